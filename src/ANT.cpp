@@ -115,6 +115,17 @@ ANT::ANT(QObject *parent, DeviceConfiguration *devConf) : QThread(parent), devCo
     usb2 = new LibUsb(TYPE_ANT);
 #endif
     channels = 0;
+    recorder = NULL;
+
+#ifndef WIN32
+    // commands write to this to wake the receive loop
+    if (pipe(wakePipe) == 0) {
+        fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+    } else {
+        wakePipe[0] = wakePipe[1] = -1;
+    }
+#endif
 }
 
 ANT::~ANT()
@@ -122,6 +133,12 @@ ANT::~ANT()
 #if defined GC_HAVE_LIBUSB
     delete usb2;
 #endif
+#ifndef WIN32
+    if (wakePipe[0] != -1) {
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+    }
+#endif
 }
 
 void ANT::setDevice(QString x)
@@ -150,6 +167,8 @@ void ANT::setWheelRpm(float x) {
     // we can default to the global setting
     if (devConf) telemetry.setSpeed(x * devConf->wheelSize / 1000 * 60 / 1000);
     else telemetry.setSpeed(x * appsettings->value(NULL, GC_WHEELSIZE, 2100).toInt() / 1000 * 60 / 1000);
+
+    if (recorder) recorder->record(recorderDevice, SessionRecorder::Speed, telemetry.getSpeed());
 }
 
 /*======================================================================
@@ -160,6 +179,7 @@ void ANT::run()
 {
     int status; // control commands from controller
     powerchannels = 0;
+    stats.reset();
 
     Status = ANT_RUNNING;
     QString strBuf;
@@ -185,23 +205,31 @@ void ANT::run()
         return;
     }
 
+    uint8_t rxBuffer[ANT_RXBUFFER];
+
     while(1)
     {
-        // read more bytes from the device
-        uint8_t byte;
-        if (rawRead(&byte, 1) > 0) receiveByte((unsigned char)byte);
-        else msleep(5);
+        // wait for the device, then take everything it has buffered
+        // in one go rather than a byte at a time
+        int n = readAvailable(rxBuffer, ANT_RXBUFFER, ANT_RXWAIT);
+        for (int i=0; i<n; i++) receiveByte((unsigned char)rxBuffer[i]);
+        if (n > 0) {
+            published.publish(telemetry);
+            stats.queued(n);
+        }
 
         //----------------------------------------------------------------------
         // LISTEN TO CONTROLLER FOR COMMANDS
         //----------------------------------------------------------------------
-        pvars.lock();
+        stats.lock(pvars);
         status = this->Status;
+        QQueue<setChannelAtom> commands = channelQueue;
+        channelQueue.clear();
         pvars.unlock();
 
-        // do we have a channel to search / stop
-        if (!channelQueue.isEmpty()) {
-            setChannelAtom x = channelQueue.dequeue();
+        // do we have channels to search / stop
+        while (!commands.isEmpty()) {
+            setChannelAtom x = commands.dequeue();
             if (x.device_number == -1) antChannel[x.channel]->close(); // unassign
             else addDevice(x.device_number, x.channel_type, x.channel); // assign
         }
@@ -333,10 +361,20 @@ ANT::stop()
     pvars.lock();
     Status = 0; // Terminate it!
     pvars.unlock();
+    wakeup();
 
     return 0;
 }
 
+void
+ANT::setChannel(int channel, int device_number, int channel_type)
+{
+    pvars.lock();
+    channelQueue.enqueue(setChannelAtom(channel, device_number, channel_type));
+    pvars.unlock();
+    wakeup();
+}
+
 int
 ANT::quit(int code)
 {
@@ -356,7 +394,7 @@ ANT::getRealtimeData(RealtimeData &rtData)
     long load = rtData.getLoad();
     double slope = rtData.getSlope();
 
-    rtData = telemetry;
+    rtData = published.read();
     rtData.mode = mode;
     rtData.setLoad(load);
     rtData.setSlope(slope);
@@ -705,6 +743,7 @@ void
 ANT::processMessage(void) {
 
     ANTMessage m(this, rxMessage); // for debug!
+    stats.arrived();
 
 //fprintf(stderr, "<< receive: ");
 //for(int i=0; i<m.length+3; i++) fprintf(stderr, "%02x ", m.data[i]);
@@ -953,6 +992,78 @@ int ANT::rawRead(uint8_t bytes[], int size)
     return -1; // keep compiler happy.
 }
 
+// wait up to timeout ms for data then return as much as is buffered
+// up to size bytes, returns 0 if there is nothing or we were woken up
+int ANT::readAvailable(uint8_t bytes[], int size, int timeout)
+{
+    int rc;
+
+#ifdef WIN32
+    switch (usbMode) {
+    case USB1:
+        rc = USBXpress::read(&devicePort, bytes, size);
+        break;
+    case USB2:
+        rc = usb2->read((char *)bytes, size, timeout);
+        break;
+    default:
+        rc = -1;
+        break;
+    }
+
+    // USBXpress doesn't block so don't spin
+    if (rc <= 0 && usbMode != USB2) msleep(5);
+    return rc > 0 ? rc : 0;
+
+#else
+
+#ifdef GC_HAVE_LIBUSB
+    if (usbMode == USB2) {
+        rc = usb2->read((char *)bytes, size, timeout); // bulk read blocks until data or timeout
+        return rc > 0 ? rc : 0;
+    }
+#endif
+
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(devicePort, &readfds);
+    int maxfd = devicePort;
+    if (wakePipe[0] != -1) {
+        FD_SET(wakePipe[0], &readfds);
+        if (wakePipe[0] > maxfd) maxfd = wakePipe[0];
+    }
+
+    struct timeval tv;
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+
+    if (select(maxfd+1, &readfds, NULL, NULL, &tv) <= 0) return 0; // timed out
+
+    // drain the wakeups, they're just to get us out of select
+    if (wakePipe[0] != -1 && FD_ISSET(wakePipe[0], &readfds)) {
+        char drain[16];
+        while (read(wakePipe[0], drain, sizeof(drain)) > 0) ;
+    }
+
+    if (!FD_ISSET(devicePort, &readfds)) return 0;
+
+    // non-blocking port so we just get what is there
+    rc = read(devicePort, bytes, size);
+    return rc > 0 ? rc : 0;
+#endif
+}
+
+void ANT::wakeup()
+{
+#ifndef WIN32
+    if (wakePipe[1] != -1) {
+        char c = 0;
+        ssize_t rc = write(wakePipe[1], &c, 1); // if full its awake anyway
+        Q_UNUSED(rc);
+    }
+#endif
+}
+
 // convert 'p' 'c' etc into ANT values for device type
 int ANT::interpretSuffix(char c)
 {
@@ -26,6 +26,9 @@
 #include "GoldenCheetah.h"
 #include "RealtimeData.h"
 #include "DeviceConfiguration.h"
+#include "TelemetrySnapshot.h"
+#include "DeviceStats.h"
+#include "SessionRecorder.h"
 
 //
 // QT stuff
@@ -65,6 +68,7 @@
 #include <termios.h> // unix!!
 #include <unistd.h> // unix!!
 #include <sys/ioctl.h>
+#include <sys/select.h>
 #ifndef N_TTY // for OpenBSD
 #define N_TTY 0
 #endif
@@ -82,6 +86,11 @@
 #define ANT_READTIMEOUT    1000
 #define ANT_WRITETIMEOUT   2000
 
+// the receive loop waits this long for data before checking for
+// commands, on unix a command wakes it up straight away
+#define ANT_RXWAIT         10
+#define ANT_RXBUFFER       256
+
 class ANTMessage;
 class ANTChannel;
 
@@ -274,9 +283,7 @@ public slots:
     int setup();                                // reset system, network key and device pairing - moved out of start()
     bool isConfiguring() { return configuring; }
     void setConfigurationMode(bool x) { configuring = x; }
-    void setChannel(int channel, int device_number, int channel_type) {
-        channelQueue.enqueue(setChannelAtom(channel, device_number, channel_type));
-    }
+    void setChannel(int channel, int device_number, int channel_type);
     bool find();                              // find usb device
     bool discover(QString name);              // confirm Server available at portSpec
 
@@ -330,30 +337,43 @@ public:
     int closePort();
     int rawRead(uint8_t bytes[], int size);
     int rawWrite(uint8_t *bytes, int size);
+    int readAvailable(uint8_t bytes[], int size, int timeout); // whatever is buffered
+    void wakeup();                                               // interrupt readAvailable
 
     // channels update our telemetry
     double channelValue(int channel);
     double channelValue2(int channel);
     void setBPM(float x) {
         telemetry.setHr(x);
+        if (recorder) recorder->record(recorderDevice, SessionRecorder::HeartRate, x);
     }
     void setCadence(float x) {
         telemetry.setCadence(x);
+        if (recorder) recorder->record(recorderDevice, SessionRecorder::Cadence, x);
     }
     void setWheelRpm(float x);
     void setWatts(float x) {
         telemetry.setWatts(x);
+        if (recorder) recorder->record(recorderDevice, SessionRecorder::Watts, x);
     }
     void setAltWatts(float x) {
         telemetry.setAltWatts(x);
+        if (recorder) recorder->record(recorderDevice, SessionRecorder::AltWatts, x);
     }
 
+    // raw samples are sent to the recorder as they arrive
+    void setRecorder(SessionRecorder *recorder, int device) { this->recorder = recorder; recorderDevice = device; }
+    DeviceStats stats;          // message timings, see DeviceStats
+
 private:
 
     void run();
 
-    RealtimeData telemetry;
-    QMutex pvars;  // lock/unlock access to telemetry data between thread and controller
+    RealtimeData telemetry;                 // updated by the channels in the thread
+    TelemetrySnapshot<RealtimeData> published; // what the controller sees
+    QMutex pvars;  // lock/unlock access to control data between thread and controller
+    SessionRecorder *recorder;      // where raw samples go, if recording
+    int recorderDevice;
     int Status;     // what status is the client in?
     bool configuring; // set to true if we're in configuration mode.
     int channels;  // how many 4 or 8 ? depends upon the USB stick...
@@ -368,6 +388,7 @@ private:
 #else
     int devicePort;                 // unix!!
     struct termios deviceSettings;  // unix!!
+    int wakePipe[2];                // to wake the receive loop
 #endif
 
 #if defined GC_HAVE_LIBUSB
@@ -392,7 +413,7 @@ private:
     int checksum;
     int powerchannels; // how many power channels do we have?
 
-    QQueue<setChannelAtom> channelQueue; // messages for configuring channels from controller
+    QQueue<setChannelAtom> channelQueue; // messages for configuring channels from controller, guarded by pvars
 
 };
 
@@ -234,7 +234,7 @@ void ANTChannel::sendCinqoSuccess() {}
 //
 void ANTChannel::broadcastEvent(unsigned char *ant_message)
 {
-    ANTMessage antMessage(parent, ant_message);
+    antMessage.decodeBroadcast(channel_type, ant_message);
     bool savemessage = true; // flag to stop lastmessage being
                              // overwritten for standard power
                              // messages
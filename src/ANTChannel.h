@@ -80,6 +80,7 @@ class ANTChannel : public QObject {
 
         ANT *parent;
 
+        ANTMessage antMessage; // each broadcast is decoded into this
         ANTMessage lastMessage, lastStdPwrMessage;
         int dualNullCount, nullCount, stdNullCount;
         double last_message_timestamp;
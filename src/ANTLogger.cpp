@@ -16,11 +16,26 @@
  * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
- #include "ANTLogger.h"
+#include "ANTLogger.h"
+#include "Settings.h"
+#include <QDebug>
 
-ANTLogger::ANTLogger(QObject *parent) : QObject(parent)
+// how often the writer wakes to write out what has arrived
+static const int drainMsecs = 100;
+
+ANTLogger::ANTLogger(QObject *parent) : QObject(parent), writer(this)
 {
     isLogging=false;
+    compress=false;
+    last=0;
+    dequeuePos=0;
+    queue = new Cell[queueSize];
+}
+
+ANTLogger::~ANTLogger()
+{
+    close();
+    delete[] queue;
 }
 
 void
@@ -29,8 +44,26 @@ ANTLogger::open()
     if (isLogging) return;
 
     antlog.setFileName("antlog.bin");
-    antlog.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if (!antlog.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+
+    compress = appsettings->value(this, GC_ANTLOG_COMPRESS, false).toBool();
+    antlog.write("GCANTLOG", 8);
+    antlog.putChar(2); // version, the first had no header or timestamps
+    antlog.putChar(compress ? 1 : 0);
+
+    // empty, every cell waiting for the writer's first lap
+    for (int i=0; i<queueSize; i++) queue[i].sequence = i;
+    enqueuePos = 0;
+    dequeuePos = 0;
+    dropped = 0;
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    last = qint64(now.tv_sec) * 1000000 + now.tv_usec;
+
     isLogging=true;
+    writer.stopping = 0;
+    writer.start(QThread::LowPriority);
 }
 
 void
@@ -38,17 +71,80 @@ ANTLogger::close()
 {
     if (!isLogging) return;
 
-    antlog.close();
+    // the writer drains what is left on the way out
+    writer.stopping = 1;
+    writer.wait();
     isLogging=false;
+
+    antlog.close();
+    if (dropped) qDebug() << "ANTLogger:" << int(dropped) << "messages not logged, the disk was too slow";
 }
 
 void ANTLogger::logRawAntMessage(const ANTMessage message, const struct timeval timestamp)
 {
-    Q_UNUSED(timestamp); // not used at present
-    if (isLogging) {
-        QDataStream out(&antlog);
+    if (!isLogging) return;
+
+    // claim the next cell, unless the writer hasn't emptied it yet
+    int pos = enqueuePos;
+    Cell *cell;
+    forever {
+        cell = &queue[pos & (queueSize - 1)];
+        int turn = cell->sequence.fetchAndAddAcquire(0) - pos;
+        if (turn == 0) {
+            if (enqueuePos.testAndSetRelaxed(pos, pos + 1)) break;
+            pos = enqueuePos;
+        } else if (turn < 0) {
+            dropped.ref();
+            return;
+        } else {
+            pos = enqueuePos;
+        }
+    }
+
+    cell->usecs = qint64(timestamp.tv_sec) * 1000000 + timestamp.tv_usec;
+    memcpy(cell->data, message.data, ANT_MAX_MESSAGE_SIZE);
+    cell->sequence.fetchAndStoreRelease(pos + 1); // the writer's now
+}
+
+void
+ANTLogger::drain()
+{
+    QByteArray records;
+    forever {
+        Cell *cell = &queue[dequeuePos & (queueSize - 1)];
+        if (cell->sequence.fetchAndAddAcquire(0) - (dequeuePos + 1) < 0) break; // empty
+
+        // relative to the one before, 32 bits is over an hour
+        qint64 delta = qBound(qint64(0), cell->usecs - last, qint64(0xffffffff));
+        last = cell->usecs;
+        for (int i=0; i<4; i++) records.append(char((delta >> (8*i)) & 0xff));
+
+        int length = qMin(int(cell->data[1]) + 4, ANT_MAX_MESSAGE_SIZE);
+        records.append(reinterpret_cast<const char *>(cell->data), length);
 
-        for (int i=0; i<ANT_MAX_MESSAGE_SIZE; i++)
-            out<<message.data[i];
+        // free for the producers' next lap
+        cell->sequence.fetchAndStoreRelease(dequeuePos + queueSize);
+        dequeuePos++;
+    }
+    if (records.isEmpty()) return;
+
+    if (compress) {
+        QByteArray block = qCompress(records);
+        quint32 size = block.size();
+        for (int i=0; i<4; i++) antlog.putChar(char((size >> (8*i)) & 0xff));
+        antlog.write(block);
+    } else {
+        antlog.write(records);
+    }
+    antlog.flush();
+}
+
+void
+ANTLogWriter::run()
+{
+    while (!stopping) {
+        logger->drain();
+        msleep(drainMsecs);
     }
+    logger->drain();
 }
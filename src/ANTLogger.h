@@ -18,29 +18,78 @@
 
 #include <sys/time.h>
 #include <QObject>
+#include <QThread>
+#include <QFile>
+#include <QAtomicInt>
 #include "ANTMessage.h"
 
 #ifndef ANTLOGGER_H
 #define ANTLOGGER_H
 
+class ANTLogger;
+
+// drains the logger's queue to antlog.bin every so often, so
+// the ANT threads never wait for the disk
+class ANTLogWriter : public QThread
+{
+public:
+    ANTLogWriter(ANTLogger *logger) : logger(logger) {}
+    void run();
+
+    QAtomicInt stopping;
+
+private:
+    ANTLogger *logger;
+};
+
+// antlog.bin starts with "GCANTLOG", a version byte and a flags byte. Each
+// record is a 32 bit little endian count of microseconds since the record
+// before (or since the log was opened) followed by the message as received:
+// sync, length, id, length bytes of payload and checksum. When the flags
+// byte is 1 the records are in blocks, each a 32 bit little endian size
+// followed by that many bytes of qCompress()ed records.
 class ANTLogger : public QObject
 {
     Q_OBJECT
 public:
     explicit ANTLogger(QObject *parent = 0);
+    ~ANTLogger();
     
 signals:
     
 public slots:
+    // called on the ANT thread that received it,
+    // connect with Qt::DirectConnection
     void logRawAntMessage(const ANTMessage message, const struct timeval timestamp);
     void open();
     void close();
 
 private:
+    friend class ANTLogWriter;
+
+    // written by the writer thread
+    void drain();
+
     // antlog.bin ant message stream
     QFile antlog;
     bool isLogging;
+    bool compress;
+    qint64 last; // usecs of the last record written
+
+    // a bounded queue any number of ANT threads can add to and the writer
+    // takes from without locking, each cell's sequence says whose turn it is
+    static const int queueSize = 4096; // a power of 2
+    struct Cell {
+        QAtomicInt sequence;
+        qint64 usecs;
+        unsigned char data[ANT_MAX_MESSAGE_SIZE];
+    };
+    Cell *queue;
+    QAtomicInt enqueuePos;
+    int dequeuePos;
+    QAtomicInt dropped; // when the writer fell behind
 
+    ANTLogWriter writer;
 };
 
 #endif // ANTLOGGER_H
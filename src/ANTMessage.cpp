@@ -218,10 +218,196 @@ ANTMessage::channelEventMessage(unsigned char c)
     }
 }
 
+//
+// Broadcast page decoders, one per device profile (channel type)
+//
+// Each sets only the fields its profile's pages carry, straight from
+// the receive buffer, see decodeBroadcast() below.
+//
+
+// Heartrate is fairly simple. Although
+// many older heart rate devices do not support
+// multiple data pages, and provide random values
+// for the data page itself. (E.g. 1st Gen GARMIN)
+// since we do not care hugely about operating time
+// and serial numbers etc, we don't even try
+static void decodeHeartRate(ANTMessage &m, const unsigned char *message)
+{
+    m.measurementTime = message[8] + (message[9]<<8);
+    m.heartrateBeats =  message[10];
+    m.instantHeartrate = message[11];
+}
+
+/*
+ * these are not supported at present:
+ * power         calibration_request None,channel,0x01,0xAA,None,None,None,None,None,None
+ * power         srm_zero_response   None,channel,0x01,0x10,0x01,None,None,None,uint16_be:offset
+ * power         calibration_pass    None,channel,0x01,0xAC,uint8:autozero_status,None,None,None,uint16_le:calibration_data
+ * power         calibration_fail    None,channel,0x01,0xAF,uint8:autozero_status,None,None,None,uint16_le:calibration_data
+ * power         torque_support      None,channel,0x01,0x12,uint8:sensor_configuration,sint16_le:raw_torque,
+ *                                                     sint16_le:offset_torque,None
+ */
+static void decodePower(ANTMessage &m, const unsigned char *message)
+{
+    switch (m.data_page) {
+
+    case ANT_STANDARD_POWER: // 0x10 - standard power
+
+        m.eventCount = message[5];
+        m.pedalPower = message[6]; // left/right 0xFF = not used
+        m.instantCadence = message[7];
+        m.sumPower = message[8] + (message[9]<<8);
+        m.instantPower = message[10] + (message[11]<<8);
+        break;
+
+    case ANT_WHEELTORQUE_POWER: // 0x11 - wheel torque (Powertap)
+        m.eventCount = message[5];
+        m.wheelRevolutions = message[6];
+        m.instantCadence = message[7];
+        m.period = message[8] + (message[9]<<8);
+        m.torque = message[10] + (message[11]<<8);
+        break;
+
+    case ANT_CRANKTORQUE_POWER: // 0x12 - crank torque (Quarq)
+        m.eventCount = message[5];
+        m.crankRevolutions = message[6];
+        m.instantCadence = message[7];
+        m.period = message[8] + (message[9]<<8);
+        m.torque = message[10] + (message[11]<<8);
+        break;
+
+    case ANT_CRANKSRM_POWER: // 0x20 - crank torque (SRM)
+        m.eventCount = message[5];
+        m.slope = message[7] + (message[6]<<8); // yes it is bigendian
+        m.period = message[9] + (message[8]<<8); // yes it is bigendian
+        m.torque = message[11] + (message[10]<<8); // yes it is bigendian
+        break;
+
+    case ANT_SPORT_CALIBRATION_MESSAGE:
+
+        // calibrations are acknowledged by sending them back
+        memcpy(m.data, message, ANT_MAX_MESSAGE_SIZE);
+
+        m.calibrationID = message[5];
+        m.ctfID = message[6];
+
+        switch (m.calibrationID) {
+
+            case ANT_SPORT_SRM_CALIBRATIONID: // 0x01
+
+                switch(m.ctfID) { // different types of calibration for SRMs
+
+                case 0x01 : // srm_offset
+                    m.srmOffset = message[11] + (message[10]<<8); // yes it is bigendian
+                    break;
+
+                case 0x02 : // slope
+                    m.srmSlope = message[11] + (message[10]<<8); // yes it is bigendian
+                    break;
+
+                case 0x03 : //serial number
+                    m.srmSerial = message[11] + (message[10]<<8); // yes it is bigendian
+                    break;
+
+                default:
+                case 0xAC : // ack
+                    break;
+                }
+                break;
+
+            case ANT_SPORT_ZEROOFFSET_SUCCESS: //0xAC
+            // is also ANT_SPORT_AUTOZERO_SUCCESS: // 0xAC
+                m.autoZeroStatus = message[6];
+                break;
+
+            case ANT_SPORT_ZEROOFFSET_FAIL: //0xAF
+            // is also ANT_SPORT_AUTOZERO_FAIL: // 0xAF
+                m.autoZeroStatus = message[6];
+                break;
+
+            case ANT_SPORT_AUTOZERO_SUPPORT: //0x12
+                m.autoZeroEnable = message[6] & 0x01;
+                m.autoZeroStatus = message[6] & 0x02;
+                break;
+
+            default:
+                break;
+
+        }
+        break;
+    } // data_page
+}
+
+static void decodeSpeed(ANTMessage &m, const unsigned char *message)
+{
+    m.wheelMeasurementTime = message[8] + (message[9]<<8);
+    m.wheelRevolutions =  message[10] + (message[11]<<8);
+}
+
+static void decodeCadence(ANTMessage &m, const unsigned char *message)
+{
+    m.crankMeasurementTime = message[8] + (message[9]<<8);
+    m.crankRevolutions =  message[10] + (message[11]<<8);
+}
+
+static void decodeSpeedAndCadence(ANTMessage &m, const unsigned char *message)
+{
+    m.crankMeasurementTime = message[4] + (message[5]<<8);
+    m.crankRevolutions =  message[6] + (message[7]<<8);
+    m.wheelMeasurementTime = message[8] + (message[9]<<8);
+    m.wheelRevolutions =  message[10] + (message[11]<<8);
+}
+
+// indexed by ANTChannel::CHANNEL_TYPE_XXX, NULL means we ignore its pages
+// a new profile (e.g. fitness equipment) needs an entry here
+typedef void (*PageDecoder)(ANTMessage &, const unsigned char *);
+static const PageDecoder pageDecoders[ANTChannel::CHANNEL_TYPE_GUARD] = {
+    NULL,                   // CHANNEL_TYPE_UNUSED
+    decodeHeartRate,        // CHANNEL_TYPE_HR
+    decodePower,            // CHANNEL_TYPE_POWER
+    decodeSpeed,            // CHANNEL_TYPE_SPEED
+    decodeCadence,          // CHANNEL_TYPE_CADENCE
+    decodeSpeedAndCadence,  // CHANNEL_TYPE_SandC
+    decodePower,            // CHANNEL_TYPE_QUARQ
+    decodePower,            // CHANNEL_TYPE_FAST_QUARQ
+    decodePower             // CHANNEL_TYPE_FAST_QUARQ_NEW
+};
+
+// decode broadcast data into this message as it stands, only the
+// header and the fields the profile's page carries are set so the
+// same message can be reused for every broadcast on a channel
+void ANTMessage::decodeBroadcast(int channelType, const unsigned char *message)
+{
+    sync = message[0];
+    length = message[1];
+    type = message[2];
+    channel = message[3];
+    data_page = message[4];
+
+    if (channelType >= 0 && channelType < ANTChannel::CHANNEL_TYPE_GUARD && pageDecoders[channelType])
+        pageDecoders[channelType](*this, message);
+}
+
 // construct an ant message based upon a message structure
 // the message structure must include the sync byte
 ANTMessage::ANTMessage(ANT *parent, const unsigned char *message) {
 
+    // broadcast data is decoded by the type of device on the channel
+    int channelType = ANTChannel::CHANNEL_TYPE_UNUSED;
+    if (message[2] == ANT_BROADCAST_DATA) channelType = parent->antChannel[message[3]]->channel_type;
+
+    decode(channelType, message);
+}
+
+// as above, but the caller tracks the channel types themselves
+// e.g. when decoding a log of messages rather than a live device
+ANTMessage::ANTMessage(int channelType, const unsigned char *message) {
+
+    decode(channelType, message);
+}
+
+void ANTMessage::decode(int channelType, const unsigned char *message) {
+
     // Initialise all fields to invalid
     init();
 
@@ -353,148 +539,8 @@ ANTMessage::ANTMessage(ANT *parent, const unsigned char *message) {
             //   0x50 - Manufacturer UD
             //   0x52 - Battery Voltage
 
-            data_page = message[4];
-
-            // we need to handle ant sport messages here
-            switch(parent->antChannel[message[3]]->channel_type) {
-
-            // Heartrate is fairly simple. Although
-            // many older heart rate devices do not support
-            // multiple data pages, and provide random values
-            // for the data page itself. (E.g. 1st Gen GARMIN)
-            // since we do not care hugely about operating time
-            // and serial numbers etc, we don't even try
-            case ANTChannel::CHANNEL_TYPE_HR:
-                channel = message[3];
-                measurementTime = message[8] + (message[9]<<8);
-                heartrateBeats =  message[10];
-                instantHeartrate = message[11];
-                break;
-
-/*
- * these are not supported at present:
- * power         calibration_request None,channel,0x01,0xAA,None,None,None,None,None,None
- * power         srm_zero_response   None,channel,0x01,0x10,0x01,None,None,None,uint16_be:offset
- * power         calibration_pass    None,channel,0x01,0xAC,uint8:autozero_status,None,None,None,uint16_le:calibration_data
- * power         calibration_fail    None,channel,0x01,0xAF,uint8:autozero_status,None,None,None,uint16_le:calibration_data
- * power         torque_support      None,channel,0x01,0x12,uint8:sensor_configuration,sint16_le:raw_torque,
- *                                                     sint16_le:offset_torque,None
- */
-            case ANTChannel::CHANNEL_TYPE_POWER:
-            case ANTChannel::CHANNEL_TYPE_QUARQ:
-            case ANTChannel::CHANNEL_TYPE_FAST_QUARQ:
-            case ANTChannel::CHANNEL_TYPE_FAST_QUARQ_NEW:
-
-                channel = message[3];
-
-                switch (data_page) {
-
-                case ANT_STANDARD_POWER: // 0x10 - standard power
-
-                    eventCount = message[5];
-                    pedalPower = message[6]; // left/right 0xFF = not used
-                    instantCadence = message[7];
-                    sumPower = message[8] + (message[9]<<8);
-                    instantPower = message[10] + (message[11]<<8);
-                    break;
-
-                case ANT_WHEELTORQUE_POWER: // 0x11 - wheel torque (Powertap)
-                    eventCount = message[5];
-                    wheelRevolutions = message[6];
-                    instantCadence = message[7];
-                    period = message[8] + (message[9]<<8);
-                    torque = message[10] + (message[11]<<8);
-                    break;
-
-                case ANT_CRANKTORQUE_POWER: // 0x12 - crank torque (Quarq)
-                    eventCount = message[5];
-                    crankRevolutions = message[6];
-                    instantCadence = message[7];
-                    period = message[8] + (message[9]<<8);
-                    torque = message[10] + (message[11]<<8);
-                    break;
-
-                case ANT_CRANKSRM_POWER: // 0x20 - crank torque (SRM)
-                    eventCount = message[5];
-                    slope = message[7] + (message[6]<<8); // yes it is bigendian
-                    period = message[9] + (message[8]<<8); // yes it is bigendian
-                    torque = message[11] + (message[10]<<8); // yes it is bigendian
-                    break;
-
-                case ANT_SPORT_CALIBRATION_MESSAGE:
-
-                    calibrationID = message[5];
-                    ctfID = message[6];
-
-                    switch (calibrationID) {
-
-                        case ANT_SPORT_SRM_CALIBRATIONID: // 0x01
-
-                            switch(ctfID) { // different types of calibration for SRMs
-
-                            case 0x01 : // srm_offset
-                                srmOffset = message[11] + (message[10]<<8); // yes it is bigendian
-                                break;
-
-                            case 0x02 : // slope
-                                srmSlope = message[11] + (message[10]<<8); // yes it is bigendian
-                                break;
-
-                            case 0x03 : //serial number
-                                srmSerial = message[11] + (message[10]<<8); // yes it is bigendian
-                                break;
-
-                            default:
-                            case 0xAC : // ack
-                                break;
-                            }
-                            break;
-
-                        case ANT_SPORT_ZEROOFFSET_SUCCESS: //0xAC
-                        // is also ANT_SPORT_AUTOZERO_SUCCESS: // 0xAC
-                            autoZeroStatus = message[6];
-                            break;
-
-                        case ANT_SPORT_ZEROOFFSET_FAIL: //0xAF
-                        // is also ANT_SPORT_AUTOZERO_FAIL: // 0xAF
-                            autoZeroStatus = message[6];
-                            break;
-
-                        case ANT_SPORT_AUTOZERO_SUPPORT: //0x12
-                            autoZeroEnable = message[6] & 0x01;
-                            autoZeroStatus = message[6] & 0x02;
-                            break;
-
-                        default: 
-                            break;
-
-                    }
-                    break;
-                } // data_page
-                break;
-
-            case ANTChannel::CHANNEL_TYPE_SPEED:
-                channel = message[3];
-                wheelMeasurementTime = message[8] + (message[9]<<8);
-                wheelRevolutions =  message[10] + (message[11]<<8);
-                break;
-
-            case ANTChannel::CHANNEL_TYPE_CADENCE:
-                channel = message[3];
-                crankMeasurementTime = message[8] + (message[9]<<8);
-                crankRevolutions =  message[10] + (message[11]<<8);
-                break;
-
-            case ANTChannel::CHANNEL_TYPE_SandC:
-                channel = message[3];
-                crankMeasurementTime = message[4] + (message[5]<<8);
-                crankRevolutions =  message[6] + (message[7]<<8);
-                wheelMeasurementTime = message[8] + (message[9]<<8);
-                wheelRevolutions =  message[10] + (message[11]<<8);
-                break;
-            default:
-                break;
-            }
+            // only the fields the channel's profile uses are decoded
+            decodeBroadcast(channelType, message);
             break;
         case ANT_ACK_DATA:
             break;
@@ -29,6 +29,10 @@ class ANTMessage {
 
         ANTMessage(); // null message
         ANTMessage(ANT *parent, const unsigned char *data); // decode from parameters
+        ANTMessage(int channelType, const unsigned char *data); // decode for a CHANNEL_TYPE_XXX
+
+        // decode broadcast data in place, only setting the fields the profile uses
+        void decodeBroadcast(int channelType, const unsigned char *data);
         ANTMessage(unsigned char b1,
                    unsigned char b2 = '\0',
                    unsigned char b3 = '\0',
@@ -105,5 +109,6 @@ class ANTMessage {
 
     private:
         void init();
+        void decode(int channelType, const unsigned char *data);
 };
 #endif
@@ -25,27 +25,81 @@
 
 ANTlocalController::ANTlocalController(TrainSidebar *parent, DeviceConfiguration *dc) : RealtimeController(parent, dc)
 {
-    myANTlocal = new ANT (parent, dc);
-    connect(myANTlocal, SIGNAL(foundDevice(int,int,int)), this, SIGNAL(foundDevice(int,int,int)));
-    connect(myANTlocal, SIGNAL(lostDevice(int)), this, SIGNAL(lostDevice(int)));
-    connect(myANTlocal, SIGNAL(searchTimeout(int)), this, SIGNAL(searchTimeout(int)));
+    QStringList ports;
+    if (dc) ports = dc->portSpec.split(",", QString::SkipEmptyParts);
 
-    // Connect a logger
-    connect(myANTlocal, SIGNAL(receivedAntMessage(const ANTMessage ,const timeval )), &logger, SLOT(logRawAntMessage(const ANTMessage ,const timeval)));
+    if (ports.count() > 1) setSticks(ports);
+    else addStick(new ANT (parent, dc));
+}
+
+ANTlocalController::~ANTlocalController()
+{
+    qDeleteAll(stickConfigs);
+}
+
+void
+ANTlocalController::addStick(ANT *stick)
+{
+    if (sticks.isEmpty()) myANTlocal = stick;
+    sticks << stick;
+
+    connect(stick, SIGNAL(foundDevice(int,int,int)), this, SLOT(stickFoundDevice(int,int,int)));
+    connect(stick, SIGNAL(lostDevice(int)), this, SLOT(stickLostDevice(int)));
+    connect(stick, SIGNAL(searchTimeout(int)), this, SLOT(stickSearchTimeout(int)));
+
+    // Connect a logger, it queues them on the stick's thread
+    connect(stick, SIGNAL(receivedAntMessage(const ANTMessage ,const timeval )), &logger, SLOT(logRawAntMessage(const ANTMessage ,const timeval)),
+            Qt::DirectConnection);
+}
+
+// one ANT per stick, each with its share of the configured ANT ids
+void
+ANTlocalController::setSticks(QStringList ports)
+{
+    qDeleteAll(sticks);
+    qDeleteAll(stickConfigs);
+    sticks.clear();
+    stickConfigs.clear();
+
+    QStringList antIDs;
+    if (dc && dc->deviceProfile.length()) antIDs = dc->deviceProfile.split(",");
+
+    for (int i=0; i<ports.count(); i++) {
+
+        DeviceConfiguration *config = NULL;
+        if (dc) {
+            config = new DeviceConfiguration(*dc);
+            config->portSpec = ports[i];
+            config->deviceProfile = QStringList(antIDs.mid(i * ANT_MAX_CHANNELS, ANT_MAX_CHANNELS)).join(",");
+            stickConfigs << config;
+        }
+
+        ANT *stick = new ANT(parent, config);
+        stick->setDevice(ports[i]);
+
+        // only the first stick pairs with whatever it can find
+        // when no devices have been configured
+        if (i && antIDs.count() <= i * ANT_MAX_CHANNELS) stick->setConfigurationMode(true);
+
+        addStick(stick);
+    }
 }
 
 void
 ANTlocalController::setDevice(QString device)
 {
-    myANTlocal->setDevice(device);
+    QStringList ports = device.split(",", QString::SkipEmptyParts);
+
+    if (ports.count() > 1 || sticks.count() > 1) setSticks(ports);
+    else myANTlocal->setDevice(device);
 }
 
 int
 ANTlocalController::start()
 {
     logger.open();
-    myANTlocal->start();
-    myANTlocal->setup();
+    foreach(ANT *stick, sticks) stick->start();
+    foreach(ANT *stick, sticks) stick->setup();
     return 0;
 }
 
@@ -53,25 +107,113 @@ ANTlocalController::start()
 int
 ANTlocalController::restart()
 {
-    return myANTlocal->restart();
+    int rc = 0;
+    foreach(ANT *stick, sticks) rc |= stick->restart();
+    return rc;
 }
 
 
 int
 ANTlocalController::pause()
 {
-    return myANTlocal->pause();
+    int rc = 0;
+    foreach(ANT *stick, sticks) rc |= stick->pause();
+    return rc;
 }
 
 
 int
 ANTlocalController::stop()
 {
-    int rc =  myANTlocal->stop();
+    int rc = 0;
+    foreach(ANT *stick, sticks) rc |= stick->stop();
     logger.close();
     return rc;
 }
 
+void
+ANTlocalController::setRecorder(SessionRecorder *recorder, int device)
+{
+    foreach(ANT *stick, sticks) stick->setRecorder(recorder, device);
+}
+
+void
+ANTlocalController::setConfigurationMode(bool x)
+{
+    foreach(ANT *stick, sticks) stick->setConfigurationMode(x);
+}
+
+//
+// Channels are numbered across the sticks in turn
+//
+int
+ANTlocalController::channels()
+{
+    int count = 0;
+    foreach(ANT *stick, sticks) count += stick->channelCount();
+    return count;
+}
+
+ANT *
+ANTlocalController::stickFor(int &channel)
+{
+    foreach(ANT *stick, sticks) {
+        if (channel < stick->channelCount()) return stick;
+        channel -= stick->channelCount();
+    }
+    return NULL;
+}
+
+int
+ANTlocalController::firstChannel(QObject *stick)
+{
+    int first = 0;
+    foreach(ANT *p, sticks) {
+        if (p == stick) break;
+        first += p->channelCount();
+    }
+    return first;
+}
+
+void
+ANTlocalController::setChannel(int channel, int device_number, int device_type)
+{
+    ANT *stick = stickFor(channel);
+    if (stick) stick->setChannel(channel, device_number, device_type);
+}
+
+double
+ANTlocalController::channelValue(int channel)
+{
+    ANT *stick = stickFor(channel);
+    return stick ? stick->channelValue(channel) : 0;
+}
+
+double
+ANTlocalController::channelValue2(int channel)
+{
+    ANT *stick = stickFor(channel);
+    return stick ? stick->channelValue2(channel) : 0;
+}
+
+void
+ANTlocalController::stickFoundDevice(int channel, int device_number, int device_id)
+{
+    emit foundDevice(firstChannel(sender()) + channel, device_number, device_id);
+}
+
+void
+ANTlocalController::stickLostDevice(int channel)
+{
+    emit lostDevice(firstChannel(sender()) + channel);
+}
+
+void
+ANTlocalController::stickSearchTimeout(int channel)
+{
+    emit searchTimeout(firstChannel(sender()) + channel);
+}
+
 bool
 ANTlocalController::find()
 {
@@ -110,6 +252,19 @@ ANTlocalController::getRealtimeData(RealtimeData &rtData)
     }
     // get latest telemetry
     myANTlocal->getRealtimeData(rtData);
+
+    // the other sticks fill in what the first doesn't have
+    for (int i=1; i<sticks.count(); i++) {
+        RealtimeData other = rtData;
+        sticks[i]->getRealtimeData(other);
+
+        if (!rtData.getWatts()) rtData.setWatts(other.getWatts());
+        if (!rtData.getAltWatts()) rtData.setAltWatts(other.getAltWatts());
+        if (!rtData.getHr()) rtData.setHr(other.getHr());
+        if (!rtData.getCadence()) rtData.setCadence(other.getCadence());
+        if (!rtData.getWheelRpm()) rtData.setWheelRpm(other.getWheelRpm());
+        if (!rtData.getSpeed()) rtData.setSpeed(other.getSpeed());
+    }
     processRealtimeData(rtData);
 }
 
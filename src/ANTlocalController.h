@@ -23,7 +23,10 @@
 #include "ANTLogger.h"
 #include "ConfigDialog.h"
 
-// Abstract base class for Realtime device controllers
+// Controller for local ANT+ sticks. The port spec may list more than one
+// stick, separated by commas, in which case the channels of all of them
+// are presented as one, numbered across the sticks in turn, and the
+// telemetry from each is combined.
 
 #ifndef _GC_ANTlocalController_h
 #define _GC_ANTlocalController_h 1
@@ -35,19 +38,21 @@ class ANTlocalController : public RealtimeController
 public:
     ANTlocalController (TrainSidebar *parent =0, DeviceConfiguration *dc =0);
 
-    ANT *myANTlocal;               // the device itself
+    ~ANTlocalController();
+
+    ANT *myANTlocal;               // the device itself, or the first stick
 
     int start();
     int restart();                              // restart after paused
     int pause();                                // pauses data collection, inbound telemetry is discarded
     int stop();                                 // stops data collection thread
 
-    int channels() { return myANTlocal->channelCount(); }
-    void setChannel(int channel, int device_number, int device_type) {
-        myANTlocal->setChannel(channel,device_number,device_type); // using QQueue
-    }
-    double channelValue(int channel) { return myANTlocal->channelValue(channel); }
-    double channelValue2(int channel) { return myANTlocal->channelValue2(channel); }
+    // channels across all the sticks
+    int channels();
+    void setChannel(int channel, int device_number, int device_type); // using QQueue
+    double channelValue(int channel);
+    double channelValue2(int channel);
+    void setConfigurationMode(bool x);
 
     bool find();
     bool discover(QString name);
@@ -58,13 +63,28 @@ public:
     void getRealtimeData(RealtimeData &rtData);
     void pushRealtimeData(RealtimeData &rtData);
     void setLoad(double) { return; }
+    void setRecorder(SessionRecorder *recorder, int device);
+    DeviceStats *stats() { return &myANTlocal->stats; }
 
 signals:
     void foundDevice(int channel, int device_number, int device_id); // channelInfo
     void lostDevice(int channel);            // dropInfo
     void searchTimeout(int channel);         // searchTimeount
 
+private slots:
+    // from each stick, renumbered across all of them
+    void stickFoundDevice(int channel, int device_number, int device_id);
+    void stickLostDevice(int channel);
+    void stickSearchTimeout(int channel);
+
 private:
+    void setSticks(QStringList ports);
+    void addStick(ANT *stick);
+    ANT *stickFor(int &channel);        // and makes channel the stick's own
+    int firstChannel(QObject *stick);
+
+    QList<ANT*> sticks;
+    QList<DeviceConfiguration*> stickConfigs; // when there are several
     QQueue<setChannelAtom> channelQueue;
     ANTLogger logger;
 
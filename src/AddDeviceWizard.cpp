@@ -147,7 +147,11 @@ AddType::clicked(QString p)
     wizard->next();
 }
 
-DeviceScanner::DeviceScanner(AddDeviceWizard *wizard) : wizard(wizard) {}
+DeviceScanner::DeviceScanner(AddDeviceWizard *wizard) : wizard(wizard)
+{
+    discovery = new DeviceDiscovery(0, this);
+    connect(discovery, SIGNAL(found(QString)), this, SIGNAL(foundPort(QString)));
+}
 
 void
 DeviceScanner::run()
@@ -182,6 +186,7 @@ void
 DeviceScanner::stop()
 {
     active = false;
+    discovery->stop();
 }
 
 
@@ -197,23 +202,7 @@ DeviceScanner::quickScan(bool deep) // scan quickly or if true scan forever, as
         wizard->controller=NULL;
     }
 
-    switch (wizard->deviceTypes.Supported[wizard->current].type) {
-
-    // we will need a factory for this soon..
-    case DEV_CT : wizard->controller = new ComputrainerController(NULL, NULL); break;
-#ifdef GC_HAVE_LIBUSB
-    case DEV_FORTIUS : wizard->controller = new FortiusController(NULL, NULL); break;
-#endif
-    case DEV_NULL : wizard->controller = new NullController(NULL, NULL); break;
-    case DEV_ANTLOCAL : wizard->controller = new ANTlocalController(NULL, NULL); break;
-#ifdef GC_HAVE_WFAPI
-    case DEV_KICKR : wizard->controller = new KickrController(NULL, NULL); break;
-    case DEV_BT40 : wizard->controller = new BT40Controller(NULL, NULL); break;
-#endif
-
-    default: wizard->controller = NULL; break;
-
-    }
+    wizard->controller = DeviceDiscovery::newController(wizard->deviceTypes.Supported[wizard->current].type);
 
     //----------------------------------------------------------------------
     // Search for USB devices
@@ -240,17 +229,17 @@ DeviceScanner::quickScan(bool deep) // scan quickly or if true scan forever, as
 
         if (isfound == false && wizard->deviceTypes.Supported[wizard->current].connector == DEV_SERIAL) {
 
-            // automatically discover a serial port ...
+            // automatically discover a serial port, probing them all at once ...
+            // native ANT+ uses every stick we find, the rest just the first
+            bool allSticks = wizard->deviceTypes.Supported[wizard->current].type == DEV_ANTLOCAL;
+            QStringList candidates;
             QString error;
-            foreach (CommPortPtr port, Serial::myListCommPorts(error)) {
-
-                // check if controller still exists. gets deleted when scan cancelled
-                if (wizard->controller && wizard->controller->discover(port->name()) == true) {
-                    isfound = true;
-                    wizard->portSpec = port->name();
-                    break;
-                }
-            }
+            foreach (CommPortPtr port, Serial::myListCommPorts(error)) candidates << port->name();
+
+            discovery->setType(wizard->deviceTypes.Supported[wizard->current].type);
+            QStringList ports = discovery->discover(candidates, allSticks);
+            isfound = ports.count() > 0;
+            if (isfound) wizard->portSpec = ports.join(",");
 
             // if we still didn't find it then we need to fall back to the user
             // specifying the device on the next page
@@ -319,6 +308,7 @@ AddSearch::AddSearch(AddDeviceWizard *parent) : QWizardPage(parent), wizard(pare
     connect(stop, SIGNAL(clicked()), this, SLOT(doScan()));
     connect(manual, SIGNAL(currentIndexChanged(int)), this, SLOT(chooseCOMPort()));
     connect(wizard->scanner, SIGNAL(finished(bool)), this, SLOT(scanFinished(bool)));
+    connect(wizard->scanner, SIGNAL(foundPort(QString)), this, SLOT(portFound(QString)));
 
 }
 
@@ -411,6 +401,14 @@ AddSearch::scanFinished(bool result)
     emit completeChanged();
 }
 
+void
+AddSearch::portFound(QString port)
+{
+    // the scan carries on for any other sticks, but say so now
+    label2->setText(QString(tr("\nFound on %1...\n")).arg(port));
+    label2->show();
+}
+
 void
 AddSearch::doScan()
 {
@@ -425,6 +423,7 @@ AddSearch::doScan()
         manual->setCurrentIndex(0); //deselect any chosen port
         wizard->found = false;
         wizard->portSpec = "";
+        label2->hide();
 
         wizard->scanner->start();
 
@@ -642,7 +641,7 @@ AddPair::initializePage()
     if (signalMapper) delete signalMapper;
     wizard->controller = new ANTlocalController(NULL,NULL);
     dynamic_cast<ANTlocalController*>(wizard->controller)->setDevice(wizard->portSpec);
-    dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->setConfigurationMode(true);
+    dynamic_cast<ANTlocalController*>(wizard->controller)->setConfigurationMode(true);
     wizard->controller->start();
     wizard->profile=""; // clear any thing thats there now
     signalMapper = new QSignalMapper(this);
@@ -737,7 +736,7 @@ AddPair::sensorChanged(int channel)
     enableDisable(channelWidget);
 
     // first off lets unassign this channel
-    dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->setChannel(channel, -1, 0);
+    dynamic_cast<ANTlocalController*>(wizard->controller)->setChannel(channel, -1, 0);
     dynamic_cast<QLineEdit*>(channelWidget->itemWidget(item,1))->setText(tr("none"));
     dynamic_cast<QLabel*>(channelWidget->itemWidget(item,2))->setText(0);
 
@@ -748,7 +747,7 @@ AddPair::sensorChanged(int channel)
         dynamic_cast<QLabel*>(channelWidget->itemWidget(item,3))->setText(tr("Unused"));
     } else {
         dynamic_cast<QLabel*>(channelWidget->itemWidget(item,3))->setText(tr("Searching..."));
-    dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->setChannel(channel, 0, channel_type);
+    dynamic_cast<ANTlocalController*>(wizard->controller)->setChannel(channel, 0, channel_type);
     }
 }
 
@@ -787,12 +786,12 @@ AddPair::getChannelValues()
             // speed+cadence is two values!
             if (p->itemData(p->currentIndex()) == ANTChannel::CHANNEL_TYPE_SandC) {
             dynamic_cast<QLabel *>(channelWidget->itemWidget(item,2))->setText(QString("%1 %2")
-                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->channelValue2(i) //speed
+                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->channelValue2(i) //speed
                           * (appsettings->value(NULL, GC_WHEELSIZE, 2100).toInt()/1000) * 60 / 1000)
-                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->channelValue(i))); // cad
+                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->channelValue(i))); // cad
             } else {
             dynamic_cast<QLabel *>(channelWidget->itemWidget(item,2))->setText(QString("%1")
-                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->channelValue(i)));
+                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->channelValue(i)));
             }
         }
     }
@@ -870,7 +869,7 @@ qDebug()<<"found this many devices:"<<WFApi::getInstance()->deviceCount();
     if (signalMapper) delete signalMapper;
     wizard->controller = new ANTlocalController(NULL,NULL);
     dynamic_cast<ANTlocalController*>(wizard->controller)->setDevice(wizard->portSpec);
-    dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->setConfigurationMode(true);
+    dynamic_cast<ANTlocalController*>(wizard->controller)->setConfigurationMode(true);
     wizard->controller->start();
     wizard->profile=""; // clear any thing thats there now
     signalMapper = new QSignalMapper(this);
@@ -965,7 +964,7 @@ AddPairBTLE::sensorChanged(int channel)
     enableDisable(channelWidget);
 
     // first off lets unassign this channel
-    dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->setChannel(channel, -1, 0);
+    dynamic_cast<ANTlocalController*>(wizard->controller)->setChannel(channel, -1, 0);
     dynamic_cast<QLineEdit*>(channelWidget->itemWidget(item,1))->setText(tr("none"));
     dynamic_cast<QLabel*>(channelWidget->itemWidget(item,2))->setText(0);
 
@@ -976,7 +975,7 @@ AddPairBTLE::sensorChanged(int channel)
         dynamic_cast<QLabel*>(channelWidget->itemWidget(item,3))->setText(tr("Unused"));
     } else {
         dynamic_cast<QLabel*>(channelWidget->itemWidget(item,3))->setText(tr("Searching..."));
-    dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->setChannel(channel, 0, channel_type);
+    dynamic_cast<ANTlocalController*>(wizard->controller)->setChannel(channel, 0, channel_type);
     }
 }
 
@@ -1015,12 +1014,12 @@ AddPairBTLE::getChannelValues()
             // speed+cadence is two values!
             if (p->itemData(p->currentIndex()) == ANTChannel::CHANNEL_TYPE_SandC) {
             dynamic_cast<QLabel *>(channelWidget->itemWidget(item,2))->setText(QString("%1 %2")
-                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->channelValue2(i) //speed
+                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->channelValue2(i) //speed
                           * (appsettings->value(NULL, GC_WHEELSIZE, 2100).toInt()/1000) * 60 / 1000)
-                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->channelValue(i))); // cad
+                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->channelValue(i))); // cad
             } else {
             dynamic_cast<QLabel *>(channelWidget->itemWidget(item,2))->setText(QString("%1")
-                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->myANTlocal->channelValue(i)));
+                .arg((int)dynamic_cast<ANTlocalController*>(wizard->controller)->channelValue(i)));
             }
         }
     }
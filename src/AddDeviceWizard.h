@@ -35,6 +35,7 @@
 #include "ANTlocalController.h"
 #include "ANTChannel.h"
 #include "NullController.h"
+#include "DeviceDiscovery.h"
 #include "Settings.h"
 #include <QWizard>
 
@@ -103,6 +104,7 @@ class AddSearch : public QWizardPage
         bool validatePage();
         void doScan();
         void scanFinished(bool);
+        void portFound(QString);
         void cleanupPage();
         void chooseCOMPort();
 
@@ -224,6 +226,7 @@ class DeviceScanner : public QThread
 
 signals:
     void finished(bool); // threaded scan finished with result x
+    void foundPort(QString); // answered on this port, may still be looking
 
 public:
     DeviceScanner(AddDeviceWizard *);
@@ -236,6 +239,7 @@ private:
     QString portSpec;    // did it find a port?
 
     AddDeviceWizard *wizard;
+    DeviceDiscovery *discovery; // probes the serial ports
 };
 
 #endif // _AddDeviceWizard_h
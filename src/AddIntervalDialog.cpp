@@ -23,6 +23,8 @@
 #include "IntervalItem.h"
 #include "RideFile.h"
 #include "WPrime.h"
+#include "RideFileCache.h"
+#include "BestEfforts.h"
 #include <QMap>
 #include <math.h>
 
@@ -441,7 +443,7 @@ AddIntervalDialog::createClicked()
     if (methodBestPower->isChecked()) {
 
         if (peakPowerStandard->isChecked())
-            findPeakPowerStandard(ride, results);
+            findPeakPowerStandard(ride, results, context->rideItem());
         else {
 
             // bad window size?
@@ -463,105 +465,10 @@ AddIntervalDialog::createClicked()
     }
 
     // FIND ASCENTS
-    if (methodClimb->isChecked()) {
-
-        // we need altitude and more than 3 data points
-        if (ride->areDataPresent()->alt == false || ride->dataPoints().count() < 3) return;
-
-        double hysteresis = appsettings->value(NULL, GC_ELEVATION_HYSTERESIS).toDouble();
-        if (hysteresis <= 0.1) hysteresis = 3.00;
-
-        // first apply hysteresis
-        QVector<QPoint> points; 
-
-        int index=0;
-        int runningAlt = ride->dataPoints().first()->alt;
-
-        foreach(RideFilePoint *p, ride->dataPoints()) {
-
-            // up
-            if (p->alt > (runningAlt + hysteresis)) {
-                runningAlt = p->alt;
-                points << QPoint(index, runningAlt);
-            }
-
-            // down
-            if (p->alt < (runningAlt - hysteresis)) {
-                runningAlt = p->alt;
-                points << QPoint(index, runningAlt);
-            }
-            index++;
-        }
-
-        // now find peaks and troughs in the point data
-        // there will only be ups and downs, no flats
-        QVector<QPoint> peaks;
-        for(int i=1; i<(points.count()-1); i++) {
-
-            // peak
-            if (points[i].y() > points[i-1].y() &&
-                points[i].y() > points[i+1].y()) peaks << points[i];
-
-            // trough
-            if (points[i].y() < points[i-1].y() &&
-                points[i].y() < points[i+1].y()) peaks << points[i];
-        }
-
-        // now run through looking for diffs > requested
-        int counter=0;
-        for (int i=0; i<(peaks.count()-1); i++) {
-
-            int ascent = 0; // ascent found in meters
-            if ((ascent=peaks[i+1].y() - peaks[i].y()) >= altSpinBox->value()) {
-
-                // found one so increment from zero
-                counter++;
-
-                // we have a winner...
-                struct AddedInterval add;
-                add.start = ride->dataPoints()[peaks[i].x()]->secs;
-                add.stop = ride->dataPoints()[peaks[i+1].x()]->secs;
-                add.name = QString("Climb #%1 (%2m)").arg(counter)
-                                                        .arg(ascent);
-                results << add;
-
-            }
-        }
-    }
+    if (methodClimb->isChecked()) findClimbs(ride, altSpinBox->value(), results);
 
     // FIND W' BAL DROPS
-    if (methodWPrime->isChecked()) {
-        WPrime wp;
-        wp.setRide((RideFile*)ride);
-
-        foreach(struct Match match, wp.matches) {
-            if (match.cost > minWPrime) {
-                struct AddedInterval add;
-                add.start = match.start;
-                add.stop = match.stop;
-
-                int lenSecs = match.stop-match.start+1;
-                QString duration;
-
-                // format the duration nicely!
-                if (lenSecs < 120) duration = QString("%1s").arg(lenSecs);
-                else {
-                    int mins = lenSecs / 60;
-                    int secs = lenSecs - (mins * 60);
-                    if (secs) {
-
-                        QChar zero = QLatin1Char ( '0' );
-                        duration = QString("%1:%2").arg(mins,2,10,zero)
-                                                   .arg(secs,2,10,zero);
-                    } else duration = QString("%1min").arg(mins);
-            
-                }
-                add.name = QString("Match %1 (%2kJ)").arg(duration)
-                                                        .arg(match.cost/1000.00, 0, 'f', 1);
-                results << add;
-            }
-        }
-    }
+    if (methodWPrime->isChecked()) findWPrimeDrops(ride, minWPrime, results);
 
     // clear the table
     clearResultsTable(resultsTable);
@@ -719,19 +626,142 @@ AddIntervalDialog::findFirsts(bool typeTime, const RideFile *ride, double window
 }
 
 void
-AddIntervalDialog::findPeakPowerStandard(const RideFile *ride, QList<AddedInterval> &results)
+AddIntervalDialog::findPeakPowerStandard(const RideFile *ride, QList<AddedInterval> &results, const RideItem *item)
+{
+    static const struct { int secs; const char *name; } peaks[] = {
+        { 5, "Peak 5s" }, { 10, "Peak 10s" }, { 20, "Peak 20s" }, { 30, "Peak 30s" },
+        { 60, "Peak 1min" }, { 120, "Peak 2min" }, { 300, "Peak 5min" }, { 600, "Peak 10min" },
+        { 1200, "Peak 20min" }, { 1800, "Peak 30min" }, { 3600, "Peak 60min" }, { 0, NULL }
+    };
+
+    // the ride's .cpx knows where the bests are, unless it has been
+    // edited, any it can't answer are found in a single pass
+    QVector<AddedInterval> found;
+    QVector<double> missing;
+    for (int i=0; peaks[i].secs; i++) {
+        double start, avg;
+        if (RideFileCache::bestEffort(item, peaks[i].secs, start, avg)) {
+            found << AddedInterval(start, start + peaks[i].secs - ride->recIntSecs(), avg); // stop as per findBests()
+        } else {
+            found << AddedInterval();
+            missing << peaks[i].secs;
+        }
+    }
+    QVector<QList<BestEfforts::Effort> > efforts = BestEfforts::find(ride, missing, 1);
+
+    for (int i=0, m=0; peaks[i].secs; i++) {
+        AddedInterval add = found[i];
+        if (add.avg == 0) {
+            const QList<BestEfforts::Effort> &best = efforts[m++];
+            if (best.isEmpty()) continue;
+            add = AddedInterval(best.first().start, ride->dataPoints()[best.first().last]->secs, best.first().avg);
+        }
+        add.name = QString("%1 (%2w)").arg(peaks[i].name).arg(round(add.avg));
+        results << add;
+    }
+}
+
+void
+AddIntervalDialog::findClimbs(const RideFile *ride, double minAscent, QList<AddedInterval> &results)
+{
+    // we need altitude and more than 3 data points
+    if (ride->areDataPresent()->alt == false || ride->dataPoints().count() < 3) return;
+
+    double hysteresis = SettingsSnapshot::current().elevationHysteresis;
+
+    // first apply hysteresis
+    QVector<QPoint> points; 
+
+    int index=0;
+    int runningAlt = ride->dataPoints().first()->alt;
+
+    foreach(RideFilePoint *p, ride->dataPoints()) {
+
+        // up
+        if (p->alt > (runningAlt + hysteresis)) {
+            runningAlt = p->alt;
+            points << QPoint(index, runningAlt);
+        }
+
+        // down
+        if (p->alt < (runningAlt - hysteresis)) {
+            runningAlt = p->alt;
+            points << QPoint(index, runningAlt);
+        }
+        index++;
+    }
+
+    // now find peaks and troughs in the point data
+    // there will only be ups and downs, no flats
+    QVector<QPoint> peaks;
+    for(int i=1; i<(points.count()-1); i++) {
+
+        // peak
+        if (points[i].y() > points[i-1].y() &&
+            points[i].y() > points[i+1].y()) peaks << points[i];
+
+        // trough
+        if (points[i].y() < points[i-1].y() &&
+            points[i].y() < points[i+1].y()) peaks << points[i];
+    }
+
+    // now run through looking for diffs > requested
+    int counter=0;
+    for (int i=0; i<(peaks.count()-1); i++) {
+
+        int ascent = 0; // ascent found in meters
+        if ((ascent=peaks[i+1].y() - peaks[i].y()) >= minAscent) {
+
+            // found one so increment from zero
+            counter++;
+
+            // we have a winner...
+            struct AddedInterval add;
+            add.start = ride->dataPoints()[peaks[i].x()]->secs;
+            add.stop = ride->dataPoints()[peaks[i+1].x()]->secs;
+            add.avg = ascent;
+            add.name = QString("Climb #%1 (%2m)").arg(counter)
+                                                    .arg(ascent);
+            results << add;
+
+        }
+    }
+}
+
+void
+AddIntervalDialog::findWPrimeDrops(const RideFile *ride, double minJoules, QList<AddedInterval> &results)
 {
-    findBests(true, ride, 5, 1, results, "Peak 5s");
-    findBests(true, ride, 10, 1, results, "Peak 10s");
-    findBests(true, ride, 20, 1, results, "Peak 20s");
-    findBests(true, ride, 30, 1, results, "Peak 30s");
-    findBests(true, ride, 60, 1, results, "Peak 1min");
-    findBests(true, ride, 120, 1, results, "Peak 2min");
-    findBests(true, ride, 300, 1, results, "Peak 5min");
-    findBests(true, ride, 600, 1, results, "Peak 10min");
-    findBests(true, ride, 1200, 1, results, "Peak 20min");
-    findBests(true, ride, 1800, 1, results, "Peak 30min");
-    findBests(true, ride, 3600, 1, results, "Peak 60min");
+    WPrime wp;
+    wp.setRide((RideFile*)ride);
+
+    foreach(struct Match match, wp.matches) {
+        if (match.cost > minJoules) {
+            struct AddedInterval add;
+            add.start = match.start;
+            add.stop = match.stop;
+            add.avg = match.cost;
+
+            int lenSecs = match.stop-match.start+1;
+            QString duration;
+
+            // format the duration nicely!
+            if (lenSecs < 120) duration = QString("%1s").arg(lenSecs);
+            else {
+                int mins = lenSecs / 60;
+                int secs = lenSecs - (mins * 60);
+                if (secs) {
+
+                    QChar zero = QLatin1Char ( '0' );
+                    duration = QString("%1:%2").arg(mins,2,10,zero)
+                                               .arg(secs,2,10,zero);
+                } else duration = QString("%1min").arg(mins);
+        
+            }
+            add.name = QString("Match %1 (%2kJ)").arg(duration)
+                                                    .arg(match.cost/1000.00, 0, 'f', 1);
+            results << add;
+        }
+    }
 }
 
 void
@@ -749,8 +779,15 @@ AddIntervalDialog::findBests(bool typeTime, const RideFile *ride, double windowS
     if (typeTime && windowSize > ride->dataPoints().last()->secs + secsDelta) return;
     else if (windowSize > ride->dataPoints().last()->km*1000) return;
 
-    // We're looking for intervals with durations in [windowSizeSecs, windowSizeSecs + secsDelta).
-    foreach (const RideFilePoint *point, ride->dataPoints()) {
+    // by time the top efforts are found directly, they don't overlap
+    // so the selection below just names them
+    if (typeTime) {
+        foreach (const BestEfforts::Effort &effort, BestEfforts::find(ride, windowSize, maxIntervals))
+            bests.append(AddedInterval(effort.start, ride->dataPoints()[effort.last]->secs, effort.avg));
+    }
+
+    // We're looking for intervals with distances of at least windowSize
+    if (!typeTime) foreach (const RideFilePoint *point, ride->dataPoints()) {
         // Discard points until interval duration is < windowSizeSecs + secsDelta.
         while ((typeTime && !window.empty() && intervalDuration(window.first(), point, ride) >= windowSize + secsDelta) ||
                (!typeTime && window.length()>1 && intervalDistance(window.at(1), point, ride) >= windowSize)) {
@@ -24,6 +24,7 @@
 
 class Context;
 class RideFile;
+class RideItem;
 
 class AddIntervalDialog : public QDialog
 {
@@ -43,7 +44,9 @@ class AddIntervalDialog : public QDialog
 
         AddIntervalDialog(Context *context);
 
-        static void findPeakPowerStandard(const RideFile *ride, QList<AddedInterval> &results);
+        // item, if given, lets the bests come from its .cpx
+        static void findPeakPowerStandard(const RideFile *ride, QList<AddedInterval> &results,
+                                          const RideItem *item = NULL);
 
         static void findBests(bool typeTime, const RideFile *ride, double windowSizeSecs,
                               int maxIntervals, QList<AddedInterval> &results, QString name);
@@ -51,6 +54,10 @@ class AddIntervalDialog : public QDialog
         static void findFirsts(bool typeTime, const RideFile *ride, double windowSizeSecs,
                                int maxIntervals, QList<AddedInterval> &results);
 
+        // avg is the ascent in metres and the W' cost in joules
+        static void findClimbs(const RideFile *ride, double minAscent, QList<AddedInterval> &results);
+        static void findWPrimeDrops(const RideFile *ride, double minJoules, QList<AddedInterval> &results);
+
     private slots:
         void createClicked();
         void addClicked(); // add to inverval selections
@@ -17,6 +17,7 @@
  */
 
 #include "RideMetric.h"
+#include "RideStatistics.h"
 #include <QApplication>
 
 // This metric computes aerobic decoupling percentage as described
@@ -59,29 +60,12 @@ class AerobicDecoupling : public RideMetric {
                  const HrZones *, int,
                  const QHash<QString,RideMetric*> &,
                  const Context *) {
-        double firstHalfPower = 0.0, secondHalfPower = 0.0;
-        double firstHalfHR = 0.0, secondHalfHR = 0.0;
-        int halfway = ride->dataPoints().size() / 2;
-        int count = 0;
-        int firstHalfCount = 0;
-        int secondHalfCount = 0;
+        const RideStatistics::Sums &sums = statistics(ride).sums();
+        double firstHalfPower = sums.firstHalfWatts, secondHalfPower = sums.secondHalfWatts;
+        double firstHalfHR = sums.firstHalfHr, secondHalfHR = sums.secondHalfHr;
+        double firstHalfCount = sums.firstHalfCount;
+        double secondHalfCount = sums.secondHalfCount;
         percent = 0;
-        foreach(const RideFilePoint *point, ride->dataPoints()) {
-            if (count++ < halfway) {
-                if (point->hr > 0) {
-                    firstHalfPower += point->watts;
-                    firstHalfHR += point->hr;
-                    ++firstHalfCount;
-                }
-            }
-            else {
-                if (point->hr > 0) {
-                    secondHalfPower += point->watts;
-                    secondHalfHR += point->hr;
-                    ++secondHalfCount;
-                }
-            }
-        }
         if ((firstHalfPower > 0) && (secondHalfPower > 0)) {
             firstHalfPower /= firstHalfCount;
             secondHalfPower /= secondHalfCount;
@@ -235,6 +235,7 @@ Aerolab::Aerolab(
   context(context),
   parent(parent),
   rideItem(NULL),
+  preparedRide(NULL), preparedPoints(0),
   smooth(1), bydist(true), autoEoffset(true) {
 
   crr       = 0.005;
@@ -306,18 +307,10 @@ Aerolab::configChanged()
 void
 Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
 
-  // HARD-CODED DATA: p1->kph
-  double vfactor = 3.600;
-  double m       =  totalMass;
-  double small_number = 0.00001;
-
   rideItem = _rideItem;
   RideFile *ride = rideItem->ride();
 
   veArray.clear();
-  altArray.clear();
-  distanceArray.clear();
-  timeArray.clear();
 
   if( ride ) {
 
@@ -329,7 +322,6 @@ Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
       // If watts are present, then we can fill the veArray data:
       const RideFileDataPresent *dataPresent = ride->areDataPresent();
       int npoints = ride->dataPoints().size();
-      double dt = ride->recIntSecs();
       veArray.resize(dataPresent->watts ? npoints : 0);
       altArray.resize(dataPresent->alt || constantAlt ? npoints : 0);
       timeArray.resize(dataPresent->watts ? npoints : 0);
@@ -355,69 +347,21 @@ Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
         altCurve->setVisible(dataPresent->alt || constantAlt );
       }
 
-      // Fill the virtual elevation profile with data from the ride data:
-      double t = 0.0;
-      double vlast = 0.0;
-      double e     = 0.0;
-      arrayLength = 0;
-      foreach(const RideFilePoint *p1, ride->dataPoints()) {
-      if ( arrayLength == 0 )
-        e = eoffset;
-
-      timeArray[arrayLength]  = p1->secs / 60.0;
-      if ( have_recorded_alt_curve ) {
-          if ( constantAlt && arrayLength > 0) {
-              altArray[arrayLength] = altArray[arrayLength-1];
-          }
-          else  {
-              if ( constantAlt && !dataPresent->alt)
-                  altArray[arrayLength] = 0;
-              else
-                altArray[arrayLength] = (context->athlete->useMetricUnits
-                   ? p1->alt
-                   : p1->alt * FEET_PER_METER);
-          }
-      }
+      // the per sample terms only depend on the ride, so when it's the same
+      // ride a parameter change just combines them again
+      if (new_zoom || preparedRide != ride || preparedConstantAlt != constantAlt ||
+          preparedMetricUnits != context->athlete->useMetricUnits || preparedPoints != npoints) {
 
-      // Unpack:
-      double power = max(0, p1->watts);
-      double v     = p1->kph/vfactor;
-      double headwind = v;
-      if( dataPresent->headwind ) {
-        headwind   = p1->headwind/vfactor;
+          prepareTerms(ride, have_recorded_alt_curve);
+          preparedRide = ride;
+          preparedConstantAlt = constantAlt;
+          preparedMetricUnits = context->athlete->useMetricUnits;
+          preparedPoints = npoints;
       }
-      double f     = 0.0;
-      double a     = 0.0;
-
-      // Use km data insteed of formula for file with a stop (gap).
-      //d += v * dt;
-      //distanceArray[arrayLength] = d/1000;
-
-      distanceArray[arrayLength] = p1->km;
-
-
-
-      if( v > small_number ) {
-        f  = power/v;
-        a  = ( v*v - vlast*vlast ) / ( 2.0 * dt * v );
-      } else {
-        a = ( v - vlast ) / dt;
-      }
-
-      f *= eta; // adjust for drivetrain efficiency if using a crank-based meter
-      double s   = slope( f, a, m, crr, cda, rho, headwind );
-      double de  = s * v * dt;
-
-      e += de;
-      t += dt;
-      veArray[arrayLength] = e;
-
-      vlast = v;
-
-      ++arrayLength;
-    }
-
+      computeVE();
   } else {
+      altArray.clear();
+      preparedRide = NULL;
       veCurve->setVisible(false);
       altCurve->setVisible(false);
   }
@@ -425,6 +369,8 @@ Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
     adjustEoffset();
   } else {
     //setTitle("no data");
+    altArray.clear();
+    preparedRide = NULL;
 
   }
 }
@@ -625,6 +571,112 @@ Aerolab::setByDistance(int value) {
 }
 
 
+//
+// The virtual elevation is eoffset plus the running sum of slope * v * dt
+// and the slope is linear in each term of the power equation:
+//
+//     s = eta * f/(m*g) - crr - cda * rho * headwind^2 / (2*m*g) - a/g
+//
+// So we keep the running sums of f*v*dt, v*dt, headwind^2*v*dt and
+// a*v*dt for each sample and any set of parameters is then just a
+// weighted sum of the four of them -- no need to go back to the ride.
+//
+void
+Aerolab::prepareTerms(RideFile *ride, bool have_recorded_alt_curve)
+{
+  // HARD-CODED DATA: p1->kph
+  double vfactor = 3.600;
+  double small_number = 0.00001;
+
+  const RideFileDataPresent *dataPresent = ride->areDataPresent();
+  int npoints = ride->dataPoints().size();
+  double dt = ride->recIntSecs();
+
+  timeArray.resize(npoints);
+  distanceArray.resize(npoints);
+  powerTerm.resize(npoints);
+  distanceTerm.resize(npoints);
+  windTerm.resize(npoints);
+  accelTerm.resize(npoints);
+
+  double vlast = 0.0;
+  double fsum = 0.0, dsum = 0.0, wsum = 0.0, asum = 0.0;
+  arrayLength = 0;
+  foreach(const RideFilePoint *p1, ride->dataPoints()) {
+
+      timeArray[arrayLength]  = p1->secs / 60.0;
+      if ( have_recorded_alt_curve ) {
+          if ( constantAlt && arrayLength > 0) {
+              altArray[arrayLength] = altArray[arrayLength-1];
+          }
+          else  {
+              if ( constantAlt && !dataPresent->alt)
+                  altArray[arrayLength] = 0;
+              else
+                altArray[arrayLength] = (context->athlete->useMetricUnits
+                   ? p1->alt
+                   : p1->alt * FEET_PER_METER);
+          }
+      }
+
+      // Unpack:
+      double power = max(0, p1->watts);
+      double v     = p1->kph/vfactor;
+      double headwind = v;
+      if( dataPresent->headwind ) {
+        headwind   = p1->headwind/vfactor;
+      }
+      double f     = 0.0;
+      double a     = 0.0;
+
+      // Use km data insteed of formula for file with a stop (gap).
+      distanceArray[arrayLength] = p1->km;
+
+      if( v > small_number ) {
+        f  = power/v;
+        a  = ( v*v - vlast*vlast ) / ( 2.0 * dt * v );
+      } else {
+        a = ( v - vlast ) / dt;
+      }
+
+      double d = v * dt;
+      fsum += f * d;
+      dsum += d;
+      wsum += headwind * headwind * d;
+      asum += a * d;
+
+      powerTerm[arrayLength] = fsum;
+      distanceTerm[arrayLength] = dsum;
+      windTerm[arrayLength] = wsum;
+      accelTerm[arrayLength] = asum;
+
+      vlast = v;
+      ++arrayLength;
+  }
+}
+
+void
+Aerolab::computeVE()
+{
+  double g = 9.80665;
+  double m = totalMass;
+
+  // weights for each of the terms, see above
+  double wf = eta / (m*g);
+  double ww = cda * rho / (2.0*m*g);
+  double wa = 1.0 / g;
+
+  const double *f = powerTerm.constData();
+  const double *d = distanceTerm.constData();
+  const double *w = windTerm.constData();
+  const double *a = accelTerm.constData();
+  double *e = veArray.data();
+
+  int n = qMin(arrayLength, veArray.size());
+  for (int i=0; i<n; i++)
+    e[i] = eoffset + wf*f[i] - crr*d[i] - ww*w[i] - wa*a[i];
+}
+
 double
 Aerolab::slope(
            double f,
@@ -652,8 +704,6 @@ Aerolab::setIntCrr(
             ) {
 
   crr = (double) value / 1000000.0;
-
-  recalc(false);
 }
 
 // At slider 1000, we want to get max CdA=1.000
@@ -663,7 +713,6 @@ Aerolab::setIntCda(
            int value
             )  {
   cda = (double) value / 10000.0;
-  recalc(false);
 }
 
 // At slider 1000, we want to get max CdA=1.000
@@ -674,7 +723,6 @@ Aerolab::setIntTotalMass(
               ) {
 
   totalMass = (double) value / 100.0;
-  recalc(false);
 }
 
 
@@ -686,7 +734,6 @@ Aerolab::setIntRho(
             ) {
 
   rho = (double) value / 10000.0;
-  recalc(false);
 }
 
 
@@ -698,7 +745,6 @@ Aerolab::setIntEta(
                      ) {
 
   eta = (double) value / 10000.0;
-  recalc(false);
 }
 
 
@@ -710,7 +756,6 @@ Aerolab::setIntEoffset(
                      ) {
 
   eoffset = (double) value / 100.0;
-  recalc(false);
 }
 
 
@@ -803,9 +848,23 @@ QString Aerolab::estimateCdACrr(RideItem *rideItem)
         if(( dataPresent->alt || constantAlt )  && dataPresent->watts) {
             double dt = ride->recIntSecs();
             int npoints = ride->dataPoints().size();
-            double X1[npoints], X2[npoints], Egain[npoints];
-            int nSeg = -1;
+            QVector<double> X1(npoints+1), X2(npoints+1), Egain(npoints+1);
+            int nSeg = 0;
+            bool open = false;
             double altInit = 0, vInit = 0;
+
+            // when intervals are selected only fit over them
+            QVector<double> starts, stops;
+            if (context->athlete->allIntervalItems() != NULL) {
+                for (int i=0; i<context->athlete->allIntervalItems()->childCount(); i++) {
+                    IntervalItem *current = dynamic_cast<IntervalItem *>(context->athlete->allIntervalItems()->child(i));
+                    if (current != NULL && current->isSelected()) {
+                        starts << current->start;
+                        stops << current->stop;
+                    }
+                }
+            }
+
             /* For each segment, defined between points with alt != 0,
              * this loop computes X1, X2 and Egain to verify:
              * Aero-Loss + RR-Loss = Egain
@@ -822,6 +881,18 @@ QString Aerolab::estimateCdACrr(RideItem *rideItem)
              *              0.5 * (vInit*vInit - v*v))
              */
             foreach(const RideFilePoint *p1, ride->dataPoints()) {
+
+                // outside the selected intervals, drop the open segment
+                if (starts.count()) {
+                    int i;
+                    for (i=0; i<starts.count(); i++)
+                        if (p1->secs+dt > starts[i] && p1->secs < stops[i]) break;
+                    if (i == starts.count()) {
+                        open = false;
+                        continue;
+                    }
+                }
+
                 // Unpack:
                 double power = max(0, p1->watts);
                 double v     = p1->kph/vfactor;
@@ -832,14 +903,14 @@ QString Aerolab::estimateCdACrr(RideItem *rideItem)
                 }
                 double alt = p1->alt;
                 // start initial segment
-                if (nSeg < 0 && alt != 0) {
-                    nSeg = 0;
+                if (!open && alt != 0) {
+                    open = true;
                     X1[nSeg] = X2[nSeg] = Egain[nSeg] = 0.0;
                     altInit = alt;
                     vInit = v;
                 }
                 // accumulate segment data
-                if (nSeg >= 0) {
+                if (open) {
                     // X1[nSgeg] * CdA == Aero-Loss
                     X1[nSeg] += 0.5 * rho * headwind*headwind * distance;
                     // X2[nSgeg] * Crr == RR-Loss
@@ -848,7 +919,7 @@ QString Aerolab::estimateCdACrr(RideItem *rideItem)
                     Egain[nSeg] += eta * power * dt;
                 }
                 // close current segment and start a new one
-                if (nSeg >= 0 && alt != 0) {
+                if (open && alt != 0) {
                     // Add change in potential and kinetic energy
                     Egain[nSeg] += totalMass * (g * (altInit - alt) + 0.5 * (vInit*vInit - v*v));
                     // Start a new segment
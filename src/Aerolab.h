@@ -89,6 +89,13 @@ class Aerolab : public QwtPlot {
 
   RideItem *rideItem;
 
+  // running sums of each term of the virtual elevation for the ride
+  // last prepared, see prepareTerms()
+  RideFile *preparedRide;
+  int preparedPoints;
+  bool preparedConstantAlt, preparedMetricUnits;
+  QVector<double> powerTerm, distanceTerm, windTerm, accelTerm;
+
   QVector<double> hrArray;
   QVector<double> wattsArray;
   QVector<double> speedArray;
@@ -117,6 +124,8 @@ class Aerolab : public QwtPlot {
 
   double   slope(double, double, double, double, double, double, double);
   void     recalc(bool);
+  void     prepareTerms(RideFile *, bool);
+  void     computeVE();
   void     setYMax(bool);
   void     setXTitle();
   void     setIntCrr(int);
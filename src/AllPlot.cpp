@@ -19,17 +19,21 @@
 #include "AllPlot.h"
 #include "Context.h"
 #include "Athlete.h"
+#include "Trace.h"
 #include "AllPlotWindow.h"
 #include "ReferenceLineDialog.h"
 #include "RideFile.h"
 #include "RideItem.h"
 #include "IntervalItem.h"
+#include "IntervalOverlay.h"
 #include "Settings.h"
 #include "Units.h"
 #include "Zones.h"
 #include "Colors.h"
 #include "WPrime.h"
+#include "RollingAverage.h"
 
+#include <qwt_plot_canvas.h>
 #include <qwt_plot_curve.h>
 #include <qwt_plot_intervalcurve.h>
 #include <qwt_plot_grid.h>
@@ -53,8 +57,6 @@ class IntervalPlotData : public QwtSeriesData<QPointF>
     size_t size() const ;
     //virtual QwtData *copy() const ;
     void init() ;
-    IntervalItem *intervalNum(int n) const;
-    int intervalCount() const;
     AllPlot *allPlot;
     Context *context;
 
@@ -62,6 +64,29 @@ class IntervalPlotData : public QwtSeriesData<QPointF>
     virtual QRectF boundingRect() const;
 };
 
+// A curve's samples at several levels of detail. Each level keeps the
+// min and the max from blocks of 2^level samples, so spikes survive the
+// decimation. Qwt tells us the visible range before each replot and we
+// pick the level that gives about as many points as the canvas is wide,
+// so a long ride doesn't push every sample through the curve on redraw.
+class AllPlotLODData : public QwtSeriesData<QPointF>
+{
+    public:
+    AllPlotLODData(QwtPlot *plot, const double *xdata, const double *ydata, int count);
+
+    virtual size_t size() const;
+    virtual QPointF sample(size_t i) const;
+    virtual QRectF boundingRect() const;
+    virtual void setRectOfInterest(const QRectF &rect);
+
+    private:
+    QwtPlot *plot;
+    QVector<double> xdata, ydata;
+    QVector<QVector<int> > levels; // index pairs into xdata/ydata for level 1...
+    int level;                     // level in use, 0 is all the samples
+    QRectF bounds;
+};
+
 // define a background class to handle shading of power zones
 // draws power zone bands IF zones are defined and the option
 // to draw bonds has been selected
@@ -243,13 +268,14 @@ AllPlot::AllPlot(AllPlotWindow *parent, Context *context):
     showBalance(true),
     bydist(false),
     context(context),
-    parent(parent)
+    parent(parent),
+    smoother(NULL)
 {
     setInstanceName("AllPlot");
 
     referencePlot = NULL;
 
-    if (appsettings->value(this, GC_SHADEZONES, true).toBool()==false)
+    if (SettingsSnapshot::current().shadeZones == false)
         shade_zones = false;
 
     smooth = 1;
@@ -345,9 +371,10 @@ AllPlot::AllPlot(AllPlotWindow *parent, Context *context):
 void
 AllPlot::configChanged()
 {
-    double width = appsettings->value(this, GC_LINEWIDTH, 2.0).toDouble();
+    SettingsSnapshot snapshot = SettingsSnapshot::current();
+    double width = snapshot.lineWidth;
 
-    if (appsettings->value(this, GC_ANTIALIAS, false).toBool() == true) {
+    if (snapshot.antiAlias == true) {
         wattsCurve->setRenderHint(QwtPlotItem::RenderAntialiased);
         npCurve->setRenderHint(QwtPlotItem::RenderAntialiased);
         xpCurve->setRenderHint(QwtPlotItem::RenderAntialiased);
@@ -558,11 +585,37 @@ AllPlot::configChanged()
     axisWidget(QwtPlot::yRight3)->setPalette(pal);
 }
 
-struct DataPoint {
-    double time, hr, watts, np, ap, xp, speed, cad, alt, temp, wind, torque, lrbalance;
-    DataPoint(double t, double h, double w, double n, double l, double x, double s, double c, double a, double te, double wi, double tq, double lrb) :
-        time(t), hr(h), watts(w), np(n), ap(l), xp(x), speed(s), cad(c), alt(a), temp(te), wind(wi), torque(tq), lrbalance(lrb) {}
-};
+AllPlot::~AllPlot()
+{
+    delete smoother;
+}
+
+void
+AllPlot::setOverlays(const QList<AllPlotOverlay> &overlays)
+{
+    foreach(QwtPlotCurve *curve, overlayCurves) {
+        curve->detach();
+        delete curve;
+    }
+    overlayCurves.clear();
+
+    foreach(const AllPlotOverlay &overlay, overlays) {
+        if (overlay.x.count() < 2) continue;
+
+        // thin and a little transparent, so the ride itself stays on top
+        QColor color = overlay.color;
+        color.setAlpha(180);
+
+        QwtPlotCurve *curve = new QwtPlotCurve(overlay.name);
+        curve->setYAxis(overlay.hr ? yLeft2 : yLeft);
+        curve->setPen(QPen(color, 1));
+        curve->setZ(wattsCurve->z() - 1);
+        curve->setRenderHint(QwtPlotItem::RenderAntialiased, wattsCurve->testRenderHint(QwtPlotItem::RenderAntialiased));
+        curve->setData(new AllPlotLODData(this, overlay.x.constData(), overlay.y.constData(), overlay.x.count()));
+        curve->attach(this);
+        overlayCurves << curve;
+    }
+}
 
 bool AllPlot::shadeZones() const
 {
@@ -574,8 +627,9 @@ AllPlot::setAxisTitle(int axis, QString label)
 {
     // setup the default fonts
     QFont stGiles; // hoho - Chart Font St. Giles ... ok you have to be British to get this joke
-    stGiles.fromString(appsettings->value(this, GC_FONT_CHARTLABELS, QFont().toString()).toString());
-    stGiles.setPointSize(appsettings->value(NULL, GC_FONT_CHARTLABELS_SIZE, 8).toInt());
+    SettingsSnapshot snapshot = SettingsSnapshot::current();
+    stGiles.fromString(snapshot.chartLabelsFont);
+    stGiles.setPointSize(snapshot.chartLabelsSize);
 
     QwtText title(label);
     title.setFont(stGiles);
@@ -657,22 +711,6 @@ AllPlot::recalc()
     // we should only smooth the curves if smoothed rate is greater than sample rate
     if (smooth > rideItem->ride()->recIntSecs()) {
 
-        double totalWatts = 0.0;
-        double totalNP = 0.0;
-        double totalXP = 0.0;
-        double totalAP = 0.0;
-        double totalHr = 0.0;
-        double totalSpeed = 0.0;
-        double totalCad = 0.0;
-        double totalDist = 0.0;
-        double totalAlt = 0.0;
-        double totalTemp = 0.0;
-        double totalWind = 0.0;
-        double totalTorque = 0.0;
-        double totalBalance = 0.0;
-
-        QList<DataPoint> list;
-
         smoothWatts.resize(rideTimeSecs + 1); //(rideTimeSecs + 1);
         smoothNP.resize(rideTimeSecs + 1); //(rideTimeSecs + 1);
         smoothXP.resize(rideTimeSecs + 1); //(rideTimeSecs + 1);
@@ -710,77 +748,47 @@ AllPlot::recalc()
             smoothBalanceR[secs]  = 50;
         }
 
-        int i = 0;
-        for (int secs = smooth; secs <= rideTimeSecs; ++secs) {
-            while ((i < arrayLength) && (timeArray[i] <= secs)) {
-                DataPoint dp(timeArray[i],
-                             (!hrArray.empty() ? hrArray[i] : 0),
-                             (!wattsArray.empty() ? wattsArray[i] : 0),
-                             (!npArray.empty() ? npArray[i] : 0),
-                             (!apArray.empty() ? apArray[i] : 0),
-                             (!xpArray.empty() ? xpArray[i] : 0),
-                             (!speedArray.empty() ? speedArray[i] : 0),
-                             (!cadArray.empty() ? cadArray[i] : 0),
-                             (!altArray.empty() ? altArray[i] : 0),
-                             (!tempArray.empty() ? tempArray[i] : 0),
-                             (!windArray.empty() ? windArray[i] : 0),
-                             (!torqueArray.empty() ? torqueArray[i] : 0),
-                             (!balanceArray.empty() ? balanceArray[i] : 0));
-                if (!wattsArray.empty())
-                    totalWatts += wattsArray[i];
-                if (!npArray.empty())
-                    totalNP += npArray[i];
-                if (!xpArray.empty())
-                    totalXP += xpArray[i];
-                if (!apArray.empty())
-                    totalAP += apArray[i];
-                if (!hrArray.empty())
-                    totalHr    += hrArray[i];
-                if (!speedArray.empty())
-                    totalSpeed += speedArray[i];
-                if (!cadArray.empty())
-                    totalCad   += cadArray[i];
-                if (!altArray.empty())
-                    totalAlt   += altArray[i];
-                if (!tempArray.empty() ) {
-                    if (tempArray[i] == RideFile::noTemp) {
-                        dp.temp = (i>0 && !list.empty()?list.back().temp:0.0);
-                        totalTemp   += dp.temp;
-                    }
-                    else {
-                        totalTemp   += tempArray[i];
-                    }
-                }
-                if (!windArray.empty())
-                    totalWind   += windArray[i];
-                if (!torqueArray.empty())
-                    totalTorque   += torqueArray[i];
-                if (!balanceArray.empty())
-                    totalBalance   += (balanceArray[i]>0?balanceArray[i]:50);
-
-                totalDist   = distanceArray[i];
-                list.append(dp);
-                ++i;
-            }
-            while (!list.empty() && (list.front().time < secs - smooth)) {
-                DataPoint &dp = list.front();
-                totalWatts -= dp.watts;
-                totalNP -= dp.np;
-                totalAP -= dp.ap;
-                totalXP -= dp.xp;
-                totalHr    -= dp.hr;
-                totalSpeed -= dp.speed;
-                totalCad   -= dp.cad;
-                totalAlt   -= dp.alt;
-                totalTemp   -= dp.temp;
-                totalWind   -= dp.wind;
-                totalTorque   -= dp.torque;
-                totalBalance   -= (dp.lrbalance>0?dp.lrbalance:50);
-                list.removeFirst();
+        // all the series are smoothed in one pass, and the smoother keeps
+        // the results for the recent smoothing values we've been asked for
+        if (smoother == NULL) {
+
+            smoother = new RollingAverage(timeArray, arrayLength);
+            for (int s=0; s<SmoothSeries; s++) smoothIndex[s] = -1;
+
+            if (!wattsArray.empty()) smoothIndex[SmoothWatts] = smoother->addSeries(wattsArray);
+            if (!npArray.empty()) smoothIndex[SmoothNP] = smoother->addSeries(npArray);
+            if (!xpArray.empty()) smoothIndex[SmoothXP] = smoother->addSeries(xpArray);
+            if (!apArray.empty()) smoothIndex[SmoothAP] = smoother->addSeries(apArray);
+            if (!hrArray.empty()) smoothIndex[SmoothHr] = smoother->addSeries(hrArray);
+            if (!speedArray.empty()) smoothIndex[SmoothSpeed] = smoother->addSeries(speedArray);
+            if (!cadArray.empty()) smoothIndex[SmoothCad] = smoother->addSeries(cadArray);
+            if (!altArray.empty()) smoothIndex[SmoothAlt] = smoother->addSeries(altArray);
+            if (!tempArray.empty()) smoothIndex[SmoothTemp] = smoother->addSeries(tempArray, RideFile::noTemp);
+            if (!windArray.empty()) smoothIndex[SmoothWind] = smoother->addSeries(windArray);
+            if (!torqueArray.empty()) smoothIndex[SmoothTorque] = smoother->addSeries(torqueArray);
+            if (!balanceArray.empty()) {
+                // no balance counts as 50/50
+                QVector<double> balance(balanceArray);
+                for (int i=0; i<balance.count(); i++) if (!(balance[i] > 0)) balance[i] = 50;
+                smoothIndex[SmoothBalance] = smoother->addSeries(balance);
             }
+            smoothIndex[SmoothDistance] = smoother->addSeries(distanceArray);
+        }
+        smoother->compute(smooth, rideTimeSecs);
+
+        // absent series are all zero
+        QVector<double> zero(rideTimeSecs + 1, 0.0);
+        const QVector<double> *means[SmoothSeries];
+        for (int s=0; s<SmoothSeries; s++)
+            means[s] = smoothIndex[s] >= 0 ? &smoother->mean(smoothIndex[s]) : &zero;
+        const QVector<int> &count = smoother->count();
+        const QVector<double> &distance = smoother->last(smoothIndex[SmoothDistance]);
+
+        for (int secs = smooth; secs <= rideTimeSecs; ++secs) {
+
             // TODO: this is wrong.  We should do a weighted average over the
             // seconds represented by each point...
-            if (list.empty()) {
+            if (count[secs] == 0) {
                 smoothWatts[secs] = 0.0;
                 smoothNP[secs] = 0.0;
                 smoothXP[secs] = 0.0;
@@ -797,20 +805,23 @@ AllPlot::recalc()
                 smoothBalanceR[secs] = 50;
             }
             else {
-                smoothWatts[secs]    = totalWatts / list.size();
-                smoothNP[secs]    = totalNP / list.size();
-                smoothXP[secs]    = totalXP / list.size();
-                smoothAP[secs]    = totalAP / list.size();
-                smoothHr[secs]       = totalHr / list.size();
-                smoothSpeed[secs]    = totalSpeed / list.size();
-                smoothCad[secs]      = totalCad / list.size();
-                smoothAltitude[secs]      = totalAlt / list.size();
-                smoothTemp[secs]      = totalTemp / list.size();
-                smoothWind[secs]    = totalWind / list.size();
-                smoothRelSpeed[secs] =  QwtIntervalSample( bydist ? totalDist : secs / 60.0, QwtInterval(qMin(totalWind / list.size(), totalSpeed / list.size()), qMax(totalWind / list.size(), totalSpeed / list.size()) ) );
-                smoothTorque[secs]    = totalTorque / list.size();
-
-                double balance = totalBalance / list.size();
+                smoothWatts[secs]    = (*means[SmoothWatts])[secs];
+                smoothNP[secs]    = (*means[SmoothNP])[secs];
+                smoothXP[secs]    = (*means[SmoothXP])[secs];
+                smoothAP[secs]    = (*means[SmoothAP])[secs];
+                smoothHr[secs]       = (*means[SmoothHr])[secs];
+                smoothSpeed[secs]    = (*means[SmoothSpeed])[secs];
+                smoothCad[secs]      = (*means[SmoothCad])[secs];
+                smoothAltitude[secs]      = (*means[SmoothAlt])[secs];
+                smoothTemp[secs]      = (*means[SmoothTemp])[secs];
+                smoothWind[secs]    = (*means[SmoothWind])[secs];
+                double wind = (*means[SmoothWind])[secs];
+                double speed = (*means[SmoothSpeed])[secs];
+                smoothRelSpeed[secs] =  QwtIntervalSample( bydist ? distance[secs] : secs / 60.0, QwtInterval(qMin(wind, speed), qMax(wind, speed) ) );
+                smoothTorque[secs]    = (*means[SmoothTorque])[secs];
+
+                // no balance data is the same as 50/50
+                double balance = smoothIndex[SmoothBalance] >= 0 ? (*means[SmoothBalance])[secs] : 50;
                 if (balance == 0) {
                     smoothBalanceL[secs]    = 50;
                     smoothBalanceR[secs]    = 50;
@@ -823,7 +834,7 @@ AllPlot::recalc()
                     smoothBalanceR[secs]    = balance;
                 }
             }
-            smoothDistance[secs] = totalDist;
+            smoothDistance[secs] = distance[secs];
             smoothTime[secs]  = secs / 60.0;
         }
 
@@ -893,47 +904,47 @@ AllPlot::recalc()
     mCurve->setData(parent->wpData->mxdata().data(), parent->wpData->mydata().data(), parent->wpData->mxdata().count());
 
     if (!wattsArray.empty()) {
-        wattsCurve->setData(xaxis.data() + startingIndex, smoothWatts.data() + startingIndex, totalPoints);
+        wattsCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothWatts.data() + startingIndex, totalPoints));
         intervalHighlighterCurve->setYAxis(yLeft);
     }
 
     if (!npArray.empty()) {
-        npCurve->setData(xaxis.data() + startingIndex, smoothNP.data() + startingIndex, totalPoints);
+        npCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothNP.data() + startingIndex, totalPoints));
         intervalHighlighterCurve->setYAxis(yLeft);
     }
 
     if (!xpArray.empty()) {
-        xpCurve->setData(xaxis.data() + startingIndex, smoothXP.data() + startingIndex, totalPoints);
+        xpCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothXP.data() + startingIndex, totalPoints));
         intervalHighlighterCurve->setYAxis(yLeft);
     }
 
     if (!apArray.empty()) {
-        apCurve->setData(xaxis.data() + startingIndex, smoothAP.data() + startingIndex, totalPoints);
+        apCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothAP.data() + startingIndex, totalPoints));
         intervalHighlighterCurve->setYAxis(yLeft);
     }
 
     if (!hrArray.empty()) {
-        hrCurve->setData(xaxis.data() + startingIndex, smoothHr.data() + startingIndex, totalPoints);
+        hrCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothHr.data() + startingIndex, totalPoints));
         intervalHighlighterCurve->setYAxis(yLeft2);
     }
 
     if (!speedArray.empty()) {
-        speedCurve->setData(xaxis.data() + startingIndex, smoothSpeed.data() + startingIndex, totalPoints);
+        speedCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothSpeed.data() + startingIndex, totalPoints));
         intervalHighlighterCurve->setYAxis(yRight);
     }
 
     if (!cadArray.empty()) {
-        cadCurve->setData(xaxis.data() + startingIndex, smoothCad.data() + startingIndex, totalPoints);
+        cadCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothCad.data() + startingIndex, totalPoints));
         intervalHighlighterCurve->setYAxis(yLeft2);
     }
 
     if (!altArray.empty()) {
-        altCurve->setData(xaxis.data() + startingIndex, smoothAltitude.data() + startingIndex, totalPoints);
+        altCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothAltitude.data() + startingIndex, totalPoints));
         intervalHighlighterCurve->setYAxis(yRight2);
     }
 
     if (!tempArray.empty()) {
-        tempCurve->setData(xaxis.data() + startingIndex, smoothTemp.data() + startingIndex, totalPoints);
+        tempCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothTemp.data() + startingIndex, totalPoints));
         if (context->athlete->useMetricUnits)
             intervalHighlighterCurve->setYAxis(yRight);
         else
@@ -947,14 +958,14 @@ AllPlot::recalc()
     }
 
     if (!torqueArray.empty()) {
-        torqueCurve->setData(xaxis.data() + startingIndex, smoothTorque.data() + startingIndex, totalPoints);
+        torqueCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothTorque.data() + startingIndex, totalPoints));
         intervalHighlighterCurve->setYAxis(yRight);
     }
 
     if (!balanceArray.empty()) {
-        balanceLCurve->setData(xaxis.data() + startingIndex, smoothBalanceL.data() + startingIndex, totalPoints);
+        balanceLCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothBalanceL.data() + startingIndex, totalPoints));
         intervalHighlighterCurve->setYAxis(yLeft2);
-        balanceRCurve->setData(xaxis.data() + startingIndex, smoothBalanceR.data() + startingIndex, totalPoints);
+        balanceRCurve->setData(new AllPlotLODData(this, xaxis.data() + startingIndex, smoothBalanceR.data() + startingIndex, totalPoints));
         intervalHighlighterCurve->setYAxis(yLeft2);
     }
 
@@ -970,41 +981,62 @@ AllPlot::recalc()
 void
 AllPlot::refreshIntervalMarkers()
 {
-    foreach(QwtPlotMarker *mrk, d_mrk) {
-        mrk->detach();
-        delete mrk;
-    }
-    d_mrk.clear();
     QRegExp wkoAuto("^(Peak *[0-9]*(s|min)|Entire workout|Find #[0-9]*) *\\([^)]*\\)$");
+
+    // the markers to draw, this is called on every replot but they
+    // rarely change so only touch them when they have
+    QList<RideFileInterval> marked;
+    QString key = QString("%1 %2 %3 %4 %5").arg((quintptr)rideItem->ride()).arg(bydist)
+                  .arg(context->athlete->useMetricUnits).arg(GColor(CPLOTMARKER).name())
+                  .arg(GColor(CWBAL).name());
     if (rideItem->ride()) {
         foreach(const RideFileInterval &interval, rideItem->ride()->intervals()) {
             // skip WKO autogenerated peak intervals
             if (wkoAuto.exactMatch(interval.name))
                 continue;
-            QwtPlotMarker *mrk = new QwtPlotMarker;
-            d_mrk.append(mrk);
-            mrk->attach(this);
-            mrk->setLineStyle(QwtPlotMarker::VLine);
-            mrk->setLabelAlignment(Qt::AlignRight | Qt::AlignTop);
-            mrk->setLinePen(QPen(GColor(CPLOTMARKER), 0, Qt::DashDotLine));
+            marked << interval;
+            key += QString("\n%1 %2 %3").arg(interval.start).arg(interval.stop).arg(interval.name);
+        }
+    }
+    if (key == markerKey) return;
+    markerKey = key;
 
-            // put matches on second line down
-            QString name(interval.name);
-            if (interval.name.startsWith(tr("Match"))) name = QString("\n%1").arg(interval.name);
+    // reuse the markers we have, adding or removing the difference
+    while (d_mrk.count() > marked.count()) {
+        QwtPlotMarker *mrk = d_mrk.last();
+        d_mrk.pop_back();
+        mrk->detach();
+        delete mrk;
+    }
+    while (d_mrk.count() < marked.count()) {
+        QwtPlotMarker *mrk = new QwtPlotMarker;
+        d_mrk.append(mrk);
+        mrk->attach(this);
+    }
 
-            QwtText text(name);
-            text.setFont(QFont("Helvetica", 10, QFont::Bold));
-            if (interval.name.startsWith(tr("Match"))) 
-                text.setColor(GColor(CWBAL));
-            else
-                text.setColor(GColor(CPLOTMARKER));
-            if (!bydist)
-                mrk->setValue(interval.start / 60.0, 0.0);
-            else
-                mrk->setValue((context->athlete->useMetricUnits ? 1 : MILES_PER_KM) *
-                                rideItem->ride()->timeToDistance(interval.start), 0.0);
-            mrk->setLabel(text);
-        }
+    for (int i=0; i<marked.count(); i++) {
+        const RideFileInterval &interval = marked[i];
+        QwtPlotMarker *mrk = d_mrk[i];
+        mrk->setLineStyle(QwtPlotMarker::VLine);
+        mrk->setLabelAlignment(Qt::AlignRight | Qt::AlignTop);
+        mrk->setLinePen(QPen(GColor(CPLOTMARKER), 0, Qt::DashDotLine));
+
+        // put matches on second line down
+        QString name(interval.name);
+        if (interval.name.startsWith(tr("Match"))) name = QString("\n%1").arg(interval.name);
+
+        QwtText text(name);
+        text.setFont(QFont("Helvetica", 10, QFont::Bold));
+        if (interval.name.startsWith(tr("Match"))) 
+            text.setColor(GColor(CWBAL));
+        else
+            text.setColor(GColor(CPLOTMARKER));
+        if (!bydist)
+            mrk->setValue(interval.start / 60.0, 0.0);
+        else
+            mrk->setValue((context->athlete->useMetricUnits ? 1 : MILES_PER_KM) *
+                            rideItem->ride()->timeToDistance(interval.start), 0.0);
+        mrk->setLabel(text);
     }
 }
 
@@ -1305,6 +1337,9 @@ AllPlot::setDataFromPlot(AllPlot *plot, int startidx, int stopidx)
 
     referencePlot = plot;
 
+    delete smoother;
+    smoother = NULL;
+
     // You got to give me some data first!
     if (!plot->distanceArray.count() || !plot->timeArray.count()) return;
 
@@ -1409,22 +1444,22 @@ AllPlot::setDataFromPlot(AllPlot *plot, int startidx, int stopidx)
 
     wCurve->setData(parent->wpData->xdata().data(),parent->wpData->ydata().data(),parent->wpData->xdata().count());
     mCurve->setData(parent->wpData->mxdata().data(),parent->wpData->mydata().data(),parent->wpData->mxdata().count());
-    wattsCurve->setData(xaxis,smoothW,stopidx-startidx);
-    npCurve->setData(xaxis,smoothN,stopidx-startidx);
-    xpCurve->setData(xaxis,smoothX,stopidx-startidx);
-    apCurve->setData(xaxis,smoothL,stopidx-startidx);
-    hrCurve->setData(xaxis, smoothHR,stopidx-startidx);
-    speedCurve->setData(xaxis, smoothS, stopidx-startidx);
-    cadCurve->setData(xaxis, smoothC, stopidx-startidx);
-    altCurve->setData(xaxis, smoothA, stopidx-startidx);
-    tempCurve->setData(xaxis, smoothTE, stopidx-startidx);
+    wattsCurve->setData(new AllPlotLODData(this, xaxis, smoothW, stopidx-startidx));
+    npCurve->setData(new AllPlotLODData(this, xaxis, smoothN, stopidx-startidx));
+    xpCurve->setData(new AllPlotLODData(this, xaxis, smoothX, stopidx-startidx));
+    apCurve->setData(new AllPlotLODData(this, xaxis, smoothL, stopidx-startidx));
+    hrCurve->setData(new AllPlotLODData(this, xaxis, smoothHR, stopidx-startidx));
+    speedCurve->setData(new AllPlotLODData(this, xaxis, smoothS, stopidx-startidx));
+    cadCurve->setData(new AllPlotLODData(this, xaxis, smoothC, stopidx-startidx));
+    altCurve->setData(new AllPlotLODData(this, xaxis, smoothA, stopidx-startidx));
+    tempCurve->setData(new AllPlotLODData(this, xaxis, smoothTE, stopidx-startidx));
 
     QVector<QwtIntervalSample> tmpWND(stopidx-startidx);
     qMemCopy( tmpWND.data(), smoothRS, (stopidx-startidx) * sizeof( QwtIntervalSample ) );
     windCurve->setData(new QwtIntervalSeriesData(tmpWND));
-    torqueCurve->setData(xaxis, smoothNM, stopidx-startidx);
-    balanceLCurve->setData(xaxis, smoothBALL, stopidx-startidx);
-    balanceRCurve->setData(xaxis, smoothBALR, stopidx-startidx);
+    torqueCurve->setData(new AllPlotLODData(this, xaxis, smoothNM, stopidx-startidx));
+    balanceLCurve->setData(new AllPlotLODData(this, xaxis, smoothBALL, stopidx-startidx));
+    balanceRCurve->setData(new AllPlotLODData(this, xaxis, smoothBALR, stopidx-startidx));
 
     /*QVector<double> _time(stopidx-startidx);
     qMemCopy( _time.data(), xaxis, (stopidx-startidx) * sizeof( double ) );
@@ -1530,9 +1565,14 @@ AllPlot::setDataFromPlot(AllPlot *plot, int startidx, int stopidx)
 void
 AllPlot::setDataFromRide(RideItem *_rideItem)
 {
+    GC_TRACE_SPAN("ride plot");
     rideItem = _rideItem;
     if (_rideItem == NULL) return;
 
+    // new data needs smoothing afresh
+    delete smoother;
+    smoother = NULL;
+
     wattsArray.clear();
     curveTitle.setLabel(QwtText(QString(""), QwtText::PlainText)); // default to no title
 
@@ -1540,20 +1580,24 @@ AllPlot::setDataFromRide(RideItem *_rideItem)
     if (ride && ride->dataPoints().size()) {
         const RideFileDataPresent *dataPresent = ride->areDataPresent();
         int npoints = ride->dataPoints().size();
-        wattsArray.resize(dataPresent->watts ? npoints : 0);
-        npArray.resize(dataPresent->np ? npoints : 0);
-        xpArray.resize(dataPresent->xp ? npoints : 0);
-        apArray.resize(dataPresent->apower ? npoints : 0);
-        hrArray.resize(dataPresent->hr ? npoints : 0);
-        speedArray.resize(dataPresent->kph ? npoints : 0);
-        cadArray.resize(dataPresent->cad ? npoints : 0);
-        altArray.resize(dataPresent->alt ? npoints : 0);
-        tempArray.resize(dataPresent->temp ? npoints : 0);
-        windArray.resize(dataPresent->headwind ? npoints : 0);
-        torqueArray.resize(dataPresent->nm ? npoints : 0);
-        balanceArray.resize(dataPresent->lrbalance ? npoints : 0);
+        bool metric = context->athlete->useMetricUnits;
+
+        // the ride's own columns, shared with the other charts
+        // unless we need to convert units
+        wattsArray = dataPresent->watts ? ride->scaledSeriesData(RideFile::watts, 1.0, true) : QVector<double>();
+        npArray = dataPresent->np ? ride->scaledSeriesData(RideFile::NP, 1.0, true) : QVector<double>();
+        xpArray = dataPresent->xp ? ride->scaledSeriesData(RideFile::xPower, 1.0, true) : QVector<double>();
+        apArray = dataPresent->apower ? ride->scaledSeriesData(RideFile::aPower, 1.0, true) : QVector<double>();
+        hrArray = dataPresent->hr ? ride->scaledSeriesData(RideFile::hr, 1.0, true) : QVector<double>();
+        speedArray = dataPresent->kph ? ride->scaledSeriesData(RideFile::kph, metric ? 1.0 : MILES_PER_KM, true) : QVector<double>();
+        cadArray = dataPresent->cad ? ride->scaledSeriesData(RideFile::cad, 1.0, true) : QVector<double>();
+        altArray = dataPresent->alt ? ride->scaledSeriesData(RideFile::alt, metric ? 1.0 : FEET_PER_METER, false) : QVector<double>();
+        tempArray = dataPresent->temp ? ride->seriesData(RideFile::temp) : QVector<double>();
+        windArray = dataPresent->headwind ? ride->scaledSeriesData(RideFile::headwind, metric ? 1.0 : MILES_PER_KM, true) : QVector<double>();
+        torqueArray = dataPresent->nm ? ride->scaledSeriesData(RideFile::nm, metric ? 1.0 : FEET_LB_PER_NM, true) : QVector<double>();
+        balanceArray = dataPresent->lrbalance ? ride->seriesData(RideFile::lrbalance) : QVector<double>();
+        distanceArray = ride->scaledSeriesData(RideFile::km, metric ? 1.0 : MILES_PER_KM, true);
         timeArray.resize(npoints);
-        distanceArray.resize(npoints);
 
         // attach appropriate curves
         wCurve->detach();
@@ -1625,46 +1669,6 @@ AllPlot::setDataFromRide(RideItem *_rideItem)
             double msecs = round((point->secs - secs) * 100) * 10;
 
             timeArray[arrayLength]  = secs + msecs/1000;
-            if (!wattsArray.empty()) wattsArray[arrayLength] = max(0, point->watts);
-            if (!npArray.empty()) npArray[arrayLength] = max(0, point->np);
-            if (!xpArray.empty()) xpArray[arrayLength] = max(0, point->xp);
-            if (!apArray.empty()) apArray[arrayLength] = max(0, point->apower);
-
-            if (!hrArray.empty())
-                hrArray[arrayLength]    = max(0, point->hr);
-            if (!speedArray.empty())
-                speedArray[arrayLength] = max(0,
-                                              (context->athlete->useMetricUnits
-                                               ? point->kph
-                                               : point->kph * MILES_PER_KM));
-            if (!cadArray.empty())
-                cadArray[arrayLength]   = max(0, point->cad);
-            if (!altArray.empty())
-                altArray[arrayLength]   = (context->athlete->useMetricUnits
-                                           ? point->alt
-                                           : point->alt * FEET_PER_METER);
-            if (!tempArray.empty())
-                tempArray[arrayLength]   = point->temp;
-
-            if (!windArray.empty())
-                windArray[arrayLength] = max(0,
-                                             (context->athlete->useMetricUnits
-                                              ? point->headwind
-                                              : point->headwind * MILES_PER_KM));
-
-            if (!balanceArray.empty())
-                balanceArray[arrayLength]   = point->lrbalance;
-
-            distanceArray[arrayLength] = max(0,
-                                             (context->athlete->useMetricUnits
-                                              ? point->km
-                                              : point->km * MILES_PER_KM));
-
-            if (!torqueArray.empty())
-                torqueArray[arrayLength] = max(0,
-                                              (context->athlete->useMetricUnits
-                                               ? point->nm
-                                               : point->nm * FEET_LB_PER_NM));
             ++arrayLength;
         }
         recalc();
@@ -1691,6 +1695,7 @@ AllPlot::setDataFromRide(RideItem *_rideItem)
         foreach(QwtPlotMarker *mrk, d_mrk)
             delete mrk;
         d_mrk.clear();
+        markerKey.clear();
 
         foreach(QwtPlotMarker *mrk, cal_mrk)
             delete mrk;
@@ -1964,51 +1969,6 @@ AllPlot::distanceIndex(double km) const
  *--------------------------------------------------------------------*/
 
 
-/*
- * HELPER FUNCTIONS:
- *    intervalNum - returns a pointer to the nth selected interval
- *    intervalCount - returns the number of highlighted intervals
- */
-
-// note this is operating on the children of allIntervals and not the
-// intervalWidget (QTreeWidget) -- this is why we do not use the
-// selectedItems() member. N starts a one not zero.
-IntervalItem *IntervalPlotData::intervalNum(int n) const
-{
-    int highlighted=0;
-    const QTreeWidgetItem *allIntervals = context->athlete->allIntervalItems();
-    for (int i=0; i<allIntervals->childCount(); i++) {
-        IntervalItem *current = (IntervalItem *)allIntervals->child(i);
-
-        if (current != NULL) {
-            if (current->isSelected() == true) ++highlighted;
-        } else {
-            return NULL;
-        }
-        if (highlighted == n) return current;
-    }
-    return NULL;
-}
-
-// how many intervals selected?
-int IntervalPlotData::intervalCount() const
-{
-    int highlighted;
-    highlighted = 0;
-    if (context->athlete->allIntervalItems() == NULL) return 0; // not inited yet!
-
-    const QTreeWidgetItem *allIntervals = context->athlete->allIntervalItems();
-    for (int i=0; i<allIntervals->childCount(); i++) {
-        IntervalItem *current = (IntervalItem *)allIntervals->child(i);
-        if (current != NULL) {
-            if (current->isSelected() == true) {
-                ++highlighted;
-            }
-        }
-    }
-    return highlighted;
-}
-
 /*
  * INTERVAL HIGHLIGHTING CURVE
  * IntervalPlotData - implements the qwtdata interface where
@@ -2030,14 +1990,14 @@ int IntervalPlotData::intervalCount() const
 double IntervalPlotData::x(size_t i) const
 {
     // for each interval there are four points, which interval is this for?
-    int interval = i ? i/4 : 0;
-    interval += 1; // interval numbers start at 1 not ZERO in the utility functions
+    // the overlay was brought up to date when qwt asked for our size
+    const IntervalOverlay *overlay = context->athlete->intervalOverlay;
+    int interval = i/4;
+    if (interval >= overlay->selected().count()) return 0; // out of bounds !?
 
     double multiplier = context->athlete->useMetricUnits ? 1 : MILES_PER_KM;
 
-    // get the interval
-    IntervalItem *current = intervalNum(interval);
-    if (current == NULL) return 0; // out of bounds !?
+    const IntervalOverlay::Interval *current = &overlay->at(overlay->selected()[interval]);
 
     // which point are we returning?
     switch (i%4) {
@@ -2063,7 +2023,93 @@ double IntervalPlotData::y(size_t i) const
 }
 
 
-size_t IntervalPlotData::size() const { return intervalCount()*4; }
+AllPlotLODData::AllPlotLODData(QwtPlot *plot, const double *x, const double *y, int count)
+    : plot(plot), level(0)
+{
+    xdata.resize(count);
+    ydata.resize(count);
+    if (count <= 0) return;
+
+    qMemCopy(xdata.data(), x, count * sizeof(double));
+    qMemCopy(ydata.data(), y, count * sizeof(double));
+
+    // full resolution bounds so autoscaling doesn't change
+    double minx=x[0], maxx=x[0], miny=y[0], maxy=y[0];
+    for (int i=1; i<count; i++) {
+        if (x[i] < minx) minx = x[i];
+        if (x[i] > maxx) maxx = x[i];
+        if (y[i] < miny) miny = y[i];
+        if (y[i] > maxy) maxy = y[i];
+    }
+    bounds = QRectF(minx, miny, maxx-minx, maxy-miny);
+
+    // build the levels, each from the one below, halving until small
+    // enough that there's no point going further, the pair in each
+    // block is kept in sample order so the shape of the curve is kept
+    QVector<int> below(count);
+    for (int i=0; i<count; i++) below[i] = i;
+    bool pairs = false; // level 0 is single samples
+
+    while (below.count() > 256) {
+
+        int step = pairs ? 4 : 2;
+        QVector<int> next;
+        next.reserve(below.count() / 2 + 2);
+
+        for (int b=0; b<below.count(); b+=step) {
+            int end = qMin(b+step, below.count());
+            int mn = below[b], mx = below[b];
+            for (int j=b+1; j<end; j++) {
+                if (ydata[below[j]] < ydata[mn]) mn = below[j];
+                if (ydata[below[j]] > ydata[mx]) mx = below[j];
+            }
+            next << qMin(mn, mx) << qMax(mn, mx);
+        }
+        levels << next;
+        below = next;
+        pairs = true;
+    }
+}
+
+size_t AllPlotLODData::size() const
+{
+    return level ? levels[level-1].count() : xdata.count();
+}
+
+QPointF AllPlotLODData::sample(size_t i) const
+{
+    int index = level ? levels[level-1][i] : i;
+    return QPointF(xdata[index], ydata[index]);
+}
+
+QRectF AllPlotLODData::boundingRect() const
+{
+    return bounds;
+}
+
+void AllPlotLODData::setRectOfInterest(const QRectF &rect)
+{
+    if (levels.isEmpty()) return;
+
+    // how many samples are visible (x is always increasing)
+    const double *from = qLowerBound(xdata.constBegin(), xdata.constEnd(), rect.left());
+    const double *to = qUpperBound(xdata.constBegin(), xdata.constEnd(), rect.right());
+    int visible = to - from;
+    int pixels = qMax(plot->canvas()->width(), 100);
+
+    // level n has two points per 2^n samples
+    level = 0;
+    while (level < levels.count() && (visible >> (level+1)) >= pixels) level++;
+}
+
+size_t IntervalPlotData::size() const
+{
+    IntervalOverlay *overlay = context->athlete->intervalOverlay;
+    if (overlay == NULL) return 0; // not inited yet!
+
+    overlay->refresh();
+    return overlay->selected().count() * 4;
+}
 
 QPointF IntervalPlotData::sample(size_t i) const {
     return QPointF(x(i), y(i));
@@ -2097,6 +2143,13 @@ AllPlot::pointHover(QwtPlotCurve *curve, int index)
                         .arg(xstring)
                         .arg(this->axisTitle(curve->xAxis()).text());
 
+        // and the intervals we are in
+        IntervalOverlay *overlay = context->athlete->intervalOverlay;
+        overlay->refresh();
+        QVector<int> in = bydist ? overlay->intervalsAtKM(xvalue / (context->athlete->useMetricUnits ? 1 : MILES_PER_KM))
+                                 : overlay->intervalsAt(xvalue * 60.0);
+        foreach(int i, in) text += QString("\n%1").arg(overlay->at(i).item->text(0));
+
         // set that text up
         tooltip->setText(text);
 
@@ -43,6 +43,19 @@ class IntervalPlotData;
 class Context;
 class LTMToolTip;
 class LTMCanvasPicker;
+class RollingAverage;
+
+// another ride's effort drawn over this one when comparing, the x values
+// are already on this plot's time or distance axis
+struct AllPlotOverlay
+{
+    QString name;
+    QColor color;
+    bool hr; // against the heart rate axis, rather than watts
+    QVector<double> x, y;
+
+    AllPlotOverlay() : hr(false) {}
+};
 
 class AllPlot : public QwtPlot
 {
@@ -53,6 +66,7 @@ class AllPlot : public QwtPlot
     public:
 
         AllPlot(AllPlotWindow *parent, Context *context);
+        ~AllPlot();
 
         bool eventFilter(QObject *object, QEvent *e);
 
@@ -82,6 +96,9 @@ class AllPlot : public QwtPlot
         void confirmTmpReference(double value, int axis, bool allowDelete);
         QwtPlotCurve* plotReferenceLine(const RideFilePoint *referencePoint);
 
+        // replaces the curves drawn for other rides, empty to remove them
+        void setOverlays(const QList<AllPlotOverlay> &overlays);
+
     public slots:
 
         void setShowPower(int id);
@@ -138,6 +155,7 @@ class AllPlot : public QwtPlot
         // plot objects
         QwtPlotGrid *grid;
         QVector<QwtPlotMarker*> d_mrk;
+        QString markerKey; // what d_mrk was last drawn from
         QVector<QwtPlotMarker*> cal_mrk;
         QwtPlotMarker curveTitle;
         QwtPlotMarker *allMarker1;
@@ -158,6 +176,7 @@ class AllPlot : public QwtPlot
         QwtPlotCurve *wCurve;
         QwtPlotCurve *mCurve;
         QwtPlotCurve *intervalHighlighterCurve;  // highlight selected intervals on the Plot
+        QList<QwtPlotCurve*> overlayCurves; // other rides, see setOverlays()
         QList <AllPlotZoneLabel *> zoneLabels;
         QVector<QwtPlotCurve*> referenceLines;
         QVector<QwtPlotCurve*> tmpReferenceLines;
@@ -209,6 +228,13 @@ class AllPlot : public QwtPlot
         LTMToolTip *tooltip;
         LTMCanvasPicker *_canvasPicker; // allow point selection/hover
 
+        // smoothing the source data, which series are where
+        enum { SmoothWatts, SmoothNP, SmoothXP, SmoothAP, SmoothHr, SmoothSpeed,
+               SmoothCad, SmoothAlt, SmoothTemp, SmoothWind, SmoothTorque,
+               SmoothBalance, SmoothDistance, SmoothSeries };
+        RollingAverage *smoother;
+        int smoothIndex[SmoothSeries];
+
         static void nextStep( int& step );
 };
 
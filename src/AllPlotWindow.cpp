@@ -30,6 +30,9 @@
 #include "Settings.h"
 #include "Units.h" // for MILES_PER_KM
 #include "Colors.h" // for MILES_PER_KM
+#include "MetricAggregator.h"
+#include "DBAccess.h" // for segment efforts
+#include "CacheStats.h"
 #include <qwt_plot_layout.h>
 #include <qwt_plot_panner.h>
 #include <qwt_plot_zoomer.h>
@@ -53,6 +56,14 @@
 // W' calculator
 #include "WPrime.h"
 
+// about two screens worth of rides for each chart
+static CacheStats compareStats("Compared rides", GC_COMPARECACHE_MB, 16);
+
+AllPlotWindow::~AllPlotWindow()
+{
+    compareStats.forget(this);
+}
+
 AllPlotWindow::AllPlotWindow(Context *context) :
     GcChartWindow(context), current(NULL), context(context), active(false), stale(true), setupStack(false)
 {
@@ -209,6 +220,25 @@ AllPlotWindow::AllPlotWindow(Context *context) :
     comboDistance->addItem(tr("Distance"));
     cl3->addRow(new QLabel(tr("X Axis")), comboDistance);
 
+    compareMode = new QComboBox();
+    compareMode->addItem(tr("Off"));
+    compareMode->addItem(tr("Whole rides"));
+    compareMode->addItem(tr("Segment efforts"));
+    cl3->addRow(new QLabel(tr("Compare")), compareMode);
+
+    compareSegment = new QComboBox();
+    cl3->addRow(new QLabel(tr("Segment")), compareSegment);
+
+    compareCount = new QSpinBox();
+    compareCount->setRange(2, 20);
+    compareCount->setValue(10);
+    cl3->addRow(new QLabel(tr("Rides")), compareCount);
+    compareSegment->setEnabled(false);
+    compareCount->setEnabled(false);
+
+    // a ride file is a few hundred KB smoothed, the budget is in bytes
+    compareCache.setMaxCost(compareStats.budget());
+
     QLabel *smoothLabel = new QLabel(tr("Smooth"), this);
     smoothLineEdit = new QLineEdit(this);
     smoothLineEdit->setFixedWidth(40);
@@ -436,6 +466,9 @@ AllPlotWindow::AllPlotWindow(Context *context) :
     connect(rFull, SIGNAL(stateChanged(int)), this, SLOT(setShowFull(int)));
     connect(paintBrush, SIGNAL(stateChanged(int)), this, SLOT(setPaintBrush(int)));
     connect(comboDistance, SIGNAL(currentIndexChanged(int)), this, SLOT(setByDistance(int)));
+    connect(compareMode, SIGNAL(currentIndexChanged(int)), this, SLOT(setCompareMode(int)));
+    connect(compareSegment, SIGNAL(currentIndexChanged(int)), this, SLOT(setCompareSegment(int)));
+    connect(compareCount, SIGNAL(valueChanged(int)), this, SLOT(setCompareCount(int)));
     connect(smoothSlider, SIGNAL(valueChanged(int)), this, SLOT(setSmoothingFromSlider()));
     connect(smoothLineEdit, SIGNAL(editingFinished()), this, SLOT(setSmoothingFromLineEdit()));
     connect(rSmoothSlider, SIGNAL(valueChanged(int)), this, SLOT(setrSmoothingFromSlider()));
@@ -669,6 +702,10 @@ AllPlotWindow::rideSelected()
     }
     allPlot->setDataFromPlot( fullPlot, startidx, stopidx );
 
+    // the segments it can be compared on are the ride's own
+    setCompareSegments();
+    refreshCompare();
+
     // redraw all the plots, they will check
     // to see if they are currently visible
     // and only redraw if neccessary
@@ -1487,6 +1524,7 @@ AllPlotWindow::setByDistance(int value)
 
     // refresh
     redrawFullPlot();
+    refreshCompare();
     redrawAllPlot();
     setupStackPlots();
 
@@ -1504,10 +1542,188 @@ AllPlotWindow::setSmoothing(int value)
 
     // redraw
     redrawFullPlot();
+    refreshCompare();
     redrawAllPlot();
     redrawStackPlot();
 }
 
+void
+AllPlotWindow::setCompareMode(int value)
+{
+    // setting the combo calls us back
+    if (compareMode->currentIndex() != value) {
+        compareMode->setCurrentIndex(value);
+        return;
+    }
+
+    compareSegment->setEnabled(value != CompareOff);
+    compareCount->setEnabled(value != CompareOff);
+
+    setCompareSegments();
+    refreshCompare();
+}
+
+void
+AllPlotWindow::setCompareCount(int value)
+{
+    compareCount->setValue(value);
+    refreshCompare();
+}
+
+void
+AllPlotWindow::setCompareSegment(int)
+{
+    refreshCompare();
+}
+
+void
+AllPlotWindow::setCompareSegments()
+{
+    int segment = compareSegment->count() ? compareSegment->itemData(compareSegment->currentIndex()).toInt() : -1;
+
+    compareSegment->blockSignals(true);
+    compareSegment->clear();
+
+    DBAccess *db = context->athlete->metricDB ? context->athlete->metricDB->db() : NULL;
+    if (current && db && compareMode->currentIndex() != CompareOff) {
+
+        QMap<int, QString> names;
+        foreach(Segment known, db->getSegments()) names.insert(known.id, known.name);
+
+        // in the order the ride goes through them
+        foreach(SegmentEffort effort, db->getRideEfforts(current->fileName)) {
+            if (!names.contains(effort.segment) || compareSegment->findData(effort.segment) >= 0) continue;
+            compareSegment->addItem(names.value(effort.segment), effort.segment);
+        }
+    }
+
+    // stay on the same segment when going from ride to ride along it
+    int index = compareSegment->findData(segment);
+    compareSegment->setCurrentIndex(index >= 0 ? index : 0);
+    compareSegment->blockSignals(false);
+}
+
+AllPlotWindow::CompareRide *
+AllPlotWindow::compareRide(QString filename)
+{
+    QFileInfo info(context->athlete->home.absolutePath() + "/" + filename);
+
+    CompareRide *compare = compareCache.object(filename);
+    if (compare && compare->modified == info.lastModified()) {
+        compareStats.hit();
+        return compare;
+    }
+    compareStats.miss();
+
+    // only the series we plot, the rest aren't decoded
+    RideFileDataPresent wanted;
+    wanted.secs = wanted.km = wanted.watts = wanted.hr = true;
+
+    QStringList errors;
+    QFile file(info.absoluteFilePath());
+    RideFile *ride = RideFileFactory::instance().openRideFileSeries(context, file, errors, wanted);
+    if (ride == NULL) return NULL;
+
+    const QVector<double> &secs = ride->seriesData(RideFile::secs);
+    if (secs.count() < 2) {
+        delete ride;
+        return NULL;
+    }
+
+    compare = new CompareRide;
+    compare->modified = info.lastModified();
+    compare->seconds = (int) ceil(secs.last());
+    compare->smoother = new RollingAverage(secs, secs.count());
+    if (ride->areDataPresent()->watts) compare->watts = compare->smoother->addSeries(ride->seriesData(RideFile::watts));
+    if (ride->areDataPresent()->hr) compare->hr = compare->smoother->addSeries(ride->seriesData(RideFile::hr));
+    compare->km = compare->smoother->addSeries(ride->seriesData(RideFile::km));
+    int cost = qMax(1, int(4 * sizeof(double)) * secs.count()); // the sums of each series and secs
+    delete ride;
+
+    compareCache.setMaxCost(compareStats.budget());
+    compareCache.insert(filename, compare, cost);
+    compareStats.setUsage(this, compareCache.totalCost(), compareCache.count());
+    return compare;
+}
+
+void
+AllPlotWindow::refreshCompare()
+{
+    QList<AllPlotOverlay> overlays;
+
+    DBAccess *db = context->athlete->metricDB ? context->athlete->metricDB->db() : NULL;
+    int segment = compareSegment->count() ? compareSegment->itemData(compareSegment->currentIndex()).toInt() : -1;
+    int mode = compareMode->currentIndex();
+
+    if (current && current->ride() && db && segment >= 0 && mode != CompareOff) {
+
+        // the others are lined up against the ride's own effort
+        SegmentEffort mine;
+        foreach(SegmentEffort effort, db->getRideEfforts(current->fileName)) {
+            if (effort.segment == segment) {
+                mine = effort;
+                break;
+            }
+        }
+        double mineKm = current->ride()->timeToDistance(mine.start);
+
+        // power where we have it, heart rate when we don't
+        bool hr = !current->ride()->areDataPresent()->watts;
+        double factor = context->athlete->useMetricUnits ? 1.0 : MILES_PER_KM;
+        int smooth = qMax(1, allPlot->smooth);
+        int rides = compareCount->value();
+
+        // the most recent efforts, one per ride
+        QStringList seen;
+        QList<QPair<QString, SegmentEffort> > efforts = db->getEfforts(segment);
+        for (int i=efforts.count()-1; i >= 0 && overlays.count() < rides; i--) {
+
+            QString filename = efforts[i].first;
+            const SegmentEffort &effort = efforts[i].second;
+            if (filename == current->fileName || seen.contains(filename)) continue;
+            seen << filename;
+
+            CompareRide *ride = compareRide(filename);
+            if (ride == NULL || (hr ? ride->hr : ride->watts) < 0) continue;
+
+            ride->smoother->compute(smooth, ride->seconds);
+            const QVector<double> &values = ride->smoother->mean(hr ? ride->hr : ride->watts);
+            const QVector<double> &km = ride->smoother->last(ride->km);
+            const QVector<int> &count = ride->smoother->count();
+
+            int from = 0, to = ride->seconds;
+            if (mode == CompareEfforts) {
+                from = qBound(0, (int) effort.start, ride->seconds);
+                to = qBound(from, (int) ceil(effort.stop), ride->seconds);
+            }
+
+            AllPlotOverlay overlay;
+            overlay.name = QFileInfo(filename).baseName();
+            overlay.color = QColor::fromHsv((overlays.count() * 300) / rides, 200, 230);
+            overlay.hr = hr;
+            for (int secs = from; secs <= to; secs++) {
+
+                if (count[secs] == 0) continue; // not recording
+
+                double x;
+                if (allPlot->bydist) {
+                    x = mode == CompareEfforts ? mineKm + km[secs] - km[from] : km[secs];
+                    x *= factor;
+                } else {
+                    x = mode == CompareEfforts ? mine.start + secs - effort.start : secs;
+                    x /= 60.0;
+                }
+                overlay.x << x;
+                overlay.y << values[secs];
+            }
+            overlays << overlay;
+        }
+    }
+
+    allPlot->setOverlays(overlays);
+    if (!showStack->isChecked()) allPlot->replot();
+}
+
 //
 // Runs through the stacks and updates their contents
 //
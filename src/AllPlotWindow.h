@@ -37,6 +37,7 @@ class QxtGroupBox;
 class WPrime;
 
 #include "LTMWindow.h" // for tooltip/canvaspicker
+#include "RollingAverage.h" // for smoothing the rides compared against
 
 class AllPlotWindow : public GcChartWindow
 {
@@ -67,10 +68,13 @@ class AllPlotWindow : public GcChartWindow
     Q_PROPERTY(int byDistance READ isByDistance WRITE setByDistance USER true)
     Q_PROPERTY(int smoothing READ smoothing WRITE setSmoothing USER true)
     Q_PROPERTY(int paintBrush READ isPaintBrush WRITE setPaintBrush USER true)
+    Q_PROPERTY(int compareMode READ isCompareMode WRITE setCompareMode USER true)
+    Q_PROPERTY(int compareCount READ compareRides WRITE setCompareCount USER true)
 
     public:
 
         AllPlotWindow(Context *context);
+        ~AllPlotWindow();
         void setData(RideItem *ride);
 
         bool hasReveal() { return true; }
@@ -100,6 +104,13 @@ class AllPlotWindow : public GcChartWindow
         int isByDistance() const { return comboDistance->currentIndex(); }
         int isPaintBrush() const { return paintBrush->isChecked(); }
         int smoothing() const { return smoothSlider->value(); }
+        int isCompareMode() const { return compareMode->currentIndex(); }
+        int compareRides() const { return compareCount->value(); }
+
+        // overlaying other rides' efforts on a segment, either the
+        // whole of those rides from their start or just the effort
+        // lined up with this ride's own
+        enum { CompareOff, CompareRides, CompareEfforts };
 
    public slots:
 
@@ -137,6 +148,9 @@ class AllPlotWindow : public GcChartWindow
         void setSmoothing(int value);
         void setByDistance(int value);
         void setStacked(int value);
+        void setCompareMode(int value);
+        void setCompareCount(int value);
+        void setCompareSegment(int index);
 
         // trap widget signals
         void zoomChanged();
@@ -200,6 +214,9 @@ class AllPlotWindow : public GcChartWindow
         QCheckBox *showW;
         QComboBox *showPower;
         QComboBox *comboDistance;
+        QComboBox *compareMode;
+        QComboBox *compareSegment;
+        QSpinBox *compareCount;
         QSlider *smoothSlider;
         QLineEdit *smoothLineEdit;
         QxtSpanSlider *spanSlider;
@@ -225,6 +242,22 @@ class AllPlotWindow : public GcChartWindow
         bool stale;
         bool setupStack; // we optimise this out, its costly
 
+        // the rides being compared, read once and kept smoothed
+        // until the ride file changes
+        struct CompareRide {
+            QDateTime modified;
+            RollingAverage *smoother;
+            int watts, hr, km; // in the smoother, -1 when not recorded
+            int seconds;
+
+            CompareRide() : smoother(NULL), watts(-1), hr(-1), km(-1), seconds(0) {}
+            ~CompareRide() { delete smoother; }
+        };
+        QCache<QString, CompareRide> compareCache;
+        CompareRide *compareRide(QString filename);
+        void setCompareSegments();
+        void refreshCompare();
+
     private slots:
 
         void addPickers(AllPlot *allPlot2);
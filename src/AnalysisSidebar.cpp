@@ -32,6 +32,8 @@
 #include "IntervalItem.h"
 #include "AddIntervalDialog.h"
 #include "BestIntervalDialog.h"
+#include "MetricAggregator.h"
+#include "Segments.h"
 
 AnalysisSidebar::AnalysisSidebar(Context *context) : QWidget(context->mainWindow), context(context)
 {
@@ -292,6 +294,12 @@ AnalysisSidebar::intervalPopup()
         menu.addAction(actZoomInt);
         menu.addAction(actEditInt);
         menu.addAction(actDeleteInt);
+
+        if (rideItem && rideItem->ride() && rideItem->ride()->areDataPresent()->lat) {
+            QAction *actSegment = new QAction(tr("Create segment"), context->athlete->intervalWidget);
+            connect(actSegment, SIGNAL(triggered(void)), this, SLOT(createSegmentSelected(void)));
+            menu.addAction(actSegment);
+        }
     }
 
     if (context->athlete->intervalWidget->selectedItems().count() > 1) {
@@ -333,6 +341,12 @@ AnalysisSidebar::showIntervalMenu(const QPoint &pos)
         menu.addAction(actZoomInt);
         menu.addAction(actEditInt);
         menu.addAction(actDeleteInt);
+
+        if (context->ride && context->ride->ride() && context->ride->ride()->areDataPresent()->lat) {
+            QAction *actSegment = new QAction(tr("Create segment"), context->athlete->intervalWidget);
+            connect(actSegment, SIGNAL(triggered(void)), this, SLOT(createSegment(void)));
+            menu.addAction(actSegment);
+        }
         menu.exec(context->athlete->intervalWidget->mapToGlobal(pos));
     }
 }
@@ -565,6 +579,50 @@ AnalysisSidebar::zoomIntervalSelected()
     }
 }
 
+void
+AnalysisSidebar::createSegmentSelected()
+{
+    // the one interval that is selected via popup menu
+    for (int i=0; i<context->athlete->allIntervals->childCount(); i++) {
+        if (context->athlete->allIntervals->child(i)->isSelected()) {
+            activeInterval = (IntervalItem*)context->athlete->allIntervals->child(i);
+            createSegment();
+            break;
+        }
+    }
+}
+
+void
+AnalysisSidebar::createSegment()
+{
+    RideFile *ride = context->ride ? context->ride->ride() : NULL;
+    DBAccess *db = context->athlete->metricDB ? context->athlete->metricDB->db() : NULL;
+    if (ride == NULL || db == NULL) return;
+
+    Segment segment;
+    segment.route = Segments::simplify(ride, 50, activeInterval->start, activeInterval->stop);
+    if (segment.route.count() < 2) {
+        QMessageBox::critical(this, tr("Create Segment"), tr("The interval has no GPS track"));
+        return;
+    }
+
+    bool ok;
+    segment.name = QInputDialog::getText(this, tr("Create Segment"), tr("Segment name:"),
+                                         QLineEdit::Normal, activeInterval->text(0), &ok);
+    if (!ok || segment.name.isEmpty()) return;
+
+    // add it and find it in all the rides, this one included, since the
+    // segments are found by their index cells this needn't read them all
+    setCursor(Qt::WaitCursor);
+    db->connection().transaction();
+    segment.id = db->addSegment(segment);
+    int efforts = Segments::backfill(context, db, segment);
+    db->connection().commit();
+    setCursor(Qt::ArrowCursor);
+
+    QMessageBox::information(this, tr("Create Segment"), tr("%1 efforts found on %2").arg(efforts).arg(segment.name));
+}
+
 void
 AnalysisSidebar::zoomOut()
 {
@@ -28,6 +28,8 @@
 #include "Units.h"
 #include "Zones.h"
 #include "MetricAggregator.h"
+#include "StressCalculator.h"
+#include "RideCache.h"
 #include "WithingsDownload.h"
 #include "ZeoDownload.h"
 #include "CalendarDownload.h"
@@ -41,22 +43,70 @@
 #include "NamedSearch.h"
 #endif
 #include "IntervalItem.h"
+#include "IntervalOverlay.h"
 #include "IntervalTreeView.h"
 
 #include "GcUpgrade.h" // upgrade wizard
 #include "GcCrashDialog.h" // recovering from a crash?
 
+#include <QDebug>
+
+// How long each phase of opening an athlete took, written to startup.log
+// in the athlete's home directory so slow startups can be looked into
+class AthleteStartupTrace
+{
+    public:
+        AthleteStartupTrace() { total.start(); phaseTime.start(); }
+
+        void phase(QString name) {
+            phases << QString("%1: %2ms").arg(name).arg(phaseTime.restart());
+        }
+
+        void finish(QString filename) {
+            phases << QString("total: %1ms").arg(total.elapsed());
+
+            QFile log(filename);
+            if (log.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+                QTextStream out(&log);
+                out << QDateTime::currentDateTime().toString() << endl;
+                foreach (QString phase, phases) out << phase << endl;
+                log.close();
+            }
+        }
+
+    private:
+        QTime total, phaseTime;
+        QStringList phases;
+};
+
+// without a main window there is nobody to click ok
+static void zonesMessage(Context *context, bool critical, QString title, QString text)
+{
+    if (context->mainWindow == NULL) qWarning() << title << ":" << text;
+    else if (critical) QMessageBox::critical(context->mainWindow, title, text);
+    else QMessageBox::warning(context->mainWindow, title, text);
+}
+
 Athlete::Athlete(Context *context, const QDir &home)
 {
+    AthleteStartupTrace trace;
+
     // athlete name
     this->home = home;
     this->context = context;
+
+    // ride files are listed when first needed and then only
+    // listed again when something in the directory changes
+    rideFilesStale = true;
+    homeWatcher = new QFileSystemWatcher(this);
+    homeWatcher->addPath(home.absolutePath());
+    connect(homeWatcher, SIGNAL(directoryChanged(QString)), this, SLOT(homeChanged()));
     context->athlete = this;
     cyclist = home.dirName();
     isclean = false;
 
-    // Recovering from a crash?
-    if(!appsettings->cvalue(cyclist, GC_SAFEEXIT, true).toBool()) {
+    // Recovering from a crash? (not asked when run --batch)
+    if(context->mainWindow && !appsettings->cvalue(cyclist, GC_SAFEEXIT, true).toBool()) {
         GcCrashDialog *crashed = new GcCrashDialog(home);
         crashed->exec();
     }
@@ -75,16 +125,16 @@ Athlete::Athlete(Context *context, const QDir &home)
         appsettings->setCValue(cyclist, GC_UNIT, unit);
     }
     useMetricUnits = (unit.toString() == GC_UNIT_METRIC);
+    trace.phase("upgrade and settings");
 
     // Power Zones
     zones_ = new Zones;
     QFile zonesFile(home.absolutePath() + "/power.zones");
     if (zonesFile.exists()) {
         if (!zones_->read(zonesFile)) {
-            QMessageBox::critical(context->mainWindow, tr("Zones File Error"),
-				  zones_->errorString());
+            zonesMessage(context, true, tr("Zones File Error"), zones_->errorString());
         } else if (! zones_->warningString().isEmpty())
-            QMessageBox::warning(context->mainWindow, tr("Reading Zones File"), zones_->warningString());
+            zonesMessage(context, false, tr("Reading Zones File"), zones_->warningString());
     }
 
     // Heartrate Zones
@@ -92,11 +142,11 @@ Athlete::Athlete(Context *context, const QDir &home)
     QFile hrzonesFile(home.absolutePath() + "/hr.zones");
     if (hrzonesFile.exists()) {
         if (!hrzones_->read(hrzonesFile)) {
-            QMessageBox::critical(context->mainWindow, tr("HR Zones File Error"),
-				  hrzones_->errorString());
+            zonesMessage(context, true, tr("HR Zones File Error"), hrzones_->errorString());
         } else if (! hrzones_->warningString().isEmpty())
-            QMessageBox::warning(context->mainWindow, tr("Reading HR Zones File"), hrzones_->warningString());
+            zonesMessage(context, false, tr("Reading HR Zones File"), hrzones_->warningString());
     }
+    trace.phase("zones");
 
     // Metadata
     rideMetadata_ = new RideMetadata(context,true);
@@ -104,33 +154,39 @@ Athlete::Athlete(Context *context, const QDir &home)
 
     // Date Ranges
     seasons = new Seasons(home);
+    trace.phase("metadata and seasons");
 
     // Search / filter
 #ifdef GC_HAVE_LUCENE
     namedSearches = new NamedSearches(home); // must be before navigator
     lucene = new Lucene(context, context); // before metricDB attempts to refresh
+    trace.phase("search index");
 #endif
 
     // metrics DB
     metricDB = new MetricAggregator(context); // just to catch config updates!
-    metricDB->refreshMetrics();
+    if (v3.refreshInBackground()) metricDB->refreshMetricsInBackground(); // rebuilding after an upgrade
+    else metricDB->refreshMetrics();
+    stressCache = new StressCache(context); // PMC kept between charts
+    trace.phase("metrics refresh");
 
     // the model atop the metric DB
     sqlModel = new QSqlTableModel(this, metricDB->db()->connection());
     sqlModel->setTable("metrics");
     sqlModel->setEditStrategy(QSqlTableModel::OnManualSubmit);
 
-    // Downloaders
-    withingsDownload = new WithingsDownload(context);
-    zeoDownload      = new ZeoDownload(context);
-    calendarDownload = new CalendarDownload(context);
-
-    // Calendar
+    // Downloaders and Calendar are created when first used
+    withingsDownload_ = NULL;
+    zeoDownload_ = NULL;
+    calendarDownload_ = NULL;
 #ifdef GC_HAVE_ICAL
-    rideCalendar = new ICalendar(context); // my local/remote calendar entries
-    davCalendar = new CalDAV(context); // remote caldav
-    davCalendar->download(); // refresh the diary window
+    rideCalendar_ = NULL;
+    davCalendar_ = NULL;
 #endif
+    trace.phase("sql model");
+
+    // opened rides
+    rideCache = new RideCache(context);
 
     // RIDE TREE -- transitionary
     treeWidget = new QTreeWidget;
@@ -164,18 +220,19 @@ Athlete::Athlete(Context *context, const QDir &home)
     allIntervals = context->athlete->intervalWidget->invisibleRootItem();
     allIntervals->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDropEnabled);
     allIntervals->setText(0, tr("Intervals"));
+    intervalOverlay = new IntervalOverlay(context);
 
-    // populate ride list
-    QTreeWidgetItem *last = NULL;
-    QStringListIterator i(RideFileFactory::instance().listRideFiles(home));
+    trace.phase("trees");
+
+    // populate ride list, the RideItems are created as they are needed
+    QStringListIterator i(allRideFiles());
     while (i.hasNext()) {
-        QString name = i.next();
-        QDateTime dt;
-        if (RideFile::parseRideFileName(name, &dt)) {
-            last = new RideItem(RIDE_TYPE, home.path(), name, dt, zones(), hrZones(), context);
-            allRides->addChild(last);
-        }
+        RideIndexEntry add;
+        add.fileName = i.next();
+        add.item = NULL;
+        if (RideFile::parseRideFileName(add.fileName, &add.dateTime)) rideIndex << add;
     }
+    trace.phase(QString("ride list (%1 rides)").arg(rideIndex.count()));
 
     // trap signals
     connect(context, SIGNAL(configChanged()), this, SLOT(configChanged()));
@@ -184,7 +241,49 @@ Athlete::Athlete(Context *context, const QDir &home)
     connect(context,SIGNAL(rideDeleted(RideItem*)),this,SLOT(checkCPX(RideItem*)));
     connect(intervalWidget,SIGNAL(itemSelectionChanged()), this, SLOT(intervalTreeWidgetSelectionChanged()));
     connect(intervalWidget,SIGNAL(itemChanged(QTreeWidgetItem *,int)), this, SLOT(updateRideFileIntervals()));
+
+    trace.finish(home.absolutePath() + "/startup.log");
+}
+
+CalendarDownload *
+Athlete::calendarDownload()
+{
+    if (calendarDownload_ == NULL) calendarDownload_ = new CalendarDownload(context);
+    return calendarDownload_;
+}
+
+WithingsDownload *
+Athlete::withingsDownload()
+{
+    if (withingsDownload_ == NULL) withingsDownload_ = new WithingsDownload(context);
+    return withingsDownload_;
+}
+
+ZeoDownload *
+Athlete::zeoDownload()
+{
+    if (zeoDownload_ == NULL) zeoDownload_ = new ZeoDownload(context);
+    return zeoDownload_;
+}
+
+#ifdef GC_HAVE_ICAL
+ICalendar *
+Athlete::rideCalendar()
+{
+    if (rideCalendar_ == NULL) {
+        rideCalendar_ = new ICalendar(context); // my local/remote calendar entries
+        davCalendar()->download(); // refresh the diary window
+    }
+    return rideCalendar_;
+}
+
+CalDAV *
+Athlete::davCalendar()
+{
+    if (davCalendar_ == NULL) davCalendar_ = new CalDAV(context); // remote caldav
+    return davCalendar_;
 }
+#endif
 
 void
 Athlete::close()
@@ -196,18 +295,22 @@ Athlete::close()
 
 Athlete::~Athlete()
 {
-    delete withingsDownload;
-    delete zeoDownload;
-    delete calendarDownload;
+    delete withingsDownload_;
+    delete zeoDownload_;
+    delete calendarDownload_;
 
 #ifdef GC_HAVE_ICAL
-    delete rideCalendar;
-    delete davCalendar;
+    delete rideCalendar_;
+    delete davCalendar_;
 #endif
     delete treeWidget;
+    delete intervalOverlay;
+    delete rideCache; // after the rides are gone
+    RideFileCache::freeIncore(context);
 
     // close the db connection (but clear models first!)
     delete sqlModel;
+    delete stressCache;
     delete metricDB;
 
 #ifdef GC_HAVE_LUCENE
@@ -221,18 +324,56 @@ Athlete::~Athlete()
     delete hrzones_;
 }
 
-void Athlete::selectRideFile(QString fileName)
+RideItem *
+Athlete::rideItem(int index)
+{
+    RideIndexEntry &entry = rideIndex[index];
+    if (entry.item == NULL) {
+        entry.item = new RideItem(RIDE_TYPE, home.path(), entry.fileName, entry.dateTime, zones(), hrZones(), context);
+        insertRideItem(entry.item);
+    }
+    return entry.item;
+}
+
+void
+Athlete::insertRideItem(RideItem *item)
+{
+    int at = 0;
+    while (at < allRides->childCount()
+           && static_cast<RideItem*>(allRides->child(at))->dateTime <= item->dateTime) at++;
+    allRides->insertChild(at, item);
+}
+
+int
+Athlete::rideIndexOf(QString fileName) const
 {
-    for (int i = 0; i < allRides->childCount(); i++)
-    {
-        context->ride = (RideItem*) allRides->child(i);
-        if (context->ride->fileName == fileName) {
-            treeWidget->scrollToItem(allRides->child(i),
-                QAbstractItemView::EnsureVisible);
-            treeWidget->setCurrentItem(allRides->child(i));
-            i = allRides->childCount();
+    // the index is in date order and the date is in the name
+    QDateTime dt;
+    if (RideFile::parseRideFileName(fileName, &dt)) {
+        int low = 0, high = rideIndex.count();
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (rideIndex[mid].dateTime < dt) low = mid + 1;
+            else high = mid;
         }
+        for (int i=low; i<rideIndex.count() && rideIndex[i].dateTime == dt; i++)
+            if (rideIndex[i].fileName == fileName) return i;
     }
+
+    // just in case
+    for (int i=0; i<rideIndex.count(); i++)
+        if (rideIndex[i].fileName == fileName) return i;
+    return -1;
+}
+
+void Athlete::selectRideFile(QString fileName)
+{
+    int index = rideIndexOf(fileName);
+    if (index < 0) return;
+
+    context->ride = rideItem(index);
+    treeWidget->scrollToItem(context->ride, QAbstractItemView::EnsureVisible);
+    treeWidget->setCurrentItem(context->ride);
 }
 
 void
@@ -247,10 +388,28 @@ Athlete::rideTreeWidgetSelectionChanged()
             context->ride = (RideItem*) which;
     }
 
+    // read it in the background rather than block the GUI, the
+    // charts are told about it once it is ready
+    if (context->ride && !context->ride->requestRide()) {
+        connect(context->ride, SIGNAL(rideReady()), this, SLOT(rideReady()), Qt::UniqueConnection);
+        context->notifyRideLoading(context->ride);
+        return;
+    }
+
     // emit signal!
     context->notifyRideSelected(context->ride);
 }
 
+void
+Athlete::rideReady()
+{
+    RideItem *item = static_cast<RideItem*>(sender());
+    disconnect(item, SIGNAL(rideReady()), this, SLOT(rideReady()));
+
+    // ignore it if we've moved on since
+    if (item == context->ride) context->notifyRideSelected(item);
+}
+
 void
 Athlete::intervalTreeWidgetSelectionChanged()
 {
@@ -278,6 +437,22 @@ Athlete::updateRideFileIntervals()
     which->setDirty(true);
 }
 
+QStringList
+Athlete::allRideFiles()
+{
+    if (rideFilesStale) {
+        rideFiles = RideFileFactory::instance().listRideFiles(home);
+        rideFilesStale = false;
+    }
+    return rideFiles;
+}
+
+void
+Athlete::homeChanged()
+{
+    rideFilesStale = true;
+}
+
 const RideFile *
 Athlete::currentRide()
 {
@@ -296,21 +471,27 @@ Athlete::addRide(QString name, bool dosignal)
 
     RideItem *last = new RideItem(RIDE_TYPE, home.path(), name, dt, zones(), hrZones(), context);
 
+    // replaces any we already have for the file
     int index = 0;
-    while (index < allRides->childCount()) {
-        QTreeWidgetItem *item = allRides->child(index);
-        if (item->type() != RIDE_TYPE) continue;
-        RideItem *other = static_cast<RideItem*>(item);
-
-        if (other->dateTime > dt) break;
-        if (other->fileName == name) {
-            delete allRides->takeChild(index);
+    while (index < rideIndex.count()) {
+        const RideIndexEntry &other = rideIndex[index];
+
+        if (other.dateTime > dt) break;
+        if (other.fileName == name) {
+            if (other.item) delete allRides->takeChild(allRides->indexOfChild(other.item));
+            rideIndex.remove(index);
             break;
         }
         ++index;
     }
+    RideIndexEntry add;
+    add.fileName = name;
+    add.dateTime = dt;
+    add.item = last;
+    rideIndex.insert(index, add);
+
     if (dosignal) context->notifyRideAdded(last); // here so emitted BEFORE rideSelected is emitted!
-    allRides->insertChild(index, last);
+    insertRideItem(last);
 
     // if it is the very first ride, we need to select it
     // after we added it
@@ -327,15 +508,16 @@ Athlete::removeCurrentRide()
     RideItem *item = static_cast<RideItem*>(_item);
 
     QTreeWidgetItem *itemToSelect = NULL;
-    for (x=0; x<allRides->childCount(); ++x)
-        if (item==allRides->child(x)) break;
+    x = rideIndexOf(item->fileName);
+    if (x < 0) return;
 
-    if (x>0) itemToSelect = allRides->child(x-1);
+    if (x>0) itemToSelect = rideItem(x-1);
 
-    if ((x+1)<allRides->childCount())
-        itemToSelect = allRides->child(x+1);
+    if ((x+1)<rideCount())
+        itemToSelect = rideItem(x+1);
 
     QString strOldFileName = item->fileName;
+    rideIndex.remove(x);
     allRides->removeChild(item);
 
 
@@ -372,7 +554,7 @@ Athlete::removeCurrentRide()
     delete item;
 
     // any left?
-    if (allRides->childCount() == 0) {
+    if (rideCount() == 0) {
         context->ride = NULL;
         context->notifyRideSelected(NULL); // notifies children
     }
@@ -390,11 +572,16 @@ Athlete::removeCurrentRide()
 void
 Athlete::checkCPX(RideItem*ride)
 {
-    QList<RideFileCache*> newList;
+    QList<RideFileCacheAggregate*> newList;
 
-    foreach(RideFileCache *p, cpxCache) {
+    // the saved month aggregate is stale too
+    RideFileCache::invalidateAggregate(context, ride->dateTime.date());
+
+    foreach(RideFileCacheAggregate *p, cpxCache) {
         if (ride->dateTime.date() < p->start || ride->dateTime.date() > p->end)
             newList.append(p);
+        else
+            delete p;
     }
     cpxCache = newList;
 }
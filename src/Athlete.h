@@ -40,9 +40,13 @@ class RideNavigator;
 class Lucene;
 class NamedSearches;
 class RideFileCache;
+class RideFileCacheAggregate;
+class StressCache;
+class RideCache;
 class RideItem;
 class IntervalItem;
 class IntervalTreeView;
+class IntervalOverlay;
 class QSqlTableModel;
 
 class Context;
@@ -68,10 +72,12 @@ class Athlete : public QObject
         void setCriticalPower(int cp);
         bool isclean;
         MetricAggregator *metricDB;
+        StressCache *stressCache;
+        RideCache *rideCache; // opened rides, freed when memory is short
         QSqlTableModel *sqlModel;
         RideMetadata *rideMetadata_;
         Seasons *seasons;
-        QList<RideFileCache*> cpxCache;
+        QList<RideFileCacheAggregate*> cpxCache;
 
         // athlete's calendar
         CalendarDownload *calendarDownload;
@@ -98,6 +104,22 @@ class Athlete : public QObject
         QTreeWidgetItem *allIntervals;
         IntervalTreeView *intervalWidget;
 
+        // the intervals as the charts draw them, see IntervalOverlay.h
+        IntervalOverlay *intervalOverlay;
+
+        // The ride collection, every ride file in date order. A RideItem is
+        // only created when a ride is first asked for, and only those that
+        // have been created are in the allRides tree
+        int rideCount() const { return rideIndex.count(); }
+        QString rideFileName(int index) const { return rideIndex[index].fileName; }
+        QDateTime rideDateTime(int index) const { return rideIndex[index].dateTime; }
+        RideItem *rideItem(int index);
+        int rideIndexOf(QString fileName) const;
+
+        // every ride file in the home directory, listed again only
+        // when the directory has changed since it was last asked for
+        QStringList allRideFiles();
+
         // access to the ride collection
         void selectRideFile(QString);
         void addRide(QString name, bool bSelect=true);
@@ -119,10 +141,32 @@ class Athlete : public QObject
 
     public slots:
         void rideTreeWidgetSelectionChanged();
+        void rideReady();
         void intervalTreeWidgetSelectionChanged();
         void checkCPX(RideItem*ride);
         void updateRideFileIntervals();
         void configChanged();
-
+        void homeChanged();
+
+    private:
+        struct RideIndexEntry {
+            QString fileName;
+            QDateTime dateTime;
+            RideItem *item; // NULL until asked for
+        };
+        QVector<RideIndexEntry> rideIndex;
+        void insertRideItem(RideItem *item); // into allRides in date order
+
+        QStringList rideFiles;
+        bool rideFilesStale;
+        QFileSystemWatcher *homeWatcher;
+
+        CalendarDownload *calendarDownload_;
+        WithingsDownload *withingsDownload_;
+        ZeoDownload *zeoDownload_;
+#ifdef GC_HAVE_ICAL
+        ICalendar *rideCalendar_;
+        CalDAV *davCalendar_;
+#endif
 };
 #endif
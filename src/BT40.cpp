@@ -22,6 +22,7 @@ BT40::BT40(QObject *parent,  DeviceConfiguration *devConf) : QThread(parent)
 {
     this->parent = parent;
     this->devConf = devConf;    
+    recorder = NULL;
     scanned = false;
     mode = -1;
     load = 100;
@@ -94,9 +95,7 @@ double BT40::getGradient()
 void
 BT40::getRealtimeData(RealtimeData &rtData)
 {
-    pvars.lock();
-    rtData = rt;
-    pvars.unlock();
+    rtData = published.read();
 }
 
 int
@@ -130,6 +129,7 @@ int BT40::quit(int code)
  *----------------------------------------------------------------------*/
 void BT40::run()
 {
+    stats.reset();
     int currentmode = -1;
     int currentload = -1;
     double currentslope= -1;
@@ -174,14 +174,20 @@ void BT40::run()
         }
 
         if (WFApi::getInstance()->hasData(sd)) {
-            pvars.lock();
             WFApi::getInstance()->getRealtimeData(sd, &rt);
 
             // set speed from wheelRpm and configured wheelsize
             double x = rt.getWheelRpm();
             if (devConf) rt.setSpeed(x * devConf->wheelSize / 1000 * 60 / 1000);
             else rt.setSpeed(x * 2.10 * 60 / 1000);
-            pvars.unlock();
+            published.publish(rt);
+            stats.arrived();
+            if (recorder) {
+                recorder->record(recorderDevice, SessionRecorder::Watts, rt.getWatts());
+                recorder->record(recorderDevice, SessionRecorder::HeartRate, rt.getHr());
+                recorder->record(recorderDevice, SessionRecorder::Cadence, rt.getCadence());
+                recorder->record(recorderDevice, SessionRecorder::Speed, rt.getSpeed());
+            }
         }
 
         // lets not hog cpu
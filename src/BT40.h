@@ -28,6 +28,9 @@
 #include "RealtimeController.h"
 #include "TrainSidebar.h"
 #include "DeviceConfiguration.h"
+#include "TelemetrySnapshot.h"
+#include "DeviceStats.h"
+#include "SessionRecorder.h"
 
 #include "WFApi.h"
 
@@ -65,6 +68,9 @@ public:
     double getGradient();
     double getLoad();
     void getRealtimeData(RealtimeData &rtData);
+    // raw samples are sent to the recorder as they arrive
+    void setRecorder(SessionRecorder *recorder, int device) { this->recorder = recorder; recorderDevice = device; }
+    DeviceStats stats;          // message timings, see DeviceStats
 
     QString id() { return deviceUUID; }
 
@@ -92,7 +98,10 @@ private:
     QString deviceUUID;
     int sd; // sensor descriptor aka an index into the connections array
             // mimics the fd index used by open/close syscalls.
-    RealtimeData rt;
+    RealtimeData rt; // only touched by the thread
+    TelemetrySnapshot<RealtimeData> published;
+    SessionRecorder *recorder;      // where raw samples go, if recording
+    int recorderDevice;
 
     void *pool;
 };
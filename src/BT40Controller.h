@@ -53,6 +53,8 @@ public:
     void setLoad(double x) { myBT40->setLoad(x); }
     void setGradient(double x) { myBT40->setGradient(x); }
     void setMode(int x) { myBT40->setMode(x); }
+    void setRecorder(SessionRecorder *recorder, int device) { myBT40->setRecorder(recorder, device); }
+    DeviceStats *stats() { return &myBT40->stats; }
 
     QString id() { return myBT40->id(); }
 
@@ -17,6 +17,7 @@
  */
 
 #include "RideMetric.h"
+#include "RideStatistics.h"
 #include "Context.h"
 #include "Settings.h"
 #include "LTMOutliers.h"
@@ -114,12 +115,8 @@ class TimeRiding : public RideMetric {
                  const Context *) {
 
         secsMovingOrPedaling = 0;
-        if (ride->areDataPresent()->kph) {
-            foreach (const RideFilePoint *point, ride->dataPoints()) {
-                if ((point->kph > 0.0) || (point->cad > 0.0))
-                    secsMovingOrPedaling += ride->recIntSecs();
-            }
-        }
+        if (ride->areDataPresent()->kph)
+            secsMovingOrPedaling = statistics(ride).sums().movingSamples * ride->recIntSecs();
         setValue(secsMovingOrPedaling);
     }
     void override(const QMap<QString,QString> &map) {
@@ -195,6 +192,7 @@ class ElevationGain : public RideMetric {
     ElevationGain() : elegain(0.0), prevalt(0.0)
     {
         setSymbol("elevation_gain");
+        setDependsOn(RideMetric::PowerZone); // the hysteresis is in the zones fingerprint
         setInternalName("Elevation Gain");
     }
     void initialize() {
@@ -207,11 +205,10 @@ class ElevationGain : public RideMetric {
     void compute(const RideFile *ride, const Zones *, int,
                  const HrZones *, int,
                  const QHash<QString,RideMetric*> &,
-                 const Context *) {
+                 const Context *context) {
 
         // hysteresis can be configured, we default to 3.0
-        double hysteresis = appsettings->value(NULL, GC_ELEVATION_HYSTERESIS).toDouble();
-        if (hysteresis <= 0.1) hysteresis = 3.00;
+        double hysteresis = config(context).settings().elevationHysteresis;
 
         bool first = true;
         foreach (const RideFilePoint *point, ride->dataPoints()) {
@@ -257,10 +254,7 @@ class TotalWork : public RideMetric {
                  const HrZones *, int,
                  const QHash<QString,RideMetric*> &,
                  const Context *) {
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->watts >= 0.0)
-                joules += point->watts * ride->recIntSecs();
-        }
+        joules = statistics(ride).sums().watts * ride->recIntSecs();
         setValue(joules/1000);
     }
     RideMetric *clone() const { return new TotalWork(*this); }
@@ -399,13 +393,9 @@ struct AvgPower : public RideMetric {
                  const HrZones *, int,
                  const QHash<QString,RideMetric*> &,
                  const Context *) {
-        total = count = 0;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->watts >= 0.0) {
-                total += point->watts;
-                ++count;
-            }
-        }
+        const RideStatistics::Sums &sums = statistics(ride).sums();
+        total = sums.watts;
+        count = sums.wattsCount;
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -439,13 +429,9 @@ struct AAvgPower : public RideMetric {
                  const HrZones *, int,
                  const QHash<QString,RideMetric*> &,
                  const Context *) {
-        total = count = 0;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->apower >= 0.0) {
-                total += point->apower;
-                ++count;
-            }
-        }
+        const RideStatistics::Sums &sums = statistics(ride).sums();
+        total = sums.apower;
+        count = sums.apowerCount;
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -479,13 +465,9 @@ struct NonZeroPower : public RideMetric {
                  const HrZones *, int,
                  const QHash<QString,RideMetric*> &,
                  const Context *) {
-        total = count = 0;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->watts > 0.0) {
-                total += point->watts;
-                ++count;
-            }
-        }
+        const RideStatistics::Sums &sums = statistics(ride).sums();
+        total = sums.nonZeroWatts;
+        count = sums.nonZeroCount;
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -519,13 +501,9 @@ struct AvgHeartRate : public RideMetric {
                  const HrZones *, int,
                  const QHash<QString,RideMetric*> &,
                  const Context *) {
-        total = count = 0;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->hr > 0) {
-                total += point->hr;
-                ++count;
-            }
-        }
+        const RideStatistics::Sums &sums = statistics(ride).sums();
+        total = sums.hr;
+        count = sums.hrCount;
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -559,13 +537,9 @@ struct AvgCadence : public RideMetric {
                  const HrZones *, int,
                  const QHash<QString,RideMetric*> &,
                  const Context *) {
-        total = count = 0;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->cad > 0) {
-                total += point->cad;
-                ++count;
-            }
-        }
+        const RideStatistics::Sums &sums = statistics(ride).sums();
+        total = sums.cad;
+        count = sums.cadCount;
         setValue(count > 0 ? total / count : count);
         setCount(count);
     }
@@ -645,10 +619,7 @@ class MaxPower : public RideMetric {
                  const HrZones *, int,
                  const QHash<QString,RideMetric*> &,
                  const Context *) {
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->watts >= max)
-                max = point->watts;
-        }
+        max = qMax(max, statistics(ride).sums().maxWatts);
         setValue(max);
     }
     RideMetric *clone() const { return new MaxPower(*this); }
@@ -678,10 +649,7 @@ class MaxHr : public RideMetric {
                  const HrZones *, int,
                  const QHash<QString,RideMetric*> &,
                  const Context *) {
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->hr >= max)
-                max = point->hr;
-        }
+        max = qMax(max, statistics(ride).sums().maxHr);
         setValue(max);
     }
     RideMetric *clone() const { return new MaxHr(*this); }
@@ -1026,7 +994,7 @@ class MeanPowerVariance : public RideMetric {
                 secs.append(point->secs);
             }
 
-            LTMOutliers outliers(secs.data(), power.data(), power.count(), 30, false);
+            LTMOutliers outliers(secs.data(), power.data(), power.count(), 30, false, 1);
             setValue(outliers.getStdDeviation());
             topRank = outliers.getYForRank(0);
         }
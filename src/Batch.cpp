@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Batch.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "MetricAggregator.h"
+#include "Maintenance.h"
+#include "DataFilter.h"
+#include "RideFile.h"
+#include "RideMetric.h"
+#include "SummaryMetrics.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTime>
+#include <QTextStream>
+
+#include <stdio.h>
+
+bool
+Batch::select(const QString &filter, QStringList &filenames)
+{
+    if (filter.isEmpty()) {
+        filenames = context->athlete->metricDB->allActivityFilenames();
+        return true;
+    }
+
+    DataFilter dataFilter(NULL, context);
+    QStringList errors = dataFilter.parseFilter(filter);
+    if (!errors.isEmpty()) {
+        foreach(QString error, errors)
+            fprintf(stderr, "batch: filter: %s\n", error.toLocal8Bit().constData());
+        return false;
+    }
+    filenames = dataFilter.files();
+    filenames.sort(); // oldest first, as the names are dates
+    return true;
+}
+
+bool
+Batch::writeMetrics(const QStringList &filenames, const QStringList &symbols)
+{
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    foreach(QString symbol, symbols) {
+        if (!factory.haveMetric(symbol)) {
+            fprintf(stderr, "batch: no metric called %s\n", symbol.toLocal8Bit().constData());
+            return false;
+        }
+    }
+
+    // as stored, which is in metric units
+    QTextStream out(stdout);
+    out << "filename";
+    foreach(QString symbol, symbols) out << "," << symbol;
+    out << "\n";
+
+    foreach(QString filename, filenames) {
+        SummaryMetrics metrics = context->athlete->metricDB->getRideMetrics(filename);
+        out << filename;
+        foreach(QString symbol, symbols) out << "," << QString::number(metrics.getForSymbol(symbol), 'g', 10);
+        out << "\n";
+    }
+    out.flush();
+    return true;
+}
+
+bool
+Batch::exportRides(const QStringList &filenames, const QString &dir, const QString &format)
+{
+    RideFileFactory &rff = RideFileFactory::instance();
+    if (!rff.writeSuffixes().contains(format.toLower())) {
+        fprintf(stderr, "batch: can't write %s, only %s\n", format.toLocal8Bit().constData(),
+                rff.writeSuffixes().join(" ").toLocal8Bit().constData());
+        return false;
+    }
+
+    QDir to(dir);
+    if (!to.exists() && !to.mkpath(".")) {
+        fprintf(stderr, "batch: can't create %s\n", dir.toLocal8Bit().constData());
+        return false;
+    }
+
+    bool ok = true;
+    foreach(QString filename, filenames) {
+        QFile file(context->athlete->home.absoluteFilePath(filename));
+        QStringList errors;
+        RideFile *ride = rff.openRideFile(context, file, errors);
+        if (ride == NULL) {
+            fprintf(stderr, "batch: can't open %s\n", filename.toLocal8Bit().constData());
+            ok = false;
+            continue;
+        }
+
+        QFile exported(to.absoluteFilePath(QFileInfo(filename).completeBaseName() + "." + format.toLower()));
+        if (!rff.writeRideFile(context, ride, exported, format)) {
+            fprintf(stderr, "batch: can't write %s\n", exported.fileName().toLocal8Bit().constData());
+            ok = false;
+        }
+        delete ride;
+    }
+    return ok;
+}
+
+int
+Batch::main(const QString &athleteDir, const QStringList &options)
+{
+    QDir home(athleteDir);
+    if (!home.exists()) {
+        fprintf(stderr, "batch: no athlete at %s\n", athleteDir.toLocal8Bit().constData());
+        return 1;
+    }
+
+    // each option takes a value
+    QString filter, exportDir, format("tcx");
+    QStringList symbols;
+    for (int i=0; i<options.count(); i += 2) {
+        if (i+1 >= options.count()) {
+            fprintf(stderr, "batch: %s needs a value\n", options.at(i).toLocal8Bit().constData());
+            return 1;
+        }
+        QString option = options.at(i), value = options.at(i+1);
+        if (option == "--filter") filter = value;
+        else if (option == "--metrics") symbols = value.split(",", QString::SkipEmptyParts);
+        else if (option == "--export") exportDir = value;
+        else if (option == "--format") format = value;
+        else {
+            fprintf(stderr, "batch: unknown option %s\n", option.toLocal8Bit().constData());
+            return 1;
+        }
+    }
+
+    QTime elapsed;
+    elapsed.start();
+
+    // no main window, so nothing is shown and opening it refreshes
+    // the metrics, and the search index with them, before it returns
+    Context *context = new Context(NULL);
+    context->athlete = new Athlete(context, home);
+    fprintf(stderr, "batch: metrics refreshed in %ds\n", elapsed.elapsed() / 1000);
+
+    // and what would otherwise be left until the app is idle
+    MaintenanceScheduler::instance()->runTasks(context);
+    fprintf(stderr, "batch: housekeeping done in %ds\n", elapsed.elapsed() / 1000);
+
+    Batch batch(context);
+    QStringList filenames;
+    bool ok = batch.select(filter, filenames);
+    if (ok && !symbols.isEmpty()) ok = batch.writeMetrics(filenames, symbols);
+    if (ok && !exportDir.isEmpty()) ok = batch.exportRides(filenames, exportDir, format);
+
+    context->athlete->close();
+    delete context->athlete;
+    delete context;
+    return ok ? 0 : 1;
+}
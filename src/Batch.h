@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_Batch_h
+#define _GC_Batch_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QStringList>
+
+class Context;
+
+// Opens an athlete with no windows, brings everything kept alongside the
+// rides up to date and exits, so an archive synced to a server can be
+// warmed overnight and opens straight away wherever it is synced back to:
+//
+//     GoldenCheetah --batch <athlete> [--filter <expression>] [--metrics <symbol,...>]
+//                                     [--export <dir>] [--format <suffix>]
+//
+// Opening the athlete refreshes the metrics and search index on every
+// core, then the .cpx rebuild and the rest of the housekeeping that would
+// wait for the app to be idle are run to completion. After that
+//
+//     --filter   only the rides the DataFilter expression matches, all otherwise
+//     --metrics  writes a csv of those metrics for each ride to stdout
+//     --export   writes each ride into the directory, as --format (default tcx)
+//
+// Dialogs are not shown, errors and progress go to stderr, and it returns
+// non-zero if anything failed. The athlete's widgets are still created, so
+// on a server without a display run it under xvfb-run or similar.
+class Batch
+{
+    public:
+        Batch(Context *context) : context(context) {}
+
+        // the ride files matching a filter, or all of them when it is empty
+        bool select(const QString &filter, QStringList &filenames);
+
+        bool writeMetrics(const QStringList &filenames, const QStringList &symbols);
+        bool exportRides(const QStringList &filenames, const QString &dir, const QString &format);
+
+        // command line entry point, returns the exit code
+        static int main(const QString &athleteDir, const QStringList &options);
+
+    private:
+        Context *context;
+};
+
+#endif // _GC_Batch_h
@@ -21,6 +21,8 @@
 #include "MainWindow.h"
 #include "Context.h"
 #include "Athlete.h"
+#include "MetricAggregator.h"
+#include "TrackSimplifier.h"
 
 BatchExportDialog::BatchExportDialog(Context *context) : QDialog(context->mainWindow), context(context)
 {
@@ -53,11 +55,10 @@ BatchExportDialog::BatchExportDialog(Context *context) : QDialog(context->mainWi
     files->setIndentation(0);
 
     // populate with each ride in the ridelist
-    const QTreeWidgetItem *allRides = context->athlete->allRideItems();
+    for (int i=0; i<context->athlete->rideCount(); i++) {
 
-    for (int i=0; i<allRides->childCount(); i++) {
-
-        RideItem *rideItem = static_cast<RideItem*>(allRides->child(i));
+        QString fileName = context->athlete->rideFileName(i);
+        QDateTime dateTime = context->athlete->rideDateTime(i);
 
         QTreeWidgetItem *add = new QTreeWidgetItem(files->invisibleRootItem());
         add->setFlags(add->flags() | Qt::ItemIsEditable);
@@ -68,9 +69,9 @@ BatchExportDialog::BatchExportDialog(Context *context) : QDialog(context->mainWi
         files->setItemWidget(add, 0, checkBox);
 
         // we will wipe the original file
-        add->setText(1, rideItem->fileName);
-        add->setText(2, rideItem->dateTime.toString(tr("dd MMM yyyy")));
-        add->setText(3, rideItem->dateTime.toString(tr("hh:mm:ss ap")));
+        add->setText(1, fileName);
+        add->setText(2, dateTime.toString(tr("dd MMM yyyy")));
+        add->setText(3, dateTime.toString(tr("hh:mm:ss ap")));
 
         // interval action
         add->setText(4, tr("Export"));
@@ -90,12 +91,25 @@ BatchExportDialog::BatchExportDialog(Context *context) : QDialog(context->mainWi
     all = new QCheckBox(tr("check/uncheck all"), this);
     all->setChecked(true);
 
+    // only the track formats (kml, kmz and gpx) are simplified
+    simplifyLabel = new QLabel(tr("Simplify GPS track"), this);
+    simplify = new QDoubleSpinBox(this);
+    simplify->setRange(0, 100);
+    simplify->setDecimals(1);
+    simplify->setSingleStep(1);
+    simplify->setSuffix(tr(" m"));
+    simplify->setSpecialValueText(tr("Off"));
+    simplify->setToolTip(tr("Drop GPS points within this distance of the simplified track when exporting KML, KMZ or GPX"));
+    simplify->setValue(TrackSimplifier::exportTolerance());
+
     grid->addWidget(formatLabel, 0,0, Qt::AlignLeft);
     grid->addWidget(format, 0,1, Qt::AlignLeft);
     grid->addWidget(dirLabel, 1,0, Qt::AlignLeft);
     grid->addWidget(dirName, 1,1, Qt::AlignLeft);
     grid->addWidget(selectDir, 1,2, Qt::AlignLeft);
-    grid->addWidget(all, 2,0, Qt::AlignLeft);
+    grid->addWidget(simplifyLabel, 2,0, Qt::AlignLeft);
+    grid->addWidget(simplify, 2,1, Qt::AlignLeft);
+    grid->addWidget(all, 3,0, Qt::AlignLeft);
     grid->setColumnStretch(0, 1);
     grid->setColumnStretch(1, 10);
 
@@ -179,34 +193,101 @@ BatchExportDialog::cancelClicked()
     reject();
 }
 
+bool
+BatchExportQueue::takeJob(BatchExportItem &item)
+{
+    QMutexLocker locker(&lock);
+    if (cancelled || todo.isEmpty()) return false;
+    item = todo.takeFirst();
+    return true;
+}
+
+void
+BatchExportQueue::putDone(BatchExportItem &item)
+{
+    QMutexLocker locker(&lock);
+    done << item;
+    notEmpty.wakeOne();
+}
+
+bool
+BatchExportQueue::takeDone(BatchExportItem &item, unsigned long msecs)
+{
+    QMutexLocker locker(&lock);
+    if (done.isEmpty() && msecs) notEmpty.wait(&lock, msecs);
+    if (done.isEmpty()) return false;
+    item = done.takeFirst();
+    return true;
+}
+
+void
+BatchExportQueue::cancel()
+{
+    QMutexLocker locker(&lock);
+    cancelled = true;
+}
+
+bool
+BatchExportQueue::isCancelled()
+{
+    QMutexLocker locker(&lock);
+    return cancelled;
+}
+
+void
+BatchExportWorker::run()
+{
+    BatchExportItem item;
+    while (queue->takeJob(item)) {
+
+        // open it..
+        QStringList errors;
+        QList<RideFile*> rides;
+        QFile thisfile(item.source);
+        RideFile *ride = RideFileFactory::instance().openRideFile(context, thisfile, errors, &rides);
+
+        item.opened = (ride != NULL);
+        item.written = false;
+
+        if (ride) {
+            ride->setWeight(MetricAggregator::weightFor(ride, measures, defaultWeight));
+
+            QFile out(item.target);
+            item.written = RideFileFactory::instance().writeRideFile(context, ride, out, type);
+        }
+
+        // free memory! only the first is exported
+        foreach (RideFile *other, rides) if (other != ride) delete other;
+        delete ride;
+
+        queue->putDone(item);
+    }
+}
+
 void
 BatchExportDialog::exportFiles()
 {
     // what format to export as?
     QString type = RideFileFactory::instance().writeSuffixes().at(format->currentIndex());
 
-    // loop through the table and export all selected
-    for(int i=0; i<files->invisibleRootItem()->childCount(); i++) {
-
-        // give user a chance to abort..
-        QApplication::processEvents();
+    // the track writers pick up the tolerance from the settings
+    appsettings->setValue(GC_EXPORT_SIMPLIFY, simplify->value());
 
-        // did they?
-        if (aborted == true) return; // user aborted!
+    // loop through the table and queue all selected
+    QList<BatchExportItem> todo;
+    for(int i=0; i<files->invisibleRootItem()->childCount(); i++) {
 
         QTreeWidgetItem *current = files->invisibleRootItem()->child(i);
 
         // is it selected
         if (static_cast<QCheckBox*>(files->itemWidget(current,0))->isChecked()) {
 
-            files->setCurrentItem(current); QApplication::processEvents();
-
             QString filename = dirName->text() + "/" + QFileInfo(current->text(1)).baseName() + "." + type;
 
             if (QFile(filename).exists()) {
                 if (overwrite->isChecked() == false) {
                     // skip existing files
-                    current->setText(4, tr("Exists - not exported")); QApplication::processEvents();
+                    current->setText(4, tr("Exists - not exported"));
                     fails++;
                     continue;
 
@@ -214,43 +295,75 @@ BatchExportDialog::exportFiles()
 
                     // remove existing
                     QFile(filename).remove();
-                    current->setText(4, tr("Removing...")); QApplication::processEvents();
                 }
 
             }
             // this one then
-            current->setText(4, tr("Reading...")); QApplication::processEvents();
-
-            // open it..
-            QStringList errors;
-            QList<RideFile*> rides;
-            QFile thisfile(QString(context->athlete->home.absolutePath()+"/"+current->text(1)));
-            RideFile *ride = RideFileFactory::instance().openRideFile(context, thisfile, errors, &rides);
-
-            // open success?
-            if (ride) {
-
-
-                current->setText(4, tr("Writing...")); QApplication::processEvents();
-                QFile out(filename);
-                bool success = RideFileFactory::instance().writeRideFile(context, ride, out, type);
-
-                if (success) {
-                    exports++;
-                    current->setText(4, tr("Exported")); QApplication::processEvents();
-                } else {
-                    fails++;
-                    current->setText(4, tr("Write failed")); QApplication::processEvents();
-                }
+            current->setText(4, tr("Queued..."));
+
+            BatchExportItem add;
+            add.row = i;
+            add.source = context->athlete->home.absolutePath()+"/"+current->text(1);
+            add.target = filename;
+            add.opened = add.written = false;
+            todo << add;
+        }
+    }
+    if (todo.isEmpty()) return;
+
+    // rides are opened and written by a pool of workers, they
+    // need the weight measures from the database which can
+    // only be read from this thread
+    QList<SummaryMetrics> measures = context->athlete->metricDB->getAllMeasuresFor(QDateTime::fromString("Jan 1 00:00:00 1900"), QDateTime::currentDateTime());
+    double defaultWeight = appsettings->cvalue(context->athlete->cyclist, GC_WEIGHT, "75.0").toString().toDouble();
+
+    int threads = QThread::idealThreadCount();
+    if (threads < 1) threads = 1;
+    if (threads > todo.count()) threads = todo.count();
+
+    int remaining = todo.count();
+    BatchExportQueue queue(todo);
+    QList<BatchExportWorker*> workers;
+    for (int t=0; t<threads; t++) {
+        BatchExportWorker *worker = new BatchExportWorker(context, &queue, type, measures, defaultWeight);
+        workers << worker;
+        worker->start();
+    }
 
-                delete ride; // free memory!
+    // update the status as each ride completes
+    while (remaining) {
 
-            // open failed
-            } else {
+        // give user a chance to abort..
+        QApplication::processEvents();
 
-                current->setText(4, tr("Read error")); QApplication::processEvents();
+        // did they? the rides being written are finished off
+        if (aborted == true && !queue.isCancelled()) queue.cancel();
 
-            }
+        BatchExportItem item;
+        if (!queue.takeDone(item, 100)) {
+            bool running = false;
+            foreach (BatchExportWorker *worker, workers) if (worker->isRunning()) running = true;
+            if (!running && !queue.takeDone(item, 0)) break; // cancelled and drained
+            continue;
         }
+        remaining--;
+
+        QTreeWidgetItem *current = files->invisibleRootItem()->child(item.row);
+        files->setCurrentItem(current);
+
+        if (!item.opened) {
+            current->setText(4, tr("Read error"));
+        } else if (item.written) {
+            exports++;
+            current->setText(4, tr("Exported"));
+        } else {
+            fails++;
+            current->setText(4, tr("Write failed"));
+        }
+    }
+
+    foreach (BatchExportWorker *worker, workers) {
+        worker->wait();
+        delete worker;
     }
 }
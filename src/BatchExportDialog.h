@@ -26,6 +26,7 @@
 
 #include "RideItem.h"
 #include "RideFile.h"
+#include "SummaryMetrics.h"
 
 #include <QtGui>
 #include <QTableWidget>
@@ -35,6 +36,51 @@
 #include <QListIterator>
 #include <QDebug>
 
+// one ride to export, the workers open and write them one
+// at a time so only a ride per worker is ever in memory
+struct BatchExportItem {
+    int row;                // in the files tree
+    QString source, target;
+    bool opened, written;
+};
+
+class BatchExportQueue
+{
+    public:
+        BatchExportQueue(QList<BatchExportItem> todo) : todo(todo), cancelled(false) {}
+
+        bool takeJob(BatchExportItem &item);                  // false when no more work
+        void putDone(BatchExportItem &item);
+        bool takeDone(BatchExportItem &item, unsigned long);  // false on timeout
+        void cancel();
+        bool isCancelled();
+
+    private:
+        QMutex lock;
+        QWaitCondition notEmpty;
+        QList<BatchExportItem> todo, done;
+        bool cancelled;
+};
+
+// the export worker ... runs in a thread
+class BatchExportWorker : public QThread
+{
+    public:
+        BatchExportWorker(Context *context, BatchExportQueue *queue, QString type,
+                          QList<SummaryMetrics> measures, double defaultWeight)
+        : context(context), queue(queue), type(type), measures(measures), defaultWeight(defaultWeight) {}
+        void run();
+
+    private:
+        Context *context;
+        BatchExportQueue *queue;
+        QString type;
+
+        // writers may compute metrics, which need the weight
+        QList<SummaryMetrics> measures;
+        double defaultWeight;
+};
+
 // Dialog class to show filenames, import progress and to capture user input
 // of ride date and time
 
@@ -70,6 +116,9 @@ private:
     QPushButton *selectDir;
     QLabel *dirLabel, *dirName;
 
+    QLabel *simplifyLabel;
+    QDoubleSpinBox *simplify; // gps track tolerance in metres, 0 is off
+
     QCheckBox *overwrite;
     QPushButton *cancel, *ok;
 
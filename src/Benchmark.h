@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_Benchmark_h
+#define _GC_Benchmark_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QMap>
+#include <QDir>
+#include <QStringList>
+
+class Context;
+
+// Times the pieces of ride processing over a directory of ride files, by
+// default test/rides, so changes to readers and metrics can be measured.
+// Run with:
+//
+//     GoldenCheetah --benchmark <athlete> [<ride dir>] [<output .csv or .json>]
+//
+// the athlete provides the zones and settings the metrics use. For each
+// reader, derived series calculation, mean-max series, metric and data
+// processor it reports the number of calls and the time taken, and the
+// number of allocations made when built with DEFINES += GC_BENCHMARK_ALLOCS.
+// No windows are shown and GoldenCheetah exits when it is done.
+//
+// To see how things scale with the size of the archive there is also
+//
+//     GoldenCheetah --generate <athlete> [rides=1000] [duration=3600] [recint=1]
+//                                        [gps=1] [measures=365] [seed=1]
+//     GoldenCheetah --scenarios <athlete> [<output .csv or .json>]
+//
+// the first writes a synthetic athlete, the same one for the same options,
+// and the second times what users wait for over the whole archive: opening
+// the athlete, refreshing the metrics after a zone change, switching seasons
+// in the CP chart, loading the LTM data, typing a filter and browsing rides.
+// The first open is only from cold the first time after generating.
+//
+// And for the charts
+//
+//     GoldenCheetah --render <athlete> [<output .csv or .json>]
+//
+// opens each of the ride, CP, histogram, scatter, PfPv and LTM charts
+// off-screen on the most recent ride, or the year up to it, and times
+// the recompute separately from painting each plot with QwtPlotRenderer.
+class Benchmark
+{
+    public:
+        Benchmark(Context *context) : context(context) {}
+
+        // what to generate
+        struct Archive {
+            Archive() : rides(1000), duration(3600), recIntSecs(1), gps(true), measures(365), seed(1) {}
+            int rides;
+            int duration;       // secs, rides vary by a third either way
+            double recIntSecs;
+            bool gps;
+            int measures;       // daily withings measures, up to the last ride
+            uint seed;
+        };
+        static bool generate(const QString &athleteDir, const Archive &archive);
+
+        // run over all the ride files in a directory
+        void run(const QString &rideDir);
+
+        // write the results as csv, or json if the filename ends .json
+        // and to stdout if it is empty
+        bool write(const QString &fileName) const;
+
+        // command line entry point, returns the exit code
+        static int main(const QString &athleteDir, const QString &rideDir, const QString &output);
+        static int generateMain(const QString &athleteDir, const QStringList &options);
+        static int scenariosMain(const QString &athleteDir, const QString &output);
+        static int renderMain(const QString &athleteDir, const QString &output);
+
+    private:
+        Context *context;
+
+        struct Timing {
+            Timing() : calls(0), nsecs(0), allocs(0) {}
+            int calls;
+            qint64 nsecs;
+            qint64 allocs;
+        };
+        QMap<QString, Timing> timings; // keyed by component/name
+
+        void add(const QString &component, const QString &name, qint64 nsecs, qint64 allocs);
+        void runScenarios(const QDir &home);
+        void runRenders();
+        void paint(const QString &chart, QWidget *widget); // every plot it shows
+};
+
+#endif // _GC_Benchmark_h
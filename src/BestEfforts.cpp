@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "BestEfforts.h"
+#include "RideFile.h"
+
+#include <QMap>
+#include <algorithm>
+
+// heap order, best avg on top and earliest start for a tie
+struct WorseEffort {
+    bool operator()(const BestEfforts::Effort &a, const BestEfforts::Effort &b) const {
+        if (a.avg != b.avg) return a.avg < b.avg;
+        return a.start > b.start;
+    }
+};
+
+static QList<BestEfforts::Effort>
+findEfforts(const QVector<double> &secs, const QVector<double> &sum, double secsDelta,
+            double window, int count)
+{
+    QList<BestEfforts::Effort> results;
+    int n = secs.count();
+
+    // ride is shorter than the window size!
+    if (n == 0 || count < 1 || window > secs[n-1] + secsDelta) return results;
+
+    // every window, one per sample it ends at
+    QVector<BestEfforts::Effort> heap;
+    heap.reserve(n);
+    int i = 0;
+    for (int j=0; j<n; j++) {
+
+        // discard samples until the duration is < window + secsDelta
+        while (i < j && (secs[j] - secs[i] + secsDelta) >= window + secsDelta) i++;
+
+        double duration = secs[j] - secs[i] + secsDelta;
+        if (duration >= window) {
+            BestEfforts::Effort add;
+            add.start = secs[i];
+            add.stop = secs[i] + duration;
+            add.avg = (sum[j+1] - sum[i]) * secsDelta / duration;
+            add.first = i;
+            add.last = j;
+            heap << add;
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), WorseEffort());
+
+    // accepted efforts don't overlap, so ordered by start their
+    // stops are in order too and only the neighbours need checking
+    QMap<double, double> accepted; // start -> stop
+    WorseEffort worse;
+    while (!heap.isEmpty() && results.count() < count) {
+
+        std::pop_heap(heap.begin(), heap.end(), worse);
+        BestEfforts::Effort candidate = heap.last();
+        heap.pop_back();
+
+        QMap<double, double>::const_iterator next = accepted.lowerBound(candidate.start);
+        if (next != accepted.constEnd() && next.key() < candidate.stop) continue;
+        if (next != accepted.constBegin() && (next-1).value() > candidate.start) continue;
+
+        accepted.insert(candidate.start, candidate.stop);
+        results << candidate;
+    }
+    return results;
+}
+
+// the sample times and a prefix sum of watts, sum[j+1] - sum[i] is the total over i..j
+static void
+prepare(const RideFile *ride, QVector<double> &secs, QVector<double> &sum)
+{
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+    int n = points.count();
+    secs.resize(n);
+    sum.resize(n+1);
+    sum[0] = 0;
+    for (int i=0; i<n; i++) {
+        secs[i] = points[i]->secs;
+        sum[i+1] = sum[i] + points[i]->watts;
+    }
+}
+
+QList<BestEfforts::Effort>
+BestEfforts::find(const RideFile *ride, double secs, int count)
+{
+    QVector<double> times, sum;
+    prepare(ride, times, sum);
+    return findEfforts(times, sum, ride->recIntSecs(), secs, count);
+}
+
+QVector<QList<BestEfforts::Effort> >
+BestEfforts::find(const RideFile *ride, const QVector<double> &secs, int count)
+{
+    QVector<double> times, sum;
+    prepare(ride, times, sum);
+
+    QVector<QList<Effort> > results(secs.count());
+    for (int i=0; i<secs.count(); i++)
+        results[i] = findEfforts(times, sum, ride->recIntSecs(), secs[i], count);
+    return results;
+}
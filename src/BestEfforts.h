@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_BestEfforts_h
+#define _GC_BestEfforts_h 1
+#include "GoldenCheetah.h"
+
+#include <QList>
+#include <QVector>
+
+class RideFile;
+
+// The best non-overlapping power efforts of a duration in a ride, as
+// found by the interval dialogs. Every window of the duration is a
+// candidate, they are taken best first from a heap and an effort is
+// accepted unless it overlaps one already accepted, which is checked
+// against the accepted efforts ordered by start time. So asking for the
+// top few efforts doesn't sort or scan every candidate.
+//
+// A window ending at a sample starts at the earliest sample that keeps
+// its duration in [secs, secs + recIntSecs), the same as findBests() has
+// always done, and efforts of equal power are taken earliest first.
+class BestEfforts
+{
+    public:
+        struct Effort {
+            double start, stop, avg; // stop is start + duration
+            int first, last;         // sample indexes
+            Effort() : start(0), stop(0), avg(0), first(0), last(0) {}
+        };
+
+        // up to count efforts, best first
+        static QList<Effort> find(const RideFile *ride, double secs, int count);
+
+        // the same for several durations at once
+        static QVector<QList<Effort> > find(const RideFile *ride, const QVector<double> &secs, int count);
+};
+
+#endif // _GC_BestEfforts_h
@@ -21,6 +21,8 @@
 #include "Context.h"
 #include "IntervalItem.h"
 #include "RideFile.h"
+#include "RideFileCache.h"
+#include "BestEfforts.h"
 #include <QMap>
 #include <math.h>
 
@@ -112,35 +114,6 @@ clearResultsTable(QTableWidget *resultsTable)
     }
 }
 
-static double
-intervalDuration(const RideFilePoint *start, const RideFilePoint *stop, const RideFile *ride)
-{
-    return stop->secs - start->secs + ride->recIntSecs();
-}
-
-static bool
-intervalsOverlap(const BestIntervalDialog::BestInterval &a,
-                 const BestIntervalDialog::BestInterval &b)
-{
-    if ((a.start <= b.start) && (a.stop > b.start))
-        return true;
-    if ((b.start <= a.start) && (b.stop > a.start))
-        return true;
-    return false;
-}
-
-struct CompareBests {
-    // Sort by decreasing power and increasing start time.
-    bool operator()(const BestIntervalDialog::BestInterval &a,
-                    const BestIntervalDialog::BestInterval &b) const {
-        if (a.avg > b.avg)
-            return true;
-        if (b.avg > a.avg)
-            return false;
-        return a.start < b.start;
-    }
-};
-
 void
 BestIntervalDialog::findClicked()
 {
@@ -161,8 +134,15 @@ BestIntervalDialog::findClicked()
         return;
     }
 
+    // a single best of whole seconds is in the ride's .cpx
     QList<BestInterval> results;
-    findBests(ride, windowSizeSecs, maxIntervals, results);
+    double start, avg;
+    if (maxIntervals == 1 && windowSizeSecs == floor(windowSizeSecs) &&
+        RideFileCache::bestEffort(context->rideItem(), windowSizeSecs, start, avg)) {
+        results << BestInterval(start, start + windowSizeSecs, avg);
+    } else {
+        findBests(ride, windowSizeSecs, maxIntervals, results);
+    }
 
     // clear the table
     clearResultsTable(resultsTable);
@@ -251,49 +231,8 @@ void
 BestIntervalDialog::findBests(const RideFile *ride, double windowSizeSecs,
                               int maxIntervals, QList<BestInterval> &results)
 {
-    QList<BestInterval> bests;
-
-    double secsDelta = ride->recIntSecs();
-    double totalWatts = 0.0;
-    QList<const RideFilePoint*> window;
-
-    // ride is shorter than the window size!
-    if (windowSizeSecs > ride->dataPoints().last()->secs + secsDelta) return;
-
-    // We're looking for intervals with durations in [windowSizeSecs, windowSizeSecs + secsDelta).
-    foreach (const RideFilePoint *point, ride->dataPoints()) {
-        // Discard points until interval duration is < windowSizeSecs + secsDelta.
-        while (!window.empty() && (intervalDuration(window.first(), point, ride) >= windowSizeSecs + secsDelta)) {
-            totalWatts -= window.first()->watts;
-            window.takeFirst();
-        }
-        // Add points until interval duration is >= windowSizeSecs.
-        totalWatts += point->watts;
-        window.append(point);
-        double duration = intervalDuration(window.first(), window.last(), ride);
-        if (duration >= windowSizeSecs) {
-            double start = window.first()->secs;
-            double stop = start + duration;
-            double avg = totalWatts * secsDelta / duration;
-            bests.append(BestInterval(start, stop, avg));
-        }
-    }
-
-    std::sort(bests.begin(), bests.end(), CompareBests());
-
-    while (!bests.empty() && (results.size() < maxIntervals)) {
-        BestInterval candidate = bests.takeFirst();
-        bool overlaps = false;
-        foreach (const BestInterval &existing, results) {
-            if (intervalsOverlap(candidate, existing)) {
-                overlaps = true;
-                break;
-            }
-        }
-        if (!overlaps)
-            results.append(candidate);
-    }
-
+    foreach (const BestEfforts::Effort &effort, BestEfforts::find(ride, windowSizeSecs, maxIntervals))
+        results.append(BestInterval(effort.start, effort.stop, effort.avg));
 }
 
 void
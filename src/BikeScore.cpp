@@ -17,6 +17,7 @@
  */
 
 #include "RideMetric.h"
+#include "RideStatistics.h"
 #include "Zones.h"
 #include <math.h>
 #include <QApplication>
@@ -56,36 +57,15 @@ class XPower : public RideMetric {
                  const QHash<QString,RideMetric*> &,
                  const Context *) {
 
-        static const double EPSILON = 0.1;
-        static const double NEGLIGIBLE = 0.1;
-
-        double secsDelta = ride->recIntSecs();
-        double sampsPerWindow = 25.0 / secsDelta;
-        double attenuation = sampsPerWindow / (sampsPerWindow + secsDelta);
-        double sampleWeight = secsDelta / (sampsPerWindow + secsDelta);
-
-        double lastSecs = 0.0;
-        double weighted = 0.0;
-
         double total = 0.0;
         int count = 0;
 
-        foreach(const RideFilePoint *point, ride->dataPoints()) {
-            while ((weighted > NEGLIGIBLE)
-                   && (point->secs > lastSecs + secsDelta + EPSILON)) {
-                weighted *= attenuation;
-                lastSecs += secsDelta;
-                total += pow(weighted, 4.0);
-                count++;
-            }
-            weighted *= attenuation;
-            weighted += sampleWeight * point->watts;
-            lastSecs = point->secs;
+        foreach(double weighted, statistics(ride).weighted25s()) {
             total += pow(weighted, 4.0);
             count++;
         }
         xpower = pow(total / count, 0.25);
-        secs = count * secsDelta;
+        secs = count * ride->recIntSecs();
 
         setValue(xpower);
         setCount(secs);
@@ -141,6 +121,7 @@ class RelativeIntensity : public RideMetric {
     RelativeIntensity() : reli(0.0), secs(0.0)
     {
         setSymbol("skiba_relative_intensity");
+        setDependsOn(RideMetric::PowerZone | RideMetric::Metadata); // CP may be in a tag
         setInternalName("Relative Intensity");
     }
     void initialize() {
@@ -190,6 +171,7 @@ class BikeScore : public RideMetric {
     BikeScore() : score(0.0)
     {
         setSymbol("skiba_bike_score");
+        setDependsOn(RideMetric::PowerZone | RideMetric::Metadata); // CP may be in a tag
         setInternalName("BikeScore&#8482;");
     }
     void initialize() {
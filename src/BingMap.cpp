@@ -21,6 +21,7 @@
 #include "RideItem.h"
 #include "RideFile.h"
 #include "IntervalItem.h"
+#include "IntervalOverlay.h"
 #include "Context.h"
 #include "Athlete.h"
 #include "Zones.h"
@@ -86,6 +87,7 @@ void BingMap::loadRide()
 
 void BingMap::updateFrame()
 {
+    webBridge->reset();
     view->page()->mainFrame()->addToJavaScriptWindowObject("webBridge", webBridge);
 }
 
@@ -171,18 +173,17 @@ void BingMap::createHtml()
     "        zIndex: -1\n"
     "    };\n"
 
-    // remove previous intervals highlighted
-    "    j= intervalList.length;\n"
-    "    while (j) {\n"
-    "       var highlighted = intervalList.pop();\n"
-    "       highlighted.setOptions( { visible: false });\n"
-    "       j--;\n"
-    "    }\n"
-
-    // how many to draw?
-    "    var intervals = webBridge.intervalCount();\n"
-    "    while (intervals > 0) {\n"
-    "        var latlons = webBridge.getLatLons(intervals);\n"
+    // only those that changed since last time, the list
+    // is indexed by interval number, removals come first
+    "    var changes = webBridge.changedIntervals();\n"
+    "    for (var k=0; k<changes.length; k += 2) {\n"
+    "        var n = changes[k];\n"
+    "        if (intervalList[n]) {\n"
+    "            map.entities.remove(intervalList[n]);\n"
+    "            intervalList[n] = null;\n"
+    "        }\n"
+    "        if (!changes[k+1]) continue;\n"
+    "        var latlons = webBridge.intervalLatLons(n);\n"
 
             // create the route path
     "        var route = new Array();\n"
@@ -195,9 +196,7 @@ void BingMap::createHtml()
              // create the route Polyline
     "        var intervalHighlighter = new Microsoft.Maps.Polyline(route, polyOptions);\n"
     "        map.entities.push(intervalHighlighter);\n"
-    "        intervalList.push(intervalHighlighter);\n"
-
-    "        intervals--;\n"
+    "        intervalList[n] = intervalHighlighter;\n"
     "    }\n"
     "}\n"
 
@@ -269,14 +268,24 @@ BingMap::drawShadedRoute()
     double prevtime=0; // time for previous point
 
     QString code;
+    QStringList latlons; // packed into an array for each segment
 
-    foreach(RideFilePoint *rfp, myRideItem->ride()->dataPoints()) {
+    route.set(myRideItem->ride());
+    const QVector<RideFilePoint*> &points = myRideItem->ride()->dataPoints();
+
+    for (int i=0; i<points.count(); i++) {
+        RideFilePoint *rfp = points[i];
 
         if (count == 0) {
             code = QString("{\nvar route = new Array();\n");
-        } else {
-            if (rfp->lat || rfp->lon)
-                code += QString("route.push(new Microsoft.Maps.Location(%1,%2));\n").arg(rfp->lat,0,'g',GPS_COORD_TO_STRING).arg(rfp->lon,0,'g',GPS_COORD_TO_STRING);
+            latlons.clear();
+        }
+
+        // the simplified route, but segments always start and end on
+        // a sample so they join up
+        if (rfp->lat || rfp->lon) {
+            if (count == 0 || route.keep(i) || rtime + rfp->secs - prevtime >= intervalTime)
+                latlons << QString("%1,%2").arg(rfp->lat,0,'g',GPS_COORD_TO_STRING).arg(rfp->lon,0,'g',GPS_COORD_TO_STRING);
         }
 
         // running total of time
@@ -294,6 +303,10 @@ BingMap::drawShadedRoute()
             // add tooltip junk
             count = rwatts = rtime = 0;
 
+            // add the points
+            code += QString("var latlons = [%1];\n"
+                            "for (var j=0; j<latlons.length; j+=2) route.push(new Microsoft.Maps.Location(latlons[j],latlons[j+1]));\n").arg(latlons.join(","));
+
             // color the polyline
             code += QString("    var polyOptions = {\n"
                             "        strokeColor: new Microsoft.Maps.Color(200, %1, %2, %3),\n"
@@ -504,22 +517,13 @@ void BWebBridge::call(int count) { qDebug()<<"webBridge call:"<<count; }
 int
 BWebBridge::intervalCount()
 {
-    int highlighted;
-    highlighted = 0;
     RideItem *rideItem = gm->property("ride").value<RideItem*>();
 
     if (context->athlete->allIntervalItems() == NULL ||
         rideItem == NULL || rideItem->ride() == NULL) return 0; // not inited yet!
 
-    for (int i=0; i<context->athlete->allIntervalItems()->childCount(); i++) {
-        IntervalItem *current = dynamic_cast<IntervalItem *>(context->athlete->allIntervalItems()->child(i));
-        if (current != NULL) {
-            if (current->isSelected() == true) {
-                ++highlighted;
-            }
-        }
-    }
-    return highlighted;
+    context->athlete->intervalOverlay->refresh();
+    return context->athlete->intervalOverlay->selected().count();
 }
 
 // get a latlon array for the i'th selected interval
@@ -527,54 +531,84 @@ QVariantList
 BWebBridge::getLatLons(int i)
 {
     QVariantList latlons;
-    int highlighted=0;
     RideItem *rideItem = gm->property("ride").value<RideItem*>();
 
     if (context->athlete->allIntervalItems() == NULL ||
        rideItem ==NULL || rideItem->ride() == NULL) return latlons; // not inited yet!
 
+    // simplified once per ride
+    gm->route.set(rideItem->ride());
+
     if (i) {
 
         // get for specific interval
-        for (int j=0; j<context->athlete->allIntervalItems()->childCount(); j++) {
-            IntervalItem *current = dynamic_cast<IntervalItem *>(context->athlete->allIntervalItems()->child(j));
-            if (current != NULL) {
-                if (current->isSelected() == true) {
-                    ++highlighted;
-
-                    // this one!
-                    if (highlighted==i) {
-
-                        // so this one is the interval we need.. lets
-                        // snaffle up the points in this section
-                        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-                            if (p1->secs+rideItem->ride()->recIntSecs() > current->start
-                                && p1->secs< current->stop) {
-
-                                if (p1->lat || p1->lon) {
-                                    latlons << p1->lat;
-                                    latlons << p1->lon;
-                                }
-                            }
-                        }
-                        return latlons;
-                    }
-                }
-            }
+        IntervalOverlay *overlay = context->athlete->intervalOverlay;
+        overlay->refresh();
+        if (i <= overlay->selected().count()) {
+            const IntervalOverlay::Interval &current = overlay->at(overlay->selected()[i-1]);
+            latlons = gm->route.latlons(current.start, current.stop);
         }
     } else {
 
         // get latlons for entire route
-        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-            if (p1->lat || p1->lon) {
-                latlons << p1->lat;
-                latlons << p1->lon;
-            }
-        }
+        latlons = gm->route.latlons();
     }
     return latlons;
 }
 
+// compare the selection with what has been drawn, when the intervals
+// themselves have changed everything drawn goes and we start again
+QVariantList
+BWebBridge::changedIntervals()
+{
+    QVariantList changes;
+    RideItem *rideItem = gm->property("ride").value<RideItem*>();
+
+    if (context->athlete->allIntervalItems() == NULL ||
+       rideItem ==NULL || rideItem->ride() == NULL) return changes; // not inited yet!
+
+    IntervalOverlay *overlay = context->athlete->intervalOverlay;
+    overlay->refresh();
+
+    if (overlay->generation() != drawnGeneration) {
+        for (int i=0; i<drawn.count(); i++) if (drawn[i]) changes << i << false;
+        drawn.fill(false, overlay->count());
+        intervalPoints.clear();
+        drawnGeneration = overlay->generation();
+    }
+
+    for (int i=0; i<overlay->count(); i++) {
+        if (drawn[i] && !overlay->at(i).selected) {
+            changes << i << false;
+            drawn[i] = false;
+        }
+    }
+    for (int i=0; i<overlay->count(); i++) {
+        if (!drawn[i] && overlay->at(i).selected) {
+            changes << i << true;
+            drawn[i] = true;
+        }
+    }
+    return changes;
+}
+
+// the points for an interval, kept until the intervals change
+QVariantList
+BWebBridge::intervalLatLons(int index)
+{
+    RideItem *rideItem = gm->property("ride").value<RideItem*>();
+    IntervalOverlay *overlay = context->athlete->intervalOverlay;
+
+    if (rideItem == NULL || rideItem->ride() == NULL || index < 0 || index >= overlay->count())
+        return QVariantList();
+
+    if (!intervalPoints.contains(index)) {
+        gm->route.set(rideItem->ride());
+        intervalPoints.insert(index, gm->route.latlons(overlay->at(index).start, overlay->at(index).stop));
+    }
+    return intervalPoints.value(index);
+}
+
 // once the basic map and route have been marked, overlay markers, shaded areas etc
 void
 BWebBridge::drawOverlays()
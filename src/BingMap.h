@@ -28,6 +28,7 @@
 #include <string>
 #include "RideFile.h"
 #include "Context.h"
+#include "SimplifiedRoute.h"
 
 class QMouseEvent;
 class RideItem;
@@ -45,8 +46,17 @@ class BWebBridge : public QObject
         Context *context;
         BingMap *gm;
 
+        // what the page has drawn, the intervals are numbered as
+        // the overlay numbered them when they were drawn
+        QVector<bool> drawn;
+        int drawnGeneration;
+        QHash<int, QVariantList> intervalPoints;
+
     public:
-        BWebBridge(Context *context, BingMap *gm) : context(context), gm(gm) {}
+        BWebBridge(Context *context, BingMap *gm) : context(context), gm(gm), drawnGeneration(-1) {}
+
+        // the page has been loaded again so nothing is drawn
+        void reset() { drawn.clear(); intervalPoints.clear(); drawnGeneration = -1; }
 
     public slots:
         Q_INVOKABLE void call(int count);
@@ -55,6 +65,11 @@ class BWebBridge : public QObject
         Q_INVOKABLE int intervalCount();
         Q_INVOKABLE QVariantList getLatLons(int i); // get array of latitudes for highlighted n
 
+        // the intervals to remove or draw since we last asked, as pairs of
+        // interval number and whether it is selected, removals first
+        Q_INVOKABLE QVariantList changedIntervals();
+        Q_INVOKABLE QVariantList intervalLatLons(int index);
+
         // once map and basic route is loaded
         // this slot is called to draw additional
         // overlays e.g. shaded route, markers
@@ -77,6 +92,7 @@ class BingMap : public GcWindow
         BingMap(Context *);
         virtual ~BingMap() {}
         bool first;
+        SimplifiedRoute route; // used by the webbridge too
 
     public slots:
         void rideSelected();
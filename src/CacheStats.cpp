@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "CacheStats.h"
+#include "Settings.h"
+
+#include <QStringList>
+
+// the stats are all static so there's no knowing what order they are
+// constructed in, the list is made when the first one is registered
+static QMutex registryLock;
+static QList<CacheStats*> &registry()
+{
+    static QList<CacheStats*> list;
+    return list;
+}
+
+CacheStats::CacheStats(const char *name, const char *setting, int megabytes) :
+    name_(name), setting(setting), defaultMB(megabytes), budgetMB_(-1), hits(0), misses(0)
+{
+    QMutexLocker locker(&registryLock);
+    registry().append(this);
+}
+
+CacheStats::~CacheStats()
+{
+    QMutexLocker locker(&registryLock);
+    registry().removeAll(this);
+}
+
+QList<CacheStats*>
+CacheStats::all()
+{
+    QMutexLocker locker(&registryLock);
+    return registry();
+}
+
+void
+CacheStats::setUsage(const void *owner, qint64 bytes, int entries)
+{
+    QMutexLocker locker(&lock);
+    usage.insert(owner, QPair<qint64, int>(bytes, entries));
+}
+
+void
+CacheStats::forget(const void *owner)
+{
+    QMutexLocker locker(&lock);
+    usage.remove(owner);
+}
+
+qint64
+CacheStats::bytes() const
+{
+    QMutexLocker locker(&lock);
+    qint64 total = 0;
+    QHashIterator<const void*, QPair<qint64, int> > i(usage);
+    while (i.hasNext()) total += i.next().value().first;
+    return total;
+}
+
+int
+CacheStats::entries() const
+{
+    QMutexLocker locker(&lock);
+    int total = 0;
+    QHashIterator<const void*, QPair<qint64, int> > i(usage);
+    while (i.hasNext()) total += i.next().value().second;
+    return total;
+}
+
+// the settings aren't there when the statics are constructed,
+// so the budget is read the first time it is asked for
+int
+CacheStats::budgetMB()
+{
+    QMutexLocker locker(&lock);
+    if (budgetMB_ < 0) budgetMB_ = qMax(1, appsettings->value(NULL, setting, defaultMB).toInt());
+    return budgetMB_;
+}
+
+qint64
+CacheStats::budget()
+{
+    return qint64(budgetMB()) * 1024 * 1024;
+}
+
+void
+CacheStats::setBudgetMB(int megabytes)
+{
+    megabytes = qMax(1, megabytes);
+    appsettings->setValue(setting, megabytes);
+
+    QMutexLocker locker(&lock);
+    budgetMB_ = megabytes;
+}
+
+QString
+CacheStats::report()
+{
+    QString returning = "cache,entries,bytes,budget,hits,misses\n";
+    foreach(CacheStats *stats, all()) {
+        QString name = stats->name();
+        returning += QString("\"%1\",%2,%3,%4,%5,%6\n").arg(name.replace("\"", "\"\""))
+                                                      .arg(stats->entries())
+                                                      .arg(stats->bytes())
+                                                      .arg(stats->budget())
+                                                      .arg(stats->hitCount())
+                                                      .arg(stats->missCount());
+    }
+    return returning;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef _GC_CacheStats_h
+#define _GC_CacheStats_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+
+// Counters for one of the in memory caches, so the Memory and Caches
+// dialog can show how much each is holding and how often it is any
+// use. They are declared static alongside the cache they count and
+// register themselves, only ever being touched by the cache itself:
+//
+//    static CacheStats intervalStats("Interval mean max", GC_INTERVALCACHE_MB, 16);
+//
+//    if (found) intervalStats.hit(); else intervalStats.miss();
+//    intervalStats.setUsage(&intervalCache, intervalCache.totalCost(), intervalCache.count());
+//
+// The usage is by owner since some caches belong to each chart, they
+// are added up and an owner must forget() its usage as it goes.
+//
+// The budget is in megabytes and kept in the setting given, the cache
+// reads budget() whenever it adds something and trims itself to fit.
+class CacheStats
+{
+    public:
+        CacheStats(const char *name, const char *setting, int megabytes);
+        ~CacheStats();
+
+        void hit() { hits.ref(); }
+        void miss() { misses.ref(); }
+        void resetCounters() { hits = 0; misses = 0; }
+
+        void setUsage(const void *owner, qint64 bytes, int entries);
+        void forget(const void *owner);
+
+        QString name() const { return name_; }
+        int hitCount() const { return hits; }
+        int missCount() const { return misses; }
+        qint64 bytes() const;
+        int entries() const;
+
+        qint64 budget(); // bytes
+        int budgetMB();
+        void setBudgetMB(int megabytes);
+
+        static QList<CacheStats*> all();
+        static QString report(); // csv, a line per cache
+
+    private:
+        const char *name_, *setting;
+        int defaultMB, budgetMB_; // -1 until read from the settings
+
+        QAtomicInt hits, misses;
+
+        mutable QMutex lock;
+        QHash<const void*, QPair<qint64, int> > usage; // bytes and entries
+};
+
+#endif // _GC_CacheStats_h
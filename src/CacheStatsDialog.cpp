@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "CacheStatsDialog.h"
+#include "CacheStats.h"
+
+CacheStatsDialog::CacheStatsDialog(QWidget *parent) : QDialog(parent, Qt::Dialog)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(tr("Memory and Caches"));
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    table = new QTreeWidget(this);
+    table->setRootIsDecorated(false);
+    table->setColumnCount(7);
+    table->setHeaderLabels(QStringList() << tr("Cache") << tr("Entries") << tr("Memory (MB)")
+                                         << tr("Budget (MB)") << tr("Hits") << tr("Misses") << tr("Hit Rate"));
+    layout->addWidget(table);
+
+    caches = CacheStats::all();
+    foreach(CacheStats *stats, caches) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(table);
+        item->setText(0, stats->name());
+        for (int i=1; i<7; i++) item->setTextAlignment(i, Qt::AlignRight);
+
+        QSpinBox *budget = new QSpinBox(this);
+        budget->setRange(1, 64 * 1024);
+        budget->setValue(stats->budgetMB());
+        budget->setKeyboardTracking(false);
+        connect(budget, SIGNAL(valueChanged(int)), this, SLOT(budgetChanged(int)));
+        table->setItemWidget(item, 3, budget);
+        budgets << budget;
+    }
+
+    QHBoxLayout *buttons = new QHBoxLayout;
+    QPushButton *reset = new QPushButton(tr("Reset Counters"), this);
+    QPushButton *exportButton = new QPushButton(tr("Export..."), this);
+    QPushButton *close = new QPushButton(tr("Close"), this);
+    buttons->addWidget(reset);
+    buttons->addStretch();
+    buttons->addWidget(exportButton);
+    buttons->addWidget(close);
+    layout->addLayout(buttons);
+
+    connect(reset, SIGNAL(clicked()), this, SLOT(resetCounters()));
+    connect(exportButton, SIGNAL(clicked()), this, SLOT(exportStats()));
+    connect(close, SIGNAL(clicked()), this, SLOT(accept()));
+
+    // keep up with the caches whilst it is open
+    timer = new QTimer(this);
+    connect(timer, SIGNAL(timeout()), this, SLOT(refresh()));
+    timer->start(1000);
+
+    refresh();
+    for (int i=0; i<7; i++) table->resizeColumnToContents(i);
+    setMinimumWidth(640);
+}
+
+void
+CacheStatsDialog::refresh()
+{
+    for (int i=0; i<caches.count(); i++) {
+        CacheStats *stats = caches.at(i);
+        QTreeWidgetItem *item = table->topLevelItem(i);
+
+        int hits = stats->hitCount(), misses = stats->missCount();
+        item->setText(1, QString("%1").arg(stats->entries()));
+        item->setText(2, QString("%1").arg(double(stats->bytes()) / (1024 * 1024), 0, 'f', 1));
+        item->setText(4, QString("%1").arg(hits));
+        item->setText(5, QString("%1").arg(misses));
+        item->setText(6, hits + misses ? QString("%1%").arg(100.0 * hits / (hits + misses), 0, 'f', 0) : QString("-"));
+    }
+}
+
+void
+CacheStatsDialog::resetCounters()
+{
+    foreach(CacheStats *stats, caches) stats->resetCounters();
+    refresh();
+}
+
+void
+CacheStatsDialog::budgetChanged(int megabytes)
+{
+    int index = budgets.indexOf(static_cast<QSpinBox*>(sender()));
+    if (index >= 0) caches.at(index)->setBudgetMB(megabytes);
+}
+
+void
+CacheStatsDialog::exportStats()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export Cache Statistics"),
+                       QDir::homePath() + "/goldencheetah-caches.csv", tr("Comma Separated (*.csv)"));
+    if (fileName.isEmpty()) return;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::warning(this, tr("Export Cache Statistics"), tr("Could not write %1").arg(fileName));
+        return;
+    }
+    QTextStream out(&file);
+    out << CacheStats::report();
+}
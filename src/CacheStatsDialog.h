@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef _GC_CacheStatsDialog_h
+#define _GC_CacheStatsDialog_h 1
+#include "GoldenCheetah.h"
+
+#include <QtGui>
+
+class CacheStats;
+
+// Help, Memory and Caches: what each of the caches is holding, how well
+// it is doing and what it is allowed, see CacheStats. Budgets changed
+// here are saved and the caches fit themselves to them as they are used
+class CacheStatsDialog : public QDialog
+{
+    Q_OBJECT
+    G_OBJECT
+
+    public:
+        CacheStatsDialog(QWidget *parent);
+
+    private slots:
+        void refresh();
+        void resetCounters();
+        void budgetChanged(int);
+        void exportStats();
+
+    private:
+        QTreeWidget *table;
+        QList<CacheStats*> caches;
+        QList<QSpinBox*> budgets; // as caches
+        QTimer *timer;
+};
+
+#endif // _GC_CacheStatsDialog_h
@@ -20,7 +20,7 @@
 #include "MainWindow.h"
 #include "Athlete.h"
 
-CalDAV::CalDAV(Context *context) : context(context), mode(None)
+CalDAV::CalDAV(Context *context) : context(context), mode(None), loaded(false), published(false)
 {
     nam = new QNetworkAccessManager(this);
     connect(nam, SIGNAL(finished(QNetworkReply*)), this, SLOT(requestReply(QNetworkReply*)));
@@ -32,7 +32,7 @@ CalDAV::CalDAV(Context *context) : context(context), mode(None)
 }
 
 //
-// GET event directory listing
+// Refresh the events, only fetching those that changed
 //
 bool
 CalDAV::download()
@@ -40,31 +40,91 @@ CalDAV::download()
     QString url = appsettings->cvalue(context->athlete->cyclist, GC_DVURL, "").toString();
     if (url == "") return false; // not configured
 
+    loadStore();
+
     QNetworkRequest request = QNetworkRequest(QUrl(url));
 
+    // getctag is a calendarserver.org extension, servers without
+    // it just don't return one and we go on to compare etags
     QByteArray *queryText = new QByteArray( "<?xml version=\"1.0\" encoding=\"utf-8\" ?>"
-                                            "<C:calendar-query xmlns:D=\"DAV:\""
-                                            "                 xmlns:C=\"urn:ietf:params:xml:ns:caldav\">"
-                                            " <D:prop>"
-                                            "   <D:getetag/>"
-                                            "   <C:calendar-data/>"
-                                            " </D:prop>"
-                                            " <C:filter>"
-                                            "   <C:comp-filter name=\"VCALENDAR\">"
-                                            "     <C:comp-filter name=\"VEVENT\">"
-                                            "       <C:time-range end=\"20200101T000000Z\" start=\"20000101T000000Z\"/>"
-                                            "     </C:comp-filter>"
-                                            "   </C:comp-filter>"
-                                            " </C:filter>"
-                                            "</C:calendar-query>\r\n");
+                                            "<D:propfind xmlns:D=\"DAV:\""
+                                            "                 xmlns:CS=\"http://calendarserver.org/ns/\">"
+                                            "  <D:prop>"
+                                            "    <CS:getctag/>"
+                                            "  </D:prop>"
+                                            "</D:propfind>\r\n");
 
-    request.setRawHeader("Depth", "0");
-    request.setRawHeader("Content-Type", "application/xml; charset=\"utf-8\"");
+    request.setRawHeader("Content-Type", "text/xml; charset=\"utf-8\"");
     request.setRawHeader("Content-Length", (QString("%1").arg(queryText->size())).toLatin1());
+    request.setRawHeader("Depth", "0");
 
     QBuffer *query = new QBuffer(queryText);
 
-    mode = Events;
+    mode = CTag;
+    QNetworkReply *reply = nam->sendCustomRequest(request, "PROPFIND" , query);
+    if (reply->error() != QNetworkReply::NoError) {
+        QMessageBox::warning(context->mainWindow, tr("CalDAV PROPFIND url error"), reply->errorString());
+        mode = None;
+        return false;
+    }
+    return true;
+}
+
+//
+// REPORT of the etags for all VEVENTS, without their data
+//
+bool
+CalDAV::etags()
+{
+    return sendReport("<?xml version=\"1.0\" encoding=\"utf-8\" ?>"
+                      "<C:calendar-query xmlns:D=\"DAV:\""
+                      "                 xmlns:C=\"urn:ietf:params:xml:ns:caldav\">"
+                      " <D:prop>"
+                      "   <D:getetag/>"
+                      " </D:prop>"
+                      " <C:filter>"
+                      "   <C:comp-filter name=\"VCALENDAR\">"
+                      "     <C:comp-filter name=\"VEVENT\">"
+                      "       <C:time-range end=\"21001231T000000Z\" start=\"20000101T000000Z\"/>"
+                      "     </C:comp-filter>"
+                      "   </C:comp-filter>"
+                      " </C:filter>"
+                      "</C:calendar-query>\r\n", ETags);
+}
+
+//
+// REPORT of just the events that were added or changed
+//
+bool
+CalDAV::multiget(QStringList hrefs)
+{
+    QByteArray body = "<?xml version=\"1.0\" encoding=\"utf-8\" ?>"
+                      "<C:calendar-multiget xmlns:D=\"DAV:\""
+                      "                 xmlns:C=\"urn:ietf:params:xml:ns:caldav\">"
+                      " <D:prop>"
+                      "   <D:getetag/>"
+                      "   <C:calendar-data/>"
+                      " </D:prop>";
+    foreach(QString href, hrefs) body += " <D:href>" + Qt::escape(href).toUtf8() + "</D:href>";
+    body += "</C:calendar-multiget>\r\n";
+
+    return sendReport(body, MultiGet);
+}
+
+bool
+CalDAV::sendReport(QByteArray body, ActionType action)
+{
+    QString url = appsettings->cvalue(context->athlete->cyclist, GC_DVURL, "").toString();
+    if (url == "") return false; // not configured
+
+    QNetworkRequest request = QNetworkRequest(QUrl(url));
+    request.setRawHeader("Depth", "1");
+    request.setRawHeader("Content-Type", "application/xml; charset=\"utf-8\"");
+    request.setRawHeader("Content-Length", (QString("%1").arg(body.size())).toLatin1());
+
+    QBuffer *query = new QBuffer(new QByteArray(body));
+
+    mode = action;
     QNetworkReply *reply = nam->sendCustomRequest(request, "REPORT", query);
     if (reply->error() != QNetworkReply::NoError) {
         QMessageBox::warning(context->mainWindow, tr("CalDAV REPORT url error"), reply->errorString());
@@ -74,6 +134,47 @@ CalDAV::download()
     return true;
 }
 
+//
+// The local copy of the remote events
+//
+void
+CalDAV::loadStore()
+{
+    if (loaded) return;
+    loaded = true;
+
+    QFile file(context->athlete->home.absolutePath() + "/caldav.cache");
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QDataStream in(&file);
+    in >> ctag >> eventEtags >> eventData;
+    if (in.status() != QDataStream::Ok) {
+        ctag = "";
+        eventEtags.clear();
+        eventData.clear();
+    }
+}
+
+void
+CalDAV::saveStore()
+{
+    QFile file(context->athlete->home.absolutePath() + "/caldav.cache");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+
+    QDataStream out(&file);
+    out << ctag << eventEtags << eventData;
+}
+
+void
+CalDAV::publish()
+{
+    QString fulltext;
+    foreach(QString event, eventData) fulltext += event;
+
+    context->athlete->rideCalendar()->refreshRemote(fulltext);
+    published = true;
+}
+
 //
 // Get OPTIONS available
 //
@@ -267,50 +368,72 @@ icalcomponent *createEvent(RideItem *rideItem)
     return root;
 }
 
-// extract <calendar-data> entries and concatenate
-// into a single string. This is from a query response
-// where the VEVENTS are embedded within an XML document
-static QString extractComponents(QString document)
+// the parts of each <response> in a multistatus document
+struct CalDAVResponse
 {
-    QString returning = "";
+    QString href, etag, ctag, data;
+};
+
+// top and tail the other crap around the VEVENT
+static QString eventText(QString text)
+{
+    int start = text.indexOf("BEGIN:VEVENT");
+    int stop = text.indexOf("END:VEVENT");
+
+    if (start == -1 || stop == -1) return "";
+    return text.mid(start, stop-start+10) + "\n";
+}
+
+static QList<CalDAVResponse> parseMultistatus(QString document)
+{
+    QList<CalDAVResponse> returning;
 
     // parse the document and extract the multistatus node (there is only one of those)
     QDomDocument doc;
-    if (document == "" || doc.setContent(document) == false) return "";
+    if (document == "" || doc.setContent(document) == false) return returning;
     QDomNode multistatus = doc.documentElement();
-    if (multistatus.isNull())  return "";
+    if (multistatus.isNull())  return returning;
 
     // Google Calendar retains the namespace prefix in the results
     // Apple MobileMe doesn't. This means the element names will
     // possibly need a prefix...
     QString Dprefix = "";
-    QString Cprefix = "";
-    if (multistatus.nodeName().startsWith("D:")) {
-        Dprefix = "D:";
-        Cprefix = "C:";
-    }
+    if (multistatus.nodeName().startsWith("D:")) Dprefix = "D:";
 
     // read all the responses within the multistatus
     for (QDomNode response = multistatus.firstChildElement(Dprefix + "response");
          response.nodeName() == (Dprefix + "response"); response = response.nextSiblingElement(Dprefix + "response")) {
 
-        // skate over the nest of crap to get at the calendar-data
+        CalDAVResponse add;
+        add.href = response.firstChildElement(Dprefix + "href").text();
+
+        // skate over the nest of crap to get at the properties, the
+        // caldav and calendarserver prefixes vary even more so we
+        // just go by the name
         QDomNode propstat = response.firstChildElement(Dprefix + "propstat");
         QDomNode prop = propstat.firstChildElement(Dprefix + "prop");
-        QDomNode calendardata = prop.firstChildElement(Cprefix + "calendar-data");
-
-        // extract the calendar entry - top and tail the other crap
-        QString text = calendardata.toElement().text();
-        int start = text.indexOf("BEGIN:VEVENT");
-        int stop = text.indexOf("END:VEVENT");
-
-        if (start == -1 || stop == -1) continue;
-
-        returning += text.mid(start, stop-start+10) + "\n";
+        for (QDomElement e = prop.firstChildElement(); !e.isNull(); e = e.nextSiblingElement()) {
+            QString name = e.nodeName().section(':', -1);
+            if (name == "getetag") add.etag = e.text();
+            else if (name == "getctag") add.ctag = e.text();
+            else if (name == "calendar-data") add.data = eventText(e.text());
+        }
+        returning << add;
     }
     return returning;
 }
 
+// extract <calendar-data> entries and concatenate
+// into a single string. This is from a query response
+// where the VEVENTS are embedded within an XML document
+static QString extractComponents(QString document)
+{
+    QString returning = "";
+    foreach(CalDAVResponse response, parseMultistatus(document))
+        returning += response.data;
+    return returning;
+}
+
 //
 // PUT a ride item
 //
@@ -355,11 +478,77 @@ CalDAV::requestReply(QNetworkReply *reply)
 {
     QString response = reply->readAll();
 
-    switch (mode) {
+    ActionType was = mode;
+    mode = None;
+
+    switch (was) {
     case Report:
     case Events:
-        context->athlete->rideCalendar->refreshRemote(extractComponents(response));
+        context->athlete->rideCalendar()->refreshRemote(extractComponents(response));
         break;
+
+    case CTag:
+        {
+            QList<CalDAVResponse> responses = parseMultistatus(response);
+            pendingCtag = responses.count() ? responses.first().ctag : "";
+
+            // nothing changed since we last looked
+            if (pendingCtag != "" && pendingCtag == ctag) {
+                if (!published) publish();
+            } else {
+                etags();
+            }
+        }
+        break;
+
+    case ETags:
+        {
+            // anything gone or changed since we last looked?
+            QMap<QString, QString> current;
+            if (reply->error() == QNetworkReply::NoError) {
+                foreach(CalDAVResponse r, parseMultistatus(response))
+                    if (r.href != "") current.insert(r.href, r.etag);
+            } else {
+                current = eventEtags; // offline, stick with what we have
+            }
+
+            foreach(QString href, eventEtags.keys()) {
+                if (!current.contains(href)) {
+                    eventEtags.remove(href);
+                    eventData.remove(href);
+                }
+            }
+
+            QStringList changed;
+            QMapIterator<QString, QString> i(current);
+            while (i.hasNext()) {
+                i.next();
+                if (!eventEtags.contains(i.key()) || eventEtags.value(i.key()) != i.value()) changed << i.key();
+            }
+
+            if (changed.count()) {
+                multiget(changed);
+            } else {
+                if (reply->error() == QNetworkReply::NoError) ctag = pendingCtag;
+                saveStore();
+                publish();
+            }
+        }
+        break;
+
+    case MultiGet:
+        if (reply->error() == QNetworkReply::NoError) {
+            foreach(CalDAVResponse r, parseMultistatus(response)) {
+                if (r.href == "") continue;
+                eventEtags.insert(r.href, r.etag);
+                eventData.insert(r.href, r.data);
+            }
+            ctag = pendingCtag;
+            saveStore();
+        }
+        publish();
+        break;
+
     default:
     case Options:
     case PropFind:
@@ -367,7 +556,6 @@ CalDAV::requestReply(QNetworkReply *reply)
         //nothing at the moment
         break;
     }
-    mode = None;
 }
 
 //
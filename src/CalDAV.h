@@ -55,7 +55,7 @@ class CalDAV : public QObject
     Q_OBJECT
     G_OBJECT
 
-    enum action { Options, PropFind, Put, Get, Events, Report, None };
+    enum action { Options, PropFind, Put, Get, Events, Report, CTag, ETags, MultiGet, None };
     typedef enum action ActionType;
 
 public:
@@ -70,7 +70,7 @@ public slots:
     // Query CalDAV server Options
     bool propfind();
 
-    // authentication (and refresh all events)
+    // authentication (and refresh the events that changed)
     bool download();
 
     // Query CalDAV server for events ...
@@ -88,5 +88,22 @@ private:
     Context *context;
     QNetworkAccessManager *nam;
     ActionType mode;
+
+    // download() syncs in steps; the collection ctag says if anything
+    // changed at all, then the event etags say which events to fetch
+    bool etags();
+    bool multiget(QStringList hrefs);
+    bool sendReport(QByteArray body, ActionType action);
+
+    // local copy of the remote events, kept in the athlete home
+    // so a refresh only fetches what changed since the last one
+    void loadStore();
+    void saveStore();
+    void publish();                 // pass the events to the calendar
+
+    bool loaded, published;
+    QString ctag, pendingCtag;
+    QMap<QString, QString> eventEtags; // by href
+    QMap<QString, QString> eventData;  // VEVENT text by href
 };
 #endif
@@ -24,7 +24,7 @@
 #include <libical/ical.h>
 #endif
 
-CalendarDownload::CalendarDownload(Context *context) : context(context)
+CalendarDownload::CalendarDownload(Context *context) : context(context), parsed(false)
 {
     nam = new QNetworkAccessManager(this);
     connect(nam, SIGNAL(finished(QNetworkReply*)), this, SLOT(downloadFinished(QNetworkReply*)));
@@ -41,7 +41,14 @@ CalendarDownload::download()
         request.replace(webcal, QString("http:"));
     }
 
-    QNetworkReply *reply = nam->get(QNetworkRequest(QUrl(request)));
+    // the server can answer 304 if nothing changed since last time
+    QNetworkRequest get = QNetworkRequest(QUrl(request));
+    QString etag = appsettings->cvalue(context->athlete->cyclist, GC_WEBCAL_ETAG, "").toString();
+    QString modified = appsettings->cvalue(context->athlete->cyclist, GC_WEBCAL_MODIFIED, "").toString();
+    if (etag != "") get.setRawHeader("If-None-Match", etag.toLatin1());
+    if (modified != "") get.setRawHeader("If-Modified-Since", modified.toLatin1());
+
+    QNetworkReply *reply = nam->get(get);
 
     if (reply->error() != QNetworkReply::NoError) {
         QMessageBox::warning(context->mainWindow, tr("Calendar Data Download"), reply->errorString());
@@ -59,15 +66,30 @@ CalendarDownload::downloadFinished(QNetworkReply *reply)
 #ifdef GC_HAVE_ICAL
     QString remoteCache = context->athlete->home.absolutePath()+"/remote.ics";
     QFile remoteCacheFile(remoteCache);
+    bool unchanged = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304;
 
-    if (fulltext != "") {
+    if (unchanged) {
+
+        // what we have is current, read the cache if we haven't yet
+        if (parsed || !remoteCacheFile.exists()) return;
+
+        remoteCacheFile.open(QFile::ReadOnly | QFile::Text);
+        QTextStream in(&remoteCacheFile);
+        fulltext = in.readAll();
+        remoteCacheFile.close();
+
+    } else if (fulltext != "") {
 
         // update remote cache - write to it!
-        remoteCacheFile.open(QFile::ReadWrite | QFile::Text);
+        remoteCacheFile.open(QFile::WriteOnly | QFile::Truncate | QFile::Text);
         QTextStream out(&remoteCacheFile);
         out << fulltext;
         remoteCacheFile.close();
 
+        // and remember what it was for next time
+        appsettings->setCValue(context->athlete->cyclist, GC_WEBCAL_ETAG, QString(reply->rawHeader("ETag")));
+        appsettings->setCValue(context->athlete->cyclist, GC_WEBCAL_MODIFIED, QString(reply->rawHeader("Last-Modified")));
+
     } else {
 
         if (remoteCacheFile.exists()) {
@@ -85,6 +107,9 @@ CalendarDownload::downloadFinished(QNetworkReply *reply)
         }
     }
 
-    if (fulltext != "") context->athlete->rideCalendar->refreshRemote(fulltext);
+    if (fulltext != "") {
+        context->athlete->rideCalendar()->refreshRemote(fulltext);
+        parsed = true;
+    }
 #endif
 }
@@ -44,6 +44,7 @@ public slots:
 private:
     Context *context;
     QNetworkAccessManager *nam;
+    bool parsed; // an unchanged calendar needn't be parsed again
 /*    CalendarParser *parser; */
 };
 #endif
@@ -17,6 +17,7 @@
  */
 
 #include "RideMetric.h"
+#include "RideStatistics.h"
 #include "Zones.h"
 #include <math.h>
 #include <QApplication>
@@ -47,35 +48,14 @@ class NP : public RideMetric {
 
         if(ride->recIntSecs() == 0) return;
 
-        int rollingwindowsize = 30 / ride->recIntSecs();
-
         double total = 0;
         int count = 0;
 
-        // no point doing a rolling average if the
-        // sample rate is greater than the rolling average
-        // window!!
-        if (rollingwindowsize > 1) {
-
-            QVector<double> rolling(rollingwindowsize);
-            int index = 0;
-            double sum = 0;
-
-            // loop over the data and convert to a rolling
-            // average for the given windowsize
-            for (int i=0; i<ride->dataPoints().size(); i++) {
-
-                sum += ride->dataPoints()[i]->watts;
-                sum -= rolling[index];
-
-                rolling[index] = ride->dataPoints()[i]->watts;
-
-                total += pow(sum/rollingwindowsize,4); // raise rolling average to 4th power
-                count ++;
-
-                // move index on/round
-                index = (index >= rollingwindowsize-1) ? 0 : index+1;
-            }
+        // empty when the sample rate is greater
+        // than the rolling average window
+        foreach(double average, statistics(ride).rolling30s()) {
+            total += pow(average,4); // raise rolling average to 4th power
+            count ++;
         }
         if (count) {
             np = pow(total / (count), 0.25);
@@ -137,6 +117,7 @@ class IntensityFactor : public RideMetric {
     IntensityFactor() : rif(0.0), secs(0.0)
     {
         setSymbol("coggan_if");
+        setDependsOn(RideMetric::PowerZone | RideMetric::Metadata); // CP may be in a tag
         setInternalName("IF");
     }
     void initialize() {
@@ -173,6 +154,7 @@ class TSS : public RideMetric {
     TSS() : score(0.0)
     {
         setSymbol("coggan_tss");
+        setDependsOn(RideMetric::PowerZone | RideMetric::Metadata); // CP may be in a tag
         setInternalName("TSS");
     }
     void initialize() {
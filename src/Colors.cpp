@@ -243,17 +243,79 @@ void ColorEngine::configUpdate()
             }
         }
     }
+    compile();
+    colors.clear();
+}
+
+void
+ColorEngine::compile()
+{
+    states.clear();
+    codeColors.clear();
+    states.append(MatchState()); // root
+
+    // the trie of codes, in workoutCodes order
+    QMapIterator<QString, QColor> i(workoutCodes);
+    while (i.hasNext()) {
+        i.next();
+        int state = 0;
+        foreach (QChar c, i.key().toLower()) {
+            int to = states[state].next.value(c, -1);
+            if (to < 0) {
+                to = states.count();
+                states.append(MatchState());
+                states[state].next.insert(c, to);
+            }
+            state = to;
+        }
+        states[state].last = codeColors.count();
+        codeColors.append(i.value());
+    }
+
+    // failure links breadth first, so each state's fail is
+    // done before its children need it
+    QVector<int> queue;
+    queue.reserve(states.count());
+    queue.append(0);
+    for (int q=0; q < queue.count(); q++) {
+        int state = queue[q];
+        QHashIterator<QChar, int> t(states[state].next);
+        while (t.hasNext()) {
+            t.next();
+            int child = t.value();
+            int fail = 0;
+            if (state) {
+                fail = states[state].fail;
+                while (fail && !states[fail].next.contains(t.key())) fail = states[fail].fail;
+                fail = states[fail].next.value(t.key(), 0);
+            }
+            states[child].fail = fail;
+            states[child].last = qMax(states[child].last, states[fail].last);
+            queue.append(child);
+        }
+    }
 }
 
 QColor
 ColorEngine::colorFor(QString text)
 {
-    QColor color = defaultColor;
+    QHash<QString, QColor>::const_iterator cached = colors.constFind(text);
+    if (cached != colors.constEnd()) return cached.value();
 
-    foreach(QString code, workoutCodes.keys()) {
-        if (text.contains(code, Qt::CaseInsensitive)) {
-           color = workoutCodes[code];
-        }
+    // scan once, remembering the highest code index that matched
+    // and stopping early if it's the last code anyway
+    int last = states.isEmpty() ? -1 : states[0].last;
+    int state = 0;
+    QString lower = text.toLower();
+    for (int i=0; i < lower.length() && last < codeColors.count()-1; i++) {
+        QChar c = lower[i];
+        while (state && !states[state].next.contains(c)) state = states[state].fail;
+        state = states[state].next.value(c, 0);
+        last = qMax(last, states[state].last);
     }
+    QColor color = last >= 0 ? codeColors[last] : defaultColor;
+
+    if (colors.count() > 1024) colors.clear(); // free form text, keep it bounded
+    colors.insert(text, color);
     return color;
 }
@@ -23,6 +23,8 @@
 #include <QObject>
 #include <QString>
 #include <QColor>
+#include <QHash>
+#include <QVector>
 
 class Context;
 
@@ -92,6 +94,22 @@ class ColorEngine : public QObject
         QMap<QString, QColor> workoutCodes;
         QColor defaultColor;
         Context *context;
+
+        // the lowercased codes compiled into one matcher (Aho-Corasick)
+        // so the text is scanned once for all of them. Where several
+        // match the last in workoutCodes order wins, as it always has.
+        struct MatchState {
+            QHash<QChar, int> next;     // goto transitions
+            int fail;                   // longest proper suffix state
+            int last;                   // highest code index matched here or via fail
+            MatchState() : fail(0), last(-1) {}
+        };
+        QVector<MatchState> states;
+        QVector<QColor> codeColors;     // by code index
+        void compile();
+
+        // the same few field values come round again and again
+        QHash<QString, QColor> colors;
 };
 
 
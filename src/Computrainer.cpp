@@ -79,6 +79,8 @@ Computrainer::Computrainer(QObject *parent,  QString devname) : QThread(parent)
     deviceCalibrated = false;
     deviceHRConnected = false;
     deviceCADConnected = false;
+    recorder = NULL;
+    publishTelemetry();
     setDevice(devname);
     deviceStatus=0;
     this->parent = parent;
@@ -137,62 +139,72 @@ void Computrainer::setGradient(double gradient)
  * ---------------------------------------------------------------------- */
 bool Computrainer::isHRConnected()
 {
-    bool tmp;
-    pvars.lock();
-    tmp = deviceHRConnected;
-    pvars.unlock();
-
-    return tmp;
+    return published.read().hrConnected;
 }
 
 bool Computrainer::isCADConnected()
 {
-    bool tmp;
-    pvars.lock();
-    tmp = deviceCADConnected;
-    pvars.unlock();
-
-    return tmp;
+    return published.read().cadConnected;
 }
 
 bool Computrainer::isCalibrated()
 {
-    bool tmp;
-    pvars.lock();
-    tmp = deviceCalibrated;
-    pvars.unlock();
-
-    return tmp;
+    return published.read().calibrated;
 }
 
 void Computrainer::getTelemetry(double &power, double &heartrate, double &cadence, double &speed,
                   double &RRC, bool &calibration, int &buttons, uint8_t *ss, int &status)
 {
 
-    pvars.lock();
-    power = devicePower;
-    heartrate = deviceHeartRate;
-    cadence = deviceCadence;
-    speed = deviceSpeed;
-    RRC = deviceRRC;
-    calibration = deviceCalibrated;
-    buttons = deviceButtons;
-    status = deviceStatus;
-    memcpy((void*)ss, (void*)spinScan, 24);
+    ComputrainerTelemetry latest = published.read();
+    power = latest.power;
+    heartrate = latest.heartrate;
+    cadence = latest.cadence;
+    speed = latest.speed;
+    RRC = latest.RRC;
+    calibration = latest.calibrated;
+    memcpy((void*)ss, (void*)latest.spinScan, 24);
 
     // work around to ensure controller doesn't miss button press. 
     // The run thread will only set the button bits, they don't get
     // reset until the ui reads the device state
     //  Borrowed from: Fortius.cpp 
-    deviceButtons = 0; 
+    buttons = deviceButtons.take();
+
+    pvars.lock();
+    status = deviceStatus;
     pvars.unlock();
 }
 
+// run() thread, hand over a consistent copy of the telemetry
+void Computrainer::publishTelemetry()
+{
+    ComputrainerTelemetry latest;
+    latest.power = devicePower;
+    latest.heartrate = deviceHeartRate;
+    latest.cadence = deviceCadence;
+    latest.speed = deviceSpeed;
+    latest.RRC = deviceRRC;
+    latest.calibrated = deviceCalibrated;
+    latest.hrConnected = deviceHRConnected;
+    latest.cadConnected = deviceCADConnected;
+    memcpy(latest.spinScan, spinScan, 24);
+    published.publish(latest);
+
+    // only changes are recorded, the ride carries values forward
+    if (recorder) {
+        if (latest.power != recorded.power) recorder->record(recorderDevice, SessionRecorder::Watts, latest.power);
+        if (latest.heartrate != recorded.heartrate) recorder->record(recorderDevice, SessionRecorder::HeartRate, latest.heartrate);
+        if (latest.cadence != recorded.cadence) recorder->record(recorderDevice, SessionRecorder::Cadence, latest.cadence);
+        if (latest.speed != recorded.speed) recorder->record(recorderDevice, SessionRecorder::Speed, latest.speed);
+    }
+    recorded = latest;
+}
+
 void Computrainer::getSpinScan(double spinData[])
 {
-    pvars.lock();
-    for (int i=0; i<24; spinData[i] = this->spinScan[i]) ;
-    pvars.unlock();
+    ComputrainerTelemetry latest = published.read();
+    for (int i=0; i<24; i++) spinData[i] = latest.spinScan[i];
 }
 
 int Computrainer::getMode()
@@ -379,13 +391,22 @@ void Computrainer::unpackTelemetry(int &ss1, int &ss2, int &ss3, int &buttons, i
     value12 = value8 | (b1&7)<<9 | (b3&2)<<7;
 
     if (buttons&64) {
-        memcpy((uint8_t*)spinScan, (uint8_t*)ss+3, 21);
-        memcpy((uint8_t*)spinScan+21, (uint8_t*)ss, 3);
+        memcpy(spinScan, (uint8_t*)ss+3, 21);
+        memcpy(spinScan+21, (uint8_t*)ss, 3);
+
+        // only a full set is a revolution, the first after
+        // we start or miss a message will be partial
+        if (pos == 24) {
+            revolutions.push(spinScan);
+            if (recorder) recorder->recordSpinScan(recorderDevice, spinScan);
+        }
         //for (pos=0; pos<24; pos++) fprintf(stderr, "%d, ", ss[pos]);
         //fprintf(stderr, "\n");
         pos=0;
     }
-    if (ss1 || ss2 || ss3) {
+    // if we missed the start of a revolution don't run off
+    // the end of ss, just wait for the next one to begin
+    if ((ss1 || ss2 || ss3) && pos <= 21) {
 
         // we drop the msb and do a ones compliment, but
         // that looks eerily like a signed byte.
@@ -513,6 +534,7 @@ void Computrainer::run()
 
 
     // initialise local cache & main vars
+    stats.reset();
     pvars.lock();
     this->deviceStatus = CT_RUNNING;
     curmode = this->mode;
@@ -522,7 +544,8 @@ void Computrainer::run()
     curHeartRate = this->deviceHeartRate = 0;
     curCadence = this->deviceCadence = 0;
     curSpeed = this->deviceSpeed = 0;
-    curButtons = this->deviceButtons = 0;
+    curButtons = 0;
+    deviceButtons.take();
     curRRC = this->deviceRRC = 0;
     this->deviceCalibrated = false;
     curhrconnected = false;
@@ -530,6 +553,7 @@ void Computrainer::run()
     curcadconnected = false;
     this->deviceCADConnected = false;
     pvars.unlock();
+    publishTelemetry();
 
 
     // open the device
@@ -554,7 +578,13 @@ void Computrainer::run()
 
         if (isDeviceOpen == true) {
 
-            if (readMessage() > 0) {
+            // waits up to CT_RXWAIT msecs for a message so we get
+            // back to check for commands from the gui promptly
+            int rc = readMessage();
+            if (rc > 0) {
+
+                stats.arrived();
+                stats.queued(rxCount);
 
                 //----------------------------------------------------------------
                 // UPDATE BASIC TELEMETRY (HR, CAD, SPD et al)
@@ -566,27 +596,21 @@ void Computrainer::run()
                     case CT_HEARTRATE :
                         if (value8 != curHeartRate) {
                             curHeartRate = value8;
-                            pvars.lock();
                             this->deviceHeartRate = curHeartRate;
-                            pvars.unlock();
                         }
                         break;
 
                     case CT_POWER :
                         if (value12 != curPower) {
                             curPower = value12;
-                            pvars.lock();
                             this->devicePower = curPower;
-                            pvars.unlock();
                         }
                         break;
 
                     case CT_CADENCE :
                         if (value8 != curCadence) {
                             curCadence = value8;
-                            pvars.lock();
                             this->deviceCadence = curCadence;
-                            pvars.unlock();
                         }
                         break;
 
@@ -597,9 +621,7 @@ void Computrainer::run()
                         newspeed = value12;
                         newspeed  /= 1000;
                         if (newspeed != curSpeed) {
-                            pvars.lock();
                             this->deviceSpeed = curSpeed = newspeed;
-                            pvars.unlock();
                         }
                         break;
 
@@ -609,9 +631,7 @@ void Computrainer::run()
                         newRRC /= 256;
 
                         if (newRRC != curRRC) {
-                            pvars.lock();
                             this->deviceRRC = curRRC = newRRC;
-                            pvars.unlock();
                         }
                         break;
 
@@ -620,10 +640,8 @@ void Computrainer::run()
                         newhrconnected  = value12&1024 ? true : false;
 
                         if (newhrconnected != curhrconnected || newcadconnected != curcadconnected) {
-                            pvars.lock();
                             this->deviceHRConnected=curhrconnected=newhrconnected;
                             this->deviceCADConnected=curcadconnected=newcadconnected;
-                            pvars.unlock();
                         }
                         break;
 
@@ -636,9 +654,7 @@ void Computrainer::run()
             //----------------------------------------------------------------
             if (buttons != curButtons) {
                 // let the gui workout what the deal is with silly button values!
-                pvars.lock();
-			  this->deviceButtons |= buttons; // Borrowed from Fortius.cpp: workaround to ensure controller doesn't miss button pushes
-                pvars.unlock();
+                deviceButtons.press(buttons); // Borrowed from Fortius.cpp: workaround to ensure controller doesn't miss button pushes
             }
 
             //----------------------------------------------------------------
@@ -646,10 +662,10 @@ void Computrainer::run()
             //----------------------------------------------------------------
             /* not yet implemented */
 
-            } else {
-                // no data
-                // how long to sleep for ... mmm save CPU cycles vs
-                //                           data overflow ?
+            publishTelemetry();
+
+            } else if (rc < 0) {
+                // read failed, don't spin on it
                 CTsleeper::msleep (100); // lets try a tenth of a second
             }
 
@@ -658,11 +674,11 @@ void Computrainer::run()
         //----------------------------------------------------------------
         // LISTEN TO GUI CONTROL COMMANDS
         //----------------------------------------------------------------
-        pvars.lock();
+        stats.lock(pvars);
         curstatus = this->deviceStatus;
         newmode = this->mode;
         newload = this->load;
-        curgradient = newgradient = this->gradient;
+        newgradient = this->gradient;
         pvars.unlock();
 
         /* time to shut up shop */
@@ -698,7 +714,10 @@ void Computrainer::run()
         //----------------------------------------------------------------
         // KEEP THE COMPUTRAINER CONTROL ALIVE
         //----------------------------------------------------------------
-        if (isDeviceOpen == true && !(cmds%10)) {
+        // changes to the load go out as soon as the last command has
+        // gone, otherwise we resend every 10 messages or so
+        bool changed = newmode != curmode || newload != curload || newgradient != curgradient;
+        if (isDeviceOpen == true && (cmds >= 10 || changed) && !outputPending()) {
             cmds=1;
             curmode = newmode;
             curload = newload;
@@ -730,11 +749,13 @@ void CTsleeper::msleep(unsigned long msecs)
  *
  * HIGH LEVEL IO
  * int sendCommand()        - writes a command to the device
- * int readMessage()        - reads an inbound message
+ * int readMessage()        - decodes the next inbound message from rxBuffer
  *
  * LOW LEVEL IO
  * openPort() - opens serial device and configures it
  * closePort() - closes serial device and releases resources
+ * readAvailable() - reads whatever has arrived into rxBuffer
+ * outputPending() - is the last command still being sent
  * rawRead() - non-blocking read of inbound data
  * rawWrite() - non-blocking write of outbound data
  * discover() - check if a ct is attached to the port specified
@@ -764,27 +785,87 @@ int Computrainer::sendCommand(int mode)      // writes a command to the device
 
 int Computrainer::readMessage()
 {
-    int rc;
-
-    if ((rc = rawRead(buf, 7)) > 0 && (buf[6]&128) == 0) {
+    // messages are 7 bytes and the last has the sync bit set, we
+    // drop bytes until that lines up. From experience, the need to
+    // sync is quite rare on a normally configured and working system
+    while (1) {
+
+        int skip = 0;
+        while (rxCount - skip >= 7 && (rxBuffer[skip+6]&128) == 0) skip++;
+        if (skip) {
+            rxCount -= skip;
+            memmove(rxBuffer, rxBuffer+skip, rxCount);
+        }
 
-        // we got something but need to sync
-        while ((buf[6]&128) == 0 && rc > 0) {
-            rc = rawRead(&buf[6], 1);
+        if (rxCount >= 7) {
+            memcpy(buf, rxBuffer, 7);
+            rxCount -= 7;
+            memmove(rxBuffer, rxBuffer+7, rxCount);
+            return 7;
         }
 
-        // at this point we are synced, we may have a dodgy
-        // record but that is fair enough if we were out of
-        // sync anyway - the alternative is to keep going
-        // until we get a good message and that will
-        // lead to bigger issues (plus we may have a hw
-        // problem anyway).
-        //
-        // From experience, the need to sync is quite rare
-        // on a normally configured and working system
+        // need more
+        int rc = readAvailable(CT_RXWAIT);
+        if (rc <= 0) return rc;
+    }
+}
+
+// read whatever has arrived, waiting up to timeout msecs for something
+// returns the number of bytes added to rxBuffer, 0 if none or -1 on error
+int Computrainer::readAvailable(int timeout)
+{
+    int space = CT_RXBUFFER - rxCount;
 
+#ifdef WIN32
+    COMSTAT stat;
+    DWORD errors;
+    int waited = 0;
+
+    while (1) {
+        if (!ClearCommError(devicePort, &errors, &stat)) return -1;
+        if (stat.cbInQue) break;
+        if (waited >= timeout) return 0;
+        CTsleeper::msleep(5);
+        waited += 5;
     }
+
+    DWORD cBytes;
+    if (!ReadFile(devicePort, rxBuffer+rxCount, qMin((int)stat.cbInQue, space), &cBytes, NULL)) return -1;
+    rxCount += cBytes;
+    return (int)cBytes;
+#else
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(devicePort, &fds);
+    struct timeval tv;
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+
+    int rc = select(devicePort+1, &fds, NULL, NULL, &tv);
+    if (rc == -1) return errno == EINTR ? 0 : -1;
+    if (rc == 0) return 0; // nothing yet
+
+    rc = read(devicePort, rxBuffer+rxCount, space);
+    if (rc == -1) return errno == EAGAIN ? 0 : -1;
+    rxCount += rc;
     return rc;
+#endif
+}
+
+// the computrainer microcontroller has almost no RAM so we
+// never queue a command behind one that is still being sent
+bool Computrainer::outputPending()
+{
+#ifdef WIN32
+    COMSTAT stat;
+    DWORD errors;
+    if (!ClearCommError(devicePort, &errors, &stat)) return false;
+    return stat.cbOutQue > 0;
+#else
+    int queued = 0;
+    if (ioctl(devicePort, TIOCOUTQ, &queued) == -1) return false;
+    return queued > 0;
+#endif
 }
 
 int Computrainer::closePort()
@@ -809,6 +890,7 @@ int Computrainer::openPort()
     int ldisc=N_TTY; // LINUX
 #endif
 
+    rxCount = 0;
     if ((devicePort=open(deviceFilename.toAscii(),O_RDWR | O_NOCTTY | O_NONBLOCK)) == -1) return errno;
 
     tcflush(devicePort, TCIOFLUSH); // clear out the garbage
@@ -852,6 +934,7 @@ int Computrainer::openPort()
     // WINDOWS USES SET/GETCOMMSTATE AND READ/WRITEFILE
 
     COMMTIMEOUTS timeouts; // timeout settings on serial ports
+    rxCount = 0;
 
     // if deviceFilename references a port above COM9
     // then we need to open "\\.\COMX" not "COMX"
@@ -921,17 +1004,10 @@ int Computrainer::rawWrite(uint8_t *bytes, int size) // unix!!
     return rc;
 
 #else
-    int ibytes;
-    ioctl(devicePort, FIONREAD, &ibytes);
-
     // timeouts are less critical for writing, since vols are low
+    // and we don't wait for it to drain, run() checks outputPending()
+    // before sending again to avoid overflowing the computrainer
     rc= write(devicePort, bytes, size);
-
-    // but it is good to avoid buffer overflow since the
-    // computrainer microcontroller has almost no RAM
-    if (rc != -1) tcdrain(devicePort); // wait till its gone.
-
-    ioctl(devicePort, FIONREAD, &ibytes);
 #endif
 
     return rc;
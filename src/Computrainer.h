@@ -39,6 +39,10 @@
 #include <QMutex>
 #include <QFile>
 #include "RealtimeController.h"
+#include "TelemetrySnapshot.h"
+#include "SpinScan.h"
+#include "DeviceStats.h"
+#include "SessionRecorder.h"
 
 #ifdef WIN32
 #include <windows.h>
@@ -47,6 +51,7 @@
 #include <termios.h> // unix!!
 #include <unistd.h> // unix!!
 #include <sys/ioctl.h>
+#include <sys/select.h>
 #ifndef N_TTY // for OpenBSD, this is a hack XXX
 #define N_TTY 0
 #endif
@@ -67,6 +72,10 @@
 #define CT_READTIMEOUT    1000
 #define CT_WRITETIMEOUT   2000
 
+// streaming reads, wait for input in msecs and buffer size
+#define CT_RXWAIT         20
+#define CT_RXBUFFER       256
+
 // message type
 #define CT_SPEED        0x01
 #define CT_POWER        0x02
@@ -104,6 +113,20 @@
 #define DEFAULT_GRADIENT    2.00
 
 
+// inbound telemetry as published by the run() thread
+struct ComputrainerTelemetry
+{
+    double power;           // current output power in Watts
+    double heartrate;       // current heartrate in BPM
+    double cadence;         // current cadence in RPM
+    double speed;           // current speed in KPH
+    double RRC;             // calibrated Rolling Resistance
+    bool calibrated;        // is it calibrated?
+    bool hrConnected;       // HR jack is connected
+    bool cadConnected;      // Cadence jack is connected
+    uint8_t spinScan[24];   // SS values only in SS_MODE
+};
+
 class Computrainer : public QThread
 {
 
@@ -139,6 +162,11 @@ public:
     void getTelemetry(double &Power, double &HeartRate, double &Cadence, double &Speed,
                         double &RRC, bool &calibration, int &Buttons, uint8_t *ss, int &Status);
     void getSpinScan(double spinData[]);
+    // revolutions completed since we last asked, newest max only
+    int getSpinScanRevolutions(SpinScanRevolution *to, int max) { return revolutions.take(to, max); }
+    // raw samples are sent to the recorder as they arrive
+    void setRecorder(SessionRecorder *recorder, int device) { this->recorder = recorder; recorderDevice = device; }
+    DeviceStats stats;          // message timings, see DeviceStats
     int getMode();
     double getGradient();
     double getLoad();
@@ -161,23 +189,31 @@ private:
     int calcCRC(int value);     // calculates the checksum for the current command
 
     // Protocol decoding
-    int readMessage();
+    int readMessage();          // next message from rxBuffer into buf, 0 if none yet
     void unpackTelemetry(int &b1, int &b2, int &b3, int &buttons, int &type, int &value8, int &value12);
 
     // Mutex for controlling accessing private data
     QMutex pvars;
 
-    // INBOUND TELEMETRY - all volatile since it is updated by the run() thread
-    volatile double devicePower;            // current output power in Watts
-    volatile double deviceHeartRate;        // current heartrate in BPM
-    volatile double deviceCadence;          // current cadence in RPM
-    volatile double deviceSpeed;            // current speef in KPH
-    volatile double deviceRRC;              // calibrated Rolling Resistance
-    volatile bool   deviceCalibrated;       // is it calibrated?
-    volatile uint8_t spinScan[24];           // SS values only in SS_MODE
-    volatile int    deviceButtons;          // Button status
-    volatile bool   deviceHRConnected;      // HR jack is connected
-    volatile bool   deviceCADConnected;     // Cadence jack is connected
+    // INBOUND TELEMETRY - only touched by the run() thread, which publishes
+    // a copy for the controller to read without taking pvars
+    double devicePower;            // current output power in Watts
+    double deviceHeartRate;        // current heartrate in BPM
+    double deviceCadence;          // current cadence in RPM
+    double deviceSpeed;            // current speef in KPH
+    double deviceRRC;              // calibrated Rolling Resistance
+    bool   deviceCalibrated;       // is it calibrated?
+    uint8_t spinScan[24];          // SS values only in SS_MODE
+    SpinScanQueue<32> revolutions; // each whole revolution as it completes
+    bool   deviceHRConnected;      // HR jack is connected
+    bool   deviceCADConnected;     // Cadence jack is connected
+    void publishTelemetry();
+    TelemetrySnapshot<ComputrainerTelemetry> published;
+    TelemetryButtons deviceButtons; // Button status, latched until read
+    ComputrainerTelemetry recorded; // last values sent to the recorder
+    SessionRecorder *recorder;      // where raw samples go, if recording
+    int recorderDevice;
+
     volatile int    deviceStatus;           // Device status running, paused, disconnected
 
     // OUTBOUND COMMANDS - all volatile since it is updated by the GUI thread
@@ -188,6 +224,10 @@ private:
     // i/o message holder
     uint8_t buf[7];
 
+    // inbound bytes not yet decoded into messages
+    uint8_t rxBuffer[CT_RXBUFFER];
+    int rxCount;
+
     // device port
     QString deviceFilename;
 #ifdef WIN32
@@ -200,6 +240,8 @@ private:
     // raw device utils
     int rawWrite(uint8_t *bytes, int size); // unix!!
     int rawRead(uint8_t *bytes, int size); // unix!!
+    int readAvailable(int timeout);         // whatever has arrived into rxBuffer
+    bool outputPending();                   // last command still going out
 };
 
 class CTsleeper : public QThread
@@ -110,6 +110,7 @@ ComputrainerController::getRealtimeData(RealtimeData &rtData)
     rtData.setSpeed(Speed);
 
     memcpy(rtData.spinScan, ss, 24);
+    rtData.spinScanRevCount = myComputrainer->getSpinScanRevolutions(rtData.spinScanRevs, SPINSCAN_MAXREVS);
 
     // post processing, probably not used
     // since its used to compute power for
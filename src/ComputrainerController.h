@@ -47,6 +47,8 @@ public:
     void setLoad(double);
     void setGradient(double);
     void setMode(int);
+    void setRecorder(SessionRecorder *recorder, int device) { myComputrainer->setRecorder(recorder, device); }
+    DeviceStats *stats() { return &myComputrainer->stats; }
 };
 
 #endif // _GC_ComputrainerController_h
@@ -93,28 +93,16 @@ ConfigDialog::ConfigDialog(QDir _home, Zones *_zones, Context *context) :
 
     pagesWidget = new QStackedWidget(this);
 
-    // create those config pages
-    general = new GeneralConfig(_home, _zones, context);
-    pagesWidget->addWidget(general);
-
-    athlete = new AthleteConfig(_home, _zones, context);
-    pagesWidget->addWidget(athlete);
-
-    password = new PasswordConfig(_home, _zones, context);
-    pagesWidget->addWidget(password);
-
-    appearance = new AppearanceConfig(_home, _zones, context);
-    pagesWidget->addWidget(appearance);
-
-    data = new DataConfig(_home, _zones, context);
-    pagesWidget->addWidget(data);
-
-    metric = new MetricConfig(_home, _zones, context);
-    pagesWidget->addWidget(metric);
-
-    device = new DeviceConfig(_home, _zones, context);
-    pagesWidget->addWidget(device);
-
+    // the config pages are created when first selected, the zones,
+    // metadata and metric pages in particular take a while to build
+    general = NULL;
+    athlete = NULL;
+    password = NULL;
+    appearance = NULL;
+    data = NULL;
+    metric = NULL;
+    device = NULL;
+    changePage(0);
 
     closeButton = new QPushButton(tr("Close"));
     saveButton = new QPushButton(tr("Save"));
@@ -153,7 +141,40 @@ ConfigDialog::ConfigDialog(QDir _home, Zones *_zones, Context *context) :
 
 void ConfigDialog::changePage(int index)
 {
-    pagesWidget->setCurrentIndex(index);
+    QWidget *page = NULL;
+
+    switch (index) {
+    case 0:
+        if (!general) pagesWidget->addWidget(general = new GeneralConfig(home, zones, context));
+        page = general;
+        break;
+    case 1:
+        if (!athlete) pagesWidget->addWidget(athlete = new AthleteConfig(home, zones, context));
+        page = athlete;
+        break;
+    case 2:
+        if (!password) pagesWidget->addWidget(password = new PasswordConfig(home, zones, context));
+        page = password;
+        break;
+    case 3:
+        if (!appearance) pagesWidget->addWidget(appearance = new AppearanceConfig(home, zones, context));
+        page = appearance;
+        break;
+    case 4:
+        if (!data) pagesWidget->addWidget(data = new DataConfig(home, zones, context));
+        page = data;
+        break;
+    case 5:
+        if (!metric) pagesWidget->addWidget(metric = new MetricConfig(home, zones, context));
+        page = metric;
+        break;
+    case 6:
+        if (!device) pagesWidget->addWidget(device = new DeviceConfig(home, zones, context));
+        page = device;
+        break;
+    }
+
+    if (page) pagesWidget->setCurrentWidget(page);
 }
 
 // if save is clicked, we want to:
@@ -161,13 +182,14 @@ void ConfigDialog::changePage(int index)
 //   ! new mode: change the CP associated with the present mode
 void ConfigDialog::saveClicked()
 {
-    general->saveClicked();
-    athlete->saveClicked();
-    appearance->saveClicked();
-    password->saveClicked();
-    metric->saveClicked();
-    data->saveClicked();
-    device->saveClicked();
+    // pages that were never opened have nothing to save
+    if (general) general->saveClicked();
+    if (athlete) athlete->saveClicked();
+    if (appearance) appearance->saveClicked();
+    if (password) password->saveClicked();
+    if (metric) metric->saveClicked();
+    if (data) data->saveClicked();
+    if (device) device->saveClicked();
 
     hide();
 
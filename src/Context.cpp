@@ -25,6 +25,7 @@ Context::Context(MainWindow *mainWindow)
     ride = NULL;
     workout = NULL;
     isfiltered = false;
+    telemetry = new TelemetryScheduler(this);
 }
 
 const RideFile *
@@ -21,12 +21,15 @@
 
 #include "TimeUtils.h" // for class DateRange
 #include "RealtimeData.h" // for class RealtimeData
+#include "TelemetryScheduler.h" // for class TelemetryScheduler
 #include "SpecialFields.h" // for class RealtimeData
+#include <QSet>
 
 class RideFile;
 class RideItem;
 class IntervalItem;
 class ErgFile;
+class TrainRider;
 
 class Context;
 class Athlete;
@@ -53,12 +56,15 @@ class Context : public QObject
         RideItem *ride;  // the currently selected ride
         DateRange dr_;
         ErgFile *workout; // the currently selected workout file
+        QList<TrainRider*> riders; // multi-rider session, empty otherwise
         long now; // point in time during train session
+        TelemetryScheduler *telemetry; // paces telemetry to the train windows
         SpecialFields specialFields;
 
         // search filter
         bool isfiltered;
         QStringList filters;
+        QSet<QString> filterSet; // the filters again, use this to test membership
 
         // *********************************************
         // APPLICATION EVENTS
@@ -68,11 +74,13 @@ class Context : public QObject
                                     // signal emitted to notify its children
 
         // filters
-        void setFilter(QStringList&f) { filters=f; isfiltered=true; emit filterChanged(); }
-        void clearFilter() { filters.clear(); isfiltered=false; emit filterChanged(); }
+        void setFilter(QStringList&f) { filters=f; filterSet=f.toSet(); isfiltered=true; emit filterChanged(); }
+        void clearFilter() { filters.clear(); filterSet.clear(); isfiltered=false; emit filterChanged(); }
 
         // realtime signals
-        void notifyTelemetryUpdate(const RealtimeData &rtData) { telemetryUpdate(rtData); }
+        void notifyTelemetryUpdate(const RealtimeData &rtData) { telemetryUpdate(rtData); telemetry->update(rtData); }
+        void notifyRidersUpdate(const QList<TrainRider*> &x) { riders=x; ridersUpdate(); }
+        const QList<TrainRider*> &currentRiders() { return riders; }
         void notifyErgFileSelected(ErgFile *x) { workout=x; ergFileSelected(x); }
         ErgFile *currentErgFile() { return workout; }
         void notifyMediaSelected( QString x) { mediaSelected(x); }
@@ -88,6 +96,7 @@ class Context : public QObject
         void notifySeek(long x) { emit seek(x); }
 
         void notifyRideSelected(RideItem*x) { ride=x; rideSelected(x); }
+        void notifyRideLoading(RideItem*x) { ride=x; rideLoading(x); }
         void notifyRideAdded(RideItem *x) { ride=x; rideAdded(x); }
         void notifyRideDeleted(RideItem *x) { ride=x; rideDeleted(x); }
         void notifyIntervalZoom(IntervalItem*x) { emit intervalZoom(x); }
@@ -105,6 +114,7 @@ class Context : public QObject
         void configChanged();
 
         void rideSelected(RideItem*);
+        void rideLoading(RideItem*); // selected, rideSelected() once it is read
         void rideAdded(RideItem *);
         void rideDeleted(RideItem *);
         void intervalSelected();
@@ -115,7 +125,8 @@ class Context : public QObject
         void rideClean(RideItem*);
 
         // realtime
-        void telemetryUpdate(RealtimeData rtData);
+        void telemetryUpdate(const RealtimeData &rtData);
+        void ridersUpdate();
         void ergFileSelected(ErgFile *);
         void mediaSelected(QString);
         void selectWorkout(QString); // ask traintool to select this
@@ -16,9 +16,12 @@
  * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include "MainWindow.h"
+#include "Context.h"
 #include "Athlete.h"
 #include "Zones.h"
 #include "Colors.h"
+#include "Trace.h"
 #include "CpintPlot.h"
 #include <unistd.h>
 #include <QDebug>
@@ -38,10 +41,61 @@
 #include "LTMCanvasPicker.h"
 #include "TimeUtils.h"
 
-#include <algorithm> // for std::lower_bound
+#include <QThreadPool>
+#include <algorithm> // for std::lower_bound, std::upper_bound
 
 #define USE_T0_IN_CP_MODEL 1 // added djconnel 08Apr2009: allow 3-parameter CP model
 
+// the mean max arrays have a value for every second, but on the log time axis
+// thousands of them land on the same few pixels, so the curves are drawn from
+// a few hundred durations a decade. They are real samples, not averages, so
+// every point drawn (and hovered) is an exact best.
+static const int kSamplesPerDecade = 200;
+
+// offsets into an array of n values, one a second from 1s
+static QVector<int>
+logSpaced(int n)
+{
+    QVector<int> offsets;
+    const double step = pow(10.0, 1.0 / kSamplesPerDecade);
+    double secs = 1;
+    while (secs < n) {
+        int s = int(secs);
+        offsets << s - 1;
+        secs = qMax(s + 1.0, secs * step);
+    }
+    if (n > 0) offsets << n - 1;
+    return offsets;
+}
+
+// the points at the offsets from low to high, both ends always included
+// so the zone curves still meet
+static void
+logSegment(const QVector<int> &offsets, int low, int high, const double *x, const double *y,
+           QVector<double> &xs, QVector<double> &ys)
+{
+    xs.clear();
+    ys.clear();
+    xs << x[low];
+    ys << y[low];
+    QVector<int>::const_iterator i = std::upper_bound(offsets.begin(), offsets.end(), low);
+    for (; i != offsets.end() && *i < high; ++i) {
+        xs << x[*i];
+        ys << y[*i];
+    }
+    if (high > low) {
+        xs << x[high];
+        ys << y[high];
+    }
+}
+
+// a whole mean max curve of n values from x, y
+static void
+logCurve(int n, const double *x, const double *y, QVector<double> &xs, QVector<double> &ys)
+{
+    logSegment(logSpaced(n), 0, n - 1, x, y, xs, ys);
+}
+
 CpintPlot::CpintPlot(Context *context, QString p, const Zones *zones, bool rangemode) :
     path(p),
     thisCurve(NULL),
@@ -52,6 +106,7 @@ CpintPlot::CpintPlot(Context *context, QString p, const Zones *zones, bool range
     context(context),
     current(NULL),
     bests(NULL),
+    compareYears(0),
     isFiltered(false),
     shadeMode(2),
     rangemode(rangemode)
@@ -132,7 +187,18 @@ CpintPlot::changeSeason(const QDate &start, const QDate &end)
     if (bests) {
         delete bests;
         bests = NULL;
+        fits.clear();
+        bestsCurves.clear();
     }
+    clearCompares();
+}
+
+void
+CpintPlot::setCompareYears(int n)
+{
+    if (n == compareYears) return;
+    compareYears = n;
+    clearCompares();
 }
 
 void
@@ -217,6 +283,14 @@ CpintPlot::setSeries(RideFile::SeriesType x)
 // it is assumed duration = index * seconds
 void
 CpintPlot::deriveCPParameters()
+{
+    fitCPParameters(bests->meanMaxArray(series), cp, tau, t0);
+}
+
+// the fit itself, for bests or any other mean max array, such
+// as the comparison years; cp and tau are also the initial estimates
+void
+CpintPlot::fitCPParameters(const QVector<double> &power, double &cp, double &tau, double &t0)
 {
     // bounds on anaerobic interval in minutes
     const double t1 = useT0 ? 0.25 : 1;
@@ -229,22 +303,25 @@ CpintPlot::deriveCPParameters()
     // bounds of these time valus in the data
     int i1, i2, i3, i4;
 
+    const int size = power.size();
+    if (size < 2) return;
+
     // find the indexes associated with the bounds
     // the first point must be at least the minimum for the anaerobic interval, or quit
-    for (i1 = 0; i1 < 60 * t1; i1++)
-        if (i1 + 1 >= bests->meanMaxArray(series).size())
-            return;
+    i1 = int(ceil(60 * t1));
+    if (i1 >= size) return;
     // the second point is the maximum point suitable for anaerobicly dominated efforts.
-    for (i2 = i1; i2 + 1 <= 60 * t2; i2++)
-        if (i2 + 1 >= bests->meanMaxArray(series).size())
-            return;
+    i2 = qMax(i1, int(floor(60 * t2)));
+    if (i2 > i1 && i2 >= size) return;
     // the third point is the beginning of the minimum duration for aerobic efforts
-    for (i3 = i2; i3 < 60 * t3; i3++)
-        if (i3 + 1 >= bests->meanMaxArray(series).size())
-            return;
-    for (i4 = i3; i4 + 1 <= 60 * t4; i4++)
-        if (i4 + 1 >= bests->meanMaxArray(series).size())
-            break;
+    i3 = qMax(i2, int(ceil(60 * t3)));
+    if (i3 > i2 && i3 >= size) return;
+    // the last is an hour, or as long as we have
+    i4 = qMin(qMax(i3, int(floor(60 * t4))), size - 1);
+
+    // durations in minutes for each index we use
+    QVector<double> minutes(i4 + 1);
+    for (int i = 0; i <= i4; i++) minutes[i] = i / 60.0;
 
     // initial estimate of tau
     if (tau == 0)
@@ -292,7 +369,7 @@ CpintPlot::deriveCPParameters()
         int i;
         cp = 0;
         for (i = i3; i <= i4; i++) {
-            double cpn = bests->meanMaxArray(series)[i] / (1 + tau / (t0 + i / 60.0));
+            double cpn = power[i] / (1 + tau / (t0 + minutes[i]));
             if (cp < cpn)
                 cp = cpn;
         }
@@ -304,14 +381,14 @@ CpintPlot::deriveCPParameters()
         // estimate tau, given cp
         tau = tau_min;
         for (i = i1; i <= i2; i++) {
-            double taun = (bests->meanMaxArray(series)[i] / cp - 1) * (i / 60.0 + t0) - t0;
+            double taun = (power[i] / cp - 1) * (minutes[i] + t0) - t0;
             if (tau < taun)
                 tau = taun;
         }
 
         // update t0 if we're using that model
         if (useT0) 
-            t0 = tau / (bests->meanMaxArray(series)[1] / cp - 1) - 1 / 60.0;
+            t0 = tau / (power[1] / cp - 1) - 1 / 60.0;
 
     } while ((fabs(tau - tau_prev) > tau_delta_max) ||
              (fabs(t0 - t0_prev) > t0_delta_max)
@@ -334,22 +411,9 @@ CpintPlot::plot_CP_curve(CpintPlot *thisPlot,     // the plot we're currently di
         return;
 
     // populate curve data with a CP curve
-    const int curve_points = 100;
-    double tmin = USE_T0_IN_CP_MODEL ? 1.0/60 : tau;
-    double tmax = 180.0;
-    QVector<double> cp_curve_power(curve_points);
-    QVector<double> cp_curve_time(curve_points);
-    int i;
-
-    for (i = 0; i < curve_points; i ++) {
-        double x = (double) i / (curve_points - 1);
-        double t = pow(tmax, x) * pow(tmin, 1-x);
-        cp_curve_time[i] = t;
-        if (series == RideFile::none) //this is ENERGY
-            cp_curve_power[i] = (cp * t + cp * tau) * 60.0 / 1000.0;
-        else
-            cp_curve_power[i] = cp * (1 + tau / (t + t0));
-    }
+    QVector<double> cp_curve_power;
+    QVector<double> cp_curve_time;
+    modelPoints(cp, tau, t0, cp_curve_time, cp_curve_power);
 
     // generate a plot
     QString curve_title;
@@ -383,10 +447,165 @@ CpintPlot::plot_CP_curve(CpintPlot *thisPlot,     // the plot we're currently di
     pen.setWidth(1.0);
     pen.setStyle(Qt::DashLine);
     CPCurve->setPen(pen);
-    CPCurve->setData(cp_curve_time.data(), cp_curve_power.data(), curve_points);
+    CPCurve->setData(cp_curve_time.data(), cp_curve_power.data(), cp_curve_time.size());
     CPCurve->attach(thisPlot);
 }
 
+void
+CpintPlot::modelPoints(double cp, double tau, double t0, QVector<double> &time, QVector<double> &power)
+{
+    const int curve_points = 100;
+    double tmin = USE_T0_IN_CP_MODEL ? 1.0/60 : tau;
+    double tmax = 180.0;
+    power.resize(curve_points);
+    time.resize(curve_points);
+
+    for (int i = 0; i < curve_points; i ++) {
+        double x = (double) i / (curve_points - 1);
+        double t = pow(tmax, x) * pow(tmin, 1-x);
+        time[i] = t;
+        if (series == RideFile::none) //this is ENERGY
+            power[i] = (cp * t + cp * tau) * 60.0 / 1000.0;
+        else
+            power[i] = cp * (1 + tau / (t + t0));
+    }
+}
+
+// aggregates one date range on a pool thread for fetchAggregates()
+class AggregateFetcher : public QRunnable
+{
+    public:
+        AggregateFetcher(Context *context, QDate from, QDate to, bool filter, QStringList files)
+            : result(NULL), context(context), from(from), to(to), filter(filter), files(files) {
+            setAutoDelete(false); // we collect the result
+        }
+
+        void run() { result = new RideFileCache(context, from, to, filter, files); }
+
+        RideFileCache *result;
+
+    private:
+        Context *context;
+        QDate from, to;
+        bool filter;
+        QStringList files;
+};
+
+void
+CpintPlot::fetchAggregates()
+{
+    QList<AggregateFetcher*> fetchers;
+    if (bests == NULL) fetchers << new AggregateFetcher(context, startDate, endDate, isFiltered, files);
+
+    // the comparisons are the same range shifted back by whole years, far
+    // enough that they never overlap; an open ended range has nothing to compare
+    bool bounded = startDate > QDate(1900, 1, 1) && endDate < QDate(3000, 12, 31);
+    if (compares.isEmpty() && compareYears > 0 && bounded) {
+        int span = qMax(1, int(ceil(startDate.daysTo(endDate) / 365.25)));
+        for (int k = 1; k <= compareYears; k++) {
+            QDate from = startDate.addYears(-k * span);
+            QDate to = endDate.addYears(-k * span);
+            fetchers << new AggregateFetcher(context, from, to, isFiltered, files);
+            compareNames << QString("%1 - %2").arg(from.toString(tr("dd MMM yyyy"))).arg(to.toString(tr("dd MMM yyyy")));
+        }
+    }
+    if (fetchers.isEmpty()) return;
+
+    if (fetchers.count() == 1) {
+        fetchers[0]->run();
+    } else {
+
+        // the ride list is cached lazily, so make sure it is current
+        // before the fetchers all go looking for it at once
+        context->athlete->allRideFiles();
+
+        if (context->mainWindow) context->mainWindow->setCursor(Qt::WaitCursor);
+        QThreadPool pool;
+        pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+        foreach(AggregateFetcher *fetcher, fetchers) pool.start(fetcher);
+        pool.waitForDone();
+        if (context->mainWindow) context->mainWindow->setCursor(Qt::ArrowCursor);
+    }
+
+    if (bests == NULL) {
+        bests = fetchers[0]->result;
+        delete fetchers.takeFirst();
+    }
+    foreach(AggregateFetcher *fetcher, fetchers) {
+        compares << fetcher->result;
+        delete fetcher;
+    }
+}
+
+void
+CpintPlot::clearCompares()
+{
+    foreach(RideFileCache *compare, compares) delete compare;
+    compares.clear();
+    compareNames.clear();
+
+    foreach(QwtPlotCurve *curve, compareCurves) delete curve;
+    compareCurves.clear();
+}
+
+// each previous year gets its bests and, where there is a model,
+// the fitted CP curve drawn in the same colour over the main plot
+void
+CpintPlot::plotCompares()
+{
+    foreach(QwtPlotCurve *curve, compareCurves) delete curve;
+    compareCurves.clear();
+
+    // energy is derived from the watts in plot_allCurve, not compared
+    if (series == RideFile::none) return;
+    bool model = series == RideFile::aPower || series == RideFile::watts || series == RideFile::wattsKg;
+
+    for (int k = 0; k < compares.count(); k++) {
+
+        const QVector<double> &values = compares[k]->meanMaxArray(series);
+        int maxNonZero = 0;
+        for (int i = 0; i < values.size(); ++i) if (values[i] > 0) maxNonZero = i;
+        if (maxNonZero < 2) continue;
+
+        QVector<double> timeArray(maxNonZero + 1);
+        for (int i = 0; i <= maxNonZero; ++i) timeArray[i] = i / 60.0;
+
+        // work round the colour wheel from the CP colour
+        QColor color = GColor(CCP);
+        color.setHsv((color.hue() + 60 * (k+1)) % 360, qMax(color.saturation(), 128), qMax(color.value(), 160));
+
+        QwtPlotCurve *curve = new QwtPlotCurve(compareNames[k]);
+        if (appsettings->value(this, GC_ANTIALIAS, false).toBool() == true)
+            curve->setRenderHint(QwtPlotItem::RenderAntialiased);
+        QPen pen(color);
+        pen.setWidth(1.0);
+        curve->setPen(pen);
+        QVector<double> x, y;
+        logCurve(maxNonZero, timeArray.constData() + 1, values.constData() + 1, x, y);
+        curve->setData(x.data(), y.data(), x.size());
+        curve->attach(this);
+        compareCurves << curve;
+
+        if (!model) continue;
+
+        double cp = 0, tau = 0, t0 = 0;
+        fitCPParameters(values, cp, tau, t0);
+        if (cp <= 0) continue;
+
+        QVector<double> time, power;
+        modelPoints(cp, tau, t0, time, power);
+
+        QwtPlotCurve *fitted = new QwtPlotCurve(QString("%1 CP=%2").arg(compareNames[k]).arg(cp, 0, 'f', series == RideFile::wattsKg ? 2 : 0));
+        if (appsettings->value(this, GC_ANTIALIAS, false).toBool() == true)
+            fitted->setRenderHint(QwtPlotItem::RenderAntialiased);
+        pen.setStyle(Qt::DashLine);
+        fitted->setPen(pen);
+        fitted->setData(time.data(), power.data(), time.size());
+        fitted->attach(this);
+        compareCurves << fitted;
+    }
+}
+
 void
 CpintPlot::clear_CP_Curves()
 {
@@ -421,6 +640,10 @@ CpintPlot::plot_allCurve(CpintPlot *thisPlot,
         energyBests[t] = power_values[t] * time_values[t] * 60.0 / 1000.0;
     }
 
+    // what gets drawn, see logSpaced
+    QVector<int> offsets = logSpaced(n_values);
+    QVector<double> x, y;
+
     // lets work out how we are shading it
     switch(shadeMode) {
         case 0 : // not shading!!
@@ -475,12 +698,11 @@ CpintPlot::plot_allCurve(CpintPlot *thisPlot,
             }
 
             if (series == RideFile::none) { // this is Energy mode 
-                curve->setData(time_values.data() + low,
-                               energyBests.data() + low, high - low + 1);
+                logSegment(offsets, low, high, time_values.constData(), energyBests.constData(), x, y);
             } else {
-                curve->setData(time_values.data() + low,
-                               power_values + low, high - low + 1);
+                logSegment(offsets, low, high, time_values.constData(), power_values, x, y);
             }
+            curve->setData(x.data(), y.data(), x.size());
             allCurves.append(curve);
 
             if (shadeMode && (series != RideFile::none || energyBests[high] > 100.0)) {
@@ -521,9 +743,10 @@ CpintPlot::plot_allCurve(CpintPlot *thisPlot,
         brush_color.setAlpha(200);
         //curve->setBrush(QBrush::None);   // brush fills below the line
         if (series == RideFile::none)
-            curve->setData(time_values.data(), energyBests.data(), n_values);
+            logSegment(offsets, 0, n_values - 1, time_values.constData(), energyBests.constData(), x, y);
         else
-            curve->setData(time_values.data(), power_values, n_values);
+            logSegment(offsets, 0, n_values - 1, time_values.constData(), power_values, x, y);
+        curve->setData(x.data(), y.data(), x.size());
         curve->attach(thisPlot);
         allCurves.append(curve);
     }
@@ -553,6 +776,7 @@ CpintPlot::plot_allCurve(CpintPlot *thisPlot,
 void
 CpintPlot::calculate(RideItem *rideItem)
 {
+    GC_TRACE_SPAN("cp plot");
     if (!rideItem) return;
 
     QString fileName = rideItem->fileName;
@@ -565,7 +789,7 @@ CpintPlot::calculate(RideItem *rideItem)
     current = new RideFileCache(context, context->athlete->home.absolutePath() + "/" + fileName);
 
     // get aggregates - incase not initialised from date change
-    if (bests == NULL) bests = new RideFileCache(context, startDate, endDate, isFiltered, files);
+    fetchAggregates();
 
     //
     // PLOT MODEL CURVE (DERIVED)
@@ -573,9 +797,21 @@ CpintPlot::calculate(RideItem *rideItem)
     if (series == RideFile::aPower || series == RideFile::xPower || series == RideFile::NP || series == RideFile::watts  || series == RideFile::wattsKg || series == RideFile::none) {
 
         if (bests->meanMaxArray(series).size() > 1) {
-            // calculate CP model from all-time best data
-            cp  = tau = t0  = 0;
-            deriveCPParameters();
+
+            // calculate CP model from all-time best data, unless
+            // we already fitted this series and model
+            QString key = QString("%1:%2:%3:%4").arg(series).arg(I1).arg(I2).arg(useT0);
+            if (fits.contains(key)) {
+                CPFit fit = fits.value(key);
+                cp = fit.cp;
+                tau = fit.tau;
+                t0 = fit.t0;
+            } else {
+                cp  = tau = t0  = 0;
+                deriveCPParameters();
+                CPFit fit = { cp, tau, t0 };
+                fits.insert(key, fit);
+            }
         }
 
         //
@@ -711,11 +947,22 @@ CpintPlot::calculate(RideItem *rideItem)
                 linearGradient.setSpread(QGradient::PadSpread);
                 allCurve->setBrush(linearGradient);
                 allCurve->attach(this);
-                allCurve->setData(timeArray.data() + 1, bests->meanMaxArray(series).constData() + 1, maxNonZero - 1);
+                if (!bestsCurves.contains(series)) {
+                    LogCurve &sampled = bestsCurves[series];
+                    logCurve(maxNonZero - 1, timeArray.constData() + 1, bests->meanMaxArray(series).constData() + 1,
+                             sampled.time, sampled.value);
+                }
+                const LogCurve &sampled = bestsCurves[series];
+                allCurve->setData(sampled.time.constData(), sampled.value.constData(), sampled.time.size());
             }
         }
     }
 
+    //
+    // PLOT PREVIOUS YEARS
+    //
+    plotCompares();
+
     //
     // PLOT THIS RIDE CURVE
     //
@@ -751,13 +998,17 @@ CpintPlot::calculate(RideItem *rideItem)
                     timeArray[i] * 
                     current->meanMaxArray(RideFile::watts)[i] * 60.0 / 1000.0;
                 }
-                thisCurve->setData(timeArray.data() + 1, energyArray.constData() + 1, maxNonZero - 1);
+                QVector<double> x, y;
+                logCurve(maxNonZero - 1, timeArray.constData() + 1, energyArray.constData() + 1, x, y);
+                thisCurve->setData(x.data(), y.data(), x.size());
 
             } else {
 
                 // normal
-                thisCurve->setData(timeArray.data() + 1, 
-                current->meanMaxArray(series).constData() + 1, maxNonZero - 1);
+                QVector<double> x, y;
+                logCurve(maxNonZero - 1, timeArray.constData() + 1,
+                         current->meanMaxArray(series).constData() + 1, x, y);
+                thisCurve->setData(x.data(), y.data(), x.size());
             }
         }
     }
@@ -783,13 +1034,16 @@ CpintPlot::pointHover(QwtPlotCurve *curve, int index)
 
         // add when to tooltip if its all curve
         if (allCurves.contains(curve)) {
-            int index = xvalue * 60;
+            int index = qRound(xvalue * 60);
             if (index >= 0 && getBests().count() > index) {
                 QDate date = getBestDates()[index];
                 dateStr = date.toString("\nddd, dd MMM yyyy");
             }
         }
 
+        // and which year for the comparisons
+        if (compareCurves.contains(curve)) dateStr = "\n" + curve->title().text();
+
             // output the tooltip
         text = QString("%1\n%3 %4%5")
             .arg(interval_to_str(60.0*xvalue))
@@ -812,6 +1066,9 @@ CpintPlot::clearFilter()
     files.clear();
     delete bests;
     bests = NULL;
+    fits.clear();
+    bestsCurves.clear();
+    clearCompares();
 }
 
 void
@@ -821,6 +1078,9 @@ CpintPlot::setFilter(QStringList list)
     files = list;
     delete bests;
     bests = NULL;
+    fits.clear();
+    bestsCurves.clear();
+    clearCompares();
 }
 
 void
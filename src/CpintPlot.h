@@ -95,12 +95,14 @@ class CpintPlot : public QwtPlot
         double cp, tau, t0; // CP model parameters
         double shadingCP; // the CP value we use to draw the shade
         void deriveCPParameters();
+        void fitCPParameters(const QVector<double> &power, double &cp, double &tau, double &t0);
         void changeSeason(const QDate &start, const QDate &end);
         void setAxisTitle(int axis, QString label);
         void setSeries(RideFile::SeriesType);
+        void setCompareYears(int n);
 
         QVector<double> getBests() { return bests->meanMaxArray(series); }
-        QVector<QDate> getBestDates() { return bests->meanMaxDates(series); }
+        const MeanMaxDates &getBestDates() { return bests->meanMaxDates(series); }
 
         QDate startDate;
         QDate endDate;
@@ -128,6 +130,7 @@ class CpintPlot : public QwtPlot
         QwtPlotMarker curveTitle;
         QList<QwtPlotMarker*> allZoneLabels;
         void clear_CP_Curves();
+        void modelPoints(double cp, double tau, double t0, QVector<double> &time, QVector<double> &power);
         QStringList filterForSeason(QStringList cpints, QDate startDate, QDate endDate);
         QwtPlotGrid *grid;
         const Zones *zones;
@@ -136,6 +139,25 @@ class CpintPlot : public QwtPlot
         Context *context;
 
         RideFileCache *current, *bests;
+
+        // the same range in previous years, aggregated alongside bests
+        int compareYears;
+        QList<RideFileCache*> compares;
+        QStringList compareNames;
+        QList<QwtPlotCurve*> compareCurves;
+        void fetchAggregates();
+        void clearCompares();
+        void plotCompares();
+
+        // model parameters fitted to bests, by series and model
+        // so selecting rides or switching back and forth doesn't refit
+        struct CPFit { double cp, tau, t0; };
+        QHash<QString, CPFit> fits;
+
+        // the bests curve as drawn, resampled evenly in log time, by series
+        // so it is only done once for each date range and filter
+        struct LogCurve { QVector<double> time, value; };
+        QHash<int, LogCurve> bestsCurves;
         LTMCanvasPicker *canvasPicker;
         penTooltip *zoomer;
 
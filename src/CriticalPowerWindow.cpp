@@ -173,6 +173,15 @@ CriticalPowerWindow::CriticalPowerWindow(const QDir &home, Context *context, boo
     shadeCombo->setCurrentIndex(2);
     cl->addRow(shading, shadeCombo);
 
+    // same range in previous years
+    compareSpin = new QSpinBox(this);
+    compareSpin->setMinimum(0);
+    compareSpin->setMaximum(5);
+    compareSpin->setValue(0);
+    compareSpin->setSpecialValueText(tr("None"));
+    compareSpin->setAlignment(Qt::AlignRight);
+    cl->addRow(new QLabel(tr("Compare previous years")), compareSpin);
+
     // model config
     // 2 or 3 point model ?
     modelCombo= new QComboBox(this);
@@ -238,6 +247,7 @@ CriticalPowerWindow::CriticalPowerWindow(const QDir &home, Context *context, boo
     connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(newRideAdded(RideItem*)));
     connect(seasons, SIGNAL(seasonsChanged()), this, SLOT(resetSeasons()));
     connect(shadeCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(shadingSelected(int)));
+    connect(compareSpin, SIGNAL(valueChanged(int)), this, SLOT(compareSelected(int)));
     connect(dateSetting, SIGNAL(useCustomRange(DateRange)), this, SLOT(useCustomRange(DateRange)));
     connect(dateSetting, SIGNAL(useThruToday()), this, SLOT(useThruToday()));
     connect(dateSetting, SIGNAL(useStandardRange()), this, SLOT(useStandardRange()));
@@ -386,27 +396,9 @@ CriticalPowerWindow::showIntervalCurve(IntervalItem *current, int index)
 
     // ack, we need to create the curve for this interval
 
-    // make a ridefile
-    RideFile f;
-    f.context = context; // hack, until we refactor athlete and mainwindow
-    f.setRecIntSecs(myRideItem->ride()->recIntSecs());
-   
-    foreach(RideFilePoint *p, myRideItem->ride()->dataPoints()) { 
-       if (p->secs+f.recIntSecs() > current->start && p->secs< current->stop) {
-           f.appendPoint(p->secs, p->cad, p->hr, p->km, p->kph, p->nm,
-                       p->watts, p->alt, p->lon, p->lat, p->headwind,
-                       p->slope, p->temp, p->lrbalance, 0);
-       }
-
-        // for xpower et al
-       f.recalculateDerivedSeries();
-    }
-
-    // compute the mean max, this is BLAZINGLY fast, thanks to Mark Rages'
-    // mean-max computer. Does a 11hr ride in 150ms
-    QVector<float>vector;
-    MeanMaxComputer thread1(&f, vector, series()); thread1.run();
-    thread1.wait();
+    // the mean max, from the cache if we've seen this interval before
+    // otherwise Mark Rages' mean-max computer is BLAZINGLY fast anyway
+    QVector<float> vector = RideFileCache::intervalMeanMax(myRideItem, current->start, current->stop, series());
 
     // no data!
     if (vector.count() == 0) return;
@@ -812,3 +804,14 @@ CriticalPowerWindow::shadingSelected(int shading)
     if (rangemode) dateRangeChanged(DateRange());
     else cpintPlot->calculate(currentRide);
 }
+
+void
+CriticalPowerWindow::compareSelected(int years)
+{
+    cpintPlot->setCompareYears(years);
+    if (rangemode) {
+        stale = true; // same range, but it needs the other years
+        dateRangeChanged(DateRange());
+    }
+    else cpintPlot->calculate(currentRide);
+}
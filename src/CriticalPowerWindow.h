@@ -60,6 +60,7 @@ class CriticalPowerWindow : public GcChartWindow
     Q_PROPERTY(int lastNX READ lastNX WRITE setLastNX USER true)
     Q_PROPERTY(int prevN READ prevN WRITE setPrevN USER true)
     Q_PROPERTY(int shading READ shading WRITE setShading USER true)
+    Q_PROPERTY(int compareYears READ compareYears WRITE setCompareYears USER true)
     Q_PROPERTY(int useSelected READ useSelected WRITE setUseSelected USER true) // !! must be last property !!
 
     public:
@@ -128,6 +129,9 @@ class CriticalPowerWindow : public GcChartWindow
         int shading() { return shadeCombo->currentIndex(); }
         void setShading(int x) { return shadeCombo->setCurrentIndex(x); }
 
+        int compareYears() { return compareSpin->value(); }
+        void setCompareYears(int x) { return compareSpin->setValue(x); }
+
 
     protected slots:
         void forceReplot();
@@ -139,6 +143,7 @@ class CriticalPowerWindow : public GcChartWindow
         void intervalsChanged();
         void seasonSelected(int season);
         void shadingSelected(int shading);
+        void compareSelected(int years);
         void setSeries(int index);
         void resetSeasons();
         void filterChanged();
@@ -171,6 +176,7 @@ class CriticalPowerWindow : public GcChartWindow
         QComboBox *modelCombo;
         QComboBox *cComboSeason;
         QComboBox *shadeCombo;
+        QSpinBox *compareSpin;
         QwtPlotPicker *picker;
         void addSeries();
         Seasons *seasons;
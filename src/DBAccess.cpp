@@ -19,6 +19,7 @@
 #include "MainWindow.h"
 #include "Athlete.h"
 #include "DBAccess.h"
+#include "Trace.h"
 #include <QtSql>
 #include <QtGui>
 #include "RideFile.h"
@@ -26,6 +27,7 @@
 #include "Settings.h"
 #include "RideItem.h"
 #include "RideMetric.h"
+#include "FormulaMetric.h"
 #include "TimeUtils.h"
 #include <math.h>
 #include <QtXml/QtXml>
@@ -70,10 +72,23 @@
 // 50  29  Oct 2013 Mark Liversedge    Added percentage time in heartrate zone
 // 51  05  Nov 2013 Mark Liversedge    Added average aPower
 // 52  05  Nov 2013 Mark Liversedge    Added EOA - Effect of Altitude
-
-int DBSchemaVersion = 52;
-
-DBAccess::DBAccess(Context* context) : context(context), db(NULL)
+// 53  14  Oct 2026                    Peak Power metrics share a single pass peak_power_bests metric
+// 54  14  Oct 2026                    Time in zone metrics share single pass time_in_zones / time_in_hr_zones
+// 55  14  Oct 2026                    Intervals table for peak, climb and W' intervals found at import
+// 56  14  Oct 2026                    Named filter results kept with the metrics
+// 57  14  Oct 2026                    Bests at standard durations kept with the metrics
+// 58  14  Oct 2026                    Fingerprint of the ride samples so metadata edits don't recompute everything
+// 59  14  Oct 2026                    Power and HR zone fingerprints and weights kept apart for targeted refresh
+// 60  14  Oct 2026                    Segment index cells and efforts for each ride
+// 61  14  Oct 2026                    Daily rollups of the metrics for long term charts
+// 62  14  Oct 2026                    Full text search table of the metadata texts
+// 63  14  Oct 2026                    Content fingerprints for finding duplicate rides
+// 64  14  Oct 2026                    Fingerprint of the ride file so a synced copy needn't be recomputed
+// 65  15  Oct 2026                    Profile of each ride for the navigator sparklines
+
+int DBSchemaVersion = 65;
+
+DBAccess::DBAccess(Context* context) : context(context), db(NULL), insertQuery(NULL), textSearch(false)
 {
     // check we have one and use built in if not there
     RideMetadata::readXML(":/xml/measures.xml", mkeywordDefinitions, mfieldDefinitions, mcolorfield);
@@ -82,6 +97,7 @@ DBAccess::DBAccess(Context* context) : context(context), db(NULL)
 
 DBAccess::~DBAccess()
 {
+    delete insertQuery; // before the connection goes
     if (db) {
         db->close();
         delete db;
@@ -113,6 +129,17 @@ DBAccess::initDatabase(QDir home)
                                        "Click Cancel to exit."), QMessageBox::Cancel);
     } else {
 
+        // a bigger page cache helps the full table reads, the
+        // write ahead log lets readers carry on during a refresh
+        // but needs SQLite 3.7 so it is optional
+        QSqlQuery query(db->database(sessionid));
+        int cachesize = appsettings->value(NULL, GC_DB_CACHESIZE, 4000).toInt();
+        query.exec(QString("PRAGMA cache_size = %1;").arg(cachesize));
+        if (appsettings->value(NULL, GC_DB_WAL, false).toBool()) {
+            query.exec("PRAGMA journal_mode = WAL;");
+            query.exec("PRAGMA synchronous = NORMAL;");
+        }
+
         // create database - does nothing if its already there
         createDatabase();
     }
@@ -163,7 +190,13 @@ bool DBAccess::createMetricsTable()
                                     "timestamp integer,"
                                     "ride_date date,"
                                     "color varchar,"
-                                    "fingerprint integer";
+                                    "fingerprint integer,"
+                                    "hrfingerprint integer,"
+                                    "samples integer,"
+                                    "weight double,"
+                                    "athleteweight double,"
+                                    "content integer,"
+                                    "profile blob";
 
         // Add columns for all the metric factory metrics
         const RideMetricFactory &factory = RideMetricFactory::instance();
@@ -188,9 +221,73 @@ bool DBAccess::createMetricsTable()
         rc = query.exec(createMetricTable);
         //if (!rc) qDebug()<<"create table failed!"  << query.lastError();
 
+        // the detected intervals live and die with the metrics
+        query.exec("DROP TABLE intervals");
+        query.exec("create table intervals (filename varchar,"
+                   "type varchar,"
+                   "name varchar,"
+                   "start double,"
+                   "stop double,"
+                   "value double )");
+        query.exec("create index intervals_filename on intervals (filename)");
+
+        // as are the results of the named filters
+        query.exec("DROP TABLE namedfilters");
+        query.exec("DROP TABLE namedfilterrides");
+        query.exec("create table namedfilters (text varchar primary key, timestamp integer)");
+        query.exec("create table namedfilterrides (text varchar, filename varchar)");
+        query.exec("create index namedfilterrides_text on namedfilterrides (text)");
+
+        // and the bests from each ride's .cpx, see RideFileCache::standardBests
+        query.exec("DROP TABLE bests");
+        query.exec("create table bests (filename varchar primary key, bests blob)");
+
+        // and the segment index and efforts, the segments are kept
+        query.exec("DROP TABLE trackcells");
+        query.exec("DROP TABLE efforts");
+        query.exec("create table trackcells (filename varchar, cell varchar)");
+        query.exec("create index trackcells_cell on trackcells (cell)");
+        query.exec("create index trackcells_filename on trackcells (filename)");
+        query.exec("create table efforts (segment integer,"
+                   "filename varchar,"
+                   "start double,"
+                   "stop double,"
+                   "watts double,"
+                   "hr double )");
+        query.exec("create index efforts_segment on efforts (segment)");
+        query.exec("create index efforts_filename on efforts (filename)");
+
+        // and the daily rollups, with the days waiting to be redone
+        query.exec("DROP TABLE daily");
+        query.exec("DROP TABLE dailystale");
+        query.exec("create table daily (symbol varchar,"
+                   "day date,"
+                   "rides integer,"
+                   "total double,"
+                   "peak double,"
+                   "low double,"
+                   "seconds double,"
+                   "weighted double,"
+                   "primary key (symbol, day) )");
+        query.exec("create table dailystale (day date primary key)");
+
+        // and what each ride is, for finding duplicates
+        query.exec("DROP TABLE fingerprints");
+        query.exec("create table fingerprints (filename varchar primary key,"
+                   "start integer,"
+                   "duration integer,"
+                   "content integer )");
+        query.exec("create index fingerprints_start on fingerprints (start)");
+        query.exec("create index fingerprints_content on fingerprints (content)");
+
+        // and the metadata texts for searching, fts5 if we have it
+        query.exec("DROP TABLE textsearch");
+        if (!query.exec("create virtual table textsearch using fts5 (filename unindexed, contents)"))
+            query.exec("create virtual table textsearch using fts4 (filename, contents)");
+
         // add row to version database
         QString metadataXML =  QString(context->athlete->home.absolutePath()) + "/metadata.xml";
-        int metadatacrcnow = computeFileCRC(metadataXML);
+        int metadatacrcnow = computeFileCRC(metadataXML) ^ FormulaMetric::fingerprint();
         QDateTime timestamp = QDateTime::currentDateTime();
 
         // wipe current version row
@@ -203,13 +300,50 @@ bool DBAccess::createMetricsTable()
 	    query.addBindValue(metadatacrcnow);
         rc = query.exec();
     }
+
+    // date range queries use this, and existing tables can just have it added
+    if (rc) query.exec("CREATE INDEX IF NOT EXISTS metrics_ride_date ON metrics (ride_date)");
+
+    // the user's segments outlive the metrics, the efforts are found again
+    if (rc) query.exec("CREATE TABLE IF NOT EXISTS segments (id integer primary key, name varchar, automatic integer, route blob)");
+
+    // sqlite may have been built without any full text search
+    textSearch = false;
+    if (rc && query.exec("SELECT name FROM sqlite_master WHERE name = 'textsearch';") && query.next())
+        textSearch = true;
     return rc;
 }
 
 bool DBAccess::dropMetricTable()
 {
+    // the prepared insert goes with the table
+    delete insertQuery;
+    insertQuery = NULL;
+
     QSqlQuery query("DROP TABLE metrics", db->database(sessionid));
     bool rc = query.exec();
+
+    QSqlQuery intervals("DROP TABLE intervals", db->database(sessionid));
+    intervals.exec();
+    QSqlQuery filters("DROP TABLE namedfilters", db->database(sessionid));
+    filters.exec();
+    QSqlQuery filterrides("DROP TABLE namedfilterrides", db->database(sessionid));
+    filterrides.exec();
+    QSqlQuery bests("DROP TABLE bests", db->database(sessionid));
+    bests.exec();
+    QSqlQuery trackcells("DROP TABLE trackcells", db->database(sessionid));
+    trackcells.exec();
+    QSqlQuery efforts("DROP TABLE efforts", db->database(sessionid));
+    efforts.exec();
+    QSqlQuery daily("DROP TABLE daily", db->database(sessionid));
+    daily.exec();
+    QSqlQuery dailystale("DROP TABLE dailystale", db->database(sessionid));
+    dailystale.exec();
+    QSqlQuery fingerprints("DROP TABLE fingerprints", db->database(sessionid));
+    fingerprints.exec();
+    QSqlQuery textsearch("DROP TABLE textsearch", db->database(sessionid));
+    textsearch.exec();
+    textSearch = false;
     return rc;
 }
 
@@ -293,9 +427,10 @@ bool DBAccess::createDatabase()
 
 void DBAccess::checkDBVersion()
 {
-    // get a CRC for metadata.xml
+    // get a CRC for metadata.xml, and the formula metrics since
+    // they have columns in the metrics table too
     QString metadataXML =  QString(context->athlete->home.absolutePath()) + "/metadata.xml";
-    int metadatacrcnow = computeFileCRC(metadataXML);
+    int metadatacrcnow = computeFileCRC(metadataXML) ^ FormulaMetric::fingerprint();
 
     // get a CRC for measures.xml
     //QString measuresXML =  QString(home.absolutePath()) + "/measures.xml";
@@ -384,20 +519,16 @@ int DBAccess::getDBVersion()
 /*----------------------------------------------------------------------
  * CRUD routines for Metrics table
  *----------------------------------------------------------------------*/
-bool DBAccess::importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor color, unsigned long fingerprint, bool modify)
+bool DBAccess::importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor color, const MetricFingerprints &fingerprints, bool modify)
 {
-	QSqlQuery query(db->database(sessionid));
+    GC_TRACE_SPAN("db import ride");
+    Q_UNUSED(modify); // the insert replaces any existing row
     QDateTime timestamp = QDateTime::currentDateTime();
 
-    if (modify) {
-        // zap the current row
-	    query.prepare("DELETE FROM metrics WHERE filename = ?;");
-	    query.addBindValue(summaryMetrics->getFileName());
-        query.exec();
-    }
-
-    // construct an insert statement
-    QString insertStatement = "insert into metrics ( filename, identifier, timestamp, ride_date, color, fingerprint ";
+    // construct an insert statement, replacing the current row
+    // since the filename is the primary key
+    QString insertStatement = "insert or replace into metrics ( filename, identifier, timestamp, ride_date, color, "
+                              "fingerprint, hrfingerprint, samples, weight, athleteweight, content ";
     const RideMetricFactory &factory = RideMetricFactory::instance();
     for (int i=0; i<factory.metricCount(); i++)
         insertStatement += QString(", X%1 ").arg(factory.metricName(i));
@@ -415,7 +546,7 @@ bool DBAccess::importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor
         }
     }
 
-    insertStatement += " ) values (?,?,?,?,?,?"; // filename, identifier, timestamp, ride_date, color, fingerprint
+    insertStatement += " ) values (?,?,?,?,?,?,?,?,?,?,?"; // filename, identifier, timestamp, ride_date, color and fingerprints
     for (int i=0; i<factory.metricCount(); i++)
         insertStatement += ",?";
     foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
@@ -425,7 +556,14 @@ bool DBAccess::importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor
     }
     insertStatement += ")";
 
-	query.prepare(insertStatement);
+    // only prepare it when the metadata fields change
+    if (insertQuery == NULL || insertStatement != this->insertStatement) {
+        delete insertQuery;
+        insertQuery = new QSqlQuery(db->database(sessionid));
+        insertQuery->prepare(insertStatement);
+        this->insertStatement = insertStatement;
+    }
+    QSqlQuery &query = *insertQuery;
 
     // filename, timestamp, ride date
 	query.addBindValue(summaryMetrics->getFileName());
@@ -433,11 +571,16 @@ bool DBAccess::importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor
 	query.addBindValue(timestamp.toTime_t());
     query.addBindValue(summaryMetrics->getRideDate());
     query.addBindValue(color.name());
-    query.addBindValue((int)fingerprint);
+    query.addBindValue((int)fingerprints.zones);
+    query.addBindValue((int)fingerprints.hrZones);
+    query.addBindValue((int)fingerprints.samples);
+    query.addBindValue(fingerprints.weight);
+    query.addBindValue(fingerprints.athleteWeight);
+    query.addBindValue((int)fingerprints.content);
 
     // values
     for (int i=0; i<factory.metricCount(); i++) {
-	    query.addBindValue(summaryMetrics->getForSymbol(factory.metricName(i)));
+	    query.addBindValue(summaryMetrics->getForIndex(i));
     }
 
     // And all the metadata texts
@@ -460,12 +603,93 @@ bool DBAccess::importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor
 
     // go do it!
 	bool rc = query.exec();
+    query.finish(); // stays prepared for the next ride
 
 	//if(!rc) qDebug() << query.lastError();
 
+    if (rc) {
+        dailyStale(summaryMetrics->getRideDate().date());
+        indexText(summaryMetrics->getFileName(), ride);
+        if (ride) importFingerprint(summaryMetrics->getFileName(), RideFingerprint(ride));
+    }
 	return rc;
 }
 
+// the samples of the ride are unchanged, so just the metadata columns,
+// fingerprints and the metrics named in symbols that depend upon
+// whatever did change are written
+bool DBAccess::updateRide(SummaryMetrics *summaryMetrics, const QStringList &symbols, RideFile *ride, QColor color,
+                          const MetricFingerprints &fingerprints)
+{
+    GC_TRACE_SPAN("db update ride");
+    QDateTime timestamp = QDateTime::currentDateTime();
+
+    QString updateStatement = "update metrics set identifier = ?, timestamp = ?, color = ?, fingerprint = ?, "
+                              "hrfingerprint = ?, samples = ?, weight = ?, athleteweight = ?, content = ?";
+    foreach(QString symbol, symbols)
+        updateStatement += QString(", X%1 = ?").arg(symbol);
+
+    // the metadata texts and then metrics, as importRide
+    foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
+        if (!context->specialFields.isMetric(field.name) && (field.type < 3 || field.type == 7)) {
+            updateStatement += QString(", Z%1 = ?").arg(context->specialFields.makeTechName(field.name));
+        }
+    }
+    foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
+        if (!context->specialFields.isMetric(field.name) && (field.type == 3 || field.type == 4)) {
+            updateStatement += QString(", Z%1 = ?").arg(context->specialFields.makeTechName(field.name));
+        }
+    }
+    updateStatement += " where filename = ?";
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare(updateStatement);
+
+    query.addBindValue(summaryMetrics->getId());
+    query.addBindValue(timestamp.toTime_t());
+    query.addBindValue(color.name());
+    query.addBindValue((int)fingerprints.zones);
+    query.addBindValue((int)fingerprints.hrZones);
+    query.addBindValue((int)fingerprints.samples);
+    query.addBindValue(fingerprints.weight);
+    query.addBindValue(fingerprints.athleteWeight);
+    query.addBindValue((int)fingerprints.content);
+    foreach(QString symbol, symbols)
+        query.addBindValue(summaryMetrics->getForSymbol(symbol));
+
+    foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
+        if (!context->specialFields.isMetric(field.name) && (field.type < 3 || field.type == 7)) {
+            query.addBindValue(ride->getTag(field.name, ""));
+        }
+    }
+    foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
+        if (!context->specialFields.isMetric(field.name) && (field.type == 3 || field.type == 4)) {
+            query.addBindValue(ride->getTag(field.name, "0.0").toDouble());
+        }
+    }
+    query.addBindValue(summaryMetrics->getFileName());
+
+    bool rc = query.exec() && query.numRowsAffected() > 0;
+    if (rc) {
+        dailyStale(summaryMetrics->getRideDate().date());
+        indexText(summaryMetrics->getFileName(), ride);
+    }
+    return rc;
+}
+
+// the metrics stored are still those of the file, only its date
+// changed (e.g. copied by a sync), so they count as written now
+bool
+DBAccess::touchRide(QString name)
+{
+    QSqlQuery query(db->database(sessionid));
+
+    query.prepare("UPDATE metrics SET timestamp = ? WHERE filename = ?;");
+    query.addBindValue(QDateTime::currentDateTime().toTime_t());
+    query.addBindValue(name);
+    return query.exec();
+}
+
 bool
 DBAccess::deleteRide(QString name)
 {
@@ -473,9 +697,612 @@ DBAccess::deleteRide(QString name)
 
     query.prepare("DELETE FROM metrics WHERE filename = ?;");
     query.addBindValue(name);
+    bool rc = query.exec();
+
+    query.prepare("DELETE FROM intervals WHERE filename = ?;");
+    query.addBindValue(name);
+    query.exec();
+
+    query.prepare("DELETE FROM bests WHERE filename = ?;");
+    query.addBindValue(name);
+    query.exec();
+
+    query.prepare("DELETE FROM trackcells WHERE filename = ?;");
+    query.addBindValue(name);
+    query.exec();
+
+    query.prepare("DELETE FROM efforts WHERE filename = ?;");
+    query.addBindValue(name);
+    query.exec();
+
+    query.prepare("DELETE FROM fingerprints WHERE filename = ?;");
+    query.addBindValue(name);
+    query.exec();
+
+    if (textSearch) {
+        query.prepare("DELETE FROM textsearch WHERE filename = ?;");
+        query.addBindValue(name);
+        query.exec();
+    }
+
+    QDateTime date;
+    if (RideFile::parseRideFileName(name, &date)) dailyStale(date.date());
+    return rc;
+}
+
+/*----------------------------------------------------------------------
+ * Duplicates
+ *----------------------------------------------------------------------*/
+
+bool
+DBAccess::importFingerprint(QString filename, const RideFingerprint &fingerprint)
+{
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("INSERT OR REPLACE INTO fingerprints (filename, start, duration, content) values (?,?,?,?);");
+    query.addBindValue(filename);
+    query.addBindValue(fingerprint.start);
+    query.addBindValue(fingerprint.duration);
+    query.addBindValue(fingerprint.content);
     return query.exec();
 }
 
+QStringList
+DBAccess::findDuplicates(const RideFingerprint &fingerprint)
+{
+    QStringList returning;
+
+    // either index narrows it to a handful, matches() has the last word
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("SELECT filename, start, duration, content FROM fingerprints "
+                  "WHERE (content = ? AND content != 0) OR (start BETWEEN ? AND ? AND start != 0);");
+    query.addBindValue(fingerprint.content);
+    query.addBindValue(fingerprint.start - RideFingerprint::startMinutes);
+    query.addBindValue(fingerprint.start + RideFingerprint::startMinutes);
+
+    bool rc = query.exec();
+    while (rc && query.next()) {
+        RideFingerprint stored;
+        stored.start = query.value(1).toLongLong();
+        stored.duration = query.value(2).toInt();
+        stored.content = query.value(3).toInt();
+        if (fingerprint.matches(stored)) returning << query.value(0).toString();
+    }
+    return returning;
+}
+
+/*----------------------------------------------------------------------
+ * Free text search
+ *----------------------------------------------------------------------*/
+
+// all the metadata texts run together, as Lucene indexed them
+void
+DBAccess::indexText(QString filename, RideFile *ride)
+{
+    if (!textSearch || ride == NULL) return;
+
+    QString contents;
+    foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
+        if (!context->specialFields.isMetric(field.name) && (field.type < 3 || field.type == 7)) {
+            contents += ride->getTag(field.name, "") + " ";
+        }
+    }
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("DELETE FROM textsearch WHERE filename = ?;");
+    query.addBindValue(filename);
+    query.exec();
+
+    query.prepare("INSERT INTO textsearch (filename, contents) values (?,?);");
+    query.addBindValue(filename);
+    query.addBindValue(contents);
+    query.exec();
+}
+
+QStringList
+DBAccess::searchText(QString text, QString where, QList<QVariant> values)
+{
+    QStringList returning;
+    if (!textSearch) return returning;
+
+    // each word is quoted so punctuation is just punctuation, and
+    // they must all match, but OR and NOT still work as expected
+    QStringList terms;
+    foreach(QString word, text.split(QRegExp("\\s+"), QString::SkipEmptyParts)) {
+        if (word == "AND") continue; // it is anyway
+        if (word == "OR" || word == "NOT") terms << word;
+        else terms << QString("\"%1\"").arg(QString(word).replace("\"", "\"\""));
+    }
+    if (terms.isEmpty()) return returning;
+
+    QString select = "SELECT textsearch.filename FROM textsearch";
+    if (where != "") select += " JOIN metrics ON metrics.filename = textsearch.filename";
+    select += " WHERE textsearch MATCH ?";
+    if (where != "") select += " AND (" + where + ")";
+    select += ";";
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare(select);
+    query.addBindValue(terms.join(" "));
+    foreach(QVariant value, values) query.addBindValue(value);
+
+    if (query.exec()) {
+        while (query.next()) returning << query.value(0).toString();
+    }
+    return returning;
+}
+
+/*----------------------------------------------------------------------
+ * Daily rollups of the metrics
+ *----------------------------------------------------------------------*/
+
+double
+DailyMetric::value(int type) const
+{
+    switch (type) {
+    case RideMetric::Average: return seconds ? weighted / seconds : (rides ? total / rides : 0);
+    case RideMetric::Peak: return peak;
+    case RideMetric::Low: return low;
+    default:
+    case RideMetric::Total: return total;
+    }
+}
+
+void
+DBAccess::dailyStale(QDate day)
+{
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("INSERT OR IGNORE INTO dailystale (day) values (?);");
+    query.addBindValue(day.toString(Qt::ISODate));
+    query.exec();
+}
+
+// worked out again from the day's rides, a ride's values can't
+// be taken back out of the peak or low once they are in
+void
+DBAccess::rollupDay(QDate day)
+{
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("DELETE FROM daily WHERE day = ?;");
+    query.addBindValue(day.toString(Qt::ISODate));
+    query.exec();
+
+    QStringList symbols;
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    for (int i=0; i<factory.metricCount(); i++) symbols << factory.metricName(i);
+    QList<SummaryMetrics> rides = getMetricsFor(QDateTime(day, QTime(0,0,0)), QDateTime(day, QTime(23,59,59)), symbols);
+    if (rides.isEmpty()) return;
+
+    int duration = factory.metricIndex("workout_time");
+    query.prepare("INSERT INTO daily (symbol, day, rides, total, peak, low, seconds, weighted) "
+                  "values (?,?,?,?,?,?,?,?);");
+    for (int i=0; i<factory.metricCount(); i++) {
+
+        DailyMetric daily;
+        foreach(const SummaryMetrics &ride, rides) {
+            double value = ride.getForIndex(i);
+            if (value == 0 || isnan(value) || isinf(value)) continue;
+
+            DailyMetric one;
+            one.rides = 1;
+            one.total = one.peak = one.low = value;
+            one.seconds = duration >= 0 ? ride.getForIndex(duration) : 0;
+            one.weighted = value * one.seconds;
+            daily.add(one);
+        }
+        if (daily.rides == 0) continue;
+
+        query.addBindValue(factory.metricName(i));
+        query.addBindValue(day.toString(Qt::ISODate));
+        query.addBindValue(daily.rides);
+        query.addBindValue(daily.total);
+        query.addBindValue(daily.peak);
+        query.addBindValue(daily.low);
+        query.addBindValue(daily.seconds);
+        query.addBindValue(daily.weighted);
+        query.exec();
+    }
+}
+
+void
+DBAccess::flushDaily()
+{
+    GC_TRACE_SPAN("db flush daily");
+    QList<QDate> days;
+    QSqlQuery query("SELECT day FROM dailystale;", db->database(sessionid));
+    if (!query.exec()) return;
+    while (query.next()) days << QDate::fromString(query.value(0).toString(), Qt::ISODate);
+    query.finish();
+    if (days.isEmpty()) return;
+
+    foreach(QDate day, days) if (day.isValid()) rollupDay(day);
+
+    QSqlQuery done("DELETE FROM dailystale;", db->database(sessionid));
+    done.exec();
+}
+
+QList<DailyMetric>
+DBAccess::getDailyFor(QDate start, QDate end, QString symbol)
+{
+    flushDaily();
+
+    QList<DailyMetric> returning;
+    QSqlQuery query(db->database(sessionid));
+    query.setForwardOnly(true);
+    query.prepare("SELECT day, rides, total, peak, low, seconds, weighted FROM daily "
+                  "WHERE symbol = ? AND day >= ? AND day <= ? ORDER BY day;");
+    query.addBindValue(symbol);
+    query.addBindValue(start.toString(Qt::ISODate));
+    query.addBindValue(end.toString(Qt::ISODate));
+    if (!query.exec()) return returning;
+
+    while (query.next()) {
+        DailyMetric add;
+        add.day = QDate::fromString(query.value(0).toString(), Qt::ISODate);
+        add.rides = query.value(1).toInt();
+        add.total = query.value(2).toDouble();
+        add.peak = query.value(3).toDouble();
+        add.low = query.value(4).toDouble();
+        add.seconds = query.value(5).toDouble();
+        add.weighted = query.value(6).toDouble();
+        returning << add;
+    }
+    return returning;
+}
+
+bool
+DBAccess::importTrack(QString filename, const QStringList &cells)
+{
+    QSqlQuery query(db->database(sessionid));
+
+    query.prepare("DELETE FROM trackcells WHERE filename = ?;");
+    query.addBindValue(filename);
+    bool rc = query.exec();
+
+    query.prepare("insert into trackcells ( filename, cell ) values ( ?,? );");
+    foreach(QString cell, cells) {
+        query.addBindValue(filename);
+        query.addBindValue(cell);
+        if (!query.exec()) rc = false;
+    }
+    return rc;
+}
+
+QStringList
+DBAccess::getRidesThrough(QString startCell, QString endCell)
+{
+    QStringList rides;
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("SELECT DISTINCT a.filename FROM trackcells a, trackcells b "
+                  "WHERE a.cell = ? AND b.cell = ? AND a.filename = b.filename;");
+    query.addBindValue(startCell);
+    query.addBindValue(endCell);
+    query.exec();
+    while(query.next()) rides << query.value(0).toString();
+    return rides;
+}
+
+QList<Segment>
+DBAccess::getSegments()
+{
+    QList<Segment> segments;
+
+    QSqlQuery query(db->database(sessionid));
+    query.exec("SELECT id, name, automatic, route FROM segments ORDER BY id;");
+    while(query.next()) {
+        Segment segment;
+        segment.id = query.value(0).toInt();
+        segment.name = query.value(1).toString();
+        segment.automatic = query.value(2).toInt() != 0;
+
+        QByteArray route = query.value(3).toByteArray();
+        QDataStream in(&route, QIODevice::ReadOnly);
+        while (!in.atEnd()) {
+            GeoPoint point;
+            in >> point.lat >> point.lon;
+            segment.route << point;
+        }
+        segments << segment;
+    }
+    return segments;
+}
+
+int
+DBAccess::addSegment(const Segment &segment)
+{
+    QByteArray route;
+    QDataStream out(&route, QIODevice::WriteOnly);
+    foreach(const GeoPoint &point, segment.route) out << point.lat << point.lon;
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("insert into segments ( name, automatic, route ) values ( ?,?,? );");
+    query.addBindValue(segment.name);
+    query.addBindValue(segment.automatic ? 1 : 0);
+    query.addBindValue(route);
+    if (!query.exec()) return -1;
+    return query.lastInsertId().toInt();
+}
+
+bool
+DBAccess::deleteSegment(int id)
+{
+    QSqlQuery query(db->database(sessionid));
+
+    query.prepare("DELETE FROM efforts WHERE segment = ?;");
+    query.addBindValue(id);
+    query.exec();
+
+    query.prepare("DELETE FROM segments WHERE id = ?;");
+    query.addBindValue(id);
+    return query.exec();
+}
+
+bool
+DBAccess::importEfforts(QString filename, const QList<SegmentEffort> &efforts, int segment)
+{
+    QSqlQuery query(db->database(sessionid));
+
+    if (segment < 0) {
+        query.prepare("DELETE FROM efforts WHERE filename = ?;");
+        query.addBindValue(filename);
+    } else {
+        query.prepare("DELETE FROM efforts WHERE filename = ? AND segment = ?;");
+        query.addBindValue(filename);
+        query.addBindValue(segment);
+    }
+    bool rc = query.exec();
+
+    query.prepare("insert into efforts ( segment, filename, start, stop, watts, hr ) values ( ?,?,?,?,?,? );");
+    foreach(const SegmentEffort &effort, efforts) {
+        query.addBindValue(effort.segment);
+        query.addBindValue(filename);
+        query.addBindValue(effort.start);
+        query.addBindValue(effort.stop);
+        query.addBindValue(effort.watts);
+        query.addBindValue(effort.hr);
+        if (!query.exec()) rc = false;
+    }
+    return rc;
+}
+
+QList<QPair<QString, SegmentEffort> >
+DBAccess::getEfforts(int segment)
+{
+    QList<QPair<QString, SegmentEffort> > efforts;
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("SELECT efforts.filename, start, stop, watts, hr FROM efforts, metrics "
+                  "WHERE efforts.filename = metrics.filename AND segment = ? ORDER BY ride_date, start;");
+    query.addBindValue(segment);
+    query.exec();
+    while(query.next()) {
+        SegmentEffort effort;
+        effort.segment = segment;
+        effort.start = query.value(1).toDouble();
+        effort.stop = query.value(2).toDouble();
+        effort.watts = query.value(3).toDouble();
+        effort.hr = query.value(4).toDouble();
+        efforts << QPair<QString, SegmentEffort>(query.value(0).toString(), effort);
+    }
+    return efforts;
+}
+
+QList<SegmentEffort>
+DBAccess::getRideEfforts(QString filename)
+{
+    QList<SegmentEffort> efforts;
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("SELECT segment, start, stop, watts, hr FROM efforts WHERE filename = ? ORDER BY start;");
+    query.addBindValue(filename);
+    query.exec();
+    while(query.next()) {
+        SegmentEffort effort;
+        effort.segment = query.value(0).toInt();
+        effort.start = query.value(1).toDouble();
+        effort.stop = query.value(2).toDouble();
+        effort.watts = query.value(3).toDouble();
+        effort.hr = query.value(4).toDouble();
+        efforts << effort;
+    }
+    return efforts;
+}
+
+bool
+DBAccess::importIntervals(QString filename, const QList<DetectedInterval> &intervals)
+{
+    // called within the caller's transaction, like importRide
+    QSqlQuery query(db->database(sessionid));
+
+    query.prepare("DELETE FROM intervals WHERE filename = ?;");
+    query.addBindValue(filename);
+    bool rc = query.exec();
+
+    query.prepare("insert into intervals ( filename, type, name, start, stop, value ) values ( ?,?,?,?,?,? );");
+    foreach(const DetectedInterval &interval, intervals) {
+        query.addBindValue(filename);
+        query.addBindValue(interval.type);
+        query.addBindValue(interval.name);
+        query.addBindValue(interval.start);
+        query.addBindValue(interval.stop);
+        query.addBindValue(interval.value);
+        if (!query.exec()) rc = false;
+    }
+    return rc;
+}
+
+QList<DetectedInterval>
+DBAccess::getIntervals(QString filename)
+{
+    QList<DetectedInterval> intervals;
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("SELECT type, name, start, stop, value FROM intervals WHERE filename = ? ORDER BY start;");
+    query.addBindValue(filename);
+    query.exec();
+    while(query.next()) {
+        DetectedInterval interval;
+        interval.type = query.value(0).toString();
+        interval.name = query.value(1).toString();
+        interval.start = query.value(2).toDouble();
+        interval.stop = query.value(3).toDouble();
+        interval.value = query.value(4).toDouble();
+        intervals << interval;
+    }
+    return intervals;
+}
+
+bool
+DBAccess::importBests(QString filename, const QByteArray &bests)
+{
+    QSqlQuery query(db->database(sessionid));
+
+    // no .cpx, no bests
+    if (bests.isEmpty()) {
+        query.prepare("DELETE FROM bests WHERE filename = ?;");
+        query.addBindValue(filename);
+        return query.exec();
+    }
+
+    query.prepare("insert or replace into bests ( filename, bests ) values ( ?,? );");
+    query.addBindValue(filename);
+    query.addBindValue(bests);
+    return query.exec();
+}
+
+bool
+DBAccess::importProfile(QString filename, const QByteArray &profile)
+{
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("UPDATE metrics SET profile = ? WHERE filename = ?;");
+    query.addBindValue(profile.isEmpty() ? QVariant(QVariant::ByteArray) : QVariant(profile));
+    query.addBindValue(filename);
+    return query.exec();
+}
+
+bool
+DBAccess::getBests(QString filename, QByteArray &bests)
+{
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("SELECT bests FROM bests WHERE filename = ?;");
+    query.addBindValue(filename);
+    if (!query.exec() || !query.next()) return false;
+    bests = query.value(0).toByteArray();
+    return true;
+}
+
+QList<QPair<QString, QByteArray> >
+DBAccess::getBestsFor(QDateTime start, QDateTime end)
+{
+    QList<QPair<QString, QByteArray> > returning;
+
+    QList<QVariant> values;
+    QString where = dateRange(start, end, values);
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("SELECT bests.filename, bests FROM bests, metrics "
+                  "WHERE bests.filename = metrics.filename AND " + where + " ORDER BY ride_date;");
+    foreach(QVariant value, values) query.addBindValue(value);
+    query.exec();
+    while(query.next())
+        returning << QPair<QString, QByteArray>(query.value(0).toString(), query.value(1).toByteArray());
+    return returning;
+}
+
+bool
+DBAccess::getNamedFilter(QString text, unsigned long &timestamp, QStringList &filenames)
+{
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("SELECT timestamp FROM namedfilters WHERE text = ?;");
+    query.addBindValue(text);
+    if (!query.exec() || !query.next()) return false;
+    timestamp = query.value(0).toULongLong();
+
+    // rides deleted since drop out with their metrics
+    query.prepare("SELECT namedfilterrides.filename FROM namedfilterrides, metrics "
+                  "WHERE namedfilterrides.filename = metrics.filename AND text = ? ORDER BY ride_date;");
+    query.addBindValue(text);
+    query.exec();
+    filenames.clear();
+    while (query.next()) filenames << query.value(0).toString();
+    return true;
+}
+
+bool
+DBAccess::putNamedFilter(QString text, unsigned long timestamp, const QStringList &filenames)
+{
+    connection().transaction();
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("insert or replace into namedfilters ( text, timestamp ) values ( ?,? );");
+    query.addBindValue(text);
+    query.addBindValue((qulonglong)timestamp);
+    bool rc = query.exec();
+
+    query.prepare("DELETE FROM namedfilterrides WHERE text = ?;");
+    query.addBindValue(text);
+    query.exec();
+
+    query.prepare("insert into namedfilterrides ( text, filename ) values ( ?,? );");
+    foreach(QString filename, filenames) {
+        query.addBindValue(text);
+        query.addBindValue(filename);
+        if (!query.exec()) rc = false;
+    }
+
+    connection().commit();
+    return rc;
+}
+
+void
+DBAccess::pruneNamedFilters(QStringList keep)
+{
+    QSqlQuery query(db->database(sessionid));
+    query.exec("SELECT text FROM namedfilters;");
+
+    QStringList gone;
+    while (query.next()) if (!keep.contains(query.value(0).toString())) gone << query.value(0).toString();
+
+    foreach(QString text, gone) {
+        query.prepare("DELETE FROM namedfilters WHERE text = ?;");
+        query.addBindValue(text);
+        query.exec();
+        query.prepare("DELETE FROM namedfilterrides WHERE text = ?;");
+        query.addBindValue(text);
+        query.exec();
+    }
+}
+
+QList<QPair<QString, DetectedInterval> >
+DBAccess::getIntervalsFor(QDateTime start, QDateTime end, QString type)
+{
+    QList<QPair<QString, DetectedInterval> > intervals;
+
+    // an empty type fetches them all
+    QString selectStatement = "SELECT intervals.filename, type, name, start, stop, value FROM intervals, metrics "
+                              "WHERE intervals.filename = metrics.filename "
+                              "AND ride_date >= :start AND ride_date < :end ";
+    if (type != "") selectStatement += "AND type = :type ";
+    selectStatement += "ORDER BY ride_date, start;";
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare(selectStatement);
+    query.bindValue(":start", start.date().toString(Qt::ISODate));
+    query.bindValue(":end", end.date().addDays(1).toString(Qt::ISODate));
+    if (type != "") query.bindValue(":type", type);
+    query.exec();
+    while(query.next()) {
+        DetectedInterval interval;
+        interval.type = query.value(1).toString();
+        interval.name = query.value(2).toString();
+        interval.start = query.value(3).toDouble();
+        interval.stop = query.value(4).toDouble();
+        interval.value = query.value(5).toDouble();
+        intervals << QPair<QString, DetectedInterval>(query.value(0).toString(), interval);
+    }
+    return intervals;
+}
+
 QList<QDateTime> DBAccess::getAllDates()
 {
     QSqlQuery query("SELECT ride_date from metrics ORDER BY ride_date;", db->database(sessionid));
@@ -526,7 +1353,7 @@ DBAccess::getRide(QString filename, SummaryMetrics &summaryMetrics, QColor&color
         // the values
         int i=0;
         for (; i<factory.metricCount(); i++)
-            summaryMetrics.setForSymbol(factory.metricName(i), query.value(i+4).toDouble());
+            summaryMetrics.setForIndex(i, query.value(i+4).toDouble());
 
         foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
             if (!context->specialFields.isMetric(field.name) && (field.type == 3 || field.type == 4)) {
@@ -545,30 +1372,102 @@ DBAccess::getRide(QString filename, SummaryMetrics &summaryMetrics, QColor&color
 
 QList<SummaryMetrics> DBAccess::getAllMetricsFor(QDateTime start, QDateTime end)
 {
-    QList<SummaryMetrics> metrics;
+    QList<QVariant> values;
+    QString where = dateRange(start, end, values);
+    return selectMetrics(where, values);
+}
+
+QList<SummaryMetrics> DBAccess::getMetricsFor(QDateTime start, QDateTime end, QStringList symbols)
+{
+    QList<QVariant> values;
+    QString where = dateRange(start, end, values);
+    return selectMetrics(where, values, &symbols);
+}
+
+int DBAccess::visitMetricsFor(QDateTime start, QDateTime end, const QStringList *symbols, SummaryMetricsVisitor &visitor)
+{
+    QList<QVariant> values;
+    QString where = dateRange(start, end, values);
+    return visitMetrics(where, values, symbols, visitor);
+}
+
+int DBAccess::countMetricsFor(QDateTime start, QDateTime end)
+{
+    QList<QVariant> values;
+    QString where = dateRange(start, end, values);
+
+    QSqlQuery query(db->database(sessionid));
+    query.prepare("SELECT COUNT(*) FROM metrics where " + where + ";");
+    foreach(QVariant value, values) query.addBindValue(value);
+    if (query.exec() && query.next()) return query.value(0).toInt();
+    return 0;
+}
 
+// whole days from start to end, compared on the stored ISO text
+// so the ride_date index can be used rather than DATE() of every row
+QString DBAccess::dateRange(QDateTime &start, QDateTime &end, QList<QVariant> &values)
+{
     // null date range fetches all, but not currently used by application code
     // since it relies too heavily on the results of the QDateTime constructor
     if (start == QDateTime()) start = QDateTime::currentDateTime().addYears(-10);
     if (end == QDateTime()) end = QDateTime::currentDateTime().addYears(+10);
 
-    // construct the select statement
-    QString selectStatement = "SELECT filename, identifier, ride_date";
+    values << start.date().toString(Qt::ISODate) << end.date().addDays(1).toString(Qt::ISODate);
+    return "ride_date >= ? AND ride_date < ?";
+}
+
+QList<SummaryMetrics> DBAccess::getAllMetricsChangedSince(unsigned long timestamp)
+{
+    return selectMetrics("timestamp >= ?", QList<QVariant>() << (qulonglong)timestamp);
+}
+
+// collects them all for selectMetrics
+class SummaryMetricsList : public SummaryMetricsVisitor
+{
+    public:
+        bool visit(const SummaryMetrics &x) { metrics << x; return true; }
+        QList<SummaryMetrics> metrics;
+};
+
+QList<SummaryMetrics> DBAccess::selectMetrics(QString where, QList<QVariant> values, const QStringList *symbols)
+{
+    SummaryMetricsList list;
+    visitMetrics(where, values, symbols, list);
+    return list.metrics;
+}
+
+int DBAccess::visitMetrics(QString where, QList<QVariant> values, const QStringList *symbols, SummaryMetricsVisitor &visitor)
+{
+    GC_TRACE_SPAN("db select metrics");
+    int visited = 0;
+
+    // which columns, all of them unless symbols says otherwise
     const RideMetricFactory &factory = RideMetricFactory::instance();
+    QVector<int> indexes;
     for (int i=0; i<factory.metricCount(); i++)
-        selectStatement += QString(", X%1 ").arg(factory.metricName(i));
+        if (!symbols || symbols->contains(factory.metricName(i))) indexes << i;
+    QList<FieldDefinition> fields;
     foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
         if (!context->specialFields.isMetric(field.name) && (field.type < 5 || field.type == 7)) {
-            selectStatement += QString(", Z%1 ").arg(context->specialFields.makeTechName(field.name));
+            QString underscored = field.name;
+            if (!symbols || symbols->contains(underscored.replace(" ", "_"))) fields << field;
         }
     }
-    selectStatement += " FROM metrics where DATE(ride_date) >=DATE(:start) AND DATE(ride_date) <=DATE(:end) "
-                       " ORDER BY ride_date;";
 
-    // execute the select statement
-    QSqlQuery query(selectStatement, db->database(sessionid));
-    query.bindValue(":start", start.date());
-    query.bindValue(":end", end.date());
+    // construct the select statement
+    QString selectStatement = "SELECT filename, identifier, ride_date";
+    foreach(int i, indexes)
+        selectStatement += QString(", X%1 ").arg(factory.metricName(i));
+    foreach(FieldDefinition field, fields)
+        selectStatement += QString(", Z%1 ").arg(context->specialFields.makeTechName(field.name));
+    selectStatement += " FROM metrics where " + where + " ORDER BY ride_date;";
+
+    // execute the select statement, forward only so the
+    // driver steps through the rows rather than caching them
+    QSqlQuery query(db->database(sessionid));
+    query.setForwardOnly(true);
+    query.prepare(selectStatement);
+    foreach(QVariant value, values) query.addBindValue(value);
     query.exec();
     while(query.next())
     {
@@ -580,22 +1479,20 @@ QList<SummaryMetrics> DBAccess::getAllMetricsFor(QDateTime start, QDateTime end)
         summaryMetrics.setRideDate(query.value(2).toDateTime());
         // the values
         int i=0;
-        for (; i<factory.metricCount(); i++)
-            summaryMetrics.setForSymbol(factory.metricName(i), query.value(i+3).toDouble());
-        foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
-            if (!context->specialFields.isMetric(field.name) && (field.type == 3 || field.type == 4)) {
-                QString underscored = field.name;
+        for (; i<indexes.count(); i++)
+            summaryMetrics.setForIndex(indexes[i], query.value(i+3).toDouble());
+        foreach(FieldDefinition field, fields) {
+            QString underscored = field.name;
+            if (field.type == 3 || field.type == 4)
                 summaryMetrics.setForSymbol(underscored.replace("_"," "), query.value(i+3).toDouble());
-                i++;
-            } else if (!context->specialFields.isMetric(field.name) && (field.type < 3 || field.type == 7)) {
-                QString underscored = field.name;
+            else
                 summaryMetrics.setText(underscored.replace("_"," "), query.value(i+3).toString());
-                i++;
-            }
+            i++;
         }
-        metrics << summaryMetrics;
+        visited++;
+        if (!visitor.visit(summaryMetrics)) break;
     }
-    return metrics;
+    return visited;
 }
 
 SummaryMetrics DBAccess::getRideMetrics(QString filename)
@@ -626,7 +1523,7 @@ SummaryMetrics DBAccess::getRideMetrics(QString filename)
         // the values
         int i=0;
         for (; i<factory.metricCount(); i++)
-            summaryMetrics.setForSymbol(factory.metricName(i), query.value(i+2).toDouble());
+            summaryMetrics.setForIndex(i, query.value(i+2).toDouble());
         foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
             if (!context->specialFields.isMetric(field.name) && (field.type == 3 || field.type == 4)) {
                 QString underscored = field.name;
@@ -645,10 +1542,8 @@ SummaryMetrics DBAccess::getRideMetrics(QString filename)
 /*----------------------------------------------------------------------
  * CRUD routines for Measures table
  *----------------------------------------------------------------------*/
-bool DBAccess::importMeasure(SummaryMetrics *summaryMetrics)
+QString DBAccess::measureInsertStatement()
 {
-	QSqlQuery query(db->database(sessionid));
-
     // construct an insert statement
     QString insertStatement = "insert into measures (timestamp, measure_date";
 
@@ -674,8 +1569,11 @@ bool DBAccess::importMeasure(SummaryMetrics *summaryMetrics)
     }
     insertStatement += ")";
 
-	query.prepare(insertStatement);
+    return insertStatement;
+}
 
+void DBAccess::bindMeasure(QSqlQuery &query, SummaryMetrics *summaryMetrics)
+{
     // timestamp and date
     query.addBindValue(summaryMetrics->getDateTime().toTime_t());
     query.addBindValue(summaryMetrics->getDateTime().date());
@@ -692,6 +1590,15 @@ bool DBAccess::importMeasure(SummaryMetrics *summaryMetrics)
             query.addBindValue(summaryMetrics->getText(field.name, "nan").toDouble());
         }
     }
+}
+
+bool DBAccess::importMeasure(SummaryMetrics *summaryMetrics)
+{
+	QSqlQuery query(db->database(sessionid));
+
+	query.prepare(measureInsertStatement());
+    bindMeasure(query, summaryMetrics);
+
     // go do it!
 	bool rc = query.exec();
 
@@ -700,6 +1607,39 @@ bool DBAccess::importMeasure(SummaryMetrics *summaryMetrics)
 	return rc;
 }
 
+// prepared once and committed once, for the downloads that
+// bring in a lot of history at a time
+bool DBAccess::importMeasures(QList<SummaryMetrics> &summaryMetrics)
+{
+    bool rc = true;
+
+    connection().transaction();
+
+	QSqlQuery query(db->database(sessionid));
+	query.prepare(measureInsertStatement());
+
+    for (int i=0; i<summaryMetrics.count(); i++) {
+        bindMeasure(query, &summaryMetrics[i]);
+        if (!query.exec()) rc = false;
+    }
+
+    connection().commit();
+    return rc;
+}
+
+// most recent day with a value for the named measure, so
+// the downloads can ask only for what came after it
+QDate DBAccess::lastMeasureWith(QString fieldName)
+{
+    QString column = QString("Z%1").arg(msp.makeTechName(fieldName));
+    QSqlQuery query(QString("SELECT MAX(measure_date) FROM measures WHERE %1 IS NOT NULL AND %1 <> '';").arg(column),
+                    db->database(sessionid));
+
+    // no such column, or nothing there yet
+    if (query.exec() && query.next()) return query.value(0).toDate();
+    return QDate();
+}
+
 QList<SummaryMetrics> DBAccess::getAllMeasuresFor(QDateTime start, QDateTime end)
 {
     QList<SummaryMetrics> measures;
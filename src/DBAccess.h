@@ -31,12 +31,63 @@
 #include "RideFile.h"
 #include "SpecialFields.h"
 #include "RideMetadata.h"
+#include "IntervalDetector.h"
+#include "Segments.h"
+#include "RideFingerprint.h"
 
 extern int DBSchemaVersion;
 
 class RideFile;
 class Zones;
 class RideMetric;
+
+// what the metrics stored for a ride were computed with, so a refresh
+// can tell which of them are out of date, see RideMetric::dependency
+struct MetricFingerprints
+{
+    unsigned long zones, hrZones; // of the zone ranges in use on the day
+    unsigned long samples;        // see MetricAggregator::samplesFingerPrint
+    double weight;                // the ride used, it may have its own
+    double athleteWeight;         // measured or configured for the day
+    unsigned long content;        // of the ride file, see MetricAggregator::contentFingerPrint
+
+    MetricFingerprints() : zones(0), hrZones(0), samples(0), weight(0), athleteWeight(0), content(0) {}
+};
+
+// one metric over all the rides of a day, kept in the daily table so trends
+// over years read a row a day rather than a row a ride. Rides without the
+// metric (a zero value) are left out, as the LTM charts do
+struct DailyMetric
+{
+    QDate day;
+    int rides;
+    double total, peak, low;
+    double seconds, weighted; // duration of the rides and the value x duration
+
+    DailyMetric() : rides(0), total(0), peak(0), low(0), seconds(0), weighted(0) {}
+
+    // a week or a month from its days
+    void add(const DailyMetric &other) {
+        if (other.rides == 0) return;
+        peak = rides ? qMax(peak, other.peak) : other.peak;
+        low = rides ? qMin(low, other.low) : other.low;
+        rides += other.rides;
+        total += other.total;
+        seconds += other.seconds;
+        weighted += other.weighted;
+    }
+
+    // summed, averaged by duration or the best, by RideMetric::MetricType
+    double value(int type) const;
+};
+
+// takes the rides from DBAccess::visitMetricsFor one at a time
+class SummaryMetricsVisitor
+{
+    public:
+        virtual ~SummaryMetricsVisitor() {}
+        virtual bool visit(const SummaryMetrics &) = 0; // false to stop
+};
 class DBAccess
 {
 
@@ -56,17 +107,68 @@ class DBAccess
         ~DBAccess();
 
         // Create/Delete Metrics
-	    bool importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor color, unsigned long, bool);
+	    bool importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor color, const MetricFingerprints &, bool);
+        bool updateRide(SummaryMetrics *summaryMetrics, const QStringList &symbols, RideFile *ride, QColor color,
+                        const MetricFingerprints &); // samples unchanged
         bool deleteRide(QString);
+        bool touchRide(QString); // the file's date changed but not what is in it
+
+        // Intervals detected at import, replacing any the ride had
+        bool importIntervals(QString filename, const QList<DetectedInterval> &intervals);
+        QList<DetectedInterval> getIntervals(QString filename);
+        QList<QPair<QString, DetectedInterval> > getIntervalsFor(QDateTime start, QDateTime end, QString type = "");
+
+        // The bests read from each ride's .cpx at the standard durations,
+        // with an empty array when there is none, see RideFileCache::standardBests
+        bool importBests(QString filename, const QByteArray &bests);
+        bool getBests(QString filename, QByteArray &bests);
+        QList<QPair<QString, QByteArray> > getBestsFor(QDateTime start, QDateTime end);
+
+        // The mini profile of the ride shown in the navigator, see RideProfile,
+        // it is kept in the metrics row so must be written after importRide
+        bool importProfile(QString filename, const QByteArray &profile);
+
+        // The segment index and efforts, see Segments. The cells a ride's track
+        // passes near, and its efforts, are replaced when its samples change
+        bool importTrack(QString filename, const QStringList &cells);
+        QStringList getRidesThrough(QString startCell, QString endCell);
+        QList<Segment> getSegments();
+        int addSegment(const Segment &segment); // returns its id, or -1
+        bool deleteSegment(int id);
+        bool importEfforts(QString filename, const QList<SegmentEffort> &efforts, int segment = -1); // -1 for all of them
+        QList<QPair<QString, SegmentEffort> > getEfforts(int segment);
+        QList<SegmentEffort> getRideEfforts(QString filename);
+
+        // What each ride is, written by importRide, and the rides already
+        // here that look like the same one, see RideFingerprint
+        bool importFingerprint(QString filename, const RideFingerprint &fingerprint);
+        QStringList findDuplicates(const RideFingerprint &fingerprint);
+
+        // Named filter results, as of when they were last brought up to date
+        bool getNamedFilter(QString text, unsigned long &timestamp, QStringList &filenames);
+        bool putNamedFilter(QString text, unsigned long timestamp, const QStringList &filenames);
+        void pruneNamedFilters(QStringList keep); // drop the ones no longer named
 
         // Create/Delete Measures
         bool importMeasure(SummaryMetrics *summaryMetrics);
+        bool importMeasures(QList<SummaryMetrics> &summaryMetrics);
+        QDate lastMeasureWith(QString fieldName); // invalid if none
 
         // Query Records
         QList<SummaryMetrics> getAllMetricsFor(QDateTime start, QDateTime end);
         QList<SummaryMetrics> getAllMetricsFor(DateRange dr) {
             return getAllMetricsFor(QDateTime(dr.from,QTime(0,0,0)), QDateTime(dr.to, QTime(23,59,59)));
         }
+        QList<SummaryMetrics> getAllMetricsChangedSince(unsigned long timestamp); // written since
+
+        // as getAllMetricsFor, but only reading the metric and metadata
+        // columns named in symbols (metadata with spaces as underscores)
+        QList<SummaryMetrics> getMetricsFor(QDateTime start, QDateTime end, QStringList symbols);
+
+        // as getMetricsFor (or getAllMetricsFor if symbols is NULL) but each ride is
+        // passed to visitor as it is read, so they are never all in memory at once
+        int visitMetricsFor(QDateTime start, QDateTime end, const QStringList *symbols, SummaryMetricsVisitor &visitor);
+        int countMetricsFor(QDateTime start, QDateTime end);
 
         bool getRide(QString filename, SummaryMetrics &metrics, QColor&color);
         QList<SummaryMetrics> getAllMeasuresFor(QDateTime start, QDateTime end);
@@ -79,6 +181,20 @@ class DBAccess
 	    QList<QDateTime> getAllDates();
         QList<Season> getAllSeasons();
 
+        // The metric for each day with rides from start to end, see DailyMetric.
+        // Days are brought up to date by flushDaily(), which the metric writes
+        // leave for the caller to do once a batch is written, and before this
+        QList<DailyMetric> getDailyFor(QDate start, QDate end, QString symbol);
+        void flushDaily();
+
+        // Free text search of the metadata texts, kept in a full text table
+        // written along with the metrics so there's no index to keep in step.
+        // The words typed must all be found, and where is an sql condition on
+        // the metrics table (e.g. "Xworkout_time > ?") to narrow it in the
+        // same query. False when the sqlite we have has no full text support
+        bool hasTextSearch() const { return textSearch; }
+        QStringList searchText(QString text, QString where = "", QList<QVariant> values = QList<QVariant>());
+
 	private:
 
         Context *context;
@@ -86,6 +202,13 @@ class DBAccess
         QSqlDatabase dbconn;
         QString sessionid;
 
+        // the insert for importRide is prepared once and reused
+        QSqlQuery *insertQuery;
+        QString insertStatement;
+
+        bool textSearch; // the textsearch table could be created
+        void indexText(QString filename, RideFile *ride);
+
         SpecialFields msp;
         QList<FieldDefinition> mfieldDefinitions;
         QList<KeywordDefinition> mkeywordDefinitions; //NOTE: not used in measures.xml
@@ -98,6 +221,13 @@ class DBAccess
         bool dropMetricTable();
         bool createMeasuresTable();
         bool dropMeasuresTable();
+        QString measureInsertStatement();
+        QList<SummaryMetrics> selectMetrics(QString where, QList<QVariant> values, const QStringList *symbols = NULL);
+        int visitMetrics(QString where, QList<QVariant> values, const QStringList *symbols, SummaryMetricsVisitor &visitor);
+        QString dateRange(QDateTime &start, QDateTime &end, QList<QVariant> &values);
+        void bindMeasure(QSqlQuery &query, SummaryMetrics *summaryMetrics);
+        void dailyStale(QDate day); // rides on it were written or deleted
+        void rollupDay(QDate day);
 	    void initDatabase(QDir home);
 };
 #endif
@@ -17,6 +17,7 @@
  */
 
 #include "RideMetric.h"
+#include "RideStatistics.h"
 #include "Zones.h"
 #include <math.h>
 #include <QApplication>
@@ -45,6 +46,7 @@ class DanielsPoints : public RideMetric {
     DanielsPoints() : score(0.0)
     {
         setSymbol("daniels_points");
+        setDependsOn(RideMetric::PowerZone);
         setInternalName("Daniels Points");
     }
     void initialize() {
@@ -62,35 +64,23 @@ class DanielsPoints : public RideMetric {
             return;
         }
 
-        static const double EPSILON = 0.1;
         static const double NEGLIGIBLE = 0.1;
 
         double secsDelta = ride->recIntSecs();
         double sampsPerWindow = 25.0 / secsDelta;
         double attenuation = sampsPerWindow / (sampsPerWindow + secsDelta);
-        double sampleWeight = secsDelta / (sampsPerWindow + secsDelta);
 
-        double lastSecs = 0.0;
         double weighted = 0.0;
 
         score = 0.0;
         double cp = zones->getCP(zoneRange);
 
-        foreach(const RideFilePoint *point, ride->dataPoints()) {
-            while ((weighted > NEGLIGIBLE)
-                   && (point->secs > lastSecs + secsDelta + EPSILON)) {
-                weighted *= attenuation;
-                lastSecs += secsDelta;
-                inc(secsDelta, weighted, cp);
-            }
-            weighted *= attenuation;
-            weighted += sampleWeight * point->watts;
-            lastSecs = point->secs;
+        foreach(double value, statistics(ride).weighted25s()) {
+            weighted = value;
             inc(secsDelta, weighted, cp);
         }
         while (weighted > NEGLIGIBLE) {
             weighted *= attenuation;
-            lastSecs += secsDelta;
             inc(secsDelta, weighted, cp);
         }
         setValue(score);
@@ -110,6 +100,7 @@ class DanielsEquivalentPower : public RideMetric {
     DanielsEquivalentPower() : watts(0.0)
     {
         setSymbol("daniels_equivalent_power");
+        setDependsOn(RideMetric::PowerZone);
         setInternalName("Daniels EqP");
     }
     void initialize() {
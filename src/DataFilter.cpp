@@ -22,23 +22,14 @@
 #include "Athlete.h"
 #include "RideNavigator.h"
 #include "RideFileCache.h"
+#include "NamedSearch.h"
+#include "DBAccess.h"
 #include <QDebug>
 
 #include "DataFilter_yacc.h"
 
-// LEXER VARIABLES WE INTERACT WITH
-// Standard yacc/lex variables / functions
-extern int DataFilterlex(); // the lexer aka yylex()
-extern char *DataFiltertext; // set by the lexer aka yytext
-
-extern void DataFilter_setString(QString);
-extern void DataFilter_clearString();
-
-// PARSER STATE VARIABLES
-QStringList DataFiltererrors;
-extern int DataFilterparse();
-
-Leaf *root; // root node for parsed statement
+// see DataFilter.l
+extern int DataFilter_parseString(DataFilterParse *parse, QString query);
 
 static RideFile::SeriesType nameToSeries(QString name)
 {
@@ -127,7 +118,7 @@ Q_UNUSED(leaf);
 #endif
 }
 
-void Leaf::validateFilter(DataFilter *df, Leaf *leaf)
+void Leaf::validateFilter(DataFilter *df, Leaf *leaf, QStringList &errors)
 {
     switch(leaf->type) {
     case Leaf::Symbol :
@@ -138,7 +129,7 @@ void Leaf::validateFilter(DataFilter *df, Leaf *leaf)
             // a lookup at execution time
             QString lookup = df->lookupMap.value(*(leaf->lvalue.n), "");
             if (lookup == "") {
-                DataFiltererrors << QString("%1 is unknown").arg(*(leaf->lvalue.n));
+                errors << QString("%1 is unknown").arg(*(leaf->lvalue.n));
             }
         }
         break;
@@ -151,10 +142,10 @@ void Leaf::validateFilter(DataFilter *df, Leaf *leaf)
             QString symbol = *(leaf->series->lvalue.n); 
 
             if (leaf->function == "best" && !bestValidSymbols.exactMatch(symbol)) 
-                DataFiltererrors << QString("invalid data series for best(): %1").arg(symbol);
+                errors << QString("invalid data series for best(): %1").arg(symbol);
 
             if (leaf->function == "tiz" && !tizValidSymbols.exactMatch(symbol)) 
-                DataFiltererrors << QString("invalid data series for tiz(): %1").arg(symbol);
+                errors << QString("invalid data series for tiz(): %1").arg(symbol);
 
             // now set the series type
             leaf->seriesType = nameToSeries(symbol);
@@ -168,24 +159,24 @@ void Leaf::validateFilter(DataFilter *df, Leaf *leaf)
             bool lhsType = Leaf::isNumber(df, leaf->lvalue.l);
             bool rhsType = Leaf::isNumber(df, leaf->rvalue.l);
             if (lhsType != rhsType) {
-                DataFiltererrors << QString("comparing strings with numbers");
+                errors << QString("comparing strings with numbers");
             }
 
             // what about using string operations on a lhs/rhs that
             // are numeric?
             if ((lhsType || rhsType) && leaf->op >= MATCHES && leaf->op <= CONTAINS) {
-                DataFiltererrors << "using a string operations with a number";
+                errors << "using a string operations with a number";
             }
 
-            validateFilter(df, leaf->lvalue.l);
-            validateFilter(df, leaf->rvalue.l);
+            validateFilter(df, leaf->lvalue.l, errors);
+            validateFilter(df, leaf->rvalue.l, errors);
         }
         break;
 
     case Leaf::Logical : 
         {
-            validateFilter(df, leaf->lvalue.l);
-            if (leaf->op) validateFilter(df, leaf->rvalue.l);
+            validateFilter(df, leaf->lvalue.l, errors);
+            if (leaf->op) validateFilter(df, leaf->rvalue.l, errors);
         }
         break;
     default:
@@ -199,34 +190,40 @@ DataFilter::DataFilter(QObject *parent, Context *context) : QObject(parent), con
     connect(context, SIGNAL(configChanged()), this, SLOT(configUpdate()));
 }
 
-QStringList DataFilter::parseFilter(QString query)
+Leaf *DataFilter::parse(QString query, QStringList &errors)
 {
     //DataFilterdebug = 2; // no debug -- needs bison -t in src.pro
-    root = NULL;
+    DataFilterParse parse;
+    DataFilter_parseString(&parse, query);
 
+    errors = parse.errors;
+    if (parse.root && errors.count()) {
+        parse.root->clear(parse.root);
+        parse.root = NULL;
+    }
+    return parse.root;
+}
+
+QStringList DataFilter::parseFilter(QString query)
+{
     // if something was left behind clear it up now
     clearFilter();
 
     // Parse from string
-    DataFiltererrors.clear(); // clear out old errors
-    DataFilter_setString(query);
-    DataFilterparse();
-    DataFilter_clearString();
-
-    // save away the results
-    treeRoot = root;
+    QStringList errors;
+    treeRoot = parse(query, errors);
 
     // if it passed syntax lets check semantics
-    if (treeRoot && DataFiltererrors.count() == 0) treeRoot->validateFilter(this, treeRoot);
+    if (treeRoot) treeRoot->validateFilter(this, treeRoot, errors);
 
     // ok, did it pass all tests?
-    if (!treeRoot || DataFiltererrors.count() > 0) { // nope
+    if (!treeRoot || errors.count() > 0) { // nope
 
         // no errors just failed to finish
-        if (!treeRoot) DataFiltererrors << "malformed expression.";
+        if (!treeRoot && errors.isEmpty()) errors << "malformed expression.";
 
         // Bzzzt, malformed
-        emit parseBad(DataFiltererrors);
+        emit parseBad(errors);
         clearFilter();
 
     } else { // yep! .. we have a winner!
@@ -235,29 +232,100 @@ QStringList DataFilter::parseFilter(QString query)
         //treeRoot->print(treeRoot);
         emit parseGood();
 
-        // get all fields...
-        QList<SummaryMetrics> allRides = context->athlete->metricDB->getAllMetricsFor(QDateTime(), QDateTime());
-
-        filenames.clear();
-
-        for (int i=0; i<allRides.count(); i++) {
+        // compile it down to a flat program over columns
+        program.compile(this, treeRoot);
 
-            // evaluate each ride...
-            QString f= allRides.at(i).getFileName();
-            double result = treeRoot->eval(this, treeRoot, allRides.at(i), f);
-            if (result) {
-                filenames << f;
-            }
+        if (isNamed(query)) {
+            filenames = named(query);
+        } else {
+            // get all fields...
+            filenames = evaluate(context->athlete->metricDB->getAllMetricsFor(QDateTime(), QDateTime()));
         }
         emit results(filenames);
     }
 
-    errors = DataFiltererrors;
+    this->errors = errors;
     return errors;
 }
 
+QStringList DataFilter::evaluate(const QList<SummaryMetrics> &allRides)
+{
+    // pull out just the columns the program uses
+    QVector<QVector<double> > numbers(program.numeric.count());
+    QVector<QStringList> texts(program.text.count());
+    for (int c=0; c<program.numeric.count(); c++) {
+        numbers[c].resize(allRides.count());
+        for (int i=0; i<allRides.count(); i++)
+            numbers[c][i] = allRides.at(i).getForSymbol(program.numeric.at(c));
+    }
+    for (int c=0; c<program.text.count(); c++) {
+        for (int i=0; i<allRides.count(); i++)
+            texts[c] << allRides.at(i).getText(program.text.at(c).first, program.text.at(c).second);
+    }
+
+    QStringList passed;
+    QVector<DataFilterProgram::Value> stack;
+    for (int i=0; i<allRides.count(); i++) {
+
+        // evaluate each ride...
+        QString f= allRides.at(i).getFileName();
+        double result = program.run(this, numbers, texts, i, f, stack);
+        if (result) {
+            passed << f;
+        }
+    }
+    return passed;
+}
+
+bool DataFilter::isNamed(QString query)
+{
+    foreach(const NamedSearch &search, context->athlete->namedSearches->getList())
+        if (search.type == NamedSearch::filter && search.text == query) return true;
+    return false;
+}
+
+QStringList DataFilter::named(QString query)
+{
+    DBAccess *db = context->athlete->metricDB->db();
+    if (db == NULL) return evaluate(context->athlete->metricDB->getAllMetricsFor(QDateTime(), QDateTime()));
+
+    // anything written from now on is picked up next time, rides written
+    // in the same second as the last run are evaluated again to be sure
+    unsigned long now = QDateTime::currentDateTime().toTime_t();
+
+    unsigned long since;
+    QStringList stored;
+    if (!db->getNamedFilter(query, since, stored)) {
+
+        // first time, so all of them
+        QStringList passed = evaluate(context->athlete->metricDB->getAllMetricsFor(QDateTime(), QDateTime()));
+
+        QStringList keep;
+        foreach(const NamedSearch &search, context->athlete->namedSearches->getList())
+            if (search.type == NamedSearch::filter) keep << search.text;
+        db->pruneNamedFilters(keep);
+        db->putNamedFilter(query, now, passed);
+        return passed;
+    }
+
+    QList<SummaryMetrics> changed = context->athlete->metricDB->getAllMetricsChangedSince(since);
+    if (changed.isEmpty()) return stored;
+
+    QSet<QString> passed = evaluate(changed).toSet();
+    QSet<QString> result = stored.toSet();
+    foreach(const SummaryMetrics &ride, changed) {
+        if (passed.contains(ride.getFileName())) result.insert(ride.getFileName());
+        else result.remove(ride.getFileName());
+    }
+
+    QStringList updated = result.toList();
+    db->putNamedFilter(query, now, updated);
+    return updated;
+}
+
 void DataFilter::clearFilter()
 {
+    program.clear();
     if (treeRoot) {
         treeRoot->clear(treeRoot);
         treeRoot = NULL;
@@ -289,6 +357,140 @@ void DataFilter::configUpdate()
     }
 }
 
+// apply a comparative or binary operator, shared by the tree and the program
+static double operate(int op, bool lhsisNumber, double lhsdouble, QString &lhsstring, double rhsdouble, QString &rhsstring)
+{
+    switch (op) {
+
+    case ADD:
+    {
+        if (lhsisNumber) {
+            return lhsdouble + rhsdouble;
+        } else {
+            return 0;
+        }
+    }
+    break;
+
+    case SUBTRACT:
+    {
+        if (lhsisNumber) {
+            return lhsdouble - rhsdouble;
+        } else {
+            return 0;
+        }
+    }
+    break;
+
+    case DIVIDE:
+    {
+        if (lhsisNumber && rhsdouble) { // avoid divide by zero
+            return lhsdouble / rhsdouble;
+        } else {
+            return 0;
+        }
+    }
+    break;
+
+    case MULTIPLY:
+    {
+        if (lhsisNumber) {
+            return lhsdouble * rhsdouble;
+        } else {
+            return 0;
+        }
+    }
+    break;
+
+    case POW:
+    {
+        if (lhsisNumber && rhsdouble) {
+            return pow(lhsdouble,rhsdouble);
+        } else {
+            return 0;
+        }
+    }
+    break;
+
+    case EQ:
+    {
+        if (lhsisNumber) {
+            return lhsdouble == rhsdouble;
+        } else {
+            return lhsstring == rhsstring;
+        }
+    }
+    break;
+
+    case NEQ:
+    {
+        if (lhsisNumber) {
+            return lhsdouble != rhsdouble;
+        } else {
+            return lhsstring != rhsstring;
+        }
+    }
+    break;
+
+    case LT:
+    {
+        if (lhsisNumber) {
+            return lhsdouble < rhsdouble;
+        } else {
+            return lhsstring < rhsstring;
+        }
+    }
+    break;
+    case LTE:
+    {
+        if (lhsisNumber) {
+            return lhsdouble <= rhsdouble;
+        } else {
+            return lhsstring <= rhsstring;
+        }
+    }
+    break;
+    case GT:
+    {
+        if (lhsisNumber) {
+            return lhsdouble > rhsdouble;
+        } else {
+            return lhsstring > rhsstring;
+        }
+    }
+    break;
+    case GTE:
+    {
+        if (lhsisNumber) {
+            return lhsdouble >= rhsdouble;
+        } else {
+            return lhsstring >= rhsstring;
+        }
+    }
+    break;
+
+    case MATCHES:
+        return QRegExp(rhsstring).exactMatch(lhsstring);
+        break;
+
+    case ENDSWITH:
+        return lhsstring.endsWith(rhsstring);
+        break;
+
+    case BEGINSWITH:
+        return lhsstring.startsWith(rhsstring);
+        break;
+
+    case CONTAINS:
+        return lhsstring.contains(rhsstring) ? true : false;
+        break;
+
+    default:
+        break;
+    }
+    return false;
+}
+
 double Leaf::eval(DataFilter *df, Leaf *leaf, SummaryMetrics m, QString f)
 {
     switch(leaf->type) {
@@ -459,139 +661,255 @@ double Leaf::eval(DataFilter *df, Leaf *leaf, SummaryMetrics m, QString f)
 
         // NOW PERFORM OPERATION
         //qDebug()<<"lhs="<<lhsdouble<<"rhs="<<rhsdouble;
-        switch (leaf->op) {
+        return operate(leaf->op, lhsisNumber, lhsdouble, lhsstring, rhsdouble, rhsstring);
+    }
+    break;
 
-        case ADD:
-        {
-            if (lhsisNumber) {
-                return lhsdouble + rhsdouble;
-            } else {
-                return 0;
-            }
-        }
+    default: // we don't need to evaluate any lower - they are leaf nodes handled above
         break;
+    }
+    return false;
+}
 
-        case SUBTRACT:
-        {
-            if (lhsisNumber) {
-                return lhsdouble - rhsdouble;
-            } else {
-                return 0;
-            }
-        }
-        break;
+//
+// COMPILED PROGRAM
+//
+void DataFilterProgram::compile(DataFilter *df, Leaf *root)
+{
+    clear();
+    compileEval(df, root);
+}
 
-        case DIVIDE:
-        {
-            if (lhsisNumber && rhsdouble) { // avoid divide by zero
-                return lhsdouble / rhsdouble;
-            } else {
-                return 0;
-            }
-        }
-        break;
+int DataFilterProgram::numericColumn(QString symbol)
+{
+    int index = numeric.indexOf(symbol);
+    if (index < 0) {
+        index = numeric.count();
+        numeric << symbol;
+    }
+    return index;
+}
 
-        case MULTIPLY:
-        {
-            if (lhsisNumber) {
-                return lhsdouble * rhsdouble;
-            } else {
-                return 0;
-            }
-        }
-        break;
+int DataFilterProgram::textColumn(QString name, QString fallback)
+{
+    QPair<QString, QString> key(name, fallback);
+    int index = text.indexOf(key);
+    if (index < 0) {
+        index = text.count();
+        text << key;
+    }
+    return index;
+}
 
-        case POW:
-        {
-            if (lhsisNumber && rhsdouble) {
-                return pow(lhsdouble,rhsdouble);
-            } else {
-                return 0;
-            }
-        }
-        break;
+// code to leave the result of Leaf::eval on the stack
+void DataFilterProgram::compileEval(DataFilter *df, Leaf *leaf)
+{
+    switch(leaf->type) {
 
-        case EQ:
-        {
-            if (lhsisNumber) {
-                return lhsdouble == rhsdouble;
-            } else {
-                return lhsstring == rhsstring;
+    case Leaf::Logical :
+    {
+        switch (leaf->op) {
+            case AND :
+            case OR :
+            {
+                // short circuit over the rhs
+                compileEval(df, leaf->lvalue.l);
+                int jump = code.count();
+                code << Instruction(leaf->op == AND ? AndJump : OrJump);
+                compileEval(df, leaf->rvalue.l);
+                code << Instruction(Truth);
+                code[jump].index = code.count();
             }
-        }
-        break;
+            break;
 
-        case NEQ:
-        {
-            if (lhsisNumber) {
-                return lhsdouble != rhsdouble;
-            } else {
-                return lhsstring != rhsstring;
-            }
+            default : // parenthesis
+                compileEval(df, leaf->lvalue.l);
+                break;
         }
-        break;
+    }
+    break;
 
-        case LT:
-        {
-            if (lhsisNumber) {
-                return lhsdouble < rhsdouble;
-            } else {
-                return lhsstring < rhsstring;
-            }
-        }
-        break;
-        case LTE:
-        {
-            if (lhsisNumber) {
-                return lhsdouble <= rhsdouble;
-            } else {
-                return lhsstring <= rhsstring;
-            }
-        }
-        break;
-        case GT:
-        {
-            if (lhsisNumber) {
-                return lhsdouble > rhsdouble;
-            } else {
-                return lhsstring > rhsstring;
-            }
-        }
+    case Leaf::Function :
+    {
+        Instruction instruction(Number); // unknown function!? just push zero
+        if (leaf->function == "best") instruction.code = Best;
+        if (leaf->function == "tiz") instruction.code = Tiz;
+        instruction.series = leaf->seriesType;
+
+        if (instruction.code != Number) compileDuration(df, leaf->lvalue.l);
+        code << instruction;
+    }
+    break;
+
+    case Leaf::BinaryOperation :
+    case Leaf::Operation :
+    {
+        compileOperand(df, leaf->lvalue.l, "");
+        compileOperand(df, leaf->rvalue.l, "notfound");
+
+        Instruction instruction(Operation);
+        instruction.op = leaf->op;
+        code << instruction;
+    }
+    break;
+
+    default: // leaf nodes on their own evaluate to false
+        code << Instruction(Number);
         break;
-        case GTE:
+    }
+}
+
+// code to push an operand of an operation, as Leaf::eval gets it
+void DataFilterProgram::compileOperand(DataFilter *df, Leaf *leaf, QString fallback)
+{
+    Instruction instruction;
+
+    switch (leaf->type) {
+
+        default:
+        case Leaf::Function :
+            compileEval(df, leaf);
+            return;
+
+        case Leaf::Symbol :
         {
-            if (lhsisNumber) {
-                return lhsdouble >= rhsdouble;
+            QString name = df->lookupMap.value(*(leaf->lvalue.n),"");
+            if (df->lookupType.value(*(leaf->lvalue.n)) == true) {
+                instruction.code = Column;
+                instruction.index = numericColumn(name);
             } else {
-                return lhsstring >= rhsstring;
+                instruction.code = Text;
+                instruction.index = textColumn(name, fallback);
             }
         }
         break;
 
-        case MATCHES:
-            return QRegExp(rhsstring).exactMatch(lhsstring);
+        case Leaf::Float :
+            instruction.number = leaf->lvalue.f;
             break;
 
-        case ENDSWITH:
-            return lhsstring.endsWith(rhsstring);
+        case Leaf::Integer :
+            instruction.number = leaf->lvalue.i;
             break;
 
-        case BEGINSWITH:
-            return lhsstring.startsWith(rhsstring);
+        case Leaf::String :
+            instruction.code = String;
+            instruction.string = *(leaf->lvalue.s);
             break;
+    }
+    code << instruction;
+}
 
-        case CONTAINS:
-            return lhsstring.contains(rhsstring) ? true : false;
-            break;
+// code to push the duration (or zone) argument of a function
+void DataFilterProgram::compileDuration(DataFilter *df, Leaf *leaf)
+{
+    Instruction instruction;
+
+    switch (leaf->type) {
 
         default:
+        case Leaf::Function :
+            compileEval(df, leaf);
+            return;
+
+        case Leaf::Symbol :
+            if (df->lookupType.value(*(leaf->lvalue.n)) == true) {
+                instruction.code = Column;
+                instruction.index = numericColumn(df->lookupMap.value(*(leaf->lvalue.n),""));
+            }
+            break;
+
+        case Leaf::Float :
+            instruction.number = leaf->lvalue.f;
+            break;
+
+        case Leaf::Integer :
+            instruction.number = leaf->lvalue.i;
+            break;
+
+        case Leaf::String :
+            instruction.number = (leaf->lvalue.s)->toDouble();
             break;
-        }
     }
-    break;
+    code << instruction;
+}
 
-    default: // we don't need to evaluate any lower - they are leaf nodes handled above
+double DataFilterProgram::run(DataFilter *df, const QVector<QVector<double> > &numbers, const QVector<QStringList> &texts,
+                              int row, QString filename, QVector<Value> &stack) const
+{
+    if (code.isEmpty()) return false;
+
+    stack.resize(code.count());
+    int top = -1;
+
+    for (int pc=0; pc<code.count(); pc++) {
+
+        const Instruction &instruction = code.at(pc);
+        switch (instruction.code) {
+
+        case Number:
+            top++;
+            stack[top].number = instruction.number;
+            stack[top].string.clear();
+            stack[top].isNumber = true;
+            break;
+
+        case String:
+            top++;
+            stack[top].number = 0;
+            stack[top].string = instruction.string;
+            stack[top].isNumber = false;
+            break;
+
+        case Column:
+            top++;
+            stack[top].number = numbers[instruction.index][row];
+            stack[top].string.clear();
+            stack[top].isNumber = true;
+            break;
+
+        case Text:
+            top++;
+            stack[top].number = 0;
+            stack[top].string = texts[instruction.index][row];
+            stack[top].isNumber = false;
+            break;
+
+        case Best:
+            stack[top].number = RideFileCache::best(df->context, filename, instruction.series, stack[top].number);
+            break;
+
+        case Tiz: // duration is really zone number
+            stack[top].number = RideFileCache::tiz(df->context, filename, instruction.series, stack[top].number);
+            break;
+
+        case Operation:
+        {
+            Value &lhs = stack[top-1];
+            Value &rhs = stack[top];
+            lhs.number = operate(instruction.op, lhs.isNumber, lhs.number, lhs.string, rhs.number, rhs.string);
+            lhs.string.clear();
+            lhs.isNumber = true;
+            top--;
+        }
         break;
+
+        case AndJump:
+            if (!stack[top].number) pc = instruction.index - 1; // leave the false on the stack
+            else top--;
+            break;
+
+        case OrJump:
+            if (stack[top].number) {
+                stack[top].number = true;
+                pc = instruction.index - 1;
+            } else top--;
+            break;
+
+        case Truth:
+            stack[top].number = stack[top].number ? true : false;
+            break;
+        }
     }
-    return false;
+    return stack[top].number;
 }
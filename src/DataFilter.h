@@ -21,6 +21,8 @@
 #include <QDebug>
 #include <QList>
 #include <QStringList>
+#include <QVector>
+#include <QPair>
 #include "RideFile.h" //for SeriesType
 
 class Context;
@@ -40,7 +42,7 @@ class Leaf {
 
         // tree traversal etc
         void print(Leaf *, int level);  // print leaf and all children
-        void validateFilter(DataFilter *, Leaf*); // validate
+        void validateFilter(DataFilter *, Leaf*, QStringList &errors); // validate
         bool isNumber(DataFilter *df, Leaf *leaf);
         void clear(Leaf*);
 
@@ -58,6 +60,61 @@ class Leaf {
         RideFile::SeriesType seriesType; // for ridefilecache
 };
 
+// The state of one parse, see DataFilter.y
+struct DataFilterParse {
+    DataFilterParse() : root(NULL) {}
+    Leaf *root;         // root node for parsed statement
+    QStringList errors;
+};
+
+// The parsed tree is compiled into a flat program for a little stack
+// machine. Symbols are resolved up front to columns of a table that
+// holds their values for every ride, so filtering a large number of
+// rides doesn't walk the tree or look up names for each one.
+class DataFilterProgram
+{
+    public:
+
+        enum { Number, String, Column, Text, Best, Tiz, Operation, AndJump, OrJump, Truth };
+
+        struct Instruction {
+            Instruction(int code=Number) : code(code), op(0), index(0), number(0), series(RideFile::none) {}
+            int code;
+            int op;         // the operation, for Operation
+            int index;      // column, or jump target for AndJump/OrJump
+            double number;  // constant value, for Number
+            QString string; // constant value, for String
+            RideFile::SeriesType series; // for Best and Tiz
+        };
+
+        // values on the stack
+        struct Value {
+            Value() : number(0), isNumber(true) {}
+            double number;
+            QString string;
+            bool isNumber;
+        };
+
+        void compile(DataFilter *df, Leaf *root);
+        void clear() { code.clear(); numeric.clear(); text.clear(); }
+
+        // evaluate for row of the column tables. The program isn't changed by
+        // running it, so threads can share one if they each have their own stack
+        double run(DataFilter *df, const QVector<QVector<double> > &numbers, const QVector<QStringList> &texts,
+                   int row, QString filename, QVector<Value> &stack) const;
+
+        QVector<Instruction> code;
+        QStringList numeric;                    // metric symbol for each numeric column
+        QList<QPair<QString, QString> > text;   // field name and fallback for each text column
+
+    private:
+        void compileEval(DataFilter *df, Leaf *leaf);
+        void compileOperand(DataFilter *df, Leaf *leaf, QString fallback);
+        void compileDuration(DataFilter *df, Leaf *leaf);
+        int numericColumn(QString symbol);
+        int textColumn(QString name, QString fallback);
+};
+
 class DataFilter : public QObject
 {
     Q_OBJECT
@@ -65,6 +122,10 @@ class DataFilter : public QObject
     public:
         DataFilter(QObject *parent, Context *context);
 
+        // just the syntax, safe on any thread, the caller owns the tree
+        // and it is NULL (with the errors) if it didn't parse
+        static Leaf *parse(QString query, QStringList &errors);
+
         Context *context;
         QStringList &files() { return filenames; }
 
@@ -87,9 +148,18 @@ class DataFilter : public QObject
 
     private:
         Leaf *treeRoot;
+        DataFilterProgram program;
         QStringList errors;
 
         QStringList filenames;
+
+        // the rides that pass the compiled program
+        QStringList evaluate(const QList<SummaryMetrics> &rides);
+
+        // named filters keep their results in the metric db, only the
+        // rides written since they were last run are evaluated again
+        bool isNamed(QString query);
+        QStringList named(QString query);
 };
 
 extern int DataFilterdebug;
@@ -32,23 +32,19 @@
 //
 //
 
-#include "DataFilter.h"
-
-extern int DataFilterlex(); // the lexer aka yylex()
-extern char *DataFiltertext; // set by the lexer aka yytext
-
-extern void DataFilter_setString(QString);
-extern void DataFilter_clearString();
+// The parser is pure and the scanner reentrant, all the state for a
+// parse is in the DataFilterParse and the scanner passed to it, so
+// any number of filters can be parsed at once on different threads.
 
-// PARSER STATE VARIABLES
-extern QStringList DataFiltererrors;
-static void DataFiltererror(const char *error) { DataFiltererrors << QString(error);}
-extern int DataFilterparse();
-
-extern Leaf *root; // root node for parsed statement
+#include "DataFilter.h"
 
 %}
 
+%pure-parser
+%parse-param { DataFilterParse *parse }
+%parse-param { void *scanner }
+%lex-param { void *scanner }
+
 // Symbol can be meta or metric name
 %token <leaf> SYMBOL
 
@@ -73,6 +69,14 @@ extern Leaf *root; // root node for parsed statement
 %type <leaf> symbol value lexpr;
 %type <op> lop cop bop;
 
+%{
+// after the %union so YYSTYPE is known
+extern int DataFilterlex(YYSTYPE *lval, void *scanner); // the lexer aka yylex()
+extern char *DataFilterget_text(void *scanner); // aka yytext
+
+static void DataFiltererror(DataFilterParse *parse, void *, const char *error) { parse->errors << QString(error); }
+%}
+
 %left ADD SUBTRACT DIVIDE MULTIPLY POW
 %left EQ NEQ LT LTE GT GTE MATCHES ENDSWITH CONTAINS
 %left AND OR
@@ -80,7 +84,7 @@ extern Leaf *root; // root node for parsed statement
 %start filter;
 %%
 
-filter: lexpr                       { root = $1; }
+filter: lexpr                       { parse->root = $1; }
         ;
 
 lexpr : '(' lexpr ')'               { $$ = new Leaf();
@@ -135,22 +139,22 @@ bop   : ADD
       ;
 
 symbol : SYMBOL                      { $$ = new Leaf(); $$->type = Leaf::Symbol;
-                                      if (QString(DataFiltertext) == "BikeScore")
+                                      if (QString(DataFilterget_text(scanner)) == "BikeScore")
                                         $$->lvalue.n = new QString("BikeScore&#8482;");
                                       else
-                                        $$->lvalue.n = new QString(DataFiltertext);
+                                        $$->lvalue.n = new QString(DataFilterget_text(scanner));
                                     }
         ;
 
 value : symbol                      { $$ = $1; }
 
       | STRING                      { $$ = new Leaf(); $$->type = Leaf::String;
-                                      QString s2(DataFiltertext);
+                                      QString s2(DataFilterget_text(scanner));
                                       $$->lvalue.s = new QString(s2.mid(1,s2.length()-2)); }
       | FLOAT                       { $$ = new Leaf(); $$->type = Leaf::Float;
-                                      $$->lvalue.f = QString(DataFiltertext).toFloat(); }
+                                      $$->lvalue.f = QString(DataFilterget_text(scanner)).toFloat(); }
       | INTEGER                     { $$ = new Leaf(); $$->type = Leaf::Integer;
-                                      $$->lvalue.i = QString(DataFiltertext).toInt(); }
+                                      $$->lvalue.i = QString(DataFilterget_text(scanner)).toInt(); }
 
       | BEST '(' symbol ',' lexpr ')' { $$ = new Leaf(); $$->type = Leaf::Function;
                                         $$->function = QString($1);
@@ -19,6 +19,7 @@
 #include "DataProcessor.h"
 #include "Context.h"
 #include "AllPlot.h"
+#include "Trace.h"
 #include "Settings.h"
 #include "Units.h"
 
@@ -40,21 +41,84 @@ DataProcessorFactory::registerProcessor(QString name, DataProcessor *processor)
 bool
 DataProcessorFactory::autoProcess(RideFile *ride)
 {
+    GC_TRACE_SPAN("data processors");
     bool changed = false;
 
-    // run through the processors and execute them!
+    // run through the processors and execute them! those that stream
+    // and are next to each other are run together in a single pass
+    QList<DataProcessor*> streaming;
     QMapIterator<QString, DataProcessor*> i(processors);
     i.toFront();
     while (i.hasNext()) {
         i.next();
         QString configsetting = QString("dp/%1/apply").arg(i.key());
-        if (appsettings->value(NULL, configsetting, "Manual").toString() == "Auto")
-            i.value()->postProcess(ride);
+        if (appsettings->value(NULL, configsetting, "Manual").toString() != "Auto") continue;
+
+        if (i.value()->isStreaming()) {
+            streaming << i.value();
+            continue;
+        }
+
+        if (streaming.count() && streamProcess(ride, streaming)) changed = true;
+        streaming.clear();
+
+        if (i.value()->postProcess(ride)) changed = true;
     }
+    if (streaming.count() && streamProcess(ride, streaming)) changed = true;
 
     return changed;
 }
 
+bool
+DataProcessorFactory::streamProcess(RideFile *ride, QList<DataProcessor*> processors, DataProcessorConfig *settings)
+{
+    DataProcessorEdits edits(ride);
+
+    // those that have something to do
+    QVector<DataProcessorStream*> streams;
+    QStringList names;
+    foreach(DataProcessor *processor, processors) {
+        DataProcessorStream *stream = processor->startStream(ride, &edits, settings);
+        if (stream) {
+            streams << stream;
+            names << stream->name;
+        }
+    }
+    if (streams.isEmpty()) return false;
+
+    // one pass over the samples for all of them
+    int points = ride->dataPoints().count();
+    for (int i=0; i<points; i++)
+        for (int j=0; j<streams.count(); j++)
+            streams[j]->point(i);
+
+    bool changed = false;
+    foreach(DataProcessorStream *stream, streams) {
+        if (stream->finish()) changed = true;
+        delete stream;
+    }
+
+    edits.commit(names.join(", "));
+    return changed;
+}
+
+void
+DataProcessorEdits::setPointValue(int index, RideFile::SeriesType series, double value)
+{
+    values->append(index, series, ride->getPointValue(index, series), value);
+    ride->setPointValue(index, series, value);
+}
+
+void
+DataProcessorEdits::commit(QString name)
+{
+    if (values->runs.isEmpty()) return;
+
+    // the stack owns it now
+    ride->command->appendLUW(name, QVector<RideCommand*>() << values);
+    values = new SetPointValuesCommand(ride);
+}
+
 ManualDataProcessorDialog::ManualDataProcessorDialog(Context *context, QString name, RideItem *ride) : context(context), ride(ride)
 {
     setAttribute(Qt::WA_DeleteOnClose);
@@ -30,11 +30,17 @@
 #include <QMap>
 #include <QVector>
 
-// This file defines four classes:
+// This file defines six classes:
 //
 // DataProcessorConfig is a base QWidget that must be supplied by the
 // DataProcessor to enable the user to configure its options
 //
+// DataProcessorEdits collects the changes made by streaming processors
+// so they can be added to the undo stack together
+//
+// DataProcessorStream is the per-ride state of a streaming processor
+// which sees each sample once, in order, alongside any others
+//
 // DataProcessor is an abstract base class for function-objects that take a
 // rideFile and manipulate it. Examples include fixing gaps in recording or
 // creating the .notes or .cpi file
@@ -65,6 +71,42 @@ class DataProcessorConfig : public QWidget
         virtual QString explain() = 0;
 };
 
+// changes made by streaming processors are applied as they are made, so
+// those later in the pass see them, and added to the ride's undo stack
+// as a single logical unit of work once the pass is complete
+class DataProcessorEdits
+{
+    public:
+        DataProcessorEdits(RideFile *ride) : ride(ride), values(new SetPointValuesCommand(ride)) {}
+        ~DataProcessorEdits() { delete values; }
+
+        void setPointValue(int index, RideFile::SeriesType series, double value);
+        void commit(QString name);
+
+    private:
+        RideFile *ride;
+        SetPointValuesCommand *values;
+};
+
+// what a streaming processor knows about the ride it is working on, the
+// samples are passed to point() in order and finish() is called after the
+// last one. Returns true from finish() if the ride was changed.
+class DataProcessorStream
+{
+    public:
+        DataProcessorStream(QString name, RideFile *ride, DataProcessorEdits *edits)
+        : name(name), ride(ride), edits(edits) {}
+        virtual ~DataProcessorStream() {}
+        virtual void point(int index) = 0;
+        virtual bool finish() = 0;
+
+        QString name; // for the undo stack
+
+    protected:
+        RideFile *ride;
+        DataProcessorEdits *edits;
+};
+
 // the data processor abstract base class
 class DataProcessor
 {
@@ -74,6 +116,11 @@ class DataProcessor
         virtual bool postProcess(RideFile *, DataProcessorConfig*settings=0) = 0;
         virtual DataProcessorConfig *processorConfig(QWidget *parent) = 0;
         virtual QString name() = 0; // Localized Name for user interface
+
+        // processors that only need to see each sample once and in order
+        // can be run together in a single pass, NULL if nothing to do
+        virtual bool isStreaming() { return false; }
+        virtual DataProcessorStream *startStream(RideFile *, DataProcessorEdits *, DataProcessorConfig* =0) { return NULL; }
 };
 
 // all data processors
@@ -91,6 +138,9 @@ class DataProcessorFactory {
         bool registerProcessor(QString name, DataProcessor *processor);
         QMap<QString,DataProcessor*> getProcessors() const { return processors; }
         bool autoProcess(RideFile *); // run auto processes (after open rideFile)
+
+        // run streaming processors in a single pass over the ride
+        static bool streamProcess(RideFile *, QList<DataProcessor*>, DataProcessorConfig *settings=0);
 };
 
 class Context;
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "DelimitedText.h"
+#include "XmlValues.h"
+#include <QTextStream>
+
+DelimitedText::DelimitedText(QFile &file) : pos(0)
+{
+    // same codec detection as reading it line by line
+    QTextStream is(&file);
+    text = is.readAll();
+}
+
+QString
+DelimitedText::readLine()
+{
+    const QChar *data = text.constData();
+    int n = text.length();
+
+    int from = pos;
+    while (pos < n && data[pos] != '\n' && data[pos] != '\r') pos++;
+    QString line = text.mid(from, pos - from);
+
+    // step over the line ending, CRLF is one ending
+    if (pos < n) {
+        if (data[pos] == '\r' && pos+1 < n && data[pos+1] == '\n') pos += 2;
+        else pos++;
+    }
+
+    return line;
+}
+
+double
+DelimitedLine::value(int i) const
+{
+    // plain decimals are parsed directly, the rest goes to toDouble
+    return xmlDouble(text(i));
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_DelimitedText_h
+#define _GC_DelimitedText_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QStringList>
+#include <QFile>
+
+// Line by line access to a text ride file (CSV et al) that is read in one
+// go. Lines may end with LF, CRLF or the CR of old Macintosh files, so the
+// readers no longer need to split each readLine() again looking for CRs
+class DelimitedText
+{
+    public:
+        DelimitedText(QFile &file);
+
+        bool atEnd() const { return pos >= text.length(); }
+        QString readLine();
+
+    private:
+        QString text;
+        int pos;
+};
+
+// One line split into its fields once, QString::section() splits the whole
+// line again on every call. Fields past the end are empty, just like section()
+class DelimitedLine
+{
+    public:
+        DelimitedLine(const QString &line, QChar separator) : fields(line.split(separator)) {}
+
+        int count() const { return fields.count(); }
+        QString text(int i) const { return i < fields.count() ? fields.at(i) : QString(); }
+        double value(int i) const;  // as text(i).toDouble()
+        int integer(int i) const { return text(i).toInt(); }
+
+    private:
+        QStringList fields;
+};
+
+#endif // _GC_DelimitedText_h
@@ -23,6 +23,7 @@
 #include "CommPort.h"
 #include <QObject>
 #include <QApplication>
+#include <QMetaType>
 
 struct DeviceDownloadFile
 {
@@ -30,6 +31,7 @@ struct DeviceDownloadFile
     QDateTime   startTime;
     QString     extension;
 };
+Q_DECLARE_METATYPE(DeviceDownloadFile)
 
 struct DeviceStoredRideItem
 {
@@ -72,6 +74,11 @@ signals:
     void updateStatus( QString statusText );
     void updateProgress( QString progressText );
 
+    // download() runs on its own thread, devices holding several rides
+    // say when each file is complete so it can be stored whilst the rest
+    // are still coming off the device
+    void downloaded( DeviceDownloadFile file );
+
 public slots:
     virtual void cancelled();
 
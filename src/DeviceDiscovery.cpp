@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "DeviceDiscovery.h"
+#include "DeviceTypes.h"
+#include "Settings.h"
+#include "RealtimeController.h"
+#ifdef GC_HAVE_WFAPI
+#include "KickrController.h"
+#include "BT40Controller.h"
+#endif
+#ifdef GC_HAVE_LIBUSB
+#include "FortiusController.h"
+#endif
+#include "ComputrainerController.h"
+#include "ANTlocalController.h"
+#include "NullController.h"
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSet>
+#include <QTime>
+
+// how long to wait for the first port to answer, a Computrainer can
+// take a second to reply and a USB serial adapter a little longer
+static const int DISCOVERTIMEOUT = 3000; // ms
+
+// once one has answered, how much longer the others get
+static const int DISCOVERGRACE = 500; // ms
+
+// most ports probed at once
+static const int DISCOVERTHREADS = 32;
+
+// what a round of probes share, held by each probe so it
+// outlives discover() when stragglers are left behind
+struct DeviceProbes
+{
+    DeviceProbes() : pending(0), stopped(false) {}
+
+    QMutex lock;
+    QWaitCondition changed;
+    QStringList answered;   // in the order they answered
+    int pending;            // probes still running
+    bool stopped;
+};
+
+// ports with a probe still running, perhaps from a round we gave up on,
+// opening them twice at once would only confuse the device
+static QMutex busyLock;
+static QSet<QString> busy;
+
+// probes block on the port so they get threads of their own
+// rather than holding up the global pool
+Q_GLOBAL_STATIC(QThreadPool, probePool)
+
+struct DeviceProbe : public QRunnable
+{
+    int type;
+    QString port;
+    QSharedPointer<DeviceProbes> probes;
+
+    DeviceProbe(int type, QString port, QSharedPointer<DeviceProbes> probes) :
+        type(type), port(port), probes(probes) {}
+
+    void run() {
+        RealtimeController *controller = DeviceDiscovery::newController(type);
+        bool answered = controller && controller->discover(port);
+        delete controller;
+
+        busyLock.lock();
+        busy.remove(port);
+        busyLock.unlock();
+
+        QMutexLocker locker(&probes->lock);
+        if (answered) probes->answered << port;
+        probes->pending--;
+        probes->changed.wakeAll();
+    }
+};
+
+DeviceDiscovery::DeviceDiscovery(int type, QObject *parent) : QObject(parent), type(type) {}
+
+RealtimeController *
+DeviceDiscovery::newController(int type)
+{
+    switch (type) {
+
+    case DEV_CT : return new ComputrainerController(NULL, NULL);
+#ifdef GC_HAVE_LIBUSB
+    case DEV_FORTIUS : return new FortiusController(NULL, NULL);
+#endif
+    case DEV_NULL : return new NullController(NULL, NULL);
+    case DEV_ANTLOCAL : return new ANTlocalController(NULL, NULL);
+#ifdef GC_HAVE_WFAPI
+    case DEV_KICKR : return new KickrController(NULL, NULL);
+    case DEV_BT40 : return new BT40Controller(NULL, NULL);
+#endif
+    default: return NULL;
+    }
+}
+
+QString
+DeviceDiscovery::lastPort(int type)
+{
+    return appsettings->value(NULL, QString("%1/%2").arg(GC_LAST_DISCOVER_PORT).arg(type), "").toString();
+}
+
+void
+DeviceDiscovery::setLastPort(int type, QString port)
+{
+    appsettings->setValue(QString("%1/%2").arg(GC_LAST_DISCOVER_PORT).arg(type), port);
+}
+
+void
+DeviceDiscovery::stop()
+{
+    lock.lock();
+    QSharedPointer<DeviceProbes> round = probes;
+    lock.unlock();
+
+    if (round) {
+        QMutexLocker locker(&round->lock);
+        round->stopped = true;
+        round->changed.wakeAll();
+    }
+}
+
+QStringList
+DeviceDiscovery::discover(QStringList ports, bool all)
+{
+    // where we found it last time goes to the front of the queue
+    QStringList last = lastPort(type).split(",", QString::SkipEmptyParts);
+    for (int i=last.count()-1; i>=0; i--) if (ports.removeAll(last[i])) ports.prepend(last[i]);
+
+    QSharedPointer<DeviceProbes> round(new DeviceProbes);
+    lock.lock();
+    probes = round;
+    lock.unlock();
+
+    QThreadPool *pool = probePool();
+    pool->setMaxThreadCount(DISCOVERTHREADS);
+
+    foreach (QString port, ports) {
+
+        busyLock.lock();
+        bool inuse = busy.contains(port);
+        if (!inuse) busy.insert(port);
+        busyLock.unlock();
+        if (inuse) continue;
+
+        round->lock.lock();
+        round->pending++;
+        round->lock.unlock();
+        pool->start(new DeviceProbe(type, port, round));
+    }
+
+    // wait for them to answer, passing each on as it does
+    QTime clock;
+    clock.start();
+    int deadline = DISCOVERTIMEOUT;
+    int reported = 0;
+
+    round->lock.lock();
+    forever {
+
+        while (reported < round->answered.count()) {
+            QString port = round->answered.at(reported++);
+            if (reported == 1) deadline = qMin(deadline, clock.elapsed() + DISCOVERGRACE);
+
+            round->lock.unlock();
+            emit found(port);
+            round->lock.lock();
+        }
+
+        if (round->stopped || !round->pending || (reported && !all)) break;
+
+        int left = deadline - clock.elapsed();
+        if (left <= 0) break;
+        round->changed.wait(&round->lock, left);
+    }
+    QStringList answered = round->answered.mid(0, all ? reported : qMin(reported, 1));
+    bool stopped = round->stopped;
+    round->lock.unlock();
+
+    lock.lock();
+    probes.clear();
+    lock.unlock();
+
+    if (!stopped && answered.count()) setLastPort(type, answered.join(","));
+    return answered;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef _GC_DeviceDiscovery_h
+#define _GC_DeviceDiscovery_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QSharedPointer>
+#include <QMutex>
+
+class RealtimeController;
+struct DeviceProbes;
+
+// Probes every candidate serial port for a device at once, rather than
+// one after the other waiting out the handshake timeout on each. Machines
+// with a lot of virtual COM ports (bluetooth, modems, phone sync) would
+// otherwise take the best part of a minute to scan.
+//
+// Each port is probed on its own thread with its own controller. The
+// port the device was last found on is probed first and results are
+// signalled as they arrive. Probes that haven't answered by the time we
+// give up are left to finish on their own and the port is skipped until
+// they do.
+class DeviceDiscovery : public QObject
+{
+    Q_OBJECT
+
+    public:
+        DeviceDiscovery(int type, QObject *parent = 0);
+        void setType(int x) { type = x; }
+
+        // blocks the caller until the device is found on a port, or on
+        // every port that answers if all is set, or we give up. Returns
+        // the ports that answered in the order they did.
+        QStringList discover(QStringList ports, bool all);
+
+        // give up on the discover in progress, from any thread
+        void stop();
+
+        // where we found each type of device last time
+        static QString lastPort(int type);
+        static void setLastPort(int type, QString port);
+
+        // a controller for the device type, NULL if we don't know it
+        static RealtimeController *newController(int type);
+
+    signals:
+        void found(QString port); // as each port answers
+
+    private:
+        int type;
+        QMutex lock;                         // for probes, stop() is called from the gui
+        QSharedPointer<DeviceProbes> probes; // the round in progress
+};
+
+#endif // _GC_DeviceDiscovery_h
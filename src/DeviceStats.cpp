@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "DeviceStats.h"
+#include <math.h>
+
+const int DeviceStats::bucketLimit[DeviceStats::Buckets] = { 10, 25, 50, 100, 250, 500, 1000, 0 };
+
+DeviceStats::DeviceStats()
+{
+    reset();
+}
+
+void
+DeviceStats::reset()
+{
+    QMutexLocker locker(&statsLock);
+
+    clock.invalidate();
+    count = 0;
+    mean = m2 = 0;
+    maxInterval = 0;
+    for (int i=0; i<Buckets; i++) histogram[i] = 0;
+    depth = maxDepth = 0;
+    waits = contended = 0;
+    waitTotal = 0;
+    maxWait = 0;
+    tasks = 0;
+    taskTotal = 0;
+    maxTask = 0;
+}
+
+void
+DeviceStats::arrived()
+{
+    QMutexLocker locker(&statsLock);
+
+    // first one just starts the clock
+    if (!clock.isValid()) {
+        clock.start();
+        return;
+    }
+    qint64 interval = clock.restart();
+
+    count++;
+    double delta = interval - mean;
+    mean += delta / count;
+    m2 += delta * (interval - mean);
+    if (interval > maxInterval) maxInterval = interval;
+
+    int i=0;
+    while (i < Buckets-1 && interval > bucketLimit[i]) i++;
+    histogram[i]++;
+}
+
+void
+DeviceStats::queued(int depth)
+{
+    QMutexLocker locker(&statsLock);
+
+    this->depth = depth;
+    if (depth > maxDepth) maxDepth = depth;
+}
+
+void
+DeviceStats::took(qint64 usecs)
+{
+    QMutexLocker locker(&statsLock);
+
+    tasks++;
+    taskTotal += usecs;
+    if (usecs > maxTask) maxTask = usecs;
+}
+
+void
+DeviceStats::lock(QMutex &mutex)
+{
+    // most of the time nobody else has it
+    qint64 usecs = 0;
+    if (!mutex.tryLock()) {
+        QElapsedTimer waited;
+        waited.start();
+        mutex.lock();
+        usecs = waited.nsecsElapsed() / 1000;
+    }
+
+    QMutexLocker locker(&statsLock);
+    waits++;
+    if (usecs) {
+        contended++;
+        waitTotal += usecs;
+        if (usecs > maxWait) maxWait = usecs;
+    }
+}
+
+QString
+DeviceStats::summary() const
+{
+    QMutexLocker locker(&statsLock);
+
+    if (!count && !tasks) return tr("No messages");
+
+    QString line = tr("%1 msgs, every %2ms (jitter %3ms, max %4ms)")
+                   .arg(count+1)
+                   .arg(mean, 0, 'f', 0)
+                   .arg(count > 1 ? sqrt(m2 / (count-1)) : 0, 0, 'f', 1)
+                   .arg(maxInterval);
+    if (tasks) line += tr(", took %1ms (max %2ms)").arg(taskTotal / tasks / 1000.0, 0, 'f', 1)
+                                                          .arg(maxTask / 1000.0, 0, 'f', 1);
+    return line;
+}
+
+QString
+DeviceStats::report() const
+{
+    QString text = summary() + "\n";
+
+    QMutexLocker locker(&statsLock);
+
+    // interval histogram
+    int from = 0;
+    for (int i=0; i<Buckets; i++) {
+        if (bucketLimit[i]) text += QString("  %1-%2ms: %3\n").arg(from).arg(bucketLimit[i]).arg(histogram[i]);
+        else text += QString("  >%1ms: %2\n").arg(from).arg(histogram[i]);
+        from = bucketLimit[i];
+    }
+
+    text += QString("  queued: %1 now, %2 max\n").arg(depth).arg(maxDepth);
+    text += QString("  locks: %1, %2 contended, %3us average wait, %4us max\n")
+            .arg(waits).arg(contended)
+            .arg(contended ? waitTotal / contended : 0, 0, 'f', 0)
+            .arg(maxWait);
+    return text;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_DeviceStats_h
+#define _GC_DeviceStats_h 1
+#include "GoldenCheetah.h"
+
+#include <QApplication>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QString>
+
+// Timing instrumentation for the realtime devices so we can tell whether
+// lag comes from the device, the controller thread or the gui. The device
+// thread notes each message as it arrives, how much is queued behind it
+// and how long it waited for its locks. The train sidebar keeps one for
+// its own refreshes, noting how long each took. Updates are a handful of
+// sums under a mutex of its own so they are cheap enough to leave on.
+class DeviceStats
+{
+    Q_DECLARE_TR_FUNCTIONS(DeviceStats)
+
+    public:
+
+        // message interval histogram, upper bound of each bucket in msecs
+        // the last one catches everything longer
+        enum { Buckets = 8 };
+        static const int bucketLimit[Buckets];
+
+        DeviceStats();
+        void reset();
+
+        void arrived();             // a message arrived now
+        void queued(int depth);     // messages or bytes waiting to be processed
+        void took(qint64 usecs);    // time spent processing
+        void lock(QMutex &mutex);   // lock mutex noting how long we waited
+
+        QString summary() const;    // one line, for the device tree
+        QString report() const;     // all of it, for the log
+
+    private:
+
+        mutable QMutex statsLock;
+        QElapsedTimer clock;        // since the last message
+
+        // interval between messages, mean and variance by Welford
+        qint64 count;
+        double mean, m2;
+        qint64 maxInterval;
+        qint64 histogram[Buckets];
+
+        int depth, maxDepth;
+
+        qint64 waits, contended;
+        double waitTotal;
+        qint64 maxWait;
+
+        qint64 tasks;
+        double taskTotal;
+        qint64 maxTask;
+};
+
+#endif // _GC_DeviceStats_h
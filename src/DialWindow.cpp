@@ -22,7 +22,7 @@
 #include "Context.h"
 
 DialWindow::DialWindow(Context *context) :
-    GcWindow(context), context(context), average(1), isNewLap(false)
+    GcWindow(context), context(context), average(1)
 {
     rolling.resize(150); // enough for 30 seconds at 5hz
 
@@ -79,11 +79,9 @@ DialWindow::DialWindow(Context *context) :
     layout->addWidget(valueLabel);
 
     // get updates..
-    connect(context, SIGNAL(telemetryUpdate(RealtimeData)), this, SLOT(telemetryUpdate(RealtimeData)));
     connect(context, SIGNAL(configChanged()), this, SLOT(seriesChanged()));
     connect(context, SIGNAL(stop()), this, SLOT(stop()));
     connect(context, SIGNAL(start()), this, SLOT(start()));
-    connect(context, SIGNAL(newLap()), this, SLOT(onNewLap()));
 
     connect(seriesSelector, SIGNAL(currentIndexChanged(int)), this, SLOT(seriesChanged()));
     connect(averageSlider, SIGNAL(valueChanged(int)),this, SLOT(setAverageFromSlider()));
@@ -161,17 +159,6 @@ DialWindow::telemetryUpdate(const RealtimeData &rtData)
 
     }
 
-    if( isNewLap &&
-        ( series == RealtimeData::AvgCadenceLap ||
-        series == RealtimeData::AvgHeartRateLap ||
-        series == RealtimeData::AvgSpeedLap ||
-        series == RealtimeData::AvgWattsLap ) )
-    {
-        count = 0;
-        sum = 0.0;
-        isNewLap = false;
-    }
-
     switch (series) {
 
     case RealtimeData::Time:
@@ -215,209 +202,47 @@ DialWindow::telemetryUpdate(const RealtimeData &rtData)
         valueLabel->setText(QString("%1").arg(value, 0, 'f', 3));
         break;
 
-    case RealtimeData::AvgWatts:
-    case RealtimeData::AvgWattsLap:
-        sum += rtData.value(RealtimeData::Watts);
-        count++;
-        value = sum / count;
-        valueLabel->setText(QString("%1").arg(round(value)));
-        break;
-
+    // averages are kept once for everyone by RealtimeMetrics
     case RealtimeData::AvgSpeed:
     case RealtimeData::AvgSpeedLap:
-        sum += rtData.value(RealtimeData::Speed);
-        count++;
-        value = sum / count;
         if (!context->athlete->useMetricUnits) value *= MILES_PER_KM;
         valueLabel->setText(QString("%1").arg(value, 0, 'f', 1));
         break;
 
+    case RealtimeData::AvgWatts:
+    case RealtimeData::AvgWattsLap:
     case RealtimeData::AvgCadence:
     case RealtimeData::AvgCadenceLap:
-        sum += rtData.value(RealtimeData::Cadence);
-        count++;
-        value = sum / count;
-        valueLabel->setText(QString("%1").arg(round(value)));
-        break;
-
     case RealtimeData::AvgHeartRate:
     case RealtimeData::AvgHeartRateLap:
-        sum += rtData.value(RealtimeData::HeartRate);
-        count++;
-        value = sum / count;
         valueLabel->setText(QString("%1").arg(round(value)));
         break;
 
     // ENERGY
     case RealtimeData::Joules:
-        sum += rtData.value(RealtimeData::Watts) / 5; // joules
-        valueLabel->setText(QString("%1").arg(round(sum/1000))); // kJoules
+        valueLabel->setText(QString("%1").arg(round(value/1000))); // kJoules
         break;
 
-    // COGGAN Metrics
-    case RealtimeData::NP:
-    case RealtimeData::IF:
-    case RealtimeData::TSS:
-    case RealtimeData::VI:
-        {
-
-        // Update sum of watts for last 30 seconds
-        sum += rtData.value(RealtimeData::Watts);
-        sum -= rolling[index];
-        rolling[index] = rtData.value(RealtimeData::Watts);
-
-        // raise average to the 4th power
-        rollingSum += pow(sum/150,4); // raise rolling average to 4th power
-        count ++;
-
-        // move index on/round
-        index = (index >= 149) ? 0 : index+1;
-
-        // calculate NP
-        double np = pow(rollingSum / (count), 0.25);
-
-        if (series == RealtimeData::NP) {
-            // We only wanted NP so thats it
-            valueLabel->setText(QString("%1").arg(round(np)));
-
-        } else {
-
-            double rif, cp;
-            // carry on and calculate IF
-            if (context->athlete->zones()) {
-
-                // get cp for today
-                int zonerange = context->athlete->zones()->whichRange(QDateTime::currentDateTime().date());
-                if (zonerange >= 0) cp = context->athlete->zones()->getCP(zonerange);
-                else cp = 0;
-
-            } else {
-                cp = 0;
-            }
-
-            if (cp) rif = np / cp;
-            else rif = 0;
-
-            if (series == RealtimeData::IF) {
-
-                // we wanted IF so thats it
-                valueLabel->setText(QString("%1").arg(rif, 0, 'f', 3));
-
-            } else {
-
-                double normWork = np * (rtData.value(RealtimeData::Time) / 1000); // msecs
-                double rawTSS = normWork * rif;
-                double workInAnHourAtCP = cp * 3600;
-                double tss = rawTSS / workInAnHourAtCP * 100.0;
-
-                if (series == RealtimeData::TSS) {
-
-                    valueLabel->setText(QString("%1").arg(tss, 0, 'f', 1));
-
-                } else {
-
-                    // track average power for VI
-                    apsum += rtData.value(RealtimeData::Watts);
-                    apcount++;
-
-                    double ap = apsum ? apsum / apcount : 0;
-
-                    // VI is all that is left!
-                    valueLabel->setText(QString("%1").arg(ap ? np / ap : 0, 0, 'f', 3));
-
-                }
-
-            }
-
-        }
-
-        }
+    case RealtimeData::WPrimeBal:
+        valueLabel->setText(QString("%1").arg(value/1000, 0, 'f', 1)); // kJoules
         break;
 
-    // SKIBA Metrics
+    // COGGAN and SKIBA Metrics, streamed by the train sidebar
+    case RealtimeData::NP:
     case RealtimeData::XPower:
+        valueLabel->setText(QString("%1").arg(round(value)));
+        break;
+
+    case RealtimeData::IF:
+    case RealtimeData::VI:
     case RealtimeData::RI:
-    case RealtimeData::BikeScore:
     case RealtimeData::SkibaVI:
-        {
-
-        static const double exp = 2.0f / ((25.0f / 0.2f) + 1.0f);
-        static const double rem = 1.0f - exp;
-
-        count++;
-
-        if (count < 125) {
-
-            // get up to speed
-            rsum += rtData.value(RealtimeData::Watts);
-            ewma = rsum / count;
-
-        } else {
-
-            // we're up to speed
-            ewma = (rtData.value(RealtimeData::Watts) * exp) + (ewma * rem);
-        }
-
-        sum += pow(ewma, 4.0f);
-        double xpower = pow(sum / count, 0.25f);
-
-        if (series == RealtimeData::XPower) {
-
-            // We wanted XPower!
-            valueLabel->setText(QString("%1").arg(round(xpower)));
-
-        } else {
-
-            double rif, cp;
-            // carry on and calculate IF
-            if (context->athlete->zones()) {
-
-                // get cp for today
-                int zonerange = context->athlete->zones()->whichRange(QDateTime::currentDateTime().date());
-                if (zonerange >= 0) cp = context->athlete->zones()->getCP(zonerange);
-                else cp = 0;
-
-            } else {
-                cp = 0;
-            }
-
-            if (cp) rif = xpower / cp;
-            else rif = 0;
-
-            if (series == RealtimeData::RI) {
-
-                // we wanted IF so thats it
-                valueLabel->setText(QString("%1").arg(rif, 0, 'f', 3));
-
-            } else {
-
-                double normWork = xpower * (rtData.value(RealtimeData::Time) / 1000); // msecs
-                double rawTSS = normWork * rif;
-                double workInAnHourAtCP = cp * 3600;
-                double tss = rawTSS / workInAnHourAtCP * 100.0;
-
-                if (series == RealtimeData::BikeScore) {
-
-                    valueLabel->setText(QString("%1").arg(tss, 0, 'f', 1));
-
-                } else {
-
-                    // track average power for Relative Intensity
-                    apsum += rtData.value(RealtimeData::Watts);
-                    apcount++;
-
-                    double ap = apsum ? apsum / apcount : 0;
-
-                    // RI is all that is left!
-                    valueLabel->setText(QString("%1").arg(ap ? xpower / ap : 0, 0, 'f', 3));
-
-                }
-
-            }
-
-        }
+        valueLabel->setText(QString("%1").arg(value, 0, 'f', 3));
+        break;
 
-        }
+    case RealtimeData::TSS:
+    case RealtimeData::BikeScore:
+        valueLabel->setText(QString("%1").arg(value, 0, 'f', 1));
         break;
 
     case RealtimeData::Load:
@@ -456,6 +281,33 @@ void DialWindow::seriesChanged()
     RealtimeData::DataSeries series = static_cast<RealtimeData::DataSeries>
                   (seriesSelector->itemData(seriesSelector->currentIndex()).toInt());
 
+    // smoothing needs every sample, the rest only when they are on
+    // screen and what they show has changed
+    QList<RealtimeData::DataSeries> shows;
+    bool always = false;
+    switch(series) {
+
+    case RealtimeData::HeartRate:
+    case RealtimeData::Watts:
+    case RealtimeData::AltWatts:
+    case RealtimeData::Cadence:
+            always = true;
+            break;
+
+    case RealtimeData::LRBalance:
+            shows << RealtimeData::Watts << RealtimeData::AltWatts;
+            break;
+
+    case RealtimeData::Load: // or slope
+    case RealtimeData::None:
+            break;
+
+    default:
+            shows << series;
+            break;
+    }
+    context->telemetry->subscribe(this, "telemetryUpdate", 0, shows, always);
+
     if (series == RealtimeData::HeartRate ||
         series == RealtimeData::Watts  ||
         series == RealtimeData::AltWatts  ||
@@ -526,6 +378,10 @@ void DialWindow::seriesChanged()
             foreground = GColor(CHEARTRATE);
             break;
 
+    case RealtimeData::WPrimeBal:
+            foreground = GColor(CWBAL);
+            break;
+
     case RealtimeData::AltWatts:
             foreground = GColor(CALTPOWER);
             break;
@@ -563,8 +419,3 @@ DialWindow::setAverageFromSlider() {
     setAverageFromText(QString("%1").arg(averageSlider->value()));
 }
 
-void
-DialWindow::onNewLap()
-{
-    isNewLap = true;
-}
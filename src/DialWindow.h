@@ -84,7 +84,6 @@ class DialWindow : public GcWindow
         void start();
         void stop();
         void pause();
-        void onNewLap();
 
     protected:
 
@@ -108,33 +107,22 @@ class DialWindow : public GcWindow
         double avg30, avgLap, avgTotal;
         double lapNumber;
 
-        // for calculating averages
+        // for smoothing, the session and lap averages
+        // come from RealtimeMetrics with the telemetry
         int average;
         int count;
         double sum;
-        bool isNewLap;
 
         // for keeping track of rolling averages (max 30s at 5hz)
-        // used by NP and XPower
         QVector<double> rolling;
-        double rollingSum;
         int index; // index into rolling (circular buffer)
 
-
-        // VI/RI makes us track AP too
-        int apcount;
-        int apsum;
-
-        // used by XPower algorithm
-        double rsum, ewma;
-
         void resetValues() { 
 
             rolling.fill(0.00);
-            rsum = ewma = 0.0f;
-            rollingSum = index = 0;
-            apcount = count = sum = instantValue = avg30 =
-            apsum = avgLap = avgTotal = lapNumber = 0;
+            index = 0;
+            count = sum = instantValue = avg30 =
+            avgLap = avgTotal = lapNumber = 0;
             telemetryUpdate(RealtimeData());
         }
 
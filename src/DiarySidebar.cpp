@@ -112,9 +112,10 @@ DiarySidebar::DiarySidebar(Context *context) : context(context)
     connect(summarySelect, SIGNAL(currentIndexChanged(int)), this, SLOT(refresh()));
 
     // refresh on these events...
-    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(refresh()));
-    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(refresh()));
-    connect(context, SIGNAL(configChanged()), this, SLOT(refresh()));
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(rideChange(RideItem*)));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(rideChange(RideItem*)));
+    connect(context, SIGNAL(configChanged()), this, SLOT(invalidate()));
+    connect(context->athlete->metricDB, SIGNAL(dataChanged()), this, SLOT(invalidate()));
 
     // set up for current selections
     refresh();
@@ -130,6 +131,23 @@ DiarySidebar::refresh()
     }
 }
 
+void
+DiarySidebar::rideChange(RideItem *ride)
+{
+    // the summary only needs querying again if the ride
+    // falls in the date range it is currently showing
+    if (ride && ride->dateTime.date() >= from && ride->dateTime.date() <= to)
+        from = to = QDate();
+    refresh();
+}
+
+void
+DiarySidebar::invalidate()
+{
+    from = to = QDate();
+    refresh();
+}
+
 void
 DiarySidebar::setRide(RideItem *ride)
 {
@@ -636,67 +654,50 @@ GcMiniCalendar::dayClicked(int i)
 void
 GcMiniCalendar::previous()
 {
-    QList<QDateTime> allDates = context->athlete->metricDB->db()->getAllDates();
-    qSort(allDates);
-
-    // begin of month
-    QDateTime bom(QDate(year,month,01), QTime(0,0,0));
-
-    for(int i=allDates.count()-1; i>=0; i--) {
-        if (allDates.at(i) < bom) {
-
-            QDate date = allDates.at(i).date();
-            month = date.month();
-            year = date.year();
-            calendarModel->setMonth(date.month(), date.year());
-
-            // find the day in the calendar...
-            for (int day=42; day>0;day--) {
-
-                QModelIndex p = calendarModel->index(day/7,day%7);
-                QDate heredate = calendarModel->date(p);
-                if (date == heredate) {
-                    // select this ride...
-                    QStringList files = calendarModel->data(p, GcCalendarModel::FilenamesRole).toStringList();
-                    if (files.count()) context->athlete->selectRideFile(QFileInfo(files[0]).fileName());
-                }
+    // last ride before the beginning of the month
+    QDate date = calendarModel->before(QDate(year,month,01));
+    if (date.isValid()) {
+        month = date.month();
+        year = date.year();
+        calendarModel->setMonth(date.month(), date.year());
+
+        // find the day in the calendar...
+        for (int day=42; day>0;day--) {
+
+            QModelIndex p = calendarModel->index(day/7,day%7);
+            QDate heredate = calendarModel->date(p);
+            if (date == heredate) {
+                // select this ride...
+                QStringList files = calendarModel->data(p, GcCalendarModel::FilenamesRole).toStringList();
+                if (files.count()) context->athlete->selectRideFile(QFileInfo(files[0]).fileName());
             }
-            emit dateChanged(month,year);
-            break;
         }
+        emit dateChanged(month,year);
     }
 }
 
 void
 GcMiniCalendar::next()
 {
-    QList<QDateTime> allDates = context->athlete->metricDB->db()->getAllDates();
-    qSort(allDates);
-
-    // end of month
-    QDateTime eom(QDate(year,month,01).addMonths(1), QTime(00,00,00));
-    for(int i=0; i<allDates.count(); i++) {
-        if (allDates.at(i) >= eom) {
-
-            QDate date = allDates.at(i).date();
-            month = date.month();
-            year = date.year();
-            calendarModel->setMonth(date.month(), date.year());
-
-            // find the day in the calendar...
-            for (int day=0; day<42;day++) {
-
-                QModelIndex p = calendarModel->index(day/7,day%7);
-                QDate heredate = calendarModel->date(p);
-                if (date == heredate) {
-                    // select this ride...
-                    QStringList files = calendarModel->data(p, GcCalendarModel::FilenamesRole).toStringList();
-                    if (files.count()) context->athlete->selectRideFile(QFileInfo(files[0]).fileName());
-                }
+    // first ride from the end of the month
+    QDate date = calendarModel->after(QDate(year,month,01).addMonths(1));
+    if (date.isValid()) {
+        month = date.month();
+        year = date.year();
+        calendarModel->setMonth(date.month(), date.year());
+
+        // find the day in the calendar...
+        for (int day=0; day<42;day++) {
+
+            QModelIndex p = calendarModel->index(day/7,day%7);
+            QDate heredate = calendarModel->date(p);
+            if (date == heredate) {
+                // select this ride...
+                QStringList files = calendarModel->data(p, GcCalendarModel::FilenamesRole).toStringList();
+                if (files.count()) context->athlete->selectRideFile(QFileInfo(files[0]).fileName());
             }
-            emit dateChanged(month,year);
-            break;
         }
+        emit dateChanged(month,year);
     }
 }
 
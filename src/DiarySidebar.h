@@ -166,6 +166,8 @@ class DiarySidebar : public QWidget // not a GcWindow - belongs on sidebar
         void setRide(RideItem *ride);
         void refresh(); 
         void setSummary(); // set the summary at the bottom
+        void rideChange(RideItem *ride); // re-query summary if in range
+        void invalidate(); // metrics changed re-query summary
 
         void filterChanged() { multiCalendar->filterChanged(); }
 
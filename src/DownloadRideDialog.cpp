@@ -28,9 +28,11 @@
 
 DownloadRideDialog::DownloadRideDialog(Context *context,
                                        const QDir &home) :
-    context(context), home(home), cancelled(false),
+    context(context), home(home), cancelled(false), failures(0),
     action(actionIdle)
 {
+    qRegisterMetaType<DeviceDownloadFile>("DeviceDownloadFile");
+
     setAttribute(Qt::WA_DeleteOnClose);
     setWindowTitle(tr("Download Ride Data"));
 
@@ -277,7 +279,6 @@ DownloadRideDialog::downloadClicked()
         }
     }
     QString err;
-    QList<DeviceDownloadFile> files;
 
     DevicesPtr devtype = Devices::getType(deviceCombo->currentText());
     DevicePtr device = devtype->newDevice( dev );
@@ -304,7 +305,25 @@ DownloadRideDialog::downloadClicked()
     }
 
     updateStatus(tr("getting data ..."));
-    if (!device->download( home, files, err))
+
+    // the device is read on its own thread, rides it says are complete
+    // are stored (and parsed in addRide) whilst the rest download
+    stored.clear();
+    failures = 0;
+    connect( device.data(), SIGNAL(downloaded(DeviceDownloadFile)), this, SLOT(downloaded(DeviceDownloadFile)));
+
+    DownloadRideWorker worker(device, home);
+    worker.start();
+    while (!worker.wait(100)) QApplication::processEvents();
+
+    // deliver any that were still queued up when it finished
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    disconnect( device.data(), SIGNAL(downloaded(DeviceDownloadFile)), this, SLOT(downloaded(DeviceDownloadFile)));
+
+    QList<DeviceDownloadFile> &files(worker.files);
+    err = worker.err;
+
+    if (!worker.ok)
     {
         if (cancelled) {
             QMessageBox::information(this, tr("Download canceled"),
@@ -321,79 +340,94 @@ DownloadRideDialog::downloadClicked()
 
     updateProgress( "" );
 
-    int failures = 0;
+    // and the rest
     for( int i = 0; i < files.size(); ++i ){
-        if( ! files.at(i).startTime.isValid() ){
-            updateStatus(tr("file %1 has no valid timestamp, falling back to 'now'")
-                .arg(files.at(i).name));
-            files[i].startTime = QDateTime::currentDateTime();
-        }
+        if (!stored.contains(files.at(i).name)) storeFile(files.at(i));
+    }
 
-        QString filename( files.at(i).startTime
-            .toString("yyyy_MM_dd_hh_mm_ss")
-            + "." + files.at(i).extension );
-        QString filepath( home.absoluteFilePath(filename) );
-
-        if (QFile::exists(filepath)) {
-            if (QMessageBox::warning( this,
-                    tr("Ride Already Downloaded"),
-                    tr("The ride starting at %1 appears to have already "
-                        "been downloaded.  Do you want to overwrite the "
-                        "previous download?")
-                        .arg(files.at(i).startTime.toString()),
-                    tr("&Overwrite"), tr("&Skip"),
-                    QString(), 1, 1) == 1) {
-                QFile::remove(files.at(i).name);
-                updateStatus(tr("skipped file %1")
-                    .arg( files.at(i).name ));
-                continue;
-            }
-        }
+    if( ! failures )
+        updateStatus( tr("download completed successfully") );
 
-#ifdef __WIN32__
-        // Windows ::rename won't overwrite an existing file.
-        if (QFile::exists(filepath)) {
-            QFile old(filepath);
-            if (!old.remove()) {
-                QMessageBox::critical(this, tr("Error"),
-                    tr("Failed to remove existing file %1: %2")
-                        .arg(filepath)
-                        .arg(old.error()) );
-                QFile::remove(files.at(i).name);
-                updateStatus(tr("failed to rename %1 to %2")
-                    .arg( files.at(i).name )
-                    .arg( filename ));
-                ++failures;
-                continue;
-            }
-        }
-#endif
+    updateAction( actionIdle );
+}
 
-        // Use ::rename() instead of QFile::rename() to get forced overwrite.
-        if (rename(QFile::encodeName(files.at(i).name),
-            QFile::encodeName(filepath)) < 0) {
+void
+DownloadRideDialog::downloaded(DeviceDownloadFile file)
+{
+    storeFile(file);
+}
+
+bool
+DownloadRideDialog::storeFile(DeviceDownloadFile file)
+{
+    stored << file.name;
+
+    if( ! file.startTime.isValid() ){
+        updateStatus(tr("file %1 has no valid timestamp, falling back to 'now'")
+            .arg(file.name));
+        file.startTime = QDateTime::currentDateTime();
+    }
 
+    QString filename( file.startTime
+        .toString("yyyy_MM_dd_hh_mm_ss")
+        + "." + file.extension );
+    QString filepath( home.absoluteFilePath(filename) );
+
+    if (QFile::exists(filepath)) {
+        if (QMessageBox::warning( this,
+                tr("Ride Already Downloaded"),
+                tr("The ride starting at %1 appears to have already "
+                    "been downloaded.  Do you want to overwrite the "
+                    "previous download?")
+                    .arg(file.startTime.toString()),
+                tr("&Overwrite"), tr("&Skip"),
+                QString(), 1, 1) == 1) {
+            QFile::remove(file.name);
+            updateStatus(tr("skipped file %1")
+                .arg( file.name ));
+            return true;
+        }
+    }
+
+#ifdef __WIN32__
+    // Windows ::rename won't overwrite an existing file.
+    if (QFile::exists(filepath)) {
+        QFile old(filepath);
+        if (!old.remove()) {
             QMessageBox::critical(this, tr("Error"),
-                tr("Failed to rename %1 to %2: %3")
-                    .arg(files.at(i).name)
+                tr("Failed to remove existing file %1: %2")
                     .arg(filepath)
-                    .arg(strerror(errno)) );
-                updateStatus(tr("failed to rename %1 to %2")
-                    .arg( files.at(i).name )
-                    .arg( filename ));
-            QFile::remove(files.at(i).name);
+                    .arg(old.error()) );
+            QFile::remove(file.name);
+            updateStatus(tr("failed to rename %1 to %2")
+                .arg( file.name )
+                .arg( filename ));
             ++failures;
-            continue;
+            return false;
         }
-
-        QFile::remove(files.at(i).name);
-        context->athlete->addRide(filename);
     }
+#endif
 
-    if( ! failures )
-        updateStatus( tr("download completed successfully") );
+    // Use ::rename() instead of QFile::rename() to get forced overwrite.
+    if (rename(QFile::encodeName(file.name),
+        QFile::encodeName(filepath)) < 0) {
+
+        QMessageBox::critical(this, tr("Error"),
+            tr("Failed to rename %1 to %2: %3")
+                .arg(file.name)
+                .arg(filepath)
+                .arg(strerror(errno)) );
+            updateStatus(tr("failed to rename %1 to %2")
+                .arg( file.name )
+                .arg( filename ));
+        QFile::remove(file.name);
+        ++failures;
+        return false;
+    }
 
-    updateAction( actionIdle );
+    QFile::remove(file.name);
+    context->athlete->addRide(filename);
+    return true;
 }
 
 void
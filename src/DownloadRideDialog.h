@@ -21,10 +21,27 @@
 #include "GoldenCheetah.h"
 
 #include "CommPort.h"
+#include "Device.h"
 #include <QtGui>
 
 class Context;
 
+// runs the device download off the GUI thread so the dialog stays
+// responsive and can store each ride as soon as it is complete
+class DownloadRideWorker : public QThread
+{
+    public:
+        DownloadRideWorker(DevicePtr device, const QDir &tmpdir)
+        : device(device), tmpdir(tmpdir), ok(false) {}
+        void run() { ok = device->download(tmpdir, files, err); }
+
+        DevicePtr device;
+        QDir tmpdir;
+        QList<DeviceDownloadFile> files;
+        QString err;
+        bool ok;
+};
+
 class DownloadRideDialog : public QDialog
 {
     Q_OBJECT
@@ -49,6 +66,7 @@ class DownloadRideDialog : public QDialog
         void deviceChanged(QString);
         void updateStatus(const QString &statusText);
         void updateProgress(const QString &progressText);
+        void downloaded(DeviceDownloadFile file);
 
     private:
 
@@ -63,6 +81,9 @@ class DownloadRideDialog : public QDialog
         QVector<CommPortPtr> devList;
         bool cancelled;
 
+        QStringList stored;     // temporary files already dealt with
+        int failures;
+
         typedef enum {
             actionIdle,
             actionMissing,
@@ -74,6 +95,7 @@ class DownloadRideDialog : public QDialog
 
         void updateAction( downloadAction action );
         void updatePort();
+        bool storeFile(DeviceDownloadFile file);
 };
 
 #endif // _GC_DownloadRideDialog_h
@@ -17,11 +17,18 @@
  */
 
 #include "ErgDB.h"
+#include <QDesktopServices>
 
 static const QString ErgDBUrl = "http://www.73summits.com/ergdb/";
 
 ErgDB::ErgDB(QObject *parent) : QObject(parent)
 {
+    networkMgr = new QNetworkAccessManager(this);
+
+    QNetworkDiskCache *cache = new QNetworkDiskCache(this);
+    cache->setCacheDirectory(QDesktopServices::storageLocation(QDesktopServices::CacheLocation) + "/ergdb");
+    networkMgr->setCache(cache);
+
     getList(); // get all the files...
 }
 
@@ -31,18 +38,28 @@ ErgDB::getList()
 {
 
     QEventLoop eventLoop; // holding pattern whilst waiting for a reply...
-    QNetworkAccessManager networkMgr; // for getting request
 
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply*)), this, SLOT(getListFinished(QNetworkReply*)));
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply *)), &eventLoop, SLOT(quit()));
-    QByteArray out;
-
-    // construct and make the call
+    // a cached copy is sent with its ETag / Last-Modified so an
+    // unchanged catalog comes back as a 304 and is read from disk
     QNetworkRequest request = QNetworkRequest(QUrl(ErgDBUrl + "api/list"));
-    networkMgr.get(request);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
+    request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, true);
 
-    // holding pattern
+    QNetworkReply *reply = networkMgr->get(request);
+    connect(reply, SIGNAL(finished()), &eventLoop, SLOT(quit()));
     eventLoop.exec();
+
+    // offline? the last catalog we saw is better than nothing
+    if (reply->error() != QNetworkReply::NoError) {
+        reply->deleteLater();
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysCache);
+        reply = networkMgr->get(request);
+        connect(reply, SIGNAL(finished()), &eventLoop, SLOT(quit()));
+        eventLoop.exec();
+    }
+
+    getListFinished(reply);
+    reply->deleteLater();
 }
 
 void
@@ -80,23 +97,25 @@ ErgDB::getFile(int id, int ftp)
 {
 
     QEventLoop eventLoop; // holding pattern whilst waiting for a reply...
-    QNetworkAccessManager networkMgr; // for getting request
-
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply*)), this, SLOT(getFileFinished(QNetworkReply*)));
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply *)), &eventLoop, SLOT(quit()));
-    QByteArray out;
 
-    // construct and make the call
-    QNetworkRequest request = QNetworkRequest(QUrl(ErgDBUrl + QString("api/workout/%1/%2").arg(id).arg(ftp)));
-    networkMgr.get(request);
-
-    // holding pattern
+    QNetworkReply *reply = requestFile(id, ftp);
+    connect(reply, SIGNAL(finished()), &eventLoop, SLOT(quit()));
     eventLoop.exec();
 
+    getFileFinished(reply);
+    reply->deleteLater();
+
     // return the file
     return fileContents;
 }
 
+QNetworkReply *
+ErgDB::requestFile(int id, int ftp)
+{
+    QNetworkRequest request = QNetworkRequest(QUrl(ErgDBUrl + QString("api/workout/%1/%2").arg(id).arg(ftp)));
+    return networkMgr->get(request);
+}
+
 void
 ErgDB::getFileFinished(QNetworkReply *reply)
 {
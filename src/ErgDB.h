@@ -22,6 +22,8 @@
 #include "ErgFile.h"
 #include <QHttp>
 #include <QNetworkReply>
+#include <QNetworkAccessManager>
+#include <QNetworkDiskCache>
 #include <QUrl>
 #include <QEventLoop>
 #include <QObject>
@@ -49,6 +51,9 @@ public:
     QList<ErgDBItem> &items() { return _items; } // get the list of files available
     QString getFile(int id, int ftp);            // get the file contents for id
 
+    // start fetching the file for id, the caller reads and deletes the reply
+    QNetworkReply *requestFile(int id, int ftp);
+
 private slots:
 
     void getListFinished(QNetworkReply *reply);
@@ -56,6 +61,10 @@ private slots:
 
 private:
     void getList(); // refresh the db
+
+    // one manager so requests reuse their connections, with a disk
+    // cache so the catalog is revalidated rather than fetched again
+    QNetworkAccessManager *networkMgr;
     QList<ErgDBItem> _items;
 
     QString fileContents; // not thread safe!
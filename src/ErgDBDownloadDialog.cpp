@@ -136,6 +136,9 @@ ErgDBDownloadDialog::okClicked()
 
     } else if (ok->text() == "Abort") {
         aborted = true;
+
+        // the replies come back through fileDownloaded as they stop
+        foreach(QNetworkReply *reply, inflight.keys()) reply->abort();
     } else if (ok->text() == "Finish") {
         accept(); // our work is done!
     }
@@ -151,96 +154,126 @@ void
 ErgDBDownloadDialog::downloadFiles()
 {
     // where to place them
-    QString workoutDir = appsettings->value(this, GC_WORKOUTDIR).toString();
+    workoutDir = appsettings->value(this, GC_WORKOUTDIR).toString();
 
-    // what format to export as?
-    QString type = RideFileFactory::instance().writeSuffixes().at(0);
+    // how many to fetch at once
+    parallel = qMax(1, appsettings->value(this, GC_ERGDB_PARALLEL, 4).toInt());
+    next = 0;
 
     // for library updating, transactional for 10x performance
     trainDB->startLUW();
 
-    // loop through the table and export all selected
-    for(int i=0; i<files->invisibleRootItem()->childCount(); i++) {
+    // wait here until the last reply is saved or they abort
+    startDownloads();
+    if (inflight.count()) waiting.exec();
 
-        // give user a chance to abort..
-        QApplication::processEvents();
+    // for library updating, transactional for 10x performance
+    // need to commit whatever was copied if aborted too
+    trainDB->endLUW();
+}
 
-        // did they?
-        if (aborted == true) {
-            trainDB->endLUW(); // need to commit whatever was copied.
-            return; // user aborted!
-        }
+void
+ErgDBDownloadDialog::startDownloads()
+{
+    // top up the requests in flight from the selected rows
+    while (aborted == false && inflight.count() < parallel && next < files->invisibleRootItem()->childCount()) {
 
-        QTreeWidgetItem *current = files->invisibleRootItem()->child(i);
+        QTreeWidgetItem *current = files->invisibleRootItem()->child(next++);
 
         // is it selected
         if (static_cast<QCheckBox*>(files->itemWidget(current,0))->isChecked()) {
 
-            files->setCurrentItem(current); QApplication::processEvents();
-
-            // this one then
-            current->setText(5, "Downloading..."); QApplication::processEvents();
+            files->setCurrentItem(current);
+            current->setText(5, "Downloading...");
 
             // get the id
             int id = current->text(6).toInt();
-            QString content = ergdb.getFile(id, 300);
-
-            QString filename = workoutDir + "/" + current->text(1) + ".erg";
-            ErgFile *p = ErgFile::fromContent(content, context);
-
-            // open success?
-            if (p->isValid()) {
+            QNetworkReply *reply = ergdb.requestFile(id, 300);
+            connect(reply, SIGNAL(finished()), this, SLOT(fileDownloaded()));
+            inflight.insert(reply, current);
+        }
+    }
+}
 
+void
+ErgDBDownloadDialog::fileDownloaded()
+{
+    QNetworkReply *reply = static_cast<QNetworkReply*>(sender());
+    QTreeWidgetItem *current = inflight.take(reply);
+    reply->deleteLater();
+    if (current == NULL) return;
 
-                if (QFile(filename).exists()) {
+    if (aborted == true) {
 
-                    if (overwrite->isChecked() == false) {
-                        // skip existing files
-                        current->setText(5, "Exists already"); QApplication::processEvents();
-                        fails++;
-                        delete p; // free memory!
-                        continue;
+        current->setText(5, "Aborted");
+        fails++;
 
-                    } else {
+    } else if (reply->error() != QNetworkReply::NoError) {
 
-                        // remove existing
-                        QFile(filename).remove();
-                        current->setText(5, "Removing..."); QApplication::processEvents();
-                    }
+        current->setText(5, "Download failed");
+        fails++;
 
-                }
-                downloads++;
+    } else {
 
-                QFile out(filename);
-                if (out.open(QIODevice::WriteOnly) == true) {
+        saveFile(current, reply->readAll().data());
+    }
 
-                    QTextStream output(&out);
-                    output << content;
-                    out.close();
+    startDownloads();
+    if (inflight.count() == 0) waiting.quit();
+}
 
-                    downloads++;
-                    current->setText(5, "Saved"); QApplication::processEvents();
-                    trainDB->importWorkout(filename, p); // add to library
+void
+ErgDBDownloadDialog::saveFile(QTreeWidgetItem *current, QString content)
+{
+    QString filename = workoutDir + "/" + current->text(1) + ".erg";
+    ErgFile *p = ErgFile::fromContent(content, context);
 
-                } else {
+    // open success?
+    if (p->isValid()) {
 
-                    fails++;
-                    current->setText(5, "Write failed"); QApplication::processEvents();
-                }
+        if (QFile(filename).exists()) {
 
+            if (overwrite->isChecked() == false) {
+                // skip existing files
+                current->setText(5, "Exists already");
+                fails++;
                 delete p; // free memory!
+                return;
 
-            // couldn't parse
             } else {
 
-                delete p; // free memory!
-                fails++;
-                current->setText(5, "Invalid File"); QApplication::processEvents();
-
+                // remove existing
+                QFile(filename).remove();
+                current->setText(5, "Removing...");
             }
 
         }
+
+        QFile out(filename);
+        if (out.open(QIODevice::WriteOnly) == true) {
+
+            QTextStream output(&out);
+            output << content;
+            out.close();
+
+            downloads++;
+            current->setText(5, "Saved");
+            trainDB->importWorkout(filename, p); // add to library
+
+        } else {
+
+            fails++;
+            current->setText(5, "Write failed");
+        }
+
+        delete p; // free memory!
+
+    // couldn't parse
+    } else {
+
+        delete p; // free memory!
+        fails++;
+        current->setText(5, "Invalid File");
+
     }
-    // for library updating, transactional for 10x performance
-    trainDB->endLUW();
 }
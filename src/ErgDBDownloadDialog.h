@@ -58,6 +58,7 @@ private slots:
     void okClicked();
     void downloadFiles();
     void allClicked();
+    void fileDownloaded();
 
 private:
     Context *context;
@@ -71,6 +72,14 @@ private:
     int downloads, fails;
     QLabel *status;
 
+    // several requests in flight at once, each saved as it lands
+    void startDownloads();
+    void saveFile(QTreeWidgetItem *current, QString content);
+    QMap<QNetworkReply*, QTreeWidgetItem*> inflight;
+    int next, parallel;
+    QEventLoop waiting;
+    QString workoutDir;
+
     ErgDB ergdb;
 };
 #endif // _ErgDBDownloadDialog_h
@@ -51,6 +51,18 @@ ErgFile::ErgFile(QString filename, int &mode, Context *context) :
     reload();
 }
 
+ErgFile::ErgFile(QString filename, int &mode, Context *context, const QByteArray &profile) :
+    filename(filename), context(context), mode(mode)
+{
+    if (context->athlete->zones()) {
+        int zonerange = context->athlete->zones()->whichRange(QDateTime::currentDateTime().date());
+        if (zonerange >= 0) CP = context->athlete->zones()->getCP(zonerange);
+    }
+
+    // a stale or missing profile means we parse as usual
+    if (!setProfile(profile)) reload();
+}
+
 ErgFile::ErgFile(Context *context) : context(context), mode(nomode)
 {
     if (context->athlete->zones()) {
@@ -70,6 +82,105 @@ ErgFile::fromContent(QString contents, Context *context)
     return p;
 }
 
+// bump if the layout below changes, old profiles are then ignored
+static const quint32 ErgFileProfileVersion = 2;
+
+QByteArray
+ErgFile::profile() const
+{
+    QByteArray bytes;
+    if (!valid) return bytes;
+
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_6);
+
+    // MRC loads are converted to watts using CP so it goes in too
+    out << ErgFileProfileVersion << CP << (qint32)format;
+    out << Version << Units << Filename << Name << Source;
+    out << (qint64)Duration << (qint32)Ftp << (qint32)MaxWatts;
+
+    out << (quint32)Points.count();
+    foreach(const ErgFilePoint &p, Points) out << p.x << p.y << p.val;
+
+    out << (quint32)Laps.count();
+    foreach(const ErgFileLap &l, Laps) out << (qint64)l.x << (qint32)l.LapNum << l.name;
+
+    // the metrics, they depend upon CP so only used if it is unchanged
+    out << maxY << AP << NP << IF << TSS << VI << XP << RI << BS << SVI << ELE << ELEDIST << GRADE;
+
+    return qCompress(bytes);
+}
+
+bool
+ErgFile::setProfile(const QByteArray &compressed)
+{
+    if (compressed.isEmpty()) return false;
+
+    QByteArray bytes = qUncompress(compressed);
+    QDataStream in(bytes);
+    in.setVersion(QDataStream::Qt_4_6);
+
+    quint32 version;
+    double cp;
+    qint32 fmt;
+    in >> version >> cp >> fmt;
+    if (in.status() != QDataStream::Ok || version != ErgFileProfileVersion) return false;
+    if (fmt == MRC && cp != CP) return false;
+
+    qint64 duration;
+    qint32 ftp, maxwatts;
+    in >> Version >> Units >> Filename >> Name >> Source;
+    in >> duration >> ftp >> maxwatts;
+
+    quint32 count;
+    Points.clear();
+    in >> count;
+    for (quint32 i=0; i<count && in.status() == QDataStream::Ok; i++) {
+        ErgFilePoint p;
+        in >> p.x >> p.y >> p.val;
+        Points << p;
+    }
+
+    Laps.clear();
+    in >> count;
+    for (quint32 i=0; i<count && in.status() == QDataStream::Ok; i++) {
+        ErgFileLap l;
+        qint64 x;
+        qint32 lapnum;
+        in >> x >> lapnum >> l.name;
+        l.x = x;
+        l.LapNum = lapnum;
+        Laps << l;
+    }
+
+    double metrics[13];
+    for (int i=0; i<13; i++) in >> metrics[i];
+
+    if (in.status() != QDataStream::Ok || Points.isEmpty()) {
+        Points.clear();
+        Laps.clear();
+        return false;
+    }
+
+    mode = format = fmt;
+    Duration = duration;
+    Ftp = ftp;
+    MaxWatts = maxwatts;
+    rightPoint = leftPoint = lapCursor = 0;
+    valid = true;
+
+    index();
+    if (cp == CP) {
+        maxY = metrics[0];
+        AP = metrics[1]; NP = metrics[2]; IF = metrics[3]; TSS = metrics[4]; VI = metrics[5];
+        XP = metrics[6]; RI = metrics[7]; BS = metrics[8]; SVI = metrics[9];
+        ELE = metrics[10]; ELEDIST = metrics[11]; GRADE = metrics[12];
+    } else {
+        calculateMetrics();
+    }
+    return true;
+}
+
 void ErgFile::reload()
 {
     // which parser to call? NOTE: we should look at moving to an ergfile factory
@@ -90,7 +201,7 @@ void ErgFile::parseTacx()
     Ftp = 0;            // FTP this file was targetted at
     MaxWatts = 0;       // maxWatts in this ergfile (scaling)
     valid = false;             // did it parse ok?
-    rightPoint = leftPoint = 0;
+    rightPoint = leftPoint = lapCursor = 0;
     format = CRS; // default to couse until we know
     Points.clear();
     Laps.clear();
@@ -251,8 +362,7 @@ void ErgFile::parseTacx()
 
         // set ErgFile duration
         Duration = Points.last().x;      // last is the end point in msecs
-        leftPoint = 0;
-        rightPoint = 1;
+        index();
 
         // calculate climbing etc
         calculateMetrics();
@@ -263,7 +373,7 @@ void ErgFile::parseComputrainer(QString p)
 {
     QFile ergFile(filename);
     int section = NOMANSLAND;            // section 0=init, 1=header data, 2=course data
-    leftPoint=rightPoint=0;
+    leftPoint=rightPoint=lapCursor=0;
     MaxWatts = Ftp = 0;
     int lapcounter = 0;
     format = ERG;                         // either ERG or MRC
@@ -489,9 +599,7 @@ void ErgFile::parseComputrainer(QString p)
 
         // set ErgFile duration
         Duration = Points.last().x;      // last is the end point in msecs
-
-        leftPoint = 0;
-        rightPoint = 1;
+        index();
 
         calculateMetrics();
 
@@ -511,6 +619,82 @@ ErgFile::isValid()
     return valid;
 }
 
+void
+ErgFile::index()
+{
+    leftPoint = 0;
+    rightPoint = Points.count() > 1 ? 1 : 0;
+    lapCursor = 0;
+
+    // the value for any x in a segment is then just
+    // segmentVal + segmentRate * (x - pointX)
+    int n = Points.count();
+    pointX.resize(n);
+    segmentVal.resize(n);
+    segmentRate.resize(n);
+
+    for (int i=0; i<n; i++) {
+
+        const ErgFilePoint &left = Points.at(i);
+        pointX[i] = left.x;
+
+        if (i+1 == n) {
+            segmentVal[i] = left.val;
+            segmentRate[i] = 0;
+            continue;
+        }
+        const ErgFilePoint &right = Points.at(i+1);
+
+        // the erg file will list the point in time twice
+        // to show a jump from one wattage to another
+        // at this point in ime (i.e x=100 watts=100 followed
+        // by x=100 watts=200), and flat sections are flat
+        if (left.x == right.x || left.val == right.val) {
+            segmentVal[i] = right.val;
+            segmentRate[i] = 0;
+        } else {
+            // ramping from one point to the next
+            segmentVal[i] = left.val;
+            segmentRate[i] = (right.val - left.val) / (right.x - left.x);
+        }
+    }
+
+    lapX.clear();
+    foreach(ErgFileLap lap, Laps) lapX << lap.x;
+    qSort(lapX);
+}
+
+int
+ErgFile::segment(long x)
+{
+    // x belongs to the segment that ends at the first point at or after it,
+    // time usually moves on a tick at a time so check where we were first
+    int n = pointX.count();
+    if (n < 2) return leftPoint = rightPoint = 0;
+
+    for (int i = leftPoint; i <= leftPoint+1 && i+1 < n; i++) {
+        if ((i == 0 || pointX[i] < x) && x <= pointX[i+1]) {
+            leftPoint = i;
+            rightPoint = i+1;
+            return leftPoint;
+        }
+    }
+
+    // seek or rewind, look it up
+    int first = qLowerBound(pointX.begin(), pointX.end(), double(x)) - pointX.begin();
+    leftPoint = qBound(0, first-1, n-2);
+    rightPoint = leftPoint+1;
+    return leftPoint;
+}
+
+int
+ErgFile::lapsAt(long x)
+{
+    while (lapCursor < lapX.count() && lapX[lapCursor] <= x) lapCursor++;
+    while (lapCursor > 0 && lapX[lapCursor-1] > x) lapCursor--;
+    return lapCursor;
+}
+
 int
 ErgFile::wattsAt(long x, int &lapnum)
 {
@@ -522,51 +706,10 @@ ErgFile::wattsAt(long x, int &lapnum)
     if (x < 0 || x > Duration) return -100;   // out of bounds!!!
 
     // do we need to return the Lap marker?
-    if (Laps.count() > 0) {
-        int lap=0;
-        for (int i=0; i<Laps.count(); i++) {
-            if (x>=Laps.at(i).x) lap += 1;
-        }
-        lapnum = lap;
-
-    } else lapnum = 0;
-
-    // find right section of the file
-    while (x < Points.at(leftPoint).x || x > Points.at(rightPoint).x) {
-        if (x < Points.at(leftPoint).x) {
-            leftPoint--;
-            rightPoint--;
-        } else if (x > Points.at(rightPoint).x) {
-            leftPoint++;
-            rightPoint++;
-        }
-    }
+    lapnum = lapsAt(x);
 
-    // two different points in time but the same watts
-    // at both, it doesn't really matter which value
-    // we use
-    if (Points.at(leftPoint).val == Points.at(rightPoint).val)
-        return Points.at(rightPoint).val;
-
-    // the erg file will list the point in time twice
-    // to show a jump from one wattage to another
-    // at this point in ime (i.e x=100 watts=100 followed
-    // by x=100 watts=200)
-    if (Points.at(leftPoint).x == Points.at(rightPoint).x)
-        return Points.at(rightPoint).val;
-
-    // so this point in time between two points and
-    // we are ramping from one point and another
-    // the steps in the calculation have been explicitly
-    // listed for code clarity
-    double deltaW = Points.at(rightPoint).val - Points.at(leftPoint).val;
-    double deltaT = Points.at(rightPoint).x - Points.at(leftPoint).x;
-    double offT = x - Points.at(leftPoint).x;
-    double factor = offT / deltaT;
-
-    double nowW = Points.at(leftPoint).val + (deltaW * factor);
-
-    return nowW;
+    int i = segment(x);
+    return segmentVal[i] + segmentRate[i] * (x - pointX[i]);
 }
 
 double
@@ -580,26 +723,19 @@ ErgFile::gradientAt(long x, int &lapnum)
     if (x < 0 || x > Duration) return -100;   // out of bounds!!! (-10 through +15 are valid return vals)
 
     // do we need to return the Lap marker?
-    if (Laps.count() > 0) {
-        int lap=0;
-        for (int i=0; i<Laps.count(); i++) {
-            if (x>=Laps.at(i).x) lap += 1;
-        }
-        lapnum = lap;
-
-    } else lapnum = 0;
-
-    // find right section of the file
-    while (x < Points.at(leftPoint).x || x > Points.at(rightPoint).x) {
-        if (x < Points.at(leftPoint).x) {
-            leftPoint--;
-            rightPoint--;
-        } else if (x > Points.at(rightPoint).x) {
-            leftPoint++;
-            rightPoint++;
-        }
-    }
-    return Points.at(leftPoint).val;
+    lapnum = lapsAt(x);
+
+    // gradient holds for the whole segment
+    return Points.at(segment(x)).val;
+}
+
+// the segment x is in ends at its right point, after that the
+// load jumps or starts ramping so that is when to set it next
+long ErgFile::nextChange(long x)
+{
+    if (!isValid() || pointX.count() < 2) return Duration;
+
+    return long(pointX[segment(x)+1]) + 1;
 }
 
 int ErgFile::nextLap(long x)
@@ -607,11 +743,9 @@ int ErgFile::nextLap(long x)
     if (!isValid()) return -1; // not a valid ergfile
 
     // do we need to return the Lap marker?
-    if (Laps.count() > 0) {
-        for (int i=0; i<Laps.count(); i++) {
-            if (x<Laps.at(i).x) return Laps.at(i).x;
-        }
-    }
+    int lap = lapsAt(x);
+    if (lap < lapX.count()) return lapX[lap];
+
     return -1; // nope, no marker ahead of there
 }
 
@@ -68,6 +68,8 @@ class ErgFile
     public:
         ErgFile(QString, int&, Context *context);       // constructor uses filename
         ErgFile(Context *context); // no filename, going to use a string
+        ErgFile(QString, int&, Context *context, const QByteArray &profile); // from a cached profile
+
 
         ~ErgFile();             // delete the contents
 
@@ -78,11 +80,18 @@ class ErgFile
         void parseComputrainer(QString p = ""); // its an erg,crs or mrc file
         void parseTacx();         // its a pgmf file
         bool isValid();         // is the file valid or not?
+
+        // the parsed points and laps, so a workout can be restored
+        // from the cache on selection without parsing the file again
+        QByteArray profile() const;
+        bool setProfile(const QByteArray &);
         double Cp;
         int format;             // ERG, CRS or MRC currently supported
         int wattsAt(long, int&);      // return the watts value for the passed msec
         double gradientAt(long, int&);      // return the gradient value for the passed meter
         int nextLap(long);      // return the msecs value for the next Lap marker
+        long nextChange(long);  // return the msecs value when the load next steps or ramps
+        void index();           // rebuild the lookups after Points or Laps change
 
         QString Version,        // version number / identifer
                 Units,          // units used
@@ -115,6 +124,15 @@ class ErgFile
         Context *context;
         int &mode;
         int nomode;
+
+        // built by index(), segment i runs from Points[i] to Points[i+1]
+        // and has its load as a start value and rate of change so with
+        // the cursors following the session each tick is constant time
+        QVector<double> pointX, segmentVal, segmentRate;
+        QVector<long> lapX;     // lap markers in order
+        int lapCursor;          // laps at or before the last lookup
+        int segment(long x);    // moves leftPoint/rightPoint to x
+        int lapsAt(long x);     // moves lapCursor to x
 };
 
 #endif
@@ -61,6 +61,39 @@ QRectF ErgFileData::boundingRect() const
 }
 
 
+ErgFileProfile::ErgFileProfile(QwtPlotCurve *curve) : curve(curve)
+{
+    setZ(curve->z());
+    setItemAttribute(QwtPlotItem::AutoScale, true);
+}
+
+static bool sameMap(const QwtScaleMap &a, const QwtScaleMap &b)
+{
+    return a.s1() == b.s1() && a.s2() == b.s2() && a.p1() == b.p1() && a.p2() == b.p2();
+}
+
+void
+ErgFileProfile::draw(QPainter *painter, const QwtScaleMap &xMap, const QwtScaleMap &yMap,
+                     const QRectF &canvasRect) const
+{
+    QSize size = canvasRect.size().toSize();
+
+    if (cache.isNull() || cache.size() != size || !sameMap(xMap, cachedX) || !sameMap(yMap, cachedY)) {
+
+        cache = QPixmap(size);
+        cache.fill(Qt::transparent);
+
+        QPainter p(&cache);
+        p.setRenderHint(QPainter::Antialiasing, curve->testRenderHint(QwtPlotItem::RenderAntialiased));
+        p.translate(-canvasRect.topLeft());
+        curve->draw(&p, xMap, yMap, canvasRect);
+
+        cachedX = xMap;
+        cachedY = yMap;
+    }
+    painter->drawPixmap(canvasRect.topLeft(), cache);
+}
+
 // Now bar
 double NowData::x(size_t) const { return context->getNow(); }
 double NowData::y(size_t i) const {
@@ -149,10 +182,14 @@ ErgFilePlot::ErgFilePlot(Context *context) : context(context)
     // Load Curve
     LodCurve = new QwtPlotCurve("Course Load");
     LodCurve->setData(lodData);
-    LodCurve->attach(this);
     LodCurve->setBaseline(-1000);
     LodCurve->setYAxis(QwtPlot::yLeft);
 
+    // which is painted from a pixmap
+    profile = new ErgFileProfile(LodCurve);
+    profile->setYAxis(QwtPlot::yLeft);
+    profile->attach(this);
+
     // load curve is blue for time and grey for gradient
     QColor brush_color = QColor(Qt::blue);
     brush_color.setAlpha(64);
@@ -210,6 +247,8 @@ ErgFilePlot::ErgFilePlot(Context *context) : context(context)
 
     bydist = false;
     ergFile = NULL;
+    nowPixel = -1;
+    telemetryChanged = false;
 
     setAutoReplot(false);
 }
@@ -220,6 +259,8 @@ ErgFilePlot::setData(ErgFile *ergfile)
     reset();
 
     ergFile = ergfile;
+    profile->invalidate();
+    nowPixel = -1;
     // clear the previous marks (if any)
     for(int i=0; i<Marks.count(); i++) {
         Marks.at(i)->detach();
@@ -366,6 +407,13 @@ ErgFilePlot::setData(ErgFile *ergfile)
 void
 ErgFilePlot::setNow(long /*msecs*/)
 {
+    // the profile comes from the pixmap, so we only repaint
+    // once the cursor has moved a pixel or there's new telemetry
+    int pixel = qRound(transform(xBottom, context->getNow()));
+    if (pixel == nowPixel && !telemetryChanged) return;
+
+    nowPixel = pixel;
+    telemetryChanged = false;
     replot(); // and update
 }
 
@@ -423,6 +471,8 @@ ErgFilePlot::performancePlot(RealtimeData rtdata)
     if (!cadData->count()) cadData->append(&zero, &cad, 1);
     cadData->append(&x, &cad, 1);
     cadCurve->setData(cadData->x(), cadData->y(), cadData->count());
+
+    telemetryChanged = true;
 }
 
 void
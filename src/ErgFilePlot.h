@@ -75,6 +75,28 @@ class NowData : public QwtPointArrayData
     //virtual QRectF boundingRect() const;
 };
 
+// The workout profile doesn't change during a session, so the load
+// curve is drawn once into a pixmap and just the pixmap is painted on
+// each replot, until the scales or canvas size change
+class ErgFileProfile : public QwtPlotItem
+{
+    public:
+    ErgFileProfile(QwtPlotCurve *curve);
+    ~ErgFileProfile() { delete curve; }
+
+    void invalidate() { cache = QPixmap(); }
+
+    virtual int rtti() const { return QwtPlotItem::Rtti_PlotUserItem; }
+    virtual QRectF boundingRect() const { return curve->boundingRect(); }
+    virtual void draw(QPainter *, const QwtScaleMap &, const QwtScaleMap &, const QRectF &) const;
+
+    private:
+    QwtPlotCurve *curve;        // not attached, we draw and own it
+
+    mutable QPixmap cache;
+    mutable QwtScaleMap cachedX, cachedY;
+};
+
 // incremental data, for each curve
 class CurveData
 {
@@ -153,6 +175,9 @@ class ErgFilePlot : public QwtPlot
 	QwtPlotCurve *cadCurve;
 	QwtPlotCurve *speedCurve;
 	QwtPlotCurve *NowCurve;
+    ErgFileProfile *profile;    // draws LodCurve
+    int nowPixel;               // where the now cursor was last drawn
+    bool telemetryChanged;      // since the last replot
 
     CurveData *wattsData,
               *hrData,
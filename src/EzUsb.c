@@ -25,7 +25,11 @@
 # include  <stdlib.h>
 # include  <string.h>
 
+#ifdef GC_HAVE_LIBUSB1
+# include  <libusb.h>
+#else
 # include  "usb.h"
+#endif
 
 # include "EzUsb.h"
 
@@ -106,6 +110,16 @@ static inline int ctrl_msg (
     size_t				length
 ) {
 
+#ifdef GC_HAVE_LIBUSB1
+    return libusb_control_transfer(device,
+			   requestType,
+			   request,
+			   value,
+			   index,
+			   data,
+			   (uint16_t)length,
+			   10000);
+#else
     return usb_control_msg(device, 
 			   (int)requestType,
 			   (int)request,
@@ -114,6 +128,7 @@ static inline int ctrl_msg (
 			   (char*)data,
 			   (int)length,
 			   10000);
+#endif
 }
 
 
@@ -20,6 +20,10 @@
  *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
  */
 
+#ifdef GC_HAVE_LIBUSB1
+/* the libusb-1.0 handle stands in for the libusb-0.1 one */
+typedef libusb_device_handle usb_dev_handle;
+#endif
 
 /*
  * This function loads the firmware from the given file into RAM.
@@ -24,6 +24,7 @@
 #include <QDebug>
 #include <QTime>
 #include <stdio.h>
+#include <string.h>
 #include <stdint.h>
 #include <limits>
 
@@ -31,7 +32,8 @@
 
 static int fitFileReaderRegistered =
     RideFileFactory::instance().registerReader(
-        "fit", "Garmin FIT", new FitFileReader());
+        "fit", "Garmin FIT", makeRideFileReader<FitFileReader>, false,
+        QByteArray(".FIT"), 8);
 
 static const QDateTime qbase_time(QDate(1989, 12, 31), QTime(0, 0, 0), Qt::UTC);
 
@@ -44,6 +46,7 @@ struct FitField {
 struct FitDefinition {
     int global_msg_num;
     bool is_big_endian;
+    int size; // bytes in each data message
     std::vector<FitField> fields;
 };
 
@@ -77,136 +80,95 @@ struct FitFileReaderState
     FitFileReaderState(QFile &file, QStringList &errors) :
         file(file), errors(errors), rideFile(NULL), start_time(0),
         last_time(0), last_distance(0.00f), interval(0), calibration(0), devices(0), stopped(true),
-        last_event_type(-1), last_event(-1), last_msg_type(-1)
+        last_event_type(-1), last_event(-1), last_msg_type(-1), data(NULL), pos(0), end(0)
     {
     }
 
     struct TruncatedRead {};
 
-    void read_unknown( int size, int *count = NULL ){
-        char c[size+1];
+    // the whole file is read up front and decoded from memory
+    QByteArray buffer;
+    const uchar *data;
+    int pos, end;
 
-        if (file.read(c, size ) != size)
-            throw TruncatedRead();
-        if (count)
-            (*count) += size;
-    }
+    // values decoded from the last data message, reused between messages
+    std::vector<fit_value_t> values;
 
-    fit_value_t read_int8(int *count = NULL) {
-        qint8 i;
-        if (file.read(reinterpret_cast<char*>( &i), 1) != 1)
+    const uchar *take(int size, int *count = NULL) {
+        if (size > end - pos)
             throw TruncatedRead();
+        const uchar *p = data + pos;
+        pos += size;
         if (count)
-            (*count) += 1;
-
-        return i == 0x7f ? NA_VALUE : i;
+            (*count) += size;
+        return p;
     }
 
     fit_value_t read_uint8(int *count = NULL) {
-        quint8 i;
-        if (file.read(reinterpret_cast<char*>( &i), 1) != 1)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 1;
-
+        quint8 i = *take(1, count);
         return i == 0xff ? NA_VALUE : i;
     }
 
-    fit_value_t read_uint8z(int *count = NULL) {
-        quint8 i;
-        if (file.read(reinterpret_cast<char*>( &i), 1) != 1)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 1;
-
-        return i == 0x00 ? NA_VALUE : i;
-    }
-
-    fit_value_t read_int16(bool is_big_endian, int *count = NULL) {
-        qint16 i;
-        if (file.read(reinterpret_cast<char*>(&i), 2) != 2)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 2;
-
-        i = is_big_endian
-            ? qFromBigEndian<qint16>( i )
-            : qFromLittleEndian<qint16>( i );
-
-        return i == 0x7fff ? NA_VALUE : i;
-    }
-
     fit_value_t read_uint16(bool is_big_endian, int *count = NULL) {
-        quint16 i;
-        if (file.read(reinterpret_cast<char*>(&i), 2) != 2)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 2;
-
-        i = is_big_endian
-            ? qFromBigEndian<quint16>( i )
-            : qFromLittleEndian<quint16>( i );
-
+        const uchar *p = take(2, count);
+        quint16 i = is_big_endian ? qFromBigEndian<quint16>(p) : qFromLittleEndian<quint16>(p);
         return i == 0xffff ? NA_VALUE : i;
     }
 
-    fit_value_t read_uint16z(bool is_big_endian, int *count = NULL) {
-        quint16 i;
-        if (file.read(reinterpret_cast<char*>(&i), 2) != 2)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 2;
-
-        i = is_big_endian
-            ? qFromBigEndian<quint16>( i )
-            : qFromLittleEndian<quint16>( i );
-
-        return i == 0x0000 ? NA_VALUE : i;
-    }
-
-    fit_value_t read_int32(bool is_big_endian, int *count = NULL) {
-        qint32 i;
-        if (file.read(reinterpret_cast<char*>(&i), 4) != 4)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 4;
-
-        i = is_big_endian
-            ? qFromBigEndian<qint32>( i )
-            : qFromLittleEndian<qint32>( i );
-
-        return i == 0x7fffffff ? NA_VALUE : i;
-    }
-
     fit_value_t read_uint32(bool is_big_endian, int *count = NULL) {
-        quint32 i;
-        if (file.read(reinterpret_cast<char*>(&i), 4) != 4)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 4;
-
-        i = is_big_endian
-            ? qFromBigEndian<quint32>( i )
-            : qFromLittleEndian<quint32>( i );
-
+        const uchar *p = take(4, count);
+        quint32 i = is_big_endian ? qFromBigEndian<quint32>(p) : qFromLittleEndian<quint32>(p);
         return i == 0xffffffff ? NA_VALUE : i;
     }
 
-    fit_value_t read_uint32z(bool is_big_endian, int *count = NULL) {
-        quint32 i;
-        if (file.read(reinterpret_cast<char*>(&i), 4) != 4)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 4;
-
-        i = is_big_endian
-            ? qFromBigEndian<quint32>( i )
-            : qFromLittleEndian<quint32>( i );
+    // the number of bytes a base type needs, or 0 if we don't decode it
+    static int base_type_size(int type) {
+        switch (type) {
+            case 0: case 1: case 2: case 10: return 1;
+            case 3: case 4: case 11: return 2;
+            case 5: case 6: case 12: return 4;
+            // we may need to add support for float, string + byte base types here
+            default: return 0;
+        }
+    }
 
-        return i == 0x00000000 ? NA_VALUE : i;
+    // decode a field resolved when its definition was read,
+    // the caller has already checked the whole message is there
+    static fit_value_t decode_field(const uchar *p, int type, bool is_big_endian) {
+        switch (type) {
+            case 0:
+            case 2: { quint8 i = *p; return i == 0xff ? NA_VALUE : i; }
+            case 1: { qint8 i = *p; return i == 0x7f ? NA_VALUE : i; }
+            case 10: { quint8 i = *p; return i == 0x00 ? NA_VALUE : i; }
+            case 3: {
+                qint16 i = is_big_endian ? qFromBigEndian<qint16>(p) : qFromLittleEndian<qint16>(p);
+                return i == 0x7fff ? NA_VALUE : i;
+            }
+            case 4: {
+                quint16 i = is_big_endian ? qFromBigEndian<quint16>(p) : qFromLittleEndian<quint16>(p);
+                return i == 0xffff ? NA_VALUE : i;
+            }
+            case 11: {
+                quint16 i = is_big_endian ? qFromBigEndian<quint16>(p) : qFromLittleEndian<quint16>(p);
+                return i == 0x0000 ? NA_VALUE : i;
+            }
+            case 5: {
+                qint32 i = is_big_endian ? qFromBigEndian<qint32>(p) : qFromLittleEndian<qint32>(p);
+                return i == 0x7fffffff ? NA_VALUE : i;
+            }
+            case 6: {
+                quint32 i = is_big_endian ? qFromBigEndian<quint32>(p) : qFromLittleEndian<quint32>(p);
+                return i == 0xffffffff ? NA_VALUE : i;
+            }
+            case 12: {
+                quint32 i = is_big_endian ? qFromBigEndian<quint32>(p) : qFromLittleEndian<quint32>(p);
+                return i == 0x00000000 ? NA_VALUE : i;
+            }
+            default: return NA_VALUE;
+        }
     }
 
-    void decodeFileId(const FitDefinition &def, int, const std::vector<fit_value_t> values) {
+    void decodeFileId(const FitDefinition &def, int, const std::vector<fit_value_t> &values) {
         int i = 0;
         int manu = -1, prod = -1;
         foreach(const FitField &field, def.fields) {
@@ -250,7 +212,7 @@ struct FitFileReaderState
         rideFile->setFileFormat("FIT (*.fit)");
     }
 
-    void decodeEvent(const FitDefinition &def, int, const std::vector<fit_value_t> values) {
+    void decodeEvent(const FitDefinition &def, int, const std::vector<fit_value_t> &values) {
         int time = -1;
         int event = -1;
         int event_type = -1;
@@ -320,7 +282,7 @@ struct FitFileReaderState
         last_event_type = event_type;
     }
 
-    void decodeLap(const FitDefinition &def, int time_offset, const std::vector<fit_value_t> values) {
+    void decodeLap(const FitDefinition &def, int time_offset, const std::vector<fit_value_t> &values) {
         time_t time = 0;
         if (time_offset > 0)
             time = last_time + time_offset;
@@ -355,7 +317,7 @@ struct FitFileReaderState
             rideFile->addInterval(this_start_time - start_time, time - start_time, QString("%1").arg(interval));
     }
 
-    void decodeRecord(const FitDefinition &def, int time_offset, const std::vector<fit_value_t> values) {
+    void decodeRecord(const FitDefinition &def, int time_offset, const std::vector<fit_value_t> &values) {
         time_t time = 0;
         if (time_offset > 0)
             time = last_time + time_offset;
@@ -520,17 +482,34 @@ struct FitFileReaderState
             //       local_msg_type, def.global_msg_num, def.is_big_endian,
             //       num_fields );
 
+            def.size = 0;
+            def.fields.reserve(num_fields);
             for (int i = 0; i < num_fields; ++i) {
                 def.fields.push_back(FitField());
                 FitField &field = def.fields.back();
 
-                field.num = read_uint8(&count);
-                field.size = read_uint8(&count);
-                int base_type = read_uint8(&count);
-                field.type = base_type & 0x1f;
+                // read raw, 0xff is a valid field number
+                const uchar *p = take(3, &count);
+                field.num = p[0];
+                field.size = p[1];
+                field.type = p[2] & 0x1f;
+                def.size += field.size;
+
+                // resolve the base type once here rather than for every
+                // message, anything we can't decode is just skipped over
+                int size = base_type_size(field.type);
+                if (size == 0 || size > field.size) {
+                    unknown_base_type.insert(field.num);
+                    field.type = -1;
+                }
                 //printf("  field %d: %d bytes, num %d, type %d\n",
                 //       i, field.size, field.num, field.type );
             }
+
+            // size the sample storage from the first record definition,
+            // assuming the rest of the file is mostly records
+            if (def.global_msg_num == RECORD_TYPE && rideFile->dataPoints().isEmpty())
+                rideFile->reservePoints((end - pos) / (def.size + 1));
         }
         else {
             // Data record
@@ -554,29 +533,14 @@ struct FitFileReaderState
             //printf( "message local=%d global=%d\n", local_msg_type,
             //    def.global_msg_num );
 
-            std::vector<fit_value_t> values;
-            foreach(const FitField &field, def.fields) {
-                fit_value_t v;
-                switch (field.type) {
-                    case 0: v = read_uint8(&count); break;
-                    case 1: v = read_int8(&count); break;
-                    case 2: v = read_uint8(&count); break;
-                    case 3: v = read_int16(def.is_big_endian, &count); break;
-                    case 4: v = read_uint16(def.is_big_endian, &count); break;
-                    case 5: v = read_int32(def.is_big_endian, &count); break;
-                    case 6: v = read_uint32(def.is_big_endian, &count); break;
-                    case 10: v = read_uint8z(&count); break;
-                    case 11: v = read_uint16z(def.is_big_endian, &count); break;
-                    case 12: v = read_uint32z(def.is_big_endian, &count); break;
-                    // we may need to add support for float, string + byte base types here
-                    default:
-                        read_unknown( field.size, &count );
-                        v = NA_VALUE;
-                        unknown_base_type.insert(field.num);
-                }
-                values.push_back(v);
+            const uchar *p = take(def.size, &count);
+            values.resize(def.fields.size());
+            for (size_t i = 0; i < def.fields.size(); ++i) {
+                const FitField &field = def.fields[i];
+                values[i] = decode_field(p, field.type, def.is_big_endian);
+                p += field.size;
                 //printf( " field: type=%d num=%d value=%lld\n",
-                //    field.type, field.num, v );
+                //    field.type, field.num, values[i] );
             }
             // Most of the record types in the FIT format aren't actually all
             // that useful.  FileId, Lap, and Record clearly are.  The one
@@ -612,6 +576,18 @@ struct FitFileReaderState
             delete rideFile;
             return NULL;
         }
+        buffer = file.readAll();
+        data = reinterpret_cast<const uchar *>(buffer.constData());
+        pos = 0;
+        end = buffer.size();
+
+        // 12 byte header, 14 if it has a crc
+        if (end < 12 || (data[0] == 14 && end < 14)) {
+            errors << "truncated header";
+            file.close();
+            delete rideFile;
+            return NULL;
+        }
         int header_size = read_uint8();
         if (header_size != 12 && header_size != 14) {
             errors << QString("bad header size: %1").arg(header_size);
@@ -629,12 +605,7 @@ struct FitFileReaderState
 
         int data_size = read_uint32(false); // always littleEndian
         char fit_str[5];
-        if (file.read(fit_str, 4) != 4) {
-            errors << "truncated header";
-            file.close();
-            delete rideFile;
-            return NULL;
-        }
+        memcpy(fit_str, take(4), 4);
         fit_str[4] = '\0';
         if (strcmp(fit_str, ".FIT") != 0) {
             errors << QString("bad header, expected \".FIT\" but got \"%1\"").arg(fit_str);
@@ -664,7 +635,8 @@ struct FitFileReaderState
             return NULL;
         }
         else {
-            int crc = read_uint16( false ); // always littleEndian
+            // crc follows the data, not checked and may be missing
+            int crc = (end - pos >= 2) ? read_uint16( false ) : 0; // always littleEndian
             (void) crc;
             foreach(int num, unknown_global_msg_nums)
                 qDebug() << QString("FitRideFile: unknown global message number %1; ignoring it").arg(num);
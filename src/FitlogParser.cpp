@@ -26,8 +26,8 @@
 #include <stdlib.h>
 #include <math.h>
 
-FitlogParser::FitlogParser (RideFile* rideFile, QList<RideFile*> *rides)
-   : rideFile(rideFile), rides(rides)
+FitlogParser::FitlogParser (RideFile* rideFile, QList<RideFile*> *rides, RideFileSplitter *splitter)
+   : rideFile(rideFile), rides(rides), splitter(splitter)
 {
   first = true;
 }
@@ -39,11 +39,12 @@ FitlogParser::startElement( const QString&, const QString&,
 {
     buffer.clear();
 
-    if (qName == "Activity") {
+    if (qName == QLatin1String("Activity")) {
 
         lap = 0;
 
-        if (first == true) first = false;
+        // when streaming the spare ride is already fresh
+        if (first == true || splitter) first = false;
         else {
 
             rideFile = new RideFile();
@@ -57,44 +58,44 @@ FitlogParser::startElement( const QString&, const QString&,
         // if caller is looking for rides...
         if (rides) rides->append(rideFile);
 
-    } else if (qName == "Lap") {
+    } else if (qName == QLatin1String("Lap")) {
 
         lap++;
         double start = start_time.secsTo(convertToLocalTime(qAttributes.value("StartTime")));
         double stop = start + qAttributes.value("DurationSeconds").toDouble();
         rideFile->addInterval(start, stop, QString("%1").arg(lap));
 
-    } else if (qName == "Track") {
+    } else if (qName == QLatin1String("Track")) {
 
 	    // Use the time of the first lap as the time of the activity.
         track_offset = start_time.secsTo(convertToLocalTime(qAttributes.value("StartTime")));
 
-    } else if (qName == "Category") {
+    } else if (qName == QLatin1String("Category")) {
 
         rideFile->setTag("Sport", qAttributes.value("Name"));
 
-    } else if (qName == "Metadata") {
+    } else if (qName == QLatin1String("Metadata")) {
 
         QString source = qAttributes.value("Source");
         if (source != "") rideFile->setDeviceType(source);
 
-    } else if (qName == "pt") {
+    } else if (qName == QLatin1String("pt")) {
 
         // set point values to zero
         RideFilePoint point;
 
         // extract from the attributes
         for (int i=0; i<qAttributes.count(); i++) {
-            QString m = qAttributes.qName(i);
-
-            if (m == "tm") point.secs = track_offset + qAttributes.value(i).toInt();
-            else if (m == "dist") point.km = qAttributes.value(i).toFloat() / 1000.00; // meters to km
-            else if (m == "ele") point.alt = qAttributes.value(i).toFloat();
-            else if (m == "hr") point.hr = qAttributes.value(i).toFloat();
-            else if (m == "cadence") point.cad = qAttributes.value(i).toFloat();
-            else if (m == "power") point.watts = qAttributes.value(i).toFloat();
-            else if (m == "lat") point.lat = qAttributes.value(i).toFloat();
-            else if (m == "lon") point.lon = qAttributes.value(i).toFloat();
+            const QString m = qAttributes.qName(i);
+
+            if (m == QLatin1String("tm")) point.secs = track_offset + qAttributes.value(i).toInt();
+            else if (m == QLatin1String("dist")) point.km = xmlDouble(qAttributes.value(i)) / 1000.00; // meters to km
+            else if (m == QLatin1String("ele")) point.alt = xmlDouble(qAttributes.value(i));
+            else if (m == QLatin1String("hr")) point.hr = xmlDouble(qAttributes.value(i));
+            else if (m == QLatin1String("cadence")) point.cad = xmlDouble(qAttributes.value(i));
+            else if (m == QLatin1String("power")) point.watts = xmlDouble(qAttributes.value(i));
+            else if (m == QLatin1String("lat")) point.lat = xmlDouble(qAttributes.value(i));
+            else if (m == QLatin1String("lon")) point.lon = xmlDouble(qAttributes.value(i));
         }
 
         // now add
@@ -108,7 +109,7 @@ FitlogParser::startElement( const QString&, const QString&,
 bool
 FitlogParser::endElement( const QString&, const QString&, const QString& qName)
 {
-    if (qName == "Activity") {
+    if (qName == QLatin1String("Activity")) {
 
         // DERIVE DISTANCE FROM GPS
         if (!rideFile->areDataPresent()->km &&
@@ -202,7 +203,16 @@ FitlogParser::endElement( const QString&, const QString&, const QString& qName)
         }
         rideFile->setRecIntSecs(populardelta);
 
-    } else if (qName == "Notes") {
+        // hand the finished activity over and start afresh
+        if (splitter) {
+            splitter->split(rideFile);
+
+            rideFile = new RideFile();
+            rideFile->setRecIntSecs(1.0);
+            rideFile->setFileFormat("SportTracks (*.fitlog)");
+        }
+
+    } else if (qName == QLatin1String("Notes")) {
 
         rideFile->setTag("Notes", buffer);
     }
@@ -25,11 +25,12 @@
 #include <QDateTime>
 #include <QXmlDefaultHandler>
 #include "Settings.h"
+#include "XmlValues.h"
 
 class FitlogParser : public QXmlDefaultHandler
 {
 public:
-    FitlogParser(RideFile* rideFile, QList<RideFile*>*rides);
+    FitlogParser(RideFile* rideFile, QList<RideFile*>*rides, RideFileSplitter *splitter = NULL);
 
     bool startElement( const QString&, const QString&, const QString&,
 		       const QXmlAttributes& );
@@ -43,6 +44,7 @@ public:
 
     RideFile*	rideFile;
     QList<RideFile*> *rides; // when parsed multiple rides
+    RideFileSplitter *splitter; // when streaming multiple rides out
 
 private:
 
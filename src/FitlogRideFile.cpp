@@ -50,6 +50,25 @@ RideFile *FitlogFileReader::openRideFile(QFile &file, QStringList &errors, QList
     return rideFile;
 }
 
+bool FitlogFileReader::splitRideFile(QFile &file, QStringList &errors, RideFileSplitter *splitter) const
+{
+    (void) errors;
+    RideFile *rideFile = new RideFile();
+    rideFile->setRecIntSecs(1.0);
+    rideFile->setFileFormat("SportTracks (*.fitlog)");
+
+    FitlogParser handler(rideFile, NULL, splitter);
+
+    QXmlInputSource source (&file);
+    QXmlSimpleReader reader;
+    reader.setContentHandler (&handler);
+    reader.parse (source);
+
+    // every activity has been handed out, this is the unused spare
+    delete handler.rideFile;
+    return true;
+}
+
 bool
 FitlogFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file) const
 {
@@ -24,6 +24,7 @@
 
 struct FitlogFileReader : public RideFileReader {
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const; 
+    bool splitRideFile(QFile &file, QStringList &errors, RideFileSplitter *splitter) const;
     bool writeRideFile(Context *context, const RideFile *ride, QFile &file) const;
     bool hasWrite() const { return true; }
 };
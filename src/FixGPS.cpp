@@ -55,8 +55,10 @@ class FixGPS : public DataProcessor {
         FixGPS() {}
         ~FixGPS() {}
 
-        // the processor
+        // the processor, it works a sample at a time
         bool postProcess(RideFile *, DataProcessorConfig* config);
+        bool isStreaming() { return true; }
+        DataProcessorStream *startStream(RideFile *, DataProcessorEdits *, DataProcessorConfig *config);
 
         // the config widget
         DataProcessorConfig* processorConfig(QWidget *parent) {
@@ -71,59 +73,79 @@ class FixGPS : public DataProcessor {
 
 static bool fixGPSAdded = DataProcessorFactory::instance().registerProcessor(QString("Fix GPS errors"), new FixGPS());
 
-bool
-FixGPS::postProcess(RideFile *ride, DataProcessorConfig *)
+// interpolates over the bad samples once it finds the next good one
+class FixGPSStream : public DataProcessorStream
 {
-    // ignore null or files without GPS data
-    if (!ride || ride->areDataPresent()->lat == false || ride->areDataPresent()->lon == false)
-        return false;
-
-    int errors=0;
-
-    ride->command->startLUW("Fix GPS Errors");
-
-    int lastgood = -1;  // where did we last have decent GPS data?
-    for (int i=0; i<ride->dataPoints().count(); i++) {
-        // is this one decent?
-        if (ride->dataPoints()[i]->lat && ride->dataPoints()[i]->lat >= double(-90) && ride->dataPoints()[i]->lat <= double(90) &&
-            ride->dataPoints()[i]->lon && ride->dataPoints()[i]->lon >= double(-180) && ride->dataPoints()[i]->lon <= double(180)) {
-
-            if (lastgood != -1 && (lastgood+1) != i) {
-                // interpolate from last good to here
-                // then set last good to here
-                double deltaLat = (ride->dataPoints()[i]->lat - ride->dataPoints()[lastgood]->lat) / double(i-lastgood);
-                double deltaLon = (ride->dataPoints()[i]->lon - ride->dataPoints()[lastgood]->lon) / double(i-lastgood);
-                for (int j=lastgood+1; j<i; j++) {
-                    ride->command->setPointValue(j, RideFile::lat, ride->dataPoints()[lastgood]->lat + (double(j-lastgood)*deltaLat));
-                    ride->command->setPointValue(j, RideFile::lon, ride->dataPoints()[lastgood]->lon + (double(j-lastgood)*deltaLon));
-                    errors++;
+    public:
+        FixGPSStream(RideFile *ride, DataProcessorEdits *edits)
+        : DataProcessorStream("Fix GPS Errors", ride, edits), lastgood(-1), errors(0) {}
+
+        void point(int i) {
+            const QVector<RideFilePoint*> &points = ride->dataPoints();
+
+            // is this one decent?
+            if (points[i]->lat && points[i]->lat >= double(-90) && points[i]->lat <= double(90) &&
+                points[i]->lon && points[i]->lon >= double(-180) && points[i]->lon <= double(180)) {
+
+                if (lastgood != -1 && (lastgood+1) != i) {
+                    // interpolate from last good to here
+                    // then set last good to here
+                    double deltaLat = (points[i]->lat - points[lastgood]->lat) / double(i-lastgood);
+                    double deltaLon = (points[i]->lon - points[lastgood]->lon) / double(i-lastgood);
+                    for (int j=lastgood+1; j<i; j++) {
+                        edits->setPointValue(j, RideFile::lat, points[lastgood]->lat + (double(j-lastgood)*deltaLat));
+                        edits->setPointValue(j, RideFile::lon, points[lastgood]->lon + (double(j-lastgood)*deltaLon));
+                        errors++;
+                    }
+                } else if (lastgood == -1) {
+                    // fill to front
+                    for (int j=0; j<i; j++) {
+                        edits->setPointValue(j, RideFile::lat, points[i]->lat);
+                        edits->setPointValue(j, RideFile::lon, points[i]->lon);
+                        errors++;
+                    }
                 }
-            } else if (lastgood == -1) {
-                // fill to front
-                for (int j=0; j<i; j++) {
-                    ride->command->setPointValue(j, RideFile::lat, ride->dataPoints()[i]->lat);
-                    ride->command->setPointValue(j, RideFile::lon, ride->dataPoints()[i]->lon);
+                lastgood = i;
+            }
+        }
+
+        bool finish() {
+            const QVector<RideFilePoint*> &points = ride->dataPoints();
+
+            // fill to end...
+            if (lastgood != -1 && lastgood != (points.count()-1)) {
+               // fill from lastgood to end with lastgood
+                for (int j=lastgood+1; j<points.count(); j++) {
+                    edits->setPointValue(j, RideFile::lat, points[lastgood]->lat);
+                    edits->setPointValue(j, RideFile::lon, points[lastgood]->lon);
                     errors++;
                 }
             }
-            lastgood = i;
-        }
-    }
-
-    // fill to end...
-    if (lastgood != -1 && lastgood != (ride->dataPoints().count()-1)) {
-       // fill from lastgood to end with lastgood
-        for (int j=lastgood+1; j<ride->dataPoints().count(); j++) {
-            ride->command->setPointValue(j, RideFile::lat, ride->dataPoints()[lastgood]->lat);
-            ride->command->setPointValue(j, RideFile::lon, ride->dataPoints()[lastgood]->lon);
-            errors++;
+
+            if (errors) {
+                ride->setTag("GPS errors", QString("%1").arg(errors));
+                return true;
+            } else
+                return false;
         }
-    } 
-    ride->command->endLUW();
-
-    if (errors) {
-        ride->setTag("GPS errors", QString("%1").arg(errors));
-        return true;
-    } else
-        return false;
+
+    private:
+        int lastgood;  // where did we last have decent GPS data?
+        int errors;
+};
+
+bool
+FixGPS::postProcess(RideFile *ride, DataProcessorConfig *config)
+{
+    return DataProcessorFactory::streamProcess(ride, QList<DataProcessor*>() << this, config);
+}
+
+DataProcessorStream *
+FixGPS::startStream(RideFile *ride, DataProcessorEdits *edits, DataProcessorConfig *)
+{
+    // ignore null or files without GPS data
+    if (!ride || ride->areDataPresent()->lat == false || ride->areDataPresent()->lon == false)
+        return NULL;
+
+    return new FixGPSStream(ride, edits);
 }
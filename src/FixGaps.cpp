@@ -192,25 +192,29 @@ FixGaps::postProcess(RideFile *ride, DataProcessorConfig *config=0)
                 double lrbalancedelta = (point->lrbalance - last->lrbalance) / (double) count;
 
                 // add the points
+                QVector<RideFilePoint> add;
                 for(int i=0; i<count; i++) {
-                    RideFilePoint *add = new RideFilePoint(last->secs+((i+1)*ride->recIntSecs()),
-                                                           last->cad+((i+1)*caddelta),
-                                                           last->hr + ((i+1)*hrdelta),
-                                                           last->km + ((i+1)*kmdelta),
-                                                           last->kph + ((i+1)*kphdelta),
-                                                           last->nm + ((i+1)*nmdelta),
-                                                           last->watts + ((i+1)*pwrdelta),
-                                                           last->alt + ((i+1)*altdelta),
-                                                           last->lon + ((i+1)*londelta),
-                                                           last->lat + ((i+1)*latdelta),
-                                                           last->headwind + ((i+1)*hwdelta),
-                                                           last->slope + ((i+1)*slopedelta),
-                                                           last->temp + ((i+1)*temperaturedelta),
-                                                           last->lrbalance + ((i+1)*lrbalancedelta),
-                                                           last->interval);
-                    ride->command->insertPoint(position++, add);
+                    add << RideFilePoint(last->secs+((i+1)*ride->recIntSecs()),
+                                         last->cad+((i+1)*caddelta),
+                                         last->hr + ((i+1)*hrdelta),
+                                         last->km + ((i+1)*kmdelta),
+                                         last->kph + ((i+1)*kphdelta),
+                                         last->nm + ((i+1)*nmdelta),
+                                         last->watts + ((i+1)*pwrdelta),
+                                         last->alt + ((i+1)*altdelta),
+                                         last->lon + ((i+1)*londelta),
+                                         last->lat + ((i+1)*latdelta),
+                                         last->headwind + ((i+1)*hwdelta),
+                                         last->slope + ((i+1)*slopedelta),
+                                         last->temp + ((i+1)*temperaturedelta),
+                                         last->lrbalance + ((i+1)*lrbalancedelta),
+                                         last->interval);
                 }
 
+                // in one block, rather than a point at a time
+                ride->command->insertPoints(position, add);
+                position += count;
+
             // stationary or greater than 30 seconds... fill with zeroes
             } else if (gap > stop) {
 
@@ -221,24 +225,28 @@ FixGaps::postProcess(RideFile *ride, DataProcessorConfig *config=0)
                 double kmdelta = (point->km - last->km) / (double) count;
 
                 // add zero value points
+                QVector<RideFilePoint> add;
                 for(int i=0; i<count; i++) {
-                    RideFilePoint *add = new RideFilePoint(last->secs+((i+1)*ride->recIntSecs()),
-                                                           0,
-                                                           0,
-                                                           last->km + ((i+1)*kmdelta),
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           last->alt,
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           last->interval);
-                    ride->command->insertPoint(position++, add);
+                    add << RideFilePoint(last->secs+((i+1)*ride->recIntSecs()),
+                                         0,
+                                         0,
+                                         last->km + ((i+1)*kmdelta),
+                                         0,
+                                         0,
+                                         0,
+                                         last->alt,
+                                         0,
+                                         0,
+                                         0,
+                                         0,
+                                         0,
+                                         0,
+                                         last->interval);
                 }
+
+                // in one block, rather than a point at a time
+                ride->command->insertPoints(position, add);
+                position += count;
             }
         }
         last = point;
@@ -98,8 +98,10 @@ class FixHRSpikes : public DataProcessor {
         FixHRSpikes() {}
         ~FixHRSpikes() {}
 
-        // the processor
+        // the processor, it works a sample at a time
         bool postProcess(RideFile *, DataProcessorConfig* config);
+        bool isStreaming() { return true; }
+        DataProcessorStream *startStream(RideFile *, DataProcessorEdits *, DataProcessorConfig *config);
 
         // the config widget
         DataProcessorConfig* processorConfig(QWidget *parent) {
@@ -114,11 +116,77 @@ class FixHRSpikes : public DataProcessor {
 
 static bool fixHRSpikesAdded = DataProcessorFactory::instance().registerProcessor(QString("Fix HR Spikes"), new FixHRSpikes());
 
+// interpolates over the bad samples once it finds the next good one
+class FixHRSpikesStream : public DataProcessorStream
+{
+    public:
+        FixHRSpikesStream(RideFile *ride, DataProcessorEdits *edits, double max)
+        : DataProcessorStream("Fix Spikes in Recording", ride, edits),
+          max(max), lastgood(-1), spikes(0), spiketime(0.0) {}
+
+        void point(int i) {
+            const QVector<RideFilePoint*> &points = ride->dataPoints();
+
+            // If we have a non-zero HR that is not above the specified MAX
+            if (points[i]->hr > 0 && points[i]->hr <= max) {
+                if (lastgood != -1 && (lastgood+1) != i) {
+                    // interpolate from last good to here
+                    double deltaHR = (points[i]->hr - points[lastgood]->hr) / double(i-lastgood);
+
+                    for (int j=lastgood+1; j<i; j++) {
+                        // Round as fractional HR is not very uselful
+                        edits->setPointValue(j, RideFile::hr, points[lastgood]->hr + round(double(j-lastgood)*deltaHR));
+                        spikes++;
+                    }
+                } else if (lastgood == -1) {
+                    // fill to front
+                    for (int j=0; j<i; j++) {
+                        edits->setPointValue(j, RideFile::hr, points[i]->hr);
+                        spikes++;
+                    }
+                }
+                lastgood = i;   // Set lastgood to here
+                spiketime += ride->recIntSecs();
+            }
+        }
+
+        bool finish() {
+            const QVector<RideFilePoint*> &points = ride->dataPoints();
+
+            // fill to end...
+            if (lastgood != -1 && lastgood != (points.count()-1)) {
+               // fill from lastgood to end with lastgood
+                for (int j=lastgood+1; j<points.count(); j++) {
+                    edits->setPointValue(j, RideFile::hr, points[lastgood]->hr);
+                    spikes++;
+                }
+            }
+
+            ride->setTag("Spikes", QString("%1").arg(spikes));
+            ride->setTag("Spike Time", QString("%1").arg(spiketime));
+
+            if (spikes) return true;
+            else return false;
+        }
+
+    private:
+        double max;
+        int lastgood;  // where did we last have decent HR data?
+        int spikes;
+        double spiketime;
+};
+
 bool
 FixHRSpikes::postProcess(RideFile *ride, DataProcessorConfig *config=0)
+{
+    return DataProcessorFactory::streamProcess(ride, QList<DataProcessor*>() << this, config);
+}
+
+DataProcessorStream *
+FixHRSpikes::startStream(RideFile *ride, DataProcessorEdits *edits, DataProcessorConfig *config)
 {
     // does this ride have heart rate data?
-    if (ride->areDataPresent()->hr == false) return false;
+    if (ride->areDataPresent()->hr == false) return NULL;
 
     // get settings
     double max;
@@ -128,50 +196,5 @@ FixHRSpikes::postProcess(RideFile *ride, DataProcessorConfig *config=0)
         max = ((FixHRSpikesConfig*)(config))->max->value();
     }
 
-    // Find the HR outliers
-    int spikes = 0;
-    double spiketime = 0.0;
-
-    ride->command->startLUW("Fix Spikes in Recording"); // Start LogicalUnitOfWork
-
-    int lastgood = -1;  // where did we last have decent HR data?
-    for (int i=0; i<ride->dataPoints().count(); i++) {
-      // If we have a non-zero HR that is not above the specified MAX
-      if(ride->dataPoints()[i]->hr > 0 and ride->dataPoints()[i]->hr <= max) {
-	if (lastgood != -1 && (lastgood+1) != i) {
-	  // interpolate from last good to here
-	  double deltaHR = (ride->dataPoints()[i]->hr - ride->dataPoints()[lastgood]->hr) / double(i-lastgood);
-
-	  for (int j=lastgood+1; j<i; j++) {
-	    // Round as fractional HR is not very uselful
-	    ride->command->setPointValue(j, RideFile::hr, ride->dataPoints()[lastgood]->hr + round(double(j-lastgood)*deltaHR));
-	    spikes++;
-	  }
-	} else if (lastgood == -1) {
-	  // fill to front
-	  for (int j=0; j<i; j++) {
-	    ride->command->setPointValue(j, RideFile::hr, ride->dataPoints()[i]->hr);
-	    spikes++;
-	  }
-	}
-	lastgood = i;		// Set lastgood to here
-        spiketime += ride->recIntSecs();
-      }
-    }
-    // fill to end...
-    if (lastgood != -1 && lastgood != (ride->dataPoints().count()-1)) {
-       // fill from lastgood to end with lastgood
-        for (int j=lastgood+1; j<ride->dataPoints().count(); j++) {
-            ride->command->setPointValue(j, RideFile::hr, ride->dataPoints()[lastgood]->hr);
-            spikes++;
-        }
-    }
-
-    ride->command->endLUW();	// End of LogicalUnitOfWork
-
-    ride->setTag("Spikes", QString("%1").arg(spikes));
-    ride->setTag("Spike Time", QString("%1").arg(spiketime));
-
-    if (spikes) return true;
-    else return false;
+    return new FixHRSpikesStream(ride, edits, max);
 }
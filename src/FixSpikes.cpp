@@ -168,7 +168,7 @@ FixSpikes::postProcess(RideFile *ride, DataProcessorConfig *config=0)
     }
 
     LTMOutliers *outliers = new LTMOutliers(secs.data(), power.data(), power.count(), windowsize, false);
-    ride->command->startLUW("Fix Spikes in Recording");
+    DataProcessorEdits edits(ride); // undone together
     for (int i=0; i<secs.count(); i++) {
 
         // is this over variance threshold?
@@ -189,9 +189,10 @@ FixSpikes::postProcess(RideFile *ride, DataProcessorConfig *config=0)
         if (pos > 0) left = ride->dataPoints()[pos-1]->watts;
         if (pos < (ride->dataPoints().count()-1)) right = ride->dataPoints()[pos+1]->watts;
 
-        ride->command->setPointValue(pos, RideFile::watts, (left+right)/2.0);
+        edits.setPointValue(pos, RideFile::watts, (left+right)/2.0);
     }
-    ride->command->endLUW();
+    edits.commit("Fix Spikes in Recording");
+    delete outliers;
 
     ride->setTag("Spikes", QString("%1").arg(spikes));
     ride->setTag("Spike Time", QString("%1").arg(spiketime));
@@ -87,8 +87,10 @@ class FixTorque : public DataProcessor {
         FixTorque() {}
         ~FixTorque() {}
 
-        // the processor
+        // the processor, it works a sample at a time
         bool postProcess(RideFile *, DataProcessorConfig* config);
+        bool isStreaming() { return true; }
+        DataProcessorStream *startStream(RideFile *, DataProcessorEdits *, DataProcessorConfig *config);
 
         // the config widget
         DataProcessorConfig* processorConfig(QWidget *parent) {
@@ -103,11 +105,44 @@ class FixTorque : public DataProcessor {
 
 static bool fixTorqueAdded = DataProcessorFactory::instance().registerProcessor(QString("Adjust Torque Values"), new FixTorque());
 
+// adjusts each sample as it goes
+class FixTorqueStream : public DataProcessorStream
+{
+    public:
+        FixTorqueStream(RideFile *ride, DataProcessorEdits *edits, double nmAdjust)
+        : DataProcessorStream("Adjust Torque", ride, edits), nmAdjust(nmAdjust) {}
+
+        void point(int i) {
+            RideFilePoint *point = ride->dataPoints()[i];
+
+            if (point->nm != 0) {
+                double newnm = point->nm + nmAdjust;
+                edits->setPointValue(i, RideFile::watts, point->watts * (newnm / point->nm));
+                edits->setPointValue(i, RideFile::nm, newnm);
+            }
+        }
+
+        bool finish() {
+            double currentta = ride->getTag("Torque Adjust", "0.0").toDouble();
+            ride->setTag("Torque Adjust", QString("%1 nm").arg(currentta + nmAdjust));
+            return true;
+        }
+
+    private:
+        double nmAdjust;
+};
+
 bool
 FixTorque::postProcess(RideFile *ride, DataProcessorConfig *config=0)
+{
+    return DataProcessorFactory::streamProcess(ride, QList<DataProcessor*>() << this, config);
+}
+
+DataProcessorStream *
+FixTorque::startStream(RideFile *ride, DataProcessorEdits *edits, DataProcessorConfig *config)
 {
     // does this ride have torque?
-    if (ride->areDataPresent()->nm == false) return false;
+    if (ride->areDataPresent()->nm == false) return NULL;
 
     // Lets do it then!
     QString ta;
@@ -131,23 +166,7 @@ FixTorque::postProcess(RideFile *ride, DataProcessorConfig *config=0)
     }
 
     // no adjustment required
-    if (nmAdjust == 0) return false;
-
-    // apply the change
-    ride->command->startLUW("Adjust Torque");
-    for (int i=0; i<ride->dataPoints().count(); i++) {
-        RideFilePoint *point = ride->dataPoints()[i];
-
-      if (point->nm != 0) {
-            double newnm = point->nm + nmAdjust;
-            ride->command->setPointValue(i, RideFile::watts, point->watts * (newnm / point->nm));
-            ride->command->setPointValue(i, RideFile::nm, newnm);
-        }
-    }
-    ride->command->endLUW();
-
-    double currentta = ride->getTag("Torque Adjust", "0.0").toDouble();
-    ride->setTag("Torque Adjust", QString("%1 nm").arg(currentta + nmAdjust));
+    if (nmAdjust == 0) return NULL;
 
-    return true;
+    return new FixTorqueStream(ride, edits, nmAdjust);
 }
@@ -0,0 +1,510 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "FormulaMetric.h"
+#include "RideStatistics.h"
+#include <QFile>
+#include <QSettings>
+#include <QRegExp>
+#include <math.h>
+
+int FormulaMetric::fingerprint_ = 0;
+
+// the sample series a formula can name
+static RideFile::SeriesType seriesNamed(QString name)
+{
+    static QHash<QString, RideFile::SeriesType> names;
+    if (names.isEmpty()) {
+        names.insert("secs", RideFile::secs);
+        names.insert("cad", RideFile::cad);
+        names.insert("hr", RideFile::hr);
+        names.insert("km", RideFile::km);
+        names.insert("kph", RideFile::kph);
+        names.insert("nm", RideFile::nm);
+        names.insert("watts", RideFile::watts);
+        names.insert("alt", RideFile::alt);
+        names.insert("headwind", RideFile::headwind);
+        names.insert("slope", RideFile::slope);
+        names.insert("temp", RideFile::temp);
+        names.insert("lrbalance", RideFile::lrbalance);
+        names.insert("np", RideFile::NP);
+        names.insert("xpower", RideFile::xPower);
+        names.insert("apower", RideFile::aPower);
+    }
+    return names.value(name, RideFile::none);
+}
+
+//
+// Compiling; a recursive descent over the formula, emitting the
+// program as it goes, with the usual precedence and ^ binding tightest
+//
+class FormulaCompiler
+{
+    public:
+
+        FormulaCompiler(QString text, FormulaProgram &program, QStringList &errors) :
+            text(text), pos(0), failed(false), program(program), errors(errors) {}
+
+        bool compile() {
+            next();
+            Kind kind = expression();
+            if (!failed && token != End) error(QString("unexpected '%1'").arg(text.mid(start, pos - start)));
+            if (!failed && kind == Samples) error("the samples must be reduced to a value, e.g. avg(watts)");
+            return !failed;
+        }
+
+    private:
+
+        // what an expression leaves on the stack
+        enum Kind { Scalar, Samples };
+
+        Kind expression() {
+            Kind kind = term();
+            while (!failed && token == Char && (ch == '+' || ch == '-')) {
+                char op = ch;
+                next();
+                kind = join(kind, term());
+                emit(FormulaProgram::Binary, op);
+            }
+            return kind;
+        }
+
+        Kind term() {
+            Kind kind = power();
+            while (!failed && token == Char && (ch == '*' || ch == '/')) {
+                char op = ch;
+                next();
+                kind = join(kind, power());
+                emit(FormulaProgram::Binary, op);
+            }
+            return kind;
+        }
+
+        Kind power() {
+            Kind kind = unary();
+            if (!failed && token == Char && ch == '^') {
+                next();
+                kind = join(kind, power()); // right associative
+                emit(FormulaProgram::Binary, '^');
+            }
+            return kind;
+        }
+
+        Kind unary() {
+            if (token == Char && ch == '-') {
+                next();
+                Kind kind = unary();
+                emit(FormulaProgram::Negate);
+                return kind;
+            }
+            return primary();
+        }
+
+        Kind primary() {
+            if (failed) return Scalar;
+
+            if (token == Number) {
+                emit(FormulaProgram::Constant, 0, number);
+                next();
+                return Scalar;
+            }
+
+            if (token == Char && ch == '(') {
+                next();
+                Kind kind = expression();
+                expect(')');
+                return kind;
+            }
+
+            if (token != Name) {
+                error(token == End ? QString("unexpected end") : QString("unexpected '%1'").arg(ch));
+                return Scalar;
+            }
+
+            QString word = name;
+            next();
+
+            // a function call
+            if (token == Char && ch == '(') {
+                next();
+                Kind kind = expression();
+                expect(')');
+
+                static const char *reductions[] = { "avg", "sum", "min", "max", "count", "total", 0 };
+                for (int i=0; reductions[i]; i++) {
+                    if (word == reductions[i]) {
+                        emit(FormulaProgram::Reduce, FormulaProgram::Avg + i);
+                        return Scalar;
+                    }
+                }
+                static const char *functions[] = { "sqrt", "abs", "log", "exp", 0 };
+                for (int i=0; functions[i]; i++) {
+                    if (word == functions[i]) {
+                        emit(FormulaProgram::Function, FormulaProgram::Sqrt + i);
+                        return kind;
+                    }
+                }
+                error(QString("unknown function '%1'").arg(word));
+                return Scalar;
+            }
+
+            // a series of samples
+            RideFile::SeriesType series = seriesNamed(word);
+            if (series != RideFile::none) {
+                emit(FormulaProgram::Series, 0, series);
+                return Samples;
+            }
+
+            // or another metric
+            if (RideMetricFactory::instance().haveMetric(word)) {
+                if (!program.metrics.contains(word)) program.metrics << word;
+                emit(FormulaProgram::Metric, 0, program.metrics.indexOf(word));
+                return Scalar;
+            }
+
+            error(QString("unknown series or metric '%1'").arg(word));
+            return Scalar;
+        }
+
+        Kind join(Kind a, Kind b) { return (a == Samples || b == Samples) ? Samples : Scalar; }
+
+        void expect(char c) {
+            if (failed) return;
+            if (token == Char && ch == c) next();
+            else error(QString("expected '%1'").arg(c));
+        }
+
+        void emit(int code, int op=0, double number=0) {
+            FormulaProgram::Instruction add(code);
+            add.op = op;
+            add.number = number;
+            program.code << add;
+        }
+
+        void error(QString message) {
+            if (!failed) errors << message;
+            failed = true;
+        }
+
+        // the tokens
+        enum { End, Number, Name, Char } token;
+        QString name;
+        double number;
+        char ch;
+
+        void next() {
+            while (pos < text.length() && text[pos].isSpace()) pos++;
+            start = pos;
+
+            if (pos == text.length()) {
+                token = End;
+                return;
+            }
+
+            QChar c = text[pos];
+            if (c.isDigit() || (c == '.' && pos+1 < text.length() && text[pos+1].isDigit())) {
+                while (pos < text.length() && (text[pos].isDigit() || text[pos] == '.')) pos++;
+                if (pos < text.length() && (text[pos] == 'e' || text[pos] == 'E')) {
+                    pos++;
+                    if (pos < text.length() && (text[pos] == '+' || text[pos] == '-')) pos++;
+                    while (pos < text.length() && text[pos].isDigit()) pos++;
+                }
+                bool ok;
+                number = text.mid(start, pos - start).toDouble(&ok);
+                token = Number;
+                if (!ok) error(QString("bad number '%1'").arg(text.mid(start, pos - start)));
+                return;
+            }
+            if (c.isLetter() || c == '_') {
+                while (pos < text.length() && (text[pos].isLetterOrNumber() || text[pos] == '_')) pos++;
+                name = text.mid(start, pos - start);
+                token = Name;
+                return;
+            }
+            ch = c.toLatin1();
+            token = Char;
+            pos++;
+        }
+
+        QString text;
+        int pos, start;
+        bool failed;
+        FormulaProgram &program;
+        QStringList &errors;
+};
+
+bool
+FormulaProgram::compile(QString formula, QStringList &errors)
+{
+    code.clear();
+    metrics.clear();
+
+    FormulaCompiler compiler(formula, *this, errors);
+    if (compiler.compile()) return true;
+
+    code.clear();
+    metrics.clear();
+    return false;
+}
+
+//
+// Running; the stack holds values or whole columns of samples
+//
+struct FormulaColumn
+{
+    FormulaColumn() : scalar(true), value(0) {}
+    bool scalar;
+    double value;
+    QVector<double> values;
+
+    double at(int i) const { return scalar ? value : values[i]; }
+};
+
+static inline double apply(int op, double x, double y)
+{
+    switch (op) {
+    case '+': return x + y;
+    case '-': return x - y;
+    case '*': return x * y;
+    case '/': return y ? x / y : 0;
+    default:
+    case '^': return pow(x, y);
+    }
+}
+
+static inline double function(int op, double x)
+{
+    switch (op) {
+    case FormulaProgram::Sqrt: return x > 0 ? sqrt(x) : 0;
+    case FormulaProgram::Abs: return fabs(x);
+    case FormulaProgram::Log: return x > 0 ? log(x) : 0;
+    default:
+    case FormulaProgram::Exp: return exp(x);
+    }
+}
+
+static double reduce(int op, const FormulaColumn &column, int samples, double recIntSecs)
+{
+    // a value where samples are expected stands for every sample
+    if (column.scalar) {
+        switch (op) {
+        case FormulaProgram::Sum: return column.value * samples;
+        case FormulaProgram::Count: return column.value ? samples : 0;
+        case FormulaProgram::Total: return column.value * samples * recIntSecs;
+        default: return samples ? column.value : 0;
+        }
+    }
+
+    const QVector<double> &values = column.values;
+    if (values.isEmpty()) return 0;
+
+    double result = op == FormulaProgram::Min || op == FormulaProgram::Max ? values[0] : 0;
+    for (int i=0; i<values.count(); i++) {
+        switch (op) {
+        case FormulaProgram::Min: if (values[i] < result) result = values[i]; break;
+        case FormulaProgram::Max: if (values[i] > result) result = values[i]; break;
+        case FormulaProgram::Count: if (values[i]) result++; break;
+        default: result += values[i]; break;
+        }
+    }
+    if (op == FormulaProgram::Avg) result /= values.count();
+    if (op == FormulaProgram::Total) result *= recIntSecs;
+    return result;
+}
+
+double
+FormulaProgram::run(const RideStatistics &statistics, const QHash<QString,RideMetric*> &deps) const
+{
+    const RideFile *ride = statistics.rideFile();
+    int samples = ride->dataPoints().count();
+
+    QVector<FormulaColumn> stack;
+    stack.reserve(8);
+
+    foreach(const Instruction &i, code) {
+        switch (i.code) {
+
+        case Constant:
+            {
+                FormulaColumn push;
+                push.value = i.number;
+                stack << push;
+            }
+            break;
+
+        case Series:
+            {
+                FormulaColumn push;
+                push.scalar = false;
+                push.values = statistics.series(static_cast<RideFile::SeriesType>(int(i.number)));
+                stack << push;
+            }
+            break;
+
+        case Metric:
+            {
+                FormulaColumn push;
+                RideMetric *m = deps.value(metrics.at(int(i.number)), NULL);
+                push.value = m ? m->value(true) : 0;
+                stack << push;
+            }
+            break;
+
+        case Negate:
+            {
+                FormulaColumn &top = stack.last();
+                if (top.scalar) top.value = -top.value;
+                else for (int n=0; n<top.values.count(); n++) top.values[n] = -top.values[n];
+            }
+            break;
+
+        case Function:
+            {
+                FormulaColumn &top = stack.last();
+                if (top.scalar) top.value = function(i.op, top.value);
+                else for (int n=0; n<top.values.count(); n++) top.values[n] = function(i.op, top.values[n]);
+            }
+            break;
+
+        case Binary:
+            {
+                FormulaColumn b = stack.last();
+                stack.pop_back();
+                FormulaColumn &a = stack.last();
+
+                if (a.scalar && b.scalar) {
+                    a.value = apply(i.op, a.value, b.value);
+                } else {
+                    // the result goes in whichever is a column
+                    if (a.scalar) {
+                        a.scalar = false;
+                        a.values.fill(a.value, b.values.count());
+                    }
+                    for (int n=0; n<a.values.count(); n++) a.values[n] = apply(i.op, a.values[n], b.at(n));
+                }
+            }
+            break;
+
+        case Reduce:
+            {
+                FormulaColumn &top = stack.last();
+                top.value = reduce(i.op, top, samples, ride->recIntSecs());
+                top.scalar = true;
+                top.values.clear();
+            }
+            break;
+        }
+    }
+
+    if (stack.isEmpty()) return 0;
+    double result = stack.last().value;
+    return (isnan(result) || isinf(result)) ? 0 : result;
+}
+
+//
+// The metrics
+//
+FormulaMetric::FormulaMetric(QString symbol, QSharedPointer<const FormulaProgram> program) : program(program)
+{
+    setSymbol(symbol);
+}
+
+void
+FormulaMetric::compute(const RideFile *ride, const Zones *, int, const HrZones *, int,
+                       const QHash<QString,RideMetric*> &deps, const Context *)
+{
+    setValue(program->run(statistics(ride), deps));
+    setCount(ride->dataPoints().count());
+}
+
+static RideMetric::MetricType typeNamed(QString name)
+{
+    if (name == "average") return RideMetric::Average;
+    if (name == "peak") return RideMetric::Peak;
+    if (name == "low") return RideMetric::Low;
+    return RideMetric::Total;
+}
+
+QStringList
+FormulaMetric::addFormulas(QString filename)
+{
+    QStringList errors;
+
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly)) return errors; // none is fine
+    QByteArray contents = file.readAll();
+    fingerprint_ = qChecksum(contents.constData(), contents.size());
+    file.close();
+
+    RideMetricFactory &factory = RideMetricFactory::instance();
+    QSettings ini(filename, QSettings::IniFormat);
+
+    // the sections come back sorted, not in the order they were written,
+    // so keep going round until no more of those using others can be added
+    QStringList pending = ini.childGroups();
+    QHash<QString, QStringList> problems;
+    bool progress = true;
+    while (progress && !pending.isEmpty()) {
+        progress = false;
+
+        foreach(QString symbol, pending) {
+
+            if (factory.haveMetric(symbol) || !QRegExp("[a-z0-9_]+").exactMatch(symbol)) {
+                errors << QString("%1: not a new metric symbol, use lower case letters, digits and _").arg(symbol);
+                pending.removeAll(symbol);
+                continue;
+            }
+
+            ini.beginGroup(symbol);
+            QString formula = ini.value("formula").toString();
+            QString name = ini.value("name", symbol).toString();
+            QString units = ini.value("units").toString();
+            QString imperialUnits = ini.value("imperialunits", units).toString();
+            double conversion = ini.value("conversion", 1.0).toDouble();
+            int precision = ini.value("precision", 0).toInt();
+            QString type = ini.value("type", "total").toString().toLower();
+            ini.endGroup();
+
+            QStringList why;
+            QSharedPointer<FormulaProgram> program(new FormulaProgram);
+            if (!program->compile(formula, why)) {
+                problems.insert(symbol, why);
+                continue;
+            }
+
+            FormulaMetric metric(symbol, program);
+            metric.setName(name);
+            metric.setInternalName(name);
+            metric.setMetricUnits(units);
+            metric.setImperialUnits(imperialUnits);
+            metric.setConversion(conversion);
+            metric.setPrecision(precision);
+            metric.setType(typeNamed(type));
+
+            QVector<QString> deps = program->metrics.toVector();
+            factory.addMetric(metric, &deps);
+
+            pending.removeAll(symbol);
+            progress = true;
+        }
+    }
+
+    foreach(QString symbol, pending)
+        errors << QString("%1: %2").arg(symbol).arg(problems.value(symbol).join(", "));
+    return errors;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_FormulaMetric_h
+#define _GC_FormulaMetric_h 1
+#include "GoldenCheetah.h"
+
+#include "RideMetric.h"
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+//
+// Metrics the user writes as formulas in formulas.ini, in the library
+// folder alongside the athletes, one section per metric:
+//
+// [power_per_beat]
+// name=Power per Heartbeat
+// formula=avg(watts) / avg(hr)
+// units=watts/bpm
+// precision=2
+// type=average
+//
+// Formulas are arithmetic (+ - * / ^, sqrt, abs, log, exp) over numbers,
+// other metrics by symbol and sample series (watts, hr, cad, kph, km, nm,
+// alt, slope, temp, secs, headwind, lrbalance, np, xpower, apower). The
+// series must be reduced to a value by avg(), sum(), min(), max(), count()
+// for the samples that are not zero, or total() for the sum over time, so
+// avg(watts / hr) works sample by sample. Dividing by zero gives zero.
+//
+// Each formula is compiled once, when registered, into a program that
+// works a whole column of samples at a time. The columns come from the
+// RideStatistics shared by every metric computed for the ride, and the
+// metrics a formula uses are its dependencies, so they are computed in
+// the same pass as the built in metrics.
+//
+class FormulaProgram
+{
+    public:
+
+        enum { Constant, Series, Metric, Binary, Negate, Function, Reduce };
+        enum { Sqrt, Abs, Log, Exp };
+        enum { Avg, Sum, Min, Max, Count, Total };
+
+        struct Instruction {
+            Instruction(int code=Constant) : code(code), op(0), number(0) {}
+            int code;
+            int op;         // operator character, function or reduction
+            double number;  // constant value, series or index into metrics
+        };
+
+        // false (with errors) when it doesn't parse or leaves samples
+        // that aren't reduced to a value
+        bool compile(QString formula, QStringList &errors);
+
+        // the program is only read, so metrics share them across threads
+        double run(const RideStatistics &statistics, const QHash<QString,RideMetric*> &deps) const;
+
+        QVector<Instruction> code;
+        QStringList metrics; // the symbols Metric instructions refer to
+};
+
+class FormulaMetric : public RideMetric
+{
+    public:
+
+        FormulaMetric(QString symbol, QSharedPointer<const FormulaProgram> program);
+
+        void compute(const RideFile *ride, const Zones *, int, const HrZones *, int,
+                     const QHash<QString,RideMetric*> &deps, const Context *);
+        RideMetric *clone() const { return new FormulaMetric(*this); }
+
+        // register the formulas in the file, problems with any of them
+        // are returned and those formulas are left out
+        static QStringList addFormulas(QString filename);
+
+        // changes when the formulas do, so the metrics table is rebuilt
+        static int fingerprint() { return fingerprint_; }
+
+    private:
+
+        QSharedPointer<const FormulaProgram> program;
+        static int fingerprint_;
+};
+
+#endif // _GC_FormulaMetric_h
@@ -54,7 +54,10 @@ const static uint8_t slope_command[12] = {
 Fortius::Fortius(QObject *parent) : QThread(parent)
 {
     
-    devicePower = deviceHeartRate = deviceCadence = deviceSpeed = 0.00;
+    devicePower = deviceHeartRate = deviceCadence = deviceSpeed = deviceDistance = 0.00;
+    deviceSteering = 0;
+    recorder = NULL;
+    publishTelemetry();
     mode = FT_IDLE;
     load = DEFAULT_LOAD;
     gradient = DEFAULT_GRADIENT;
@@ -152,23 +155,46 @@ void Fortius::setGradient(double gradient)
 void Fortius::getTelemetry(double &power, double &heartrate, double &cadence, double &speed, double &distance, int &buttons, int &steering, int &status)
 {
 
-    pvars.lock();
-    power = devicePower;
-    heartrate = deviceHeartRate;
-    cadence = deviceCadence;
-    speed = deviceSpeed;
-    distance = deviceDistance;
-    buttons = deviceButtons;
-    steering = deviceSteering;
-    status = deviceStatus;
+    FortiusTelemetry latest = published.read();
+    power = latest.power;
+    heartrate = latest.heartrate;
+    cadence = latest.cadence;
+    speed = latest.speed;
+    distance = latest.distance;
+    steering = latest.steering;
     
     // work around to ensure controller doesn't miss button press. 
     // The run thread will only set the button bits, they don't get
     // reset until the ui reads the device state
-    deviceButtons = 0; 
+    buttons = deviceButtons.take();
+
+    pvars.lock();
+    status = deviceStatus;
     pvars.unlock();
 }
 
+// run() thread, hand over a consistent copy of the telemetry
+void Fortius::publishTelemetry()
+{
+    FortiusTelemetry latest;
+    latest.power = devicePower;
+    latest.heartrate = deviceHeartRate;
+    latest.cadence = deviceCadence;
+    latest.speed = deviceSpeed;
+    latest.distance = deviceDistance;
+    latest.steering = deviceSteering;
+    published.publish(latest);
+
+    // only changes are recorded, the ride carries values forward
+    if (recorder) {
+        if (latest.power != recorded.power) recorder->record(recorderDevice, SessionRecorder::Watts, latest.power);
+        if (latest.heartrate != recorded.heartrate) recorder->record(recorderDevice, SessionRecorder::HeartRate, latest.heartrate);
+        if (latest.cadence != recorded.cadence) recorder->record(recorderDevice, SessionRecorder::Cadence, latest.cadence);
+        if (latest.speed != recorded.speed) recorder->record(recorderDevice, SessionRecorder::Speed, latest.speed);
+    }
+    recorded = latest;
+}
+
 int Fortius::getMode()
 {
     int  tmp;
@@ -317,6 +343,7 @@ int Fortius::quit(int code)
  *----------------------------------------------------------------------*/
 void Fortius::run()
 {
+    stats.reset();
 
     // newly read values - compared against cached values
     bool isDeviceOpen = false;
@@ -351,9 +378,11 @@ void Fortius::run()
     curSpeed = this->deviceSpeed = 0;
     // UNUSED curDistance = this->deviceDistance = 0;
     curSteering = this->deviceSteering = 0;
-    curButtons = this->deviceButtons = 0;
+    curButtons = 0;
+    deviceButtons.take();
     pedalSensor = 0;
     pvars.unlock();
+    publishTelemetry();
 
 
     // open the device
@@ -375,6 +404,8 @@ void Fortius::run()
             int actualLength = readMessage();
             if (actualLength >= 24) {
 
+                stats.arrived();
+
                 //----------------------------------------------------------------
                 // UPDATE BASIC TELEMETRY (HR, CAD, SPD et al)
                 // The data structure is very simple, no bit twiddling needed here
@@ -389,10 +420,9 @@ void Fortius::run()
                 curSteering = buf[18] | (buf[19] << 8);
                 
                 // update public fields
-                pvars.lock();
-                deviceButtons |= curButtons;    // workaround to ensure controller doesn't miss button pushes
+                deviceButtons.press(curButtons);    // workaround to ensure controller doesn't miss button pushes
                 deviceSteering = curSteering;
-                pvars.unlock();
+                publishTelemetry();
             }
             if (actualLength >= 48) {
                 // brake status status&0x04 == stopping wheel
@@ -428,19 +458,18 @@ void Fortius::run()
                 curHeartRate = buf[12];
 
                 // update public fields
-                pvars.lock();
                 deviceSpeed = curSpeed;
                 deviceCadence = curCadence;
                 deviceHeartRate = curHeartRate;
                 devicePower = curPower;
-                pvars.unlock();
+                publishTelemetry();
             }
         }
 
         //----------------------------------------------------------------
         // LISTEN TO GUI CONTROL COMMANDS
         //----------------------------------------------------------------
-        pvars.lock();
+        stats.lock(pvars);
         curstatus = this->deviceStatus;
         pvars.unlock();
 
@@ -40,6 +40,9 @@
 #include <QFile>
 #include <QtCore/qendian.h>
 #include "RealtimeController.h"
+#include "TelemetrySnapshot.h"
+#include "DeviceStats.h"
+#include "SessionRecorder.h"
 
 #include "LibUsb.h"
 
@@ -73,6 +76,17 @@
 #define DEFAULT_CALIBRATION  0.00
 #define DEFAULT_SCALING      1.00
 
+// inbound telemetry as published by the run() thread
+struct FortiusTelemetry
+{
+    double power;           // current output power in Watts
+    double heartrate;       // current heartrate in BPM
+    double cadence;         // current cadence in RPM
+    double speed;           // current speed in KPH
+    double distance;        // odometer in meters
+    int steering;           // Steering angle
+};
+
 class Fortius : public QThread
 {
 
@@ -111,6 +125,9 @@ public:
     // direct access to class variables is not allowed because we need to use wait conditions
     // to sync data read/writes between the run() thread and the main gui thread
     void getTelemetry(double &power, double &heartrate, double &cadence, double &speed, double &distance, int &buttons, int &steering, int &status);
+    // raw samples are sent to the recorder as they arrive
+    void setRecorder(SessionRecorder *recorder, int device) { this->recorder = recorder; recorderDevice = device; }
+    DeviceStats stats;          // message timings, see DeviceStats
 
 private:
     void run();                                 // called by start to kick off the CT comtrol thread
@@ -134,15 +151,22 @@ private:
     // Mutex for controlling accessing private data
     QMutex pvars;
 
-    // INBOUND TELEMETRY - all volatile since it is updated by the run() thread
-    volatile double devicePower;            // current output power in Watts
-    volatile double deviceHeartRate;        // current heartrate in BPM
-    volatile double deviceCadence;          // current cadence in RPM
-    volatile double deviceSpeed;            // current speed in KPH
-    volatile double deviceDistance;         // odometer in meters
-    volatile int    deviceButtons;          // Button status
+    // INBOUND TELEMETRY - only touched by the run() thread, which publishes
+    // a copy for the controller to read without taking pvars
+    double devicePower;            // current output power in Watts
+    double deviceHeartRate;        // current heartrate in BPM
+    double deviceCadence;          // current cadence in RPM
+    double deviceSpeed;            // current speed in KPH
+    double deviceDistance;         // odometer in meters
+    int    deviceSteering;         // Steering angle
+    void publishTelemetry();
+    TelemetrySnapshot<FortiusTelemetry> published;
+    TelemetryButtons deviceButtons; // Button status, latched until read
+    FortiusTelemetry recorded;      // last values sent to the recorder
+    SessionRecorder *recorder;      // where raw samples go, if recording
+    int recorderDevice;
+
     volatile int    deviceStatus;           // Device status running, paused, disconnected
-    volatile int    deviceSteering;            // Steering angle
     
     // OUTBOUND COMMANDS - all volatile since it is updated by the GUI thread
     volatile int mode;
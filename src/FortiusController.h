@@ -49,6 +49,8 @@ public:
     void setLoad(double);
     void setGradient(double);
     void setMode(int);
+    void setRecorder(SessionRecorder *recorder, int device) { myFortius->setRecorder(recorder, device); }
+    DeviceStats *stats() { return &myFortius->stats; }
 };
 
 #endif // _GC_FortiusController_h
@@ -65,7 +65,7 @@ private:
     QVector<QDate> dates; // dates for each cell from zero onwards
     int rows;
 
-    QMap <QDate, QVector<int>* > dateToRows; // map a date to SQL rows
+    QMap <QDate, QVector<int> > dateToRows; // map a date to SQL rows, all months
 
     QList<QString> columns; // what columns in the sql model
     Context *context;
@@ -81,23 +81,12 @@ public slots:
         }
     }
 
+    // the date index covers every ride in the source model so it is
+    // only rebuilt when the source changes, not when the month does
     void refresh() {
 
         if (!sourceModel()) return; // no model yet!
 
-        QDate first = QDate(year, month, 1);
-        // Date array
-        int monthDays = first.daysTo(first.addMonths(1)); // how many days in this month?
-        QDate firstDate = first.addDays((first.dayOfWeek()-1)*-1); // date in cell 0,0
-        int ndays = firstDate.daysTo(QDate(year, month, monthDays));
-        ndays += 7 - ndays % 7;
-
-        dates.clear();
-        dates.resize(ndays);
-        for(int i=0; i<ndays; i++) dates[i] = firstDate.addDays(i);
-
-        rows = ndays / 7;
-
         textIndex = colorIndex = filenameIndex = dateIndex = durationIndex = -1;
         columns.clear();
         for (int i=0; i<sourceModel()->columnCount(); i++) {
@@ -111,27 +100,32 @@ public slots:
         }
 
         // we need to build a list of all the rides
-        // in the source model for the dates we have
-        // first we clear previous
-        QMapIterator<QDate, QVector<int>* > fm(dateToRows);
-        while (fm.hasNext()) {
-            fm.next();
-            delete fm.value();
-        }
+        // in the source model by date
         dateToRows.clear();
-
-        // then we create new
         for (int j=0; j<sourceModel()->rowCount(); j++) {
-            QVector<int> *arr;
 
             // get ride date
             QDateTime dateTime = sourceModel()->data(sourceModel()->index(j, dateIndex), Qt::DisplayRole).toDateTime();
-            if ((arr = dateToRows.value(dateTime.date(), NULL)) == NULL)
-                arr = new QVector<int>();
-
-            arr->append(j);
-            dateToRows.insert(dateTime.date(), arr);
+            dateToRows[dateTime.date()].append(j);
         }
+        setDates();
+    }
+
+    // just the cells for the current month
+    void setDates() {
+
+        QDate first = QDate(year, month, 1);
+        // Date array
+        int monthDays = first.daysTo(first.addMonths(1)); // how many days in this month?
+        QDate firstDate = first.addDays((first.dayOfWeek()-1)*-1); // date in cell 0,0
+        int ndays = firstDate.daysTo(QDate(year, month, monthDays));
+        ndays += 7 - ndays % 7;
+
+        dates.clear();
+        dates.resize(ndays);
+        for(int i=0; i<ndays; i++) dates[i] = firstDate.addDays(i);
+
+        rows = ndays / 7;
         reset();
 
     }
@@ -156,13 +150,30 @@ public:
     void setMonth(int month, int year) {
 
         if (stale || this->month != month || this->year != year) {
-            stale = false;
             this->month = month;
             this->year  = year;
-            refresh();
+            if (stale) {
+                stale = false;
+                refresh();
+            } else {
+                setDates();
+            }
         }
     }
 
+    // nearest ride dates either side of a date, from the index
+    // rather than querying the metrics database each time
+    QDate before(QDate date) const {
+        QMap<QDate, QVector<int> >::const_iterator i = dateToRows.lowerBound(date);
+        if (i == dateToRows.constBegin()) return QDate();
+        return (--i).key();
+    }
+    QDate after(QDate date) const {
+        QMap<QDate, QVector<int> >::const_iterator i = dateToRows.lowerBound(date);
+        if (i == dateToRows.constEnd()) return QDate();
+        return i.key();
+    }
+
     int getMonth() { return month; }
     int getYear() { return year; }
 
@@ -181,7 +192,7 @@ public:
         connect(model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(refresh()));
         connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(refresh()));
 #ifdef GC_HAVE_ICAL
-        connect(context->athlete->rideCalendar, SIGNAL(dataChanged()), this, SLOT(refresh()));
+        connect(context->athlete->rideCalendar(), SIGNAL(dataChanged()), this, SLOT(refresh()));
 #endif
         refresh();
     }
@@ -238,9 +249,9 @@ public:
         case Qt::BackgroundRole:
             {
             QList<QColor> colors;
-            QVector<int> *arr = dateToRows.value(date(proxyIndex), NULL);
-            if (arr) {
-                foreach (int i, *arr) {
+            QVector<int> arr = dateToRows.value(date(proxyIndex));
+            if (arr.count()) {
+                foreach (int i, arr) {
                     if (context->rideItem() && sourceModel()->data(index(i, dateIndex, QModelIndex())).toDateTime() == context->rideItem()->dateTime) {
                         colors << GColor(CCALCURRENT); // its the current ride!
                     } else {
@@ -251,7 +262,7 @@ public:
 
 #ifdef GC_HAVE_ICAL
             // added planned workouts
-            for (int k= context->athlete->rideCalendar->data(date(proxyIndex), EventCountRole).toInt(); k>0; k--)
+            for (int k= context->athlete->rideCalendar()->data(date(proxyIndex), EventCountRole).toInt(); k>0; k--)
                 colors.append(GColor(CCALPLANNED));
 #endif
 
@@ -262,11 +273,11 @@ public:
         case Qt::ForegroundRole:
             {
             QList<QColor> colors;
-            QVector<int> *arr = dateToRows.value(date(proxyIndex), NULL);
-            if (arr) {
-                foreach (int i, *arr) {
+            QVector<int> arr = dateToRows.value(date(proxyIndex));
+            if (arr.count()) {
+                foreach (int i, arr) {
                     QString filename = sourceModel()->data(index(i, filenameIndex, QModelIndex())).toString();
-                    if (context->isfiltered && context->filters.contains(filename))
+                    if (context->isfiltered && context->filterSet.contains(filename))
                         colors << GColor(CCALCURRENT);
                     else
                         colors << QColor(Qt::black);
@@ -275,7 +286,7 @@ public:
 
 #ifdef GC_HAVE_ICAL
             // added planned workouts
-            for (int k= context->athlete->rideCalendar->data(date(proxyIndex), EventCountRole).toInt(); k>0; k--)
+            for (int k= context->athlete->rideCalendar()->data(date(proxyIndex), EventCountRole).toInt(); k>0; k--)
                 colors.append(Qt::black);
 #endif
 
@@ -313,17 +324,17 @@ public:
             {
                 QStringList filenames;
             // is there an entry?
-            QVector<int> *arr = dateToRows.value(date(proxyIndex), NULL);
+            QVector<int> arr = dateToRows.value(date(proxyIndex));
             QStringList strings;
 
-            if (arr)
-                foreach (int i, *arr)
+            if (arr.count())
+                foreach (int i, arr)
                     filenames << sourceModel()->data(index(i, filenameIndex, QModelIndex())).toString();
 
 #ifdef GC_HAVE_ICAL
             // fold in planned workouts
-            if (context->athlete->rideCalendar->data(date(proxyIndex), EventCountRole).toInt()) {
-                foreach(QString x, context->athlete->rideCalendar->data(date(proxyIndex), Qt::DisplayRole).toStringList())
+            if (context->athlete->rideCalendar()->data(date(proxyIndex), EventCountRole).toInt()) {
+                foreach(QString x, context->athlete->rideCalendar()->data(date(proxyIndex), Qt::DisplayRole).toStringList())
                     filenames << "calendar";
             }
 #endif
@@ -335,18 +346,18 @@ public:
         case Qt::DisplayRole:   // returns the string to display
             {
             // is there an entry?
-            QVector<int> *arr = dateToRows.value(date(proxyIndex), NULL);
+            QVector<int> arr = dateToRows.value(date(proxyIndex));
             QStringList strings;
 
-            if (arr)
-                foreach (int i, *arr)
+            if (arr.count())
+                foreach (int i, arr)
                     strings << sourceModel()->data(index(i, textIndex, QModelIndex())).toString();
 
 #ifdef GC_HAVE_ICAL
             // fold in planned workouts
-            if (context->athlete->rideCalendar->data(date(proxyIndex), EventCountRole).toInt()) {
+            if (context->athlete->rideCalendar()->data(date(proxyIndex), EventCountRole).toInt()) {
                 QStringList planned;
-                planned = context->athlete->rideCalendar->data(date(proxyIndex), Qt::DisplayRole).toStringList();
+                planned = context->athlete->rideCalendar()->data(date(proxyIndex), Qt::DisplayRole).toStringList();
                 strings << planned;
             }
 #endif
@@ -210,7 +210,9 @@ QString GcCrashDialog::versionHTML()
 
     // -- LUCENE ----
     QString clucene = "none";
-    #ifdef GC_HAVE_LUCENE
+    #ifdef GC_SQLITE_SEARCH
+    clucene = "sqlite";
+    #elif defined GC_HAVE_LUCENE
     clucene = _CL_VERSION;
     #endif
 
@@ -20,6 +20,55 @@
 #include "Settings.h"
 #include "GcUpgrade.h"
 #include <QDebug>
+#include <QApplication>
+#include <QProgressDialog>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+
+// removes a share of the files for GcUpgrade::removeFiles
+class GcUpgradeRemover : public QRunnable
+{
+    public:
+        GcUpgradeRemover(QStringList files, QAtomicInt *removed) : files(files), removed(removed) {}
+        void run() {
+            foreach (QString file, files) {
+                QFile::remove(file);
+                removed->ref();
+            }
+        }
+
+    private:
+        QStringList files;
+        QAtomicInt *removed;
+};
+
+void
+GcUpgrade::stepDone(const QDir &home, QString name)
+{
+    done << name;
+    appsettings->setCValue(home.dirName(), GC_UPGRADE_DONE, done.join(","));
+}
+
+void
+GcUpgrade::removeFiles(const QStringList &files)
+{
+    if (files.isEmpty()) return;
+
+    QThreadPool pool;
+    QAtomicInt removed(0);
+    int share = qMax(1, files.count() / (pool.maxThreadCount() * 4));
+    for (int i=0; i<files.count(); i += share)
+        pool.start(new GcUpgradeRemover(files.mid(i, share), &removed));
+
+    // only shows up if it takes a while
+    QProgressDialog progress(QApplication::translate("GcUpgrade", "Upgrading athlete files..."), QString(), 0, files.count());
+    progress.setMinimumDuration(2000);
+    while (!pool.waitForDone(100)) {
+        progress.setValue(int(removed));
+        QApplication::processEvents();
+    }
+}
 
 int 
 GcUpgrade::upgrade(const QDir &home)
@@ -27,6 +76,10 @@ GcUpgrade::upgrade(const QDir &home)
     // what was the last version? -- do we need to upgrade?
     int last = appsettings->cvalue(home.dirName(), GC_VERSION_USED, 0).toInt();
 
+    // and how far we got if we were interrupted
+    QString previously = appsettings->cvalue(home.dirName(), GC_UPGRADE_DONE, "").toString();
+    if (!previously.isEmpty()) done = previously.split(",");
+
     // Upgrade processing was introduced in Version 3 -- below must be performed
     // for athlete directories from prior to Version 3
     if (!last || last < VERSION3_BUILD) {
@@ -37,24 +90,33 @@ GcUpgrade::upgrade(const QDir &home)
         if (last < VERSION3_BUILD) {
 
             // 1. Delete old files
-            QStringList oldfiles;
-            oldfiles << "*.cpi";
-            oldfiles << "*.bak";
-            foreach (QString oldfile, home.entryList(oldfiles, QDir::Files)) {
-                QFile old(QString("%1/%2").arg(home.canonicalPath()).arg(oldfile));
-                old.remove();
-
+            if (step("v3oldfiles")) {
+                QStringList oldfiles;
+                oldfiles << "*.cpi";
+                oldfiles << "*.bak";
+                QStringList remove;
+                foreach (QString oldfile, home.entryList(oldfiles, QDir::Files))
+                    remove << QString("%1/%2").arg(home.canonicalPath()).arg(oldfile);
+                removeFiles(remove);
+                stepDone(home, "v3oldfiles");
             }
 
             // 2. Remove old CLucece 'index'
-            QFile index(QString("%1/index").arg(home.canonicalPath()));
-            if (index.exists()) {
-                removeIndex(index);
+            if (step("v3index")) {
+                QFile index(QString("%1/index").arg(home.canonicalPath()));
+                if (index.exists()) {
+                    removeIndex(index);
+                }
+                stepDone(home, "v3index");
             }
 
             // 3. Remove metricDBv3 - force rebuild including the search index
-            QFile db(QString("%1/metricDBv3").arg(home.canonicalPath()));
-            if (db.exists()) db.remove();
+            if (step("v3metricdb")) {
+                QFile db(QString("%1/metricDBv3").arg(home.canonicalPath()));
+                if (db.exists()) db.remove();
+                refresh = true;
+                stepDone(home, "v3metricdb");
+            }
 
             // 4. Set default weight to 75kg if currently zero
             double weight_ = appsettings->cvalue(home.dirName(), GC_WEIGHT, "75.0").toString().toDouble();
@@ -87,6 +149,7 @@ GcUpgrade::upgrade(const QDir &home)
 
             // FINALLY -- Set latest version - so only tries to upgrade once
             appsettings->setCValue(home.dirName(), GC_VERSION_USED, VERSION_LATEST);
+            appsettings->setCValue(home.dirName(), GC_UPGRADE_DONE, "");
         }
     }
 
@@ -36,14 +36,30 @@
 
 #define VERSION3_BUILD 3010
 
+// Each step of an upgrade is remembered as it completes, so if the upgrade
+// is interrupted the next open only does the steps that are left. Steps
+// that work through the files of the athlete do so on a pool of threads.
 class GcUpgrade
 {
 	public:
-        GcUpgrade() {}
+        GcUpgrade() : refresh(false) {}
         int upgrade(const QDir &home);
         static int version() { return VERSION_LATEST; }
         static QString versionString() { return VERSION_STRING; }
         void removeIndex(QFile&);
+
+        // the metrics were thrown away, rebuild them in the background
+        // rather than holding up the first open after the upgrade
+        bool refreshInBackground() const { return refresh; }
+
+    private:
+        bool refresh;
+
+        QStringList done; // steps completed so far
+        bool step(QString name) const { return !done.contains(name); } // still to do?
+        void stepDone(const QDir &home, QString name);
+
+        void removeFiles(const QStringList &files); // on the pool, with progress
 };
 
 #endif
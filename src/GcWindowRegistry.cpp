@@ -52,6 +52,7 @@
 #include "RideWindow.h"
 #include "DialWindow.h"
 #include "RealtimePlotWindow.h"
+#include "RiderGridWindow.h"
 #include "SpinScanPlotWindow.h"
 #include "WorkoutPlotWindow.h"
 #include "BingMap.h"
@@ -96,6 +97,7 @@ GcWindowRegistry::initialize()
     { VIEW_TRAIN, tr("Workout"),GcWindowTypes::WorkoutPlot },
     { VIEW_TRAIN, tr("Realtime"),GcWindowTypes::RealtimePlot },
     { VIEW_TRAIN, tr("Pedal Stroke"),GcWindowTypes::SpinScanPlot },
+    { VIEW_TRAIN, tr("Riders"),GcWindowTypes::RiderGrid },
     { VIEW_TRAIN, tr("Map"), GcWindowTypes::MapWindow },
     { VIEW_TRAIN, tr("StreetView"), GcWindowTypes::StreetViewWindow },
     { VIEW_TRAIN, tr("Video Player"),GcWindowTypes::VideoPlayer },
@@ -171,6 +173,7 @@ GcWindowRegistry::newGcWindow(GcWinID id, Context *context)
     case GcWindowTypes::RealtimeControls: returning = new GcWindow(); break;
     case GcWindowTypes::RealtimePlot: returning = new RealtimePlotWindow(context); break;
     case GcWindowTypes::SpinScanPlot: returning = new SpinScanPlotWindow(context); break;
+    case GcWindowTypes::RiderGrid: returning = new RiderGridWindow(context); break;
     case GcWindowTypes::WorkoutPlot: returning = new WorkoutPlotWindow(context); break;
     case GcWindowTypes::BingMap: returning = new BingMap(context); break;
     case GcWindowTypes::MapWindow: returning = new MapWindow(context); break;
@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "GcbRideFile.h"
+#include <QDataStream>
+
+#define GCB_MAGIC   0x47434231 // "GCB1"
+#define GCB_VERSION 1
+
+static int gcbFileReaderRegistered =
+    RideFileFactory::instance().registerReader(
+        "gcb", "GoldenCheetah Binary", new GcbFileReader());
+
+// the series we store and the resolution they are stored at,
+// the order here is the order of the blocks in the file
+static const struct {
+    RideFile::SeriesType series;
+    double scale;
+} gcbSeries[] = {
+    { RideFile::secs, 1000 },
+    { RideFile::km, 100000 },
+    { RideFile::watts, 10 },
+    { RideFile::nm, 100 },
+    { RideFile::cad, 10 },
+    { RideFile::kph, 1000 },
+    { RideFile::hr, 10 },
+    { RideFile::alt, 100 },
+    { RideFile::lat, 1e9 },
+    { RideFile::lon, 1e9 },
+    { RideFile::headwind, 1000 },
+    { RideFile::slope, 100 },
+    { RideFile::temp, 100 },
+    { RideFile::lrbalance, 100 },
+};
+static const int gcbSeriesCount = sizeof(gcbSeries) / sizeof(gcbSeries[0]);
+
+// adler-32, cheap and good enough to spot a truncated or damaged file
+static quint32
+checksum(const char *data, int len)
+{
+    quint32 a = 1, b = 0;
+    for (int i=0; i<len; i++) {
+        a = (a + (unsigned char)data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void
+putVarint(QByteArray &out, qint64 value)
+{
+    // zig-zag so small negative deltas stay small
+    quint64 v = (quint64(value) << 1) ^ quint64(value >> 63);
+    while (v >= 0x80) {
+        out.append(char((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.append(char(v));
+}
+
+static bool
+getVarint(const char *&p, const char *end, qint64 &value)
+{
+    quint64 v = 0;
+    int shift = 0;
+    while (p < end && shift < 64) {
+        unsigned char c = *p++;
+        v |= quint64(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            value = qint64(v >> 1) ^ -qint64(v & 1);
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+static double
+pointValue(const RideFilePoint *p, RideFile::SeriesType series)
+{
+    switch (series) {
+    case RideFile::secs : return p->secs;
+    case RideFile::km : return p->km;
+    case RideFile::watts : return p->watts;
+    case RideFile::nm : return p->nm;
+    case RideFile::cad : return p->cad;
+    case RideFile::kph : return p->kph;
+    case RideFile::hr : return p->hr;
+    case RideFile::alt : return p->alt;
+    case RideFile::lat : return p->lat;
+    case RideFile::lon : return p->lon;
+    case RideFile::headwind : return p->headwind;
+    case RideFile::slope : return p->slope;
+    case RideFile::temp : return p->temp;
+    case RideFile::lrbalance : return p->lrbalance;
+    default : return 0;
+    }
+}
+
+static void
+setPointValue(RideFilePoint &p, RideFile::SeriesType series, double value)
+{
+    switch (series) {
+    case RideFile::secs : p.secs = value; break;
+    case RideFile::km : p.km = value; break;
+    case RideFile::watts : p.watts = value; break;
+    case RideFile::nm : p.nm = value; break;
+    case RideFile::cad : p.cad = value; break;
+    case RideFile::kph : p.kph = value; break;
+    case RideFile::hr : p.hr = value; break;
+    case RideFile::alt : p.alt = value; break;
+    case RideFile::lat : p.lat = value; break;
+    case RideFile::lon : p.lon = value; break;
+    case RideFile::headwind : p.headwind = value; break;
+    case RideFile::slope : p.slope = value; break;
+    case RideFile::temp : p.temp = value; break;
+    case RideFile::lrbalance : p.lrbalance = value; break;
+    default : break;
+    }
+}
+
+static bool
+isPresent(const RideFile *ride, RideFile::SeriesType series)
+{
+    const RideFileDataPresent *present = ride->areDataPresent();
+    switch (series) {
+    case RideFile::secs : return true;
+    case RideFile::km : return present->km;
+    case RideFile::watts : return present->watts;
+    case RideFile::nm : return present->nm;
+    case RideFile::cad : return present->cad;
+    case RideFile::kph : return present->kph;
+    case RideFile::hr : return present->hr;
+    case RideFile::alt : return present->alt;
+    case RideFile::lat : return present->lat;
+    case RideFile::lon : return present->lon;
+    case RideFile::headwind : return present->headwind;
+    case RideFile::slope : return present->slope;
+    case RideFile::temp : return present->temp;
+    case RideFile::lrbalance : return present->lrbalance;
+    default : return false;
+    }
+}
+
+RideFile *
+GcbFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
+{
+    if (!file.open(QFile::ReadOnly)) {
+        errors << "unable to open file" + file.fileName();
+        return NULL;
+    }
+    QByteArray contents = file.readAll();
+    file.close();
+
+    // header is magic, version and payload length, trailer is the checksum
+    if (contents.size() < 16) {
+        errors << "truncated file" + file.fileName();
+        return NULL;
+    }
+    QDataStream header(contents);
+    quint32 magic, length, sum;
+    quint16 version, flags;
+    header >> magic >> version >> flags >> length;
+
+    if (magic != GCB_MAGIC || version > GCB_VERSION) {
+        errors << "not a GoldenCheetah binary file" + file.fileName();
+        return NULL;
+    }
+    if (quint32(contents.size()) != length + 16) {
+        errors << "truncated file" + file.fileName();
+        return NULL;
+    }
+    const char *payload = contents.constData() + 12;
+    QDataStream trailer(contents.mid(12 + length));
+    trailer >> sum;
+    if (sum != checksum(payload, length)) {
+        errors << "checksum mismatch" + file.fileName();
+        return NULL;
+    }
+
+    // metadata
+    QByteArray meta;
+    QByteArray samples;
+    QDataStream in(QByteArray::fromRawData(payload, length));
+    in.setVersion(QDataStream::Qt_4_6);
+    in >> meta >> samples;
+
+    RideFile *ride = new RideFile;
+    QDataStream m(meta);
+    m.setVersion(QDataStream::Qt_4_6);
+
+    QDateTime startTime;
+    double recIntSecs;
+    QString deviceType, id;
+    QMap<QString,QString> tags;
+    m >> startTime >> recIntSecs >> deviceType >> id >> tags >> ride->metricOverrides;
+    ride->setStartTime(startTime);
+    ride->setRecIntSecs(recIntSecs);
+    ride->setDeviceType(deviceType);
+    ride->setId(id);
+    QMap<QString,QString>::const_iterator t;
+    for (t = tags.constBegin(); t != tags.constEnd(); t++) ride->setTag(t.key(), t.value());
+
+    quint32 count;
+    m >> count;
+    for (quint32 i=0; i<count && m.status() == QDataStream::Ok; i++) {
+        double start, stop;
+        QString name;
+        m >> start >> stop >> name;
+        ride->addInterval(start, stop, name);
+    }
+    m >> count;
+    for (quint32 i=0; i<count && m.status() == QDataStream::Ok; i++) {
+        double start;
+        qint32 value;
+        QString name;
+        m >> start >> value >> name;
+        ride->addCalibration(start, value, name);
+    }
+    m >> count;
+    for (quint32 i=0; i<count && m.status() == QDataStream::Ok; i++) {
+        double watts, cad, hr;
+        m >> watts >> cad >> hr;
+        RideFilePoint p;
+        p.watts = watts;
+        p.cad = cad;
+        p.hr = hr;
+        ride->appendReference(p);
+    }
+
+    if (in.status() != QDataStream::Ok || m.status() != QDataStream::Ok) {
+        errors << "corrupt metadata" + file.fileName();
+        delete ride;
+        return NULL;
+    }
+
+    // samples, count and series mask then a block per series
+    const char *p = samples.constData();
+    const char *end = p + samples.size();
+    qint64 points, mask;
+    if (!getVarint(p, end, points) || !getVarint(p, end, mask) || points < 0) {
+        errors << "corrupt samples" + file.fileName();
+        delete ride;
+        return NULL;
+    }
+
+    QVector<RideFilePoint> rows(points);
+    for (int s=0; s<gcbSeriesCount; s++) {
+
+        if (!(mask & (1 << s))) continue;
+
+        qint64 value = 0, delta;
+        for (int i=0; i<rows.count(); i++) {
+            if (!getVarint(p, end, delta)) {
+                errors << "corrupt samples" + file.fileName();
+                delete ride;
+                return NULL;
+            }
+            value += delta;
+            setPointValue(rows[i], gcbSeries[s].series, value / gcbSeries[s].scale);
+        }
+    }
+
+    // temp defaults to noTemp when not recorded
+    bool temp = false;
+    for (int s=0; s<gcbSeriesCount; s++) {
+        if (!(mask & (1 << s))) continue;
+        ride->setDataPresent(gcbSeries[s].series, true);
+        if (gcbSeries[s].series == RideFile::temp) temp = true;
+    }
+    for (int i=0; i<rows.count(); i++) {
+        if (!temp) rows[i].temp = RideFile::noTemp;
+        ride->appendPoint(rows[i]);
+    }
+
+    return ride;
+}
+
+bool
+GcbFileReader::writeRideFile(Context *, const RideFile *ride, QFile &file) const
+{
+    // metadata via QDataStream, it is not big enough to be worth packing
+    QByteArray meta;
+    QDataStream m(&meta, QIODevice::WriteOnly);
+    m.setVersion(QDataStream::Qt_4_6);
+
+    m << ride->startTime() << ride->recIntSecs() << ride->deviceType() << ride->id()
+      << ride->tags() << ride->metricOverrides;
+
+    m << quint32(ride->intervals().count());
+    foreach (RideFileInterval i, ride->intervals()) m << i.start << i.stop << i.name;
+
+    m << quint32(ride->calibrations().count());
+    foreach (RideFileCalibration i, ride->calibrations()) m << i.start << qint32(i.value) << i.name;
+
+    m << quint32(ride->referencePoints().count());
+    foreach (RideFilePoint *p, ride->referencePoints()) m << p->watts << p->cad << p->hr;
+
+    // samples, a block per series with each value a delta from the last
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+    QByteArray samples;
+    samples.reserve(points.count() * 8);
+
+    qint64 mask = 0;
+    for (int s=0; s<gcbSeriesCount; s++)
+        if (isPresent(ride, gcbSeries[s].series)) mask |= (1 << s);
+
+    putVarint(samples, points.count());
+    putVarint(samples, mask);
+
+    for (int s=0; s<gcbSeriesCount; s++) {
+
+        if (!(mask & (1 << s))) continue;
+
+        qint64 last = 0;
+        foreach (const RideFilePoint *p, points) {
+            qint64 value = qRound64(pointValue(p, gcbSeries[s].series) * gcbSeries[s].scale);
+            putVarint(samples, value - last);
+            last = value;
+        }
+    }
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_6);
+    out << meta << samples;
+
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.resize(0);
+
+    QDataStream header(&file);
+    header << quint32(GCB_MAGIC) << quint16(GCB_VERSION) << quint16(0) << quint32(payload.size());
+    header.writeRawData(payload.constData(), payload.size());
+    header << checksum(payload.constData(), payload.size());
+
+    file.close();
+    return true;
+}
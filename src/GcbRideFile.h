@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GcbRideFile_h
+#define _GcbRideFile_h
+#include "GoldenCheetah.h"
+
+#include "RideFile.h"
+
+// A compact binary alternative to the native .json format. The file is
+// a small header, the ride metadata (tags, overrides, intervals, calibrations
+// and reference points), then one block per series present with each sample
+// stored as a zig-zag varint delta from the one before it, and a checksum over
+// the lot. Samples are quantised to a fixed resolution per series, which is
+// finer than the precision the .json writer already uses.
+//
+// The native format used when saving is chosen with GC_NATIVE_FORMAT, rides
+// are migrated as they are saved and can still be exported as .json.
+struct GcbFileReader : public RideFileReader {
+    virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const;
+    bool writeRideFile(Context *, const RideFile *ride, QFile &file) const;
+    bool hasWrite() const { return true; }
+};
+
+#endif // _GcbRideFile_h
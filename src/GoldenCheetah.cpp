@@ -653,7 +653,7 @@ GcWindow::_closeWindow()
     emit closeWindow(this);
 }
 
-GcChartWindow::GcChartWindow(Context *context) : GcWindow(context) {
+GcChartWindow::GcChartWindow(Context *context) : GcWindow(context), _isBlank(false), _isLoading(false), _pending(NULL), _running(NULL) {
     //
     // Default layout
     //
@@ -667,7 +667,12 @@ GcChartWindow::GcChartWindow(Context *context) : GcWindow(context) {
     _blank = new QWidget(this);
     _blank->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 
+    _loading = new QLabel(tr("Loading..."), this);
+    _loading->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    _loading->setAlignment(Qt::AlignCenter);
+
     _layout->addWidget(_blank);
+    _layout->addWidget(_loading);
     _layout->addWidget(_mainWidget);
     _layout->setCurrentWidget(_mainWidget);
 
@@ -731,6 +736,67 @@ GcChartWindow::GcChartWindow(Context *context) : GcWindow(context) {
     _defaultBlankLayout->addWidget(blankLabel);
     _defaultBlankLayout->addStretch();
     _blank->setLayout(_defaultBlankLayout);
+
+    // data preparation is debounced by this
+    _prepareTimer = new QTimer(this);
+    _prepareTimer->setSingleShot(true);
+    connect(_prepareTimer, SIGNAL(timeout()), this, SLOT(_startPrepare()));
+}
+
+GcChartWindow::~GcChartWindow()
+{
+    // don't leave it running, it may be just about to finish
+    delete _pending;
+    if (_running) {
+        _running->setCancelled();
+        _running->wait();
+        delete _running;
+    }
+}
+
+void
+GcChartWindow::requestPrepare(GcChartPrepare *work, int delay)
+{
+    cancelPrepare();
+    _pending = work;
+    _prepareTimer->start(delay);
+}
+
+void
+GcChartWindow::cancelPrepare()
+{
+    _prepareTimer->stop();
+    delete _pending;
+    _pending = NULL;
+    if (_running) _running->setCancelled();
+}
+
+void
+GcChartWindow::_startPrepare()
+{
+    // still busy giving up on the last one, we
+    // get going again when it has finished
+    if (!_pending || _running) return;
+
+    _running = _pending;
+    _pending = NULL;
+    connect(_running, SIGNAL(finished()), this, SLOT(_prepareFinished()));
+    _running->start();
+}
+
+void
+GcChartWindow::_prepareFinished()
+{
+    GcChartPrepare *done = static_cast<GcChartPrepare*>(sender());
+    if (done != _running) return;
+    _running = NULL;
+
+    // superseded results are never shown
+    if (!done->cancelled()) prepared(done);
+    done->deleteLater();
+
+    // one came in whilst this was cancelling
+    if (_pending && !_prepareTimer->isActive()) _startPrepare();
 }
 
 void
@@ -757,7 +823,15 @@ GcChartWindow:: setBlankLayout(QLayout *layout)
 void
 GcChartWindow:: setIsBlank(bool value)
 {
-    _layout->setCurrentWidget(value?_blank:_mainWidget);
+    _isBlank = value;
+    if (!_isLoading) _layout->setCurrentWidget(value?_blank:_mainWidget);
+}
+
+void
+GcChartWindow:: setIsLoading(bool value)
+{
+    _isLoading = value;
+    _layout->setCurrentWidget(value ? _loading : (_isBlank ? _blank : _mainWidget));
 }
 
 void
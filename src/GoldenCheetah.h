@@ -38,6 +38,8 @@ class Context;
 #include <QVariant>
 #include <QMetaType>
 #include <QFrame>
+#include <QThread>
+#include <QAtomicInt>
 #include <QtGui>
 
 #include "GcWindowRegistry.h"
@@ -197,6 +199,27 @@ public:
     QMenu *menu;
 };
 
+// The data preparation for a chart, run off the GUI thread by
+// GcChartWindow::requestPrepare. Subclass it with the inputs (taken
+// as snapshots on the GUI thread, e.g. copies of RideFile::seriesData)
+// and the results; prepare() runs on a worker and should give up when
+// cancelled() says a newer request has superseded it.
+class GcChartPrepare : public QThread
+{
+    public:
+        GcChartPrepare() : cancel(0) {}
+
+        virtual void prepare() = 0;
+        bool cancelled() const { return int(cancel) != 0; }
+        void setCancelled() { cancel.fetchAndStoreOrdered(1); }
+
+    protected:
+        void run() { prepare(); }
+
+    private:
+        QAtomicInt cancel;
+};
+
 class GcChartWindow : public GcWindow
 {
 private:
@@ -213,6 +236,8 @@ private:
 
     QWidget *_mainWidget;
     QWidget *_blank;
+    QLabel *_loading;
+    bool _isBlank, _isLoading;
     QWidget *_chart;
 
     // reveal controls
@@ -227,8 +252,13 @@ private:
     void reveal();
     void unreveal();
 
+    // asynchronous preparation, at most one running and one waiting
+    QTimer *_prepareTimer;
+    GcChartPrepare *_pending, *_running;
+
 public:
     GcChartWindow(Context *context);
+    ~GcChartWindow();
 
     QWidget *mainWidget() { return _mainWidget; }
 
@@ -237,9 +267,24 @@ public:
     void setBlankLayout(QLayout *layout);
 
     void setIsBlank(bool value);
+    void setIsLoading(bool value); // whilst the ride is read, see RideItem::requestRide()
+
+protected:
+    // hand over work to run on a worker after delay ms, replacing any
+    // that is waiting and cancelling any that is running, so arrowing
+    // through rides only prepares the one we stop on. The results come
+    // back to prepared() on the GUI thread, for the latest request only,
+    // and the work is deleted afterwards.
+    void requestPrepare(GcChartPrepare *work, int delay = 100);
+    void cancelPrepare();
+    virtual void prepared(GcChartPrepare *) {}
 
 public slots:
     void hideRevealControls();
+
+private slots:
+    void _startPrepare();
+    void _prepareFinished();
 };
 
 
@@ -23,6 +23,7 @@
 #include "RideItem.h"
 #include "RideFile.h"
 #include "IntervalItem.h"
+#include "IntervalOverlay.h"
 #include "Context.h"
 #include "Athlete.h"
 #include "Zones.h"
@@ -30,13 +31,23 @@
 #include "Colors.h"
 #include "Units.h"
 #include "TimeUtils.h"
+#include "MetricAggregator.h"
+#include "Heatmap.h"
 
 #include <QDebug>
 
 GoogleMapControl::GoogleMapControl(Context *context) : GcChartWindow(context), context(context), range(-1), current(NULL)
 {
     setInstanceName("Google Map");
-    setControls(NULL);
+
+    QWidget *c = new QWidget;
+    QFormLayout *cl = new QFormLayout(c);
+    cl->setContentsMargins(5,5,5,5);
+    setControls(c);
+
+    showHeatmap = new QCheckBox(tr("Show where all rides went"));
+    showHeatmap->setChecked(false);
+    cl->addRow(new QLabel(tr("Heatmap")), showHeatmap);
     setContentsMargins(0,0,0,0);
     layout = new QVBoxLayout();
     layout->setSpacing(0);
@@ -61,6 +72,7 @@ GoogleMapControl::GoogleMapControl(Context *context) : GcChartWindow(context), c
     connect(context, SIGNAL(intervalsChanged()), webBridge, SLOT(intervalsChanged()));
     connect(context, SIGNAL(intervalSelected()), webBridge, SLOT(intervalsChanged()));
     connect(context, SIGNAL(intervalZoom(IntervalItem*)), this, SLOT(zoomInterval(IntervalItem*)));
+    connect(showHeatmap, SIGNAL(toggled(bool)), this, SLOT(setShowHeatmap(bool)));
 
     first = true;
 }
@@ -94,6 +106,18 @@ GoogleMapControl::rideSelected()
     loadRide();
 }
 
+void
+GoogleMapControl::setShowHeatmap(bool show)
+{
+    if (showHeatmap->isChecked() != show) {
+        showHeatmap->setChecked(show); // calls us back
+        return;
+    }
+
+    // redraw with or without it
+    if (current && amVisible()) loadRide();
+}
+
 void GoogleMapControl::loadRide()
 {
     createHtml();
@@ -102,6 +126,7 @@ void GoogleMapControl::loadRide()
 
 void GoogleMapControl::updateFrame()
 {
+    webBridge->reset();
     view->page()->mainFrame()->addToJavaScriptWindowObject("webBridge", webBridge);
 }
 
@@ -187,28 +212,27 @@ void GoogleMapControl::createHtml()
     "        zIndex: -1\n"  // put at the bottom
     "    }\n"
 
-    // remove previous intervals highlighted
-    "    j= intervalList.length;\n"
-    "    while (j) {\n"
-    "       var highlighted = intervalList.pop();\n"
-    "       highlighted.setMap(null);\n"
-    "       j--;\n"
-    "    }\n"
+    // only those that changed since last time, the list
+    // is indexed by interval number, removals come first
+    "    var changes = webBridge.changedIntervals();\n"
+    "    for (var k=0; k<changes.length; k += 2) {\n"
+    "        var n = changes[k];\n"
+    "        if (intervalList[n]) {\n"
+    "            intervalList[n].setMap(null);\n"
+    "            intervalList[n] = null;\n"
+    "        }\n"
+    "        if (!changes[k+1]) continue;\n"
 
-    // how many to draw?
-    "    var intervals = webBridge.intervalCount();\n"
-    "    while (intervals > 0) {\n"
-    "        var latlons = webBridge.getLatLons(intervals);\n"
+    "        var latlons = webBridge.intervalLatLons(n);\n"
     "        var intervalHighlighter = new google.maps.Polyline(polyOptions);\n"
     "        intervalHighlighter.setMap(map);\n"
-    "        intervalList.push(intervalHighlighter);\n"
+    "        intervalList[n] = intervalHighlighter;\n"
     "        var path = intervalHighlighter.getPath();\n"
     "        var j=0;\n"
     "        while (j<latlons.length) {\n"
     "          path.push(new google.maps.LatLng(latlons[j], latlons[j+1]));\n"
     "          j += 2;\n"
     "        }\n"
-    "        intervals--;\n"
     "    }\n"
     "}\n"
 
@@ -242,6 +266,21 @@ void GoogleMapControl::createHtml()
     "    var bikeLayer = new google.maps.BicyclingLayer();\n"
     "    bikeLayer.setMap(map);\n"
 
+    // where all the rides went, the tiles are drawn by the webbridge
+    // from the counts kept as rides are imported, null for none
+    "    if (webBridge.showHeatmap()) {\n"
+    "        var heatmap = new google.maps.ImageMapType({\n"
+    "            getTileUrl: function(coord, zoom) {\n"
+    "                var n = 1 << zoom;\n"
+    "                var url = webBridge.heatmapTile(((coord.x % n) + n) % n, coord.y, zoom);\n"
+    "                return url ? url : null;\n"
+    "            },\n"
+    "            tileSize: new google.maps.Size(256, 256),\n"
+    "            opacity: 0.8\n"
+    "        });\n"
+    "        map.overlayMapTypes.push(heatmap);\n"
+    "    }\n"
+
     // initialise local variables
     "    markerList = new Array();\n"
     "    intervalList = new Array();\n"
@@ -291,16 +330,26 @@ GoogleMapControl::drawShadedRoute()
     double prevtime=0; // time for previous point
 
     QString code;
+    QStringList latlons; // packed into an array for each segment
 
-    foreach(RideFilePoint *rfp, myRideItem->ride()->dataPoints()) {
+    route.set(myRideItem->ride());
+    const QVector<RideFilePoint*> &points = myRideItem->ride()->dataPoints();
+
+    for (int i=0; i<points.count(); i++) {
+        RideFilePoint *rfp = points[i];
 
         if (count == 0) {
             code = QString("{\nvar polyline = new google.maps.Polyline();\n"
                    "   polyline.setMap(map);\n"
                    "   path = polyline.getPath();\n");
-        } else {
-            if (rfp->lat || rfp->lon)
-                code += QString("path.push(new google.maps.LatLng(%1,%2));\n").arg(rfp->lat,0,'g',GPS_COORD_TO_STRING).arg(rfp->lon,0,'g',GPS_COORD_TO_STRING);
+            latlons.clear();
+        }
+
+        // the simplified route, but segments always start and end on
+        // a sample so they join up
+        if (rfp->lat || rfp->lon) {
+            if (count == 0 || route.keep(i) || rtime + rfp->secs - prevtime >= intervalTime)
+                latlons << QString("%1,%2").arg(rfp->lat,0,'g',GPS_COORD_TO_STRING).arg(rfp->lon,0,'g',GPS_COORD_TO_STRING);
         }
 
         // running total of time
@@ -318,6 +367,10 @@ GoogleMapControl::drawShadedRoute()
             // add tooltip junk
             count = rwatts = rtime = 0;
 
+            // add the points
+            code += QString("var latlons = [%1];\n"
+                            "for (var j=0; j<latlons.length; j+=2) path.push(new google.maps.LatLng(latlons[j],latlons[j+1]));\n").arg(latlons.join(","));
+
             // color the polyline
             code += QString("var polyOptions = {\n"
                             "    strokeColor: '%1',\n"
@@ -526,22 +579,13 @@ void WebBridge::call(int count) { qDebug()<<"webBridge call:"<<count; }
 int
 WebBridge::intervalCount()
 {
-    int highlighted;
-    highlighted = 0;
     RideItem *rideItem = gm->property("ride").value<RideItem*>();
 
     if (context->athlete->allIntervalItems() == NULL ||
         rideItem == NULL || rideItem->ride() == NULL) return 0; // not inited yet!
 
-    for (int i=0; i<context->athlete->allIntervalItems()->childCount(); i++) {
-        IntervalItem *current = dynamic_cast<IntervalItem *>(context->athlete->allIntervalItems()->child(i));
-        if (current != NULL) {
-            if (current->isSelected() == true) {
-                ++highlighted;
-            }
-        }
-    }
-    return highlighted;
+    context->athlete->intervalOverlay->refresh();
+    return context->athlete->intervalOverlay->selected().count();
 }
 
 // get a latlon array for the i'th selected interval
@@ -549,54 +593,84 @@ QVariantList
 WebBridge::getLatLons(int i)
 {
     QVariantList latlons;
-    int highlighted=0;
     RideItem *rideItem = gm->property("ride").value<RideItem*>();
 
     if (context->athlete->allIntervalItems() == NULL ||
        rideItem ==NULL || rideItem->ride() == NULL) return latlons; // not inited yet!
 
+    // simplified once per ride
+    gm->route.set(rideItem->ride());
+
     if (i) {
 
         // get for specific interval
-        for (int j=0; j<context->athlete->allIntervalItems()->childCount(); j++) {
-            IntervalItem *current = dynamic_cast<IntervalItem *>(context->athlete->allIntervalItems()->child(j));
-            if (current != NULL) {
-                if (current->isSelected() == true) {
-                    ++highlighted;
-
-                    // this one!
-                    if (highlighted==i) {
-
-                        // so this one is the interval we need.. lets
-                        // snaffle up the points in this section
-                        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-                            if (p1->secs+rideItem->ride()->recIntSecs() > current->start
-                                && p1->secs< current->stop) {
-
-                                if (p1->lat || p1->lon) {
-                                    latlons << p1->lat;
-                                    latlons << p1->lon;
-                                }
-                            }
-                        }
-                        return latlons;
-                    }
-                }
-            }
+        IntervalOverlay *overlay = context->athlete->intervalOverlay;
+        overlay->refresh();
+        if (i <= overlay->selected().count()) {
+            const IntervalOverlay::Interval &current = overlay->at(overlay->selected()[i-1]);
+            latlons = gm->route.latlons(current.start, current.stop);
         }
     } else {
 
         // get latlons for entire route
-        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-            if (p1->lat || p1->lon) {
-                latlons << p1->lat;
-                latlons << p1->lon;
-            }
-        }
+        latlons = gm->route.latlons();
     }
     return latlons;
 }
 
+// compare the selection with what has been drawn, when the intervals
+// themselves have changed everything drawn goes and we start again
+QVariantList
+WebBridge::changedIntervals()
+{
+    QVariantList changes;
+    RideItem *rideItem = gm->property("ride").value<RideItem*>();
+
+    if (context->athlete->allIntervalItems() == NULL ||
+       rideItem ==NULL || rideItem->ride() == NULL) return changes; // not inited yet!
+
+    IntervalOverlay *overlay = context->athlete->intervalOverlay;
+    overlay->refresh();
+
+    if (overlay->generation() != drawnGeneration) {
+        for (int i=0; i<drawn.count(); i++) if (drawn[i]) changes << i << false;
+        drawn.fill(false, overlay->count());
+        intervalPoints.clear();
+        drawnGeneration = overlay->generation();
+    }
+
+    for (int i=0; i<overlay->count(); i++) {
+        if (drawn[i] && !overlay->at(i).selected) {
+            changes << i << false;
+            drawn[i] = false;
+        }
+    }
+    for (int i=0; i<overlay->count(); i++) {
+        if (!drawn[i] && overlay->at(i).selected) {
+            changes << i << true;
+            drawn[i] = true;
+        }
+    }
+    return changes;
+}
+
+// the points for an interval, kept until the intervals change
+QVariantList
+WebBridge::intervalLatLons(int index)
+{
+    RideItem *rideItem = gm->property("ride").value<RideItem*>();
+    IntervalOverlay *overlay = context->athlete->intervalOverlay;
+
+    if (rideItem == NULL || rideItem->ride() == NULL || index < 0 || index >= overlay->count())
+        return QVariantList();
+
+    if (!intervalPoints.contains(index)) {
+        gm->route.set(rideItem->ride());
+        intervalPoints.insert(index, gm->route.latlons(overlay->at(index).start, overlay->at(index).stop));
+    }
+    return intervalPoints.value(index);
+}
+
 // once the basic map and route have been marked, overlay markers, shaded areas etc
 void
 WebBridge::drawOverlays()
@@ -608,6 +682,22 @@ WebBridge::drawOverlays()
     gm->drawShadedRoute();
 }
 
+bool
+WebBridge::showHeatmap()
+{
+    return gm->isShowHeatmap() && context->athlete->metricDB != NULL;
+}
+
+QString
+WebBridge::heatmapTile(int x, int y, int zoom)
+{
+    if (!showHeatmap()) return "";
+
+    QByteArray png = context->athlete->metricDB->heatmap()->png(zoom, x, y);
+    if (png.isEmpty()) return "";
+    return QString("data:image/png;base64,") + png.toBase64();
+}
+
 // interval marker was clicked on the map, toggle its display
 void
 WebBridge::toggleInterval(int x)
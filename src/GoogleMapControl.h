@@ -29,6 +29,7 @@
 #include "RideFile.h"
 #include "IntervalItem.h"
 #include "Context.h"
+#include "SimplifiedRoute.h"
 
 class QMouseEvent;
 class RideItem;
@@ -57,8 +58,17 @@ class WebBridge : public QObject
         Context *context;
         GoogleMapControl *gm;
 
+        // what the page has drawn, the intervals are numbered as
+        // the overlay numbered them when they were drawn
+        QVector<bool> drawn;
+        int drawnGeneration;
+        QHash<int, QVariantList> intervalPoints;
+
     public:
-        WebBridge(Context *context, GoogleMapControl *gm) : context(context), gm(gm) {}
+        WebBridge(Context *context, GoogleMapControl *gm) : context(context), gm(gm), drawnGeneration(-1) {}
+
+        // the page has been loaded again so nothing is drawn
+        void reset() { drawn.clear(); intervalPoints.clear(); drawnGeneration = -1; }
 
     public slots:
         Q_INVOKABLE void call(int count);
@@ -67,6 +77,11 @@ class WebBridge : public QObject
         Q_INVOKABLE int intervalCount();
         Q_INVOKABLE QVariantList getLatLons(int i); // get array of latitudes for highlighted n
 
+        // the intervals to remove or draw since we last asked, as pairs of
+        // interval number and whether it is selected, removals first
+        Q_INVOKABLE QVariantList changedIntervals();
+        Q_INVOKABLE QVariantList intervalLatLons(int index);
+
         // once map and basic route is loaded
         // this slot is called to draw additional
         // overlays e.g. shaded route, markers
@@ -74,6 +89,10 @@ class WebBridge : public QObject
 
         // display/toggle interval on map
         Q_INVOKABLE void toggleInterval(int);
+
+        // the all rides heatmap overlay, tiles are data: urls
+        Q_INVOKABLE bool showHeatmap();
+        Q_INVOKABLE QString heatmapTile(int x, int y, int zoom);
         void intervalsChanged() { emit drawIntervals(); }
 
     signals:
@@ -85,13 +104,19 @@ class GoogleMapControl : public GcChartWindow
     Q_OBJECT
     G_OBJECT
 
+    Q_PROPERTY(bool heatmap READ isShowHeatmap WRITE setShowHeatmap USER true)
+
     public:
         GoogleMapControl(Context *);
         ~GoogleMapControl();
         bool first;
+        SimplifiedRoute route; // used by the webbridge too
+
+        bool isShowHeatmap() const { return showHeatmap->isChecked(); }
 
     public slots:
         void rideSelected();
+        void setShowHeatmap(bool);
         void createMarkers();
         void drawShadedRoute();
         void zoomInterval(IntervalItem*);
@@ -106,6 +131,7 @@ class GoogleMapControl : public GcChartWindow
         int rideCP; // rider's CP
         QString currentPage;
         RideItem *current;
+        QCheckBox *showHeatmap;
 
         QColor GetColor(int watts);
         void createHtml();
@@ -27,9 +27,6 @@
 #include "TimeUtils.h"
 #include <math.h>
 
-// use stc strtod to bypass Qt toDouble() issues
-#include <stdlib.h>
-
 GpxParser::GpxParser (RideFile* rideFile)
     : rideFile(rideFile)
 {
@@ -61,17 +58,17 @@ bool GpxParser::startElement( const QString&, const QString&,
     if(metadata)
         return true;
 
-    if(qName == "metadata")
+    if(qName == QLatin1String("metadata"))
     {
         metadata = true;
 
     }
-    else if(qName == "trkpt")
+    else if(qName == QLatin1String("trkpt"))
     {
         int i = qAttributes.index("lat");
         if(i >= 0)
         {
-            lat = qAttributes.value(i).toDouble();
+            lat = xmlDouble(qAttributes.value(i));
         }
         else
         {
@@ -80,7 +77,7 @@ bool GpxParser::startElement( const QString&, const QString&,
         i = qAttributes.index("lon");
         if( i >= 0)
         {
-            lon = qAttributes.value(i).toDouble();
+            lon = xmlDouble(qAttributes.value(i));
         }
         else
         {
@@ -100,7 +97,7 @@ inline double toRadians(double degrees)
 bool
         GpxParser::endElement( const QString&, const QString&, const QString& qName)
 {
-    if(qName == "metadata")
+    if(qName == QLatin1String("metadata"))
     {
         metadata = false;
     }
@@ -108,10 +105,10 @@ bool
     {
         return true;
     }
-    else if (qName == "time")
+    else if (qName == QLatin1String("time"))
     {
 
-        time = convertToLocalTime(buffer);
+        time = timestamps.toLocal(buffer);
         if(firstTime)
         {
             start_time = time;
@@ -119,33 +116,33 @@ bool
             firstTime = false;
         }
     }
-    else if (qName == "ele")
+    else if (qName == QLatin1String("ele"))
     {
-        alt = buffer.toDouble();  // metric
+        alt = xmlDouble(buffer);  // metric
     }
-    else if (qName == "gpxtpx:hr")
+    else if (qName == QLatin1String("gpxtpx:hr"))
     {
         hr = buffer.toInt();
     }
-    else if (qName == "gpxdata:hr")
+    else if (qName == QLatin1String("gpxdata:hr"))
     {
-        hr = buffer.toDouble(); // on suunto ambit export file, there are sometimes double values
+        hr = xmlDouble(buffer); // on suunto ambit export file, there are sometimes double values
     }
-    else if (qName == "gpxdata:temp")
+    else if (qName == QLatin1String("gpxdata:temp"))
     {
-        temp = buffer.toDouble();
+        temp = xmlDouble(buffer);
     }
-    else if (qName == "gpxdata:cadence")
+    else if (qName == QLatin1String("gpxdata:cadence"))
     {
-        cad = buffer.toDouble();
+        cad = xmlDouble(buffer);
     }
-    else if (qName == "gpxdata:bikepower") // hopefully suunto adds bikepower data to gpx export file, as it is on saved moveslink log_.xml
+    else if (qName == QLatin1String("gpxdata:bikepower")) // hopefully suunto adds bikepower data to gpx export file, as it is on saved moveslink log_.xml
     {
-        watts = buffer.toDouble();
+        watts = xmlDouble(buffer);
     }
 
 
-    else if (qName == "trkpt")
+    else if (qName == QLatin1String("trkpt"))
     {
         if(lastLon == 0)
         {
@@ -28,6 +28,7 @@
 #include <QDateTime>
 #include <QXmlDefaultHandler>
 #include "Settings.h"
+#include "XmlValues.h"
 
 class GpxParser : public QXmlDefaultHandler
 {
@@ -45,6 +46,7 @@ private:
     RideFile*   rideFile;
 
     QString     buffer;
+    XmlTimeStamp timestamps;
     QVariant    isGarminSmartRecording;
     QVariant    GarminHWM;
 
@@ -21,6 +21,9 @@
 
 #include "GpxRideFile.h"
 #include "GpxParser.h"
+#include "TrackSimplifier.h"
+
+#include <QXmlStreamWriter>
 
 static int tcxFileReaderRegistered =
     RideFileFactory::instance().registerReader(
@@ -43,3 +46,61 @@ RideFile *GpxFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
 
     return rideFile;
 }
+
+//
+// Written as the points are visited, with heartrate and cadence
+// in the garmin track point extension that the parser reads back
+//
+bool
+GpxFileReader::writeRideFile(Context *, const RideFile *ride, QFile &file) const
+{
+    if (!file.open(QIODevice::WriteOnly)) return(false);
+
+    QVector<bool> keep = TrackSimplifier::keep(ride, TrackSimplifier::exportTolerance());
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+    bool hr = ride->areDataPresent()->hr;
+    bool cad = ride->areDataPresent()->cad;
+
+    QXmlStreamWriter xml(&file);
+    xml.setAutoFormatting(true);
+    xml.writeStartDocument();
+    xml.writeStartElement("gpx");
+    xml.writeDefaultNamespace("http://www.topografix.com/GPX/1/1");
+    xml.writeNamespace("http://www.garmin.com/xmlschemas/TrackPointExtension/v1", "gpxtpx");
+    xml.writeAttribute("version", "1.1");
+    xml.writeAttribute("creator", "GoldenCheetah");
+
+    xml.writeStartElement("metadata");
+    xml.writeTextElement("time", ride->startTime().toUTC().toString("yyyy-MM-dd'T'hh:mm:ss'Z'"));
+    xml.writeEndElement();
+
+    xml.writeStartElement("trk");
+    xml.writeStartElement("trkseg");
+    for (int i=0; i<points.count(); i++) {
+        if (!keep[i]) continue;
+        const RideFilePoint *p = points[i];
+
+        xml.writeStartElement("trkpt");
+        xml.writeAttribute("lat", QString::number(p->lat, 'f', 7));
+        xml.writeAttribute("lon", QString::number(p->lon, 'f', 7));
+        xml.writeTextElement("ele", QString::number(p->alt));
+        xml.writeTextElement("time", ride->startTime().addSecs(p->secs).toUTC().toString("yyyy-MM-dd'T'hh:mm:ss'Z'"));
+        if (hr || cad) {
+            xml.writeStartElement("extensions");
+            xml.writeStartElement("gpxtpx:TrackPointExtension");
+            if (hr) xml.writeTextElement("gpxtpx:hr", QString::number(int(p->hr)));
+            if (cad) xml.writeTextElement("gpxtpx:cad", QString::number(int(p->cad)));
+            xml.writeEndElement();
+            xml.writeEndElement();
+        }
+        xml.writeEndElement(); // trkpt
+    }
+    xml.writeEndElement(); // trkseg
+    xml.writeEndElement(); // trk
+    xml.writeEndElement(); // gpx
+    xml.writeEndDocument();
+
+    bool ok = !xml.hasError();
+    file.close();
+    return(ok);
+}
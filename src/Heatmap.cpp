@@ -0,0 +1,385 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Heatmap.h"
+#include "RideFile.h"
+#include "Context.h"
+#include "Athlete.h"
+
+#include <QFile>
+#include <QBuffer>
+#include <QImage>
+#include <QPointF>
+#include <QTextStream>
+#include <QMutexLocker>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// a jump further than this between samples, in maxZoom pixels (about
+// 2km at the equator), is a gap in recording or a GPS glitch and isn't
+// drawn as somewhere ridden
+static const double maxJump = 400;
+
+// loaded tiles are 128KB each, we write them out and start
+// again rather than hold more than this many
+static const int maxTiles = 512;
+
+// pixels are zoom:x:y, with x and y as pixels across the world at
+// that zoom, and tiles are zoom:x:y in tiles
+static inline quint64 pixelKey(quint64 zoom, quint64 x, quint64 y) { return (zoom << 50) | (x << 25) | y; }
+static inline quint64 tileKey(quint64 zoom, quint64 x, quint64 y) { return (zoom << 40) | (x << 20) | y; }
+
+Heatmap::Heatmap(Context *context) : context(context), stale(false), rebuilding(false), pngs(16 * 1024 * 1024)
+{
+    dir = QDir(context->athlete->home.absolutePath() + "/heatmap");
+    if (!dir.exists()) dir.mkpath(dir.absolutePath());
+
+    maxCount.fill(0, maxZoom + 1);
+    readIndex();
+}
+
+Heatmap::~Heatmap()
+{
+    flush();
+}
+
+QVector<quint64>
+Heatmap::rasterize(const RideFile *ride)
+{
+    QVector<quint64> returning;
+    if (!ride || !ride->areDataPresent()->lat || !ride->areDataPresent()->lon) return returning;
+
+    // the track as pixels across the world at maxZoom
+    double world = double(tileSize) * double(1 << maxZoom);
+    QVector<QPointF> track;
+    foreach(const RideFilePoint *p, ride->dataPoints()) {
+        if ((!p->lat && !p->lon) || p->lat < -85 || p->lat > 85) continue;
+
+        double sinlat = sin(p->lat * M_PI / 180.0);
+        track << QPointF((p->lon + 180.0) / 360.0 * world,
+                         (0.5 - log((1.0 + sinlat) / (1.0 - sinlat)) / (4.0 * M_PI)) * world);
+    }
+    if (track.isEmpty()) return returning;
+
+    // each level draws the track as a line, pixels are only counted
+    // once however often the ride goes through them
+    QSet<quint64> pixels;
+    for (int zoom=minZoom; zoom <= maxZoom; zoom++) {
+
+        double shrink = double(1 << (maxZoom - zoom));
+        double last = world / shrink - 1;
+
+        for (int i=0; i<track.count(); i++) {
+            QPointF from = track[i > 0 ? i-1 : 0], to = track[i];
+
+            double length = qMax(fabs(to.x() - from.x()), fabs(to.y() - from.y()));
+            if (length > maxJump) from = to;
+            from /= shrink;
+            to /= shrink;
+
+            int steps = ceil(qMax(fabs(to.x() - from.x()), fabs(to.y() - from.y())));
+            for (int s=0; s <= steps; s++) {
+                double t = steps ? double(s) / steps : 1.0;
+                double x = qBound(0.0, from.x() + (to.x() - from.x()) * t, last);
+                double y = qBound(0.0, from.y() + (to.y() - from.y()) * t, last);
+                pixels.insert(pixelKey(zoom, quint64(x), quint64(y)));
+            }
+        }
+    }
+
+    returning.reserve(pixels.count());
+    foreach(quint64 pixel, pixels) returning << pixel;
+    qSort(returning);
+    return returning;
+}
+
+void
+Heatmap::add(QString filename, const QVector<quint64> &pixels, bool samplesChanged)
+{
+    QMutexLocker locker(&lock);
+    if (rides.contains(filename)) {
+        if (samplesChanged && !stale) {
+            stale = true;
+            writeIndex();
+        }
+        return;
+    }
+    include(filename, pixels);
+}
+
+void
+Heatmap::remove(QString filename)
+{
+    QMutexLocker locker(&lock);
+    if (rides.contains(filename) && !stale) {
+        stale = true;
+        writeIndex();
+    }
+}
+
+bool
+Heatmap::include(QString filename, const QVector<quint64> &pixels)
+{
+    if (rides.contains(filename)) return false;
+    rides.insert(filename);
+
+    quint64 current = ~quint64(0);
+    QVector<quint16> *counts = NULL;
+    foreach(quint64 pixel, pixels) {
+
+        quint64 zoom = pixel >> 50;
+        quint64 x = (pixel >> 25) & 0x1ffffff;
+        quint64 y = pixel & 0x1ffffff;
+
+        quint64 key = tileKey(zoom, x / tileSize, y / tileSize);
+        if (key != current) {
+            current = key;
+            counts = tile(key, true);
+            dirty.insert(key);
+        }
+
+        quint16 &count = (*counts)[(y % tileSize) * tileSize + (x % tileSize)];
+        if (count < 65535) count++;
+        if (count > maxCount[zoom]) maxCount[zoom] = count;
+    }
+
+    // the colours are relative to the busiest pixel
+    if (!pixels.isEmpty()) pngs.clear();
+    return true;
+}
+
+QVector<quint16> *
+Heatmap::tile(quint64 key, bool create)
+{
+    QHash<quint64, QVector<quint16> >::iterator t = tiles.find(key);
+    if (t != tiles.end()) return &t.value();
+
+    if (tiles.count() >= maxTiles) {
+        writeTiles();
+        tiles.clear();
+    }
+
+    QVector<quint16> counts;
+    QFile file(dir.absoluteFilePath(QString("%1/%2_%3.tile").arg(key >> 40).arg((key >> 20) & 0xfffff).arg(key & 0xfffff)));
+    if (file.open(QIODevice::ReadOnly)) {
+        QByteArray data = qUncompress(file.readAll());
+        if (data.size() == int(tileSize * tileSize * sizeof(quint16))) {
+            counts.resize(tileSize * tileSize);
+            memcpy(counts.data(), data.constData(), data.size());
+        }
+    }
+
+    // nothing ridden there yet
+    if (counts.isEmpty()) {
+        if (!create) return NULL;
+        counts.fill(0, tileSize * tileSize);
+    }
+    return &tiles.insert(key, counts).value();
+}
+
+void
+Heatmap::writeTiles()
+{
+    foreach(quint64 key, dirty) {
+        QHash<quint64, QVector<quint16> >::const_iterator t = tiles.constFind(key);
+        if (t == tiles.constEnd()) continue;
+
+        QString zoom = QString("%1").arg(key >> 40);
+        dir.mkpath(zoom);
+
+        QFile file(dir.absoluteFilePath(QString("%1/%2_%3.tile").arg(zoom).arg((key >> 20) & 0xfffff).arg(key & 0xfffff)));
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            file.write(qCompress(QByteArray::fromRawData(reinterpret_cast<const char *>(t.value().constData()),
+                                                         t.value().count() * sizeof(quint16))));
+    }
+    dirty.clear();
+}
+
+// the rides in the counts and the busiest pixel at each level, and whether
+// it needs rebuilding or is part way through. Missing when never built
+void
+Heatmap::writeIndex()
+{
+    QFile file(dir.absoluteFilePath("rides.txt"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+
+    QTextStream out(&file);
+    out << "stale " << (stale ? 1 : 0) << " rebuilding " << (rebuilding ? 1 : 0) << "\n";
+    out << "max";
+    foreach(int count, maxCount) out << " " << count;
+    out << "\n";
+    foreach(QString ride, rides) out << ride << "\n";
+}
+
+void
+Heatmap::readIndex()
+{
+    QFile file(dir.absoluteFilePath("rides.txt"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        stale = true;
+        return;
+    }
+
+    QTextStream in(&file);
+    QStringList state = in.readLine().split(' ', QString::SkipEmptyParts);
+    stale = state.value(1).toInt() != 0;
+    rebuilding = state.value(3).toInt() != 0;
+
+    QStringList counts = in.readLine().split(' ', QString::SkipEmptyParts);
+    for (int i=1; i < counts.count() && i <= maxCount.count(); i++) maxCount[i-1] = counts[i].toInt();
+
+    while (!in.atEnd()) {
+        QString ride = in.readLine();
+        if (!ride.isEmpty()) rides.insert(ride);
+    }
+}
+
+void
+Heatmap::flush()
+{
+    QMutexLocker locker(&lock);
+    writeTiles();
+    writeIndex();
+}
+
+bool
+Heatmap::isStale()
+{
+    QMutexLocker locker(&lock);
+    return stale;
+}
+
+bool
+Heatmap::isRebuilding()
+{
+    QMutexLocker locker(&lock);
+    return rebuilding;
+}
+
+void
+Heatmap::beginRebuild()
+{
+    QMutexLocker locker(&lock);
+
+    // start again from nothing
+    tiles.clear();
+    dirty.clear();
+    pngs.clear();
+    rides.clear();
+    maxCount.fill(0);
+
+    foreach(QString zoom, dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QDir level(dir.absoluteFilePath(zoom));
+        foreach(QString name, level.entryList(QStringList() << "*.tile", QDir::Files)) level.remove(name);
+    }
+    stale = false;
+    rebuilding = true;
+    writeIndex();
+}
+
+bool
+Heatmap::rebuildRide(QString filename)
+{
+    {
+        QMutexLocker locker(&lock);
+        if (rides.contains(filename)) return false;
+    }
+
+    // just the track
+    RideFileDataPresent wanted;
+    wanted.secs = wanted.lat = wanted.lon = true;
+
+    QStringList errors;
+    QFile file(context->athlete->home.absolutePath() + "/" + filename);
+    RideFile *ride = RideFileFactory::instance().openRideFileSeries(context, file, errors, wanted);
+    QVector<quint64> pixels = rasterize(ride);
+    delete ride;
+
+    QMutexLocker locker(&lock);
+    return include(filename, pixels);
+}
+
+void
+Heatmap::endRebuild()
+{
+    QMutexLocker locker(&lock);
+    rebuilding = false;
+    writeTiles();
+    writeIndex();
+}
+
+// transparent red through yellow to white as rides
+// get more frequent, t is 0 - 1 on a log scale
+static QRgb heatColour(double t)
+{
+    t = qBound(0.0, t, 1.0);
+    int alpha = 140 + int(115 * t);
+    if (t < 0.5) return qRgba(255, int(510 * t), 0, alpha);
+    return qRgba(255, 255, int(510 * (t - 0.5)), alpha);
+}
+
+QByteArray
+Heatmap::png(int zoom, int x, int y)
+{
+    QMutexLocker locker(&lock);
+
+    QByteArray returning;
+    if (zoom < minZoom || zoom > 22 || x < 0 || y < 0 || x >= (1 << zoom) || y >= (1 << zoom)) return returning;
+
+    quint64 cached = (quint64(zoom) << 48) | (quint64(x) << 24) | quint64(y);
+    if (pngs.contains(cached)) return *pngs.object(cached);
+
+    // closer in than we keep, use the part of the maxZoom tile it covers
+    int level = qMin(zoom, int(maxZoom));
+    int shift = zoom - level;
+    int size = tileSize >> shift;
+    int ox = (x & ((1 << shift) - 1)) * size;
+    int oy = (y & ((1 << shift) - 1)) * size;
+
+    QVector<quint16> *counts = tile(tileKey(level, x >> shift, y >> shift), false);
+    if (counts && maxCount[level] > 0) {
+
+        double range = log(1.0 + maxCount[level]);
+        bool ridden = false;
+
+        QImage image(tileSize, tileSize, QImage::Format_ARGB32);
+        image.fill(0);
+        for (int j=0; j<tileSize; j++) {
+            QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(j));
+            const quint16 *row = counts->constData() + (oy + (j * size) / tileSize) * tileSize + ox;
+            for (int i=0; i<tileSize; i++) {
+                quint16 count = row[(i * size) / tileSize];
+                if (count) {
+                    line[i] = heatColour(log(1.0 + count) / range);
+                    ridden = true;
+                }
+            }
+        }
+
+        if (ridden) {
+            QBuffer buffer(&returning);
+            buffer.open(QIODevice::WriteOnly);
+            image.save(&buffer, "PNG");
+        }
+    }
+    pngs.insert(cached, new QByteArray(returning), returning.size() + 1);
+    return returning;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_Heatmap_h
+#define _GC_Heatmap_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QCache>
+#include <QDir>
+#include <QMutex>
+
+class RideFile;
+class Context;
+
+// Where the athlete has ridden, for every ride with GPS. The tracks are
+// rasterized into the web mercator tiles the maps use, at each zoom level
+// from minZoom to maxZoom, with every pixel counting the rides that went
+// through it. Tiles are kept in the athlete's heatmap directory so the map
+// only has to colour the ones it shows, and a ride is added to them when
+// it is imported.
+//
+// Counts can't be taken away from without the track that was added, so a
+// ride deleted or with its samples changed marks the heatmap stale and it
+// is rebuilt from all the rides whilst the app is idle, see HeatmapRebuildTask.
+class Heatmap
+{
+    public:
+        static const int tileSize = 256;
+        static const int minZoom = 3;   // a continent per tile
+        static const int maxZoom = 15;  // about 5m a pixel, closer in is scaled up
+
+        Heatmap(Context *context);
+        ~Heatmap();
+
+        // the pixels a ride passes through at every level, once each,
+        // safe to call from the refresh worker threads
+        static QVector<quint64> rasterize(const RideFile *ride);
+
+        // add a ride's pixels, if it is already in the counts and its samples
+        // changed then the heatmap is stale instead
+        void add(QString filename, const QVector<quint64> &pixels, bool samplesChanged);
+        void remove(QString filename);
+
+        // write the tiles added to
+        void flush();
+
+        // rebuilding from nothing a ride at a time, the rides done so far
+        // are kept so it carries on from there after a restart. Rides
+        // added meanwhile are kept and skipped by rebuildRide()
+        bool isStale();
+        bool isRebuilding();
+        void beginRebuild();
+        bool rebuildRide(QString filename); // false if it is already in
+        void endRebuild();
+
+        // a tile coloured for the map, closer in than maxZoom the tile
+        // is scaled up. Empty when nothing has been ridden there
+        QByteArray png(int zoom, int x, int y);
+
+    private:
+        Context *context;
+        QDir dir;
+        QMutex lock;
+
+        QSet<QString> rides;        // in the counts
+        bool stale, rebuilding;
+        QVector<int> maxCount;      // per level, for colouring
+
+        QHash<quint64, QVector<quint16> > tiles; // loaded, those in dirty need writing
+        QSet<quint64> dirty;
+        QCache<quint64, QByteArray> pngs;
+
+        bool include(QString filename, const QVector<quint64> &pixels); // with lock held
+        QVector<quint16> *tile(quint64 key, bool create);               // with lock held
+        void writeTiles();                                              // with lock held
+        void writeIndex();                                              // with lock held
+        void readIndex();
+};
+
+#endif // _GC_Heatmap_h
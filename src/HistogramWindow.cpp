@@ -39,7 +39,7 @@ static const int cadDigits   = 0;
 //
 // Constructor
 //
-HistogramWindow::HistogramWindow(Context *context, bool rangemode) : GcChartWindow(context), context(context), stale(true), source(NULL), active(false), bactive(false), rangemode(rangemode), useCustom(false), useToToday(false), precision(99)
+HistogramWindow::HistogramWindow(Context *context, bool rangemode) : GcChartWindow(context), context(context), stale(true), source(NULL), active(false), bactive(false), rangemode(rangemode), useCustom(false), useToToday(false), precision(99), resultsRead(0)
 {
     setInstanceName("Histogram Window");
 
@@ -656,6 +656,7 @@ void
 HistogramWindow::rideAddorRemove(RideItem *)
 {
     stale = true;
+    last = DateRange(); // read them again
 }
 
 void
@@ -838,6 +839,7 @@ HistogramWindow::updateChart()
 
                 // set the data on the plot
                 powerHist->setData(source);
+                metricsPlotted = ""; // not the metrics any more
 
                 // and which series to plot
                 powerHist->setSeries(series);
@@ -851,35 +853,52 @@ HistogramWindow::updateChart()
 
             } else {
 
-                if (last.from != use.from || last.to != use.to) {
+                // only the two metrics plotted are read
+                QStringList symbols;
+                symbols << distMetric() << totalMetric();
+                if (last.from != use.from || last.to != use.to || lastSymbols != symbols) {
 
                     // remember the last lot we collected
                     last = use;
+                    lastSymbols = symbols;
 
                     // plotting a metric, reread the metrics for the selected date range
-                    results = context->athlete->metricDB->getAllMetricsFor(use);
-
+                    results = context->athlete->metricDB->getMetricsFor(QDateTime(use.from, QTime(0,0,0)),
+                                                                        QDateTime(use.to, QTime(23,59,59)), symbols);
+                    resultsRead++;
                 }
 
 		if (results.count() == 0) setIsBlank(true);
 		else setIsBlank(false);
 
-                // setData using the summary metrics -- always reset since filters may
-                // have changed, or perhaps the bin width...
-                powerHist->setSeries(RideFile::none);
+                // setData using the summary metrics, the distribution it builds
+                // is kept until the rides or filters change since changing the
+                // bin width just needs recalc() to bin it again
+                uint searched = 0;
+#ifdef GC_HAVE_LUCENE
+                if (isfiltered) searched = qHash(files.join(","));
+#endif
+                uint filtered = context->isfiltered ? qHash(QStringList(context->filterSet.toList()).join(",")) : 0;
+                QString plotted = QString("%1|%2|%3|%4").arg(resultsRead).arg(context->athlete->useMetricUnits)
+                                                        .arg(filtered).arg(searched);
                 powerHist->setDelta(getDelta());
                 powerHist->setDigits(getDigits());
+                if (plotted != metricsPlotted) {
+                    metricsPlotted = plotted;
+                    powerHist->setSeries(RideFile::none); // before, it sets the axis titles too
 #ifdef GC_HAVE_LUCENE
-                powerHist->setData(results, totalMetric(), distMetric(), isfiltered, files);
+                    powerHist->setData(results, totalMetric(), distMetric(), isfiltered, files);
 #else
-                powerHist->setData(results, totalMetric(), distMetric(), false, QStringList());
+                    powerHist->setData(results, totalMetric(), distMetric(), false, QStringList());
 #endif
+                }
                 powerHist->setColor(colorButton->getColor());
 
             }
 
         } else {
 
+            metricsPlotted = "";
             powerHist->setData(myRideItem, interval); // intervals selected forces data to
                                                   // be recomputed since interval selection
                                                   // has changed.
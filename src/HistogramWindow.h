@@ -250,6 +250,9 @@ class HistogramWindow : public GcChartWindow
         ColorButton *colorButton;
         QList<SummaryMetrics> results;
         DateRange last;
+        QStringList lastSymbols;    // the metrics in results
+        int resultsRead;            // times results were read
+        QString metricsPlotted;     // what powerHist's distribution was built from
 };
 
 #endif // _GC_HistogramWindow_h
@@ -158,6 +158,8 @@ HomeWindow::HomeWindow(Context *context, QString name, QString /* windowtitle */
     styleChanged(2);
 
     connect(this, SIGNAL(rideItemChanged(RideItem*)), this, SLOT(rideSelected()));
+    if (name == "analysis")
+        connect(context, SIGNAL(rideLoading(RideItem*)), this, SLOT(rideLoading(RideItem*)));
     connect(this, SIGNAL(dateRangeChanged(DateRange)), this, SLOT(dateRangeChanged(DateRange)));
     connect(context, SIGNAL(configChanged()), this, SLOT(configChanged()));
     connect(tabbed, SIGNAL(currentChanged(int)), this, SLOT(tabSelected(int)));
@@ -165,6 +167,10 @@ HomeWindow::HomeWindow(Context *context, QString name, QString /* windowtitle */
     connect(tb, SIGNAL(tabMoved(int,int)), this, SLOT(tabMoved(int,int)));
     connect(titleEdit, SIGNAL(textChanged(const QString&)), SLOT(titleChanged()));
 
+    // charts scrolled out of view catch up when they scroll back in
+    connect(tileArea->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(updateVisible()));
+    connect(winArea->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(updateVisible()));
+
     installEventFilter(this);
     application->installEventFilter(this);
 }
@@ -238,9 +244,25 @@ HomeWindow::titleChanged()
     }
 }
 
+void
+HomeWindow::rideLoading(RideItem *)
+{
+    // the selected ride is still being read, so rather than leave the
+    // charts showing the last one we say so until rideSelected()
+    for (int i=0; i < charts.count(); i++) {
+        GcChartWindow *chart = qobject_cast<GcChartWindow*>(charts[i]);
+        if (chart) chart->setIsLoading(true);
+    }
+}
+
 void
 HomeWindow::rideSelected()
 {
+    for (int i=0; i < charts.count(); i++) {
+        GcChartWindow *chart = qobject_cast<GcChartWindow*>(charts[i]);
+        if (chart) chart->setIsLoading(false);
+    }
+
     // we need to notify of null rides immediately
     if (!myRideItem || amVisible()) {
         for (int i=0; i < charts.count(); i++) {
@@ -253,8 +275,11 @@ HomeWindow::rideSelected()
             //otherwise just go ahead and notify it of a new ride
             if (!currentStyle && charts.count() && i==tabbed->currentIndex())
                 tabSelected(tabbed->currentIndex(), true); // for ride change
-            else
+            else if (!myRideItem || chartVisible(charts[i])) {
+                staleRide.remove(charts[i]);
                 charts[i]->setProperty("ride", property("ride"));
+            } else
+                staleRide.insert(charts[i]); // when it is next in view
         }
     }
 }
@@ -274,9 +299,51 @@ HomeWindow::dateRangeChanged(DateRange dr)
             //otherwise just go ahead and notify it of a new ride
             if (!currentStyle && charts.count() && i==tabbed->currentIndex())
                 tabSelected(tabbed->currentIndex(), false); // for date range
-            else
+            else if (chartVisible(charts[i])) {
+                staleDateRange.remove(charts[i]);
                 charts[i]->setProperty("dateRange", property("dateRange"));
+            } else
+                staleDateRange.insert(charts[i]); // when it is next in view
+        }
+    }
+}
+
+bool
+HomeWindow::chartVisible(GcWindow *chart)
+{
+    switch (currentStyle) {
+
+    case 0 : // tabbed, only the current tab
+        return tabbed->currentWidget() == chart;
+
+    case 1 : // tiled
+    case 2 : // flow
+        {
+            // not laid out yet, so we can't tell
+            if (chart->geometry().isEmpty()) return true;
+
+            QScrollArea *area = currentStyle == 1 ? tileArea : winArea;
+            QRect view(area->widget()->mapFrom(area->viewport(), QPoint(0,0)), area->viewport()->size());
+            return view.intersects(chart->geometry());
         }
+
+    default:
+        return true;
+    }
+}
+
+void
+HomeWindow::updateVisible()
+{
+    if (!amVisible() || (staleRide.isEmpty() && staleDateRange.isEmpty())) return;
+
+    // tell the charts that have come into view what
+    // they missed whilst they were out of view
+    foreach (GcWindow *chart, charts) {
+        if (!chartVisible(chart)) continue;
+
+        if (staleDateRange.remove(chart)) chart->setProperty("dateRange", property("dateRange"));
+        if (staleRide.remove(chart)) chart->setProperty("ride", property("ride"));
     }
 }
 
@@ -289,7 +356,10 @@ HomeWindow::tabSelected(int index)
     active = true;
 
     if (index >= 0) {
+        realChart(index);
         charts[index]->show();
+        staleRide.remove(charts[index]);
+        staleDateRange.remove(charts[index]);
         charts[index]->setProperty("ride", property("ride"));
         charts[index]->setProperty("dateRange", property("dateRange"));
         controlStack->setCurrentIndex(index);
@@ -307,9 +377,15 @@ HomeWindow::tabSelected(int index, bool forride)
     active = true;
 
     if (index >= 0) {
+        realChart(index);
         charts[index]->show();
-        if (forride) charts[index]->setProperty("ride", property("ride"));
-        else charts[index]->setProperty("dateRange", property("dateRange"));
+        if (forride) {
+            staleRide.remove(charts[index]);
+            charts[index]->setProperty("ride", property("ride"));
+        } else {
+            staleDateRange.remove(charts[index]);
+            charts[index]->setProperty("dateRange", property("dateRange"));
+        }
         controlStack->setCurrentIndex(index);
         titleEdit->setText(charts[index]->property("title").toString());
     }
@@ -339,6 +415,9 @@ HomeWindow::styleChanged(int id)
 {
     // ignore if out of bounds or we're already using that style
     if (id > 2 || id < 0 || id == currentStyle) return;
+
+    // every chart can be seen in the other styles
+    if (currentStyle == 0) for (int i=0; i<charts.count(); i++) realChart(i);
     active = true;
 
     // block updates as it is butt ugly
@@ -493,17 +572,12 @@ HomeWindow::addChart(GcWindow* newone)
         QWidget *x = dynamic_cast<GcWindow*>(newone)->controls();
         QWidget *c = (x != NULL) ? x : new QWidget(this);
 
-        // link settings button to show controls
-        connect(newone, SIGNAL(showControls()), this, SLOT(showControls()));
-        connect(newone, SIGNAL(closeWindow(GcWindow*)), this, SLOT(closeWindow(GcWindow*)));
-
         if (currentStyle == 2 && chartCursor >= 0)
             controlStack->insertWidget(chartCursor, c);
         else
             controlStack->addWidget(c);
 
-        // watch for enter events!
-        newone->installEventFilter(this);
+        wireChart(newone);
 
         RideItem *notconst = (RideItem*)context->currentRideItem();
         newone->setProperty("ride", QVariant::fromValue<RideItem*>(notconst));
@@ -566,12 +640,6 @@ HomeWindow::addChart(GcWindow* newone)
         if (currentStyle == 2 && chartCursor >= 0) charts.insert(chartCursor, newone);
         else charts.append(newone);
         newone->hide();
-
-        // watch for moves etc
-        connect(newone, SIGNAL(resizing(GcWindow*)), this, SLOT(windowResizing(GcWindow*)));
-        connect(newone, SIGNAL(moving(GcWindow*)), this, SLOT(windowMoving(GcWindow*)));
-        connect(newone, SIGNAL(resized(GcWindow*)), this, SLOT(windowResized(GcWindow*)));
-        connect(newone, SIGNAL(moved(GcWindow*)), this, SLOT(windowMoved(GcWindow*)));
     }
 
     // enable disable
@@ -584,6 +652,73 @@ HomeWindow::addChart(GcWindow* newone)
     active = false;
 }
 
+void
+HomeWindow::wireChart(GcWindow *chart)
+{
+    // link settings button to show controls
+    connect(chart, SIGNAL(showControls()), this, SLOT(showControls()));
+    connect(chart, SIGNAL(closeWindow(GcWindow*)), this, SLOT(closeWindow(GcWindow*)));
+
+    // watch for enter events!
+    chart->installEventFilter(this);
+
+    // watch for moves etc
+    connect(chart, SIGNAL(resizing(GcWindow*)), this, SLOT(windowResizing(GcWindow*)));
+    connect(chart, SIGNAL(moving(GcWindow*)), this, SLOT(windowMoving(GcWindow*)));
+    connect(chart, SIGNAL(resized(GcWindow*)), this, SLOT(windowResized(GcWindow*)));
+    connect(chart, SIGNAL(moved(GcWindow*)), this, SLOT(windowMoved(GcWindow*)));
+}
+
+// In a tabbed layout only the current tab can be seen, so the rest
+// start out as bare placeholders and the chart itself, with all its
+// plots and web views, is only made when its tab is first selected
+GcWindow *
+HomeWindow::realChart(int index)
+{
+    GcWindow *stub = charts[index];
+    if (!deferred.contains(stub)) return stub;
+    ChartProperties properties = deferred.take(stub);
+
+    GcWindow *chart = GcWindowRegistry::newGcWindow(stub->property("type").value<GcWinID>(), context);
+    if (!chart) return stub; // type no longer known, leave it be
+
+    chart->hide();
+    chart->setProperty("title", stub->property("title"));
+    chart->setProperty("instanceName", stub->property("instanceName"));
+    for (int i=0; i<properties.count(); i++)
+        chart->setProperty(properties[i].first.toLatin1(), properties[i].second);
+
+    bool wasActive = active;
+    active = true;
+
+    // swap its controls in for the placeholder's
+    QWidget *x = chart->controls();
+    QWidget *c = (x != NULL) ? x : new QWidget(this);
+    QWidget *old = controlStack->widget(index);
+    controlStack->insertWidget(index, c);
+    controlStack->removeWidget(old);
+    delete old;
+
+    // and the chart for the placeholder in its tab
+    int current = tabbed->currentIndex();
+    chart->setContentsMargins(0,25,0,0);
+    chart->setResizable(false); // we need to show on tab selection!
+    tabbed->removeTab(index);
+    tabbed->insertTab(index, chart, chart->property("title").toString());
+    tabbed->setCurrentIndex(current);
+    controlStack->setCurrentIndex(current);
+
+    wireChart(chart);
+    if (clicked == stub) clicked = NULL;
+    staleRide.remove(stub);
+    staleDateRange.remove(stub);
+    charts[index] = chart;
+    stub->deleteLater();
+
+    active = wasActive;
+    return chart;
+}
+
 bool
 HomeWindow::removeChart(int num, bool confirm)
 {
@@ -625,6 +760,9 @@ HomeWindow::removeChart(int num, bool confirm)
         default:
             break; // never reached
     }
+    staleRide.remove(charts[num]);
+    staleDateRange.remove(charts[num]);
+    deferred.remove(charts[num]);
     ((GcWindow*)(charts[num]))->close(); // disconnect
     ((GcWindow*)(charts[num]))->deleteLater();
     charts.removeAt(num);
@@ -712,6 +850,9 @@ HomeWindow::resizeEvent(QResizeEvent * /* e */)
             break;
         }
     }
+
+    // once the layout has settled some charts may have come into view
+    QTimer::singleShot(0, this, SLOT(updateVisible()));
 }
 
 bool
@@ -940,6 +1081,7 @@ HomeWindow::windowMoved(GcWindow*w)
         winFlow->update();
         chartCursor = -2;
         winWidget->repaint();
+        QTimer::singleShot(0, this, SLOT(updateVisible()));
     }
 
     // remove the cursor
@@ -949,6 +1091,7 @@ HomeWindow::windowMoved(GcWindow*w)
 void
 HomeWindow::windowResized(GcWindow* /*w*/)
 {
+    QTimer::singleShot(0, this, SLOT(updateVisible()));
 }
 
 void
@@ -1153,30 +1296,42 @@ HomeWindow::saveState()
            <<"name=\""<<xmlprotect(chart->property("instanceName").toString())<<"\" "
            <<"title=\""<<xmlprotect(chart->property("title").toString())<<"\" >\n";
 
-        // iterate over chart properties
-        const QMetaObject *m = chart->metaObject();
-        for (int i=0; i<m->propertyCount(); i++) {
-            QMetaProperty p = m->property(i);
-            if (p.isUser(chart)) {
-               out<<"\t\t<property name=\""<<xmlprotect(p.name())<<"\" "
-                  <<"type=\""<<p.typeName()<<"\" "
-                  <<"value=\"";
-
-                if (QString(p.typeName()) == "int") out<<p.read(chart).toInt();
-                if (QString(p.typeName()) == "double") out<<p.read(chart).toDouble();
-                if (QString(p.typeName()) == "QDate") out<<p.read(chart).toDate().toString();
-                if (QString(p.typeName()) == "QString") out<<xmlprotect(p.read(chart).toString());
-                if (QString(p.typeName()) == "bool") out<<p.read(chart).toBool();
-                if (QString(p.typeName()) == "LTMSettings") {
-                    QByteArray marshall;
-                    QDataStream s(&marshall, QIODevice::WriteOnly);
-                    LTMSettings x = p.read(chart).value<LTMSettings>();
-                    s << x;
-                    out<<marshall.toBase64();
-                }
+        // iterate over chart properties, or those read for it
+        // when it is still a placeholder that was never shown
+        ChartProperties properties;
+        if (deferred.contains(chart)) {
+            properties = deferred.value(chart);
+        } else {
+            const QMetaObject *m = chart->metaObject();
+            for (int i=0; i<m->propertyCount(); i++) {
+                QMetaProperty p = m->property(i);
+                if (p.isUser(chart)) properties << QPair<QString, QVariant>(p.name(), p.read(chart));
+            }
+        }
 
-                out<<"\" />\n";
+        for (int i=0; i<properties.count(); i++) {
+            QString name = properties[i].first;
+            const QVariant &value = properties[i].second;
+            QString type = value.typeName();
+
+            out<<"\t\t<property name=\""<<xmlprotect(name)<<"\" "
+               <<"type=\""<<type<<"\" "
+               <<"value=\"";
+
+            if (type == "int") out<<value.toInt();
+            if (type == "double") out<<value.toDouble();
+            if (type == "QDate") out<<value.toDate().toString();
+            if (type == "QString") out<<xmlprotect(value.toString());
+            if (type == "bool") out<<value.toBool();
+            if (type == "LTMSettings") {
+                QByteArray marshall;
+                QDataStream s(&marshall, QIODevice::WriteOnly);
+                LTMSettings x = value.value<LTMSettings>();
+                s << x;
+                out<<marshall.toBase64();
             }
+
+            out<<"\" />\n";
         }
         out<<"\t</chart>\n";
     }
@@ -1202,7 +1357,7 @@ HomeWindow::restoreState(bool useDefault)
     // setup the handler
     QXmlInputSource source(&file);
     QXmlSimpleReader xmlReader;
-    ViewParser handler(context);
+    ViewParser handler(context, true);
     xmlReader.setContentHandler(&handler);
     xmlReader.setErrorHandler(&handler);
 
@@ -1214,6 +1369,7 @@ HomeWindow::restoreState(bool useDefault)
     // layout the results
     styleChanged(handler.style);
     foreach(GcWindow *chart, handler.charts) addChart(chart);
+    deferred.unite(handler.deferred);
 }
 
 //
@@ -1253,9 +1409,16 @@ bool ViewParser::startElement( const QString&, const QString&, const QString &na
             if (attrs.qName(i) == "id")  typeStr = unprotect(attrs.value(i));
         }
 
-        // new chart
+        // new chart, or just a placeholder for it if it
+        // will be in a tab that isn't shown straight away
         type = static_cast<GcWinID>(typeStr.toInt());
-        chart = GcWindowRegistry::newGcWindow(type, context);
+        if (lazy && style == 0 && charts.count()) {
+            chart = new GcWindow(context);
+            chart->setProperty("type", QVariant::fromValue<GcWinID>(type));
+            deferred.insert(chart, ChartProperties());
+        } else {
+            chart = GcWindowRegistry::newGcWindow(type, context);
+        }
         chart->hide();
         chart->setProperty("title", QVariant(title));
         chart->setProperty("instanceName", QVariant(name));
@@ -1272,21 +1435,28 @@ bool ViewParser::startElement( const QString&, const QString&, const QString &na
             if (attrs.qName(i) == "type")  type = unprotect(attrs.value(i));
         }
 
-        // set the chart property
-        if (type == "int") chart->setProperty(name.toLatin1(), QVariant(value.toInt()));
-        if (type == "double") chart->setProperty(name.toLatin1(), QVariant(value.toDouble()));
+        // the chart property
+        QVariant set;
+        if (type == "int") set = QVariant(value.toInt());
+        if (type == "double") set = QVariant(value.toDouble());
 
         // deprecate dateRange asa chart propert THAT IS DSAVED IN STATE
-        if (type == "QString" && name != "dateRange") chart->setProperty(name.toLatin1(), QVariant(QString(value)));
-        if (type == "QDate") chart->setProperty(name.toLatin1(), QVariant(QDate::fromString(value)));
-        if (type == "bool") chart->setProperty(name.toLatin1(), QVariant(value.toInt() ? true : false));
+        if (type == "QString" && name != "dateRange") set = QVariant(QString(value));
+        if (type == "QDate") set = QVariant(QDate::fromString(value));
+        if (type == "bool") set = QVariant(value.toInt() ? true : false);
         if (type == "LTMSettings") {
             QByteArray base64(value.toLatin1());
             QByteArray unmarshall = QByteArray::fromBase64(base64);
             QDataStream s(&unmarshall, QIODevice::ReadOnly);
             LTMSettings x;
             s >> x;
-            chart->setProperty(name.toLatin1(), QVariant().fromValue<LTMSettings>(x));
+            set = QVariant().fromValue<LTMSettings>(x);
+        }
+
+        // placeholders keep them for the real chart
+        if (set.isValid()) {
+            if (deferred.contains(chart)) deferred[chart] << QPair<QString, QVariant>(name, set);
+            else chart->setProperty(name.toLatin1(), set);
         }
 
     }
@@ -52,6 +52,7 @@ class HomeWindow : public GcWindow
 
         // GC signals
         void rideSelected();
+        void rideLoading(RideItem*);
         void dateRangeChanged(DateRange);
         void configChanged();
 
@@ -90,6 +91,10 @@ class HomeWindow : public GcWindow
         void windowMoved(GcWindow*);
         void windowResized(GcWindow*);
 
+        // deliver ride/date range changes to charts that
+        // have come into view since they were made
+        void updateVisible();
+
         // when moving tiles
         int pointTile(QPoint pos);
         void drawCursor();
@@ -123,8 +128,19 @@ class HomeWindow : public GcWindow
 
         // the charts!
         QList<GcWindow*> charts;
+
+        // charts not made yet, just placeholders in the tabs with the
+        // properties to give the real one when it is first shown
+        QHash<GcWindow*, ChartProperties> deferred;
+        GcWindow *realChart(int index);
+        void wireChart(GcWindow *chart);
         int chartCursor;
 
+        // charts that were out of view when the ride or date range
+        // changed, they are told when they come back into view
+        QSet<GcWindow*> staleRide, staleDateRange;
+        bool chartVisible(GcWindow *chart);
+
         bool loaded;
 
         void translateChartTitles(QList<GcWindow*> charts);
@@ -159,15 +175,22 @@ class GcWindowDialog : public QDialog
         QDoubleSpinBox *height, *width;
 };
 
+// the saved properties of a chart in the order they were saved
+typedef QList<QPair<QString, QVariant> > ChartProperties;
+
 class ViewParser : public QXmlDefaultHandler
 {
 
 public:
-    ViewParser(Context *context) : style(2), context(context) {}
+    // when lazy the charts in a tabbed layout are only placeholders
+    // carrying the saved properties, see HomeWindow::realChart()
+    ViewParser(Context *context, bool lazy = false) : style(2), lazy(lazy), context(context) {}
 
     // the results!
     QList<GcWindow*> charts;
+    QHash<GcWindow*, ChartProperties> deferred;
     int style;
+    bool lazy;
 
     // unmarshall
     bool startDocument();
@@ -24,6 +24,7 @@
 #include "Zones.h"
 #include "Settings.h"
 #include "Colors.h"
+#include "CacheStats.h"
 
 #include <qwt_plot_curve.h>
 #include <qwt_plot_grid.h>
@@ -102,12 +103,13 @@ HrPwPlot::HrPwPlot(Context *context, HrPwWindow *hrPwWindow) :
     shade_zones = true;
 }
 
-struct DataPoint {
-    double time, hr, watts;
-    int inter;
-    DataPoint(double t, double h, double w, int i) :
-        time(t), hr(h), watts(w), inter(i) {}
-};
+// shared by all the charts, each has its own cache
+static CacheStats preparedStats("HR/power series", GC_HRPWCACHE_MB, 16);
+
+HrPwPlot::~HrPwPlot()
+{
+    preparedStats.forget(this);
+}
 
 void
 HrPwPlot::setAxisTitle(int axis, QString label)
@@ -123,63 +125,54 @@ HrPwPlot::setAxisTitle(int axis, QString label)
     QwtPlot::setAxisTitle(axis, title);
 }
 
-void
-HrPwPlot::recalc()
+HrPwPlot::Prepared *
+HrPwPlot::prepare()
 {
-    if (timeArray.count() == 0)
-        return;
-
     int rideTimeSecs = (int) ceil(timeArray[arrayLength - 1]);
     if (rideTimeSecs > 7*24*60*60) {
-        return;
+        return NULL;
+    }
+
+    int smooth = hrPwWindow->smooth;
+    QString key = QString("%1|%2|%3|%4|%5|%6").arg(rideItem ? rideItem->fileName : QString())
+                                           .arg(rideItem ? rideItem->revision() : 0)
+                                           .arg(smooth).arg(minHr).arg(minWatt).arg(maxWatt);
+    if (prepared.contains(key)) {
+        preparedStats.hit();
+        return prepared.object(key);
     }
+    preparedStats.miss();
 
     // ------ smoothing -----
+    // over the points from start up to i, those within smooth secs
     double totalWatts = 0.0;
     double totalHr = 0.0;
-    QList<DataPoint*> list;
-    int i = 0;
+    int i = 0, start = 0;
     QVector<double> smoothWatts(rideTimeSecs + 1);
     QVector<double> smoothHr(rideTimeSecs + 1);
-    QVector<double> smoothTime(rideTimeSecs + 1);
     int decal=0;
 
-    //int interval = 0;
-    int smooth = hrPwWindow->smooth;
-
     for (int secs = smooth; secs <= rideTimeSecs; ++secs) {
 
         while ((i < arrayLength) && (timeArray[i] <= secs)) {
-
-            DataPoint *dp = new DataPoint(timeArray[i], hrArray[i], wattsArray[i], interArray[i]);
             totalWatts += wattsArray[i];
             totalHr    += hrArray[i];
-            list.append(dp);
-
             ++i;
         }
 
-        while (!list.empty() && (list.front()->time < secs - smooth)) {
-
-            DataPoint *dp = list.front();
-            list.removeFirst();
-            totalWatts -= dp->watts;
-            totalHr    -= dp->hr;
-            delete dp;
+        while (start < i && timeArray[start] < secs - smooth) {
+            totalWatts -= wattsArray[start];
+            totalHr    -= hrArray[start];
+            ++start;
         }
 
-        if (list.empty()) ++decal;
+        if (start == i) ++decal;
         else {
-            smoothWatts[secs-decal]    = totalWatts / list.size();
-            smoothHr[secs-decal]       = totalHr / list.size();
+            smoothWatts[secs-decal]    = totalWatts / (i - start);
+            smoothHr[secs-decal]       = totalHr / (i - start);
         }
-        smoothTime[secs]  = secs / 60.0;
     }
 
-    // Delete temporary list
-    qDeleteAll(list);
-    list.clear();
-
     rideTimeSecs = rideTimeSecs-decal;
     smoothWatts.resize(rideTimeSecs);
     smoothHr.resize(rideTimeSecs);
@@ -201,23 +194,43 @@ HrPwPlot::recalc()
     clipWatts.resize(rideTimeSecs);
     clipHr.resize(rideTimeSecs);
 
-    // Find Hr Delay
-    if (delay == -1) delay = hrPwWindow->findDelay(clipWatts, clipHr, clipWatts.size());
-    else if (delay>rideTimeSecs) delay=rideTimeSecs;
+    Prepared *add = new Prepared;
+    add->watts = clipWatts;
+    add->hr = clipHr;
+    add->delay = -1;
+    prepared.setMaxCost(preparedStats.budget());
+    prepared.insert(key, add, qMax(1, int(2 * sizeof(double)) * rideTimeSecs));
+    preparedStats.setUsage(this, prepared.totalCost(), prepared.count());
+    return add;
+}
 
-    // Apply delay
-    QVector<double> delayWatts(rideTimeSecs-delay);
-    QVector<double> delayHr(rideTimeSecs-delay);
+void
+HrPwPlot::recalc()
+{
+    if (timeArray.count() == 0)
+        return;
 
-    for (int secs = 0; secs < rideTimeSecs-delay; ++secs) {
-        delayWatts[secs]    = clipWatts[secs];
-        delayHr[secs]    = clipHr[secs+delay];
+    Prepared *p = prepare();
+    if (!p) return;
+    QVector<double> &clipWatts = p->watts;
+    QVector<double> &clipHr = p->hr;
+    int rideTimeSecs = clipWatts.size();
+
+    // Find Hr Delay, once for the ride at this smoothing
+    if (delay == -1) {
+        if (p->delay == -1) p->delay = hrPwWindow->findDelay(clipWatts, clipHr, clipWatts.size());
+        else hrPwWindow->showDelay(p->delay);
+        delay = p->delay;
     }
+    else if (delay>rideTimeSecs) delay=rideTimeSecs;
+
+    // Apply delay
+    HrPwWindow::Fit fit = HrPwWindow::fit(clipWatts, clipHr, rideTimeSecs, delay);
     rideTimeSecs = rideTimeSecs-delay;
 
-    double rpente = hrPwWindow->pente(delayWatts, delayHr, delayWatts.size());
-    double rordonnee = hrPwWindow->ordonnee(delayWatts, delayHr, delayWatts.size());
-    double maxr = hrPwWindow->corr(delayWatts, delayHr, delayWatts.size());
+    double rpente = fit.slope;
+    double rordonnee = fit.intercept;
+    double maxr = fit.r;
 
     // ----- limit plotted points ---
     int intpoints = 10; // could be ride length dependent
@@ -448,26 +461,15 @@ HrPwPlot::setDataFromRide(RideItem *_rideItem)
     int npoints = ride->dataPoints().size();
 
     if (dataPresent->watts && dataPresent->hr) {
-        wattsArray.resize(npoints);
-        hrArray.resize(npoints);
-        timeArray.resize(npoints);
+        // shared with the ride and the other charts
+        wattsArray = ride->scaledSeriesData(RideFile::watts, 1.0, true);
+        hrArray = ride->scaledSeriesData(RideFile::hr, 1.0, true);
+        timeArray = ride->seriesData(RideFile::secs);
         interArray.resize(npoints);
 
         arrayLength = 0;
-        //QListIterator<RideFilePoint*> i(ride->dataPoints());
-        //while (i.hasNext()) {
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            //RideFilePoint *point = i.next();
-            if (!timeArray.empty())
-                timeArray[arrayLength]  = point->secs;
-            if (!wattsArray.empty())
-                wattsArray[arrayLength] = max(0, point->watts);
-            if (!hrArray.empty())
-                hrArray[arrayLength]    = max(0, point->hr);
-            if (!interArray.empty())
-                interArray[arrayLength] = point->interval;
-            ++arrayLength;
-        }
+        foreach (const RideFilePoint *point, ride->dataPoints())
+            interArray[arrayLength++] = point->interval;
 
         delay = -1;
         recalc();
@@ -43,6 +43,7 @@ class HrPwPlot : public QwtPlot
     public:
 
         HrPwPlot(Context *context, HrPwWindow *hrPwWindow);
+        ~HrPwPlot();
 
         RideItem *rideItem;
         QwtPlotMarker *r_mrk1;
@@ -97,6 +98,15 @@ class HrPwPlot : public QwtPlot
         QList <HrPwPlotZoneLabel *> zoneLabels;
         bool shade_zones;     // whether power should be shaded
 
+        // the smoothed and clipped series and the delay found in them
+        // by ride and smoothing, so moving the delay is just the fit
+        struct Prepared {
+            QVector<double> watts, hr;
+            int delay; // -1 until it is searched for
+        };
+        QCache<QString, Prepared> prepared;
+        Prepared *prepare();
+
         void recalc();
         void setYMax();
         void setXTitle();
@@ -326,16 +326,7 @@ HrPwWindow::findDelay(QVector<double> &wattsArray, QVector<double> &hrArray, int
 
         for (int a = 10; a <=60; ++a) {
 
-            QVector<double> delayHr(rideTimeSecs);
-
-            for (int j = a; j<rideTimeSecs; ++j) {
-                delayHr[j-a] = hrArray[j];
-            }
-            for (int j = rideTimeSecs-a; j<rideTimeSecs; ++j) {
-                delayHr[j] = 0.0;
-            }
-
-            double r = corr(wattsArray, delayHr, rideTimeSecs-a);
+            double r = fit(wattsArray, hrArray, rideTimeSecs, a).r;
             //fprintf(stderr, "findDelay %d: %.2f \n", a, r);
 
             if (r>maxr) {
@@ -345,11 +336,47 @@ HrPwWindow::findDelay(QVector<double> &wattsArray, QVector<double> &hrArray, int
         }
     } 
 
+    showDelay(delay);
+    return delay;
+}
+
+void
+HrPwWindow::showDelay(int delay)
+{
     delayEdit->setText(QString("%1").arg(delay));
     rDelayEdit->setText(QString("%1").arg(delay));
     delaySlider->setValue(delay);
     rDelaySlider->setValue(delay);
-    return delay;
+}
+
+// the same sums pente(), ordonnee() and corr() work from
+HrPwWindow::Fit
+HrPwWindow::fit(const QVector<double> &watts, const QVector<double> &hr, int n, int lag)
+{
+    Fit returning = { 0, 0, 0 };
+    int count = n - lag;
+    if (count <= 0) return returning;
+
+    const double *x = watts.constData();
+    const double *y = hr.constData() + lag;
+    double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+    for (int j=0; j<count; j++) {
+        sx += x[j];
+        sy += y[j];
+        sxx += x[j] * x[j];
+        syy += y[j] * y[j];
+        sxy += x[j] * y[j];
+    }
+
+    double mx = sx / count, my = sy / count;
+    double cov = sxy / count - mx * my;
+    double varx = sxx / count - mx * mx;
+    double vary = syy / count - my * my;
+
+    returning.slope = cov / varx;
+    returning.intercept = my - returning.slope * mx;
+    returning.r = cov / (sqrt(varx) * sqrt(vary));
+    return returning;
 }
 
 /**************************************/
@@ -55,6 +55,12 @@ class HrPwWindow : public GcChartWindow
         HrPwWindow(Context *context);
         void setData(RideItem *item);
         int findDelay(QVector<double> &wattsArray, QVector<double> &hrArray, int rideTimeSecs);
+        void showDelay(int delay); // found by findDelay
+
+        // least squares fit of hr[j+lag] on watts[j] and its r, in one
+        // pass over the series rather than copying them for each lag
+        struct Fit { double slope, intercept, r; };
+        static Fit fit(const QVector<double> &watts, const QVector<double> &hr, int n, int lag);
 
         // Maths functions used by HrPwPlot
         double pente(QVector<double> &Xi,QVector<double> &Yi,int n);
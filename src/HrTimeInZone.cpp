@@ -20,9 +20,60 @@
 #include "RideMetric.h"
 #include "BestIntervalDialog.h"
 #include "HrZones.h"
+#include "ZoneLookup.h"
 #include <math.h>
 #include <QApplication>
 
+// Time in every heartrate zone from one pass over the ride, the HrZoneTime
+// metrics below each take their zone from here instead of each scanning
+// the ride and searching the zones for every sample
+class HrZoneTimes : public RideMetric {
+    Q_DECLARE_TR_FUNCTIONS(HrZoneTimes)
+
+    public:
+
+    QVector<double> seconds; // by zone
+
+    HrZoneTimes()
+    {
+        setSymbol("time_in_hr_zones");
+        setDependsOn(RideMetric::HrZone);
+        setInternalName("Time in HR Zones");
+        setType(RideMetric::Total);
+        setAggregate(false);
+    }
+    void initialize ()
+    {
+        setName(tr("Time in HR Zones"));
+        setMetricUnits("seconds");
+        setImperialUnits("seconds");
+    }
+
+    double secondsIn(int level) const {
+        return (level >= 0 && level < seconds.count()) ? seconds[level] : 0;
+    }
+
+    void compute(const RideFile *ride, const Zones *, int, const HrZones *hrZone, int hrZoneRange,
+                 const QHash<QString,RideMetric*> &, const Context *)
+    {
+        seconds.clear();
+        if (hrZone && hrZoneRange >= 0) {
+            seconds.fill(0, hrZone->numZones(hrZoneRange));
+
+            ZoneLookup<HrZones> lookup(hrZone, hrZoneRange);
+            foreach(const RideFilePoint *point, ride->dataPoints()) {
+                int level = lookup.whichZone(point->hr);
+                if (level >= 0 && level < seconds.count()) seconds[level] += ride->recIntSecs();
+            }
+        }
+        setValue(0); // only meaningful to the HrZoneTime metrics
+    }
+
+    bool canAggregate() { return false; }
+    void aggregateWith(const RideMetric &) {}
+    RideMetric *clone() const { return new HrZoneTimes(*this); }
+};
+
 class HrZoneTime : public RideMetric {
     Q_DECLARE_TR_FUNCTIONS(HrZoneTime)
     int level;
@@ -42,18 +93,11 @@ public:
         setConversion(1.0);
     }
     void setLevel(int level) { this->level=level-1; } // zones start from zero not 1
-    void compute(const RideFile *ride, const Zones *, int, const HrZones *hrZone, int hrZoneRange,
-                 const QHash<QString,RideMetric*> &, const Context *)
+    void compute(const RideFile *, const Zones *, int, const HrZones *, int,
+                 const QHash<QString,RideMetric*> &deps, const Context *)
     {
-        seconds = 0;
-        // get zone ranges
-        if (hrZone && hrZoneRange >= 0) {
-            // iterate and compute
-            foreach(const RideFilePoint *point, ride->dataPoints()) {
-                if (hrZone->whichZone(hrZoneRange, point->hr) == level)
-                    seconds += ride->recIntSecs();
-            }
-        }
+        const HrZoneTimes *kernel = dynamic_cast<HrZoneTimes*>(deps.value("time_in_hr_zones", NULL));
+        seconds = kernel ? kernel->secondsIn(level) : 0;
         setValue(seconds);
     }
 
@@ -551,15 +595,18 @@ class HrZonePTime8 : public RideMetric {
         RideMetric *clone() const { return new HrZonePTime8(*this); }
 };
 static bool addAllHrZones() {
-    RideMetricFactory::instance().addMetric(HrZoneTime1());
-    RideMetricFactory::instance().addMetric(HrZoneTime2());
-    RideMetricFactory::instance().addMetric(HrZoneTime3());
-    RideMetricFactory::instance().addMetric(HrZoneTime4());
-    RideMetricFactory::instance().addMetric(HrZoneTime5());
-    RideMetricFactory::instance().addMetric(HrZoneTime6());
-    RideMetricFactory::instance().addMetric(HrZoneTime7());
-    RideMetricFactory::instance().addMetric(HrZoneTime8());
+    RideMetricFactory::instance().addMetric(HrZoneTimes());
     QVector<QString> deps;
+    deps.append("time_in_hr_zones");
+    RideMetricFactory::instance().addMetric(HrZoneTime1(), &deps);
+    RideMetricFactory::instance().addMetric(HrZoneTime2(), &deps);
+    RideMetricFactory::instance().addMetric(HrZoneTime3(), &deps);
+    RideMetricFactory::instance().addMetric(HrZoneTime4(), &deps);
+    RideMetricFactory::instance().addMetric(HrZoneTime5(), &deps);
+    RideMetricFactory::instance().addMetric(HrZoneTime6(), &deps);
+    RideMetricFactory::instance().addMetric(HrZoneTime7(), &deps);
+    RideMetricFactory::instance().addMetric(HrZoneTime8(), &deps);
+    deps.clear();
     deps.append("time_in_zone_H1");
     deps.append("workout_time");
     RideMetricFactory::instance().addMetric(HrZonePTime1(), &deps);
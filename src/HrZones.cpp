@@ -849,27 +849,54 @@ int HrZones::insertRangeAtDate(QDate date, int lt) {
     return rnum;
 }
 
-quint16
-HrZones::getFingerprint() const
+static quint64
+rangeFingerprint(const HrZoneRange &range)
 {
     quint64 x = 0;
-    for (int i=0; i<ranges.size(); i++) {
-
-        // from
-        x += ranges[i].begin.toJulianDay();
 
-        // to
-        x += ranges[i].end.toJulianDay();
+    // from
+    x += range.begin.toJulianDay();
 
-        // CP
-        x += ranges[i].lt;
+    // to
+    x += range.end.toJulianDay();
 
-        // each zone definition (manual edit/default changed)
-        for (int j=0; j<ranges[i].zones.count(); j++) {
-            x += ranges[i].zones[j].lo;
+    // CP
+    x += range.lt;
 
-        }
+    // each zone definition (manual edit/default changed)
+    for (int j=0; j<range.zones.count(); j++) {
+        x += range.zones[j].lo;
     }
+    return x;
+}
+
+quint16
+HrZones::getFingerprint() const
+{
+    quint64 x = 0;
+    for (int i=0; i<ranges.size(); i++) x += rangeFingerprint(ranges[i]);
+
     QByteArray ba = QByteArray::number(x);
     return qChecksum(ba, ba.length());
 }
+
+quint16
+HrZones::getFingerprint(const QDate &forDate) const
+{
+    int range = whichRange(forDate);
+    quint64 x = range >= 0 ? rangeFingerprint(ranges[range]) : 0;
+
+    QByteArray ba = QByteArray::number(x);
+    return qChecksum(ba, ba.length());
+}
+
+HrZones *
+HrZones::copy() const
+{
+    HrZones *returning = new HrZones;
+    returning->defaults_from_user = defaults_from_user;
+    returning->scheme = scheme;
+    returning->ranges = ranges;
+    returning->modificationTime = modificationTime;
+    return returning;
+}
@@ -208,6 +208,14 @@ class HrZones : public QObject
         // data is changed since last referenced in Metric code
         // could also be used in Configuration pages (later)
         quint16 getFingerprint() const;
+
+        // the same but only for the range that applies on a date, so
+        // rides in other ranges are unaffected when one range is edited
+        quint16 getFingerprint(const QDate &forDate) const;
+
+        // a copy to read from other threads, later edits to these
+        // zones don't reach it. Caller owns it.
+        HrZones *copy() const;
 };
 
 QColor hrZoneColor(int zone, int num_zones);
@@ -183,7 +183,7 @@ ICalendar::ICalendar(Context *context) : QWidget(context->mainWindow), context(c
     }
 
     // remote file
-    context->athlete->calendarDownload->download();
+    context->athlete->calendarDownload()->download();
 }
 
 void ICalendar::refreshRemote(QString fulltext)
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "IntervalDetector.h"
+#include "AddIntervalDialog.h"
+#include "RideFile.h"
+
+const double IntervalDetector::minAscent = 100;
+const double IntervalDetector::minWPrime = 2000;
+
+static void
+append(QList<DetectedInterval> &detected, const char *type,
+       const QList<AddIntervalDialog::AddedInterval> &found)
+{
+    foreach(const AddIntervalDialog::AddedInterval &add, found) {
+        DetectedInterval interval;
+        interval.type = type;
+        interval.name = add.name;
+        interval.start = add.start;
+        interval.stop = add.stop;
+        interval.value = add.avg;
+        detected << interval;
+    }
+}
+
+QList<DetectedInterval>
+IntervalDetector::detect(const RideFile *ride)
+{
+    QList<DetectedInterval> detected;
+    if (!ride || ride->dataPoints().isEmpty()) return detected;
+
+    QList<AddIntervalDialog::AddedInterval> found;
+
+    // no ride item, the .cpx may not be current yet
+    if (ride->areDataPresent()->watts) {
+        AddIntervalDialog::findPeakPowerStandard(ride, found, NULL);
+        append(detected, "peak", found);
+        found.clear();
+
+        AddIntervalDialog::findWPrimeDrops(ride, minWPrime, found);
+        append(detected, "wprime", found);
+        found.clear();
+    }
+
+    AddIntervalDialog::findClimbs(ride, minAscent, found);
+    append(detected, "climb", found);
+
+    return detected;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_IntervalDetector_h
+#define _GC_IntervalDetector_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QList>
+
+class RideFile;
+
+// an interval found automatically when the ride is imported or its
+// metrics refreshed, stored alongside the metrics in the ride database
+struct DetectedInterval {
+    QString type;   // "peak", "climb" or "wprime"
+    QString name;
+    double start, stop;
+    double value;   // watts, metres of ascent or joules of W'
+
+    DetectedInterval() : start(0), stop(0), value(0) {}
+};
+
+class IntervalDetector
+{
+    public:
+        // thresholds match the defaults in the add interval dialog
+        static const double minAscent;  // metres
+        static const double minWPrime;  // joules
+
+        // safe to call from the metric refresh worker threads
+        static QList<DetectedInterval> detect(const RideFile *ride);
+};
+
+#endif // _GC_IntervalDetector_h
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "IntervalOverlay.h"
+#include "IntervalItem.h"
+#include "RideFile.h"
+#include "Context.h"
+#include "Athlete.h"
+
+#include <QtAlgorithms>
+
+IntervalOverlay::IntervalOverlay(Context *context) : context(context), generation_(0), revision_(0)
+{
+}
+
+void
+IntervalOverlay::refresh()
+{
+    const QTreeWidgetItem *all = context->athlete->allIntervalItems();
+    int n = all ? all->childCount() : 0;
+
+    // are they the same intervals?
+    bool same = n == intervals.count();
+    for (int i=0; same && i<n; i++) {
+        const IntervalItem *item = (const IntervalItem *)all->child(i);
+        same = item == intervals[i].item && item->start == intervals[i].start && item->stop == intervals[i].stop;
+    }
+
+    if (!same) {
+        intervals.resize(n);
+        QVector<double> starts(n), stops(n), startsKM(n), stopsKM(n);
+        for (int i=0; i<n; i++) {
+            IntervalItem *item = (IntervalItem *)all->child(i);
+            Interval &add = intervals[i];
+            add.item = item;
+            add.start = starts[i] = item->start;
+            add.stop = stops[i] = item->stop;
+            add.startKM = startsKM[i] = item->startKM;
+            add.stopKM = stopsKM[i] = item->stopKM;
+            add.startIndex = item->ride ? item->ride->timeIndex(item->start) : 0;
+            add.stopIndex = item->ride ? item->ride->timeIndex(item->stop) : 0;
+            add.selected = false;
+        }
+        byTime.build(starts, stops);
+        byDistance.build(startsKM, stopsKM);
+        selection.clear();
+        generation_++;
+        revision_++;
+    }
+
+    // and the same selection?
+    bool changed = false;
+    for (int i=0; i<n; i++) {
+        bool selected = all->child(i)->isSelected();
+        if (selected != intervals[i].selected) {
+            intervals[i].selected = selected;
+            changed = true;
+        }
+    }
+    if (changed) {
+        selection.clear();
+        for (int i=0; i<n; i++) if (intervals[i].selected) selection << i;
+        revision_++;
+    }
+}
+
+QVector<int>
+IntervalOverlay::intervalsAt(double secs) const
+{
+    QVector<int> found;
+    byTime.stab(secs, found);
+    qSort(found);
+    return found;
+}
+
+QVector<int>
+IntervalOverlay::intervalsAtKM(double km) const
+{
+    QVector<int> found;
+    byDistance.stab(km, found);
+    qSort(found);
+    return found;
+}
+
+// sorts the intervals by start, as they usually are already
+struct TreeOrder {
+    const QVector<double> &starts;
+    TreeOrder(const QVector<double> &starts) : starts(starts) {}
+    bool operator()(int a, int b) const { return starts[a] < starts[b]; }
+};
+
+void
+IntervalOverlay::Tree::build(const QVector<double> &starts, const QVector<double> &stops)
+{
+    int n = starts.count();
+    order.resize(n);
+    for (int i=0; i<n; i++) order[i] = i;
+    qStableSort(order.begin(), order.end(), TreeOrder(starts));
+
+    lo.resize(n);
+    hi.resize(n);
+    reach.resize(n);
+    for (int i=0; i<n; i++) {
+        lo[i] = starts[order[i]];
+        hi[i] = stops[order[i]];
+    }
+    build(0, n);
+}
+
+double
+IntervalOverlay::Tree::build(int from, int to)
+{
+    if (from >= to) return -1e300;
+
+    int mid = (from + to) / 2;
+    reach[mid] = qMax(hi[mid], qMax(build(from, mid), build(mid + 1, to)));
+    return reach[mid];
+}
+
+void
+IntervalOverlay::Tree::stab(int from, int to, double x, QVector<int> &into) const
+{
+    if (from >= to) return;
+
+    int mid = (from + to) / 2;
+    if (reach[mid] < x) return; // nothing below reaches this far
+
+    stab(from, mid, x, into);
+    if (lo[mid] > x) return; // nor does anything to the right start soon enough
+    if (hi[mid] >= x) into << order[mid];
+    stab(mid + 1, to, x, into);
+}
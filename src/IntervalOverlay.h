@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_IntervalOverlay_h
+#define _GC_IntervalOverlay_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+
+class Context;
+class IntervalItem;
+
+// The intervals of the current ride as the charts draw them, kept in
+// step with the interval tree in the sidebar. AllPlot and the maps take
+// the geometry and the selection from here rather than walking the tree
+// for every point they draw, and the maps compare the selection with
+// what they have drawn so only the intervals that changed are redrawn.
+class IntervalOverlay
+{
+    public:
+
+        IntervalOverlay(Context *context);
+
+        struct Interval {
+            IntervalItem *item;         // only to compare, it may have gone
+            double start, stop;         // secs
+            double startKM, stopKM;
+            int startIndex, stopIndex;  // samples in the ride
+            bool selected;
+        };
+
+        // catch up with the interval tree, one walk over it which only
+        // counts as a change when there was one, so call it freely
+        void refresh();
+
+        int count() const { return intervals.count(); }
+        const Interval &at(int i) const { return intervals[i]; }
+
+        // the selected intervals, in tree order
+        const QVector<int> &selected() const { return selection; }
+
+        // generation changes when the intervals are not the same ones,
+        // revision on any change at all, including the selection
+        int generation() const { return generation_; }
+        int revision() const { return revision_; }
+
+        // the intervals containing a time in secs or a distance in km
+        QVector<int> intervalsAt(double secs) const;
+        QVector<int> intervalsAtKM(double km) const;
+
+    private:
+
+        // a static interval tree, the intervals sorted by start with the
+        // middle of each range the root of its subtree, holding the
+        // furthest stop beneath it so whole subtrees can be skipped
+        struct Tree {
+            QVector<int> order;
+            QVector<double> lo, hi, reach;
+
+            void build(const QVector<double> &starts, const QVector<double> &stops);
+            void stab(double x, QVector<int> &into) const { stab(0, order.count(), x, into); }
+
+            private:
+            double build(int from, int to);
+            void stab(int from, int to, double x, QVector<int> &into) const;
+        };
+
+        Context *context;
+        QVector<Interval> intervals;
+        QVector<int> selection;
+        Tree byTime, byDistance;
+        int generation_, revision_;
+};
+
+#endif // _GC_IntervalOverlay_h
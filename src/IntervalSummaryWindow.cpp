@@ -69,22 +69,9 @@ void IntervalSummaryWindow::calcInterval(IntervalItem* interval, QString& html)
 
     bool metricUnits = context->athlete->useMetricUnits;
 
-    RideFile f(ride->startTime(), ride->recIntSecs());
-    f.context = context;
     int start = ride->timeIndex(interval->start);
     int end = ride->timeIndex(interval->stop);
-    for (int i = start; i <= end; ++i) {
-        const RideFilePoint *p = ride->dataPoints()[i];
-        f.appendPoint(p->secs, p->cad, p->hr, p->km, p->kph, p->nm,
-                      p->watts, p->alt, p->lon, p->lat, p->headwind, p->slope, p->temp, p->lrbalance, 0);
-
-        // derived data
-        RideFilePoint *l = f.dataPoints().last();
-        l->np = p->np;
-        l->xp = p->xp;
-        l->apower = p->apower;
-    }
-    if (f.dataPoints().size() == 0) {
+    if (ride->dataPoints().isEmpty() || end < start) {
         // Interval empty, do not compute any metrics
         html += "<i>" + tr("empty interval") + "</tr>";
     }
@@ -97,7 +84,7 @@ void IntervalSummaryWindow::calcInterval(IntervalItem* interval, QString& html)
     QStringList intervalMetrics = s.split(",");
 
     QHash<QString,RideMetricPtr> metrics =
-        RideMetric::computeMetrics(context, &f, context->athlete->zones(), context->athlete->hrZones(), intervalMetrics);
+        RideMetric::computeIntervalMetrics(context, ride, start, end, intervalMetrics);
 
     html += "<b>" + interval->text(0) + "</b>";
     html += "<table align=\"center\" width=\"90%\" ";
@@ -251,6 +251,7 @@ JouleDevice::download( const QDir &tmpdir,
                     }
                 }
                 tmp.close();
+                emit downloaded(file);
             }
 
 
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "JsonReader.h"
+#include <QStringList>
+
+// nesting we will follow before giving up on a reply
+static const int maxDepth = 256;
+
+JsonReader::JsonReader(const QByteArray &text) : p(text.constData()), end(text.constData() + text.size())
+{
+}
+
+QVariant
+JsonReader::parse(const QByteArray &text, bool *ok)
+{
+    JsonReader reader(text);
+    QVariant result;
+
+    bool parsed = reader.readValue(result, 0);
+    if (parsed) {
+        reader.skipSpace();
+        parsed = reader.p == reader.end; // nothing trailing
+    }
+
+    if (ok) *ok = parsed;
+    return parsed ? result : QVariant();
+}
+
+QVariant
+JsonReader::value(const QVariant &root, const QString &path)
+{
+    QVariant at = root;
+
+    foreach(QString step, path.split('.', QString::SkipEmptyParts)) {
+        if (at.type() == QVariant::Map) {
+            QVariantMap map = at.toMap();
+            if (!map.contains(step)) return QVariant();
+            at = map.value(step);
+        } else if (at.type() == QVariant::List) {
+            bool isIndex;
+            int index = step.toInt(&isIndex);
+            QVariantList list = at.toList();
+            if (!isIndex || index < 0 || index >= list.count()) return QVariant();
+            at = list.at(index);
+        } else {
+            return QVariant();
+        }
+    }
+    return at;
+}
+
+void
+JsonReader::skipSpace()
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+}
+
+bool
+JsonReader::readValue(QVariant &into, int depth)
+{
+    if (depth > maxDepth) return false;
+
+    skipSpace();
+    if (p == end) return false;
+
+    switch (*p) {
+    case '{': return readObject(into, depth);
+    case '[': return readArray(into, depth);
+    case '"':
+        {
+            QString string;
+            if (!readString(string)) return false;
+            into = string;
+            return true;
+        }
+    case 't':
+        into = true;
+        return readWord("true");
+    case 'f':
+        into = false;
+        return readWord("false");
+    case 'n':
+        into = QVariant();
+        return readWord("null");
+    default:
+        return readNumber(into);
+    }
+}
+
+bool
+JsonReader::readObject(QVariant &into, int depth)
+{
+    QVariantMap map;
+    p++; // '{'
+
+    skipSpace();
+    if (p < end && *p == '}') {
+        p++;
+        into = map;
+        return true;
+    }
+
+    while (p < end) {
+        QString name;
+        QVariant member;
+
+        skipSpace();
+        if (p == end || *p != '"' || !readString(name)) return false;
+        skipSpace();
+        if (p == end || *p++ != ':') return false;
+        if (!readValue(member, depth + 1)) return false;
+        map.insert(name, member);
+
+        skipSpace();
+        if (p == end) return false;
+        if (*p == ',') { p++; continue; }
+        if (*p++ != '}') return false;
+
+        into = map;
+        return true;
+    }
+    return false;
+}
+
+bool
+JsonReader::readArray(QVariant &into, int depth)
+{
+    QVariantList list;
+    p++; // '['
+
+    skipSpace();
+    if (p < end && *p == ']') {
+        p++;
+        into = list;
+        return true;
+    }
+
+    while (p < end) {
+        QVariant element;
+        if (!readValue(element, depth + 1)) return false;
+        list << element;
+
+        skipSpace();
+        if (p == end) return false;
+        if (*p == ',') { p++; continue; }
+        if (*p++ != ']') return false;
+
+        into = list;
+        return true;
+    }
+    return false;
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool
+JsonReader::readString(QString &into)
+{
+    p++; // opening quote
+    into.clear();
+
+    // plain runs are decoded from utf-8 in one go, escapes between them
+    const char *run = p;
+    while (p < end) {
+        char c = *p;
+
+        if (c == '"') {
+            into += QString::fromUtf8(run, p - run);
+            p++;
+            return true;
+        }
+        if (c != '\\') {
+            p++;
+            continue;
+        }
+
+        into += QString::fromUtf8(run, p - run);
+        if (++p == end) return false;
+
+        switch (*p++) {
+        case '"': into += QChar('"'); break;
+        case '\\': into += QChar('\\'); break;
+        case '/': into += QChar('/'); break;
+        case 'b': into += QChar('\b'); break;
+        case 'f': into += QChar('\f'); break;
+        case 'n': into += QChar('\n'); break;
+        case 'r': into += QChar('\r'); break;
+        case 't': into += QChar('\t'); break;
+        case 'u':
+            {
+                if (end - p < 4) return false;
+                ushort code = 0;
+                for (int i = 0; i < 4; i++) {
+                    int digit = hexValue(*p++);
+                    if (digit < 0) return false;
+                    code = (code << 4) | digit;
+                }
+                // surrogate pairs arrive as two escapes, which is
+                // just what QString wants as utf-16
+                into += QChar(code);
+            }
+            break;
+        default:
+            return false;
+        }
+        run = p;
+    }
+    return false; // unterminated
+}
+
+bool
+JsonReader::readNumber(QVariant &into)
+{
+    const char *start = p;
+    bool integer = true;
+
+    if (p < end && *p == '-') p++;
+    if (p == end || *p < '0' || *p > '9') return false;
+    while (p < end && *p >= '0' && *p <= '9') p++;
+
+    if (p < end && *p == '.') {
+        integer = false;
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        integer = false;
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    }
+
+    QByteArray number(start, p - start);
+    bool ok = false;
+    if (integer) {
+        qlonglong value = number.toLongLong(&ok);
+        if (ok) into = value;
+    }
+    if (!ok) {
+        double value = number.toDouble(&ok);
+        if (ok) into = value;
+    }
+    return ok;
+}
+
+bool
+JsonReader::readWord(const char *word)
+{
+    for (; *word; word++) {
+        if (p == end || *p != *word) return false;
+        p++;
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_JsonReader_h
+#define _GC_JsonReader_h 1
+#include "GoldenCheetah.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+
+//
+// A small single pass reader for the JSON replies from web services
+//
+// The uploaders and downloaders only ever want a field or two from a
+// reply, so rather than evaluating it in a script engine the body is
+// read once, straight into QVariants: objects become a QVariantMap,
+// arrays a QVariantList, integers a qlonglong and other numbers a
+// double, so ids keep all their digits when read back as a string
+//
+class JsonReader
+{
+    public:
+
+        // returns an invalid QVariant, and sets ok false, if malformed
+        static QVariant parse(const QByteArray &text, bool *ok = NULL);
+
+        // follow member names and array indexes separated by dots
+        // e.g. "response.dateList.date", invalid if any step is missing
+        static QVariant value(const QVariant &root, const QString &path);
+
+    private:
+
+        JsonReader(const QByteArray &text);
+
+        void skipSpace();
+        bool readValue(QVariant &into, int depth);
+        bool readObject(QVariant &into, int depth);
+        bool readArray(QVariant &into, int depth);
+        bool readString(QString &into);
+        bool readNumber(QVariant &into);
+        bool readWord(const char *word);
+
+        const char *p, *end;
+};
+
+#endif // _GC_JsonReader_h
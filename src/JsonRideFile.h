@@ -32,6 +32,7 @@
 
 struct JsonFileReader : public RideFileReader {
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const; 
+    RideFile *openRideFileSeries(QFile &file, QStringList &errors, const RideFileDataPresent &wanted) const;
     bool writeRideFile(Context *, const RideFile *ride, QFile &file) const;
     bool hasWrite() const { return true; }
 };
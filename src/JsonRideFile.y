@@ -35,6 +35,8 @@
 // in writeRideFile below, this is NOT a generic json parser.
 
 #include "JsonRideFile.h"
+#include <QMutex>
+#include <math.h>
 
 // Set during parser processing, using same
 // naming conventions as yacc/lex -p
@@ -48,9 +50,16 @@ static QString JsonString,
                JsonTagKey, JsonTagValue,
                JsonOverName, JsonOverKey, JsonOverValue;
 static double JsonNumber;
+static RideFileDataPresent JsonWanted; // the sample series to decode
+static bool JsonSkip;                  // the number being read is not wanted
 static QStringList JsonRideFileerrors;
 static QMap <QString, QString> JsonOverrides;
 
+// the lexer and parser state above is global so only
+// one file can be parsed at a time, the metric refresh
+// opens rides from multiple threads so we serialise here
+static QMutex JsonParserLock;
+
 // Lex scanner
 extern int JsonRideFilelex(); // the lexer aka yylex()
 extern void JsonRideFile_setString(QString);
@@ -103,6 +112,13 @@ static QString unprotect(const QString string)
     return s;
 }
 
+// store a sample value, unless it was skipped
+static void JsonSeries(double &field)
+{
+    if (JsonSkip) JsonSkip = false;
+    else field = JsonNumber;
+}
+
 %}
 
 %token STRING INTEGER FLOAT
@@ -240,28 +256,29 @@ sample: '{' series_list '}'             { JsonRide->appendPoint(JsonPoint.secs,
                                           JsonPoint = RideFilePoint();
                                         }
 
+// a series that was not wanted is skipped without converting the number
 series_list: series | series_list ',' series ;
-series: SECS ':' number                 { JsonPoint.secs = JsonNumber; }
-        | KM ':' number                 { JsonPoint.km = JsonNumber; }
-        | WATTS ':' number              { JsonPoint.watts = JsonNumber; }
-        | NM ':' number                 { JsonPoint.nm = JsonNumber; }
-        | CAD ':' number                { JsonPoint.cad = JsonNumber; }
-        | KPH ':' number                { JsonPoint.kph = JsonNumber; }
-        | HR ':' number                 { JsonPoint.hr = JsonNumber; }
-        | ALTITUDE ':' number           { JsonPoint.alt = JsonNumber; }
-        | LAT ':' number                { JsonPoint.lat = JsonNumber; }
-        | LON ':' number                { JsonPoint.lon = JsonNumber; }
-        | HEADWIND ':' number           { JsonPoint.headwind = JsonNumber; }
-        | SLOPE ':' number              { JsonPoint.slope = JsonNumber; }
-        | TEMP ':' number               { JsonPoint.temp = JsonNumber; }
-        | LRBALANCE ':' number          { JsonPoint.lrbalance = JsonNumber; }
+series: SECS { JsonSkip = !JsonWanted.secs; } ':' number                { JsonSeries(JsonPoint.secs); }
+        | KM { JsonSkip = !JsonWanted.km; } ':' number                  { JsonSeries(JsonPoint.km); }
+        | WATTS { JsonSkip = !JsonWanted.watts; } ':' number            { JsonSeries(JsonPoint.watts); }
+        | NM { JsonSkip = !JsonWanted.nm; } ':' number                  { JsonSeries(JsonPoint.nm); }
+        | CAD { JsonSkip = !JsonWanted.cad; } ':' number                { JsonSeries(JsonPoint.cad); }
+        | KPH { JsonSkip = !JsonWanted.kph; } ':' number                { JsonSeries(JsonPoint.kph); }
+        | HR { JsonSkip = !JsonWanted.hr; } ':' number                  { JsonSeries(JsonPoint.hr); }
+        | ALTITUDE { JsonSkip = !JsonWanted.alt; } ':' number           { JsonSeries(JsonPoint.alt); }
+        | LAT { JsonSkip = !JsonWanted.lat; } ':' number                { JsonSeries(JsonPoint.lat); }
+        | LON { JsonSkip = !JsonWanted.lon; } ':' number                { JsonSeries(JsonPoint.lon); }
+        | HEADWIND { JsonSkip = !JsonWanted.headwind; } ':' number      { JsonSeries(JsonPoint.headwind); }
+        | SLOPE { JsonSkip = !JsonWanted.slope; } ':' number            { JsonSeries(JsonPoint.slope); }
+        | TEMP { JsonSkip = !JsonWanted.temp; } ':' number              { JsonSeries(JsonPoint.temp); }
+        | LRBALANCE { JsonSkip = !JsonWanted.lrbalance; } ':' number    { JsonSeries(JsonPoint.lrbalance); }
         ;
 
 /*
  * Primitives
  */
-number: INTEGER                         { JsonNumber = QString(JsonRideFiletext).toInt(); }
-        | FLOAT                         { JsonNumber = QString(JsonRideFiletext).toDouble(); }
+number: INTEGER                         { if (!JsonSkip) JsonNumber = QString(JsonRideFiletext).toInt(); }
+        | FLOAT                         { if (!JsonSkip) JsonNumber = QString(JsonRideFiletext).toDouble(); }
         ;
 
 string: STRING                          { JsonString = unprotect(JsonRideFiletext); }
@@ -275,6 +292,12 @@ static int jsonFileReaderRegistered =
 
 RideFile *
 JsonFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
+{
+    return openRideFileSeries(file, errors, RideFileDataPresent::all());
+}
+
+RideFile *
+JsonFileReader::openRideFileSeries(QFile &file, QStringList &errors, const RideFileDataPresent &wanted) const
 {
     // Read the entire file into a QString -- we avoid using fopen since it
     // doesn't handle foreign characters well. Instead we use QFile and parse
@@ -293,12 +316,17 @@ JsonFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*
         return NULL; 
     }
 
+    // parser/lexer are not reentrant
+    QMutexLocker locker(&JsonParserLock);
+
     // inform the parser/lexer we have a new file
     JsonRideFile_setString(contents);
 
     // setup
     JsonRide = new RideFile;
     JsonRideFileerrors.clear();
+    JsonWanted = wanted;
+    JsonSkip = false;
 
     // set to non-zero if you want to
     // to debug the yyparse() state machine
@@ -319,6 +347,76 @@ JsonFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*
     } else return JsonRide;
 }
 
+// The samples are the bulk of the file, so they are formatted straight
+// into a buffer, rather than a QString per value
+static char *formatInteger(char *p, qint64 v)
+{
+    char digits[24];
+    int n = 0;
+    do { digits[n++] = '0' + char(v % 10); v /= 10; } while (v);
+    while (n) *p++ = digits[--n];
+    return p;
+}
+
+// as QString::arg(v) writes it, %g with prec significant digits, except
+// that large numbers are written out in full since the lexer doesn't read
+// positive exponents. Whole numbers (secs, watts, hr, cad ...) are quickest
+static char *formatNumber(char *p, double v, int prec = 6)
+{
+    if (v != v || v > 1e300 || v < -1e300) { *p++ = '0'; return p; } // nan and inf aren't json
+    if (v < 0) { *p++ = '-'; v = -v; }
+    if (v == floor(v) && v < 1e15) return formatInteger(p, qint64(v));
+
+    // the prec significant digits, and the exponent of the first
+    int e = int(floor(log10(v)));
+    qint64 limit = 1;
+    for (int i=0; i<prec; i++) limit *= 10;
+    qint64 m = qRound64(v * pow(10.0, prec - 1 - e));
+    if (m >= limit) { m = qRound64(double(m) / 10); e++; }
+    else if (m < limit / 10) { e--; m = qRound64(v * pow(10.0, prec - 1 - e)); }
+
+    // without the trailing zeros
+    int n = prec;
+    while (n > 1 && m % 10 == 0) { m /= 10; n--; }
+    char digits[24];
+    for (int i=n-1; i>=0; i--) { digits[i] = '0' + char(m % 10); m /= 10; }
+
+    if (e < -4) {
+        // d.ddde-XX
+        *p++ = digits[0];
+        if (n > 1) {
+            *p++ = '.';
+            for (int i=1; i<n; i++) *p++ = digits[i];
+        }
+        *p++ = 'e';
+        *p++ = '-';
+        if (-e < 10) *p++ = '0';
+        return formatInteger(p, -e);
+
+    } else if (e < 0) {
+        // 0.000ddd
+        *p++ = '0';
+        *p++ = '.';
+        for (int i=-1; i>e; i--) *p++ = '0';
+        for (int i=0; i<n; i++) *p++ = digits[i];
+
+    } else {
+        // ddd.ddd, or ddd000 once the digits run out
+        for (int i=0; i<=e; i++) *p++ = i < n ? digits[i] : '0';
+        if (n > e+1) {
+            *p++ = '.';
+            for (int i=e+1; i<n; i++) *p++ = digits[i];
+        }
+    }
+    return p;
+}
+
+static inline char *formatName(char *p, const char *name)
+{
+    while (*name) *p++ = *name++;
+    return p;
+}
+
 // Writes valid .json (validated at www.jsonlint.com)
 bool
 JsonFileReader::writeRideFile(Context *, const RideFile *ride, QFile &file) const
@@ -329,8 +427,10 @@ JsonFileReader::writeRideFile(Context *, const RideFile *ride, QFile &file) cons
     // truncate existing
     file.resize(0);
 
-    // setup streamer
-    QTextStream out(&file);
+    // everything but the samples is streamed into a string first,
+    // and the whole file goes out in one write at the end
+    QString header;
+    QTextStream out(&header);
 
     // start of document and ride
     out << "{\n\t\"RIDE\":{\n";
@@ -466,51 +566,63 @@ JsonFileReader::writeRideFile(Context *, const RideFile *ride, QFile &file) cons
         out <<"\n\t\t]";
     }
 
+    out.flush();
+    QByteArray json = header.toLocal8Bit(); // as the QTextStream would have
+    header = QString();
+
     //
     // SAMPLES
     //
     if (ride->dataPoints().count()) {
 
-        out << ",\n\t\t\"SAMPLES\":[\n";
+        // the series that aren't present are left out of every sample
+        const RideFileDataPresent *present = ride->areDataPresent();
+
+        // room for them all to start with, a long sample is about 200 bytes
+        json.reserve(json.size() + ride->dataPoints().count() * 128 + 64);
+        json.append(",\n\t\t\"SAMPLES\":[\n");
         bool first = true;
 
+        char line[1024]; // a full sample is under 500
         foreach (RideFilePoint *p, ride->dataPoints()) {
 
+            char *c = line;
             if (first) first=false;
-            else out << ",\n";
+            else c = formatName(c, ",\n");
 
-            out << "\t\t\t{ ";
+            c = formatName(c, "\t\t\t{ ");
 
             // always store time
-            out << "\"SECS\":" << QString("%1").arg(p->secs);
-
-            if (ride->areDataPresent()->km) out << ", \"KM\":" << QString("%1").arg(p->km);
-            if (ride->areDataPresent()->watts) out << ", \"WATTS\":" << QString("%1").arg(p->watts);
-            if (ride->areDataPresent()->nm) out << ", \"NM\":" << QString("%1").arg(p->nm);
-            if (ride->areDataPresent()->cad) out << ", \"CAD\":" << QString("%1").arg(p->cad);
-            if (ride->areDataPresent()->kph) out << ", \"KPH\":" << QString("%1").arg(p->kph);
-            if (ride->areDataPresent()->hr) out << ", \"HR\":"  << QString("%1").arg(p->hr);
-            if (ride->areDataPresent()->alt) out << ", \"ALT\":" << QString("%1").arg(p->alt);
-            if (ride->areDataPresent()->lat)
-                out << ", \"LAT\":" << QString("%1").arg(p->lat, 0, 'g', 11);
-            if (ride->areDataPresent()->lon)
-                out << ", \"LON\":" << QString("%1").arg(p->lon, 0, 'g', 11);
-            if (ride->areDataPresent()->headwind) out << ", \"HEADWIND\":" << QString("%1").arg(p->headwind);
-            if (ride->areDataPresent()->slope) out << ", \"SLOPE\":" << QString("%1").arg(p->slope);
-            if (ride->areDataPresent()->temp && p->temp != RideFile::noTemp) out << ", \"TEMP\":" << QString("%1").arg(p->temp);
-            if (ride->areDataPresent()->lrbalance) out << ", \"LRBALANCE\":" << QString("%1").arg(p->lrbalance);
+            c = formatNumber(formatName(c, "\"SECS\":"), p->secs);
+
+            if (present->km) c = formatNumber(formatName(c, ", \"KM\":"), p->km);
+            if (present->watts) c = formatNumber(formatName(c, ", \"WATTS\":"), p->watts);
+            if (present->nm) c = formatNumber(formatName(c, ", \"NM\":"), p->nm);
+            if (present->cad) c = formatNumber(formatName(c, ", \"CAD\":"), p->cad);
+            if (present->kph) c = formatNumber(formatName(c, ", \"KPH\":"), p->kph);
+            if (present->hr) c = formatNumber(formatName(c, ", \"HR\":"), p->hr);
+            if (present->alt) c = formatNumber(formatName(c, ", \"ALT\":"), p->alt);
+            if (present->lat) c = formatNumber(formatName(c, ", \"LAT\":"), p->lat, 11);
+            if (present->lon) c = formatNumber(formatName(c, ", \"LON\":"), p->lon, 11);
+            if (present->headwind) c = formatNumber(formatName(c, ", \"HEADWIND\":"), p->headwind);
+            if (present->slope) c = formatNumber(formatName(c, ", \"SLOPE\":"), p->slope);
+            if (present->temp && p->temp != RideFile::noTemp) c = formatNumber(formatName(c, ", \"TEMP\":"), p->temp);
+            if (present->lrbalance) c = formatNumber(formatName(c, ", \"LRBALANCE\":"), p->lrbalance);
 
             // sample points in here!
-            out << " }";
+            c = formatName(c, " }");
+            json.append(line, c - line);
         }
-        out <<"\n\t\t]";
+        json.append("\n\t\t]");
     }
 
     // end of ride and document
-    out << "\n\t}\n}\n";
+    json.append("\n\t}\n}\n");
+
+    bool written = file.write(json) == json.size();
 
     // close
     file.close();
 
-    return true;
+    return written;
 }
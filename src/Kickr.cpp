@@ -22,6 +22,7 @@ Kickr::Kickr(QObject *parent,  DeviceConfiguration *devConf) : QThread(parent)
 {
     this->parent = parent;
     this->devConf = devConf;    
+    recorder = NULL;
     scanned = false;
     mode = -1;
     load = 100;
@@ -93,9 +94,7 @@ double Kickr::getGradient()
 void
 Kickr::getRealtimeData(RealtimeData &rtData)
 {
-    pvars.lock();
-    rtData = rt;
-    pvars.unlock();
+    rtData = published.read();
 }
 
 int
@@ -129,6 +128,7 @@ int Kickr::quit(int code)
  *----------------------------------------------------------------------*/
 void Kickr::run()
 {
+    stats.reset();
     int currentmode = -1;
     int currentload = -1;
     double currentslope= -1;
@@ -177,14 +177,20 @@ void Kickr::run()
 
             // get telemetry
             if (WFApi::getInstance()->hasData(sd)) {
-                pvars.lock();
                 WFApi::getInstance()->getRealtimeData(sd, &rt);
 
                 // set speed from wheelRpm and configured wheelsize
                 double x = rt.getWheelRpm();
                 if (devConf) rt.setSpeed(x * devConf->wheelSize / 1000 * 60 / 1000);
                 else rt.setSpeed(x * 2.10 * 60 / 1000);
-                pvars.unlock();
+                published.publish(rt);
+                stats.arrived();
+                if (recorder) {
+                    recorder->record(recorderDevice, SessionRecorder::Watts, rt.getWatts());
+                    recorder->record(recorderDevice, SessionRecorder::HeartRate, rt.getHr());
+                    recorder->record(recorderDevice, SessionRecorder::Cadence, rt.getCadence());
+                    recorder->record(recorderDevice, SessionRecorder::Speed, rt.getSpeed());
+                }
             }
 
         } else {
@@ -52,6 +52,8 @@ public:
     void setLoad(double x) { myKickr->setLoad(x); }
     void setGradient(double x) { myKickr->setGradient(x); }
     void setMode(int x) { myKickr->setMode(x); }
+    void setRecorder(SessionRecorder *recorder, int device) { myKickr->setRecorder(recorder, device); }
+    DeviceStats *stats() { return &myKickr->stats; }
 
     QString id() { return myKickr->id(); }
 
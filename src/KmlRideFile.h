@@ -22,10 +22,16 @@
 
 #include "RideFile.h"
 
+// writes kml, or kmz when zipped, straight to the file as the
+// points are visited, the document is never built in memory
 struct KmlFileReader : public RideFileReader {
+    KmlFileReader(bool zipped) : zipped(zipped) {}
     virtual RideFile *openRideFile(QFile &, QStringList &, QList<RideFile*>* =0) const { return NULL; } // does not support reading
     bool writeRideFile(Context *, const RideFile *ride, QFile &file) const;
     bool hasWrite() const { return true; }
+
+    private:
+        bool zipped;
 };
 
 #endif // _KmlRideFile_h
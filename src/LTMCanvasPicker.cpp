@@ -11,6 +11,7 @@
 #include <qwt_plot_canvas.h>
 #include <qwt_plot_curve.h>
 #include "LTMCanvasPicker.h"
+#include <math.h>
 
 #include <QDebug>
 
@@ -69,6 +70,16 @@ void LTMCanvasPicker::select(const QPoint &pos, bool clicked)
     int index = -1;
 
     const QwtPlotItemList& itmList = plot()->itemList();
+
+    // forget the curves that have gone
+    if (indexes.count() > itmList.count()) {
+        QHash<const QwtPlotCurve*, CurvePointIndex> keep;
+        foreach(QwtPlotItem *item, itmList)
+            if (item->rtti() == QwtPlotItem::Rtti_PlotCurve && indexes.contains((QwtPlotCurve*)item))
+                keep.insert((QwtPlotCurve*)item, indexes.value((QwtPlotCurve*)item));
+        indexes = keep;
+    }
+
     for ( QwtPlotItemIterator it = itmList.begin();
         it != itmList.end(); ++it )
     {
@@ -77,8 +88,8 @@ void LTMCanvasPicker::select(const QPoint &pos, bool clicked)
             QwtPlotCurve *c = (QwtPlotCurve*)(*it);
 
             double d = -1;
-            int idx = c->closestPoint(pos, &d);
-            if ( d != -1 && d < dist )
+            int idx = indexes[c].closest(plot(), c, pos, 10, &d);
+            if ( idx != -1 && d < dist )
             {
                 curve = c;
                 index = idx;
@@ -109,3 +120,87 @@ void LTMCanvasPicker::select(const QPoint &pos, bool clicked)
 
     }
 }
+
+//
+// CurvePointIndex
+//
+bool
+CurvePointIndex::stale(const QwtPlot *plot, const QwtPlotCurve *curve, int tolerance) const
+{
+    if (size < 0 || data != curve->data() || size != int(curve->dataSize()) || cell != tolerance) return true;
+    if (canvas != plot->canvas()->contentsRect()) return true;
+
+    const QwtScaleMap xMap = plot->canvasMap(curve->xAxis());
+    const QwtScaleMap yMap = plot->canvasMap(curve->yAxis());
+    return scale[0] != xMap.s1() || scale[1] != xMap.s2() || scale[2] != xMap.p1() || scale[3] != xMap.p2() ||
+           scale[4] != yMap.s1() || scale[5] != yMap.s2() || scale[6] != yMap.p1() || scale[7] != yMap.p2();
+}
+
+void
+CurvePointIndex::build(const QwtPlot *plot, const QwtPlotCurve *curve, int tolerance)
+{
+    const QwtScaleMap xMap = plot->canvasMap(curve->xAxis());
+    const QwtScaleMap yMap = plot->canvasMap(curve->yAxis());
+
+    data = curve->data();
+    size = curve->dataSize();
+    scale[0] = xMap.s1(); scale[1] = xMap.s2(); scale[2] = xMap.p1(); scale[3] = xMap.p2();
+    scale[4] = yMap.s1(); scale[5] = yMap.s2(); scale[6] = yMap.p1(); scale[7] = yMap.p2();
+    canvas = plot->canvas()->contentsRect();
+    cell = qMax(1, tolerance);
+
+    // the canvas and a cell's width around it, points further
+    // out than that can't be picked from the canvas
+    cols = canvas.width() / cell + 3;
+    rows = canvas.height() / cell + 3;
+
+    // which cell each point is in, -1 when off the grid
+    at.resize(size);
+    QVector<int> cells(size);
+    first.fill(0, cols * rows + 1);
+    for (int i=0; i<size; i++) {
+        const QPointF sample = curve->sample(i);
+        at[i] = QPointF(xMap.transform(sample.x()), yMap.transform(sample.y()));
+
+        double x = at[i].x() / cell + 1, y = at[i].y() / cell + 1;
+        if (x >= 0 && y >= 0 && x < cols && y < rows) { // not nan either
+            cells[i] = int(y) * cols + int(x);
+            first[cells[i] + 1]++;
+        } else cells[i] = -1;
+    }
+
+    // counted into place
+    for (int i=1; i<first.count(); i++) first[i] += first[i-1];
+    points.resize(first.last());
+    QVector<int> next = first;
+    for (int i=0; i<size; i++) if (cells[i] >= 0) points[next[cells[i]]++] = i;
+}
+
+int
+CurvePointIndex::closest(const QwtPlot *plot, const QwtPlotCurve *curve, const QPoint &pos,
+                         int tolerance, double *dist)
+{
+    if (stale(plot, curve, tolerance)) build(plot, curve, tolerance);
+
+    // tolerance is a cell so the closest is in the cells around
+    int col = pos.x() / cell + 1, row = pos.y() / cell + 1;
+    int index = -1;
+    double best = tolerance * tolerance;
+    for (int r = qMax(0, row - 1); r <= qMin(rows - 1, row + 1); r++) {
+        for (int c = qMax(0, col - 1); c <= qMin(cols - 1, col + 1); c++) {
+            int cellno = r * cols + c;
+            for (int i = first[cellno]; i < first[cellno + 1]; i++) {
+                double dx = at[points[i]].x() - pos.x();
+                double dy = at[points[i]].y() - pos.y();
+                double d = dx * dx + dy * dy;
+                if (d < best) {
+                    best = d;
+                    index = points[i];
+                }
+            }
+        }
+    }
+
+    if (dist) *dist = index >= 0 ? sqrt(best) : -1;
+    return index;
+}
@@ -6,12 +6,46 @@
 #include "GoldenCheetah.h"
 
 #include <qobject.h>
+#include <qvector.h>
+#include <qhash.h>
+#include <qrect.h>
 
 class QPoint;
 class QCustomEvent;
 class QwtPlot;
 class QwtPlotCurve;
 
+// Where a curve's points are on the canvas, bucketed into a grid of cells
+// as wide as the pick tolerance so a hover only looks at the points in the
+// cells around it rather than all of them. It is built when first asked
+// and again whenever the curve's data, the scales or the canvas change,
+// which is to say when it has been replotted
+class CurvePointIndex
+{
+    public:
+        CurvePointIndex() : data(NULL), size(-1), cols(0), rows(0) {}
+
+        // the point within tolerance pixels of pos closest to it, or -1
+        int closest(const QwtPlot *plot, const QwtPlotCurve *curve, const QPoint &pos,
+                    int tolerance, double *dist);
+
+    private:
+        bool stale(const QwtPlot *plot, const QwtPlotCurve *curve, int tolerance) const;
+        void build(const QwtPlot *plot, const QwtPlotCurve *curve, int tolerance);
+
+        // what it was built for
+        const void *data;
+        int size;
+        double scale[8]; // x and y maps, s1 s2 p1 p2
+        QRect canvas;
+        int cell;
+
+        int cols, rows;
+        QVector<int> first;  // into points, by cell and one past the last
+        QVector<int> points; // sample indexes, cell by cell
+        QVector<QPointF> at; // where each sample is, in pixels
+};
+
 class LTMCanvasPicker: public QObject
 {
     Q_OBJECT
@@ -32,6 +66,8 @@ private:
     const QwtPlot *plot() const { return (QwtPlot *)parent(); }
     QwtPlotCurve *d_selectedCurve;
     int d_selectedPoint;
+
+    QHash<const QwtPlotCurve*, CurvePointIndex> indexes; // stale ones are rebuilt
 };
 
 #endif
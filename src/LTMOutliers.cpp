@@ -18,13 +18,16 @@
 
 #include <math.h>
 #include <float.h>
+#include <algorithm>
 #include "LTMOutliers.h"
 
 #include <QDebug>
 
 
-LTMOutliers::LTMOutliers(double *xdata, double *ydata, int count, int windowsize, bool absolute) : stdDeviation(0.0)
+LTMOutliers::LTMOutliers(double *xdata, double *ydata, int count, int windowsize, bool absolute, int top) : stdDeviation(0.0)
 {
+    rank.reserve(count);
+
     double sum = 0;
     int points = 0;
     double allSum = 0.0;
@@ -85,6 +88,10 @@ LTMOutliers::LTMOutliers(double *xdata, double *ydata, int count, int windowsize
     // calculate the average deviation across all points
     stdDeviation = allSum / (double)points;
 
-    // create a ranked list
-    qSort(rank);
+    // create a ranked list, callers after the worst few
+    // don't need to pay to sort the rest of a long history
+    if (top > 0 && top < rank.count())
+        std::partial_sort(rank.begin(), rank.begin() + top, rank.end());
+    else
+        qSort(rank);
 }
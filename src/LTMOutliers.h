@@ -37,8 +37,9 @@ class LTMOutliers
     };
 
     public:
-        // Constructor using arrays of x values and y values
-        LTMOutliers(double *x, double *y, int count, int windowsize, bool absolute=true);
+        // Constructor using arrays of x values and y values, when top is
+        // set only that many ranks are sorted (the rest follow unordered)
+        LTMOutliers(double *x, double *y, int count, int windowsize, bool absolute=true, int top=0);
 
         // ranked values
         int getIndexForRank(int i) { return rank[i].pos; }
@@ -19,6 +19,7 @@
 #include "Athlete.h"
 #include "Context.h"
 #include "LTMPlot.h"
+#include "Trace.h"
 #include "LTMTool.h"
 #include "LTMTrend.h"
 #include "LTMOutliers.h"
@@ -67,6 +68,7 @@ LTMPlot::LTMPlot(LTMWindow *parent, Context *context) :
     configUpdate(); // set basic colors
 
     connect(context, SIGNAL(configChanged()), this, SLOT(configUpdate()));
+    connect(context->athlete->metricDB, SIGNAL(metricsChanged(QDate)), this, SLOT(clearColumns()));
 }
 
 LTMPlot::~LTMPlot()
@@ -81,6 +83,15 @@ LTMPlot::configUpdate()
     QPen gridPen(GColor(CPLOTGRID));
     //gridPen.setStyle(Qt::DotLine);
     grid->setPen(gridPen);
+
+    // units may have changed
+    clearColumns();
+}
+
+void
+LTMPlot::clearColumns()
+{
+    columns.clear();
 }
 
 void
@@ -88,8 +99,9 @@ LTMPlot::setAxisTitle(int axis, QString label)
 {
     // setup the default fonts
     QFont stGiles; // hoho - Chart Font St. Giles ... ok you have to be British to get this joke
-    stGiles.fromString(appsettings->value(this, GC_FONT_CHARTLABELS, QFont().toString()).toString());
-    stGiles.setPointSize(appsettings->value(NULL, GC_FONT_CHARTLABELS_SIZE, 8).toInt());
+    SettingsSnapshot snapshot = SettingsSnapshot::current();
+    stGiles.fromString(snapshot.chartLabelsFont);
+    stGiles.setPointSize(snapshot.chartLabelsSize);
 
     QwtText title(label);
     title.setFont(stGiles);
@@ -100,6 +112,7 @@ LTMPlot::setAxisTitle(int axis, QString label)
 void
 LTMPlot::setData(LTMSettings *set)
 {
+    GC_TRACE_SPAN("ltm plot");
     settings = set;
 
     // For each metric in chart, translate units and name if default uname
@@ -230,7 +243,8 @@ LTMPlot::setData(LTMSettings *set)
     }
 
     // setup the curves
-    double width = appsettings->value(this, GC_LINEWIDTH, 2.0).toDouble();
+    double width = SettingsSnapshot::current().lineWidth;
+    bool antialias = SettingsSnapshot::current().antiAlias;
     bool donestack = false;
 
     // now we iterate over the metric details AGAIN
@@ -271,7 +285,7 @@ LTMPlot::setData(LTMSettings *set)
         else
             curves.insert(metricDetail.symbol, current);
         stacks.insert(current, stackcounter+1);
-        if (appsettings->value(this, GC_ANTIALIAS, false).toBool() == true)
+        if (antialias == true)
             current->setRenderHint(QwtPlotItem::RenderAntialiased);
         QPen cpen = QPen(metricDetail.penColor);
         cpen.setWidth(width);
@@ -415,7 +429,7 @@ LTMPlot::setData(LTMSettings *set)
             curves.insert(metricDetail.bestSymbol, current);
         else
             curves.insert(metricDetail.symbol, current);
-        if (appsettings->value(this, GC_ANTIALIAS, false).toBool() == true)
+        if (antialias == true)
             current->setRenderHint(QwtPlotItem::RenderAntialiased);
         QPen cpen = QPen(metricDetail.penColor);
         cpen.setWidth(width);
@@ -469,7 +483,7 @@ LTMPlot::setData(LTMSettings *set)
             cpen.setWidth(width*2); // double thickness for trend lines
             cpen.setStyle(Qt::DotLine);
             trend->setPen(cpen);
-            if (appsettings->value(this, GC_ANTIALIAS, false).toBool()==true)
+            if (antialias == true)
                 trend->setRenderHint(QwtPlotItem::RenderAntialiased);
             trend->setBaseline(0);
             trend->setYAxis(axisid);
@@ -493,7 +507,7 @@ LTMPlot::setData(LTMSettings *set)
         // highlight outliers
         if (metricDetail.topOut > 0 && metricDetail.topOut < count && count > 10) {
 
-            LTMOutliers outliers(xdata.data(), ydata.data(), count, 10);
+            LTMOutliers outliers(xdata.data(), ydata.data(), count, 10, true, metricDetail.topOut);
 
             // the top 5 outliers
             QVector<double> hxdata, hydata;
@@ -793,7 +807,7 @@ LTMPlot::createTODCurveData(LTMSettings *settings, MetricDetail metricDetail, QV
     foreach (SummaryMetrics rideMetrics, *(settings->data)) {
 
         // filter out unwanted rides
-        if (context->isfiltered && !context->filters.contains(rideMetrics.getFileName())) continue;
+        if (context->isfiltered && !context->filterSet.contains(rideMetrics.getFileName())) continue;
 
         double value = rideMetrics.getForSymbol(metricDetail.symbol);
 
@@ -841,10 +855,146 @@ LTMPlot::createTODCurveData(LTMSettings *settings, MetricDetail metricDetail, QV
     }
 }
 
+// which of the settings lists the values for a curve come from
+static const QList<SummaryMetrics> *
+listFor(LTMSettings *settings, const MetricDetail &metricDetail)
+{
+    switch (metricDetail.type) {
+    case METRIC_DB:
+    case METRIC_META: return settings->data;
+    case METRIC_MEASURE: return settings->measures;
+    case METRIC_BEST: return settings->bests;
+    default: return NULL;
+    }
+}
+
+// the key for a curve's column of values
+static QString
+columnFor(const MetricDetail &metricDetail)
+{
+    return QString("%1|%2").arg(metricDetail.type).arg(metricDetail.type == METRIC_BEST ?
+                                                       metricDetail.bestSymbol : metricDetail.symbol);
+}
+
+LTMPlot::LTMColumns &
+LTMPlot::columnsFor(LTMSettings *settings, const QList<SummaryMetrics> *data)
+{
+    // have the rides or the filter changed ?
+    uint fingerprint = data->count();
+    foreach (const SummaryMetrics &x, *data)
+        fingerprint = (fingerprint * 31) + qHash(x.getFileName()) + x.getRideDate().date().toJulianDay();
+    if (context->isfiltered) fingerprint ^= qHash(context->filters.join("|"));
+
+    LTMColumns &c = columns[data];
+    if (c.fingerprint != fingerprint || c.start != settings->start.date()
+        || c.groupBy != settings->groupBy || c.group.count() != data->count()) {
+
+        c = LTMColumns();
+        c.fingerprint = fingerprint;
+        fillColumns(c, settings, data, true);
+    }
+
+    // get the values for all the curves on this chart in one go
+    QList<MetricDetail> wanted;
+    foreach (MetricDetail metricDetail, settings->metrics)
+        if (listFor(settings, metricDetail) == data && !c.values.contains(columnFor(metricDetail)))
+            wanted << metricDetail;
+    if (wanted.count()) addColumns(c, data, wanted);
+
+    return c;
+}
+
+void
+LTMPlot::fillColumns(LTMColumns &c, LTMSettings *settings, const QList<SummaryMetrics> *data, bool filter)
+{
+    c.start = settings->start.date();
+    c.groupBy = settings->groupBy;
+    c.group.resize(data->count());
+    c.seconds.resize(data->count());
+    c.wanted.resize(data->count());
+
+    QSet<QString> filters;
+    if (filter && context->isfiltered) filters = context->filterSet;
+    int workout_time = RideMetricFactory::instance().metricIndex("workout_time");
+
+    for (int i=0; i<data->count(); i++) {
+        const SummaryMetrics &rideMetrics = data->at(i);
+        c.group[i] = groupForDate(rideMetrics.getRideDate().date(), settings->groupBy);
+        c.seconds[i] = workout_time >= 0 ? rideMetrics.getForIndex(workout_time)
+                                         : rideMetrics.getForSymbol("workout_time");
+        c.wanted[i] = !(filter && context->isfiltered) || filters.contains(rideMetrics.getFileName());
+    }
+}
+
+void
+LTMPlot::addColumns(LTMColumns &c, const QList<SummaryMetrics> *data, QList<MetricDetail> metrics)
+{
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+
+    // where each value comes from
+    QVector<QVector<double>*> into(metrics.count());
+    QVector<int> index(metrics.count());
+    for (int m=0; m<metrics.count(); m++) {
+        QVector<double> &column = c.values[columnFor(metrics[m])];
+        column.resize(data->count());
+        into[m] = &column;
+        index[m] = metrics[m].type == METRIC_MEASURE ? -1 :
+                   factory.metricIndex(metrics[m].type == METRIC_BEST ? metrics[m].bestSymbol : metrics[m].symbol);
+    }
+
+    for (int i=0; i<data->count(); i++) {
+        const SummaryMetrics &rideMetrics = data->at(i);
+
+        for (int m=0; m<metrics.count(); m++) {
+
+            // value for day -- measures are stored differently
+            double value;
+            if (metrics[m].type == METRIC_MEASURE)
+                value = rideMetrics.getText(metrics[m].symbol, "0.0").toDouble();
+            else if (index[m] >= 0)
+                value = rideMetrics.getForIndex(index[m]);
+            else if (metrics[m].type == METRIC_BEST)
+                value = rideMetrics.getForSymbol(metrics[m].bestSymbol);
+            else
+                value = rideMetrics.getForSymbol(metrics[m].symbol);
+
+            (*into[m])[i] = value;
+        }
+    }
+}
+
 void
 LTMPlot::createCurveData(LTMSettings *settings, MetricDetail metricDetail, QVector<double>&x,QVector<double>&y,int&n)
 {
-    QList<SummaryMetrics> *data = NULL;
+    // Get metric data, either from metricDB for RideFile metrics
+    // or from StressCalculator for PM type metrics
+    QList<SummaryMetrics> PMCdata;
+    LTMColumns PMCcolumns;
+    LTMColumns *c;
+    if (metricDetail.type == METRIC_PM) {
+        // filtering is done in the stress calculator
+        createPMCCurveData(settings, metricDetail, PMCdata);
+        fillColumns(PMCcolumns, settings, &PMCdata, false);
+        addColumns(PMCcolumns, &PMCdata, QList<MetricDetail>() << metricDetail);
+        c = &PMCcolumns;
+    } else if (listFor(settings, metricDetail)) {
+        c = &columnsFor(settings, listFor(settings, metricDetail));
+    } else {
+        // nothing to plot
+        c = &PMCcolumns;
+    }
+
+    // already done it?
+    bool wantZero = (metricDetail.curveStyle == QwtPlotCurve::Steps);
+    QString curveKey = QString("%1|%2|%3|%4").arg(columnFor(metricDetail)).arg(metricDetail.uunits)
+                       .arg(wantZero).arg(settings->end.date().toJulianDay());
+    if (c->curves.contains(curveKey)) {
+        const LTMCurve &curve = c->curves[curveKey];
+        x = curve.x;
+        y = curve.y;
+        n = curve.n;
+        return;
+    }
 
     // resize the curve array to maximum possible size
     int maxdays = groupForDate(settings->end.date(), settings->groupBy)
@@ -852,85 +1002,67 @@ LTMPlot::createCurveData(LTMSettings *settings, MetricDetail metricDetail, QVect
     x.resize(maxdays+3); // one for start from zero plus two for 0 value added at head and tail
     y.resize(maxdays+3); // one for start from zero plus two for 0 value added at head and tail
 
-    // Get metric data, either from metricDB for RideFile metrics
-    // or from StressCalculator for PM type metrics
-    QList<SummaryMetrics> PMCdata;
-    if (metricDetail.type == METRIC_DB || metricDetail.type == METRIC_META) {
-        data = settings->data;
-    } else if (metricDetail.type == METRIC_MEASURE) {
-        data = settings->measures;
-    } else if (metricDetail.type == METRIC_PM) {
-        createPMCCurveData(settings, metricDetail, PMCdata);
-        data = &PMCdata;
-    } else if (metricDetail.type == METRIC_BEST) {
-        data = settings->bests;
-    }
+    // sum totals, average averages and choose best for Peaks
+    int type = metricDetail.metric ? metricDetail.metric->type() : RideMetric::Average;
+    if (metricDetail.uunits == "Ramp" ||
+        metricDetail.uunits == tr("Ramp")) type = RideMetric::Total;
+    if (metricDetail.type == METRIC_BEST) type = RideMetric::Peak;
+
+    // Special computed metrics (LTS/STS) have a null metric pointer
+    bool convert = metricDetail.type != METRIC_BEST && metricDetail.metric;
+    bool imperial = convert && context->athlete->useMetricUnits == false;
+    bool hours = convert && (metricDetail.metric->units(true) == "seconds" ||
+                             metricDetail.metric->units(true) == tr("seconds"));
+
+    const QVector<double> &values = c->values[columnFor(metricDetail)];
+    int baseGroup = groupForDate(settings->start.date(), settings->groupBy);
 
     n=-1;
     int lastDay=0;
     unsigned long secondsPerGroupBy=0;
-    bool wantZero = (metricDetail.curveStyle == QwtPlotCurve::Steps);
-    foreach (SummaryMetrics rideMetrics, *data) {
+    for (int i=0; i<values.count(); i++) {
 
-        // filter out unwanted rides but not for PMC type metrics
-        // because that needs to be done in the stress calculator
-        if (metricDetail.type != METRIC_PM && context->isfiltered && 
-            !context->filters.contains(rideMetrics.getFileName())) continue;
+        // filter out unwanted rides
+        if (!c->wanted[i]) continue;
 
         // day we are on
-        int currentDay = groupForDate(rideMetrics.getRideDate().date(), settings->groupBy);
+        int currentDay = c->group[i];
 
-        // value for day -- measures are stored differently
-        double value;
-        if (metricDetail.type == METRIC_MEASURE)
-            value = rideMetrics.getText(metricDetail.symbol, "0.0").toDouble();
-        else if (metricDetail.type == METRIC_BEST)
-            value = rideMetrics.getForSymbol(metricDetail.bestSymbol);
-        else
-            value = rideMetrics.getForSymbol(metricDetail.symbol);
+        // value for day
+        double value = values[i];
 
         // check values are bounded to stop QWT going berserk
         if (isnan(value) || isinf(value)) value = 0;
 
-        // Special computed metrics (LTS/STS) have a null metric pointer
-        if (metricDetail.type != METRIC_BEST && metricDetail.metric) {
+        if (convert) {
             // convert from stored metric value to imperial
-            if (context->athlete->useMetricUnits == false) {
+            if (imperial) {
                 value *= metricDetail.metric->conversion();
                 value += metricDetail.metric->conversionSum();
             }
 
             // convert seconds to hours
-            if (metricDetail.metric->units(true) == "seconds" ||
-                metricDetail.metric->units(true) == tr("seconds")) value /= 3600;
+            if (hours) value /= 3600;
         }
 
         if (value || wantZero) {
-            unsigned long seconds = rideMetrics.getForSymbol("workout_time");
+            unsigned long seconds = c->seconds[i];
             if (metricDetail.type == METRIC_BEST || metricDetail.type == METRIC_MEASURE) seconds = 1;
             if (currentDay > lastDay) {
                 if (lastDay && wantZero) {
                     while (lastDay<currentDay) {
                         lastDay++;
                         n++;
-                        x[n]=lastDay - groupForDate(settings->start.date(), settings->groupBy);
+                        x[n]=lastDay - baseGroup;
                         y[n]=0;
                     }
                 } else {
                     n++;
                 }
                 y[n] = value;
-                x[n] = currentDay - groupForDate(settings->start.date(), settings->groupBy);
+                x[n] = currentDay - baseGroup;
                 secondsPerGroupBy = seconds; // reset for new group
             } else {
-                // sum totals, average averages and choose best for Peaks
-                int type = metricDetail.metric ? metricDetail.metric->type() : RideMetric::Average;
-
-                if (metricDetail.uunits == "Ramp" ||
-                    metricDetail.uunits == tr("Ramp")) type = RideMetric::Total;
-
-                if (metricDetail.type == METRIC_BEST) type = RideMetric::Peak;
-
                 switch (type) {
                 case RideMetric::Total:
                     y[n] += value;
@@ -955,6 +1087,12 @@ LTMPlot::createCurveData(LTMSettings *settings, MetricDetail metricDetail, QVect
             lastDay = currentDay;
         }
     }
+
+    // keep it for next time
+    LTMCurve &curve = c->curves[curveKey];
+    curve.x = x;
+    curve.y = y;
+    curve.n = n;
 }
 
 void
@@ -985,8 +1123,8 @@ LTMPlot::createPMCCurveData(LTMSettings *settings, MetricDetail metricDetail,
             context->athlete->cyclist,
 		    settings->start,
 		    settings->end,
-		    (appsettings->value(this, GC_STS_DAYS,7)).toInt(),
-            (appsettings->value(this, GC_LTS_DAYS,42)).toInt());
+		    SettingsSnapshot::current().stsDays,
+            SettingsSnapshot::current().ltsDays);
 
     sc->calculateStress(context, context->athlete->home.absolutePath(), scoreType, settings->ltmTool->isFiltered(), settings->ltmTool->filters());
 
@@ -54,6 +54,7 @@ class LTMPlot : public QwtPlot
         void pointHover(QwtPlotCurve*, int);
         void pointClicked(QwtPlotCurve*, int); // point clicked
         void configUpdate();
+        void clearColumns();
 
     protected:
         friend class ::LTMPlotBackground;
@@ -87,6 +88,33 @@ class LTMPlot : public QwtPlot
         QVector< QVector<double>* > stackX;
         QVector< QVector<double>* > stackY;
 
+        // The rides in each of the settings lists as columns; the group for
+        // each ride, its duration and whether it is filtered are worked out
+        // once and the values for all the curves pulled out in one pass.
+        // The aggregated curves are kept too, so flipping between charts
+        // over the same rides doesn't aggregate them again.
+        struct LTMCurve {
+            QVector<double> x, y;
+            int n;
+        };
+        struct LTMColumns {
+            LTMColumns() : fingerprint(0), groupBy(-1) {}
+
+            uint fingerprint;           // of the rides and filter
+            QDate start;
+            int groupBy;
+
+            QVector<int> group;         // groupForDate() for each ride
+            QVector<double> seconds;    // workout time for each ride
+            QVector<bool> wanted;       // passes the global filter
+            QHash<QString, QVector<double> > values; // by curve symbol
+            QHash<QString, LTMCurve> curves;
+        };
+        QHash<const QList<SummaryMetrics>*, LTMColumns> columns;
+        LTMColumns &columnsFor(LTMSettings *, const QList<SummaryMetrics> *);
+        void fillColumns(LTMColumns &, LTMSettings *, const QList<SummaryMetrics> *, bool filter);
+        void addColumns(LTMColumns &, const QList<SummaryMetrics> *, QList<MetricDetail>);
+
         int groupForDate(QDate , int);
         void createCurveData(LTMSettings *, MetricDetail,
                              QVector<double>&, QVector<double>&, int&);
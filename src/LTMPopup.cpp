@@ -232,7 +232,15 @@ LTMPopup::setData(LTMSettings &settings, QDate start, QDate end)
          rides->setHorizontalHeaderItem(column++,h);
     }
 
-    foreach(SummaryMetrics x, (*settings.data)) {
+    // the chart only fetched the metrics it plots, but the
+    // summary can show any, so read all of them for these rides
+    QSet<QString> plotted;
+    foreach(SummaryMetrics x, (*settings.data)) plotted << x.getFileName();
+    QList<SummaryMetrics> all = context->athlete->metricDB->getAllMetricsFor(QDateTime(start, QTime(0,0,0)),
+                                                                           QDateTime(end, QTime(23,59,59)));
+
+    foreach(SummaryMetrics x, all) {
+        if (!plotted.contains(x.getFileName())) continue;
         QDateTime rideDate = x.getRideDate();
         if (rideDate.date() >= start && rideDate.date() <= end) {
 
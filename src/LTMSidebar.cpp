@@ -25,6 +25,7 @@
 #include <QApplication>
 #include <QWebView>
 #include <QWebFrame>
+#include <QTimer>
 #include <QtGui>
 
 // seasons support
@@ -135,6 +136,13 @@ LTMSidebar::LTMSidebar(Context *context) : QWidget(context->mainWindow), context
 
     connect(this, SIGNAL(dateRangeChanged(DateRange)), this, SLOT(setSummary(DateRange)));
 
+    // once the selection has settled the neighbouring seasons are read
+    // into the metricDB season cache, so moving up or down is instant
+    prefetchTimer = new QTimer(this);
+    prefetchTimer->setSingleShot(true);
+    prefetchTimer->setInterval(500);
+    connect(prefetchTimer, SIGNAL(timeout()), this, SLOT(prefetchNeighbours()));
+
     // let everyone know what date range we are starting with
     dateRangeTreeWidgetSelectionChanged();
 
@@ -191,6 +199,7 @@ LTMSidebar::dateRangeTreeWidgetSelectionChanged()
     if (dateRange) emit dateRangeChanged(DateRange(dateRange->start, dateRange->end, dateRange->name));
     else emit dateRangeChanged(DateRange());
 
+    prefetchTimer->start();
 }
 
 /*----------------------------------------------------------------------
@@ -589,38 +598,61 @@ LTMSidebar::editEvent()
     active = false;
 }
 
+// main totals
+static const QStringList totalColumn = QStringList()
+    << "workout_time"
+    << "time_riding"
+    << "total_distance"
+    << "total_work"
+    << "elevation_gain";
+
+static const QStringList averageColumn = QStringList()
+    << "average_speed"
+    << "average_power"
+    << "average_hr"
+    << "average_cad";
+
+static const QStringList maximumColumn = QStringList()
+    << "max_speed"
+    << "max_power"
+    << "max_heartrate"
+    << "max_cadence";
+
+// user defined
+static QStringList
+userSummaryColumns(const QObject *owner)
+{
+    QString s = appsettings->value(owner, GC_SETTINGS_SUMMARY_METRICS, GC_SETTINGS_SUMMARY_METRICS_DEFAULT).toString();
+
+    // in case they were set tand then unset
+    if (s == "") s = GC_SETTINGS_SUMMARY_METRICS_DEFAULT;
+    return s.split(",");
+}
+
+void
+LTMSidebar::prefetchNeighbours()
+{
+    if (dateRangeTree->selectedItems().isEmpty()) return;
+    QTreeWidgetItem *which = dateRangeTree->selectedItems().first();
+    if (which == allDateRanges) return;
+
+    QStringList symbols = QStringList() << totalColumn << averageColumn << maximumColumn << userSummaryColumns(this);
+
+    int index = allDateRanges->indexOfChild(which);
+    for (int i=index-1; i<=index+1; i += 2) {
+        if (i < 0 || i >= seasons->seasons.count()) continue;
+        const Season &season = seasons->seasons.at(i);
+        context->athlete->metricDB->prefetch(DateRange(season.start, season.end, season.name), symbols);
+    }
+}
+
 void
 LTMSidebar::setSummary(DateRange dateRange)
 {
     // where we construct the text
     QString summaryText("");
 
-    // main totals
-    static const QStringList totalColumn = QStringList()
-        << "workout_time"
-        << "time_riding"
-        << "total_distance"
-        << "total_work"
-        << "elevation_gain";
-
-    static const QStringList averageColumn = QStringList()
-        << "average_speed"
-        << "average_power"
-        << "average_hr"
-        << "average_cad";
-
-    static const QStringList maximumColumn = QStringList()
-        << "max_speed"
-        << "max_power"
-        << "max_heartrate"
-        << "max_cadence";
-
-    // user defined
-    QString s = appsettings->value(this, GC_SETTINGS_SUMMARY_METRICS, GC_SETTINGS_SUMMARY_METRICS_DEFAULT).toString();
-
-    // in case they were set tand then unset
-    if (s == "") s = GC_SETTINGS_SUMMARY_METRICS_DEFAULT;
-    QStringList metricColumn = s.split(",");
+    QStringList metricColumn = userSummaryColumns(this);
 
     // what date range should we use?
     QDate newFrom = dateRange.from;
@@ -633,9 +665,6 @@ LTMSidebar::setSummary(DateRange dateRange)
         from = newFrom;
         to = newTo;
 
-        // lets get the metrics
-        QList<SummaryMetrics>results = context->athlete->metricDB->getAllMetricsFor(QDateTime(from,QTime(0,0,0)), QDateTime(to, QTime(24,59,59)));
-
         // foreach of the metrics get an aggregated value
         // header of summary
         summaryText = QString("<!DOCTYPE html PUBLIC \"-//W3C//DTD HTML 3.2//EN\">"
@@ -685,8 +714,8 @@ LTMSidebar::setSummary(DateRange dateRange)
 
                 const RideMetric *metric = RideMetricFactory::instance().rideMetric(metricname);
 
-                QStringList empty; // filter list not used at present
-                QString value = SummaryMetrics::getAggregated(context, metricname, results, empty, false, context->athlete->useMetricUnits);
+                // aggregated once per season and kept by the metricDB
+                QString value = context->athlete->metricDB->getAggregatedFor(dateRange, metricname, context->athlete->useMetricUnits);
 
                 // Maximum Max and Average Average looks nasty, remove from name for display
                 QString s = metric ? metric->name().replace(QRegExp(tr("^(Average|Max) ")), "") : "unknown";
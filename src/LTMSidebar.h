@@ -34,6 +34,7 @@
 #include <QtGui>
 
 class QWebView;
+class QTimer;
 class LTMSidebar : public QWidget
 {
     Q_OBJECT
@@ -79,6 +80,9 @@ class LTMSidebar : public QWidget
         // gui components
         void setSummary(DateRange);
 
+        // read the seasons either side of the selection whilst idle
+        void prefetchNeighbours();
+
     private:
 
         Context *context;
@@ -96,6 +100,7 @@ class LTMSidebar : public QWidget
         QTreeWidgetItem *allEvents;
 
         QWebView *summary;
+        QTimer *prefetchTimer;
 
         GcSplitter *splitter;
 };
@@ -23,24 +23,26 @@
 #include <QDebug>
 
 LTMTrend::LTMTrend(double *xdata, double *ydata, int count) :
-          points(0.0), sumX(0.0), sumY(0.0), sumXsquared(0.0),
-          sumYsquared(0.0), sumXY(0.0), a(0.0), b(0.0)
+          points(0), meanX(0.0), meanY(0.0), sumXXdev(0.0),
+          sumXYdev(0.0), a(0.0), b(0.0)
 {
     if (count <= 2) return;
 
+    // one pass updating the means and the sums of deviations from
+    // them (Welford), raw sums of squares lose the slope to rounding
+    // when x is large and the history is long
     for (int i = 0; i < count; i++) {
         points++;
-        sumX += xdata[i];
-        sumY += ydata[i];
-        sumXsquared += xdata[i] * xdata[i];
-        sumYsquared += ydata[i] * ydata[i];
-        sumXY += xdata[i] * ydata[i];
+        double dx = xdata[i] - meanX;
+        meanX += dx / double(points);
+        meanY += (ydata[i] - meanY) / double(points);
+        sumXXdev += dx * (xdata[i] - meanX);
+        sumXYdev += dx * (ydata[i] - meanY);
     }
 
-    if (fabs( double(points) * sumXsquared - sumX * sumX) > DBL_EPSILON) {
-        b = ( double(points) * sumXY - sumY * sumX) /
-            ( double(points) * sumXsquared - sumX * sumX);
-        a = (sumY - b * sumX) / double(points);
+    if (sumXXdev > DBL_EPSILON) {
+        b = sumXYdev / sumXXdev;
+        a = meanY - b * meanX;
     }
 }
 
@@ -29,10 +29,9 @@ class LTMTrend
 
     protected:
         long points;
-        double sumX, sumY;
-        double sumXsquared,
-               sumYsquared;
-        double sumXY;
+        double meanX, meanY;    // running means
+        double sumXXdev;        // sum of squared x deviations from the mean
+        double sumXYdev;        // sum of x,y co-deviations from the mean
         double a, b;   // a = intercept, b = slope
 };
 
@@ -207,6 +207,19 @@ LTMWindow::useThruToday()
     dateRangeChanged(custom);
 }
 
+// the metrics and metadata the curves plot, we don't
+// fetch the hundreds of other columns for every ride
+static QStringList
+symbolsFor(const LTMSettings &settings)
+{
+    QStringList symbols;
+    symbols << "workout_time"; // to weight averages
+    foreach (MetricDetail metricDetail, settings.metrics)
+        if (metricDetail.type == METRIC_DB || metricDetail.type == METRIC_META)
+            symbols << metricDetail.symbol;
+    return symbols;
+}
+
 // total redraw, reread data etc
 void
 LTMWindow::refresh()
@@ -216,7 +229,7 @@ LTMWindow::refresh()
     if (amVisible() == true && context->athlete->metricDB != NULL) {
 
         results.clear(); // clear any old data
-        results = context->athlete->metricDB->getAllMetricsFor(settings.start, settings.end);
+        results = context->athlete->metricDB->getMetricsFor(settings.start, settings.end, symbolsFor(settings));
         measures.clear(); // clear any old data
         measures = context->athlete->metricDB->getAllMeasuresFor(settings.start, settings.end);
         bestsresults.clear();
@@ -284,7 +297,7 @@ LTMWindow::filterChanged()
 
     // we need to get data again and apply filter
     results.clear(); // clear any old data
-    results = context->athlete->metricDB->getAllMetricsFor(settings.start, settings.end);
+    results = context->athlete->metricDB->getMetricsFor(settings.start, settings.end, symbolsFor(settings));
     measures.clear(); // clear any old data
     measures = context->athlete->metricDB->getAllMeasuresFor(settings.start, settings.end);
     bestsresults.clear();
@@ -29,6 +29,7 @@
 LibUsb::LibUsb(int type) : type(type)
 {
 
+    device = NULL;
     intf = NULL;
     readBufIndex = 0;
     readBufSize = 0;
@@ -40,6 +41,11 @@ LibUsb::LibUsb(int type) : type(type)
     usb_find_devices();
 }
 
+LibUsb::~LibUsb()
+{
+    close();
+}
+
 int LibUsb::open()
 {
     // reset counters
@@ -104,7 +110,7 @@ void LibUsb::close()
     }
 }
 
-int LibUsb::read(char *buf, int bytes)
+int LibUsb::read(char *buf, int bytes, int timeout)
 {
     // check it isn't closed already
     if (!device) return -1;
@@ -132,7 +138,7 @@ int LibUsb::read(char *buf, int bytes)
     readBufSize = 0;
     readBufIndex = 0;
 
-    int rc = usb_bulk_read(device, readEndpoint, readBuf, 64, 125);
+    int rc = usb_bulk_read(device, readEndpoint, readBuf, 64, timeout);
     if (rc < 0)
     {
         // don't report timeouts - lots of noise so commented out
@@ -491,7 +497,7 @@ void LibUsb::close()
 {
 }
 
-int LibUsb::read(char *, int)
+int LibUsb::read(char *, int, int)
 {
     return -1;
 }
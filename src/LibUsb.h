@@ -26,7 +26,15 @@
 #include <windows.h>
 #endif
 
+#ifdef GC_HAVE_LIBUSB1
+#include <libusb.h> // asynchronous transfers and hotplug
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QList>
+#else
 #include <usb.h> // for the constants etc
+#endif
 
 // EZ-USB firmware loader for Fortius
 extern "C" {
@@ -55,13 +63,49 @@ class LibUsb {
 
 public:
     LibUsb(int type);
+    ~LibUsb();
     int open();
     void close();
-    int read(char *buf, int bytes);
+    int read(char *buf, int bytes, int timeout = 125);
     int write(char *buf, int bytes);
     bool find();
 private:
 
+#ifdef GC_HAVE_LIBUSB1
+    // libusb-1.0: reads are kept queued on the device so packets are
+    // collected as they arrive, completions are handled on one event
+    // thread shared by all devices and read() just waits for a packet
+    static const int inflight = 4;
+
+    static void LIBUSB_CALL readComplete(struct libusb_transfer *transfer);
+    static int LIBUSB_CALL hotplug(libusb_context *, libusb_device *, libusb_hotplug_event event, void *user);
+
+    bool matches(const struct libusb_device_descriptor &desc) const;
+    libusb_device_handle *openMatching();
+    libusb_device_handle *OpenAntStick();
+    libusb_device_handle *OpenFortius();
+    bool claim(libusb_device_handle *udev);
+
+    libusb_context *ctx;            // shared, NULL if libusb failed to start
+    libusb_device_handle *device;
+    struct libusb_transfer *transfers[inflight];
+    unsigned char transferBuf[inflight][64];
+    int pending;                    // transfers not yet completed or cancelled
+    libusb_hotplug_callback_handle hotplugHandle;
+    bool hotplugging;
+    int present;                    // devices attached, as told by hotplug
+
+    QMutex lock;                    // all below and pending/present above
+    QWaitCondition arrived;
+    QList<QByteArray> packets;      // read but not yet returned
+    QByteArray readBuf;             // the last packet, partly returned
+    bool failed;                    // device went away or transfer errored
+
+    int readEndpoint, writeEndpoint;
+    int interface;
+    int alternate;
+#else
+
     struct usb_dev_handle* OpenAntStick();
     struct usb_dev_handle* OpenFortius();
     bool findAntStick();
@@ -79,6 +123,7 @@ private:
     int readBufIndex;
     int readBufSize;
 
+#endif
     int type;
 };
 #endif
@@ -0,0 +1,496 @@
+/*
+ * Copyright (c) 2011 Darren Hague & Eric Brandt
+ *               Modified to suport Linux and OSX by Mark Liversedge
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// The libusb-1.0 backend for LibUsb, used instead of LibUsb.cpp when
+// GC_HAVE_LIBUSB1 is defined. Reads are asynchronous: a few bulk
+// transfers are kept queued on the read endpoint and the packets they
+// collect are handed out by read(). Completions and hotplug events for
+// every device are handled on a single event thread.
+
+#if defined GC_HAVE_LIBUSB && defined GC_HAVE_LIBUSB1
+#include <QString>
+#include <QDebug>
+#include <QThread>
+#include <QTime>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <errno.h>
+#endif
+#include "LibUsb.h"
+#include "Settings.h"
+#include "Context.h"
+
+// the most packets we hold on to if nobody is reading them
+static const int maxPackets = 256;
+
+// handles libusb events for all the devices open, it runs for
+// as long as there are LibUsb instances using the context
+class LibUsbEvents : public QThread
+{
+    public:
+        static libusb_context *acquire();
+        static void release();
+
+    protected:
+        void run();
+
+    private:
+        LibUsbEvents() : ctx(NULL), users(0), stop(false) {}
+
+        static QMutex mutex;
+        static LibUsbEvents *events;
+
+        libusb_context *ctx;
+        int users;
+        volatile bool stop;
+};
+
+QMutex LibUsbEvents::mutex;
+LibUsbEvents *LibUsbEvents::events = NULL;
+
+libusb_context *
+LibUsbEvents::acquire()
+{
+    QMutexLocker locker(&mutex);
+
+    if (events == NULL) {
+        events = new LibUsbEvents;
+        if (libusb_init(&events->ctx) < 0) {
+            qDebug()<<"libusb_init failed, USB2 devices will not be available";
+            delete events;
+            events = NULL;
+            return NULL;
+        }
+        events->start();
+    }
+    events->users++;
+    return events->ctx;
+}
+
+void
+LibUsbEvents::release()
+{
+    QMutexLocker locker(&mutex);
+
+    if (events == NULL || --events->users) return;
+
+    // the event loop wakes up at least every 250ms to notice
+    events->stop = true;
+    events->wait();
+    libusb_exit(events->ctx);
+    delete events;
+    events = NULL;
+}
+
+void
+LibUsbEvents::run()
+{
+    while (!stop) {
+        struct timeval tv = { 0, 250000 };
+        libusb_handle_events_timeout_completed(ctx, &tv, NULL);
+    }
+}
+
+LibUsb::LibUsb(int type) : type(type)
+{
+    device = NULL;
+    pending = 0;
+    present = 0;
+    failed = false;
+    hotplugging = false;
+    for (int i=0; i<inflight; i++) transfers[i] = NULL;
+
+    ctx = LibUsbEvents::acquire();
+    if (!ctx) return;
+
+    // when the platform can tell us devices come and go we don't
+    // need to scan the busses every time we are asked to find()
+    if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+        int rc = libusb_hotplug_register_callback(ctx,
+                    (libusb_hotplug_event) (LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+                    LIBUSB_HOTPLUG_ENUMERATE, type == TYPE_FORTIUS ? FORTIUS_VID : GARMIN_USB2_VID,
+                    LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, hotplug, this, &hotplugHandle);
+        hotplugging = (rc == LIBUSB_SUCCESS);
+    }
+}
+
+LibUsb::~LibUsb()
+{
+    close();
+    if (ctx) {
+        if (hotplugging) libusb_hotplug_deregister_callback(ctx, hotplugHandle);
+        LibUsbEvents::release();
+    }
+}
+
+bool LibUsb::matches(const struct libusb_device_descriptor &desc) const
+{
+    switch (type) {
+
+    default:
+    case TYPE_ANT:
+        return desc.idVendor == GARMIN_USB2_VID &&
+               (desc.idProduct == GARMIN_USB2_PID || desc.idProduct == GARMIN_OEM_PID);
+
+    case TYPE_FORTIUS:
+        return desc.idVendor == FORTIUS_VID &&
+               (desc.idProduct == FORTIUS_INIT_PID || desc.idProduct == FORTIUS_PID ||
+                desc.idProduct == FORTIUSVR_PID);
+    }
+}
+
+// called on the event thread, including for the devices already
+// attached when we register
+int LIBUSB_CALL LibUsb::hotplug(libusb_context *, libusb_device *dev, libusb_hotplug_event event, void *user)
+{
+    LibUsb *me = static_cast<LibUsb*>(user);
+
+    struct libusb_device_descriptor desc;
+    if (libusb_get_device_descriptor(dev, &desc) < 0 || !me->matches(desc)) return 0;
+
+    QMutexLocker locker(&me->lock);
+    if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED) {
+        me->present++;
+    } else {
+        if (me->present) me->present--;
+
+        // it was ours, so wake any reader to tell them
+        if (me->device && libusb_get_device(me->device) == dev) {
+            me->failed = true;
+            me->arrived.wakeAll();
+        }
+    }
+    return 0;
+}
+
+bool LibUsb::find()
+{
+    if (!ctx) return false;
+
+    if (hotplugging) {
+        QMutexLocker locker(&lock);
+        return present > 0;
+    }
+
+    bool found = false;
+    libusb_device **list;
+    ssize_t count = libusb_get_device_list(ctx, &list);
+    for (ssize_t i=0; i<count && !found; i++) {
+        struct libusb_device_descriptor desc;
+        if (libusb_get_device_descriptor(list[i], &desc) == 0 && matches(desc)) found = true;
+    }
+    if (count >= 0) libusb_free_device_list(list, 1);
+    return found;
+}
+
+int LibUsb::open()
+{
+    if (!ctx) return -1;
+
+    // reopening starts afresh
+    close();
+
+    switch (type) {
+
+    // Search USB busses for USB2 ANT+ stick host controllers
+    default:
+    case TYPE_ANT: device = OpenAntStick();
+              break;
+
+    case TYPE_FORTIUS: device = OpenFortius();
+              break;
+    }
+
+    if (device == NULL) return -1;
+
+    // Clear halt is needed, but ignore return code
+    libusb_clear_halt(device, writeEndpoint);
+    libusb_clear_halt(device, readEndpoint);
+
+    // queue up the reads, they stay queued until we close
+    QMutexLocker locker(&lock);
+    failed = false;
+    packets.clear();
+    readBuf.clear();
+    for (int i=0; i<inflight; i++) {
+        transfers[i] = libusb_alloc_transfer(0);
+        libusb_fill_bulk_transfer(transfers[i], device, readEndpoint, transferBuf[i], sizeof(transferBuf[i]),
+                                  readComplete, this, 0);
+        if (libusb_submit_transfer(transfers[i]) == 0) pending++;
+    }
+
+    if (pending == 0) {
+        qDebug()<<"libusb_submit_transfer failed, cannot read from USB2 device";
+        locker.unlock();
+        close();
+        return -1;
+    }
+    return 0;
+}
+
+// called on the event thread as each read completes
+void LIBUSB_CALL LibUsb::readComplete(struct libusb_transfer *transfer)
+{
+    LibUsb *me = static_cast<LibUsb*>(transfer->user_data);
+    QMutexLocker locker(&me->lock);
+
+    if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+
+        if (transfer->actual_length > 0) {
+            if (me->packets.count() == maxPackets) me->packets.removeFirst();
+            me->packets << QByteArray((const char*)transfer->buffer, transfer->actual_length);
+            me->arrived.wakeAll();
+        }
+
+        // and go again, unless we are closing
+        if (me->device && libusb_submit_transfer(transfer) == 0) return;
+
+    } else if (transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+
+        // stalled, errored or unplugged
+        me->failed = true;
+    }
+
+    me->pending--;
+    me->arrived.wakeAll();
+}
+
+void LibUsb::close()
+{
+    QMutexLocker locker(&lock);
+    if (!device) return;
+
+    // stop any further reads or writes whilst we close down
+    libusb_device_handle *p = device;
+    device = NULL;
+
+    for (int i=0; i<inflight; i++)
+        if (transfers[i]) libusb_cancel_transfer(transfers[i]);
+
+    // the cancellations complete on the event thread
+    while (pending > 0) arrived.wait(&lock, 250);
+
+    for (int i=0; i<inflight; i++) {
+        if (transfers[i]) libusb_free_transfer(transfers[i]);
+        transfers[i] = NULL;
+    }
+    locker.unlock();
+
+    libusb_release_interface(p, interface);
+    libusb_close(p);
+}
+
+int LibUsb::read(char *buf, int bytes, int timeout)
+{
+    QMutexLocker locker(&lock);
+
+    // check it isn't closed already
+    if (!device) return -1;
+
+    // The USB2 stick really doesn't like you reading 1 byte when more are available
+    // so, as before, what's left of the last packet goes first then at most one more
+    int got = qMin(bytes, readBuf.size());
+    memcpy(buf, readBuf.constData(), got);
+    readBuf.remove(0, got);
+    if (got == bytes) return got;
+
+    QTime waited;
+    waited.start();
+    while (packets.isEmpty() && !failed && waited.elapsed() < timeout)
+        arrived.wait(&lock, timeout - waited.elapsed());
+
+    if (packets.isEmpty()) {
+        // don't report timeouts - lots of noise
+        if (got) return got;
+        return failed ? LIBUSB_ERROR_IO : LIBUSB_ERROR_TIMEOUT;
+    }
+
+    readBuf = packets.takeFirst();
+    int more = qMin(bytes - got, readBuf.size());
+    memcpy(buf + got, readBuf.constData(), more);
+    readBuf.remove(0, more);
+
+    return got + more;
+}
+
+int LibUsb::write(char *buf, int bytes)
+{
+    // check it isn't closed
+    if (!device) return -1;
+
+    int rc, sent = 0;
+    if (OperatingSystem == WINDOWS) {
+        rc = libusb_interrupt_transfer(device, writeEndpoint, (unsigned char*)buf, bytes, &sent, 1000);
+    } else {
+        rc = libusb_bulk_transfer(device, writeEndpoint, (unsigned char*)buf, bytes, &sent, 125);
+    }
+
+    if (rc < 0) {
+        // Report timeouts, as with libusb-0.1 they mean the stick needs a reset
+        qDebug()<<"libusb write Error writing ["<<rc<<"]: "<< libusb_error_name(rc);
+        return rc;
+    }
+    return sent;
+}
+
+// see LibUsb.cpp for how the Fortius firmware gets loaded, the
+// EzUsb code talks to the libusb-1.0 handle when built with it
+libusb_device_handle *LibUsb::OpenFortius()
+{
+    bool programmed = false;
+
+    libusb_device **list;
+    ssize_t count = libusb_get_device_list(ctx, &list);
+    for (ssize_t i=0; i<count; i++) {
+
+        struct libusb_device_descriptor desc;
+        if (libusb_get_device_descriptor(list[i], &desc) < 0) continue;
+
+        if (desc.idVendor == FORTIUS_VID && desc.idProduct == FORTIUS_INIT_PID) {
+
+            libusb_device_handle *udev;
+            if (libusb_open(list[i], &udev) == 0) {
+
+                // LOAD THE FIRMWARE
+                ezusb_load_ram (udev, appsettings->value(NULL, FORTIUS_FIRMWARE, "").toString().toLatin1(), 0, 0);
+
+                // Now close the connection, our work here is done
+                libusb_close(udev);
+            }
+            programmed = true;
+        }
+    }
+    if (count >= 0) libusb_free_device_list(list, 1);
+
+    // it re-enumerates with a different PID, and takes its time
+    if (programmed == true) {
+#ifdef WIN32
+        Sleep(3000); // windows sleep is in milliseconds
+#else
+        sleep(3);  // do not be tempted to reduce this, it really does take that long!
+#endif
+    }
+
+    return openMatching();
+}
+
+libusb_device_handle *LibUsb::OpenAntStick()
+{
+// for Mac and Linux we do a bus reset on it first...
+#ifndef WIN32
+    libusb_device **list;
+    ssize_t count = libusb_get_device_list(ctx, &list);
+    for (ssize_t i=0; i<count; i++) {
+
+        struct libusb_device_descriptor desc;
+        libusb_device_handle *udev;
+        if (libusb_get_device_descriptor(list[i], &desc) == 0 && matches(desc) &&
+            libusb_open(list[i], &udev) == 0) {
+            libusb_reset_device(udev);
+            libusb_close(udev);
+        }
+    }
+    if (count >= 0) libusb_free_device_list(list, 1);
+#endif
+
+    return openMatching();
+}
+
+// open and claim the first (initialised) device of our type
+libusb_device_handle *LibUsb::openMatching()
+{
+    libusb_device_handle *found = NULL;
+
+    libusb_device **list;
+    ssize_t count = libusb_get_device_list(ctx, &list);
+    for (ssize_t i=0; i<count && !found; i++) {
+
+        struct libusb_device_descriptor desc;
+        if (libusb_get_device_descriptor(list[i], &desc) < 0 || !matches(desc)) continue;
+        if (type == TYPE_FORTIUS && desc.idProduct == FORTIUS_INIT_PID) continue;
+
+        libusb_device_handle *udev;
+        if (libusb_open(list[i], &udev) == 0) {
+            if (desc.bNumConfigurations && claim(udev)) found = udev;
+            else libusb_close(udev);
+        }
+    }
+    if (count >= 0) libusb_free_device_list(list, 1);
+
+    return found;
+}
+
+// find the interface with a read and a write endpoint and claim it
+bool LibUsb::claim(libusb_device_handle *udev)
+{
+    libusb_device *dev = libusb_get_device(udev);
+
+    struct libusb_config_descriptor *config;
+    if (libusb_get_config_descriptor(dev, 0, &config) < 0) return false;
+
+    readEndpoint = writeEndpoint = interface = alternate = -1;
+    if (config->bNumInterfaces && config->interface[0].num_altsetting) {
+
+        const struct libusb_interface_descriptor *intf = &config->interface[0].altsetting[0];
+        if (intf->bNumEndpoints == 2) {
+
+            interface = intf->bInterfaceNumber;
+            alternate = intf->bAlternateSetting;
+            for (int i = 0 ; i < 2; i++) {
+                if (intf->endpoint[i].bEndpointAddress & LIBUSB_ENDPOINT_DIR_MASK)
+                    readEndpoint = intf->endpoint[i].bEndpointAddress;
+                else
+                    writeEndpoint = intf->endpoint[i].bEndpointAddress;
+            }
+        }
+    }
+    libusb_free_config_descriptor(config);
+
+    if (readEndpoint < 0 || writeEndpoint < 0) return false;
+
+#ifdef Q_OS_LINUX
+    if (libusb_kernel_driver_active(udev, interface) == 1)
+        libusb_detach_kernel_driver(udev, interface);
+#endif
+
+    int rc = libusb_set_configuration(udev, 1);
+    if (rc < 0) {
+        qDebug()<<"libusb_set_configuration Error: "<< libusb_error_name(rc);
+        if (OperatingSystem == LINUX) {
+            // looks like the udev rule has not been implemented
+            qDebug()<<"check permissions on:"<<QString("/dev/bus/usb/%1/%2")
+                                                .arg(libusb_get_bus_number(dev), 3, 10, QChar('0'))
+                                                .arg(libusb_get_device_address(dev), 3, 10, QChar('0'));
+            qDebug()<<"did you remember to setup a udev rule for this device?";
+        }
+    }
+
+    rc = libusb_claim_interface(udev, interface);
+    if (rc < 0) qDebug()<<"libusb_claim_interface Error: "<< libusb_error_name(rc);
+
+    if (OperatingSystem != OSX) {
+        // fails on Mac OS X, we don't actually need it anyway
+        rc = libusb_set_interface_alt_setting(udev, interface, alternate);
+        if (rc < 0) qDebug()<<"libusb_set_interface_alt_setting Error: "<< libusb_error_name(rc);
+    }
+
+    return true;
+}
+#endif // GC_HAVE_LIBUSB && GC_HAVE_LIBUSB1
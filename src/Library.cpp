@@ -94,10 +94,24 @@ Library::initialise(QDir home)
     }
 }
 
+// the compiled profile for a workout, empty if it isn't valid. Those
+// already in the library aren't parsed again, and the profile lets the
+// import that follows skip parsing too
+static QByteArray compileWorkout(QString file, Context *context)
+{
+    QByteArray profile = trainDB->workoutProfile(file);
+    if (!profile.isEmpty()) return profile;
+
+    int mode;
+    ErgFile p(file, mode, context);
+    return p.profile();
+}
+
 void
 Library::importFiles(Context *context, QStringList files)
 {
     QStringList videos, workouts;
+    QHash<QString, QByteArray> profiles;
     MediaHelper helper;
 
     // sort the wheat from the chaff
@@ -111,10 +125,11 @@ Library::importFiles(Context *context, QStringList files)
 
         // if it is a workout we parse it to check
         if (ErgFile::isWorkout(file)) {
-            int mode;
-            ErgFile *p = new ErgFile(file, mode, context);
-            if (p->isValid()) workouts << file;
-            delete p;
+            QByteArray profile = compileWorkout(file, context);
+            if (!profile.isEmpty()) {
+                workouts << file;
+                profiles.insert(file, profile);
+            }
         }
     }
 
@@ -176,7 +191,7 @@ Library::importFiles(Context *context, QStringList files)
 
             // still add it, it may noit have been scanned...
             int mode;
-            ErgFile file(target, mode, context);
+            ErgFile file(target, mode, context, profiles.value(workouts[0]));
             trainDB->importWorkout(target, &file);
 
         }
@@ -545,17 +560,30 @@ LibrarySearchDialog::removeReference()
 void
 LibrarySearchDialog::updateDB()
 {
-    // wipe away all user data before updating
-    trainDB->rebuildDB();
+    // workouts that haven't changed since they were last
+    // imported are kept, so only new or changed files are parsed
+    QHash<QString, TrainDBStamp> stamps = trainDB->workoutStamps();
 
     trainDB->startLUW();
+    trainDB->rebuildVideos();
+
+    // workouts no longer found (references are re-added below)
+    QSet<QString> found = workoutsFound.toSet();
+    if (library) found += library->refs.toSet();
+    foreach(QString ergFile, stamps.keys()) {
+        if (!found.contains(ergFile)) trainDB->deleteWorkout(ergFile);
+    }
 
     // workouts
     foreach(QString ergFile, workoutsFound) {
+        if (stamps.contains(ergFile) && stamps.value(ergFile).matches(QFileInfo(ergFile))) continue;
+
         int mode;
         ErgFile file(ergFile, mode, context);
         if (file.isValid()) {
             trainDB->importWorkout(ergFile, &file);
+        } else {
+            trainDB->deleteWorkout(ergFile);
         }
     }
 
@@ -580,6 +608,8 @@ LibrarySearchDialog::updateDB()
 
             // is a workout?
             if (ErgFile::isWorkout(r)) {
+                if (stamps.contains(r) && stamps.value(r).matches(QFileInfo(r))) continue;
+
                 int mode;
                 ErgFile file(r, mode, context);
                 if (file.isValid()) {
@@ -615,11 +645,15 @@ LibrarySearch::run()
         // whizz through every file in the directory
         // if it has the right extension then we are happy
         QString name = directory_walker.filePath();
+        QFileInfo info = directory_walker.fileInfo(); // already stat'ed by the walker
 
         // skip . files
-        if (QFileInfo(name).fileName().startsWith(".")) continue;
+        if (info.fileName().startsWith(".")) continue;
 
-        if (QFileInfo(name).isDir()) emit searching(name);
+        if (info.isDir()) {
+            emit searching(name);
+            continue;
+        }
 
         // we've been told to stop!
         if (aborted) {
@@ -668,10 +702,11 @@ WorkoutImportDialog::WorkoutImportDialog(Context *context, QStringList files) :
 
         // if it is a workout we parse it to check
         if (ErgFile::isWorkout(file)) {
-            int mode;
-            ErgFile *p = new ErgFile(file, mode, context);
-            if (p->isValid()) workouts << file;
-            delete p;
+            QByteArray profile = compileWorkout(file, context);
+            if (!profile.isEmpty()) {
+                workouts << file;
+                profiles.insert(file, profile);
+            }
         }
     }
 
@@ -771,7 +806,7 @@ WorkoutImportDialog::import()
 
         // cannot read or not valid
         int mode;
-        ErgFile file(workout, mode, context);
+        ErgFile file(workout, mode, context, profiles.value(workout));
         if (!file.isValid()) continue;
 
         // get target name
@@ -28,6 +28,7 @@
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
 #include <QThread>
+#include <QHash>
 
 class Library : QObject
 {
@@ -140,6 +141,7 @@ class WorkoutImportDialog : public QDialog
         QStringList files;
  
         QStringList videos, workouts;
+        QHash<QString, QByteArray> profiles; // compiled when checking the workouts
 
         QTreeWidget *fileTable;
         QPushButton *okButton, *cancelButton;
@@ -19,6 +19,7 @@
 #include "Lucene.h"
 #include "Context.h"
 #include "Athlete.h"
+#include "Maintenance.h" // to stay out of the way of a workout
 
 // stdc strings
 using namespace std;
@@ -30,7 +31,24 @@ using namespace lucene::queryParser;
 using namespace lucene::search;
 using namespace lucene::store;
 
-Lucene::Lucene(QObject *parent, Context *context) : QObject(parent), context(context)
+// the clucene we bundle is built without thread support so the indexer
+// and searches must not call into it at the same time
+static QMutex cluceneLock;
+
+// commit a batch this often, or once the queue has been quiet a while
+static const int BATCHSIZE = 100;
+static const unsigned long COMMITWAIT = 2000; // ms
+static const unsigned long MERGEWAIT = 60000; // ms
+static const int MERGESEGMENTS = 10;
+
+// how many indexers are open, the lock is only stale when there are none
+static int indexers = 0;
+
+// searches remembered between commits
+static const int CACHESIZE = 64;
+
+Lucene::Lucene(QObject *parent, Context *context) : QObject(parent), context(context), hits(NULL),
+    reader(NULL), searcher(NULL), generation(0), readerGeneration(0), indexer(NULL)
 {
     // create the directory if needed
     context->athlete->home.mkdir("index");
@@ -38,12 +56,14 @@ Lucene::Lucene(QObject *parent, Context *context) : QObject(parent), context(con
     // make index directory if needed
     dir = QDir(context->athlete->home.canonicalPath() + "/index");
 
+    QMutexLocker locker(&cluceneLock);
+
     try {
 
         bool indexExists = IndexReader::indexExists(dir.canonicalPath().toLocal8Bit().data());
 
-        // clear any locks
-        if (indexExists && IndexReader::isLocked(dir.canonicalPath().toLocal8Bit().data()))
+        // clear any locks left behind by a crash
+        if (indexExists && !indexers && IndexReader::isLocked(dir.canonicalPath().toLocal8Bit().data()))
             IndexReader::unlock(dir.canonicalPath().toLocal8Bit().data());
 
         if (!indexExists) {
@@ -63,107 +83,260 @@ Lucene::Lucene(QObject *parent, Context *context) : QObject(parent), context(con
 
 Lucene::~Lucene()
 {
+    if (indexer) {
+        indexer->stop();
+        delete indexer;
+    }
+
+    QMutexLocker locker(&cluceneLock);
+    closeReader();
 }
 
-bool Lucene::importRide(SummaryMetrics *, RideFile *ride, QColor , unsigned long, bool)
+// call with cluceneLock held
+void Lucene::closeReader()
 {
-    // create a document
-    Document doc;
+    try {
+        if (searcher) searcher->close();
+        if (reader) reader->close();
+    } catch (CLuceneError &e) {
+        //qDebug()<<"clucene error!"<<e.what();
+    }
+    delete searcher;
+    delete reader;
+    searcher = NULL;
+    reader = NULL;
+}
 
-    // add Filename special field (unique)
-    std::wstring cname = ride->getTag("Filename","").toStdWString();
-    Field *fadd = new Field(_T("Filename"), cname.c_str(), Field::STORE_YES | Field::INDEX_UNTOKENIZED);
-    doc.add( *fadd );
+void Lucene::queue(LuceneDocument &doc)
+{
+    if (!indexer) {
+        indexer = new LuceneIndexer(this);
+        indexer->start();
+    }
+    indexer->queue(doc);
+}
 
-    QString alltexts;
+bool Lucene::importRide(SummaryMetrics *, RideFile *ride, QColor , unsigned long, bool)
+{
+    LuceneDocument doc;
+    doc.filename = ride->getTag("Filename","");
 
-    // And all the metadata texts individually
+    // all the metadata texts individually
     foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
 
         if (!context->specialFields.isMetric(field.name) && (field.type < 3 || field.type == 7)) {
 
-            std::wstring name = context->specialFields.makeTechName(field.name).toStdWString();
-            std::wstring value = ride->getTag(field.name,"").toStdWString();
-
-            alltexts += ride->getTag(field.name,"") + " ";
-            Field *add = new Field(name.c_str(), value.c_str(), Field::STORE_YES | Field::INDEX_TOKENIZED);
-            doc.add( *add );
+            QString value = ride->getTag(field.name,"");
+            doc.fields << QPair<QString,QString>(context->specialFields.makeTechName(field.name), value);
+            doc.contents += value + " ";
         }
     }
 
-    // add a catchall text which is concat of all text fields
-    std::wstring value = alltexts.toStdWString();
-    Field *cadd = new Field(_T("contents"), value.c_str(), Field::STORE_YES | Field::INDEX_TOKENIZED);
-    doc.add( *cadd );
-    
-    // delete if already in the index
-    deleteRide(ride->getTag("Filename", ""));
+    // replaces it if already in the index
+    queue(doc);
+    return true;
+}
 
-    // now add to index
-    try { 
+bool Lucene::deleteRide(QString name)
+{
+    LuceneDocument doc;
+    doc.filename = name;
+    doc.remove = true;
 
-        // now lets open using a mnodifier since the API is much simpler
-        IndexWriter *writer = new IndexWriter(dir.canonicalPath().toLocal8Bit().data(), &analyzer, false); // for updates
-        writer->addDocument(&doc); 
-        writer->close();
-        delete writer;
+    queue(doc);
+    return true;
+}
 
-    } catch (CLuceneError &e) {
-        qDebug()<<"add document clucene error!"<<e.what();
-    }
+//
+// The indexer thread
+//
+void LuceneIndexer::queue(LuceneDocument &doc)
+{
+    QMutexLocker locker(&lock);
+    todo << doc;
+    pending.wakeOne();
+}
 
-    doc.clear();
+void LuceneIndexer::stop()
+{
+    lock.lock();
+    stopping = true;
+    pending.wakeOne();
+    lock.unlock();
 
-    return true;
+    wait();
 }
 
-bool Lucene::deleteRide(QString name)
+void LuceneIndexer::run()
 {
-    std::wstring cname = name.toStdWString();
+    IndexWriter *writer = NULL;
+    QByteArray path = lucene->dir.canonicalPath().toLocal8Bit();
 
+    cluceneLock.lock();
     try {
+        writer = new IndexWriter(path.data(), &lucene->analyzer, false); // for updates
+        writer->setMaxBufferedDocs(BATCHSIZE);
+        indexers++;
+    } catch (CLuceneError &e) {
+        qDebug()<<"open index clucene error!"<<e.what();
+    }
+    cluceneLock.unlock();
+
+    if (!writer) return; // nowt we can do
+
+    int uncommitted = 0;
+    bool merged = true;
+
+    lock.lock();
+    forever {
+
+        // wait for something to do, committing or merging if
+        // it goes quiet for long enough
+        if (todo.isEmpty() && !stopping) {
+
+            unsigned long waitFor = uncommitted ? COMMITWAIT : MERGEWAIT;
+            if (!pending.wait(&lock, waitFor) && todo.isEmpty()) {
+
+                lock.unlock();
+                QMutexLocker locker(&cluceneLock);
+                try {
+                    if (uncommitted) {
+                        writer->flush();
+                        uncommitted = 0;
+                        merged = false;
+                        lucene->generation++;
+                    } else if (!merged && !MaintenanceScheduler::isTraining()) {
+#ifndef WIN32 // windows crashes
+                        // only merge down a little, not a full optimise
+                        writer->optimize(MERGESEGMENTS);
+                        lucene->generation++;
+#endif
+                        merged = true;
+                    }
+                } catch (CLuceneError &e) {
+                    qDebug()<<"commit clucene error!"<<e.what();
+                }
+                locker.unlock();
+                lock.lock();
+                continue;
+            }
+        }
 
-        IndexReader *reader = IndexReader::open(dir.canonicalPath().toLocal8Bit().data());
-        Term del = Term(_T("Filename"), cname.c_str());
-        reader->deleteDocuments(&del);
-        reader->close();
-        delete reader;
+        if (todo.isEmpty() && stopping) break;
 
-    } catch (CLuceneError &e) {
-        qDebug()<<"deleteDocuments clucene error!"<<e.what();
+        // take a batch and let the queue carry on filling
+        QList<LuceneDocument> batch = todo.mid(0, BATCHSIZE);
+        todo = todo.mid(batch.count());
+        lock.unlock();
+
+        QMutexLocker locker(&cluceneLock);
+        foreach(LuceneDocument ldoc, batch) {
+
+            std::wstring cname = ldoc.filename.toStdWString();
+            Term term(_T("Filename"), cname.c_str());
+
+            try {
+
+                if (ldoc.remove) {
+
+                    writer->deleteDocuments(&term);
+
+                } else {
+
+                    Document doc;
+
+                    // Filename special field (unique)
+                    doc.add(*new Field(_T("Filename"), cname.c_str(), Field::STORE_YES | Field::INDEX_UNTOKENIZED));
+
+                    // the metadata texts
+                    QPair<QString,QString> field;
+                    foreach(field, ldoc.fields) {
+                        std::wstring name = field.first.toStdWString();
+                        std::wstring value = field.second.toStdWString();
+                        doc.add(*new Field(name.c_str(), value.c_str(), Field::STORE_YES | Field::INDEX_TOKENIZED));
+                    }
+
+                    // catchall text which is concat of all text fields
+                    std::wstring value = ldoc.contents.toStdWString();
+                    doc.add(*new Field(_T("contents"), value.c_str(), Field::STORE_YES | Field::INDEX_TOKENIZED));
+
+                    // deletes any existing document for the ride first
+                    writer->updateDocument(&term, &doc);
+                    doc.clear();
+                }
+
+            } catch (CLuceneError &e) {
+                qDebug()<<"update document clucene error!"<<e.what();
+            }
+            uncommitted++;
+        }
+
+        // commit every batch so searches can see them
+        if (uncommitted >= BATCHSIZE) {
+            try {
+                writer->flush();
+            } catch (CLuceneError &e) {
+                qDebug()<<"commit clucene error!"<<e.what();
+            }
+            uncommitted = 0;
+            merged = false;
+            lucene->generation++;
+        }
+        locker.unlock();
+
+        lock.lock();
     }
-    return true;
-}
+    lock.unlock();
 
-void Lucene::optimise()
-{
+    // commit whatever is left and close
+    QMutexLocker locker(&cluceneLock);
     try {
-
-        IndexWriter *writer = new IndexWriter(dir.canonicalPath().toLocal8Bit().data(), &analyzer, false); // for updates
-        writer->optimize();
         writer->close();
-        delete writer;
-
-    } catch(CLuceneError &e) {
-        qDebug()<<"optimise clucene error!"<<e.what();
+    } catch (CLuceneError &e) {
+        qDebug()<<"close index clucene error!"<<e.what();
     }
+    delete writer;
+    indexers--;
+    lucene->generation++;
 }
 
 int Lucene::search(QString query)
 {
 
+    QMutexLocker locker(&cluceneLock);
+
+    // anything committed since we last looked means the reader
+    // and everything we remembered are out of date
+    if (readerGeneration != generation) {
+        closeReader();
+        cache.clear();
+        readerGeneration = generation;
+    }
+
+    // the same query written differently is still the same query
+    QString normalized = query.simplified();
+    if (cache.contains(normalized)) {
+        filenames = cache.value(normalized);
+        locker.unlock();
+
+        emit results(filenames);
+        return filenames.count();
+    }
+
     try {
         // parse query
         QueryParser parser(_T("contents"), &analyzer);
         parser.setPhraseSlop(4);
 
-        std::wstring querystring = query.toStdWString();
+        std::wstring querystring = normalized.toStdWString();
         Query* lquery = parser.parse(querystring.c_str());
 
         if (lquery == NULL) return 0;
 
-        IndexReader *reader = IndexReader::open(dir.canonicalPath().toLocal8Bit().data());
-        IndexSearcher *searcher = new IndexSearcher(reader);           // to perform searches
+        if (reader == NULL) {
+            reader = IndexReader::open(dir.canonicalPath().toLocal8Bit().data());
+            searcher = new IndexSearcher(reader);           // to perform searches
+        }
 
         // go find hits
         hits = searcher->search(lquery);
@@ -174,20 +347,21 @@ int Lucene::search(QString query)
             filenames << QString::fromWCharArray(d->get(_T("Filename")));
         }
 
-        searcher->close();
-        reader->close();
-
         delete hits;
+        hits = NULL;
         delete lquery;
-        delete searcher;
-        delete reader;
 
     } catch (CLuceneError &e) {
 
         //qDebug()<<"clucene error:"<<e.what();
+        closeReader(); // try again next time
         return 0;
     }
 
+    if (cache.count() >= CACHESIZE) cache.clear();
+    cache.insert(normalized, filenames);
+    locker.unlock();
+
     emit results(filenames);
 
     return filenames.count();
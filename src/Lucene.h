@@ -22,12 +22,47 @@
 #include <QObject>
 #include <QString>
 #include <QDir>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
 
 #include "Context.h"
 #include "RideMetadata.h"
 #include "SummaryMetrics.h"
 #include "RideFile.h"
 
+#ifdef GC_SQLITE_SEARCH
+
+// Without CLucene the texts are searched in the metric database, which
+// writes them along with the metrics, so there's nothing to index here
+// and the import and delete are only kept for the callers, see
+// DBAccess::searchText and LuceneSqlite.cpp
+class Lucene : public QObject
+{
+    Q_OBJECT
+
+public:
+    Lucene(QObject *parent, Context *context) : QObject(parent), context(context) {}
+
+    bool importRide(SummaryMetrics *, RideFile *, QColor, unsigned long, bool) { return true; }
+    bool deleteRide(QString) { return true; }
+
+    QStringList &files() { return filenames; }
+
+public slots:
+    int search(QString query); // run query and return number of results found
+
+signals:
+    void results(QStringList);
+
+private:
+    Context *context;
+    QStringList filenames;
+};
+
+#else
+
 #include "CLucene.h"
 #include "CLucene/index/IndexModifier.h"
 
@@ -38,18 +73,33 @@ using namespace lucene::queryParser;
 using namespace lucene::search;
 using namespace lucene::store;
 
+class LuceneIndexer;
+
+// what gets indexed for a ride, taken from the ride when it is imported
+// since it may well be gone by the time the indexer gets to it
+struct LuceneDocument
+{
+    QString filename;
+    QList<QPair<QString, QString> > fields; // tech name and value
+    QString contents; // all the texts, for searching on
+    bool remove;      // just delete it from the index
+
+    LuceneDocument() : remove(false) {}
+};
+
 class Lucene : public QObject
 {
     Q_OBJECT
 
+    friend class ::LuceneIndexer;
+
 public:
     Lucene(QObject *parent, Context *context);
     ~Lucene();
 
-    // Create/Delete Metrics
+    // Create/Delete Metrics, these are queued for the indexer
 	bool importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor color, unsigned long, bool);
     bool deleteRide(QString);
-    void optimise(); // for optimising the index once updated
 
     QStringList &files() { return filenames; }
 
@@ -72,6 +122,45 @@ private:
     // Query results
     Hits *hits; // null when no results
     QStringList filenames;
+
+    // the reader stays open between searches and is only reopened once
+    // the indexer has committed something, until then the results of
+    // each query are remembered so typing and deleting is cheap
+    IndexReader *reader;
+    IndexSearcher *searcher;
+    unsigned long generation;       // bumped by the indexer on commit
+    unsigned long readerGeneration; // what the reader has seen
+    QHash<QString, QStringList> cache;
+    void closeReader();
+
+    // started when the first document is queued, searching
+    // doesn't need one and there can only be one writer
+    LuceneIndexer *indexer;
+    void queue(LuceneDocument &doc);
+};
+
+// The indexer keeps the index open for writing in its own thread and
+// works through the documents queued in batches. They are committed
+// every so often rather than as each one is added so searches see them
+// shortly after, and the segments are merged down a little once it has
+// been idle for a while rather than optimising the whole index.
+class LuceneIndexer : public QThread
+{
+    public:
+        LuceneIndexer(Lucene *lucene) : lucene(lucene), stopping(false) {}
+        void run();
+
+        void queue(LuceneDocument &doc);
+        void stop(); // commits what is queued and closes the index
+
+    private:
+        Lucene *lucene;
+
+        QMutex lock;
+        QWaitCondition pending;
+        QList<LuceneDocument> todo;
+        bool stopping;
 };
 
+#endif // GC_SQLITE_SEARCH
 #endif
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Lucene.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "MetricAggregator.h"
+#include "DBAccess.h"
+
+// the query runs against the texts kept with the metrics, so
+// a ride is found as soon as its metrics have been written
+int Lucene::search(QString query)
+{
+    filenames.clear();
+
+    MetricAggregator *metricDB = context->athlete->metricDB;
+    if (metricDB && metricDB->db()) {
+        metricDB->db()->connection().transaction();
+        filenames = metricDB->db()->searchText(query.simplified());
+        metricDB->db()->connection().commit();
+    }
+
+    emit results(filenames);
+    return filenames.count();
+}
@@ -25,6 +25,7 @@
 
 // DATA STRUCTURES
 #include "MainWindow.h"
+#include "Trace.h"
 #include "Context.h"
 #include "Athlete.h"
 
@@ -41,6 +42,7 @@
 
 // DIALOGS / DOWNLOADS / UPLOADS
 #include "AboutDialog.h"
+#include "CacheStatsDialog.h"
 #include "ChooseCyclistDialog.h"
 #include "ConfigDialog.h"
 #include "DownloadRideDialog.h"
@@ -51,6 +53,8 @@
 #include "SplitActivityWizard.h"
 #include "MergeActivityWizard.h"
 #include "BatchExportDialog.h"
+#include "MetricsExport.h"
+#include "RideArchive.h"
 #include "TwitterDialog.h"
 #include "ShareDialog.h"
 #include "TtbDialog.h"
@@ -471,6 +475,8 @@ MainWindow::MainWindow(const QDir &home)
     rideMenu->addAction(tr("&Export..."), this, SLOT(exportRide()), tr("Ctrl+E"));
     rideMenu->addAction(tr("&Batch export..."), this, SLOT(exportBatch()), tr("Ctrl+B"));
     rideMenu->addAction(tr("Export Metrics as CSV..."), this, SLOT(exportMetrics()), tr(""));
+    rideMenu->addAction(tr("Archive activities..."), this, SLOT(archiveRides()), tr(""));
+    rideMenu->addAction(tr("Restore activities from archive..."), this, SLOT(restoreArchive()), tr(""));
 #ifdef GC_HAVE_SOAP
     rideMenu->addSeparator ();
     rideMenu->addAction(tr("&Upload to TrainingPeaks"), this, SLOT(uploadTP()), tr("Ctrl+U"));
@@ -585,6 +591,12 @@ MainWindow::MainWindow(const QDir &home)
     QMenu *helpMenu = menuBar()->addMenu(tr("&Help"));
     helpMenu->addAction(tr("&User Guide"), this, SLOT(helpView()));
     helpMenu->addAction(tr("&Log a bug or feature request"), this, SLOT(logBug()));
+    helpMenu->addAction(tr("&Memory and Caches..."), this, SLOT(showCacheStats()));
+#ifdef GC_HAVE_TRACE
+    QAction *traceAction = helpMenu->addAction(tr("&Record Performance Trace"));
+    traceAction->setCheckable(true);
+    connect(traceAction, SIGNAL(toggled(bool)), this, SLOT(recordTrace(bool)));
+#endif
     helpMenu->addSeparator();
     helpMenu->addAction(tr("&About GoldenCheetah"), this, SLOT(aboutDialog()));
 
@@ -593,8 +605,8 @@ MainWindow::MainWindow(const QDir &home)
      *--------------------------------------------------------------------*/
 
     // selects the latest ride in the list:
-    if (context->athlete->allRides->childCount() != 0)
-        context->athlete->treeWidget->setCurrentItem(context->athlete->allRides->child(context->athlete->allRides->childCount()-1));
+    if (context->athlete->rideCount() != 0)
+        context->athlete->treeWidget->setCurrentItem(context->athlete->rideItem(context->athlete->rideCount()-1));
 
     //XXX!!! We really do need a mechanism for showing if a ride needs saving...
     //connect(this, SIGNAL(rideDirty()), this, SLOT(enableSaveButton()));
@@ -793,6 +805,9 @@ MainWindow::closeEvent(QCloseEvent* event)
     if (saveRideExitDialog() == false) event->ignore();
     else {
 
+        // the saves need to be on disk before we go
+        waitForSaves();
+
 #ifdef GC_HAVE_LUCENE
         // save the named searches
         context->athlete->namedSearches->write();
@@ -836,6 +851,13 @@ MainWindow::closeAll()
     close();
 }
 
+void
+MainWindow::showCacheStats()
+{
+    CacheStatsDialog *stats = new CacheStatsDialog(this);
+    stats->show(); // deletes itself when closed
+}
+
 void
 MainWindow::aboutDialog()
 {
@@ -887,6 +909,27 @@ MainWindow::logBug()
     QDesktopServices::openUrl(QUrl("http://www.goldencheetah.org/bug-tracker.html"));
 }
 
+#ifdef GC_HAVE_TRACE
+void
+MainWindow::recordTrace(bool on)
+{
+    if (on) {
+        GcTrace::start();
+        return;
+    }
+
+    // stopped, so where shall we put it?
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save Performance Trace"),
+                       QDir::homePath() + "/goldencheetah-trace.json", tr("Trace (*.json)"));
+    if (filename.isEmpty()) {
+        GcTrace::stop(QString()); // just forget it
+        return;
+    }
+    if (!GcTrace::stop(filename))
+        QMessageBox::warning(this, tr("Performance Trace"), tr("Could not write %1").arg(filename));
+}
+#endif
+
 void
 MainWindow::helpView()
 {
@@ -1122,8 +1165,10 @@ MainWindow::deleteRide()
     msgBox.setDefaultButton(QMessageBox::Cancel);
     msgBox.setIcon(QMessageBox::Critical);
     msgBox.exec();
-    if(msgBox.clickedButton() == deleteButton)
+    if(msgBox.clickedButton() == deleteButton) {
+        waitForSaves(item);
         context->athlete->removeCurrentRide();
+    }
 }
 
 /*----------------------------------------------------------------------
@@ -1179,10 +1224,59 @@ MainWindow::openCyclist()
 void
 MainWindow::exportMetrics()
 {
-    QString fileName = QFileDialog::getSaveFileName( this, tr("Export Metrics"), QDir::homePath(), tr("Comma Separated Variables (*.csv)"));
+    MetricsExportDialog *d = new MetricsExportDialog(context);
+    d->exec();
+}
+
+void
+MainWindow::archiveRides()
+{
+    // an existing archive is brought up to date, not replaced
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Archive Activities"),
+                       QDir::homePath() + "/" + context->athlete->cyclist + ".gca",
+                       tr("GoldenCheetah Archive (*.gca)"), 0, QFileDialog::DontConfirmOverwrite);
+    if (fileName.length() == 0)
+        return;
+
+    RideArchive archive(fileName);
+    if (!archive.open()) {
+        QMessageBox::critical(this, tr("Archive Activities"), tr("%1 is not a GoldenCheetah archive").arg(fileName));
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    int count = archive.update(context->athlete->home, context->athlete->allRideFiles());
+    archive.close();
+    QApplication::restoreOverrideCursor();
+
+    QMessageBox::information(this, tr("Archive Activities"), tr("%1 files archived").arg(count));
+}
+
+void
+MainWindow::restoreArchive()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Restore Activities"), QDir::homePath(),
+                       tr("GoldenCheetah Archive (*.gca)"));
     if (fileName.length() == 0)
         return;
-    context->athlete->metricDB->writeAsCSV(fileName);
+
+    // into a folder that can then be opened as an athlete
+    QString dirName = QFileDialog::getExistingDirectory(this, tr("Restore Activities To"), QDir::homePath());
+    if (dirName.length() == 0)
+        return;
+
+    RideArchive archive(fileName);
+    if (!archive.open()) {
+        QMessageBox::critical(this, tr("Restore Activities"), tr("%1 is not a GoldenCheetah archive").arg(fileName));
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    int count = archive.restore(QDir(dirName));
+    archive.close();
+    QApplication::restoreOverrideCursor();
+
+    QMessageBox::information(this, tr("Restore Activities"), tr("%1 files restored").arg(count));
 }
 
 /*----------------------------------------------------------------------
@@ -1336,6 +1430,9 @@ MainWindow::downloadTP()
 void
 Context::notifyConfigChanged()
 {
+    // before anyone reads them
+    SettingsSnapshot::refresh();
+
     // now tell everyone else
     configChanged();
 }
@@ -1377,21 +1474,21 @@ Athlete::configChanged()
 void
 MainWindow::downloadMeasures()
 {
-    context->athlete->withingsDownload->download();
+    context->athlete->withingsDownload()->download();
 }
 
 void
 MainWindow::downloadMeasuresFromZeo()
 {
-    context->athlete->zeoDownload->download();
+    context->athlete->zeoDownload()->download();
 }
 
 void
 MainWindow::refreshCalendar()
 {
 #ifdef GC_HAVE_ICAL
-    context->athlete->davCalendar->download();
-    context->athlete->calendarDownload->download();
+    context->athlete->davCalendar()->download();
+    context->athlete->calendarDownload()->download();
 #endif
 }
 
@@ -1403,7 +1500,7 @@ MainWindow::refreshCalendar()
 void
 MainWindow::uploadCalendar()
 {
-    context->athlete->davCalendar->upload((RideItem*)context->currentRideItem()); // remove const coz it updates the ride
+    context->athlete->davCalendar()->upload((RideItem*)context->currentRideItem()); // remove const coz it updates the ride
                                                // to set GID and upload date
 }
 #endif
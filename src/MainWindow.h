@@ -40,6 +40,7 @@ class GcScopeBar;
 class Library;
 class QtSegmentControl;
 class SaveSingleDialogWidget;
+class RideFileSaver;
 
 class MainWindow;
 class Athlete;
@@ -76,8 +77,12 @@ class MainWindow : public QMainWindow
         void toggleFullScreen();
 #endif
         void aboutDialog();
+        void showCacheStats();
         void helpView();
         void logBug();
+#ifdef GC_HAVE_TRACE
+        void recordTrace(bool);
+#endif
         void closeAll();
         void actionClicked(int);
 
@@ -138,11 +143,15 @@ class MainWindow : public QMainWindow
         void rideSelected(RideItem*ride);
         bool saveRideSingleDialog(RideItem *);
         void saveSilent(RideItem *);
+        void rideSaved();                       // a saveSilent has been written
+        void waitForSaves(RideItem *only = NULL);
         void downloadRide();
         void manualRide();
         void exportRide();
         void exportBatch();
         void exportMetrics();
+        void archiveRides();
+        void restoreArchive();
 #ifdef GC_HAVE_LIBOAUTH
         void tweetRide();
         void share();
@@ -167,6 +176,10 @@ class MainWindow : public QMainWindow
         GcScopeBar *scopebar;
         Tab *tab;
 
+        // saves being written, one per ride
+        QHash<RideItem*, RideFileSaver*> savers;
+        void finishSave(RideFileSaver *);
+
 #if (defined Q_OS_MAC) && (defined GC_HAVE_LION)
         LionFullScreen *fullScreen;
 #endif
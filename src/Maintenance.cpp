@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Maintenance.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "MetricAggregator.h"
+#include "RideFileCache.h"
+#include "RideFile.h"
+#include "Heatmap.h"
+#include "Settings.h"
+
+#include <QApplication>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QEvent>
+#include <QDir>
+#include <QFile>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_MAC)
+#include <IOKit/ps/IOPowerSources.h>
+#include <IOKit/ps/IOPSKeys.h>
+#endif
+
+// how long without keyboard or mouse input before we
+// count as idle, and how often we look for something to do
+static const int idleMsecs = 30000;
+static const int scheduleMsecs = 1000;
+
+QAtomicInt MaintenanceScheduler::training;
+
+static MaintenanceScheduler *scheduler = NULL;
+
+MaintenanceScheduler *
+MaintenanceScheduler::instance()
+{
+    if (scheduler == NULL) scheduler = new MaintenanceScheduler();
+    return scheduler;
+}
+
+MaintenanceScheduler::MaintenanceScheduler() : QObject(qApp), worker(new MaintenanceWorker), running(NULL), battery(false)
+{
+    lastInput.start();
+    qApp->installEventFilter(this);
+
+    connect(worker, SIGNAL(finished()), this, SLOT(stepFinished()));
+    connect(&timer, SIGNAL(timeout()), this, SLOT(schedule()));
+    timer.start(scheduleMsecs);
+}
+
+MaintenanceScheduler::~MaintenanceScheduler()
+{
+    timer.stop();
+    worker->wait();
+    delete worker;
+    foreach(MaintenanceTask *task, tasks) delete task;
+    scheduler = NULL;
+}
+
+void
+MaintenanceScheduler::addTask(MaintenanceTask *task)
+{
+    // kept in priority order, first come first served within one
+    int i = 0;
+    while (i < tasks.count() && tasks[i]->priority <= task->priority) i++;
+    tasks.insert(i, task);
+
+    // a workout on any athlete has the machine
+    if (!contexts.contains(task->context)) {
+        contexts << task->context;
+        connect(task->context, SIGNAL(start()), this, SLOT(trainingStarted()));
+        connect(task->context, SIGNAL(stop()), this, SLOT(trainingStopped()));
+        connect(task->context, SIGNAL(destroyed(QObject*)), this, SLOT(contextDestroyed(QObject*)));
+    }
+}
+
+void
+MaintenanceScheduler::removeTasks(Context *context)
+{
+    // let the step finish, but not call back
+    if (running && running->context == context) {
+        worker->wait();
+        running = NULL;
+    }
+
+    foreach(MaintenanceTask *task, tasks) {
+        if (task->context == context) {
+            tasks.removeAll(task);
+            delete task;
+        }
+    }
+}
+
+void
+MaintenanceScheduler::runTasks(Context *context)
+{
+    // let a step under way finish first
+    if (running) {
+        worker->wait();
+        MaintenanceTask *task = running;
+        running = NULL;
+        task->done();
+    }
+
+    foreach(MaintenanceTask *task, tasks) {
+        if (task->context != context) continue;
+        while (task->pending()) {
+            task->step();
+            task->done();
+        }
+    }
+}
+
+void
+MaintenanceScheduler::contextDestroyed(QObject *context)
+{
+    contexts.removeAll(context);
+}
+
+bool
+MaintenanceScheduler::eventFilter(QObject *, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::KeyPress:
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseMove:
+    case QEvent::Wheel:
+    case QEvent::TouchBegin:
+        lastInput.restart();
+        break;
+    default:
+        break;
+    }
+    return false;
+}
+
+bool
+MaintenanceScheduler::isIdle() const
+{
+    return lastInput.elapsed() > idleMsecs && !isTraining();
+}
+
+bool
+MaintenanceScheduler::onBattery()
+{
+#if defined(Q_OS_WIN)
+    SYSTEM_POWER_STATUS status;
+    return GetSystemPowerStatus(&status) && status.ACLineStatus == 0;
+#elif defined(Q_OS_MAC)
+    CFTypeRef info = IOPSCopyPowerSourcesInfo();
+    if (info == NULL) return false;
+    CFStringRef type = IOPSGetProvidingPowerSourceType(info);
+    bool returning = type && CFStringCompare(type, CFSTR(kIOPMBatteryPowerKey), 0) == kCFCompareEqualTo;
+    CFRelease(info);
+    return returning;
+#elif defined(Q_OS_LINUX)
+    // on battery if there is one and no mains adapter is online
+    bool battery = false;
+    QDir supplies("/sys/class/power_supply");
+    foreach(QString name, supplies.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QFile type(supplies.absoluteFilePath(name + "/type"));
+        if (!type.open(QIODevice::ReadOnly)) continue;
+        QString kind = QString(type.readAll()).trimmed();
+
+        if (kind == "Battery") battery = true;
+        else if (kind == "Mains" || kind == "USB") {
+            QFile online(supplies.absoluteFilePath(name + "/online"));
+            if (online.open(QIODevice::ReadOnly) && QString(online.readAll()).trimmed() == "1") return false;
+        }
+    }
+    return battery;
+#else
+    return false;
+#endif
+}
+
+void
+MaintenanceScheduler::schedule()
+{
+    if (running || worker->isRunning() || tasks.isEmpty() || isTraining()) return;
+    bool idle = isIdle();
+
+    if (batteryChecked.isNull() || batteryChecked.elapsed() > 60000) {
+        battery = onBattery();
+        batteryChecked.start();
+    }
+    if (battery) return;
+
+    foreach(MaintenanceTask *task, tasks) {
+        if ((idle || task->urgent()) && task->pending()) {
+            running = task;
+            worker->task = task;
+            worker->start(QThread::LowestPriority);
+            return;
+        }
+    }
+}
+
+void
+MaintenanceScheduler::stepFinished()
+{
+    // a late signal from a step removeTasks() waited for
+    if (worker->isRunning()) return;
+
+    MaintenanceTask *task = running;
+    running = NULL;
+    if (task) task->done();
+
+    // carry on whilst we're still idle
+    if (task) QTimer::singleShot(0, this, SLOT(schedule()));
+}
+
+//
+// .cpx files for the current RideFileCacheVersion
+//
+CpxRebuildTask::CpxRebuildTask(Context *context)
+    : MaintenanceTask(context, "cpx", High), next(-1), defaultWeight(0)
+{
+}
+
+bool
+CpxRebuildTask::pending()
+{
+    // the refresh rebuilds them itself, and writes them too
+    if (context->athlete->metricDB == NULL || context->athlete->metricDB->isRefreshing()) return false;
+
+    if (next < 0) {
+        rides = context->athlete->allRideFiles();
+
+        // the charts mostly want the recent ones
+        qSort(rides.begin(), rides.end(), qGreater<QString>());
+
+        // carry on where we got to, if it was for this version
+        next = 0;
+        if (appsettings->cvalue(context->athlete->cyclist, GC_MAINT_CPXVERSION, 0).toInt() == RideFileCacheVersion) {
+            QString done = appsettings->cvalue(context->athlete->cyclist, GC_MAINT_CPXDONE, "").toString();
+            if (done != "") next = qUpperBound(rides.begin(), rides.end(), done, qGreater<QString>()) - rides.begin();
+        }
+    }
+    if (next >= rides.count()) return false;
+
+    // the weight the bests are computed with, from here since
+    // RideFile::getWeight() goes to the database
+    weights = context->athlete->metricDB->weights();
+    defaultWeight = appsettings->cvalue(context->athlete->cyclist, GC_WEIGHT, "75.0").toString().toDouble();
+    return true;
+}
+
+// rebuilds one .cpx on a pool thread for CpxRebuildTask::step()
+class CpxRebuilder : public QRunnable
+{
+    public:
+        CpxRebuilder(Context *context, QString filename, const WeightTimeline &weights, double defaultWeight)
+            : filename(filename), ok(false), context(context), weights(weights), defaultWeight(defaultWeight) {
+            setAutoDelete(false); // the step collects the bests
+        }
+
+        void run() {
+            // stay out of the way, the app may well be in use
+            QThread::currentThread()->setPriority(QThread::LowestPriority);
+
+            QString path = context->athlete->home.absolutePath() + "/" + filename;
+            QStringList errors;
+            QFile file(path);
+            RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
+            if (ride == NULL) return;
+
+            ride->setWeight(MetricAggregator::weightFor(ride, weights, defaultWeight));
+            RideFileCache updater(context, path, ride, true);
+            delete ride;
+
+            bests = RideFileCache::standardBests(context, filename);
+            ok = true;
+        }
+
+        QString filename;
+        QByteArray bests;
+        bool ok;
+
+    private:
+        Context *context;
+        const WeightTimeline &weights;
+        double defaultWeight;
+};
+
+void
+CpxRebuildTask::step()
+{
+    rebuilt.clear();
+
+    // checking the header is quick, take the next few that are
+    // out of date and rebuild them together, one per core
+    int cores = qMax(1, QThread::idealThreadCount());
+    QList<CpxRebuilder*> batch;
+    QTime elapsed;
+    elapsed.start();
+    while (next < rides.count() && batch.count() < cores && elapsed.elapsed() < 500) {
+
+        QString filename = rides[next++];
+        if (RideFileCache::isCurrent(context->athlete->home.absolutePath() + "/" + filename)) continue;
+
+        batch << new CpxRebuilder(context, filename, weights, defaultWeight);
+    }
+    if (batch.isEmpty()) return;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(cores);
+    foreach(CpxRebuilder *rebuilder, batch) pool.start(rebuilder);
+    pool.waitForDone();
+
+    foreach(CpxRebuilder *rebuilder, batch) {
+        if (rebuilder->ok) rebuilt << QPair<QString, QByteArray>(rebuilder->filename, rebuilder->bests);
+        delete rebuilder;
+    }
+}
+
+void
+CpxRebuildTask::done()
+{
+    if (context->athlete->metricDB && context->athlete->metricDB->db()) {
+        for (int i=0; i<rebuilt.count(); i++)
+            context->athlete->metricDB->db()->importBests(rebuilt[i].first, rebuilt[i].second);
+    }
+
+    appsettings->setCValue(context->athlete->cyclist, GC_MAINT_CPXVERSION, RideFileCacheVersion);
+    if (next > 0 && next <= rides.count())
+        appsettings->setCValue(context->athlete->cyclist, GC_MAINT_CPXDONE, rides[next-1]);
+}
+
+//
+// A stale heatmap
+//
+HeatmapRebuildTask::HeatmapRebuildTask(Context *context, Heatmap *heatmap)
+    : MaintenanceTask(context, "heatmap", Normal), heatmap(heatmap), next(-1)
+{
+}
+
+bool
+HeatmapRebuildTask::pending()
+{
+    if (!heatmap->isStale() && !heatmap->isRebuilding()) return false;
+
+    // the rides as we start, or carry on after a restart
+    if (next < 0) {
+        rides = context->athlete->allRideFiles();
+        next = 0;
+    }
+    return true;
+}
+
+void
+HeatmapRebuildTask::step()
+{
+    if (!heatmap->isRebuilding()) {
+        heatmap->beginRebuild();
+        next = 0;
+        return;
+    }
+
+    // rides already in are skipped, one opened a step
+    while (next < rides.count())
+        if (heatmap->rebuildRide(rides[next++])) return;
+
+    heatmap->endRebuild();
+    next = -1;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_Maintenance_h
+#define _GC_Maintenance_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QList>
+#include <QStringList>
+#include <QTime>
+#include <QTimer>
+#include <QThread>
+#include <QByteArray>
+#include <QAtomicInt>
+
+#include "MetricAggregator.h" // for WeightTimeline
+
+class Context;
+class Heatmap;
+class MaintenanceWorker;
+
+// Housekeeping that can wait until nobody is using the app, done a step at
+// a time by the MaintenanceScheduler. Each step runs on the scheduler's
+// worker thread and should take a second or so at most, pending() and done()
+// are called on the GUI thread either side of it. Tasks keep their own
+// progress so they carry on where they were after a restart.
+class MaintenanceTask
+{
+    public:
+        enum Priority { High, Normal, Low };
+
+        MaintenanceTask(Context *context, QString name, Priority priority)
+        : context(context), name(name), priority(priority) {}
+        virtual ~MaintenanceTask() {}
+
+        virtual bool pending() = 0;
+        virtual void step() = 0;
+        virtual void done() {}
+
+        // needed whilst the app is in use, not only once it is idle, but
+        // still not during a workout or on battery
+        virtual bool urgent() { return false; }
+
+        Context *context;
+        QString name;
+        Priority priority;
+};
+
+// Runs the tasks, highest priority first, whilst the app is idle: there has
+// been no keyboard or mouse input for a while, no athlete has a workout
+// running in train view and we aren't running on battery. One for the
+// whole process, since the athletes open share the machine.
+class MaintenanceScheduler : public QObject
+{
+    Q_OBJECT
+    G_OBJECT
+
+    public:
+        static MaintenanceScheduler *instance();
+
+        // tasks are owned by the scheduler, remove them
+        // all before the context they use is deleted
+        void addTask(MaintenanceTask *task);
+        void removeTasks(Context *context);
+
+        // all of a context's tasks, now and on this thread, for --batch
+        void runTasks(Context *context);
+
+        bool isIdle() const;
+        static bool isTraining() { return training > 0; } // any thread
+        static bool onBattery();
+
+    protected:
+        bool eventFilter(QObject *object, QEvent *event);
+
+    private slots:
+        void schedule();
+        void stepFinished();
+        void trainingStarted() { training.ref(); }
+        void trainingStopped() { if (training > 0) training.deref(); }
+        void contextDestroyed(QObject *);
+
+    private:
+        MaintenanceScheduler();
+        ~MaintenanceScheduler();
+
+        QList<MaintenanceTask*> tasks;
+        QList<QObject*> contexts; // we're connected to
+        QTimer timer;
+        QTime lastInput;
+
+        MaintenanceWorker *worker;
+        MaintenanceTask *running;
+
+        QTime batteryChecked; // checked once a minute at most
+        bool battery;
+
+        static QAtomicInt training;
+};
+
+// runs a step off the GUI thread
+class MaintenanceWorker : public QThread
+{
+    public:
+        MaintenanceWorker() : task(NULL) {}
+        void run() { if (task) task->step(); }
+
+        MaintenanceTask *task;
+};
+
+// rebuilds the .cpx files left behind by a new RideFileCacheVersion, rather
+// than all of them as the metrics are refreshed at startup. The most recent
+// rides go first, a batch at a time with one per core, and it doesn't wait
+// for the app to be idle. The charts use the old ones meanwhile if they are
+// RideFileCacheReadable, or rebuild any they need straight away if not.
+// Restarts when the version changes
+class CpxRebuildTask : public MaintenanceTask
+{
+    public:
+        CpxRebuildTask(Context *context);
+
+        bool pending();
+        void step();
+        void done();
+        bool urgent() { return true; }
+
+    private:
+        QStringList rides;  // newest first
+        int next;           // the first not checked yet
+        QList<QPair<QString, QByteArray> > rebuilt; // and their bests, stored in done()
+
+        WeightTimeline weights;
+        double defaultWeight;
+};
+
+// a stale heatmap is rebuilt from all the rides, see Heatmap
+class HeatmapRebuildTask : public MaintenanceTask
+{
+    public:
+        HeatmapRebuildTask(Context *context, Heatmap *heatmap);
+
+        bool pending();
+        void step();
+
+    private:
+        Heatmap *heatmap;
+        QStringList rides;
+        int next;
+};
+
+#endif // _GC_Maintenance_h
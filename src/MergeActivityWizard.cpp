@@ -266,26 +266,32 @@ MergeSync::initializePage()
     findBestDelay();
 }
 
-QVector<DataPoint*>
+QVector<DataPoint>
 MergeSync::getSamplesForRide(RideFile *ride1)
 {
-    QVector<DataPoint*> sample;
+    QVector<DataPoint> sample;
+
+    // we walk the points themselves, there is no need
+    // to copy them to interpolate between neighbours
+    const QVector<RideFilePoint*> &points = ride1->dataPoints();
+    if (points.count() < 3) return sample;
 
     int index = 0;
 
-    double minTime = ride1->getPointValue(0, RideFile::secs);
+    double minTime = points.first()->secs;
     double maxTime = ride1->getMaxPoint(RideFile::secs).toDouble();
+    sample.reserve(qMax(0.0, maxTime - minTime));
 
-    DataPoint *previousPoint = new DataPoint(ride1->getPointValue(index, RideFile::secs),  ride1->getPointValue(index, RideFile::watts),  ride1->getPointValue(index, RideFile::cad),  ride1->getPointValue(index, RideFile::kph), ride1->getPointValue(index, RideFile::alt), ride1->getPointValue(index++, RideFile::hr));
-    DataPoint *currentPoint = new DataPoint(ride1->getPointValue(index, RideFile::secs),  ride1->getPointValue(index, RideFile::watts),  ride1->getPointValue(index, RideFile::cad),  ride1->getPointValue(index, RideFile::kph), ride1->getPointValue(index, RideFile::alt), ride1->getPointValue(index++, RideFile::hr));
-    DataPoint *nextPoint = new DataPoint(ride1->getPointValue(index, RideFile::secs),  ride1->getPointValue(index, RideFile::watts),  ride1->getPointValue(index, RideFile::cad),  ride1->getPointValue(index, RideFile::kph), ride1->getPointValue(index, RideFile::alt), ride1->getPointValue(index++, RideFile::hr));
+    const RideFilePoint *previousPoint = points[index++];
+    const RideFilePoint *currentPoint = points[index++];
+    const RideFilePoint *nextPoint = points[index++];
 
     for (int secs = minTime+1; secs < maxTime; ++secs) {
         double hr = 0.0, watts = 0.0, alt = 0.0, cad = 0.0, kph = 0.0;
-        while (currentPoint->time <= secs) {
+        while (currentPoint->secs <= secs) {
             // current point
-            if (currentPoint->time>secs-1) {
-                double pond = (currentPoint->time-secs+1);
+            if (currentPoint->secs>secs-1) {
+                double pond = (currentPoint->secs-secs+1);
                 hr+=pond*currentPoint->hr;
                 watts+=pond*currentPoint->watts;
                 alt+=pond*currentPoint->alt;
@@ -295,20 +301,18 @@ MergeSync::getSamplesForRide(RideFile *ride1)
             previousPoint = currentPoint;
             currentPoint = nextPoint;
 
-            //watts, cad, kph, alt, hr;
-            //if (secs < maxTime-ride1->recIntSecs())
-            if (index <= ride1->timeIndex(maxTime))
-                nextPoint = new DataPoint(ride1->getPointValue(index, RideFile::secs),  ride1->getPointValue(index, RideFile::watts),  ride1->getPointValue(index, RideFile::cad),  ride1->getPointValue(index, RideFile::kph), ride1->getPointValue(index, RideFile::alt), ride1->getPointValue(index++, RideFile::hr));
+            if (index < points.count())
+                nextPoint = points[index++];
         }
         // next point
         // pause ?
-        if (currentPoint->time>secs+300) {
-            secs = currentPoint->time;
+        if (currentPoint->secs>secs+300) {
+            secs = currentPoint->secs;
             continue;
         }
         // next point contribution
-        if (currentPoint->time>secs && previousPoint->time<secs) {
-            double pond = (secs-previousPoint->time);
+        if (currentPoint->secs>secs && previousPoint->secs<secs) {
+            double pond = (secs-previousPoint->secs);
             hr+=pond*currentPoint->hr;
             watts+=pond*currentPoint->watts;
             alt+=pond*currentPoint->alt;
@@ -316,18 +320,21 @@ MergeSync::getSamplesForRide(RideFile *ride1)
             kph+=pond*currentPoint->kph;
         }
 
-        DataPoint *pt = new DataPoint(secs, watts, cad, kph, alt, hr);
-        sample.append(pt);
+        sample.append(DataPoint(secs, watts, cad, kph, alt, hr));
     }
     return sample;
 }
 
 void
-MergeSync::analyse(QVector<DataPoint*> points1, QVector<DataPoint*> points2, int analysesCount)
+MergeSync::analyse(const QVector<DataPoint> &points1, const QVector<DataPoint> &points2, int analysesCount)
 {
-    for (int j=0;j<points2.count();j++) {
+    // slide points2 along points1 by offset j; once fewer than
+    // samplesLength points remain every diff is 1 and can't be a best
+    // but we still need one pass to set up minR and delay
+    int offsets = qMax(qMin(points2.count(), 1), points2.count()-samplesLength+1);
+    for (int j=0;j<offsets;j++) {
         for (int sample=0;sample<samplesCount;sample++) {
-            DataPoint pt = diffForSeries(points1, points2, sample*samplesLength, samplesLength);
+            DataPoint pt = diffForSeries(points1, points2, sample*samplesLength, j, samplesLength);
             for (int series=0;series<seriesCount;series++) {
                 double r=1;
                 //watts, cad, kph, alt, hr;
@@ -361,7 +368,6 @@ MergeSync::analyse(QVector<DataPoint*> points1, QVector<DataPoint*> points2, int
                 }
             }
         }
-        points2.remove(0);
     }
 }
 
@@ -378,8 +384,8 @@ MergeSync::findBestDelay()
 void
 MergeSync::findDelays(RideFile *ride1, RideFile *ride2)
 {
-    QVector<DataPoint*> sample1 = getSamplesForRide(ride1);
-    QVector<DataPoint*> sample2 = getSamplesForRide(ride2);
+    QVector<DataPoint> sample1 = getSamplesForRide(ride1);
+    QVector<DataPoint> sample2 = getSamplesForRide(ride2);
 
     analyse(sample1, sample2, 0);
     analyse(sample2, sample1, 1);
@@ -522,10 +528,10 @@ MergeSync::setDelayFromSlider()
 }
 
 DataPoint
-MergeSync::diffForSeries(QVector<DataPoint*> a1, QVector<DataPoint*> a2, int start, int length)
+MergeSync::diffForSeries(const QVector<DataPoint> &a1, const QVector<DataPoint> &a2, int start, int offset, int length)
 {
     DataPoint result(1,1,1,1,1,1);
-    if (a1.count()-start < length  || a2.count()<length)
+    if (a1.count()-start < length  || a2.count()-offset < length)
         return result;
 
     //watts, cad, kph, alt, hr;
@@ -537,28 +543,28 @@ MergeSync::diffForSeries(QVector<DataPoint*> a1, QVector<DataPoint*> a2, int sta
     for (int i=0;i<length;i++)
     {
         if (hr) {
-            diffHr+=qAbs(a1[i+start]->hr-a2[i]->hr);
-            totalHr+=a1[i+start]->hr;
+            diffHr+=qAbs(a1[i+start].hr-a2[i+offset].hr);
+            totalHr+=a1[i+start].hr;
         }
         if (watts) {
-            diffWatts+=qAbs(a1[i+start]->watts-a2[i]->watts);
-            totalWatts+=a1[i+start]->watts;
+            diffWatts+=qAbs(a1[i+start].watts-a2[i+offset].watts);
+            totalWatts+=a1[i+start].watts;
         }
         if (cad) {
-            diffCad+=qAbs(a1[i+start]->cad-a2[i]->cad);
-            totalCad+=a1[i+start]->cad;
+            diffCad+=qAbs(a1[i+start].cad-a2[i+offset].cad);
+            totalCad+=a1[i+start].cad;
         }
         if (kph) {
-            diffKph+=qAbs(a1[i+start]->kph-a2[i]->kph);
-            totalKph+=a1[i+start]->kph;
+            diffKph+=qAbs(a1[i+start].kph-a2[i+offset].kph);
+            totalKph+=a1[i+start].kph;
         }
         if (alt) {
             if (i==0)
-                offsetAlt = a1[i+start]->alt-a2[i]->alt;
+                offsetAlt = a1[i+start].alt-a2[i+offset].alt;
             else
-                variabilityAlt += qAbs(a1[i+start]->alt-a1[i+start-1]->alt);
-            diffAlt+=qAbs(a1[i+start]->alt-a2[i]->alt-offsetAlt);
-            totalAlt+=qAbs(a1[i+start]->alt);
+                variabilityAlt += qAbs(a1[i+start].alt-a1[i+start-1].alt);
+            diffAlt+=qAbs(a1[i+start].alt-a2[i+offset].alt-offsetAlt);
+            totalAlt+=qAbs(a1[i+start].alt);
         }
     }
 
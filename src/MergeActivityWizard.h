@@ -47,6 +47,7 @@ class MergeSyncBackground;
 struct DataPoint {
     double time, watts, cad, kph, alt, hr;
     //watts, cad, kph, alt, hr;
+    DataPoint() : time(0), watts(0), cad(0), kph(0), alt(0), hr(0) {}
     DataPoint(double t, double w, double c, double k, double a, double h ) :
         time(t), watts(w), cad(c), kph(k), alt(a), hr(h) {}
 };
@@ -178,12 +179,13 @@ class MergeSync : public QWizardPage
         QList<QList<double> > minR;
 
 
-        QVector<DataPoint*> getSamplesForRide(RideFile *ride1);
-        void analyse(QVector<DataPoint*> points1, QVector<DataPoint*> points2, int analysesCount);
+        QVector<DataPoint> getSamplesForRide(RideFile *ride1);
+        void analyse(const QVector<DataPoint> &points1, const QVector<DataPoint> &points2, int analysesCount);
         void findDelays(RideFile *ride1, RideFile *ride2);
         int bestDelay();
         void printDelays();
-        DataPoint diffForSeries(QVector<DataPoint*> a1, QVector<DataPoint*> a2, int start, int length);
+        // compare a1 from start with a2 from offset, over length samples
+        DataPoint diffForSeries(const QVector<DataPoint> &a1, const QVector<DataPoint> &a2, int start, int offset, int length);
         void removeDelayFromRide( RideFile *ride, int delay );
 
         void setDelay(int delay);
@@ -23,6 +23,14 @@
 #include "DBAccess.h"
 #include "RideFile.h"
 #include "RideFileCache.h"
+#include "IntervalDetector.h"
+#include "Segments.h"
+#include "Heatmap.h"
+#include "RideProfile.h"
+#include "Maintenance.h"
+#include "Trace.h"
+#include "CacheStats.h"
+#include "MetricsExport.h"
 #ifdef GC_HAVE_LUCENE
 #include "Lucene.h"
 #endif
@@ -35,21 +43,44 @@
 #include <math.h>
 #include <QtXml/QtXml>
 #include <QProgressDialog>
+#include <stdio.h>
+#include <QTimer>
+#include <QCryptographicHash>
 
-MetricAggregator::MetricAggregator(Context *context) : QObject(context), context(context)
+static CacheStats seasonStats("Season summaries", GC_SEASONCACHE_MB, 32);
+
+MetricAggregator::MetricAggregator(Context *context) : QObject(context), context(context), weightsStale(true), refresh(NULL)
 {
     colorEngine = new ColorEngine(context);
     dbaccess = new DBAccess(context);
+    heatmap_ = new Heatmap(context);
+
+    // housekeeping left until the app is idle
+    MaintenanceScheduler::instance()->addTask(new CpxRebuildTask(context));
+    MaintenanceScheduler::instance()->addTask(new HeatmapRebuildTask(context, heatmap_));
+
+    refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(250);
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(refreshBatch()));
+
     connect(context, SIGNAL(configChanged()), this, SLOT(update()));
     connect(context, SIGNAL(rideClean(RideItem*)), this, SLOT(update(void)));
     connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(addRide(RideItem*)));
     connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(update(void)));
+
+    // the cached seasons go stale with the rides in them
+    connect(this, SIGNAL(metricsChanged(QDate)), this, SLOT(seasonsChanged(QDate)));
+    connect(context, SIGNAL(configChanged()), this, SLOT(clearSeasons()));
 }
 
 MetricAggregator::~MetricAggregator()
 {
+    if (refresh) finishRefresh(true);
+    clearSeasons();
+    MaintenanceScheduler::instance()->removeTasks(context);
     delete colorEngine;
     delete dbaccess;
+    delete heatmap_;
 }
 
 /*----------------------------------------------------------------------
@@ -59,7 +90,7 @@ MetricAggregator::~MetricAggregator()
  *----------------------------------------------------------------------*/
 
 // used to store timestamp and fingerprint used in database
-struct status { unsigned long timestamp, fingerprint; };
+struct status { unsigned long timestamp; MetricFingerprints fingerprints; };
 
 // Refresh not up to date metrics
 void MetricAggregator::refreshMetrics()
@@ -83,30 +114,238 @@ MetricAggregator::allActivityFilenames()
 }
 
 
-// Refresh not up to date metrics and metrics after date
+// the state of a refresh whilst it is running, whether we are
+// waiting for it in refreshMetrics() or it is running in the background
+struct MetricRefresh
+{
+    MetricRefresh(QList<MetricRefreshItem> todo, int maxdone)
+    : queue(todo, maxdone), total(todo.count()), processed(0), written(0), restart(false) {}
+
+    MetricRefreshQueue queue;
+    QList<MetricRefreshWorker*> workers;
+    int total, processed, written;
+    QString current;
+
+    // asked to refresh again whilst we were running
+    bool restart;
+    QDateTime restartAfter;
+
+    QTime elapsed, lastCommit;
+    QFile log;
+    QTextStream out;
+
+    // the segments the rides are matched against, and the climbs added
+    // as new segments by the writer (with the ride they came from) that
+    // the rides already written must be matched against when we finish
+    QList<Segment> segments;
+    QList<Segment> created;
+    QStringList createdFrom;
+};
+
+// refreshes running for all the athletes open in this process, newest
+// first. They share the cpus rather than each taking all of them, and
+// only the newest runs at normal priority since that is the athlete
+// the user just opened or changed
+static QList<MetricRefresh*> runningRefreshes;
+
+// Refresh not up to date metrics and metrics after date, waiting
+// for it to complete (and seeing through any background refresh)
 void MetricAggregator::refreshMetrics(QDateTime forceAfterThisDate)
+{
+    if (refresh == NULL && !startRefresh(forceAfterThisDate)) return;
+
+    // we do the writing from here on
+    refreshTimer->stop();
+
+    // update statistics for ride files which are out of date
+    // showing a progress bar as we go
+    QString title = tr("Refreshing Ride Statistics...\nStarted");
+    QProgressDialog *bar = NULL;
+    bool cancelled = false;
+    int reported = 0;
+
+    QApplication::processEvents(); // get that dialog up!
+
+    // we are the single writer, results arrive in any order
+    while (refresh->processed < refresh->total) {
+
+        bool got = writeRefreshed(100);
+
+        // create the dialog if we need to show progress for long running uodate
+        long elapsedtime = refresh->elapsed.elapsed();
+        if (elapsedtime > 6000 && bar == NULL && context->mainWindow) {
+            bar = new QProgressDialog(title, tr("Abort"), 0, refresh->total, context->mainWindow);
+            bar->setWindowModality(Qt::WindowModal);
+            bar->setMinimumDuration(0);
+            bar->show(); // lets hide until elapsed time is > 6 seconds
+        }
+
+        // update the dialog always after 6 seconds
+        if (elapsedtime > 6000 && got && bar) {
+
+            // update progress bar
+            QString elapsedString = QString("%1:%2:%3").arg(elapsedtime/3600000,2)
+                                                .arg((elapsedtime%3600000)/60000,2,10,QLatin1Char('0'))
+                                                .arg((elapsedtime%60000)/1000,2,10,QLatin1Char('0'));
+            QString title = tr("Refreshing Ride Statistics...\nElapsed: %1\n%2").arg(elapsedString).arg(refresh->current);
+            bar->setLabelText(title);
+            bar->setValue(refresh->processed);
+
+        } else if (elapsedtime > 6000 && got && context->mainWindow == NULL &&
+                   (refresh->processed >= reported + 100 || refresh->processed == refresh->total)) {
+
+            // run --batch, so to the console
+            reported = refresh->processed;
+            fprintf(stderr, "refreshing metrics: %d of %d\n", refresh->processed, refresh->total);
+        }
+        QApplication::processEvents();
+
+        // somebody cancelled it whilst we processed events
+        if (refresh == NULL) break;
+
+        if (bar && bar->wasCanceled()) {
+            cancelled = true;
+            break;
+        }
+    }
+
+    // now zap the progress bar
+    if (bar) delete bar;
+
+    if (refresh) finishRefresh(cancelled);
+}
+
+// Refresh in the background, the results are committed and dataChanged()
+// is signalled in batches as they arrive, so readers always see a
+// consistent snapshot of the rides refreshed so far
+void MetricAggregator::refreshMetricsInBackground(QDateTime forceAfterThisDate)
+{
+    // already running, go round again when it finishes
+    if (refresh) {
+        refresh->restart = true;
+        if (!forceAfterThisDate.isNull() && (refresh->restartAfter.isNull() || forceAfterThisDate < refresh->restartAfter))
+            refresh->restartAfter = forceAfterThisDate;
+        return;
+    }
+
+    if (startRefresh(forceAfterThisDate)) refreshTimer->start();
+}
+
+void MetricAggregator::cancelRefresh()
+{
+    if (refresh == NULL) return;
+
+    refreshTimer->stop();
+    finishRefresh(true);
+}
+
+// timer driven whilst refreshing in the background
+void MetricAggregator::refreshBatch()
+{
+    if (refresh == NULL) {
+        refreshTimer->stop();
+        return;
+    }
+
+    // a workout in train view has the machine, the workers
+    // stall once the done queue is full until it stops
+    if (MaintenanceScheduler::isTraining()) return;
+
+    // write what the workers have finished, but don't hog the GUI
+    QTime slice;
+    slice.start();
+    int written = refresh->written;
+    while (refresh->processed < refresh->total && slice.elapsed() < 100 && writeRefreshed(0)) ;
+
+    if (refresh->processed >= refresh->total) {
+        refreshTimer->stop();
+        finishRefresh(false);
+        return;
+    }
+
+    emit refreshProgress(refresh->processed, refresh->total);
+
+    // commit a batch at most every second
+    if (refresh->written > written && refresh->lastCommit.elapsed() > 1000) {
+        refresh->out << "COMMIT BATCH: " << refresh->processed << "/" << refresh->total << "\r\n";
+        dbaccess->flushDaily();
+        dbaccess->connection().commit();
+        dbaccess->connection().transaction();
+        refresh->lastCommit.start();
+        dataChanged(); // notify models/views
+    }
+}
+
+// take a ride the workers have finished with and write it
+// returns false if none arrived in time
+bool MetricAggregator::writeRefreshed(unsigned long msecs)
+{
+    MetricRefreshItem item;
+    if (!refresh->queue.takeDone(item, msecs)) return false;
+
+    refresh->processed++;
+    refresh->current = item.name;
+    GC_TRACE_COUNTER("rides refreshed", refresh->processed);
+
+    if (item.bestsRead) dbaccess->importBests(item.name, item.bests);
+    if (item.touched && item.ride == NULL) dbaccess->touchRide(item.name);
+
+    if (item.ride != NULL && item.partial) {
+        refresh->out << "Updating changed statistics (" << item.changed << "): " << item.name << "\r\n";
+        writeChanged(item.summary, item.ride, item.current, item.changed);
+        if (item.intervalsRead) dbaccess->importIntervals(item.name, item.intervals);
+        delete item.ride;
+        refresh->written++;
+
+    } else if (item.ride != NULL) {
+        refresh->out << "Updating statistics: " << item.name << "\r\n";
+        writeRide(item.summary, item.ride, item.current, (item.dbTimeStamp > 0));
+        dbaccess->importIntervals(item.name, item.intervals);
+        if (item.segmentsRead) {
+            int created = refresh->created.count();
+            Segments::store(dbaccess, item.name, item.ride, item.segments, refresh->created);
+            while (refresh->createdFrom.count() < refresh->created.count()) refresh->createdFrom << item.name;
+            if (refresh->created.count() > created)
+                refresh->out << "New segments: " << (refresh->created.count() - created) << "\r\n";
+        }
+        if (item.heatRead) heatmap_->add(item.name, item.heat, item.db.samples != item.current.samples);
+        if (item.profileRead) dbaccess->importProfile(item.name, item.profile);
+        delete item.ride;
+        refresh->written++;
+    }
+    return true;
+}
+
+// work out what needs doing and start the workers
+bool MetricAggregator::startRefresh(QDateTime forceAfterThisDate)
 {
     // only if we have established a connection to the database
-    if (dbaccess == NULL || context->athlete->isclean==true) return;
+    if (dbaccess == NULL || context->athlete->isclean==true) return false;
 
     // first check db structure is still up to date
     // this is because metadata.xml may add new fields
     dbaccess->checkDBVersion();
 
     // Get a list of the ride files
-    QRegExp rx = RideFileFactory::instance().rideFileRegExp();
-    QStringList filenames = RideFileFactory::instance().listRideFiles(context->athlete->home);
+    QStringList filenames = context->athlete->allRideFiles();
     QStringListIterator i(filenames);
+    QSet<QString> exists = filenames.toSet();
 
     // get a Hash map of statistic records and timestamps
     QSqlQuery query(dbaccess->connection());
     QHash <QString, status> dbStatus;
-    bool rc = query.exec("SELECT filename, timestamp, fingerprint FROM metrics ORDER BY ride_date;");
+    bool rc = query.exec("SELECT filename, timestamp, fingerprint, hrfingerprint, samples, weight, athleteweight, content "
+                         "FROM metrics ORDER BY ride_date;");
     while (rc && query.next()) {
         status add;
         QString filename = query.value(0).toString();
         add.timestamp = query.value(1).toInt();
-        add.fingerprint = query.value(2).toInt();
+        add.fingerprints.zones = query.value(2).toInt();
+        add.fingerprints.hrZones = query.value(3).toInt();
+        add.fingerprints.samples = query.value(4).toInt();
+        add.fingerprints.weight = query.value(5).toDouble();
+        add.fingerprints.athleteWeight = query.value(6).toDouble();
+        add.fingerprints.content = query.value(7).toInt();
         dbStatus.insert(filename, add);
     }
 
@@ -116,128 +355,142 @@ void MetricAggregator::refreshMetrics(QDateTime forceAfterThisDate)
     // Delete statistics for non-existant ride files
     QHash<QString, status>::iterator d;
     for (d = dbStatus.begin(); d != dbStatus.end(); ++d) {
-        if (QFile(context->athlete->home.absolutePath() + "/" + d.key()).exists() == false) {
+        if (!exists.contains(d.key())) {
             dbaccess->deleteRide(d.key());
+            heatmap_->remove(d.key());
+
+            QDateTime dt;
+            if (RideFile::parseRideFileName(d.key(), &dt)) emit metricsChanged(dt.date());
 #ifdef GC_HAVE_LUCENE
             context->athlete->lucene->deleteRide(d.key());
 #endif
         }
     }
 
-    unsigned long zoneFingerPrint = static_cast<unsigned long>(context->athlete->zones()->getFingerprint())
-                                  + static_cast<unsigned long>(context->athlete->hrZones()->getFingerprint()); // checksum of *all* zone data (HR and Power)
-
-    // update statistics for ride files which are out of date
-    // showing a progress bar as we go
-    QTime elapsed;
-    elapsed.start();
-    QString title = tr("Refreshing Ride Statistics...\nStarted");
-    QProgressDialog *bar = NULL;
-
-    int processed=0;
-    QApplication::processEvents(); // get that dialog up!
-
-    // log of progress
-    QFile log(context->athlete->home.absolutePath() + "/" + "metric.log");
-    log.open(QIODevice::WriteOnly);
-    log.resize(0);
-    QTextStream out(&log);
-    out << "METRIC REFRESH STARTS: " << QDateTime::currentDateTime().toString() + "\r\n";
-
+    // work out what needs to be done for each ride, the workers
+    // will check the file timestamps themselves. Each ride is checked
+    // against the zone ranges and weight for its own date, so editing
+    // one range only refreshes the rides that fall within it, and then
+    // only the metrics that depend on it
+    QHash<QDate, MetricFingerprints> fingerprints;
+    QList<MetricRefreshItem> todo;
     while (i.hasNext()) {
-        QString name = i.next();
-        QFile file(context->athlete->home.absolutePath() + "/" + name);
-
-        // if it s missing or out of date then update it!
-        status current = dbStatus.value(name);
-        unsigned long dbTimeStamp = current.timestamp;
-        unsigned long fingerprint = current.fingerprint;
-
-        RideFile *ride = NULL;
-
-        processed++;
-
-        // create the dialog if we need to show progress for long running uodate
-        long elapsedtime = elapsed.elapsed();
-        if (elapsedtime > 6000 && bar == NULL) {
-            bar = new QProgressDialog(title, tr("Abort"), 0, filenames.count(), context->mainWindow);
-            bar->setWindowModality(Qt::WindowModal);
-            bar->setMinimumDuration(0);
-            bar->show(); // lets hide until elapsed time is > 6 seconds
-        }
-
-        // update the dialog always after 6 seconds
-        if (elapsedtime > 6000) {
-
-            // update progress bar
-            QString elapsedString = QString("%1:%2:%3").arg(elapsedtime/3600000,2)
-                                                .arg((elapsedtime%3600000)/60000,2,10,QLatin1Char('0'))
-                                                .arg((elapsedtime%60000)/1000,2,10,QLatin1Char('0'));
-            QString title = tr("Refreshing Ride Statistics...\nElapsed: %1\n%2").arg(elapsedString).arg(name);
-            bar->setLabelText(title);
-            bar->setValue(processed);
-        }
-        QApplication::processEvents();
-
-        if (dbTimeStamp < QFileInfo(file).lastModified().toTime_t() ||
-            zoneFingerPrint != fingerprint ||
-            (!forceAfterThisDate.isNull() && name >= forceAfterThisDate.toString("yyyy_MM_dd_hh_mm_ss"))) {
-            QStringList errors;
-
-            // log
-            out << "Opening ride: " << name << "\r\n";
+        MetricRefreshItem item;
+        item.name = i.next();
+
+        QDateTime dt;
+        RideFile::parseRideFileName(item.name, &dt);
+        QHash<QDate, MetricFingerprints>::const_iterator f = fingerprints.constFind(dt.date());
+        if (f == fingerprints.constEnd()) f = fingerprints.insert(dt.date(), fingerprintsOn(dt.date()));
+        item.current = f.value();
+
+        status current = dbStatus.value(item.name);
+        item.dbTimeStamp = current.timestamp;
+        item.db = current.fingerprints;
+        item.stale = current.timestamp == 0 ||
+                     (!forceAfterThisDate.isNull() && item.name >= forceAfterThisDate.toString("yyyy_MM_dd_hh_mm_ss"));
+        todo << item;
+    }
 
-            // read file and process it if we didn't already...
-            if (ride == NULL) ride = RideFileFactory::instance().openRideFile(context, file, errors);
+    // rides are opened and metrics computed by a pool of workers, we
+    // fetch what they need from the database before they start since
+    // the connection can only be used from this thread
+    int threads = QThread::idealThreadCount() / (runningRefreshes.count() + 1);
+    if (threads < 1) threads = 1;
 
-            out << "File open completed: " << name << "\r\n";
+    double defaultWeight = appsettings->cvalue(context->athlete->cyclist, GC_WEIGHT, "75.0").toString().toDouble();
 
-            if (ride != NULL) {
+    refresh = new MetricRefresh(todo, threads * 2);
+    refresh->segments = dbaccess->getSegments();
+    refresh->elapsed.start();
+    refresh->lastCommit.start();
 
-                out << "Getting weight: " << name << "\r\n";
-                ride->getWeight();
-                out << "Updating statistics: " << name << "\r\n";
-                importRide(context->athlete->home, ride, name, zoneFingerPrint, (dbTimeStamp > 0));
+    // log of progress
+    refresh->log.setFileName(context->athlete->home.absolutePath() + "/" + "metric.log");
+    refresh->log.open(QIODevice::WriteOnly);
+    refresh->log.resize(0);
+    refresh->out.setDevice(&refresh->log);
+    refresh->out << "METRIC REFRESH STARTS: " << QDateTime::currentDateTime().toString() + "\r\n";
+    refresh->out << "WORKER THREADS: " << threads << "\r\n";
+
+    // every worker computes with the same configuration
+    RideMetricConfig config(context);
+    for (int t=0; t<threads; t++) {
+        MetricRefreshWorker *worker = new MetricRefreshWorker(context, &refresh->queue, config, weights(), defaultWeight,
+                                                             &refresh->segments);
+        refresh->workers << worker;
+        worker->start();
+    }
 
-            }
-        }
+    // the others step back
+    foreach(MetricRefresh *other, runningRefreshes)
+        foreach(MetricRefreshWorker *worker, other->workers) worker->setPriority(QThread::LowPriority);
+    runningRefreshes.prepend(refresh);
 
-        // update cache (will check timestamps itself)
-        // if ride wasn't opened it will do it itself
-        // we only want to check so passing check=true
-        // because we don't actually want the results now
-        RideFileCache updater(context, context->athlete->home.absolutePath() + "/" + name, ride, true);
+    emit refreshStarted(refresh->total);
+    return true;
+}
 
-        // free memory - if needed
-        if (ride) delete ride;
+void MetricAggregator::finishRefresh(bool cancelled)
+{
+    QTextStream &out = refresh->out;
+    if (cancelled) {
+        out << "METRIC REFRESH CANCELLED\r\n";
+        refresh->queue.cancel();
+    }
 
-        if (bar && bar->wasCanceled()) {
-            out << "METRIC REFRESH CANCELLED\r\n";
-            break;
+    // wait for the workers to finish, then discard
+    // anything left over if we were cancelled
+    foreach(MetricRefreshWorker *worker, refresh->workers) {
+        worker->wait();
+        delete worker;
+    }
+    MetricRefreshItem leftover;
+    while (refresh->queue.takeDone(leftover, 0)) if (leftover.ride) delete leftover.ride;
+
+    // the rides written before a new segment was found may be on it too
+    if (!cancelled) {
+        for (int i=0; i<refresh->created.count(); i++) {
+            int efforts = Segments::backfill(context, dbaccess, refresh->created[i], refresh->createdFrom[i]);
+            out << "SEGMENT " << refresh->created[i].name << ": " << efforts << " efforts\r\n";
         }
     }
 
-    // now zap the progress bar
-    if (bar) delete bar;
-
     // end LUW -- now syncs DB
     out << "COMMIT: " << QDateTime::currentDateTime().toString() + "\r\n";
+    dbaccess->flushDaily();
     dbaccess->connection().commit();
 
-#ifdef GC_HAVE_LUCENE
-#ifndef WIN32 // windows crashes here....
-    out << "OPTIMISE: " << QDateTime::currentDateTime().toString() + "\r\n";
-    context->athlete->lucene->optimise();
-#endif
-#endif
+    // the heatmap tiles too, rides that changed or were deleted
+    // can only be taken out of it by starting again, when idle
+    heatmap_->flush();
+    if (heatmap_->isStale()) out << "HEATMAP STALE\r\n";
+
     context->athlete->isclean = true;
 
     // stop logging
     out << "SIGNAL DATA CHANGED: " << QDateTime::currentDateTime().toString() + "\r\n";
+    emit refreshFinished();
     dataChanged(); // notify models/views
 
     out << "METRIC REFRESH ENDS: " << QDateTime::currentDateTime().toString() + "\r\n";
-    log.close();
+    refresh->log.close();
+
+    // the next most recent gets its priority back
+    runningRefreshes.removeAll(refresh);
+    if (!runningRefreshes.isEmpty())
+        foreach(MetricRefreshWorker *worker, runningRefreshes.first()->workers) worker->setPriority(QThread::NormalPriority);
+
+    bool restart = refresh->restart;
+    QDateTime restartAfter = refresh->restartAfter;
+    delete refresh;
+    refresh = NULL;
+
+    // things changed whilst we were running
+    if (restart) {
+        context->athlete->isclean = false;
+        refreshMetricsInBackground(restartAfter);
+    }
 }
 
 /*----------------------------------------------------------------------
@@ -248,22 +501,63 @@ void MetricAggregator::refreshMetrics(QDateTime forceAfterThisDate)
 void MetricAggregator::addRide(RideItem*ride)
 {
     if (ride && ride->ride()) {
-        importRide(context->athlete->home, ride->ride(), ride->fileName, context->athlete->zones()->getFingerprint(), true);
+        importRide(context->athlete->home, ride->ride(), ride->fileName, true);
+        dbaccess->importProfile(ride->fileName, RideProfile::summarise(ride->ride()));
         RideFileCache updater(context, context->athlete->home.absolutePath() + "/" + ride->fileName, ride->ride(), true); // update cpx etc
+        dbaccess->importBests(ride->fileName, RideFileCache::standardBests(context, ride->fileName));
         dataChanged(); // notify models/views
     }
 }
 
+// the checksums of the power and hr zone ranges that apply on a date
+// and the weight, stored with the metrics to spot which of them need
+// recomputing. The ride's own are added once it is opened
+MetricFingerprints MetricAggregator::fingerprintsOn(const QDate &date)
+{
+    MetricFingerprints fingerprints;
+    fingerprints.zones = context->athlete->zones()->getFingerprint(date);
+    fingerprints.hrZones = context->athlete->hrZones()->getFingerprint(date);
+
+    double defaultWeight = appsettings->cvalue(context->athlete->cyclist, GC_WEIGHT, "75.0").toString().toDouble();
+    fingerprints.athleteWeight = weightOn(date, weights(), defaultWeight);
+    return fingerprints;
+}
+
 void MetricAggregator::update() {
     context->athlete->isclean = false;
-    refreshMetrics();
+    refreshMetricsInBackground();
 }
 
-bool MetricAggregator::importRide(QDir path, RideFile *ride, QString fileName, unsigned long fingerprint, bool modify)
+bool MetricAggregator::importRide(QDir, RideFile *ride, QString fileName, bool modify)
 {
     SummaryMetrics summaryMetric;
-    QFile file(path.absolutePath() + "/" + fileName);
+    if (!computeRide(context, RideMetricConfig(context, context->athlete->zones(), context->athlete->hrZones()),
+                     ride, fileName, summaryMetric)) return false;
+
+    MetricFingerprints fingerprints = fingerprintsOn(ride->startTime().date());
+    fingerprints.samples = samplesFingerPrint(ride);
+    fingerprints.weight = ride->getWeight();
+    fingerprints.content = contentFingerPrint(context->athlete->home.absolutePath() + "/" + fileName);
+
+    writeRide(summaryMetric, ride, fingerprints, modify);
+
+    QList<DetectedInterval> intervals = IntervalDetector::detect(ride);
+    dbaccess->importIntervals(fileName, intervals);
+
+    // its efforts, and any climbs new to us are matched against the others
+    RideSegments segments = Segments::find(ride, dbaccess->getSegments(), intervals);
+    QList<Segment> created;
+    Segments::store(dbaccess, fileName, ride, segments, created);
+    foreach(const Segment &segment, created) Segments::backfill(context, dbaccess, segment, fileName);
+
+    heatmap_->add(fileName, Heatmap::rasterize(ride), modify);
+    heatmap_->flush();
+    return true;
+}
 
+bool MetricAggregator::computeRide(Context *context, const RideMetricConfig &config, RideFile *ride,
+                                   QString fileName, SummaryMetrics &summaryMetric, const QStringList *only)
+{
     QRegExp rx = RideFileFactory::instance().rideFileRegExp();
     if (!rx.exactMatch(fileName)) {
         return false; // not a ridefile!
@@ -280,76 +574,349 @@ bool MetricAggregator::importRide(QDir path, RideFile *ride, QString fileName, u
     const RideMetricFactory &factory = RideMetricFactory::instance();
     QStringList metrics;
 
-    for (int i = 0; i < factory.metricCount(); ++i)
+    if (only) metrics = *only;
+    else for (int i = 0; i < factory.metricCount(); ++i)
         metrics << factory.metricName(i);
 
     // compute all the metrics
-    QHash<QString, RideMetricPtr> computed = RideMetric::computeMetrics(context, ride, context->athlete->zones(), context->athlete->hrZones(), metrics);
+    QHash<QString, RideMetricPtr> computed = RideMetric::computeMetrics(context, ride, config, metrics);
 
     // get metrics into summaryMetric QMap
-    for(int i = 0; i < factory.metricCount(); ++i) {
+    foreach(QString symbol, metrics) {
         // check for override
-        summaryMetric.setForSymbol(factory.metricName(i), computed.value(factory.metricName(i))->value(true));
+        summaryMetric.setForSymbol(symbol, computed.value(symbol)->value(true));
     }
+    return true;
+}
 
+unsigned long MetricAggregator::samplesFingerPrint(RideFile *ride)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+
+    // the recorded data, secs through lrbalance are all doubles so
+    // there is no padding between them, the derived data is skipped
+    foreach(const RideFilePoint *p, ride->dataPoints()) {
+        hash.addData(reinterpret_cast<const char *>(&p->secs), (&p->lrbalance - &p->secs + 1) * sizeof(double));
+        hash.addData(reinterpret_cast<const char *>(&p->interval), sizeof(p->interval));
+    }
+    double recIntSecs = ride->recIntSecs();
+    hash.addData(reinterpret_cast<const char *>(&recIntSecs), sizeof(recIntSecs));
+
+    // overrides are edited on the metadata form, but any metric
+    // might have one so they are counted as samples
+    QMapIterator<QString, QMap<QString,QString> > o(ride->metricOverrides);
+    while (o.hasNext()) {
+        o.next();
+        hash.addData(o.key().toUtf8());
+        hash.addData(o.value().value("value").toUtf8());
+    }
+
+    // 31 bits is plenty to spot a change and stays positive in the
+    // integer column, 0 is kept for none
+    QByteArray digest = hash.result();
+    unsigned long fingerprint = (uchar(digest[0] & 0x7f) << 24) | (uchar(digest[1]) << 16) | (uchar(digest[2]) << 8) | uchar(digest[3]);
+    return fingerprint ? fingerprint : 1;
+}
+
+unsigned long MetricAggregator::contentFingerPrint(QString filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+
+    // reading is quick next to parsing, in blocks to keep big files out of memory
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    while (!file.atEnd()) hash.addData(file.read(1 << 16));
+
+    QByteArray digest = hash.result();
+    unsigned long fingerprint = (uchar(digest[0] & 0x7f) << 24) | (uchar(digest[1]) << 16) | (uchar(digest[2]) << 8) | uchar(digest[3]);
+    return fingerprint ? fingerprint : 1;
+}
+
+void MetricAggregator::writeRide(SummaryMetrics &summaryMetric, RideFile *ride, const MetricFingerprints &fingerprints, bool modify)
+{
     // what color will this ride be?
     QColor color = colorEngine->colorFor(ride->getTag(context->athlete->rideMetadata()->getColorField(), ""));
 
-    dbaccess->importRide(&summaryMetric, ride, color, fingerprint, modify);
+    dbaccess->importRide(&summaryMetric, ride, color, fingerprints, modify);
 #ifdef GC_HAVE_LUCENE
-    context->athlete->lucene->importRide(&summaryMetric, ride, color, fingerprint, modify);
+    context->athlete->lucene->importRide(&summaryMetric, ride, color, fingerprints.zones, modify);
 #endif
 
-    return true;
+    emit metricsChanged(summaryMetric.getRideDate().date());
 }
 
-void
-MetricAggregator::importMeasure(SummaryMetrics *sm)
+// summary only has the metrics that depend on what changed, e.g. the
+// W/kg metrics for a new weight, so only those columns are written
+void MetricAggregator::writeChanged(SummaryMetrics &summaryMetric, RideFile *ride, const MetricFingerprints &fingerprints, int changed)
 {
-    dbaccess->importMeasure(sm);
+    // the color may have changed with the metadata
+    QColor color = colorEngine->colorFor(ride->getTag(context->athlete->rideMetadata()->getColorField(), ""));
+
+    dbaccess->updateRide(&summaryMetric, RideMetricFactory::instance().metricsDependingOn(changed), ride, color, fingerprints);
+#ifdef GC_HAVE_LUCENE
+    if (changed & RideMetric::Metadata)
+        context->athlete->lucene->importRide(&summaryMetric, ride, color, fingerprints.zones, true); // only indexes the texts
+#endif
+
+    // nothing to tell if the ride had its own weight
+    if (changed) emit metricsChanged(summaryMetric.getRideDate().date());
 }
 
 /*----------------------------------------------------------------------
- * Query functions are wrappers around DBAccess functions
+ * Metric refresh workers
  *----------------------------------------------------------------------*/
+
+bool
+MetricRefreshQueue::takeJob(MetricRefreshItem &item)
+{
+    QMutexLocker locker(&lock);
+    if (cancelled || todo.isEmpty()) return false;
+    item = todo.takeFirst();
+    return true;
+}
+
 void
-MetricAggregator::writeAsCSV(QString filename)
+MetricRefreshQueue::putDone(MetricRefreshItem &item)
 {
-    // write all metrics as a CSV file
-    QList<SummaryMetrics> all = getAllMetricsFor(QDateTime(), QDateTime());
+    QMutexLocker locker(&lock);
+    while (!cancelled && done.count() >= maxdone) notFull.wait(&lock);
+    done << item;
+    notEmpty.wakeOne();
+}
 
-    // write headings
-    if (!all.count()) return; // no dice
+bool
+MetricRefreshQueue::takeDone(MetricRefreshItem &item, unsigned long msecs)
+{
+    QMutexLocker locker(&lock);
+    if (done.isEmpty() && msecs) notEmpty.wait(&lock, msecs);
+    if (done.isEmpty()) return false;
+    item = done.takeFirst();
+    notFull.wakeOne();
+    return true;
+}
 
-    // open file.. truncate if exists already
-    QFile file(filename);
-    file.open(QFile::WriteOnly);
-    file.resize(0);
-    QTextStream out(&file);
+void
+MetricRefreshQueue::cancel()
+{
+    QMutexLocker locker(&lock);
+    cancelled = true;
+    notFull.wakeAll();
+}
 
-    // write headings
-    out<<"date, time, filename,";
-    QMapIterator<QString, double>i(all[0].values());
-    while (i.hasNext()) {
-        i.next();
-        out<<i.key()<<",";
+bool
+MetricRefreshQueue::isCancelled()
+{
+    QMutexLocker locker(&lock);
+    return cancelled;
+}
+
+WeightTimeline::WeightTimeline(const QList<SummaryMetrics> &measures)
+{
+    foreach(const SummaryMetrics &measure, measures) {
+        double weight = measure.getText("Weight", "0.0").toDouble();
+        if (weight > 0) {
+            dates << measure.getDateTime().date();
+            weights << weight;
+        }
+    }
+}
+
+double
+WeightTimeline::at(QDate date) const
+{
+    // first after date, the one before it is what we want
+    int index = qUpperBound(dates.begin(), dates.end(), date) - dates.begin();
+    return index ? weights[index-1] : 0;
+}
+
+const WeightTimeline &
+MetricAggregator::weights()
+{
+    if (weightsStale) {
+        weights_ = WeightTimeline(getAllMeasuresFor(QDateTime::fromString("Jan 1 00:00:00 1900"), QDateTime::currentDateTime()));
+        weightsStale = false;
     }
-    out<<"\n";
-
-    // write values
-    foreach(SummaryMetrics x, all) {
-        out<<x.getRideDate().date().toString("MM/dd/yy")<<","
-           <<x.getRideDate().time().toString()<<","
-           <<x.getFileName()<<",";
-
-        QMapIterator<QString, double>i(x.values());
-        while (i.hasNext()) {
-            i.next();
-            out<<i.value()<<",";
+    return weights_;
+}
+
+// same precedence as RideFile::getWeight() but using the
+// timeline fetched for us by the GUI thread
+double
+MetricAggregator::weightFor(RideFile *ride, const WeightTimeline &weights, double defaultWeight)
+{
+    double weight;
+
+    // ride
+    if ((weight = ride->getTag("Weight", "0.0").toDouble()) > 0) return weight;
+
+    return weightOn(ride->startTime().date(), weights, defaultWeight);
+}
+
+double
+MetricAggregator::weightOn(QDate date, const WeightTimeline &weights, double defaultWeight)
+{
+    double weight;
+
+    // withings?
+    if ((weight = weights.at(date)) > 0) return weight;
+
+    // global options, it must not be zero!!!
+    return defaultWeight > 0 ? defaultWeight : 75.00;
+}
+
+double
+MetricRefreshWorker::weightFor(RideFile *ride)
+{
+    return MetricAggregator::weightFor(ride, weights, defaultWeight);
+}
+
+void
+MetricRefreshWorker::run()
+{
+    MetricRefreshItem item;
+    while (queue->takeJob(item)) {
+
+        QFile file(context->athlete->home.absolutePath() + "/" + item.name);
+        RideFile *ride = NULL;
+
+        // what changed since the metrics were stored, a different weight
+        // for the day may not matter if the ride has its own, but we need
+        // to open it to find out
+        bool modified = item.dbTimeStamp < QFileInfo(file).lastModified().toTime_t();
+
+        // a newer file may only have been copied here, e.g. by syncing the
+        // home directory, and the metrics from the other machine still hold
+        if (modified && !item.stale && item.db.content) {
+            item.current.content = MetricAggregator::contentFingerPrint(file.fileName());
+            if (item.current.content == item.db.content) {
+                modified = false;
+                item.touched = true;
+            }
+        }
+        if (item.current.zones != item.db.zones) item.changed |= RideMetric::PowerZone;
+        if (item.current.hrZones != item.db.hrZones) item.changed |= RideMetric::HrZone;
+        bool weighed = item.current.athleteWeight != item.db.athleteWeight;
+
+        // if it s missing or out of date then update it!
+        bool refresh = item.stale || modified || item.changed || weighed;
+
+        // the cache would open the ride itself if it was out of date, but
+        // we need to set the weight ourselves, so we open it here instead.
+        // The time in zone blocks depend on the zones too. A .cpx that is
+        // only an old version is left for the CpxRebuildTask to do when idle
+        bool refreshCache = item.changed || (refresh && !RideFileCache::isCurrent(file.fileName(), item.current.content));
+
+        // the .cpx was copied with it, checking it brings its date up too
+        if (item.touched && !refreshCache) RideFileCache::isCurrent(file.fileName(), item.current.content);
+
+        if (refresh || refreshCache) {
+            QStringList errors;
+
+            // read file and process it
+            ride = RideFileFactory::instance().openRideFile(context, file, errors);
+
+            if (ride != NULL) ride->setWeight(weightFor(ride));
+        }
+
+        // the W/kg bests in the .cpx depend on it too
+        if (ride) {
+            item.current.weight = ride->getWeight();
+            if (item.current.weight != item.db.weight) {
+                item.changed |= RideMetric::Weight;
+                refresh = refreshCache = true;
+            }
+        }
+
+        // with the same samples we only need the metrics that depend on
+        // what did change, the metadata if it was rewritten. If only that
+        // then the intervals and .cpx can be kept as they are too
+        if (ride && refresh) {
+            item.current.samples = MetricAggregator::samplesFingerPrint(ride);
+            if (!item.current.content) item.current.content = MetricAggregator::contentFingerPrint(file.fileName());
+            item.partial = !item.stale && item.db.samples == item.current.samples;
+            if (item.partial && modified) item.changed |= RideMetric::Metadata;
+            if (item.partial && refreshCache && (item.changed & ~RideMetric::Metadata) == 0 &&
+                RideFileCache::keep(file.fileName())) refreshCache = false;
+        }
+
+        // update cache (will check timestamps itself)
+        // we only want to check so passing check=true
+        // because we don't actually want the results now
+        if (ride && refreshCache && !queue->isCancelled()) {
+            RideFileCache updater(context, file.fileName(), ride, true);
+        }
+
+        // and keep its bests in the database, the .cpx may have been
+        // brought up to date by a chart since the ride last changed
+        if (ride && (refreshCache || !item.partial) && !queue->isCancelled()) {
+            item.bests = RideFileCache::standardBests(context, item.name);
+            item.bestsRead = true;
         }
-        out<<"\n";
+
+        // compute metrics, if the ride was only opened for the cache
+        // then we don't hand it over to the writer
+        QStringList only;
+        if (item.partial) only = RideMetricFactory::instance().metricsDependingOn(item.changed);
+        if (ride && (!refresh || !MetricAggregator::computeRide(context, config, ride, item.name, item.summary,
+                                                                 item.partial ? &only : NULL))) {
+            delete ride;
+            ride = NULL;
+        }
+
+        // the intervals are found here too, off the gui thread, the
+        // W' intervals depend on CP and W' from the zones
+        if (ride && (!item.partial || (item.changed & RideMetric::PowerZone)) && !queue->isCancelled()) {
+            item.intervals = IntervalDetector::detect(ride);
+            item.intervalsRead = true;
+        }
+
+        // and where it went, when the samples changed
+        if (ride && !item.partial && !queue->isCancelled()) {
+            item.segments = Segments::find(ride, *segments, item.intervals);
+            item.segmentsRead = true;
+            item.heat = Heatmap::rasterize(ride);
+            item.heatRead = true;
+            item.profile = RideProfile::summarise(ride);
+            item.profileRead = true;
+        }
+
+        // hand over to the writer, it frees the ride
+        item.ride = ride;
+        queue->putDone(item);
+
+        item = MetricRefreshItem();
     }
-    file.close();
+}
+
+void
+MetricAggregator::importMeasure(SummaryMetrics *sm)
+{
+    dbaccess->importMeasure(sm);
+    weightsStale = true;
+}
+
+void
+MetricAggregator::importMeasures(QList<SummaryMetrics> &sms)
+{
+    dbaccess->importMeasures(sms);
+    weightsStale = true;
+}
+
+QDate
+MetricAggregator::lastMeasureWith(QString fieldName)
+{
+    return dbaccess->lastMeasureWith(fieldName);
+}
+
+/*----------------------------------------------------------------------
+ * Query functions are wrappers around DBAccess functions
+ *----------------------------------------------------------------------*/
+void
+MetricAggregator::writeAsCSV(QString filename)
+{
+    // write all metrics as a CSV file, a ride at a time
+    MetricsExporter exporter(context, MetricsExporter::allColumns(context, false), MetricsExporter::CSV);
+    exporter.write(filename);
 }
 
 QList<SummaryMetrics>
@@ -361,7 +928,9 @@ MetricAggregator::getAllMetricsFor(DateRange dr)
 QList<SummaryMetrics>
 MetricAggregator::getAllMetricsFor(QDateTime start, QDateTime end)
 {
-    if (context->athlete->isclean == false) refreshMetrics(); // get them up-to-date
+    // get them up-to-date, unless a background refresh is already underway
+    // in which case we return what it has committed so far
+    if (context->athlete->isclean == false && refresh == NULL) refreshMetrics();
 
     QList<SummaryMetrics> empty;
 
@@ -371,10 +940,169 @@ MetricAggregator::getAllMetricsFor(QDateTime start, QDateTime end)
         return empty;
     }
 
+    return season(start, end)->metrics;
+}
+
+//
+// The season cache, ranges are read whole and kept until a ride in
+// them is written or deleted. A background refresh signals as it
+// writes each ride so the partial seasons it leaves are dropped too
+//
+SeasonAggregate *
+MetricAggregator::season(QDateTime start, QDateTime end)
+{
+    for (int i=0; i<seasons.count(); i++) {
+        if (seasons[i]->start == start && seasons[i]->end == end) {
+            seasonStats.hit();
+            if (i) seasons.move(i, 0);
+            return seasons[0];
+        }
+    }
+    seasonStats.miss();
+
+    SeasonAggregate *add = new SeasonAggregate;
+    add->start = start;
+    add->end = end;
+
     // apparently using transactions for queries
     // can improve performance!
     dbaccess->connection().transaction();
-    QList<SummaryMetrics> results = dbaccess->getAllMetricsFor(start, end);
+    add->metrics = dbaccess->getAllMetricsFor(start, end);
+    dbaccess->connection().commit();
+
+    // near enough, every metric value and a few texts per ride
+    add->bytes = sizeof(SeasonAggregate) + add->metrics.count() * (256 + RideMetricFactory::instance().metricCount() * 9);
+
+    seasons.prepend(add);
+    trimSeasons();
+    return add;
+}
+
+void
+MetricAggregator::trimSeasons()
+{
+    qint64 bytes = 0;
+    foreach (SeasonAggregate *p, seasons) bytes += p->bytes;
+
+    // least recently used go first, the one just read is always kept
+    while (seasons.count() > 1 && bytes > seasonStats.budget()) {
+        bytes -= seasons.last()->bytes;
+        delete seasons.takeLast();
+    }
+    seasonStats.setUsage(this, bytes, seasons.count());
+}
+
+void
+MetricAggregator::seasonsChanged(QDate from)
+{
+    for (int i=0; i<seasons.count(); i++) {
+        if (seasons[i]->start.date() <= from && (!seasons[i]->end.isValid() || seasons[i]->end.date() >= from)) {
+            delete seasons.takeAt(i);
+            i--;
+        }
+    }
+    trimSeasons();
+}
+
+void
+MetricAggregator::clearSeasons()
+{
+    qDeleteAll(seasons);
+    seasons.clear();
+    seasonStats.forget(this);
+}
+
+QString
+MetricAggregator::getAggregatedFor(DateRange dr, QString symbol, bool useMetricUnits)
+{
+    if (context->athlete->isclean == false && refresh == NULL) refreshMetrics();
+    if (dbaccess == NULL) return "";
+
+    SeasonAggregate *aggregate = season(QDateTime(dr.from, QTime(0,0,0)), QDateTime(dr.to, QTime(23,59,59)));
+
+    QString key = symbol + (useMetricUnits ? "/metric" : "/imperial");
+    QHash<QString, QString>::const_iterator found = aggregate->aggregated.constFind(key);
+    if (found != aggregate->aggregated.constEnd()) return found.value();
+
+    QStringList empty; // filter list not used at present
+    QString value = SummaryMetrics::getAggregated(context, symbol, aggregate->metrics, empty, false, useMetricUnits);
+    aggregate->aggregated.insert(key, value);
+    return value;
+}
+
+void
+MetricAggregator::prefetch(DateRange dr, QStringList symbols)
+{
+    // the rides may need refreshing, which we leave to a real selection
+    if (context->athlete->isclean == false || refresh || dbaccess == NULL) return;
+
+    bool metricUnits = context->athlete->useMetricUnits;
+    foreach (QString symbol, symbols) getAggregatedFor(dr, symbol, metricUnits);
+}
+
+int
+MetricAggregator::visitMetricsFor(QDateTime start, QDateTime end, const QStringList *symbols, SummaryMetricsVisitor &visitor)
+{
+    if (context->athlete->isclean == false && refresh == NULL) refreshMetrics();
+
+    if (dbaccess == NULL) return 0;
+
+    dbaccess->connection().transaction();
+    int visited = dbaccess->visitMetricsFor(start, end, symbols, visitor);
+    dbaccess->connection().commit();
+    return visited;
+}
+
+QList<DailyMetric>
+MetricAggregator::getDailyFor(QDate start, QDate end, QString symbol)
+{
+    if (context->athlete->isclean == false && refresh == NULL) refreshMetrics();
+
+    if (dbaccess == NULL) return QList<DailyMetric>();
+
+    dbaccess->connection().transaction();
+    QList<DailyMetric> results = dbaccess->getDailyFor(start, end, symbol);
+    dbaccess->connection().commit();
+    return results;
+}
+
+int
+MetricAggregator::countMetricsFor(QDateTime start, QDateTime end)
+{
+    if (dbaccess == NULL) return 0;
+    return dbaccess->countMetricsFor(start, end);
+}
+
+QList<SummaryMetrics>
+MetricAggregator::getMetricsFor(QDateTime start, QDateTime end, QStringList symbols)
+{
+    if (context->athlete->isclean == false && refresh == NULL) refreshMetrics();
+
+    if (dbaccess == NULL) return QList<SummaryMetrics>();
+
+    // a cached season has every column, so it will do
+    foreach (SeasonAggregate *p, seasons) {
+        if (p->start == start && p->end == end) {
+            seasonStats.hit();
+            return p->metrics;
+        }
+    }
+
+    dbaccess->connection().transaction();
+    QList<SummaryMetrics> results = dbaccess->getMetricsFor(start, end, symbols);
+    dbaccess->connection().commit();
+    return results;
+}
+
+QList<SummaryMetrics>
+MetricAggregator::getAllMetricsChangedSince(unsigned long timestamp)
+{
+    if (context->athlete->isclean == false && refresh == NULL) refreshMetrics();
+
+    if (dbaccess == NULL) return QList<SummaryMetrics>();
+
+    dbaccess->connection().transaction();
+    QList<SummaryMetrics> results = dbaccess->getAllMetricsChangedSince(timestamp);
     dbaccess->connection().commit();
     return results;
 }
@@ -382,7 +1110,9 @@ MetricAggregator::getAllMetricsFor(QDateTime start, QDateTime end)
 SummaryMetrics
 MetricAggregator::getAllMetricsFor(QString filename)
 {
-    if (context->athlete->isclean == false) refreshMetrics(); // get them up-to-date
+    // get them up-to-date, unless a background refresh is already underway
+    // in which case we return what it has committed so far
+    if (context->athlete->isclean == false && refresh == NULL) refreshMetrics();
 
     SummaryMetrics results;
     QColor color; // ignored for now...
@@ -423,7 +1153,9 @@ MetricAggregator::getAllMeasuresFor(QDateTime start, QDateTime end)
 SummaryMetrics
 MetricAggregator::getRideMetrics(QString filename)
 {
-    if (context->athlete->isclean == false) refreshMetrics(); // get them up-to-date
+    // get them up-to-date, unless a background refresh is already underway
+    // in which case we return what it has committed so far
+    if (context->athlete->isclean == false && refresh == NULL) refreshMetrics();
 
     SummaryMetrics empty;
 
@@ -434,3 +1166,12 @@ MetricAggregator::getRideMetrics(QString filename)
     }
     return dbaccess->getRideMetrics(filename);
 }
+
+QList<DetectedInterval>
+MetricAggregator::getIntervals(QString filename)
+{
+    if (context->athlete->isclean == false && refresh == NULL) refreshMetrics();
+
+    if (dbaccess == NULL) return QList<DetectedInterval>();
+    return dbaccess->getIntervals(filename);
+}
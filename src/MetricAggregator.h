@@ -32,6 +32,42 @@
 #include "DBAccess.h"
 #include "Colors.h"
 
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+class QTimer;
+class Heatmap;
+struct MetricRefresh;
+
+// The athlete's weight measures in date order, so the weight on the
+// day of a ride is a binary search rather than a walk of every measure.
+// A value class so the refresh workers can each hold a copy.
+class WeightTimeline
+{
+    public:
+        WeightTimeline() {}
+        WeightTimeline(const QList<SummaryMetrics> &measures); // in date order
+
+        double at(QDate date) const; // latest on or before date, 0 if none
+
+    private:
+        QVector<QDate> dates;
+        QVector<double> weights;
+};
+
+// A season's rides as read from the database, and the values aggregated
+// from them for the summaries, kept so flicking between seasons and events
+// doesn't read and aggregate them again. An entry is dropped when a ride
+// in its range is written or deleted, see metricsChanged()
+struct SeasonAggregate
+{
+    QDateTime start, end;
+    QList<SummaryMetrics> metrics;
+    QHash<QString, QString> aggregated; // by symbol, metric or imperial
+    qint64 bytes;
+};
+
 class MetricAggregator : public QObject
 {
     Q_OBJECT
@@ -43,35 +79,196 @@ class MetricAggregator : public QObject
 		~MetricAggregator();
 
 
+        // refresh and wait for it to complete
         void refreshMetrics();
         void refreshMetrics(QDateTime forceAfterThisDate);
+
+        // refresh without blocking, see the refresh signals
+        void refreshMetricsInBackground(QDateTime forceAfterThisDate = QDateTime());
+        bool isRefreshing() const { return refresh != NULL; }
         void getFirstLast(QDate &, QDate &);
         DBAccess *db() { return dbaccess; }
+        Heatmap *heatmap() { return heatmap_; } // kept up to date with the rides
         SummaryMetrics getAllMetricsFor(QString filename); // for a single ride
         QList<SummaryMetrics> getAllMetricsFor(QDateTime start, QDateTime end);
         QList<SummaryMetrics> getAllMetricsFor(DateRange);
+        QList<SummaryMetrics> getMetricsFor(QDateTime start, QDateTime end, QStringList symbols); // just these
+        int visitMetricsFor(QDateTime start, QDateTime end, const QStringList *symbols, SummaryMetricsVisitor &visitor);
+        int countMetricsFor(QDateTime start, QDateTime end);
+        QList<DailyMetric> getDailyFor(QDate start, QDate end, QString symbol); // a row a day, unfiltered
+        QList<SummaryMetrics> getAllMetricsChangedSince(unsigned long timestamp);
         QList<SummaryMetrics> getAllMeasuresFor(QDateTime start, QDateTime end);
         QList<SummaryMetrics> getAllMeasuresFor(DateRange);
+
+        // SummaryMetrics::getAggregated() over all the rides in the range, cached
+        QString getAggregatedFor(DateRange, QString symbol, bool useMetricUnits);
+
+        // read the range into the season cache ahead of it being selected
+        void prefetch(DateRange, QStringList symbols);
+        QDate lastMeasureWith(QString fieldName); // for incremental downloads
         SummaryMetrics getRideMetrics(QString filename);
+        QList<DetectedInterval> getIntervals(QString filename); // found at import
         void writeAsCSV(QString filename); // export all...
         QStringList allActivityFilenames();
 
+        // compute all the metrics for a ride into summary, this does not touch
+        // the database and so is safe to call from the refresh worker threads.
+        // Just those in only if it is given, e.g. those depending on the zones
+        static bool computeRide(Context *context, const RideMetricConfig &config, RideFile *ride,
+                                QString fileName, SummaryMetrics &summary, const QStringList *only = NULL);
+
+        // checksum of what the metrics get from a ride other than its metadata,
+        // the samples and metric overrides. Stored with the metrics so a ride
+        // rewritten with the same fingerprint only had its metadata edited
+        static unsigned long samplesFingerPrint(RideFile *ride);
+
+        // checksum of the bytes in a ride file, the metrics and .cpx keep it
+        // so when the file is newer than they are, but only because it was
+        // copied from another machine, they can still be trusted. 0 if unreadable
+        static unsigned long contentFingerPrint(QString filename);
+
+        // weight measures by date, rebuilt after measures are imported
+        const WeightTimeline &weights();
+
+        // weight for a ride off the GUI thread, using the timeline it fetched
+        static double weightFor(RideFile *ride, const WeightTimeline &weights, double defaultWeight);
+
+        // and the weight for a day when the ride doesn't have its own
+        static double weightOn(QDate date, const WeightTimeline &weights, double defaultWeight);
+
     signals:
         void dataChanged(); // when metricDB table changed
+        void metricsChanged(QDate from); // rides from this date were written or deleted
+
+        // progress of a refresh
+        void refreshStarted(int total);
+        void refreshProgress(int processed, int total);
+        void refreshFinished();
 
     public slots:
         void update();
+        void cancelRefresh();
         void addRide(RideItem*);
         void importMeasure(SummaryMetrics *sm);
+        void importMeasures(QList<SummaryMetrics> &sms);
 
     private:
         Context *context;
         DBAccess *dbaccess;
+        Heatmap *heatmap_;
 
 	    typedef QHash<QString,RideMetric*> MetricMap;
-	    bool importRide(QDir path, RideFile *ride, QString fileName, unsigned long, bool modify);
+	    bool importRide(QDir path, RideFile *ride, QString fileName, bool modify);
+        void writeRide(SummaryMetrics &summary, RideFile *ride, const MetricFingerprints &, bool modify);
+        void writeChanged(SummaryMetrics &summary, RideFile *ride, const MetricFingerprints &, int changed); // samples unchanged
+        MetricFingerprints fingerprintsOn(const QDate &date); // the zones and weight that apply on date
 	    MetricMap metrics;
         ColorEngine *colorEngine;
+
+        WeightTimeline weights_;
+        bool weightsStale;
+
+        // a refresh in progress
+        MetricRefresh *refresh;
+        QTimer *refreshTimer;
+        bool startRefresh(QDateTime forceAfterThisDate);
+        bool writeRefreshed(unsigned long msecs);
+        void finishRefresh(bool cancelled);
+
+        // seasons most recently used first, see SeasonAggregate
+        QList<SeasonAggregate*> seasons;
+        SeasonAggregate *season(QDateTime start, QDateTime end);
+        void trimSeasons();
+
+    private slots:
+        void refreshBatch();
+        void seasonsChanged(QDate from);
+        void clearSeasons();
+};
+
+// Each ride file is passed through the refresh workers as one of these, on
+// the way in it says what the database knows, on the way out it holds the
+// opened ride and computed metrics if the ride needed to be refreshed
+struct MetricRefreshItem
+{
+    QString name;
+    unsigned long dbTimeStamp;
+    MetricFingerprints db;      // what the stored metrics were computed with
+    MetricFingerprints current; // the zones and weight for the day, the worker adds the ride's
+    bool stale;         // new or forced by date so refresh regardless
+    bool touched;       // newer file with the same content, set by the worker
+
+    int changed;        // RideMetric::dependency flags changed since, set by the worker
+    bool partial;       // samples unchanged, only the metrics depending on those are in summary
+
+    RideFile *ride;     // set by the worker when it was refreshed
+    SummaryMetrics summary;
+    bool intervalsRead; // found again, the samples or zones changed
+    QList<DetectedInterval> intervals;
+    bool bestsRead;     // the .cpx is new or the ride changed, so store these
+    QByteArray bests;
+    bool segmentsRead;  // the samples changed, see Segments::find
+    RideSegments segments;
+    bool heatRead;      // and the pixels its track covers, see Heatmap::rasterize
+    QVector<quint64> heat;
+    bool profileRead;   // and the navigator sparkline, see RideProfile
+    QByteArray profile;
+
+    MetricRefreshItem() : dbTimeStamp(0), stale(false), touched(false), changed(0), partial(false), ride(NULL),
+                          intervalsRead(false), bestsRead(false), segmentsRead(false), heatRead(false), profileRead(false) {}
+};
+
+// The queues shared between refreshMetrics() and its workers. Rides are
+// opened and computed in parallel, but the SQLite writes are all made
+// by the GUI thread so the single transaction is kept. The done queue is
+// bounded so we don't hold thousands of opened rides in memory whilst the
+// writer catches up.
+class MetricRefreshQueue
+{
+    public:
+        MetricRefreshQueue(QList<MetricRefreshItem> todo, int maxdone)
+        : todo(todo), maxdone(maxdone), cancelled(false) {}
+
+        bool takeJob(MetricRefreshItem &item);                  // false when no more work
+        void putDone(MetricRefreshItem &item);                  // blocks whilst done queue is full
+        bool takeDone(MetricRefreshItem &item, unsigned long);  // false on timeout
+        void cancel();
+        bool isCancelled();
+
+    private:
+        QMutex lock;
+        QWaitCondition notFull, notEmpty;
+        QList<MetricRefreshItem> todo, done;
+        int maxdone;
+        bool cancelled;
+};
+
+// the refresh worker ... runs in a thread
+class MetricRefreshWorker : public QThread
+{
+    public:
+        MetricRefreshWorker(Context *context, MetricRefreshQueue *queue, const RideMetricConfig &config,
+                            WeightTimeline weights, double defaultWeight, const QList<Segment> *segments)
+        : context(context), queue(queue), config(config), weights(weights), defaultWeight(defaultWeight),
+          segments(segments) {}
+        void run();
+
+    private:
+        Context *context;
+        MetricRefreshQueue *queue;
+
+        // the zones and settings as the refresh started, the athlete's
+        // may be edited while we are still working
+        RideMetricConfig config;
+
+        // RideFile::getWeight() queries the database which we cannot
+        // do from this thread, so the GUI thread fetches them for us
+        WeightTimeline weights;
+        double defaultWeight;
+        double weightFor(RideFile *ride);
+
+        // the segments as the refresh started, for matching the rides
+        const QList<Segment> *segments;
 };
 
 #endif /* METRICAGGREGATOR_H_ */
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MetricsExport.h"
+#include "Athlete.h"
+#include "MetricAggregator.h"
+#include "RideMetric.h"
+#include "RideMetadata.h"
+#include "SpecialFields.h"
+
+MetricsExporter::MetricsExporter(Context *context, QStringList columns, Format format) :
+    context(context), columns(columns), format(format), done(0), total(0), cancelled(false)
+{
+}
+
+QStringList
+MetricsExporter::allColumns(Context *context, bool text)
+{
+    QStringList returning;
+
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    for (int i=0; i<factory.metricCount(); i++) returning << factory.metricName(i);
+
+    foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
+        if (context->specialFields.isMetric(field.name)) continue;
+        if (field.type == 3 || field.type == 4 || (text && (field.type < 3 || field.type == 7)))
+            returning << field.name;
+    }
+    returning.sort();
+    return returning;
+}
+
+bool
+MetricsExporter::write(QString filename, QDateTime start, QDateTime end)
+{
+    QFile file(filename);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) return false;
+    out.setDevice(&file);
+
+    // the database names metadata with underscores
+    QStringList symbols;
+    foreach(QString column, columns) symbols << QString(column).replace(" ", "_");
+
+    if (format == CSV) {
+        out<<"date, time, filename,";
+        foreach(QString column, columns) out<<column<<",";
+        out<<"\n";
+    }
+
+    done = 0;
+    total = context->athlete->metricDB->countMetricsFor(start, end);
+    cancelled = false;
+    emit progress(done, total);
+
+    context->athlete->metricDB->visitMetricsFor(start, end, &symbols, *this);
+
+    emit progress(done, total);
+    out.flush();
+    out.setDevice(NULL);
+    file.close();
+
+    return !cancelled && file.error() == QFile::NoError;
+}
+
+// csv fields are quoted when they need to be
+static QString
+csvText(QString text)
+{
+    if (!text.contains(',') && !text.contains('"') && !text.contains('\n')) return text;
+    return "\"" + text.replace("\"", "\"\"") + "\"";
+}
+
+static QString
+jsonText(QString text)
+{
+    text.replace("\\", "\\\\").replace("\"", "\\\"").replace("\n", "\\n").replace("\r", "\\r").replace("\t", "\\t");
+    return "\"" + text + "\"";
+}
+
+bool
+MetricsExporter::visit(const SummaryMetrics &x)
+{
+    QMap<QString, double> values = x.values();
+
+    if (format == CSV) {
+        out<<x.getRideDate().date().toString("MM/dd/yy")<<","
+           <<x.getRideDate().time().toString()<<","
+           <<csvText(x.getFileName())<<",";
+
+        foreach(QString column, columns) {
+            if (values.contains(column)) out<<values.value(column)<<",";
+            else out<<csvText(x.getText(column, ""))<<",";
+        }
+        out<<"\n";
+
+    } else {
+        out<<"{\"date\":\""<<x.getRideDate().date().toString(Qt::ISODate)<<"\""
+           <<",\"time\":\""<<x.getRideDate().time().toString()<<"\""
+           <<",\"filename\":"<<jsonText(x.getFileName());
+
+        foreach(QString column, columns) {
+            out<<","<<jsonText(column)<<":";
+            if (values.contains(column)) out<<values.value(column);
+            else out<<jsonText(x.getText(column, ""));
+        }
+        out<<"}\n";
+    }
+
+    // let the dialog keep up, and cancel
+    if (++done % 100 == 0) emit progress(done, total);
+    return !cancelled;
+}
+
+MetricsExportDialog::MetricsExportDialog(Context *context) : QDialog(context->mainWindow), context(context), exporter(NULL)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(tr("Export Metrics"));
+    setMinimumWidth(400);
+    setMinimumHeight(450);
+
+    QVBoxLayout *layout = new QVBoxLayout;
+    setLayout(layout);
+
+    columns = new QListWidget(this);
+    foreach(QString column, MetricsExporter::allColumns(context, true)) {
+        QListWidgetItem *add = new QListWidgetItem(column, columns);
+        add->setFlags(add->flags() | Qt::ItemIsUserCheckable);
+        add->setCheckState(Qt::Checked);
+    }
+
+    all = new QCheckBox(tr("check/uncheck all"), this);
+    all->setChecked(true);
+
+    QHBoxLayout *formatLayout = new QHBoxLayout;
+    format = new QComboBox(this);
+    format->addItem(tr("Comma Separated Variables (*.csv)"));
+    format->addItem(tr("JSON, an object per line (*.json)"));
+    formatLayout->addWidget(new QLabel(tr("Export as"), this));
+    formatLayout->addWidget(format);
+    formatLayout->addStretch();
+
+    progressBar = new QProgressBar(this);
+    progressBar->hide();
+
+    QHBoxLayout *buttons = new QHBoxLayout;
+    cancel = new QPushButton(tr("Cancel"), this);
+    ok = new QPushButton(tr("Export"), this);
+    buttons->addStretch();
+    buttons->addWidget(cancel);
+    buttons->addWidget(ok);
+
+    layout->addWidget(columns);
+    layout->addWidget(all);
+    layout->addLayout(formatLayout);
+    layout->addWidget(progressBar);
+    layout->addLayout(buttons);
+
+    connect(all, SIGNAL(stateChanged(int)), this, SLOT(allClicked()));
+    connect(ok, SIGNAL(clicked()), this, SLOT(okClicked()));
+    connect(cancel, SIGNAL(clicked()), this, SLOT(reject()));
+}
+
+void
+MetricsExportDialog::allClicked()
+{
+    Qt::CheckState state = all->isChecked() ? Qt::Checked : Qt::Unchecked;
+    for (int i=0; i<columns->count(); i++) columns->item(i)->setCheckState(state);
+}
+
+void
+MetricsExportDialog::okClicked()
+{
+    bool csv = format->currentIndex() == 0;
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export Metrics"), QDir::homePath(),
+                                                    csv ? tr("Comma Separated Variables (*.csv)") : tr("JSON (*.json)"));
+    if (fileName.isEmpty()) return;
+
+    QStringList chosen;
+    for (int i=0; i<columns->count(); i++)
+        if (columns->item(i)->checkState() == Qt::Checked) chosen << columns->item(i)->text();
+
+    // cancel stops the export rather than closing whilst it runs
+    ok->setEnabled(false);
+    progressBar->show();
+    exporter = new MetricsExporter(context, chosen, csv ? MetricsExporter::CSV : MetricsExporter::JSONLines);
+    connect(exporter, SIGNAL(progress(int,int)), this, SLOT(progress(int,int)));
+    disconnect(cancel, SIGNAL(clicked()), this, SLOT(reject()));
+    connect(cancel, SIGNAL(clicked()), exporter, SLOT(cancel()));
+
+    bool written = exporter->write(fileName);
+    bool cancelled = exporter->isCancelled();
+
+    delete exporter;
+    exporter = NULL;
+
+    if (!written && !cancelled)
+        QMessageBox::warning(this, tr("Export Metrics"), tr("Could not write %1").arg(fileName));
+    if (!written) QFile::remove(fileName);
+    accept();
+}
+
+void
+MetricsExportDialog::progress(int done, int total)
+{
+    progressBar->setMaximum(qMax(1, total));
+    progressBar->setValue(done);
+    QApplication::processEvents(); // for cancel
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_MetricsExport_h
+#define _GC_MetricsExport_h 1
+#include "GoldenCheetah.h"
+#include "Context.h"
+#include "DBAccess.h"
+
+#include <QtGui>
+#include <QFile>
+#include <QTextStream>
+
+// Writes the metrics database out a ride at a time as it is read, so the
+// size of the archive doesn't matter. Columns are metric symbols or metadata
+// field names, in the order given. As csv, in the layout writeAsCSV has
+// always used, or as JSON lines (an object per ride) for loading elsewhere.
+class MetricsExporter : public QObject, public SummaryMetricsVisitor
+{
+    Q_OBJECT
+
+    public:
+        enum format { CSV, JSONLines };
+        typedef enum format Format;
+
+        MetricsExporter(Context *context, QStringList columns, Format format);
+
+        // all the metrics and numeric metadata, sorted, and with text metadata if asked
+        static QStringList allColumns(Context *context, bool text);
+
+        // null dates export everything, false if it couldn't be written or was cancelled
+        bool write(QString filename, QDateTime start = QDateTime(), QDateTime end = QDateTime());
+        bool visit(const SummaryMetrics &);
+
+        bool isCancelled() const { return cancelled; }
+
+    public slots:
+        void cancel() { cancelled = true; }
+
+    signals:
+        void progress(int done, int total);
+
+    private:
+        Context *context;
+        QStringList columns;
+        Format format;
+
+        QTextStream out;
+        int done, total;
+        bool cancelled;
+};
+
+// Choose the columns and format for MainWindow's Export Metrics
+class MetricsExportDialog : public QDialog
+{
+    Q_OBJECT
+    G_OBJECT
+
+    public:
+        MetricsExportDialog(Context *context);
+
+    private slots:
+        void allClicked();
+        void okClicked();
+        void progress(int done, int total);
+
+    private:
+        Context *context;
+        MetricsExporter *exporter;
+
+        QListWidget *columns;
+        QCheckBox *all;
+        QComboBox *format;
+        QProgressBar *progressBar;
+        QPushButton *cancel, *ok;
+};
+#endif // _GC_MetricsExport_h
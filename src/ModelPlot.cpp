@@ -50,8 +50,43 @@ using namespace Qwt3D; // namespace ref is only visible in this file (is not in
  *
  *----------------------------------------------------------------------*/
 
-// util function to create an x/y key for QHash, effective and quick enough
-static QString xystring(double x, double y) { return QString("%1:%2").arg((int)x).arg((int)y); }
+// util function to create an x/y key for QHash, packs the two bins into one integer
+static qint64 xykey(double x, double y) { return qint64((quint64(quint32((int)x)) << 32) | quint32((int)y)); }
+
+#define MODEL_SERIES (MODEL_AEPF+1)
+
+// a single x/y bin holding the sample count and the sum of every series
+struct ModelBin
+{
+    int x, y;
+    int count;
+    double sum[MODEL_SERIES];
+};
+
+// The ride binned on x and y with every series accumulated, it is kept
+// by the plot and reused while the ride, axes and bin sizes are unchanged
+// so selecting a different z or color just re-reads the bins. Since they
+// are counts and sums the bins for several rides can simply be added
+class ModelBins
+{
+    public:
+        ModelBins() : ride(NULL), points(0) {}
+
+        bool matches(const RideFile *r, ModelSettings *s, bool metric, double crank) const {
+            return ride == r && points == r->dataPoints().count() &&
+                   x == s->x && y == s->y && xbin == s->xbin && ybin == s->ybin &&
+                   ignore == s->ignore && useMetricUnits == metric && cranklength == crank;
+        }
+
+        const RideFile *ride;
+        int points;
+        int x, y, xbin, ybin;
+        bool ignore, useMetricUnits;
+        double cranklength;
+
+        QHash<qint64, ModelBin> bins;
+        double lo[MODEL_SERIES], hi[MODEL_SERIES]; // sample range for the color legend
+};
 
 // returns the color for an xyz point
 class ModelDataColor : public Color
@@ -66,7 +101,7 @@ class ModelDataColor : public Color
 #endif
         {
             QColor cHSV, cRGB;
-            double val = color.value(xystring(x,y), 0.0);
+            double val = color.value(xykey(x,y), 0.0);
             RGBA colour;
             if (!val) {
                 return RGBA(255,255,255,0); // see thru
@@ -129,8 +164,8 @@ class ModelDataColor : public Color
         }
 
         public:
-            QHash<QString, double> color;
-            QHash<QString, int> num;      // xy map with count of values for averaging
+            QHash<qint64, double> color;
+            QHash<qint64, int> num;      // xy map with count of values for averaging
             double min, max;
 
             bool iszones; // if the color value is a zone number
@@ -152,11 +187,11 @@ class ModelDataProvider : public Function
         double operator () (double x, double y)
         {
             // return the z value for x and y
-            return mz.value(xystring(x,y), 0.0);
+            return mz.value(xykey(x,y), 0.0);
         }
         double intervals (double x, double y) // return value for selected intervals
         {
-            return plot.iz.value(xystring(x,y), 0.0)-minz;
+            return plot.iz.value(xykey(x,y), 0.0)-minz;
         }
         double getMinz() { return minz; }
         double getMaxz() { return maxz; }
@@ -169,12 +204,13 @@ class ModelDataProvider : public Function
             plot.inum.clear();
         }
 
-        QHash<QString, double> mz;        // xy map with max z values;
-        QHash<QString, int> mnum;      // xy map with count of values for averaging
+        QHash<qint64, double> mz;        // xy map with max z values;
+        QHash<qint64, int> mnum;      // xy map with count of values for averaging
 
     private:
 
         double pointType(const RideFilePoint *, int);
+        void binRide(ModelSettings *);
         QString describeType(int, bool);
         double maxz, minz;
         double cranklength; // used for CPV/AEPF calculation
@@ -241,6 +277,79 @@ ModelDataProvider::pointType(const RideFilePoint *point, int type)
     return 0; // ? unknown channel ?
 }
 
+//
+// Bin every sample in the ride by x and y accumulating all the series
+// at once, this is the only pass over the ride samples for a plot
+// without intervals and is skipped when the cached bins still apply
+//
+void
+ModelDataProvider::binRide(ModelSettings *settings)
+{
+    const RideFile *ride = settings->ride->ride();
+    ModelBins *bins = plot.bins;
+
+    if (bins->matches(ride, settings, useMetricUnits, cranklength)) return;
+
+    bins->ride = ride;
+    bins->points = ride->dataPoints().count();
+    bins->x = settings->x;
+    bins->y = settings->y;
+    bins->xbin = settings->xbin;
+    bins->ybin = settings->ybin;
+    bins->ignore = settings->ignore;
+    bins->useMetricUnits = useMetricUnits;
+    bins->cranklength = cranklength;
+    bins->bins.clear();
+
+    // edits to the ride invalidate the bins
+    QObject::connect(ride, SIGNAL(modified()), &plot, SLOT(resetBins()), Qt::UniqueConnection);
+
+    for (int i=0; i<MODEL_SERIES; i++) {
+        bins->lo[i] = 180000;
+        bins->hi[i] = -180000;
+    }
+    bins->lo[MODEL_NONE] = bins->hi[MODEL_NONE] = 0;
+
+    double value[MODEL_SERIES];
+    value[MODEL_NONE] = 0;
+
+    foreach(const RideFilePoint *point, ride->dataPoints()) {
+
+        // get x and z bin values - round to nearest bin
+        double dx  = pointType(point, settings->x);
+        int binx = settings->xbin * floor(dx / settings->xbin);
+
+        double dy = pointType(point, settings->y);
+        int biny = settings->ybin * floor(dy / settings->ybin);
+
+        // ignore zero points
+        if (settings->ignore && (dx==0 || dy==0)) continue;
+
+        // even further ignore 0 for lat/lon
+        if ((settings->y == MODEL_LAT || settings->y == MODEL_LONG) && dy == 0) continue;
+        if ((settings->x == MODEL_LAT || settings->x == MODEL_LONG) && dx == 0) continue;
+
+        for (int i=MODEL_NONE+1; i<MODEL_SERIES; i++) {
+            value[i] = pointType(point, i);
+            if (value[i] > bins->hi[i]) bins->hi[i] = value[i];
+            if (value[i] < bins->lo[i]) bins->lo[i] = value[i];
+        }
+
+        QHash<qint64, ModelBin>::iterator it = bins->bins.find(xykey(binx, biny));
+        if (it == bins->bins.end()) {
+            ModelBin bin;
+            bin.x = binx;
+            bin.y = biny;
+            bin.count = 0;
+            for (int i=0; i<MODEL_SERIES; i++) bin.sum[i] = 0;
+            it = bins->bins.insert(xykey(binx, biny), bin);
+        }
+
+        it.value().count++;
+        for (int i=MODEL_NONE+1; i<MODEL_SERIES; i++) it.value().sum[i] += value[i];
+    }
+}
+
 QString
 ModelDataProvider::describeType(int type, bool longer)
 {
@@ -317,7 +426,7 @@ ModelDataProvider::describeType(int type, bool longer)
 ModelDataProvider::ModelDataProvider (BasicModelPlot &plot, ModelSettings *settings) : Function(plot), plot(plot)
 {
     // get application settings
-    cranklength = appsettings->value(NULL, GC_CRANKLENGTH, 0.0).toDouble() / 1000.0;
+    cranklength = SettingsSnapshot::current().crankLength / 1000.0;
     useMetricUnits = plot.context->athlete->useMetricUnits;
 
     // if there are no settings or incomplete settings
@@ -336,8 +445,9 @@ ModelDataProvider::ModelDataProvider (BasicModelPlot &plot, ModelSettings *setti
     // if its not setup or no settings exist default to 175mm cranks
     if (cranklength == 0.0) cranklength = 0.175;
 
-    // Run through the ridefile points putting the selected
-    // values into the approprate bins
+    // Bin the ride, unless the last one binned is still current
+    binRide(settings);
+
     settings->colorProvider->color.clear();
     settings->colorProvider->num.clear();
     settings->colorProvider->zonecolor.clear();
@@ -346,125 +456,111 @@ ModelDataProvider::ModelDataProvider (BasicModelPlot &plot, ModelSettings *setti
 
     double maxbinx =-180000, maxbiny =-180000; // was 65535
     double minbinx =180000, minbiny =180000; // 180000 is the max value (for longitude)
-    double mincol =180000, maxcol =-180000;
+    double mincol = plot.bins->lo[settings->color == MODEL_XYTIME ? MODEL_NONE : settings->color];
+    double maxcol = plot.bins->hi[settings->color == MODEL_XYTIME ? MODEL_NONE : settings->color];
+    double recIntSecs = settings->ride->ride()->recIntSecs();
 
     //
-    // Create Plot dataset, filter on values and calculate averages etc
+    // Create Plot dataset from the bins, averaging or time at
     //
-    foreach(const RideFilePoint *point, settings->ride->ride()->dataPoints()) {
+    if (settings->intervals.count() == 0) plot.intervals_ = 0;
+    else {
+        plot.intervals_ = SHOW_INTERVALS;
+        if (settings->frame == true) plot.intervals_ |= SHOW_FRAME;
+    }
 
-        // get x and z bin values - round to nearest bin
-        double dx  = pointType(point, settings->x);
-        int binx = settings->xbin * floor(dx / settings->xbin);
+    QHashIterator<qint64, ModelBin> bi(plot.bins->bins);
+    while (bi.hasNext()) {
+        bi.next();
+        const ModelBin &bin = bi.value();
 
-        double dy = pointType(point, settings->y);
-        int biny = settings->ybin * floor(dy / settings->ybin);
+        if (bin.x > maxbinx) maxbinx = bin.x;
+        if (bin.x < minbinx) minbinx = bin.x;
+        if (bin.y > maxbiny) maxbiny = bin.y;
+        if (bin.y < minbiny) minbiny = bin.y;
 
-        // ignore zero points
-        if (settings->ignore && (dx==0 || dy==0)) continue;
+        // ZED
+        double zed;
+        if (settings->z == MODEL_XYTIME) zed = bin.count * recIntSecs; // time at
+        else zed = bin.sum[settings->z] / bin.count; // average
 
-        // even further ignore 0 for lat/lon
-        if ((settings->y == MODEL_LAT || settings->y == MODEL_LONG) && dy == 0) continue;
-        if ((settings->x == MODEL_LAT || settings->x == MODEL_LONG) && dx == 0) continue;
+        mz.insert(bi.key(), zed);
+        mnum.insert(bi.key(), bin.count);
 
-        // get z value
-        double zed=0;
-        if (settings->z == MODEL_XYTIME) zed = settings->ride->ride()->recIntSecs(); // time at
-        else zed = pointType(point, settings->z); // raw data
-
-        // get color value
-        double color=0;
-        if (settings->color == MODEL_XYTIME) color = settings->ride->ride()->recIntSecs(); // time at
-        else color = pointType(point, settings->color); // raw data
-
-        // min max
-        if (color > maxcol) maxcol = color;
-        if (color < mincol) mincol = color;
-        if (binx > maxbinx) maxbinx = binx;
-        if (binx < minbinx) minbinx = binx;
-        if (biny > maxbiny) maxbiny = biny;
-        if (biny < minbiny) minbiny = biny;
-
-        // How many & Curent Value
-        // ZED
-        QString lookup = xystring(binx,biny);
-        int count = mnum.value(lookup, 0.0);
-        double currentz = mz.value(lookup, 0.0);
+        // NO INTERVALS COLOR IS FOR ALL SAMPLES
+        if (settings->intervals.count() == 0) {
+            double color;
+            if (settings->color == MODEL_XYTIME) color = bin.count * recIntSecs; // time at
+            else color = bin.sum[settings->color] / bin.count; // average
 
-        if (settings->z == MODEL_XYTIME) {
-            count++;
-            zed += currentz;
-        } else {
-           if (count) zed = ((currentz*count)+zed)/(count+1); // average
+            settings->colorProvider->color.insert(bi.key(), color);
+            settings->colorProvider->num.insert(bi.key(), bin.count);
         }
+    }
 
-        // always update the max values
-        mz.insert(lookup, zed);
-        mnum.insert(lookup, count);
+    // WE HAVE INTERVALS! COLOR AND INTERVAL Z VALUES NEED TO BE TREATED
+    // DIFFERENTLY NOW - COLOR IS FOR SELECTED INTERVALS AND WE MAINTAIN
+    // A SECOND SET OF Z VALUES SO WE HAVE MAX + INTERVALS
+    if (settings->intervals.count() > 0) {
 
-        // NO INTERVALS COLOR IS FOR ALL SAMPLES
-        if (settings->intervals.count() == 0 ) {
-            plot.intervals_ = 0;
+        foreach(const RideFilePoint *point, settings->ride->ride()->dataPoints()) {
+
+            // filter for interval
+            int i;
+            for(i=0; i<settings->intervals.count(); i++) {
+                IntervalItem *curr = settings->intervals.at(i);
+                if ((point->secs + recIntSecs) > curr->start && point->secs < curr->stop) break;
+            }
+            if (i == settings->intervals.count()) continue;
+
+            // get x and z bin values - round to nearest bin
+            double dx  = pointType(point, settings->x);
+            int binx = settings->xbin * floor(dx / settings->xbin);
+
+            double dy = pointType(point, settings->y);
+            int biny = settings->ybin * floor(dy / settings->ybin);
 
-            int colcount = settings->colorProvider->num.value(lookup, 0.0);
-            double currentcol = settings->colorProvider->color.value(lookup,0.0);
+            // ignore zero points
+            if (settings->ignore && (dx==0 || dy==0)) continue;
+
+            // even further ignore 0 for lat/lon
+            if ((settings->y == MODEL_LAT || settings->y == MODEL_LONG) && dy == 0) continue;
+            if ((settings->x == MODEL_LAT || settings->x == MODEL_LONG) && dx == 0) continue;
+
+            qint64 lookup = xykey(binx, biny);
+
+            // update colors
+            double color=0;
+            if (settings->color == MODEL_XYTIME) color = recIntSecs; // time at
+            else color = pointType(point, settings->color); // raw data
+
+            int colcount = settings->colorProvider->num.value(lookup, 0);
+            double currentcol = settings->colorProvider->color.value(lookup, 0.0);
 
             if (settings->color == MODEL_XYTIME) { // color in time
-                colcount++;
                 color += currentcol;
             } else { // color in average of
-                if (colcount) color = ((currentcol*colcount)+color)/(colcount+1); // average
+                color = ((currentcol*colcount)+color)/(colcount+1); // average
             }
             settings->colorProvider->color.insert(lookup, color);
-            settings->colorProvider->num.insert(lookup, colcount);
-        }
+            settings->colorProvider->num.insert(lookup, colcount+1);
 
-        // WE HAVE INTERVALS! COLOR AND INTERVAL Z VALUES NEED TO BE TREATED
-        // DIFFERENTLY NOW - COLOR IS FOR SELECTED INTERVALS AND WE MAINTAIN
-        // A SECOND SET OF Z VALUES SO WE HAVE MAX + INTERVALS
-        if (settings->intervals.count() > 0) {
-            plot.intervals_ = SHOW_INTERVALS;
-            if (settings->frame == true) plot.intervals_ |= SHOW_FRAME;
+            // update interval values
+            double ized=0;
+            if (settings->z == MODEL_XYTIME) ized = recIntSecs; // time at
+            else ized = pointType(point, settings->z); // raw data
 
-            QString lookup = xystring(binx, biny);
+            int count = plot.inum.value(lookup, 0);
+            double currentz = plot.iz.value(lookup, 0.0);
 
-            // filter for interval
-            for(int i=0; i<settings->intervals.count(); i++) {
-                IntervalItem *curr = settings->intervals.at(i);
-                if ((point->secs + settings->ride->ride()->recIntSecs()) > curr->start
-                    && point->secs < curr->stop) {
-                    // update colors
-                    int colcount = settings->colorProvider->num.value(lookup,0.0);
-                    double currentcol = settings->colorProvider->color.value(lookup, 0.0);
-
-                    if (settings->color == MODEL_XYTIME) { // color in time
-                        colcount++;
-                        color += currentcol;
-                    } else { // color in average of
-                        if (colcount) color = ((currentcol*colcount)+color)/(colcount+1); // average
-                    }
-                    settings->colorProvider->color.insert(lookup, color);
-                    settings->colorProvider->num.insert(lookup, colcount);
-
-                    double ized=0;
-                    if (settings->z == MODEL_XYTIME) ized = settings->ride->ride()->recIntSecs(); // time at
-                    else ized = pointType(point, settings->z); // raw data
-                    // update interval values
-                    int count = plot.inum.value(lookup, 0.0);
-                    double currentz = plot.iz.value(lookup, 0.0);
-
-                    if (settings->z == MODEL_XYTIME) {
-                        count++;
-                        ized += currentz;
-                    } else {
-                       if (count) ized = ((currentz*count)+ized)/(count+1); // average
-                    }
-
-                    plot.iz.insert(lookup, ized);
-                    plot.inum.insert(lookup, count);
-                    break;
-                }
+            if (settings->z == MODEL_XYTIME) {
+                ized += currentz;
+            } else {
+                ized = ((currentz*count)+ized)/(count+1); // average
             }
+
+            plot.iz.insert(lookup, ized);
+            plot.inum.insert(lookup, count+1);
         }
     }
 
@@ -502,10 +598,10 @@ ModelDataProvider::ModelDataProvider (BasicModelPlot &plot, ModelSettings *setti
         }
 
         // iterate over the existing power values converting to a power zone
-        QHashIterator<QString, double> coli(settings->colorProvider->color);
+        QHashIterator<qint64, double> coli(settings->colorProvider->color);
         while (coli.hasNext()) {
             coli.next();
-            QString lookup = coli.key();
+            qint64 lookup = coli.key();
             double color = coli.value();
             // turn into power zone
             color = zones->whichZone(zone_range, color);
@@ -534,7 +630,7 @@ ModelDataProvider::ModelDataProvider (BasicModelPlot &plot, ModelSettings *setti
     // Multis...
     if (settings->z == MODEL_XYTIME) {
         // time on Z axis
-        QHashIterator<QString, double> zi(mz);
+        QHashIterator<qint64, double> zi(mz);
         while (duration && settings->z == MODEL_XYTIME && zi.hasNext()) {
             zi.next();
             double timePercent = (zi.value()/duration) * 100;
@@ -544,7 +640,7 @@ ModelDataProvider::ModelDataProvider (BasicModelPlot &plot, ModelSettings *setti
     // Intervals
     if (settings->z == MODEL_XYTIME) {
         // time on Z axis
-        QHashIterator<QString, double> ii(plot.iz);
+        QHashIterator<qint64, double> ii(plot.iz);
         while (duration && settings->z == MODEL_XYTIME && ii.hasNext()) {
             ii.next();
             double timePercent = (ii.value()/duration) * 100;
@@ -555,7 +651,7 @@ ModelDataProvider::ModelDataProvider (BasicModelPlot &plot, ModelSettings *setti
         // time on Color
     if (settings->color == MODEL_XYTIME) {
         mincol=65535; maxcol=0;
-        QHashIterator<QString, double> ci(settings->colorProvider->color);
+        QHashIterator<qint64, double> ci(settings->colorProvider->color);
         while (duration && settings->color == MODEL_XYTIME && ci.hasNext()) {
             ci.next();
             double timePercent = (ci.value()/duration) * 100;
@@ -569,7 +665,7 @@ ModelDataProvider::ModelDataProvider (BasicModelPlot &plot, ModelSettings *setti
     // We DO NOT do the same for color since they represent
     // the entire data set and not just the intervals selected (if any)
     bool first = true;
-    QHashIterator <QString, double> iz(mz);
+    QHashIterator <qint64, double> iz(mz);
     while (iz.hasNext()) {
         double z;
         iz.next();
@@ -808,6 +904,7 @@ BasicModelPlot::BasicModelPlot(Context *context, ModelSettings *settings) : cont
     if (settings) settings->colorProvider = modelDataColor;
 
     // the data provider returns a z for an x,y
+    bins = new ModelBins;
     modelDataProvider = new ModelDataProvider(*this, settings);
 
 
@@ -918,6 +1015,12 @@ BasicModelPlot::setStyle(int index)
     updateGL();
 }
 
+void
+BasicModelPlot::resetBins()
+{
+    bins->ride = NULL;
+}
+
 void
 BasicModelPlot::setData(ModelSettings *settings)
 {
@@ -1421,7 +1524,7 @@ void Bar::draw(Qwt3D::Triple const& pos)
     // get pos for the interval data
     // call the current data provider
     // which is a global
-    double z =  model->iz.value(xystring(pos.x,pos.y));
+    double z =  model->iz.value(xykey(pos.x,pos.y));
     if (z == 0) return;
 
     // do the max bars
@@ -62,6 +62,7 @@ using namespace Qwt3D;
 class ModelDataProvider;
 class ModelDataColor;
 class ModelSettings;
+class ModelBins;
 class Bar;
 class Water;
 
@@ -104,11 +105,13 @@ class BasicModelPlot : public SurfacePlot
         double diag_;
         int   intervals_;                // SHOW_INTERVALS | SHOW_MAX
         double zpane;
-        QHash<QString, double> iz;         // for selected intervals
-        QHash<QString, double> inum;      // for selected intervals
+        QHash<qint64, double> iz;         // for selected intervals
+        QHash<qint64, double> inum;      // for selected intervals
+        ModelBins *bins;                  // cached bins for the current ride
 
     public slots:
         void configChanged();
+        void resetBins();
 
     protected:
 
@@ -857,6 +857,32 @@ DevicePage::DevicePage(QWidget *parent, Context *context) : QWidget(parent), con
     multiCheck = new QCheckBox("Allow multiple devices in Train View", this);
     multiCheck->setChecked(appsettings->value(this, TRAIN_MULTI, false).toBool());
 
+    // how the load is driven when following a workout
+    loadRate = new QSpinBox(this);
+    loadRate->setRange(1, 50); // LOADMINRATE in TrainSidebar.h
+    loadRate->setSuffix(tr(" per second"));
+    loadRate->setValue(appsettings->value(this, TRAIN_LOADRATE, 4).toInt());
+    loadLead = new QSpinBox(this);
+    loadLead->setRange(0, 5000);
+    loadLead->setSingleStep(100);
+    loadLead->setSuffix(tr(" ms"));
+    loadLead->setValue(appsettings->value(this, TRAIN_LOADLEAD, 0).toInt());
+    loadLead->setToolTip(tr("Send the workout load this far ahead to allow for the trainer taking time to respond"));
+
+    // telemetry for other screens, see TelemetryPublisher.h
+    publishCheck = new QCheckBox(tr("Publish telemetry to"), this);
+    publishCheck->setChecked(appsettings->value(this, TRAIN_PUBLISH, false).toBool());
+    publishAddress = new QLineEdit(appsettings->value(this, TRAIN_PUBLISH_ADDRESS, "239.255.67.67").toString(), this);
+    publishAddress->setToolTip(tr("A multicast group, or the address of one machine"));
+    publishPort = new QSpinBox(this);
+    publishPort->setRange(1, 65535);
+    publishPort->setValue(appsettings->value(this, TRAIN_PUBLISH_PORT, 5467).toInt());
+    publishMsecs = new QSpinBox(this);
+    publishMsecs->setRange(50, 10000);
+    publishMsecs->setSingleStep(50);
+    publishMsecs->setSuffix(tr(" ms"));
+    publishMsecs->setValue(appsettings->value(this, TRAIN_PUBLISH_MSECS, 1000).toInt());
+
     mainLayout->addWidget(deviceList);
     QHBoxLayout *bottom = new QHBoxLayout;
     bottom->setSpacing(2);
@@ -866,6 +892,26 @@ DevicePage::DevicePage(QWidget *parent, Context *context) : QWidget(parent), con
     bottom->addWidget(delButton);
     mainLayout->addLayout(bottom);
 
+    QHBoxLayout *loads = new QHBoxLayout;
+    loads->addWidget(new QLabel(tr("Workout load updates"), this));
+    loads->addWidget(loadRate);
+    loads->addSpacing(10);
+    loads->addWidget(new QLabel(tr("Lead"), this));
+    loads->addWidget(loadLead);
+    loads->addStretch();
+    mainLayout->addLayout(loads);
+
+    QHBoxLayout *publish = new QHBoxLayout;
+    publish->addWidget(publishCheck);
+    publish->addWidget(publishAddress);
+    publish->addWidget(new QLabel(tr("Port"), this));
+    publish->addWidget(publishPort);
+    publish->addSpacing(10);
+    publish->addWidget(new QLabel(tr("Every"), this));
+    publish->addWidget(publishMsecs);
+    publish->addStretch();
+    mainLayout->addLayout(publish);
+
     connect(addButton, SIGNAL(clicked()), this, SLOT(devaddClicked()));
     connect(delButton, SIGNAL(clicked()), this, SLOT(devdelClicked()));
 }
@@ -877,6 +923,12 @@ DevicePage::saveClicked()
     DeviceConfigurations all;
     all.writeConfig(deviceListModel->Configuration);
     appsettings->setValue(TRAIN_MULTI, multiCheck->isChecked());
+    appsettings->setValue(TRAIN_LOADRATE, loadRate->value());
+    appsettings->setValue(TRAIN_LOADLEAD, loadLead->value());
+    appsettings->setValue(TRAIN_PUBLISH, publishCheck->isChecked());
+    appsettings->setValue(TRAIN_PUBLISH_ADDRESS, publishAddress->text().trimmed());
+    appsettings->setValue(TRAIN_PUBLISH_PORT, publishPort->value());
+    appsettings->setValue(TRAIN_PUBLISH_MSECS, publishMsecs->value());
 }
 
 void
@@ -1123,6 +1175,9 @@ ColorsPage::ColorsPage(QWidget *parent) : QWidget(parent)
     shadeZones->setChecked(appsettings->value(this, GC_SHADEZONES, true).toBool());
     antiAliased = new QCheckBox;
     antiAliased->setChecked(appsettings->value(this, GC_ANTIALIAS, false).toBool());
+    openGL = new QCheckBox;
+    openGL->setChecked(appsettings->value(this, GC_OPENGL, false).toBool());
+    openGL->setToolTip(tr("Paint the charts with OpenGL, from the next time GoldenCheetah starts"));
     lineWidth = new QDoubleSpinBox;
     lineWidth->setMaximum(5);
     lineWidth->setMinimum(0.5);
@@ -1132,6 +1187,7 @@ ColorsPage::ColorsPage(QWidget *parent) : QWidget(parent)
 
     QLabel *lineWidthLabel = new QLabel(tr("Line Width"));
     QLabel *antialiasLabel = new QLabel(tr("Antialias" ));
+    QLabel *openGLLabel = new QLabel(tr("OpenGL" ));
     QLabel *shadeZonesLabel = new QLabel(tr("Shade Zones" ));
 
     QLabel *defaultLabel = new QLabel(tr("Default"));
@@ -1220,6 +1276,8 @@ ColorsPage::ColorsPage(QWidget *parent) : QWidget(parent)
     misc->addStretch();
     misc->addWidget(antialiasLabel);
     misc->addWidget(antiAliased);
+    misc->addWidget(openGLLabel);
+    misc->addWidget(openGL);
     misc->addWidget(shadeZonesLabel);
     misc->addWidget(shadeZones);
     misc->addStretch();
@@ -1290,6 +1348,7 @@ ColorsPage::saveClicked()
 {
     appsettings->setValue(GC_LINEWIDTH, lineWidth->value());
     appsettings->setValue(GC_ANTIALIAS, antiAliased->isChecked());
+    appsettings->setValue(GC_OPENGL, openGL->isChecked());
     appsettings->setValue(GC_SHADEZONES, shadeZones->isChecked());
 
     // run down and get the current colors and save
@@ -1330,6 +1389,63 @@ ColorsPage::saveClicked()
     QApplication::setFont(font);
 }
 
+//
+// The metric lists on the summary and interval pages
+//
+// Naming a metric means instantiating it, so the names are
+// collected once and shared by both pages (and by every later
+// opening of the dialog) rather than for each list in turn
+//
+struct MetricNames
+{
+    QStringList symbols; // in factory order
+    QHash<QString, QString> names;
+};
+
+static const MetricNames &metricNames()
+{
+    static MetricNames cached;
+
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    if (cached.symbols.count() != factory.metricCount()) {
+        cached.symbols.clear();
+        cached.names.clear();
+        for (int i = 0; i < factory.metricCount(); ++i) {
+            QString symbol = factory.metricName(i);
+            QSharedPointer<RideMetric> m(factory.newMetric(symbol));
+            QString name = m->name();
+            name.replace(QObject::tr("&#8482;"), QObject::tr(" (TM)"));
+            cached.symbols << symbol;
+            cached.names.insert(symbol, name);
+        }
+    }
+    return cached;
+}
+
+static void fillMetricLists(QListWidget *availList, QListWidget *selectedList, QStringList selectedMetrics)
+{
+    const MetricNames &metrics = metricNames();
+
+    // sort once at the end, not on every insert
+    availList->setSortingEnabled(false);
+    foreach (QString symbol, metrics.symbols) {
+        if (selectedMetrics.contains(symbol))
+            continue;
+        QListWidgetItem *item = new QListWidgetItem(metrics.names.value(symbol));
+        item->setData(Qt::UserRole, symbol);
+        availList->addItem(item);
+    }
+    availList->setSortingEnabled(true);
+
+    foreach (QString symbol, selectedMetrics) {
+        if (!metrics.names.contains(symbol))
+            continue;
+        QListWidgetItem *item = new QListWidgetItem(metrics.names.value(symbol));
+        item->setData(Qt::UserRole, symbol);
+        selectedList->addItem(item);
+    }
+}
+
 IntervalMetricsPage::IntervalMetricsPage(QWidget *parent) :
     QWidget(parent), changed(false)
 {
@@ -1400,28 +1516,7 @@ IntervalMetricsPage::IntervalMetricsPage(QWidget *parent) :
         s = GC_SETTINGS_INTERVAL_METRICS_DEFAULT;
     QStringList selectedMetrics = s.split(",");
 
-    const RideMetricFactory &factory = RideMetricFactory::instance();
-    for (int i = 0; i < factory.metricCount(); ++i) {
-        QString symbol = factory.metricName(i);
-        if (selectedMetrics.contains(symbol))
-            continue;
-        QSharedPointer<RideMetric> m(factory.newMetric(symbol));
-        QString name = m->name();
-        name.replace(tr("&#8482;"), tr(" (TM)"));
-        QListWidgetItem *item = new QListWidgetItem(name);
-        item->setData(Qt::UserRole, symbol);
-        availList->addItem(item);
-    }
-    foreach (QString symbol, selectedMetrics) {
-        if (!factory.haveMetric(symbol))
-            continue;
-        QSharedPointer<RideMetric> m(factory.newMetric(symbol));
-        QString name = m->name();
-        name.replace(tr("&#8482;"), tr(" (TM)"));
-        QListWidgetItem *item = new QListWidgetItem(name);
-        item->setData(Qt::UserRole, symbol);
-        selectedList->addItem(item);
-    }
+    fillMetricLists(availList, selectedList, selectedMetrics);
 
     upButton->setEnabled(false);
     downButton->setEnabled(false);
@@ -1589,28 +1684,7 @@ SummaryMetricsPage::SummaryMetricsPage(QWidget *parent) :
     QString s = appsettings->value(this, GC_SETTINGS_SUMMARY_METRICS, GC_SETTINGS_SUMMARY_METRICS_DEFAULT).toString();
     QStringList selectedMetrics = s.split(",");
 
-    const RideMetricFactory &factory = RideMetricFactory::instance();
-    for (int i = 0; i < factory.metricCount(); ++i) {
-        QString symbol = factory.metricName(i);
-        if (selectedMetrics.contains(symbol))
-            continue;
-        QSharedPointer<RideMetric> m(factory.newMetric(symbol));
-        QString name = m->name();
-        name.replace(tr("&#8482;"), tr(" (TM)"));
-        QListWidgetItem *item = new QListWidgetItem(name);
-        item->setData(Qt::UserRole, symbol);
-        availList->addItem(item);
-    }
-    foreach (QString symbol, selectedMetrics) {
-        if (!factory.haveMetric(symbol))
-            continue;
-        QSharedPointer<RideMetric> m(factory.newMetric(symbol));
-        QString name = m->name();
-        name.replace(tr("&#8482;"), tr(" (TM)"));
-        QListWidgetItem *item = new QListWidgetItem(name);
-        item->setData(Qt::UserRole, symbol);
-        selectedList->addItem(item);
-    }
+    fillMetricLists(availList, selectedList, selectedMetrics);
 
     upButton->setEnabled(false);
     downButton->setEnabled(false);
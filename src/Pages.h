@@ -249,6 +249,13 @@ class DevicePage : public QWidget
         deviceModel *deviceListModel;
 
         QCheckBox   *multiCheck;
+        QSpinBox    *loadRate;      // load updates per second in a workout
+        QSpinBox    *loadLead;      // msecs ahead of the workout to send it
+
+        QCheckBox   *publishCheck;  // telemetry for other screens
+        QLineEdit   *publishAddress;
+        QSpinBox    *publishPort;
+        QSpinBox    *publishMsecs;
 };
 
 class IntervalMetricsPage : public QWidget
@@ -379,6 +386,7 @@ class ColorsPage : public QWidget
 
         // General stuff
         QCheckBox *antiAliased;
+        QCheckBox *openGL;
         QCheckBox *shadeZones;
         QDoubleSpinBox *lineWidth;
 
@@ -22,6 +22,103 @@
 #include <math.h>
 #include <QApplication>
 
+// All the standard peak power durations, computed in a single pass
+// over a prefix sum of watts rather than each PeakPower metric scanning
+// the ride with BestIntervalDialog::findBests. The results are equivalent
+// to that function when asked for a single best interval; the best avg and
+// the earliest start time in the event of a tie.
+static const int peakDurations[] = { 1, 5, 10, 15, 20, 30, 60, 120, 180, 300, 480, 600,
+                                     1200, 1800, 3600, 5400, 0 };
+
+class PeakPowerBests : public RideMetric {
+    Q_DECLARE_TR_FUNCTIONS(PeakPowerBests)
+
+    public:
+
+    struct Best {
+        int start;      // index of first sample
+        double secs,    // start time..
+               stop,    // ..and stop time as per findBests()
+               avg;
+        Best() : start(-1), secs(0), stop(0), avg(0) {}
+    };
+
+    // one for each of peakDurations
+    QVector<Best> bests;
+
+    PeakPowerBests()
+    {
+        setSymbol("peak_power_bests");
+        setInternalName("Peak Power Bests");
+        setType(RideMetric::Peak);
+        setAggregate(false);
+    }
+    void initialize () {
+        setName(tr("Peak Power Bests"));
+        setMetricUnits(tr("watts"));
+        setImperialUnits(tr("watts"));
+    }
+
+    // the best for a duration, or NULL if it isn't a standard one
+    const Best *bestFor(double secs) const {
+        for (int d=0; peakDurations[d] && d < bests.count(); d++)
+            if (peakDurations[d] == secs) return &bests[d];
+        return NULL;
+    }
+
+    void compute(const RideFile *ride, const Zones *, int,
+                 const HrZones *, int,
+                 const QHash<QString,RideMetric*> &,
+                 const Context *) {
+
+        int durations = 0;
+        while (peakDurations[durations]) durations++;
+        bests.fill(Best(), durations);
+
+        const QVector<RideFilePoint*> &points = ride->dataPoints();
+        int n = points.count();
+        if (n == 0) return;
+
+        // prefix sum of watts, sum[j+1] - sum[i] is the total over i..j
+        double secsDelta = ride->recIntSecs();
+        QVector<double> secs(n), sum(n+1);
+        sum[0] = 0;
+        for (int i=0; i<n; i++) {
+            secs[i] = points[i]->secs;
+            sum[i+1] = sum[i] + points[i]->watts;
+        }
+
+        // windows start at first[d] and end at the current sample
+        QVector<int> first(durations, 0);
+        double rideSecs = secs[n-1] + secsDelta;
+
+        for (int j=0; j<n; j++) {
+            for (int d=0; d<durations; d++) {
+
+                double window = peakDurations[d];
+                if (window > rideSecs) continue; // ride is shorter than the window size!
+
+                // Discard points until interval duration is < window + secsDelta.
+                int &i = first[d];
+                while (i < j && (secs[j] - secs[i] + secsDelta) >= window + secsDelta) i++;
+
+                double duration = secs[j] - secs[i] + secsDelta;
+                if (duration >= window) {
+                    double avg = (sum[j+1] - sum[i]) * secsDelta / duration;
+                    if (bests[d].start < 0 || avg > bests[d].avg) {
+                        bests[d].start = i;
+                        bests[d].secs = secs[i];
+                        bests[d].stop = secs[i] + duration;
+                        bests[d].avg = avg;
+                    }
+                }
+            }
+        }
+        setValue(0); // only meaningful to the PeakPower metrics
+    }
+    RideMetric *clone() const { return new PeakPowerBests(*this); }
+};
+
 class PeakPower : public RideMetric {
     Q_DECLARE_TR_FUNCTIONS(PeakPower)
     double watts;
@@ -36,16 +133,22 @@ class PeakPower : public RideMetric {
     void setSecs(double secs) { this->secs=secs; }
     void compute(const RideFile *ride, const Zones *, int,
                  const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
+                 const QHash<QString,RideMetric*> &deps,
                  const Context *) {
 
-        if (!ride->dataPoints().isEmpty()) {
+        const PeakPowerBests *kernel = dynamic_cast<PeakPowerBests*>(deps.value("peak_power_bests", NULL));
+        const PeakPowerBests::Best *best = kernel ? kernel->bestFor(secs) : NULL;
+
+        if (ride->dataPoints().isEmpty()) {
+            watts = 0.0;
+        } else if (best) {
+            if (best->start >= 0 && best->avg < 3000) watts = best->avg;
+            else watts = 0.0;
+        } else {
             QList<BestIntervalDialog::BestInterval> results;
             BestIntervalDialog::findBests(ride, secs, 1, results);
             if (results.count() > 0 && results.first().avg < 3000) watts = results.first().avg;
             else watts = 0.0;
-        } else {
-            watts = 0.0;
         }
         setValue(watts);
     }
@@ -338,18 +441,40 @@ class PeakPowerHr : public RideMetric {
     }
     void setSecs(double secs) { this->secs=secs; }
     void compute(const RideFile *ride, const Zones *, int, const HrZones *, int,
-                 const QHash<QString,RideMetric*> &, const Context *) {
+                 const QHash<QString,RideMetric*> &deps, const Context *) {
+
+        const PeakPowerBests *kernel = dynamic_cast<PeakPowerBests*>(deps.value("peak_power_bests", NULL));
+        const PeakPowerBests::Best *best = kernel ? kernel->bestFor(secs) : NULL;
 
         if (!ride->dataPoints().isEmpty()){
-            QList<BestIntervalDialog::BestInterval> results;
-            BestIntervalDialog::findBests(ride, secs, 1, results);
-            if (results.count() > 0) {
-                double start = results.first().start;
-                double stop = results.first().stop;
+            double start = 0, stop = 0;
+            int from = 0;
+            bool found = false;
+
+            if (best) {
+                found = best->start >= 0;
+                start = best->secs;
+                stop = best->stop;
+                from = best->start;
+            } else {
+                QList<BestIntervalDialog::BestInterval> results;
+                BestIntervalDialog::findBests(ride, secs, 1, results);
+                if (results.count() > 0) {
+                    found = true;
+                    start = results.first().start;
+                    stop = results.first().stop;
+                }
+            }
+
+            if (found) {
                 int points = 0;
 
-                foreach(const RideFilePoint *point, ride->dataPoints()) {
-                    if (point->secs >= start && point->secs < stop) {
+                // the points are in time order so we can start from the
+                // first point of the interval and stop once past the end
+                for (int i=from; i<ride->dataPoints().count(); i++) {
+                    const RideFilePoint *point = ride->dataPoints()[i];
+                    if (point->secs >= stop) break;
+                    if (point->secs >= start) {
                         points++;
                         hr = (point->hr + (points-1)*hr) / (points);
                     }
@@ -474,28 +599,31 @@ class PeakPowerHr60m : public PeakPowerHr {
 };
 
 static bool addAllPeaks() {
-    RideMetricFactory::instance().addMetric(PeakPower1s());
-    RideMetricFactory::instance().addMetric(PeakPower5s());
-    RideMetricFactory::instance().addMetric(PeakPower10s());
-    RideMetricFactory::instance().addMetric(PeakPower15s());
-    RideMetricFactory::instance().addMetric(PeakPower20s());
-    RideMetricFactory::instance().addMetric(PeakPower30s());
-    RideMetricFactory::instance().addMetric(PeakPower1m());
-    RideMetricFactory::instance().addMetric(PeakPower2m());
-    RideMetricFactory::instance().addMetric(PeakPower3m());
-    RideMetricFactory::instance().addMetric(PeakPower5m());
-    RideMetricFactory::instance().addMetric(PeakPower8m());
-    RideMetricFactory::instance().addMetric(PeakPower10m());
-    RideMetricFactory::instance().addMetric(PeakPower20m());
-    RideMetricFactory::instance().addMetric(PeakPower30m());
-    RideMetricFactory::instance().addMetric(CriticalPower());
-    RideMetricFactory::instance().addMetric(PeakPower90m());
-    RideMetricFactory::instance().addMetric(PeakPowerHr1m());
-    RideMetricFactory::instance().addMetric(PeakPowerHr5m());
-    RideMetricFactory::instance().addMetric(PeakPowerHr10m());
-    RideMetricFactory::instance().addMetric(PeakPowerHr20m());
-    RideMetricFactory::instance().addMetric(PeakPowerHr30m());
-    RideMetricFactory::instance().addMetric(PeakPowerHr60m());
+    RideMetricFactory::instance().addMetric(PeakPowerBests());
+    QVector<QString> deps;
+    deps.append("peak_power_bests");
+    RideMetricFactory::instance().addMetric(PeakPower1s(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower5s(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower10s(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower15s(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower20s(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower30s(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower1m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower2m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower3m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower5m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower8m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower10m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower20m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower30m(), &deps);
+    RideMetricFactory::instance().addMetric(CriticalPower(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPower90m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPowerHr1m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPowerHr5m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPowerHr10m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPowerHr20m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPowerHr30m(), &deps);
+    RideMetricFactory::instance().addMetric(PeakPowerHr60m(), &deps);
     return true;
 }
 
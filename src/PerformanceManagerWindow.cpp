@@ -163,30 +163,27 @@ void PerformanceManagerWindow::rideSelected()
 
 void PerformanceManagerWindow::replot()
 {
-    const QTreeWidgetItem *allRides = context->athlete->allRideItems();
-
     int newdays, rightIndex, endIndex;
-    RideItem *firstRideItem = NULL;
-    RideItem *lastRideItem = NULL;
+    QDateTime firstRide, lastRide;
     QDateTime now;
 
 
     // calculate the number of days to look at... for now
     // use first ride in allRides to today.  When Season stuff is hooked
     // up, maybe use that, or will allRides reflect only current season?
-    if (allRides->childCount()) {
-        firstRideItem =  (RideItem*) allRides->child(0);
-        lastRideItem =  (RideItem*) allRides->child(allRides->childCount()-1);
+    if (context->athlete->rideCount()) {
+        firstRide = context->athlete->rideDateTime(0);
+        lastRide = context->athlete->rideDateTime(context->athlete->rideCount()-1);
     }
 
-    if (firstRideItem) {
+    if (firstRide.isValid()) {
         int lookahead = (appsettings->cvalue(context->athlete->cyclist, GC_STS_DAYS,7)).toInt();
-        QDateTime endTime = std::max(lastRideItem->dateTime, now.currentDateTime());
+        QDateTime endTime = std::max(lastRide, now.currentDateTime());
         endTime = endTime.addDays( lookahead );
-        newdays = firstRideItem->dateTime.daysTo(endTime);
+        newdays = firstRide.daysTo(endTime);
         QString newMetric = metricCombo->itemData(metricCombo->currentIndex()).toString();
 
-        if (newdays != days || allRides->childCount() != count || newMetric != metric) {
+        if (newdays != days || context->athlete->rideCount() != count || newMetric != metric) {
 
 	    // days in allRides changed, so recalculate stress
 	    //
@@ -195,7 +192,7 @@ void PerformanceManagerWindow::replot()
 	    /*
 	    fprintf(stderr,
 		    "PerformanceManagerWindow::replot: %d days from %s to %s\n",
-		    newdays,firstRideItem->dateTime.toString().toAscii().data(),
+		    newdays,firstRide.toString().toAscii().data(),
 		    now.currentDateTime().toString().toAscii().data());
 		*/
 
@@ -206,7 +203,7 @@ void PerformanceManagerWindow::replot()
 
 	    sc = new StressCalculator(
             context->athlete->cyclist,
-		    firstRideItem->dateTime,
+		    firstRide,
 		    endTime,
 		    (appsettings->cvalue(context->athlete->cyclist, GC_STS_DAYS,7)).toInt(),
 		    (appsettings->cvalue(context->athlete->cyclist, GC_LTS_DAYS,42)).toInt());
@@ -255,7 +252,7 @@ void PerformanceManagerWindow::replot()
             perfplot->resize(PMleftSlider->value(),PMrightSlider->value());
 	    days = newdays;
             metric = newMetric;
-	    count = allRides->childCount();
+	    count = context->athlete->rideCount();
 	}
 	perfplot->plot();
     }
@@ -18,6 +18,8 @@
  */
 
 #include "PfPvPlot.h"
+#include "ScatterDensity.h"
+#include "Trace.h"
 #include "Athlete.h"
 #include "Context.h"
 #include "RideFile.h"
@@ -155,6 +157,12 @@ PfPvPlot::PfPvPlot(Context *context)
     curve = new QwtPlotCurve();
     curve->attach(this);
 
+    // long rides are shown as a density instead
+    density = new ScatterDensity(Qt::black);
+    density->setVisible(false);
+    density->attach(this);
+    dense = false;
+
     cl_ = appsettings->value(this, GC_CRANKLENGTH).toDouble() / 1000.0;
 
     // markup timeInQuadrant
@@ -343,8 +351,67 @@ int PfPvPlot::intervalCount() const
     return highlighted;
 }
 
+void
+PfPvPlot::prepare(const QVector<double> &watts, const QVector<double> &cad,
+                  double cl, PfPvData &data, const GcChartPrepare *work)
+{
+    GC_TRACE_SPAN("pfpv prepare");
+
+    // due to the discrete power and cadence values returned by the
+    // power meter, there will very likely be many duplicate values.
+    // Rather than pass them all to the curve, use a set to strip
+    // out duplicates.
+    std::set<std::pair<double, double> > dataSet;
+
+    long tot_cad = 0;
+    long tot_cad_points = 0;
+
+    int count = qMin(watts.count(), cad.count());
+    for (int i=0; i<count; i++) {
+
+        if (work && (i&1023) == 0 && work->cancelled()) return;
+
+        if (watts[i] != 0 && cad[i] != 0) {
+
+            double aepf = (watts[i] * 60.0) / (cad[i] * cl * 2.0 * PI);
+            double cpv = (cad[i] * cl * 2.0 * PI) / 60.0;
+
+            if (aepf <= 2500) { // > 2500 newtons is our out of bounds
+                dataSet.insert(std::make_pair<double, double>(aepf, cpv));
+                data.aepfs << aepf;
+                data.cpvs << cpv;
+                tot_cad += cad[i];
+                tot_cad_points++;
+            }
+        }
+    }
+
+    data.cad = tot_cad_points ? tot_cad / tot_cad_points : 0;
+
+    // Now that we have the set of points, transform them into the
+    // QwtArrays needed to set the curve's data.
+    std::set<std::pair<double, double> >::const_iterator j(dataSet.begin());
+    while (j != dataSet.end()) {
+        const std::pair<double, double>& dataPoint = *j;
+
+        data.aepfArray.push_back(dataPoint.first);
+        data.cpvArray.push_back(dataPoint.second);
+
+        ++j;
+    }
+}
+
 void
 PfPvPlot::setData(RideItem *_rideItem)
+{
+    PfPvData data;
+    RideFile *ride = _rideItem->ride();
+    if (ride) prepare(ride->seriesData(RideFile::watts), ride->seriesData(RideFile::cad), cl_, data);
+    setData(_rideItem, data);
+}
+
+void
+PfPvPlot::setData(RideItem *_rideItem, const PfPvData &data)
 {
     // clear out any interval curves which are presently defined
     if (intervalCurves.size()) {
@@ -363,58 +430,22 @@ PfPvPlot::setData(RideItem *_rideItem)
     if (ride) {
 
         // quickly erase old data
-        curve->setVisible(false);
-
-
-        // due to the discrete power and cadence values returned by the
-        // power meter, there will very likely be many duplicate values.
-        // Rather than pass them all to the curve, use a set to strip
-        // out duplicates.
-        std::set<std::pair<double, double> > dataSet;
-        std::set<std::pair<double, double> > dataSetSelected;
-
-        long tot_cad = 0;
-        long tot_cad_points = 0;
-
-        foreach(const RideFilePoint *p1, ride->dataPoints()) {
-
-            if (p1->watts != 0 && p1->cad != 0) {
+        showAll(false);
 
-                double aepf = (p1->watts * 60.0) / (p1->cad * cl_ * 2.0 * PI);
-                double cpv = (p1->cad * cl_ * 2.0 * PI) / 60.0;
+        setCAD(data.cad);
 
-                if (aepf <= 2500) { // > 2500 newtons is our out of bounds
-                    dataSet.insert(std::make_pair<double, double>(aepf, cpv));
-                    tot_cad += p1->cad;
-                    tot_cad_points++;
-                }
-            }
-        }
-
-        setCAD(tot_cad_points ? tot_cad / tot_cad_points : 0);
-
-        if (tot_cad_points == 0) {
+        if (data.cpvs.isEmpty()) {
             //setTitle(tr("no cadence"));
             refreshZoneItems();
-            curve->setVisible(false);
+            showAll(false);
 
         } else {
-            // Now that we have the set of points, transform them into the
-            // QwtArrays needed to set the curve's data.
-            QwtArray<double> aepfArray;
-            QwtArray<double> cpvArray;
-
-            std::set<std::pair<double, double> >::const_iterator j(dataSet.begin());
-            while (j != dataSet.end()) {
-                const std::pair<double, double>& dataPoint = *j;
+            curve->setData(data.cpvArray, data.aepfArray);
 
-                aepfArray.push_back(dataPoint.first);
-                cpvArray.push_back(dataPoint.second);
+            // too many to draw as symbols, show as a density
+            dense = ScatterDensity::wanted(data.cpvArray.size());
+            if (dense) density->setSamples(data.cpvs.constData(), data.aepfs.constData(), data.cpvs.count());
 
-                ++j;
-            }
-
-            curve->setData(cpvArray, aepfArray);
             QwtSymbol sym;
             sym.setStyle(QwtSymbol::Ellipse);
             sym.setSize(6);
@@ -422,18 +453,25 @@ PfPvPlot::setData(RideItem *_rideItem)
 
             // now show the data (zone shading would already be visible)
             refreshZoneItems();
-            curve->setVisible(true);
+            showAll(true);
         }
     } else {
 
         //setTitle("no data");
         refreshZoneItems();
-        curve->setVisible(false);
+        showAll(false);
     }
 
     replot();
 }
 
+void
+PfPvPlot::showAll(bool show)
+{
+    curve->setVisible(show && !dense);
+    density->setVisible(show && dense);
+}
+
 void
 PfPvPlot::showIntervals(RideItem *_rideItem)
 {
@@ -458,8 +496,8 @@ PfPvPlot::showIntervals(RideItem *_rideItem)
        int num_intervals=intervalCount();
 
        if (mergeIntervals()) num_intervals = 1;
-       if (frameIntervals() || num_intervals==0) curve->setVisible(true);
-       if (frameIntervals()==false && num_intervals) curve->setVisible(false);
+       if (frameIntervals() || num_intervals==0) showAll(true);
+       if (frameIntervals()==false && num_intervals) showAll(false);
        QVector<std::set<std::pair<double, double> > > dataSetInterval(num_intervals);
 
        long tot_cad = 0;
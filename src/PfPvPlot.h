@@ -30,10 +30,19 @@ class RideFile;
 class RideItem;
 struct RideFilePoint;
 class QwtPlotCurve;
+class ScatterDensity;
 class QwtPlotMarker;
 class Context;
 class PfPvPlotZoneLabel;
 
+// what setData plots for a ride, see PfPvPlot::prepare
+struct PfPvData {
+    QwtArray<double> aepfArray, cpvArray;   // without duplicates
+    QVector<double> aepfs, cpvs;            // all of them (for density)
+    int cad;                                // average cadence
+    PfPvData() : cad(0) {}
+};
+
 class PfPvPlot : public QwtPlot
 {
     Q_OBJECT
@@ -45,6 +54,13 @@ class PfPvPlot : public QwtPlot
         PfPvPlot(Context *context);
         void refreshZoneItems();
         void setData(RideItem *_rideItem);
+
+        // the work behind setData, split out so it can be done off the
+        // GUI thread from snapshots of the series; it stops early if work
+        // is cancelled. Crank length cl is in metres.
+        static void prepare(const QVector<double> &watts, const QVector<double> &cad,
+                            double cl, PfPvData &data, const GcChartPrepare *work = NULL);
+        void setData(RideItem *_rideItem, const PfPvData &data);
         void showIntervals(RideItem *_rideItem);
 
         int getCP();
@@ -81,9 +97,12 @@ class PfPvPlot : public QwtPlot
 
     protected:
         int intervalCount() const;
+        void showAll(bool); // all points as curve or density
 
         Context *context;
         QwtPlotCurve *curve;
+        ScatterDensity *density;
+        bool dense;          // too many points, drawing density
         QList <QwtPlotCurve *> intervalCurves;
         QwtPlotCurve *cpCurve;
         QList <QwtPlotCurve *> zoneCurves;
@@ -207,15 +207,39 @@ PfPvWindow::rideSelected()
     if (!ride || !ride->ride() || !ride->ride()->isDataPresent(RideFile::watts) || !ride->ride()->isDataPresent(RideFile::cad)) {
         setIsBlank(true);
         current = NULL;
+        cancelPrepare();
         return;
     }
     else {
         setIsBlank(false);
     }
 
-    if (ride == current) return;
+    if (ride == current) {
+        cancelPrepare(); // we came back before the last one arrived
+        return;
+    }
+
+    // the series are shared, not copied, so can be read on the
+    // worker even if the ride is edited in the meantime
+    Prepare *work = new Prepare;
+    work->item = ride;
+    work->watts = ride->ride()->seriesData(RideFile::watts);
+    work->cad = ride->ride()->seriesData(RideFile::cad);
+    work->cl = pfPvPlot->getCL();
+    requestPrepare(work);
+}
+
+void
+PfPvWindow::prepared(GcChartPrepare *work)
+{
+    Prepare *done = static_cast<Prepare*>(work);
 
-    pfPvPlot->setData(ride);
+    // the ride may have gone since
+    RideItem *ride = myRideItem;
+    if (done->item != ride || !ride->ride()) return;
+
+    pfPvPlot->setData(ride, done->data);
+    pfPvPlot->showIntervals(ride);
 
     current = ride;
 
@@ -112,6 +112,16 @@ class PfPvWindow : public GcChartWindow
         QLineEdit *qaClValue;
         RideItem *current;
 
+        // the pf/pv points worked out on a worker
+        struct Prepare : public GcChartPrepare {
+            RideItem *item;
+            QVector<double> watts, cad;
+            double cl;
+            PfPvData data;
+            void prepare() { PfPvPlot::prepare(watts, cad, cl, data, this); }
+        };
+        void prepared(GcChartPrepare *work);
+
     private:
         // reveal controls
         QCheckBox *rShade, *rMergeInterval, *rFrameInterval;
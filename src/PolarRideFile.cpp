@@ -20,6 +20,7 @@
 #include "Units.h"
 #include <QRegExp>
 #include <QTextStream>
+#include "DelimitedText.h"
 #include <algorithm> // for std::sort
 #include "math.h"
 
@@ -209,23 +210,24 @@ this differently
                 seconds += recInterval;
 
                 int i=0;
-                hr = line.section('\t', i, i).toDouble();
+                DelimitedLine fields(line, '\t'); // split once, not for every field
+                hr = fields.value(i);
                 i++;
 
                 if (speed) {
-                    kph = line.section('\t', i, i).toDouble()/10;
+                    kph = fields.value(i)/10;
                     i++;
                 }
                 if (cadence) {
-                    cad = line.section('\t', i, i).toDouble();
+                    cad = fields.value(i);
                     i++;
                 }
                 if (altitude) {
-                    alt = line.section('\t', i, i).toDouble();
+                    alt = fields.value(i);
                     i++;
                 }
                 if (power) {
-                    watts = line.section('\t', i, i).toDouble();
+                    watts = fields.value(i);
                     i++;
                 }
                 if (balance) {
@@ -241,7 +243,7 @@ this differently
                     // For example value 12857 (= 40 * 256 + 47)
                     // means: PI = 40 and LRB = 47 => L47 - 53R
 
-                    lrbalance = line.section('\t', i, i).toInt() & 0xff;
+                    lrbalance = fields.integer(i) & 0xff;
                     i++;
                 }
 
@@ -20,6 +20,7 @@
 #include "PowerHist.h"
 #include "MainWindow.h"
 #include "Context.h"
+#include "Trace.h"
 #include "Athlete.h"
 #include "RideItem.h"
 #include "IntervalItem.h"
@@ -44,6 +45,46 @@
 
 #include "LTMCanvasPicker.h" // for tooltip
 
+// predefined deltas for each series
+static const double wattsDelta = 1.0;
+static const double wattsKgDelta = 0.01;
+static const double nmDelta    = 0.1;
+static const double hrDelta    = 1.0;
+static const double kphDelta   = 0.1;
+static const double cadDelta   = 1.0;
+
+static const int maxSize = 4096;
+
+// count a sample in a distribution array, growing it as needed
+static inline void
+addSample(QVector<unsigned int> &array, int index)
+{
+    if (index >= 0 && index < maxSize) {
+        if (index >= array.size()) array.resize(index + 1);
+        array[index]++;
+    }
+}
+
+// total up a distribution array by zone, the array is indexed by
+// value/delta so each index maps to a single zone
+template <class Z>
+static void
+zoneSamples(const Z *zones, int range, const QVector<unsigned int> &array, double delta,
+            bool withz, QVector<unsigned int> &zoneArray)
+{
+    zoneArray.resize(0);
+    if (!zones || range < 0) return;
+
+    for (int i = withz ? 0 : 1; i < array.size(); i++) {
+        if (!array[i]) continue;
+        int zone = zones->whichZone(range, i * delta);
+        if (zone >= 0 && zone < maxSize) {
+            if (zone >= zoneArray.size()) zoneArray.resize(zone + 1);
+            zoneArray[zone] += array[i];
+        }
+    }
+}
+
 PowerHist::PowerHist(Context *context):
     minX(0),
     maxX(0),
@@ -60,6 +101,10 @@ PowerHist::PowerHist(Context *context):
     cache(NULL),
     source(Ride)
 {
+    binnedRide = NULL;
+    binnedMetricUnits = true;
+    binnedPoints = 0;
+
     binw = appsettings->value(this, GC_HIST_BIN_WIDTH, 5).toInt();
     if (appsettings->value(this, GC_SHADEZONES, true).toBool() == true)
         shade = true;
@@ -263,6 +308,7 @@ PowerHist::refreshHRZoneLabels()
 void
 PowerHist::recalc(bool force)
 {
+    GC_TRACE_SPAN("histogram");
     QVector<unsigned int> *array = NULL;
     QVector<unsigned int> *selectedArray = NULL;
     int arrayLength = 0;
@@ -303,6 +349,21 @@ PowerHist::recalc(bool force)
 
     if (source == Ride && !rideItem) return;
 
+    // zones are totalled from the ride distributions, so we
+    // don't need to go back to the samples when zoning or zeroes change
+    if (source == Ride && zoned == true && rideItem->ride()) {
+        RideFile *ride = rideItem->ride();
+        const Zones *zones = rideItem->zones;
+        int zoneRange = zones ? zones->whichRange(ride->startTime().date()) : -1;
+        zoneSamples(zones, zoneRange, wattsArray, wattsDelta, withz, wattsZoneArray);
+        zoneSamples(zones, zoneRange, wattsSelectedArray, wattsDelta, withz, wattsZoneSelectedArray);
+
+        const HrZones *hrZones = context->athlete->hrZones();
+        int hrZoneRange = hrZones ? hrZones->whichRange(ride->startTime().date()) : -1;
+        zoneSamples(hrZones, hrZoneRange, hrArray, hrDelta, withz, hrZoneArray);
+        zoneSamples(hrZones, hrZoneRange, hrSelectedArray, hrDelta, withz, hrZoneSelectedArray);
+    }
+
     // make sure the interval length is set if not plotting metrics
     if (source != Metric && dt <= 0) return;
 
@@ -647,37 +708,52 @@ PowerHist::setData(QList<SummaryMetrics>&results, QString totalMetric, QString d
     metricX = distMetric;
     metricY = totalMetric;
 
-    // how big should the array be?
+    // each ride's value and what it adds to the total, read once
     double multiplier = pow(10, m->precision());
-    double max = 0, min = 0;
+    bool distMinutes = m->units(context->athlete->useMetricUnits) == tr("seconds");
+    bool totalMinutes = tm->units(context->athlete->useMetricUnits) == tr("seconds");
+    bool temp = distMetric == "average_temp" || distMetric == "max_temp";
 
-    // LOOP THRU VALUES -- REPEATED WITH CUT AND PASTE BELOW
-    // SO PLEASE MAKE SAME CHANGES TWICE (SORRY)
-    foreach(SummaryMetrics x, results) { 
+    QVector<double> values, totals;
+    values.reserve(results.count());
+    totals.reserve(results.count());
+    double max = 0, min = 0;
+    foreach(const SummaryMetrics &x, results) {
 
         // skip filtered values
         if (isFiltered && !files.contains(x.getFileName())) continue;
 
         // and global filter too
-        if (context->isfiltered && !context->filters.contains(x.getFileName())) continue;
+        if (context->isfiltered && !context->filterSet.contains(x.getFileName())) continue;
 
         // get computed value
         double v = x.getForSymbol(distMetric, context->athlete->useMetricUnits);
 
         // ignore no temp files
-        if ((distMetric == "average_temp" || distMetric == "max_temp") && v == RideFile::noTemp) continue;
+        if (temp && v == RideFile::noTemp) continue;
 
         // clean up dodgy values
         if (isnan(v) || isinf(v)) v = 0;
 
         // seconds to minutes
-        if (m->units(context->athlete->useMetricUnits) == tr("seconds")) v /= 60;
+        if (distMinutes) v /= 60;
 
         // apply multiplier
         v *= multiplier;
 
         if (v>max) max = v;
         if (v<min) min = v;
+
+        // there will be some loss of precision due to totalising
+        // a double in an int, but frankly that should be minimal
+        // since most values of note are integer based anyway.
+        double t = x.getForSymbol(totalMetric, context->athlete->useMetricUnits);
+
+        // totalise in minutes
+        if (totalMinutes) t /= 60;
+
+        values << v;
+        totals << t;
     }
 
     // lets truncate the data if there are very high
@@ -685,51 +761,18 @@ PowerHist::setData(QList<SummaryMetrics>&results, QString totalMetric, QString d
     if (max > 100000) max = 100000;
     if (min < -100000) min = -100000;
 
-    // now run thru the data again, but this time
-    // populate the metricArray
+    // the distribution at the metric's precision, the bin width
+    // is applied by recalc() so changing it doesn't come back here
     // we add 1 to account for possible rounding up
     metricArray.resize(1 + (int)(max)-(int)(min));
     metricArray.fill(0);
-
-    // LOOP THRU VALUES -- REPEATED WITH CUT AND PASTE ABOVE
-    // SO PLEASE MAKE SAME CHANGES TWICE (SORRY)
-    foreach(SummaryMetrics x, results) { 
-
-        // skip filtered values
-        if (isFiltered && !files.contains(x.getFileName())) continue;
-
-        // and global filter too
-        if (context->isfiltered && !context->filters.contains(x.getFileName())) continue;
-
-        // get computed value
-        double v = x.getForSymbol(distMetric, context->athlete->useMetricUnits);
-
-        // ignore no temp files
-        if ((distMetric == "average_temp" || distMetric == "max_temp") && v == RideFile::noTemp) continue;
-
-        // clean up dodgy values
-        if (isnan(v) || isinf(v)) v = 0;
-
-        // seconds to minutes
-        if (m->units(context->athlete->useMetricUnits) == tr("seconds")) v /= 60;
-
-        // apply multiplier
-        v *= multiplier;
+    for (int i=0; i<values.count(); i++) {
 
         // ignore out of bounds data
-        if ((int)(v)<min || (int)(v)>max) continue;
-
-        // increment value, are intitialised to zero above
-        // there will be some loss of precision due to totalising
-        // a double in an int, but frankly that should be minimal
-        // since most values of note are integer based anyway.
-        double t = x.getForSymbol(totalMetric, context->athlete->useMetricUnits);
-
-        // totalise in minutes
-        if (tm->units(context->athlete->useMetricUnits) == tr("seconds")) t /= 60;
+        if ((int)(values[i])<min || (int)(values[i])>max) continue;
 
         // sum up
-        metricArray[(int)(v)-min] += t;
+        metricArray[(int)(values[i])-min] += totals[i];
     }
 
     // we certainly don't want the interval curve when plotting
@@ -773,14 +816,6 @@ PowerHist::updatePlot()
 void
 PowerHist::setData(RideItem *_rideItem, bool force)
 {
-    // predefined deltas for each series
-    static const double wattsDelta = 1.0;
-    static const double wattsKgDelta = 0.01;
-    static const double nmDelta    = 0.1;
-    static const double hrDelta    = 1.0;
-    static const double kphDelta   = 0.1;
-    static const double cadDelta   = 1.0;
-
     source = Ride;
 
     // we set with this data already
@@ -801,173 +836,21 @@ PowerHist::setData(RideItem *_rideItem, bool force)
     if (ride && hasData) {
         //setTitle(ride->startTime().toString(GC_DATETIME_FORMAT));
 
-        static const int maxSize = 4096;
-
         // recording interval in minutes
         dt = ride->recIntSecs() / 60.0;
 
-        wattsArray.resize(0);
-        wattsZoneArray.resize(0);
-        wattsKgArray.resize(0);
-        aPowerArray.resize(0);
-        nmArray.resize(0);
-        hrArray.resize(0);
-        hrZoneArray.resize(0);
-        kphArray.resize(0);
-        cadArray.resize(0);
-
-        wattsSelectedArray.resize(0);
-        wattsZoneSelectedArray.resize(0);
-        wattsKgSelectedArray.resize(0);
-        aPowerSelectedArray.resize(0);
-        nmSelectedArray.resize(0);
-        hrSelectedArray.resize(0);
-        hrZoneSelectedArray.resize(0);
-        kphSelectedArray.resize(0);
-        cadSelectedArray.resize(0);
-
-        // unit conversion factor for imperial units for selected parameters
-        double torque_factor = (context->athlete->useMetricUnits ? 1.0 : 0.73756215);
-        double speed_factor  = (context->athlete->useMetricUnits ? 1.0 : 0.62137119);
-
-        foreach(const RideFilePoint *p1, ride->dataPoints()) {
-            bool selected = isSelected(p1, ride->recIntSecs());
-
-            // watts array
-            int wattsIndex = int(floor(p1->watts / wattsDelta));
-            if (wattsIndex >= 0 && wattsIndex < maxSize) {
-                if (wattsIndex >= wattsArray.size())
-                    wattsArray.resize(wattsIndex + 1);
-                wattsArray[wattsIndex]++;
-
-                if (selected) {
-                    if (wattsIndex >= wattsSelectedArray.size())
-                        wattsSelectedArray.resize(wattsIndex + 1);
-                    wattsSelectedArray[wattsIndex]++;
-                }
-            }
-
-            // watts zoned array
-            const Zones *zones = rideItem->zones;
-            int zoneRange = zones ? zones->whichRange(ride->startTime().date()) : -1;
-
-            // Only calculate zones if we have a valid range and check zeroes
-            if (zoneRange > -1 && (withz || (!withz && p1->watts))) {
-                wattsIndex = zones->whichZone(zoneRange, p1->watts);
-
-                if (wattsIndex >= 0 && wattsIndex < maxSize) {
-                    if (wattsIndex >= wattsZoneArray.size())
-                        wattsZoneArray.resize(wattsIndex + 1);
-                    wattsZoneArray[wattsIndex]++;
-
-                    if (selected) {
-                        if (wattsIndex >= wattsZoneSelectedArray.size())
-                            wattsZoneSelectedArray.resize(wattsIndex + 1);
-                        wattsZoneSelectedArray[wattsIndex]++;
-                    }
-                }
-            }
-
-            // aPower array
-            int aPowerIndex = int(floor(p1->apower / wattsDelta));
-            if (aPowerIndex >= 0 && aPowerIndex < maxSize) {
-                if (aPowerIndex >= aPowerArray.size())
-                    aPowerArray.resize(aPowerIndex + 1);
-                aPowerArray[aPowerIndex]++;
-
-                if (selected) {
-                    if (aPowerIndex >= aPowerSelectedArray.size())
-                        aPowerSelectedArray.resize(aPowerIndex + 1);
-                    aPowerSelectedArray[aPowerIndex]++;
-                }
-            }
-
-            // wattsKg array
-            int wattsKgIndex = int(floor(p1->watts / ride->getWeight() / wattsKgDelta));
-            if (wattsKgIndex >= 0 && wattsKgIndex < maxSize) {
-                if (wattsKgIndex >= wattsKgArray.size())
-                    wattsKgArray.resize(wattsKgIndex + 1);
-                wattsKgArray[wattsKgIndex]++;
-
-                if (selected) {
-                    if (wattsKgIndex >= wattsKgSelectedArray.size())
-                        wattsKgSelectedArray.resize(wattsKgIndex + 1);
-                    wattsKgSelectedArray[wattsKgIndex]++;
-                }
-            }
-
-            int nmIndex = int(floor(p1->nm * torque_factor / nmDelta));
-            if (nmIndex >= 0 && nmIndex < maxSize) {
-                if (nmIndex >= nmArray.size())
-                    nmArray.resize(nmIndex + 1);
-                nmArray[nmIndex]++;
+        // the distributions for the whole ride are only collected once
+        // per ride, all the plot settings re-bin from them and a change
+        // of interval selection only needs the selected ones again
+        if (binnedRide != ride || binnedMetricUnits != context->athlete->useMetricUnits ||
+            binnedPoints != ride->dataPoints().count()) {
 
-                if (selected) {
-                    if (nmIndex >= nmSelectedArray.size())
-                        nmSelectedArray.resize(nmIndex + 1);
-                    nmSelectedArray[nmIndex]++;
-                }
-            }
-
-            int hrIndex = int(floor(p1->hr / hrDelta));
-            if (hrIndex >= 0 && hrIndex < maxSize) {
-                if (hrIndex >= hrArray.size())
-                    hrArray.resize(hrIndex + 1);
-                hrArray[hrIndex]++;
-
-                if (selected) {
-                    if (hrIndex >= hrSelectedArray.size())
-                        hrSelectedArray.resize(hrIndex + 1);
-                    hrSelectedArray[hrIndex]++;
-                }
-            }
-
-            // hr zoned array
-            int hrZoneRange = context->athlete->hrZones() ? context->athlete->hrZones()->whichRange(ride->startTime().date()) : -1;
-
-            // Only calculate zones if we have a valid range
-            if (hrZoneRange > -1 && (withz || (!withz && p1->hr))) {
-                hrIndex = context->athlete->hrZones()->whichZone(hrZoneRange, p1->hr);
-
-                if (hrIndex >= 0 && hrIndex < maxSize) {
-                    if (hrIndex >= hrZoneArray.size())
-                        hrZoneArray.resize(hrIndex + 1);
-                    hrZoneArray[hrIndex]++;
-
-                    if (selected) {
-                        if (hrIndex >= hrZoneSelectedArray.size())
-                            hrZoneSelectedArray.resize(hrIndex + 1);
-                        hrZoneSelectedArray[hrIndex]++;
-                    }
-                }
-            }
-
-            int kphIndex = int(floor(p1->kph * speed_factor / kphDelta));
-            if (kphIndex >= 0 && kphIndex < maxSize) {
-                if (kphIndex >= kphArray.size())
-                    kphArray.resize(kphIndex + 1);
-                kphArray[kphIndex]++;
-
-                if (selected) {
-                    if (kphIndex >= kphSelectedArray.size())
-                        kphSelectedArray.resize(kphIndex + 1);
-                    kphSelectedArray[kphIndex]++;
-                }
-            }
-
-            int cadIndex = int(floor(p1->cad / cadDelta));
-            if (cadIndex >= 0 && cadIndex < maxSize) {
-                if (cadIndex >= cadArray.size())
-                    cadArray.resize(cadIndex + 1);
-                cadArray[cadIndex]++;
-
-                if (selected) {
-                    if (cadIndex >= cadSelectedArray.size())
-                        cadSelectedArray.resize(cadIndex + 1);
-                    cadSelectedArray[cadIndex]++;
-                }
-            }
+            binSamples(ride, false);
+            binnedRide = ride;
+            binnedMetricUnits = context->athlete->useMetricUnits;
+            binnedPoints = ride->dataPoints().count();
         }
+        binSamples(ride, true);
 
     } else {
 
@@ -981,6 +864,84 @@ PowerHist::setData(RideItem *_rideItem, bool force)
     zoomer->setZoomBase();
 }
 
+void
+PowerHist::binSamples(RideFile *ride, bool selected)
+{
+    QVector<unsigned int> &watts = selected ? wattsSelectedArray : wattsArray;
+    QVector<unsigned int> &wattsKg = selected ? wattsKgSelectedArray : wattsKgArray;
+    QVector<unsigned int> &aPower = selected ? aPowerSelectedArray : aPowerArray;
+    QVector<unsigned int> &nm = selected ? nmSelectedArray : nmArray;
+    QVector<unsigned int> &hr = selected ? hrSelectedArray : hrArray;
+    QVector<unsigned int> &kph = selected ? kphSelectedArray : kphArray;
+    QVector<unsigned int> &cad = selected ? cadSelectedArray : cadArray;
+
+    watts.resize(0);
+    wattsKg.resize(0);
+    aPower.resize(0);
+    nm.resize(0);
+    hr.resize(0);
+    kph.resize(0);
+    cad.resize(0);
+
+    // the selected intervals, looked up once rather than per sample
+    QVector<double> starts, stops;
+    if (selected && context->athlete->allIntervalItems() != NULL) {
+        for (int i=0; i<context->athlete->allIntervalItems()->childCount(); i++) {
+            IntervalItem *current = dynamic_cast<IntervalItem*>(context->athlete->allIntervalItems()->child(i));
+            if (current != NULL && current->isSelected()) {
+                starts << current->start;
+                stops << current->stop;
+            }
+        }
+    }
+    if (selected && starts.isEmpty()) return;
+
+    // unit conversion factor for imperial units for selected parameters
+    double torque_factor = (context->athlete->useMetricUnits ? 1.0 : 0.73756215);
+    double speed_factor  = (context->athlete->useMetricUnits ? 1.0 : 0.62137119);
+    double weight = ride->getWeight();
+    double sample = ride->recIntSecs();
+
+    // the samples to visit, the selected intervals are found by a
+    // binary search and overlapping ones merged so we only walk them
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+    QVector<QPair<int,int> > ranges;
+    if (selected) {
+        for (int i=0; i<starts.count(); i++) {
+            int first = ride->timeIndex(starts[i] - sample);
+            int last = ride->timeIndex(stops[i]);
+            if (last >= 0 && points[last]->secs < stops[i]) last++;
+            if (first >= 0 && first < last) ranges << qMakePair(first, last);
+        }
+        qSort(ranges);
+        for (int i=1; i<ranges.count();) {
+            if (ranges[i].first <= ranges[i-1].second) {
+                ranges[i-1].second = qMax(ranges[i-1].second, ranges[i].second);
+                ranges.remove(i);
+            } else i++;
+        }
+    } else ranges << qMakePair(0, points.count());
+
+    for (int r=0; r<ranges.count(); r++) for (int k=ranges[r].first; k<ranges[r].second; k++) {
+        const RideFilePoint *p1 = points[k];
+
+        if (selected) {
+            int i;
+            for (i=0; i<starts.count(); i++)
+                if (p1->secs+sample>starts[i] && p1->secs<stops[i]) break;
+            if (i == starts.count()) continue;
+        }
+
+        addSample(watts, int(floor(p1->watts / wattsDelta)));
+        addSample(aPower, int(floor(p1->apower / wattsDelta)));
+        addSample(wattsKg, int(floor(p1->watts / weight / wattsKgDelta)));
+        addSample(nm, int(floor(p1->nm * torque_factor / nmDelta)));
+        addSample(hr, int(floor(p1->hr / hrDelta)));
+        addSample(kph, int(floor(p1->kph * speed_factor / kphDelta)));
+        addSample(cad, int(floor(p1->cad / cadDelta)));
+    }
+}
+
 void
 PowerHist::setBinWidth(double value)
 {
@@ -1109,20 +1070,6 @@ bool PowerHist::shadeHRZones() const
     return (rideItem && rideItem->ride() && series == RideFile::hr && !zoned && shade == true);
 }
 
-bool PowerHist::isSelected(const RideFilePoint *p, double sample) {
-    if (context->athlete->allIntervalItems() != NULL) {
-        for (int i=0; i<context->athlete->allIntervalItems()->childCount(); i++) {
-            IntervalItem *current = dynamic_cast<IntervalItem*>(context->athlete->allIntervalItems()->child(i));
-            if (current != NULL) {
-                if (current->isSelected() && p->secs+sample>current->start && p->secs<current->stop) {
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
-}
-
 void
 PowerHist::pointHover(QwtPlotCurve *curve, int index)
 {
@@ -152,7 +152,7 @@ class PowerHist : public QwtPlot
 
         void refreshHRZoneLabels();
         void setParameterAxisTitle();
-        bool isSelected(const RideFilePoint *p, double);
+        void binSamples(RideFile *ride, bool selected);
         void percentify(QVector<double> &, double factor); // and a function to convert
 
         bool shadeZones() const; // check if zone shading is both wanted and possible
@@ -202,6 +202,11 @@ class PowerHist : public QwtPlot
         enum Source { Ride, Cache, Metric } source, LASTsource;
         QColor metricColor;
 
+        // ride the distributions were collected from
+        const RideFile *binnedRide;
+        bool binnedMetricUnits;
+        int binnedPoints;
+
         // last plot settings - to avoid lots of uneeded recalcs
         RideItem *LASTrideItem;
         RideFileCache *LASTcache;
@@ -19,7 +19,8 @@
 #include "PwxRideFile.h"
 #include "Athlete.h"
 #include "Settings.h"
-#include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 #include <QVector>
 
 #include <QDebug>
@@ -31,29 +32,48 @@ static int pwxFileReaderRegistered =
 RideFile *
 PwxFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
 {
-    QDomDocument doc("TrainingPeaks PWX");
     if (!file.open(QIODevice::ReadOnly)) {
         errors << "Could not open file.";
         return NULL;
     }
 
-    bool parsed = doc.setContent(&file);
+    // samples go straight into the ride as they are read
+    QXmlStreamReader xml(&file);
+    RideFile *ride = PwxFromStream(xml, errors);
     file.close();
-    if (!parsed) {
-        errors << "Could not parse file.";
-        return NULL;
-    }
+    return ride;
+}
+
+RideFile *
+PwxFileReader::PwxFromXml(const QByteArray &pwx, QStringList &errors) const
+{
+    QXmlStreamReader xml(pwx);
+    return PwxFromStream(xml, errors);
+}
 
-    return PwxFromDomDoc(doc, errors);
+// the text of the element we're at, and any elements in it
+static inline QString text(QXmlStreamReader &xml)
+{
+    return xml.readElementText(QXmlStreamReader::IncludeChildElements);
 }
 
 RideFile *
-PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList &errors) const
+PwxFileReader::PwxFromStream(QXmlStreamReader &xml, QStringList &errors) const
 {
+    // the root (pwx) then its first workout
+    bool workout = false;
+    if (xml.readNextStartElement()) {
+        while (!workout && xml.readNextStartElement()) {
+            if (xml.name() == "workout") workout = true;
+            else xml.skipCurrentElement();
+        }
+    }
+    if (xml.hasError()) {
+        errors << "Could not parse file.";
+        return NULL;
+    }
+
     RideFile *rideFile = new RideFile();
-    QDomElement root = doc.documentElement();
-    QDomNode workout = root.firstChildElement("workout");
-    QDomNode node = workout.firstChild();
 
     // can arrive at any time, so lets cache them
     // and sort out at the end
@@ -66,166 +86,134 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList &errors) const
     double rtime = 0;
     double rdist = 0;
 
-    while (!node.isNull()) {
+    while (workout && xml.readNextStartElement()) {
 
-        // athlete
-        if (node.nodeName() == "athlete") {
+        QStringRef node = xml.name();
 
-            QDomElement name = node.firstChildElement("name");
-            if (!name.isNull()) {
-                rideFile->setTag("Athlete Name", name.text());
-            }
+        // athlete
+        if (node == "athlete") {
 
-            QDomElement weight = node.firstChildElement("weight");
-            if (!weight.isNull()) {
-                rideFile->setTag("Weight", weight.text());
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "name") rideFile->setTag("Athlete Name", text(xml));
+                else if (xml.name() == "weight") rideFile->setTag("Weight", text(xml));
+                else xml.skipCurrentElement();
             }
 
         // workout code
-        } else if (node.nodeName() == "code") {
+        } else if (node == "code") {
 
-            QDomElement code = node.toElement();
-            rideFile->setTag("Workout Code", code.text());
+            rideFile->setTag("Workout Code", text(xml));
 
         // goal / objective
-        } else if (node.nodeName() == "goal") {
+        } else if (node == "goal") {
 
-            QDomElement goal = node.toElement();
-            rideFile->setTag("Objective", goal.text());
+            rideFile->setTag("Objective", text(xml));
 
         // sport
-        } else if (node.nodeName() == "sportType") {
+        } else if (node == "sportType") {
 
-            QDomElement sport = node.toElement();
-            rideFile->setTag("Sport", sport.text());
+            rideFile->setTag("Sport", text(xml));
 
         // notes
-        } else if (node.nodeName() == "cmt") {
+        } else if (node == "cmt") {
 
             // Add the PWX cmt tag as notes
-            QDomElement notes = node.toElement();
-            rideFile->setTag("Notes", notes.text());
+            rideFile->setTag("Notes", text(xml));
 
         // device type and info
-        } else if (node.nodeName() == "device") {
-
-            QString devicetype;
-            // make and model
-            QDomElement make = node.firstChildElement("make");
-            if (!make.isNull()) devicetype = make.text();
-            QDomElement model = node.firstChildElement("model");
-            if (!model.isNull()) {
+        } else if (node == "device") {
+
+            // make and model, and the device settings data
+            QString make, model, deviceinfo;
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "make") make = text(xml);
+                else if (xml.name() == "model") model = text(xml);
+                else if (xml.name() == "extension") {
+                    while (xml.readNextStartElement()) {
+                        deviceinfo += xml.name().toString();
+                        deviceinfo += ": ";
+                        deviceinfo += text(xml);
+                        deviceinfo += '\n';
+                    }
+                } else xml.skipCurrentElement();
+            }
+
+            QString devicetype = make;
+            if (model != "") {
                 if (devicetype != "") devicetype += " ";
-                devicetype += model.text();
+                devicetype += model;
             }
             rideFile->setDeviceType(devicetype);
             rideFile->setFileFormat("Peaksware Data File (pwx)");
-
-            // device settings data
-            QString deviceinfo;
-            QDomElement extension = node.firstChildElement("extension");
-            if (!extension.isNull()) {
-                for (QDomElement info=extension.firstChildElement();
-                    !info.isNull();
-                    info = info.nextSiblingElement()) {
-                    deviceinfo += info.tagName();
-                    deviceinfo += ": ";
-                    deviceinfo += info.text();
-                    deviceinfo += '\n';
-                }
-            }
             rideFile->setTag("Device Info", deviceinfo);
 
         // start date/time
-        } else if (node.nodeName() == "time") {
-            QDomElement date = node.toElement();
-            rideDate = QDateTime::fromString(date.text(), Qt::ISODate);
+        } else if (node == "time") {
+            rideDate = QDateTime::fromString(text(xml), Qt::ISODate);
             rideFile->setStartTime(rideDate);
 
         // interval data
-        } else if (node.nodeName() == "segment") {
+        } else if (node == "segment") {
             RideFileInterval add;
+            bool summary = false;
+            add.start = add.stop = -1;
+
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "name") add.name = text(xml);
+                else if (xml.name() == "summarydata") {
+                    summary = true;
+                    double duration = -1;
+                    while (xml.readNextStartElement()) {
+                        // start, and duration converted to end
+                        if (xml.name() == "beginning") add.start = text(xml).toDouble();
+                        else if (xml.name() == "duration") duration = text(xml).toDouble();
+                        else xml.skipCurrentElement();
+                    }
+                    if (duration != -1 && add.start != -1) add.stop = duration + add.start;
+                } else xml.skipCurrentElement();
+            }
+            if (add.name.isEmpty()) add.name = QString("Interval #%1").arg(++intervals);
 
-            // name
-            QDomElement name = node.firstChildElement("name");
-            if (!name.isNull()) add.name = name.text();
-            else add.name = QString("Interval #%1").arg(++intervals);
-
-            QDomElement summary = node.firstChildElement("summarydata");
-            if (!summary.isNull()) {
-
-                // start
-                QDomElement beginning = summary.firstChildElement("beginning");
-                if (!beginning.isNull()) add.start = beginning.text().toDouble();
-                else add.start = -1;
-
-                // duration - convert to end
-                QDomElement duration = summary.firstChildElement("duration");
-                if (!duration.isNull() && add.start != -1)
-                    add.stop = duration.text().toDouble() + add.start;
-                else
-                    add.stop = -1;
-
-                // add interval
-                if (add.start != -1 && add.stop != -1) {
-                    rideFile->addInterval(add.start, add.stop, add.name);
-                }
+            // add interval
+            if (summary && add.start != -1 && add.stop != -1) {
+                rideFile->addInterval(add.start, add.stop, add.name);
             }
 
         // data points: offset, hr, spd, pwr, torq, cad, dist, lat, lon, alt, temp
-        } else if (node.nodeName() == "sample") {
+        } else if (node == "sample") {
             RideFilePoint add;
-
-            // offset (secs)
-            QDomElement off = node.firstChildElement("timeoffset");
-            if (!off.isNull()) add.secs = off.text().toDouble();
-            else add.secs = 0.0;
-            // hr
-            QDomElement hr = node.firstChildElement("hr");
-            if (!hr.isNull()) add.hr = hr.text().toDouble();
-            else add.hr = 0.0;
-            // spd in meters per second converted to kph
-            QDomElement spd = node.firstChildElement("spd");
-            if (!spd.isNull()) add.kph = spd.text().toDouble() * 3.6;
-            else add.kph = 0.0;
-            // pwr
-            QDomElement pwr = node.firstChildElement("pwr");
-            if (!pwr.isNull()) {
-                add.watts = pwr.text().toDouble();
-                // NOTE! undo the fudge to set zero values to
-                //       1 in the writer (below). This is to keep
-                //       the TP upload web-service happy with zero values
-                if (add.watts == 1) add.watts = 0.0;
-            } else add.watts = 0.0;
-            // torq
-            QDomElement torq = node.firstChildElement("torq");
-            if (!torq.isNull()) add.nm = torq.text().toDouble();
-            else add.nm = 0.0;
-            // cad
-            QDomElement cad = node.firstChildElement("cad");
-            if (!cad.isNull()) add.cad = cad.text().toDouble();
-            else add.cad = 0.0;
-            // dist
-            QDomElement dist = node.firstChildElement("dist");
-            if (!dist.isNull()) add.km = dist.text().toDouble() /1000;
-            else add.km = 0.0;
-
-            // lat
-            QDomElement lat = node.firstChildElement("lat");
-            if (!lat.isNull()) add.lat = lat.text().toDouble();
-            else add.lat = 0.0;
-            // lon
-            QDomElement lon = node.firstChildElement("lon");
-            if (!lon.isNull()) add.lon = lon.text().toDouble();
-            else add.lon = 0.0;
-            // alt
-            QDomElement alt = node.firstChildElement("alt");
-            if (!alt.isNull()) add.alt = alt.text().toDouble();
-            else add.alt = 0.0;
-            // temp
-            QDomElement temp = node.firstChildElement("temp");
-            if (!temp.isNull()) add.temp = temp.text().toDouble();
-            else add.temp = 0.0;
+            add.temp = 0.0;
+
+            while (xml.readNextStartElement()) {
+                QStringRef name = xml.name();
+
+                // offset (secs)
+                if (name == "timeoffset") add.secs = text(xml).toDouble();
+                // hr
+                else if (name == "hr") add.hr = text(xml).toDouble();
+                // spd in meters per second converted to kph
+                else if (name == "spd") add.kph = text(xml).toDouble() * 3.6;
+                // pwr
+                else if (name == "pwr") {
+                    add.watts = text(xml).toDouble();
+                    // NOTE! undo the fudge to set zero values to
+                    //       1 in the writer (below). This is to keep
+                    //       the TP upload web-service happy with zero values
+                    if (add.watts == 1) add.watts = 0.0;
+                }
+                // torq
+                else if (name == "torq") add.nm = text(xml).toDouble();
+                // cad
+                else if (name == "cad") add.cad = text(xml).toDouble();
+                // dist
+                else if (name == "dist") add.km = text(xml).toDouble() /1000;
+                // lat, lon, alt and temp
+                else if (name == "lat") add.lat = text(xml).toDouble();
+                else if (name == "lon") add.lon = text(xml).toDouble();
+                else if (name == "alt") add.alt = text(xml).toDouble();
+                else if (name == "temp") add.temp = text(xml).toDouble();
+                else xml.skipCurrentElement();
+            }
 
             // do we need to calculate distance?
             if (add.km == 0.0 && samples) {
@@ -243,13 +231,17 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList &errors) const
                     add.nm, add.watts, add.alt, add.lon, add.lat, add.headwind,
                     add.slope, add.temp, add.lrbalance, add.interval);
 
-
-        // ignored for now
-        } else if (node.nodeName() == "summarydata") {
-        } else if (node.nodeName() == "extension") {
+        // ignored for now, summarydata and extension amongst them
+        } else {
+            xml.skipCurrentElement();
         }
+    }
 
-        node = node.nextSibling();
+    // a broken file is still broken, even if we got some of it
+    if (xml.hasError()) {
+        errors << "Could not parse file.";
+        delete rideFile;
+        return NULL;
     }
 
     // post-process and check
@@ -303,197 +295,108 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList &errors) const
 bool
 PwxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file) const
 {
-    QDomText text; // used all over
-    QDomDocument doc;
-    QDomProcessingInstruction hdr = doc.createProcessingInstruction("xml","version=\"1.0\"");
-    doc.appendChild(hdr);
+    if (!file.open(QIODevice::WriteOnly)) return(false);
+    bool written = writePwx(context, ride, file);
+    file.close();
+    return(written);
+}
+
+// min max avg get set by TP anyway so we leave them
+// blank to save time on calculating them
+static void channel(QXmlStreamWriter &xml, const char *name)
+{
+    xml.writeStartElement(name);
+    xml.writeAttribute("max", "0");
+    xml.writeAttribute("min", "0");
+    xml.writeAttribute("avg", "0");
+    xml.writeEndElement();
+}
+
+// written out a sample at a time rather than building the whole document first
+bool
+PwxFileReader::writePwx(Context *context, const RideFile *ride, QIODevice &out) const
+{
+    QXmlStreamWriter xml(&out);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(4);
+    xml.writeStartDocument();
 
     // pwx
-    QDomElement pwx = doc.createElementNS("http://www.peaksware.com/PWX/1/0", "pwx");
-    pwx.setAttribute("creator", "Golden Cheetah");
-    pwx.setAttribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
-    pwx.setAttribute("xmlns:xsd", "http://www.w3.org/2001/XMLSchema");
-    pwx.setAttribute("xsi:schemaLocation", "http://www.peaksware.com/PWX/1/0 http://www.peaksware.com/PWX/1/0/pwx.xsd");
-    pwx.setAttribute("version", "1.0");
-    doc.appendChild(pwx);
+    xml.writeDefaultNamespace("http://www.peaksware.com/PWX/1/0");
+    xml.writeStartElement("pwx");
+    xml.writeAttribute("creator", "Golden Cheetah");
+    xml.writeAttribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
+    xml.writeAttribute("xmlns:xsd", "http://www.w3.org/2001/XMLSchema");
+    xml.writeAttribute("xsi:schemaLocation", "http://www.peaksware.com/PWX/1/0 http://www.peaksware.com/PWX/1/0/pwx.xsd");
+    xml.writeAttribute("version", "1.0");
 
     // workouts... we just serialise 1 at a time
-    QDomElement root = doc.createElement("workout");
-    pwx.appendChild(root);
+    xml.writeStartElement("workout");
 
     // athlete details
-    QDomElement athlete = doc.createElement("athlete");
-    QDomElement name = doc.createElement("name");
-    text = doc.createTextNode(context->athlete->cyclist); name.appendChild(text);
-    athlete.appendChild(name);
+    xml.writeStartElement("athlete");
+    xml.writeTextElement("name", context->athlete->cyclist);
     double cyclistweight = ride->getTag("Weight", "0.0").toDouble();
-    if (cyclistweight) {
-        QDomElement weight = doc.createElement("weight");
-        text = doc.createTextNode(QString("%1").arg(cyclistweight));
-        weight.appendChild(text);
-        athlete.appendChild(weight);
-    }
-    root.appendChild(athlete);
+    if (cyclistweight) xml.writeTextElement("weight", QString("%1").arg(cyclistweight));
+    xml.writeEndElement();
 
     // sport
     QString sport = ride->getTag("Sport", "Bike");
     if (sport == QObject::tr("Biking") || sport == QObject::tr("Cycling") || sport == QObject::tr("Cycle") || sport == QObject::tr("Bike")) {
         sport = "Bike";
     }
-    QDomElement sportType = doc.createElement("sportType");
-    text = doc.createTextNode(sport); 
-    sportType.appendChild(text);
-    root.appendChild(sportType);
+    xml.writeTextElement("sportType", sport);
 
     // notes
-    if (ride->getTag("Notes","") != "") {
-        QDomElement notes = doc.createElement("cmt");
-        text = doc.createTextNode(ride->getTag("Notes","")); notes.appendChild(text);
-        root.appendChild(notes);
-    }
-    
-    
+    if (ride->getTag("Notes","") != "") xml.writeTextElement("cmt", ride->getTag("Notes",""));
+
     // workout code
-    if (ride->getTag("Workout Code", "") != "") {
-        QString wcode = ride->getTag("Workout Code", "");
-        QDomElement code = doc.createElement("code");
-        text = doc.createTextNode(wcode); code.appendChild(text);
-        root.appendChild(code);
-    }
+    if (ride->getTag("Workout Code", "") != "") xml.writeTextElement("code", ride->getTag("Workout Code", ""));
 
     // goal
-    if (ride->getTag("Objective", "") != "") {
-        QString obj = ride->getTag("Objective", "");
-        QDomElement goal = doc.createElement("goal");
-        text = doc.createTextNode(obj); goal.appendChild(text);
-        root.appendChild(goal);
-    }
+    if (ride->getTag("Objective", "") != "") xml.writeTextElement("goal", ride->getTag("Objective", ""));
 
     // device type 
     if (ride->deviceType() != "") { 
-
-        QDomElement device = doc.createElement("device"); 
-        device.setAttribute("id", ride->deviceType());
-
-        QDomElement make = doc.createElement("make"); 
-        text = doc.createTextNode("Golden Cheetah"); 
-        make.appendChild(text); 
-        device.appendChild(make);
-
-        QDomElement model = doc.createElement("model"); 
-        text = doc.createTextNode(ride->deviceType());
-        model.appendChild(text); 
-        device.appendChild(model);
-
-        root.appendChild(device); 
+        xml.writeStartElement("device");
+        xml.writeAttribute("id", ride->deviceType());
+        xml.writeTextElement("make", "Golden Cheetah");
+        xml.writeTextElement("model", ride->deviceType());
+        xml.writeEndElement();
     }
     
     // time
-    QDomElement time = doc.createElement("time");
-    text = doc.createTextNode(ride->startTime().toString(Qt::ISODate));
-    time.appendChild(text);
-    root.appendChild(time);
+    xml.writeTextElement("time", ride->startTime().toString(Qt::ISODate));
 
     // summary data
-    QDomElement summarydata = doc.createElement("summarydata");
-    root.appendChild(summarydata);
-    QDomElement beginning = doc.createElement("beginning");
-    text = doc.createTextNode(QString("%1").arg(ride->dataPoints().empty()
+    xml.writeStartElement("summarydata");
+    xml.writeTextElement("beginning", QString("%1").arg(ride->dataPoints().empty()
         ? 0 : ride->dataPoints().first()->secs));
-    beginning.appendChild(text);
-    summarydata.appendChild(beginning);
-
-    QDomElement duration = doc.createElement("duration");
-    text = doc.createTextNode(QString("%1").arg(ride->dataPoints().empty()
+    xml.writeTextElement("duration", QString("%1").arg(ride->dataPoints().empty()
         ? 0 : ride->dataPoints().last()->secs));
-    duration.appendChild(text);
-    summarydata.appendChild(duration);
-
-    // the channels - min max avg get set by TP anyway
-    // so we leave them blank to save time on calculating them
-    if (ride->areDataPresent()->hr) {
-        QDomElement s = doc.createElement("hr");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }
-    if (ride->areDataPresent()->kph) {
-        QDomElement s = doc.createElement("spd");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }
-    if (ride->areDataPresent()->watts) {
-        QDomElement s = doc.createElement("pwr");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }
-    if (ride->areDataPresent()->nm) {
-        QDomElement s = doc.createElement("torq");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }
-    if (ride->areDataPresent()->cad) {
-        QDomElement s = doc.createElement("cad");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }
-    QDomElement dist = doc.createElement("dist");
-    text = doc.createTextNode(QString("%1")
+
+    // the channels
+    if (ride->areDataPresent()->hr) channel(xml, "hr");
+    if (ride->areDataPresent()->kph) channel(xml, "spd");
+    if (ride->areDataPresent()->watts) channel(xml, "pwr");
+    if (ride->areDataPresent()->nm) channel(xml, "torq");
+    if (ride->areDataPresent()->cad) channel(xml, "cad");
+    xml.writeTextElement("dist", QString("%1")
         .arg((int)(ride->dataPoints().empty() ? 0
             : ride->dataPoints().last()->km * 1000)));
-    dist.appendChild(text);
-    summarydata.appendChild(dist);
-
-    if (ride->areDataPresent()->alt) {
-        QDomElement s = doc.createElement("alt");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }
-
-    if (ride->areDataPresent()->temp) {
-        QDomElement s = doc.createElement("temp");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }
+    if (ride->areDataPresent()->alt) channel(xml, "alt");
+    if (ride->areDataPresent()->temp) channel(xml, "temp");
+    xml.writeEndElement();
 
     // interval "segments"
     foreach (RideFileInterval i, ride->intervals()) {
-        QDomElement segment = doc.createElement("segment");
-        root.appendChild(segment);
-
-        // name
-        QDomElement name = doc.createElement("name");
-        text = doc.createTextNode(i.name); name.appendChild(text);
-        segment.appendChild(name);
-
-        // summarydata
-        QDomElement summarydata = doc.createElement("summarydata");
-        segment.appendChild(summarydata);
-
-        // beginning
-        QDomElement beginning = doc.createElement("beginning");
-        text = doc.createTextNode(QString("%1").arg(i.start));
-        beginning.appendChild(text);
-        summarydata.appendChild(beginning);
-
-        // duration
-        QDomElement duration = doc.createElement("duration");
-        text = doc.createTextNode(QString("%1").arg(i.stop - i.start));
-        duration.appendChild(text);
-        summarydata.appendChild(duration);
+        xml.writeStartElement("segment");
+        xml.writeTextElement("name", i.name);
+        xml.writeStartElement("summarydata");
+        xml.writeTextElement("beginning", QString("%1").arg(i.start));
+        xml.writeTextElement("duration", QString("%1").arg(i.stop - i.start));
+        xml.writeEndElement();
+        xml.writeEndElement();
     }
 
     // samples
@@ -504,39 +407,24 @@ PwxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file
         foreach (const RideFilePoint *point, ride->dataPoints()) {
             // if there was a gap, log time when this sample started:
             if( secs + ride->recIntSecs() < point->secs ){
-                QDomElement sample = doc.createElement("sample");
-                root.appendChild(sample);
-
-                QDomElement timeoffset = doc.createElement("timeoffset");
-                text = doc.createTextNode(QString("%1")
-                    .arg(point->secs - ride->recIntSecs() ));
-                timeoffset.appendChild(text);
-                sample.appendChild(timeoffset);
+                xml.writeStartElement("sample");
+                xml.writeTextElement("timeoffset", QString("%1").arg(point->secs - ride->recIntSecs() ));
+                xml.writeEndElement();
             }
 
-            QDomElement sample = doc.createElement("sample");
-            root.appendChild(sample);
+            xml.writeStartElement("sample");
 
             // time
-            QDomElement timeoffset = doc.createElement("timeoffset");
-            text = doc.createTextNode(QString("%1").arg(point->secs));
-            timeoffset.appendChild(text);
-            sample.appendChild(timeoffset);
+            xml.writeTextElement("timeoffset", QString("%1").arg(point->secs));
 
             // hr
-            if (ride->areDataPresent()->hr) {
-                QDomElement hr = doc.createElement("hr");
-                text = doc.createTextNode(QString("%1").arg((int)point->hr));
-                hr.appendChild(text);
-                sample.appendChild(hr);
-            }
+            if (ride->areDataPresent()->hr)
+                xml.writeTextElement("hr", QString("%1").arg((int)point->hr));
+
             // spd - meters per second
-            if (ride->areDataPresent()->kph) {
-                QDomElement spd = doc.createElement("spd");
-                text = doc.createTextNode(QString("%1").arg(point->kph / 3.6));
-                spd.appendChild(text);
-                sample.appendChild(spd);
-            }
+            if (ride->areDataPresent()->kph)
+                xml.writeTextElement("spd", QString("%1").arg(point->kph / 3.6));
+
             // pwr
             if (ride->areDataPresent()->watts) {
                 // TrainingPeaks.com file upload rejects rides
@@ -545,69 +433,39 @@ PwxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file
                 // we set 0 to 1 to at least get an upload
                 // and do the reverse in the reader above
                 int watts = point->watts ? point->watts : 1;
-                QDomElement pwr = doc.createElement("pwr");
-                text = doc.createTextNode(QString("%1").arg(watts));
-                pwr.appendChild(text);
-                sample.appendChild(pwr);
+                xml.writeTextElement("pwr", QString("%1").arg(watts));
             }
             // torq
-            if (ride->areDataPresent()->nm) {
-                QDomElement torq = doc.createElement("torq");
-                text = doc.createTextNode(QString("%1").arg(point->nm));
-                torq.appendChild(text);
-                sample.appendChild(torq);
-            }
+            if (ride->areDataPresent()->nm)
+                xml.writeTextElement("torq", QString("%1").arg(point->nm));
+
             // cad
-            if (ride->areDataPresent()->cad) {
-                QDomElement cad = doc.createElement("cad");
-                text = doc.createTextNode(QString("%1").arg((int)(point->cad)));
-                cad.appendChild(text);
-                sample.appendChild(cad);
-            }
+            if (ride->areDataPresent()->cad)
+                xml.writeTextElement("cad", QString("%1").arg((int)(point->cad)));
 
             // distance - meters
-            QDomElement dist = doc.createElement("dist");
-            text = doc.createTextNode(QString("%1").arg((point->km*1000)));
-            dist.appendChild(text);
-            sample.appendChild(dist);
-
+            xml.writeTextElement("dist", QString("%1").arg((point->km*1000)));
 
             // lat
-            if (ride->areDataPresent()->lat && point->lat > -90.0 && point->lat < 90.0) {
-                QDomElement lat = doc.createElement("lat");
-                text = doc.createTextNode(QString("%1").arg(point->lat));
-                lat.appendChild(text);
-                sample.appendChild(lat);
-            }
+            if (ride->areDataPresent()->lat && point->lat > -90.0 && point->lat < 90.0)
+                xml.writeTextElement("lat", QString("%1").arg(point->lat));
+
             // lon
-            if (ride->areDataPresent()->lon && point->lon > -180.00 && point->lon < 180.00) {
-                QDomElement lon = doc.createElement("lon");
-                text = doc.createTextNode(QString("%1").arg(point->lon));
-                lon.appendChild(text);
-                sample.appendChild(lon);
-            }
+            if (ride->areDataPresent()->lon && point->lon > -180.00 && point->lon < 180.00)
+                xml.writeTextElement("lon", QString("%1").arg(point->lon));
 
             // alt
-            if (ride->areDataPresent()->alt) {
-                QDomElement alt = doc.createElement("alt");
-                text = doc.createTextNode(QString("%1").arg(point->alt));
-                alt.appendChild(text);
-                sample.appendChild(alt);
-            }
+            if (ride->areDataPresent()->alt)
+                xml.writeTextElement("alt", QString("%1").arg(point->alt));
 
             // temp
-            if (ride->areDataPresent()->temp) {
-                QDomElement temp = doc.createElement("temp");
-                text = doc.createTextNode(QString("%1").arg(point->temp));
-                temp.appendChild(text);
-                sample.appendChild(temp);
-            }
+            if (ride->areDataPresent()->temp)
+                xml.writeTextElement("temp", QString("%1").arg(point->temp));
+
+            xml.writeEndElement();
         }
     }
 
-    QByteArray xml = doc.toByteArray(4);
-    if (!file.open(QIODevice::WriteOnly)) return(false);
-    if (file.write(xml) != xml.size()) return(false);
-    file.close();
-    return(true);
+    xml.writeEndDocument(); // closes the workout and pwx
+    return !xml.hasError();
 }
@@ -22,13 +22,22 @@
 
 #include "RideFile.h"
 #include "Context.h"
-#include <QDomDocument>
+#include <QIODevice>
 
+class QXmlStreamReader;
+
+// read and written as a stream, the samples go straight into or
+// out of the ride so there's never a document of them all in memory
 struct PwxFileReader : public RideFileReader {
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const; 
     bool writeRideFile(Context *, const RideFile *ride, QFile &file) const;
-    virtual RideFile *PwxFromDomDoc(QDomDocument doc, QStringList &errors) const;
     bool hasWrite() const { return true; }
+
+    // as downloaded and uploaded, without going through a file
+    RideFile *PwxFromXml(const QByteArray &pwx, QStringList &errors) const;
+    bool writePwx(Context *, const RideFile *ride, QIODevice &out) const; // out is open for writing
+
+    RideFile *PwxFromStream(QXmlStreamReader &xml, QStringList &errors) const;
 };
 
 #endif // _PwxRideFile_h
@@ -18,6 +18,8 @@
 
 #include "QuarqRideFile.h"
 #include "QuarqParser.h"
+#include "ANTMessage.h"
+#include "Settings.h"
 #include <iostream>
 #include <assert.h>
 
@@ -44,8 +46,8 @@ QProcess *getInterpreterProcess( QString path ) {
    interpretation code lives in a closed source binary. It takes the
    log on stdin and writes XML to stdout.
 
-   If the binary is not available, no Quarq ANT+ capability is shown
-   in the menu, nor are any ANT+ files opened.
+   It is now only used for logs the decoder below can't read, so if
+   the binary is not available those are the only ones not opened.
 
    QProcess note:
 
@@ -102,19 +104,329 @@ bool quarqInterpreterInstalled( void ) {
     return installed;
 }
 
-static int antFileReaderRegistered = quarqInterpreterInstalled()
-    ? RideFileFactory::instance().registerReader(
-        "qla", "Quarq ANT+ Files", new QuarqFileReader())
-    : 0;
+/*
+   The log itself is the ANT+ messages the Qollector received, one
+   per line as a timestamp in seconds followed by the message bytes in
+   hex, sync byte first. We decode that here with ANTMessage, as train
+   mode does for a live stick, and only fall back to the interpreter for
+   logs we can't make sense of. Telemetry is sampled-and-held once a
+   second, as the interpreter's output was.
+ */
+
+class QuarqAntLog
+{
+    public:
+        QuarqAntLog(RideFile *rideFile);
+
+        // false if nothing was decoded
+        bool decode(QIODevice &log);
+
+    private:
+        void message(double time, const unsigned char *bytes);
+        void broadcast(const ANTMessage &m);
+        void sample(double time);
+
+        // what we need to remember about each channel to
+        // work out the values from the cumulative counts
+        struct Channel {
+            Channel() : type(ANTChannel::CHANNEL_TYPE_UNUSED), nullCount(0), stdNullCount(0), dualNullCount(0) {}
+
+            int type;
+            ANTMessage last, lastStd;
+            int nullCount, stdNullCount, dualNullCount;
+        };
+
+        RideFile *rideFile;
+        Channel channels[ANT_MAX_CHANNELS];
+        double initial, next;
+        double watts, cad, hr, kph, km;
+        double wheelSize; // metres
+        int decoded;
+};
+
+QuarqAntLog::QuarqAntLog(RideFile *rideFile)
+    : rideFile(rideFile), initial(-1), next(0),
+      watts(0), cad(0), hr(0), kph(0), km(0), decoded(0)
+{
+    wheelSize = appsettings->value(NULL, GC_WHEELSIZE, 2100).toInt() / 1000.0;
+}
+
+bool
+QuarqAntLog::decode(QIODevice &log)
+{
+    while (!log.atEnd()) {
+
+        QStringList tokens = QString(log.readLine()).simplified().split(' ', QString::SkipEmptyParts);
+        if (tokens.count() < 2) continue;
+
+        bool ok;
+        double time = tokens.takeFirst().toDouble(&ok);
+        if (!ok) continue;
+
+        // there may be more than one message, anything
+        // that doesn't checksum is skipped
+        QByteArray bytes = QByteArray::fromHex(tokens.join("").toLatin1());
+        const unsigned char *b = (const unsigned char *) bytes.constData();
+        for (int i=0; i+4 <= bytes.size(); ) {
+
+            int total = b[i+1] + 4; // sync, length, id, payload, checksum
+            if (b[i] != ANT_SYNC_BYTE || total-1 > ANT_MAX_MESSAGE_SIZE || i+total > bytes.size()) {
+                i++;
+                continue;
+            }
+
+            unsigned char crc = 0;
+            for (int k=0; k<total-1; k++) crc ^= b[i+k];
+            if (crc != b[i+total-1]) {
+                i++;
+                continue;
+            }
+
+            // decoding reads a whole message's worth
+            unsigned char msg[ANT_MAX_MESSAGE_SIZE+1];
+            memset(msg, 0, sizeof(msg));
+            memcpy(msg, b+i, total);
+            message(time, msg);
+            i += total;
+        }
+    }
+
+    // flush one last data point
+    if (decoded) rideFile->appendPoint(next, cad, hr, km, kph, 0, watts, 0, 0.0, 0.0, 0.0, 0.0, RideFile::noTemp, 0.0, 0);
+
+    return decoded > 0;
+}
+
+void
+QuarqAntLog::message(double time, const unsigned char *bytes)
+{
+    if (bytes[3] >= ANT_MAX_CHANNELS) return;
+    Channel &channel = channels[bytes[3]];
+
+    switch (bytes[2]) {
+
+    // tells us what is on the channel
+    case ANT_CHANNEL_ID:
+    {
+        ANTMessage m(ANTChannel::CHANNEL_TYPE_UNUSED, bytes);
+
+        channel.type = ANTChannel::CHANNEL_TYPE_UNUSED;
+        if (m.deviceType == ANT_QUARQ_TYPE) channel.type = ANTChannel::CHANNEL_TYPE_QUARQ;
+        for (const ant_sensor_type_t *st=ANT::ant_sensor_types; st->suffix; st++)
+            if (st->device_id && st->device_id == m.deviceType) channel.type = st->type;
+    }
+    break;
+
+    case ANT_BROADCAST_DATA:
+        if (channel.type == ANTChannel::CHANNEL_TYPE_UNUSED) break;
+        sample(time);
+        broadcast(ANTMessage(channel.type, bytes));
+        decoded++;
+        break;
+
+    default:
+        break;
+    }
+}
+
+// the same sums as ANTChannel::broadcastEvent, the counts since the
+// last message give the values and long enough without any change
+// means the sensor has stopped
+void
+QuarqAntLog::broadcast(const ANTMessage &m)
+{
+    Channel &c = channels[m.channel];
+    const ANTMessage &last = c.last;
+
+    switch (c.type) {
+
+    case ANTChannel::CHANNEL_TYPE_POWER:
+    case ANTChannel::CHANNEL_TYPE_QUARQ:
+    case ANTChannel::CHANNEL_TYPE_FAST_QUARQ:
+    case ANTChannel::CHANNEL_TYPE_FAST_QUARQ_NEW:
+
+        switch (m.data_page) {
+
+        // interleaved with the others so has its own last message
+        case ANT_STANDARD_POWER:
+        {
+            uint8_t events = m.eventCount - c.lastStd.eventCount;
+            if (c.lastStd.type && events) {
+                c.stdNullCount = 0;
+                watts = m.instantPower;
+                cad = m.instantCadence;
+            } else if (++c.stdNullCount >= 6) {
+                watts = cad = 0;
+            }
+            c.lastStd = m;
+        }
+        return;
+
+        case ANT_CRANKTORQUE_POWER:
+        {
+            uint8_t events = m.eventCount - last.eventCount;
+            uint16_t period = m.period - last.period;
+            uint16_t torque = m.torque - last.torque;
+
+            if (events && period && last.period) {
+                c.nullCount = 0;
+                double nm_torque = torque / (32.0 * events);
+                cad = 2048.0 * 60.0 * events / period;
+                watts = 3.14159 * nm_torque * cad / 30;
+            } else if (++c.nullCount >= 4) {
+                watts = cad = 0;
+            }
+        }
+        break;
+
+        case ANT_WHEELTORQUE_POWER:
+        {
+            uint8_t events = m.eventCount - last.eventCount;
+            uint16_t period = m.period - last.period;
+            uint16_t torque = m.torque - last.torque;
+
+            if (events && period) {
+                c.nullCount = 0;
+                double nm_torque = torque / (32.0 * events);
+                double wheelRPM = 2048.0 * 60.0 * events / period;
+                watts = 3.14159 * nm_torque * wheelRPM / 30;
+                kph = wheelRPM * wheelSize * 60 / 1000;
+            } else if (++c.nullCount >= 4) {
+                watts = kph = 0;
+            }
+        }
+        break;
+
+        case ANT_CRANKSRM_POWER:
+        {
+            uint16_t period = m.period - last.period;
+            uint16_t torque = m.torque - last.torque;
+            double time = period / 2000.0;
+
+            if (time && m.slope && period) {
+                c.nullCount = 0;
+                double torque_freq = torque / time - 420/*srm_offset*/;
+                double nm_torque = 10.0 * torque_freq / m.slope;
+                double cadence = 2000.0 * 60 * (uint8_t)(m.eventCount - last.eventCount) / period;
+                double power = 3.14159 * nm_torque * cadence / 30;
+
+                // ignore the occassional spikes (reed switch)
+                if (power >= 0 && power < 2501 && cadence >=0 && cadence < 256) {
+                    watts = power;
+                    cad = cadence;
+                }
+            } else if (++c.nullCount >= 4) {
+                watts = cad = 0;
+            }
+        }
+        break;
+
+        default: // calibration etc
+            return;
+        }
+        break;
+
+    case ANTChannel::CHANNEL_TYPE_HR:
+        if ((uint16_t)(m.measurementTime - last.measurementTime)) {
+            c.nullCount = 0;
+            hr = m.instantHeartrate;
+        } else if (++c.nullCount >= 12) {
+            hr = 0;
+        }
+        break;
+
+    case ANTChannel::CHANNEL_TYPE_CADENCE:
+    case ANTChannel::CHANNEL_TYPE_SandC:
+    {
+        uint16_t time = m.crankMeasurementTime - last.crankMeasurementTime;
+        uint16_t revs = m.crankRevolutions - last.crankRevolutions;
+        if (time) {
+            c.nullCount = 0;
+            cad = 1024.0 * 60 * revs / time;
+        } else if (++c.nullCount >= 12) {
+            cad = 0;
+        }
+        if (c.type == ANTChannel::CHANNEL_TYPE_CADENCE) break;
+    }
+    // fall through for the speed of speed and cadence
+
+    case ANTChannel::CHANNEL_TYPE_SPEED:
+    {
+        int &nullCount = c.type == ANTChannel::CHANNEL_TYPE_SPEED ? c.nullCount : c.dualNullCount;
+        uint16_t time = m.wheelMeasurementTime - last.wheelMeasurementTime;
+        uint16_t revs = m.wheelRevolutions - last.wheelRevolutions;
+        if (time) {
+            nullCount = 0;
+            kph = 1024.0 * 60 * revs / time * wheelSize * 60 / 1000;
+        } else if (++nullCount >= 12) {
+            kph = 0;
+        }
+    }
+    break;
+
+    default:
+        break;
+    }
+
+    c.last = m;
+}
+
+// sample-and-hold up to the time of the next message
+void
+QuarqAntLog::sample(double time)
+{
+    if (initial < 0) initial = time;
+
+    while (time - initial > next) {
+        rideFile->appendPoint(next, cad, hr, km, kph, 0, watts, 0, 0.0, 0.0, 0.0, 0.0, RideFile::noTemp, 0.0, 0);
+        km += kph / 3600.0;
+        next += 1.0;
+    }
+}
+
+static int antFileReaderRegistered = RideFileFactory::instance().registerReader(
+        "qla", "Quarq ANT+ Files", makeRideFileReader<QuarqFileReader>, false);
 
 RideFile *QuarqFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
 {
-    (void) errors;
     RideFile *rideFile = new RideFile();
     rideFile->setDeviceType("Quarq Qollector");
     rideFile->setFileFormat("Quarq ANT+ Files (qla)");
     rideFile->setRecIntSecs(1.0);
 
+    QRegExp rideTime("^.*/(\\d\\d\\d\\d)_(\\d\\d)_(\\d\\d)_"
+                     "(\\d\\d)_(\\d\\d)_(\\d\\d)\\.qla$");
+    if (rideTime.indexIn(file.fileName()) >= 0) {
+        QDateTime datetime(QDate(rideTime.cap(1).toInt(),
+                                 rideTime.cap(2).toInt(),
+                                 rideTime.cap(3).toInt()),
+                           QTime(rideTime.cap(4).toInt(),
+                                 rideTime.cap(5).toInt(),
+                                 rideTime.cap(6).toInt()));
+        rideFile->setStartTime(datetime);
+    }
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        errors << ("Could not open ride file: \"" + file.fileName() + "\"");
+        delete rideFile;
+        return NULL;
+    }
+
+    QuarqAntLog log(rideFile);
+    if (log.decode(file)) {
+        file.close();
+        return rideFile;
+    }
+
+    // not one we understand, so see if the interpreter does
+    if (!quarqInterpreterInstalled()) {
+        errors << ("No ANT+ data found in: \"" + file.fileName() + "\"");
+        file.close();
+        delete rideFile;
+        return NULL;
+    }
+    file.reset();
+
     QuarqParser handler(rideFile);
 
     QProcess *antProcess = getInterpreterProcess( installed_path );
@@ -126,7 +438,6 @@ RideFile *QuarqFileReader::openRideFile(QFile &file, QStringList &errors, QList<
     reader.setContentHandler (&handler);
 
     // this could done be a loop to "save memory."
-    file.open(QIODevice::ReadOnly);
     antProcess->write(file.readAll());
     antProcess->closeWriteChannel();
     antProcess->waitForFinished(-1);
@@ -138,18 +449,6 @@ RideFile *QuarqFileReader::openRideFile(QFile &file, QStringList &errors, QList<
 
     reader.parseContinue();
 
-    QRegExp rideTime("^.*/(\\d\\d\\d\\d)_(\\d\\d)_(\\d\\d)_"
-                     "(\\d\\d)_(\\d\\d)_(\\d\\d)\\.qla$");
-    if (rideTime.indexIn(file.fileName()) >= 0) {
-        QDateTime datetime(QDate(rideTime.cap(1).toInt(),
-                                 rideTime.cap(2).toInt(),
-                                 rideTime.cap(3).toInt()),
-                           QTime(rideTime.cap(4).toInt(),
-                                 rideTime.cap(5).toInt(),
-                                 rideTime.cap(6).toInt()));
-        rideFile->setStartTime(datetime);
-    }
-
     delete antProcess;
 
     return rideFile;
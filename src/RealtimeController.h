@@ -25,6 +25,9 @@
 #define _GC_RealtimeController_h 1
 #include "GoldenCheetah.h"
 
+class SessionRecorder;
+class DeviceStats;
+
 #define DEVICE_ERROR 1
 #define DEVICE_OK 0
 
@@ -61,6 +64,13 @@ public:
     virtual void setGradient(double) { return; }
     virtual void setMode(int) { return; }
 
+    // raw samples go to the recorder as they arrive, device is
+    // our index in the sidebar, NULL to stop recording
+    virtual void setRecorder(SessionRecorder *, int) { return; }
+
+    // message timings kept by the device thread, NULL if it has none
+    virtual DeviceStats *stats() { return NULL; }
+
     // post process, based upon device configuration
     void processRealtimeData(RealtimeData &rtData);
     void processSetup();
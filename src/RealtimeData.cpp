@@ -24,11 +24,12 @@
 RealtimeData::RealtimeData()
 {
     name[0] = '\0';
-	hr= watts= altWatts= speed= wheelRpm= load= slope = 0.0;
-	cadence = distance = virtualSpeed = 0.0;
-	lap = msecs = lapMsecs = lapMsecsRemaining = 0;
+    for (int i=0; i<SeriesCount; i++) values[i] = 0;
+    wheelRpm = slope = 0.0;
+    sequence = 0;
 
-    memset(spinScan, 0, 24);
+    memset(spinScan, 0, SPINSCAN_BINS);
+    spinScanRevCount = 0;
 }
 
 void RealtimeData::setName(char *name)
@@ -37,23 +38,23 @@ void RealtimeData::setName(char *name)
 }
 void RealtimeData::setAltWatts(double watts)
 {
-    this->altWatts = (int)watts;
+    values[AltWatts] = (int)watts;
 }
 void RealtimeData::setWatts(double watts)
 {
-    this->watts = (int)watts;
+    values[Watts] = (int)watts;
 }
 void RealtimeData::setHr(double hr)
 {
-    this->hr = (int)hr;
+    values[HeartRate] = (int)hr;
 }
 void RealtimeData::setSpeed(double speed)
 {
-    this->speed = speed;
+    values[Speed] = speed;
 }
 void RealtimeData::setVirtualSpeed(double speed)
 {
-    this->virtualSpeed = speed;
+    values[VirtualSpeed] = speed;
 }
 void RealtimeData::setWheelRpm(double wheelRpm)
 {
@@ -61,7 +62,7 @@ void RealtimeData::setWheelRpm(double wheelRpm)
 }
 void RealtimeData::setCadence(double aCadence)
 {
-    cadence = (int)aCadence;
+    values[Cadence] = (int)aCadence;
 }
 void RealtimeData::setSlope(double slope)
 {
@@ -69,24 +70,68 @@ void RealtimeData::setSlope(double slope)
 }
 void RealtimeData::setLoad(double load)
 {
-    this->load = load;
+    values[Load] = load;
 }
 void RealtimeData::setMsecs(long x)
 {
-    this->msecs = x;
+    values[Time] = x;
 }
 void RealtimeData::setLapMsecs(long x)
 {
-    this->lapMsecs = x;
+    values[LapTime] = x;
 }
 void RealtimeData::setLapMsecsRemaining(long x)
 {
-    this->lapMsecsRemaining = x;
+    values[LapTimeRemaining] = x;
 }
 
 void RealtimeData::setDistance(double x)
 {
-    this->distance = x;
+    values[Distance] = x;
+}
+void RealtimeData::setNP(double x)
+{
+    values[NP] = x;
+}
+void RealtimeData::setIF(double x)
+{
+    values[IF] = x;
+}
+void RealtimeData::setTSS(double x)
+{
+    values[TSS] = x;
+}
+void RealtimeData::setVI(double x)
+{
+    values[VI] = x;
+}
+void RealtimeData::setXPower(double x)
+{
+    values[XPower] = x;
+}
+void RealtimeData::setRI(double x)
+{
+    values[RI] = x;
+}
+void RealtimeData::setBikeScore(double x)
+{
+    values[BikeScore] = x;
+}
+void RealtimeData::setSkibaVI(double x)
+{
+    values[SkibaVI] = x;
+}
+void RealtimeData::setJoules(double x)
+{
+    values[Joules] = x;
+}
+void RealtimeData::setWbal(double x)
+{
+    values[WPrimeBal] = x;
+}
+void RealtimeData::setAverage(DataSeries series, double x)
+{
+    if (series >= AvgWatts && series <= AvgHeartRateLap) values[series] = x;
 }
 const char *
 RealtimeData::getName() const
@@ -95,23 +140,23 @@ RealtimeData::getName() const
 }
 double RealtimeData::getAltWatts() const
 {
-    return altWatts;
+    return values[AltWatts];
 }
 double RealtimeData::getWatts() const
 {
-    return watts;
+    return values[Watts];
 }
 double RealtimeData::getHr() const
 {
-    return hr;
+    return values[HeartRate];
 }
 double RealtimeData::getSpeed() const
 {
-    return speed;
+    return values[Speed];
 }
 double RealtimeData::getVirtualSpeed() const
 {
-    return virtualSpeed;
+    return values[VirtualSpeed];
 }
 double RealtimeData::getWheelRpm() const
 {
@@ -119,7 +164,7 @@ double RealtimeData::getWheelRpm() const
 }
 double RealtimeData::getCadence() const
 {
-    return cadence;
+    return values[Cadence];
 }
 double RealtimeData::getSlope() const
 {
@@ -127,67 +172,26 @@ double RealtimeData::getSlope() const
 }
 double RealtimeData::getLoad() const
 {
-    return load;
+    return values[Load];
 }
 long RealtimeData::getMsecs() const
 {
-    return msecs;
+    return values[Time];
 }
 long RealtimeData::getLapMsecs() const
 {
-    return lapMsecs;
+    return values[LapTime];
 }
 double RealtimeData::getDistance() const
 {
-    return distance;
+    return values[Distance];
 }
 
 double RealtimeData::value(DataSeries series) const
 {
-    switch (series) {
-
-    case Time: return msecs;
-        break;
-
-    case Lap: return lap;
-        break;
-
-    case LapTime: return lapMsecs;
-        break;
-
-    case LapTimeRemaining: return lapMsecsRemaining;
-        break;
-
-    case Distance: return distance;
-        break;
-
-    case AltWatts: return altWatts;
-        break;
-
-    case Watts: return watts;
-        break;
-
-    case Speed: return speed;
-        break;
-
-    case VirtualSpeed: return virtualSpeed;
-        break;
-
-    case Cadence: return cadence;
-        break;
-
-    case HeartRate: return hr;
-        break;
-
-    case Load: return load;
-        break;
-
-    case None: 
-    default:
-        return 0;
-        break;
-
-    }
+    // the averages and balance are set by RealtimeMetrics
+    if (series <= None || series >= SeriesCount) return 0;
+    return values[series];
 }
 
 // provide a list of data series
@@ -229,6 +233,7 @@ const QList<RealtimeData::DataSeries> &RealtimeData::listDataSeries()
         seriesList << AltWatts;
         seriesList << LRBalance;
         seriesList << LapTimeRemaining;
+        seriesList << WPrimeBal;
     }
     return seriesList;
 }
@@ -330,15 +335,18 @@ QString RealtimeData::seriesName(DataSeries series)
 
     case LRBalance: return tr("Left/Right Balance");
         break;
+
+    case WPrimeBal: return tr("W' Balance");
+        break;
     }
 }
 
 void RealtimeData::setLap(long lap)
 {
-    this->lap = lap;
+    values[Lap] = lap;
 }
 
 long RealtimeData::getLap() const
 {
-    return lap;
+    return values[Lap];
 }
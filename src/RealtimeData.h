@@ -22,7 +22,9 @@
 #include "GoldenCheetah.h"
 
 #include <stdint.h> // uint8_t
+#include "SpinScan.h"
 #include <QString>
+#include <QtGlobal> // quint32
 #include <QApplication>
 
 class RealtimeData
@@ -40,9 +42,10 @@ public:
                       NP, TSS, IF, VI,
                       AvgWatts, AvgSpeed, AvgCadence, AvgHeartRate,
                       AvgWattsLap, AvgSpeedLap, AvgCadenceLap, AvgHeartRateLap,
-                      VirtualSpeed, AltWatts, LRBalance, LapTimeRemaining };
+                      VirtualSpeed, AltWatts, LRBalance, LapTimeRemaining, WPrimeBal };
 
     typedef enum dataseries DataSeries;
+    enum { SeriesCount = WPrimeBal + 1 };
     double value(DataSeries) const;
     static QString seriesName(DataSeries);
     static const QList<DataSeries> &listDataSeries();
@@ -65,9 +68,19 @@ public:
     void setLapMsecs(long);
     void setLapMsecsRemaining(long);
     void setDistance(double);
-    void setBikeScore(long);
-    void setJoules(long);
-    void setXPower(long);
+
+    // streaming metrics, see RealtimeMetrics
+    void setNP(double);
+    void setIF(double);
+    void setTSS(double);
+    void setVI(double);
+    void setXPower(double);
+    void setRI(double);
+    void setBikeScore(double);
+    void setSkibaVI(double);
+    void setJoules(double);
+    void setWbal(double);
+    void setAverage(DataSeries, double); // Avg* and Avg*Lap only
     void setLap(long);
 
     const char *getName() const;
@@ -86,22 +99,27 @@ public:
     double getDistance() const;
     long getLap() const;
 
-    uint8_t spinScan[24];
+    // frames are numbered as the sidebar sends them out so a window
+    // can tell a new one from the same one delivered again
+    void setSequence(quint32 x) { sequence = x; }
+    quint32 getSequence() const { return sequence; }
+
+    // SpinScan, what to show and the revolutions
+    // completed since the last sample, oldest first
+    uint8_t spinScan[SPINSCAN_BINS];
+    SpinScanRevolution spinScanRevs[SPINSCAN_MAXREVS];
+    int spinScanRevCount;
 
 private:
     char name[64];
 
-    // realtime telemetry
-    double hr, watts, altWatts, speed, wheelRpm, load, slope;
-    double cadence;      // in rpm
-
-    // derived data
-    double distance;
-    double virtualSpeed;
-    long lap;
-    long msecs;
-    long lapMsecs;
-    long lapMsecsRemaining;
+    // telemetry, derived data and streaming metrics are all kept
+    // by series so value() is just a lookup, times are in msecs
+    double values[SeriesCount];
+
+    // not shown as series
+    double wheelRpm, slope;
+    quint32 sequence;
 };
 
 #endif
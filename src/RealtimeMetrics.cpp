@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RealtimeMetrics.h"
+#include <math.h>
+
+RealtimeMetrics::RealtimeMetrics(double period) : period(period)
+{
+    rolling.resize(qMax(1, int(round(30.0 / period))));
+    alpha = 2.0 / ((25.0 / period) + 1.0);
+    reset(0, 0);
+}
+
+void
+RealtimeMetrics::reset(double CP, double WPRIME)
+{
+    this->CP = CP;
+    this->WPRIME = WPRIME;
+    count = 0;
+    apsum = 0;
+    rolling.fill(0.00);
+    index = 0;
+    rollingSum = rollingTotal = _np = 0;
+    ewma = ewmaTotal = _xpower = 0;
+    belowSum = 0;
+    belowCount = 0;
+    wexp = 0;
+    _tau = 546.00 * exp(-0.01 * CP) + 316.00;
+    _joules = 0;
+    sessionCount = 0;
+    for (int i=0; i<AvgSeries; i++) sessionSum[i] = 0;
+    newLap();
+}
+
+void
+RealtimeMetrics::newLap()
+{
+    lapCount = 0;
+    for (int i=0; i<AvgSeries; i++) lapSum[i] = 0;
+}
+
+// the series averaged, in the order of the Avg* and Avg*Lap series
+static const RealtimeData::DataSeries averaged[] = {
+    RealtimeData::Watts, RealtimeData::Speed, RealtimeData::Cadence, RealtimeData::HeartRate
+};
+
+void
+RealtimeMetrics::update(const RealtimeData &rtData)
+{
+    update(rtData.getWatts());
+
+    sessionCount++;
+    lapCount++;
+    for (int i=0; i<AvgSeries; i++) {
+        double value = rtData.value(averaged[i]);
+        sessionSum[i] += value;
+        lapSum[i] += value;
+    }
+}
+
+void
+RealtimeMetrics::update(double watts)
+{
+    count++;
+    apsum += watts;
+    _joules += watts * period;
+
+    // NP, the rolling sum covers the last 30 seconds
+    rollingSum += watts - rolling[index];
+    rolling[index] = watts;
+    index = (index+1) % rolling.count();
+    rollingTotal += pow(rollingSum / rolling.count(), 4);
+    _np = pow(rollingTotal / count, 0.25);
+
+    // XPower, a plain average until the EWMA is up to speed
+    if (count < 25.0 / period) ewma = ((ewma * (count-1)) + watts) / count;
+    else ewma = (watts * alpha) + (ewma * (1.0 - alpha));
+    ewmaTotal += pow(ewma, 4);
+    _xpower = pow(ewmaTotal / count, 0.25);
+
+    // W' balance, tau comes from the average power below CP so far
+    // and the work above CP decays away with it
+    if (CP <= 0) return;
+    if (watts < CP) {
+        belowSum += watts;
+        belowCount++;
+        _tau = int(546.00 * exp(-0.01 * (CP - (belowSum / belowCount))) + 316.00);
+    }
+    wexp = (wexp * exp(-period / _tau)) + (watts > CP ? (watts - CP) * period : 0);
+}
+
+void
+RealtimeMetrics::apply(RealtimeData &rtData) const
+{
+    double secs = count * period;
+    double ap = count ? apsum / count : 0;
+
+    // Coggan
+    double rif = CP ? _np / CP : 0;
+    rtData.setNP(_np);
+    rtData.setIF(rif);
+    rtData.setTSS(CP ? (_np * secs * rif) / (CP * 3600) * 100.0 : 0);
+    rtData.setVI(ap ? _np / ap : 0);
+
+    // Skiba
+    double ri = CP ? _xpower / CP : 0;
+    rtData.setXPower(_xpower);
+    rtData.setRI(ri);
+    rtData.setBikeScore(CP ? (_xpower * secs * ri) / (CP * 3600) * 100.0 : 0);
+    rtData.setSkibaVI(ap ? _xpower / ap : 0);
+
+    rtData.setJoules(_joules);
+    rtData.setWbal(WPRIME ? wbal() : 0);
+
+    // averages
+    for (int i=0; i<AvgSeries; i++) {
+        rtData.setAverage(RealtimeData::DataSeries(RealtimeData::AvgWatts + i), sessionCount ? sessionSum[i] / sessionCount : 0);
+        rtData.setAverage(RealtimeData::DataSeries(RealtimeData::AvgWattsLap + i), lapCount ? lapSum[i] / lapCount : 0);
+    }
+}
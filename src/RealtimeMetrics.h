@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RealtimeMetrics_h
+#define _GC_RealtimeMetrics_h 1
+#include "GoldenCheetah.h"
+
+#include "RealtimeData.h"
+#include <QVector>
+
+// Streaming versions of the ride metrics for the train view,
+// each sample updates them in constant time so they can be
+// published with the telemetry rather than being recomputed
+// by every dial that shows them.
+//
+// NP uses a 30s rolling average, XPower a 25s exponentially
+// weighted average and W' balance the Skiba integral, kept as
+// a running sum that decays by exp(-dt/tau) every sample.
+//
+// The session and lap averages of power, speed, cadence and
+// heartrate are running sums too, the lap sums are reset by
+// newLap() so every dial showing them agrees.
+class RealtimeMetrics
+{
+    public:
+
+        RealtimeMetrics(double period = 0.2); // sample period in seconds
+
+        // start over, with the CP and W' in force for the session
+        void reset(double CP, double WPRIME);
+
+        // add one power sample
+        void update(double watts);
+
+        // add one sample, the power metrics and the averages
+        void update(const RealtimeData &rtData);
+
+        // the lap averages start over
+        void newLap();
+
+        // set the metric series on the telemetry
+        void apply(RealtimeData &rtData) const;
+
+        double np() const { return _np; }
+        double xpower() const { return _xpower; }
+        double joules() const { return _joules; }
+        double wbal() const { return WPRIME - wexp; }
+        double tau() const { return _tau; }
+
+    private:
+
+        double period;
+        double CP, WPRIME;
+        long count;
+
+        // average power
+        double apsum;
+
+        // NP - 30s rolling average raised to the 4th
+        QVector<double> rolling;
+        int index;
+        double rollingSum, rollingTotal, _np;
+
+        // XPower - 25s EWMA raised to the 4th
+        double ewma, ewmaTotal, _xpower, alpha;
+
+        // W' - decaying sum of the work above CP
+        double belowSum;
+        long belowCount;
+        double wexp, _tau;
+
+        double _joules;
+
+        // averages, watts, speed, cadence and heartrate
+        enum { AvgSeries = 4 };
+        double sessionSum[AvgSeries], lapSum[AvgSeries];
+        long sessionCount, lapCount;
+};
+
+#endif // _GC_RealtimeMetrics_h
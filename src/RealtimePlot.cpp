@@ -27,112 +27,47 @@
 #include "Colors.h"
 
 
-// Power history
-double RealtimePwrData::x(size_t i) const { return (double)MAXSAMPLES-i; }
-double RealtimePwrData::y(size_t i) const { return pwrData[(pwrCur+i) < MAXSAMPLES ? (pwrCur+i) : (pwrCur+i-MAXSAMPLES)]; }
-size_t RealtimePwrData::size() const { return MAXSAMPLES; }
-//QwtSeriesData *RealtimePwrData::copy() const { return new RealtimePwrData(const_cast<RealtimePwrData*>(this)); }
-void RealtimePwrData::init() { pwrCur=0; for (int i=0; i<MAXSAMPLES; i++) pwrData[i]=0; }
-void RealtimePwrData::addData(double v) { pwrData[pwrCur++] = v; if (pwrCur==MAXSAMPLES) pwrCur=0; }
-
-QPointF RealtimePwrData::sample(size_t i) const
-{
-    return QPointF(x(i), y(i));
-}
+// Power, Cadence, Speed and HR history
+void RealtimeSeriesData::init() { cur=0; for (int i=0; i<MAXSAMPLES; i++) data[i]=0; }
 
-QRectF RealtimePwrData::boundingRect() const
+QRectF RealtimeSeriesData::boundingRect() const
 {
     // TODO dgr
     return QRectF(-5000, 5000, 10000, 10000);
 }
 
-// 30 second Power rolling avg
+// 30 second Power rolling avg, a flat line so just the two ends
 double Realtime30PwrData::x(size_t i) const { return i ? 0 : MAXSAMPLES; }
 
-double Realtime30PwrData::y(size_t /*i*/) const { double pwr30=0; for (int x=0; x<150; x++) { pwr30+=pwrData[x]; } pwr30 /= 150; return pwr30; }
-size_t Realtime30PwrData::size() const { return 150; }
+double Realtime30PwrData::y(size_t /*i*/) const { return pwrSum / 150; }
+size_t Realtime30PwrData::size() const { return 2; }
 //QwtSeriesData *Realtime30PwrData::copy() const { return new Realtime30PwrData(const_cast<Realtime30PwrData*>(this)); }
-void Realtime30PwrData::init() { pwrCur=0; for (int i=0; i<150; i++) pwrData[i]=0; }
-void Realtime30PwrData::addData(double v) { pwrData[pwrCur++] = v; if (pwrCur==150) pwrCur=0; }
-
-QPointF Realtime30PwrData::sample(size_t i) const
-{
-    return QPointF(x(i), y(i));
-}
-
-QRectF Realtime30PwrData::boundingRect() const
+void Realtime30PwrData::init() { pwrCur=0; pwrSum=0; for (int i=0; i<150; i++) pwrData[i]=0; }
+void Realtime30PwrData::addData(double v)
 {
-    // TODO dgr
-    return QRectF(-5000, 5000, 10000, 10000);
-}
-
-
-
-
-// Cadence history
-double RealtimeCadData::x(size_t i) const { return (double)MAXSAMPLES-i; }
-double RealtimeCadData::y(size_t i) const { return cadData[(cadCur+i) < MAXSAMPLES ? (cadCur+i) : (cadCur+i-MAXSAMPLES)]; }
-size_t RealtimeCadData::size() const { return MAXSAMPLES; }
-//QwtSeriesData *RealtimeCadData::copy() const { return new RealtimeCadData(const_cast<RealtimeCadData*>(this)); }
-void RealtimeCadData::init() { cadCur=0; for (int i=0; i<MAXSAMPLES; i++) cadData[i]=0; }
-void RealtimeCadData::addData(double v) { cadData[cadCur++] = v; if (cadCur==MAXSAMPLES) cadCur=0; }
-
-QPointF RealtimeCadData::sample(size_t i) const
-{
-    return QPointF(x(i), y(i));
+    pwrSum += v - pwrData[pwrCur];
+    pwrData[pwrCur++] = v;
+
+    // resum each time round so rounding errors don't accumulate
+    if (pwrCur==150) {
+        pwrCur=0;
+        pwrSum=0;
+        for (int i=0; i<150; i++) pwrSum += pwrData[i];
+    }
 }
 
-QRectF RealtimeCadData::boundingRect() const
-{
-    // TODO dgr
-    return QRectF(-5000, 5000, 10000, 10000);
-}
-
-// Speed history
-double RealtimeSpdData::x(size_t i) const { return (double)MAXSAMPLES-i; }
-double RealtimeSpdData::y(size_t i) const { return spdData[(spdCur+i) < MAXSAMPLES ? (spdCur+i) : (spdCur+i-MAXSAMPLES)]; }
-size_t RealtimeSpdData::size() const { return MAXSAMPLES; }
-//QwtSeriesData *RealtimeSpdData::copy() const { return new RealtimeSpdData(const_cast<RealtimeSpdData*>(this)); }
-void RealtimeSpdData::init() { spdCur=0; for (int i=0; i<MAXSAMPLES; i++) spdData[i]=0; }
-void RealtimeSpdData::addData(double v) { spdData[spdCur++] = v; if (spdCur==MAXSAMPLES) spdCur=0; }
-
-QPointF RealtimeSpdData::sample(size_t i) const
+QPointF Realtime30PwrData::sample(size_t i) const
 {
     return QPointF(x(i), y(i));
 }
 
-QRectF RealtimeSpdData::boundingRect() const
+QRectF Realtime30PwrData::boundingRect() const
 {
     // TODO dgr
     return QRectF(-5000, 5000, 10000, 10000);
 }
 
-// HR history
-double RealtimeHrData::x(size_t i) const { return (double)MAXSAMPLES-i; }
-double RealtimeHrData::y(size_t i) const { return hrData[(hrCur+i) < MAXSAMPLES ? (hrCur+i) : (hrCur+i-MAXSAMPLES)]; }
-size_t RealtimeHrData::size() const { return MAXSAMPLES; }
-//QwtSeriesData *RealtimeHrData::copy() const { return new RealtimeHrData(const_cast<RealtimeHrData*>(this)); }
-void RealtimeHrData::init() { hrCur=0; for (int i=0; i<MAXSAMPLES; i++) hrData[i]=0; }
-void RealtimeHrData::addData(double v) { hrData[hrCur++] = v; if (hrCur==MAXSAMPLES) hrCur=0; }
 
-QPointF RealtimeHrData::sample(size_t i) const
-{
-    return QPointF(x(i), y(i));
-}
-
-QRectF RealtimeHrData::boundingRect() const
-{
-    // TODO dgr
-    return QRectF(-5000, 5000, 10000, 10000);
-}
-
-// Load history
-//double RealtimeLodData::x(size_t i) const { return (double)50-i; }
-//double RealtimeLodData::y(size_t i) const { return lodData[(lodCur+i) < 50 ? (lodCur+i) : (lodCur+i-50)]; }
-//size_t RealtimeLodData::size() const { return 50; }
-//QwtData *RealtimeLodData::copy() const { return new RealtimeLodData(); }
-//void RealtimeLodData::init() { lodCur=0; for (int i=0; i<50; i++) lodData[i]=0; }
-//void RealtimeLodData::addData(double v) { lodData[lodCur++] = v; if (lodCur==50) lodCur=0; }
 
 
 RealtimePlot::RealtimePlot() : 
@@ -149,11 +84,11 @@ RealtimePlot::RealtimePlot() :
 
     //insertLegend(new QwtLegend(), QwtPlot::BottomLegend);
     pwr30Data = new Realtime30PwrData;
-    pwrData = new RealtimePwrData;
-    altPwrData = new RealtimePwrData;
-    spdData = new RealtimeSpdData;
-    hrData = new RealtimeHrData;
-    cadData = new RealtimeCadData;
+    pwrData = new RealtimeSeriesData;
+    altPwrData = new RealtimeSeriesData;
+    spdData = new RealtimeSeriesData;
+    hrData = new RealtimeSeriesData;
+    cadData = new RealtimeSeriesData;
 
     // Setup the axis (of evil :-)
     setAxisTitle(yLeft, "Watts");
@@ -252,6 +187,11 @@ RealtimePlot::RealtimePlot() :
 //    lodCurve->attach(this);
 //    lodCurve->setYAxis(QwtPlot::yLeft);
     canvas()->setFrameStyle(QFrame::NoFrame);
+
+    // every sample scrolls every curve so the whole canvas is
+    // repainted each time, the backing store would just be another copy
+    canvas()->setPaintAttribute(QwtPlotCanvas::BackingStore, false);
+
     configChanged(); // set colors
 }
 
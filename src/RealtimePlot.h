@@ -40,6 +40,7 @@ class Realtime30PwrData : public QwtSeriesData<QPointF>
     int &pwrCur;
     double pwrData_[150];
     double (&pwrData)[150];
+    double pwrSum; // running total of pwrData
 
     public:
     Realtime30PwrData() : pwrCur(pwrCur_), pwrData(pwrData_) { init(); }
@@ -55,111 +56,24 @@ class Realtime30PwrData : public QwtSeriesData<QPointF>
     virtual QRectF boundingRect() const;
 };
 
-class RealtimePwrData : public QwtSeriesData<QPointF>
+// history of the last MAXSAMPLES values for power, cadence, speed
+// and hr. New values overwrite the oldest in a circular buffer so
+// adding is constant time, sample 0 is the oldest
+class RealtimeSeriesData : public QwtSeriesData<QPointF>
 {
-    int pwrCur_;
-    int &pwrCur;
-    double pwrData_[MAXSAMPLES];
-    double (&pwrData)[MAXSAMPLES];
+    int cur;
+    double data[MAXSAMPLES];
 
     public:
-    RealtimePwrData() : pwrCur(pwrCur_), pwrData(pwrData_) { init(); }
+    RealtimeSeriesData() { init(); }
 
-    double x(size_t i) const ;
-    double y(size_t i) const ;
-    size_t size() const ;
-    //virtual QwtSeriesData *copy() const ;
-    void init() ;
-    void addData(double v) ;
-
-    virtual QPointF sample(size_t i) const;
-    virtual QRectF boundingRect() const;
-};
-
-class RealtimeLodData : public QwtSeriesData<QPointF>
-{
-    int lodCur_;
-    int &lodCur;
-    double lodData_[MAXSAMPLES];
-    double (&lodData)[MAXSAMPLES];
-
-    public:
-    RealtimeLodData() : lodCur(lodCur_), lodData(lodData_) { init(); }
-
-    double x(size_t i) const ;
-    double y(size_t i) const ;
-    size_t size() const ;
-    //virtual QwtSeriesData *copy() const ;
+    double x(size_t i) const { return (double)MAXSAMPLES-i; }
+    double y(size_t i) const { return data[(cur+i) < MAXSAMPLES ? (cur+i) : (cur+i-MAXSAMPLES)]; }
+    size_t size() const { return MAXSAMPLES; }
     void init() ;
-    void addData(double v) ;
+    void addData(double v) { data[cur++] = v; if (cur==MAXSAMPLES) cur=0; }
 
-    virtual QPointF sample(size_t i) const;
-    virtual QRectF boundingRect() const;
-};
-
-// tedious virtual data interface for QWT
-class RealtimeCadData : public QwtSeriesData<QPointF>
-{
-    int cadCur_;
-    int &cadCur;
-    double cadData_[MAXSAMPLES];
-    double (&cadData)[MAXSAMPLES];
-
-    public:
-    RealtimeCadData() : cadCur(cadCur_), cadData(cadData_) { init(); }
-
-    double x(size_t i) const ;
-    double y(size_t i) const ;
-    size_t size() const ;
-    //virtual QwtSeriesData *copy() const ;
-    void init() ;
-    void addData(double v) ;
-
-    virtual QPointF sample(size_t i) const;
-    virtual QRectF boundingRect() const;
-};
-
-// tedious virtual data interface for QWT
-class RealtimeSpdData : public QwtSeriesData<QPointF>
-{
-    int spdCur_;
-    int &spdCur;
-    double spdData_[MAXSAMPLES];
-    double (&spdData)[MAXSAMPLES];
-
-    public:
-    RealtimeSpdData() : spdCur(spdCur_), spdData(spdData_) { init(); }
-
-    double x(size_t i) const ;
-    double y(size_t i) const ;
-    size_t size() const ;
-    //virtual QwtSeriesData *copy() const ;
-    void init() ;
-    void addData(double v) ;
-
-    virtual QPointF sample(size_t i) const;
-    virtual QRectF boundingRect() const;
-};
-
-// tedious virtual data interface for QWT
-class RealtimeHrData : public QwtSeriesData<QPointF>
-{
-    int hrCur_;
-    int &hrCur;
-    double hrData_[MAXSAMPLES];
-    double (&hrData)[MAXSAMPLES];
-
-    public:
-    RealtimeHrData() : hrCur(hrCur_), hrData(hrData_) { init(); }
-
-    double x(size_t i) const ;
-    double y(size_t i) const ;
-    size_t size() const ;
-    //virtual QwtSeriesData *copy() const ;
-    void init() ;
-    void addData(double v) ;
-
-    virtual QPointF sample(size_t i) const;
+    virtual QPointF sample(size_t i) const { return QPointF(x(i), y(i)); }
     virtual QRectF boundingRect() const;
 };
 
@@ -195,12 +109,11 @@ class RealtimePlot : public QwtPlot
     void setAxisTitle(int axis, QString label);
 
     Realtime30PwrData *pwr30Data;
-    RealtimePwrData *pwrData;
-    RealtimePwrData *altPwrData;
-    RealtimeSpdData *spdData;
-    RealtimeHrData *hrData;
-    RealtimeCadData *cadData;
-    //RealtimeLodData lodData;
+    RealtimeSeriesData *pwrData;
+    RealtimeSeriesData *altPwrData;
+    RealtimeSeriesData *spdData;
+    RealtimeSeriesData *hrData;
+    RealtimeSeriesData *cadData;
 
     RealtimePlot();
     int smooth;
@@ -91,7 +91,7 @@ RealtimePlotWindow::RealtimePlotWindow(Context *context) :
     connect(smoothLineEdit, SIGNAL(editingFinished()), this, SLOT(setSmoothingFromLineEdit()));
 
     // get updates..
-    connect(context, SIGNAL(telemetryUpdate(RealtimeData)), this, SLOT(telemetryUpdate(RealtimeData)));
+    context->telemetry->subscribe(this, "telemetryUpdate", 0, QList<RealtimeData::DataSeries>(), true); // keeps history
 
     // lets initialise all the smoothing variables
     hrtot = hrindex = cadtot = cadindex = spdtot = spdindex = alttot = altindex = powtot = powindex = 0;
@@ -123,7 +123,7 @@ RealtimePlotWindow::pause()
 }
 
 void
-RealtimePlotWindow::telemetryUpdate(RealtimeData rtData)
+RealtimePlotWindow::telemetryUpdate(const RealtimeData &rtData)
 {
     // lets apply smoothing if we have to
     if (rtPlot->smooth) {
@@ -178,7 +178,9 @@ RealtimePlotWindow::telemetryUpdate(RealtimeData rtData)
         rtPlot->spdData->addData(rtData.value(RealtimeData::Speed));
         rtPlot->hrData->addData(rtData.value(RealtimeData::HeartRate));
     }
-    rtPlot->replot();                // redraw
+
+    // redraw, the history is kept regardless
+    if (amVisible()) rtPlot->replot();
 }
 
 void
@@ -62,7 +62,7 @@ class RealtimePlotWindow : public GcWindow
    public slots:
 
         // trap signals
-        void telemetryUpdate(RealtimeData rtData); // got new data
+        void telemetryUpdate(const RealtimeData &rtData); // got new data
         void start();
         void stop();
         void pause();
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideArchive.h"
+#include <QDataStream>
+#include <QFileInfo>
+
+// "GCA1" at the start of the file and "GCAC" at the start of each chunk
+static const quint32 archiveMagic = 0x47434131;
+static const quint32 chunkMagic = 0x47434143;
+
+RideArchive::RideArchive(QString filename) : file(filename)
+{
+}
+
+bool
+RideArchive::open()
+{
+    index.clear();
+    if (!file.open(QFile::ReadWrite)) return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_6);
+
+    // a new archive
+    if (file.size() == 0) {
+        in << archiveMagic;
+        return in.status() == QDataStream::Ok;
+    }
+
+    quint32 magic;
+    in >> magic;
+    if (magic != archiveMagic) {
+        file.close();
+        return false;
+    }
+
+    // walk the chunk headers, skipping the data. A chunk cut short by
+    // a crash part way through an append is ignored and overwritten
+    // by the next one
+    qint64 end = sizeof(archiveMagic);
+    while (!in.atEnd()) {
+
+        QString name;
+        qint64 modified;
+        quint32 size;
+        in >> magic >> name >> modified >> size;
+        if (in.status() != QDataStream::Ok || magic != chunkMagic) break;
+
+        Entry entry;
+        entry.offset = file.pos();
+        entry.size = size;
+        entry.modified = QDateTime::fromTime_t(modified);
+        if (entry.offset + size > file.size()) break;
+
+        index.insert(name, entry);
+        end = entry.offset + size;
+        file.seek(end);
+    }
+    return file.resize(end);
+}
+
+QByteArray
+RideArchive::read(QString name)
+{
+    QMap<QString, Entry>::const_iterator entry = index.find(name);
+    if (entry == index.end() || !file.seek(entry->offset)) return QByteArray();
+
+    return qUncompress(file.read(entry->size));
+}
+
+bool
+RideArchive::append(QString name, QDateTime modified, const QByteArray &data)
+{
+    QByteArray compressed = qCompress(data);
+    if (!file.seek(file.size())) return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_6);
+    out << chunkMagic << name << qint64(modified.toTime_t()) << quint32(compressed.size());
+
+    Entry entry;
+    entry.offset = file.pos();
+    entry.size = compressed.size();
+    entry.modified = modified;
+
+    if (out.status() != QDataStream::Ok || file.write(compressed) != compressed.size()) return false;
+    index.insert(name, entry);
+    return true;
+}
+
+int
+RideArchive::update(const QDir &dir, const QStringList &files)
+{
+    int count = 0;
+    foreach(QString name, files) {
+
+        QFileInfo info(dir, name);
+        QString cpx = info.baseName() + ".cpx";
+
+        // the ride and its cache go together
+        QStringList both;
+        both << name;
+        if (QFileInfo(dir, cpx).exists()) both << cpx;
+
+        foreach(QString member, both) {
+            QFile source(dir.absoluteFilePath(member));
+            QDateTime modified = QFileInfo(source).lastModified();
+
+            // time_t resolution, as they are stored
+            if (contains(member) && lastModified(member).toTime_t() >= modified.toTime_t()) continue;
+            if (!source.open(QFile::ReadOnly)) continue;
+
+            if (append(member, modified, source.readAll())) count++;
+        }
+    }
+    file.flush();
+    return count;
+}
+
+int
+RideArchive::restore(const QDir &dir)
+{
+    // caches go last so they are not older than their ride and
+    // recomputed when next opened
+    QStringList rides, caches;
+    foreach(QString name, names()) {
+        if (name.endsWith(".cpx")) caches << name;
+        else rides << name;
+    }
+
+    int count = 0;
+    foreach(QString name, rides + caches) {
+
+        QFileInfo info(dir, name);
+        if (info.exists() && info.lastModified().toTime_t() >= lastModified(name).toTime_t()) continue;
+
+        QFile target(info.absoluteFilePath());
+        if (!target.open(QFile::WriteOnly | QFile::Truncate)) continue;
+        target.write(read(name));
+        target.close();
+        count++;
+    }
+    return count;
+}
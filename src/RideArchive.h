@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideArchive_h
+#define _GC_RideArchive_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QFile>
+#include <QDir>
+#include <QMap>
+
+// A single file holding the rides (and their .cpx caches) from an athlete
+// home, for backups and synced folders that struggle with thousands of
+// small files. It is append-only; each file is stored as a compressed
+// chunk and a later chunk with the same name replaces the earlier one, so
+// updating an archive only ever writes the files that have changed
+class RideArchive
+{
+    public:
+        RideArchive(QString filename);
+
+        bool open();    // reads the index, creating the archive if needed
+        void close() { file.close(); }
+
+        QStringList names() const { return index.keys(); }
+        bool contains(QString name) const { return index.contains(name); }
+        QDateTime lastModified(QString name) const { return index.value(name).modified; }
+
+        QByteArray read(QString name);
+        bool append(QString name, QDateTime modified, const QByteArray &data);
+
+        // append the files in dir that are missing or newer than the archived
+        // copy, and write out those that are missing or older in dir
+        int update(const QDir &dir, const QStringList &files);
+        int restore(const QDir &dir);
+
+    private:
+        struct Entry {
+            Entry() : offset(0), size(0) {}
+            qint64 offset;          // of the compressed data
+            quint32 size;           // compressed size
+            QDateTime modified;
+        };
+
+        QFile file;
+        QMap<QString, Entry> index;
+};
+
+#endif // _GC_RideArchive_h
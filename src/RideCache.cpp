@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideCache.h"
+#include "Athlete.h"
+#include "Context.h"
+#include "RideItem.h"
+#include "RideFile.h"
+#include "RideFileCommand.h"
+#include "CacheStats.h"
+#include "Settings.h"
+
+#include <QApplication>
+#include <QTimer>
+
+static CacheStats rideStats("Rides", GC_RIDECACHE_MB, 512);
+
+CacheStats &
+RideCache::stats()
+{
+    return rideStats;
+}
+
+RideCache::RideCache(Context *context) : QObject(context), context(context), evicting(false)
+{
+    configChanged();
+
+    connect(context, SIGNAL(configChanged()), this, SLOT(configChanged()));
+    connect(context, SIGNAL(rideSelected(RideItem*)), this, SLOT(rideSelected(RideItem*)));
+}
+
+RideCache::~RideCache()
+{
+    // don't leave them running
+    foreach (RidePrefetch *p, prefetching) {
+        p->wait();
+        delete p->ride;
+        delete p;
+    }
+    rideStats.forget(this);
+}
+
+void
+RideCache::configChanged()
+{
+    budget = rideStats.budget();
+}
+
+// roughly how much memory an open ride is using
+static qint64
+rideSize(RideItem *item)
+{
+    RideFile *ride = item->rideIfOpen();
+    if (ride == NULL) return 0;
+    return sizeof(RideFile) + (ride->dataPoints().count() * (sizeof(RideFilePoint) + sizeof(RideFilePoint*)));
+}
+
+void
+RideCache::opened(RideItem *item)
+{
+    open.insert(item);
+
+    // we free them once whatever caused this ride to be opened has
+    // finished with the one it was looking at before
+    if (!evicting) {
+        evicting = true;
+        QTimer::singleShot(0, this, SLOT(evict()));
+    }
+}
+
+void
+RideCache::freed(RideItem *item)
+{
+    open.remove(item);
+}
+
+void
+RideCache::evict()
+{
+    evicting = false;
+
+    qint64 total = 0;
+    QMap<unsigned long, RideItem*> candidates; // least recently used first
+    foreach (RideItem *item, open) {
+        total += rideSize(item);
+        if (item->isDirty() || item->isedit || item == context->ride) continue;
+        candidates.insert(item->lastUsed, item);
+    }
+
+    budget = rideStats.budget(); // may have been changed in the Memory and Caches dialog
+    QMapIterator<unsigned long, RideItem*> i(candidates);
+    while (total > budget && i.hasNext()) {
+        i.next();
+        total -= rideSize(i.value());
+        i.value()->freeMemory();
+    }
+    rideStats.setUsage(this, total, open.count());
+}
+
+void
+RideCache::rideSelected(RideItem *item)
+{
+    if (item == NULL) return;
+
+    int index = context->athlete->rideIndexOf(item->fileName);
+    if (index < 0) return;
+
+    if (index > 0) prefetch(context->athlete->rideFileName(index-1));
+    if (index+1 < context->athlete->rideCount()) prefetch(context->athlete->rideFileName(index+1));
+}
+
+void
+RideCache::request(RideItem *item)
+{
+    requested.insert(item->fileName);
+
+    // may be on its way already, but it isn't idle anymore
+    if (prefetching.contains(item->fileName)) {
+        prefetching.value(item->fileName)->setPriority(QThread::NormalPriority);
+        return;
+    }
+
+    RidePrefetch *p = new RidePrefetch(context, item->path, item->fileName);
+    prefetching.insert(item->fileName, p);
+    connect(p, SIGNAL(finished()), this, SLOT(prefetched()));
+    p->start(QThread::NormalPriority);
+}
+
+void
+RideCache::prefetch(QString filename)
+{
+    if (prefetching.contains(filename)) return;
+
+    // already open ?
+    int index = context->athlete->rideIndexOf(filename);
+    if (index < 0 || context->athlete->rideItem(index)->rideIfOpen()) return;
+
+    RidePrefetch *p = new RidePrefetch(context, context->athlete->home.path(), filename);
+    prefetching.insert(filename, p);
+    connect(p, SIGNAL(finished()), this, SLOT(prefetched()));
+    p->start(QThread::LowPriority);
+}
+
+void
+RideCache::prefetched()
+{
+    RidePrefetch *p = static_cast<RidePrefetch*>(sender());
+    prefetching.remove(p->filename);
+
+    bool waiting = requested.remove(p->filename);
+
+    // it may have been opened or deleted whilst we were reading it
+    int index = context->athlete->rideIndexOf(p->filename);
+    RideItem *item = index >= 0 ? context->athlete->rideItem(index) : NULL;
+    if (p->ride && item && item->rideIfOpen() == NULL)
+        item->setRide(p->ride);
+    else
+        delete p->ride;
+
+    // tell whoever asked, even if it failed or was opened meanwhile
+    if (waiting && item) {
+        if (item->rideIfOpen() == NULL) item->setErrors(p->errors);
+        item->notifyRideReady();
+    }
+
+    p->deleteLater();
+}
+
+void
+RidePrefetch::run()
+{
+    QFile file(path + "/" + filename);
+    ride = RideFileFactory::instance().openRideFile(context, file, errors);
+
+    // it is going to live on the GUI thread
+    if (ride) {
+        ride->command->moveToThread(QApplication::instance()->thread());
+        ride->moveToThread(QApplication::instance()->thread());
+    }
+}
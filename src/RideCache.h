@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideCache_h
+#define _GC_RideCache_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QThread>
+#include <QSet>
+#include <QMap>
+
+class Context;
+class CacheStats;
+class RideItem;
+class RideFile;
+class RidePrefetch;
+
+// Rides opened by RideItem::ride() stay in memory until they are freed, so
+// looking through a season of rides would keep every one of them. The cache
+// keeps track of the rides that are open and frees the least recently used
+// of them once they take up more than the memory budget (GC_RIDECACHE_MB).
+// Rides that are dirty, being edited or currently selected are never freed.
+//
+// When a ride is selected the rides either side of it are opened in
+// the background, so stepping through the list doesn't wait on the disk.
+// A ride can also be requested, it is read the same way but at normal
+// priority and the RideItem emits rideReady() once it is done.
+class RideCache : public QObject
+{
+    Q_OBJECT
+    G_OBJECT
+
+    public:
+        RideCache(Context *context);
+        ~RideCache();
+
+        // called by RideItem as it opens and frees its ride
+        void opened(RideItem *item);
+        void freed(RideItem *item);
+
+        // open it in the background, see RideItem::requestRide()
+        void request(RideItem *item);
+
+        // RideItem::ride() counts its hits and misses here
+        static CacheStats &stats();
+
+    public slots:
+        void configChanged();
+        void rideSelected(RideItem *item);
+
+    private slots:
+        void evict();
+        void prefetched();
+
+    private:
+        Context *context;
+        QSet<RideItem*> open;
+        qint64 budget;
+        bool evicting;
+
+        QMap<QString, RidePrefetch*> prefetching; // by filename
+        QSet<QString> requested; // someone is waiting for these
+        void prefetch(QString filename);
+};
+
+// opens a ride file in the background for the cache
+class RidePrefetch : public QThread
+{
+    public:
+        RidePrefetch(Context *context, QString path, QString filename)
+            : filename(filename), ride(NULL), context(context), path(path) {}
+        void run();
+
+        QString filename;
+        RideFile *ride;
+        QStringList errors;
+
+    private:
+        Context *context;
+        QString path;
+};
+
+#endif // _GC_RideCache_h
@@ -43,19 +43,6 @@ static void unxsstring(QString val, int &x, RideFile::SeriesType &series)
     series = static_cast<RideFile::SeriesType>(it.cap(2).toInt());
 }
 
-static void secsMsecs(double value, int &secs, int &msecs)
-{
-    // split into secs and msecs from a double
-    // tried modf, floor, round and a host of others but
-    // they all had difference problems. In the end
-    // I've resorted to rounding to 100ths of a second.
-    // I acknowledge that this is horrid, but its ok
-    // for Powertaps but maybe more precise devices will
-    // come along?
-    secs = floor(value); // assume it is positive!! .. it is a time field!
-    msecs = round((value - secs) * 100) * 10;
-}
-
 RideEditor::RideEditor(Context *context) : GcChartWindow(context), data(NULL), ride(NULL), context(context), inLUW(false), colMapper(NULL)
 {
     setInstanceName("Ride Editor");
@@ -229,14 +216,7 @@ RideEditor::isTooPrecise(int row, int column)
 {
     if (row < 0 || column < 0) return false;
 
-    RideFile::SeriesType what = model->columnType(column);
-    int dp;
-    QString value = QString("%1").arg(getValue(row, column), 0, 'g', 10);
-
-    if ((dp = value.indexOf(".")) >= 0)
-        if (value.length()-(dp+1) > RideFile::decimalsFor(what)) return true;
-
-    return false;
+    return model->tooPrecise(row, column);
 }
 
 bool
@@ -327,13 +307,48 @@ AnomalyDialog::check()
     //header << "Id" << "Anomalies";
     //anomalyList->setHorizontalHeaderLabels(header);
     anomalyList->horizontalHeader()->hide();
+    anomalyList->setRowCount(0);
+
+    // the points are checked a slice at a time in the background, so
+    // opening a long ride doesn't wait on it. Any scan already under
+    // way restarts from the top
+    scanning = rideEditor->ride->ride();
+    power.clear();
+    secs.clear();
+    lastdistance = 9;
+    scanned = 0;
+
+    if (!scheduled) {
+        scheduled = true;
+        QTimer::singleShot(0, this, SLOT(scan()));
+    }
+}
 
-    QVector<double> power;
-    QVector<double> secs;
-    double lastdistance=9;
-    int count = 0;
+void
+AnomalyDialog::cancel()
+{
+    scanning = NULL;
+}
 
-    foreach (RideFilePoint *point, rideEditor->ride->ride()->dataPoints()) {
+void
+AnomalyDialog::scan()
+{
+    scheduled = false;
+
+    RideFile *ride = scanning;
+    if (ride == NULL) return; // deleted or cancelled
+
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+    QTime slice;
+    slice.start();
+
+    for (; scanned < points.count(); scanned++) {
+
+        // give the gui a look in every now and again
+        if ((scanned & 1023) == 0 && slice.elapsed() > 20) break;
+
+        int count = scanned;
+        RideFilePoint *point = points[count];
         power.append(point->watts);
         secs.append(point->secs);
 
@@ -342,7 +357,7 @@ AnomalyDialog::check()
             // whilst we are here we might as well check for gaps in recording
             // anything bigger than a second is of a material concern
             // and we assume time always flows forward ;-)
-            double diff = secs[count] - (secs[count-1] + rideEditor->ride->ride()->recIntSecs());
+            double diff = secs[count] - (secs[count-1] + ride->recIntSecs());
             if (diff > (double)1.0 || diff < (double)-1.0 || secs[count] < secs[count-1]) {
                 rideEditor->data->anomalies.insert(xsstring(count, RideFile::secs),
                                        tr("Invalid recording gap"));
@@ -377,17 +392,31 @@ AnomalyDialog::check()
             rideEditor->data->anomalies.insert(xsstring(count, RideFile::lon),
                                    tr("Out of bounds value"));
         }
-        if (rideEditor->ride->ride()->areDataPresent()->cad && point->nm && !point->cad) {
+        if (ride->areDataPresent()->cad && point->nm && !point->cad) {
             rideEditor->data->anomalies.insert(xsstring(count, RideFile::nm),
                                    tr("Non-zero torque but zero cadence"));
 
         }
-        count++;
     }
 
+    if (scanned < points.count()) {
+
+        // show what we've found so far and carry on
+        if (rideEditor->data->anomalies.count()) rideEditor->model->forceRedraw();
+        scheduled = true;
+        QTimer::singleShot(0, this, SLOT(scan()));
+        return;
+    }
+
+    finish();
+}
+
+void
+AnomalyDialog::finish()
+{
     // lets look at the Power Column if its there and has enough data
     int column = rideEditor->model->headings().indexOf(tr("Power"));
-    if (column >= 0 && rideEditor->ride->ride()->dataPoints().count() >= 30) {
+    if (column >= 0 && scanning->dataPoints().count() >= 30) {
 
         // get spike config
         double max = appsettings->value(this, GC_DPFS_MAX, "1500").toDouble();
@@ -833,7 +862,7 @@ RideEditor::paste()
     }
 
     // go paste!
-    ride->ride()->command->startLUW("Paste Cells");
+    SetPointValuesCommand *values = new SetPointValuesCommand(ride->ride());
     for (int i=0; i<cells.count(); i++) {
 
         // just in case check booundary (i.e. truncate)
@@ -844,10 +873,11 @@ RideEditor::paste()
             if ((selectedcol+j > model->columnCount()-1)) break;
 
             // set table
-            setModelValue(selectedrow+i, selectedcol+j, cells[i][j]);
+            RideFile::SeriesType series = model->columnType(selectedcol+j);
+            values->append(selectedrow+i, series, ride->ride()->getPointValue(selectedrow+i, series), cells[i][j]);
         }
     }
-    ride->ride()->command->endLUW();
+    ride->ride()->command->setPointValues(values, tr("Paste Cells"));
 }
 
 // get clipboard into a 2-dim array of doubles
@@ -921,11 +951,12 @@ void
 RideEditor::clear()
 {
     // Set the selected cells to zero
-    ride->ride()->command->startLUW("Clear cells");
+    SetPointValuesCommand *values = new SetPointValuesCommand(ride->ride());
     foreach (QModelIndex current, table->selectionModel()->selection().indexes()) {
-        setModelValue(current.row(), current.column(), (double)0.0);
+        RideFile::SeriesType series = model->columnType(current.column());
+        values->append(current.row(), series, ride->ride()->getPointValue(current.row(), series), 0.0);
     }
-    ride->ride()->command->endLUW();
+    ride->ride()->command->setPointValues(values, tr("Clear cells"));
 }
 
 void
@@ -992,7 +1023,7 @@ void CellDelegate::setEditorData(QWidget *editor, const QModelIndex &index) cons
     if (what == RideFile::secs) {
 
         int seconds, msecs;
-        secsMsecs(index.model()->data(index, Qt::DisplayRole).toDouble(), seconds, msecs);
+        RideFileTableModel::secsMsecs(index.model()->data(index, Qt::DisplayRole).toDouble(), seconds, msecs);
 
         QTime value = QTime(0,0,0,0).addSecs(seconds).addMSecs(msecs);
         QTimeEdit *timeEdit = qobject_cast<QTimeEdit *>(editor);
@@ -1037,16 +1068,8 @@ void CellDelegate::setModelData(QWidget *editor, QAbstractItemModel *, const QMo
 void CellDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
                          const QModelIndex &index) const
 {
-    // what are we editing?
-    RideFile::SeriesType what = rideEditor->model->columnType(index.column());
-    QString value;
-
-    if (what == RideFile::secs) {
-        int seconds, msecs;
-        secsMsecs(index.model()->data(index, Qt::DisplayRole).toDouble(), seconds, msecs);
-        value = QTime(0,0,0,0).addSecs(seconds).addMSecs(msecs).toString("hh:mm:ss.zzz");
-    } else
-        value = index.model()->data(index, Qt::DisplayRole).toString();
+    // formatted by the model when first drawn
+    QString value = rideEditor->model->text(index.row(), index.column());
 
     // best place to update the tooltip is here, rather than whenever we update the editor
     // data, since this is just before it is used...
@@ -1147,6 +1170,7 @@ RideEditor::rideSelected()
     RideItem *current = myRideItem;
     if (!current || !current->ride() || !current->ride()->dataPoints().count()) {
         model->setRide(NULL);
+        anomalyTool->cancel();
         setIsBlank(true);
         findTool->rideSelected();
         return;
@@ -1272,6 +1296,20 @@ RideEditor::endCommand(bool undo, RideCommand *cmd)
 
             break;
         }
+        case RideCommand::SetPointValues:
+        {
+            SetPointValuesCommand *spv = (SetPointValuesCommand*)cmd;
+
+            // highlight the runs that were updated
+            QItemSelection highlight;
+            foreach(const SetPointValuesCommand::Run &run, spv->runs) {
+                int column = model->columnFor(run.series);
+                highlight.select(model->index(run.row, column), model->index(run.row + run.oldvalues.count() - 1, column));
+            }
+            if (!inLUW) table->selectionModel()->clearSelection();
+            table->selectionModel()->select(highlight, QItemSelectionModel::Select);
+            break;
+        }
         case RideCommand::InsertPoint:
         {
             InsertPointCommand *ip = (InsertPointCommand *)cmd;
@@ -1282,6 +1320,16 @@ RideEditor::endCommand(bool undo, RideCommand *cmd)
             }
             break;
         }
+        case RideCommand::InsertPoints:
+        {
+            InsertPointsCommand *ip = (InsertPointsCommand *)cmd;
+            if (undo) { // deleted these rows...
+                data->deleteRows(ip->row, ip->count);
+            } else {
+                data->insertRows(ip->row, ip->count);
+            }
+            break;
+        }
         case RideCommand::DeletePoint:
         {
             DeletePointCommand *dp = (DeletePointCommand *)cmd;
@@ -1804,7 +1852,7 @@ FindDialog::dataChanged()
 
         // time -- format correctly... held as a double in the model
         int seconds, msecs;
-        secsMsecs(rideEditor->model->getValue(row,0), seconds, msecs);
+        RideFileTableModel::secsMsecs(rideEditor->model->getValue(row,0), seconds, msecs);
         QString value = QTime(0,0,0,0).addSecs(seconds).addMSecs(msecs).toString("hh:mm:ss.zzz");
 
         QTableWidgetItem *t = new QTableWidgetItem;
@@ -2357,7 +2405,7 @@ PasteSpecialDialog::columnChanged()
     }
 }
 
-AnomalyDialog::AnomalyDialog(RideEditor *rideEditor) : rideEditor(rideEditor)
+AnomalyDialog::AnomalyDialog(RideEditor *rideEditor) : rideEditor(rideEditor), scheduled(false), scanned(0), lastdistance(9)
 {
     // setup the basic window settings; nonmodal, ontop and delete on close
     setWindowTitle("Anomalies");
@@ -211,10 +211,23 @@ class AnomalyDialog : public QWidget
 
     public slots:
         void reject();
-        void check();
+        void check();   // starts a scan, the results come in as it goes
+        void cancel();  // the ride has gone
+
+    private slots:
+        void scan();    // the next slice of points
 
     private:
         RideEditor *rideEditor;
+
+        // scan state, check() starts it again from the top
+        QPointer<RideFile> scanning;
+        bool scheduled;
+        int scanned;
+        double lastdistance;
+        QVector<double> power, secs;
+
+        void finish();
 };
 
 //
@@ -20,6 +20,7 @@
 #include "RideFile.h"
 #include "Athlete.h"
 #include "DataProcessor.h"
+#include "Trace.h"
 #include "RideEditor.h"
 #include "RideMetadata.h"
 #include "MetricAggregator.h"
@@ -29,6 +30,9 @@
 #include <QtXml/QtXml>
 #include <algorithm> // for std::lower_bound
 #include <assert.h>
+#include <math.h>
+#include <string.h> // memset
+#include <new> // placement new
 
 #define mark() \
 { \
@@ -41,7 +45,8 @@
 RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
             startTime_(startTime), recIntSecs_(recIntSecs),
             deviceType_("unknown"), data(NULL), weight_(0),
-            totalCount(0), dstale(true)
+            slice(false), totalCount(0), dstale(true), dfrom(0),
+            sharedFrom(0), sharedRevision(0), columnBuilds(0)
 {
     command = new RideFileCommand(this);
 
@@ -49,9 +54,13 @@ RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
     maxPoint = new RideFilePoint();
     avgPoint = new RideFilePoint();
     totalPoint = new RideFilePoint();
+
+    memset(rbuilt, 0, sizeof(rbuilt));
+    columnsChanged();
 }
 
-RideFile::RideFile() : recIntSecs_(0.0), deviceType_("unknown"), data(NULL), weight_(0), totalCount(0), dstale(true)
+RideFile::RideFile() : recIntSecs_(0.0), deviceType_("unknown"), data(NULL), slice(false), weight_(0), totalCount(0),
+                       dstale(true), dfrom(0), sharedFrom(0), sharedRevision(0), columnBuilds(0)
 {
     command = new RideFileCommand(this);
 
@@ -59,17 +68,108 @@ RideFile::RideFile() : recIntSecs_(0.0), deviceType_("unknown"), data(NULL), wei
     maxPoint = new RideFilePoint();
     avgPoint = new RideFilePoint();
     totalPoint = new RideFilePoint();
+
+    memset(rbuilt, 0, sizeof(rbuilt));
+    columnsChanged();
+}
+
+RideFile::RideFile(const RideFile *ride, int start, int stop) :
+            startTime_(ride->startTime_), recIntSecs_(ride->recIntSecs_),
+            deviceType_(ride->deviceType_), tags_(ride->tags_), data(NULL), slice(true), weight_(ride->weight_),
+            totalCount(0), dstale(false), dfrom(0), sharedFrom(0), sharedRevision(0), columnBuilds(0)
+{
+    context = ride->context;
+    command = new RideFileCommand(this);
+
+    minPoint = new RideFilePoint();
+    maxPoint = new RideFilePoint();
+    avgPoint = new RideFilePoint();
+    totalPoint = new RideFilePoint();
+
+    memset(rbuilt, 0, sizeof(rbuilt));
+    columnsChanged();
+
+    // the derived series come with the points, the data present
+    // and the min, max and average are just for these points
+    start = qMax(0, start);
+    stop = qMin(stop, ride->dataPoints_.count()-1);
+    if (stop >= start) dataPoints_ = ride->dataPoints_.mid(start, stop-start+1);
+
+    foreach(RideFilePoint *point, dataPoints_) {
+        dataPresent.secs     |= (point->secs != 0);
+        dataPresent.cad      |= (point->cad != 0);
+        dataPresent.hr       |= (point->hr != 0);
+        dataPresent.km       |= (point->km != 0);
+        dataPresent.kph      |= (point->kph != 0);
+        dataPresent.nm       |= (point->nm != 0);
+        dataPresent.watts    |= (point->watts != 0);
+        dataPresent.alt      |= (point->alt != 0);
+        dataPresent.lon      |= (point->lon != 0);
+        dataPresent.lat      |= (point->lat != 0);
+        dataPresent.headwind |= (point->headwind != 0);
+        dataPresent.slope    |= (point->slope != 0);
+        dataPresent.temp     |= (point->temp != noTemp);
+        dataPresent.lrbalance|= (point->lrbalance != 0);
+
+        updateMin(point);
+        updateMax(point);
+        updateAvg(point);
+    }
+    dataPresent.np = ride->dataPresent.np;
+    dataPresent.xp = ride->dataPresent.xp;
+    dataPresent.apower = ride->dataPresent.apower;
 }
 
 RideFile::~RideFile()
 {
     emit deleted();
-    foreach(RideFilePoint *point, dataPoints_)
+    if (!slice) foreach(RideFilePoint *point, dataPoints_)
+        deletePointStorage(point); // the arena frees the rest in one go
+    foreach(RideFilePoint *point, referencePoints_)
         delete point;
     delete command;
     //!!! if (data) delete data; // need a mechanism to notify the editor
 }
 
+// slabs start small for short rides and grow to a year's worth quickly
+static const int arenaMinSlab = 256;
+static const int arenaMaxSlab = 8192;
+
+RideFilePointArena::~RideFilePointArena()
+{
+    // points have nothing to destruct
+    foreach(RideFilePoint *slab, slabs) ::operator delete(slab);
+}
+
+RideFilePoint *
+RideFilePointArena::alloc(const RideFilePoint &point)
+{
+    if (next == size) {
+        size = size ? qMin(size * 2, arenaMaxSlab) : arenaMinSlab;
+        slabs << static_cast<RideFilePoint*>(::operator new(size * sizeof(RideFilePoint)));
+        sizes << size;
+        next = 0;
+    }
+    return new (slabs.last() + next++) RideFilePoint(point);
+}
+
+bool
+RideFilePointArena::owns(const RideFilePoint *point) const
+{
+    quintptr p = quintptr(point);
+    for (int i=slabs.count()-1; i>=0; i--) {
+        quintptr from = quintptr(slabs[i]);
+        if (p >= from && p < from + sizes[i] * sizeof(RideFilePoint)) return true;
+    }
+    return false;
+}
+
+void
+RideFile::deletePointStorage(RideFilePoint *point)
+{
+    if (!arena.owns(point)) delete point;
+}
+
 QString
 RideFile::seriesName(SeriesType series)
 {
@@ -236,24 +336,94 @@ int RideFileFactory::registerReader(const QString &suffix,
                                     const QString &description,
                                        RideFileReader *reader)
 {
-    assert(!readFuncs_.contains(suffix));
-    readFuncs_.insert(suffix, reader);
+    assert(!formats_.contains(suffix));
+    Format format;
+    format.reader = reader;
+    format.writes = reader->hasWrite();
+    formats_.insert(suffix, format);
+    descriptions_.insert(suffix, description);
+    return 1;
+}
+
+int RideFileFactory::registerReader(const QString &suffix,
+                                    const QString &description,
+                                    RideFileReaderMaker maker, bool writes,
+                                    const QByteArray &magic, int offset)
+{
+    assert(!formats_.contains(suffix));
+    Format format;
+    format.maker = maker;
+    format.writes = writes;
+    format.magic = magic;
+    format.offset = offset;
+    formats_.insert(suffix, format);
     descriptions_.insert(suffix, description);
+    if (!magic.isEmpty()) magicLength_ = qMax(magicLength_, offset + magic.length());
     return 1;
 }
 
+RideFileReader *RideFileFactory::reader(const Format &format) const
+{
+    // files are opened from the refresh threads too
+    QMutexLocker locker(&makeLock_);
+    if (!format.reader && format.maker) format.reader = format.maker();
+    return format.reader;
+}
+
+RideFileReader *RideFileFactory::reader(const QString &suffix) const
+{
+    QMap<QString,Format>::const_iterator i = formats_.find(suffix.toLower());
+    return i == formats_.end() ? NULL : reader(i.value());
+}
+
+// the reader for the suffix, unless the file has the magic of another
+// format, which happens when a device names its files loosely
+RideFileReader *RideFileFactory::reader(QFile &file) const
+{
+    QString suffix = QFileInfo(file.fileName()).suffix().toLower();
+    QMap<QString,Format>::const_iterator i = formats_.find(suffix);
+
+    // only formats with magic are worth looking at before parsing
+    if (i == formats_.end() || !i.value().magic.isEmpty()) {
+        QString sniffed = sniff(file);
+        if (!sniffed.isEmpty()) return reader(sniffed);
+    }
+    return i == formats_.end() ? NULL : reader(i.value());
+}
+
+QString RideFileFactory::sniff(QFile &file) const
+{
+    if (!magicLength_) return QString();
+
+    QByteArray head;
+    if (file.isOpen()) head = file.peek(magicLength_);
+    else if (file.open(QIODevice::ReadOnly)) {
+        head = file.read(magicLength_);
+        file.close();
+    }
+
+    QMapIterator<QString,Format> i(formats_);
+    while (i.hasNext()) {
+        i.next();
+        const Format &format = i.value();
+        if (!format.magic.isEmpty() && head.mid(format.offset, format.magic.length()) == format.magic)
+            return i.key();
+    }
+    return QString();
+}
+
 QStringList RideFileFactory::suffixes() const
 {
-    return readFuncs_.keys();
+    return formats_.keys();
 }
 
 QStringList RideFileFactory::writeSuffixes() const
 {
     QStringList returning;
-    QMapIterator<QString,RideFileReader*> i(readFuncs_);
+    QMapIterator<QString,Format> i(formats_);
     while (i.hasNext()) {
         i.next();
-        if (i.value()->hasWrite()) returning << i.key();
+        if (i.value().writes) returning << i.key();
     }
     return returning;
 }
@@ -270,120 +440,177 @@ bool
 RideFileFactory::writeRideFile(Context *context, const RideFile *ride, QFile &file, QString format) const
 {
     // get the ride file writer for this format
-    RideFileReader *reader = readFuncs_.value(format.toLower());
+    RideFileReader *writer = reader(format);
 
     // write away
-    if (!reader) return false;
-    else return reader->writeRideFile(context, ride, file);
+    if (!writer) return false;
+    else return writer->writeRideFile(context, ride, file);
+}
+
+// the date and time from a filename in the GC format, yyyy_MM_dd_hh_mm_ss.ext
+// this is checked on every open and for every file listed, so we avoid
+// compiling a QRegExp each time (and they are not safe to share across threads)
+static bool gcFileNameDateTime(const QString &name, QDate &date, QTime &time)
+{
+    // fixed positions of the underscores, dot and digits
+    if (name.length() < 21 || name[19] != '.') return false;
+
+    int field[6];
+    for (int f=0; f<6; f++) {
+        int from = f ? 2 + f*3 : 0;
+        int len = f ? 2 : 4;
+        if (f && name[from-1] != '_') return false;
+
+        int value = 0;
+        for (int i=from; i<from+len; i++) {
+            if (!name[i].isDigit()) return false;
+            value = value*10 + name[i].digitValue();
+        }
+        field[f] = value;
+    }
+    date = QDate(field[0], field[1], field[2]);
+    time = QTime(field[3], field[4], field[5]);
+    return true;
 }
 
 RideFile *RideFileFactory::openRideFile(Context *context, QFile &file,
-                                           QStringList &errors, QList<RideFile*> *rideList) const
-{
-    QString suffix = file.fileName();
-    int dot = suffix.lastIndexOf(".");
-    assert(dot >= 0);
-    suffix.remove(0, dot + 1);
-    RideFileReader *reader = readFuncs_.value(suffix.toLower());
-    assert(reader);
-//qDebug()<<"open"<<file.fileName()<<"start:"<<QDateTime::currentDateTime().toString("hh:mm:ss.zzz");
+                                           QStringList &errors, QList<RideFile*> *rideList, bool bulk) const
+{
+    GC_TRACE_SPAN("open ride");
+    RideFileReader *reader = this->reader(file);
+    if (!reader) {
+        errors << QObject::tr("Unknown file type: %1").arg(file.fileName());
+        return NULL;
+    }
     RideFile *result = reader->openRideFile(file, errors, rideList);
-//qDebug()<<"open"<<file.fileName()<<"end:"<<QDateTime::currentDateTime().toString("hh:mm:ss.zzz");
 
     // NULL returned to indicate openRide failed
-    if (result) {
-        result->context = context;
-        if (result->intervals().empty()) result->fillInIntervals();
+    if (result) finishRideFile(context, file, result, bulk);
 
+    return result;
+}
 
-        // override the file ride time with that set from the filename
-        // but only if it matches the GC format
-        QFileInfo fileInfo(file.fileName());
-        QRegExp rx ("^((\\d\\d\\d\\d)_(\\d\\d)_(\\d\\d)_(\\d\\d)_(\\d\\d)_(\\d\\d))\\.(.+)$");
+RideFile *RideFileFactory::openRideFileSeries(Context *context, QFile &file,
+                                             QStringList &errors, const RideFileDataPresent &wanted) const
+{
+    GC_TRACE_SPAN("open ride series");
+    RideFileReader *reader = this->reader(file);
+    if (!reader) {
+        errors << QObject::tr("Unknown file type: %1").arg(file.fileName());
+        return NULL;
+    }
 
-        if (rx.exactMatch(fileInfo.fileName())) {
+    RideFile *result = reader->openRideFileSeries(file, errors, wanted);
+    if (result) finishRideFile(context, file, result, true);
 
-            QDate date(rx.cap(2).toInt(), rx.cap(3).toInt(),rx.cap(4).toInt());
-            QTime time(rx.cap(5).toInt(), rx.cap(6).toInt(),rx.cap(7).toInt());
-            QDateTime datetime(date, time);
-            result->setStartTime(datetime);
-        }
+    return result;
+}
 
-        // legacy support for .notes file
-        QString notesFileName = fileInfo.absolutePath() + '/' + fileInfo.baseName() + ".notes";
-        QFile notesFile(notesFileName);
+bool RideFileFactory::splitRideFile(QFile &file, QStringList &errors, RideFileSplitter *splitter) const
+{
+    RideFileReader *reader = this->reader(file);
 
-        // read it in if it exists and "Notes" is not already set
-        if (result->getTag("Notes", "") == "" && notesFile.exists() &&
-            notesFile.open(QFile::ReadOnly | QFile::Text)) {
-            QTextStream in(&notesFile);
-            result->setTag("Notes", in.readAll());
-            notesFile.close();
-        }
+    return reader && reader->splitRideFile(file, errors, splitter);
+}
 
-        // Construct the summary text used on the calendar
-        QString calendarText;
-        foreach (FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
-            if (field.diary == true && result->getTag(field.name, "") != "") {
-                calendarText += QString("%1\n")
-                        .arg(result->getTag(field.name, ""));
-            }
-        }
-        result->setTag("Calendar Text", calendarText);
-
-        // set other "special" fields
-        result->setTag("Filename", QFileInfo(file.fileName()).fileName());
-        result->setTag("Device", result->deviceType());
-        result->setTag("File Format", result->fileFormat());
-        result->setTag("Athlete", QFileInfo(file).dir().dirName());
-        result->setTag("Year", result->startTime().toString("yyyy"));
-        result->setTag("Month", result->startTime().toString("MMMM"));
-        result->setTag("Weekday", result->startTime().toString("ddd"));
-
-        // calculate derived data series
-        result->recalculateDerivedSeries();
+void RideFileFactory::finishRideFile(Context *context, QFile &file, RideFile *result, bool bulk) const
+{
+    result->context = context;
+    if (result->intervals().empty()) result->fillInIntervals();
+
+
+    // override the file ride time with that set from the filename
+    // but only if it matches the GC format
+    QFileInfo fileInfo(file.fileName());
+    QDate date;
+    QTime time;
+
+    if (gcFileNameDateTime(fileInfo.fileName(), date, time)) {
+
+        QDateTime datetime(date, time);
+        result->setStartTime(datetime);
+    }
 
+    // bulk readers (e.g. .cpx refresh) only want the data, the
+    // tags below are for display and the metadata database
+    if (bulk) {
+        result->recalculateDerivedSeries();
         DataProcessorFactory::instance().autoProcess(result);
+        return;
+    }
 
-        // what data is present - after processor in case 'derived' or adjusted
-        QString flags;
-
-        if (result->areDataPresent()->secs) flags += 'T'; // time
-        else flags += '-';
-        if (result->areDataPresent()->km) flags += 'D'; // distance
-        else flags += '-';
-        if (result->areDataPresent()->kph) flags += 'S'; // speed
-        else flags += '-';
-        if (result->areDataPresent()->watts) flags += 'P'; // Power
-        else flags += '-';
-        if (result->areDataPresent()->hr) flags += 'H'; // Heartrate
-        else flags += '-';
-        if (result->areDataPresent()->cad) flags += 'C'; // cadence
-        else flags += '-';
-        if (result->areDataPresent()->nm) flags += 'N'; // Torque
-        else flags += '-';
-        if (result->areDataPresent()->alt) flags += 'A'; // Altitude
-        else flags += '-';
-        if (result->areDataPresent()->lat ||
-            result->areDataPresent()->lon ) flags += 'G'; // GPS
-        else flags += '-';
-        if (result->areDataPresent()->headwind) flags += 'W'; // Windspeed
-        else flags += '-';
-        if (result->areDataPresent()->temp) flags += 'E'; // Temperature
-        else flags += '-';
-        if (result->areDataPresent()->lrbalance) flags += 'B'; // Left/Right Balance, TODO Walibu, unsure about this flag? 'B' ok?
-        else flags += '-';
-        result->setTag("Data", flags);
+    // legacy support for .notes file
+    QString notesFileName = fileInfo.absolutePath() + '/' + fileInfo.baseName() + ".notes";
+    QFile notesFile(notesFileName);
 
+    // read it in if it exists and "Notes" is not already set
+    if (result->getTag("Notes", "") == "" && notesFile.exists() &&
+        notesFile.open(QFile::ReadOnly | QFile::Text)) {
+        QTextStream in(&notesFile);
+        result->setTag("Notes", in.readAll());
+        notesFile.close();
     }
 
-    return result;
+    // Construct the summary text used on the calendar
+    QString calendarText;
+    foreach (FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
+        if (field.diary == true && result->getTag(field.name, "") != "") {
+            calendarText += QString("%1\n")
+                    .arg(result->getTag(field.name, ""));
+        }
+    }
+    result->setTag("Calendar Text", calendarText);
+
+    // set other "special" fields
+    result->setTag("Filename", QFileInfo(file.fileName()).fileName());
+    result->setTag("Device", result->deviceType());
+    result->setTag("File Format", result->fileFormat());
+    result->setTag("Athlete", QFileInfo(file).dir().dirName());
+    result->setTag("Year", result->startTime().toString("yyyy"));
+    result->setTag("Month", result->startTime().toString("MMMM"));
+    result->setTag("Weekday", result->startTime().toString("ddd"));
+
+    // calculate derived data series
+    result->recalculateDerivedSeries();
+
+    DataProcessorFactory::instance().autoProcess(result);
+
+    // what data is present - after processor in case 'derived' or adjusted
+    QString flags;
+
+    if (result->areDataPresent()->secs) flags += 'T'; // time
+    else flags += '-';
+    if (result->areDataPresent()->km) flags += 'D'; // distance
+    else flags += '-';
+    if (result->areDataPresent()->kph) flags += 'S'; // speed
+    else flags += '-';
+    if (result->areDataPresent()->watts) flags += 'P'; // Power
+    else flags += '-';
+    if (result->areDataPresent()->hr) flags += 'H'; // Heartrate
+    else flags += '-';
+    if (result->areDataPresent()->cad) flags += 'C'; // cadence
+    else flags += '-';
+    if (result->areDataPresent()->nm) flags += 'N'; // Torque
+    else flags += '-';
+    if (result->areDataPresent()->alt) flags += 'A'; // Altitude
+    else flags += '-';
+    if (result->areDataPresent()->lat ||
+        result->areDataPresent()->lon ) flags += 'G'; // GPS
+    else flags += '-';
+    if (result->areDataPresent()->headwind) flags += 'W'; // Windspeed
+    else flags += '-';
+    if (result->areDataPresent()->temp) flags += 'E'; // Temperature
+    else flags += '-';
+    if (result->areDataPresent()->lrbalance) flags += 'B'; // Left/Right Balance, TODO Walibu, unsure about this flag? 'B' ok?
+    else flags += '-';
+    result->setTag("Data", flags);
+
 }
 
 QStringList RideFileFactory::listRideFiles(const QDir &dir) const
 {
     QStringList filters;
-    QMapIterator<QString,RideFileReader*> i(readFuncs_);
+    QMapIterator<QString,Format> i(formats_);
     while (i.hasNext()) {
         i.next();
         filters << ("*." + i.key());
@@ -520,8 +747,9 @@ void RideFile::appendPoint(double secs, double cad, double hr, double km,
     //                                 point on Earth (Mt Everest).
     if (alt > RideFile::maximumFor(RideFile::alt)) alt = RideFile::maximumFor(RideFile::alt);
 
-    RideFilePoint* point = new RideFilePoint(secs, cad, hr, km, kph,
-                                             nm, watts, alt, lon, lat, headwind, slope, temp, lrbalance, interval);
+    RideFilePoint* point = arena.alloc(RideFilePoint(secs, cad, hr, km, kph,
+                                             nm, watts, alt, lon, lat, headwind, slope, temp, lrbalance, interval));
+    sharedChanged(dataPoints_.count());
     dataPoints_.append(point);
 
     dataPresent.secs     |= (secs != 0);
@@ -545,10 +773,171 @@ void RideFile::appendPoint(double secs, double cad, double hr, double km,
     updateAvg(point);
 }
 
+RideFile *
+RideFile::copyRange(int start, int stop) const
+{
+    RideFile *returning = new RideFile;
+
+    start = qMax(0, start);
+    stop = qMin(stop, dataPoints_.count());
+
+    // set offset in seconds and distance
+    double offset = 0, distanceoffset = 0;
+    if (start < dataPoints_.count()) {
+        offset = dataPoints_[start]->secs;
+        distanceoffset = dataPoints_[start]->km;
+    }
+
+    // copy first class variables (adjust starttime to include offset)
+    returning->setStartTime(startTime_.addSecs(offset));
+    returning->setRecIntSecs(recIntSecs_);
+    returning->setDeviceType(deviceType_);
+    returning->setFileFormat(fileFormat_);
+    returning->tags_ = tags_;
+
+    if (stop <= start) return returning;
+
+    // now the dataPoints, in one allocation for the vector
+    returning->reservePoints(stop - start);
+    for (int i=start; i<stop; i++) {
+        const RideFilePoint *p = dataPoints_[i];
+        returning->appendPoint(p->secs - offset, // start from zero!
+                               p->cad, p->hr, p->km - distanceoffset, p->kph,
+                               p->nm, p->watts, p->alt, p->lon, p->lat,
+                               p->headwind, p->slope, p->temp, p->lrbalance, p->interval);
+    }
+
+    // keep intervals that start in our section truncating them
+    // if neccessary (some folks want to keep lap markers)
+    double startTime = dataPoints_[start]->secs;
+    double stopTime = dataPoints_[qMin(stop, dataPoints_.count()-1)]->secs;
+    foreach (RideFileInterval interval, intervals_) {
+
+        if (interval.start >= startTime && interval.start <= stopTime) {
+            if (interval.stop > stopTime)
+                returning->addInterval(interval.start - offset, stopTime - offset, interval.name);
+            else
+                returning->addInterval(interval.start - offset, interval.stop - offset, interval.name);
+        }
+    }
+    return returning;
+}
+
+RideFile *
+RideFile::snapshot() const
+{
+    RideFile *returning = new RideFile(startTime_, recIntSecs_);
+
+    returning->id_ = id_;
+    returning->deviceType_ = deviceType_;
+    returning->fileFormat_ = fileFormat_;
+    returning->tags_ = tags_;
+    returning->metricOverrides = metricOverrides;
+    returning->dataPresent = dataPresent;
+    returning->intervals_ = intervals_;
+    returning->calibrations_ = calibrations_;
+
+    returning->dataPoints_.reserve(dataPoints_.count());
+    foreach (const RideFilePoint *p, dataPoints_) returning->dataPoints_.append(returning->newPoint(*p));
+    foreach (const RideFilePoint *p, referencePoints_) returning->referencePoints_.append(new RideFilePoint(*p));
+
+    return returning;
+}
+
+RideFileSnapshot
+RideFile::sharedSnapshot()
+{
+    // the derived series are kept in the points
+    recalculateDerivedSeries();
+
+    const int size = RideFileSnapshotData::blockSize;
+    int count = dataPoints_.count();
+    int blocks = (count + size - 1) / size;
+
+    RideFileSnapshotData *d = new RideFileSnapshotData;
+    d->revision = ++sharedRevision;
+    d->id = id_;
+    d->deviceType = deviceType_;
+    d->fileFormat = fileFormat_;
+    d->startTime = startTime_;
+    d->recIntSecs = recIntSecs_;
+    d->dataPresent = dataPresent;
+    d->intervals = intervals_;
+    d->calibrations = calibrations_;
+    d->tags = tags_;
+    d->metricOverrides = metricOverrides;
+    foreach (const RideFilePoint *p, referencePoints_) d->referencePoints.append(*p);
+
+    // copy the blocks that changed, share the rest with the last one
+    d->count = count;
+    d->blocks.resize(blocks);
+    for (int b=0; b<blocks; b++) {
+        int from = b * size;
+        int n = qMin(size, count - from);
+
+        if (shared && b < sharedFrom && b < shared->blocks.count() && !sharedDirty[b]
+            && shared->blocks[b]->count() == n) {
+            d->blocks[b] = shared->blocks[b];
+            continue;
+        }
+
+        QVector<RideFilePoint> *points = new QVector<RideFilePoint>;
+        points->reserve(n);
+        for (int i=from; i<from+n; i++) points->append(*dataPoints_[i]);
+        d->blocks[b] = QSharedPointer<const QVector<RideFilePoint> >(points);
+    }
+
+    shared = QSharedPointer<const RideFileSnapshotData>(d);
+    sharedDirty.fill(false, blocks);
+    sharedFrom = blocks;
+
+    return RideFileSnapshot(shared);
+}
+
+void
+RideFile::sharedChanged(int from, int to)
+{
+    if (!shared) return; // the first snapshot copies everything anyway
+
+    const int size = RideFileSnapshotData::blockSize;
+    int first = qMax(0, from) / size;
+    if (to < 0) {
+        sharedFrom = qMin(sharedFrom, first);
+    } else {
+        int last = qMin(to / size, sharedDirty.count()-1);
+        for (int b=first; b<=last; b++) sharedDirty[b] = true;
+    }
+}
+
+RideFile *
+RideFileSnapshot::toRideFile() const
+{
+    if (!d) return NULL;
+
+    RideFile *returning = new RideFile(d->startTime, d->recIntSecs);
+
+    returning->id_ = d->id;
+    returning->deviceType_ = d->deviceType;
+    returning->fileFormat_ = d->fileFormat;
+    returning->tags_ = d->tags;
+    returning->metricOverrides = d->metricOverrides;
+    returning->dataPresent = d->dataPresent;
+    returning->intervals_ = d->intervals;
+    returning->calibrations_ = d->calibrations;
+
+    returning->dataPoints_.reserve(d->count);
+    foreach (const QSharedPointer<const QVector<RideFilePoint> > &block, d->blocks)
+        foreach (const RideFilePoint &p, *block) returning->dataPoints_.append(returning->newPoint(p));
+    foreach (const RideFilePoint &p, d->referencePoints) returning->referencePoints_.append(new RideFilePoint(p));
+
+    return returning;
+}
+
 void RideFile::appendPoint(const RideFilePoint &point)
 {
-    dataPoints_.append(new RideFilePoint(point.secs,point.cad,point.hr,point.km,point.kph,point.nm,point.watts,point.alt,point.lon,point.lat,
-                                         point.headwind, point.slope, point.temp, point.lrbalance, point.interval));
+    sharedChanged(dataPoints_.count());
+    dataPoints_.append(arena.alloc(RideFilePoint(point.secs,point.cad,point.hr,point.km,point.kph,point.nm,point.watts,point.alt,point.lon,point.lat,
+                                         point.headwind, point.slope, point.temp, point.lrbalance, point.interval)));
 }
 
 void
@@ -622,6 +1011,47 @@ RideFile::setPointValue(int index, SeriesType series, double value)
         default:
         case none : break;
     }
+
+    sharedChanged(index, index);
+
+    // appended points are noticed by seriesData() but not changes
+    if (series >= secs && series < none) {
+        QMutexLocker locker(&columnLock);
+        cstale[series] = true;
+    }
+}
+
+// a run of consecutive rows in one series, as kept by the undo stack
+void
+RideFile::setPointValues(int index, SeriesType series, const double *values, int count)
+{
+    double RideFilePoint::*field;
+    switch (series) {
+        case secs : field = &RideFilePoint::secs; break;
+        case cad : field = &RideFilePoint::cad; break;
+        case hr : field = &RideFilePoint::hr; break;
+        case km : field = &RideFilePoint::km; break;
+        case kph : field = &RideFilePoint::kph; break;
+        case nm : field = &RideFilePoint::nm; break;
+        case watts : field = &RideFilePoint::watts; break;
+        case alt : field = &RideFilePoint::alt; break;
+        case lon : field = &RideFilePoint::lon; break;
+        case lat : field = &RideFilePoint::lat; break;
+        case headwind : field = &RideFilePoint::headwind; break;
+        case slope : field = &RideFilePoint::slope; break;
+        case temp : field = &RideFilePoint::temp; break;
+        case lrbalance : field = &RideFilePoint::lrbalance; break;
+        default:
+            // interval isn't a double
+            for (int i=0; i<count; i++) setPointValue(index+i, series, values[i]);
+            return;
+    }
+
+    for (int i=0; i<count; i++) dataPoints_[index+i]->*field = values[i];
+    sharedChanged(index, index+count-1);
+
+    QMutexLocker locker(&columnLock);
+    cstale[series] = true;
 }
 
 double
@@ -783,34 +1213,53 @@ RideFile::minimumFor(SeriesType series)
 void
 RideFile::deletePoint(int index)
 {
-    delete dataPoints_[index];
+    deletePointStorage(dataPoints_[index]);
     dataPoints_.remove(index);
+    sharedChanged(index);
+    columnsChanged();
 }
 
 void
 RideFile::deletePoints(int index, int count)
 {
-    for(int i=index; i<(index+count); i++) delete dataPoints_[i];
+    for(int i=index; i<(index+count); i++) deletePointStorage(dataPoints_[i]);
     dataPoints_.remove(index, count);
+    sharedChanged(index);
+    columnsChanged();
 }
 
 void
 RideFile::insertPoint(int index, RideFilePoint *point)
 {
     dataPoints_.insert(index, point);
+    sharedChanged(index);
+    columnsChanged();
+}
+
+void
+RideFile::insertPoints(int index, QVector <struct RideFilePoint *> points)
+{
+    // make room once rather than shuffling up for every point
+    dataPoints_.insert(index, points.count(), NULL);
+    for (int i=0; i<points.count(); i++) dataPoints_[index+i] = points[i];
+    sharedChanged(index);
+    columnsChanged();
 }
 
 void
 RideFile::appendPoints(QVector <struct RideFilePoint *> newRows)
 {
+    sharedChanged(dataPoints_.count());
     dataPoints_ += newRows;
+    columnsChanged();
 }
 
 void
 RideFile::emitSaved()
 {
     weight_ = 0;
-    dstale = true;
+    derivedChanged(0);
+    columnsChanged();
     emit saved();
 }
 
@@ -818,18 +1267,196 @@ void
 RideFile::emitReverted()
 {
     weight_ = 0;
-    dstale = true;
+    derivedChanged(0);
+    columnsChanged();
     emit reverted();
 }
 
 void
 RideFile::emitModified()
+{
+    emitModified(0);
+}
+
+void
+RideFile::emitModified(int index)
 {
     weight_ = 0;
-    dstale = true;
+    derivedChanged(index);
+    columnsChanged();
+    {
+        QMutexLocker locker(&intervalLock);
+        intervalMetrics.clear();
+    }
     emit modified();
 }
 
+void
+RideFile::derivedChanged(int index)
+{
+    if (index < 0) return; // derived data not affected
+
+    if (dstale == false || index < dfrom) dfrom = index;
+    dstale = true;
+
+    // recalculating rewrites the points from there on
+    sharedChanged(index);
+}
+
+void
+RideFile::columnsChanged()
+{
+    QMutexLocker locker(&columnLock);
+    for (int i=0; i<none; i++) {
+        cstale[i] = true;
+        cbuilt[i] = 0;
+    }
+}
+
+// a column from the points with the series chosen up front
+template<int series>
+static void fillColumn(double *into, RideFilePoint * const *from, int count)
+{
+    for (int i=0; i<count; i++) into[i] = RideFilePointField<series>::get(*from[i]);
+}
+
+const QVector<double> &
+RideFile::seriesData(SeriesType series) const
+{
+    static const QVector<double> empty;
+    if (series < secs || series >= none) return empty;
+
+    QMutexLocker locker(&columnLock);
+
+    if (cstale[series] || columns[series].count() != dataPoints_.count()) {
+
+        QVector<double> &column = columns[series];
+        column.resize(dataPoints_.count());
+
+        double *into = column.data();
+        RideFilePoint * const *from = dataPoints_.constData();
+        int n = dataPoints_.count();
+        switch (series) {
+            case RideFile::secs : fillColumn<RideFile::secs>(into, from, n); break;
+            case RideFile::cad : fillColumn<RideFile::cad>(into, from, n); break;
+            case RideFile::hr : fillColumn<RideFile::hr>(into, from, n); break;
+            case RideFile::km : fillColumn<RideFile::km>(into, from, n); break;
+            case RideFile::kph : fillColumn<RideFile::kph>(into, from, n); break;
+            case RideFile::nm : fillColumn<RideFile::nm>(into, from, n); break;
+            case RideFile::watts : fillColumn<RideFile::watts>(into, from, n); break;
+            case RideFile::alt : fillColumn<RideFile::alt>(into, from, n); break;
+            case RideFile::lon : fillColumn<RideFile::lon>(into, from, n); break;
+            case RideFile::lat : fillColumn<RideFile::lat>(into, from, n); break;
+            case RideFile::headwind : fillColumn<RideFile::headwind>(into, from, n); break;
+            case RideFile::slope : fillColumn<RideFile::slope>(into, from, n); break;
+            case RideFile::temp : fillColumn<RideFile::temp>(into, from, n); break;
+            case RideFile::lrbalance : fillColumn<RideFile::lrbalance>(into, from, n); break;
+            case RideFile::interval : fillColumn<RideFile::interval>(into, from, n); break;
+            case RideFile::NP : fillColumn<RideFile::NP>(into, from, n); break;
+            case RideFile::xPower : fillColumn<RideFile::xPower>(into, from, n); break;
+            case RideFile::aPower : fillColumn<RideFile::aPower>(into, from, n); break;
+            default: column.fill(0.0); break;
+        }
+
+        cstale[series] = false;
+        cbuilt[series] = ++columnBuilds;
+    }
+    return columns[series];
+}
+
+QVector<double>
+RideFile::scaledSeriesData(SeriesType series, double factor, bool positive) const
+{
+    const QVector<double> &column = seriesData(series);
+
+    bool same = (factor == 1.0);
+    for (int i=0; same && positive && i<column.count(); i++)
+        if (column[i] < 0) same = false;
+    if (same) return column;
+
+    QVector<double> returning(column.count());
+    for (int i=0; i<column.count(); i++) {
+        double value = column[i] * factor;
+        returning[i] = (positive && value < 0) ? 0 : value;
+    }
+    return returning;
+}
+
+int
+RideFile::resampledStart() const
+{
+    return dataPoints_.isEmpty() ? 0 : floor(dataPoints_.first()->secs);
+}
+
+const QVector<float> &
+RideFile::resampledData(SeriesType series) const
+{
+    static const QVector<float> empty;
+    if (series < secs || series >= none) return empty;
+
+    // bring the columns up to date first
+    const QVector<double> &times = seriesData(secs);
+    const QVector<double> &values = seriesData(series);
+    int built[2];
+    {
+        QMutexLocker locker(&columnLock);
+        built[0] = cbuilt[series];
+        built[1] = cbuilt[secs];
+    }
+
+    QMutexLocker locker(&resampleLock);
+    QVector<float> &into = resampled[series];
+    if (rbuilt[series][0] == built[0] && rbuilt[series][1] == built[1] && built[0] && built[1])
+        return into;
+
+    into.resize(0);
+    rbuilt[series][0] = built[0];
+    rbuilt[series][1] = built[1];
+
+    int n = times.count();
+    if (n == 0) return into;
+
+    // no single ride is longer than 2 days, even RAAM
+    int start = floor(times[0]);
+    int last = floor(times[n-1]);
+    if (last < start || last - start > 2*24*60*60) return into;
+
+    into.fill(0, last - start + 1);
+
+    // a gap is at least one sample missing
+    double gap = 2 * recIntSecs_;
+
+    if (recIntSecs_ > 0 && recIntSecs_ < 1) {
+
+        // faster than 1s, average the samples within each second
+        QVector<int> counts(into.count(), 0);
+        for (int i=0; i<n; i++) {
+            int t = floor(times[i]) - start;
+            if (t < 0 || t >= into.count()) continue; // time going backwards
+            into[t] += values[i];
+            counts[t]++;
+        }
+        for (int t=0; t<into.count(); t++) if (counts[t]) into[t] /= counts[t];
+
+    } else {
+
+        // interpolate each second between the samples either side
+        int k = 0;
+        for (int t=0; t<into.count(); t++) {
+            double secs = start + t;
+            while (k < n-1 && times[k+1] <= secs) k++;
+
+            if (times[k] == secs || k == n-1) {
+                into[t] = times[k] == secs ? values[k] : 0;
+            } else if (times[k] < secs && times[k+1] - times[k] < gap) {
+                double ratio = (secs - times[k]) / (times[k+1] - times[k]);
+                into[t] = values[k] + (values[k+1] - values[k]) * ratio;
+            }
+        }
+    }
+    return into;
+}
+
 double
 RideFile::getWeight()
 {
@@ -841,18 +1468,10 @@ RideFile::getWeight()
     }
 
     // withings?
-    QList<SummaryMetrics> measures = context->athlete->metricDB->getAllMeasuresFor(QDateTime::fromString("Jan 1 00:00:00 1900"), startTime());
-    int i = measures.count()-1;
-    if (i) {
-        while (i>=0) {
-            if ((weight_ = measures[i].getText("Weight", "0.0").toDouble()) > 0) {
-               return weight_;
-            }
-            i--;
-        }
+    if ((weight_ = context->athlete->metricDB->weights().at(startTime().date())) > 0) {
+        return weight_;
     }
 
-
     // global options
     weight_ = appsettings->cvalue(context->athlete->cyclist, GC_WEIGHT, "75.0").toString().toDouble(); // default to 75kg
 
@@ -877,14 +1496,10 @@ void RideFile::removeReference(int index)
 bool
 RideFile::parseRideFileName(const QString &name, QDateTime *dt)
 {
-    static char rideFileRegExp[] = "^((\\d\\d\\d\\d)_(\\d\\d)_(\\d\\d)"
-                                   "_(\\d\\d)_(\\d\\d)_(\\d\\d))\\.(.+)$";
-    QRegExp rx(rideFileRegExp);
-    if (!rx.exactMatch(name))
+    QDate date;
+    QTime time;
+    if (!gcFileNameDateTime(name, date, time))
             return false;
-    assert(rx.numCaptures() == 8);
-    QDate date(rx.cap(2).toInt(), rx.cap(3).toInt(),rx.cap(4).toInt());
-    QTime time(rx.cap(5).toInt(), rx.cap(6).toInt(),rx.cap(7).toInt());
     if ((! date.isValid()) || (! time.isValid())) {
 	QMessageBox::warning(NULL,
 			     tr("Invalid Activity File Name"),
@@ -905,6 +1520,9 @@ RideFile::parseRideFileName(const QString &name, QDateTime *dt)
 // performance." Journal of Applied Physiology 70:399-404
 //
 
+// checkpoints in the derived series calculation are this many points apart
+static const int derivedStride = 1024;
+
 void
 RideFile::recalculateDerivedSeries()
 {
@@ -943,7 +1561,77 @@ RideFile::recalculateDerivedSeries()
     double APtotal=0;
     double APcount=0;
 
-    foreach(RideFilePoint *p, dataPoints_) {
+    //
+    // Resume from the last checkpoint before the first changed point, so
+    // long as the recording interval and series present haven't changed
+    //
+    int start = 0;
+    int checkpoint = qMin(dfrom / derivedStride, derivedStates.count() - 1);
+    if (checkpoint > 0 && derivedStates[checkpoint].recIntSecs == recIntSecs_
+        && derivedStates[checkpoint].watts == dataPresent.watts
+        && derivedStates[checkpoint].alt == dataPresent.alt) {
+
+        const DerivedState &state = derivedStates[checkpoint];
+        NProlling = state.NProlling;
+        NPtotal = state.NPtotal;
+        NPsum = state.NPsum;
+        NPcount = state.NPcount;
+        NPindex = state.NPindex;
+        XPlastSecs = state.XPlastSecs;
+        XPweighted = state.XPweighted;
+        XPtotal = state.XPtotal;
+        XPcount = state.XPcount;
+        APtotal = state.APtotal;
+        APcount = state.APcount;
+        minPoint->np = state.minNP;
+        maxPoint->np = state.maxNP;
+        minPoint->xp = state.minXP;
+        maxPoint->xp = state.maxXP;
+        minPoint->apower = state.minAP;
+        maxPoint->apower = state.maxAP;
+
+        start = checkpoint * derivedStride;
+        derivedStates.resize(checkpoint);
+
+    } else {
+        derivedStates.clear();
+
+        // no gaps, so it can be done a series at a time
+        if (recalculateDerivedRegular()) {
+            dstale=false;
+            return;
+        }
+    }
+
+    for (int i=start; i<dataPoints_.count(); i++) {
+
+        RideFilePoint *p = dataPoints_[i];
+
+        // remember where we were in case we get edited
+        if (i % derivedStride == 0) {
+            DerivedState state;
+            state.recIntSecs = recIntSecs_;
+            state.watts = dataPresent.watts;
+            state.alt = dataPresent.alt;
+            state.NProlling = NProlling;
+            state.NPtotal = NPtotal;
+            state.NPsum = NPsum;
+            state.NPcount = NPcount;
+            state.NPindex = NPindex;
+            state.XPlastSecs = XPlastSecs;
+            state.XPweighted = XPweighted;
+            state.XPtotal = XPtotal;
+            state.XPcount = XPcount;
+            state.APtotal = APtotal;
+            state.APcount = APcount;
+            state.minNP = minPoint->np;
+            state.maxNP = maxPoint->np;
+            state.minXP = minPoint->xp;
+            state.maxXP = maxPoint->xp;
+            state.minAP = minPoint->apower;
+            state.maxAP = maxPoint->apower;
+            derivedStates << state;
+        }
 
         //
         // NP
@@ -1055,6 +1743,156 @@ RideFile::recalculateDerivedSeries()
     avgPoint->apower = APcount ? (APtotal / APcount) : 0;
     totalPoint->apower = APtotal;
 
+    // derived columns need refreshing
+    columnLock.lock();
+    cstale[NP] = cstale[xPower] = cstale[aPower] = true;
+    columnLock.unlock();
+
     // and we're done
     dstale=false;
 }
+
+// Recalculating the derived series for the whole ride when there are no gaps
+// in recording, the usual case. With no gaps xPower never has to decay over
+// missing samples, so each series can be worked out as a straight loop over
+// the columns, which the compiler can vectorize, rather than point by point
+// with the branches above. The results and checkpoints are the same as the
+// point by point loop. False if the ride isn't suitable, when nothing is done.
+bool
+RideFile::recalculateDerivedRegular()
+{
+    int n = dataPoints_.count();
+    if (!dataPresent.watts || n == 0) return false;
+
+    static const double EPSILON = 0.1;
+    double XPsecsDelta = recIntSecs_ ? recIntSecs_ : 1;
+
+    const double *times = seriesData(secs).constData();
+    for (int i=1; i<n; i++) if (times[i] > times[i-1] + XPsecsDelta + EPSILON) return false;
+
+    const double *watts = seriesData(RideFile::watts).constData();
+    const double *alts = seriesData(RideFile::alt).constData();
+
+    //
+    // NP - rolling 30s average from prefix sums, raised to 4th power
+    //
+    int window = 30 / (recIntSecs_ ? recIntSecs_ : 1);
+    QVector<double> prefix(n+1), fourth(n, 0.0), NPtotals(n+1, 0.0);
+    prefix[0] = 0;
+    for (int i=0; i<n; i++) prefix[i+1] = prefix[i] + watts[i];
+
+    if (window > 1) {
+        for (int i=0; i<n && i<window; i++) fourth[i] = prefix[i+1] / window;
+        for (int i=window; i<n; i++) fourth[i] = (prefix[i+1] - prefix[i+1-window]) / window;
+        for (int i=0; i<n; i++) fourth[i] = (fourth[i] * fourth[i]) * (fourth[i] * fourth[i]);
+        for (int i=0; i<n; i++) NPtotals[i+1] = NPtotals[i] + fourth[i];
+    }
+
+    //
+    // xPower - 25s exponentially weighted average, raised to 4th power
+    //
+    double XPsampsPerWindow = 25.0 / XPsecsDelta;
+    double XPattenuation = XPsampsPerWindow / (XPsampsPerWindow + XPsecsDelta);
+    double XPsampleWeight = XPsecsDelta / (XPsampsPerWindow + XPsecsDelta);
+    QVector<double> XPweighted(n+1), XPtotals(n+1);
+    XPweighted[0] = XPtotals[0] = 0;
+    for (int i=0; i<n; i++) {
+        double weighted = XPweighted[i] * XPattenuation + XPsampleWeight * watts[i];
+        XPweighted[i+1] = weighted;
+        XPtotals[i+1] = XPtotals[i] + (weighted * weighted) * (weighted * weighted);
+    }
+
+    //
+    // aPower - altitude adjusted
+    //
+    QVector<double> apower(n);
+    if (dataPresent.alt) {
+        static const double a0  = -174.1448622;
+        static const double a1  = 1.0899959;
+        static const double a2  = -0.0015119;
+        static const double a3  = 7.2674E-07;
+
+        for (int i=0; i<n; i++) {
+            // pbar [mbar]= 0.76*EXP( -alt[m] / 7000 )*1000, %Vo2max a cubic in pbar
+            double pbar = 0.76 * exp(alts[i] / 7000) * 1000;
+            double vo2maxPCT = a0 + pbar * (a1 + pbar * (a2 + pbar * a3));
+            apower[i] = alts[i] > 0 ? (watts[i] / 100) * vo2maxPCT : watts[i];
+        }
+    } else {
+        for (int i=0; i<n; i++) apower[i] = watts[i];
+    }
+
+    //
+    // Set the points, and the min, max and checkpoints as we go
+    //
+    if (window > 1) dataPresent.np = true;
+    dataPresent.xp = true;
+    if (dataPresent.alt) dataPresent.apower = true;
+
+    double APtotal = 0;
+    for (int i=0; i<n; i++) {
+
+        if (i % derivedStride == 0) {
+            DerivedState state;
+            state.recIntSecs = recIntSecs_;
+            state.watts = dataPresent.watts;
+            state.alt = dataPresent.alt;
+            if (window > 1) {
+                state.NProlling.resize(window);
+                for (int k=qMax(0, i-window); k<i; k++) state.NProlling[k % window] = watts[k];
+                state.NPsum = prefix[i] - prefix[qMax(0, i-window)];
+                state.NPcount = i;
+                state.NPindex = i % window;
+            } else {
+                state.NPsum = 0;
+                state.NPcount = state.NPindex = 0;
+            }
+            state.NPtotal = NPtotals[i];
+            state.XPlastSecs = i ? times[i-1] : 0;
+            state.XPweighted = XPweighted[i];
+            state.XPtotal = XPtotals[i];
+            state.XPcount = i;
+            state.APtotal = APtotal;
+            state.APcount = i;
+            state.minNP = minPoint->np;
+            state.maxNP = maxPoint->np;
+            state.minXP = minPoint->xp;
+            state.maxXP = maxPoint->xp;
+            state.minAP = minPoint->apower;
+            state.maxAP = maxPoint->apower;
+            derivedStates << state;
+        }
+
+        RideFilePoint *p = dataPoints_[i];
+        p->np = (window > 1 && (i+1)*recIntSecs_ > 30) ? sqrt(sqrt(NPtotals[i+1] / (i+1))) : 0.00f;
+        p->xp = sqrt(sqrt(XPtotals[i+1] / (i+1)));
+        p->apower = apower[i];
+
+        if (p->np > maxPoint->np) maxPoint->np = p->np;
+        if (p->np < minPoint->np) minPoint->np = p->np;
+        if (p->xp > maxPoint->xp) maxPoint->xp = p->xp;
+        if (p->xp < minPoint->xp) minPoint->xp = p->xp;
+        if (p->apower > maxPoint->apower) maxPoint->apower = p->apower;
+        if (p->apower < minPoint->apower) minPoint->apower = p->apower;
+
+        APtotal += p->apower;
+    }
+
+    // Averages and Totals
+    int NPcount = window > 1 ? n : 0;
+    avgPoint->np = NPcount ? (NPtotals[n] / NPcount) : 0;
+    totalPoint->np = NPtotals[n];
+
+    avgPoint->xp = XPtotals[n] / n;
+    totalPoint->xp = XPtotals[n];
+
+    avgPoint->apower = APtotal / n;
+    totalPoint->apower = APtotal;
+
+    // derived columns need refreshing
+    columnLock.lock();
+    cstale[NP] = cstale[xPower] = cstale[aPower] = true;
+    columnLock.unlock();
+
+    return true;
+}
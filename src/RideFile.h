@@ -27,17 +27,24 @@
 #include <QMap>
 #include <QVector>
 #include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QSharedPointer>
 
 class RideItem;
 class RideFile;
 struct RideFilePoint;
 struct RideFileDataPresent;
 struct RideFileInterval;
+struct RideFileSnapshotData;
+class RideFileSnapshot;
+template<int series> class RideFileSeries;
 class EditorData;      // attached to a RideFile
 class RideFileCommand; // for manipulating ride data
 class Context;      // for context; cyclist, homedir
+class RideMetric;   // interval metrics are kept with the ride
 
-// This file defines four classes:
+// This file defines five classes:
 //
 // RideFile, as the name suggests, represents the data stored in a ride file,
 // regardless of what type of file it is (.raw, .srm, .csv).
@@ -48,6 +55,8 @@ class Context;      // for context; cyclist, homedir
 // filename and return a RideFile object representing the ride stored in the
 // corresponding file.
 //
+// RideFileSplitter is handed the rides of a multi-ride container one by one.
+//
 // RideFileFactory is a singleton that maintains a mapping from ride file
 // suffixes to the RideFileReader objects capable of converting those files
 // into RideFile objects.
@@ -66,6 +75,14 @@ struct RideFileDataPresent
         kph(false), nm(false), watts(false), alt(false), lon(false), lat(false),
         headwind(false), slope(false), temp(false), lrbalance(false), interval(false),
         np(false), xp(false), apower(false) {}
+
+    // every series, for asking a reader to decode them all
+    static RideFileDataPresent all() {
+        RideFileDataPresent p;
+        p.secs = p.cad = p.hr = p.km = p.kph = p.nm = p.watts = p.alt = p.lon = p.lat =
+        p.headwind = p.slope = p.temp = p.lrbalance = p.interval = true;
+        return p;
+    }
 };
 
 struct RideFileInterval
@@ -93,6 +110,28 @@ struct RideFileCalibration
     bool operator< (RideFileCalibration right) const { return start < right.start; }
 };
 
+// Where a ride's points are allocated, in slabs that are freed together
+// with the ride rather than a point at a time, so reading and closing a
+// lot of rides doesn't make millions of small allocations. Space is never
+// handed back, points deleted from the ride stay put until it goes.
+class RideFilePointArena
+{
+    public:
+        RideFilePointArena() : next(0), size(0) {}
+        ~RideFilePointArena();
+
+        RideFilePoint *alloc(const RideFilePoint &point);
+        bool owns(const RideFilePoint *point) const;
+
+    private:
+        QVector<RideFilePoint*> slabs;
+        QVector<int> sizes;
+        int next, size; // of the last slab
+
+        RideFilePointArena(const RideFilePointArena &);
+        RideFilePointArena &operator=(const RideFilePointArena &);
+};
+
 class RideFile : public QObject // QObject to emit signals
 {
     Q_OBJECT
@@ -104,12 +143,39 @@ class RideFile : public QObject // QObject to emit signals
         friend class RideFileCommand; // tells us we were modified
         friend class MainWindow; // tells us we were modified
         friend class Context; // tells us we were saved
+        friend class RideFileSnapshot; // makes rides of snapshots
 
         // Constructor / Destructor
         RideFile();
         RideFile(const QDateTime &startTime, double recIntSecs);
+
+        // A read only view of the points from start to stop (inclusive) of
+        // another ride, sharing its points rather than copying them, to work
+        // out metrics for part of it. It must not outlive the ride.
+        RideFile(const RideFile *ride, int start, int stop);
         virtual ~RideFile();
 
+        // A standalone copy of the points from start up to (not including)
+        // stop, rebased to start from zero secs and km, along with the
+        // metadata and the intervals that start within it. Caller owns it.
+        RideFile *copyRange(int start, int stop) const;
+
+        // A standalone copy of everything the writers save, unchanged,
+        // so it can be written on another thread. Caller owns it.
+        RideFile *snapshot() const;
+
+        // An immutable copy of the same, for readers on other threads,
+        // that shares the blocks of points unchanged since the last one
+        // was taken, so taking another after an edit is cheap. GUI thread
+        // only, and changes made since must have gone through the
+        // command or the point mutators below to be noticed.
+        RideFileSnapshot sharedSnapshot();
+
+        // a copy of point from this ride's own storage, for handing to
+        // insertPoint(), insertPoints() or appendPoints(). Those also
+        // take points made with new, the ride owns them either way.
+        RideFilePoint *newPoint(const RideFilePoint &point) { return arena.alloc(point); }
+
         // Working with DATASERIES
         enum seriestype { secs=0, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, NP, xPower, vam, wattsKg, lrbalance, aPower, none };
         enum specialValues { noTemp = -255 };
@@ -126,6 +192,7 @@ class RideFile : public QObject // QObject to emit signals
         RideFileCommand *command;
         double getPointValue(int index, SeriesType series) const;
         QVariant getPoint(int index, SeriesType series) const;
+        QVariant getPointFromValue(double value, SeriesType series) const;
 
         QVariant getMinPoint(SeriesType series) const;
         QVariant getAvgPoint(SeriesType series) const;
@@ -137,8 +204,41 @@ class RideFile : public QObject // QObject to emit signals
                          double temperature, double lrbalance, int interval);
 
         void appendPoint(const RideFilePoint &);
+        void reservePoints(int n) { dataPoints_.reserve(n); } // when the count is roughly known
         const QVector<RideFilePoint*> &dataPoints() const { return dataPoints_; }
 
+        // Working with COLUMNS -- one contiguous array per data series
+        // with a value for every sample, the same as dataPoints()[i]->value(series).
+        // They are built on first use and kept until the ride data is changed
+        // so per-series loops (distributions, mean-max) can stream over memory
+        // rather than chase pointers through every RideFilePoint. As with the
+        // derived series, call recalculateDerivedSeries() before asking for NP,
+        // xPower or aPower. Safe to call from multiple threads.
+        const QVector<double> &seriesData(SeriesType series) const;
+
+        // the values of one series straight from the points, with the
+        // series chosen at compile time so loops over them don't switch
+        // on it for every point, e.g.
+        //      foreach (double watts, ride->series<RideFile::watts>())
+        // The derived series need recalculateDerivedSeries() first.
+        template<SeriesType S> RideFileSeries<S> series() const;
+
+        // The column as the charts plot it, multiplied by factor (e.g. for
+        // imperial units) and with negative values raised to zero when
+        // positive is set. When that changes nothing the column itself is
+        // returned, shared rather than copied, so every open chart plotting
+        // the ride holds the same array.
+        QVector<double> scaledSeriesData(SeriesType series, double factor, bool positive) const;
+
+        // The series on a 1 second grid, for anything that needs the same
+        // value at every second whatever the recording interval. Element 0
+        // is the whole second of the first sample, see resampledStart().
+        // Samples are interpolated between, or averaged into each second
+        // when recorded faster than 1s; gaps in recording come back as
+        // zero. Kept alongside the columns and rebuilt when they are.
+        const QVector<float> &resampledData(SeriesType series) const;
+        int resampledStart() const;
+
         // recalculate all the derived data series
         // might want to move to a factory for these
         // at some point, but for now hard coded
@@ -148,7 +248,11 @@ class RideFile : public QObject // QObject to emit signals
         // STATE IS MAINTAINED IN 'bool dstale' BELOW
         // TO ENSURE IT IS ONLY REFRESHED IF NEEDED
         //
+        // When only part of the ride has changed the
+        // recalculation resumes from a checkpoint just
+        // before the first changed point
         void recalculateDerivedSeries();
+        void derivedChanged(int index); // stale from index, -1 for unaffected
 
         // Working with DATAPRESENT flags
         inline const RideFileDataPresent *areDataPresent() const { return &dataPresent; }
@@ -198,6 +302,7 @@ class RideFile : public QObject // QObject to emit signals
 
         Context *context;
         double getWeight();
+        void setWeight(double x) { weight_ = x; } // when already known (e.g. worker threads)
 
         // METRIC OVERRIDES
         QMap<QString,QMap<QString,QString> > metricOverrides;
@@ -215,9 +320,11 @@ class RideFile : public QObject // QObject to emit signals
         // rather use the RideFileCommand *command
         // to manipulate the ride data
         void setPointValue(int index, SeriesType series, double value);
+        void setPointValues(int index, SeriesType series, const double *values, int count);
         void deletePoint(int index);
         void deletePoints(int index, int count);
         void insertPoint(int index, RideFilePoint *point);
+        void insertPoints(int index, QVector <struct RideFilePoint *> points);
         void appendPoints(QVector <struct RideFilePoint *> newRows);
         void setDataPresent(SeriesType, bool);
         // ************************************************************
@@ -233,6 +340,7 @@ class RideFile : public QObject // QObject to emit signals
         void emitSaved();
         void emitReverted();
         void emitModified();
+        void emitModified(int index); // derived data only stale from index
 
 
     private:
@@ -240,8 +348,10 @@ class RideFile : public QObject // QObject to emit signals
         QString id_; // global uuid@goldencheetah.org
         QDateTime startTime_;  // time of day that the ride started
         double recIntSecs_;    // recording interval in seconds
+        RideFilePointArena arena; // before the points it holds
         QVector<RideFilePoint*> dataPoints_;
         QVector<RideFilePoint*> referencePoints_;
+        void deletePointStorage(RideFilePoint *point);
         RideFilePoint* minPoint;
         RideFilePoint* maxPoint;
         RideFilePoint* avgPoint;
@@ -253,15 +363,56 @@ class RideFile : public QObject // QObject to emit signals
         QList<RideFileCalibration> calibrations_;
         QMap<QString,QString> tags_;
         EditorData *data;
+        bool slice; // points belong to another ride
         double weight_; // cached to save calls to getWeight();
         double totalCount;
 
-        QVariant getPointFromValue(double value, SeriesType series) const;
         void updateMin(RideFilePoint* point);
         void updateMax(RideFilePoint* point);
         void updateAvg(RideFilePoint* point);
 
         bool dstale; // is derived data up to date?
+        int dfrom; // if not, the first point that needs recalculating
+
+        // the last shared snapshot and which of its blocks of points
+        // have changed since, see sharedSnapshot()
+        QSharedPointer<const RideFileSnapshotData> shared;
+        QVector<bool> sharedDirty;
+        int sharedFrom; // every block from here on has changed
+        int sharedRevision;
+        void sharedChanged(int from, int to = -1); // to the end when -1
+
+        // the state of the derived series calculation before every
+        // derivedStride'th point, so we can resume after an edit
+        struct DerivedState {
+            double recIntSecs;
+            bool watts, alt;
+            QVector<double> NProlling;
+            double NPtotal, NPsum;
+            int NPcount, NPindex;
+            double XPlastSecs, XPweighted, XPtotal;
+            int XPcount;
+            double APtotal, APcount;
+            double minNP, maxNP, minXP, maxXP, minAP, maxAP;
+        };
+        QVector<DerivedState> derivedStates;
+        bool recalculateDerivedRegular(); // whole ride at a regular interval
+
+        // metrics for parts of the ride, see RideMetric::computeIntervalMetrics()
+        friend class RideMetric;
+        QMap<QString, QHash<QString, QSharedPointer<RideMetric> > > intervalMetrics;
+        QMutex intervalLock;
+        // columnar copies of the series, see seriesData()
+        mutable QVector<double> columns[none];
+        mutable bool cstale[none];
+        mutable QMutex columnLock;
+        mutable int columnBuilds, cbuilt[none]; // when each column was last built
+        void columnsChanged(); // mark all stale
+
+        // and the 1s resampled copies, see resampledData()
+        mutable QVector<float> resampled[none];
+        mutable int rbuilt[none][2]; // of the series and secs columns used
+        mutable QMutex resampleLock;
 };
 
 struct RideFilePoint
@@ -289,6 +440,138 @@ struct RideFilePoint
     double value(RideFile::SeriesType series) const;
 };
 
+// RideFilePoint::value() for a series known at compile time, the series
+// that aren't held in the points are zero
+template<int series> struct RideFilePointField {
+    static double get(const RideFilePoint &) { return 0.0; }
+};
+
+#define GC_POINT_FIELD(series, field) \
+template<> struct RideFilePointField<RideFile::series> { \
+    static double get(const RideFilePoint &p) { return p.field; } \
+};
+GC_POINT_FIELD(secs, secs)
+GC_POINT_FIELD(cad, cad)
+GC_POINT_FIELD(hr, hr)
+GC_POINT_FIELD(km, km)
+GC_POINT_FIELD(kph, kph)
+GC_POINT_FIELD(nm, nm)
+GC_POINT_FIELD(watts, watts)
+GC_POINT_FIELD(alt, alt)
+GC_POINT_FIELD(lon, lon)
+GC_POINT_FIELD(lat, lat)
+GC_POINT_FIELD(headwind, headwind)
+GC_POINT_FIELD(slope, slope)
+GC_POINT_FIELD(temp, temp)
+GC_POINT_FIELD(lrbalance, lrbalance)
+GC_POINT_FIELD(interval, interval)
+GC_POINT_FIELD(NP, np)
+GC_POINT_FIELD(xPower, xp)
+GC_POINT_FIELD(aPower, apower)
+#undef GC_POINT_FIELD
+
+// A range over one series of a ride's points, see RideFile::series(). It
+// is only good while the points are left alone
+template<int series>
+class RideFileSeries
+{
+    public:
+        class const_iterator {
+            public:
+                const_iterator(RideFilePoint * const *p) : p(p) {}
+                double operator*() const { return RideFilePointField<series>::get(**p); }
+                const_iterator &operator++() { ++p; return *this; }
+                const_iterator operator++(int) { const_iterator was = *this; ++p; return was; }
+                bool operator==(const const_iterator &other) const { return p == other.p; }
+                bool operator!=(const const_iterator &other) const { return p != other.p; }
+            private:
+                RideFilePoint * const *p;
+        };
+        typedef const_iterator iterator; // for foreach
+
+        RideFileSeries(const QVector<RideFilePoint*> &points) : from(points.constData()), n(points.count()) {}
+
+        const_iterator begin() const { return const_iterator(from); }
+        const_iterator end() const { return const_iterator(from + n); }
+        int count() const { return n; }
+        double operator[](int i) const { return RideFilePointField<series>::get(*from[i]); }
+
+    private:
+        RideFilePoint * const *from;
+        int n;
+};
+
+template<RideFile::SeriesType S>
+inline RideFileSeries<S> RideFile::series() const { return RideFileSeries<S>(dataPoints_); }
+
+// What a RideFileSnapshot holds; never changed once it is shared
+struct RideFileSnapshotData
+{
+    enum { blockSize = 1024 }; // points in each block
+
+    int revision;
+    QString id, deviceType, fileFormat;
+    QDateTime startTime;
+    double recIntSecs;
+    RideFileDataPresent dataPresent;
+    QList<RideFileInterval> intervals;
+    QList<RideFileCalibration> calibrations;
+    QMap<QString,QString> tags;
+    QMap<QString,QMap<QString,QString> > metricOverrides;
+    QVector<RideFilePoint> referencePoints;
+
+    int count;
+    QVector<QSharedPointer<const QVector<RideFilePoint> > > blocks;
+};
+
+// A read only copy of a ride, see RideFile::sharedSnapshot(). It is cheap
+// to copy and safe to read from any number of threads at once, whatever
+// happens to the ride it was taken from in the meantime.
+class RideFileSnapshot
+{
+    public:
+        RideFileSnapshot() {}
+        RideFileSnapshot(QSharedPointer<const RideFileSnapshotData> d) : d(d) {}
+
+        bool isNull() const { return d.isNull(); }
+        int revision() const { return d ? d->revision : 0; } // changes when the ride does
+
+        QString id() const { return d->id; }
+        QString deviceType() const { return d->deviceType; }
+        QString fileFormat() const { return d->fileFormat; }
+        const QDateTime &startTime() const { return d->startTime; }
+        double recIntSecs() const { return d->recIntSecs; }
+        const RideFileDataPresent *areDataPresent() const { return &d->dataPresent; }
+        const QList<RideFileInterval> &intervals() const { return d->intervals; }
+        const QList<RideFileCalibration> &calibrations() const { return d->calibrations; }
+        const QMap<QString,QString> &tags() const { return d->tags; }
+        QString getTag(QString name, QString fallback) const { return d->tags.value(name, fallback); }
+        const QMap<QString,QMap<QString,QString> > &metricOverrides() const { return d->metricOverrides; }
+        const QVector<RideFilePoint> &referencePoints() const { return d->referencePoints; }
+
+        int count() const { return d ? d->count : 0; }
+        const RideFilePoint &point(int i) const {
+            return d->blocks[i / RideFileSnapshotData::blockSize]->at(i % RideFileSnapshotData::blockSize);
+        }
+
+        // a standalone RideFile of it for code that wants one, such
+        // as the writers, owned by the caller and the calling thread
+        RideFile *toRideFile() const;
+
+    private:
+        QSharedPointer<const RideFileSnapshotData> d;
+};
+
+// RideFileSplitter receives the rides held in a multi-ride container (a
+// TCX or Fitlog history export) one at a time as they are parsed, so the
+// whole history never needs to be held in memory at once. The splitter
+// takes ownership of each ride it is handed.
+class RideFileSplitter {
+    public:
+        virtual ~RideFileSplitter() {}
+        virtual void split(RideFile *ride) = 0;
+};
+
 struct RideFileReader {
     virtual ~RideFileReader() {}
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const = 0;
@@ -296,17 +579,47 @@ struct RideFileReader {
     // if hasWrite capability should re-implement writeRideFile and hasWrite
     virtual bool hasWrite() const { return false; }
     virtual bool writeRideFile(Context *, const RideFile *, QFile &) const { return false; }
+
+    // readers that can skip decoding the series that are not wanted should re-implement
+    // openRideFileSeries, by default they are all read
+    virtual RideFile *openRideFileSeries(QFile &file, QStringList &errors, const RideFileDataPresent &) const {
+        return openRideFile(file, errors);
+    }
+
+    // containers that can stream their rides out should re-implement splitRideFile
+    virtual bool splitRideFile(QFile &, QStringList &, RideFileSplitter *) const { return false; }
 };
 
+// readers registered with a maker are only constructed the first time a file
+// of that format is opened or written, until then all the factory holds is the
+// suffix, description, magic bytes and whether it can write
+typedef RideFileReader *(*RideFileReaderMaker)();
+template<class T> RideFileReader *makeRideFileReader() { return new T(); }
+
 class RideFileFactory {
 
     private:
 
+        struct Format {
+            Format() : maker(0), reader(0), writes(false), offset(0) {}
+            RideFileReaderMaker maker;
+            mutable RideFileReader *reader; // made on first use
+            bool writes;
+            QByteArray magic;               // empty if the format has none
+            int offset;                     // where the magic lives
+        };
+
         static RideFileFactory *instance_;
-        QMap<QString,RideFileReader*> readFuncs_;
+        QMap<QString,Format> formats_;
         QMap<QString,QString> descriptions_;
+        mutable QMutex makeLock_;
+        int magicLength_;                   // bytes needed to check every magic
+
+        RideFileFactory() : magicLength_(0) {}
 
-        RideFileFactory() {}
+        RideFileReader *reader(const Format &format) const;
+        RideFileReader *reader(const QString &suffix) const;
+        RideFileReader *reader(QFile &file) const;
 
     public:
 
@@ -314,7 +627,21 @@ class RideFileFactory {
 
         int registerReader(const QString &suffix, const QString &description,
                            RideFileReader *reader);
-        RideFile *openRideFile(Context *context, QFile &file, QStringList &errors, QList<RideFile*>* = 0) const;
+        // lazy registration, magic is the leading bytes (at offset) every file
+        // of this format has, so it can be picked without a trial parse
+        int registerReader(const QString &suffix, const QString &description,
+                           RideFileReaderMaker maker, bool writes,
+                           const QByteArray &magic = QByteArray(), int offset = 0);
+        // the suffix of the format whose magic matches the file, empty if none do
+        QString sniff(QFile &file) const;
+        // bulk opens skip the display and metadata tags (notes, calendar text etc)
+        RideFile *openRideFile(Context *context, QFile &file, QStringList &errors, QList<RideFile*>* = 0, bool bulk = false) const;
+        // a bulk open that only needs the series flagged in wanted, the rest may be left zero
+        RideFile *openRideFileSeries(Context *context, QFile &file, QStringList &errors, const RideFileDataPresent &wanted) const;
+        // streams each ride out to the splitter, false if the format can't
+        bool splitRideFile(QFile &file, QStringList &errors, RideFileSplitter *splitter) const;
+        // the post-processing openRideFile applies, for rides that were split out
+        void finishRideFile(Context *context, QFile &file, RideFile *result, bool bulk = false) const;
         bool writeRideFile(Context *context, const RideFile *ride, QFile &file, QString format) const;
         QStringList listRideFiles(const QDir &dir) const;
         QStringList suffixes() const;
@@ -19,24 +19,98 @@
 #include "RideFileCache.h"
 #include "MainWindow.h"
 #include "Context.h"
+#include "Trace.h"
 #include "Athlete.h"
 #include "Zones.h"
 #include "HrZones.h"
+#include "ZoneLookup.h"
 #include "MetricAggregator.h"
 #include "SummaryMetrics.h"
 #include "LTMSettings.h" // getAllBestsFor needs this
+#include "RideItem.h"
+#include "CacheStats.h"
+#include "Settings.h"
 
 #include <math.h> // for pow()
 #include <QDebug>
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QtAlgorithms> // for qStableSort
+#include <QMutex>
+#include <QThread>
+#include <QMap>
+#include <QCache>
+#include <string.h>
+
+static CacheStats cpxStats("Date range mean max", GC_CPXCACHE_MB, 64); // lets max out at 64MB of caches
+
+// refreshCache() is called from the metric refresh workers
+// so we serialise access to the athlete's incore cpxCache
+static QMutex cpxCacheLock;
+
+// the layout of the blocks in the file, the directory in the
+// header is written in this order and the blocks follow it
+static const struct { unsigned int type; RideFile::SeriesType series; } cacheLayout[RideFileCacheBlocks] = {
+    { RideFileCacheMeanMaxBlock, RideFile::watts },
+    { RideFileCacheMeanMaxBlock, RideFile::hr },
+    { RideFileCacheMeanMaxBlock, RideFile::cad },
+    { RideFileCacheMeanMaxBlock, RideFile::nm },
+    { RideFileCacheMeanMaxBlock, RideFile::kph },
+    { RideFileCacheMeanMaxBlock, RideFile::xPower },
+    { RideFileCacheMeanMaxBlock, RideFile::NP },
+    { RideFileCacheMeanMaxBlock, RideFile::vam },
+    { RideFileCacheMeanMaxBlock, RideFile::wattsKg },
+    { RideFileCacheMeanMaxBlock, RideFile::aPower },
+    { RideFileCacheDistributionBlock, RideFile::watts },
+    { RideFileCacheDistributionBlock, RideFile::hr },
+    { RideFileCacheDistributionBlock, RideFile::cad },
+    { RideFileCacheDistributionBlock, RideFile::nm },
+    { RideFileCacheDistributionBlock, RideFile::kph },
+    { RideFileCacheDistributionBlock, RideFile::xPower },
+    { RideFileCacheDistributionBlock, RideFile::NP },
+    { RideFileCacheDistributionBlock, RideFile::wattsKg },
+    { RideFileCacheDistributionBlock, RideFile::aPower },
+    { RideFileCacheTizBlock, RideFile::watts },
+    { RideFileCacheTizBlock, RideFile::hr },
+    { RideFileCacheOffsetBlock, RideFile::watts }
+};
+
+// the rarely used mean-max series, left until they're asked for
+static bool deferredSeries(RideFile::SeriesType series)
+{
+    return series == RideFile::cad || series == RideFile::nm || series == RideFile::vam;
+}
 
-static const int maxcache = 25; // lets max out at 25 caches
+// the series a mean-max is worked out from
+static RideFile::SeriesType meanMaxBaseSeries(RideFile::SeriesType series)
+{
+    // xPower and NP need watts to be present
+    if (series == RideFile::xPower || series == RideFile::NP || series == RideFile::wattsKg) return RideFile::watts;
+    if (series == RideFile::vam) return RideFile::alt;
+    return series;
+}
+
+// the ride date from its file name
+static QDate dateFromFileName(const QString filename) {
+    QRegExp rx("^(\\d\\d\\d\\d)_(\\d\\d)_(\\d\\d)_\\d\\d_\\d\\d_\\d\\d\\..*$");
+    if (rx.exactMatch(filename)) {
+        QDate date(rx.cap(1).toInt(), rx.cap(2).toInt(), rx.cap(3).toInt());
+        if (date.isValid()) return date;
+    }
+    return QDate(); // nil date
+}
+
+// completeDeferred() appends to the .cpx, one at a time
+static QMutex deferredLock;
+
+// interval mean maxes by ride, revision, bounds and series, costed in bytes
+static QCache<QString, QVector<float> > intervalCache(16 * 1024 * 1024);
+static QMutex intervalCacheLock;
+static CacheStats intervalStats("Interval mean max", GC_INTERVALCACHE_MB, 16);
 
 // cache from ride
 RideFileCache::RideFileCache(Context *context, QString fileName, RideFile *passedride, bool check) :
-               context(context), rideFileName(fileName), ride(passedride)
+               context(context), rideFileName(fileName), ride(passedride), deferred(0), filtered(false)
 {
     // resize all the arrays to zero
     wattsMeanMax.resize(0);
@@ -66,30 +140,20 @@ RideFileCache::RideFileCache(Context *context, QString fileName, RideFile *passe
     // Get info for ride file and cache file
     QFileInfo rideFileInfo(rideFileName);
     cacheFileName = rideFileInfo.path() + "/" + rideFileInfo.baseName() + ".cpx";
-    QFileInfo cacheFileInfo(cacheFileName);
 
     // is it up-to-date?
-    if (cacheFileInfo.exists() && rideFileInfo.lastModified() <= cacheFileInfo.lastModified() &&
-        cacheFileInfo.size() >= (int)sizeof(struct RideFileCacheHeader)) {
-        // we have a file, it is more recent than the ride file
-        // but is it the latest version?
-        RideFileCacheHeader head;
-        QFile cacheFile(cacheFileName);
-        if (cacheFile.open(QIODevice::ReadOnly) == true) {
+    if (isCurrent(rideFileName)) {
 
-            // read the header
-            QDataStream inFile(&cacheFile);
-            inFile.readRawData((char *) &head, sizeof(head));
-            cacheFile.close();
-
-            // is it as recent as we are?
-            if (head.version == RideFileCacheVersion) {
+        // WE'RE GOOD
+        if (check == false) readCache(); // if check is false we aren't just checking
+        return;
+    }
 
-                // WE'RE GOOD
-                if (check == false) readCache(); // if check is false we aren't just checking
-                return;
-            }
-        }
+    // a version bump leaves the old ones to be rebuilt in the background,
+    // the charts can use them meanwhile rather than wait on the ride
+    if (check == false && isReadable(rideFileName)) {
+        readCache();
+        return;
     }
 
     // NEED TO UPDATE!!
@@ -106,7 +170,11 @@ RideFileCache::RideFileCache(Context *context, QString fileName, RideFile *passe
         QStringList errors;
         QFile file(rideFileName);
 
-        ride = RideFileFactory::instance().openRideFile(context, file, errors);
+        // the cache doesn't use the GPS, weather or balance data
+        RideFileDataPresent wanted = RideFileDataPresent::all();
+        wanted.lat = wanted.lon = wanted.headwind = wanted.slope = wanted.temp = wanted.lrbalance = false;
+
+        ride = RideFileFactory::instance().openRideFileSeries(context, file, errors, wanted);
 
         if (ride) {
             ride->getWeight(); // before threads are created
@@ -117,6 +185,82 @@ RideFileCache::RideFileCache(Context *context, QString fileName, RideFile *passe
     }
 }
 
+// the version of the .cpx, or 0 when there isn't one or it is older than the ride.
+// A ride file newer than its .cpx may have been copied from another machine that
+// built the .cpx, so the content is checked before giving up on it. The content
+// fingerprint can be passed when it is already known
+static unsigned int cacheVersion(QString rideFileName, unsigned long content = 0)
+{
+    // Get info for ride file and cache file
+    QFileInfo rideFileInfo(rideFileName);
+    QString cacheFileName = rideFileInfo.path() + "/" + rideFileInfo.baseName() + ".cpx";
+    QFileInfo cacheFileInfo(cacheFileName);
+
+    // is there one at all?
+    if (cacheFileInfo.exists() && cacheFileInfo.size() >= (int)sizeof(struct RideFileCacheHeader)) {
+
+        RideFileCacheHeader head;
+        QFile cacheFile(cacheFileName);
+        if (cacheFile.open(QIODevice::ReadWrite) == true || cacheFile.open(QIODevice::ReadOnly) == true) {
+
+            // read the header
+            if (cacheFile.read((char *) &head, sizeof(head)) != sizeof(head)) return 0;
+
+            // it is more recent than the ride file, but is it the latest version?
+            if (rideFileInfo.lastModified() <= cacheFileInfo.lastModified()) return head.version;
+
+            // older, but from the same ride file
+            if (head.version != RideFileCacheVersion || head.content == 0) return 0;
+            if (content == 0) content = MetricAggregator::contentFingerPrint(rideFileName);
+            if (content != head.content) return 0;
+
+            // so it is, write the header back to make it newer than the ride
+            // file again, and we won't need to check the content next time
+            if (cacheFile.openMode() & QIODevice::WriteOnly) {
+                cacheFile.seek(0);
+                cacheFile.write((char *) &head, sizeof(head));
+            }
+            return head.version;
+        }
+    }
+    return 0;
+}
+
+bool
+RideFileCache::isCurrent(QString rideFileName, unsigned long content)
+{
+    return cacheVersion(rideFileName, content) == RideFileCacheVersion;
+}
+
+bool
+RideFileCache::isReadable(QString rideFileName)
+{
+    return RideFileCacheReadableVersion(cacheVersion(rideFileName));
+}
+
+bool
+RideFileCache::keep(QString rideFileName)
+{
+    QFileInfo rideFileInfo(rideFileName);
+    QString cacheFileName = rideFileInfo.path() + "/" + rideFileInfo.baseName() + ".cpx";
+
+    QFile cacheFile(cacheFileName);
+    if (!cacheFile.exists() || cacheFile.size() < (int)sizeof(struct RideFileCacheHeader)) return false;
+    if (cacheFile.open(QIODevice::ReadWrite) == false) return false;
+
+    // writing the header back with the new content of the ride
+    // file is enough to make it newer than the ride file again
+    RideFileCacheHeader head;
+    bool kept = cacheFile.read((char *) &head, sizeof(head)) == sizeof(head) &&
+                head.version == RideFileCacheVersion;
+    if (kept) {
+        head.content = MetricAggregator::contentFingerPrint(rideFileName);
+        kept = cacheFile.seek(0) && cacheFile.write((char *) &head, sizeof(head)) == sizeof(head);
+    }
+    cacheFile.close();
+    return kept;
+}
+
 int
 RideFileCache::decimalsFor(RideFile::SeriesType series)
 {
@@ -149,7 +293,42 @@ RideFileCache::decimalsFor(RideFile::SeriesType series)
 //
 // DATA ACCESS
 //
-QVector<QDate> &
+QDate
+MeanMaxDates::at(int secs) const
+{
+    if (secs < 0 || secs >= size()) return QDate();
+
+    // the first run that ends after it
+    return dates[qUpperBound(ends.begin(), ends.end(), secs) - ends.begin()];
+}
+
+void
+MeanMaxDates::append(const QDate &date, int count)
+{
+    if (count <= 0) return;
+    if (!dates.isEmpty() && dates.last() == date) ends.last() += count;
+    else {
+        ends << size() + count;
+        dates << date;
+    }
+}
+
+void
+MeanMaxDates::resize(int to)
+{
+    if (to >= size()) {
+        append(QDate(), to - size());
+        return;
+    }
+
+    // drop the runs past the end and shorten the last one
+    int keep = qUpperBound(ends.begin(), ends.end(), to - 1) - ends.begin() + (to > 0 ? 1 : 0);
+    ends.resize(keep);
+    dates.resize(keep);
+    if (keep) ends.last() = to;
+}
+
+MeanMaxDates &
 RideFileCache::meanMaxDates(RideFile::SeriesType series)
 {
     switch (series) {
@@ -203,6 +382,42 @@ RideFileCache::meanMaxDates(RideFile::SeriesType series)
 
 QVector<double> &
 RideFileCache::meanMaxArray(RideFile::SeriesType series)
+{
+    unsigned int bit = 0;
+    for (int i=0; i<RideFileCacheBlocks; i++)
+        if (cacheLayout[i].type == RideFileCacheMeanMaxBlock && cacheLayout[i].series == series)
+            bit = 1 << i;
+
+    if (deferred & bit) {
+
+        if (rideFileName != "") {
+
+            // compute them now, they're appended to the .cpx
+            if (completeDeferred(context, rideFileName)) readCache();
+
+        } else if (start.isValid()) {
+
+            // complete the rides in the range and aggregate it again
+            foreach (QString name, context->athlete->allRideFiles()) {
+                QDate date = dateFromFileName(name);
+                if (date < start || date > end || (filtered && !filteredFiles.contains(name))) continue;
+                if (context->isfiltered && !context->filterSet.contains(name)) continue;
+
+                QFileInfo rideFileInfo(context->athlete->home.absolutePath() + "/" + name);
+                QFileInfo cacheFileInfo(rideFileInfo.path() + "/" + rideFileInfo.baseName() + ".cpx");
+                if (cacheFileInfo.exists()) completeDeferred(context, rideFileInfo.filePath());
+            }
+            *this = RideFileCache(context, start, end, filtered, filteredFiles);
+        }
+
+        // only try once, if it couldn't be computed it stays empty
+        deferred &= ~bit;
+    }
+    return meanMaxValues(series);
+}
+
+QVector<double> &
+RideFileCache::meanMaxValues(RideFile::SeriesType series)
 {
     switch (series) {
 
@@ -296,9 +511,37 @@ RideFileCache::distributionArray(RideFile::SeriesType series)
 //
 // COMPUTATION
 //
+
+// drop the incore aggregates with this date in their range
+static void invalidateIncore(Context *context, QDate date)
+{
+    QMutexLocker locker(&cpxCacheLock);
+    for (int i=0; i<context->athlete->cpxCache.count();) {
+        if (date >= context->athlete->cpxCache.at(i)->start &&
+            date <= context->athlete->cpxCache.at(i)->end) {
+            delete context->athlete->cpxCache.at(i);
+            context->athlete->cpxCache.removeAt(i);
+        } else i++;
+    }
+
+    int bytes = 0;
+    foreach(RideFileCacheAggregate *p, context->athlete->cpxCache) bytes += p->bytes();
+    cpxStats.setUsage(context->athlete, bytes, context->athlete->cpxCache.count());
+}
+
+void
+RideFileCache::freeIncore(Context *context)
+{
+    QMutexLocker locker(&cpxCacheLock);
+    qDeleteAll(context->athlete->cpxCache);
+    context->athlete->cpxCache.clear();
+    cpxStats.forget(context->athlete);
+}
+
 void
 RideFileCache::refreshCache()
 {
+    GC_TRACE_SPAN("cpx refresh");
     static bool writeerror=false;
 
     // update cache!
@@ -320,19 +563,12 @@ RideFileCache::refreshCache()
 
         // invalidate any incore cache of aggregate
         // that contains this ride in its date range
-        QDate date = ride->startTime().date();
-        for (int i=0; i<context->athlete->cpxCache.count();) {
-            if (date >= context->athlete->cpxCache.at(i)->start &&
-                date <= context->athlete->cpxCache.at(i)->end) {
-                delete context->athlete->cpxCache.at(i);
-                context->athlete->cpxCache.removeAt(i);
-            } else i++;
-        }
+        invalidateIncore(context, ride->startTime().date());
 
 
-    } else if (writeerror == false) {
+    } else if (writeerror == false && QThread::currentThread() == QApplication::instance()->thread()) {
 
-        // popup the first time...
+        // popup the first time... but only from the GUI thread
         writeerror = true;
         QMessageBox err;
         QString errMessage = QString("Cannot create cache file %1.").arg(cacheFileName);
@@ -354,42 +590,50 @@ RideFileCache::refreshCache()
 // with many cores would benefit enormously
 void RideFileCache::RideFileCache::compute()
 {
+    GC_TRACE_SPAN("cpx compute");
     if (ride == NULL) {
         return;
     }
 
-    // all the mean maxes
-    MeanMaxComputer thread1(ride, wattsMeanMax, RideFile::watts); thread1.start();
-    MeanMaxComputer thread2(ride, hrMeanMax, RideFile::hr); thread2.start();
-    MeanMaxComputer thread3(ride, cadMeanMax, RideFile::cad); thread3.start();
-    MeanMaxComputer thread4(ride, nmMeanMax, RideFile::nm); thread4.start();
-    MeanMaxComputer thread5(ride, kphMeanMax, RideFile::kph); thread5.start();
-    MeanMaxComputer thread6(ride, xPowerMeanMax, RideFile::xPower); thread6.start();
-    MeanMaxComputer thread7(ride, npMeanMax, RideFile::NP); thread7.start();
-    MeanMaxComputer thread8(ride, vamMeanMax, RideFile::vam); thread8.start();
-    MeanMaxComputer thread9(ride, wattsKgMeanMax, RideFile::wattsKg); thread9.start();
-    MeanMaxComputer thread10(ride, aPowerMeanMax, RideFile::aPower); thread10.start();
-
-    // all the different distributions
-    computeDistribution(wattsDistribution, RideFile::watts);
-    computeDistribution(hrDistribution, RideFile::hr);
-    computeDistribution(cadDistribution, RideFile::cad);
-    computeDistribution(nmDistribution, RideFile::nm);
-    computeDistribution(kphDistribution, RideFile::kph);
-    computeDistribution(wattsKgDistribution, RideFile::wattsKg);
-    computeDistribution(aPowerDistribution, RideFile::aPower);
+    // build the columns the computers stream over before
+    // we start, so the threads don't queue up to build them
+    ride->recalculateDerivedSeries();
+    ride->seriesData(RideFile::secs);
+    ride->seriesData(RideFile::watts);
+    ride->seriesData(RideFile::alt);
+
+    // and the timeline they all share
+    MeanMaxTimeline timeline(ride);
+
+    // the mean maxes of the series the ride has, the rarely
+    // used ones are deferred until meanMaxArray() wants them
+    QVector<float> *floats[RideFileCacheBlocks];
+    QVector<double> *doubles[RideFileCacheBlocks];
+    blockArrays(floats, doubles);
+
+    QList<MeanMaxComputer*> threads;
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        RideFile::SeriesType series = cacheLayout[i].series;
+        if (cacheLayout[i].type != RideFileCacheMeanMaxBlock) continue;
+        if (ride->isDataPresent(meanMaxBaseSeries(series)) == false) continue;
+
+        if (deferredSeries(series)) {
+            deferred |= 1 << i;
+            continue;
+        }
+        threads << new MeanMaxComputer(ride, *floats[i], series,
+                                       series == RideFile::watts ? &wattsMeanMaxOffsets : NULL, &timeline);
+        threads.last()->start();
+    }
+
+    // all the different distributions, whilst they run
+    computeDistributions();
 
     // wait for them threads
-    thread1.wait();
-    thread2.wait();
-    thread3.wait();
-    thread4.wait();
-    thread5.wait();
-    thread6.wait();
-    thread7.wait();
-    thread8.wait();
-    thread9.wait();
-    thread10.wait();
+    foreach (MeanMaxComputer *thread, threads) {
+        thread->wait();
+        delete thread;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -513,6 +757,45 @@ void RideFileCache::RideFileCache::compute()
 
 */
 
+MeanMaxTimeline::MeanMaxTimeline(RideFile *ride)
+{
+    double lastsecs = 0;
+    double offset = 0;
+
+    const QVector<double> &secsData = ride->seriesData(RideFile::secs);
+    const double *times = secsData.constData();
+    int samples = secsData.count();
+
+    // get offset to apply on all samples
+    if (samples) offset = times[0];
+
+    secs.reserve(samples);
+    index.reserve(samples);
+    for (int s=0; s<samples; s++) {
+
+        // drag back to start at 0s
+        double psecs = times[s] - offset;
+
+        // fill in any gaps in recording - use same dodgy rounding as before
+        int count = (psecs - lastsecs - ride->recIntSecs()) / ride->recIntSecs();
+
+        // gap more than an hour, damn that ride file is a mess
+        if (count > 3600) count = 1;
+
+        for(int i=0; i<count; i++) {
+            secs << round(lastsecs+((i+1)*ride->recIntSecs() *1000.0)/1000);
+            index << -1;
+        }
+        lastsecs = psecs;
+
+        double rsecs = round(psecs * 1000.0) / 1000;
+        if (rsecs > 0) {
+            secs << rsecs;
+            index << s;
+        }
+    }
+}
+
 data_t *
 MeanMaxComputer::integrate_series(cpintdata &data)
 {
@@ -533,6 +816,38 @@ MeanMaxComputer::integrate_series(cpintdata &data)
 data_t
 MeanMaxComputer::partial_max_mean(data_t *dataseries_i, int start, int end, int length, int *offset)
 {
+    // when the offset isn't wanted only the largest energy matters and
+    // that doesn't depend on the order the windows are looked at, so we
+    // keep four independent maxima which the compiler can vectorise.
+    // The result is identical to the scan below.
+    if (offset == NULL) {
+
+        const data_t *head = dataseries_i + length;
+        const data_t *tail = dataseries_i;
+        int last = 1+end-length;
+        data_t c0=0, c1=0, c2=0, c3=0;
+
+        int i=start;
+        for (; i+3<last; i+=4) {
+            data_t e0 = head[i]-tail[i];
+            data_t e1 = head[i+1]-tail[i+1];
+            data_t e2 = head[i+2]-tail[i+2];
+            data_t e3 = head[i+3]-tail[i+3];
+            c0 = e0 > c0 ? e0 : c0;
+            c1 = e1 > c1 ? e1 : c1;
+            c2 = e2 > c2 ? e2 : c2;
+            c3 = e3 > c3 ? e3 : c3;
+        }
+        for (; i<last; i++) {
+            data_t e = head[i]-tail[i];
+            c0 = e > c0 ? e : c0;
+        }
+        if (c1 > c0) c0 = c1;
+        if (c2 > c0) c0 = c2;
+        if (c3 > c0) c0 = c3;
+        return c0;
+    }
+
     int i=0;
     data_t candidate=0;
 
@@ -578,7 +893,7 @@ MeanMaxComputer::divided_max_mean(data_t *dataseries_i, int datalength, int leng
         if (energy < candidate) {
           continue;
         }
-        data_t window_mm=partial_max_mean(dataseries_i, start, end, length, &this_offset);
+        data_t window_mm=partial_max_mean(dataseries_i, start, end, length, offset ? &this_offset : NULL);
 
         if (window_mm>candidate) {
             candidate=window_mm;
@@ -596,7 +911,7 @@ MeanMaxComputer::divided_max_mean(data_t *dataseries_i, int datalength, int leng
 
         if (energy >= candidate) {
 
-            data_t window_mm=partial_max_mean(dataseries_i, start, end, length, &this_offset);
+            data_t window_mm=partial_max_mean(dataseries_i, start, end, length, offset ? &this_offset : NULL);
 
             if (window_mm>candidate) {
                 candidate=window_mm;
@@ -609,14 +924,27 @@ MeanMaxComputer::divided_max_mean(data_t *dataseries_i, int datalength, int leng
 }
 
 
+void
+MeanMaxDurations::run()
+{
+    for (int i=first; i<count; i+=stride)
+        energy[i] = MeanMaxComputer::divided_max_mean(integrated, count, i, offsets ? &offsets[i] : NULL);
+}
+
+QAtomicInt MeanMaxComputer::running;
+
 void
 MeanMaxComputer::run()
 {
-    // xPower and NP need watts to be present
-    RideFile::SeriesType baseSeries = (series == RideFile::xPower || series == RideFile::NP || series == RideFile::wattsKg) ?
-                                      RideFile::watts : series;
+    running.ref();
+    compute();
+    running.deref();
+}
 
-    if (series == RideFile::vam) baseSeries = RideFile::alt;
+void
+MeanMaxComputer::compute()
+{
+    RideFile::SeriesType baseSeries = meanMaxBaseSeries(series);
 
     // only bother if the data series is actually present
     if (ride->isDataPresent(baseSeries) == false) return;
@@ -644,33 +972,21 @@ MeanMaxComputer::run()
     // time drastically).
     cpintdata data;
     data.rec_int_ms = (int) round(ride->recIntSecs() * 1000.0);
-    double lastsecs = 0;
-    bool first = true;
-    double offset = 0;
-    foreach (const RideFilePoint *p, ride->dataPoints()) {
 
-        // get offset to apply on all samples if first sample
-        if (first == true) {
-            offset = p->secs;
-            first = false;
-        }
+    // the timeline is shared when computing the whole cache
+    MeanMaxTimeline *ours = timeline ? NULL : new MeanMaxTimeline(ride);
+    const MeanMaxTimeline &times = timeline ? *timeline : *ours;
 
-        // drag back to start at 0s
-        double psecs = p->secs - offset;
+    // stream over the column rather than the points
+    const QVector<double> &valueData = ride->seriesData(baseSeries);
+    const double *values = valueData.constData();
 
-        // fill in any gaps in recording - use same dodgy rounding as before
-        int count = (psecs - lastsecs - ride->recIntSecs()) / ride->recIntSecs();
-
-        // gap more than an hour, damn that ride file is a mess
-        if (count > 3600) count = 1;
-
-        for(int i=0; i<count; i++)
-            data.points.append(cpintpoint(round(lastsecs+((i+1)*ride->recIntSecs() *1000.0)/1000), 0));
-        lastsecs = psecs;
-
-        double secs = round(psecs * 1000.0) / 1000;
-        if (secs > 0) data.points.append(cpintpoint(secs, (int) round(p->value(baseSeries))));
+    data.points.resize(times.secs.count());
+    for (int i=0; i<times.secs.count(); i++) {
+        int s = times.index[i];
+        data.points[i] = cpintpoint(times.secs[i], s < 0 ? 0 : (int) round(values[s]));
     }
+    delete ours;
 
     // don't bother with insufficient data
     if (!data.points.count()) return;
@@ -783,13 +1099,41 @@ MeanMaxComputer::run()
 
     // the bests go in here...
     QVector <double> ride_bests(total_secs + 1);
+    QVector <double> ride_starts(offsets ? total_secs + 1 : 0);
 
     data_t *dataseries_i = integrate_series(data);
 
+    // find the best energy for every duration, long rides are
+    // shared out across helper threads if there are cores spare
+    int durations = data.points.size();
+    QVector<data_t> energy(durations);
+    QVector<int> starts(offsets ? durations : 0);
+    int *startp = offsets ? starts.data() : NULL;
+
+    int parts = 1;
+    if (durations > 3600) {
+        parts = QThread::idealThreadCount() / qMax(1, int(running));
+        if (parts > 8) parts = 8;
+        if (parts < 1) parts = 1;
+    }
+
+    QList<MeanMaxDurations*> helpers;
+    for (int p=1; p<parts; p++) {
+        MeanMaxDurations *helper = new MeanMaxDurations(dataseries_i, durations, p+1, parts, energy.data(), startp);
+        helper->start();
+        helpers << helper;
+    }
+    MeanMaxDurations mine(dataseries_i, durations, 1, parts, energy.data(), startp);
+    mine.run();
+
+    foreach(MeanMaxDurations *helper, helpers) {
+        helper->wait();
+        delete helper;
+    }
+
     for (int i=1; i<data.points.size(); i++) {
 
-        int offset;
-        data_t c=divided_max_mean(dataseries_i,data.points.size(),i,&offset);
+        data_t c=energy[i];
 
         // snaffle it away
         int sec = i*ride->recIntSecs();
@@ -800,6 +1144,9 @@ MeanMaxComputer::run()
                 ride_bests[sec] = pow(val, 0.25f);
             else
                 ride_bests[sec] = val;
+
+            // back to ride time, the effort starts with the sample
+            if (offsets) ride_starts[sec] = data.points[starts[i]].secs + offset;
         }
     }
     free(dataseries_i);
@@ -814,11 +1161,18 @@ MeanMaxComputer::run()
     // future if some fancy new algorithm arrives
     //
 
-    double last = 0;
+    double last = 0, lastStart = 0;
     array.resize(ride_bests.count());
+    if (offsets) offsets->resize(ride_bests.count());
     for (int i=ride_bests.size()-1; i; i--) {
-        if (ride_bests[i] == 0) ride_bests[i]=last;
-        else last = ride_bests[i];
+        if (ride_bests[i] == 0) {
+            ride_bests[i]=last;
+            if (offsets) ride_starts[i] = lastStart;
+        } else {
+            last = ride_bests[i];
+            if (offsets) lastStart = ride_starts[i];
+        }
+        if (offsets) (*offsets)[i] = ride_starts[i];
 
         // convert from double to long, preserving the
         // precision by applying a multiplier
@@ -826,15 +1180,16 @@ MeanMaxComputer::run()
     }
 }
 
+// one of the distributions being collected by computeDistributions()
+struct DistributionDigest {
+    QVector<float> *array;
+    const double *values;
+    double factor, min, divide;
+};
+
 void
-RideFileCache::computeDistribution(QVector<float> &array, RideFile::SeriesType series)
+RideFileCache::computeDistributions()
 {
-    RideFile::SeriesType baseSeries = (series == RideFile::wattsKg) ?
-                                      RideFile::watts : series;
-
-    // only bother if the data series is actually present
-    if (ride->isDataPresent(baseSeries) == false) return;
-
     // get zones that apply, if any
     int zoneRange = context->athlete->zones() ? context->athlete->zones()->whichRange(ride->startTime().date()) : -1;
     int hrZoneRange = context->athlete->hrZones() ? context->athlete->hrZones()->whichRange(ride->startTime().date()) : -1;
@@ -845,62 +1200,127 @@ RideFileCache::computeDistribution(QVector<float> &array, RideFile::SeriesType s
     if (hrZoneRange != -1) LTHR=context->athlete->hrZones()->getLT(hrZoneRange);
     else LTHR=0;
 
-    // setup the array based upon the ride
-    int decimals = decimalsFor(series); //RideFile::decimalsFor(series) ? 1 : 0;
-    double min = RideFile::minimumFor(series) * pow(10, decimals);
-    double max = RideFile::maximumFor(series) * pow(10, decimals);
+    static const struct { RideFile::SeriesType series; QVector<float> RideFileCache::*array; } layout[] = {
+        { RideFile::watts, &RideFileCache::wattsDistribution },
+        { RideFile::hr, &RideFileCache::hrDistribution },
+        { RideFile::cad, &RideFileCache::cadDistribution },
+        { RideFile::nm, &RideFileCache::nmDistribution },
+        { RideFile::kph, &RideFileCache::kphDistribution },
+        { RideFile::wattsKg, &RideFileCache::wattsKgDistribution },
+        { RideFile::aPower, &RideFileCache::aPowerDistribution },
+        { RideFile::none, NULL }
+    };
+
+    // set up the ones we have data for, then visit each sample once
+    // and update all of them along with the time in zone
+    QVector<DistributionDigest> digests;
+    for (int d=0; layout[d].array; d++) {
+
+        RideFile::SeriesType series = layout[d].series;
+        RideFile::SeriesType baseSeries = (series == RideFile::wattsKg) ?
+                                          RideFile::watts : series;
+
+        // only bother if the data series is actually present
+        if (ride->isDataPresent(baseSeries) == false) continue;
+
+        // setup the array based upon the ride
+        int decimals = decimalsFor(series); //RideFile::decimalsFor(series) ? 1 : 0;
+        double min = RideFile::minimumFor(series) * pow(10, decimals);
+        double max = RideFile::maximumFor(series) * pow(10, decimals);
+
+        // lets resize the array to the right size
+        // it will also initialise with a default value
+        // which for longs is handily zero
+        QVector<float> &array = this->*(layout[d].array);
+        array.resize(max-min);
+
+        DistributionDigest add;
+        add.array = &array;
+        add.values = ride->seriesData(baseSeries).constData();
+        add.factor = pow(10, decimals);
+        add.min = min;
+        add.divide = series == RideFile::wattsKg ? ride->getWeight() : 1.0;
+        digests << add;
+    }
+    if (digests.isEmpty()) return;
 
-    // lets resize the array to the right size
-    // it will also initialise with a default value
-    // which for longs is handily zero
-    array.resize(max-min);
+    // stream over the columns rather than the points
+    const double *watts = ride->isDataPresent(RideFile::watts) ? ride->seriesData(RideFile::watts).constData() : NULL;
+    const double *hr = ride->isDataPresent(RideFile::hr) ? ride->seriesData(RideFile::hr).constData() : NULL;
+    double recIntSecs = ride->recIntSecs();
+    int samples = ride->dataPoints().count();
 
-    foreach(RideFilePoint *dp, ride->dataPoints()) {
-        double value = dp->value(baseSeries);
-        if (series == RideFile::wattsKg) {
-            value /= ride->getWeight();
-        }
+    // zone for each sample is a table lookup
+    ZoneLookup<Zones> *wattsZones = (watts && zoneRange != -1) ? new ZoneLookup<Zones>(context->athlete->zones(), zoneRange) : NULL;
+    ZoneLookup<HrZones> *hrZones = (hr && hrZoneRange != -1) ? new ZoneLookup<HrZones>(context->athlete->hrZones(), hrZoneRange) : NULL;
 
-        float lvalue = value * pow(10, decimals);
+    for (int i=0; i<samples; i++) {
+
+        for (int d=0; d<digests.count(); d++) {
+            DistributionDigest &digest = digests[d];
+            float lvalue = (digest.values[i] / digest.divide) * digest.factor;
+
+            int offset = lvalue - digest.min;
+            if (offset >= 0 && offset < digest.array->size()) (*digest.array)[offset] += recIntSecs;
+        }
 
         // watts time in zone
-        if (series == RideFile::watts && zoneRange != -1)
-            wattsTimeInZone[context->athlete->zones()->whichZone(zoneRange, dp->value(series))] += ride->recIntSecs();
+        if (wattsZones) wattsTimeInZone[wattsZones->whichZone(watts[i])] += recIntSecs;
 
         // hr time in zone
-        if (series == RideFile::hr && hrZoneRange != -1)
-            hrTimeInZone[context->athlete->hrZones()->whichZone(hrZoneRange, dp->value(series))] += ride->recIntSecs();
-
-        int offset = lvalue - min;
-        if (offset >= 0 && offset < array.size()) array[offset] += ride->recIntSecs();
+        if (hrZones) hrTimeInZone[hrZones->whichZone(hr[i])] += recIntSecs;
     }
+    delete wattsZones;
+    delete hrZones;
 }
 
 //
 // AGGREGATE FOR A GIVEN DATE RANGE
 //
-static QDate dateFromFileName(const QString filename) {
-    QRegExp rx("^(\\d\\d\\d\\d)_(\\d\\d)_(\\d\\d)_\\d\\d_\\d\\d_\\d\\d\\..*$");
-    if (rx.exactMatch(filename)) {
-        QDate date(rx.cap(1).toInt(), rx.cap(2).toInt(), rx.cap(3).toInt());
-        if (date.isValid()) return date;
+// select and update bests
+static void meanMaxAggregate(QVector<double> &into, QVector<double> &other, MeanMaxDates &dates, QDate rideDate)
+{
+    if (into.size() < other.size()) {
+        into.resize(other.size());
+        dates.resize(other.size());
     }
-    return QDate(); // nil date
+
+    // the dates are rebuilt as we go, beyond the ride they're unchanged
+    MeanMaxDates merged;
+    MeanMaxDates::Reader was(dates);
+    for (int i=0; i<other.size(); i++) {
+        QDate date = was.next();
+        if (other[i] > into[i]) {
+            into[i] = other[i];
+            date = rideDate;
+        }
+        merged.append(date);
+    }
+    for (int i=other.size(); i<into.size(); i++) merged.append(was.next());
+    dates = merged;
 }
 
-// select and update bests
-static void meanMaxAggregate(QVector<double> &into, QVector<double> &other, QVector<QDate>&dates, QDate rideDate)
+// select and update bests from another aggregate, keeping its dates
+static void meanMaxAggregate(QVector<double> &into, QVector<double> &other, MeanMaxDates &dates, MeanMaxDates &otherDates)
 {
     if (into.size() < other.size()) {
         into.resize(other.size());
         dates.resize(other.size());
     }
 
-    for (int i=0; i<other.size(); i++)
+    MeanMaxDates merged;
+    MeanMaxDates::Reader was(dates), theirs(otherDates);
+    int n = qMin(other.size(), otherDates.size());
+    for (int i=0; i<n; i++) {
+        QDate date = was.next(), otherDate = theirs.next();
         if (other[i] > into[i]) {
             into[i] = other[i];
-            dates[i] = rideDate;
+            date = otherDate;
         }
+        merged.append(date);
+    }
+    for (int i=n; i<into.size(); i++) merged.append(was.next());
+    dates = merged;
 }
 
 // resize into and then sum the arrays
@@ -912,103 +1332,91 @@ static void distAggregate(QVector<double> &into, QVector<double> &other)
 }
 
 RideFileCache::RideFileCache(Context *context, QDate start, QDate end, bool filter, QStringList files)
-               : start(start), end(end), context(context), rideFileName(""), ride(0) 
+               : start(start), end(end), context(context), rideFileName(""), ride(0),
+                 deferred(0), filtered(filter), filteredFiles(files)
 {
 
     // Oh lets get from the cache if we can -- but not if filtered
     if (!filter && !context->isfiltered) {
-        foreach(RideFileCache *p, context->athlete->cpxCache) {
+        QMutexLocker locker(&cpxCacheLock);
+        foreach(RideFileCacheAggregate *p, context->athlete->cpxCache) {
             if (p->start == start && p->end == end) {
-                *this = *p;
+                cpxStats.hit();
+                p->expand(*this);
                 return;
             }
         }
+        cpxStats.miss();
     }
 
     // resize all the arrays to zero - expand as neccessary
-    xPowerMeanMax.resize(0);
-    npMeanMax.resize(0);
-    wattsMeanMax.resize(0);
-    hrMeanMax.resize(0);
-    cadMeanMax.resize(0);
-    nmMeanMax.resize(0);
-    kphMeanMax.resize(0);
-    xPowerMeanMax.resize(0);
-    npMeanMax.resize(0);
-    vamMeanMax.resize(0);
-    wattsKgMeanMax.resize(0);
-    aPowerMeanMax.resize(0);
-    wattsDistribution.resize(0);
-    hrDistribution.resize(0);
-    cadDistribution.resize(0);
-    nmDistribution.resize(0);
-    kphDistribution.resize(0);
-    xPowerDistribution.resize(0);
-    npDistribution.resize(0);
-    wattsKgDistribution.resize(0);
-    aPowerDistribution.resize(0);
-
-    // time in zone are fixed to 10 zone max
-    wattsTimeInZone.resize(10);
-    hrTimeInZone.resize(10);
+    resetAggregate();
 
     // set cursor busy whilst we aggregate -- bit of feedback
-    // and less intrusive than a popup box
-    context->mainWindow->setCursor(Qt::WaitCursor);
+    // and less intrusive than a popup box, but only from the gui
+    // thread, callers may aggregate several ranges on a pool
+    bool gui = context->mainWindow && QThread::currentThread() == qApp->thread();
+    if (gui) context->mainWindow->setCursor(Qt::WaitCursor);
+
+    // whole months within the range are taken from the month aggregates
+    // we persist alongside the .cpx files, so only the rides in the part
+    // months at either end of the range need to be read one by one
+    bool useMonths = !filter && !context->isfiltered;
+    QMap<QDate, QStringList> months;
 
     // Iterate over the ride files (not the cpx files since they /might/ not
     // exist, or /might/ be out of date.
-    foreach (QString rideFileName, RideFileFactory::instance().listRideFiles(context->athlete->home)) {
+    foreach (QString rideFileName, context->athlete->allRideFiles()) {
         QDate rideDate = dateFromFileName(rideFileName);
         if (((filter == true && files.contains(rideFileName)) || filter == false) &&
             rideDate >= start && rideDate <= end) {
 
             // skip globally filtered values
-            if (context->isfiltered && !context->filters.contains(rideFileName)) continue;
+            if (context->isfiltered && !context->filterSet.contains(rideFileName)) continue;
+
+            // is the whole month in range?
+            QDate month(rideDate.year(), rideDate.month(), 1);
+            if (useMonths && month >= start && month.addMonths(1).addDays(-1) <= end) {
+                months[month] << rideFileName;
+                continue;
+            }
 
             // get its cached values (will refresh if needed...)
             RideFileCache rideCache(context, context->athlete->home.absolutePath() + "/" + rideFileName);
 
             // lets aggregate
-            meanMaxAggregate(wattsMeanMaxDouble, rideCache.wattsMeanMaxDouble, wattsMeanMaxDate, rideDate);
-            meanMaxAggregate(hrMeanMaxDouble, rideCache.hrMeanMaxDouble, hrMeanMaxDate, rideDate);
-            meanMaxAggregate(cadMeanMaxDouble, rideCache.cadMeanMaxDouble, cadMeanMaxDate, rideDate);
-            meanMaxAggregate(nmMeanMaxDouble, rideCache.nmMeanMaxDouble, nmMeanMaxDate, rideDate);
-            meanMaxAggregate(kphMeanMaxDouble, rideCache.kphMeanMaxDouble, kphMeanMaxDate, rideDate);
-            meanMaxAggregate(xPowerMeanMaxDouble, rideCache.xPowerMeanMaxDouble, xPowerMeanMaxDate, rideDate);
-            meanMaxAggregate(npMeanMaxDouble, rideCache.npMeanMaxDouble, npMeanMaxDate, rideDate);
-            meanMaxAggregate(vamMeanMaxDouble, rideCache.vamMeanMaxDouble, vamMeanMaxDate, rideDate);
-            meanMaxAggregate(wattsKgMeanMaxDouble, rideCache.wattsKgMeanMaxDouble, wattsKgMeanMaxDate, rideDate);
-            meanMaxAggregate(aPowerMeanMaxDouble, rideCache.aPowerMeanMaxDouble, aPowerMeanMaxDate, rideDate);
-
-            distAggregate(wattsDistributionDouble, rideCache.wattsDistributionDouble);
-            distAggregate(hrDistributionDouble, rideCache.hrDistributionDouble);
-            distAggregate(cadDistributionDouble, rideCache.cadDistributionDouble);
-            distAggregate(nmDistributionDouble, rideCache.nmDistributionDouble);
-            distAggregate(kphDistributionDouble, rideCache.kphDistributionDouble);
-            distAggregate(xPowerDistributionDouble, rideCache.xPowerDistributionDouble);
-            distAggregate(npDistributionDouble, rideCache.npDistributionDouble);
-            distAggregate(wattsKgDistributionDouble, rideCache.wattsKgDistributionDouble);
-            distAggregate(aPowerDistributionDouble, rideCache.aPowerDistributionDouble);
-
-            // cumulate timeinzones
-            for (int i=0; i<10; i++) {
-                hrTimeInZone[i] += rideCache.hrTimeInZone[i];
-                wattsTimeInZone[i] += rideCache.wattsTimeInZone[i];
-            }
+            aggregate(rideCache, rideDate);
         }
     }
 
+    // and now the whole months
+    QMapIterator<QDate, QStringList> month(months);
+    while (month.hasNext()) {
+        month.next();
+
+        RideFileCache monthCache(context);
+        monthCache.monthAggregate(month.key(), month.value());
+        aggregate(monthCache);
+    }
+
     // set the cursor back to normal
-    context->mainWindow->setCursor(Qt::ArrowCursor);
+    if (gui) context->mainWindow->setCursor(Qt::ArrowCursor);
 
     // lets add to the cache for others to re-use -- but not if filtered
     if (!context->isfiltered && !filter) {
-        if (context->athlete->cpxCache.count() > maxcache) {
+        RideFileCacheAggregate *add = new RideFileCacheAggregate(*this);
+
+        // oldest go first when over budget
+        QMutexLocker locker(&cpxCacheLock);
+        int bytes = add->bytes();
+        foreach(RideFileCacheAggregate *p, context->athlete->cpxCache) bytes += p->bytes();
+        while (bytes > cpxStats.budget() && context->athlete->cpxCache.count()) {
+            bytes -= context->athlete->cpxCache.at(0)->bytes();
             delete(context->athlete->cpxCache.at(0));
             context->athlete->cpxCache.removeAt(0);
         }
-        context->athlete->cpxCache.append(new RideFileCache(this));
+        context->athlete->cpxCache.append(add);
+        cpxStats.setUsage(context->athlete, bytes, context->athlete->cpxCache.count());
     }
 
 }
@@ -1016,15 +1424,45 @@ RideFileCache::RideFileCache(Context *context, QDate start, QDate end, bool filt
 //
 // PERSISTANCE
 //
+
+void
+RideFileCache::blockArrays(QVector<float> **floats, QVector<double> **doubles)
+{
+    QVector<float> *f[RideFileCacheBlocks] = {
+        &wattsMeanMax, &hrMeanMax, &cadMeanMax, &nmMeanMax, &kphMeanMax,
+        &xPowerMeanMax, &npMeanMax, &vamMeanMax, &wattsKgMeanMax, &aPowerMeanMax,
+        &wattsDistribution, &hrDistribution, &cadDistribution, &nmDistribution, &kphDistribution,
+        &xPowerDistribution, &npDistribution, &wattsKgDistribution, &aPowerDistribution,
+        &wattsTimeInZone, &hrTimeInZone,
+        &wattsMeanMaxOffsets
+    };
+    QVector<double> *d[RideFileCacheBlocks] = {
+        &wattsMeanMaxDouble, &hrMeanMaxDouble, &cadMeanMaxDouble, &nmMeanMaxDouble, &kphMeanMaxDouble,
+        &xPowerMeanMaxDouble, &npMeanMaxDouble, &vamMeanMaxDouble, &wattsKgMeanMaxDouble, &aPowerMeanMaxDouble,
+        &wattsDistributionDouble, &hrDistributionDouble, &cadDistributionDouble, &nmDistributionDouble, &kphDistributionDouble,
+        &xPowerDistributionDouble, &npDistributionDouble, &wattsKgDistributionDouble, &aPowerDistributionDouble,
+        NULL, NULL, // time in zone is only kept as floats
+        NULL        // as are the offsets
+    };
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        floats[i] = f[i];
+        doubles[i] = d[i];
+    }
+}
+
 void
 RideFileCache::serialize(QDataStream *out)
 {
     RideFileCacheHeader head;
+    QVector<float> *floats[RideFileCacheBlocks];
+    QVector<double> *doubles[RideFileCacheBlocks];
+    blockArrays(floats, doubles);
 
     // write header
     head.version = RideFileCacheVersion;
     head.CP = CP;
     head.LTHR = LTHR;
+    head.content = MetricAggregator::contentFingerPrint(rideFileName);
 
     head.wattsMeanMaxCount = wattsMeanMax.size();
     head.hrMeanMaxCount = hrMeanMax.size();
@@ -1038,7 +1476,7 @@ RideFileCache::serialize(QDataStream *out)
     head.aPowerMeanMaxCount = aPowerMeanMax.size();
     head.wattsDistCount = wattsDistribution.size();
     head.xPowerDistCount = xPowerDistribution.size();
-    head.npDistCount = xPowerDistribution.size();
+    head.npDistCount = npDistribution.size();
     head.hrDistCount = hrDistribution.size();
     head.cadDistCount = cadDistribution.size();
     head.nmDistrCount = nmDistribution.size();
@@ -1046,214 +1484,602 @@ RideFileCache::serialize(QDataStream *out)
     head.wattsKgDistCount = wattsKgDistribution.size();
     head.aPowerDistCount = aPowerDistribution.size();
 
-    out->writeRawData((const char *) &head, sizeof(head));
-
-    // write meanmax
-    out->writeRawData((const char *) wattsMeanMax.data(), sizeof(float) * wattsMeanMax.size());
-    out->writeRawData((const char *) hrMeanMax.data(), sizeof(float) * hrMeanMax.size());
-    out->writeRawData((const char *) cadMeanMax.data(), sizeof(float) * cadMeanMax.size());
-    out->writeRawData((const char *) nmMeanMax.data(), sizeof(float) * nmMeanMax.size());
-    out->writeRawData((const char *) kphMeanMax.data(), sizeof(float) * kphMeanMax.size());
-    out->writeRawData((const char *) xPowerMeanMax.data(), sizeof(float) * xPowerMeanMax.size());
-    out->writeRawData((const char *) npMeanMax.data(), sizeof(float) * npMeanMax.size());
-    out->writeRawData((const char *) vamMeanMax.data(), sizeof(float) * vamMeanMax.size());
-    out->writeRawData((const char *) wattsKgMeanMax.data(), sizeof(float) * wattsKgMeanMax.size());
-    out->writeRawData((const char *) aPowerMeanMax.data(), sizeof(float) * aPowerMeanMax.size());
-
-    // write dist
-    out->writeRawData((const char *) wattsDistribution.data(), sizeof(float) * wattsDistribution.size());
-    out->writeRawData((const char *) hrDistribution.data(), sizeof(float) * hrDistribution.size());
-    out->writeRawData((const char *) cadDistribution.data(), sizeof(float) * cadDistribution.size());
-    out->writeRawData((const char *) nmDistribution.data(), sizeof(float) * nmDistribution.size());
-    out->writeRawData((const char *) kphDistribution.data(), sizeof(float) * kphDistribution.size());
-    out->writeRawData((const char *) xPowerDistribution.data(), sizeof(float) * xPowerDistribution.size());
-    out->writeRawData((const char *) npDistribution.data(), sizeof(float) * npDistribution.size());
-    out->writeRawData((const char *) wattsKgDistribution.data(), sizeof(float) * wattsKgDistribution.size());
-    out->writeRawData((const char *) aPowerDistribution.data(), sizeof(float) * aPowerDistribution.size());
-
-    // time in zone
-    out->writeRawData((const char *) wattsTimeInZone.data(), sizeof(float) * wattsTimeInZone.size());
-    out->writeRawData((const char *) hrTimeInZone.data(), sizeof(float) * hrTimeInZone.size());
+    // block directory
+    unsigned int offset = sizeof(head);
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        head.blocks[i].type = cacheLayout[i].type;
+        head.blocks[i].series = cacheLayout[i].series;
+        head.blocks[i].offset = offset;
+        head.blocks[i].count = (deferred & (1 << i)) ? RideFileCacheDeferred : floats[i]->size();
+        offset += sizeof(float) * floats[i]->size();
+    }
+
+    out->writeRawData(reinterpret_cast<const char *>(&head), sizeof(head));
+
+    // write meanmax, dist and time in zone
+    for (int i=0; i<RideFileCacheBlocks; i++)
+        out->writeRawData(reinterpret_cast<const char *>(floats[i]->constData()), sizeof(float) * floats[i]->size());
 }
 
 void
 RideFileCache::readCache()
 {
-    RideFileCacheHeader head;
+    GC_TRACE_SPAN("cpx read");
     QFile cacheFile(cacheFileName);
+    if (cacheFile.open(QIODevice::ReadOnly) == false) return;
+
+    // map the file if we can, otherwise just read it in
+    qint64 size = cacheFile.size();
+    QByteArray contents;
+    const uchar *base = cacheFile.map(0, size);
+    if (base == NULL) {
+        contents = cacheFile.readAll();
+        base = reinterpret_cast<const uchar *>(contents.constData());
+        size = contents.size();
+    }
+    if (size < qint64(sizeof(RideFileCacheHeader))) {
+        cacheFile.close();
+        return;
+    }
 
-    if (cacheFile.open(QIODevice::ReadOnly) == true) {
-        QDataStream inFile(&cacheFile);
-
-        inFile.readRawData((char *) &head, sizeof(head));
+    const RideFileCacheHeader *head = reinterpret_cast<const RideFileCacheHeader *>(base);
+    QVector<float> *floats[RideFileCacheBlocks];
+    QVector<double> *doubles[RideFileCacheBlocks];
+    blockArrays(floats, doubles);
 
-        // resize all the arrays to fit
-        wattsMeanMax.resize(head.wattsMeanMaxCount);
-        hrMeanMax.resize(head.hrMeanMaxCount);
-        cadMeanMax.resize(head.cadMeanMaxCount);
-        nmMeanMax.resize(head.nmMeanMaxCount);
-        kphMeanMax.resize(head.kphMeanMaxCount);
-        npMeanMax.resize(head.npMeanMaxCount);
-        vamMeanMax.resize(head.vamMeanMaxCount);
-        xPowerMeanMax.resize(head.xPowerMeanMaxCount);
-        wattsKgMeanMax.resize(head.wattsKgMeanMaxCount);
-        aPowerMeanMax.resize(head.aPowerMeanMaxCount);
-
-        wattsDistribution.resize(head.wattsDistCount);
-        hrDistribution.resize(head.hrDistCount);
-        cadDistribution.resize(head.cadDistCount);
-        nmDistribution.resize(head.nmDistrCount);
-        kphDistribution.resize(head.kphDistCount);
-        xPowerDistribution.resize(head.xPowerDistCount);
-        npDistribution.resize(head.npDistCount);
-        wattsKgDistribution.resize(head.wattsKgDistCount);
-        aPowerDistribution.resize(head.aPowerDistCount);
-
-        // read in the arrays
-        inFile.readRawData((char *) wattsMeanMax.data(), sizeof(float) * wattsMeanMax.size());
-        inFile.readRawData((char *) hrMeanMax.data(), sizeof(float) * hrMeanMax.size());
-        inFile.readRawData((char *) cadMeanMax.data(), sizeof(float) * cadMeanMax.size());
-        inFile.readRawData((char *) nmMeanMax.data(), sizeof(float) * nmMeanMax.size());
-        inFile.readRawData((char *) kphMeanMax.data(), sizeof(float) * kphMeanMax.size());
-        inFile.readRawData((char *) xPowerMeanMax.data(), sizeof(float) * xPowerMeanMax.size());
-        inFile.readRawData((char *) npMeanMax.data(), sizeof(float) * npMeanMax.size());
-        inFile.readRawData((char *) vamMeanMax.data(), sizeof(float) * vamMeanMax.size());
-        inFile.readRawData((char *) wattsKgMeanMax.data(), sizeof(float) * wattsKgMeanMax.size());
-        inFile.readRawData((char *) aPowerMeanMax.data(), sizeof(float) * aPowerMeanMax.size());
-
-
-        // write dist
-        inFile.readRawData((char *) wattsDistribution.data(), sizeof(float) * wattsDistribution.size());
-        inFile.readRawData((char *) hrDistribution.data(), sizeof(float) * hrDistribution.size());
-        inFile.readRawData((char *) cadDistribution.data(), sizeof(float) * cadDistribution.size());
-        inFile.readRawData((char *) nmDistribution.data(), sizeof(float) * nmDistribution.size());
-        inFile.readRawData((char *) kphDistribution.data(), sizeof(float) * kphDistribution.size());
-        inFile.readRawData((char *) xPowerDistribution.data(), sizeof(float) * xPowerDistribution.size());
-        inFile.readRawData((char *) npDistribution.data(), sizeof(float) * npDistribution.size());
-        inFile.readRawData((char *) wattsKgDistribution.data(), sizeof(float) * wattsKgDistribution.size());
-        inFile.readRawData((char *) aPowerDistribution.data(), sizeof(float) * aPowerDistribution.size());
-
-        // time in zone
-        inFile.readRawData((char *) wattsTimeInZone.data(), sizeof(float) * 10);
-        inFile.readRawData((char *) hrTimeInZone.data(), sizeof(float) * 10);
-
-        // setup the doubles the users use
-        doubleArray(wattsMeanMaxDouble, wattsMeanMax, RideFile::watts);
-        doubleArray(hrMeanMaxDouble, hrMeanMax, RideFile::hr);
-        doubleArray(cadMeanMaxDouble, cadMeanMax, RideFile::cad);
-        doubleArray(nmMeanMaxDouble, nmMeanMax, RideFile::nm);
-        doubleArray(kphMeanMaxDouble, kphMeanMax, RideFile::kph);
-        doubleArray(npMeanMaxDouble, npMeanMax, RideFile::NP);
-        doubleArray(vamMeanMaxDouble, vamMeanMax, RideFile::vam);
-        doubleArray(xPowerMeanMaxDouble, xPowerMeanMax, RideFile::xPower);
-        doubleArray(wattsKgMeanMaxDouble, wattsKgMeanMax, RideFile::wattsKg);
-        doubleArray(aPowerMeanMaxDouble, aPowerMeanMax, RideFile::aPower);
-
-        doubleArray(wattsDistributionDouble, wattsDistribution, RideFile::watts);
-        doubleArray(hrDistributionDouble, hrDistribution, RideFile::hr);
-        doubleArray(cadDistributionDouble, cadDistribution, RideFile::cad);
-        doubleArray(nmDistributionDouble, nmDistribution, RideFile::nm);
-        doubleArray(kphDistributionDouble, kphDistribution, RideFile::kph);
-        doubleArray(xPowerDistributionDouble, xPowerDistribution, RideFile::xPower);
-        doubleArray(npDistributionDouble, npDistribution, RideFile::NP);
-        doubleArray(wattsKgDistributionDouble, wattsKgDistribution, RideFile::wattsKg);
-        doubleArray(aPowerDistributionDouble, aPowerDistribution, RideFile::aPower);
+    // the users only want doubles so we convert from the file
+    // directly, except time in zone which are returned as floats
+    deferred = 0;
+    for (int i=0; i<RideFileCacheBlocks; i++) {
 
-        cacheFile.close();
+        const RideFileCacheBlock &block = head->blocks[i];
+        if (block.count == RideFileCacheDeferred) {
+            deferred |= 1 << i; // not computed yet
+            continue;
+        }
+        if (qint64(block.offset) + qint64(block.count) * qint64(sizeof(float)) > size) break; // truncated
+        const float *from = reinterpret_cast<const float *>(base + block.offset);
+
+        if (doubles[i]) {
+            doubleArray(*doubles[i], from, block.count, cacheLayout[i].series);
+        } else if (cacheLayout[i].type == RideFileCacheTizBlock) {
+            int count = block.count < 10 ? block.count : 10; // fixed to 10 zones
+            for (int z=0; z<count; z++) (*floats[i])[z] = from[z];
+        } else {
+            floats[i]->resize(block.count);
+            memcpy(floats[i]->data(), from, block.count * sizeof(float));
+        }
     }
+
+    if (contents.isEmpty()) cacheFile.unmap(const_cast<uchar *>(base));
+    cacheFile.close();
 }
 
 // unpack the longs into a double array
 void RideFileCache::doubleArray(QVector<double> &into, QVector<float> &from, RideFile::SeriesType series)
+{
+    doubleArray(into, from.constData(), from.size(), series);
+}
+
+void RideFileCache::doubleArray(QVector<double> &into, const float *from, int count, RideFile::SeriesType series)
 {
     double divisor = pow(10, decimalsFor(series)); // ? 10 : 1;
-    into.resize(from.size());
-    for(int i=0; i<from.size(); i++) into[i] = double(from[i]) / divisor;
+    into.resize(count);
+    double *to = into.data();
+    for(int i=0; i<count; i++) to[i] = double(from[i]) / divisor;
 
     return;
 }
 
-// returns offset from end of head
-static long offsetForMeanMax(RideFileCacheHeader head, RideFile::SeriesType series)
+bool
+RideFileCache::completeDeferred(Context *context, QString rideFileName)
 {
-    long offset = 0;
+    GC_TRACE_SPAN("cpx deferred");
+    QMutexLocker locker(&deferredLock);
 
-    switch (series) {
-    case RideFile::aPower : offset += head.wattsKgMeanMaxCount * sizeof(float);
-    case RideFile::wattsKg : offset += head.vamMeanMaxCount * sizeof(float);
-    case RideFile::vam : offset += head.npMeanMaxCount * sizeof(float);
-    case RideFile::NP : offset += head.xPowerMeanMaxCount * sizeof(float);
-    case RideFile::xPower : offset += head.kphMeanMaxCount * sizeof(float);
-    case RideFile::kph : offset += head.nmMeanMaxCount * sizeof(float);
-    case RideFile::nm : offset += head.cadMeanMaxCount * sizeof(float);
-    case RideFile::cad : offset += head.hrMeanMaxCount * sizeof(float);
-    case RideFile::hr : offset += head.wattsMeanMaxCount * sizeof(float);
-    case RideFile::watts : offset += 0;
-    default:
-        break;
-    }
-
-    return offset;
+    QFileInfo rideFileInfo(rideFileName);
+    QFile cacheFile(rideFileInfo.path() + "/" + rideFileInfo.baseName() + ".cpx");
+    if (!isCurrent(rideFileName) || cacheFile.open(QIODevice::ReadWrite) == false) return false;
+
+    RideFileCacheHeader head;
+    if (cacheFile.read(reinterpret_cast<char *>(&head), sizeof(head)) != qint64(sizeof(head))) return false;
+
+    QList<int> blocks;
+    for (int i=0; i<RideFileCacheBlocks; i++)
+        if (head.blocks[i].count == RideFileCacheDeferred) blocks << i;
+    if (blocks.isEmpty()) return true; // another caller got here first
+
+    // open the ride, as the constructor does
+    QStringList errors;
+    QFile file(rideFileName);
+    RideFileDataPresent wanted = RideFileDataPresent::all();
+    wanted.lat = wanted.lon = wanted.headwind = wanted.slope = wanted.temp = wanted.lrbalance = false;
+
+    RideFile *ride = RideFileFactory::instance().openRideFileSeries(context, file, errors, wanted);
+    if (ride == NULL) return false;
+
+    ride->recalculateDerivedSeries(); // for vam
+    ride->seriesData(RideFile::secs);
+    MeanMaxTimeline timeline(ride);
+
+    QVector<QVector<float> > arrays(blocks.count());
+    QList<MeanMaxComputer*> threads;
+    for (int b=0; b<blocks.count(); b++) {
+        threads << new MeanMaxComputer(ride, arrays[b], cacheLayout[blocks[b]].series, NULL, &timeline);
+        threads.last()->start();
+    }
+    foreach (MeanMaxComputer *thread, threads) {
+        thread->wait();
+        delete thread;
+    }
+    QDate date = ride->startTime().date();
+    delete ride;
+
+    // append them and point the directory at them, the blocks
+    // already there don't move so readers can carry on using them
+    qint64 offset = cacheFile.size();
+    cacheFile.seek(offset);
+    for (int b=0; b<blocks.count(); b++) {
+        head.blocks[blocks[b]].offset = offset;
+        head.blocks[blocks[b]].count = arrays[b].size();
+        cacheFile.write(reinterpret_cast<const char *>(arrays[b].constData()), sizeof(float) * arrays[b].size());
+        offset += sizeof(float) * arrays[b].size();
+    }
+    cacheFile.seek(0);
+    cacheFile.write(reinterpret_cast<const char *>(&head), sizeof(head));
+    cacheFile.close();
+
+    // the date ranges that have this ride need them too, the month
+    // aggregate is older than the .cpx now so it will be rebuilt
+    invalidateIncore(context, date);
+
+    // and the standard bests the metric database keeps for the ride
+    if (QThread::currentThread() == QApplication::instance()->thread() &&
+        context->athlete->metricDB && context->athlete->metricDB->db())
+        context->athlete->metricDB->db()->importBests(rideFileInfo.fileName(), standardBests(context, rideFileInfo.fileName()));
+
+    return true;
+}
+
+//
+// AGGREGATION
+//
+void
+RideFileCache::resetAggregate()
+{
+    QVector<float> *floats[RideFileCacheBlocks];
+    QVector<double> *doubles[RideFileCacheBlocks];
+    blockArrays(floats, doubles);
+
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        floats[i]->resize(0);
+        if (doubles[i]) doubles[i]->resize(0);
+        if (cacheLayout[i].type == RideFileCacheMeanMaxBlock) meanMaxDates(cacheLayout[i].series).resize(0);
+    }
+    deferred = 0;
+
+    // time in zone are fixed to 10 zone max
+    wattsTimeInZone.resize(10);
+    hrTimeInZone.resize(10);
 }
 
-//offset to tiz table
-static long offsetForTiz(RideFileCacheHeader head, RideFile::SeriesType series)
+// add a single ride, all its bests are from the ride date
+void
+RideFileCache::aggregate(RideFileCache &other, QDate rideDate)
 {
-    long offset = 0;
-
-    // skip past the mean max arrays
-    offset += head.aPowerMeanMaxCount * sizeof(float);
-    offset += head.wattsKgMeanMaxCount * sizeof(float);
-    offset += head.vamMeanMaxCount * sizeof(float);
-    offset += head.npMeanMaxCount * sizeof(float);
-    offset += head.xPowerMeanMaxCount * sizeof(float);
-    offset += head.kphMeanMaxCount * sizeof(float);
-    offset += head.nmMeanMaxCount * sizeof(float);
-    offset += head.cadMeanMaxCount * sizeof(float);
-    offset += head.hrMeanMaxCount * sizeof(float);
-    offset += head.wattsMeanMaxCount * sizeof(float);
-
-    // skip past the distribution arrays
-    offset += head.wattsDistCount * sizeof(float);
-    offset += head.hrDistCount * sizeof(float);
-    offset += head.cadDistCount * sizeof(float);
-    offset += head.nmDistrCount * sizeof(float);
-    offset += head.kphDistCount * sizeof(float);
-    offset += head.xPowerDistCount * sizeof(float);
-    offset += head.npDistCount * sizeof(float);
-    offset += head.wattsKgDistCount * sizeof(float);
-    offset += head.aPowerDistCount * sizeof(float);
-
-    // Watts then HR
-    if (series == RideFile::hr) offset += 10 * sizeof(float);
-
-    return offset;
+    QVector<float> *floats[RideFileCacheBlocks], *otherFloats[RideFileCacheBlocks];
+    QVector<double> *doubles[RideFileCacheBlocks], *others[RideFileCacheBlocks];
+    blockArrays(floats, doubles);
+    other.blockArrays(otherFloats, others);
+
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        RideFile::SeriesType series = cacheLayout[i].series;
+        switch (cacheLayout[i].type) {
+        case RideFileCacheMeanMaxBlock:
+            meanMaxAggregate(meanMaxValues(series), other.meanMaxValues(series), meanMaxDates(series), rideDate);
+            break;
+        case RideFileCacheDistributionBlock:
+            distAggregate(*doubles[i], *others[i]);
+            break;
+        }
+    }
+
+    // cumulate timeinzones
+    for (int i=0; i<10; i++) {
+        hrTimeInZone[i] += other.hrTimeInZone[i];
+        wattsTimeInZone[i] += other.wattsTimeInZone[i];
+    }
+
+    // its deferred series are missing from ours too
+    deferred |= other.deferred;
 }
 
+// add another aggregate, the bests keep the dates they came from
+void
+RideFileCache::aggregate(RideFileCache &other)
+{
+    QVector<float> *floats[RideFileCacheBlocks], *otherFloats[RideFileCacheBlocks];
+    QVector<double> *doubles[RideFileCacheBlocks], *others[RideFileCacheBlocks];
+    blockArrays(floats, doubles);
+    other.blockArrays(otherFloats, others);
+
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        RideFile::SeriesType series = cacheLayout[i].series;
+        switch (cacheLayout[i].type) {
+        case RideFileCacheMeanMaxBlock:
+            meanMaxAggregate(meanMaxValues(series), other.meanMaxValues(series),
+                             meanMaxDates(series), other.meanMaxDates(series));
+            break;
+        case RideFileCacheDistributionBlock:
+            distAggregate(*doubles[i], *others[i]);
+            break;
+        }
+    }
 
-// returns offset from end of head
-static long countForMeanMax(RideFileCacheHeader head, RideFile::SeriesType series)
+    for (int i=0; i<10; i++) {
+        hrTimeInZone[i] += other.hrTimeInZone[i];
+        wattsTimeInZone[i] += other.wattsTimeInZone[i];
+    }
+    deferred |= other.deferred;
+}
+
+//
+// COMPACT AGGREGATES FOR THE INCORE CACHE
+//
+static const int compactFullSecs = 3600; // every duration up to an hour
+
+RideFileCacheAggregate::RideFileCacheAggregate(RideFileCache &from) : start(from.start), end(from.end)
 {
-    switch (series) {
-    case RideFile::aPower : return head.aPowerMeanMaxCount;
-    case RideFile::wattsKg : return head.wattsKgMeanMaxCount;
-    case RideFile::vam : return head.vamMeanMaxCount;
-    case RideFile::NP : return head.npMeanMaxCount;
-    case RideFile::xPower :  return head.xPowerMeanMaxCount;
-    case RideFile::kph :  return head.kphMeanMaxCount;
-    case RideFile::nm :  return head.nmMeanMaxCount;
-    case RideFile::cad :  return head.cadMeanMaxCount;
-    case RideFile::hr :  return head.hrMeanMaxCount;
-    case RideFile::watts :  return head.wattsMeanMaxCount;
-    default:
-        break;
+    QVector<float> *floats[RideFileCacheBlocks];
+    QVector<double> *doubles[RideFileCacheBlocks];
+    from.blockArrays(floats, doubles);
+
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        RideFile::SeriesType series = cacheLayout[i].series;
+        switch (cacheLayout[i].type) {
+        case RideFileCacheMeanMaxBlock:
+            {
+                const QVector<double> &values = from.meanMaxValues(series);
+
+                MeanMax m;
+                m.size = values.size();
+                m.dates = from.meanMaxDates(series);
+                m.dates.resize(m.size);
+                for (int secs=0; secs < m.size; secs += (secs < compactFullSecs ? 1 : qMax(1, secs/100))) {
+                    m.secs << secs;
+                    m.values << values[secs];
+                }
+
+                // always keep the longest
+                if (m.size && m.secs.last() != m.size-1) {
+                    m.secs << m.size-1;
+                    m.values << values[m.size-1];
+                }
+                meanMax << m;
+            }
+            break;
+        case RideFileCacheDistributionBlock:
+            {
+                QVector<float> dist(doubles[i]->size());
+                for (int j=0; j<dist.size(); j++) dist[j] = (*doubles[i])[j];
+                distributions << dist;
+            }
+            break;
+        }
     }
+    wattsTimeInZone = from.wattsTimeInZone;
+    hrTimeInZone = from.hrTimeInZone;
+    deferred = from.deferred;
+}
 
-    return 0;
+void
+RideFileCacheAggregate::expand(RideFileCache &into) const
+{
+    into.resetAggregate();
+    into.start = start;
+    into.end = end;
+
+    QVector<float> *floats[RideFileCacheBlocks];
+    QVector<double> *doubles[RideFileCacheBlocks];
+    into.blockArrays(floats, doubles);
+
+    int nmeanmax = 0, ndist = 0;
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        RideFile::SeriesType series = cacheLayout[i].series;
+        switch (cacheLayout[i].type) {
+        case RideFileCacheMeanMaxBlock:
+            {
+                const MeanMax &m = meanMax[nmeanmax++];
+                QVector<double> &values = into.meanMaxValues(series);
+                values.resize(m.size);
+                into.meanMaxDates(series) = m.dates;
+
+                // durations between those kept are interpolated
+                for (int k=0; k<m.secs.count(); k++) {
+                    int from = m.secs[k];
+                    if (k == m.secs.count()-1) {
+                        values[from] = m.values[k];
+                        break;
+                    }
+
+                    int to = m.secs[k+1];
+                    for (int secs=from; secs<to; secs++) {
+                        double ratio = double(secs-from) / (to-from);
+                        values[secs] = m.values[k] + ratio * (m.values[k+1] - m.values[k]);
+                    }
+                }
+            }
+            break;
+        case RideFileCacheDistributionBlock:
+            {
+                const QVector<float> &dist = distributions[ndist++];
+                doubles[i]->resize(dist.size());
+                for (int j=0; j<dist.size(); j++) (*doubles[i])[j] = dist[j];
+            }
+            break;
+        }
+    }
+    into.wattsTimeInZone = wattsTimeInZone;
+    into.hrTimeInZone = hrTimeInZone;
+    into.deferred = deferred;
 }
+
+int
+RideFileCacheAggregate::bytes() const
+{
+    int bytes = sizeof(*this);
+    foreach(const MeanMax &m, meanMax)
+        bytes += m.secs.count() * (sizeof(int) + sizeof(float)) + m.dates.runs() * (sizeof(int) + sizeof(QDate));
+    foreach(const QVector<float> &dist, distributions)
+        bytes += dist.count() * sizeof(float);
+    return bytes;
+}
+
+// the month aggregates live in the athlete home as yyyy_MM.cpxm
+QString
+RideFileCache::aggregateFileName(Context *context, QDate month)
+{
+    return context->athlete->home.absolutePath() + "/" + month.toString("yyyy_MM") + ".cpxm";
+}
+
+void
+RideFileCache::invalidateAggregate(Context *context, QDate date)
+{
+    QFile::remove(aggregateFileName(context, QDate(date.year(), date.month(), 1)));
+}
+
+// aggregate all the rides in a month, reusing the saved aggregate
+// if it is still newer than every ride and .cpx file in the month
+void
+RideFileCache::monthAggregate(QDate month, QStringList rides)
+{
+    QString filename = aggregateFileName(context, month);
+    QFileInfo aggregateInfo(filename);
+
+    if (aggregateInfo.exists()) {
+
+        bool current = true;
+        foreach(QString rideFileName, rides) {
+            QFileInfo rideInfo(context->athlete->home.absolutePath() + "/" + rideFileName);
+            QFileInfo cpxInfo(rideInfo.path() + "/" + rideInfo.baseName() + ".cpx");
+
+            if (!cpxInfo.exists() || rideInfo.lastModified() > aggregateInfo.lastModified() ||
+                cpxInfo.lastModified() > aggregateInfo.lastModified()) {
+                current = false;
+                break;
+            }
+        }
+        if (current && readAggregate(filename, rides.count())) return;
+        resetAggregate();
+    }
+
+    // rebuild it from the rides
+    foreach(QString rideFileName, rides) {
+        RideFileCache rideCache(context, context->athlete->home.absolutePath() + "/" + rideFileName);
+        aggregate(rideCache, dateFromFileName(rideFileName));
+    }
+    writeAggregate(filename, rides.count());
+}
+
+bool
+RideFileCache::readAggregate(QString filename, int rides)
+{
+    QFile file(filename);
+    if (file.open(QIODevice::ReadOnly) == false) return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_6);
+
+    quint32 version, deferredBlocks;
+    qint32 count;
+    in >> version >> count;
+
+    // a ride was added or removed since it was saved
+    if (version != RideFileCacheAggregateVersion || count != rides) return false;
+    in >> deferredBlocks;
+    deferred = deferredBlocks;
+
+    QVector<float> *floats[RideFileCacheBlocks];
+    QVector<double> *doubles[RideFileCacheBlocks];
+    blockArrays(floats, doubles);
+
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        RideFile::SeriesType series = cacheLayout[i].series;
+        switch (cacheLayout[i].type) {
+        case RideFileCacheMeanMaxBlock:
+            in >> meanMaxValues(series) >> meanMaxDates(series);
+            break;
+        case RideFileCacheDistributionBlock:
+            in >> *doubles[i];
+            break;
+        case RideFileCacheTizBlock:
+            in >> (series == RideFile::watts ? wattsTimeInZone : hrTimeInZone);
+            break;
+        }
+    }
+
+    if (in.status() != QDataStream::Ok || wattsTimeInZone.size() != 10 || hrTimeInZone.size() != 10) {
+        resetAggregate();
+        return false;
+    }
+    return true;
+}
+
+void
+RideFileCache::writeAggregate(QString filename, int rides)
+{
+    QFile file(filename);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate) == false) return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_6);
+
+    out << quint32(RideFileCacheAggregateVersion) << qint32(rides) << quint32(deferred);
+
+    QVector<float> *floats[RideFileCacheBlocks];
+    QVector<double> *doubles[RideFileCacheBlocks];
+    blockArrays(floats, doubles);
+
+    for (int i=0; i<RideFileCacheBlocks; i++) {
+        RideFile::SeriesType series = cacheLayout[i].series;
+        switch (cacheLayout[i].type) {
+        case RideFileCacheMeanMaxBlock:
+            out << meanMaxValues(series) << meanMaxDates(series);
+            break;
+        case RideFileCacheDistributionBlock:
+            out << *doubles[i];
+            break;
+        case RideFileCacheTizBlock:
+            out << (series == RideFile::watts ? wattsTimeInZone : hrTimeInZone);
+            break;
+        }
+    }
+    file.close();
+}
+
+// find a block in the directory
+static const RideFileCacheBlock *blockFor(const RideFileCacheHeader &head, unsigned int type, RideFile::SeriesType series)
+{
+    for (int i=0; i<RideFileCacheBlocks; i++)
+        if (head.blocks[i].type == type && head.blocks[i].series == (unsigned int)series)
+            return &head.blocks[i];
+    return NULL;
+}
+
+// returns offset from start of file, or -1 if not there
+static long offsetForMeanMax(const RideFileCacheHeader &head, RideFile::SeriesType series)
+{
+    const RideFileCacheBlock *block = blockFor(head, RideFileCacheMeanMaxBlock, series);
+    return block ? long(block->offset) : -1;
+}
+
+//offset to tiz table from start of file, or -1 if not there
+static long offsetForTiz(const RideFileCacheHeader &head, RideFile::SeriesType series)
+{
+    const RideFileCacheBlock *block = blockFor(head, RideFileCacheTizBlock, series);
+    return block ? long(block->offset) : -1;
+}
+
+// returns number of durations in the mean max array
+static long countForMeanMax(const RideFileCacheHeader &head, RideFile::SeriesType series)
+{
+    const RideFileCacheBlock *block = blockFor(head, RideFileCacheMeanMaxBlock, series);
+    return (block && block->count != RideFileCacheDeferred) ? long(block->count) : 0;
+}
+
+// the mean max array hasn't been computed yet, see completeDeferred()
+static bool isDeferred(const RideFileCacheHeader &head, RideFile::SeriesType series)
+{
+    const RideFileCacheBlock *block = blockFor(head, RideFileCacheMeanMaxBlock, series);
+    return block && block->count == RideFileCacheDeferred;
+}
+
+// the bests the metric database keeps for every ride, in this order
+static const RideFile::SeriesType standardSeries[] = {
+    RideFile::watts, RideFile::hr, RideFile::cad, RideFile::nm, RideFile::kph,
+    RideFile::xPower, RideFile::NP, RideFile::vam, RideFile::wattsKg, RideFile::aPower
+};
+static const int standardDurations[] = {
+    1, 5, 10, 15, 20, 30, 60, 120, 180, 300, 360, 600, 1200, 1800, 2400, 3600, 5400, 7200
+};
+static const int nStandardSeries = sizeof(standardSeries) / sizeof(standardSeries[0]);
+static const int nStandardDurations = sizeof(standardDurations) / sizeof(standardDurations[0]);
+
+// where a best is in standardBests(), or -1 if it isn't one of them
+static int standardIndex(RideFile::SeriesType series, int duration)
+{
+    for (int s=0; s<nStandardSeries; s++) {
+        if (standardSeries[s] != series) continue;
+        for (int d=0; d<nStandardDurations; d++)
+            if (standardDurations[d] == duration) return s * nStandardDurations + d;
+    }
+    return -1;
+}
+
+// the raw value, as stored in the .cpx
+static float standardBest(const QByteArray &bests, int index)
+{
+    float value = 0;
+    if (index >= 0 && (index+1) * int(sizeof(float)) <= bests.size())
+        memcpy(&value, bests.constData() + index * sizeof(float), sizeof(float));
+    return value;
+}
+
+// from the metric database when it has them, the caller falls back to the .cpx
+static bool standardBestsFor(Context *context, QString filename, QByteArray &bests)
+{
+    return context->athlete->metricDB && context->athlete->metricDB->db() &&
+           context->athlete->metricDB->db()->getBests(filename, bests);
+}
+
+QByteArray
+RideFileCache::standardBests(Context *context, QString filename)
+{
+    QFileInfo rideFileInfo(context->athlete->home.absolutePath() + "/" + filename);
+    QFile cacheFile(context->athlete->home.absolutePath() + "/" + rideFileInfo.baseName() + ".cpx");
+    if (cacheFile.open(QIODevice::ReadOnly) == false) return QByteArray();
+
+    RideFileCacheHeader head;
+    QDataStream inFile(&cacheFile);
+    inFile.readRawData(reinterpret_cast<char *>(&head), sizeof(head));
+    if (head.version != RideFileCacheVersion) return QByteArray();
+
+    QVector<float> bests(nStandardSeries * nStandardDurations, 0);
+    QVector<float> values;
+    for (int s=0; s<nStandardSeries; s++) {
+
+        // marked so best() goes to the .cpx, which computes it
+        if (isDeferred(head, standardSeries[s])) {
+            for (int d=0; d<nStandardDurations; d++) bests[s * nStandardDurations + d] = -1;
+            continue;
+        }
+
+        long offset = offsetForMeanMax(head, standardSeries[s]);
+        int count = qMin(countForMeanMax(head, standardSeries[s]), long(standardDurations[nStandardDurations-1]));
+        if (offset < 0 || count < 1) continue;
+
+        // one read for all the durations we keep
+        values.resize(count);
+        cacheFile.seek(qint64(offset));
+        inFile.readRawData(reinterpret_cast<char *>(values.data()), sizeof(float) * count);
+
+        for (int d=0; d<nStandardDurations && standardDurations[d] <= count; d++)
+            bests[s * nStandardDurations + d] = values[standardDurations[d]-1];
+    }
+    cacheFile.close();
+
+    return QByteArray(reinterpret_cast<const char *>(bests.constData()), bests.count() * sizeof(float));
+}
+
 double 
 RideFileCache::best(Context *context, QString filename, RideFile::SeriesType series, int duration)
 {
+    // one of the bests the metric database keeps?
+    QByteArray bests;
+    int index = standardIndex(series, duration);
+    if (index >= 0 && standardBestsFor(context, filename, bests) && standardBest(bests, index) >= 0)
+        return standardBest(bests, index) / pow(10, decimalsFor(series));
+
     // read the header
     QFileInfo rideFileInfo(context->athlete->home.absolutePath() + "/" + filename);
     QString cacheFileName(context->athlete->home.absolutePath() + "/" + rideFileInfo.baseName() + ".cpx");
@@ -1265,20 +2091,27 @@ RideFileCache::best(Context *context, QString filename, RideFile::SeriesType ser
 
     if (cacheFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) == true) {
         QDataStream inFile(&cacheFile);
-        inFile.readRawData((char *) &head, sizeof(head));
+        inFile.readRawData(reinterpret_cast<char *>(&head), sizeof(head));
+
+        // not computed yet, do it now and look again
+        if (head.version == RideFileCacheVersion && isDeferred(head, series)) {
+            cacheFile.close();
+            if (completeDeferred(context, rideFileInfo.filePath()) == false) return 0;
+            return best(context, filename, series, duration);
+        }
 
         // out of date or not enough samples
-        if (head.version != RideFileCacheVersion || duration > countForMeanMax(head, series)) {
+        if (!RideFileCacheReadableVersion(head.version) || duration < 1 || duration > countForMeanMax(head, series)) {
             cacheFile.close();
             return 0;
         }
 
         // jump to correct offset
         long offset = offsetForMeanMax(head, series) + (sizeof(float) * (duration-1));
-        inFile.skipRawData(offset);
+        cacheFile.seek(qint64(offset));
 
         float readhere = 0;
-        inFile.readRawData((char*)&readhere, sizeof(float));
+        inFile.readRawData(reinterpret_cast<char *>(&readhere), sizeof(float));
         cacheFile.close();
 
         double divisor = pow(10, decimalsFor(series)); // ? 10 : 1;
@@ -1307,14 +2140,14 @@ RideFileCache::tiz(Context *context, QString filename, RideFile::SeriesType seri
         inFile.readRawData((char *) &head, sizeof(head));
 
         // out of date 
-        if (head.version != RideFileCacheVersion) {
+        if (!RideFileCacheReadableVersion(head.version) || offsetForTiz(head, series) < 0) {
             cacheFile.close();
             return 0;
         }
 
         // jump to correct offset
         long offset = offsetForTiz(head, series) + (sizeof(float) * (zone-1));
-        inFile.skipRawData(offset);
+        cacheFile.seek(qint64(offset));
 
         float readhere = 0;
         inFile.readRawData((char*)&readhere, sizeof(float));
@@ -1326,6 +2159,87 @@ RideFileCache::tiz(Context *context, QString filename, RideFile::SeriesType seri
     return 0;
 }
 
+bool
+RideFileCache::bestEffort(const RideItem *item, int duration, double &start, double &watts)
+{
+    // unsaved changes aren't in the cache
+    if (item == NULL || item->isDirty() || duration < 1) return false;
+
+    QFileInfo rideFileInfo(item->path + "/" + item->fileName);
+    if (!isReadable(rideFileInfo.filePath())) return false;
+
+    QFile cacheFile(rideFileInfo.path() + "/" + rideFileInfo.baseName() + ".cpx");
+    if (cacheFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) == false) return false;
+
+    RideFileCacheHeader head;
+    QDataStream inFile(&cacheFile);
+    inFile.readRawData(reinterpret_cast<char *>(&head), sizeof(head));
+
+    const RideFileCacheBlock *values = blockFor(head, RideFileCacheMeanMaxBlock, RideFile::watts);
+    const RideFileCacheBlock *offsets = blockFor(head, RideFileCacheOffsetBlock, RideFile::watts);
+
+    // ride is shorter than the duration or has no power
+    if (!RideFileCacheReadableVersion(head.version) || !values || !offsets ||
+        duration >= int(values->count) || duration >= int(offsets->count)) {
+        cacheFile.close();
+        return false;
+    }
+
+    float value = 0, offset = 0;
+    cacheFile.seek(qint64(values->offset) + sizeof(float) * duration);
+    inFile.readRawData(reinterpret_cast<char *>(&value), sizeof(float));
+    cacheFile.seek(qint64(offsets->offset) + sizeof(float) * duration);
+    inFile.readRawData(reinterpret_cast<char *>(&offset), sizeof(float));
+    cacheFile.close();
+
+    watts = value / pow(10, decimalsFor(RideFile::watts));
+    start = offset;
+    return watts > 0;
+}
+
+QVector<float>
+RideFileCache::intervalMeanMax(RideItem *item, double start, double stop, RideFile::SeriesType series)
+{
+    QString key = QString("%1/%2:%3:%4:%5:%6").arg(item->path).arg(item->fileName).arg(item->revision())
+                  .arg(start).arg(stop).arg(int(series));
+
+    QMutexLocker locker(&intervalCacheLock);
+    QVector<float> *found = intervalCache.object(key);
+    if (found) {
+        intervalStats.hit();
+        return *found;
+    }
+    intervalStats.miss();
+    locker.unlock();
+
+    // make a ridefile with just the interval
+    RideFile *ride = item->ride();
+    if (ride == NULL) return QVector<float>();
+
+    RideFile f;
+    f.context = ride->context;
+    f.setRecIntSecs(ride->recIntSecs());
+    foreach(const RideFilePoint *p, ride->dataPoints()) {
+        if (p->secs+f.recIntSecs() > start && p->secs < stop) {
+            f.appendPoint(p->secs, p->cad, p->hr, p->km, p->kph, p->nm,
+                          p->watts, p->alt, p->lon, p->lat, p->headwind,
+                          p->slope, p->temp, p->lrbalance, 0);
+        }
+    }
+    f.recalculateDerivedSeries(); // for xpower et al
+
+    QVector<float> *vector = new QVector<float>;
+    MeanMaxComputer computer(&f, *vector, series);
+    computer.run();
+
+    QVector<float> result = *vector;
+    locker.relock();
+    intervalCache.setMaxCost(intervalStats.budget());
+    intervalCache.insert(key, vector, qMax(1, int(sizeof(float)) * vector->size()));
+    intervalStats.setUsage(&intervalCache, intervalCache.totalCost(), intervalCache.count());
+    return result;
+}
+
 // get best values (as passed in the list of MetricDetails between the dates specified
 // and return as an array of SummaryMetrics.
 //
@@ -1353,6 +2267,42 @@ RideFileCache::getAllBestsFor(Context *context, QList<MetricDetail> metrics, QDa
     }
     if (worklist.count() == 0) return results; // no work to do
 
+    // when they are all standard bests the metric database has
+    // them for every ride in one read, rather than a .cpx per ride
+    QVector<int> index;
+    foreach (MetricDetail workitem, worklist) {
+        index << standardIndex(workitem.series, workitem.duration * workitem.duration_units);
+        if (index.last() < 0) break;
+    }
+    if (!index.contains(-1) && context->athlete->metricDB && context->athlete->metricDB->db()) {
+
+        QRegExp rx ("^((\\d\\d\\d\\d)_(\\d\\d)_(\\d\\d)_(\\d\\d)_(\\d\\d)_(\\d\\d))\\.(.+)$");
+        QList<QPair<QString, QByteArray> > bests = context->athlete->metricDB->db()->getBestsFor(from, to);
+        for (int i=0; i<bests.count(); i++) {
+
+            // ride date from the filename, like the .cpx path below
+            if (!rx.exactMatch(bests[i].first)) continue;
+            QDateTime datetime(QDate(rx.cap(2).toInt(), rx.cap(3).toInt(),rx.cap(4).toInt()),
+                               QTime(rx.cap(5).toInt(), rx.cap(6).toInt(),rx.cap(7).toInt()));
+            if (datetime < from || datetime > to) continue;
+
+            SummaryMetrics add;
+            add.setFileName(bests[i].first);
+            add.setRideDate(datetime);
+            for (int w=0; w<worklist.count(); w++) {
+                float value = standardBest(bests[i].second, index[w]);
+
+                // deferred in the .cpx, best() will compute it
+                if (value < 0) value = best(context, bests[i].first, worklist[w].series,
+                                            worklist[w].duration * worklist[w].duration_units) *
+                                       pow(10, decimalsFor(worklist[w].series));
+                add.setForSymbol(worklist[w].bestSymbol, value);
+            }
+            results << add;
+        }
+        return results;
+    }
+
     // get a list of rides & iterate over them
     foreach(QString filename, context->athlete->metricDB->allActivityFilenames()) {
 
@@ -1385,7 +2335,7 @@ RideFileCache::getAllBestsFor(Context *context, QList<MetricDetail> metrics, QDa
         inFile.readRawData((char *) &head, sizeof(head));
 
         // out of date 
-        if (head.version != RideFileCacheVersion) {
+        if (!RideFileCacheReadableVersion(head.version)) {
             cacheFile.close();
             continue;
         }
@@ -1400,12 +2350,13 @@ RideFileCache::getAllBestsFor(Context *context, QList<MetricDetail> metrics, QDa
             int seconds = workitem.duration * workitem.duration_units;
             float value;
 
-            if (seconds > countForMeanMax(head, workitem.series)) value=0.0;
+            if (isDeferred(head, workitem.series)) {
+                value = best(context, filename, workitem.series, seconds) * pow(10, decimalsFor(workitem.series));
+            } else if (seconds < 1 || seconds > countForMeanMax(head, workitem.series)) value=0.0;
             else {
 
                 // get the values and place into the summarymetric map
-                long offset = offsetForMeanMax(head, workitem.series) + 
-                              (sizeof(head)) +
+                long offset = offsetForMeanMax(head, workitem.series) +
                               (sizeof(float) * ((workitem.duration*workitem.duration_units)-1));
 
                 cacheFile.seek(qint64(offset));
@@ -23,9 +23,11 @@
 #include <QDataStream>
 #include <QVector>
 #include <QThread>
+#include <QAtomicInt>
 
 class Context;
 class RideFile;
+class RideItem;
 class SummaryMetrics;
 class MetricDetail;
 
@@ -40,7 +42,7 @@ typedef double data_t;
 // arrays when plotting CP curves and histograms. It is precoputed
 // to save time and cached in a file .cpx
 //
-static const unsigned int RideFileCacheVersion = 9;
+static const unsigned int RideFileCacheVersion = 13;
 // revision history:
 // version  date         description
 // 1        29-Apr-11    Initial - header, mean-max & distribution data blocks
@@ -52,12 +54,53 @@ static const unsigned int RideFileCacheVersion = 9;
 // 7        03-Dec-12    Fixed W/kg calculations!
 // 8        13-Feb-13    Fixed VAM calculations
 // 9        06-Nov-13    Added aPower
+// 10       14-Oct-26    Block directory in header for random access and mmap
+// 11       14-Oct-26    Start times of the watts mean-max efforts
+// 12       14-Oct-26    Rarely used mean-max series computed when first asked for
+// 13       14-Oct-26    Fingerprint of the ride file content so synced copies are kept
+
+// the oldest version laid out just as this one, so its values can still be shown
+// whilst CpxRebuildTask works through them after a version bump. When a new
+// version changes the layout rather than just how the values are computed
+// this has to move up with it
+static const unsigned int RideFileCacheReadable = 13;
+static inline bool RideFileCacheReadableVersion(unsigned int version) {
+    return version >= RideFileCacheReadable && version <= RideFileCacheVersion;
+}
+
+// The month aggregates (yyyy_MM.cpxm) hold the mean-max (with dates),
+// distribution and time in zone for all the rides in a calendar month
+// so date range aggregates only need to read the part months at the
+// ends of the range. They are a QDataStream with their own version.
+static const unsigned int RideFileCacheAggregateVersion = 3;
 
 // The cache file (.cpx) has a binary format:
 // 1 x Header data - describing the version and contents of the cache
 // n x Blocks - meanmax or distribution arrays
 // 1 x Watts TIZ - 10 floats
 // 1 x Heartrate TIZ - 10 floats
+// 1 x Watts offsets - start time (secs) of each watts mean-max effort
+
+// The header ends with a directory of all the blocks that follow it
+// giving the offset from the start of the file and count of floats
+// so a reader can seek (or index into a mapped file) directly to the
+// block or value it wants. The blocks are in the same order as the
+// directory and are always 4 byte aligned.
+//
+// The rarely used mean-max series (cadence, torque and VAM) are not
+// computed when the cache is built. Their count in the directory is
+// RideFileCacheDeferred until someone asks for one, when they are all
+// computed and appended to the end of the file.
+enum { RideFileCacheMeanMaxBlock=0, RideFileCacheDistributionBlock, RideFileCacheTizBlock, RideFileCacheOffsetBlock };
+
+struct RideFileCacheBlock {
+    unsigned int type,      // one of the block types above
+                 series,    // RideFile::SeriesType
+                 offset,    // in bytes from the start of the file
+                 count;     // number of floats
+};
+static const int RideFileCacheBlocks = 22; // 10 meanmax, 9 distribution, 2 tiz, 1 offsets
+static const unsigned int RideFileCacheDeferred = 0xffffffff; // count of a block not computed yet
 
 // The header is written directly to disk, the only
 // field which is endian sensitive is the count field
@@ -89,7 +132,10 @@ struct RideFileCacheHeader {
 
     int LTHR, // used to calculate Time in Zone (TIZ)
         CP;   // used to calculate Time in Zone (TIZ)
-                
+
+    unsigned int content; // fingerprint of the ride file it was built from
+
+    RideFileCacheBlock blocks[RideFileCacheBlocks];
 };
 
 
@@ -111,6 +157,45 @@ struct RideFileCacheHeader {
 // the arrays have been computed they can be retrieved quickly.
 //
 // This is the main user entry to the ridefile cached data.
+// The date each best in a date range came from, by duration. The bests
+// for neighbouring durations mostly come from the same ride, so they are
+// kept as runs of durations with the same date rather than a date each.
+class MeanMaxDates
+{
+    public:
+        int size() const { return ends.isEmpty() ? 0 : ends.last(); }
+        int runs() const { return ends.count(); }
+        QDate at(int secs) const; // invalid out of range
+        QDate operator[](int secs) const { return at(secs); }
+
+        void clear() { ends.clear(); dates.clear(); }
+        void resize(int size); // the durations added have no date
+        void append(const QDate &date, int count = 1); // the next durations
+
+        // the dates for each duration in turn, for merging
+        class Reader {
+            public:
+                Reader(const MeanMaxDates &of) : of(of), run(0), secs(0) {}
+                QDate next() {
+                    while (run < of.ends.count() && secs >= of.ends[run]) run++;
+                    secs++;
+                    return run < of.ends.count() ? of.dates[run] : QDate();
+                }
+            private:
+                const MeanMaxDates &of;
+                int run, secs;
+        };
+        friend class Reader;
+
+        friend QDataStream &operator<<(QDataStream &out, const MeanMaxDates &d) { return out << d.ends << d.dates; }
+        friend QDataStream &operator>>(QDataStream &in, MeanMaxDates &d) { return in >> d.ends >> d.dates; }
+
+    private:
+        QVector<int> ends;      // one past the last duration in each run
+        QVector<QDate> dates;   // for each run
+};
+
+class RideFileCacheAggregate;
 class RideFileCache
 {
     public:
@@ -136,18 +221,56 @@ class RideFileCache
 
         // get a single best or time in zone value from the cache file
         // intended to be very fast (using lseek to jump direct to the value requested
+        // or, for bests at the standard durations, from the metric database
         static double best(Context *context, QString fileName, RideFile::SeriesType series, int duration);
         static int tiz(Context *context, QString fileName, RideFile::SeriesType series, int zone);
 
+        // the best watts for a duration and the time it starts, so interval
+        // searches needn't scan the ride. False if the ride has been changed
+        // since the cache was computed, when the caller should scan instead
+        static bool bestEffort(const RideItem *item, int duration, double &start, double &watts);
+
+        // the mean max of the part of a ride from start to stop (secs), e.g. an
+        // interval, as MeanMaxComputer leaves it (scaled by decimalsFor). Kept
+        // incore by ride revision and bounds so flicking between intervals, or
+        // laps, doesn't compute them again
+        static QVector<float> intervalMeanMax(RideItem *item, double start, double stop, RideFile::SeriesType series);
+
         // get all the bests passed and return a list of summary metrics, like the DBAccess
         // function but using CPX files as the source
         static QList<SummaryMetrics> getAllBestsFor(Context *context, QList<MetricDetail>, QDateTime from, QDateTime to);
 
+        // the mean max values at a standard set of durations for each mean max
+        // series, as stored in the .cpx, read in one go for the metric database
+        // to keep (see DBAccess::importBests). Empty if there is no current .cpx
+        static QByteArray standardBests(Context *context, QString fileName);
+
         static int decimalsFor(RideFile::SeriesType series);
 
+        // is the .cpx for this ride file present, newer than the ride (or built
+        // from the same content) and the current version? pass the content
+        // fingerprint if it is known, see MetricAggregator::contentFingerPrint
+        static bool isCurrent(QString rideFileName, unsigned long content = 0);
+        static bool isReadable(QString rideFileName); // current, or an older compatible version
+
+        // the ride file was rewritten without changing its samples, e.g. only
+        // its metadata was edited, so bring the .cpx up to date rather than
+        // rebuild it. False if there isn't one of the current version
+        static bool keep(QString rideFileName);
+
+        // remove the saved month aggregate that covers this date
+        static void invalidateAggregate(Context *context, QDate date);
+
+        // the athlete is closing, drop its incore date range aggregates
+        static void freeIncore(Context *context);
+
+        // compute the deferred mean-max series of a ride and add them to its .cpx
+        // False if its .cpx isn't current or the ride couldn't be read
+        static bool completeDeferred(Context *context, QString rideFileName);
+
         // get data
-        QVector<double> &meanMaxArray(RideFile::SeriesType); // return meanmax array for the given series
-        QVector<QDate> &meanMaxDates(RideFile::SeriesType series); // the dates of the bests
+        QVector<double> &meanMaxArray(RideFile::SeriesType); // return meanmax array for the given series, computing it if deferred
+        MeanMaxDates &meanMaxDates(RideFile::SeriesType series); // the dates of the bests
         QVector<double> &distributionArray(RideFile::SeriesType); // return distribution array for the given series
         QVector<float> &wattsZoneArray() { return wattsTimeInZone; }
         QVector<float> &hrZoneArray() { return hrTimeInZone; }
@@ -166,11 +289,26 @@ class RideFileCache
 
         // NOW replaced computeMeanMax with MeanMaxComputer class see bottom of file
         //void computeMeanMax(QVector<float>&, RideFile::SeriesType);      // compute mean max arrays
-        void computeDistribution(QVector<float>&, RideFile::SeriesType); // compute the distributions
+        void computeDistributions(); // compute the distributions and time in zone in one pass
 
 
     private:
 
+        // an empty aggregate, used to collect the rides in a month
+        RideFileCache(Context *context) : context(context), rideFileName(""), ride(0), filtered(false) { resetAggregate(); }
+
+        // the mean-max array as it is, without computing it if deferred
+        QVector<double> &meanMaxValues(RideFile::SeriesType);
+
+        // aggregating rides and the month aggregates into a date range
+        void resetAggregate();
+        void aggregate(RideFileCache &other, QDate rideDate);
+        void aggregate(RideFileCache &other);
+        void monthAggregate(QDate month, QStringList rides);
+        bool readAggregate(QString filename, int rides);
+        void writeAggregate(QString filename, int rides);
+        static QString aggregateFileName(Context *context, QDate month);
+
         Context *context;
         QString rideFileName; // filename of ride
         QString cacheFileName; // filename of cache file
@@ -180,6 +318,14 @@ class RideFileCache
         int CP;
         int LTHR;
 
+        // the mean-max blocks (bit per cacheLayout index) that were deferred,
+        // for a date range those deferred by any of the rides in it
+        unsigned int deferred;
+
+        // the rides a date range was asked for, to aggregate it again
+        bool filtered;
+        QStringList filteredFiles;
+
         //
         // MEAN MAXIMAL VALUES
         //
@@ -206,16 +352,16 @@ class RideFileCache
         QVector<double> wattsKgMeanMaxDouble; // watts/kg
         QVector<double> aPowerMeanMaxDouble; // RideFile::aPower
 
-        QVector<QDate> wattsMeanMaxDate; // RideFile::watts
-        QVector<QDate> hrMeanMaxDate; // RideFile::hr
-        QVector<QDate> cadMeanMaxDate; // RideFile::cad
-        QVector<QDate> nmMeanMaxDate; // RideFile::nm
-        QVector<QDate> kphMeanMaxDate; // RideFile::kph
-        QVector<QDate> xPowerMeanMaxDate; // RideFile::kph
-        QVector<QDate> npMeanMaxDate; // RideFile::kph
-        QVector<QDate> vamMeanMaxDate; // RideFile::vam
-        QVector<QDate> wattsKgMeanMaxDate; // watts/kg
-        QVector<QDate> aPowerMeanMaxDate; // RideFile::aPower
+        MeanMaxDates wattsMeanMaxDate; // RideFile::watts
+        MeanMaxDates hrMeanMaxDate; // RideFile::hr
+        MeanMaxDates cadMeanMaxDate; // RideFile::cad
+        MeanMaxDates nmMeanMaxDate; // RideFile::nm
+        MeanMaxDates kphMeanMaxDate; // RideFile::kph
+        MeanMaxDates xPowerMeanMaxDate; // RideFile::kph
+        MeanMaxDates npMeanMaxDate; // RideFile::kph
+        MeanMaxDates vamMeanMaxDate; // RideFile::vam
+        MeanMaxDates wattsKgMeanMaxDate; // watts/kg
+        MeanMaxDates aPowerMeanMaxDate; // RideFile::aPower
 
         //
         // SAMPLE DISTRIBUTION
@@ -247,11 +393,49 @@ class RideFileCache
 
 
         QVector<float> wattsTimeInZone;   // time in zone in seconds
+        QVector<float> wattsMeanMaxOffsets; // start of each wattsMeanMax effort in seconds
         QVector<float> hrTimeInZone;      // time in zone in seconds
 
         // we need to return doubles not longs, we just use longs
         // to reduce disk storage
         void doubleArray(QVector<double> &into, QVector<float> &from, RideFile::SeriesType series);
+        void doubleArray(QVector<double> &into, const float *from, int count, RideFile::SeriesType series);
+
+        // the float arrays in file order, and their double companions
+        void blockArrays(QVector<float> **floats, QVector<double> **doubles);
+
+        friend class RideFileCacheAggregate;
+};
+
+// A date range RideFileCache as it is kept in the athlete's cpxCache, so
+// a chart returning to a range needn't aggregate it again. Over a long
+// history the mean-max arrays run to tens of hours, so they are kept
+// as floats with every duration up to an hour but only every 1% beyond;
+// durations between are interpolated when it is expanded back out (the
+// curve changes very little out there). The dates of the bests are kept
+// in full, as runs they are small.
+class RideFileCacheAggregate
+{
+    public:
+        RideFileCacheAggregate(RideFileCache &from);
+
+        // set up a date range cache from this one
+        void expand(RideFileCache &into) const;
+
+        QDate start, end;
+        int bytes() const; // roughly, for the cpxCache memory budget
+
+    private:
+        struct MeanMax {
+            int size;                   // durations in the full array
+            QVector<int> secs;          // the durations kept
+            QVector<float> values;
+            MeanMaxDates dates;         // for every duration
+        };
+        QVector<MeanMax> meanMax;       // in cacheLayout order
+        QVector<QVector<float> > distributions;
+        QVector<float> wattsTimeInZone, hrTimeInZone;
+        unsigned int deferred;
 };
 
 // Working structured inherited from CpintPlot.cpp
@@ -272,25 +456,63 @@ struct cpintdata {
     cpintdata() : rec_int_ms(0) {}
 };
 
+// the sample times the mean-max computers work with, pulled back to start
+// at zero with the gaps in recording filled. They are the same for every
+// series so are worked out once for the ride rather than by each computer.
+struct MeanMaxTimeline
+{
+    QVector<double> secs;
+    QVector<int> index; // of the ride sample, or -1 where a gap was filled
+
+    MeanMaxTimeline(RideFile *ride);
+};
+
 // the mean-max computer ... runs in a thread
 class MeanMaxComputer : public QThread
 {
     public:
-        MeanMaxComputer(RideFile *ride, QVector<float>&array, RideFile::SeriesType series)
-        : ride(ride), array(array), series(series) {}
+        MeanMaxComputer(RideFile *ride, QVector<float>&array, RideFile::SeriesType series,
+                        QVector<float> *offsets = NULL, // start of each effort, if wanted
+                        const MeanMaxTimeline *timeline = NULL) // shared, or we work it out
+        : ride(ride), array(array), series(series), offsets(offsets), timeline(timeline) {}
         void run();
 
+        // Mark Rages' algorithm for fast find of mean max
+        static data_t partial_max_mean(data_t *dataseries_i, int start, int end, int length, int *offset);
+        static data_t divided_max_mean(data_t *dataseries_i, int datalength, int length, int *offset);
+
     private:
 
-        // Mark Rages' algorithm for fast find of mean max
+        void compute();
         data_t *integrate_series(cpintdata &data);
-        data_t partial_max_mean(data_t *dataseries_i, int start, int end, int length, int *offset);
-        data_t divided_max_mean(data_t *dataseries_i, int datalength, int length, int *offset);
+
+        // how many are running, to decide if its worth sharing
+        // the durations of a long ride out across more threads
+        static QAtomicInt running;
 
         RideFile *ride;
         QVector<float> &array;
         QVector<data_t> integratedArray;
 
         RideFile::SeriesType series;
+        QVector<float> *offsets;
+        const MeanMaxTimeline *timeline;
+};
+
+// the durations are independent of each other, so for long rides
+// the mean-max computer shares them out across a few of these, each
+// takes every stride'th duration and leaves the energy in energy[i]
+class MeanMaxDurations : public QThread
+{
+    public:
+        MeanMaxDurations(data_t *integrated, int count, int first, int stride, data_t *energy, int *offsets)
+        : integrated(integrated), count(count), first(first), stride(stride), energy(energy), offsets(offsets) {}
+        void run();
+
+    private:
+        data_t *integrated;
+        int count, first, stride;
+        data_t *energy;
+        int *offsets; // where each one starts, or NULL
 };
 #endif // _GC_RideFileCache_h
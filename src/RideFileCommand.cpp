@@ -50,6 +50,18 @@ RideFileCommand::setPointValue(int index, RideFile::SeriesType series, double va
     doCommand(cmd);
 }
 
+// a block of cells changed as one command, rather than one per cell
+void
+RideFileCommand::setPointValues(SetPointValuesCommand *values, QString name)
+{
+    if (values->runs.isEmpty()) {
+        delete values;
+        return;
+    }
+    values->description = name;
+    doCommand(values);
+}
+
 void
 RideFileCommand::deletePoint(int index)
 {
@@ -77,6 +89,14 @@ RideFileCommand::insertPoint(int index, RideFilePoint *points)
     doCommand(cmd);
 }
 
+void
+RideFileCommand::insertPoints(int index, QVector <RideFilePoint> points)
+{
+    if (points.isEmpty()) return;
+    InsertPointsCommand *cmd = new InsertPointsCommand(ride, index, points);
+    doCommand(cmd);
+}
+
 void
 RideFileCommand::appendPoints(QVector <RideFilePoint> newRows)
 {
@@ -131,6 +151,31 @@ RideFileCommand::endLUW()
     if (luw->worklist.count()) doCommand(luw, true);
 }
 
+// the commands have already been applied to the ride, we just add them
+// to the stack as one so they can be undone together, without executing
+// them again. We take ownership of the commands.
+void
+RideFileCommand::appendLUW(QString name, QVector<RideCommand*> worklist)
+{
+    if (worklist.isEmpty()) return;
+
+    foreach(RideCommand *cmd, worklist) {
+        beginCommand(false, cmd);
+        cmd->docount++;
+        endCommand(false, cmd);
+    }
+
+    // part of a bigger one
+    if (inLUW) {
+        luw->worklist += worklist;
+        return;
+    }
+
+    LUWCommand *batch = new LUWCommand(this, name, ride);
+    batch->worklist = worklist;
+    doCommand(batch, true);
+}
+
 void
 RideFileCommand::doCommand(RideCommand *cmd, bool noexec)
 {
@@ -165,7 +210,7 @@ RideFileCommand::doCommand(RideCommand *cmd, bool noexec)
     endCommand(false, cmd); // signal - even if LUW
 
     // we changed it!
-    ride->emitModified();
+    ride->emitModified(cmd->derivedFrom());
 }
 
 void
@@ -175,6 +220,7 @@ RideFileCommand::redoCommand()
         beginCommand(false, stack[stackptr]); // signal
         stack[stackptr]->doCommand();
         stack[stackptr]->docount++;
+        ride->derivedChanged(stack[stackptr]->derivedFrom());
         stackptr++; // increment before end to keep in sync in case
                     // it is queried 'after' the command is executed
                     // i.e. within a slot connected to this signal
@@ -190,6 +236,7 @@ RideFileCommand::undoCommand()
 
         beginCommand(true, stack[stackptr]); // signal
         stack[stackptr]->undoCommand();
+        ride->derivedChanged(stack[stackptr]->derivedFrom());
         endCommand(true, stack[stackptr]); // signal
     }
 }
@@ -258,6 +305,17 @@ LUWCommand::undoCommand()
     return true;
 }
 
+int
+LUWCommand::derivedFrom() const
+{
+    int from = -1;
+    foreach(RideCommand *cmd, worklist) {
+        int index = cmd->derivedFrom();
+        if (index >= 0 && (from < 0 || index < from)) from = index;
+    }
+    return from;
+}
+
 // Set point value
 SetPointValueCommand::SetPointValueCommand(RideFile *ride, int row,
             RideFile::SeriesType series, double oldvalue, double newvalue) :
@@ -287,6 +345,74 @@ SetPointValueCommand::undoCommand()
     return true;
 }
 
+int
+SetPointValueCommand::derivedFrom() const
+{
+    // NP and xPower come from power and time, aPower from power and altitude
+    if (series == RideFile::watts || series == RideFile::secs || series == RideFile::alt) return row;
+    return -1;
+}
+
+// Set point values in bulk
+SetPointValuesCommand::SetPointValuesCommand(RideFile *ride) :
+        RideCommand(ride), // base class looks after these
+        top(-1), bottom(-1), last(RideFile::none+1, -1)
+{
+    type = RideCommand::SetPointValues;
+    description = tr("Set Values");
+}
+
+void
+SetPointValuesCommand::append(int row, RideFile::SeriesType series, double oldvalue, double newvalue)
+{
+    int &latest = last[series];
+
+    // carry on with the run for this series if we're the next row
+    // otherwise start a new one, the runs are replayed in order
+    if (latest < 0 || runs[latest].row + runs[latest].oldvalues.count() != row) {
+        Run add;
+        add.series = series;
+        add.row = row;
+        latest = runs.count();
+        runs << add;
+    }
+
+    Run &run = runs[latest];
+    run.oldvalues << oldvalue;
+    run.newvalues << newvalue;
+
+    if (top < 0 || row < top) top = row;
+    if (row > bottom) bottom = row;
+}
+
+bool
+SetPointValuesCommand::doCommand()
+{
+    foreach(const Run &run, runs)
+        ride->setPointValues(run.row, run.series, run.newvalues.constData(), run.newvalues.count());
+    return true;
+}
+
+bool
+SetPointValuesCommand::undoCommand()
+{
+    for (int i=runs.count()-1; i>=0; i--)
+        ride->setPointValues(runs[i].row, runs[i].series, runs[i].oldvalues.constData(), runs[i].oldvalues.count());
+    return true;
+}
+
+int
+SetPointValuesCommand::derivedFrom() const
+{
+    // NP and xPower come from power and time, aPower from power and altitude
+    int from = -1;
+    foreach(const Run &run, runs) {
+        if (run.series == RideFile::watts || run.series == RideFile::secs || run.series == RideFile::alt)
+            if (from < 0 || run.row < from) from = run.row;
+    }
+    return from;
+}
+
 // Remove a point
 DeletePointCommand::DeletePointCommand(RideFile *ride, int row, RideFilePoint point) :
         RideCommand(ride), // base class looks after these
@@ -306,7 +432,7 @@ DeletePointCommand::doCommand()
 bool
 DeletePointCommand::undoCommand()
 {
-    ride->insertPoint(row, new RideFilePoint(point));
+    ride->insertPoint(row, ride->newPoint(point));
     return true;
 }
 
@@ -330,7 +456,7 @@ DeletePointsCommand::doCommand()
 bool
 DeletePointsCommand::undoCommand()
 {
-    for (int i=(count-1); i>=0; i--) ride->insertPoint(row, new RideFilePoint(points[i]));
+    for (int i=(count-1); i>=0; i--) ride->insertPoint(row, ride->newPoint(points[i]));
     return true;
 }
 
@@ -346,7 +472,7 @@ InsertPointCommand::InsertPointCommand(RideFile *ride, int row, RideFilePoint *p
 bool
 InsertPointCommand::doCommand()
 {
-    ride->insertPoint(row, new RideFilePoint(point));
+    ride->insertPoint(row, ride->newPoint(point));
     return true;
 }
 
@@ -357,6 +483,31 @@ InsertPointCommand::undoCommand()
     return true;
 }
 
+// Insert a block of points
+InsertPointsCommand::InsertPointsCommand(RideFile *ride, int row, QVector<RideFilePoint> points) :
+        RideCommand(ride), // base class looks after these
+        row(row), count(points.count()), points(points)
+{
+    type = RideCommand::InsertPoints;
+    description = tr("Insert Points");
+}
+
+bool
+InsertPointsCommand::doCommand()
+{
+    QVector<RideFilePoint *> newPoints(count);
+    for (int i=0; i<count; i++) newPoints[i] = ride->newPoint(points[i]);
+    ride->insertPoints(row, newPoints);
+    return true;
+}
+
+bool
+InsertPointsCommand::undoCommand()
+{
+    ride->deletePoints(row, count);
+    return true;
+}
+
 // Append points
 AppendPointsCommand::AppendPointsCommand(RideFile *ride, int row, QVector<RideFilePoint> points) :
         RideCommand(ride), // base class looks after these
@@ -371,7 +522,7 @@ AppendPointsCommand::doCommand()
 {
     QVector<RideFilePoint *> newPoints;
     foreach (RideFilePoint point, points) {
-        RideFilePoint *p = new RideFilePoint(point);
+        RideFilePoint *p = ride->newPoint(point);
         newPoints.append(p);
     }
     ride->appendPoints(newPoints);
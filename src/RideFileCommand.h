@@ -35,6 +35,7 @@
 //                           for undo/redo functionality
 class RideCommand;
 class LUWCommand;
+class SetPointValuesCommand;
 
 class RideFileCommand : public QObject
 {
@@ -49,9 +50,11 @@ class RideFileCommand : public QObject
         virtual ~RideFileCommand();
 
         void setPointValue(int index, RideFile::SeriesType series, double value);
+        void setPointValues(SetPointValuesCommand *values, QString name); // takes ownership
         void deletePoint(int index);
         void deletePoints(int index, int count);
         void insertPoint(int index, RideFilePoint *point);
+        void insertPoints(int index, QVector <struct RideFilePoint> points);
         void appendPoints(QVector <struct RideFilePoint> newRows);
         void setDataPresent(RideFile::SeriesType, bool);
 
@@ -63,6 +66,7 @@ class RideFileCommand : public QObject
         // stack status
         void startLUW(QString name);
         void endLUW();
+        void appendLUW(QString name, QVector<RideCommand*> worklist); // already applied
 
         // change status
         QString changeLog();
@@ -94,7 +98,8 @@ class RideCommand
 {
     public:
         // supported command types
-        enum commandtype { NoOp, LUW, SetPointValue, DeletePoint, DeletePoints, InsertPoint, AppendPoints, SetDataPresent };
+        enum commandtype { NoOp, LUW, SetPointValue, DeletePoint, DeletePoints, InsertPoint, AppendPoints, SetDataPresent,
+                           SetPointValues, InsertPoints };
         typedef enum commandtype CommandType;
 
 
@@ -103,6 +108,10 @@ class RideCommand
         virtual bool doCommand() { return true; }
         virtual bool undoCommand() { return true; }
 
+        // the first point whose derived series (NP, xPower, aPower) are
+        // changed by the command, or -1 if they aren't affected at all
+        virtual int derivedFrom() const { return 0; }
+
         // state of selection model -- if passed at all
         CommandType type;
         QString description;
@@ -122,6 +131,7 @@ class LUWCommand : public RideCommand
         void addCommand(RideCommand *cmd) { worklist.append(cmd); }
         bool doCommand();
         bool undoCommand();
+        int derivedFrom() const;
 
         QVector<RideCommand*> worklist;
         RideFileCommand *commander;
@@ -135,6 +145,7 @@ class SetPointValueCommand : public RideCommand
         SetPointValueCommand(RideFile *ride, int row, RideFile::SeriesType series, double oldvalue, double newvalue);
         bool doCommand();
         bool undoCommand();
+        int derivedFrom() const;
 
         // state
         int row;
@@ -142,6 +153,31 @@ class SetPointValueCommand : public RideCommand
         double oldvalue, newvalue;
 };
 
+// Bulk edits, runs of consecutive rows in the same series are kept
+// together with their old and new values in contiguous arrays
+class SetPointValuesCommand : public RideCommand
+{
+    Q_DECLARE_TR_FUNCTIONS(SetPointValuesCommand)
+
+    public:
+        SetPointValuesCommand(RideFile *ride);
+        void append(int row, RideFile::SeriesType series, double oldvalue, double newvalue);
+        bool doCommand();
+        bool undoCommand();
+        int derivedFrom() const;
+
+        struct Run {
+            RideFile::SeriesType series;
+            int row;
+            QVector<double> oldvalues, newvalues;
+        };
+
+        // state
+        QVector<Run> runs;
+        int top, bottom; // rows changed
+        QVector<int> last; // latest run for each series, or -1
+};
+
 class DeletePointCommand : public RideCommand
 {
     Q_DECLARE_TR_FUNCTIONS(DeletePointCommand)
@@ -150,6 +186,7 @@ class DeletePointCommand : public RideCommand
         DeletePointCommand(RideFile *ride, int row, RideFilePoint point);
         bool doCommand();
         bool undoCommand();
+        int derivedFrom() const { return row; }
 
         // state
         int row;
@@ -165,6 +202,7 @@ class DeletePointsCommand : public RideCommand
             QVector<RideFilePoint> current);
         bool doCommand();
         bool undoCommand();
+        int derivedFrom() const { return row; }
 
         // state
         int row;
@@ -180,11 +218,25 @@ class InsertPointCommand : public RideCommand
         InsertPointCommand(RideFile *ride, int row, RideFilePoint *point);
         bool doCommand();
         bool undoCommand();
+        int derivedFrom() const { return row; }
 
         // state
         int row;
         RideFilePoint point;
 };
+class InsertPointsCommand : public RideCommand
+{
+    Q_DECLARE_TR_FUNCTIONS(InsertPointsCommand)
+
+    public:
+        InsertPointsCommand(RideFile *ride, int row, QVector<RideFilePoint> points);
+        bool doCommand();
+        bool undoCommand();
+        int derivedFrom() const { return row; }
+
+        int row, count;
+        QVector<RideFilePoint> points;
+};
 class AppendPointsCommand : public RideCommand
 {
     Q_DECLARE_TR_FUNCTIONS(AppendPointsCommand)
@@ -193,6 +245,7 @@ class AppendPointsCommand : public RideCommand
         AppendPointsCommand(RideFile *ride, int row, QVector<RideFilePoint> points);
         bool doCommand();
         bool undoCommand();
+        int derivedFrom() const { return row; }
 
         int row, count;
         QVector<RideFilePoint> points;
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideFileSaver.h"
+#include "RideFile.h"
+#include "RideItem.h"
+
+#include <QFile>
+#ifndef Q_OS_WIN
+#include <stdio.h> // rename
+#endif
+
+RideFileSaver::RideFileSaver(Context *context, RideItem *item, QString fileName, QString format, QString previous) :
+    context(context), item(item), ride(item->ride()->sharedSnapshot()), revision_(item->revision()),
+    fileName_(fileName), format(format), previous_(previous), ok(false)
+{
+}
+
+RideFileSaver::~RideFileSaver()
+{
+    wait();
+}
+
+void
+RideFileSaver::run()
+{
+    // the copy is made here rather than on the gui thread
+    RideFile *copy = ride.toRideFile();
+    ok = writeRideFile(context, copy, fileName_, format);
+    delete copy;
+}
+
+bool
+RideFileSaver::writeRideFile(Context *context, const RideFile *ride, QString fileName, QString format)
+{
+    QString temporary = fileName + ".saving";
+    QFile::remove(temporary); // left by a crash
+
+    QFile file(temporary);
+    if (!RideFileFactory::instance().writeRideFile(context, ride, file, format)) {
+        QFile::remove(temporary);
+        return false;
+    }
+    file.close();
+
+#ifdef Q_OS_WIN
+    // there is no rename over an existing file, so there
+    // is a moment when only the temporary file exists
+    QFile::remove(fileName);
+    return QFile::rename(temporary, fileName);
+#else
+    return ::rename(QFile::encodeName(temporary).constData(), QFile::encodeName(fileName).constData()) == 0;
+#endif
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideFileSaver_h
+#define _GC_RideFileSaver_h 1
+#include "GoldenCheetah.h"
+#include "RideFile.h" // RideFileSnapshot
+
+#include <QThread>
+#include <QString>
+
+class Context;
+class RideItem;
+
+// Saves a ride without holding up the user. The ride is snapshot when the
+// saver is made and written on a thread of its own, to a temporary file that
+// is only renamed over the target once it is complete, so a failed save
+// never leaves a half written ride behind. MainWindow finishes the save on
+// the GUI thread when finished() is emitted, see MainWindow::saveSilent.
+class RideFileSaver : public QThread
+{
+    Q_OBJECT
+
+    public:
+        RideFileSaver(Context *context, RideItem *item, QString fileName, QString format, QString previous);
+        ~RideFileSaver();
+
+        RideItem *rideItem() const { return item; }
+        int revision() const { return revision_; } // of the ride when it was snapshot
+        QString fileName() const { return fileName_; }
+        QString previous() const { return previous_; } // the file it came from
+        bool succeeded() const { return ok; }
+
+        // write via a temporary file renamed over fileName
+        static bool writeRideFile(Context *context, const RideFile *ride, QString fileName, QString format);
+
+    protected:
+        void run();
+
+    private:
+        Context *context;
+        RideItem *item;
+        RideFileSnapshot ride; // as it was when we were asked to save it
+        int revision_;
+        QString fileName_, format, previous_;
+        bool ok;
+};
+
+#endif // _GC_RideFileSaver_h
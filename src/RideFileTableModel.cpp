@@ -17,6 +17,7 @@
  */
 
 #include "RideFileTableModel.h"
+#include <math.h>
 
 RideFileTableModel::RideFileTableModel(RideFile *ride) : ride(ride)
 {
@@ -35,6 +36,7 @@ RideFileTableModel::setRide(RideFile *newride)
 
     ride = newride;
     tooltips.clear(); // remove the tooltips -- rideEditor will set them (this is fugly, but efficient)
+    cells.clear();
 
     if (ride) {
 
@@ -57,6 +59,7 @@ RideFileTableModel::deleted()
 {
     // we don't need to disconnect since they're free'd up by QT
     ride = NULL;
+    cells.clear();
     beginResetModel();
     endResetModel();
     dataChanged(createIndex(0,0), createIndex(90,999999));
@@ -150,10 +153,60 @@ RideFileTableModel::data(const QModelIndex & index, int role) const
     if (index.row() >= ride->dataPoints().count() || index.column() >= headings_.count())
         return QVariant();
     else {
-        return ride->getPoint(index.row(), headingsType[index.column()]);
+        // the columnar copy is only rebuilt when the series is edited
+        RideFile::SeriesType series = headingsType[index.column()];
+        return ride->getPointFromValue(ride->seriesData(series).at(index.row()), series);
     }
 }
 
+void
+RideFileTableModel::secsMsecs(double value, int &secs, int &msecs)
+{
+    // split into secs and msecs from a double
+    // tried modf, floor, round and a host of others but
+    // they all had difference problems. In the end
+    // I've resorted to rounding to 100ths of a second.
+    // I acknowledge that this is horrid, but its ok
+    // for Powertaps but maybe more precise devices will
+    // come along?
+    secs = floor(value); // assume it is positive!! .. it is a time field!
+    msecs = round((value - secs) * 100) * 10;
+}
+
+const RideFileTableModel::Cell &
+RideFileTableModel::cell(int row, int column) const
+{
+    qint64 key = (qint64(row) << 8) | column;
+    QHash<qint64, Cell>::const_iterator found = cells.constFind(key);
+    if (found != cells.constEnd()) return found.value();
+
+    // a screenful or two is plenty, start again if we've scrolled that far
+    if (cells.count() > 4096) cells.clear();
+
+    Cell add;
+    add.tooPrecise = false;
+    if (ride && row < ride->dataPoints().count() && column < headingsType.count()) {
+
+        RideFile::SeriesType what = headingsType[column];
+        double value = ride->seriesData(what).at(row);
+
+        if (what == RideFile::secs) {
+            int seconds, msecs;
+            secsMsecs(value, seconds, msecs);
+            add.text = QTime(0,0,0,0).addSecs(seconds).addMSecs(msecs).toString("hh:mm:ss.zzz");
+        } else {
+            add.text = ride->getPointFromValue(value, what).toString();
+        }
+
+        // more decimal places than the file format will keep
+        int dp;
+        QString precise = QString("%1").arg(value, 0, 'g', 10);
+        if ((dp = precise.indexOf(".")) >= 0)
+            add.tooPrecise = precise.length()-(dp+1) > RideFile::decimalsFor(what);
+    }
+    return cells.insert(key, add).value();
+}
+
 QVariant
 RideFileTableModel::headerData(int section, Qt::Orientation orient, int role) const
 {
@@ -290,8 +343,8 @@ void
 RideFileTableModel::forceRedraw()
 {
     // tell the view to redraw everything
-    if (ride)
-        dataChanged(createIndex(0,0), createIndex(headingsType.count(), ride->dataPoints().count()));
+    if (ride && ride->dataPoints().count() && headingsType.count())
+        dataChanged(index(0,0), index(ride->dataPoints().count()-1, headingsType.count()-1));
 }
 
 //
@@ -336,6 +389,14 @@ RideFileTableModel::beginCommand(bool undo, RideCommand *cmd)
             else beginRemoveRows(QModelIndex(), ap->row, ap->row + ap->count - 1);
             break;
         }
+
+        case RideCommand::InsertPoints:
+        {
+            InsertPointsCommand *ip = (InsertPointsCommand *)cmd;
+            if (!undo) beginInsertRows(QModelIndex(), ip->row, ip->row + ip->count - 1);
+            else beginRemoveRows(QModelIndex(), ip->row, ip->row + ip->count - 1);
+            break;
+        }
         default:
             break;
     }
@@ -344,6 +405,8 @@ RideFileTableModel::beginCommand(bool undo, RideCommand *cmd)
 void
 RideFileTableModel::endCommand(bool undo, RideCommand *cmd)
 {
+    cells.clear(); // redrawn as needed
+
     switch (cmd->type) {
 
         case RideCommand::SetPointValue:
@@ -353,7 +416,14 @@ RideFileTableModel::endCommand(bool undo, RideCommand *cmd)
             dataChanged(cell, cell);
             break;
         }
+        case RideCommand::SetPointValues:
+        {
+            SetPointValuesCommand *spv = (SetPointValuesCommand*)cmd;
+            dataChanged(index(spv->top, 0), index(spv->bottom, headingsType.count()-1));
+            break;
+        }
         case RideCommand::InsertPoint:
+        case RideCommand::InsertPoints:
             if (!undo) endInsertRows();
             else endRemoveRows();
             break;
@@ -78,6 +78,14 @@ class RideFileTableModel : public QAbstractTableModel
         void setToolTip(int row, RideFile::SeriesType series, QString value);
         QString toolTip(int row, RideFile::SeriesType series) const;
 
+        // what the editor paints, formatted when first drawn and kept
+        // until the ride changes so scrolling back and forth is cheap
+        QString text(int row, int column) const { return cell(row, column).text; }
+        bool tooPrecise(int row, int column) const { return cell(row, column).tooPrecise; }
+
+        // split into secs and msecs for display as a time
+        static void secsMsecs(double value, int &secs, int &msecs);
+
     public slots:
         // RideCommand signals trapped here
         void beginCommand(bool undo, RideCommand *);
@@ -98,6 +106,13 @@ class RideFileTableModel : public QAbstractTableModel
         RideFile *ride;
         QMap <QString,QString> tooltips;
 
+        struct Cell {
+            QString text;
+            bool tooPrecise;
+        };
+        mutable QHash<qint64, Cell> cells; // only those that have been drawn
+        const Cell &cell(int row, int column) const;
+
         QStringList headings_;
         QVector<RideFile::SeriesType> headingsType;
         void setHeadings(RideFile::SeriesType series = RideFile::none);
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideFingerprint.h"
+#include "RideFile.h"
+
+#include <QDateTime>
+
+// minutes of samples in each step of the hash, and what they are rounded to
+static const double blockSecs = 60;
+static const double wattsStep = 10;
+static const double hrStep = 5;
+
+// fewer and short rides would share the hash too often
+static const int minBlocks = 10;
+
+RideFingerprint::RideFingerprint(const RideFile *ride) : start(0), duration(0), content(0)
+{
+    if (ride == NULL) return;
+
+    if (ride->startTime().isValid()) start = qint64(ride->startTime().toTime_t()) / 60;
+    if (ride->dataPoints().isEmpty()) return;
+
+    const RideFilePoint *first = ride->dataPoints().first();
+    duration = ride->dataPoints().last()->secs - first->secs;
+
+    bool watts = ride->areDataPresent()->watts, hr = ride->areDataPresent()->hr;
+    if (!watts && !hr) return;
+
+    // the mean of each block, from the first sample so a ride
+    // recorded from a different time of day hashes the same
+    quint32 hash = 17;
+    double wattsTotal = 0, hrTotal = 0;
+    int samples = 0, block = 0, blocks = 0;
+    foreach(const RideFilePoint *p, ride->dataPoints()) {
+        int here = int((p->secs - first->secs) / blockSecs);
+        if (here != block && samples) {
+            hash = hash * 31 + quint32(qRound(wattsTotal / samples / wattsStep));
+            hash = hash * 31 + quint32(qRound(hrTotal / samples / hrStep));
+            wattsTotal = hrTotal = 0;
+            samples = 0;
+            blocks++;
+        }
+        block = here;
+        wattsTotal += p->watts;
+        hrTotal += p->hr;
+        samples++;
+    }
+    // the last block is left out, formats differ on where a ride stops
+    if (blocks < minBlocks) return;
+
+    // positive and non zero, zero is kept for none
+    content = int(hash & 0x7fffffff);
+    if (content == 0) content = 1;
+}
+
+bool
+RideFingerprint::matches(const RideFingerprint &other) const
+{
+    if (content && content == other.content) return true;
+    return start && other.start && qAbs(start - other.start) <= startMinutes &&
+           qAbs(duration - other.duration) <= durationSecs;
+}
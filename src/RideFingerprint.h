@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideFingerprint_h
+#define _GC_RideFingerprint_h 1
+#include "GoldenCheetah.h"
+
+#include <QtGlobal>
+
+class RideFile;
+
+// What a ride is, regardless of the format it came in, so the same ride
+// exported twice, or with its clock set wrong, can be found without
+// parsing anything: the start to the minute, the duration, and a hash of
+// the power and heart rate a minute at a time, rounded so the small
+// differences between formats don't matter. Kept for each ride in the
+// fingerprints table of the metrics db, see DBAccess::findDuplicates
+struct RideFingerprint
+{
+    RideFingerprint() : start(0), duration(0), content(0) {}
+    RideFingerprint(const RideFile *ride);
+
+    qint64 start;   // minutes since the epoch, 0 when the ride has no date
+    int duration;   // secs
+    int content;    // 0 without power or heart rate
+
+    // how far apart the same ride can be
+    static const int startMinutes = 2;
+    static const int durationSecs = 60;
+
+    // the same samples, whenever they were, or the same time and duration
+    bool matches(const RideFingerprint &other) const;
+};
+
+#endif // _GC_RideFingerprint_h
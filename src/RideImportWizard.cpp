@@ -259,189 +259,62 @@ RideImportWizard::process()
     repaint();
     QApplication::processEvents();
 
-    // Pass 2 - Read in with the relevant RideFileReader method
+    // Pass 2 - Read in with the relevant RideFileReader method, the files
+    //          are parsed by a pool of workers and each row updated as
+    //          they complete. Archives are split up once they are all
+    //          done and the rides extracted from them go round again
 
     phaseLabel->setText(tr("Step 2 of 4: Validating Files"));
-   for (int i=0; i< filenames.count(); i++) {
+    forever {
 
+        QList<RideImportItem> todo;
+        for (int i=0; i< filenames.count(); i++) {
 
-        // does the status say Queued?
-        if (!tableWidget->item(i,5)->text().startsWith(tr("Error"))) {
+            // does the status say Queued?
+            if (tableWidget->item(i,5)->text() != tr("Queued")) continue;
+
+            RideImportItem item;
+            item.row = i;
+            item.filename = filenames[i];
+            todo << item;
 
-              QStringList errors;
-              QFile thisfile(filenames[i]);
-
-              tableWidget->item(i,5)->setText(tr("Parsing..."));
-              tableWidget->setCurrentCell(i,5);
-              QApplication::processEvents();
-
-              if (aborted) { done(0); }
-              this->repaint();
-              QApplication::processEvents();
-
-              QList<RideFile*> rides;
-              RideFile *ride = RideFileFactory::instance().openRideFile(context, thisfile, errors, &rides);
-
-              // is this an archive of files?
-              if (rides.count() > 1) {
-
-                 int here = i;
-
-                 // remove current filename from state arrays and tableview
-                 filenames.removeAt(here);
-                 blanks.removeAt(here);
-                 tableWidget->removeRow(here);
-
-                 // resize dialog according to the number of rows we expect
-                 int willhave = filenames.count() + rides.count();
-                 resize(920 + ((willhave > 16 ? 24 : 0) +
-                     ((willhave > 9 && willhave < 17) ? 8 : 0)),
-                     118 + ((willhave > 16 ? 17*20 : (willhave+1) * 20)));
-
-
-                 // ok so create a temporary file and add to the tableWidget
-                 int counter = 0;
-                 foreach(RideFile *extracted, rides) {
-
-                     // write as a temporary file, using the original
-                     // filename with "-n" appended
-                     QString fulltarget = QDir::tempPath() + "/" + QFileInfo(thisfile).baseName() + QString("-%1.tcx").arg(counter+1);
-                     TcxFileReader reader;
-                     QFile target(fulltarget);
-                     reader.writeRideFile(context, extracted, target);
-                     deleteMe.append(fulltarget);
-                     delete extracted;
-                     
-                     // now add each temporary file ...
-                     filenames.insert(here, fulltarget);
-                     blanks.insert(here, true); // by default editable
-                     tableWidget->insertRow(here+counter);
-
-                     QTableWidgetItem *t;
-
-                     // Filename
-                     t = new QTableWidgetItem();
-                     t->setText(fulltarget);
-                     t->setFlags(t->flags() & (~Qt::ItemIsEditable));
-                     tableWidget->setItem(here+counter,0,t);
-
-                     // Date
-                     t = new QTableWidgetItem();
-                     t->setText(tr(""));
-                     t->setFlags(t->flags()  | Qt::ItemIsEditable);
-                     t->setBackgroundColor(Qt::red);
-                     tableWidget->setItem(here+counter,1,t);
-
-                     // Time
-                     t = new QTableWidgetItem();
-                     t->setText(tr(""));
-                     t->setFlags(t->flags() | Qt::ItemIsEditable);
-                     tableWidget->setItem(here+counter,2,t);
-
-                     // Duration
-                     t = new QTableWidgetItem();
-                     t->setText(tr(""));
-                     t->setFlags(t->flags() & (~Qt::ItemIsEditable));
-                     tableWidget->setItem(here+counter,3,t);
-
-                     // Distance
-                     t = new QTableWidgetItem();
-                     t->setText(tr(""));
-                     t->setFlags(t->flags() & (~Qt::ItemIsEditable));
-                     tableWidget->setItem(here+counter,4,t);
-
-                     // Import Status
-                     t = new QTableWidgetItem();
-                     t->setText(tr(""));
-                     t->setFlags(t->flags() & (~Qt::ItemIsEditable));
-                     tableWidget->setItem(here+counter,5,t);
-
-                     counter++;
-
-                     tableWidget->adjustSize();
-                 }
-                 QApplication::processEvents();
-
-
-                 // progress bar needs to adjust...
-                 progressBar->setMaximum(filenames.count()*4);
-
-                 // then go back one and re-parse from there
-                 rides.clear();
-   
-                 i--;
-                 goto next; // buttugly I know, but count em across 100,000 lines of code
-
-              }
-
-              // did it parse ok?
-              if (ride) {
-
-                   // ride != NULL but !errors.isEmpty() means they're just warnings
-                   if (errors.isEmpty())
-                       tableWidget->item(i,5)->setText(tr("Validated"));
-                   else
-                       tableWidget->item(i,5)->setText(tr("Warning - ") + errors.join(tr(" ")));
-
-                   // Set Date and Time
-                   if (ride->startTime().isNull()) {
-
-                       // Poo. The user needs to supply the date/time for this ride
-                       blanks[i] = true;
-                       tableWidget->item(i,1)->setText(tr(""));
-                       tableWidget->item(i,2)->setText(tr(""));
-
-                   } else {
-
-                       // Cool, the date and time was extrcted from the source file
-                       blanks[i] = false;
-                       tableWidget->item(i,1)->setText(ride->startTime().toString(tr("dd MMM yyyy")));
-                       tableWidget->item(i,2)->setText(ride->startTime().toString(tr("hh:mm:ss ap")));
-                   }
-
-                   tableWidget->item(i,1)->setTextAlignment(Qt::AlignRight); // put in the middle
-                   tableWidget->item(i,2)->setTextAlignment(Qt::AlignRight); // put in the middle
-
-                   // time and distance from tags (.gc files)
-                   QMap<QString,QString> lookup;
-                   lookup = ride->metricOverrides.value("total_distance");
-                   double km = lookup.value("value", "0.0").toDouble();
-
-                   lookup = ride->metricOverrides.value("workout_time");
-                   int secs = lookup.value("value", "0.0").toDouble();
-
-                   // show duration by looking at last data point
-                   if (!ride->dataPoints().isEmpty() && ride->dataPoints().last() != NULL) {
-                       if (!secs) secs = ride->dataPoints().last()->secs;
-                       if (!km) km = ride->dataPoints().last()->km;
-                   }
-
-                   QChar zero = QLatin1Char ( '0' );
-                   QString time = QString("%1:%2:%3").arg(secs/3600,2,10,zero)
-                       .arg(secs%3600/60,2,10,zero)
-                       .arg(secs%60,2,10,zero);
-                   tableWidget->item(i,3)->setText(time);
-                   tableWidget->item(i,3)->setTextAlignment(Qt::AlignHCenter); // put in the middle
-
-                   // show distance by looking at last data point
-                   QString dist = context->athlete->useMetricUnits
-                       ? QString ("%1 km").arg(km, 0, 'f', 1)
-                       : QString ("%1 mi").arg(km * MILES_PER_KM, 0, 'f', 1);
-                   tableWidget->item(i,4)->setText(dist);
-                   tableWidget->item(i,4)->setTextAlignment(Qt::AlignRight); // put in the middle
-
-                   delete ride;
-               } else {
-                   // nope - can't handle this file
-                   tableWidget->item(i,5)->setText(tr("Error - ") + errors.join(tr(" ")));
-               }
+            tableWidget->item(i,5)->setText(tr("Parsing..."));
+        }
+        if (todo.isEmpty()) break;
+
+        // the rides are not kept so no need to bound the done queue
+        RideImportQueue queue(todo, todo.count(), false);
+        QList<RideImportWorker*> workers = startWorkers(&queue, true);
+
+        QList<RideImportItem> archives;
+        for (int finished=0; finished < todo.count() && !aborted;) {
+
+            RideImportItem item;
+            if (queue.takeDone(item, 100)) {
+
+                finished++;
+                if (!item.extracted.isEmpty()) {
+                    archives << item;
+                } else {
+                    validated(item);
+                    progressBar->setValue(progressBar->value()+1);
+                }
+            }
+            QApplication::processEvents();
+        }
+        stopWorkers(&queue, workers);
+
+        if (aborted) {
+            foreach(RideImportItem item, archives)
+                foreach(QString name, item.extracted) QFile(name).remove();
+            done(0);
+            return 0;
         }
-        progressBar->setValue(progressBar->value()+1);
-        QApplication::processEvents();
-        if (aborted) { done(0); }
-        this->repaint();
 
-        next:;
+        // split up from the last row so the rows above stay put
+        qSort(archives.begin(), archives.end(), byRow);
+        for (int i=archives.count()-1; i>=0; i--) expandArchive(archives[i]);
+        this->repaint();
     }
 
     // Pass 3 - get missing date and times for imported files
@@ -493,6 +366,200 @@ RideImportWizard::process()
    return 0;
 }
 
+static bool
+byRow(const RideImportItem &a, const RideImportItem &b)
+{
+    return a.row < b.row;
+}
+
+QList<RideImportWorker*>
+RideImportWizard::startWorkers(RideImportQueue *queue, bool validating)
+{
+    int threads = QThread::idealThreadCount();
+    if (threads < 1) threads = 1;
+
+    QList<RideImportWorker*> workers;
+    for (int t=0; t<threads; t++) {
+        RideImportWorker *worker = new RideImportWorker(context, queue, validating);
+        workers << worker;
+        worker->start();
+    }
+    return workers;
+}
+
+void
+RideImportWizard::stopWorkers(RideImportQueue *queue, QList<RideImportWorker*> &workers)
+{
+    // finished or aborted, any they are still working on are thrown away
+    queue->cancel();
+    foreach(RideImportWorker *worker, workers) {
+        worker->wait();
+        delete worker;
+    }
+    workers.clear();
+
+    RideImportItem item;
+    while (queue->takeDone(item, 0)) {
+        delete item.ride;
+        foreach(QString name, item.extracted) QFile(name).remove();
+    }
+}
+
+void
+RideImportWizard::validated(const RideImportItem &item)
+{
+    int i = item.row;
+    tableWidget->setCurrentCell(i,5);
+
+    // did it parse ok?
+    if (item.parsed) {
+
+        // ride != NULL but !errors.isEmpty() means they're just warnings
+        if (item.errors.isEmpty())
+            tableWidget->item(i,5)->setText(tr("Validated"));
+        else
+            tableWidget->item(i,5)->setText(tr("Warning - ") + item.errors.join(tr(" ")));
+
+        // Set Date and Time
+        if (item.startTime.isNull()) {
+
+            // Poo. The user needs to supply the date/time for this ride
+            blanks[i] = true;
+            tableWidget->item(i,1)->setText(tr(""));
+            tableWidget->item(i,2)->setText(tr(""));
+
+        } else {
+
+            // Cool, the date and time was extrcted from the source file
+            blanks[i] = false;
+            tableWidget->item(i,1)->setText(item.startTime.toString(tr("dd MMM yyyy")));
+            tableWidget->item(i,2)->setText(item.startTime.toString(tr("hh:mm:ss ap")));
+        }
+
+        tableWidget->item(i,1)->setTextAlignment(Qt::AlignRight); // put in the middle
+        tableWidget->item(i,2)->setTextAlignment(Qt::AlignRight); // put in the middle
+
+        int secs = item.secs;
+        QChar zero = QLatin1Char ( '0' );
+        QString time = QString("%1:%2:%3").arg(secs/3600,2,10,zero)
+            .arg(secs%3600/60,2,10,zero)
+            .arg(secs%60,2,10,zero);
+        tableWidget->item(i,3)->setText(time);
+        tableWidget->item(i,3)->setTextAlignment(Qt::AlignHCenter); // put in the middle
+
+        // show distance by looking at last data point
+        QString dist = context->athlete->useMetricUnits
+            ? QString ("%1 km").arg(item.km, 0, 'f', 1)
+            : QString ("%1 mi").arg(item.km * MILES_PER_KM, 0, 'f', 1);
+        tableWidget->item(i,4)->setText(dist);
+        tableWidget->item(i,4)->setTextAlignment(Qt::AlignRight); // put in the middle
+
+        // the same ride in another format, or with the clock out, isn't imported again
+        QString duplicate = duplicateOf(item.fingerprint);
+        if (duplicate != "") tableWidget->item(i,5)->setText(tr("Error - Duplicate of %1").arg(duplicate));
+        else validatedRides << QPair<QString, RideFingerprint>(QFileInfo(item.filename).fileName(), item.fingerprint);
+
+    } else {
+        // nope - can't handle this file
+        tableWidget->item(i,5)->setText(tr("Error - ") + item.errors.join(tr(" ")));
+    }
+}
+
+QString
+RideImportWizard::duplicateOf(const RideFingerprint &fingerprint) const
+{
+    QStringList found = context->athlete->metricDB->db()->findDuplicates(fingerprint);
+    if (!found.isEmpty()) return found.first();
+
+    for (int i=0; i<validatedRides.count(); i++)
+        if (fingerprint.matches(validatedRides[i].second)) return validatedRides[i].first;
+    return "";
+}
+
+void
+RideImportWizard::expandArchive(RideImportItem &item)
+{
+    int here = item.row;
+
+    // remove current filename from state arrays and tableview
+    filenames.removeAt(here);
+    blanks.removeAt(here);
+    tableWidget->removeRow(here);
+
+    // resize dialog according to the number of rows we expect
+    int willhave = filenames.count() + item.extracted.count();
+    resize(920 + ((willhave > 16 ? 24 : 0) +
+        ((willhave > 9 && willhave < 17) ? 8 : 0)),
+        118 + ((willhave > 16 ? 17*20 : (willhave+1) * 20)));
+
+
+    // the workers already wrote each ride out as a temporary file
+    int counter = 0;
+    foreach(QString fulltarget, item.extracted) {
+
+        deleteMe.append(fulltarget);
+
+        // now add each temporary file ...
+        filenames.insert(here+counter, fulltarget);
+        blanks.insert(here+counter, true); // by default editable
+        tableWidget->insertRow(here+counter);
+
+        QTableWidgetItem *t;
+
+        // Filename
+        t = new QTableWidgetItem();
+        t->setText(fulltarget);
+        t->setFlags(t->flags() & (~Qt::ItemIsEditable));
+        tableWidget->setItem(here+counter,0,t);
+
+        // Date
+        t = new QTableWidgetItem();
+        t->setText(tr(""));
+        t->setFlags(t->flags()  | Qt::ItemIsEditable);
+        t->setBackgroundColor(Qt::red);
+        tableWidget->setItem(here+counter,1,t);
+
+        // Time
+        t = new QTableWidgetItem();
+        t->setText(tr(""));
+        t->setFlags(t->flags() | Qt::ItemIsEditable);
+        tableWidget->setItem(here+counter,2,t);
+
+        // Duration
+        t = new QTableWidgetItem();
+        t->setText(tr(""));
+        t->setFlags(t->flags() & (~Qt::ItemIsEditable));
+        tableWidget->setItem(here+counter,3,t);
+
+        // Distance
+        t = new QTableWidgetItem();
+        t->setText(tr(""));
+        t->setFlags(t->flags() & (~Qt::ItemIsEditable));
+        tableWidget->setItem(here+counter,4,t);
+
+        // Import Status, parsed on the next time round
+        t = new QTableWidgetItem();
+        t->setText(tr("Queued"));
+        t->setFlags(t->flags() & (~Qt::ItemIsEditable));
+        tableWidget->setItem(here+counter,5,t);
+
+        counter++;
+
+        tableWidget->adjustSize();
+    }
+    item.extracted.clear();
+
+    // progress bar needs to adjust...
+    progressBar->setMaximum(filenames.count()*4);
+}
+
+QDateTime
+RideImportWizard::rideDateTime(int row) const
+{
+    return QDateTime(QDate().fromString(tableWidget->item(row,1)->text(), tr("dd MMM yyyy")),
+                     QTime().fromString(tableWidget->item(row,2)->text(), tr("hh:mm:ss a")));
+}
+
 void
 RideImportWizard::overClicked()
 {
@@ -755,6 +822,29 @@ RideImportWizard::abortClicked()
 
     QChar zero = QLatin1Char ( '0' );
 
+    // the files we need to parse and serialize are opened by a pool of
+    // workers ahead of us, they are handed back in order so the files
+    // are still written and added to the ride tree one by one from here
+    QList<RideImportItem> todo;
+    for (int i=0; i< filenames.count(); i++) {
+
+        if (tableWidget->item(i,5)->text().startsWith(tr("Error"))) continue; // skip error
+
+        if (filenames[i].endsWith(".gc", Qt::CaseInsensitive) ||
+            filenames[i].endsWith(".json", Qt::CaseInsensitive) ||
+            filenames[i].endsWith(".gcb", Qt::CaseInsensitive)) {
+
+            RideImportItem item;
+            item.row = i;
+            item.filename = filenames[i];
+            item.rideTime = rideDateTime(i);
+            todo << item;
+        }
+    }
+    RideImportQueue queue(todo, QThread::idealThreadCount() * 2, true);
+    QList<RideImportWorker*> workers = startWorkers(&queue, false);
+    int saved = 0;
+
     for (int i=0; i< filenames.count(); i++) {
 
         if (tableWidget->item(i,5)->text().startsWith(tr("Error"))) continue; // skip error
@@ -762,12 +852,11 @@ RideImportWizard::abortClicked()
         tableWidget->item(i,5)->setText(tr("Saving..."));
         tableWidget->setCurrentCell(i,5);
         QApplication::processEvents();
-        if (aborted) { done(0); }
+        if (aborted) break;
         this->repaint();
 
         // Setup the ridetime as a QDateTime
-        QDateTime ridedatetime = QDateTime(QDate().fromString(tableWidget->item(i,1)->text(), tr("dd MMM yyyy")),
-                                 QTime().fromString(tableWidget->item(i,2)->text(), tr("hh:mm:ss a")));
+        QDateTime ridedatetime = rideDateTime(i);
         QString suffix = QFileInfo(filenames[i]).suffix();
         QString targetnosuffix = QString ( "%1_%2_%3_%4_%5_%6" )
                                .arg ( ridedatetime.date().year(), 4, 10, zero )
@@ -784,7 +873,14 @@ RideImportWizard::abortClicked()
         // if its a gc file we need to parse and serialize
         // using the ridedatetime and target filename
         if (filenames[i].endsWith(".gc", Qt::CaseInsensitive) ||
-            filenames[i].endsWith(".json", Qt::CaseInsensitive)) {
+            filenames[i].endsWith(".json", Qt::CaseInsensitive) ||
+            filenames[i].endsWith(".gcb", Qt::CaseInsensitive)) {
+
+            // wait for the workers to open it
+            RideImportItem opened;
+            while (!aborted && !queue.takeDone(opened, 100)) QApplication::processEvents();
+            if (aborted) break;
+            RideFile *ride = opened.ride;
 
             QStringList duplicates;
 
@@ -792,6 +888,8 @@ RideImportWizard::abortClicked()
             duplicates = findDuplicates(fulltarget);
             if (duplicates.count() && !overwriteFiles) {
                 tableWidget->item(i,5)->setText(tr("Error - File exists"));
+            } else if (!ride) {
+                tableWidget->item(i,5)->setText(tr("Error - ") + opened.errors.join(tr(" ")));
             } else {
 
                 // wipe away the duplicate
@@ -799,36 +897,22 @@ RideImportWizard::abortClicked()
                     removeDuplicate(duplicate); // we do not use removeRide coz it clashes
                 }
 
-                // read the file (again)
-                QStringList errors;
-                QFile thisfile(filenames[i]);
-                RideFile *ride(RideFileFactory::instance().openRideFile(context, thisfile, errors));
-
-                // update ridedatetime
-                ride->setStartTime(ridedatetime);
-
-                // serialize
-                if (filenames[i].endsWith(".gc")) {
-                    GcFileReader reader;
-                    QFile target(fulltarget);
-                    reader.writeRideFile(context, ride, target);
-                } else {
-                    JsonFileReader reader;
-                    QFile target(fulltarget);
-                    reader.writeRideFile(context, ride, target);
-                }
-
-                // clear
-                delete ride;
+                // serialize in the same format
+                QFile target(fulltarget);
+                RideFileFactory::instance().writeRideFile(context, ride, target, suffix);
 
+                saved++;
                 if (duplicates.count()) {
                     tableWidget->item(i,5)->setText(tr("File Overwritten"));
                 } else {
                     tableWidget->item(i,5)->setText(tr("File Saved"));
-                    context->athlete->addRide(QFileInfo(fulltarget).fileName(), true);
+                    context->athlete->addRide(QFileInfo(fulltarget).fileName(), false);
                 }
             }
 
+            // clear
+            delete ride;
+
         } else {
             // for native file formats the filename IS the ride date time so
             // no need to write -- we just copy
@@ -856,6 +940,7 @@ RideImportWizard::abortClicked()
                         QFile temp(fulltargettmp);
                         if (temp.rename(fulltarget)) {
                             tableWidget->item(i,5)->setText(tr("File Overwritten"));
+                            saved++;
                             //no need to add since its already there!
                         } else
                             tableWidget->item(i,5)->setText(tr("Error - overwrite failed"));
@@ -870,7 +955,8 @@ RideImportWizard::abortClicked()
                     QFile source(filenames[i]);
                     if (source.copy(fulltarget)) {
                         tableWidget->item(i,5)->setText(tr("File Saved"));
-                        context->athlete->addRide(QFileInfo(fulltarget).fileName(), true); // add to tree view
+                        context->athlete->addRide(QFileInfo(fulltarget).fileName(), false); // add to tree view
+                        saved++;
                         // free immediately otherwise all imported rides are cached
                         // and with large imports this can lead to memory exhaustion
                         // BUT! Some charts/windows will hava snaffled away the ridefile
@@ -881,10 +967,17 @@ RideImportWizard::abortClicked()
             }
         }
         QApplication::processEvents();
-        if (aborted) { done(0); }
+        if (aborted) break;
         progressBar->setValue(progressBar->value()+1);
         this->repaint();
     }
+    stopWorkers(&queue, workers);
+
+    // the metrics and .cpx for the rides we saved are computed by the
+    // refresh workers rather than one at a time as each was added,
+    // Finish waits for them before we close
+    if (saved) context->athlete->metricDB->refreshMetricsInBackground();
+    if (aborted) { done(0); return; }
 
     // how did we get on in the end then ...
     int completed = 0;
@@ -910,6 +1003,152 @@ RideImportWizard::~RideImportWizard()
 }
 
 
+/*----------------------------------------------------------------------
+ * Import workers
+ *----------------------------------------------------------------------*/
+
+RideImportQueue::RideImportQueue(QList<RideImportItem> todo, int maxdone, bool ordered)
+: todo(todo), maxdone(maxdone), ordered(ordered), cancelled(false)
+{
+    foreach(RideImportItem item, todo) order << item.row;
+}
+
+bool
+RideImportQueue::takeJob(RideImportItem &item)
+{
+    QMutexLocker locker(&lock);
+    if (cancelled || todo.isEmpty()) return false;
+    item = todo.takeFirst();
+    return true;
+}
+
+void
+RideImportQueue::putDone(RideImportItem &item)
+{
+    QMutexLocker locker(&lock);
+
+    // the next one in order is always let in, or we would never make progress
+    while (!cancelled && done.count() >= maxdone && !(ordered && item.row == order.first()))
+        notFull.wait(&lock);
+    done.insert(item.row, item);
+    notEmpty.wakeOne();
+}
+
+bool
+RideImportQueue::takeDone(RideImportItem &item, unsigned long msecs)
+{
+    QMutexLocker locker(&lock);
+
+    // once cancelled we're just clearing up so any will do
+    bool inorder = ordered && !cancelled;
+    if (msecs && (inorder ? !done.contains(order.value(0, -1)) : done.isEmpty())) notEmpty.wait(&lock, msecs);
+
+    QMap<int, RideImportItem>::iterator next = inorder ? done.find(order.value(0, -1)) : done.begin();
+    if (next == done.end()) return false;
+
+    item = next.value();
+    done.erase(next);
+    order.removeOne(item.row);
+    notFull.wakeAll();
+    return true;
+}
+
+void
+RideImportQueue::cancel()
+{
+    QMutexLocker locker(&lock);
+    cancelled = true;
+    notFull.wakeAll();
+}
+
+void
+RideImportSplitter::split(RideFile *ride)
+{
+    // hold the first, it might be the only one
+    if (++count == 1) {
+        held = ride;
+        return;
+    }
+
+    // its an archive, so the one we held goes out first
+    if (held) {
+        extract(held);
+        held = NULL;
+    }
+    extract(ride);
+}
+
+void
+RideImportSplitter::extract(RideFile *ride)
+{
+    // write as a temporary file, using the original
+    // filename with "-n" appended
+    QString fulltarget = QDir::tempPath() + "/" + QFileInfo(filename).baseName()
+                         + QString("-%1.tcx").arg(extracted.count()+1);
+    TcxFileReader reader;
+    QFile target(fulltarget);
+    reader.writeRideFile(context, ride, target);
+    extracted << fulltarget;
+    delete ride;
+}
+
+void
+RideImportWorker::run()
+{
+    RideImportItem item;
+    while (queue->takeJob(item)) {
+
+        // open it, which runs the data processors too, the rides in an
+        // archive are streamed out as they are parsed when validating
+        QFile file(item.filename);
+        RideFile *ride = NULL;
+        RideImportSplitter splitter(context, item.filename);
+
+        if (validating && RideFileFactory::instance().splitRideFile(file, item.errors, &splitter)) {
+
+            ride = splitter.take();
+            if (ride) RideFileFactory::instance().finishRideFile(context, file, ride);
+            item.extracted = splitter.extracted;
+            item.parsed = (ride != NULL || !item.extracted.isEmpty());
+
+        } else {
+
+            ride = RideFileFactory::instance().openRideFile(context, file, item.errors);
+            item.parsed = (ride != NULL);
+        }
+
+        if (ride && !validating) {
+
+            // saving, the GUI thread writes it for us
+            ride->setStartTime(item.rideTime);
+            item.ride = ride;
+
+        } else if (ride) {
+
+            item.startTime = ride->startTime();
+            item.fingerprint = RideFingerprint(ride);
+
+            // time and distance from tags (.gc files)
+            QMap<QString,QString> lookup;
+            lookup = ride->metricOverrides.value("total_distance");
+            item.km = lookup.value("value", "0.0").toDouble();
+
+            lookup = ride->metricOverrides.value("workout_time");
+            item.secs = lookup.value("value", "0.0").toDouble();
+
+            // show duration by looking at last data point
+            if (!ride->dataPoints().isEmpty() && ride->dataPoints().last() != NULL) {
+                if (!item.secs) item.secs = ride->dataPoints().last()->secs;
+                if (!item.km) item.km = ride->dataPoints().last()->km;
+            }
+            delete ride;
+        }
+
+        queue->putDone(item);
+        item = RideImportItem();
+    }
+}
+
 // Below is the code to implement a custom ItemDelegate to support
 // editing of the date and time of the Ride inside a QTableWidget
 // the ItemDelegate is registered for every cell in the table
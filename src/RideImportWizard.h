@@ -25,7 +25,16 @@
 #include <QProgressBar>
 #include <QList>
 #include <QListIterator>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
 #include "Context.h"
+#include "RideFingerprint.h"
+
+class RideFile;
+class RideImportQueue;
+class RideImportWorker;
+struct RideImportItem;
 
 // Dialog class to show filenames, import progress and to capture user input
 // of ride date and time
@@ -53,6 +62,15 @@ private slots:
 
 private:
     void init(QList<QString> files, QDir &home, Context *context);
+
+    // parsing and opening files is done by a pool of workers
+    QList<RideImportWorker*> startWorkers(RideImportQueue *queue, bool validating);
+    void stopWorkers(RideImportQueue *queue, QList<RideImportWorker*> &workers);
+    void validated(const RideImportItem &item);  // show what was found in the table
+    void expandArchive(RideImportItem &item);    // replace with a row for each ride
+    QDateTime rideDateTime(int row) const;       // as entered in the table
+    QString duplicateOf(const RideFingerprint &fingerprint) const; // in the library or this import
+
     QList <QString> filenames; // list of filenames passed
     QList <bool> blanks; // record of which have a RideFileReader returned date & time
     QDir home; // target directory
@@ -68,6 +86,89 @@ private:
     Context *context; // caller
 
     QStringList deleteMe; // list of temp files created during import
+    QList<QPair<QString, RideFingerprint> > validatedRides; // so far, to spot the same one twice
+};
+
+// Each file is passed through the import workers as one of these, when
+// validating they say what was found in the file, when saving they hand
+// back the opened ride for the GUI thread to write
+struct RideImportItem
+{
+    int row;                // in the table
+    QString filename;
+    QDateTime rideTime;     // saving: as confirmed by the user
+
+    RideFile *ride;         // saving: opened and processed ready to write
+    QStringList extracted;  // validating: temporary files split out of an archive of rides
+    QStringList errors;
+    bool parsed;
+    QDateTime startTime;
+    int secs;
+    double km;
+    RideFingerprint fingerprint;
+
+    RideImportItem() : row(0), ride(NULL), parsed(false), secs(0), km(0) {}
+};
+
+// The queues shared between the wizard and its workers. When ordered the
+// done items are handed back in the order they were queued so the files
+// are written in order, the done queue is bounded so we don't hold every
+// opened ride in memory whilst the GUI thread catches up.
+class RideImportQueue
+{
+    public:
+        RideImportQueue(QList<RideImportItem> todo, int maxdone, bool ordered);
+
+        bool takeJob(RideImportItem &item);                 // false when no more work
+        void putDone(RideImportItem &item);                 // blocks whilst done queue is full
+        bool takeDone(RideImportItem &item, unsigned long); // false on timeout
+        void cancel();
+
+    private:
+        QMutex lock;
+        QWaitCondition notFull, notEmpty;
+        QList<RideImportItem> todo;
+        QMap<int, RideImportItem> done; // by row
+        QList<int> order;               // rows not yet taken from done
+        int maxdone;
+        bool ordered, cancelled;
+};
+
+// the import worker ... runs in a thread
+// Used by the validating workers to stream the rides out of an archive, the
+// first is held in case it is the only one and the rest are written straight
+// out as temporary files, so only one ride is ever in memory at a time
+class RideImportSplitter : public RideFileSplitter
+{
+    public:
+        RideImportSplitter(Context *context, QString filename)
+        : context(context), filename(filename), held(NULL), count(0) {}
+        ~RideImportSplitter() { delete held; }
+        void split(RideFile *ride);
+
+        RideFile *take() { RideFile *ride = held; held = NULL; return ride; }
+        QStringList extracted;
+
+    private:
+        void extract(RideFile *ride);
+
+        Context *context;
+        QString filename;
+        RideFile *held;
+        int count;
+};
+
+class RideImportWorker : public QThread
+{
+    public:
+        RideImportWorker(Context *context, RideImportQueue *queue, bool validating)
+        : context(context), queue(queue), validating(validating) {}
+        void run();
+
+    private:
+        Context *context;
+        RideImportQueue *queue;
+        bool validating;
 };
 
 // Item Delegate for Editing Date and Time of Ride inside the
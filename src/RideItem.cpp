@@ -22,6 +22,9 @@
 #include "RideFile.h"
 #include "Context.h"
 #include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "CacheStats.h"
 #include "Zones.h"
 #include "HrZones.h"
 #include <math.h>
@@ -29,18 +32,50 @@
 RideItem::RideItem(int type,
                    QString path, QString fileName, const QDateTime &dateTime,
                    const Zones *zones, const HrZones *hrZones, Context *context) :
-    QTreeWidgetItem(type), ride_(NULL), context(context), isdirty(false), isedit(false), path(path), fileName(fileName),
-    dateTime(dateTime), zones(zones), hrZones(hrZones)
+    QTreeWidgetItem(type), ride_(NULL), context(context), isdirty(false), revision_(0), saving(false), isedit(false), path(path), fileName(fileName),
+    dateTime(dateTime), lastUsed(0), zones(zones), hrZones(hrZones)
 { }
 
+RideItem::~RideItem()
+{
+    if (ride_) context->athlete->rideCache->freed(this);
+}
+
 RideFile *RideItem::ride()
 {
-    if (ride_) return ride_;
+    static unsigned long clock = 0;
+    lastUsed = ++clock;
+
+    if (ride_) {
+        RideCache::stats().hit();
+        return ride_;
+    }
+    RideCache::stats().miss();
 
     // open the ride file
     QFile file(path + "/" + fileName);
-    ride_ = RideFileFactory::instance().openRideFile(context, file, errors_);
-    if (ride_ == NULL) return NULL; // failed to read ride
+    RideFile *opened = RideFileFactory::instance().openRideFile(context, file, errors_);
+    if (opened == NULL) return NULL; // failed to read ride
+
+    setRide(opened);
+    return ride_;
+}
+
+// open the ride in the background rather than wait on the disk, the
+// cache reads it and rideReady() is emitted once it has been set
+bool
+RideItem::requestRide()
+{
+    if (ride_) return true;
+
+    context->athlete->rideCache->request(this);
+    return false;
+}
+
+void
+RideItem::setRide(RideFile *opened)
+{
+    ride_ = opened;
 
     setDirty(false); // we're gonna use on-disk so by
                      // definition it is clean - but do it *after*
@@ -53,7 +88,8 @@ RideFile *RideItem::ride()
     connect(ride_, SIGNAL(saved()), this, SLOT(saved()));
     connect(ride_, SIGNAL(reverted()), this, SLOT(reverted()));
 
-    return ride_;
+    // the cache frees it when we run short of memory
+    context->athlete->rideCache->opened(this);
 }
 
 void
@@ -68,9 +104,16 @@ RideItem::notifyRideMetadataChanged()
     emit rideMetadataChanged();
 }
 
+void
+RideItem::notifyRideReady()
+{
+    emit rideReady();
+}
+
 void
 RideItem::modified()
 {
+    revision_++;
     setDirty(true);
 }
 
@@ -117,6 +160,19 @@ RideItem::setDirty(bool val)
     }
 }
 
+void
+RideItem::setSaving(bool val)
+{
+    if (saving == val) return;
+    saving = val;
+
+    for (int i=0; i<3; i++) {
+        QFont current = font(i);
+        current.setItalic(saving);
+        setFont(i, current);
+    }
+}
+
 // name gets changed when file is converted in save
 void
 RideItem::setFileName(QString path, QString fileName)
@@ -150,6 +206,7 @@ void
 RideItem::freeMemory()
 {
     if (ride_) {
+        context->athlete->rideCache->freed(this);
         delete ride_;
         ride_ = NULL;
     }
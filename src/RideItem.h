@@ -51,6 +51,8 @@ class RideItem : public QObject, public QTreeWidgetItem //<< for signals/slots
         QStringList errors_;
         Context *context; // to notify widgets when date/time changes
         bool isdirty;
+        int revision_; // counts the edits
+        bool saving;
 
     public slots:
         void modified();
@@ -58,10 +60,12 @@ class RideItem : public QObject, public QTreeWidgetItem //<< for signals/slots
         void saved();
         void notifyRideDataChanged();
         void notifyRideMetadataChanged();
+        void notifyRideReady();
 
     signals:
         void rideDataChanged();
         void rideMetadataChanged();
+        void rideReady(); // requestRide() finished, rideIfOpen() is NULL if it failed
 
     public:
 
@@ -71,16 +75,24 @@ class RideItem : public QObject, public QTreeWidgetItem //<< for signals/slots
         QString fileName;
         QDateTime dateTime;
         RideFile *ride();
+        RideFile *rideIfOpen() { return ride_; } // doesn't open it
+        void setRide(RideFile *); // already opened, e.g. prefetched
+        bool requestRide(); // true if open, otherwise rideReady() follows
+        unsigned long lastUsed; // when ride() was last called, see RideCache
         const QStringList errors() { return errors_; }
+        void setErrors(QStringList errors) { errors_ = errors; }
         const Zones *zones;
         const HrZones *hrZones;
 
         RideItem(int type, QString path,
                  QString fileName, const QDateTime &dateTime,
                  const Zones *zones, const HrZones *hrZones, Context *context);
+        ~RideItem();
 
         void setDirty(bool);
-        bool isDirty() { return isdirty; }
+        bool isDirty() const { return isdirty; }
+        int revision() const { return revision_; }
+        void setSaving(bool); // shown in italics whilst a save is written
         void setFileName(QString, QString);
         void setStartTime(QDateTime);
         void freeMemory();
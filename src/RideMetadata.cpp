@@ -844,9 +844,29 @@ static QString xmlprotect(QString string)
     return s;
 }
 
+// Every athlete and a good few charts read the same metadata and measures
+// files, so the parsed definitions are shared across the whole process
+// and only parsed again when the file changes
+struct MetadataSchema
+{
+    QDateTime modified;
+    qint64 size;
+    QList<KeywordDefinition> keywordDefinitions;
+    QList<FieldDefinition> fieldDefinitions;
+    QString colorfield;
+};
+static QMutex schemaLock;
+static QHash<QString, MetadataSchema> schemas; // by filename
+static void parseXML(QString filename, QList<KeywordDefinition>&, QList<FieldDefinition>&, QString &colorfield);
+
 void
 RideMetadata::serialize(QString filename, QList<KeywordDefinition>keywordDefinitions, QList<FieldDefinition>fieldDefinitions, QString colorfield)
 {
+    // about to change, don't trust the timestamp to notice
+    schemaLock.lock();
+    schemas.remove(filename);
+    schemaLock.unlock();
+
     // open file - truncate contents
     QFile file(filename);
     file.open(QFile::WriteOnly);
@@ -923,6 +943,31 @@ static QString unprotect(QString buffer)
 
 void
 RideMetadata::readXML(QString filename, QList<KeywordDefinition>&keywordDefinitions, QList<FieldDefinition>&fieldDefinitions, QString &colorfield)
+{
+    QFileInfo info(filename);
+    QMutexLocker locker(&schemaLock);
+
+    QHash<QString, MetadataSchema>::const_iterator cached = schemas.constFind(filename);
+    if (cached != schemas.constEnd() && cached->modified == info.lastModified() && cached->size == info.size()) {
+        keywordDefinitions = cached->keywordDefinitions;
+        fieldDefinitions = cached->fieldDefinitions;
+        colorfield = cached->colorfield;
+        return;
+    }
+
+    parseXML(filename, keywordDefinitions, fieldDefinitions, colorfield);
+
+    MetadataSchema add;
+    add.modified = info.lastModified();
+    add.size = info.size();
+    add.keywordDefinitions = keywordDefinitions;
+    add.fieldDefinitions = fieldDefinitions;
+    add.colorfield = colorfield;
+    schemas.insert(filename, add);
+}
+
+static void
+parseXML(QString filename, QList<KeywordDefinition>&keywordDefinitions, QList<FieldDefinition>&fieldDefinitions, QString &colorfield)
 {
     QFile metadataFile(filename);
     QXmlInputSource source( &metadataFile );
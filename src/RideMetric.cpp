@@ -19,45 +19,171 @@
 #include "RideMetric.h"
 #include "Zones.h"
 #include "HrZones.h"
+#include "Trace.h"
+#include "RideStatistics.h"
+#include "Athlete.h"
+#include "Settings.h"
+#include <QSet>
+#include <QMutex>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QRunnable>
 
 RideMetricFactory *RideMetricFactory::_instance;
 QVector<QString> RideMetricFactory::noDeps;
 
+RideMetricConfig::RideMetricConfig(const Context *context) :
+    zones_(NULL), hrZones_(NULL), settings_(SettingsSnapshot::current()), female_(false)
+{
+    if (context) {
+        ownZones_ = QSharedPointer<const Zones>(context->athlete->zones()->copy());
+        ownHrZones_ = QSharedPointer<const HrZones>(context->athlete->hrZones()->copy());
+        zones_ = ownZones_.data();
+        hrZones_ = ownHrZones_.data();
+        female_ = appsettings->cvalue(context->athlete->cyclist, GC_SEX).toInt() == 1;
+    }
+
+    // and so is the registry, as far as the threads are concerned
+    RideMetricFactory::instance().prepare();
+}
+
+RideMetricConfig::RideMetricConfig(const Context *context, const Zones *zones, const HrZones *hrZones) :
+    zones_(zones), hrZones_(hrZones), settings_(SettingsSnapshot::current()), female_(false)
+{
+    if (context) female_ = appsettings->cvalue(context->athlete->cyclist, GC_SEX).toInt() == 1;
+}
+
+RideMetricConfig::RideMetricConfig(const RideMetricConfig &other) :
+    zones_(other.zones_), hrZones_(other.hrZones_), ownZones_(other.ownZones_), ownHrZones_(other.ownHrZones_),
+    settings_(other.settings_), female_(other.female_)
+{
+}
+
+RideMetricConfig &
+RideMetricConfig::operator=(const RideMetricConfig &other)
+{
+    zones_ = other.zones_;
+    hrZones_ = other.hrZones_;
+    ownZones_ = other.ownZones_;
+    ownHrZones_ = other.ownHrZones_;
+    settings_ = other.settings_;
+    female_ = other.female_;
+    return *this;
+}
+
+RideMetricConfig::~RideMetricConfig()
+{
+}
+
+// the metrics at one level of the schedule are computed by these, on the
+// pool or inline, they only read the metrics from lower levels
+struct RideMetricTask : public QRunnable
+{
+    RideMetric *m;
+    QString symbol;
+    const Context *context;
+    const RideFile *ride;
+    const RideMetricConfig *config;
+    int zoneRange, hrZoneRange;
+    const QHash<QString,RideMetric*> *done;
+    const RideStatistics *statistics;
+    QSemaphore *finished;
+
+    RideMetricTask() : finished(NULL) { setAutoDelete(false); }
+
+    void run() {
+        m->setStatistics(statistics);
+        m->setConfig(config);
+        //if (!ride->dataPoints().isEmpty())
+            m->compute(ride, config->zones(), zoneRange, config->hrZones(), hrZoneRange, *done, context);
+        m->setStatistics(NULL); // only lives as long as computeMetrics
+        m->setConfig(NULL);
+        if (ride->metricOverrides.contains(symbol))
+            m->override(ride->metricOverrides.value(symbol));
+        if (finished) finished->release();
+    }
+};
+
+// short rides are computed inline, handing over to a thread would cost
+// more than the metrics themselves
+static const int parallelMinimumPoints = 3600;
+
 QHash<QString,RideMetricPtr>
 RideMetric::computeMetrics(const Context *context, const RideFile *ride, const Zones *zones, const HrZones *hrZones,
                            const QStringList &metrics)
 {
-    int zoneRange = zones->whichRange(ride->startTime().date());
-    int hrZoneRange = hrZones->whichRange(ride->startTime().date());
+    return computeMetrics(context, ride, RideMetricConfig(context, zones, hrZones), metrics);
+}
+
+QHash<QString,RideMetricPtr>
+RideMetric::computeMetrics(const Context *context, const RideFile *ride, const RideMetricConfig &config,
+                           const QStringList &metrics)
+{
+    GC_TRACE_SPAN("compute metrics");
+    int zoneRange = config.zones()->whichRange(ride->startTime().date());
+    int hrZoneRange = config.hrZones()->whichRange(ride->startTime().date());
 
     const RideMetricFactory &factory = RideMetricFactory::instance();
-    QStringList todo = metrics;
+
+    // gather the metrics asked for and everything they depend upon
+    QSet<QString> wanted;
+    QStringList stack = metrics;
+    while (!stack.isEmpty()) {
+        QString symbol = stack.takeLast();
+        if (wanted.contains(symbol) || !factory.haveMetric(symbol)) continue;
+        wanted.insert(symbol);
+        foreach (QString dep, factory.dependencies(symbol)) stack.append(dep);
+    }
+
+    // and put them in their levels
+    QVector<QStringList> levels;
+    foreach (QString symbol, wanted) {
+        int level = factory.metricLevel(factory.metricIndex(symbol));
+        if (level >= levels.count()) levels.resize(level + 1);
+        levels[level] << symbol;
+    }
+
+    // the weight may come from the athlete's measures, look it up
+    // once here rather than from several metrics at once
+    bool parallel = ride->dataPoints().count() >= parallelMinimumPoints;
+    if (parallel) const_cast<RideFile*>(ride)->getWeight();
+
+    QThreadPool *pool = QThreadPool::globalInstance();
     QHash<QString,RideMetric*> done;
-    while (!todo.isEmpty()) {
-        QString symbol = todo.takeFirst();
-        if (!factory.haveMetric(symbol)) continue;
-        const QVector<QString> &deps = factory.dependencies(symbol);
-        bool ready = true;
-        foreach (QString dep, deps) {
-            if (!done.contains(dep)) {
-                ready = false;
-                if (!todo.contains(dep))
-                    todo.append(dep);
+    RideStatistics statistics(ride);
+    foreach (const QStringList &level, levels) {
+
+        QVector<RideMetricTask> tasks(level.count());
+        QSemaphore finished;
+        int started = 0;
+
+        for (int i=0; i<level.count(); i++) {
+            RideMetricTask &task = tasks[i];
+            task.m = factory.newMetric(level[i]);
+            task.symbol = level[i];
+            task.context = context;
+            task.ride = ride;
+            task.config = &config;
+            task.zoneRange = zoneRange;
+            task.hrZoneRange = hrZoneRange;
+            task.done = &done;
+            task.statistics = &statistics;
+
+            // only use threads that are free, otherwise do it ourselves
+            // so we don't queue behind refresh workers already busy
+            task.finished = &finished;
+            if (parallel && i < level.count()-1 && pool->tryStart(&task)) started++;
+            else {
+                task.finished = NULL;
+                task.run();
             }
         }
-        if (ready) {
-            RideMetric *m = factory.newMetric(symbol);
-            //if (!ride->dataPoints().isEmpty())
-                m->compute(ride, zones, zoneRange, hrZones, hrZoneRange, done, context);
-            if (ride->metricOverrides.contains(symbol))
-                m->override(ride->metricOverrides.value(symbol));
-            done.insert(symbol, m);
-        }
-        else {
-            if (!todo.contains(symbol))
-                todo.append(symbol);
-        }
+        finished.acquire(started);
+
+        // the next level can see these now
+        for (int i=0; i<tasks.count(); i++) done.insert(tasks[i].symbol, tasks[i].m);
     }
+
     QHash<QString,RideMetricPtr> result;
     foreach (QString symbol, metrics) {
         result.insert(symbol, QSharedPointer<RideMetric>(done.value(symbol)));
@@ -67,3 +193,127 @@ RideMetric::computeMetrics(const Context *context, const RideFile *ride, const Z
         delete done.value(symbol);
     return result;
 }
+
+QHash<QString,RideMetricPtr>
+RideMetric::computeIntervalMetrics(const Context *context, const RideFile *ride, int start, int stop,
+                                   const QStringList &metrics)
+{
+    const Zones *zones = context->athlete->zones();
+    const HrZones *hrZones = context->athlete->hrZones();
+
+    QString key = QString("%1:%2:%3:%4:%5:%6").arg(start).arg(stop)
+                                              .arg(quintptr(zones)).arg(quintptr(hrZones))
+                                              .arg(SettingsSnapshot::current().generation)
+                                              .arg(metrics.join(","));
+    RideFile *mutableRide = const_cast<RideFile*>(ride);
+    {
+        QMutexLocker locker(&mutableRide->intervalLock);
+        if (ride->intervalMetrics.contains(key)) return ride->intervalMetrics.value(key);
+    }
+
+    RideFile view(ride, start, stop);
+    QHash<QString,RideMetricPtr> computed = computeMetrics(context, &view, zones, hrZones, metrics);
+
+    QMutexLocker locker(&mutableRide->intervalLock);
+    mutableRide->intervalMetrics.insert(key, computed);
+    return computed;
+}
+
+const RideStatistics &
+RideMetric::statistics(const RideFile *ride) const
+{
+    if (statistics_) return *statistics_;
+    if (ownStatistics_.isNull() || ownStatistics_->rideFile() != ride)
+        ownStatistics_ = QSharedPointer<RideStatistics>(new RideStatistics(ride));
+    return *ownStatistics_;
+}
+
+const RideMetricConfig &
+RideMetric::config(const Context *context) const
+{
+    if (config_) return *config_;
+    if (ownConfig_.isNull())
+        ownConfig_ = QSharedPointer<RideMetricConfig>(new RideMetricConfig(context,
+                                        context ? context->athlete->zones() : NULL,
+                                        context ? context->athlete->hrZones() : NULL));
+    return *ownConfig_;
+}
+
+// levels are worked out the first time they're needed, after all
+// the metrics have registered, since registration order is arbitrary
+int
+RideMetricFactory::metricLevel(int i) const
+{
+    static QMutex lock;
+    QMutexLocker locker(&lock);
+
+    if (!scheduled) {
+        RideMetricFactory *me = const_cast<RideMetricFactory*>(this);
+        me->metricLevels.fill(-1, metricNames.count());
+
+        // repeat until settled, each pass resolves at least one more level
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int j=0; j<metricNames.count(); j++) {
+                if (metricLevels[j] >= 0) continue;
+
+                int level = 0;
+                bool ready = true;
+                foreach (const QString &dep, dependencies(metricNames[j])) {
+                    int d = metricLevels.value(metricIndex(dep), -1);
+                    if (d < 0) { ready = false; break; }
+                    level = qMax(level, d + 1);
+                }
+                if (ready) {
+                    me->metricLevels[j] = level;
+                    changed = true;
+                }
+            }
+        }
+
+        // dependency cycles or missing metrics, compute them last
+        int last = 0;
+        for (int j=0; j<metricLevels.count(); j++) last = qMax(last, metricLevels[j] + 1);
+        for (int j=0; j<metricLevels.count(); j++) if (metricLevels[j] < 0) me->metricLevels[j] = last;
+
+        me->scheduled = true;
+    }
+    return metricLevels.value(i, 0);
+}
+
+QStringList
+RideMetricFactory::metricsDependingOn(int flags) const
+{
+    static QMutex lock;
+    QMutexLocker locker(&lock);
+
+    if (!dependents.contains(flags)) {
+
+        // keep going until no more are found, a metric is in if
+        // it depends on them or on a metric that is already in
+        QSet<QString> found;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            foreach (const QString &symbol, metricNames) {
+                if (found.contains(symbol)) continue;
+
+                bool depends = (metrics.value(symbol)->dependsOn() & flags) != 0;
+                foreach (const QString &dep, dependencies(symbol))
+                    if (found.contains(dep)) depends = true;
+
+                if (depends) {
+                    found.insert(symbol);
+                    changed = true;
+                }
+            }
+        }
+
+        // in registration order, as the database columns are
+        QStringList result;
+        foreach (const QString &symbol, metricNames) if (found.contains(symbol)) result << symbol;
+        const_cast<RideMetricFactory*>(this)->dependents.insert(flags, result);
+    }
+    return dependents.value(flags);
+}
@@ -30,14 +30,49 @@
 
 #include "RideFile.h"
 #include "Context.h"
+#include "Settings.h"
 
 class Zones;
 class HrZones;
 class Context;
+class RideStatistics;
 
 class RideMetric;
 typedef QSharedPointer<RideMetric> RideMetricPtr;
 
+// What metrics are computed with besides the ride; the zones, settings and
+// the athlete's details. A frozen one is copied from the athlete on the GUI
+// thread, so every ride in a refresh is computed with the same version of
+// it whatever is edited meanwhile, and the threads computing them never
+// read the athlete or appsettings. Cheap to copy.
+class RideMetricConfig
+{
+    public:
+        // a frozen copy of the athlete's, GUI thread only
+        RideMetricConfig(const Context *context);
+
+        // the zones given as they are, for computing on the GUI thread
+        RideMetricConfig(const Context *context, const Zones *zones, const HrZones *hrZones);
+
+        // where the zones are complete
+        RideMetricConfig(const RideMetricConfig &other);
+        RideMetricConfig &operator=(const RideMetricConfig &other);
+        ~RideMetricConfig();
+
+        const Zones *zones() const { return zones_; }
+        const HrZones *hrZones() const { return hrZones_; }
+        const SettingsSnapshot &settings() const { return settings_; }
+        bool female() const { return female_; }
+
+    private:
+        const Zones *zones_;
+        const HrZones *hrZones_;
+        QSharedPointer<const Zones> ownZones_; // when frozen
+        QSharedPointer<const HrZones> ownHrZones_;
+        SettingsSnapshot settings_;
+        bool female_;
+};
+
 class RideMetric {
 
 public:
@@ -45,6 +80,12 @@ public:
     enum metrictype { Total, Average, Peak, Low } types;
     typedef enum metrictype MetricType;
 
+    // What a metric reads besides the ride samples, so when only one of
+    // these changes we need only recompute the metrics that use it. The
+    // zones are those in effect on the day, the weight the ride's own, or
+    // the athlete's for the day if it hasn't one
+    enum dependency { Samples = 0x00, Metadata = 0x01, PowerZone = 0x02, HrZone = 0x04, Weight = 0x08 };
+
     RideMetric() {
         // some sensible defaults
         aggregate_ = true;
@@ -54,6 +95,9 @@ public:
         type_ = Total;
         count_ = 1;
         value_ = 0.0;
+        dependsOn_ = Samples;
+        statistics_ = NULL;
+        config_ = NULL;
     }
     virtual ~RideMetric() {}
 
@@ -73,6 +117,10 @@ public:
     // English name used in metadata.xml for compatibility
     virtual QString internalName() const { return internalName_; }
 
+    // Whatever it reads besides the samples, a combination of the
+    // dependency flags, not including those of its dependencies
+    virtual int dependsOn() const { return dependsOn_; }
+
     // What type of metric is this?
     // Drives the way metrics combined over a day or week in the
     // Long term metrics charts
@@ -140,6 +188,18 @@ public:
     computeMetrics(const Context *context, const RideFile *ride, const Zones *zones, const HrZones *hrZones,
                    const QStringList &metrics);
 
+    // the same with a configuration taken beforehand, safe from any thread
+    static QHash<QString,RideMetricPtr>
+    computeMetrics(const Context *context, const RideFile *ride, const RideMetricConfig &config,
+                   const QStringList &metrics);
+
+    // metrics for the points from start to stop (inclusive) of a ride,
+    // worked out over a view of its points and kept with the ride until
+    // it is changed, or the zones or settings are
+    static QHash<QString,RideMetricPtr>
+    computeIntervalMetrics(const Context *context, const RideFile *ride, int start, int stop,
+                           const QStringList &metrics);
+
     // Initialisers for derived classes to setup basic data
     void setValue(double x) { value_ = x; }
     void setCount(double x) { count_ = x; }
@@ -153,8 +213,24 @@ public:
     void setSymbol(QString x) { symbol_ = x; }
     void setType(MetricType x) { type_ = x; }
     void setAggregate(bool x) { aggregate_ = x; }
+    void setDependsOn(int x) { dependsOn_ = x; }
+
+    // shared by the metrics computeMetrics is working out for a ride, those
+    // computed on their own get one of their own
+    void setStatistics(const RideStatistics *x) { statistics_ = x; }
+    const RideStatistics &statistics(const RideFile *ride) const;
+
+    // the configuration computeMetrics was given, metrics read their
+    // settings from here rather than appsettings
+    void setConfig(const RideMetricConfig *x) { config_ = x; }
+    const RideMetricConfig &config(const Context *context) const;
 
     private:
+        const RideStatistics *statistics_;
+        mutable QSharedPointer<RideStatistics> ownStatistics_;
+        const RideMetricConfig *config_;
+        mutable QSharedPointer<RideMetricConfig> ownConfig_;
+
         bool    aggregate_;
         double  value_,
                 count_, // used when averaging
@@ -165,6 +241,7 @@ public:
         QString metricUnits_, imperialUnits_;
         QString name_, symbol_, internalName_;
         MetricType type_;
+        int dependsOn_;
 };
 
 class RideMetricFactory {
@@ -173,12 +250,22 @@ class RideMetricFactory {
     static QVector<QString> noDeps;
 
     QVector<QString> metricNames;
+    QHash<QString,int> metricIndexes;
     QVector<RideMetric::MetricType> metricTypes;
     QHash<QString,RideMetric*> metrics;
     QHash<QString,QVector<QString>*> dependencyMap;
     bool dependenciesChecked;
 
-    RideMetricFactory() : dependenciesChecked(false) {}
+    // the schedule computeMetrics works to, each metric's level is one more
+    // than the deepest of its dependencies so metrics at the same level
+    // can be computed together. Built on first use after registration.
+    QVector<int> metricLevels;
+    bool scheduled;
+
+    // metricsDependingOn() by the flags asked for, built on first use
+    QHash<int, QStringList> dependents;
+
+    RideMetricFactory() : dependenciesChecked(false), scheduled(false) {}
     RideMetricFactory(const RideMetricFactory &other);
     RideMetricFactory &operator=(const RideMetricFactory &other);
 
@@ -206,7 +293,12 @@ class RideMetricFactory {
             metrics[metricName]->initialize();
     }
 
+    // check the dependencies and work out the schedule now, rather than
+    // on first use, so threads computing metrics only ever read them
+    void prepare() const { checkDependencies(); metricLevel(0); }
+
     const QString &metricName(int i) const { return metricNames[i]; }
+    int metricIndex(const QString &symbol) const { return metricIndexes.value(symbol, -1); }
     const RideMetric::MetricType &metricType(int i) const { return metricTypes[i]; }
     const RideMetric *rideMetric(QString name) const { return metrics.value(name, NULL); }
 
@@ -224,6 +316,7 @@ class RideMetricFactory {
                    const QVector<QString> *deps = NULL) {
         assert(!metrics.contains(metric.symbol()));
         metrics.insert(metric.symbol(), metric.clone());
+        metricIndexes.insert(metric.symbol(), metricNames.count());
         metricNames.append(metric.symbol());
         metricTypes.append(metric.type());
         if (deps) {
@@ -233,6 +326,8 @@ class RideMetricFactory {
             dependencyMap.insert(metric.symbol(), copy);
             dependenciesChecked = false;
         }
+        scheduled = false;
+        dependents.clear();
         return true;
     }
 
@@ -241,6 +336,13 @@ class RideMetricFactory {
         QVector<QString> *result = dependencyMap.value(symbol);
         return result ? *result : noDeps;
     }
+
+    // the level a metric is scheduled at, 0 for no dependencies
+    int metricLevel(int i) const;
+
+    // the metrics that depend on any of the dependency flags given, either
+    // themselves or through one of the metrics they depend upon
+    QStringList metricsDependingOn(int flags) const;
 };
 
 #endif // _GC_RideMetric_h
@@ -22,6 +22,7 @@
 #include "RideNavigator.h"
 #include "RideNavigatorProxy.h"
 #include "SearchFilterBox.h"
+#include "RideProfile.h"
 
 #include <QtGui>
 #include <QString>
@@ -68,6 +69,7 @@ RideNavigator::RideNavigator(Context *context, bool mainwindow) : context(contex
     // get setup
     tableView = new QTreeView;
     delegate = new NavigatorCellDelegate(this);
+    profiles = new RideProfileCache(this);
     tableView->setAnimated(true);
     tableView->setItemDelegate(delegate);
     tableView->setModel(sortModel);
@@ -97,6 +99,10 @@ RideNavigator::RideNavigator(Context *context, bool mainwindow) : context(contex
     // refresh when database is updated
     connect(context->athlete->metricDB, SIGNAL(dataChanged()), this, SLOT(refresh()));
 
+    // the sparklines are drawn on other threads
+    connect(profiles, SIGNAL(rendered()), tableView->viewport(), SLOT(update()));
+    connect(context, SIGNAL(configChanged()), profiles, SLOT(clear()));
+
     // refresh when config changes (metric/imperial?)
     connect(context, SIGNAL(configChanged()), this, SLOT(refresh()));
     // refresh when rides added/removed
@@ -175,6 +181,8 @@ RideNavigator::resetView()
     internalNameMap.insert("Time", tr("Time"));
     nameMap.insert("fingerprint", tr("Config Checksum"));
     internalNameMap.insert("Config Checksum", tr("Config Checksum"));
+    nameMap.insert("profile", tr("Profile")); // drawn as a sparkline
+    internalNameMap.insert("Profile", tr("Profile"));
 
     // add metrics to the map
     const RideMetricFactory &factory = RideMetricFactory::instance();
@@ -602,6 +610,7 @@ class groupRange {
 };
 
 static QList<groupRange> groupRanges;
+static QHash<QString, int> groupRangeIndex; // column name to entry in groupRanges
 bool
 GroupByModel::initGroupRanges()
 {
@@ -666,6 +675,8 @@ GroupByModel::initGroupRanges()
     groupRanges << addColumn;
     addColumn.ranges.clear();
 
+    for (int i=0; i<groupRanges.count(); i++) groupRangeIndex.insert(groupRanges[i].column, i);
+
     return true;
 }
 static bool _initGroupRanges = false;
@@ -677,21 +688,20 @@ GroupByModel::groupFromValue(QString headingName, QString value, double rank, do
     if (!_initGroupRanges)
         _initGroupRanges = initGroupRanges();
     // Check for predefined thresholds / zones / bands for this metric/column
-    foreach (groupRange orange, groupRanges) {
-        if (orange.column == headingName) {
-
-            double number = value.toDouble();
-            // use thresholds defined for this column/metric
-            foreach(groupRange::range range, orange.ranges) {
-
-                // 0-x is lower, x-0 is upper, 0-0 is no data and x-x is a range
-                if (range.low == 0.0 && range.high == 0.0 && number == 0.0) return range.name;
-                else if (range.high != 0.0 && range.low == 0.0 && number < range.high) return range.name;
-                else if (range.low != 0.0 && range.high == 0.0 && number >= range.low) return range.name;
-                else if (number < range.high && number >= range.low) return range.name;
-            }
-            return tr("Undefined");
+    int index = groupRangeIndex.value(headingName, -1);
+    if (index >= 0) {
+
+        double number = value.toDouble();
+        // use thresholds defined for this column/metric
+        foreach(const groupRange::range &range, groupRanges[index].ranges) {
+
+            // 0-x is lower, x-0 is upper, 0-0 is no data and x-x is a range
+            if (range.low == 0.0 && range.high == 0.0 && number == 0.0) return range.name;
+            else if (range.high != 0.0 && range.low == 0.0 && number < range.high) return range.name;
+            else if (range.low != 0.0 && range.high == 0.0 && number >= range.low) return range.name;
+            else if (number < range.high && number >= range.low) return range.name;
         }
+        return tr("Undefined");
     }
 
     // Use upper quartile for anything left that is a metric
@@ -737,6 +747,15 @@ GroupByModel::groupFromValue(QString headingName, QString value, double rank, do
     return value;
 }
 
+// quartiles depend on every row, so adding one can move all the others
+bool
+GroupByModel::groupIsRanked(QString headingName) const
+{
+    if (!_initGroupRanges)
+        _initGroupRanges = initGroupRanges();
+    return !groupRangeIndex.contains(headingName) && rideNavigator->columnMetrics.value(headingName, NULL) != NULL;
+}
+
 void
 RideNavigator::removeColumn()
 {
@@ -913,6 +932,8 @@ void NavigatorCellDelegate::paint(QPainter *painter, const QStyleOptionViewItem
         } else if (columnName == tr("Time")) {
             QDateTime dateTime = QDateTime::fromString(value, Qt::ISODate);
             value = dateTime.toString("hh:mm:ss"); // same format as ride list
+        } else if (columnName == tr("Profile")) {
+            value = ""; // the sparkline is drawn below
         } else if (columnName == tr("Last updated")) {
             QDateTime dateTime;
             dateTime.setTime_t(index.model()->data(index, Qt::DisplayRole).toInt());
@@ -959,6 +980,15 @@ void NavigatorCellDelegate::paint(QPainter *painter, const QStyleOptionViewItem
             drawDisplay(painter, myOption, indented, value); //added
         } else drawDisplay(painter, myOption, normal, value); //added
 
+        // the sparkline, when it isn't drawn yet it will be repainted
+        if (columnName == tr("Profile")) {
+            QByteArray profile = index.model()->data(index, Qt::DisplayRole).toByteArray();
+            QSize size(myOption.rect.width() - 4, rideNavigator->fontHeight - 2);
+            QPixmap sparkline;
+            if (size.width() > 2 && rideNavigator->profiles->pixmap(profile, size, sparkline))
+                painter->drawPixmap(myOption.rect.x() + 2, myOption.rect.y() + 2, sparkline);
+        }
+
         // now get the calendar text to appear ...
         if (calendarText != "") {
             myOption.rect.setX(0);
@@ -40,6 +40,7 @@ class DiarySidebar;
 class BUGFIXQSortFilterProxyModel;
 class DataFilter;
 class GcMiniCalendar;
+class RideProfileCache;
 class SearchBox;
 
 //
@@ -175,6 +176,9 @@ class RideNavigator : public GcWindow
 
         // search filter box
         SearchFilterBox *searchFilterBox;
+
+        // the Profile column sparklines
+        RideProfileCache *profiles;
 };
 
 //
@@ -74,8 +74,15 @@ private:
 
     QMap<QString, QVector<int>*> groupToSourceRow;
     QVector<int> sourceRowToGroupRow;
+    QVector<int> sourceRowToGroup;
     QList<rankx> rankedRows;
 
+    // the group each source row is in, worked out once per row
+    // and then regrouped with a bucket pass over the keys
+    QVector<int> rowKey;    // index into keyNames
+    QStringList keyNames;
+    QHash<QString, int> keyIndex;
+
     void clearGroups() {
         // Wipe current
         QMapIterator<QString, QVector<int>*> i(groupToSourceRow);
@@ -87,7 +94,112 @@ private:
         groupIndexes.clear();
         groupToSourceRow.clear();
         sourceRowToGroupRow.clear();
+        sourceRowToGroup.clear();
+        rankedRows.clear();
+    }
+
+    void clearKeys() {
+        rowKey.clear();
+        keyNames.clear();
+        keyIndex.clear();
+    }
+
+    int internKey(const QString &name) {
+        int key = keyIndex.value(name, -1);
+        if (key < 0) {
+            key = keyNames.count();
+            keyNames << name;
+            keyIndex.insert(name, key);
+        }
+        return key;
+    }
+
+    // which group does this source row belong in, uses rankedRows
+    // when the grouping is ranked
+    QString groupForRow(int row, const QString &heading) const {
+
+        if (groupBy == -1) return tr("All Activities");
+
+        double rank = row < rankedRows.count() ? rankedRows[row].value : 0;
+        return groupFromValue(heading, sourceModel()->data(sourceModel()->index(row,groupBy)).toString(),
+                              rank, sourceModel()->rowCount(QModelIndex()));
+    }
+
+    QString groupHeading() const {
+        return groupBy == -1 ? QString() : headerData(groupBy+2, Qt::Horizontal).toString(); // accomodate virtual column
+    }
+
+    void rankRows() {
         rankedRows.clear();
+        if (groupBy < 0) return;
+
+        // rank all the values
+        for (int i=0; i<sourceModel()->rowCount(QModelIndex()); i++) {
+            rankx rank;
+            rank.value = sourceModel()->data(sourceModel()->index(i,groupBy)).toDouble();
+            rank.row = i;
+            rankedRows << rank;
+        }
+
+        // rank the entries
+        qSort(rankedRows); // sort by value
+        for (int i=0; i<rankedRows.count(); i++) {
+            rankedRows[i].value = i;
+        }
+
+        // sort by row again
+        qStableSort(rankedRows.begin(), rankedRows.end(), rankx::sortByRow);
+    }
+
+    // create a QMap from 'group' string to list of rows in that group
+    void buildGroups() {
+
+        clearGroups();
+
+        QVector<QVector<int>*> buckets(keyNames.count(), NULL);
+        for (int i=0; i<rowKey.count(); i++) {
+
+            QVector<int> *&rows = buckets[rowKey[i]];
+            if (rows == NULL) {
+                // add to list of groups
+                rows = new QVector<int>;
+                groupToSourceRow.insert(keyNames[rowKey[i]], rows);
+            }
+
+            // rowmap is an array corresponding to each row in the
+            // source model, and maps to its row # within the group
+            sourceRowToGroupRow.append(rows->count());
+
+            // add to this groups rows
+            rows->append(i);
+        }
+
+        // Update list of groups
+        QVector<int> keyToGroup(keyNames.count(), -1);
+        int group=0;
+        QMapIterator<QString, QVector<int>*> j(groupToSourceRow);
+        while (j.hasNext()) {
+            j.next();
+            keyToGroup[keyIndex.value(j.key())] = group;
+            groups << j.key();
+            groupIndexes << createIndex(group++,0,(void*)NULL);
+        }
+
+        sourceRowToGroup.resize(rowKey.count());
+        for (int i=0; i<rowKey.count(); i++) sourceRowToGroup[i] = keyToGroup[rowKey[i]];
+    }
+
+    // can rows be added, removed or changed without working out
+    // the groups of all the others again?
+    bool groupIsRanked(QString headingName) const; // in RideNavigator.cpp
+    bool incremental() const { return groupBy == -1 || !groupIsRanked(groupHeading()); }
+
+    void expandGroups() {
+        // lets expand column 0 for the groupBy heading
+        for (int i=0; i < groupCount(); i++)
+            rideNavigator->tableView->setFirstColumnSpanned(i, QModelIndex(), true);
+        // now show em
+        rideNavigator->tableView->expandAll();
     }
 
     static bool initGroupRanges();
@@ -124,10 +236,10 @@ public:
         }
 
         connect(model, SIGNAL(modelReset()), this, SLOT(sourceModelChanged()));
-        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(sourceModelChanged()));
-        connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(sourceModelChanged()));
+        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(sourceDataChanged(QModelIndex, QModelIndex)));
+        connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(sourceRowsInserted(QModelIndex,int,int)));
         connect(model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(sourceModelChanged()));
-        connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(sourceModelChanged()));
+        connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(sourceRowsRemoved(QModelIndex,int,int)));
     }
 
     QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const {
@@ -173,18 +285,14 @@ public:
     QModelIndex mapFromSource(const QModelIndex &sourceIndex) const {
 
         // which group did we put this row into?
-        QString group = whichGroup(sourceIndex.row());
-        int groupNo = groups.indexOf(group);
+        int row = sourceIndex.row();
+        if (row < 0 || row >= sourceRowToGroup.size()) return QModelIndex();
 
-        if (groupNo < 0) {
-            return QModelIndex();
-        } else {
-            QModelIndex *p = new QModelIndex(createIndex(groupNo, 0, (void*)NULL));
-            if (sourceIndex.row() > 0 && sourceIndex.row() < sourceRowToGroupRow.size())
-                return createIndex(sourceRowToGroupRow[sourceIndex.row()], sourceIndex.column()+2, &p); // accomodate virtual columns
-            else
-                return QModelIndex();
-        }
+        int groupNo = sourceRowToGroup[row];
+        if (groupNo < 0) return QModelIndex();
+
+        return createIndex(sourceRowToGroupRow[row], sourceIndex.column()+2, // accomodate virtual columns
+                           (void*)&groupIndexes[groupNo]);
     }
 
     // we override the standard version to make our virtual column zero
@@ -394,13 +502,8 @@ public:
 
     QString whichGroup(int row) const {
 
-        if (row < 0 || row >= rankedRows.count()) return ("");
-        if (groupBy == -1) return tr("All Activities");
-        else return groupFromValue(headerData(groupBy+2, // accomodate virtual column
-                                    Qt::Horizontal).toString(),
-                                    sourceModel()->data(sourceModel()->index(row,groupBy)).toString(),
-                                    rankedRows[row].value, rankedRows.count());
-
+        if (row < 0 || row >= rowKey.count()) return ("");
+        return keyNames[rowKey[row]];
     }
 
     // implemented in RideNavigator.cpp, to avoid developers
@@ -419,84 +522,99 @@ public:
 
         // wipe whatever is there first
         clearGroups();
+        clearKeys();
 
-        if (groupBy >= 0) {
+        rankRows();
 
-            // rank all the values
-            for (int i=0; i<sourceModel()->rowCount(QModelIndex()); i++) {
-                rankx rank;
-                rank.value = sourceModel()->data(sourceModel()->index(i,groupBy)).toDouble();
-                rank.row = i;
-                rankedRows << rank;
-            }
+        // work out each row's group just the once
+        QString heading = groupHeading();
+        int rows = sourceModel()->rowCount(QModelIndex());
+        rowKey.resize(rows);
+        for (int i=0; i<rows; i++) rowKey[i] = internKey(groupForRow(i, heading));
+        rankedRows.clear();
 
-            // rank the entries
-            qSort(rankedRows); // sort by value
-            for (int i=0; i<rankedRows.count(); i++) {
-                rankedRows[i].value = i;
-            }
+        buildGroups();
 
-            // sort by row again
-            qStableSort(rankedRows.begin(), rankedRows.end(), rankx::sortByRow);
+        // all done. let the views know everything changed
+        endResetModel();
+    }
 
+public slots:
+    void sourceModelChanged() {
+        setGroupBy(groupBy+2); // accomodate virtual columns, resets the model
+        expandGroups();
+    }
 
-            // create a QMap from 'group' string to list of rows in that group
-            for (int i=0; i<sourceModel()->rowCount(QModelIndex()); i++) {
+    // only the new rows need their group working out
+    void sourceRowsInserted(const QModelIndex &parent, int first, int last) {
 
-                // which group are we in?
-                QString value = whichGroup(i); // uses rankedRows
+        if (parent.isValid()) return;
+        if (!incremental()) {
+            sourceModelChanged();
+            return;
+        }
 
-                QVector<int> *rows;
-                if ((rows=groupToSourceRow.value(value,NULL)) == NULL) {
-                    // add to list of groups
-                    rows = new QVector<int>;
-                    groupToSourceRow.insert(value, rows);
-                }
+        beginResetModel();
+        QString heading = groupHeading();
+        rowKey.insert(first, last-first+1, 0);
+        for (int i=first; i<=last; i++) rowKey[i] = internKey(groupForRow(i, heading));
+        buildGroups();
+        endResetModel();
+        expandGroups();
+    }
 
-                // rowmap is an array corresponding to each row in the
-                // source model, and maps to its row # within the group
-                sourceRowToGroupRow.append(rows->count());
+    void sourceRowsRemoved(const QModelIndex &parent, int first, int last) {
 
-                // add to this groups rows
-                rows->append(i);
-            }
+        if (parent.isValid()) return;
+        if (!incremental()) {
+            sourceModelChanged();
+            return;
+        }
 
-        } else {
+        beginResetModel();
+        rowKey.remove(first, qMin(last, rowKey.count()-1)-first+1);
+        buildGroups();
+        endResetModel();
+        expandGroups();
+    }
+
+    // values changed in place, unless the column we group by was one of
+    // them the rows stay in the same groups so we just pass it on
+    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight) {
 
-            // Just one group by 'All Rides'
-            QVector<int> *rows = new QVector<int>;
-            for (int i=0; i<sourceModel()->rowCount(QModelIndex()); i++) {
-                rows->append(i);
-                sourceRowToGroupRow.append(i);
+        if (topLeft.parent().isValid()) return; // flat source, never happens
+        if (groupBy >= topLeft.column() && groupBy <= bottomRight.column()) {
+
+            if (!incremental()) {
+                sourceModelChanged();
+                return;
             }
-            groupToSourceRow.insert("All Activities", rows);
 
+            // regroup just the changed rows
+            beginResetModel();
+            QString heading = groupHeading();
+            for (int i=topLeft.row(); i<=bottomRight.row() && i<rowKey.count(); i++)
+                rowKey[i] = internKey(groupForRow(i, heading));
+            buildGroups();
+            endResetModel();
+            expandGroups();
+            return;
         }
 
-        // Update list of groups
-        int group=0;
-        QMapIterator<QString, QVector<int>*> j(groupToSourceRow);
-        while (j.hasNext()) {
-            j.next();
-            groups << j.key();
-            groupIndexes << createIndex(group++,0,(void*)NULL);
-        }
+        // accomodate virtual columns, ride_time shows ride_date
+        int left = topLeft.column()+2;
+        if (dateColumn >= topLeft.column() && dateColumn <= bottomRight.column()) left = 1;
 
-        // all done. let the views know everything changed
-        endResetModel();
-    }
+        for (int row = topLeft.row(); row <= bottomRight.row() && row < sourceRowToGroupRow.count(); row++) {
 
-public slots:
-    void sourceModelChanged() {
-        clearGroups();
-        setGroupBy(groupBy+2); // accomodate virtual columns
-        reset();
+            int groupNo = sourceRowToGroup[row];
+            if (groupNo < 0) continue;
 
-        // lets expand column 0 for the groupBy heading
-        for (int i=0; i < groupCount(); i++)
-            rideNavigator->tableView->setFirstColumnSpanned(i, QModelIndex(), true);
-        // now show em
-        rideNavigator->tableView->expandAll();
+            void *group = (void*)&groupIndexes[groupNo];
+            int groupRow = sourceRowToGroupRow[row];
+            emit dataChanged(createIndex(groupRow, left, group),
+                             createIndex(groupRow, bottomRight.column()+2, group));
+        }
     }
 };
 
@@ -529,7 +647,9 @@ class SearchFilter : public QSortFilterProxyModel
     SearchFilter(QWidget *p) : QSortFilterProxyModel(p), searchActive(false) {}
 
     void setSourceModel(QAbstractItemModel *model) {
-        QAbstractProxyModel::setSourceModel(model);
+        // the base class maps source changes row by row, rather
+        // than us turning each one into a reset of everything upstream
+        QSortFilterProxyModel::setSourceModel(model);
         this->model = model;
 
         // find the filename column
@@ -539,13 +659,6 @@ class SearchFilter : public QSortFilterProxyModel
                 fileIndex = i;
             }
         }
-
-	// make sure changes are propogated upstream
-        connect(model, SIGNAL(modelReset()), this, SIGNAL(modelReset()));
-        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SIGNAL(modelReset()));
-        connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SIGNAL(modelReset()));
-        connect(model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SIGNAL(modelReset()));
-        connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SIGNAL(modelReset()));
     }
 
     bool filterAcceptsRow (int source_row, const QModelIndex &source_parent) const {
@@ -563,13 +676,18 @@ class SearchFilter : public QSortFilterProxyModel
     public slots:
 
     void setStrings(QStringList list) {
+        QSet<QString> set = list.toSet();
+        if (searchActive && set == strings) return; // same results, nothing to redo
+
         beginResetModel();
-        strings = list;
+        strings = set;
         searchActive = true;
         endResetModel();
     }
 
     void clearStrings() {
+        if (!searchActive) return;
+
         beginResetModel();
         strings.clear();
         searchActive = false;
@@ -578,7 +696,7 @@ class SearchFilter : public QSortFilterProxyModel
 
     private:
         QAbstractItemModel *model;
-        QStringList strings;
+        QSet<QString> strings;
         int fileIndex;
         bool searchActive;
 };
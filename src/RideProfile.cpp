@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideProfile.h"
+#include "RideFile.h"
+#include "Colors.h"
+#include "Settings.h"
+#include "CacheStats.h"
+
+#include <QDataStream>
+#include <QPainter>
+#include <QPainterPath>
+#include <QRunnable>
+#include <QMetaObject>
+
+static CacheStats profileStats("Navigator sparklines", GC_PROFILECACHE_MB, 8);
+
+// the series in the profile, a bit each in the header
+enum { ProfilePower = 1, ProfileHr = 2, ProfileAlt = 4 };
+static const int ProfileVersion = 1;
+
+//
+// Encoded as the version, the number of points and which series are
+// present, then for each series its range and a byte per point
+//
+QByteArray
+RideProfile::summarise(const RideFile *ride)
+{
+    QByteArray returning;
+    const QVector<RideFilePoint*> &samples = ride->dataPoints();
+    if (samples.count() < 2) return returning;
+
+    int series = 0;
+    if (ride->areDataPresent()->watts) series |= ProfilePower;
+    if (ride->areDataPresent()->hr) series |= ProfileHr;
+    if (ride->areDataPresent()->alt) series |= ProfileAlt;
+    if (!series) return returning;
+
+    // average each series into buckets of elapsed time
+    double start = samples.first()->secs;
+    double duration = samples.last()->secs - start;
+    if (duration <= 0) return returning;
+
+    QVector<double> watts(points, 0), hr(points, 0), alt(points, 0);
+    QVector<int> count(points, 0);
+    foreach (const RideFilePoint *p, samples) {
+        int bucket = qMin(points-1, int((p->secs - start) / duration * points));
+        watts[bucket] += p->watts;
+        hr[bucket] += p->hr;
+        alt[bucket] += p->alt;
+        count[bucket]++;
+    }
+
+    // empty buckets, from recording gaps, carry the last value along
+    for (int i=0; i<points; i++) {
+        if (count[i]) {
+            watts[i] /= count[i];
+            hr[i] /= count[i];
+            alt[i] /= count[i];
+        } else if (i) {
+            watts[i] = 0;
+            hr[i] = hr[i-1];
+            alt[i] = alt[i-1];
+        }
+    }
+
+    QDataStream out(&returning, QIODevice::WriteOnly);
+    out << quint8(ProfileVersion) << quint16(points) << quint8(series);
+    QVector<double> *values[] = { &watts, &hr, &alt };
+    for (int s=0; s<3; s++) {
+        if (!(series & (1<<s))) continue;
+        QVector<double> &v = *values[s];
+
+        float min = v[0], max = v[0];
+        for (int i=1; i<points; i++) {
+            if (v[i] < min) min = v[i];
+            if (v[i] > max) max = v[i];
+        }
+        out << min << max;
+        for (int i=0; i<points; i++)
+            out << quint8(max > min ? qRound((v[i] - min) / (max - min) * 255.0) : 0);
+    }
+    return returning;
+}
+
+QImage
+RideProfile::render(const QByteArray &profile, QSize size, QColor power, QColor heartrate, QColor altitude)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    if (profile.isEmpty() || size.width() < 2 || size.height() < 2) return image;
+
+    QDataStream in(profile);
+    quint8 version, series;
+    quint16 count;
+    in >> version >> count >> series;
+    if (version != ProfileVersion || count < 2) return image;
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    double xscale = double(size.width() - 1) / (count - 1);
+    double height = size.height() - 2;
+
+    // the altitude is filled underneath, the others are lines over it
+    QColor colors[] = { power, heartrate, altitude };
+    QList<QPolygonF> lines;
+    QList<QColor> lineColors;
+    for (int s=0; s<3; s++) {
+        if (!(series & (1<<s))) continue;
+
+        float min, max;
+        in >> min >> max;
+        QPolygonF line;
+        for (int i=0; i<count; i++) {
+            quint8 v;
+            in >> v;
+            line << QPointF(i * xscale, 1 + height - v / 255.0 * height);
+        }
+        if (in.status() != QDataStream::Ok) break;
+
+        if (s == 2) {
+            QPainterPath fill;
+            fill.moveTo(0, size.height());
+            foreach (QPointF p, line) fill.lineTo(p);
+            fill.lineTo(size.width() - 1, size.height());
+            fill.closeSubpath();
+            QColor brush = altitude;
+            brush.setAlpha(90);
+            painter.fillPath(fill, brush);
+        } else {
+            lines << line;
+            lineColors << colors[s];
+        }
+    }
+    for (int i=lines.count()-1; i>=0; i--) { // power on top
+        painter.setPen(QPen(lineColors[i], 1));
+        painter.drawPolyline(lines[i]);
+    }
+    return image;
+}
+
+// draws one sparkline on the pool and hands it back to the cache
+class RideProfileRenderer : public QRunnable
+{
+    public:
+        RideProfileRenderer(QObject *cache, QString key, QByteArray profile, QSize size,
+                            QColor power, QColor heartrate, QColor altitude)
+            : cache(cache), key(key), profile(profile), size(size),
+              power(power), heartrate(heartrate), altitude(altitude) {}
+
+        void run() {
+            QImage image = RideProfile::render(profile, size, power, heartrate, altitude);
+            QMetaObject::invokeMethod(cache, "done", Qt::QueuedConnection, Q_ARG(QString, key), Q_ARG(QImage, image));
+        }
+
+    private:
+        QObject *cache;
+        QString key;
+        QByteArray profile;
+        QSize size;
+        QColor power, heartrate, altitude;
+};
+
+RideProfileCache::RideProfileCache(QObject *parent) : QObject(parent)
+{
+}
+
+RideProfileCache::~RideProfileCache()
+{
+    // the renderers post back to us
+    pool.waitForDone();
+    profileStats.forget(this);
+}
+
+bool
+RideProfileCache::pixmap(const QByteArray &profile, QSize size, QPixmap &pixmap)
+{
+    if (profile.isEmpty()) return false;
+
+    QString key = QString("%1:%2:%3x%4").arg(qHash(profile)).arg(profile.size()).arg(size.width()).arg(size.height());
+    QPixmap *found = pixmaps.object(key);
+    if (found) {
+        profileStats.hit();
+        pixmap = *found;
+        return true;
+    }
+    if (pending.contains(key)) return false;
+    profileStats.miss();
+
+    // the colors are read here, they are not safe off the GUI thread
+    pending.insert(key);
+    pool.start(new RideProfileRenderer(this, key, profile, size,
+                                         GColor(CPOWER), GColor(CHEARTRATE), GColor(CALTITUDE)));
+    return false;
+}
+
+void
+RideProfileCache::done(QString key, QImage image)
+{
+    if (!pending.remove(key)) return; // cleared whilst drawing
+
+    // the least recently drawn go when over budget
+    pixmaps.setMaxCost(profileStats.budget());
+    pixmaps.insert(key, new QPixmap(QPixmap::fromImage(image)), image.byteCount());
+    profileStats.setUsage(this, pixmaps.totalCost(), pixmaps.count());
+
+    emit rendered();
+}
+
+void
+RideProfileCache::clear()
+{
+    pixmaps.clear();
+    pending.clear();
+    profileStats.setUsage(this, 0, 0);
+}
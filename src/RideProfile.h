@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideProfile_h
+#define _GC_RideProfile_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QCache>
+#include <QSet>
+#include <QImage>
+#include <QPixmap>
+#include <QColor>
+#include <QThreadPool>
+
+class RideFile;
+
+//
+// A mini profile of a ride, power, heartrate and altitude averaged into
+// a couple of hundred points and stored a byte each. It is computed by
+// the metric refresh whenever the samples change and kept in the metrics
+// table, so the navigator can draw a sparkline for every ride without
+// opening any of them.
+//
+class RideProfile
+{
+    public:
+        static const int points = 200;
+
+        // the encoded profile, empty if the ride has none of the series
+        static QByteArray summarise(const RideFile *ride);
+
+        // draw it, safe to call off the GUI thread
+        static QImage render(const QByteArray &profile, QSize size,
+                             QColor power, QColor heartrate, QColor altitude);
+};
+
+//
+// The sparklines the navigator has drawn, they are rendered on a
+// thread pool and rendered() is emitted as each one arrives
+// so the view can repaint.
+//
+class RideProfileCache : public QObject
+{
+    Q_OBJECT
+    G_OBJECT
+
+    public:
+        RideProfileCache(QObject *parent = 0);
+        ~RideProfileCache();
+
+        // true with the pixmap when it has been drawn, otherwise it is
+        // queued for drawing and false is returned until it is ready
+        bool pixmap(const QByteArray &profile, QSize size, QPixmap &pixmap);
+
+    signals:
+        void rendered();
+
+    public slots:
+        void clear(); // when the colors change
+
+    private slots:
+        void done(QString key, QImage image);
+
+    private:
+        QCache<QString, QPixmap> pixmaps;
+        QSet<QString> pending;
+        QThreadPool pool; // our own, so we only wait for ours
+
+};
+
+#endif // _GC_RideProfile_h
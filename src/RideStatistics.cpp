@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideStatistics.h"
+#include "RideFile.h"
+#include <string.h>
+
+RideStatistics::RideStatistics(const RideFile *ride) : ride(ride),
+    haveSums(false), haveWeighted(false), haveRolling(false)
+{
+    memset(haveSeries, 0, sizeof(haveSeries));
+}
+
+const RideStatistics::Sums &
+RideStatistics::sums() const
+{
+    QMutexLocker locker(&lock);
+    if (haveSums) return sums_;
+
+    Sums &s = sums_;
+    memset(&s, 0, sizeof(s));
+
+    int halfway = ride->dataPoints().count() / 2;
+    int index = 0;
+    foreach(const RideFilePoint *point, ride->dataPoints()) {
+
+        if (point->watts >= 0) {
+            s.watts += point->watts;
+            s.wattsCount++;
+        }
+        if (point->watts > 0) {
+            s.nonZeroWatts += point->watts;
+            s.nonZeroCount++;
+        }
+        if (point->apower >= 0) {
+            s.apower += point->apower;
+            s.apowerCount++;
+        }
+        if (point->hr > 0) {
+            s.hr += point->hr;
+            s.hrCount++;
+
+            if (index < halfway) {
+                s.firstHalfWatts += point->watts;
+                s.firstHalfHr += point->hr;
+                s.firstHalfCount++;
+            } else {
+                s.secondHalfWatts += point->watts;
+                s.secondHalfHr += point->hr;
+                s.secondHalfCount++;
+            }
+        }
+        if (point->cad > 0) {
+            s.cad += point->cad;
+            s.cadCount++;
+        }
+        if (point->watts >= s.maxWatts) s.maxWatts = point->watts;
+        if (point->hr >= s.maxHr) s.maxHr = point->hr;
+        if (point->kph > 0 || point->cad > 0) s.movingSamples++;
+
+        index++;
+    }
+
+    haveSums = true;
+    return sums_;
+}
+
+const QVector<double> &
+RideStatistics::weighted25s() const
+{
+    QMutexLocker locker(&lock);
+    if (haveWeighted) return weighted_;
+
+    static const double EPSILON = 0.1;
+    static const double NEGLIGIBLE = 0.1;
+
+    double secsDelta = ride->recIntSecs();
+    double sampsPerWindow = 25.0 / secsDelta;
+    double attenuation = sampsPerWindow / (sampsPerWindow + secsDelta);
+    double sampleWeight = secsDelta / (sampsPerWindow + secsDelta);
+
+    double lastSecs = 0.0;
+    double weighted = 0.0;
+
+    weighted_.clear();
+    weighted_.reserve(ride->dataPoints().count());
+    foreach(const RideFilePoint *point, ride->dataPoints()) {
+        while ((weighted > NEGLIGIBLE)
+               && (point->secs > lastSecs + secsDelta + EPSILON)) {
+            weighted *= attenuation;
+            lastSecs += secsDelta;
+            weighted_ << weighted;
+        }
+        weighted *= attenuation;
+        weighted += sampleWeight * point->watts;
+        lastSecs = point->secs;
+        weighted_ << weighted;
+    }
+
+    haveWeighted = true;
+    return weighted_;
+}
+
+const QVector<double> &
+RideStatistics::rolling30s() const
+{
+    QMutexLocker locker(&lock);
+    if (haveRolling) return rolling_;
+
+    rolling_.clear();
+    int rollingwindowsize = ride->recIntSecs() ? 30 / ride->recIntSecs() : 0;
+
+    // no point doing a rolling average if the
+    // sample rate is greater than the rolling average
+    // window!!
+    if (rollingwindowsize > 1) {
+
+        QVector<double> rolling(rollingwindowsize);
+        int index = 0;
+        double sum = 0;
+
+        rolling_.resize(ride->dataPoints().count());
+        for (int i=0; i<ride->dataPoints().count(); i++) {
+
+            double watts = ride->dataPoints()[i]->watts;
+            sum += watts;
+            sum -= rolling[index];
+            rolling[index] = watts;
+
+            rolling_[i] = sum/rollingwindowsize;
+
+            // move index on/round
+            index = (index >= rollingwindowsize-1) ? 0 : index+1;
+        }
+    }
+
+    haveRolling = true;
+    return rolling_;
+}
+
+const QVector<double> &
+RideStatistics::series(RideFile::SeriesType series) const
+{
+    if (series < 0 || series >= RideFile::none) return series_[RideFile::none];
+
+    QMutexLocker locker(&lock);
+    if (haveSeries[series]) return series_[series];
+
+    QVector<double> &column = series_[series];
+    column.resize(ride->dataPoints().count());
+    for (int i=0; i<column.count(); i++) column[i] = ride->dataPoints()[i]->value(series);
+
+    haveSeries[series] = true;
+    return column;
+}
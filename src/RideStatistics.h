@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideStatistics_h
+#define _GC_RideStatistics_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QMutex>
+
+#include "RideFile.h"
+
+// The sums, counts and smoothed series that many metrics would otherwise
+// each work out with their own pass over the ride. computeMetrics makes
+// one for the ride and hands it to every metric it computes; each part is
+// only worked out the first time a metric asks for it. Safe to use from
+// the threads computeMetrics runs metrics on.
+class RideStatistics
+{
+    public:
+
+        RideStatistics(const RideFile *ride);
+        const RideFile *rideFile() const { return ride; }
+
+        struct Sums {
+            double watts, wattsCount;           // watts >= 0
+            double nonZeroWatts, nonZeroCount;  // watts > 0
+            double apower, apowerCount;         // apower >= 0
+            double hr, hrCount;                 // hr > 0
+            double cad, cadCount;               // cad > 0
+            double maxWatts, maxHr;
+            double movingSamples;               // kph > 0 or cad > 0
+
+            // power and hr where hr > 0 in each half of the ride
+            double firstHalfWatts, firstHalfHr, firstHalfCount;
+            double secondHalfWatts, secondHalfHr, secondHalfCount;
+        };
+        const Sums &sums() const;
+
+        // power smoothed with a 25 second exponentially weighted average
+        // at each sample, with gaps in recording decayed through at the
+        // recording interval (Skiba xPower)
+        const QVector<double> &weighted25s() const;
+
+        // power averaged over the last 30 seconds at each sample (Coggan NP),
+        // empty if the recording interval is longer than that
+        const QVector<double> &rolling30s() const;
+
+        // one series of the samples as a column, for the formula metrics
+        // which work a column at a time; none gives an empty column
+        const QVector<double> &series(RideFile::SeriesType series) const;
+
+    private:
+
+        const RideFile *ride;
+        mutable QMutex lock;
+
+        mutable bool haveSums, haveWeighted, haveRolling;
+        mutable Sums sums_;
+        mutable QVector<double> weighted_, rolling_;
+        mutable bool haveSeries[RideFile::none];
+        mutable QVector<double> series_[RideFile::none + 1];
+};
+
+#endif // _GC_RideStatistics_h
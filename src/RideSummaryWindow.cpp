@@ -84,15 +84,16 @@ RideSummaryWindow::RideSummaryWindow(Context *context, bool ridesummary) :
     if (ridesummary) {
 
         connect(this, SIGNAL(rideItemChanged(RideItem*)), this, SLOT(rideItemChanged()));
-        connect(context->athlete, SIGNAL(zonesChanged()), this, SLOT(refresh()));
-        connect(context, SIGNAL(intervalsChanged()), this, SLOT(refresh()));
+        connect(context->athlete, SIGNAL(zonesChanged()), this, SLOT(invalidate()));
+        connect(context, SIGNAL(intervalsChanged()), this, SLOT(invalidate()));
+            connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(rideDeleted(RideItem*)));
 
     } else {
 
         connect(this, SIGNAL(dateRangeChanged(DateRange)), this, SLOT(dateRangeChanged(DateRange)));
-        connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(refresh()));
-        connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(refresh()));
-        connect(context, SIGNAL(filterChanged()), this, SLOT(refresh()));
+        connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(invalidate()));
+        connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(invalidate()));
+        connect(context, SIGNAL(filterChanged()), this, SLOT(invalidate()));
 
         // date settings
         connect(dateSetting, SIGNAL(useCustomRange(DateRange)), this, SLOT(useCustomRange(DateRange)));
@@ -100,6 +101,11 @@ RideSummaryWindow::RideSummaryWindow(Context *context, bool ridesummary) :
         connect(dateSetting, SIGNAL(useStandardRange()), this, SLOT(useStandardRange()));
 
     }
+
+    // metrics recomputed or units changed, the summaries we kept are stale
+    connect(context->athlete->metricDB, SIGNAL(dataChanged()), this, SLOT(invalidate()));
+    connect(context, SIGNAL(configChanged()), this, SLOT(invalidate()));
+
     setChartLayout(vlayout);
 }
 
@@ -109,7 +115,7 @@ RideSummaryWindow::clearFilter()
 {
     filters.clear();
     filtered = false;
-    refresh();
+    invalidate();
 }
 
 void
@@ -117,7 +123,7 @@ RideSummaryWindow::setFilter(QStringList list)
 {
     filters = list;
     filtered = true;
-    refresh();
+    invalidate();
 }
 #endif
 
@@ -149,6 +155,21 @@ RideSummaryWindow::rideItemChanged()
 void
 RideSummaryWindow::metadataChanged()
 {
+    summaries.remove(myRideItem);
+    refresh();
+}
+
+void
+RideSummaryWindow::rideDeleted(RideItem *item)
+{
+    summaries.remove(item);
+}
+
+void
+RideSummaryWindow::invalidate()
+{
+    summaries.clear();
+    rangeSummary = "";
     refresh();
 }
 
@@ -159,6 +180,7 @@ RideSummaryWindow::refresh()
 
     // if we're summarising a ride but have no ride to summarise
     if (ridesummary && !myRideItem) {
+        shown = "";
 	    rideSummary->page()->mainFrame()->setHtml("");
         return;
     }
@@ -175,7 +197,25 @@ RideSummaryWindow::refresh()
                     myDateRange.to.toString("dddd MMMM d yyyy"));
         }
     }
-    rideSummary->page()->mainFrame()->setHtml(htmlSummary());
+
+    // the page is only generated once for each ride or range shown, and
+    // only set when it differs from what is already being displayed
+    QString html;
+    if (ridesummary && myRideItem->isDirty()) {
+        html = htmlSummary(); // being edited, metrics computed afresh
+    } else if (ridesummary) {
+        QHash<RideItem*, QString>::const_iterator it = summaries.constFind(myRideItem);
+        if (it == summaries.constEnd()) it = summaries.insert(myRideItem, htmlSummary());
+        html = it.value();
+    } else {
+        if (rangeSummary == "") rangeSummary = htmlSummary();
+        html = rangeSummary;
+    }
+
+    if (html != shown) {
+        shown = html;
+        rideSummary->page()->mainFrame()->setHtml(html);
+    }
 }
 
 
@@ -467,29 +507,16 @@ RideSummaryWindow::htmlSummary() const
             summary += "cellspacing=0 border=0>";
             bool even = false;
             foreach (RideFileInterval interval, ride->intervals()) {
-                RideFile f(ride->startTime(), ride->recIntSecs());
-                f.context = context; // hack, until we refactor athlete and mainwindow
-                for (int i = ride->intervalBegin(interval); i>= 0 &&i < ride->dataPoints().size(); ++i) {
-                    const RideFilePoint *p = ride->dataPoints()[i];
-                    if (p->secs > interval.stop)
-                        break;
-                    f.appendPoint(p->secs, p->cad, p->hr, p->km, p->kph, p->nm,
-                                p->watts, p->alt, p->lon, p->lat, p->headwind,
-                                p->slope, p->temp, p->lrbalance, 0);
-
-                    // derived data
-                    RideFilePoint *l = f.dataPoints().last();
-                    l->np = p->np;
-                    l->xp = p->xp;
-                    l->apower = p->apower;
-                }
-                if (f.dataPoints().size() == 0) {
+                int start = ride->intervalBegin(interval), stop = start;
+                while (stop >= 0 && stop < ride->dataPoints().size() && ride->dataPoints()[stop]->secs <= interval.stop)
+                    stop++;
+                if (start < 0 || stop == start) {
                     // Interval empty, do not compute any metrics
                     continue;
                 }
 
                 QHash<QString,RideMetricPtr> metrics =
-                    RideMetric::computeMetrics(context, &f, context->athlete->zones(), context->athlete->hrZones(), intervalMetrics);
+                    RideMetric::computeIntervalMetrics(context, ride, start, stop-1, intervalMetrics);
                 if (firstRow) {
                     summary += "<tr>";
                     summary += "<td align=\"center\" valign=\"bottom\">Interval Name</td>";
@@ -545,7 +572,7 @@ RideSummaryWindow::htmlSummary() const
 
             foreach (SummaryMetrics activity, data) {
                 if (filtered && !filters.contains(activity.getFileName())) continue;
-                if (context->isfiltered && !context->filters.contains(activity.getFileName())) continue;
+                if (context->isfiltered && !context->filterSet.contains(activity.getFileName())) continue;
                 activities++;
             }
 
@@ -622,7 +649,7 @@ RideSummaryWindow::htmlSummary() const
 
             // apply the filter if there is one active
             if (filtered && !filters.contains(rideMetrics.getFileName())) continue;
-            if (context->isfiltered && !context->filters.contains(rideMetrics.getFileName())) continue;
+            if (context->isfiltered && !context->filterSet.contains(rideMetrics.getFileName())) continue;
 
             if (even) summary += "<tr>";
             else {
@@ -721,5 +748,6 @@ void RideSummaryWindow::dateRangeChanged(DateRange dr)
 
     } else data = context->athlete->metricDB->getAllMetricsFor(myDateRange);
 
+    rangeSummary = "";
     refresh();
 }
@@ -84,6 +84,8 @@ class RideSummaryWindow : public GcChartWindow
         void dateRangeChanged(DateRange);
         void rideItemChanged();
         void metadataChanged();
+        void rideDeleted(RideItem*);
+        void invalidate(); // drop cached summaries and refresh
 
         // date settings
         void useCustomRange(DateRange);
@@ -106,6 +108,10 @@ class RideSummaryWindow : public GcChartWindow
         bool ridesummary; // do we summarise ride or daterange?
 
         QList<SummaryMetrics> data; // when in date range mode
+
+        QHash<RideItem*, QString> summaries; // html for rides already summarised
+        QString rangeSummary; // html for the current date range
+        QString shown; // html currently in the page
         DateRange current;
 
         DateSettingsEdit *dateSetting;
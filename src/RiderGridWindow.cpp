@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RiderGridWindow.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "Units.h"
+
+enum { RIDER=0, POWER, HEARTRATE, CADENCE, SPEED, DISTANCE, INTENSITY, COLUMNS };
+
+RiderGridWindow::RiderGridWindow(Context *context) :
+    GcWindow(context), context(context)
+{
+    setContentsMargins(0,0,0,0);
+    setInstanceName("Rider Grid");
+    setControls(NULL);
+    setProperty("color", GColor(CRIDEPLOTBACKGROUND));
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setSpacing(0);
+    layout->setContentsMargins(2,2,2,2);
+
+    grid = new QTableWidget(0, COLUMNS, this);
+    grid->setHorizontalHeaderLabels(QStringList() << tr("Rider") << tr("Power") << tr("Heartrate")
+                                                  << tr("Cadence") << tr("Speed") << tr("Distance")
+                                                  << tr("Intensity"));
+    grid->verticalHeader()->hide();
+    grid->horizontalHeader()->setStretchLastSection(true);
+    grid->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    grid->setSelectionMode(QAbstractItemView::NoSelection);
+    layout->addWidget(grid);
+
+    connect(context, SIGNAL(ridersUpdate()), this, SLOT(ridersUpdate()));
+}
+
+void
+RiderGridWindow::setRows()
+{
+    const QList<TrainRider*> &riders = context->currentRiders();
+
+    grid->setRowCount(riders.count());
+    intensities.clear();
+    shown = riders;
+
+    for (int row=0; row < riders.count(); row++) {
+
+        grid->setItem(row, RIDER, new QTableWidgetItem(riders[row]->name));
+        for (int column=POWER; column < INTENSITY; column++) {
+            QTableWidgetItem *item = new QTableWidgetItem;
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            grid->setItem(row, column, item);
+        }
+
+        QSpinBox *intensity = new QSpinBox(this);
+        intensity->setRange(50, 150);
+        intensity->setSuffix("%");
+        intensity->setValue(riders[row]->intensity);
+        intensity->setProperty("row", row);
+        connect(intensity, SIGNAL(valueChanged(int)), this, SLOT(intensityChanged(int)));
+        grid->setCellWidget(row, INTENSITY, intensity);
+        intensities << intensity;
+    }
+}
+
+void
+RiderGridWindow::setValue(int row, int column, double value, int decimals)
+{
+    grid->item(row, column)->setText(QString("%1").arg(value, 0, 'f', decimals));
+}
+
+void
+RiderGridWindow::ridersUpdate()
+{
+    if (!amVisible()) return;
+
+    const QList<TrainRider*> &riders = context->currentRiders();
+
+    // new session, new riders
+    if (riders != shown) setRows();
+
+    bool metric = context->athlete->useMetricUnits;
+
+    for (int row=0; row < riders.count(); row++) {
+
+        const RealtimeData &rtData = riders[row]->rtData;
+        setValue(row, POWER, rtData.getWatts(), 0);
+        setValue(row, HEARTRATE, rtData.getHr(), 0);
+        setValue(row, CADENCE, rtData.getCadence(), 0);
+        setValue(row, SPEED, rtData.getSpeed() * (metric ? 1.0 : MILES_PER_KM), 1);
+        setValue(row, DISTANCE, riders[row]->distance * (metric ? 1.0 : MILES_PER_KM), 2);
+    }
+}
+
+void
+RiderGridWindow::intensityChanged(int value)
+{
+    int row = sender()->property("row").toInt();
+    const QList<TrainRider*> &riders = context->currentRiders();
+
+    // picked up on the next load update
+    if (row < riders.count()) riders[row]->intensity = value;
+}
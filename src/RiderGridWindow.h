@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RiderGridWindow_h
+#define _GC_RiderGridWindow_h 1
+#include "GoldenCheetah.h"
+
+#include <QtGui>
+#include <QObject> // for Q_PROPERTY
+
+#include "Context.h"
+#include "TrainRider.h"
+
+#include "Settings.h"
+#include "Colors.h"
+
+// compact view of every rider in a multi-rider session, one row each
+// with their intensity adjustable as the workout goes
+class RiderGridWindow : public GcWindow
+{
+    Q_OBJECT
+    G_OBJECT
+
+    public:
+
+        RiderGridWindow(Context *context);
+
+   public slots:
+
+        // trap signals
+        void ridersUpdate();
+        void intensityChanged(int);
+
+    private:
+
+        Context *context;
+        QTableWidget *grid;
+        QList<QSpinBox*> intensities;
+        QList<TrainRider*> shown;   // riders the rows are for
+
+        void setRows();
+        void setValue(int row, int column, double value, int decimals);
+};
+
+#endif // _GC_RiderGridWindow_h
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RollingAverage.h"
+
+static const int maxresults = 4; // window sizes we keep results for
+
+RollingAverage::RollingAverage(const QVector<double> &time, int count)
+    : time(time), samples(qMin(count, time.count())), current(NULL)
+{
+}
+
+int
+RollingAverage::addSeries(const QVector<double> &values)
+{
+    Series add;
+    add.values = values;
+    add.hasMissing = false;
+    add.missing = 0;
+    series << add;
+
+    // any results we have are now incomplete
+    qDeleteAll(results);
+    results.clear();
+    current = NULL;
+
+    return series.count() - 1;
+}
+
+int
+RollingAverage::addSeries(const QVector<double> &values, double missing)
+{
+    int index = addSeries(values);
+    series[index].hasMissing = true;
+    series[index].missing = missing;
+    return index;
+}
+
+void
+RollingAverage::compute(int window, int seconds)
+{
+    // already got it?
+    for (int r=0; r<results.count(); r++) {
+        if (results[r]->window == window && results[r]->seconds == seconds) {
+            current = results[r];
+            results.move(r, 0);
+            return;
+        }
+    }
+
+    Result *result = new Result;
+    result->window = window;
+    result->seconds = seconds;
+    result->counts.fill(0, seconds + 1);
+    result->means.resize(series.count());
+    result->lasts.resize(series.count());
+    for (int s=0; s<series.count(); s++) {
+        result->means[s].fill(0.0, seconds + 1);
+        result->lasts[s].fill(0.0, seconds + 1);
+    }
+
+    // the window is the samples from head to tail, with the values
+    // as they were added so missing values are treated consistently
+    int n = series.count();
+    QVector<double> totals(n, 0.0), lasts(n, 0.0);
+    QVector<double> added(samples * n);
+    int head = 0, tail = 0;
+
+    for (int secs = window; secs <= seconds; ++secs) {
+
+        // add the samples up to now
+        while (tail < samples && time[tail] <= secs) {
+            for (int s=0; s<n; s++) {
+                const Series &from = series.at(s);
+                double value = tail < from.values.count() ? from.values[tail] : 0;
+
+                if (from.hasMissing && value == from.missing)
+                    value = (tail > 0 && tail > head) ? added[(tail-1)*n + s] : 0.0;
+
+                added[tail*n + s] = value;
+                totals[s] += value;
+                lasts[s] = tail < from.values.count() ? from.values[tail] : 0;
+            }
+            tail++;
+        }
+
+        // drop those that have fallen out of the window
+        while (head < tail && time[head] < secs - window) {
+            for (int s=0; s<n; s++) totals[s] -= added[head*n + s];
+            head++;
+        }
+
+        int count = tail - head;
+        result->counts[secs] = count;
+        for (int s=0; s<n; s++) {
+            if (count) result->means[s][secs] = totals[s] / count;
+            result->lasts[s][secs] = lasts[s];
+        }
+    }
+
+    // keep it, ditching the least recently used
+    results.prepend(result);
+    while (results.count() > maxresults) delete results.takeLast();
+    current = result;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RollingAverage_h
+#define _GC_RollingAverage_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QList>
+
+// Time windowed rolling averages of several series that share the same
+// timestamps, as used by the ride plots when smoothing. For each whole
+// second of the ride the samples timestamped in [secs - window, secs]
+// are averaged. The window is slid once for all the series together,
+// with running sums, so it is O(n) regardless of the window size.
+//
+// The results are kept for the last few window sizes, so going back to
+// a smoothing value already seen doesn't recompute anything.
+class RollingAverage
+{
+    public:
+
+        // the timestamps (in seconds) of the samples, count may be less
+        // than the size of the series to only use the first count samples
+        RollingAverage(const QVector<double> &time, int count);
+
+        // add a series to average, returns its index. If missing is set
+        // then samples with that value are replaced by the last sample
+        // added to the window, or 0 if the window was empty
+        int addSeries(const QVector<double> &values);
+        int addSeries(const QVector<double> &values, double missing);
+
+        // the averages for each second 0 ... seconds, seconds before the
+        // window is full are 0 and count() is 0 when the window is empty
+        void compute(int window, int seconds);
+        const QVector<double> &mean(int series) const { return current->means[series]; }
+        const QVector<int> &count() const { return current->counts; }
+
+        // the value of the last sample at or before each second
+        const QVector<double> &last(int series) const { return current->lasts[series]; }
+
+    private:
+
+        struct Series {
+            QVector<double> values;
+            bool hasMissing;
+            double missing;
+        };
+
+        struct Result {
+            int window, seconds;
+            QVector<QVector<double> > means, lasts;
+            QVector<int> counts;
+        };
+
+        QVector<double> time;
+        int samples;
+        QList<Series> series;
+
+        QList<Result*> results; // most recently used first
+        Result *current;
+};
+
+#endif // _GC_RollingAverage_h
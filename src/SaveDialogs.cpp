@@ -24,6 +24,7 @@
 #include "RideFileCommand.h"
 #include "Settings.h"
 #include "SaveDialogs.h"
+#include "RideFileSaver.h"
 
 //----------------------------------------------------------------------
 // Utility functions to get and set WARN on CONVERT application setting
@@ -121,8 +122,13 @@ MainWindow::saveSilent(RideItem *rideItem)
     QFile   savedFile;
     bool    convert;
 
+    // native format is .json unless binary has been chosen, rides
+    // in the other native format are migrated as they are saved
+    QString native = appsettings->value(this, GC_NATIVE_FORMAT, "json").toString().toLower();
+    if (native != "gcb") native = "json";
+
     // Do we need to convert the file type?
-    if (currentType != "JSON") convert = true;
+    if (currentType != native.toUpper()) convert = true;
     else convert = false;
 
     // Has the date/time changed?
@@ -140,28 +146,13 @@ MainWindow::saveSilent(RideItem *rideItem)
     QFile notesFile(currentFI.path() + QDir::separator() + currentFI.baseName() + ".notes");
     if (notesFile.exists()) notesFile.remove();
 
-    // When datetime changes we need to update
-    // the filename & rename/delete old file
-    // we also need to preserve the notes file
+    // When datetime changes we need to update the filename, the
+    // file it came from is removed (or kept as a backup if it was
+    // converted) once the save has been written, see rideSaved()
     if (currentFI.baseName() != targetnosuffix) {
-
-        // rename as backup current if converting, or just delete it if its already .gc
-        // unlink previous .bak if it is already there
-        if (convert) {
-            QFile::remove(currentFile.fileName()+".bak"); // ignore errors if not there
-            currentFile.rename(currentFile.fileName(), currentFile.fileName() + ".bak");
-        } else currentFile.remove();
-        convert = false; // we just did it already!
-
-        // set the new filename & Start time everywhere
-        currentFile.setFileName(rideItem->path + QDir::separator() + targetnosuffix + ".json");
-        rideItem->setFileName(QFileInfo(currentFile).path(), QFileInfo(currentFile).fileName());
-    }
-
-    // set target filename
-    if (convert) {
-        // rename the source
-        savedFile.setFileName(currentFI.path() + QDir::separator() + currentFI.baseName() + ".json");
+        savedFile.setFileName(rideItem->path + QDir::separator() + targetnosuffix + "." + native);
+    } else if (convert) {
+        savedFile.setFileName(currentFI.path() + QDir::separator() + currentFI.baseName() + "." + native);
     } else {
         savedFile.setFileName(currentFile.fileName());
     }
@@ -173,24 +164,69 @@ MainWindow::saveSilent(RideItem *rideItem)
     log += '\n' + rideItem->ride()->command->changeLog();
     rideItem->ride()->setTag("Change History", log);
 
-    // save in GC format
-    JsonFileReader reader;
-    reader.writeRideFile(context, rideItem->ride(), savedFile);
+    // one save at a time for each ride, they share the temporary file
+    waitForSaves(rideItem);
+
+    // written on a thread whilst the ride is shown in italics, the
+    // metrics are refreshed in the background once it is marked clean
+    RideFileSaver *saver = new RideFileSaver(context, rideItem, savedFile.fileName(), native, currentFile.fileName());
+    savers.insert(rideItem, saver);
+    connect(saver, SIGNAL(finished()), this, SLOT(rideSaved()));
+    rideItem->setSaving(true);
+    saver->start();
+}
+
+//----------------------------------------------------------------------
+// A save started by saveSilent has been written (or failed)
+//----------------------------------------------------------------------
+void
+MainWindow::rideSaved()
+{
+    RideFileSaver *saver = qobject_cast<RideFileSaver*>(sender());
+    if (saver && savers.value(saver->rideItem()) == saver) finishSave(saver);
+    // otherwise waitForSaves already finished it
+}
 
-    // rename the file and update the rideItem list to reflect the change
-    if (convert) {
+void
+MainWindow::finishSave(RideFileSaver *saver)
+{
+    RideItem *rideItem = saver->rideItem();
+    savers.remove(rideItem);
+    rideItem->setSaving(false);
+
+    if (!saver->succeeded()) {
+        QMessageBox::warning(this, tr("Save Activity"), tr("Could not save %1").arg(saver->fileName()));
+        saver->deleteLater();
+        return;
+    }
 
-        // rename on disk
-        QFile::remove(currentFile.fileName()+".bak"); // ignore errors if not there
-        currentFile.rename(currentFile.fileName(), currentFile.fileName() + ".bak");
+    // the file it came from, keep a backup if the format changed
+    if (saver->previous() != saver->fileName()) {
+        if (QFileInfo(saver->previous()).suffix() != QFileInfo(saver->fileName()).suffix()) {
+            QFile::remove(saver->previous() + ".bak"); // ignore errors if not there
+            QFile::rename(saver->previous(), saver->previous() + ".bak");
+        } else QFile::remove(saver->previous());
 
-        // rename in memory
-        rideItem->setFileName(QFileInfo(savedFile).path(), QFileInfo(savedFile).fileName());
+        QFileInfo saved(saver->fileName());
+        rideItem->setFileName(saved.path(), saved.fileName());
     }
 
+    // mark clean as we have now saved the data, unless
+    // it was edited again whilst it was being written
+    if (rideItem->revision() == saver->revision()) rideItem->ride()->emitSaved();
 
-    // mark clean as we have now saved the data
-    rideItem->ride()->emitSaved();
+    saver->deleteLater();
+}
+
+// finish any saves still being written, for one ride or all of them
+void
+MainWindow::waitForSaves(RideItem *rideItem)
+{
+    foreach (RideFileSaver *saver, savers.values()) {
+        if (rideItem && saver->rideItem() != rideItem) continue;
+        saver->wait();
+        finishSave(saver);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ScatterDensity.h"
+#include <qwt_color_map.h>
+#include <qnumeric.h>
+#include <math.h>
+
+ScatterDensityData::ScatterDensityData(const double *x, const double *y, int n, int bins) :
+    xbins(bins), ybins(bins), minX(0), minY(0), xwidth(1), ywidth(1)
+{
+    double maxX = 0, maxY = 0;
+
+    // bounds of the data set
+    for (int i=0; i<n; i++) {
+        if (i == 0 || x[i] < minX) minX = x[i];
+        if (i == 0 || x[i] > maxX) maxX = x[i];
+        if (i == 0 || y[i] < minY) minY = y[i];
+        if (i == 0 || y[i] > maxY) maxY = y[i];
+    }
+    if (maxX > minX) xwidth = (maxX - minX) / xbins;
+    if (maxY > minY) ywidth = (maxY - minY) / ybins;
+
+    setInterval(Qt::XAxis, QwtInterval(minX, minX + xwidth * xbins));
+    setInterval(Qt::YAxis, QwtInterval(minY, minY + ywidth * ybins));
+
+    // count 'em
+    counts.fill(0, xbins * ybins);
+    int maxCount = 0;
+    for (int i=0; i<n; i++) {
+        int bx = qMin(int((x[i] - minX) / xwidth), xbins-1);
+        int by = qMin(int((y[i] - minY) / ywidth), ybins-1);
+        int &count = counts[by * xbins + bx];
+        if (++count > maxCount) maxCount = count;
+    }
+
+    setInterval(Qt::ZAxis, QwtInterval(0, log(1.0 + maxCount)));
+}
+
+double
+ScatterDensityData::value(double x, double y) const
+{
+    int bx = int(floor((x - minX) / xwidth));
+    int by = int(floor((y - minY) / ywidth));
+    if (bx < 0 || bx >= xbins || by < 0 || by >= ybins) return qQNaN();
+
+    int count = counts[by * xbins + bx];
+    return count ? log(1.0 + count) : qQNaN(); // empty cells are see thru
+}
+
+ScatterDensity::ScatterDensity(QColor color)
+{
+    setDisplayMode(QwtPlotSpectrogram::ImageMode, true);
+    setDisplayMode(QwtPlotSpectrogram::ContourMode, false);
+    setColorMap(new QwtAlphaColorMap(color));
+    setRenderThreadCount(0); // use as many as there are cores
+}
+
+void
+ScatterDensity::setSamples(const double *x, const double *y, int n)
+{
+    setData(new ScatterDensityData(x, y, n));
+}
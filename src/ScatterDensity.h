@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_ScatterDensity_h
+#define _GC_ScatterDensity_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QColor>
+#include <qwt_raster_data.h>
+#include <qwt_plot_spectrogram.h>
+
+//
+// Scatter plots of long rides paint a symbol per sample, which
+// gets slow past a few tens of thousands of them. Instead the samples
+// are counted into a 2d histogram and drawn as a raster, the shade of
+// each cell giving the number of samples that landed in it.
+//
+
+// the 2d histogram, values are log scaled counts so the shading isn't
+// dominated by the handful of cells a ride spends most of its time in
+class ScatterDensityData : public QwtRasterData
+{
+    public:
+        ScatterDensityData(const double *x, const double *y, int n, int bins = 200);
+
+        double value(double x, double y) const;
+
+    private:
+        int xbins, ybins;
+        double minX, minY, xwidth, ywidth;
+        QVector<int> counts;
+};
+
+class ScatterDensity : public QwtPlotSpectrogram
+{
+    public:
+        ScatterDensity(QColor color);
+
+        void setSamples(const double *x, const double *y, int n);
+
+        // above this many points draw a density rather than a curve
+        static bool wanted(int points) { return points > 20000; }
+};
+
+#endif // _GC_ScatterDensity_h
@@ -18,6 +18,7 @@
 
 #include "ScatterPlot.h"
 #include "ScatterWindow.h"
+#include "ScatterDensity.h"
 #include "IntervalItem.h"
 #include "Context.h"
 #include "Context.h"
@@ -153,6 +154,7 @@ ScatterPlot::ScatterPlot(Context *context) : context(context)
 {
     setInstanceName("2D Plot");
     all = NULL;
+    density = NULL;
     grid = NULL;
     canvas()->setFrameStyle(QFrame::NoFrame);
 
@@ -231,9 +233,19 @@ void ScatterPlot::setData (ScatterSettings *settings)
         all->detach();
 	    delete all;
     }
+    if (density) {
+        density->detach();
+        delete density;
+        density = NULL;
+    }
 
-    // setup the framing curve
-    if (settings->frame) {
+    // setup the framing curve, as a density when there are too many to paint
+    if (settings->frame && ScatterDensity::wanted(points)) {
+        all = NULL;
+        density = new ScatterDensity(GColor(CPLOTSYMBOL));
+        density->setSamples(x.constData(), y.constData(), points);
+        density->attach(this);
+    } else if (settings->frame) {
         all = new QwtPlotCurve();
         all->setSymbol(new QwtSymbol(sym));
         all->setStyle(QwtPlotCurve::Dots);
@@ -32,6 +32,8 @@
 #include <qwt_plot_curve.h>
 #include <qwt_symbol.h>
 
+class ScatterDensity;
+
 #define MODEL_NONE          0
 #define MODEL_POWER         1
 #define MODEL_CADENCE       2
@@ -84,6 +86,7 @@ class ScatterPlot : public QwtPlot
         QList <QwtPlotCurve *> intervalCurves; // each curve on plot
 
         QwtPlotCurve *all;
+        ScatterDensity *density;
         QwtPlotGrid *grid;
 
     private:
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Segments.h"
+#include "IntervalDetector.h"
+#include "DBAccess.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "RideFile.h"
+
+#include <math.h>
+#include <QSet>
+#include <QFile>
+#include <QObject>
+
+const int Segments::precision = 6;
+const double Segments::tolerance = 25;
+
+static const double metresPerDegree = 111320; // of latitude
+
+// flat earth is fine over the distances we compare
+static double distance(double lat1, double lon1, double lat2, double lon2)
+{
+    double y = (lat2 - lat1) * metresPerDegree;
+    double x = (lon2 - lon1) * metresPerDegree * cos((lat1 + lat2) / 2 * M_PI / 180);
+    return sqrt(x*x + y*y);
+}
+
+static double distance(const RideFilePoint *p, const GeoPoint &g)
+{
+    return distance(p->lat, p->lon, g.lat, g.lon);
+}
+
+static bool hasPosition(const RideFilePoint *p)
+{
+    return p->lat != 0 || p->lon != 0;
+}
+
+QString
+Segments::geohash(double lat, double lon, int precision)
+{
+    static const char base32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+    double latRange[2] = { -90, 90 }, lonRange[2] = { -180, 180 };
+
+    QString hash;
+    bool even = true; // longitude first
+    int bit = 0, ch = 0;
+    while (hash.length() < precision) {
+        double *range = even ? lonRange : latRange;
+        double value = even ? lon : lat;
+        double mid = (range[0] + range[1]) / 2;
+
+        ch <<= 1;
+        if (value >= mid) {
+            ch |= 1;
+            range[0] = mid;
+        } else range[1] = mid;
+
+        even = !even;
+        if (++bit == 5) {
+            hash += base32[ch];
+            bit = ch = 0;
+        }
+    }
+    return hash;
+}
+
+QVector<GeoPoint>
+Segments::simplify(const RideFile *ride, double metres, double start, double stop)
+{
+    QVector<GeoPoint> track;
+    const RideFilePoint *last = NULL;
+    foreach(const RideFilePoint *p, ride->dataPoints()) {
+        if (p->secs < start || (stop >= 0 && p->secs > stop) || !hasPosition(p)) continue;
+
+        if (track.isEmpty() || distance(p, track.last()) >= metres) track << GeoPoint(p->lat, p->lon);
+        last = p;
+    }
+
+    // always finish where it does
+    if (last && (track.last().lat != last->lat || track.last().lon != last->lon))
+        track << GeoPoint(last->lat, last->lon);
+    return track;
+}
+
+QStringList
+Segments::cells(const QVector<GeoPoint> &track)
+{
+    // the cells are much bigger than the tolerance, so those the corners of the
+    // square around each point are in are all those within tolerance of it
+    QSet<QString> cells;
+    foreach(const GeoPoint &g, track) {
+        double dlat = tolerance / metresPerDegree;
+        double dlon = tolerance / (metresPerDegree * qMax(0.01, cos(g.lat * M_PI / 180)));
+        cells << geohash(g.lat - dlat, g.lon - dlon, precision);
+        cells << geohash(g.lat - dlat, g.lon + dlon, precision);
+        cells << geohash(g.lat + dlat, g.lon - dlon, precision);
+        cells << geohash(g.lat + dlat, g.lon + dlon, precision);
+    }
+    return cells.toList();
+}
+
+// the closest to g of the run of points near it from i, i is left at the end of the run
+static int closest(const QVector<RideFilePoint*> &points, int &i, const GeoPoint &g)
+{
+    int best = i;
+    while (i+1 < points.count() && hasPosition(points[i+1]) && distance(points[i+1], g) < Segments::tolerance) {
+        i++;
+        if (distance(points[i], g) < distance(points[best], g)) best = i;
+    }
+    return best;
+}
+
+QList<SegmentEffort>
+Segments::match(const Segment &segment, const RideFile *ride)
+{
+    QList<SegmentEffort> efforts;
+    const QVector<GeoPoint> &route = segment.route;
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+    if (route.count() < 2 || !ride->areDataPresent()->lat) return efforts;
+
+    for (int i=0; i<points.count(); i++) {
+
+        // each time the ride comes past the start
+        if (!hasPosition(points[i]) || distance(points[i], route.first()) >= tolerance) continue;
+        int start = closest(points, i, route.first());
+
+        // follow the route a point at a time, it's lost if we
+        // go much further than the leg to get to the next one
+        int j = start;
+        bool lost = false;
+        for (int k=1; k<route.count() && !lost; k++) {
+            double budget = 1.5 * distance(route[k-1].lat, route[k-1].lon, route[k].lat, route[k].lon) + 2 * tolerance;
+            double along = 0;
+            while (!hasPosition(points[j]) || distance(points[j], route[k]) >= tolerance) {
+                if (j+1 == points.count()) {
+                    lost = true;
+                    break;
+                }
+                if (hasPosition(points[j]) && hasPosition(points[j+1]))
+                    along += distance(points[j]->lat, points[j]->lon, points[j+1]->lat, points[j+1]->lon);
+                j++;
+                if (along > budget) {
+                    lost = true;
+                    break;
+                }
+            }
+        }
+        if (lost) continue;
+        int stop = closest(points, j, route.last());
+
+        SegmentEffort effort;
+        effort.segment = segment.id;
+        effort.start = points[start]->secs;
+        effort.stop = points[stop]->secs;
+
+        double watts = 0, hr = 0;
+        int samples = 0;
+        for (int s=start; s<=stop; s++, samples++) {
+            watts += points[s]->watts;
+            hr += points[s]->hr;
+        }
+        effort.watts = watts / samples;
+        effort.hr = hr / samples;
+        efforts << effort;
+
+        i = j; // carry on from the end
+    }
+    return efforts;
+}
+
+// the effort covers most of the climb
+static bool covers(const SegmentEffort &effort, double start, double stop)
+{
+    double overlap = qMin(effort.stop, stop) - qMax(effort.start, start);
+    return overlap > (stop - start) / 2;
+}
+
+RideSegments
+Segments::find(const RideFile *ride, const QList<Segment> &known, const QList<DetectedInterval> &intervals)
+{
+    RideSegments found;
+    if (!ride || !ride->areDataPresent()->lat) return found;
+
+    // the index cells from the track at full resolution, near enough
+    found.cells = cells(simplify(ride, 5));
+    QSet<QString> through = found.cells.toSet();
+
+    // only those that start and finish in cells we passed through
+    foreach(const Segment &segment, known) {
+        if (segment.route.count() < 2 ||
+            !through.contains(geohash(segment.route.first().lat, segment.route.first().lon, precision)) ||
+            !through.contains(geohash(segment.route.last().lat, segment.route.last().lon, precision))) continue;
+        found.efforts << match(segment, ride);
+    }
+
+    // climbs we don't have yet become segments
+    foreach(const DetectedInterval &interval, intervals) {
+        if (interval.type != "climb") continue;
+
+        bool on = false;
+        foreach(const SegmentEffort &effort, found.efforts)
+            if (covers(effort, interval.start, interval.stop)) on = true;
+        if (on) continue;
+
+        Segment climb;
+        climb.automatic = true;
+        climb.name = QObject::tr("%1m climb, first ridden %2").arg(int(interval.value))
+                     .arg(ride->startTime().date().toString("d MMM yyyy"));
+        climb.route = simplify(ride, 50, interval.start, interval.stop);
+        if (climb.route.count() < 2) continue;
+
+        // the ride's effort on it, the segment id is set when it's added
+        SegmentEffort effort;
+        effort.start = interval.start;
+        effort.stop = interval.stop;
+        int samples = 0;
+        foreach(const RideFilePoint *p, ride->dataPoints()) {
+            if (p->secs < interval.start || p->secs > interval.stop) continue;
+            effort.watts += p->watts;
+            effort.hr += p->hr;
+            samples++;
+        }
+        if (samples) {
+            effort.watts /= samples;
+            effort.hr /= samples;
+        }
+
+        found.climbs << climb;
+        found.climbEfforts << effort;
+    }
+    return found;
+}
+
+void
+Segments::store(DBAccess *db, QString filename, const RideFile *ride, RideSegments &found, QList<Segment> &created)
+{
+    db->importTrack(filename, found.cells);
+
+    for (int i=0; i<found.climbs.count(); i++) {
+        const SegmentEffort &climb = found.climbEfforts[i];
+
+        // another ride in this refresh may have found it first
+        bool on = false;
+        foreach(const Segment &segment, created) {
+            foreach(const SegmentEffort &effort, match(segment, ride)) {
+                if (covers(effort, climb.start, climb.stop)) {
+                    found.efforts << effort;
+                    on = true;
+                }
+            }
+        }
+        if (on) continue;
+
+        Segment segment = found.climbs[i];
+        segment.id = db->addSegment(segment);
+        if (segment.id < 0) continue;
+
+        SegmentEffort effort = climb;
+        effort.segment = segment.id;
+        found.efforts << effort;
+        created << segment;
+    }
+    db->importEfforts(filename, found.efforts);
+}
+
+int
+Segments::backfill(Context *context, DBAccess *db, const Segment &segment, QString except)
+{
+    if (segment.id < 0 || segment.route.count() < 2) return 0;
+
+    const GeoPoint &first = segment.route.first(), &last = segment.route.last();
+    QStringList rides = db->getRidesThrough(geohash(first.lat, first.lon, precision),
+                                            geohash(last.lat, last.lon, precision));
+
+    // we only need the position and what we average
+    RideFileDataPresent wanted;
+    wanted.secs = wanted.lat = wanted.lon = wanted.watts = wanted.hr = true;
+
+    int count = 0;
+    foreach(QString filename, rides) {
+        if (filename == except) continue;
+
+        QStringList errors;
+        QFile file(context->athlete->home.absolutePath() + "/" + filename);
+        RideFile *ride = RideFileFactory::instance().openRideFileSeries(context, file, errors, wanted);
+        if (ride == NULL) continue;
+
+        QList<SegmentEffort> efforts = match(segment, ride);
+        delete ride;
+
+        db->importEfforts(filename, efforts, segment.id);
+        count += efforts.count();
+    }
+    return count;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_Segments_h
+#define _GC_Segments_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVector>
+
+class RideFile;
+class DBAccess;
+class Context;
+struct DetectedInterval;
+
+struct GeoPoint {
+    double lat, lon;
+
+    GeoPoint() : lat(0), lon(0) {}
+    GeoPoint(double lat, double lon) : lat(lat), lon(lon) {}
+};
+
+// a stretch of road or trail, defined by the user from an interval or
+// found automatically from a climb, that every ride with GPS is matched
+// against. The route is the track simplified to a point every 50m or so
+struct Segment {
+    int id;             // in the segments table, -1 until it is added
+    QString name;
+    bool automatic;     // from a detected climb
+    QVector<GeoPoint> route;
+
+    Segment() : id(-1), automatic(false) {}
+};
+
+// a ride's time on a segment
+struct SegmentEffort {
+    int segment;
+    double start, stop; // secs in the ride
+    double watts, hr;   // averages, 0 if not recorded
+
+    SegmentEffort() : segment(-1), start(0), stop(0), watts(0), hr(0) {}
+};
+
+// what is kept for a ride, worked out when it is imported or its samples
+// change: the index cells its track passes through and its efforts on the
+// segments we know about. Climbs not on any of them become new segments
+struct RideSegments {
+    QStringList cells;
+    QList<SegmentEffort> efforts;
+    QList<Segment> climbs;
+    QList<SegmentEffort> climbEfforts; // the ride's effort on each climb
+};
+
+// Rides are indexed by the geohash cells their track passes near, so
+// the rides a segment might be on are found with a query rather than
+// comparing its route with every ride in the archive
+class Segments
+{
+    public:
+        static const int precision;     // geohash characters, about 1.2 x 0.6km
+        static const double tolerance;  // metres a ride may be from the route
+
+        static QString geohash(double lat, double lon, int precision);
+
+        // the track from start to stop (secs), a point at least metres apart. Unlike
+        // SimplifiedRoute, which is for drawing, the points are evenly spaced so
+        // none of the cells passed through are skipped and matching can follow it
+        static QVector<GeoPoint> simplify(const RideFile *ride, double metres = 50,
+                                          double start = 0, double stop = -1);
+
+        // the cells a track passes within tolerance of
+        static QStringList cells(const QVector<GeoPoint> &track);
+
+        // the times a ride went along a segment
+        static QList<SegmentEffort> match(const Segment &segment, const RideFile *ride);
+
+        // the cells and efforts for a ride, safe to call from the
+        // metric refresh worker threads
+        static RideSegments find(const RideFile *ride, const QList<Segment> &known,
+                                 const QList<DetectedInterval> &intervals);
+
+        // write them, within the caller's transaction. Climbs that aren't on one of
+        // the segments in created (earlier in the same refresh) are added to it
+        static void store(DBAccess *db, QString filename, const RideFile *ride,
+                          RideSegments &found, QList<Segment> &created);
+
+        // match a new segment against the rides already imported, except
+        // the one it came from (it has its effort), returns the efforts found
+        static int backfill(Context *context, DBAccess *db, const Segment &segment, QString except = "");
+};
+
+#endif // _GC_Segments_h
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "SessionRecorder.h"
+#include "RideFile.h"
+
+#include <string.h>     // memcmp
+
+#ifdef WIN32
+#include <io.h>         // _commit
+#else
+#include <unistd.h>     // fsync
+#endif
+
+// room for a minute or so of samples from a full set of sensors
+static const int RINGSIZE = 8192;
+
+// write out every quarter second, sync to disk every five
+static const unsigned long WRITEWAIT = 250;  // ms
+static const int SYNCWAIT = 5000;            // ms
+
+// rides are built on a 4Hz grid, the native rate for ANT+ power
+static const int RECINTMSECS = 250;
+
+static const char magic[8] = { 'G', 'C', 'R', 'E', 'C', '0', '0', '1' };
+
+SessionRecorder::SessionRecorder(QString filename) :
+    filename(filename), file(filename), head(0), count(0),
+    stopping(false), paused(false), dropped(0), spinScanned(false), elapsed(0)
+{
+    ring.resize(RINGSIZE);
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    close();
+}
+
+bool SessionRecorder::open()
+{
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) return false;
+    file.write(magic, sizeof(magic));
+
+    clock.start();
+    start();
+    return true;
+}
+
+void SessionRecorder::pause()
+{
+    QMutexLocker locker(&lock);
+    if (paused) return;
+    elapsed += clock.elapsed();
+    paused = true;
+}
+
+void SessionRecorder::resume()
+{
+    QMutexLocker locker(&lock);
+    if (!paused) return;
+    clock.start();
+    paused = false;
+}
+
+void SessionRecorder::close()
+{
+    lock.lock();
+    stopping = true;
+    pending.wakeOne();
+    lock.unlock();
+
+    wait();
+    if (file.isOpen()) file.close();
+}
+
+bool SessionRecorder::remove()
+{
+    close();
+    return file.remove();
+}
+
+void SessionRecorder::record(int device, Series series, double value)
+{
+    QMutexLocker locker(&lock);
+
+    if (paused || stopping) return;
+
+    // writer has fallen behind, better to lose
+    // this sample than hold up the device
+    if (count == ring.size()) {
+        dropped++;
+        return;
+    }
+
+    SessionSample &p = ring[(head + count) % ring.size()];
+    p.msecs = elapsed + clock.elapsed();
+    p.device = device;
+    p.series = series;
+    p.value = value;
+
+    // kick the writer early if it's filling up
+    if (++count == ring.size() / 2) pending.wakeOne();
+}
+
+void SessionRecorder::recordSpinScan(int device, const uint8_t *torque)
+{
+    QMutexLocker locker(&lock);
+
+    if (paused || stopping) return;
+
+    // all or nothing, half a revolution is no use to anyone
+    if (count + SPINSCAN_BINS > ring.size()) {
+        dropped += SPINSCAN_BINS;
+        return;
+    }
+
+    qint32 msecs = elapsed + clock.elapsed();
+    for (int i=0; i<SPINSCAN_BINS; i++) {
+        SessionSample &p = ring[(head + count + i) % ring.size()];
+        p.msecs = msecs;
+        p.device = device;
+        p.series = SpinScan + i;
+        p.value = torque[i];
+    }
+    spinScanned = true;
+
+    int before = count;
+    count += SPINSCAN_BINS;
+    if (before < ring.size() / 2 && count >= ring.size() / 2) pending.wakeOne();
+}
+
+void SessionRecorder::run()
+{
+    QVector<SessionSample> batch;
+    batch.reserve(RINGSIZE);
+
+    QTime sinceSync;
+    sinceSync.start();
+
+    lock.lock();
+    forever {
+
+        if (!count && !stopping) pending.wait(&lock, WRITEWAIT);
+
+        // take what is there and let the devices carry on
+        batch.resize(count);
+        for (int i=0; i<count; i++) batch[i] = ring[(head + i) % ring.size()];
+        head = (head + count) % ring.size();
+        count = 0;
+        bool done = stopping;
+        lock.unlock();
+
+        if (batch.count()) file.write((const char*)batch.constData(), batch.count() * sizeof(SessionSample));
+
+        if (done || sinceSync.elapsed() > SYNCWAIT) {
+            file.flush();
+#ifdef WIN32
+            _commit(file.handle());
+#else
+            fsync(file.handle());
+#endif
+            sinceSync.restart();
+        }
+
+        if (done) return;
+        lock.lock();
+    }
+}
+
+// builds up the ride on the fixed grid from the samples as they are read
+struct SessionGrid
+{
+    SessionGrid(RideFile *ride) : ride(ride), period(0), wattsTotal(0), wattsCount(0), km(0) {
+        for (int i=0; i<=SessionRecorder::Lap; i++) last[i] = 0;
+    }
+
+    // latest value of each series, power is averaged across the
+    // samples in each period so short spikes aren't lost
+    void add(const SessionSample &p) {
+        if (p.series == SessionRecorder::Watts) {
+            wattsTotal += p.value;
+            wattsCount++;
+        }
+        last[p.series] = p.value;
+    }
+
+    // write out the grid up to the period given
+    void fillTo(int upto) {
+        for (; period < upto; period++) {
+
+            double watts = wattsCount ? wattsTotal / wattsCount : last[SessionRecorder::Watts];
+            wattsTotal = 0;
+            wattsCount = 0;
+
+            double kph = last[SessionRecorder::Speed];
+            km += kph * RECINTMSECS / 3600000.0;
+
+            ride->appendPoint(double(period * RECINTMSECS) / 1000.0, last[SessionRecorder::Cadence],
+                              last[SessionRecorder::HeartRate], km, kph, 0, watts, 0, 0, 0, 0, 0,
+                              RideFile::noTemp, last[SessionRecorder::LRBalance], last[SessionRecorder::Lap]);
+        }
+    }
+
+    RideFile *ride;
+    int period;
+    double last[SessionRecorder::Lap+1];
+    double wattsTotal;
+    int wattsCount;
+    double km;
+};
+
+RideFile *SessionRecorder::rideFile(const QDateTime &start, const QVector<int> &sources) const
+{
+    QFile in(filename);
+    if (!in.open(QFile::ReadOnly)) return NULL;
+
+    char check[sizeof(magic)];
+    if (in.read(check, sizeof(magic)) != sizeof(magic) || memcmp(check, magic, sizeof(magic))) return NULL;
+
+    RideFile *ride = new RideFile(start, double(RECINTMSECS) / 1000.0);
+    ride->setDeviceType("GoldenCheetah Train");
+    ride->setFileFormat("GoldenCheetah Session Recording");
+    ride->reservePoints((in.size() / sizeof(SessionSample)) / 4);
+
+    SessionGrid grid(ride);
+    bool any = false;
+
+    SessionSample samples[1024];
+    qint64 n;
+    while ((n = in.read((char*)samples, sizeof(samples))) > 0) {
+
+        for (int i=0; i < n / (qint64)sizeof(SessionSample); i++) {
+
+            const SessionSample &p = samples[i];
+            if (p.series < 0 || p.series > Lap) continue;
+
+            // only take the series from the device chosen to supply it
+            if (p.device != Sidebar && p.series < sources.count() && sources[p.series] != p.device) continue;
+
+            grid.fillTo(p.msecs / RECINTMSECS);
+            grid.add(p);
+            any = true;
+        }
+    }
+    if (any) grid.fillTo(grid.period + 1);
+
+    return ride;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_SessionRecorder_h
+#define _GC_SessionRecorder_h 1
+#include "GoldenCheetah.h"
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QDateTime>
+#include <QTime>
+#include <QFile>
+#include <QVector>
+#include "SpinScan.h"
+
+class RideFile;
+
+// one raw sample from a device, as written to disk
+struct SessionSample
+{
+    qint32 msecs;       // session time, excluding pauses
+    qint16 device;      // which device it came from
+    qint16 series;      // SessionRecorder::Series
+    double value;
+};
+
+// The session recorder takes raw samples from every device as they
+// arrive, timestamps them against the session clock and appends them to
+// a binary file from its own thread. Devices hand samples over through a
+// ring buffer so they never wait on the disk, and the file is synced
+// every few seconds so a crash loses very little.
+//
+// When the session stops the recording is converted straight into a
+// RideFile on a fixed grid fine enough to keep the native sample rate.
+class SessionRecorder : public QThread
+{
+    public:
+        // SpinScan is the first of SPINSCAN_BINS series, one for each
+        // 15 degrees of the pedal stroke, they stay in the recording for
+        // pedal stroke analysis but aren't converted into the ride
+        enum series { Watts=0, AltWatts, HeartRate, Cadence, Speed, LRBalance, Lap, SpinScan };
+        typedef enum series Series;
+
+        // samples recorded by the sidebar itself, e.g. laps
+        static const int Sidebar = -1;
+
+        SessionRecorder(QString filename);
+        ~SessionRecorder();
+
+        bool open();                    // create the file and start writing
+        void pause();                   // session clock stops, samples dropped
+        void resume();
+        void close();                   // write what is left and stop
+        bool remove();                  // throw the recording away
+        QString fileName() const { return filename; }
+
+        // device threads, at their native rate
+        void record(int device, Series series, double value);
+
+        // computrainer thread, a whole revolution at once
+        void recordSpinScan(int device, const uint8_t *torque);
+        bool hasSpinScan() const { return spinScanned; }
+
+        // sidebar, when the user or workout starts a new lap
+        void newLap(int lap) { record(Sidebar, Lap, lap); }
+
+        // convert the recording, sources gives the device to take each
+        // series from since several may supply the same one
+        RideFile *rideFile(const QDateTime &start, const QVector<int> &sources) const;
+
+        int overruns() const { return dropped; }
+
+    private:
+        void run();
+
+        QString filename;
+        QFile file;
+
+        QMutex lock;
+        QWaitCondition pending;
+        QVector<SessionSample> ring;
+        int head, count;
+        bool stopping, paused;
+        int dropped;
+        bool spinScanned;
+
+        QTime clock;        // running since the session (re)started
+        qint64 elapsed;     // msecs recorded before the last pause
+};
+
+#endif // _GC_SessionRecorder_h
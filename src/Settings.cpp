@@ -2,6 +2,8 @@
 #include "Settings.h"
 #include <QSettings>
 #include <QDebug>
+#include <QMutex>
+#include <QFont>
 
 #ifdef Q_OS_MAC
 int OperatingSystem = OSX;
@@ -42,3 +44,42 @@ GSettings::value(const QObject * /*me*/, const QString key, const QVariant def)
 // initialise with no cyclist
 // as soon as a cyclist is opened it will be intialised via mainwindow
 GSettings *appsettings = GetApplicationSettings();
+
+SettingsSnapshot::SettingsSnapshot()
+{
+    // hysteresis can be configured, we default to 3.0
+    elevationHysteresis = appsettings->value(NULL, GC_ELEVATION_HYSTERESIS).toDouble();
+    if (elevationHysteresis <= 0.1) elevationHysteresis = 3.00;
+
+    crankLength = appsettings->value(NULL, GC_CRANKLENGTH, 0.0).toDouble();
+    lineWidth = appsettings->value(NULL, GC_LINEWIDTH, 2.0).toDouble();
+    antiAlias = appsettings->value(NULL, GC_ANTIALIAS, false).toBool();
+    shadeZones = appsettings->value(NULL, GC_SHADEZONES, true).toBool();
+    stsDays = appsettings->value(NULL, GC_STS_DAYS, 7).toInt();
+    ltsDays = appsettings->value(NULL, GC_LTS_DAYS, 42).toInt();
+    chartLabelsFont = appsettings->value(NULL, GC_FONT_CHARTLABELS, QFont().toString()).toString();
+    chartLabelsSize = appsettings->value(NULL, GC_FONT_CHARTLABELS_SIZE, 8).toInt();
+    generation = 0;
+}
+
+static QMutex snapshotLock;
+static SettingsSnapshot *snapshot = NULL;
+
+SettingsSnapshot
+SettingsSnapshot::current()
+{
+    QMutexLocker locker(&snapshotLock);
+    if (snapshot == NULL) snapshot = new SettingsSnapshot;
+    return *snapshot;
+}
+
+void
+SettingsSnapshot::refresh()
+{
+    SettingsSnapshot *fresh = new SettingsSnapshot;
+
+    QMutexLocker locker(&snapshotLock);
+    fresh->generation = snapshot ? snapshot->generation + 1 : 1;
+    delete snapshot;
+    snapshot = fresh;
+}
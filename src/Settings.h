@@ -22,6 +22,7 @@
 #include <QDebug>
 
 #define GC_VERSION_USED             "versionused"
+#define GC_UPGRADE_DONE             "upgradedone" // steps of an unfinished upgrade
 #define GC_SAFEEXIT                 "safeexit"
 #define GC_SETTINGS_CO              "goldencheetah.org"
 #define GC_SETTINGS_APP             "GoldenCheetah"
@@ -35,6 +36,19 @@
 #define GC_SETTINGS_CALENDAR_SIZES  "mainwindow/calendarSizes"
 #define GC_TABS_TO_HIDE             "mainwindow/tabsToHide"
 #define GC_ELEVATION_HYSTERESIS     "elevationHysteresis"
+#define GC_DB_WAL                   "metricDB/wal"
+#define GC_DB_CACHESIZE             "metricDB/cachesize"
+#define GC_RIDECACHE_MB             "rideCache/megabytes"
+#define GC_CPXCACHE_MB              "cpxCache/megabytes"
+#define GC_INTERVALCACHE_MB         "intervalCache/megabytes"
+#define GC_HRPWCACHE_MB             "hrPwCache/megabytes"
+#define GC_COMPARECACHE_MB          "compareCache/megabytes"
+#define GC_SEASONCACHE_MB           "seasonCache/megabytes"
+#define GC_PROFILECACHE_MB          "profileCache/megabytes"
+#define GC_ERGDB_PARALLEL           "ergdb/parallel"
+#define GC_VIDEO_REFSPEED           "video/referenceSpeed"
+#define GC_NATIVE_FORMAT            "nativeFormat"
+#define GC_EXPORT_SIMPLIFY          "export/simplifyMetres"
 #define GC_SETTINGS_SUMMARY_METRICS "rideSummaryWindow/summaryMetrics"
 #define GC_SETTINGS_INTERVAL_METRICS "rideSummaryWindow/intervalMetrics"
 #define GC_RIDE_PLOT_SMOOTHING       "ridePlot/Smoothing"
@@ -56,6 +70,7 @@
 #define GC_SETTINGS_LAST_WORKOUT_PATH "mainwindow/lastWorkoutPath"
 #define GC_LAST_DOWNLOAD_DEVICE      "mainwindow/lastDownloadDevice"
 #define GC_LAST_DOWNLOAD_PORT        "mainwindow/lastDownloadPort"
+#define GC_LAST_DISCOVER_PORT        "mainwindow/lastDiscoverPort"
 #define GC_CRANKLENGTH              "crankLength"
 #define GC_WHEELSIZE                "wheelsize"
 #define GC_BIKESCOREDAYS	    "bikeScoreDays"
@@ -81,6 +96,7 @@
 #define GC_BLANK_DIARY    "blank/diary"
 #define GC_LINEWIDTH      "linewidth"
 #define GC_ANTIALIAS      "antialias"
+#define GC_OPENGL         "opengl"
 #define GC_DROPSHADOW     "dropshadow"
 #define GC_SHADEZONES     "shadezones"
 #define GC_PROXYTYPE      "proxy/type"
@@ -146,6 +162,10 @@
 #define GC_SORTBY           "navigator/sortby"
 #define GC_SORTBYORDER      "navigator/sortbyorder"
 
+// background maintenance, where the .cpx rebuild got to
+#define GC_MAINT_CPXVERSION "maintenance/cpxversion"
+#define GC_MAINT_CPXDONE    "maintenance/cpxdonenewest" // newest first, since the oldest first "cpxdone"
+
 //Twitter oauth keys
 #define GC_TWITTER_CONSUMER_KEY    "qbbmhDt8bG8ZBcT3r9nYw" //< consumer key
 #define GC_TWITTER_CONSUMER_SECRET "IWXu2G6mQC5xvhM8V0ohA0mPTUOqAFutiuKIva3LQg"
@@ -166,6 +186,8 @@
 
 // Calendar sync
 #define GC_WEBCAL_URL "webcal_url"
+#define GC_WEBCAL_ETAG "webcal_etag"
+#define GC_WEBCAL_MODIFIED "webcal_modified"
 
 // Default view on Diary
 #define GC_DIARY_VIEW "diaryview"
@@ -191,6 +213,13 @@
 
 #define FORTIUS_FIRMWARE          "fortius/firmware"
 #define TRAIN_MULTI               "train/multi"
+#define TRAIN_LOADRATE            "train/loadrate"
+#define TRAIN_LOADLEAD            "train/loadlead"
+#define TRAIN_PUBLISH             "train/publish"
+#define TRAIN_PUBLISH_ADDRESS     "train/publishaddress"
+#define TRAIN_PUBLISH_PORT        "train/publishport"
+#define TRAIN_PUBLISH_MSECS       "train/publishmsecs"
+#define GC_ANTLOG_COMPRESS        "train/antlogcompress" // antlog.bin in qCompress blocks
 
 #include <QSettings>
 #include <QFileInfo>
@@ -222,6 +251,30 @@ class GSettings : public QSettings
 };
 
 extern GSettings *appsettings;
+
+// The settings read in metric computation and on every replot, taken from
+// appsettings in one go and refreshed when the configuration changes so
+// a refresh or a redraw does not go to the ini file or registry for each
+// ride or curve. Taking a copy is cheap and safe from the worker threads.
+class SettingsSnapshot
+{
+    public:
+        static SettingsSnapshot current();
+        static void refresh(); // after the configuration changes
+
+        double elevationHysteresis; // metres
+        double crankLength;         // millimetres
+        double lineWidth;
+        bool antiAlias, shadeZones;
+        int stsDays, ltsDays;
+        QString chartLabelsFont;
+        int chartLabelsSize;
+
+        int generation; // one more at each refresh, for caches of results using settings
+
+    private:
+        SettingsSnapshot(); // reads appsettings
+};
 extern int OperatingSystem;
 
 #define WINDOWS 1
@@ -22,7 +22,7 @@
 #include <QHttp>
 #include <QUrl>
 #include <QHttpMultiPart>
-#include <QScriptEngine>
+#include "JsonReader.h"
 #include "TimeUtils.h"
 #include "Units.h"
 
@@ -81,6 +81,9 @@ ShareDialog::ShareDialog(Context *context, RideItem *item) :
 
     ride = item;
 
+    // one connection for all the uploads, so they reuse it
+    networkMgr = new QNetworkAccessManager(this);
+
     // uploaders
     stravaUploader = new StravaUploader(context, ride, this);
     rideWithGpsUploader = new RideWithGpsUploader(context, ride, this);
@@ -188,6 +191,10 @@ ShareDialog::upload()
         return;
     }
 
+    // channels may have changed since the last upload
+    encodedTcx.clear();
+    encodedTcxgz.clear();
+
     shareSiteCount = 0;
     progressBar->setValue(0);
     progressLabel->setText("");
@@ -220,6 +227,78 @@ ShareDialog::upload()
     }
 }
 
+QByteArray
+ShareDialog::tcx()
+{
+    if (encodedTcx.isEmpty()) {
+        TcxFileReader reader;
+        encodedTcx = reader.toByteArray(context, ride->ride(), altitudeChk->isChecked(), powerChk->isChecked(),
+                                        heartrateChk->isChecked(), cadenceChk->isChecked());
+    }
+    return encodedTcx;
+}
+
+QByteArray
+ShareDialog::tcxgz()
+{
+    if (encodedTcxgz.isEmpty()) encodedTcxgz = zCompress(tcx());
+    return encodedTcxgz;
+}
+
+// retries after 1, 2 then 4 seconds
+static const int maxRetries = 3;
+
+bool
+ShareDialog::waitFor(QNetworkReply *reply, int attempt)
+{
+    QEventLoop eventLoop;
+    connect(reply, SIGNAL(finished()), &eventLoop, SLOT(quit()));
+    if (!reply->isFinished()) eventLoop.exec();
+
+    // only worth trying again if the network or the site hiccuped
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool transient = status >= 500 ||
+                     reply->error() == QNetworkReply::TemporaryNetworkFailureError ||
+                     reply->error() == QNetworkReply::TimeoutError ||
+                     reply->error() == QNetworkReply::RemoteHostClosedError;
+
+    if (!transient || attempt >= maxRetries) return false;
+
+    progressLabel->setText(tr("Network problem, trying again..."));
+    QTimer::singleShot(1000 << attempt, &eventLoop, SLOT(quit()));
+    eventLoop.exec();
+    return true;
+}
+
+QNetworkReply *
+ShareDialog::post(QNetworkRequest request, QHttpMultiPart::ContentType type, QByteArray boundary, QList<QHttpPart> parts)
+{
+    for (int attempt=0; ; attempt++) {
+
+        // the parts share their bodies so a resend doesn't copy them
+        QHttpMultiPart *multiPart = new QHttpMultiPart(type);
+        multiPart->setBoundary(boundary);
+        foreach(QHttpPart part, parts) multiPart->append(part);
+
+        QNetworkReply *reply = networkMgr->post(request, multiPart);
+        multiPart->setParent(reply);
+
+        if (!waitFor(reply, attempt)) return reply;
+        delete reply;
+    }
+}
+
+QNetworkReply *
+ShareDialog::post(QNetworkRequest request, QByteArray data)
+{
+    for (int attempt=0; ; attempt++) {
+
+        QNetworkReply *reply = networkMgr->post(request, data);
+        if (!waitFor(reply, attempt)) return reply;
+        delete reply;
+    }
+}
+
 StravaUploader::StravaUploader(Context *context, RideItem *ride, ShareDialog *parent) :
     context(context), ride(ride), parent(parent)
 {
@@ -291,9 +370,6 @@ StravaUploader::requestUploadStrava()
     parent->progressLabel->setText(tr("Upload ride to Strava..."));
     parent->progressBar->setValue(parent->progressBar->value()+10/parent->shareSiteCount);
 
-    QEventLoop eventLoop;
-    QNetworkAccessManager networkMgr;
-
     int year = ride->fileName.left(4).toInt();
     int month = ride->fileName.mid(5,2).toInt();
     int day = ride->fileName.mid(8,2).toInt();
@@ -305,23 +381,17 @@ StravaUploader::requestUploadStrava()
     QTime rideTime = QTime(hour, minute, second);
     QDateTime rideDateTime = QDateTime(rideDate, rideTime);
 
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply*)), this, SLOT(requestUploadStravaFinished(QNetworkReply*)));
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply *)), &eventLoop, SLOT(quit()));
-
-    TcxFileReader reader;
-
     QUrl url = QUrl( "https://www.strava.com/api/v3/uploads" ); // The V3 API doc said "https://api.strava.com" but it is not working yet
     QNetworkRequest request = QNetworkRequest(url);
 
     //QString boundary = QString::number(qrand() * (90000000000) / (RAND_MAX + 1) + 10000000000, 16);
     QString boundary = QVariant(qrand()).toString()+QVariant(qrand()).toString()+QVariant(qrand()).toString();
 
-    QByteArray file = reader.toByteArray(context, ride->ride(), parent->altitudeChk->isChecked(), parent->powerChk->isChecked(), parent->heartrateChk->isChecked(), parent->cadenceChk->isChecked());
+    QByteArray file = parent->tcx();
 
     // MULTIPART *****************
 
-    QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
-    multiPart->setBoundary(boundary.toAscii());
+    QList<QHttpPart> parts;
 
     QHttpPart accessTokenPart;
     accessTokenPart.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant("form-data; name=\"access_token\""));
@@ -353,21 +423,20 @@ StravaUploader::requestUploadStrava()
     filePart.setBody(file);
 
 
-    multiPart->append(accessTokenPart);
-    multiPart->append(activityTypePart);
-    multiPart->append(activityNamePart);
-    multiPart->append(dataTypePart);
-    multiPart->append(externalIdPart);
-    multiPart->append(privatePart);
-    multiPart->append(filePart);
-
-    QScopedPointer<QNetworkReply> reply( networkMgr.post(request, multiPart) );
-    multiPart->setParent(reply.data());
+    parts << accessTokenPart;
+    parts << activityTypePart;
+    parts << activityNamePart;
+    parts << dataTypePart;
+    parts << externalIdPart;
+    parts << privatePart;
+    parts << filePart;
 
     parent->progressBar->setValue(parent->progressBar->value()+30/parent->shareSiteCount);
     parent->progressLabel->setText(tr("Upload ride... Sending to Strava"));
 
-    eventLoop.exec();
+    QNetworkReply *reply = parent->post(request, QHttpMultiPart::FormDataType, boundary.toAscii(), parts);
+    requestUploadStravaFinished(reply);
+    delete reply;
 }
 
 void
@@ -378,14 +447,11 @@ StravaUploader::requestUploadStravaFinished(QNetworkReply *reply)
 
     uploadSuccessful = false;
 
-    QString response = reply->readLine();
+    QByteArray response = reply->readLine();
     //qDebug() << response;
 
-    QScriptValue sc;
-    QScriptEngine se;
-
-    sc = se.evaluate("("+response+")");
-    QString uploadError = sc.property("error").toString();
+    QVariantMap sc = JsonReader::parse(response).toMap();
+    QString uploadError = sc.value("error").toString();
     if (uploadError.toLower() == "none" || uploadError.toLower() == "null")
         uploadError = "";
 
@@ -397,7 +463,7 @@ StravaUploader::requestUploadStravaFinished(QNetworkReply *reply)
     }
     else
     {
-        stravaUploadId = sc.property("upload_id").toString();
+        stravaUploadId = sc.value("upload_id").toString();
 
         ride->ride()->setTag("Strava uploadId", stravaUploadId);
         ride->setDirty(true);
@@ -415,19 +481,15 @@ StravaUploader::requestVerifyUpload()
     parent->progressBar->setValue(0);
     parent->progressLabel->setText(tr("Ride processing..."));
 
-    QEventLoop eventLoop;
-    QNetworkAccessManager networkMgr;
-
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply*)), this, SLOT(requestVerifyUploadFinished(QNetworkReply*)));
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply *)), &eventLoop, SLOT(quit()));
     QByteArray out;
 
     QUrl url = QUrl("https://www.strava.com/api/v3/upload/status/"+stravaUploadId+"?token="+token);
     QNetworkRequest request = QNetworkRequest(url);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
 
-    networkMgr.post( request, out);
-    eventLoop.exec();
+    QNetworkReply *reply = parent->post(request, out);
+    requestVerifyUploadFinished(reply);
+    delete reply;
 }
 
 void
@@ -437,20 +499,17 @@ StravaUploader::requestVerifyUploadFinished(QNetworkReply *reply)
     if (reply->error() != QNetworkReply::NoError)
         qDebug() << "Error from upload " <<reply->error();
     else {
-        QString response = reply->readLine();
+        QByteArray response = reply->readLine();
 
         //qDebug() << response;
 
-        QScriptValue sc;
-        QScriptEngine se;
-
-        sc = se.evaluate("("+response+")");
-        uploadProgress = sc.property("upload_progress").toString();
+        QVariantMap sc = JsonReader::parse(response).toMap();
+        uploadProgress = sc.value("upload_progress").toString();
 
         //qDebug() << "upload_progress: " << uploadProgress;
         parent->progressBar->setValue(uploadProgress.toInt());
 
-        stravaActivityId = sc.property("activity_id").toString();
+        stravaActivityId = sc.value("activity_id").toString();
 
         if (stravaActivityId.length() == 0) {
             requestVerifyUpload();
@@ -460,8 +519,7 @@ StravaUploader::requestVerifyUploadFinished(QNetworkReply *reply)
         ride->ride()->setTag("Strava activityId", stravaActivityId);
         ride->setDirty(true);
 
-        sc = se.evaluate("("+response+")");
-        uploadStatus = sc.property("upload_status").toString();
+        uploadStatus = sc.value("upload_status").toString();
 
         //qDebug() << "upload_status: " << uploadStatus;
         parent->progressLabel->setText(uploadStatus);
@@ -545,9 +603,6 @@ RideWithGpsUploader::requestUploadRideWithGPS()
     parent->progressLabel->setText(tr("Upload ride..."));
     parent->progressBar->setValue(parent->progressBar->value()+10/parent->shareSiteCount);
 
-    QEventLoop eventLoop;
-    QNetworkAccessManager networkMgr;
-
     int prevSecs = 0;
     long diffSecs = 0;
 
@@ -562,8 +617,6 @@ RideWithGpsUploader::requestUploadRideWithGPS()
     QTime rideTime = QTime(hour, minute, second);
     QDateTime rideDateTime = QDateTime(rideDate, rideTime);
 
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply*)), this, SLOT(requestUploadRideWithGPSFinished(QNetworkReply*)));
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply *)), &eventLoop, SLOT(quit()));
     QString out, data;
 
     QVector<RideFilePoint*> vectorPoints = ride->ride()->dataPoints();
@@ -632,8 +685,9 @@ RideWithGpsUploader::requestUploadRideWithGPS()
     parent->progressBar->setValue(parent->progressBar->value()+30/parent->shareSiteCount);
     parent->progressLabel->setText(tr("Upload ride... Sending to RideWithGPS"));
 
-    networkMgr.post( request, out.toAscii());
-    eventLoop.exec();
+    QNetworkReply *reply = parent->post(request, out.toAscii());
+    requestUploadRideWithGPSFinished(reply);
+    delete reply;
 }
 
 void
@@ -644,14 +698,11 @@ RideWithGpsUploader::requestUploadRideWithGPSFinished(QNetworkReply *reply)
 
     uploadSuccessful = false;
 
-    QString response = reply->readAll();
+    QByteArray response = reply->readAll();
     //qDebug() << response;
 
-    QScriptValue sc;
-    QScriptEngine se;
-
-    sc = se.evaluate("("+response+")");
-    QString uploadError = sc.property("error").toString();
+    QVariantMap sc = JsonReader::parse(response).toMap();
+    QString uploadError = sc.value("error").toString();
     if (uploadError.toLower() == "none" || uploadError.toLower() == "null")
         uploadError = "";
 
@@ -662,7 +713,7 @@ RideWithGpsUploader::requestUploadRideWithGPSFinished(QNetworkReply *reply)
     }
     else
     {
-        QString tripid = sc.property("trip").property("id").toString();
+        QString tripid = JsonReader::value(sc, "trip.id").toString();
 
         ride->ride()->setTag("RideWithGPS tripid", tripid);
         ride->setDirty(true);
@@ -756,24 +807,16 @@ CyclingAnalyticsUploader::requestUploadCyclingAnalytics()
     parent->progressLabel->setText(tr("Upload ride to CyclingAnalytics..."));
     parent->progressBar->setValue(parent->progressBar->value()+10/parent->shareSiteCount);
 
-    QEventLoop eventLoop;
-    QNetworkAccessManager networkMgr;
-
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply*)), this, SLOT(requestUploadCyclingAnalyticsFinished(QNetworkReply*)));
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply *)), &eventLoop, SLOT(quit()));
-
     QUrl url = QUrl( "https://www.cyclinganalytics.com/api/me/upload" );
     QNetworkRequest request = QNetworkRequest(url);
 
     QString boundary = QVariant(qrand()).toString()+QVariant(qrand()).toString()+QVariant(qrand()).toString();
 
-    TcxFileReader reader;
-    QByteArray file = reader.toByteArray(context, ride->ride(), parent->altitudeChk->isChecked(), parent->powerChk->isChecked(), parent->heartrateChk->isChecked(), parent->cadenceChk->isChecked());
+    QByteArray file = parent->tcx();
 
     // MULTIPART *****************
 
-    QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
-    multiPart->setBoundary(boundary.toAscii());
+    QList<QHttpPart> parts;
 
     request.setRawHeader("Authorization", (QString("Bearer %1").arg(token)).toAscii());
 
@@ -793,18 +836,17 @@ CyclingAnalyticsUploader::requestUploadCyclingAnalytics()
     filePart.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant("form-data; name=\"data\"; filename=\"file.tcx\"; type=\"text/xml\""));
     filePart.setBody(file);
 
-    multiPart->append(activityNamePart);
-    multiPart->append(filenamePart);
-    multiPart->append(dataTypePart);
-    multiPart->append(filePart);
-
-    QScopedPointer<QNetworkReply> reply( networkMgr.post(request, multiPart) );
-    multiPart->setParent(reply.data());
+    parts << activityNamePart;
+    parts << filenamePart;
+    parts << dataTypePart;
+    parts << filePart;
 
     parent->progressBar->setValue(parent->progressBar->value()+30/parent->shareSiteCount);
     parent->progressLabel->setText(tr("Upload ride... Sending to CyclingAnalytics"));
 
-    eventLoop.exec();
+    QNetworkReply *reply = parent->post(request, QHttpMultiPart::FormDataType, boundary.toAscii(), parts);
+    requestUploadCyclingAnalyticsFinished(reply);
+    delete reply;
 }
 
 void
@@ -815,14 +857,11 @@ CyclingAnalyticsUploader::requestUploadCyclingAnalyticsFinished(QNetworkReply *r
 
     uploadSuccessful = false;
 
-    QString response = reply->readAll();
+    QByteArray response = reply->readAll();
     //qDebug() << "response" << response;
 
-    QScriptValue sc;
-    QScriptEngine se;
-
-    sc = se.evaluate("("+response+")");
-    QString uploadError = sc.property("error").toString();
+    QVariantMap sc = JsonReader::parse(response).toMap();
+    QString uploadError = sc.value("error").toString();
     if (uploadError.toLower() == "none" || uploadError.toLower() == "null")
         uploadError = "";
 
@@ -834,7 +873,7 @@ CyclingAnalyticsUploader::requestUploadCyclingAnalyticsFinished(QNetworkReply *r
     }
     else
     {
-        cyclingAnalyticsUploadId = sc.property("upload_id").toString();
+        cyclingAnalyticsUploadId = sc.value("upload_id").toString();
 
         ride->ride()->setTag("CyclingAnalytics uploadId", cyclingAnalyticsUploadId);
         ride->setDirty(true);
@@ -932,28 +971,20 @@ SelfLoopsUploader::requestUploadSelfLoops()
     parent->progressLabel->setText(tr("Upload ride to Selfloops..."));
     parent->progressBar->setValue(parent->progressBar->value()+10/parent->shareSiteCount);
 
-    QEventLoop eventLoop;
-    QNetworkAccessManager networkMgr;
-
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply*)), this, SLOT(requestUploadSelfLoopsFinished(QNetworkReply*)));
-    connect(&networkMgr, SIGNAL(finished(QNetworkReply *)), &eventLoop, SLOT(quit()));
-
     QUrl url = QUrl( "https://www.selfloops.com/restapi/public/activities/upload.json" );
     QNetworkRequest request = QNetworkRequest(url);
 
     QString boundary = QVariant(qrand()).toString()+QVariant(qrand()).toString()+QVariant(qrand()).toString();
 
     // The TCX file have to be gzipped
-    TcxFileReader reader;
-    QByteArray file = zCompress(reader.toByteArray(context, ride->ride(), parent->altitudeChk->isChecked(), parent->powerChk->isChecked(), parent->heartrateChk->isChecked(), parent->cadenceChk->isChecked()));
+    QByteArray file = parent->tcxgz();
 
     QString username = appsettings->cvalue(context->athlete->cyclist, GC_SELUSER).toString();
     QString password = appsettings->cvalue(context->athlete->cyclist, GC_SELPASS).toString();
 
     // MULTIPART *****************
 
-    QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::MixedType);
-    multiPart->setBoundary(boundary.toAscii());
+    QList<QHttpPart> parts;
 
     QHttpPart emailPart;
     emailPart.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant("form-data; name=\"email\""));
@@ -968,17 +999,16 @@ SelfLoopsUploader::requestUploadSelfLoops()
     filePart.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-gzip");
     filePart.setBody(file);
 
-    multiPart->append(emailPart);
-    multiPart->append(passwordPart);
-    multiPart->append(filePart);
-
-    QScopedPointer<QNetworkReply> reply( networkMgr.post(request, multiPart) );
-    multiPart->setParent(reply.data());
+    parts << emailPart;
+    parts << passwordPart;
+    parts << filePart;
 
     parent->progressBar->setValue(parent->progressBar->value()+30/parent->shareSiteCount);
     parent->progressLabel->setText(tr("Upload ride... Sending to Selfloops"));
 
-    eventLoop.exec();
+    QNetworkReply *reply = parent->post(request, QHttpMultiPart::MixedType, boundary.toAscii(), parts);
+    requestUploadSelfLoopsFinished(reply);
+    delete reply;
 }
 
 void
@@ -989,15 +1019,12 @@ SelfLoopsUploader::requestUploadSelfLoopsFinished(QNetworkReply *reply)
 
     uploadSuccessful = false;
 
-    QString response = reply->readAll();
+    QByteArray response = reply->readAll();
     qDebug() << "response" << response;
 
-    QScriptValue sc;
-    QScriptEngine se;
-
-    sc = se.evaluate("("+response+")");
-    QString error = sc.property("error_code").toString();
-    QString uploadError = sc.property("message").toString();
+    QVariantMap sc = JsonReader::parse(response).toMap();
+    QString error = sc.value("error_code").toString();
+    QString uploadError = sc.value("message").toString();
 
     if (error.length()>0 || reply->error() != QNetworkReply::NoError)
     {
@@ -1007,7 +1034,7 @@ SelfLoopsUploader::requestUploadSelfLoopsFinished(QNetworkReply *reply)
     }
     else
     {
-        selfloopsActivityId = sc.property("activity_id").toString();
+        selfloopsActivityId = sc.value("activity_id").toString();
 
         ride->ride()->setTag("Selfloops activityId", selfloopsActivityId);
         ride->setDirty(true);
@@ -23,6 +23,8 @@
 #include <QObject>
 #include <QtGui>
 #include <QNetworkReply>
+#include <QNetworkAccessManager>
+#include <QHttpMultiPart>
 #include <QSslError>
 #include "MainWindow.h"
 #include "RideItem.h"
@@ -194,6 +196,18 @@ public:
     QCheckBox *heartrateChk;
 
     int shareSiteCount;
+
+    // the ride encoded for the sites, once per upload whichever sites use it
+    QByteArray tcx();
+    QByteArray tcxgz();
+
+    // post on the connection shared by the uploaders and wait for the
+    // reply, a transient failure is sent again after backing off. The
+    // caller deletes the reply
+    QNetworkReply *post(QNetworkRequest request, QHttpMultiPart::ContentType type,
+                        QByteArray boundary, QList<QHttpPart> parts);
+    QNetworkReply *post(QNetworkRequest request, QByteArray data);
+
 signals:
 
 public slots:
@@ -219,6 +233,11 @@ private:
      SelfLoopsUploader *selfLoopsUploader;
 
      QString athleteId;
+
+     QNetworkAccessManager *networkMgr;
+     QByteArray encodedTcx, encodedTcxgz;
+
+     bool waitFor(QNetworkReply *reply, int attempt); // true if it should be sent again
 };
 
 
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "SimplifiedRoute.h"
+#include "RideFile.h"
+#include <QStack>
+#include <QPair>
+#include <math.h>
+
+void
+SimplifiedRoute::set(const RideFile *r, double tolerance)
+{
+    if (r == ride && r && r->dataPoints().count() == points) return;
+
+    ride = r;
+    points = r ? r->dataPoints().count() : 0;
+    kept.fill(false, points);
+    if (!r) return;
+
+    // the samples with a location, projected onto a flat plane in
+    // meters, near enough over the extent of a ride
+    QVector<int> index;
+    QVector<double> x, y;
+    double coslat = 0;
+    for (int i=0; i<points; i++) {
+        const RideFilePoint *p = r->dataPoints().at(i);
+        if (p->lat || p->lon) {
+            if (index.isEmpty()) coslat = cos(p->lat * M_PI / 180.0);
+            index << i;
+            x << p->lon * 111320.0 * coslat;
+            y << p->lat * 110540.0;
+        }
+    }
+    if (index.isEmpty()) return;
+
+    kept[index.first()] = kept[index.last()] = true;
+
+    // Douglas-Peucker, keep the furthest point from the line between
+    // the ends of each span if it is outside tolerance and split there
+    QStack<QPair<int,int> > spans;
+    spans.push(QPair<int,int>(0, index.count()-1));
+
+    while (!spans.isEmpty()) {
+        QPair<int,int> span = spans.pop();
+        int first = span.first, last = span.second;
+        if (last - first < 2) continue;
+
+        double dx = x[last] - x[first];
+        double dy = y[last] - y[first];
+        double length = sqrt(dx*dx + dy*dy);
+
+        double furthest = 0;
+        int split = -1;
+        for (int i=first+1; i<last; i++) {
+            double distance;
+            if (length > 0) distance = fabs(dy*(x[i]-x[first]) - dx*(y[i]-y[first])) / length;
+            else distance = sqrt((x[i]-x[first])*(x[i]-x[first]) + (y[i]-y[first])*(y[i]-y[first]));
+
+            if (distance > furthest) {
+                furthest = distance;
+                split = i;
+            }
+        }
+
+        if (split > 0 && furthest > tolerance) {
+            kept[index[split]] = true;
+            spans.push(QPair<int,int>(first, split));
+            spans.push(QPair<int,int>(split, last));
+        }
+    }
+}
+
+QVariantList
+SimplifiedRoute::latlons(double from, double to) const
+{
+    QVariantList latlons;
+    if (!ride) return latlons;
+
+    bool interval = from >= 0 && to >= 0;
+    int last = -1; // last sample in the interval, kept or not
+
+    for (int i=0; i<points; i++) {
+        const RideFilePoint *p = ride->dataPoints().at(i);
+        if (!p->lat && !p->lon) continue;
+
+        if (interval) {
+            if (p->secs + ride->recIntSecs() <= from || p->secs >= to) continue;
+
+            // always start the interval line where it starts
+            if (last < 0 && !kept[i]) latlons << p->lat << p->lon;
+            last = i;
+        }
+
+        if (kept[i]) latlons << p->lat << p->lon;
+    }
+
+    // and finish it where it finishes
+    if (last >= 0 && !kept[last]) {
+        const RideFilePoint *p = ride->dataPoints().at(last);
+        latlons << p->lat << p->lon;
+    }
+    return latlons;
+}
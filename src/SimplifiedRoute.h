@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_SimplifiedRoute_h
+#define _GC_SimplifiedRoute_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QVariantList>
+
+class RideFile;
+
+//
+// The GPS track of a ride thinned using Douglas-Peucker so the map
+// pages don't need to carry every sample. It is worked out once per ride
+// and shared by the route, interval and shaded polylines.
+//
+// The tolerance is a couple of meters, which is below what even the
+// street level zoom can show, so a single level serves all zooms.
+//
+class SimplifiedRoute
+{
+    public:
+        SimplifiedRoute() : ride(NULL), points(0) {}
+
+        // recompute if the ride is not the one we last simplified
+        void set(const RideFile *ride, double tolerance = 2.0);
+
+        // is the sample at index on the simplified route?
+        bool keep(int index) const { return index < kept.count() && kept[index]; }
+
+        // packed lat, lon pairs of the route, or the part of it between
+        // from and to when they are set (interval start and stop secs)
+        QVariantList latlons(double from = -1, double to = -1) const;
+
+    private:
+        const RideFile *ride;
+        int points;
+        QVector<bool> kept;
+};
+
+#endif // _GC_SimplifiedRoute_h
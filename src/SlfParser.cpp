@@ -36,13 +36,13 @@ SlfParser::startElement( const QString&, const QString&,
     (void)qName;
     (void)qAttributes;
 
-    if (qName == "Log")
+    if (qName == QLatin1String("Log"))
     {
         secs = 0.0;
         distance = 0.0;
         lap = 0;
     }
-    else if (qName == "Eintrag") {
+    else if (qName == QLatin1String("Eintrag")) {
         hr = 0.0;
         alt = 0.0;
         speed = 0.0;
@@ -53,11 +53,11 @@ SlfParser::startElement( const QString&, const QString&,
             lap++;
         }
     }
-    else if (qName == "Pause")
+    else if (qName == QLatin1String("Pause"))
     {
         pauseSec = qAttributes.value("zeit").toDouble();
     }
-    else if (qName == "Rest")
+    else if (qName == QLatin1String("Rest"))
     {
         restSec = qAttributes.value("zeit").toDouble();
     }
@@ -68,68 +68,68 @@ SlfParser::startElement( const QString&, const QString&,
 bool
 SlfParser::endElement( const QString&, const QString&, const QString& qName)
 {
-    if (qName == "StartDatum")
+    if (qName == QLatin1String("StartDatum"))
     {
         start_time.setDate(QDate::fromString(buffer, "dd.MM.yy").addYears(100));
 	rideFile->setStartTime(start_time);
     }
-    else if (qName == "StartZeit")
+    else if (qName == QLatin1String("StartZeit"))
     {
         start_time.setTime(QTime::fromString(buffer, "hh:mm:ss"));
     }
-    else if (qName == "StoppDatum")
+    else if (qName == QLatin1String("StoppDatum"))
     {
         QMap<QString, QString> workout;
         stop_time.setDate(QDate::fromString(buffer, "dd.MM.yy").addYears(100));
         workout.insert("value", QString("%1").arg(start_time.secsTo(stop_time)));
         rideFile->metricOverrides.insert("workout_time", workout);
     }
-    else if (qName == "StoppZeit")
+    else if (qName == QLatin1String("StoppZeit"))
     {
         stop_time.setTime(QTime::fromString(buffer, "hh:mm:ss"));
     }
-    else if (qName == "RadGroesse")
+    else if (qName == QLatin1String("RadGroesse"))
     {
         wheelSize = buffer.toInt();
     }
-    else if (qName == "Einheit")
+    else if (qName == QLatin1String("Einheit"))
     {
         imperial = (buffer == "mph");
     }
-    else if (qName == "Kalorien")
+    else if (qName == QLatin1String("Kalorien"))
     {
         QMap<QString, QString> work;
-        work.insert("value", QString("%1").arg(buffer.toDouble() / 0.239));
+        work.insert("value", QString("%1").arg(xmlDouble(buffer) / 0.239));
         rideFile->metricOverrides.insert("total_work", work);
     }
-    else if (qName == "SamplingRate")
+    else if (qName == QLatin1String("SamplingRate"))
     {
         //Seems like the sampling rate is rounded...
-        samplingRate = buffer.toDouble() - 0.5;
+        samplingRate = xmlDouble(buffer) - 0.5;
         rideFile->setRecIntSecs(samplingRate);
     }
-    else if (qName == "Speed")
+    else if (qName == QLatin1String("Speed"))
     {
-        speed = buffer.toDouble();
+        speed = xmlDouble(buffer);
     }
-    else if (qName == "Puls")
+    else if (qName == QLatin1String("Puls"))
     {
-        hr = buffer.toDouble();
+        hr = xmlDouble(buffer);
     }
-    else if (qName == "Hoehe")
+    else if (qName == QLatin1String("Hoehe"))
     {
-        alt = buffer.toDouble();
+        alt = xmlDouble(buffer);
     }
-    else if (qName == "RPLAbs")
+    else if (qName == QLatin1String("RPLAbs"))
     {
-        rotations = buffer.toDouble();
+        rotations = xmlDouble(buffer);
         distance += (rotations * (wheelSize) / 1000 / 1000);
     }
-    else if (qName == "Temp")
+    else if (qName == QLatin1String("Temp"))
     {
-        temperature = buffer.toDouble();
+        temperature = xmlDouble(buffer);
     }
-    else if (qName == "Eintrag")
+    else if (qName == QLatin1String("Eintrag"))
     {
         double cadence = 0.0;
         double torque = 0.0;
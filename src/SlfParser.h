@@ -23,6 +23,7 @@
 #include <QString>
 #include <QDateTime>
 #include <QXmlDefaultHandler>
+#include "XmlValues.h"
 
 class SlfParser : public QXmlDefaultHandler
 {
@@ -42,55 +42,55 @@ SmfParser::startElement( const QString&, const QString&,
 bool
 SmfParser::endElement( const QString&, const QString&, const QString& qName)
 {
-    if (qName == "Datum")
+    if (qName == QLatin1String("Datum"))
     {
         start_time.setDate(QDate::fromString(buffer, "dd.MM.yy").addYears(100));
     }
-    else if (qName == "Einheit")
+    else if (qName == QLatin1String("Einheit"))
     {
         imperial = (buffer == "mph");
     }
-    else if (qName == "Uhrzeit")
+    else if (qName == QLatin1String("Uhrzeit"))
     {
         start_time.setTime(QTime::fromString(buffer, "hh:mm"));
 	rideFile->setStartTime(start_time);
     }
-    else if (qName == "DurchschnittHR")
+    else if (qName == QLatin1String("DurchschnittHR"))
     {
         QMap<QString, QString> avg_hr;
         avg_hr.insert("value", buffer);
         rideFile->metricOverrides.insert("average_hr", avg_hr);
     }
-    else if (qName == "MaximalHR")
+    else if (qName == QLatin1String("MaximalHR"))
     {
         QMap<QString, QString> max_hr;
         max_hr.insert("value", buffer);
         rideFile->metricOverrides.insert("max_heartrate", max_hr);
     }
-    else if (qName == "MinimalTemp")
+    else if (qName == QLatin1String("MinimalTemp"))
     {
         //min_temperature
     }
-    else if (qName == "MaximalTemp")
+    else if (qName == QLatin1String("MaximalTemp"))
     {
         //max_temperature
     }
-    else if (qName == "Kalorien")
+    else if (qName == QLatin1String("Kalorien"))
     {
         QMap<QString, QString> work;
-        work.insert("value", QString("%1").arg(buffer.toDouble() / 0.239));
+        work.insert("value", QString("%1").arg(xmlDouble(buffer) / 0.239));
         rideFile->metricOverrides.insert("total_work", work);
     }
-    else if (qName == "Strecke")
+    else if (qName == QLatin1String("Strecke"))
     {
-        double dist = buffer.toDouble();
+        double dist = xmlDouble(buffer);
         QMap<QString, QString> distance;
         if (imperial)
             dist *= KM_PER_MILE;
         distance.insert("value", QString("%1").arg(dist));
         rideFile->metricOverrides.insert("total_distance", distance);
     }
-    else if (qName == "Fahrzeit")
+    else if (qName == QLatin1String("Fahrzeit"))
     {
         QStringList durationParts;
         QMap<QString,QString> trm;
@@ -105,39 +105,39 @@ SmfParser::endElement( const QString&, const QString&, const QString& qName)
         rideFile->metricOverrides.insert("time_riding", trm);
         rideFile->setRecIntSecs(time_in_sec);
     }
-    else if (qName == "DurchGeschwindigkeit")
+    else if (qName == QLatin1String("DurchGeschwindigkeit"))
     {
-        double avg = buffer.toDouble();
+        double avg = xmlDouble(buffer);
         QMap<QString, QString> avg_speed;
         if (imperial)
             avg *= KM_PER_MILE;
         avg_speed.insert("value", QString("%1").arg(avg));
         rideFile->metricOverrides.insert("average_speed", avg_speed);
     }
-    else if (qName == "MaxGeschwindigkeit")
+    else if (qName == QLatin1String("MaxGeschwindigkeit"))
     {
-        double max = buffer.toDouble();
+        double max = xmlDouble(buffer);
         QMap<QString, QString> max_speed;
         if (imperial)
             max *= KM_PER_MILE;
         max_speed.insert("value", QString("%1").arg(max));
         rideFile->metricOverrides.insert("max_speed", max_speed);
     }
-    else if (qName == "DurchTrittfrequenz")
+    else if (qName == QLatin1String("DurchTrittfrequenz"))
     {
         QMap<QString, QString> avg_cad;
         avg_cad.insert("value", buffer);
         rideFile->metricOverrides.insert("average_cad", avg_cad);
     }
-    else if (qName == "MaxTrittfrequenz")
+    else if (qName == QLatin1String("MaxTrittfrequenz"))
     {
         QMap<QString, QString> max_cad;
         max_cad.insert("value", buffer);
         rideFile->metricOverrides.insert("max_cad", max_cad);
     }
-    else if (qName == "HoehenMeterBergauf")
+    else if (qName == QLatin1String("HoehenMeterBergauf"))
     {
-        double g = buffer.toDouble();
+        double g = xmlDouble(buffer);
         QMap<QString, QString> gain;
         if (imperial)
             g *= METERS_PER_FOOT;
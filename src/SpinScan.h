@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef _GC_SpinScan_h
+#define _GC_SpinScan_h 1
+#include "GoldenCheetah.h"
+
+#include <stdint.h> // uint8_t
+#include <string.h> // memcpy
+#include <QAtomicInt>
+
+// Computrainer SpinScan reports the force at every 15 degrees of
+// the pedal stroke, once for each revolution of the cranks
+#define SPINSCAN_BINS 24
+
+// most revolutions handed on with a single telemetry sample, at
+// 120rpm and a 200ms refresh that is still only ever 1 or 2
+#define SPINSCAN_MAXREVS 4
+
+struct SpinScanRevolution
+{
+    uint8_t torque[SPINSCAN_BINS];
+};
+
+// Revolutions are handed from the device thread to the controller
+// through a fixed ring with no locks, there is a single writer that
+// only moves tail and a single reader that only moves head. One slot
+// is always left empty so a full ring can be told from an empty one.
+// When the reader falls behind new revolutions are dropped rather
+// than hold up the device thread.
+template <int N>
+class SpinScanQueue
+{
+    public:
+        SpinScanQueue() : head(0), tail(0), dropped(0) {}
+
+        // device thread only
+        bool push(const uint8_t *torque) {
+            int t = tail.fetchAndAddOrdered(0);
+            int next = (t + 1) % N;
+            if (next == head.fetchAndAddOrdered(0)) {
+                dropped.ref();
+                return false;
+            }
+            memcpy(ring[t].torque, torque, SPINSCAN_BINS);
+            tail.fetchAndStoreOrdered(next); // publish
+            return true;
+        }
+
+        // reader only, takes everything waiting but keeps
+        // just the newest max of them, returns how many
+        int take(SpinScanRevolution *to, int max) {
+            int h = head.fetchAndAddOrdered(0);
+            int t = tail.fetchAndAddOrdered(0);
+            int waiting = (t - h + N) % N;
+            if (waiting > max) h = (h + waiting - max) % N;
+            int n = 0;
+            for (; h != t; h = (h + 1) % N) to[n++] = ring[h];
+            head.fetchAndStoreOrdered(t);
+            return n;
+        }
+
+        int overruns() const { return dropped; }
+
+    private:
+        SpinScanRevolution ring[N];
+        QAtomicInt head, tail, dropped;
+};
+
+// Rolling average over the last few revolutions. Each revolution
+// arrives whole and aligned to the same crank position so we can just
+// sum bin by bin; until enough have arrived we average over those we
+// have rather than dragging the plot down towards zero.
+class SpinScanAverage
+{
+    public:
+        enum { MaxRevolutions = 32 };
+
+        SpinScanAverage(int n = 16) { setRevolutions(n); }
+
+        int revolutions() const { return count; }
+        void setRevolutions(int n) {
+            count = qBound(1, n, (int)MaxRevolutions);
+            clear();
+        }
+
+        void clear() {
+            memset(history, 0, sizeof(history));
+            memset(total, 0, sizeof(total));
+            current = filled = 0;
+        }
+
+        void add(const uint8_t *torque) {
+            for (int i=0; i<SPINSCAN_BINS; i++) total[i] += torque[i] - history[current][i];
+            memcpy(history[current], torque, SPINSCAN_BINS);
+            if (++current == count) current = 0;
+            if (filled < count) filled++;
+        }
+
+        void average(uint8_t *to) const {
+            for (int i=0; i<SPINSCAN_BINS; i++) to[i] = filled ? total[i] / filled : 0;
+        }
+
+    private:
+        uint8_t history[MaxRevolutions][SPINSCAN_BINS];
+        int total[SPINSCAN_BINS];
+        int count, current, filled;
+};
+
+#endif // _GC_SpinScan_h
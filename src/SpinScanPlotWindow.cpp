@@ -31,7 +31,9 @@ SpinScanPlotWindow::SpinScanPlotWindow(Context *context) :
     QWidget *c = new QWidget;
     QVBoxLayout *cl = new QVBoxLayout(c);
     QHBoxLayout *style = new QHBoxLayout();
+    QHBoxLayout *smooth = new QHBoxLayout();
     cl->addLayout(style);
+    cl->addLayout(smooth);
     cl->addStretch();
 
     QLabel *label = new QLabel("Style", this);
@@ -43,25 +45,16 @@ SpinScanPlotWindow::SpinScanPlotWindow(Context *context) :
     style->addWidget(mode);
     style->addStretch();
 
-    setControls(c);
+    // how many pedal strokes to average over
+    QLabel *revsLabel = new QLabel("Revolutions", this);
+    revs = new QSpinBox(this);
+    revs->setRange(1, SpinScanAverage::MaxRevolutions);
+    revs->setValue(average.revolutions());
+    smooth->addWidget(revsLabel);
+    smooth->addWidget(revs);
+    smooth->addStretch();
 
-    // init to zero
-    history[0] = set1;
-    history[1] = set2;
-    history[2] = set3;
-    history[3] = set4;
-    history[4] = set5;
-    history[5] = set6;
-    history[6] = set7;
-    history[7] = set8;
-    history[8] = set8;
-    history[9] = set9;
-    history[10] = set11;
-    history[11] = set12;
-    history[12] = set13;
-    history[13] = set14;
-    history[14] = set15;
-    history[15] = set16;
+    setControls(c);
 
     QVBoxLayout *layout = new QVBoxLayout(this);
     stack = new QStackedWidget(this);
@@ -76,9 +69,11 @@ SpinScanPlotWindow::SpinScanPlotWindow(Context *context) :
 
     // when we change styles..
     connect(mode, SIGNAL(currentIndexChanged(int)), this, SLOT(styleChanged()));
+    connect(revs, SIGNAL(valueChanged(int)), this, SLOT(revolutionsChanged()));
 
-    // get updates..
-    connect(context, SIGNAL(telemetryUpdate(RealtimeData)), this, SLOT(telemetryUpdate(RealtimeData)));
+    // get updates.. every one since each carries the revolutions
+    // completed since the last and we'd miss them otherwise
+    context->telemetry->subscribe(this, "telemetryUpdate", 0, QList<RealtimeData::DataSeries>(), true);
     connect(context, SIGNAL(start()), this, SLOT(start()));
     connect(context, SIGNAL(stop()), this, SLOT(stop()));
 
@@ -103,28 +98,29 @@ SpinScanPlotWindow::styleChanged()
     int index = mode->currentIndex();
     if (index < 0 || index > 1) return;
     stack->setCurrentIndex(index);
+    static_cast<QwtPlot*>(stack->currentWidget())->replot();
+}
+
+void
+SpinScanPlotWindow::revolutionsChanged()
+{
+    average.setRevolutions(revs->value());
+    memset(spinData, 0, SPINSCAN_BINS);
+    static_cast<QwtPlot*>(stack->currentWidget())->replot();
 }
 
 void
 SpinScanPlotWindow::start()
 {
-    //resetValues();
-    // init to zero
-    for (int i=0; i<16; i++) memset(history[i], 0, 24);
-    for (int i=0; i<24; i++) rtot[i] = 0;
-    memset(spinData, 0, 24);
-    current=0;
+    average.clear();
+    memset(spinData, 0, SPINSCAN_BINS);
 }
 
 void
 SpinScanPlotWindow::stop()
 {
-    //resetValues();
-    // init to zero
-    for (int i=0; i<16; i++) memset(history[i], 0, 24);
-    for (int i=0; i<24; i++) rtot[i] = 0;
-    memset(spinData, 0, 24);
-    current=0;
+    average.clear();
+    memset(spinData, 0, SPINSCAN_BINS);
 }
 
 void
@@ -133,16 +129,15 @@ SpinScanPlotWindow::pause()
 }
 
 void
-SpinScanPlotWindow::telemetryUpdate(RealtimeData rtData)
+SpinScanPlotWindow::telemetryUpdate(const RealtimeData &rtData)
 {
-    for (int i=0; i<24; i++) {
-        rtot[i] += rtData.spinScan[i];
-        rtot[i] -= history[current][i];
-        spinData[i] = rtot[i]/16;
-    }
-    memcpy(history[current++], rtData.spinScan, 24);
-    if (current==16) current=0;
-
-    plPlot->replot();                // redraw
-    rtPlot->replot();                // redraw
+    // nothing new to show until a revolution completes
+    if (!rtData.spinScanRevCount) return;
+
+    for (int i=0; i<rtData.spinScanRevCount; i++) average.add(rtData.spinScanRevs[i].torque);
+    average.average(spinData);
+
+    // only the chart being shown needs redrawing, the
+    // other picks up the latest when it is selected
+    static_cast<QwtPlot*>(stack->currentWidget())->replot();
 }
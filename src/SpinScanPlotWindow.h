@@ -29,6 +29,7 @@
 #include "SpinScanPolarPlot.h"
 #include "SpinScanPlot.h"
 #include "RealtimeData.h" // for realtimedata structure
+#include "SpinScan.h"
 
 #include "Settings.h"
 #include "Colors.h"
@@ -39,6 +40,7 @@ class SpinScanPlotWindow : public GcWindow
     G_OBJECT
 
     Q_PROPERTY(int style READ getStyle WRITE setStyle USER true)
+    Q_PROPERTY(int revolutions READ getRevolutions WRITE setRevolutions USER true)
 
     public:
 
@@ -47,7 +49,7 @@ class SpinScanPlotWindow : public GcWindow
    public slots:
 
         // trap signals
-        void telemetryUpdate(RealtimeData rtData); // got new data
+        void telemetryUpdate(const RealtimeData &rtData); // got new data
         void start();
         void stop();
         void pause();
@@ -56,35 +58,16 @@ class SpinScanPlotWindow : public GcWindow
         void setStyle(int x);
         void styleChanged();
 
+        int getRevolutions() const { return revs->value(); }
+        void setRevolutions(int x) { revs->setValue(x); }
+        void revolutionsChanged();
+
     private:
 
-        // we keep 8 sets of spinscan data (last 2 seconds)
-        // and maintain a rolling average for display
-        // we use 2 seconds since that is the default refresh
-        // rate from the computrainer. We don't use a
-        // multidimensional array because we need to use
-        // memcpy and don't want to guess the model used by
-        // the compiler (although in reality it is always
-        // gcc and we could, but this isn't a huge overhead)
-        uint8_t set1[24];
-        uint8_t set2[24];
-        uint8_t set3[24];
-        uint8_t set4[24];
-        uint8_t set5[24];
-        uint8_t set6[24];
-        uint8_t set7[24];
-        uint8_t set8[24];
-        uint8_t set9[24];
-        uint8_t set10[24];
-        uint8_t set11[24];
-        uint8_t set12[24];
-        uint8_t set13[24];
-        uint8_t set14[24];
-        uint8_t set15[24];
-        uint8_t set16[24];
-        uint8_t *history[16];
-        uint16_t rtot[24];
-        int current;
+        // rolling average over the last few revolutions
+        // which is what we give to the plots to show
+        SpinScanAverage average;
+        uint8_t spinData[SPINSCAN_BINS];
 
         Context *context;
         bool active;
@@ -93,9 +76,8 @@ class SpinScanPlotWindow : public GcWindow
         SpinScanPlot *rtPlot;
         SpinScanPolarPlot *plPlot;
 
-        uint8_t spinData[24]; // what we give to the plot
-
         QComboBox *mode;
+        QSpinBox *revs;
 };
 
 #endif // _GC_SpinScanPlotWindow_h
@@ -749,50 +749,8 @@ SplitConfirm::initializePage()
 RideFile *
 SplitConfirm::createRideFile(long start, long stop)
 {
-    RideFile *returning = new RideFile; // target
-    RideFile *ride = wizard->rideItem->ride(); // source
-
-    // set offset in seconds, make sure in bounds too
-    double offset = 0;
-    double distanceoffset = 0;
-    if (start < ride->dataPoints().count() && start >= 0) {
-        offset = ride->dataPoints().at(start)->secs;
-        distanceoffset = ride->dataPoints().at(start)->km;
-    }
-
-    // copy first class variables (adjust starttime to include offset)
-    returning->setStartTime(ride->startTime().addSecs(offset));
-    returning->setRecIntSecs(ride->recIntSecs());
-    returning->setDeviceType(ride->deviceType());
-    returning->setFileFormat(ride->fileFormat());
-
-    // lets keep the metadata too
-    const_cast<QMap<QString,QString>&>(returning->tags()) = QMap<QString,QString>(ride->tags());
-
-    // now the dataPoints, check in bounds too!
-    for(long i=start; i<stop && i<ride->dataPoints().count(); i++) {
-        RideFilePoint *p = ride->dataPoints().at(i);
-
-        returning->appendPoint(p->secs - offset, // start from zero!
-                               p->cad, p->hr, p->km - distanceoffset, p->kph,
-                               p->nm, p->watts, p->alt, p->lon, p->lat,
-                               p->headwind, p->slope, p->temp, p->lrbalance, p->interval);
-    }
-
-    // lets keep intervals that start in our section truncating them
-    // if neccessary (some folks want to keep lap markers)
-    double startTime = wizard->rideItem->ride()->dataPoints().at(start)->secs;
-    double stopTime = wizard->rideItem->ride()->dataPoints().at(stop)->secs;
-    foreach (RideFileInterval interval, wizard->rideItem->ride()->intervals()) {
-
-        if (interval.start >= startTime && interval.start <= stopTime) {
-            if (interval.stop > stopTime)
-                returning->addInterval(interval.start - offset, stopTime, interval.name);
-            else 
-                returning->addInterval(interval.start - offset, interval.stop - offset, interval.name);
-        }
-    }
-    return returning;
+    // the points, metadata and intervals for this section
+    return wizard->rideItem->ride()->copyRange(start, stop);
 }
 
 bool
@@ -30,7 +30,7 @@
 
 static int srdFileReaderRegistered =
     RideFileFactory::instance().registerReader(
-        "srd", "Polar SRD files", new SrdFileReader());
+        "srd", "Polar SRD files", makeRideFileReader<SrdFileReader>, false);
 
 RideFile *SrdFileReader::openRideFile(QFile &file, QStringList &errorStrings, QList<RideFile*>*) const
 {
@@ -80,6 +80,7 @@ RideFile *SrdFileReader::openRideFile(QFile &file, QStringList &errorStrings, QL
         // dataPoints
         //
         double time = 0;
+        result->reservePoints(w->samples);
         for (int i = 0; i < w->samples; i++ ) {
             double cad=0, hr=0, km=0, kph=0, nm=0, watts=0, alt=0, lon=0, lat=0, wind=0;
 
@@ -581,6 +581,7 @@ SrmDevice::download( const QDir &tmpdir,
         files.append(file);
 
         fclose( fh );
+        emit downloaded(file);
         srmio_data_free(fixed);
 
     }
@@ -86,7 +86,8 @@ struct blockhdr
 
 static int srmFileReaderRegistered =
     RideFileFactory::instance().registerReader(
-        "srm", "SRM training files", new SrmFileReader());
+        "srm", "SRM training files", makeRideFileReader<SrmFileReader>, false,
+        QByteArray("SRM"));
 
 RideFile *SrmFileReader::openRideFile(QFile &file, QStringList &errorStrings, QList<RideFile*>*) const
 {
@@ -94,7 +95,9 @@ RideFile *SrmFileReader::openRideFile(QFile &file, QStringList &errorStrings, QL
         errorStrings << QString("can't open file %1").arg(file.fileName());
         return NULL;
     }
-    QDataStream in(&file);
+    // decode from memory, the file is read with lots of tiny reads
+    QByteArray contents = file.readAll();
+    QDataStream in(contents);
     in.setByteOrder( QDataStream::LittleEndian );
 
     RideFile *result = new RideFile;
@@ -254,6 +257,7 @@ RideFile *SrmFileReader::openRideFile(QFile &file, QStringList &errorStrings, QL
     if (markercnt > 0)
         mrknum = 1;
 
+    result->reservePoints(datacnt);
     for (int i = 0; i < datacnt; ++i) {
         int cad, hr, watts;
         double kph, alt;
@@ -66,11 +66,58 @@ double StressCalculator::min(void) {
 
 void StressCalculator::calculateStress(Context *context, QString, const QString &metric, bool isfilter, QStringList filter)
 {
-    // get all metric data from the year 1900 - 3000
-    QList<SummaryMetrics> results;
+    // remember the date range required so we can truncate afterwards
+    QDateTime startDateNeeded = startDate;
+    QDateTime endDateNeeded   = endDate;
 
-    // get metrics
-    results = context->athlete->metricDB->getAllMetricsFor(QDateTime(QDate(1900,1,1)), QDateTime(QDate(3000,1,1)));
+    // the seeds we're calculating with, if they change we start again
+    QString seeds;
+    foreach(Season x, context->athlete->seasons->seasons)
+        if (x.getSeed()) seeds += QString("%1:%2;").arg(x.getStart().toString(Qt::ISODate)).arg(x.getSeed());
+
+    // filtered results vary from call to call so we can't keep them
+    bool cached = !isfilter && !context->isfiltered;
+    QString key = QString("%1|%2|%3|%4").arg(metric).arg(shortTermDays).arg(longTermDays).arg(showSBToday);
+    StressCache::State *state = cached ? &context->athlete->stressCache->states[key] : NULL;
+
+    // what do we need to get from the metricDB ?
+    QDateTime from;
+    if (state && state->list.count() && state->seeds == seeds && state->startDate <= startDate
+        && (!state->stale.isValid() || state->stale >= state->startDate.date())) {
+
+        // pick up from where we left off
+        startDate = state->startDate;
+        ltsvalues = state->ltsvalues;
+        stsvalues = state->stsvalues;
+        sbvalues = state->sbvalues;
+        xdays = state->xdays;
+        list = state->list;
+        ltsramp = state->ltsramp;
+        stsramp = state->stsramp;
+        lastDaysIndex = state->lastDaysIndex;
+        if (endDate < state->endDate) endDate = state->endDate;
+
+        if (state->stale.isValid()) from = QDateTime(state->stale, QTime(0,0,0));
+        state->stale = QDate(); // changes from now on are noticed next time
+
+    } else {
+
+        // start from scratch
+        from = QDateTime(QDate(1900,1,1));
+        lastDaysIndex = -1;
+        if (state) *state = StressCache::State();
+    }
+
+    // get all metric data from the year 1900 - 3000, or just those that
+    // have changed since we last calculated. Unfiltered we only need the
+    // daily totals, filtered it has to be ride by ride
+    QList<SummaryMetrics> results;
+    QList<QPair<QDateTime, double> > days;
+    if (from.isValid() && !isfilter && !context->isfiltered && RideMetricFactory::instance().haveMetric(metric)) {
+        foreach(const DailyMetric &day, context->athlete->metricDB->getDailyFor(from.date(), QDate(3000,1,1), metric))
+            days << QPair<QDateTime, double>(QDateTime(day.day, QTime(0,0,0)), day.total);
+    } else if (from.isValid())
+        results = context->athlete->metricDB->getAllMetricsFor(from, QDateTime(QDate(3000,1,1)));
 
     if (isfilter) {
         // remove any we don't have filtered
@@ -87,56 +134,95 @@ void StressCalculator::calculateStress(Context *context, QString, const QString
         // remove any we don't have filtered
         QList<SummaryMetrics> filteredresults;
         foreach (SummaryMetrics x, results) {
-            if (context->filters.contains(x.getFileName()))
+            if (context->filterSet.contains(x.getFileName()))
                 filteredresults << x;
         }
         results = filteredresults;
     }
+    foreach(const SummaryMetrics &x, results)
+        days << QPair<QDateTime, double>(x.getRideDate(), x.getForSymbol(metric));
 
-    if (results.count() == 0) return; // no ride files found
+    if (lastDaysIndex < 0) {
 
-    // set start and enddate to maximum maximum required date range
-    // remember the date range required so we can truncate afterwards
-    QDateTime startDateNeeded = startDate;
-    QDateTime endDateNeeded   = endDate;
-    startDate = startDate < results[0].getRideDate() ? startDate : results[0].getRideDate();
-    endDate   = endDate > results[results.count()-1].getRideDate() ? endDate : results[results.count()-1].getRideDate();
+        if (days.count() == 0) {
+            // no ride files found
+            startDate = startDateNeeded;
+            endDate = endDateNeeded;
+            return;
+        }
+
+        // set start and enddate to maximum maximum required date range
+        startDate = startDate < days[0].first ? startDate : days[0].first;
+
+        // but we need to also take into account the earliest
+        // start date for any season -- since it may be seeded
+        // so lets run through the seasons and set start date
+        // to the very earliest date set
+        foreach(Season x, context->athlete->seasons->seasons)
+            if (x.getStart() < startDate.date())
+                startDate = QDateTime(x.getStart(), QTime(0,0,0));
+    }
+    if (days.count() && endDate < days.last().first)
+        endDate = days.last().first;
 
-    // but we need to also take into account the earliest
-    // start date for any season -- since it may be seeded
-    // so lets run through the seasons and set start date
-    // to the very earliest date set
-    foreach(Season x, context->athlete->seasons->seasons)
-        if (x.getStart() < startDate.date())
-            startDate = QDateTime(x.getStart(), QTime(0,0,0));
-    
     int maxarray = startDate.daysTo(endDate) +2; // from zero plus tomorrows SB!
-    stsvalues.resize(maxarray);
-    ltsvalues.resize(maxarray);
-    sbvalues.resize(maxarray);
-    xdays.resize(maxarray);
-    list.resize(maxarray);
-    ltsramp.resize(maxarray);
-    stsramp.resize(maxarray);
-
-    // clear data add in the seeds
-    ltsvalues.fill(0);
-    stsvalues.fill(0);
-    foreach(Season x, context->athlete->seasons->seasons) {
-        if (x.getSeed()) {
-            int offset = startDate.date().daysTo(x.getStart());
-            ltsvalues[offset] = x.getSeed() * -1;
-            stsvalues[offset] = x.getSeed() * -1;
+    int oldarray = lastDaysIndex < 0 ? 0 : list.count();
+    if (maxarray > oldarray) {
+        stsvalues.resize(maxarray);
+        ltsvalues.resize(maxarray);
+        sbvalues.resize(maxarray);
+        xdays.resize(maxarray);
+        list.resize(maxarray);
+        ltsramp.resize(maxarray);
+        stsramp.resize(maxarray);
+    }
+    maxarray = list.count();
+
+    if (lastDaysIndex < 0) {
+
+        // clear data add in the seeds
+        ltsvalues.fill(0);
+        stsvalues.fill(0);
+        list.fill(0);
+        addSeeds(context, 0);
+
+    } else {
+
+        // days we haven't been to yet need their seeds
+        if (oldarray < maxarray) addSeeds(context, oldarray);
+
+        // and days that have changed are cleared and started again
+        int fromIndex = from.isValid() ? startDate.daysTo(from) : maxarray;
+        if (fromIndex <= lastDaysIndex) {
+            for (int d=fromIndex; d<maxarray; d++) {
+                list[d] = ltsvalues[d] = stsvalues[d] = 0;
+            }
+            addSeeds(context, fromIndex);
+            lastDaysIndex = fromIndex - 1;
         }
     }
 
-    
-    for (int i=0; i<results.count(); i++)
-        addRideData(results[i].getForSymbol(metric), results[i].getRideDate());
+    for (int i=0; i<days.count(); i++)
+        addRideData(days[i].second, days[i].first);
 
     // ensure the last day is covered ...
     addRideData(0.0, endDate);
 
+    // keep it for next time
+    if (state) {
+        state->startDate = startDate;
+        state->endDate = endDate;
+        state->seeds = seeds;
+        state->lastDaysIndex = lastDaysIndex;
+        state->ltsvalues = ltsvalues;
+        state->stsvalues = stsvalues;
+        state->sbvalues = sbvalues;
+        state->xdays = xdays;
+        state->list = list;
+        state->ltsramp = ltsramp;
+        state->stsramp = stsramp;
+    }
+
     // now truncate the data series to the requested date range
     int firstindex = startDate.daysTo(startDateNeeded);
     int lastindex  = startDate.daysTo(endDateNeeded)+2; // for today and tomorrow SB
@@ -173,6 +259,21 @@ void StressCalculator::calculateStress(Context *context, QString, const QString
 
 }
 
+// the seasons seeds on or after fromIndex, seeds are stored as negative
+// values so calculate() knows to leave them alone
+void StressCalculator::addSeeds(Context *context, int fromIndex)
+{
+    foreach(Season x, context->athlete->seasons->seasons) {
+        if (x.getSeed()) {
+            int offset = startDate.date().daysTo(x.getStart());
+            if (offset >= fromIndex && offset < ltsvalues.count()) {
+                ltsvalues[offset] = x.getSeed() * -1;
+                stsvalues[offset] = x.getSeed() * -1;
+            }
+        }
+    }
+}
+
 /*
  * calculate each day's STS and LTS.  The daily BS values are in
  * the list.  if there aren't enough days in the list yet, we fake
@@ -247,3 +348,18 @@ void StressCalculator::calculate(int daysIndex) {
         ltsramp[daysIndex] = ltsvalues[daysIndex] - ltsvalues[daysIndex-1];
     }
 }
+
+StressCache::StressCache(Context *context) : QObject(context)
+{
+    connect(context->athlete->metricDB, SIGNAL(metricsChanged(QDate)), this, SLOT(metricsChanged(QDate)));
+}
+
+void
+StressCache::metricsChanged(QDate from)
+{
+    QMutableHashIterator<QString, State> i(states);
+    while (i.hasNext()) {
+        i.next();
+        if (!i.value().stale.isValid() || from < i.value().stale) i.value().stale = from;
+    }
+}
@@ -18,6 +18,8 @@
 #include "Settings.h"
 #include "MetricAggregator.h"
 
+class StressCache;
+
 class StressCalculator:public QObject {
 
     Q_OBJECT
@@ -46,6 +48,7 @@ class StressCalculator:public QObject {
 
 	void calculate(int daysIndex);
 	void addRideData(double BS, QDateTime rideDate);
+    void addSeeds(Context *context, int fromIndex);
 
     QSharedPointer<QSettings> settings;
 
@@ -79,4 +82,36 @@ class StressCalculator:public QObject {
 
 
 
+// The whole history STS/LTS for each metric and set of constants is kept
+// between calls to calculateStress, so redrawing a PMC chart doesn't query
+// every ride and recalculate every day. When rides are written or deleted
+// the days from the earliest of them onwards are recalculated next time.
+class StressCache : public QObject {
+
+    Q_OBJECT
+
+    friend class StressCalculator;
+
+    public:
+        StressCache(Context *context);
+
+    public slots:
+        void metricsChanged(QDate from);
+
+    private:
+        struct State {
+            State() : lastDaysIndex(-1) {}
+
+            QDateTime startDate;    // day zero
+            QDateTime endDate;      // last day calculated
+            QString seeds;          // the season seeds it was calculated with
+            int lastDaysIndex;
+            QDate stale;            // recalculate from here, invalid if not
+
+            QVector<double> stsvalues, ltsvalues, ltsramp, stsramp,
+                            sbvalues, xdays, list;
+        };
+        QHash<QString, State> states;
+};
+
 #endif // _GC_StressCalculator_h
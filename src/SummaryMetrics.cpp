@@ -22,6 +22,8 @@
 #include <QRegExp>
 #include <QStringList>
 #include <QDebug>
+#include <QHash>
+#include <QReadWriteLock>
 
 QString
 SummaryMetrics::toString(QString format, bool UseMetric) const
@@ -57,13 +59,98 @@ const RideMetric *metricForSymbol(QString symbol)
     return factory.rideMetric(symbol);
 }
 
+// the metadata names, shared by all SummaryMetrics
+static QReadWriteLock textLock;
+static QHash<QString, int> textNames;
+
+int
+SummaryMetrics::textIndex(const QString &name, bool add)
+{
+    {
+        QReadLocker locker(&textLock);
+        QHash<QString, int>::const_iterator it = textNames.constFind(name);
+        if (it != textNames.constEnd()) return it.value();
+        if (!add) return -1;
+    }
+
+    QWriteLocker locker(&textLock);
+    if (!textNames.contains(name)) textNames.insert(name, textNames.count());
+    return textNames.value(name);
+}
+
+void
+SummaryMetrics::setForIndex(int index, double v)
+{
+    if (index < 0) return;
+    if (index >= metricValues.size()) {
+        int count = qMax(index+1, RideMetricFactory::instance().metricCount());
+        metricValues.resize(count);
+        metricSet.resize(count);
+    }
+    metricValues[index] = v;
+    metricSet.setBit(index);
+}
+
+void
+SummaryMetrics::setForSymbol(QString symbol, double v)
+{
+    int index = RideMetricFactory::instance().metricIndex(symbol);
+    if (index >= 0) setForIndex(index, v);
+    else otherValues.insert(symbol, v);
+}
+
+void
+SummaryMetrics::setText(QString name, QString v)
+{
+    int index = textIndex(name, true);
+    if (index >= textValues.size()) {
+        textValues.resize(index+1);
+        textSet.resize(index+1);
+    }
+    textValues[index] = v;
+    textSet.setBit(index);
+}
+
+QString
+SummaryMetrics::getText(QString name, QString fallback) const
+{
+    int index = textIndex(name, false);
+    if (index >= 0 && index < textSet.size() && textSet.testBit(index)) return textValues[index];
+    return fallback;
+}
+
+QMap<QString, double>
+SummaryMetrics::values() const
+{
+    QMap<QString, double> returning = otherValues;
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    for (int i=0; i<metricSet.size(); i++)
+        if (metricSet.testBit(i)) returning.insert(factory.metricName(i), metricValues[i]);
+    return returning;
+}
+
+QMap<QString, QString>
+SummaryMetrics::texts() const
+{
+    QMap<QString, QString> returning;
+    QReadLocker locker(&textLock);
+    QHashIterator<QString, int> i(textNames);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value() < textSet.size() && textSet.testBit(i.value())) returning.insert(i.key(), textValues[i.value()]);
+    }
+    return returning;
+}
+
 double
 SummaryMetrics::getForSymbol(QString symbol, bool metric) const
 {
-    if (metric) return value.value(symbol, 0.0);
+    int index = RideMetricFactory::instance().metricIndex(symbol);
+    double metricValue = index >= 0 ? getForIndex(index) : otherValues.value(symbol, 0.0);
+
+    if (metric) return metricValue;
     else {
         const RideMetric *m = metricForSymbol(symbol);
-        double metricValue = value.value(symbol, 0.0);
         metricValue *= m->conversion();
         metricValue += m->conversionSum();
         return metricValue;
@@ -130,7 +217,7 @@ QString SummaryMetrics::getAggregated(Context *context, QString name, const QLis
 
         // skip filtered rides
         if (filtered && !filters.contains(rideMetrics.getFileName())) continue;
-        if (context->isfiltered && !context->filters.contains(rideMetrics.getFileName())) continue;
+        if (context->isfiltered && !context->filterSet.contains(rideMetrics.getFileName())) continue;
 
         // get this value
         double value = rideMetrics.getForSymbol(name);
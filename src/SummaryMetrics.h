@@ -22,6 +22,8 @@
 
 #include <QString>
 #include <QMap>
+#include <QVector>
+#include <QBitArray>
 #include <QDateTime>
 #include <QApplication>
 class Context;
@@ -46,11 +48,17 @@ class SummaryMetrics
         void setDateTime(QDateTime dateTime) { this->rideDate = dateTime; }
 
         // metric values
-        void setForSymbol(QString symbol, double v) { value.insert(symbol, v); }
+        void setForSymbol(QString symbol, double v);
         double getForSymbol(QString symbol, bool metric=true) const;
 
-        void setText(QString name, QString v) { text.insert(name, v); }
-        QString getText(QString name, QString fallback) { return text.value(name, fallback); }
+        // metric values by RideMetricFactory index, avoids the symbol lookup
+        void setForIndex(int index, double v);
+        double getForIndex(int index) const {
+            return (index >= 0 && index < metricSet.size() && metricSet.testBit(index)) ? metricValues[index] : 0.0;
+        }
+
+        void setText(QString name, QString v);
+        QString getText(QString name, QString fallback) const;
 
         // convert to string, using format supplied
         // replaces ${...:units} or ${...} with unit string
@@ -69,15 +77,26 @@ class SummaryMetrics
                                      const QStringList &filters, bool filtered,
                                      bool useMetricUnits, bool nofmt = false);
 
-        QMap<QString, double> &values() { return value; }
-        QMap<QString, QString> &texts() { return text; }
+        // everything by name, built on demand
+        QMap<QString, double> values() const;
+        QMap<QString, QString> texts() const;
 
 	private:
 	    QString fileName;
         QString id;
         QDateTime rideDate;
-        QMap<QString, double> value;
-        QMap<QString, QString> text;
+
+        // metric values are held densely by RideMetricFactory index, the
+        // metadata names are interned into one table shared by all so
+        // each only holds its values. Anything else, e.g. numeric
+        // metadata or the PMC values LTM adds, is kept by name.
+        QVector<double> metricValues;
+        QBitArray metricSet;
+        QVector<QString> textValues;
+        QBitArray textSet;
+        QMap<QString, double> otherValues;
+
+        static int textIndex(const QString &name, bool add);
 };
 
 
@@ -230,13 +230,16 @@ TPDownload::download(QString cyclist, int personId, int workoutId)
 void TPDownload::getResponse(const QtSoapMessage &message)
 {
     downloading = false;
-    QString result;
-    QDomDocument pwx("PWX");
+    QByteArray pwx;
 
+    // the soap response is already a tree, but it only
+    // lasts as long as it takes to write it out as text
     if (!message.isFault()) {
+        QDomDocument doc("PWX");
         const QtSoapType &response = message.returnValue();
-        QDomNode workout = response.toDomElement(pwx).firstChild();
-        pwx.appendChild(workout);
+        QDomNode workout = response.toDomElement(doc).firstChild();
+        doc.appendChild(workout);
+        pwx = doc.toByteArray(0);
     }
     completed(pwx);
 }
@@ -77,7 +77,7 @@ public:
     void download(QString cyclist, int PersonId, int WorkoutId);
 
 signals:
-    void completed(QDomDocument);
+    void completed(QByteArray); // the pwx, empty if it failed
 
 private slots:
     void getResponse(const QtSoapMessage &);
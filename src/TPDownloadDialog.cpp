@@ -27,6 +27,9 @@
 #include "MetricAggregator.h"
 #include "Units.h"
 
+// requests to TrainingPeaks in flight at once for each of upload/download
+static const int maxInFlight = 4;
+
 TPDownloadDialog::TPDownloadDialog(Context *context) : QDialog(context->mainWindow, Qt::Dialog), context(context), downloading(false), aborted(false)
 {
     setWindowTitle(tr("Download from TrainingPeaks.com"));
@@ -73,13 +76,18 @@ TPDownloadDialog::completedAthlete(QList<QMap<QString, QString> >athletes)
     connect (workouter, SIGNAL(completed(QList<QMap<QString,QString> >)), this,
             SLOT(completedWorkout(QList<QMap<QString,QString> >)));
 
-    downloader = new TPDownload(this);
-    connect (downloader, SIGNAL(completed(QDomDocument)), this,
-            SLOT(completedDownload(QDomDocument)));
-
-    uploader = new TPUpload(this);
-    connect (uploader, SIGNAL(completed(QString)), this,
-            SLOT(completedUpload(QString)));
+    // a season is round trip bound, so keep a few requests on the go
+    for (int i=0; i<maxInFlight; i++) {
+        TPDownload *downloader = new TPDownload(this);
+        connect (downloader, SIGNAL(completed(QByteArray)), this,
+                SLOT(completedDownload(QByteArray)));
+        downloaders << downloader;
+
+        TPUpload *uploader = new TPUpload(this);
+        connect (uploader, SIGNAL(completed(QString)), this,
+                SLOT(completedUpload(QString)));
+        uploaders << uploader;
+    }
 
     // OK! Lets build up that dialog box
     athlete = athletes[0];
@@ -305,7 +313,7 @@ TPDownloadDialog::refreshClicked()
     // Whilst we wait for the results lets fill the map of existing rideFiles
     // (but ignore seconds since they aren't reliable)
     rideFiles.clear();
-    QStringListIterator i(RideFileFactory::instance().listRideFiles(context->athlete->home));
+    QStringListIterator i(context->athlete->allRideFiles());
     for (i.toFront(); i.hasNext();) rideFiles << QFileInfo(i.next()).baseName().mid(0,14);
 
 }
@@ -637,24 +645,69 @@ TPDownloadDialog::downloadClicked()
     }
 }
 
+TPDownload *
+TPDownloadDialog::freeDownloader()
+{
+    foreach(TPDownload *downloader, downloaders)
+        if (!inflight.contains(downloader)) return downloader;
+    return NULL;
+}
+
+TPUpload *
+TPDownloadDialog::freeUploader()
+{
+    foreach(TPUpload *uploader, uploaders)
+        if (!inflight.contains(uploader)) return uploader;
+    return NULL;
+}
+
+bool
+TPDownloadDialog::startUpload(TPUpload *uploader, QTreeWidgetItem *curr)
+{
+    // read in the file
+    QStringList errors;
+    QFile file(context->athlete->home.absolutePath() + "/" + curr->text(1));
+    RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
+
+    if (ride) {
+        inflight.insert(uploader, curr);
+        uploader->upload(context, ride);
+        delete ride; // clean up!
+        QApplication::processEvents();
+        return true;
+    } else {
+        curr->setText(7, "Parse failure");
+        QApplication::processEvents();
+        return false;
+    }
+}
+
 bool
 TPDownloadDialog::syncNext()
 {
-    // the actual download/upload is kicked off using the uploader / downloader
+    // completions can arrive whilst another is being handled
+    if (!downloading) return false;
+
+    // the actual download/upload is kicked off using the uploaders / downloaders
     // if in sync mode the completedDownload / completedUpload functions
-    // just call completedSync to get the next Sync done
-    for (int i=listindex; i<rideListSync->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListSync->invisibleRootItem()->child(i);
+    // just call syncNext to fill the slot they freed up
+    // listindex moves on before anything is started, processEvents may
+    // deliver a completion that comes back in here
+    while (listindex<rideListSync->invisibleRootItem()->childCount()) {
+        QTreeWidgetItem *curr = rideListSync->invisibleRootItem()->child(listindex++);
         QCheckBox *check = (QCheckBox*)rideListSync->itemWidget(curr, 0);
 
         if (check->isChecked()) {
 
-            listindex = i+1; // start from the next one
-
             progressLabel->setText(QString(tr("Processed %1 of %2")).arg(downloadcounter).arg(downloadtotal));
             if (curr->text(6) == "Download") {
+
+                TPDownload *downloader = freeDownloader();
+                if (!downloader) { listindex--; return true; } // wait for one to finish
+
                 curr->setText(7, tr("Downloading"));
                 rideListSync->setCurrentItem(curr);
+                inflight.insert(downloader, curr);
                 downloader->download(
                     context->athlete->cyclist,
                     athleteCombo->itemData(athleteCombo->currentIndex()).toInt(),
@@ -662,29 +715,20 @@ TPDownloadDialog::syncNext()
                     );
                 QApplication::processEvents();
             } else {
-                curr->setText(7, tr("Uploading"));
-                rideListSync->setCurrentItem(curr);
 
-                // read in the file
-                QStringList errors;
-                QFile file(context->athlete->home.absolutePath() + "/" + curr->text(1));
-                RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
-
-                if (ride) {
-                    uploader->upload(context, ride);
-                    delete ride; // clean up!
-                    QApplication::processEvents();
-                    return true;
-                } else {
-                    curr->setText(7, "Parse failure");
-                    QApplication::processEvents();
-                }
+                TPUpload *uploader = freeUploader();
+                if (!uploader) { listindex--; return true; } // wait for one to finish
 
+                curr->setText(7, tr("Uploading"));
+                rideListSync->setCurrentItem(curr);
+                startUpload(uploader, curr);
             }
-            return true;
         }
     }
 
+    // still waiting for some
+    if (!inflight.isEmpty()) return true;
+
     //
     // Our work is done!
     //
@@ -710,8 +754,10 @@ TPDownloadDialog::syncNext()
 bool
 TPDownloadDialog::downloadNext()
 {
-    for (int i=listindex; i<rideList->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideList->invisibleRootItem()->child(i);
+    if (!downloading) return false;
+
+    while (listindex<rideList->invisibleRootItem()->childCount()) {
+        QTreeWidgetItem *curr = rideList->invisibleRootItem()->child(listindex++);
         QCheckBox *check = (QCheckBox*)rideList->itemWidget(curr, 0);
         QCheckBox *exists = (QCheckBox*)rideList->itemWidget(curr, 6);
 
@@ -724,20 +770,25 @@ TPDownloadDialog::downloadNext()
 
         if (check->isChecked()) {
 
-            listindex = i+1; // start from the next one
+            TPDownload *downloader = freeDownloader();
+            if (!downloader) { listindex--; return true; } // wait for one to finish
+
             curr->setText(7, tr("Downloading"));
             rideList->setCurrentItem(curr);
             progressLabel->setText(QString(tr("Downloaded %1 of %2")).arg(downloadcounter).arg(downloadtotal));
+            inflight.insert(downloader, curr);
             downloader->download(
                   context->athlete->cyclist,
                   athleteCombo->itemData(athleteCombo->currentIndex()).toInt(),
                   curr->text(1).toInt()
                   );
             QApplication::processEvents();
-            return true;
         }
     }
 
+    // still waiting for some
+    if (!inflight.isEmpty()) return true;
+
     //
     // Our work is done!
     //
@@ -759,13 +810,14 @@ TPDownloadDialog::downloadNext()
 }
 
 void
-TPDownloadDialog::completedDownload(QDomDocument pwx)
+TPDownloadDialog::completedDownload(QByteArray pwx)
 {
-    QTreeWidget *which = sync ? rideListSync : rideList;
+    // which row was this one for?
+    QTreeWidgetItem *curr = inflight.take(sender());
+    if (!curr) return;
 
     // was abort pressed?
     if (aborted == true) {
-        QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
         curr->setText(7, tr("Aborted"));
         return;
     }
@@ -774,13 +826,12 @@ TPDownloadDialog::completedDownload(QDomDocument pwx)
     // validate (parse)
     QStringList errors;
     PwxFileReader reader;
-    RideFile *ride = reader.PwxFromDomDoc(pwx, errors);
+    RideFile *ride = reader.PwxFromXml(pwx, errors);
 
     progressBar->setValue(++downloadcounter);
 
-    QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
     if (ride) {
-        if (saveRide(ride, pwx, errors) == true) {
+        if (saveRide(ride, errors) == true) {
             curr->setText(7, tr("Saved"));
             successful++;
         } else {
@@ -801,8 +852,10 @@ TPDownloadDialog::completedDownload(QDomDocument pwx)
 bool
 TPDownloadDialog::uploadNext()
 {
-    for (int i=listindex; i<rideListUp->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListUp->invisibleRootItem()->child(i);
+    if (!downloading) return false;
+
+    while (listindex<rideListUp->invisibleRootItem()->childCount()) {
+        QTreeWidgetItem *curr = rideListUp->invisibleRootItem()->child(listindex++);
         QCheckBox *check = (QCheckBox*)rideListUp->itemWidget(curr, 0);
         QCheckBox *exists = (QCheckBox*)rideListUp->itemWidget(curr, 6);
 
@@ -815,28 +868,19 @@ TPDownloadDialog::uploadNext()
 
         if (check->isChecked()) {
 
-            listindex = i+1; // start from the next one
+            TPUpload *uploader = freeUploader();
+            if (!uploader) { listindex--; return true; } // wait for one to finish
+
             curr->setText(7, tr("Uploading"));
             rideListUp->setCurrentItem(curr);
             progressLabel->setText(QString(tr("Uploaded %1 of %2")).arg(downloadcounter).arg(downloadtotal));
-
-            // read in the file
-            QStringList errors;
-            QFile file(context->athlete->home.absolutePath() + "/" + curr->text(1));
-            RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
-
-            if (ride) {
-                uploader->upload(context, ride);
-                delete ride; // clean up!
-                QApplication::processEvents();
-                return true;
-            } else {
-                curr->setText(7, "Parse failure");
-                QApplication::processEvents();
-            }
+            startUpload(uploader, curr);
         }
     }
 
+    // still waiting for some
+    if (!inflight.isEmpty()) return true;
+
     //
     // Our work is done!
     //
@@ -860,18 +904,18 @@ TPDownloadDialog::uploadNext()
 void
 TPDownloadDialog::completedUpload(QString result)
 {
-    QTreeWidget *which = sync ? rideListSync : rideListUp;
+    // which row was this one for?
+    QTreeWidgetItem *curr = inflight.take(sender());
+    if (!curr) return;
 
     // was abort pressed?
     if (aborted == true) {
-        QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
         curr->setText(7, tr("Aborted"));
         return;
     }
 
     progressBar->setValue(++downloadcounter);
 
-    QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
     curr->setText(7, result);
     if (result == tr("Upload successful")) successful++;
     QApplication::processEvents();
@@ -883,7 +927,7 @@ TPDownloadDialog::completedUpload(QString result)
 }
 
 bool
-TPDownloadDialog::saveRide(RideFile *ride, QDomDocument &, QStringList &errors)
+TPDownloadDialog::saveRide(RideFile *ride, QStringList &errors)
 {
     QDateTime ridedatetime = ride->startTime();
 
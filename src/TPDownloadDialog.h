@@ -46,7 +46,7 @@ class TPDownloadDialog : public QDialog
     public slots:
         void completedAthlete(QList<QMap<QString,QString> >);
         void completedWorkout(QList<QMap<QString,QString> >);
-        void completedDownload(QDomDocument);
+        void completedDownload(QByteArray);
         void completedUpload(QString);
         void cancelClicked();
         void refreshClicked();
@@ -61,8 +61,10 @@ class TPDownloadDialog : public QDialog
 
     private:
         Context *context;
-        TPDownload *downloader;
-        TPUpload *uploader;
+        // several requests are kept in flight, each with its own transport
+        QList<TPDownload*> downloaders;
+        QList<TPUpload*> uploaders;
+        QMap<QObject*, QTreeWidgetItem*> inflight; // request -> row
         TPAthlete *athleter;
         TPWorkout *workouter;
         QList<SummaryMetrics> rideMetrics;
@@ -82,13 +84,16 @@ class TPDownloadDialog : public QDialog
             successful,         // how many downloaded ok?
             listindex;          // where in rideList we've got to
 
-        bool saveRide(RideFile *, QDomDocument &, QStringList &);
+        bool saveRide(RideFile *, QStringList &);
         bool syncNext();        // kick off another download/upload
                                 // returns false if none left
         bool downloadNext();    // kick off another download
                                 // returns false if none left
         bool uploadNext();     // kick off another upload
                                 // returns false if none left
+        TPDownload *freeDownloader(); // NULL when all are busy
+        TPUpload *freeUploader();
+        bool startUpload(TPUpload *, QTreeWidgetItem *);
 
         // tabs - Upload/Download
         QTabWidget *tabs;
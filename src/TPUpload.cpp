@@ -24,6 +24,7 @@
 #include "RideFile.h"
 #include "PwxRideFile.h"
 #include <QtXml>
+#include <QBuffer>
 
 #include <QtCore/QCoreApplication>
 #include <QtCore/QLocale>
@@ -79,18 +80,16 @@ TPUpload::upload(Context *context, const RideFile *ride)
     // if currently uploading fail!
     if (uploading == true) return 0;
 
-    // create the file in .pwx format for upload
-    QString uploadfile(QDir::tempPath() + "/tpupload.pwx");
-    QFile file(uploadfile);
+    // in .pwx format for upload, written straight into memory
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
     PwxFileReader reader;
-    reader.writeRideFile(context, ride, file);
-
-    // read the whole thing back and encode as base64binary
-    file.open(QFile::ReadOnly);
-    QTextStream stream(&file);
-    QString thelot = stream.readAll();
-    QString pwxFile = zCompress(thelot.toUtf8()).toBase64(); // bleck!
-    file.close();
+    reader.writePwx(context, ride, buffer);
+    buffer.close();
+
+    // and encoded as base64binary
+    QString pwxFile = zCompress(buffer.data()).toBase64(); // bleck!
+    buffer.setData(QByteArray());
 
     // setup the soap message
     current = QtSoapMessage();
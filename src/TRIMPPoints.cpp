@@ -44,6 +44,7 @@ class TRIMPPoints : public RideMetric {
     TRIMPPoints() : score(0.0)
     {
         setSymbol("trimp_points");
+        setDependsOn(RideMetric::HrZone | RideMetric::Metadata); // reads tags
         setInternalName("TRIMP Points");
     }
     void initialize() {
@@ -92,7 +93,7 @@ class TRIMPPoints : public RideMetric {
         QString athlete;
         double ksex = 1.92;
         if ((athlete = rideFile->getTag("Athlete", "unknown")) != "unknown") {
-            if (appsettings->cvalue(context->athlete->cyclist, GC_SEX).toInt() == 1) ksex = 1.67; // Female
+            if (config(context).female()) ksex = 1.67; // Female
             else ksex = 1.92; // Male
         }
 
@@ -119,6 +120,7 @@ public:
     TRIMP100Points() : score(0.0)
     {
         setSymbol("trimp_100_points");
+        setDependsOn(RideMetric::HrZone | RideMetric::Metadata); // reads tags
         setInternalName("TRIMP(100) Points");
     }
     void initialize() {
@@ -159,7 +161,7 @@ public:
         QString athlete;
         double ksex = 1.92;
         if ((athlete = rideFile->getTag("Athlete", "unknown")) != "unknown") {
-            if (appsettings->cvalue(context->athlete->cyclist, GC_SEX).toInt() == 1) ksex = 1.67; // Female
+            if (config(context).female()) ksex = 1.67; // Female
             else ksex = 1.92; // Male
         }
 
@@ -189,6 +191,7 @@ public:
     TRIMPZonalPoints() : score(0.0)
     {
         setSymbol("trimp_zonal_points");
+        setDependsOn(RideMetric::HrZone);
         setInternalName("TRIMP Zonal Points");
     }
     void initialize() {
@@ -315,6 +318,7 @@ class SessionRPE : public RideMetric {
     SessionRPE() : score(0.0)
     {
         setSymbol("session_rpe");
+        setDependsOn(RideMetric::Metadata); // reads tags
         setInternalName("Session RPE");
     }
     void initialize() {
@@ -23,10 +23,8 @@
 #include "TcxParser.h"
 #include "TimeUtils.h"
 
-// use stc strtod to bypass Qt toDouble() issues
-#include <stdlib.h>
-
-TcxParser::TcxParser (RideFile* rideFile, QList<RideFile*> *rides) : rideFile(rideFile), rides(rides)
+TcxParser::TcxParser (RideFile* rideFile, QList<RideFile*> *rides, RideFileSplitter *splitter) :
+    rideFile(rideFile), rides(rides), splitter(splitter)
 {
     isGarminSmartRecording = appsettings->value(NULL, GC_GARMIN_SMARTRECORD,Qt::Checked);
     GarminHWM = appsettings->value(NULL, GC_GARMIN_HWMARK);
@@ -42,11 +40,13 @@ TcxParser::startElement( const QString&, const QString&, const QString& qName, c
 {
     buffer.clear();
 
-    if (qName == "Activity") {
+    if (qName == QLatin1String("Activity")) {
 
         lap = 0;
 
-        if (first == true) first = false;
+        // when streaming, the ride handed out at the end of the
+        // last activity has already been replaced with a fresh one
+        if (first == true || splitter) first = false;
         else {
 
             rideFile = new RideFile();
@@ -58,12 +58,12 @@ TcxParser::startElement( const QString&, const QString&, const QString& qName, c
         // if caller is looking for rides...
         if (rides) rides->append(rideFile);
 
-    } else if (qName == "Lap") {
+    } else if (qName == QLatin1String("Lap")) {
 
     // Use the time of the first lap as the time of the activity.
         if (lap == 0) {
 
-            start_time = convertToLocalTime(qAttributes.value("StartTime"));
+            start_time = timestamps.toLocal(qAttributes.value("StartTime"));
             rideFile->setStartTime(start_time);
 
             last_distance = 0.0;
@@ -71,7 +71,7 @@ TcxParser::startElement( const QString&, const QString&, const QString& qName, c
         }
         lap++;
 
-    } else if (qName == "Trackpoint") {
+    } else if (qName == QLatin1String("Trackpoint")) {
 
         power = 0.0;
         cadence = 0.0;
@@ -94,30 +94,19 @@ TcxParser::startElement( const QString&, const QString&, const QString& qName, c
 bool
 TcxParser::endElement( const QString&, const QString&, const QString& qName)
 {
-    if (qName == "Time") {
-        time = convertToLocalTime(buffer);
+    if (qName == QLatin1String("Time")) {
+        time = timestamps.toLocal(buffer);
         secs = start_time.secsTo(time);
 
-    } else if (qName == "DistanceMeters") { distance = buffer.toDouble() / 1000; }
-    else if (qName == "Watts" || qName == "ns3:Watts") { power = buffer.toDouble(); }
-    else if (qName == "Speed" || qName == "ns3:Speed") { speed = buffer.toDouble() * 3.6; }
-    else if (qName == "Value") { hr = buffer.toDouble(); }
-    else if (qName == "Cadence") { cadence = buffer.toDouble(); }
-    else if (qName == "AltitudeMeters") { alt = buffer.toDouble(); }
-    else if (qName == "LongitudeDegrees") {
-
-        char *p; 
-        setlocale(LC_NUMERIC,"C"); // strtod is locale dependent!
-        lon = strtod(buffer.toLatin1(), &p);
-        setlocale(LC_NUMERIC,"");
-
-    } else if (qName == "LatitudeDegrees") {
-        char *p;
-        setlocale(LC_NUMERIC,"C"); // strtod is locale dependent!
-        lat = strtod(buffer.toLatin1(), &p);
-        setlocale(LC_NUMERIC,"");
-
-    } else if (qName == "Trackpoint") {
+    } else if (qName == QLatin1String("DistanceMeters")) { distance = xmlDouble(buffer) / 1000; }
+    else if (qName == QLatin1String("Watts") || qName == QLatin1String("ns3:Watts")) { power = xmlDouble(buffer); }
+    else if (qName == QLatin1String("Speed") || qName == QLatin1String("ns3:Speed")) { speed = xmlDouble(buffer) * 3.6; }
+    else if (qName == QLatin1String("Value")) { hr = xmlDouble(buffer); }
+    else if (qName == QLatin1String("Cadence")) { cadence = xmlDouble(buffer); }
+    else if (qName == QLatin1String("AltitudeMeters")) { alt = xmlDouble(buffer); }
+    else if (qName == QLatin1String("LongitudeDegrees")) { lon = xmlDouble(buffer); }
+    else if (qName == QLatin1String("LatitudeDegrees")) { lat = xmlDouble(buffer); }
+    else if (qName == QLatin1String("Trackpoint")) {
 
         // Some TCX files have Speed, some have Distance
         // Lets derive Speed from Distance or vice-versa
@@ -215,6 +204,17 @@ TcxParser::endElement( const QString&, const QString&, const QString& qName)
         }
         last_distance = distance;
         last_time = time;
+
+    } else if (qName == QLatin1String("Activity") && splitter) {
+
+        // hand the finished activity over and start afresh, so a
+        // history export never holds more than one ride in memory
+        splitter->split(rideFile);
+
+        rideFile = new RideFile();
+        rideFile->setRecIntSecs(1.0);
+        rideFile->setDeviceType("Garmin");
+        rideFile->setFileFormat("Garmin Training Centre (tcx)");
     }
     return TRUE;
 }
@@ -26,13 +26,14 @@
 #include <QDateTime>
 #include <QXmlDefaultHandler>
 #include "Settings.h"
+#include "XmlValues.h"
 
 class TcxParser : public QXmlDefaultHandler
 {
 
 public:
 
-    TcxParser(RideFile* rideFile, QList<RideFile*>*rides);
+    TcxParser(RideFile* rideFile, QList<RideFile*>*rides, RideFileSplitter *splitter = NULL);
 
     bool startElement( const QString&, const QString&, const QString&, const QXmlAttributes& );
     bool endElement( const QString&, const QString&, const QString& );
@@ -40,10 +41,12 @@ public:
 
     RideFile*	rideFile;
     QList<RideFile*> *rides; // when parsed multiple rides
+    RideFileSplitter *splitter; // when streaming multiple rides out
 
 private:
 
     QString	buffer;
+    XmlTimeStamp timestamps;
     QVariant isGarminSmartRecording;
     QVariant GarminHWM;
 
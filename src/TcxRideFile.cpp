@@ -31,7 +31,7 @@
 
 static int tcxFileReaderRegistered =
     RideFileFactory::instance().registerReader(
-        "tcx", "Garmin Training Centre TCX", new TcxFileReader());
+        "tcx", "Garmin Training Centre TCX", makeRideFileReader<TcxFileReader>, true);
 
 RideFile *TcxFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*list) const
 {
@@ -51,6 +51,26 @@ RideFile *TcxFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
     return rideFile;
 }
 
+bool TcxFileReader::splitRideFile(QFile &file, QStringList &errors, RideFileSplitter *splitter) const
+{
+    (void) errors;
+    RideFile *rideFile = new RideFile();
+    rideFile->setRecIntSecs(1.0);
+    rideFile->setDeviceType("Garmin");
+    rideFile->setFileFormat("Garmin Training Centre (tcx)");
+
+    TcxParser handler(rideFile, NULL, splitter);
+
+    QXmlInputSource source (&file);
+    QXmlSimpleReader reader;
+    reader.setContentHandler (&handler);
+    reader.parse (source);
+
+    // every activity has been handed out, this is the unused spare
+    delete handler.rideFile;
+    return true;
+}
+
 QByteArray
 TcxFileReader::toByteArray(Context *context, const RideFile *ride, bool withAlt, bool withWatts, bool withHr, bool withCad) const
 {
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TeamMetrics.h"
+#include "DBAccess.h"
+#include "RideMetric.h"
+
+// SQLite only allows 10 attached databases unless built otherwise
+static const int attachBatch = 8;
+
+static int sessions = 0;
+
+TeamMetrics::TeamMetrics(QDir root)
+{
+    sessionid = QString("team%1").arg(sessions++);
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", sessionid);
+    db.setDatabaseName(":memory:");
+    db.open();
+
+    // which athletes have a metricDB we can read?
+    foreach(QString name, root.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+
+        QString path = root.absoluteFilePath(name) + "/metricDBv3";
+        if (!QFile(path).exists()) continue;
+
+        QSqlQuery query(db);
+        query.prepare("ATTACH DATABASE ? AS athlete;");
+        query.addBindValue(path);
+        if (!query.exec()) continue;
+
+        query.exec("SELECT schema_version FROM athlete.version WHERE table_name = 'metrics';");
+        if (query.next() && query.value(0).toInt() == DBSchemaVersion) {
+            names << name;
+            paths << path;
+        }
+        query.finish();
+        query.exec("DETACH DATABASE athlete;");
+    }
+}
+
+TeamMetrics::~TeamMetrics()
+{
+    QSqlDatabase::database(sessionid).close();
+    QSqlDatabase::removeDatabase(sessionid);
+}
+
+QList<TeamMetricResult>
+TeamMetrics::aggregate(QString symbol, QDate from, QDate to, Aggregation how, bool byDay)
+{
+    QList<TeamMetricResult> returning;
+
+    // the symbol becomes a column name so it must be one of ours
+    if (!RideMetricFactory::instance().haveMetric(symbol)) return returning;
+
+    // open ended ranges
+    if (from.isNull()) from = QDate(1900, 1, 1);
+    if (to.isNull()) to = QDate(2100, 12, 31);
+
+    QString function;
+    switch (how) {
+    default:
+    case Sum: function = "SUM"; break;
+    case Average: function = "AVG"; break;
+    case Max: function = "MAX"; break;
+    case Min: function = "MIN"; break;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database(sessionid);
+
+    for (int first=0; first < paths.count(); first += attachBatch) {
+
+        int last = qMin(first + attachBatch, paths.count());
+
+        // attach this batch
+        QStringList attached, selects;
+        for (int i=first; i<last; i++) {
+            QSqlQuery attach(db);
+            attach.prepare(QString("ATTACH DATABASE ? AS a%1;").arg(i));
+            attach.addBindValue(paths[i]);
+            if (!attach.exec()) continue;
+            attached << QString("a%1").arg(i);
+
+            // the athlete index comes back in the first column
+            selects << QString("SELECT %1, %2, %3(X%4), COUNT(*) FROM a%1.metrics "
+                               "WHERE DATE(ride_date) >= DATE('%5') AND DATE(ride_date) <= DATE('%6') "
+                               "AND X%4 IS NOT NULL%7")
+                       .arg(i)
+                       .arg(byDay ? "DATE(ride_date)" : "NULL")
+                       .arg(function)
+                       .arg(symbol)
+                       .arg(from.toString(Qt::ISODate))
+                       .arg(to.toString(Qt::ISODate))
+                       .arg(byDay ? " GROUP BY DATE(ride_date)" : "");
+        }
+
+        // and query it all at once
+        if (selects.count()) {
+            QSqlQuery query(db);
+            if (query.exec(selects.join(" UNION ALL ") + ";")) {
+                while (query.next()) {
+                    if (query.value(3).toInt() == 0) continue; // no rides in range
+
+                    TeamMetricResult add;
+                    add.athlete = names[query.value(0).toInt()];
+                    add.date = query.value(1).toDate();
+                    add.value = query.value(2).toDouble();
+                    add.rides = query.value(3).toInt();
+                    returning << add;
+                }
+            }
+        }
+
+        foreach(QString name, attached) {
+            QSqlQuery detach(db);
+            detach.exec(QString("DETACH DATABASE %1;").arg(name));
+        }
+    }
+    return returning;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_TeamMetrics_h
+#define _GC_TeamMetrics_h 1
+#include "GoldenCheetah.h"
+
+#include <QDir>
+#include <QDate>
+#include <QStringList>
+#include <QtSql>
+
+// one row of a query across the team, for one athlete and, when
+// asked for by day, one day
+struct TeamMetricResult
+{
+    QString athlete;
+    QDate date;         // null unless grouped by day
+    double value;
+    int rides;          // how many rides went into value
+};
+
+// Read-only queries over the metric databases of every athlete under
+// a directory, without opening the athletes themselves. The databases
+// are attached to one in-memory connection a batch at a time and a
+// single statement aggregates each batch, so only the results come
+// back rather than any SummaryMetrics or RideItems.
+//
+// Athletes whose metricDB was built by another version are skipped
+// since their columns may not match the metric factory.
+class TeamMetrics
+{
+    public:
+
+        enum aggregation { Sum, Average, Max, Min };
+        typedef enum aggregation Aggregation;
+
+        TeamMetrics(QDir root); // the directory holding the athlete homes
+        ~TeamMetrics();
+
+        QStringList athletes() const { return names; }
+
+        // symbol as in the RideMetricFactory, e.g. "coggan_tss"
+        QList<TeamMetricResult> aggregate(QString symbol, QDate from, QDate to,
+                                          Aggregation how, bool byDay = false);
+
+    private:
+        QString sessionid;
+        QStringList names, paths; // athletes with a current metricDB
+};
+#endif // _GC_TeamMetrics_h
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TelemetryPublisher.h"
+#include "TrainRider.h"
+#include "Settings.h"
+
+#include <QUdpSocket>
+#include <string.h>
+
+TelemetryPublisher::TelemetryPublisher(QObject *parent)
+    : QThread(parent), snapshotSize(0), frames(0), port(0), msecs(1000)
+{
+}
+
+TelemetryPublisher::~TelemetryPublisher()
+{
+    stop();
+}
+
+void
+TelemetryPublisher::start()
+{
+    if (isRunning() || !appsettings->value(NULL, TRAIN_PUBLISH, false).toBool()) return;
+
+    address = QHostAddress(appsettings->value(NULL, TRAIN_PUBLISH_ADDRESS, "239.255.67.67").toString());
+    port = appsettings->value(NULL, TRAIN_PUBLISH_PORT, 5467).toInt();
+    msecs = qMax(50, appsettings->value(NULL, TRAIN_PUBLISH_MSECS, 1000).toInt());
+    if (address.isNull() || port == 0) return;
+
+    stopping = 0;
+    QThread::start(QThread::LowPriority);
+}
+
+void
+TelemetryPublisher::stop()
+{
+    stopping = 1;
+    wait();
+}
+
+static void put16(unsigned char *at, int value)
+{
+    quint16 v = qBound(0, value, 0xffff);
+    at[0] = v & 0xff;
+    at[1] = v >> 8;
+}
+
+static void put32(unsigned char *at, qint64 value)
+{
+    quint32 v = qBound(qint64(0), value, qint64(0xffffffff));
+    for (int i=0; i<4; i++) at[i] = (v >> (8*i)) & 0xff;
+}
+
+void
+TelemetryPublisher::encode(unsigned char *at, const RealtimeData &rtData, const QString &name, double distance)
+{
+    memset(at, 0, riderSize);
+    QByteArray utf8 = name.toUtf8().left(16);
+    memcpy(at, utf8.constData(), utf8.size());
+
+    put32(at + 16, rtData.getMsecs());
+    put32(at + 20, rtData.getLapMsecs());
+    put32(at + 24, qRound64(distance * 1000));
+    put16(at + 28, qRound(rtData.getWatts()));
+    put16(at + 30, qRound(rtData.getLoad()));
+    put16(at + 32, qRound(rtData.getSpeed() * 100));
+    put16(at + 34, rtData.getLap());
+    at[36] = qBound(0, qRound(rtData.getHr()), 255);
+    at[37] = qBound(0, qRound(rtData.getCadence()), 255);
+}
+
+void
+TelemetryPublisher::publish(const RealtimeData &rtData, const QString &name, double distance,
+                            const QList<TrainRider*> &riders)
+{
+    if (!isRunning()) return;
+
+    int count = riders.isEmpty() ? 1 : qMin(int(maxRiders), riders.count());
+
+    version.ref(); // odd, the sender waits
+    memcpy(snapshot, "GCRT", 4);
+    snapshot[4] = 1;
+    snapshot[5] = count;
+    put16(snapshot + 6, ++frames);
+
+    if (riders.isEmpty()) encode(snapshot + headerSize, rtData, name, distance);
+    else for (int i=0; i<count; i++)
+        encode(snapshot + headerSize + i * riderSize, riders[i]->rtData, riders[i]->name, riders[i]->distance);
+
+    snapshotSize = headerSize + count * riderSize;
+    version.ref(); // even, done
+}
+
+void
+TelemetryPublisher::run()
+{
+    QUdpSocket socket;
+    socket.setSocketOption(QAbstractSocket::MulticastTtlOption, 1); // the studio, not beyond
+
+    unsigned char datagram[sizeof(snapshot)];
+    int sent = 0; // the version last sent
+    while (!stopping) {
+        msleep(msecs);
+
+        // copy it out, and again if it changed meanwhile
+        int before, after, size;
+        do {
+            before = version.fetchAndAddAcquire(0);
+            size = snapshotSize;
+            memcpy(datagram, snapshot, sizeof(datagram));
+            after = version.fetchAndAddAcquire(0);
+        } while ((before & 1) || before != after);
+
+        // only new telemetry, not whilst paused
+        if (before == sent || size == 0) continue;
+        sent = before;
+
+        socket.writeDatagram(reinterpret_cast<const char *>(datagram), size, address, port);
+    }
+}
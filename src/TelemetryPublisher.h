@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_TelemetryPublisher_h
+#define _GC_TelemetryPublisher_h 1
+#include "GoldenCheetah.h"
+
+#include "RealtimeData.h"
+#include <QThread>
+#include <QAtomicInt>
+#include <QHostAddress>
+#include <QList>
+
+class TrainRider;
+
+// Sends the latest telemetry of each rider as UDP datagrams, normally to a
+// multicast group, for leaderboards and the like on other screens. The train
+// sidebar hands over each sample and it is encoded into a snapshot there
+// and then; the publisher's own thread sends the snapshot at its own rate
+// and never blocks the sidebar, so a slow network can't hold up the devices.
+//
+// Each datagram is "GCRT", a version byte (1), the number of riders and a
+// 16 bit sequence number, then for each rider 40 bytes, little endian:
+//
+//     name       16 bytes utf8, zero padded
+//     msecs      32 bits, time in the session
+//     lap msecs  32 bits
+//     distance   32 bits, metres
+//     watts      16 bits
+//     load       16 bits, watts asked of the trainer
+//     speed      16 bits, 0.01 km/h
+//     lap        16 bits
+//     heartrate   8 bits
+//     cadence     8 bits
+//     reserved   16 bits
+class TelemetryPublisher : public QThread
+{
+    public:
+        TelemetryPublisher(QObject *parent);
+        ~TelemetryPublisher();
+
+        // from settings, only publishes if enabled there
+        void start();
+        void stop();
+
+        // on the gui thread, riders is empty when there is only us, distance is km
+        void publish(const RealtimeData &rtData, const QString &name, double distance,
+                     const QList<TrainRider*> &riders);
+
+        static const int maxRiders = 8;
+        static const int headerSize = 8;
+        static const int riderSize = 40;
+
+    protected:
+        void run();
+
+    private:
+        void encode(unsigned char *at, const RealtimeData &rtData, const QString &name, double distance);
+
+        // the newest datagram, a sequence lock: odd whilst it
+        // is being written, the reader copies and checks it again
+        QAtomicInt version;
+        unsigned char snapshot[headerSize + maxRiders * riderSize];
+        int snapshotSize;
+        quint16 frames;
+
+        QHostAddress address;
+        quint16 port;
+        int msecs;
+        QAtomicInt stopping;
+};
+
+#endif // _GC_TelemetryPublisher_h
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TelemetryScheduler.h"
+#include <QTimer>
+#include <QMetaObject>
+
+TelemetryScheduler::TelemetryScheduler(QObject *parent) : QObject(parent), pending(false), coalesced(0)
+{
+}
+
+void
+TelemetryScheduler::subscribe(QWidget *window, const char *slot, int msecs,
+                              QList<RealtimeData::DataSeries> series, bool always)
+{
+    unsubscribe(window);
+
+    Subscriber add;
+    add.window = window;
+    add.slot = slot;
+    add.msecs = msecs;
+    add.series = series;
+    add.always = always;
+    subscribers << add;
+}
+
+void
+TelemetryScheduler::unsubscribe(QWidget *window)
+{
+    for (int i=0; i<subscribers.count(); i++) {
+        if (subscribers[i].window == window) {
+            subscribers.removeAt(i);
+            return;
+        }
+    }
+}
+
+void
+TelemetryScheduler::update(const RealtimeData &rtData)
+{
+    latest = rtData;
+    coalesced++;
+
+    // more may arrive before we get back to the event loop
+    // they all go out together as the latest values
+    if (!pending) {
+        pending = true;
+        QTimer::singleShot(0, this, SLOT(deliver()));
+    }
+}
+
+void
+TelemetryScheduler::deliver()
+{
+    pending = false;
+
+    QElapsedTimer took;
+    took.start();
+    stats.arrived();
+    stats.queued(coalesced);
+    coalesced = 0;
+
+    for (int i=0; i<subscribers.count(); i++) {
+
+        Subscriber &s = subscribers[i];
+
+        // window has gone
+        if (s.window.isNull()) {
+            subscribers.removeAt(i--);
+            continue;
+        }
+
+        if (!s.always) {
+
+            // nobody is looking
+            if (!s.window->isVisible()) continue;
+
+            // not due yet
+            if (s.msecs && !s.last.isNull() && s.last.elapsed() < s.msecs) continue;
+
+            // does it show anything that changed?
+            if (s.series.count()) {
+                bool changed = s.sent.count() != s.series.count();
+                s.sent.resize(s.series.count());
+                for (int j=0; j<s.series.count(); j++) {
+                    double value = latest.value(s.series[j]);
+                    if (s.sent[j] != value) {
+                        s.sent[j] = value;
+                        changed = true;
+                    }
+                }
+                if (!changed) continue;
+            }
+        }
+
+        s.last.start();
+        QMetaObject::invokeMethod(s.window, s.slot.constData(), Qt::DirectConnection,
+                                  Q_ARG(RealtimeData, latest));
+    }
+
+    stats.took(took.nsecsElapsed() / 1000);
+}
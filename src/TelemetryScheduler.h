@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_TelemetryScheduler_h
+#define _GC_TelemetryScheduler_h 1
+#include "GoldenCheetah.h"
+
+#include "RealtimeData.h"
+#include "DeviceStats.h"
+#include <QObject>
+#include <QWidget>
+#include <QPointer>
+#include <QTime>
+#include <QList>
+#include <QVector>
+
+// Delivers telemetry to the train view windows. The train sidebar
+// publishes a sample every refresh and each window says how often
+// it wants them and which series it shows. Samples are coalesced
+// and delivered in one pass once control returns to the event loop,
+// windows that are hidden, not due or whose series have not changed
+// are skipped.
+//
+// Windows that accumulate (averages, history plots) subscribe with
+// always set so they see every sample regardless.
+class TelemetryScheduler : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        TelemetryScheduler(QObject *parent);
+
+        // slot is the method name, e.g. "telemetryUpdate" which must
+        // take a RealtimeData, msecs of 0 means as often as we get them
+        // and no series means deliver even if nothing has changed.
+        // subscribing again replaces the previous subscription
+        void subscribe(QWidget *window, const char *slot, int msecs = 0,
+                       QList<RealtimeData::DataSeries> series = QList<RealtimeData::DataSeries>(),
+                       bool always = false);
+        void unsubscribe(QWidget *window);
+
+        // latest sample published
+        const RealtimeData &current() const { return latest; }
+
+        // how often we deliver, how long it takes and how many
+        // samples were coalesced each time
+        DeviceStats stats;
+
+    public slots:
+
+        void update(const RealtimeData &rtData); // a new sample
+        void deliver();                          // send to those due
+
+    private:
+
+        struct Subscriber {
+            QPointer<QWidget> window;
+            QByteArray slot;
+            int msecs;
+            QList<RealtimeData::DataSeries> series;
+            bool always;
+
+            QTime last;             // when we last delivered
+            QVector<double> sent;   // series values last delivered
+        };
+        QList<Subscriber> subscribers;
+
+        RealtimeData latest;
+        bool pending;
+        int coalesced;
+};
+
+#endif // _GC_TelemetryScheduler_h
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_TelemetrySnapshot_h
+#define _GC_TelemetrySnapshot_h 1
+#include "GoldenCheetah.h"
+
+#include <QAtomicInt>
+#include <QThread>
+
+// A seqlock for handing telemetry from a device thread to the GUI, the
+// disk writer and the load controller without either side blocking.
+//
+// There is a single writer, the device thread, which bumps the sequence
+// to odd whilst it copies in the latest values and back to even once it
+// is done. Readers copy the values out and try again if the sequence
+// was odd or changed underneath them, so they always get a consistent
+// set and the device thread never waits on a slow GUI frame.
+//
+// T must be plain data that is safe to copy whilst being overwritten
+// since a torn copy is thrown away, RealtimeData is fine.
+template <class T>
+class TelemetrySnapshot
+{
+    public:
+        TelemetrySnapshot() : sequence(0) {}
+
+        // device thread only
+        void publish(const T &latest) {
+            sequence.fetchAndAddOrdered(1); // odd, being written
+            data = latest;
+            sequence.fetchAndAddOrdered(1); // even, consistent again
+        }
+
+        // any thread
+        T read() const {
+            T copy;
+            forever {
+                int before = sequence.fetchAndAddOrdered(0);
+                if (before & 1) {
+                    QThread::yieldCurrentThread(); // mid-write
+                    continue;
+                }
+                copy = data;
+                if (sequence.fetchAndAddOrdered(0) == before) return copy;
+            }
+        }
+
+    private:
+        mutable QAtomicInt sequence;
+        T data;
+};
+
+// Button presses are latched by the device thread and cleared when
+// the controller reads them so a press between two reads isn't lost
+class TelemetryButtons
+{
+    public:
+        TelemetryButtons() : buttons(0) {}
+
+        // device thread, set these bits
+        void press(int bits) {
+            forever {
+                int current = buttons;
+                if ((current & bits) == bits || buttons.testAndSetOrdered(current, current | bits)) return;
+            }
+        }
+
+        // controller, take what has been pressed since last time
+        int take() { return buttons.fetchAndStoreOrdered(0); }
+
+    private:
+        QAtomicInt buttons;
+};
+
+#endif // _GC_TelemetrySnapshot_h
@@ -20,9 +20,62 @@
 #include "RideMetric.h"
 #include "BestIntervalDialog.h"
 #include "Zones.h"
+#include "ZoneLookup.h"
 #include <math.h>
 #include <QApplication>
 
+// Time in every power zone from one pass over the ride, the ZoneTime
+// metrics below each take their zone from here instead of each scanning
+// the ride and searching the zones for every sample
+class ZoneTimes : public RideMetric {
+    Q_DECLARE_TR_FUNCTIONS(ZoneTimes)
+
+    public:
+
+    QVector<double> seconds; // by zone
+
+    ZoneTimes()
+    {
+        setSymbol("time_in_zones");
+        setDependsOn(RideMetric::PowerZone);
+        setInternalName("Time in Zones");
+        setType(RideMetric::Total);
+        setAggregate(false);
+    }
+    void initialize ()
+    {
+        setName(tr("Time in Zones"));
+        setMetricUnits("seconds");
+        setImperialUnits("seconds");
+    }
+
+    double secondsIn(int level) const {
+        return (level >= 0 && level < seconds.count()) ? seconds[level] : 0;
+    }
+
+    void compute(const RideFile *ride, const Zones *zone, int zoneRange,
+                 const HrZones *, int,
+                 const QHash<QString,RideMetric*> &,
+                 const Context *)
+    {
+        seconds.clear();
+        if (zone && zoneRange >= 0) {
+            seconds.fill(0, zone->numZones(zoneRange));
+
+            ZoneLookup<Zones> lookup(zone, zoneRange);
+            foreach(const RideFilePoint *point, ride->dataPoints()) {
+                int level = lookup.whichZone(point->watts);
+                if (level >= 0 && level < seconds.count()) seconds[level] += ride->recIntSecs();
+            }
+        }
+        setValue(0); // only meaningful to the ZoneTime metrics
+    }
+
+    bool canAggregate() { return false; }
+    void aggregateWith(const RideMetric &) {}
+    RideMetric *clone() const { return new ZoneTimes(*this); }
+};
+
 class ZoneTime : public RideMetric {
     Q_DECLARE_TR_FUNCTIONS(ZoneTime)
     int level;
@@ -42,20 +95,13 @@ class ZoneTime : public RideMetric {
         setConversion(1.0);
     }
     void setLevel(int level) { this->level=level-1; } // zones start from zero not 1
-    void compute(const RideFile *ride, const Zones *zone, int zoneRange,
+    void compute(const RideFile *, const Zones *, int,
                  const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
+                 const QHash<QString,RideMetric*> &deps,
                  const Context *)
     {
-        seconds = 0;
-        // get zone ranges
-        if (zone && zoneRange >= 0) {
-            // iterate and compute
-            foreach(const RideFilePoint *point, ride->dataPoints()) {
-                if (zone->whichZone(zoneRange, point->watts) == level)
-                    seconds += ride->recIntSecs();
-            }
-        }
+        const ZoneTimes *kernel = dynamic_cast<ZoneTimes*>(deps.value("time_in_zones", NULL));
+        seconds = kernel ? kernel->secondsIn(level) : 0;
         setValue(seconds);
     }
 
@@ -676,17 +722,20 @@ class ZonePTime10 : public RideMetric {
 };
 
 static bool addAllZones() {
-    RideMetricFactory::instance().addMetric(ZoneTime1());
-    RideMetricFactory::instance().addMetric(ZoneTime2());
-    RideMetricFactory::instance().addMetric(ZoneTime3());
-    RideMetricFactory::instance().addMetric(ZoneTime4());
-    RideMetricFactory::instance().addMetric(ZoneTime5());
-    RideMetricFactory::instance().addMetric(ZoneTime6());
-    RideMetricFactory::instance().addMetric(ZoneTime7());
-    RideMetricFactory::instance().addMetric(ZoneTime8());
-    RideMetricFactory::instance().addMetric(ZoneTime9());
-    RideMetricFactory::instance().addMetric(ZoneTime10());
+    RideMetricFactory::instance().addMetric(ZoneTimes());
     QVector<QString> deps;
+    deps.append("time_in_zones");
+    RideMetricFactory::instance().addMetric(ZoneTime1(), &deps);
+    RideMetricFactory::instance().addMetric(ZoneTime2(), &deps);
+    RideMetricFactory::instance().addMetric(ZoneTime3(), &deps);
+    RideMetricFactory::instance().addMetric(ZoneTime4(), &deps);
+    RideMetricFactory::instance().addMetric(ZoneTime5(), &deps);
+    RideMetricFactory::instance().addMetric(ZoneTime6(), &deps);
+    RideMetricFactory::instance().addMetric(ZoneTime7(), &deps);
+    RideMetricFactory::instance().addMetric(ZoneTime8(), &deps);
+    RideMetricFactory::instance().addMetric(ZoneTime9(), &deps);
+    RideMetricFactory::instance().addMetric(ZoneTime10(), &deps);
+    deps.clear();
     deps.append("time_in_zone_L1");
     deps.append("workout_time");
     RideMetricFactory::instance().addMetric(ZonePTime1(), &deps);
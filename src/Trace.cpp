@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "Trace.h"
+
+#ifdef GC_HAVE_TRACE
+
+#include <QMutex>
+#include <QVector>
+#include <QFile>
+#include <QTextStream>
+#include <QHash>
+#include <QThread>
+
+volatile bool GcTrace::recording = false;
+QElapsedTimer GcTrace::clock;
+
+// what we record, spans have a duration and counters a value
+struct GcTraceEvent {
+    const char *name;
+    qint64 ts, dur;     // microseconds, dur < 0 for a counter
+    double value;
+    quintptr tid;
+};
+
+static QMutex traceLock;
+static QVector<GcTraceEvent> events;
+static const int maxEvents = 2000000; // ~80MB, stops a forgotten recording eating memory
+
+void
+GcTrace::start()
+{
+    QMutexLocker locker(&traceLock);
+    events.clear();
+    clock.start();
+    recording = true;
+}
+
+void
+GcTrace::span(const char *name, qint64 start, qint64 end)
+{
+    GcTraceEvent add;
+    add.name = name;
+    add.ts = start;
+    add.dur = end - start;
+    add.value = 0;
+    add.tid = quintptr(QThread::currentThreadId());
+
+    QMutexLocker locker(&traceLock);
+    if (events.count() < maxEvents) events.append(add);
+}
+
+void
+GcTrace::counter(const char *name, double value)
+{
+    GcTraceEvent add;
+    add.name = name;
+    add.ts = now();
+    add.dur = -1;
+    add.value = value;
+    add.tid = quintptr(QThread::currentThreadId());
+
+    QMutexLocker locker(&traceLock);
+    if (events.count() < maxEvents) events.append(add);
+}
+
+// names are literals from our own code but be safe
+static QString escaped(const char *name)
+{
+    QString returning = QString::fromLatin1(name);
+    returning.replace("\\", "\\\\");
+    returning.replace("\"", "\\\"");
+    return returning;
+}
+
+bool
+GcTrace::stop(QString filename)
+{
+    recording = false;
+
+    QMutexLocker locker(&traceLock);
+
+    QFile file(filename);
+    if (filename.isEmpty() || !file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+        events.clear();
+        events.squeeze();
+        return false;
+    }
+    QTextStream out(&file);
+
+    // the trace event format, threads are numbered in order of appearance
+    // after the GUI thread, which is the one that stops the recording
+    QHash<quintptr, int> threads;
+    threads.insert(quintptr(QThread::currentThreadId()), 1);
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GoldenCheetah\"}}";
+    for (int i=0; i<events.count(); i++) {
+        const GcTraceEvent &e = events[i];
+        int tid = threads.value(e.tid, 0);
+        if (tid == 0) {
+            tid = threads.count() + 1;
+            threads.insert(e.tid, tid);
+        }
+        if (e.dur >= 0)
+            out << QString(",\n{\"name\":\"%1\",\"ph\":\"X\",\"pid\":1,\"tid\":%2,\"ts\":%3,\"dur\":%4}")
+                   .arg(escaped(e.name)).arg(tid).arg(e.ts).arg(e.dur);
+        else
+            out << QString(",\n{\"name\":\"%1\",\"ph\":\"C\",\"pid\":1,\"tid\":%2,\"ts\":%3,\"args\":{\"value\":%4}}")
+                   .arg(escaped(e.name)).arg(tid).arg(e.ts).arg(e.value, 0, 'g', 10);
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    out.flush();
+    file.close();
+
+    events.clear();
+    events.squeeze();
+    return true;
+}
+
+#endif // GC_HAVE_TRACE
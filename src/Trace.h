@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef _GC_Trace_h
+#define _GC_Trace_h 1
+#include "GoldenCheetah.h"
+
+// Performance tracing, written out as Chrome trace / Perfetto JSON so the
+// recording can be loaded into chrome://tracing or ui.perfetto.dev
+//
+// Only compiled in when gcconfig.pri sets GC_TRACE, otherwise the macros
+// below are empty. Even then nothing is recorded until it is switched on
+// from the Help menu, so the cost is a flag test per span.
+//
+//    GC_TRACE_SPAN("open ride");            // until the end of the scope
+//    GC_TRACE_COUNTER("rides open", count); // a value plotted over time
+//
+// Names must be string literals (or otherwise outlive the recording).
+
+#ifdef GC_HAVE_TRACE
+
+#include <QString>
+#include <QElapsedTimer>
+
+class GcTrace
+{
+    public:
+        static void start();                    // clears anything recorded before
+        static bool stop(QString filename);     // writes the JSON, false if it couldn't (or no filename)
+        static bool isRecording() { return recording; }
+
+        // microseconds since the recording started
+        static qint64 now() { return clock.nsecsElapsed() / 1000; }
+
+        static void span(const char *name, qint64 start, qint64 end);
+        static void counter(const char *name, double value);
+
+    private:
+        static volatile bool recording;
+        static QElapsedTimer clock;
+};
+
+class GcTraceSpan
+{
+    public:
+        GcTraceSpan(const char *name) : name(name), start(GcTrace::isRecording() ? GcTrace::now() : -1) {}
+        ~GcTraceSpan() { if (start >= 0 && GcTrace::isRecording()) GcTrace::span(name, start, GcTrace::now()); }
+
+    private:
+        const char *name;
+        qint64 start;
+};
+
+#define GC_TRACE_NAME_(line) gcTraceSpan ## line
+#define GC_TRACE_NAME(line) GC_TRACE_NAME_(line)
+#define GC_TRACE_SPAN(name) GcTraceSpan GC_TRACE_NAME(__LINE__)(name)
+#define GC_TRACE_COUNTER(name, value) do { if (GcTrace::isRecording()) GcTrace::counter(name, value); } while(0)
+
+#else
+
+#define GC_TRACE_SPAN(name)
+#define GC_TRACE_COUNTER(name, value)
+
+#endif // GC_HAVE_TRACE
+#endif // _GC_Trace_h
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TrackSimplifier.h"
+#include "RideFile.h"
+#include "Settings.h"
+
+#include <QStack>
+#include <QPair>
+#include <math.h>
+
+double
+TrackSimplifier::exportTolerance()
+{
+    double tolerance = appsettings->value(NULL, GC_EXPORT_SIMPLIFY, 0.0).toDouble();
+    return tolerance > 0 ? tolerance : 0;
+}
+
+QVector<bool>
+TrackSimplifier::keep(const RideFile *ride, double toleranceMetres)
+{
+    const QVector<RideFilePoint*> &points = ride->dataPoints();
+    QVector<bool> returning(points.count(), false);
+
+    // the points with a position, projected onto a plane in metres, an
+    // equirectangular projection is plenty for the length of a ride
+    QVector<int> index;
+    QVector<double> x, y;
+    double lat0 = 0;
+    for (int i=0; i<points.count(); i++) {
+        if (!points[i]->lat || !points[i]->lon) continue;
+        if (index.isEmpty()) lat0 = points[i]->lat * M_PI / 180.0;
+        index << i;
+        x << points[i]->lon * M_PI / 180.0 * cos(lat0) * 6371000.0;
+        y << points[i]->lat * M_PI / 180.0 * 6371000.0;
+    }
+    if (index.isEmpty()) return returning;
+
+    if (toleranceMetres <= 0 || index.count() < 3) {
+        foreach (int i, index) returning[i] = true;
+        return returning;
+    }
+
+    // iterative rather than recursive, a long ride would go deep
+    QVector<bool> kept(index.count(), false);
+    kept[0] = kept[index.count()-1] = true;
+
+    QStack<QPair<int,int> > todo;
+    todo.push(QPair<int,int>(0, index.count()-1));
+    while (!todo.isEmpty()) {
+
+        QPair<int,int> span = todo.pop();
+        int first = span.first, last = span.second;
+        if (last - first < 2) continue;
+
+        double dx = x[last] - x[first], dy = y[last] - y[first];
+        double length = sqrt(dx*dx + dy*dy);
+
+        // furthest point from the chord
+        int furthest = -1;
+        double max = 0;
+        for (int i=first+1; i<last; i++) {
+            double distance;
+            if (length > 0) distance = fabs(dy * x[i] - dx * y[i] + x[last] * y[first] - y[last] * x[first]) / length;
+            else distance = sqrt((x[i]-x[first])*(x[i]-x[first]) + (y[i]-y[first])*(y[i]-y[first]));
+            if (distance > max) {
+                max = distance;
+                furthest = i;
+            }
+        }
+
+        if (furthest >= 0 && max > toleranceMetres) {
+            kept[furthest] = true;
+            todo.push(QPair<int,int>(first, furthest));
+            todo.push(QPair<int,int>(furthest, last));
+        }
+    }
+
+    for (int i=0; i<index.count(); i++) if (kept[i]) returning[index[i]] = true;
+    return returning;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_TrackSimplifier_h
+#define _GC_TrackSimplifier_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+
+class RideFile;
+
+//
+// Douglas-Peucker simplification of the GPS track, used by the
+// track exporters (KML, KMZ and GPX) when writing for course planning
+// tools that have no use for a point every second.
+//
+// Returns a flag per data point, true for the points to keep. Points
+// without a position are never kept. A tolerance of zero keeps every
+// point that has a position.
+//
+class TrackSimplifier
+{
+    public:
+        static QVector<bool> keep(const RideFile *ride, double toleranceMetres);
+
+        // the tolerance configured for exports, 0 when off
+        static double exportTolerance();
+};
+
+#endif // _GC_TrackSimplifier_h
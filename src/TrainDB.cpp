@@ -24,8 +24,10 @@
 // Revision History
 // Rev Date         Who                What Changed
 // 01  21 Dec 2012  Mark Liversedge    Initial Build
+// 02  14 Oct 2026  GoldenCheetah      Workout file size and modified time for incremental rescans
+// 03  14 Oct 2026  GoldenCheetah      Parsed workout profiles cached alongside the workouts
 
-static int TrainDBSchemaVersion = 1;
+static int TrainDBSchemaVersion = 3;
 TrainDB *trainDB;
 
 TrainDB::TrainDB(QDir home) : home(home)
@@ -78,6 +80,13 @@ TrainDB::rebuildDB()
 {
     dropWorkoutTable();
     createWorkoutTable();
+    rebuildVideos();
+}
+
+// the videos aren't parsed so they are just found afresh
+void
+TrainDB::rebuildVideos()
+{
     dropVideoTable();
     createVideoTable();
 }
@@ -158,10 +167,16 @@ bool TrainDB::createWorkoutTable()
                                     "coggan_tss integer,"
                                     "coggan_if integer,"
                                     "elevation integer,"
-                                    "grade double );";
+                                    "grade double,"
+                                    "filesize integer,"
+                                    "modified integer );";
 
         rc = query.exec(createMetricTable);
 
+        // the parsed profiles live in their own table so the
+        // workout list model doesn't drag the blobs around
+        query.exec("create table profiles (filepath varchar primary key, profile blob);");
+
         // adding a space at the front of string to make manual mode always
         // appear first in a sorted list is a bit of a hack, but works ok
         QString manualErg = QString("INSERT INTO workouts (filepath, filename) values (\"//1\", \"%1\");")
@@ -194,6 +209,9 @@ bool TrainDB::dropVideoTable()
 
 bool TrainDB::dropWorkoutTable()
 {
+    QSqlQuery profiles("DROP TABLE profiles", dbconn);
+    profiles.exec();
+
     QSqlQuery query("DROP TABLE workouts", dbconn);
     bool rc = query.exec();
     return rc;
@@ -301,12 +319,33 @@ bool TrainDB::deleteWorkout(QString pathname)
     QDateTime timestamp = QDateTime::currentDateTime();
 
     // zap the current row - if there is one
+    query.prepare("DELETE FROM profiles WHERE filepath = ?;");
+    query.addBindValue(pathname);
+    query.exec();
+
     query.prepare("DELETE FROM workouts WHERE filepath = ?;");
     query.addBindValue(pathname);
 
     return query.exec();
 }
 
+QHash<QString, TrainDBStamp> TrainDB::workoutStamps()
+{
+    QHash<QString, TrainDBStamp> stamps;
+
+    // the manual modes have no file
+    QSqlQuery query("SELECT filepath, filesize, modified FROM workouts WHERE filesize IS NOT NULL;", dbconn);
+    if (query.exec()) {
+        while (query.next()) {
+            TrainDBStamp stamp;
+            stamp.size = query.value(1).toLongLong();
+            stamp.modified = query.value(2).toUInt();
+            stamps.insert(query.value(0).toString(), stamp);
+        }
+    }
+    return stamps;
+}
+
 bool TrainDB::importWorkout(QString pathname, ErgFile *ergFile)
 {
 	QSqlQuery query(dbconn);
@@ -328,7 +367,9 @@ bool TrainDB::importWorkout(QString pathname, ErgFile *ergFile)
                                     "coggan_tss,"
                                     "coggan_if,"
                                     "elevation,"
-                                    "grade ) values ( ?,?,?,?,?,?,?,?,?,?,? );";
+                                    "grade,"
+                                    "filesize,"
+                                    "modified ) values ( ?,?,?,?,?,?,?,?,?,?,?,?,? );";
 	query.prepare(insertStatement);
 
     // filename, timestamp, ride date
@@ -344,12 +385,48 @@ bool TrainDB::importWorkout(QString pathname, ErgFile *ergFile)
 	query.addBindValue(ergFile->ELE);
 	query.addBindValue(ergFile->GRADE);
 
+    // so a rescan can tell if it has changed
+    QFileInfo info(pathname);
+    query.addBindValue(info.size());
+    query.addBindValue(info.lastModified().toTime_t());
+
     // go do it!
 	bool rc = query.exec();
 
+    // and the parsed profile for selecting it later
+    query.prepare("DELETE FROM profiles WHERE filepath = ?;");
+    query.addBindValue(pathname);
+    query.exec();
+
+    QByteArray profile = ergFile->profile();
+    if (rc && !profile.isEmpty()) {
+        query.prepare("INSERT INTO profiles (filepath, profile) values (?,?);");
+        query.addBindValue(pathname);
+        query.addBindValue(profile);
+        query.exec();
+    }
+
 	return rc;
 }
 
+QByteArray TrainDB::workoutProfile(QString pathname)
+{
+    QSqlQuery query(dbconn);
+    query.prepare("SELECT profiles.profile, workouts.filesize, workouts.modified FROM profiles, workouts "
+                  "WHERE profiles.filepath = ? AND workouts.filepath = profiles.filepath;");
+    query.addBindValue(pathname);
+
+    if (query.exec() && query.next()) {
+
+        // only if the file hasn't been touched since it was imported
+        TrainDBStamp stamp;
+        stamp.size = query.value(1).toLongLong();
+        stamp.modified = query.value(2).toUInt();
+        if (stamp.matches(QFileInfo(pathname))) return query.value(0).toByteArray();
+    }
+    return QByteArray();
+}
+
 bool TrainDB::deleteVideo(QString pathname)
 {
 	QSqlQuery query(dbconn);
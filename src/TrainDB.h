@@ -22,10 +22,24 @@
 #include "GoldenCheetah.h"
 #include <QMessageBox>
 #include <QDir>
+#include <QFileInfo>
 #include <QHash>
 #include <QtSql>
 
 class ErgFile;
+
+// what a workout file looked like when it was imported
+struct TrainDBStamp
+{
+    TrainDBStamp() : size(0), modified(0) {}
+    bool matches(const QFileInfo &info) const {
+        return size == info.size() && modified == info.lastModified().toTime_t();
+    }
+
+    qint64 size;
+    uint modified;
+};
+
 class TrainDB : public QObject
 {
 
@@ -52,12 +66,15 @@ class TrainDB : public QObject
 
     bool importWorkout(QString pathname, ErgFile *ergFile);
     bool deleteWorkout(QString pathname);
+    QHash<QString, TrainDBStamp> workoutStamps(); // by filepath
+    QByteArray workoutProfile(QString pathname); // empty if missing or stale
 
     bool importVideo(QString pathname);
     bool deleteVideo(QString pathname);
 
     // drop and recreate tables
     void rebuildDB();
+    void rebuildVideos();
 
     signals:
         void dataChanged();
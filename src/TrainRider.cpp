@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TrainRider.h"
+#include "RealtimeController.h"
+#include "SessionRecorder.h"
+#include "RideFile.h"
+
+#include <QRegExp>
+
+TrainRider::TrainRider(QString name, int device) :
+    name(name), device(device), intensity(100), distance(0), recorder(NULL)
+{
+}
+
+TrainRider::~TrainRider()
+{
+    if (recorder) delete recorder;
+}
+
+void TrainRider::update(RealtimeController *controller, long msecs, long lapmsecs, int lap, double secs)
+{
+    RealtimeData local = rtData;
+    controller->getRealtimeData(local);
+
+    // one device supplies everything for a rider
+    local.setMsecs(msecs);
+    local.setLapMsecs(lapmsecs);
+    local.setLap(lap);
+
+    distance += local.getSpeed() * secs / 3600;
+    local.setDistance(distance);
+
+    rtData = local;
+}
+
+bool TrainRider::startRecording(QDir riders, const QDateTime &start)
+{
+    if (recorder) delete recorder;
+
+    // a folder for each rider, named after the device
+    QString folder = QString(name).replace(QRegExp("[^A-Za-z0-9_-]"), "_");
+    riders.mkpath(folder);
+    path = riders.absoluteFilePath(folder);
+
+    recordStart = start;
+    recorder = new SessionRecorder(path + "/" + start.toString(QString("yyyy_MM_dd_hh_mm_ss")) + QString(".gcrec"));
+    if (recorder->open()) return true;
+
+    delete recorder;
+    recorder = NULL;
+    return false;
+}
+
+bool TrainRider::saveRecording(Context *context)
+{
+    if (!recorder) return false;
+    recorder->close();
+
+    // every series comes from our device
+    QVector<int> sources(SessionRecorder::Lap+1, device);
+    sources[SessionRecorder::Lap] = SessionRecorder::Sidebar;
+
+    RideFile *ride = recorder->rideFile(recordStart, sources);
+    if (!ride) return false;
+
+    ride->setTag("Athlete", name);
+
+    QFile out(path + "/" + recordStart.toString(QString("yyyy_MM_dd_hh_mm_ss")) + QString(".json"));
+    bool success = RideFileFactory::instance().writeRideFile(context, ride, out, "json");
+    delete ride;
+
+    if (success) recorder->remove();
+    return success;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_TrainRider_h
+#define _GC_TrainRider_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QDateTime>
+#include <QDir>
+#include "RealtimeData.h"
+
+class RealtimeController;
+class SessionRecorder;
+class Context;
+
+// In multi-rider mode each selected device (typically an ANT+ stick
+// pairing one rider's sensors, or a trainer) is a rider of its own with
+// its own telemetry, workout intensity and recording, so a studio can
+// drive all its trainers from a single session.
+//
+// The first rider is the one shown on the dials and plots as before,
+// the rest are shown together on the Riders chart.
+class TrainRider
+{
+    public:
+        TrainRider(QString name, int device);
+        ~TrainRider();
+
+        QString name;
+        int device;             // index into the sidebar Devices
+        int intensity;          // percentage of the workout load or gradient
+
+        RealtimeData rtData;    // latest telemetry
+        double distance;        // km, from speed at each update
+
+        // fetch the latest telemetry from our device
+        void update(RealtimeController *controller, long msecs, long lapmsecs, int lap, double secs);
+
+        // what this rider should get from the workout
+        double load(double workoutLoad) const { return workoutLoad * intensity / 100.0; }
+        double gradient(double workoutGradient) const { return workoutGradient * intensity / 100.0; }
+
+        // recording, rides for riders other than the athlete are saved
+        // into a folder for each rider in the riders folder of the home
+        SessionRecorder *recorder;
+        bool startRecording(QDir riders, const QDateTime &start);
+        bool saveRecording(Context *context);
+
+    private:
+        QDateTime recordStart;
+        QString path;
+};
+
+#endif // _GC_TrainRider_h
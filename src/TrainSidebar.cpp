@@ -19,18 +19,22 @@
 #include "TrainSidebar.h"
 #include "MainWindow.h"
 #include "Context.h"
+#include "Trace.h"
 #include "Athlete.h"
 #include "Settings.h"
 #include "Colors.h"
 #include "Units.h"
 #include "DeviceTypes.h"
 #include "DeviceConfiguration.h"
+#include "RideFile.h"
+#include "Zones.h"
 #include <QApplication>
 #include <QtGui>
 #include <QRegExp>
 
 // Three current realtime device types supported are:
 #include "RealtimeController.h"
+#include "DeviceStats.h"
 #include "ComputrainerController.h"
 #include "ANTlocalController.h"
 #include "NullController.h"
@@ -55,10 +59,12 @@
 #include "TrainDB.h"
 #include "Library.h"
 
-TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(context)
+TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(context), metrics(double(REFRESHRATE) / 1000.0)
 {
     setInstanceName("Train Controls");
 
+    publisher = new TelemetryPublisher(this);
+
     QWidget *c = new QWidget;
     //c->setContentsMargins(0,0,0,0); // bit of space is useful
     QVBoxLayout *cl = new QVBoxLayout(c);
@@ -69,6 +75,7 @@ TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(contex
 
     // don't set the source for telemetry
     bpmTelemetry = wattsTelemetry = kphTelemetry = rpmTelemetry = -1;
+    multiRider = false;
 
 #if defined Q_OS_MAC || defined GC_HAVE_VLC
     videoModel = new QSqlTableModel(this, trainDB->connection());
@@ -348,31 +355,29 @@ intensity->hide(); //XXX!!! temporary
 
     // now the GUI is setup lets sort our control variables
     gui_timer = new QTimer(this);
-    disk_timer = new QTimer(this);
     load_timer = new QTimer(this);
+    load_timer->setSingleShot(true); // loadUpdate() says when it wants the next
+    loadRate = LOADRATE;
+    loadLead = 0;
 
     session_time = QTime();
     session_elapsed_msec = 0;
     lap_time = QTime();
     lap_elapsed_msec = 0;
 
-    recordFile = NULL;
+    recorder = NULL;
     status = 0;
     status |= RT_MODE_ERGO;         // ergo mode by default
     mode = ERG;
 
     displayWorkoutLap = displayLap = 0;
-    pwrcount = 0;
-    cadcount = 0;
-    hrcount = 0;
-    spdcount = 0;
-    lodcount = 0;
     load_msecs = total_msecs = lap_msecs = 0;
+    statsShown = -1;
+    sequence = 0;
     displayWorkoutDistance = displayDistance = displayPower = displayHeartRate =
     displaySpeed = displayCadence = slope = load = 0;
 
     connect(gui_timer, SIGNAL(timeout()), this, SLOT(guiUpdate()));
-    connect(disk_timer, SIGNAL(timeout()), this, SLOT(diskUpdate()));
     connect(load_timer, SIGNAL(timeout()), this, SLOT(loadUpdate()));
 
     configChanged(); // will reset the workout tree
@@ -546,6 +551,7 @@ void
 TrainSidebar::deviceTreeWidgetSelectionChanged()
 {
     bpmTelemetry = wattsTelemetry = kphTelemetry = rpmTelemetry = -1;
+    multiRider = false;
     deviceSelected();
 }
 
@@ -571,6 +577,16 @@ TrainSidebar::devices()
     return returning;
 }
 
+// which rider does this device belong to, if we have riders
+TrainRider *
+TrainSidebar::riderFor(int dev)
+{
+    foreach(TrainRider *rider, riders)
+        if (rider->device == dev)
+            return rider;
+    return NULL;
+}
+
 /*----------------------------------------------------------------------
  * Workout Selected
  *--------------------------------------------------------------------*/
@@ -610,7 +626,7 @@ TrainSidebar::workoutTreeWidgetSelectionChanged()
         //ergPlot->setVisible(false);
     } else {
         // workout mode
-        ergFile = new ErgFile(filename, mode, context);
+        ergFile = new ErgFile(filename, mode, context, trainDB->workoutProfile(filename));
         if (ergFile->isValid()) {
 
             status |= RT_WORKOUT;
@@ -754,9 +770,9 @@ void TrainSidebar::Start()       // when start button is pressed
         status &=~RT_PAUSED;
         foreach(int dev, devices()) Devices[dev].controller->restart();
         gui_timer->start(REFRESHRATE);
-        if (status & RT_RECORDING) disk_timer->start(SAMPLERATE);
+        if (status & RT_RECORDING) recorder->resume();
         load_period.restart();
-        if (status & RT_WORKOUT) load_timer->start(LOADRATE);
+        if (status & RT_WORKOUT) startLoad();
 
 #if defined Q_OS_MAC || defined GC_HAVE_VLC
         mediaTree->setEnabled(false);
@@ -775,7 +791,7 @@ void TrainSidebar::Start()       // when start button is pressed
         foreach(int dev, devices()) Devices[dev].controller->pause();
         status |=RT_PAUSED;
         gui_timer->stop();
-        if (status & RT_RECORDING) disk_timer->stop();
+        if (status & RT_RECORDING) recorder->pause();
         if (status & RT_WORKOUT) load_timer->stop();
         load_msecs += load_period.restart();
 
@@ -802,10 +818,23 @@ void TrainSidebar::Start()       // when start button is pressed
         } else if (deviceTree->selectedItems().count() == 1) {
             bpmTelemetry = wattsTelemetry = kphTelemetry = rpmTelemetry =
             deviceTree->selectedItems().first()->type();
+            multiRider = false;
         } else {
             return;
         }
 
+        // one rider per device, the first one is us and is
+        // shown on the dials and plots as usual
+        qDeleteAll(riders);
+        riders.clear();
+        if (multiRider) {
+            QList<int> devs = devices();
+            bpmTelemetry = wattsTelemetry = kphTelemetry = rpmTelemetry = devs.first();
+            riders << new TrainRider(context->athlete->cyclist, devs.first());
+            for (int i=1; i<devs.count(); i++) riders << new TrainRider(Devices[devs[i]].name, devs[i]);
+        }
+        context->notifyRidersUpdate(riders);
+
 #if defined Q_OS_MAC || defined GC_HAVE_VLC
         mediaTree->setEnabled(false);
 #endif
@@ -818,6 +847,11 @@ void TrainSidebar::Start()       // when start button is pressed
         load = 0;
         slope = 0.0;
 
+        // how often to update the load, in Hz, and how far ahead of
+        // the workout to run to make up for the trainer's own lag
+        loadRate = 1000 / qBound(1, appsettings->value(this, TRAIN_LOADRATE, 1000/LOADRATE).toInt(), 1000/LOADMINRATE);
+        loadLead = qBound(0, appsettings->value(this, TRAIN_LOADLEAD, 0).toInt(), 5000);
+
         if (mode == ERG || mode == MRC) {
             status |= RT_MODE_ERGO;
             status &= ~RT_MODE_SPIN;
@@ -828,6 +862,36 @@ void TrainSidebar::Start()       // when start button is pressed
             foreach(int dev, devices()) Devices[dev].controller->setMode(RT_MODE_SPIN);
         }
 
+        if (recordSelector->isChecked()) {
+            status |= RT_RECORDING;
+        }
+
+        if (status & RT_RECORDING) {
+
+            // raw samples from the devices are recorded as they arrive
+            // and converted into a ride when we stop
+            recordStart = QDateTime::currentDateTime();
+            QString filename = recordStart.toString(QString("yyyy_MM_dd_hh_mm_ss")) + QString(".gcrec");
+
+            QString fulltarget = context->athlete->home.absolutePath() + "/" + filename;
+            if (recorder) delete recorder;
+            recorder = new SessionRecorder(fulltarget);
+            recordedLap = -1;
+
+            if (!recorder->open()) {
+                status &= ~RT_RECORDING;
+            } else {
+                foreach(int dev, devices()) Devices[dev].controller->setRecorder(recorder, dev);
+
+                // the other riders record alongside
+                QDir riderHome(context->athlete->home.absolutePath() + "/riders");
+                for (int i=1; i<riders.count(); i++) {
+                    if (riders[i]->startRecording(riderHome, recordStart))
+                        Devices[riders[i]->device].controller->setRecorder(riders[i]->recorder, riders[i]->device);
+                }
+            }
+        }
+
         foreach(int dev, devices()) Devices[dev].controller->start();
 
         // tell the world
@@ -843,35 +907,26 @@ void TrainSidebar::Start()       // when start button is pressed
         lap_elapsed_msec = 0;
         calibrating = false;
 
-        if (status & RT_WORKOUT) {
-            load_timer->start(LOADRATE);      // start recording
-        }
+        statsShown = -1;
+        context->telemetry->stats.reset();
 
-        if (recordSelector->isChecked()) {
-            status |= RT_RECORDING;
+        // streaming metrics use the CP and W' for today
+        double cp = 0, wprime = 0;
+        if (context->athlete->zones()) {
+            int zonerange = context->athlete->zones()->whichRange(QDateTime::currentDateTime().date());
+            if (zonerange >= 0) {
+                cp = context->athlete->zones()->getCP(zonerange);
+                wprime = context->athlete->zones()->getWprime(zonerange);
+            }
         }
+        metrics.reset(cp, wprime);
 
-        if (status & RT_RECORDING) {
-            QDateTime now = QDateTime::currentDateTime();
-
-            // setup file
-            QString filename = now.toString(QString("yyyy_MM_dd_hh_mm_ss")) + QString(".csv");
-
-            QString fulltarget = context->athlete->home.absolutePath() + "/" + filename;
-            if (recordFile) delete recordFile;
-            recordFile = new QFile(fulltarget);
-            if (!recordFile->open(QFile::WriteOnly | QFile::Truncate)) {
-                status &= ~RT_RECORDING;
-            } else {
-
-                // CSV File header
-
-                QTextStream recordFileStream(recordFile);
-                recordFileStream << "Minutes,Torq (N-m),Km/h,Watts,Km,Cadence,Hrate,ID,Altitude (m)\n";
-                disk_timer->start(SAMPLERATE);  // start screen
-            }
+        if (status & RT_WORKOUT) {
+            startLoad();
         }
+
         gui_timer->start(REFRESHRATE);      // start recording
+        publisher->start();                 // if other screens want it
 
     }
 }
@@ -888,9 +943,9 @@ void TrainSidebar::Pause()        // pause capture to recalibrate
         status &=~RT_PAUSED;
         foreach(int dev, devices()) Devices[dev].controller->restart();
         gui_timer->start(REFRESHRATE);
-        if (status & RT_RECORDING) disk_timer->start(SAMPLERATE);
+        if (status & RT_RECORDING) recorder->resume();
         load_period.restart();
-        if (status & RT_WORKOUT) load_timer->start(LOADRATE);
+        if (status & RT_WORKOUT) startLoad();
 
 #if defined Q_OS_MAC || defined GC_HAVE_VLC
         mediaTree->setEnabled(false);
@@ -906,7 +961,7 @@ void TrainSidebar::Pause()        // pause capture to recalibrate
         foreach(int dev, devices()) Devices[dev].controller->pause();
         status |=RT_PAUSED;
         gui_timer->stop();
-        if (status & RT_RECORDING) disk_timer->stop();
+        if (status & RT_RECORDING) recorder->pause();
         if (status & RT_WORKOUT) load_timer->stop();
         load_msecs += load_period.restart();
 
@@ -938,28 +993,56 @@ void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
     foreach(int dev, devices()) Devices[dev].controller->stop();
 
     gui_timer->stop();
+    publisher->stop();
     calibrating = false;
 
+    // keep the timings for when riders report lag
+    logDeviceStats();
+
     load = 0;
     slope = 0.0;
 
     QDateTime now = QDateTime::currentDateTime();
 
     if (status & RT_RECORDING) {
-        disk_timer->stop();
 
-        // close and reset File
-        recordFile->close();
+        // no more samples
+        foreach(int dev, devices()) Devices[dev].controller->setRecorder(NULL, 0);
+        recorder->close();
+        status &= ~RT_RECORDING;
 
         if(deviceStatus == DEVICE_ERROR)
         {
-            recordFile->remove();
+            recorder->remove();
+            for (int i=1; i<riders.count(); i++) if (riders[i]->recorder) riders[i]->recorder->remove();
         }
         else {
-            // add to the view - using basename ONLY
-            QString name;
-            name = recordFile->fileName();
-            context->athlete->addRide(QFileInfo(name).fileName(), true);
+            // take each series from the device it was shown from
+            QVector<int> sources(SessionRecorder::Lap+1, SessionRecorder::Sidebar);
+            sources[SessionRecorder::Watts] = wattsTelemetry;
+            sources[SessionRecorder::AltWatts] = wattsTelemetry;
+            sources[SessionRecorder::LRBalance] = wattsTelemetry;
+            sources[SessionRecorder::HeartRate] = bpmTelemetry;
+            sources[SessionRecorder::Cadence] = rpmTelemetry;
+            sources[SessionRecorder::Speed] = kphTelemetry;
+
+            RideFile *ride = recorder->rideFile(recordStart, sources);
+            if (ride) {
+                QString basename = recordStart.toString(QString("yyyy_MM_dd_hh_mm_ss")) + QString(".json");
+                QFile out(context->athlete->home.absolutePath() + "/" + basename);
+
+                // add to the view - using basename ONLY
+                // the recording is kept alongside when it has the
+                // pedal stroke in it since the ride can't hold that
+                if (RideFileFactory::instance().writeRideFile(context, ride, out, "json")) {
+                    if (!recorder->hasSpinScan()) recorder->remove();
+                    context->athlete->addRide(basename, true);
+                }
+                delete ride;
+            }
+
+            // the other riders aren't us, so they're saved but not added
+            for (int i=1; i<riders.count(); i++) riders[i]->saveRecording(context);
         }
     }
 
@@ -983,11 +1066,6 @@ void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
 
     // Re-enable gui elements
     // reset counters etc
-    pwrcount = 0;
-    cadcount = 0;
-    hrcount = 0;
-    spdcount = 0;
-    lodcount = 0;
     displayWorkoutLap = displayLap =0;
     session_elapsed_msec = 0;
     session_time.restart();
@@ -1018,6 +1096,7 @@ void TrainSidebar::updateData(RealtimeData &rtData)
 
 void TrainSidebar::guiUpdate()           // refreshes the telemetry
 {
+    GC_TRACE_SPAN("train gui tick");
     RealtimeData rtData;
     rtData.setLap(displayLap + displayWorkoutLap); // user laps + predefined workout lap
     rtData.mode = mode;
@@ -1048,12 +1127,17 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
             // fetch the right data from each device...
             foreach(int dev, devices()) {
 
+                // other riders devices are theirs
+                if (riders.count() && riderFor(dev) != riders[0]) continue;
+
                 RealtimeData local = rtData;
                 Devices[dev].controller->getRealtimeData(local);
 
                 // get spinscan data from a computrainer?
                 if (Devices[dev].type == DEV_CT) {
                     memcpy((uint8_t*)rtData.spinScan, (uint8_t*)local.spinScan, 24);
+                    memcpy(rtData.spinScanRevs, local.spinScanRevs, sizeof(rtData.spinScanRevs));
+                    rtData.spinScanRevCount = local.spinScanRevCount;
                     rtData.setLoad(local.getLoad()); // and get load in case it was adjusted
                     rtData.setSlope(local.getSlope()); // and get slope in case it was adjusted
                     // to within defined limits
@@ -1078,6 +1162,13 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
                 }
             }
 
+            // laps go in the recording alongside the raw samples
+            if ((status&RT_RECORDING) && rtData.getLap() != recordedLap) {
+                recordedLap = rtData.getLap();
+                recorder->newLap(recordedLap);
+                for (int i=1; i<riders.count(); i++) if (riders[i]->recorder) riders[i]->recorder->newLap(recordedLap);
+            }
+
             // Distance assumes current speed for the last second. from km/h to km/sec
             displayDistance += displaySpeed / (5 * 3600); // assumes 200ms refreshrate
             displayWorkoutDistance += displaySpeed / (5 * 3600); // assumes 200ms refreshrate
@@ -1139,10 +1230,32 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
 
             rtData.setVirtualSpeed(vs);
 
+            // metrics and averages, one sample per refresh, the
+            // dials show them rather than keeping their own sums
+            metrics.update(rtData);
+            metrics.apply(rtData);
 
             // go update the displays...
+            rtData.setSequence(++sequence);
             context->notifyTelemetryUpdate(rtData); // signal everyone to update telemetry
 
+            // device timings in the device tree every 5 seconds or so
+            if (total_msecs / 5000 != statsShown) {
+                statsShown = total_msecs / 5000;
+                showDeviceStats();
+            }
+
+            // and the other riders
+            if (riders.count()) {
+                riders[0]->rtData = rtData;
+                riders[0]->distance = displayDistance;
+                for (int i=1; i<riders.count(); i++)
+                    riders[i]->update(Devices[riders[i]->device].controller, total_msecs, lap_msecs,
+                                      rtData.getLap(), double(REFRESHRATE) / 1000.0);
+                context->notifyRidersUpdate(riders);
+            }
+            publisher->publish(rtData, context->athlete->cyclist, displayDistance, riders);
+
             // set now to current time when not using a workout
             // but limit to almost every second (account for
             // slight timing errors of 100ms or so)
@@ -1159,17 +1272,38 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
     }
 }
 
+void TrainSidebar::showDeviceStats()
+{
+    foreach(int dev, devices()) {
+        DeviceStats *stats = Devices[dev].controller->stats();
+        QTreeWidgetItem *item = deviceTree->invisibleRootItem()->child(dev);
+        if (stats && item) item->setToolTip(0, stats->summary());
+    }
+    deviceTree->setToolTip(tr("Display: %1").arg(context->telemetry->stats.summary()));
+}
+
+void TrainSidebar::logDeviceStats()
+{
+    QFile log(context->athlete->home.absolutePath() + "/" + "devices.log");
+    if (!log.open(QIODevice::WriteOnly | QIODevice::Append)) return;
+
+    QTextStream out(&log);
+    out << "TRAIN SESSION ENDS: " << QDateTime::currentDateTime().toString() << "\r\n";
+    foreach(int dev, devices()) {
+        DeviceStats *stats = Devices[dev].controller->stats();
+        if (stats) out << Devices[dev].name << ": " << stats->report().replace("\n", "\r\n");
+    }
+    out << "Display: " << context->telemetry->stats.report().replace("\n", "\r\n");
+    log.close();
+}
+
 // can be called from the controller - when user presses "Lap" button
 void TrainSidebar::newLap()
 {
     if ((status&RT_RUNNING) == RT_RUNNING) {
         displayLap++;
 
-        pwrcount  = 0;
-        cadcount  = 0;
-        hrcount   = 0;
-        spdcount  = 0;
-
+        metrics.newLap();
         context->notifyNewLap();
     }
 }
@@ -1191,56 +1325,51 @@ void TrainSidebar::warnnoConfig()
 }
 
 //----------------------------------------------------------------------
-// DISK UPDATE FUNCTIONS
+// WORKOUT MODE
 //----------------------------------------------------------------------
-void TrainSidebar::diskUpdate()
-{
-    double  Minutes;
 
-    long Torq = 0, Altitude = 0;
-    QTextStream recordFileStream(recordFile);
-
-    if (calibrating) return;
-
-    // convert from milliseconds to minutes
-    total_msecs = session_elapsed_msec + session_time.elapsed();
-    Minutes = total_msecs;
-    Minutes /= 1000.00;
-    Minutes *= (1.0/60);
-
-    // PowerAgent Format "Minutes,Torq (N-m),Km/h,Watts,Km,Cadence,Hrate,ID,Altitude (m)"
-    recordFileStream    << Minutes
-                        << "," << Torq
-                        << "," << displaySpeed
-                        << "," << displayPower
-                        << "," << displayDistance
-                        << "," << displayCadence
-                        << "," << displayHeartRate
-                        << "," << (displayLap + displayWorkoutLap)
-                        << "," << Altitude
-                        << "," << "\n";
+void TrainSidebar::startLoad()
+{
+    // devices may have been told something else whilst we were
+    // stopped, so everyone gets the target on the first tick
+    sentLoad.clear();
+    load_timer->start(0);
 }
 
-//----------------------------------------------------------------------
-// WORKOUT MODE
-//----------------------------------------------------------------------
+void TrainSidebar::sendLoad(int dev, double value)
+{
+    // the devices hold the last load or gradient they were given
+    // so there's no need to repeat it every tick, we only send a
+    // change big enough to make a difference
+    QHash<int, double>::const_iterator last = sentLoad.find(dev);
+    double close = (status&RT_MODE_ERGO) ? 0.5 : 0.05; // watts or % grade
+    if (last != sentLoad.end() && fabs(last.value() - value) < close) return;
+    sentLoad.insert(dev, value);
+
+    if (status&RT_MODE_ERGO) Devices[dev].controller->setLoad(value);
+    else Devices[dev].controller->setGradient(value);
+}
 
 void TrainSidebar::loadUpdate()
 {
+    GC_TRACE_SPAN("train load tick");
     int curLap;
 
     // we hold our horses whilst calibration is taking place...
     if (calibrating) return;
 
-    // the period between loadUpdate calls is not constant, and not exactly LOADRATE,
+    // the period between loadUpdate calls is not constant, and not exactly loadRate,
     // therefore, use a QTime timer to measure the load period
     load_msecs += load_period.restart();
 
+    int next = loadRate;
+
     if (status&RT_MODE_ERGO) {
         load = ergFile->wattsAt(load_msecs, curLap);
 
         if(displayWorkoutLap != curLap)
         {
+            metrics.newLap();
             context->notifyNewLap();
         }
         displayWorkoutLap = curLap;
@@ -1248,15 +1377,32 @@ void TrainSidebar::loadUpdate()
         // we got to the end!
         if (load == -100) {
             Stop(DEVICE_OK);
-        } else {
-            foreach(int dev, devices()) Devices[dev].controller->setLoad(load);
-            context->notifySetNow(load_msecs);
+            return;
+        }
+
+        // trainers take a moment to get to a new load, so they are
+        // sent the target a little ahead of where the workout is
+        double target = load;
+        long ahead = load_msecs + loadLead;
+        int aheadLap;
+        if (loadLead && ahead < ergFile->Duration) target = ergFile->wattsAt(ahead, aheadLap);
+
+        foreach(int dev, devices()) {
+            TrainRider *rider = riderFor(dev);
+            sendLoad(dev, rider ? rider->load(target) : target);
         }
+        context->notifySetNow(load_msecs);
+
+        // short intervals need the step on time, not up to a tick late
+        int step = ergFile->nextChange(ahead) - ahead;
+        if (step > 0 && step < next) next = qMax(step, LOADMINRATE);
+
     } else {
         slope = ergFile->gradientAt(displayWorkoutDistance*1000, curLap);
 
         if(displayWorkoutLap != curLap)
         {
+            metrics.newLap();
             context->notifyNewLap();
         }
         displayWorkoutLap = curLap;
@@ -1264,11 +1410,17 @@ void TrainSidebar::loadUpdate()
         // we got to the end!
         if (slope == -100) {
             Stop(DEVICE_OK);
-        } else {
-            foreach(int dev, devices()) Devices[dev].controller->setGradient(slope);
-            context->notifySetNow(displayWorkoutDistance * 1000);
+            return;
         }
+
+        foreach(int dev, devices()) {
+            TrainRider *rider = riderFor(dev);
+            sendLoad(dev, rider ? rider->gradient(slope) : slope);
+        }
+        context->notifySetNow(displayWorkoutDistance * 1000);
     }
+
+    load_timer->start(next);
 }
 
 void TrainSidebar::Calibrate()
@@ -1283,8 +1435,8 @@ void TrainSidebar::Calibrate()
         session_time.start();
         lap_time.start();
         load_period.restart();
-        if (status & RT_WORKOUT) load_timer->start(LOADRATE);
-        if (status & RT_RECORDING) disk_timer->start(SAMPLERATE);
+        if (status & RT_WORKOUT) startLoad();
+        if (status & RT_RECORDING) recorder->resume();
         context->notifyUnPause(); // get video started again, amongst other things
 
         // back to ergo/slope mode and restore load/gradient
@@ -1319,7 +1471,7 @@ void TrainSidebar::Calibrate()
         session_elapsed_msec += session_time.elapsed();
         lap_elapsed_msec += lap_time.elapsed();
 
-        if (status & RT_RECORDING) disk_timer->stop();
+        if (status & RT_RECORDING) recorder->pause();
         if (status & RT_WORKOUT) load_timer->stop();
         load_msecs += load_period.restart();
 
@@ -1509,8 +1661,9 @@ void TrainSidebar::adjustIntensity()
         last = context->currentErgFile()->Points.at(i);
     }
 
-    // recalculate metrics
+    // recalculate metrics and load lookups
     context->currentErgFile()->calculateMetrics();
+    context->currentErgFile()->index();
     setLabels();
 
     // unblock signals now we are done
@@ -1552,6 +1705,16 @@ MultiDeviceDialog::MultiDeviceDialog(Context *, TrainSidebar *traintool) : train
         kphSelect->addItem(selected->text(0), selected->type());
     }
 
+    ridersSelect = new QCheckBox(tr("One rider per device"), this);
+    ridersSelect->setChecked(traintool->multiRider);
+    mainLayout->addRow(new QLabel("Riders", this), ridersSelect);
+
+    // each rider gets everything from their own device
+    connect(ridersSelect, SIGNAL(toggled(bool)), bpmSelect, SLOT(setDisabled(bool)));
+    connect(ridersSelect, SIGNAL(toggled(bool)), wattsSelect, SLOT(setDisabled(bool)));
+    connect(ridersSelect, SIGNAL(toggled(bool)), rpmSelect, SLOT(setDisabled(bool)));
+    connect(ridersSelect, SIGNAL(toggled(bool)), kphSelect, SLOT(setDisabled(bool)));
+
     bpmSelect->addItem("None", -1);
     wattsSelect->addItem("None", -1);
     rpmSelect->addItem("None", -1);
@@ -1596,6 +1759,7 @@ MultiDeviceDialog::applyClicked()
     traintool->bpmTelemetry = bpmSelect->itemData(bpmSelect->currentIndex()).toInt();
     traintool->wattsTelemetry = wattsSelect->itemData(wattsSelect->currentIndex()).toInt();
     traintool->kphTelemetry = kphSelect->itemData(kphSelect->currentIndex()).toInt();
+    traintool->multiRider = ridersSelect->isChecked();
     accept();
 }
 
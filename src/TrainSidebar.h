@@ -27,6 +27,10 @@
 #include "DeviceTypes.h"
 #include "ErgFile.h"
 #include "ErgFilePlot.h"
+#include "RealtimeMetrics.h"
+#include "SessionRecorder.h"
+#include "TrainRider.h"
+#include "TelemetryPublisher.h"
 #include "GcSideBarItem.h"
 
 // standard stuff
@@ -52,8 +56,8 @@
 // msecs constants for timers
 #define REFRESHRATE    200 // screen refresh in milliseconds
 #define STREAMRATE     200 // rate at which we stream updates to remote peer
-#define SAMPLERATE     1000 // disk update in milliseconds
-#define LOADRATE       1000 // rate at which load is adjusted
+#define LOADRATE       250 // default rate at which load is adjusted, see TRAIN_LOADRATE
+#define LOADMINRATE    20  // never tick faster than this, even for a step
 
 // device treeview node types
 #define HEAD_TYPE    6666
@@ -108,6 +112,9 @@ class TrainSidebar : public GcWindow
         int rpmTelemetry;   // Cadence
         int kphTelemetry;   // Speed (and Distance)
 
+        // each selected device is a rider of its own
+        bool multiRider;
+
     signals:
 
         void deviceSelected();
@@ -152,7 +159,6 @@ class TrainSidebar : public GcWindow
 
         // Timed actions
         void guiUpdate();           // refreshes the telemetry
-        void diskUpdate();          // writes to CSV file
         void loadUpdate();          // sets Load on CT like devices
 
         // When no config has been setup
@@ -208,24 +214,37 @@ class TrainSidebar : public GcWindow
         int displayWorkoutLap;     // which Lap in the workout are we at?
 
         // for non-zero average calcs
-        int pwrcount, cadcount, hrcount, spdcount, lodcount, grdcount; // for NZ average calc
         int status;
         int displaymode;
 
-        QFile *recordFile;      // where we record!
+        SessionRecorder *recorder; // where we record!
+        RealtimeMetrics metrics;   // NP, XPower, W' etc as we go
+        long statsShown;           // device timings last shown in the tree
+        quint32 sequence;          // frames of telemetry sent out
+        void showDeviceStats();    // as tooltips on the device tree
+        void logDeviceStats();     // appended to devices.log
+        QList<TrainRider*> riders;  // multi-rider, the first is us
+        TelemetryPublisher *publisher; // to other screens, when enabled
+        TrainRider *riderFor(int dev);
+        QDateTime recordStart;
+        int recordedLap;
         ErgFile *ergFile;       // workout file
 
         long total_msecs,
              lap_msecs,
              load_msecs;
         QTime load_period;
+        int loadRate;           // msecs between load updates
+        int loadLead;           // msecs ahead to look to cover device lag
+        QHash<int, double> sentLoad; // last load or gradient sent to each device
+        void startLoad();
+        void sendLoad(int dev, double value);
 
         uint session_elapsed_msec, lap_elapsed_msec;
         QTime session_time, lap_time;
 
         QTimer      *gui_timer,     // refresh the gui
-                    *load_timer,    // change the load on the device
-                    *disk_timer;    // write to .CSV file
+                    *load_timer;    // change the load on the device
 
     public:
         int mode;
@@ -255,6 +274,7 @@ class MultiDeviceDialog : public QDialog
                    *wattsSelect,        // power
                    *rpmSelect,          // cadence
                    *kphSelect;          // speed
+        QCheckBox *ridersSelect;        // one rider per device
 
         QPushButton *applyButton, *cancelButton;
 };
@@ -43,6 +43,8 @@ TreeMapPlot::TreeMapPlot(TreeMapWindow *parent, Context *context)
     setInstanceName("TreeMap Plot");
 
     settings = NULL;
+    highlight = NULL;
+    version = -1;
 
     root = new TreeMap;
     setMouseTracking(true);
@@ -65,28 +67,95 @@ TreeMapPlot::configUpdate() { }
 void
 TreeMapPlot::setData(TMSettings *settings)
 {
+    this->settings = settings;
+    highlight = NULL;
     root->clear();
 
-    foreach (SummaryMetrics rideMetrics, *(settings->data)) {
+    // new data, so the columns we kept are no good
+    if (version != settings->version) {
+        version = settings->version;
+        names.clear();
+        codeOf.clear();
+        fields.clear();
+        metrics.clear();
+    }
+
+    QVector<int> codes1 = fieldCodes(settings->field1);
+    QVector<int> codes2 = fieldCodes(settings->field2);
+    QVector<double> values = metricColumn(settings->symbol);
+
+    QSet<QString> filters;
+    if (context->isfiltered) filters = context->filterSet;
+
+    // group by the two fields using their codes
+    QHash<int, TreeMap*> firsts;
+    QHash<qint64, TreeMap*> seconds;
+
+    for (int i=0; i<settings->data->count(); i++) {
 
         // don't plot if filtered
-        if (context->isfiltered && !context->filters.contains(rideMetrics.getFileName())) continue;
+        if (context->isfiltered && !filters.contains(settings->data->at(i).getFileName())) continue;
 
-        double value = rideMetrics.getForSymbol(settings->symbol);
-        QString text1 = rideMetrics.getText(settings->field1, "(unknown)");
-        QString text2 = rideMetrics.getText(settings->field2, "(unknown)");
-        if (text1 == "") text1 = "(unknown)";
-        if (text2 == "") text2 = "(unknown)";
+        TreeMap *first = firsts.value(codes1[i], NULL);
+        if (!first) {
+            first = new TreeMap(root, names[codes1[i]]);
+            root->children.append(first);
+            firsts.insert(codes1[i], first);
+        }
+
+        qint64 key = (qint64(codes1[i]) << 32) | codes2[i];
+        TreeMap *second = seconds.value(key, NULL);
+        if (!second) {
+            second = new TreeMap(first, names[codes2[i]]);
+            first->children.append(second);
+            seconds.insert(key, second);
+        }
 
-        TreeMap *first = root->insert(text1, 0.0);
-        first->insert(text2, value);
+        second->value += values[i];
+        first->value += values[i];
+        root->value += values[i];
     }
+    root->sort();
 
     // layout and paint
     resizeEvent(NULL);
     repaint();
 }
 
+const QVector<int> &
+TreeMapPlot::fieldCodes(QString field)
+{
+    QHash<QString, QVector<int> >::iterator it = fields.find(field);
+    if (it != fields.end()) return it.value();
+
+    QVector<int> codes(settings->data->count());
+    for (int i=0; i<settings->data->count(); i++) {
+        QString text = settings->data->at(i).getText(field, "(unknown)");
+        if (text == "") text = "(unknown)";
+
+        QHash<QString, int>::const_iterator code = codeOf.constFind(text);
+        if (code == codeOf.constEnd()) {
+            code = codeOf.insert(text, names.count());
+            names << text;
+        }
+        codes[i] = code.value();
+    }
+    return fields.insert(field, codes).value();
+}
+
+const QVector<double> &
+TreeMapPlot::metricColumn(QString symbol)
+{
+    QHash<QString, QVector<double> >::iterator it = metrics.find(symbol);
+    if (it != metrics.end()) return it.value();
+
+    QVector<double> values(settings->data->count());
+    for (int i=0; i<settings->data->count(); i++)
+        values[i] = settings->data->at(i).getForSymbol(symbol);
+
+    return metrics.insert(symbol, values).value();
+}
+
 void
 TreeMapPlot::resizeEvent(QResizeEvent *)
 {
@@ -92,8 +92,9 @@ class TreeMap
             // I'll take that
             this->rect = rect;
 
-            // need to sort in descending order
-            sort();
+            // children must already be sorted in descending
+            // order, see sort() above, so a resize doesn't
+            // need to sort it all over again
 
             // Use the squarified algorithm outlined
             // by Mark Bruls, Kees Huizing, and Jarke J. van Wijk
@@ -263,6 +264,17 @@ class TreeMapPlot : public QWidget
 
         TreeMap *root;      // the tree map data structure
         TreeMap *highlight; // currently needs to be highlighted
+
+        // the data dictionary encoded by field and as dense metric
+        // columns, only rebuilt when the window re-reads the data
+        const QVector<int> &fieldCodes(QString field);
+        const QVector<double> &metricColumn(QString symbol);
+
+        int version;                // settings version the columns are for
+        QStringList names;          // dictionary of field values
+        QHash<QString, int> codeOf; // and the code for each
+        QHash<QString, QVector<int> > fields;
+        QHash<QString, QVector<double> > metrics;
 };
 
 
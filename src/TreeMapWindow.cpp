@@ -135,11 +135,12 @@ TreeMapWindow::TreeMapWindow(Context *context) :
 
     // config changes or ride file activities cause a redraw/refresh (but only if active)
     connect(this, SIGNAL(rideItemChanged(RideItem*)), this, SLOT(rideSelected()));
-    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(refresh(void)));
-    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(refresh(void)));
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(invalidate(void)));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(invalidate(void)));
     connect(context, SIGNAL(filterChanged()), this, SLOT(refresh(void)));
+    connect(context->athlete->metricDB, SIGNAL(dataChanged()), this, SLOT(invalidate(void)));
 
-    connect(context, SIGNAL(configChanged()), this, SLOT(refresh()));
+    connect(context, SIGNAL(configChanged()), this, SLOT(invalidate()));
 
     // user clicked on a cell in the plot
     connect(ltmPlot, SIGNAL(clicked(QString,QString)), this, SLOT(cellClicked(QString,QString)));
@@ -150,6 +151,8 @@ TreeMapWindow::TreeMapWindow(Context *context) :
     connect(dateSetting, SIGNAL(useStandardRange()), this, SLOT(useStandardRange()));
 
     // lets refresh / setup state
+    settings.data = &results;
+    settings.version = 0;
     refresh();
 }
 
@@ -197,6 +200,13 @@ TreeMapWindow::useThruToday()
     dateRangeChanged(custom);
 }
 
+void
+TreeMapWindow::invalidate()
+{
+    dirty = true;
+    refresh();
+}
+
 // total redraw, reread data etc
 void
 TreeMapWindow::refresh()
@@ -213,6 +223,8 @@ TreeMapWindow::refresh()
             }
         }
 
+        QDate from = settings.from, to = settings.to;
+
         if (useCustom) {
             settings.from = custom.from;
             settings.to = custom.to;
@@ -228,10 +240,14 @@ TreeMapWindow::refresh()
         settings.field2 = field2->currentText();
         settings.data = &results;
 
-        // get the data
-        results.clear(); // clear any old data
-        results = context->athlete->metricDB->getAllMetricsFor(QDateTime(settings.from, QTime(0,0,0)),
-                                                   QDateTime(settings.to, QTime(0,0,0)));
+        // get the data, unless we already have it for this date range
+        if (dirty || from != settings.from || to != settings.to) {
+            results.clear(); // clear any old data
+            results = context->athlete->metricDB->getAllMetricsFor(QDateTime(settings.from, QTime(0,0,0)),
+                                                       QDateTime(settings.to, QTime(0,0,0)));
+            settings.version++;
+            dirty = false;
+        }
 
         refreshPlot();
     }
@@ -41,6 +41,7 @@ class TMSettings
         QString field1, field2;
         QDate from, to;
         QList<SummaryMetrics> *data;
+        int version; // bumped each time data is re-read
 };
 
 class TreeMapPlot;
@@ -120,6 +121,7 @@ class TreeMapWindow : public GcWindow
         void dateRangeChanged(DateRange);
         void metricTreeWidgetSelectionChanged();
         void refresh();
+        void invalidate(); // re-read data and refresh
         void fieldSelected(int);
         void cellClicked(QString, QString); // cell clicked
 
@@ -139,7 +141,7 @@ class TreeMapWindow : public GcWindow
 
         // local state
         bool active;
-        bool dirty;
+        bool dirty;        // results need to be re-read
         bool useCustom;
         bool useToToday;
         DateRange custom; // custom date range supplied
@@ -122,6 +122,11 @@ RideFile *TxtFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
         rideFile->setDeviceType("Computrainer/Velotron");
         rideFile->setFileFormat("Computrainer/Velotron text file (txt)");
 
+        // compiled once, not for every line
+        QRegExp sectionPattern("^\\[.*\\]$");
+        QRegExp unitsPattern("^UNITS += +\\(.*\\)$");
+        QRegExp sepPattern("( +|,)");
+
         while (!is.atEnd()) {
 
             // the readLine() method doesn't handle old Macintosh CR line endings
@@ -135,10 +140,6 @@ RideFile *TxtFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
             // loop through the lines we got
             foreach (QString line, lines) {
 
-                QRegExp sectionPattern("^\\[.*\\]$");
-                QRegExp unitsPattern("^UNITS += +\\(.*\\)$");
-                QRegExp sepPattern("( +|,)");
-
                 // ignore blank lines
                 if (line == "") continue;
 
@@ -349,10 +350,11 @@ RideFile *TxtFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
         // lets loop through each row of data adding a sample
         // using the indexes we set above
         double rsecs = 0;
+        QRegExp tokenSep("[\r\n\t]");
         while (!in.atEnd()) {
 
             QString line = in.readLine();
-            QStringList tokens = line.split(QRegExp("[\r\n\t]"), QString::SkipEmptyParts);
+            QStringList tokens = line.split(tokenSep, QString::SkipEmptyParts);
 
             // do we have as many columns as we expected?
             if (tokens.count() == columns) {
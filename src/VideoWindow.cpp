@@ -18,6 +18,12 @@
 
 #include "VideoWindow.h"
 #include "Context.h"
+#include "Settings.h"
+#include "ErgFile.h"
+
+// rate changes smaller than this can't be seen so aren't sent
+static const float minRateChange = 0.03;
+static const float minRate = 0.25, maxRate = 2.0;
 
 VideoWindow::VideoWindow(Context *context, const QDir &home)  :
     GcWindow(context), home(home), context(context), m_MediaChanged(false)
@@ -74,6 +80,13 @@ VideoWindow::VideoWindow(Context *context, const QDir &home)  :
      libvlc_media_player_set_hwnd (mp, container->winId());
 #endif
 
+    // follows the rider's speed on course videos
+    followSpeed = false;
+    rate = new VideoRateController(mp);
+    rate->start();
+
+    connect(context, SIGNAL(telemetryUpdate(const RealtimeData &)), this, SLOT(telemetryUpdate(const RealtimeData &)));
+    connect(context, SIGNAL(ergFileSelected(ErgFile*)), this, SLOT(ergFileSelected(ErgFile*)));
     connect(context, SIGNAL(stop()), this, SLOT(stopPlayback()));
     connect(context, SIGNAL(start()), this, SLOT(startPlayback()));
     connect(context, SIGNAL(pause()), this, SLOT(pausePlayback()));
@@ -92,6 +105,10 @@ VideoWindow::~VideoWindow()
 
     stopPlayback();
 
+    // the controller uses the player so goes first
+    rate->finish();
+    delete rate;
+
     /* No need to keep the media now */
     if (m) libvlc_media_release (m);
 
@@ -116,6 +133,8 @@ void VideoWindow::startPlayback()
 
     /* set the media to playback */
     libvlc_media_player_set_media (mp, m);
+    rate->setReferenceSpeed(appsettings->value(this, GC_VIDEO_REFSPEED, 30.0).toDouble());
+    rate->reset();
 
     /* play the media_player */
     libvlc_media_player_play (mp);
@@ -179,6 +198,13 @@ void VideoWindow::mediaSelected(QString filename)
         /* open media */
         m = libvlc_media_new_path(inst, filename.endsWith("/DVD") ? "dvd://" : fileURL.toLatin1());
 
+        // decode ahead so rate changes don't starve the decoder, and
+        // let it use the gpu when there is one to spare the cpu
+        if (m) {
+            libvlc_media_add_option(m, ":file-caching=1500");
+            libvlc_media_add_option(m, ":avcodec-hw=any");
+        }
+
         /* set the media to playback */
         if (m) libvlc_media_player_set_media (mp, m);
 
@@ -186,6 +212,79 @@ void VideoWindow::mediaSelected(QString filename)
     }
 }
 
+void VideoWindow::ergFileSelected(ErgFile *ergFile)
+{
+    // ergo workouts play at normal speed
+    followSpeed = ergFile && ergFile->format == CRS;
+    if (!followSpeed) rate->reset();
+}
+
+void VideoWindow::telemetryUpdate(const RealtimeData &rtData)
+{
+    if (followSpeed && m) rate->setSpeed(rtData.getSpeed());
+}
+
+VideoRateController::VideoRateController(libvlc_media_player_t *mp) :
+    mp(mp), refSpeed(30), target(0), following(false), finishing(false)
+{
+}
+
+void VideoRateController::setSpeed(double kph)
+{
+    QMutexLocker locker(&lock);
+    target = kph;
+    following = true;
+}
+
+void VideoRateController::reset()
+{
+    QMutexLocker locker(&lock);
+    following = false;
+    tick.wakeAll();
+}
+
+void VideoRateController::finish()
+{
+    lock.lock();
+    finishing = true;
+    tick.wakeAll();
+    lock.unlock();
+    wait();
+}
+
+void VideoRateController::run()
+{
+    float applied = 1.0;
+    double smoothed = refSpeed;
+
+    lock.lock();
+    while (!finishing) {
+
+        // at most 4 updates a second
+        tick.wait(&lock, 250);
+        if (finishing) break;
+
+        float wanted = 1.0;
+        if (following && refSpeed > 0) {
+            // exponential smoothing takes out the jitter in the speed
+            smoothed += 0.3 * (target - smoothed);
+            wanted = qBound(minRate, float(smoothed / refSpeed), maxRate);
+        } else {
+            smoothed = refSpeed;
+        }
+
+        if (qAbs(wanted - applied) >= minRateChange * applied || (wanted == 1.0 && applied != 1.0)) {
+            applied = wanted;
+
+            // libvlc can take its time, so don't hold the lock
+            lock.unlock();
+            libvlc_media_player_set_rate(mp, applied);
+            lock.lock();
+        }
+    }
+    lock.unlock();
+}
+
 MediaHelper::MediaHelper()
 {
     // construct a list of supported types
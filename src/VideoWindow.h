@@ -33,6 +33,9 @@ extern "C" {
 // QT stuff etc
 #include <QtGui>
 #include <QTimer>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
 #include "Context.h"
 #include "DeviceConfiguration.h"
 #include "DeviceTypes.h"
@@ -60,6 +63,35 @@ class MediaHelper
         libvlc_instance_t * inst;
 };
 
+// follows the rider's speed on its own thread so libvlc rate changes
+// never block the GUI, speed is smoothed and a new rate is only sent
+// when it has moved far enough to be visible
+class VideoRateController : public QThread
+{
+    public:
+
+        VideoRateController(libvlc_media_player_t *mp);
+
+        void setSpeed(double kph);        // from the telemetry, any thread
+        void setReferenceSpeed(double kph) { refSpeed = kph; }
+        void reset();                     // back to normal speed
+        void finish();                    // stop the thread
+
+    protected:
+
+        void run();
+
+    private:
+
+        libvlc_media_player_t *mp;
+        double refSpeed;                  // the speed the video was shot at
+
+        QMutex lock;
+        QWaitCondition tick;
+        double target;                    // protected by lock
+        bool following, finishing;        // protected by lock
+};
+
 class VideoWindow : public GcWindow
 {
     Q_OBJECT
@@ -79,6 +111,8 @@ class VideoWindow : public GcWindow
         void resumePlayback();
         void seekPlayback(long ms);
         void mediaSelected(QString filename);
+        void telemetryUpdate(const RealtimeData &rtData);
+        void ergFileSelected(ErgFile *);
 
     protected:
 
@@ -95,6 +129,9 @@ class VideoWindow : public GcWindow
         libvlc_media_player_t *mp;
         libvlc_media_t *m;
 
+        VideoRateController *rate;
+        bool followSpeed; // only for course videos
+
 #ifdef Q_OS_LINUX
         QX11EmbedContainer *x11Container;
 #endif
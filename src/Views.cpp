@@ -62,7 +62,7 @@ void AnalysisView::close()
 bool
 AnalysisView::isBlank()
 {
-    if (context->athlete->allRides->childCount() > 0) return false;
+    if (context->athlete->rideCount() > 0) return false;
     else return true;
 }
 
@@ -102,7 +102,7 @@ DiaryView::dateRangeChanged(DateRange dr)
 bool
 DiaryView::isBlank()
 {
-    if (context->athlete->allRides->childCount() > 0) return false;
+    if (context->athlete->rideCount() > 0) return false;
     else return true;
 }
 
@@ -135,7 +135,7 @@ HomeView::dateRangeChanged(DateRange dr)
 bool
 HomeView::isBlank()
 {
-    if (context->athlete->allRides->childCount() > 0) return false;
+    if (context->athlete->rideCount() > 0) return false;
     else return true;
 }
 
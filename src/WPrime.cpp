@@ -28,31 +28,118 @@
 // The actual code is derived from an MS Office Excel spreadsheet shared
 // privately to assist in the development of the code.
 // 
-// There is definitely room form a performance improvement from anyone
-// with a greater math expertise than this developer. I suspect that is
-// most!
+// The SUMPRODUCT from the spreadsheet is worked out recursively by
+// WPrimeBalance so the whole ride is a single pass.
 //
 
 #include "WPrime.h"
+#include "Trace.h"
+#include <QMutex>
 
-const double WprimeMultConst = 1.0;
 const int WprimeDecayPeriod = 1200; // 1200 seconds or 20 minutes
 const double E = 2.71828183;
 
 const int WprimeMatchSmoothing = 25; // 25 sec smoothing looking for matches
 const int WprimeMatchMinJoules = 100; 
 
+WPrimeBalance::WPrimeBalance(double CP, double WPRIME, double TAU) :
+    CP(CP), WPRIME(WPRIME), sumproduct(0), secs(0),
+    window(WprimeDecayPeriod, 0), recent(WprimeMatchSmoothing, 0), recentTotal(0),
+    inmatch(false), detected(false), start(0), lastAbove(0),
+    startBalance(0), lastAboveBalance(0)
+{
+    decay = TAU > 0 ? pow(E, -1.0/TAU) : 0;
+    expire = TAU > 0 ? pow(E, -double(WprimeDecayPeriod)/TAU) : 0;
+}
+
+double
+WPrimeBalance::add(double watts)
+{
+    int slot = secs % WprimeDecayPeriod;
+    double above = watts > CP ? watts - CP : 0;
+
+    // decay the sum by a second, drop the power leaving the
+    // window (decayed for the whole period) and add this second
+    sumproduct = (sumproduct * decay) - (window[slot] * expire) + above;
+    window[slot] = above;
+
+    // rounding can leave a residue once the window empties
+    if (sumproduct < 0) sumproduct = 0;
+    double bal = balance();
+
+    // trailing average used to stop short dips ending a match
+    int rslot = secs % WprimeMatchSmoothing;
+    recentTotal += watts - recent[rslot];
+    recent[rslot] = watts;
+    double smoothed = recentTotal / WprimeMatchSmoothing;
+
+    // MATCHES -- POWER > CP AND W' DEPLETED BY > WprimeMatchMinJoules
+    detected = false;
+    if (!inmatch && (smoothed >= CP || watts >= CP)) {
+        inmatch = true;
+        start = lastAbove = secs;
+        startBalance = lastAboveBalance = bal;
+    }
+
+    if (inmatch) {
+
+        if (watts >= CP) {
+            // it ends on the last raw sample above CP, to
+            // avoid smoothing artefacts
+            lastAbove = secs;
+            lastAboveBalance = bal;
+
+        } else if (smoothed < CP) {
+
+            if (lastAbove > start) {
+                Match match;
+                match.start = start;
+                match.stop = lastAbove;
+                match.secs = (match.stop-match.start) +1; // don't fencepost!
+                match.cost = startBalance - lastAboveBalance;
+
+                if (match.cost >= WprimeMatchMinJoules) {
+                    completed << match;
+                    detected = true;
+                }
+            }
+            inmatch = false;
+        }
+    }
+
+    secs++;
+    return bal;
+}
+
+// results for the last few rides worked out, keyed on the
+// ride and the CP and W' used; a checksum of the power data
+// catches rides that have been edited since
+struct WPrimeCacheEntry {
+    RideFile *ride;
+    double CP, WPRIME;
+    int points;
+    double checksum;
+
+    double TAU, minY, maxY;
+    QVector<double> values, xvalues, mvalues, mxvalues;
+    QList<Match> matches;
+};
+static QList<WPrimeCacheEntry> wprimeCache;
+static QMutex wprimeCacheLock;
+static const int WprimeCacheSize = 8;
+
 WPrime::WPrime()
 {
     // XXX will need to reset metrics when they are added
     minY = maxY = 0;
+    TAU = CP = WPRIME = 0;
+    rideFile = NULL;
 }
 
 void
 WPrime::setRide(RideFile *input)
 {
-    QTime time; // for profiling performance of the code
-    time.start();
+    GC_TRACE_SPAN("w' bal");
 
     // remember the ride for next time
     rideFile = input;
@@ -60,6 +147,9 @@ WPrime::setRide(RideFile *input)
     // reset from previous
     values.resize(0); // the memory is kept for next time so this is efficient
     xvalues.resize(0);
+    mvalues.clear();
+    mxvalues.clear();
+    matches.clear();
 
     minY = maxY = 0;
     CP = WPRIME = TAU=0;
@@ -69,35 +159,6 @@ WPrime::setRide(RideFile *input)
         return;
     }
 
-    // STEP 1: CONVERT POWER DATA TO A 1 SECOND TIME SERIES
-
-    // create a raw time series in the format QwtSpline wants
-    QVector<QPointF> points;
-    int last=0;
-    RideFilePoint *lp=NULL;
-    foreach(RideFilePoint *p, input->dataPoints()) {
-
-        // fill gaps in recording with zeroes
-        if (lp)
-            for(int t=lp->secs+input->recIntSecs();
-                t < p->secs;
-                t += input->recIntSecs())
-                points << QPointF(t, 0);
-
-        // lets not go backwards -- or two sampls at the same time
-        if ((lp && p->secs > lp->secs) || !lp)
-            points << QPointF(p->secs, p->watts);
-
-        // update state
-        last = p->secs;
-        lp = p;
-    }
-
-    // Create a spline
-    QwtSpline smoothed;
-    smoothed.setSplineType(QwtSpline::Natural);
-    smoothed.setPoints(QPolygonF(points));
-
     // Get CP
     CP = 250; // default
     if (input->context->athlete->zones()) {
@@ -106,123 +167,68 @@ WPrime::setRide(RideFile *input)
         WPRIME = zoneRange >= 0 ? input->context->athlete->zones()->getWprime(zoneRange) : 0;
     }
 
-    // since we will be running up and down the data series multiple times
-    // as we iterate and run a SUMPRODUCT it is best to extract the data
-    // into a vector of ints for the watts above CP
-    double totalBelowCP=0;
-    double countBelowCP=0;
-    QVector<int> inputArray(last+1);
-    for (int i=0; i<last; i++) {
+    // already worked out?
+    double checksum = 0;
+    foreach(RideFilePoint *p, input->dataPoints()) checksum += p->secs + p->watts;
+    int samples = input->dataPoints().count();
+    {
+        QMutexLocker locker(&wprimeCacheLock);
+        for (int i=0; i<wprimeCache.count(); i++) {
+            const WPrimeCacheEntry &entry = wprimeCache.at(i);
+            if (entry.ride == input && entry.CP == CP && entry.WPRIME == WPRIME &&
+                entry.points == samples && entry.checksum == checksum) {
+
+                TAU = entry.TAU;
+                minY = entry.minY;
+                maxY = entry.maxY;
+                values = entry.values;
+                xvalues = entry.xvalues;
+                mvalues = entry.mvalues;
+                mxvalues = entry.mxvalues;
+                matches = entry.matches;
+                return;
+            }
+        }
+    }
 
-        int value = smoothed.value(i);
-        inputArray[i] = value > CP ? value-CP : 0;
+    // STEP 1: POWER DATA AS A 1 SECOND TIME SERIES
+    const QVector<float> &power = input->resampledData(RideFile::watts);
+    int offset = input->resampledStart();
+    int last = power.count()-1;
+    if (last < 0) return;
 
-        if (value < CP) {
-            totalBelowCP += value;
+    // TAU depends upon the average power below CP
+    double totalBelowCP=0;
+    double countBelowCP=0;
+    for (int i=0; i<=last; i++) {
+        if (power[i] < CP) {
+            totalBelowCP += power[i];
             countBelowCP++;
         }
     }
 
-    TAU = 546.00f * pow(E,-0.01*(CP - (totalBelowCP/countBelowCP))) + 316.00f;
+    TAU = 546.00f * pow(E,-0.01*(CP - (countBelowCP ? totalBelowCP/countBelowCP : 0))) + 316.00f;
     TAU = int(TAU); // round it down
 
-    //qDebug()<<"data preparation took"<<time.elapsed();
-
-    // STEP 2: ITERATE OVER DATA TO CREATE W' DATA SERIES
-
-    // wipe away whatever is there
-    minY = maxY = 0;
+    // STEP 2: ITERATE OVER DATA TO CREATE W' DATA SERIES AND FIND MATCHES
     values.resize(last+1);
     xvalues.resize(last+1);
-    for(int i=last; i>=0; i--) {
+    WPrimeBalance balance(CP, WPRIME, TAU);
+    for(int i=0; i<=last; i++) {
 
         // used by AllPlot to plot the curve, we might as well
         // create it here whilst we're iterating. But bear in mind
         // that its in minutes, a bit of a legacy that one.
-        xvalues[i] = double(i)/60.00f;
-
-        // W' is a SUMPRODUCT of the previous 1200 samples
-        // of power over CP * the associated decay factor * the mult factor
-        // it will be zero for first 20 minutes
-
-        double sumproduct = 0;
-        for (int j=0; j<1200 && (i-j) > 0; j++) {
-            sumproduct += inputArray.at(i-j) * pow(E, -(double(j)/TAU)); 
-        }
-        values[i] = WPRIME - (sumproduct * WprimeMultConst);
+        xvalues[i] = double(offset+i)/60.00f;
+        values[i] = balance.add(power[i]);
 
         // min / max
         if (values[i] < minY) minY = values[i];
         if (values[i] > maxY) maxY = values[i];
     }
 
-    // STEP 3: FIND MATCHES
-
-    // SMOOTH DATA SERIES 
-
-    // get raw data adjusted to 1s intervals (as before)
-    QVector<int> smoothArray(last+1);
-    QVector<int> rawArray(last+1);
-    for (int i=0; i<last; i++) {
-        smoothArray[i] = smoothed.value(i);
-        rawArray[i] = smoothed.value(i);
-    }
-    
-    // initialise rolling average
-    double rtot = 0;
-    for (int i=WprimeMatchSmoothing; i>0 && last-i >=0; i--) {
-        rtot += smoothArray[last-i];
-    }
-
-    // now run backwards setting the rolling average
-    for (int i=last; i>=WprimeMatchSmoothing; i--) {
-        int here = smoothArray[i];
-        smoothArray[i] = rtot / WprimeMatchSmoothing;
-        rtot -= here;
-        rtot += smoothArray[i-WprimeMatchSmoothing];
-    }
-
-    // FIND MATCHES -- INTERVALS WHERE POWER > CP 
-    //                 AND W' DEPLETED BY > WprimeMatchMinJoules
-    bool inmatch=false;
-    matches.clear();
-    mvalues.clear();
-    mxvalues.clear();
-    for(int i=0; i<last; i++) {
-
-        Match match;
-
-        if (!inmatch && (smoothArray[i] >= CP || rawArray[i] >= CP)) {
-            inmatch=true;
-            match.start=i;
-        }
-
-        if (inmatch && (smoothArray[i] < CP && rawArray[i] < CP)) {
-
-            // lets work backwards as we're at the end
-            // we only care about raw data to avoid smoothing
-            // artefacts
-            int end=i-1;
-            while (end > match.start && rawArray[end] < CP) {
-                end--;
-            }
-
-            if (end > match.start) {
-
-                match.stop = end;
-                match.secs = (match.stop-match.start) +1; // don't fencepost!
-                match.cost = values[match.start] - values[match.stop];
-
-                if (match.cost >= WprimeMatchMinJoules) {
-                    matches << match;
-                }
-            }
-            inmatch=false;
-        }
-    }
-
     // SET MATCH SERIES FOR ALLPLOT CHART
-    foreach (struct Match match, matches) {
+    foreach (struct Match match, balance.matches()) {
 
         // we only count 1kj asa match
         if (match.cost >= 2000) { //XXX need to agree how to define a match -- or even if we want to...
@@ -231,7 +237,32 @@ WPrime::setRide(RideFile *input)
             mvalues << values[match.stop];
             mxvalues << xvalues[match.stop];
         }
+
+        // in ride time
+        match.start += offset;
+        match.stop += offset;
+        matches << match;
     }
+
+    // remember for next time
+    WPrimeCacheEntry entry;
+    entry.ride = input;
+    entry.CP = CP;
+    entry.WPRIME = WPRIME;
+    entry.points = samples;
+    entry.checksum = checksum;
+    entry.TAU = TAU;
+    entry.minY = minY;
+    entry.maxY = maxY;
+    entry.values = values;
+    entry.xvalues = xvalues;
+    entry.mvalues = mvalues;
+    entry.mxvalues = mxvalues;
+    entry.matches = matches;
+
+    QMutexLocker locker(&wprimeCacheLock);
+    wprimeCache.prepend(entry);
+    while (wprimeCache.count() > WprimeCacheSize) wprimeCache.removeLast();
 }
 
 //
@@ -246,6 +277,7 @@ class MinWPrime : public RideMetric {
     MinWPrime()
     {
         setSymbol("skiba_wprime_low");
+        setDependsOn(RideMetric::PowerZone); // CP and W' come from the zones
         setInternalName("Minimum W'");
     }
     void initialize() {
@@ -25,7 +25,6 @@
 #include "Zones.h"
 #include "RideMetric.h"
 #include <QVector>
-#include <qwt_spline.h> // smoothing
 #include <math.h>
 
 struct Match {
@@ -33,6 +32,46 @@ struct Match {
     int cost;                   // W' depletion
 };
 
+// W' balance one second at a time. The SUMPRODUCT of power above CP over
+// the previous WprimeDecayPeriod seconds is kept as a running sum that is
+// decayed each second, with the sample leaving the window taken off, so
+// each second costs the same however long the ride. Matches are spotted as
+// they end, so the same engine can follow a live workout.
+class WPrimeBalance {
+
+    public:
+
+        WPrimeBalance(double CP, double WPRIME, double TAU);
+
+        // add the next second of power, returns W' balance
+        double add(double watts);
+
+        // matches completed so far, matchDetected() is
+        // true when the last second added closed one
+        const QList<Match> &matches() const { return completed; }
+        bool matchDetected() const { return detected; }
+
+        double balance() const { return WPRIME - sumproduct; }
+        int seconds() const { return secs; }
+
+    private:
+
+        double CP, WPRIME;
+        double decay, expire;       // e^(-1/TAU) and e^(-period/TAU)
+        double sumproduct;
+        int secs;
+
+        QVector<double> window;     // power above CP for the decay period
+        QVector<double> recent;     // raw power for match smoothing
+        double recentTotal;
+
+        // match in progress
+        bool inmatch, detected;
+        int start, lastAbove;
+        double startBalance, lastAboveBalance;
+        QList<Match> completed;
+};
+
 class WPrime {
 
 
@@ -41,7 +80,8 @@ class WPrime {
         // construct and calculate series/metrics
         WPrime();
 
-        // recalc from ride selected
+        // recalc from ride selected, a ride already worked out
+        // with the same CP and W' comes from the cache
         void setRide(RideFile *ride);
         RideFile *ride() { return rideFile; }
 
@@ -32,6 +32,7 @@ class AverageWPK : public RideMetric {
     AverageWPK()
     {
         setSymbol("average_wpk");
+        setDependsOn(RideMetric::Weight);
         setInternalName("Watts Per Kilogram");
     }
     void initialize () {
@@ -72,6 +73,7 @@ class PeakWPK : public RideMetric {
 
     PeakWPK() : wpk(0.0), secs(0.0), weight(0.0)
     {
+        setDependsOn(RideMetric::Weight);
         setType(RideMetric::Peak);
         setMetricUnits(tr("wpk"));
         setImperialUnits(tr("wpk"));
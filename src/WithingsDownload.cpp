@@ -35,6 +35,10 @@ WithingsDownload::download()
                              .arg(appsettings->cvalue(context->athlete->cyclist, GC_WIUSER, "").toString())
                              .arg(appsettings->cvalue(context->athlete->cyclist, GC_WIKEY, "").toString());
 
+    // only what came after the last weight we have, a day
+    // early to pick up the rest of that day's readings
+    QDate last = context->athlete->metricDB->lastMeasureWith("Weight");
+    if (last.isValid()) request += QString("&startdate=%1").arg(QDateTime(last.addDays(-1)).toTime_t());
 
     QNetworkReply *reply = nam->get(QNetworkRequest(QUrl(request)));
 
@@ -58,8 +62,21 @@ WithingsDownload::downloadFinished(QNetworkReply *reply)
     QDateTime olderDate;
 
 
+    // what we already have for the days covered, in one query
+    QDateTime first, last;
     foreach (WithingsReading x, parser->readings()) {
-        QList<SummaryMetrics> list = context->athlete->metricDB->getAllMeasuresFor(x.when,x.when);
+        if (first.isNull() || x.when < first) first = x.when;
+        if (last.isNull() || x.when > last) last = x.when;
+    }
+    QMultiHash<QDate, SummaryMetrics> existing;
+    if (!first.isNull()) {
+        foreach (SummaryMetrics sm, context->athlete->metricDB->getAllMeasuresFor(first, last))
+            existing.insert(sm.getDateTime().date(), sm);
+    }
+
+    QList<SummaryMetrics> adding;
+    foreach (WithingsReading x, parser->readings()) {
+        QList<SummaryMetrics> list = existing.values(x.when.date());
         bool presentOrEmpty = false;
         for (int i=0;i<list.size();i++) {
             SummaryMetrics sm = list.at(i);
@@ -82,19 +99,24 @@ WithingsDownload::downloadFinished(QNetworkReply *reply)
             add.setText("Fat Mass", QString("%1").arg(x.fatkg));
             add.setText("Fat Ratio", QString("%1").arg(x.fatpercent));
 
-            context->athlete->metricDB->importMeasure(&add);
+            adding << add;
 
             if (olderDate.isNull() || x.when<olderDate)
                 olderDate = x.when;
         }
     }
 
+    // one transaction for the lot
+    if (adding.count()) context->athlete->metricDB->importMeasures(adding);
+
     QString status = QString(tr("%1 new on %2 measurements received.")).arg(newMeasures).arg(allMeasures);
     QMessageBox::information(context->mainWindow, tr("Withings Data Download"), status);
 
+    // the rides whose weight changed are found by the refresh, and
+    // only their W/kg metrics are recomputed
     if (!olderDate.isNull()) {
         context->athlete->isclean = false;
-        context->athlete->metricDB->refreshMetrics(olderDate);
+        context->athlete->metricDB->refreshMetrics();
     }
     return;
 }
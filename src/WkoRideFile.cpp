@@ -25,7 +25,8 @@
 #include "math.h"
 
 static int wkoFileReaderRegistered = RideFileFactory::instance().registerReader(
-                                     "wko", "WKO+ Files", new WkoFileReader());
+                                     "wko", "WKO+ Files", makeRideFileReader<WkoFileReader>, false,
+                                     QByteArray("WKO\x1a"));
 
 RideFile *WkoFileReader::openRideFile(QFile &file,
                                       QStringList &errors,
@@ -259,6 +260,7 @@ WkoParser::parseRawData(WKO_UCHAR *fb)
         errors << ("Workout is empty.");
         return NULL;
     }
+    results->reservePoints(records);
     /* how much data is there? */
     fb += doshort(fb, &us);
     if (us == 0xffff) {
@@ -1420,15 +1422,19 @@ WkoParser::get_bit(WKO_UCHAR *data, unsigned bitoffset) // returns the n-th bit
 unsigned int
 WkoParser::get_bits(WKO_UCHAR* data, unsigned bitOffset, unsigned numBits)
 {
-    unsigned int bits = 0;
-    unsigned int currentbit;
+    // the bits are numbered from the low bit of each byte, so reading
+    // them high bit first is the same as taking them from the bytes as
+    // a little endian number. Only the bytes spanned are touched (at most 5)
+    if (numBits == 0) return 0;
 
-    bits=0;
-    for (currentbit = bitOffset+numBits-1; numBits--; currentbit--) {
-        bits = bits << 1;
-        bits = bits | get_bit(data, currentbit);
-    }
-    return bits;
+    unsigned first = bitOffset >> 3;
+    unsigned shift = bitOffset & 7;
+    unsigned bytes = (shift + numBits + 7) >> 3;
+
+    quint64 word = 0;
+    for (unsigned i=0; i<bytes; i++) word |= quint64(data[first+i]) << (8*i);
+
+    return (unsigned int)((word >> shift) & ((quint64(1) << numBits) - 1));
 }
 
 /*****************************************************************************
@@ -36,7 +36,7 @@ WorkoutPlotWindow::WorkoutPlotWindow(Context *context) :
 
     connect(context, SIGNAL(setNow(long)), this, SLOT(setNow(long)));
     connect(context, SIGNAL(ergFileSelected(ErgFile*)), this, SLOT(ergFileSelected(ErgFile*)));
-    connect(context, SIGNAL(telemetryUpdate(RealtimeData)), ergPlot, SLOT(performancePlot(RealtimeData)));
+    context->telemetry->subscribe(ergPlot, "performancePlot", 0, QList<RealtimeData::DataSeries>(), true); // keeps history
     connect(context, SIGNAL(start()), ergPlot, SLOT(start()));
 }
 
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "XmlValues.h"
+#include "TimeUtils.h"
+
+double
+xmlDouble(const QString &text)
+{
+    static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                     1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+                                     1e20, 1e21, 1e22 };
+
+    const QChar *p = text.constData();
+    const QChar *end = p + text.length();
+
+    // element text may well be surrounded by whitespace
+    while (p < end && p->isSpace()) p++;
+    while (end > p && (end-1)->isSpace()) end--;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+    // up to 15 significant digits fit exactly in the mantissa, so a
+    // single division by an exact power of ten is correctly rounded
+    qint64 mantissa = 0;
+    int digits = 0, scale = 0;
+    bool point = false, any = false;
+    for (; p < end; p++) {
+        ushort c = p->unicode();
+        if (c >= '0' && c <= '9') {
+            if (mantissa || c != '0') digits++;
+            if (digits > 15) return text.toDouble();
+            mantissa = mantissa * 10 + (c - '0');
+            if (point) scale++;
+            any = true;
+        } else if (c == '.' && !point) {
+            point = true;
+        } else {
+            return text.toDouble();
+        }
+    }
+    if (!any || scale > 22) return text.toDouble();
+
+    double value = double(mantissa) / powers[scale];
+    return negative ? -value : value;
+}
+
+// two digits at a fixed position, -1 if not digits
+static int digits2(const QString &s, int i)
+{
+    ushort a = s[i].unicode(), b = s[i+1].unicode();
+    if (a < '0' || a > '9' || b < '0' || b > '9') return -1;
+    return (a - '0') * 10 + (b - '0');
+}
+
+QDateTime
+XmlTimeStamp::toLocal(const QString &timestamp)
+{
+    // yyyy-MM-ddThh:mm:ss[.fff]Z
+    int n = timestamp.length();
+    if (n < 20 || timestamp[n-1].toLower() != 'z' || timestamp[4] != '-' || timestamp[7] != '-' ||
+        timestamp[10].toUpper() != 'T' || timestamp[13] != ':' || timestamp[16] != ':')
+        return convertToLocalTime(timestamp);
+
+    int century = digits2(timestamp, 0), year = digits2(timestamp, 2);
+    int month = digits2(timestamp, 5), day = digits2(timestamp, 8);
+    int hh = digits2(timestamp, 11), mm = digits2(timestamp, 14), ss = digits2(timestamp, 17);
+    if (century < 0 || year < 0 || month < 0 || day < 0 || hh < 0 || mm < 0 || ss < 0)
+        return convertToLocalTime(timestamp);
+
+    // fractions of a second are ignored, as they are by convertToLocalTime
+    if (n > 20) {
+        if (timestamp[19] != '.') return convertToLocalTime(timestamp);
+        for (int i=20; i<n-1; i++) {
+            ushort c = timestamp[i].unicode();
+            if (c < '0' || c > '9') return convertToLocalTime(timestamp);
+        }
+    }
+
+    QDateTime utc(QDate(century * 100 + year, month, day), QTime(hh, mm, ss), Qt::UTC);
+    if (!utc.isValid()) return convertToLocalTime(timestamp);
+
+    // offset changes (daylight saving) happen on the hour
+    qint64 thishour = (qint64(utc.date().toJulianDay()) * 24) + hh;
+    if (thishour != hour) {
+        QDateTime local = utc.toLocalTime();
+        offset = utc.secsTo(QDateTime(local.date(), local.time(), Qt::UTC));
+        hour = thishour;
+    }
+
+    QDateTime wall = utc.addSecs(offset);
+    return QDateTime(wall.date(), wall.time(), Qt::LocalTime);
+}
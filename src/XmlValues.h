@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_XmlValues_h
+#define _GC_XmlValues_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QDateTime>
+
+// Helpers for the SAX parsers (TCX, GPX, Fitlog et al) that convert element
+// text and attribute values once per sample, these are called hundreds of
+// thousands of times for a long ride so they avoid the general purpose paths
+
+// plain decimals ("-12.3456") are parsed directly, anything else (exponents,
+// more than 15 significant digits) falls back to QString::toDouble. Unlike
+// strtod it is not affected by the locale so no need for setlocale()
+extern double xmlDouble(const QString &text);
+
+// ISO 8601 UTC timestamps ("2013-06-01T10:00:00.000Z") to local time. The
+// offset from UTC is worked out once per hour of the ride rather than asking
+// the OS for every trackpoint. Anything else goes to convertToLocalTime()
+class XmlTimeStamp
+{
+    public:
+        XmlTimeStamp() : hour(-1), offset(0) {}
+
+        QDateTime toLocal(const QString &timestamp);
+
+    private:
+        qint64 hour;    // UTC hour the offset was worked out for
+        int offset;     // local - UTC in seconds
+};
+
+#endif // _GC_XmlValues_h
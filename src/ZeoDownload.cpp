@@ -20,7 +20,7 @@
 #include "MainWindow.h"
 #include "Athlete.h"
 #include "MetricAggregator.h"
-#include <QScriptEngine>
+#include "JsonReader.h"
 
 ZeoDownload::ZeoDownload(Context *context) : context(context)
 {
@@ -63,38 +63,36 @@ ZeoDownload::downloadFinished(QNetworkReply *reply)
 {
     if (dates.empty()) {
         // We have to build a list of dates
-        QString response = reply->readAll();
+        QByteArray response = reply->readAll();
         //qDebug() << "response " << response;
 
-        QScriptValue sc;
-        QScriptEngine se;
+        QVariantList list = JsonReader::value(JsonReader::parse(response), "response.dateList.date").toList();
 
-        sc = se.evaluate("("+response+")").property("response").property("dateList").property("date");
-        int length = sc.property("length").toInteger();
+        // the days before the last night we have are already here
+        QDate lastNight = context->athlete->metricDB->lastMeasureWith("Sleep time");
 
         dates.clear();
-        for (int i=0;i<length;i++) {
-            QString day = sc.property(i).property("day").toString();
-            QString month = sc.property(i).property("month").toString();
-            QString year = sc.property(i).property("year").toString();
-
-            dates.append(QDate(year.toInt(), month.toInt(), day.toInt()));
+        foreach(QVariant entry, list) {
+            QVariantMap when = entry.toMap();
+            QString day = when.value("day").toString();
+            QString month = when.value("month").toString();
+            QString year = when.value("year").toString();
+
+            QDate date(year.toInt(), month.toInt(), day.toInt());
+            if (!lastNight.isValid() || date >= lastNight) dates.append(date);
         }
         allMeasures = dates.count();
     } else {
         // We have to read data for the date
-        QString response = reply->readAll();
+        QByteArray response = reply->readAll();
         //qDebug() << "response2 " << response;
 
-        QScriptValue sc;
-        QScriptEngine se;
-
-        sc = se.evaluate("("+response+")").property("response").property("sleepStats");
-        QString zq = sc.property("zq").toString();
+        QVariantMap stats = JsonReader::value(JsonReader::parse(response), "response.sleepStats").toMap();
+        QString zq = stats.value("zq").toString();
 
-        int deep = sc.property("timeInDeep").toInteger();
-        int light = sc.property("timeInLight").toInteger();
-        int rem = sc.property("timeInRem").toInteger();
+        int deep = stats.value("timeInDeep").toInt();
+        int light = stats.value("timeInLight").toInt();
+        int rem = stats.value("timeInRem").toInt();
         int time = deep + light + rem;
 
         if (dates.first() > QDate().addMonths(-1)) {
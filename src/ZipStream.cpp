@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ZipStream.h"
+#include <QDateTime>
+#include <string.h>
+
+// zip records are little endian whatever the machine
+static void le16(QByteArray &b, quint16 v) { b.append(char(v & 0xff)); b.append(char(v >> 8)); }
+static void le32(QByteArray &b, quint32 v) { le16(b, v & 0xffff); le16(b, v >> 16); }
+
+ZipStream::ZipStream(QIODevice *out, QString name) :
+    out(out), name(name.toUtf8()), started(false), failed(false), crc(0), compressed(0), uncompressed(0)
+{
+    QDateTime now = QDateTime::currentDateTime();
+    dosTime = (now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2);
+    dosDate = ((now.date().year() - 1980) << 9) | (now.date().month() << 5) | now.date().day();
+}
+
+ZipStream::~ZipStream()
+{
+    if (isOpen()) close();
+}
+
+bool
+ZipStream::open(OpenMode mode)
+{
+    if ((mode & ReadOnly) || !out->isWritable()) return false;
+
+    // raw deflate, the zip headers are our own
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    started = true;
+    crc = crc32(0L, Z_NULL, 0);
+
+    // local file header, bit 3 says the sizes follow the data
+    QByteArray header;
+    le32(header, 0x04034b50);
+    le16(header, 20);           // version needed
+    le16(header, 0x0008 | 0x0800); // data descriptor, utf-8 name
+    le16(header, 8);            // deflated
+    le16(header, dosTime);
+    le16(header, dosDate);
+    le32(header, 0);            // crc, sizes
+    le32(header, 0);
+    le32(header, 0);
+    le16(header, name.size());
+    le16(header, 0);            // no extra field
+    header.append(name);
+    put(header);
+
+    return QIODevice::open(mode | Unbuffered);
+}
+
+qint64
+ZipStream::writeData(const char *data, qint64 len)
+{
+    if (!started || failed) return -1;
+
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(data), len);
+    uncompressed += len;
+
+    strm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    strm.avail_in = len;
+    if (!deflateOut(Z_NO_FLUSH)) return -1;
+    return len;
+}
+
+bool
+ZipStream::deflateOut(int flush)
+{
+    char buffer[16384];
+    int rc;
+    do {
+        strm.next_out = reinterpret_cast<Bytef *>(buffer);
+        strm.avail_out = sizeof(buffer);
+        rc = deflate(&strm, flush);
+        if (rc == Z_STREAM_ERROR) {
+            failed = true;
+            return false;
+        }
+        int have = sizeof(buffer) - strm.avail_out;
+        compressed += have;
+        put(QByteArray::fromRawData(buffer, have));
+    } while (strm.avail_out == 0 || (flush == Z_FINISH && rc != Z_STREAM_END));
+    return !failed;
+}
+
+void
+ZipStream::put(const QByteArray &bytes)
+{
+    if (!failed && !bytes.isEmpty() && out->write(bytes) != bytes.size()) failed = true;
+}
+
+void
+ZipStream::close()
+{
+    if (started) {
+        strm.avail_in = 0;
+        deflateOut(Z_FINISH);
+        deflateEnd(&strm);
+        started = false;
+
+        quint32 offset = compressed + 30 + name.size(); // where the central directory starts
+
+        QByteArray tail;
+
+        // data descriptor
+        le32(tail, 0x08074b50);
+        le32(tail, crc);
+        le32(tail, compressed);
+        le32(tail, uncompressed);
+        offset += 16;
+
+        // central directory, one file
+        QByteArray directory;
+        le32(directory, 0x02014b50);
+        le16(directory, 20);        // made by
+        le16(directory, 20);        // needed
+        le16(directory, 0x0008 | 0x0800);
+        le16(directory, 8);
+        le16(directory, dosTime);
+        le16(directory, dosDate);
+        le32(directory, crc);
+        le32(directory, compressed);
+        le32(directory, uncompressed);
+        le16(directory, name.size());
+        le16(directory, 0);         // extra, comment, disk
+        le16(directory, 0);
+        le16(directory, 0);
+        le16(directory, 0);         // attributes
+        le32(directory, 0);
+        le32(directory, 0);         // local header offset
+        directory.append(name);
+        tail.append(directory);
+
+        // end of central directory
+        le32(tail, 0x06054b50);
+        le16(tail, 0);
+        le16(tail, 0);
+        le16(tail, 1);
+        le16(tail, 1);
+        le32(tail, directory.size());
+        le32(tail, offset);
+        le16(tail, 0);
+        put(tail);
+    }
+    QIODevice::close();
+}
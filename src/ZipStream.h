@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_ZipStream_h
+#define _GC_ZipStream_h 1
+#include "GoldenCheetah.h"
+
+#include <QIODevice>
+#include <QByteArray>
+#include <zlib.h>
+
+//
+// A zip archive holding a single file, deflated as it is written so
+// the whole of it is never in memory. This is all a KMZ needs, the
+// KML document is written through it with a QXmlStreamWriter.
+//
+// The sizes and checksum follow the data in a data descriptor since
+// they aren't known when the header is written, closing the stream
+// finishes the archive.
+//
+class ZipStream : public QIODevice
+{
+    public:
+        ZipStream(QIODevice *out, QString name);
+        ~ZipStream();
+
+        bool open(OpenMode mode);
+        void close();
+
+        // all the archive was written
+        bool ok() const { return !failed; }
+
+    protected:
+        qint64 readData(char *, qint64) { return -1; }
+        qint64 writeData(const char *data, qint64 len);
+
+    private:
+        bool deflateOut(int flush);
+        void put(const QByteArray &bytes);
+
+        QIODevice *out;
+        QByteArray name;
+        z_stream strm;
+        bool started, failed;
+        quint32 crc, compressed, uncompressed;
+        quint16 dosTime, dosDate;
+};
+
+#endif // _GC_ZipStream_h
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2026 The GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_ZoneLookup_h
+#define _GC_ZoneLookup_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <math.h>
+
+// whichZone() for every sample of a ride without searching the zones each
+// time. The zone bounds are whole numbers so a table from whole watts (or
+// bpm) to zone gives the same answer as whichZone for any value within it;
+// values beyond the highest bound fall back to whichZone. Works for both
+// Zones and HrZones.
+template <class ZoneScheme>
+class ZoneLookup
+{
+    public:
+        ZoneLookup(const ZoneScheme *zones, int range) : zones(zones), range(range) {
+
+            // the open ended top zone has a hi of INT_MAX
+            int top = 0;
+            foreach(int lo, zones->getZoneLows(range)) top = qMax(top, lo);
+            foreach(int hi, zones->getZoneHighs(range)) if (hi < maxTable) top = qMax(top, hi);
+            top = qMin(top, int(maxTable));
+
+            table.resize(top);
+            for (int i=0; i<top; i++) table[i] = zones->whichZone(range, i);
+        }
+
+        int whichZone(double value) const {
+            if (value >= 0 && value < table.size()) return table[int(value)];
+            return zones->whichZone(range, value);
+        }
+
+    private:
+        static const int maxTable = 10000;
+
+        const ZoneScheme *zones;
+        int range;
+        QVector<int> table;
+};
+
+#endif // _GC_ZoneLookup_h
@@ -820,31 +820,59 @@ int Zones::deleteRange(int rnum) {
     return rnum-1;
 }
 
-quint16
-Zones::getFingerprint() const
+static quint64
+rangeFingerprint(const ZoneRange &range)
 {
     quint64 x = 0;
-    for (int i=0; i<ranges.size(); i++) {
 
-        // from
-        x += ranges[i].begin.toJulianDay();
+    // from
+    x += range.begin.toJulianDay();
 
-        // to
-        x += ranges[i].end.toJulianDay();
+    // to
+    x += range.end.toJulianDay();
 
-        // CP
-        x += ranges[i].cp;
+    // CP
+    x += range.cp;
 
-        // W'
-        //!! will not affect metrics so not part of the
-        //!! fingerprint calculation
-        //x += ranges[i].wprime;
+    // W'
+    //!! will not affect metrics so not part of the
+    //!! fingerprint calculation
+    //x += range.wprime;
 
-        // each zone definition (manual edit/default changed)
-        for (int j=0; j<ranges[i].zones.count(); j++) {
-            x += ranges[i].zones[j].lo;
-        }
+    // each zone definition (manual edit/default changed)
+    for (int j=0; j<range.zones.count(); j++) {
+        x += range.zones[j].lo;
     }
+    return x;
+}
+
+quint16
+Zones::getFingerprint() const
+{
+    quint64 x = 0;
+    for (int i=0; i<ranges.size(); i++) x += rangeFingerprint(ranges[i]);
+
     QByteArray ba = QByteArray::number(x);
     return qChecksum(ba, ba.length()) + (appsettings->value(this, GC_ELEVATION_HYSTERESIS).toDouble()*10);
 }
+
+quint16
+Zones::getFingerprint(const QDate &forDate) const
+{
+    int range = whichRange(forDate);
+    quint64 x = range >= 0 ? rangeFingerprint(ranges[range]) : 0;
+
+    QByteArray ba = QByteArray::number(x);
+    return qChecksum(ba, ba.length()) + (appsettings->value(this, GC_ELEVATION_HYSTERESIS).toDouble()*10);
+}
+
+Zones *
+Zones::copy() const
+{
+    Zones *returning = new Zones;
+    returning->defaults_from_user = defaults_from_user;
+    returning->scheme = scheme;
+    returning->ranges = ranges;
+    returning->modificationTime = modificationTime;
+    return returning;
+}
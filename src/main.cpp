@@ -22,6 +22,9 @@
 #include "MainWindow.h"
 #include "Settings.h"
 #include "TrainDB.h"
+#include "Benchmark.h"
+#include "Batch.h"
+#include "FormulaMetric.h"
 
 #ifdef Q_OS_X11
 #include <X11/Xlib.h>
@@ -51,6 +54,15 @@ main(int argc, char *argv[])
     }
 #endif
 
+#if QT_VERSION >= 0x040500 && QT_VERSION < 0x050000
+    // dense charts (stacked ride plots, PfPv, scatter, LTM over years) are
+    // slow to rasterise on big displays, so painting can go through OpenGL.
+    // It has to be chosen before the application exists, so this applies
+    // from the next start. Printing and exporting still paint in software
+    if (appsettings->value(NULL, GC_OPENGL, false).toBool())
+        QApplication::setGraphicsSystem("opengl");
+#endif
+
     application = new QApplication(argc, argv);
 
     QFont font;
@@ -128,6 +140,10 @@ main(int argc, char *argv[])
     // Initialize metrics once the translator is installed
     RideMetricFactory::instance().initialize();
 
+    // and add the user's own, after the built in metrics they may use
+    foreach(QString error, FormulaMetric::addFormulas(home.absoluteFilePath("formulas.ini")))
+        qWarning() << "formulas.ini:" << error;
+
     // Initialize global registry once the translator is installed
     GcWindowRegistry::initialize();
 
@@ -136,6 +152,23 @@ main(int argc, char *argv[])
 
     QStringList args( application->arguments() );
 
+    // headless benchmark of readers and metrics, see Benchmark.h
+    if (args.size() > 2 && args.at(1) == "--benchmark") {
+        return Benchmark::main(home.absoluteFilePath(args.at(2)),
+                               args.size() > 3 ? args.at(3) : QString("test/rides"),
+                               args.size() > 4 ? args.at(4) : QString());
+    }
+    if (args.size() > 2 && args.at(1) == "--generate")
+        return Benchmark::generateMain(home.absoluteFilePath(args.at(2)), args.mid(3));
+    if (args.size() > 2 && args.at(1) == "--scenarios")
+        return Benchmark::scenariosMain(home.absoluteFilePath(args.at(2)), args.size() > 3 ? args.at(3) : QString());
+    if (args.size() > 2 && args.at(1) == "--render")
+        return Benchmark::renderMain(home.absoluteFilePath(args.at(2)), args.size() > 3 ? args.at(3) : QString());
+
+    // headless refresh and export, see Batch.h
+    if (args.size() > 2 && args.at(1) == "--batch")
+        return Batch::main(home.absoluteFilePath(args.at(2)), args.mid(3));
+
     QVariant lastOpened;
     if( args.size() > 1 ){
         lastOpened = args.at(1);
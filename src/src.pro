@@ -67,8 +67,6 @@ LIBS += -lm $${LIBZ_LIBS}
     INCLUDEPATH += $${KML_INCLUDE} $${BOOST_INCLUDE}
     LIBS        += $${KML_LIBS}
     DEFINES     += GC_HAVE_KML
-    SOURCES     += KmlRideFile.cpp
-    HEADERS     += KmlRideFile.h
 }
 
 !isEmpty( ICAL_INSTALL ) {
@@ -91,7 +89,17 @@ LIBS += -lm $${LIBZ_LIBS}
     INCLUDEPATH += $${LIBUSB_INCLUDE}
     LIBS        += $${LIBUSB_LIBS}
     DEFINES     += GC_HAVE_LIBUSB
-    SOURCES     += LibUsb.cpp EzUsb.c Fortius.cpp FortiusController.cpp
+    SOURCES     += EzUsb.c Fortius.cpp FortiusController.cpp
+
+    # libusb-1.0 gives asynchronous reads and hotplug
+    !isEmpty( LIBUSB_USE_V_1 ) {
+        DEFINES     += GC_HAVE_LIBUSB1
+        SOURCES     += LibUsb1.cpp
+        unix:!macx  { LIBS += -lpthread -ludev }
+        macx        { LIBS += -framework IOKit -framework CoreFoundation }
+    } else {
+        SOURCES     += LibUsb.cpp
+    }
     HEADERS     += LibUsb.h EzUsb.h Fortius.cpp FortiusController.h
 }
 
@@ -119,6 +127,11 @@ LIBS += -lm $${LIBZ_LIBS}
     }
 }
 
+# performance tracing, see Trace.h
+!isEmpty( GC_TRACE ) {
+    DEFINES     += GC_HAVE_TRACE
+}
+
 !isEmpty( CLUCENE_LIBS ) {
     INCLUDEPATH += $${CLUCENE_INCLUDE}
     LIBS        += $${CLUCENE_LIBS}
@@ -129,6 +142,15 @@ LIBS += -lm $${LIBZ_LIBS}
     LEXSOURCES  += DataFilter.l
 }
 
+# search the metadata texts in the metric database when there is no clucene
+isEmpty( CLUCENE_LIBS ):!isEmpty( GC_SQLITE_SEARCH ) {
+    DEFINES     += GC_HAVE_LUCENE GC_SQLITE_SEARCH
+    HEADERS     += Lucene.h DataFilter.h SearchBox.h NamedSearch.h SearchFilterBox.h
+    SOURCES     += LuceneSqlite.cpp DataFilter.cpp SearchBox.cpp NamedSearch.cpp SearchFilterBox.cpp
+    YACCSOURCES += DataFilter.y
+    LEXSOURCES  += DataFilter.l
+}
+
 # Mac specific build for
 # Segmented mac style button
 # Video playback using Quicktime Framework
@@ -240,11 +262,16 @@ HEADERS += \
         ANTlocalController.h \
         Athlete.h \
         BatchExportDialog.h \
+        Batch.h \
+        Benchmark.h \
+        BestEfforts.h \
         BestIntervalDialog.h \
         BinRideFile.h \
         Bin2RideFile.h \
         BingMap.h \
         BlankState.h \
+        CacheStats.h \
+        CacheStatsDialog.h \
         CalendarDownload.h \
         ChartSettings.h \
         ChooseCyclistDialog.h \
@@ -259,11 +286,13 @@ HEADERS += \
         CriticalPowerWindow.h \
         CsvRideFile.h \
         DataProcessor.h \
+        DelimitedText.h \
         DBAccess.h \
         DaysScaleDraw.h \
         Device.h \
         DeviceTypes.h \
         DeviceConfiguration.h \
+        DeviceStats.h \
         DialWindow.h \
         DiarySidebar.h \
         DownloadRideDialog.h \
@@ -274,9 +303,11 @@ HEADERS += \
         FitlogRideFile.h \
         FitlogParser.h \
         FitRideFile.h \
+        FormulaMetric.h \
         GcCalendarModel.h \
         GcCrashDialog.h \
         GcPane.h \
+        GcbRideFile.h \
         GcRideFile.h \
         GcScopeBar.h \
         GcSideBarItem.h \
@@ -288,6 +319,7 @@ HEADERS += \
         GoogleMapControl.h \
         GpxParser.h \
         GpxRideFile.h \
+        Heatmap.h \
         HelpWindow.h \
         HistogramWindow.h \
         HomeWindow.h \
@@ -295,10 +327,13 @@ HEADERS += \
         HrPwPlot.h \
         HrPwWindow.h \
         IntervalItem.h \
+        IntervalOverlay.h \
         IntervalSummaryWindow.h \
         IntervalTreeView.h \
         JouleDevice.h \
+        JsonReader.h \
         JsonRideFile.h \
+        KmlRideFile.h \
         Library.h \
         LibraryParser.h \
         LogTimeScaleDraw.h \
@@ -315,6 +350,7 @@ HEADERS += \
         LTMWindow.h \
         MacroDevice.h \
         MainWindow.h \
+        Maintenance.h \
         ManualRideDialog.h \
         ManualRideFile.h \
         MergeActivityWizard.h \
@@ -336,6 +372,7 @@ HEADERS += \
         QuarqRideFile.h \
         RawRideFile.h \
         RealtimeData.h \
+        RealtimeMetrics.h \
         RealtimePlotWindow.h \
         RealtimeController.h \
         ReferenceLineDialog.h \
@@ -343,26 +380,36 @@ HEADERS += \
         RealtimePlot.h \
         RideEditor.h \
         RideFile.h \
+        RideCache.h \
         RideFileCache.h \
+        RollingAverage.h \
         RideFileCommand.h \
         RideFileTableModel.h \
+        RideFingerprint.h \
         RideImportWizard.h \
         RideItem.h \
         RideMetadata.h \
         RideMetric.h \
         RideNavigator.h \
         RideNavigatorProxy.h \
+        RideProfile.h \
         RideWindow.h \
         SaveDialogs.h \
         SmallPlot.h \
         RideSummaryWindow.h \
+        RiderGridWindow.h \
+        ScatterDensity.h \
         ScatterPlot.h \
         ScatterWindow.h \
         Season.h \
         SeasonParser.h \
+        Segments.h \
+        SessionRecorder.h \
         Serial.h \
         Settings.h \
+        SimplifiedRoute.h \
         SpecialFields.h \
+        SpinScan.h \
         SpinScanPlot.h \
         SpinScanPolarPlot.h \
         SpinScanPlotWindow.h \
@@ -381,11 +428,15 @@ HEADERS += \
         TabView.h \
         TcxParser.h \
         TcxRideFile.h \
+        TelemetryPublisher.h \
+        TelemetryScheduler.h \
+        TelemetrySnapshot.h \
         TxtRideFile.h \
         TimeUtils.h \
         ToolsDialog.h \
         ToolsRhoEstimator.h \
         TrainDB.h \
+        TrainRider.h \
         TrainSidebar.h \
         TreeMapWindow.h \
         TreeMapPlot.h \
@@ -397,6 +448,18 @@ HEADERS += \
         WorkoutPlotWindow.h \
         WorkoutWizard.h \
         WPrime.h \
+        DeviceDiscovery.h \
+        MetricsExport.h \
+        RideFileSaver.h \
+        Trace.h \
+        IntervalDetector.h \
+        RideStatistics.h \
+        ZoneLookup.h \
+        TeamMetrics.h \
+        RideArchive.h \
+        TrackSimplifier.h \
+        XmlValues.h \
+        ZipStream.h \
         ZeoDownload.h \
         Zones.h \
         ZoneScaleDraw.h
@@ -425,12 +488,17 @@ SOURCES += \
         Athlete.cpp \
         BasicRideMetrics.cpp \
         BatchExportDialog.cpp \
+        Batch.cpp \
+        Benchmark.cpp \
+        BestEfforts.cpp \
         BestIntervalDialog.cpp \
         BikeScore.cpp \
         BinRideFile.cpp \
         Bin2RideFile.cpp \
         BingMap.cpp \
         BlankState.cpp \
+        CacheStats.cpp \
+        CacheStatsDialog.cpp \
         CalendarDownload.cpp \
         ChartSettings.cpp \
         ChooseCyclistDialog.cpp \
@@ -447,10 +515,12 @@ SOURCES += \
         CsvRideFile.cpp \
         DanielsPoints.cpp \
         DataProcessor.cpp \
+        DelimitedText.cpp \
         DBAccess.cpp \
         Device.cpp \
         DeviceTypes.cpp \
         DeviceConfiguration.cpp \
+        DeviceStats.cpp \
         DialWindow.cpp \
         DiarySidebar.cpp \
         DownloadRideDialog.cpp \
@@ -466,8 +536,10 @@ SOURCES += \
         FixSpikes.cpp \
         FixTorque.cpp \
         FixHRSpikes.cpp \
+        FormulaMetric.cpp \
         GcCrashDialog.cpp \
         GcPane.cpp \
+        GcbRideFile.cpp \
         GcRideFile.cpp \
         GcScopeBar.cpp \
         GcSideBarItem.cpp \
@@ -479,6 +551,7 @@ SOURCES += \
         GoogleMapControl.cpp \
         GpxParser.cpp \
         GpxRideFile.cpp \
+        Heatmap.cpp \
         HelpWindow.cpp \
         HistogramWindow.cpp \
         HomeWindow.cpp \
@@ -487,9 +560,12 @@ SOURCES += \
         HrPwPlot.cpp \
         HrPwWindow.cpp \
         IntervalItem.cpp \
+        IntervalOverlay.cpp \
         IntervalSummaryWindow.cpp \
         IntervalTreeView.cpp \
         JouleDevice.cpp \
+        JsonReader.cpp \
+        KmlRideFile.cpp \
         LeftRightBalance.cpp \
         Library.cpp \
         LibraryParser.cpp \
@@ -507,6 +583,7 @@ SOURCES += \
         LTMWindow.cpp \
         MacroDevice.cpp \
         MainWindow.cpp \
+        Maintenance.cpp \
         ManualRideDialog.cpp \
         ManualRideFile.cpp \
         MergeActivityWizard.cpp \
@@ -529,6 +606,7 @@ SOURCES += \
         QuarqRideFile.cpp \
         RawRideFile.cpp \
         RealtimeData.cpp \
+        RealtimeMetrics.cpp \
         RealtimeController.cpp \
         ComputrainerController.cpp \
         RealtimePlot.cpp \
@@ -536,23 +614,32 @@ SOURCES += \
         ReferenceLineDialog.cpp \
         RideEditor.cpp \
         RideFile.cpp \
+        RideCache.cpp \
         RideFileCache.cpp \
+        RollingAverage.cpp \
         RideFileCommand.cpp \
         RideFileTableModel.cpp \
+        RideFingerprint.cpp \
         RideImportWizard.cpp \
         RideItem.cpp \
         RideMetadata.cpp \
         RideMetric.cpp \
         RideNavigator.cpp \
+        RideProfile.cpp \
         RideSummaryWindow.cpp \
         RideWindow.cpp \
+        RiderGridWindow.cpp \
         SaveDialogs.cpp \
+        ScatterDensity.cpp \
         ScatterPlot.cpp \
         ScatterWindow.cpp \
         Season.cpp \
         SeasonParser.cpp \
+        Segments.cpp \
+        SessionRecorder.cpp \
         Serial.cpp \
         Settings.cpp \
+        SimplifiedRoute.cpp \
         SmallPlot.cpp \
         SpecialFields.cpp \
         SpinScanPlot.cpp \
@@ -574,12 +661,15 @@ SOURCES += \
         TacxCafRideFile.cpp \
         TcxParser.cpp \
         TcxRideFile.cpp \
+        TelemetryPublisher.cpp \
+        TelemetryScheduler.cpp \
         TxtRideFile.cpp \
         TimeInZone.cpp \
         TimeUtils.cpp \
         ToolsDialog.cpp \
         ToolsRhoEstimator.cpp \
         TrainDB.cpp \
+        TrainRider.cpp \
         TrainSidebar.cpp \
         TreeMapWindow.cpp \
         TreeMapPlot.cpp \
@@ -592,6 +682,17 @@ SOURCES += \
         WorkoutPlotWindow.cpp \
         WorkoutWizard.cpp \
         WPrime.cpp \
+        DeviceDiscovery.cpp \
+        MetricsExport.cpp \
+        RideFileSaver.cpp \
+        Trace.cpp \
+        IntervalDetector.cpp \
+        RideStatistics.cpp \
+        TeamMetrics.cpp \
+        RideArchive.cpp \
+        TrackSimplifier.cpp \
+        XmlValues.cpp \
+        ZipStream.cpp \
         ZeoDownload.cpp \
         Zones.cpp \
         main.cpp \